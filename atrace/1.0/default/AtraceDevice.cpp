@@ -17,6 +17,11 @@
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <algorithm>
 
 #include "AtraceDevice.h"
 
@@ -74,49 +79,116 @@ AtraceDevice::AtraceDevice() {
     }
 }
 
+void AtraceDevice::ToggleStats::record(std::chrono::nanoseconds duration) {
+    count++;
+    last = duration;
+    max = std::max(max, duration);
+}
+
+int AtraceDevice::getEnableFd(const std::string& event) {
+    auto it = enable_fds_.find(event);
+    if (it != enable_fds_.end()) {
+        return it->second.get();
+    }
+    std::string path =
+            android::base::StringPrintf("%s%s/enable", tracefs_event_root_.c_str(), event.c_str());
+    android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_WRONLY | O_CLOEXEC)));
+    if (fd.get() < 0) {
+        // Not cached, the event may show up once its driver is loaded.
+        return -1;
+    }
+    return enable_fds_.emplace(event, std::move(fd)).first->second.get();
+}
+
+bool AtraceDevice::setEventsEnabled(const std::vector<const TracingPath*>& paths, bool enable) {
+    const char value = enable ? '1' : '0';
+    bool ok = true;
+    for (const TracingPath* p : paths) {
+        int fd = getEnableFd(p->first);
+        if (fd >= 0 && TEMP_FAILURE_RETRY(write(fd, &value, 1)) != 1) {
+            // The event may have gone away with its driver, retry once with a new file.
+            enable_fds_.erase(p->first);
+            fd = getEnableFd(p->first);
+            if (fd >= 0 && TEMP_FAILURE_RETRY(write(fd, &value, 1)) != 1) {
+                fd = -1;
+            }
+        }
+        if (fd < 0) {
+            LOG(ERROR) << "Failed to " << (enable ? "enable" : "disable")
+                       << " tracing on: " << tracefs_event_root_ << p->first << "/enable";
+            if (p->second) {
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
 Return<::android::hardware::atrace::V1_0::Status> AtraceDevice::enableCategories(
         const hidl_vec<hidl_string>& categories) {
     if (!categories.size()) {
         return Status::ERROR_INVALID_ARGUMENT;
     }
 
+    // Check every category before toggling any event, so an invalid one changes nothing.
+    std::vector<const TracingPath*> paths;
     for (auto& c : categories) {
-        if (kTracingMap.count(c)) {
-            for (auto& p : kTracingMap.at(c).paths) {
-                std::string tracefs_event_enable_path = android::base::StringPrintf(
-                        "%s%s/enable", tracefs_event_root_.c_str(), p.first.c_str());
-                if (!android::base::WriteStringToFile("1", tracefs_event_enable_path)) {
-                    LOG(ERROR) << "Failed to enable tracing on: " << tracefs_event_enable_path;
-                    if (p.second) {
-                        // disable before return
-                        disableAllCategories();
-                        return Status::ERROR_TRACING_POINT;
-                    }
-                }
-            }
-        } else {
+        auto it = kTracingMap.find(c);
+        if (it == kTracingMap.end()) {
             return Status::ERROR_INVALID_ARGUMENT;
         }
+        for (auto& p : it->second.paths) {
+            paths.push_back(&p);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = setEventsEnabled(paths, true);
+    enable_stats_.record(std::chrono::steady_clock::now() - start);
+    if (!ok) {
+        // disable before return
+        disableAllCategories();
+        return Status::ERROR_TRACING_POINT;
     }
     return Status::SUCCESS;
 }
 
 Return<::android::hardware::atrace::V1_0::Status> AtraceDevice::disableAllCategories() {
-    auto ret = Status::SUCCESS;
-
+    std::vector<const TracingPath*> paths;
     for (auto& c : kTracingMap) {
         for (auto& p : c.second.paths) {
-            std::string tracefs_event_enable_path = android::base::StringPrintf(
-                    "%s%s/enable", tracefs_event_root_.c_str(), p.first.c_str());
-            if (!android::base::WriteStringToFile("0", tracefs_event_enable_path)) {
-                LOG(ERROR) << "Failed to disable tracing on: " << tracefs_event_enable_path;
-                if (p.second) {
-                    ret = Status::ERROR_TRACING_POINT;
-                }
-            }
+            paths.push_back(&p);
         }
     }
-    return ret;
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = setEventsEnabled(paths, false);
+    disable_stats_.record(std::chrono::steady_clock::now() - start);
+    return ok ? Status::SUCCESS : Status::ERROR_TRACING_POINT;
+}
+
+Return<void> AtraceDevice::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& /*options*/) {
+    if (fd == nullptr || fd->numFds < 1) {
+        return Void();
+    }
+    auto formatStats = [](const char* name, const ToggleStats& stats) {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        return android::base::StringPrintf(
+                "%s: calls %" PRIu64 ", last %lld us, max %lld us\n", name, stats.count,
+                static_cast<long long>(duration_cast<microseconds>(stats.last).count()),
+                static_cast<long long>(duration_cast<microseconds>(stats.max).count()));
+    };
+    std::string out = "tracefs events: " + tracefs_event_root_ + "\n";
+    out += formatStats("enableCategories", enable_stats_);
+    out += formatStats("disableAllCategories", disable_stats_);
+    out += "open enable files:";
+    for (auto& entry : enable_fds_) {
+        out += " " + entry.first;
+    }
+    out += "\n";
+    android::base::WriteStringToFd(out, fd->data[0]);
+    return Void();
 }
 
 }  // namespace implementation
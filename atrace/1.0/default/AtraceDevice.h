@@ -17,10 +17,16 @@
 #ifndef ANDROID_HARDWARE_ATRACE_V1_0_ATRACEDEVICE_H
 #define ANDROID_HARDWARE_ATRACE_V1_0_ATRACEDEVICE_H
 
+#include <android-base/unique_fd.h>
 #include <android/hardware/atrace/1.0/IAtraceDevice.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
 namespace android {
 namespace hardware {
 namespace atrace {
@@ -29,6 +35,7 @@ namespace implementation {
 
 using ::android::sp;
 using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_memory;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
@@ -43,10 +50,33 @@ struct AtraceDevice : public IAtraceDevice {
         const hidl_vec<hidl_string>& categories) override;
     Return<::android::hardware::atrace::V1_0::Status> disableAllCategories() override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
+
   private:
-    std::string tracefs_event_root_;
+    // An event to toggle and whether failing to toggle it is an error.
+    using TracingPath = std::pair<std::string, bool>;
 
-    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    // Writes value to the enable file of every event, opening the files on first use. Returns
+    // false if a required event could not be toggled.
+    bool setEventsEnabled(const std::vector<const TracingPath*>& paths, bool enable);
+    // Returns the cached enable file of an event, or -1 if it can't be opened.
+    int getEnableFd(const std::string& event);
+
+    struct ToggleStats {
+        uint64_t count = 0;
+        std::chrono::nanoseconds last{0};
+        std::chrono::nanoseconds max{0};
+
+        void record(std::chrono::nanoseconds duration);
+    };
+
+    std::string tracefs_event_root_;
+    // Enable files of the events toggled so far, keyed by event. The service has a single binder
+    // thread, so they are not locked.
+    std::map<std::string, android::base::unique_fd> enable_fds_;
+    ToggleStats enable_stats_;
+    ToggleStats disable_stats_;
 };
 
 }  // namespace implementation
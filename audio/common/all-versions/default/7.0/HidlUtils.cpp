@@ -17,6 +17,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <algorithm>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
 
 #define LOG_TAG "HidlUtils"
 #include <log/log.h>
@@ -24,6 +27,7 @@
 #include PATH(APM_XSD_ENUMS_H_FILENAME)
 #include <common/all-versions/HidlSupport.h>
 #include <common/all-versions/VersionUtils.h>
+#include <xsdc/XsdcSupport.h>
 
 #include "HidlUtils.h"
 
@@ -43,8 +47,114 @@ using namespace ::android::audio::policy::configuration::CPP_VERSION;
         result = status;                                \
     }
 
+namespace {
+
+// The XSD names of a HAL enum type, interned once, with lookups in both directions. HIDL strings
+// filled in by fromHal and intern point into the table instead of owning a copy, so conversions
+// do not allocate. The table is never destroyed, so these strings stay valid for the lifetime
+// of the process. Values and names unknown to the table take the regular conversion path.
+template <typename HalType>
+class HalEnumNames {
+  public:
+    using HalFromString = bool (*)(const char*, HalType*);
+    using HalToString = const char* (*)(HalType);
+
+    // Interns the names of XsdEnum that halFromString accepts. fromHal maps their values to the
+    // names halToString returns for them, if those are interned as well.
+    template <typename XsdEnum>
+    static const HalEnumNames* create(HalFromString halFromString, HalToString halToString) {
+        auto names = new HalEnumNames();
+        for (const auto xsdValue : xsdc_enum_range<XsdEnum>{}) {
+            const std::string& name = names->mStorage.emplace_back(toString(xsdValue));
+            HalType value;
+            if (halFromString(name.c_str(), &value)) {
+                names->mValues.emplace(name, value);
+            }
+        }
+        for (const auto& [name, value] : names->mValues) {
+            const char* canonicalName = halToString(value);
+            if (canonicalName == nullptr) continue;
+            if (const auto interned = names->mValues.find(canonicalName);
+                interned != names->mValues.end()) {
+                names->mNames.emplace(value, interned->first);
+            }
+        }
+        return names;
+    }
+
+    bool fromHal(HalType value, hidl_string* name) const {
+        const auto it = mNames.find(value);
+        if (it == mNames.end()) return false;
+        name->setToExternal(it->second.data(), it->second.size());
+        return true;
+    }
+
+    bool toHal(const hidl_string& name, HalType* value) const {
+        const auto it = mValues.find(std::string_view(name.c_str(), name.size()));
+        if (it == mValues.end()) return false;
+        *value = it->second;
+        return true;
+    }
+
+    // Points interned to the interned copy of name.
+    bool intern(const std::string& name, hidl_string* interned) const {
+        const auto it = mValues.find(name);
+        if (it == mValues.end()) return false;
+        interned->setToExternal(it->first.data(), it->first.size());
+        return true;
+    }
+
+  private:
+    HalEnumNames() = default;
+
+    std::deque<std::string> mStorage;  // never reallocates, keys below point into it
+    std::unordered_map<std::string_view, HalType> mValues;
+    std::unordered_map<HalType, std::string_view> mNames;
+};
+
+const HalEnumNames<audio_channel_mask_t>& indexChannelMaskNames() {
+    static const auto names = HalEnumNames<audio_channel_mask_t>::create<xsd::AudioChannelMask>(
+            audio_channel_mask_from_string, audio_channel_index_mask_to_string);
+    return *names;
+}
+
+const HalEnumNames<audio_channel_mask_t>& inputChannelMaskNames() {
+    static const auto names = HalEnumNames<audio_channel_mask_t>::create<xsd::AudioChannelMask>(
+            audio_channel_mask_from_string, audio_channel_in_mask_to_string);
+    return *names;
+}
+
+const HalEnumNames<audio_channel_mask_t>& outputChannelMaskNames() {
+    static const auto names = HalEnumNames<audio_channel_mask_t>::create<xsd::AudioChannelMask>(
+            audio_channel_mask_from_string, audio_channel_out_mask_to_string);
+    return *names;
+}
+
+const HalEnumNames<audio_devices_t>& deviceNames() {
+    static const auto names = HalEnumNames<audio_devices_t>::create<xsd::AudioDevice>(
+            audio_device_from_string, audio_device_to_string);
+    return *names;
+}
+
+const HalEnumNames<audio_format_t>& formatNames() {
+    static const auto names = HalEnumNames<audio_format_t>::create<xsd::AudioFormat>(
+            audio_format_from_string, audio_format_to_string);
+    return *names;
+}
+
+const HalEnumNames<audio_gain_mode_t>& gainModeNames() {
+    static const auto names = HalEnumNames<audio_gain_mode_t>::create<xsd::AudioGainMode>(
+            audio_gain_mode_from_string, audio_gain_mode_to_string);
+    return *names;
+}
+
+}  // namespace
+
 status_t HidlUtils::audioIndexChannelMaskFromHal(audio_channel_mask_t halChannelMask,
                                                  AudioChannelMask* channelMask) {
+    if (indexChannelMaskNames().fromHal(halChannelMask, channelMask)) {
+        return NO_ERROR;
+    }
     *channelMask = audio_channel_index_mask_to_string(halChannelMask);
     if (!channelMask->empty() && !xsd::isUnknownAudioChannelMask(*channelMask)) {
         return NO_ERROR;
@@ -56,6 +166,9 @@ status_t HidlUtils::audioIndexChannelMaskFromHal(audio_channel_mask_t halChannel
 
 status_t HidlUtils::audioInputChannelMaskFromHal(audio_channel_mask_t halChannelMask,
                                                  AudioChannelMask* channelMask) {
+    if (inputChannelMaskNames().fromHal(halChannelMask, channelMask)) {
+        return NO_ERROR;
+    }
     *channelMask = audio_channel_in_mask_to_string(halChannelMask);
     if (!channelMask->empty() && !xsd::isUnknownAudioChannelMask(*channelMask)) {
         return NO_ERROR;
@@ -67,6 +180,9 @@ status_t HidlUtils::audioInputChannelMaskFromHal(audio_channel_mask_t halChannel
 
 status_t HidlUtils::audioOutputChannelMaskFromHal(audio_channel_mask_t halChannelMask,
                                                   AudioChannelMask* channelMask) {
+    if (outputChannelMaskNames().fromHal(halChannelMask, channelMask)) {
+        return NO_ERROR;
+    }
     *channelMask = audio_channel_out_mask_to_string(halChannelMask);
     if (!channelMask->empty() && !xsd::isUnknownAudioChannelMask(*channelMask)) {
         return NO_ERROR;
@@ -103,7 +219,10 @@ status_t HidlUtils::audioChannelMasksFromHal(const std::vector<std::string>& hal
     tempChannelMasks.resize(halChannelMasks.size());
     size_t tempPos = 0;
     for (const auto& halChannelMask : halChannelMasks) {
-        if (!halChannelMask.empty() && !xsd::isUnknownAudioChannelMask(halChannelMask)) {
+        // All channel mask tables intern every name, regardless of the direction.
+        if (outputChannelMaskNames().intern(halChannelMask, &tempChannelMasks[tempPos])) {
+            tempPos++;
+        } else if (!halChannelMask.empty() && !xsd::isUnknownAudioChannelMask(halChannelMask)) {
             tempChannelMasks[tempPos++] = halChannelMask;
         }
     }
@@ -118,6 +237,9 @@ status_t HidlUtils::audioChannelMasksFromHal(const std::vector<std::string>& hal
 
 status_t HidlUtils::audioChannelMaskToHal(const AudioChannelMask& channelMask,
                                           audio_channel_mask_t* halChannelMask) {
+    if (outputChannelMaskNames().toHal(channelMask, halChannelMask)) {
+        return NO_ERROR;
+    }
     if (!xsd::isUnknownAudioChannelMask(channelMask) &&
         audio_channel_mask_from_string(channelMask.c_str(), halChannelMask)) {
         return NO_ERROR;
@@ -224,6 +346,9 @@ status_t HidlUtils::audioContentTypeToHal(const AudioContentType& contentType,
 }
 
 status_t HidlUtils::audioDeviceTypeFromHal(audio_devices_t halDevice, AudioDevice* device) {
+    if (deviceNames().fromHal(halDevice, device)) {
+        return NO_ERROR;
+    }
     *device = audio_device_to_string(halDevice);
     if (!device->empty() && !xsd::isUnknownAudioDevice(*device)) {
         return NO_ERROR;
@@ -234,6 +359,9 @@ status_t HidlUtils::audioDeviceTypeFromHal(audio_devices_t halDevice, AudioDevic
 }
 
 status_t HidlUtils::audioDeviceTypeToHal(const AudioDevice& device, audio_devices_t* halDevice) {
+    if (deviceNames().toHal(device, halDevice)) {
+        return NO_ERROR;
+    }
     if (!xsd::isUnknownAudioDevice(device) && audio_device_from_string(device.c_str(), halDevice)) {
         return NO_ERROR;
     }
@@ -243,6 +371,9 @@ status_t HidlUtils::audioDeviceTypeToHal(const AudioDevice& device, audio_device
 }
 
 status_t HidlUtils::audioFormatFromHal(audio_format_t halFormat, AudioFormat* format) {
+    if (formatNames().fromHal(halFormat, format)) {
+        return NO_ERROR;
+    }
     *format = audio_format_to_string(halFormat);
     if (!format->empty() && !xsd::isUnknownAudioFormat(*format)) {
         return NO_ERROR;
@@ -257,7 +388,9 @@ status_t HidlUtils::audioFormatsFromHal(const std::vector<std::string>& halForma
     tempFormats.resize(halFormats.size());
     size_t tempPos = 0;
     for (const auto& halFormat : halFormats) {
-        if (!halFormat.empty() && !xsd::isUnknownAudioFormat(halFormat)) {
+        if (formatNames().intern(halFormat, &tempFormats[tempPos])) {
+            tempPos++;
+        } else if (!halFormat.empty() && !xsd::isUnknownAudioFormat(halFormat)) {
             tempFormats[tempPos++] = halFormat;
         }
     }
@@ -270,6 +403,9 @@ status_t HidlUtils::audioFormatsFromHal(const std::vector<std::string>& halForma
 }
 
 status_t HidlUtils::audioFormatToHal(const AudioFormat& format, audio_format_t* halFormat) {
+    if (formatNames().toHal(format, halFormat)) {
+        return NO_ERROR;
+    }
     if (!xsd::isUnknownAudioFormat(format) && audio_format_from_string(format.c_str(), halFormat)) {
         return NO_ERROR;
     }
@@ -285,9 +421,12 @@ status_t HidlUtils::audioGainModeMaskFromHal(audio_gain_mode_t halGainModeMask,
     for (uint32_t bit = 0; halGainModeMask != 0 && bit < sizeof(audio_gain_mode_t) * 8; ++bit) {
         audio_gain_mode_t flag = static_cast<audio_gain_mode_t>(1u << bit);
         if ((flag & halGainModeMask) == flag) {
-            AudioGainMode flagStr = audio_gain_mode_to_string(flag);
-            if (!flagStr.empty() && !xsd::isUnknownAudioGainMode(flagStr)) {
-                result.push_back(flagStr);
+            AudioGainMode flagStr;
+            if (gainModeNames().fromHal(flag, &flagStr)) {
+                result.push_back(std::move(flagStr));
+            } else if (flagStr = audio_gain_mode_to_string(flag);
+                       !flagStr.empty() && !xsd::isUnknownAudioGainMode(flagStr)) {
+                result.push_back(std::move(flagStr));
             } else {
                 ALOGE("Unknown audio gain mode value 0x%X", flag);
                 status = BAD_VALUE;
@@ -295,7 +434,9 @@ status_t HidlUtils::audioGainModeMaskFromHal(audio_gain_mode_t halGainModeMask,
             halGainModeMask = static_cast<audio_gain_mode_t>(halGainModeMask & ~flag);
         }
     }
-    *gainModeMask = result;
+    // Move the strings so that interned ones are not copied
+    gainModeMask->resize(result.size());
+    std::move(result.begin(), result.end(), gainModeMask->begin());
     return status;
 }
 
@@ -305,8 +446,9 @@ status_t HidlUtils::audioGainModeMaskToHal(const hidl_vec<AudioGainMode>& gainMo
     *halGainModeMask = {};
     for (const auto& gainMode : gainModeMask) {
         audio_gain_mode_t halGainMode;
-        if (!xsd::isUnknownAudioGainMode(gainMode) &&
-            audio_gain_mode_from_string(gainMode.c_str(), &halGainMode)) {
+        if (gainModeNames().toHal(gainMode, &halGainMode) ||
+            (!xsd::isUnknownAudioGainMode(gainMode) &&
+             audio_gain_mode_from_string(gainMode.c_str(), &halGainMode))) {
             *halGainModeMask = static_cast<audio_gain_mode_t>(*halGainModeMask | halGainMode);
         } else {
             ALOGE("Unknown audio gain mode \"%s\"", gainMode.c_str());
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#define LOG_TAG "HidlUtils_Benchmark"
+#include <log/log.h>
+
+#include <HidlUtils.h>
+#include <system/audio.h>
+
+using namespace android;
+using ::android::hardware::hidl_vec;
+using namespace ::android::hardware::audio::common::COMMON_TYPES_CPP_VERSION;
+using ::android::hardware::audio::common::COMMON_TYPES_CPP_VERSION::implementation::HidlUtils;
+
+// The profile of a USB headset, as queried by getAudioPort on every hot-plug and route change.
+static audio_profile makeUsbProfile() {
+    audio_profile profile = {};
+    profile.format = AUDIO_FORMAT_PCM_16_BIT;
+    profile.num_sample_rates = 4;
+    profile.sample_rates[0] = 44100;
+    profile.sample_rates[1] = 48000;
+    profile.sample_rates[2] = 96000;
+    profile.sample_rates[3] = 192000;
+    const audio_channel_mask_t masks[] = {AUDIO_CHANNEL_OUT_MONO, AUDIO_CHANNEL_OUT_STEREO,
+                                          AUDIO_CHANNEL_OUT_5POINT1, AUDIO_CHANNEL_OUT_7POINT1,
+                                          AUDIO_CHANNEL_INDEX_MASK_2, AUDIO_CHANNEL_INDEX_MASK_8};
+    profile.num_channel_masks = std::size(masks);
+    std::copy(std::begin(masks), std::end(masks), profile.channel_masks);
+    return profile;
+}
+
+static void BM_AudioProfileFromHal(benchmark::State& state) {
+    const audio_profile halProfile = makeUsbProfile();
+    for (auto _ : state) {
+        AudioProfile profile;
+        benchmark::DoNotOptimize(
+                HidlUtils::audioProfileFromHal(halProfile, false /*isInput*/, &profile));
+    }
+}
+BENCHMARK(BM_AudioProfileFromHal);
+
+static void BM_AudioProfileToHal(benchmark::State& state) {
+    AudioProfile profile;
+    HidlUtils::audioProfileFromHal(makeUsbProfile(), false /*isInput*/, &profile);
+    for (auto _ : state) {
+        audio_profile halProfile;
+        benchmark::DoNotOptimize(HidlUtils::audioProfileToHal(profile, &halProfile));
+    }
+}
+BENCHMARK(BM_AudioProfileToHal);
+
+static void BM_AudioFormatsFromHal(benchmark::State& state) {
+    const std::vector<std::string> halFormats = {
+            audio_format_to_string(AUDIO_FORMAT_PCM_16_BIT),
+            audio_format_to_string(AUDIO_FORMAT_PCM_24_BIT_PACKED),
+            audio_format_to_string(AUDIO_FORMAT_PCM_FLOAT),
+            audio_format_to_string(AUDIO_FORMAT_AC3),
+            audio_format_to_string(AUDIO_FORMAT_E_AC3),
+            audio_format_to_string(AUDIO_FORMAT_DTS),
+            audio_format_to_string(AUDIO_FORMAT_AAC_LC),
+            audio_format_to_string(AUDIO_FORMAT_MAT_2_1)};
+    for (auto _ : state) {
+        hidl_vec<AudioFormat> formats;
+        benchmark::DoNotOptimize(HidlUtils::audioFormatsFromHal(halFormats, &formats));
+    }
+}
+BENCHMARK(BM_AudioFormatsFromHal);
+
+static void BM_AudioDeviceTypeRoundTrip(benchmark::State& state) {
+    const audio_devices_t halDevices[] = {AUDIO_DEVICE_OUT_SPEAKER, AUDIO_DEVICE_OUT_USB_HEADSET,
+                                          AUDIO_DEVICE_OUT_BLUETOOTH_A2DP,
+                                          AUDIO_DEVICE_IN_BUILTIN_MIC};
+    for (auto _ : state) {
+        for (const auto halDevice : halDevices) {
+            AudioDevice device;
+            HidlUtils::audioDeviceTypeFromHal(halDevice, &device);
+            audio_devices_t halDeviceBack;
+            benchmark::DoNotOptimize(HidlUtils::audioDeviceTypeToHal(device, &halDeviceBack));
+        }
+    }
+}
+BENCHMARK(BM_AudioDeviceTypeRoundTrip);
+
+static void BM_AudioGainModeMaskFromHal(benchmark::State& state) {
+    const audio_gain_mode_t halGainModeMask = static_cast<audio_gain_mode_t>(
+            AUDIO_GAIN_MODE_JOINT | AUDIO_GAIN_MODE_CHANNELS | AUDIO_GAIN_MODE_RAMP);
+    for (auto _ : state) {
+        hidl_vec<AudioGainMode> gainModeMask;
+        benchmark::DoNotOptimize(HidlUtils::audioGainModeMaskFromHal(halGainModeMask,
+                                                                     &gainModeMask));
+    }
+}
+BENCHMARK(BM_AudioGainModeMaskFromHal);
+
+BENCHMARK_MAIN();
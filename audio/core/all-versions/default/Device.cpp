@@ -47,7 +47,13 @@ namespace util {
 using namespace ::android::hardware::audio::CORE_TYPES_CPP_VERSION::implementation::util;
 }
 
-Device::Device(audio_hw_device_t* device) : mIsClosed(false), mDevice(device) {}
+Device::Device(audio_hw_device_t* device) : mIsClosed(false), mDevice(device) {
+    // Telephony settings of the primary device, which the framework queries on every route change
+    // and which legacy HALs only change through set_parameters.
+    setCacheableKeys({AudioParameter::keyBtNrec, AUDIO_PARAMETER_KEY_BT_SCO_WB,
+                      AUDIO_PARAMETER_KEY_TTY_MODE, AUDIO_PARAMETER_KEY_HAC,
+                      AUDIO_PARAMETER_KEY_HFP_ENABLE});
+}
 
 Device::~Device() {
     (void)doClose();
@@ -71,6 +77,14 @@ void Device::closeOutputStream(audio_stream_out_t* stream) {
     --mOpenedStreamsCount;
 }
 
+void Device::addStreamStats(int32_t ioHandle, const std::shared_ptr<StreamStats>& stats) {
+    std::lock_guard<std::mutex> lock(mStreamStatsLock);
+    mStreamStats.erase(std::remove_if(mStreamStats.begin(), mStreamStats.end(),
+                                      [](const auto& entry) { return entry.second.expired(); }),
+                       mStreamStats.end());
+    mStreamStats.emplace_back(ioHandle, stats);
+}
+
 char* Device::halGetParameters(const char* keys) {
     return mDevice->get_parameters(mDevice, keys);
 }
@@ -182,7 +196,9 @@ std::tuple<Result, sp<IStreamOut>> Device::openOutputStreamCore(int32_t ioHandle
     ALOGV("open_output_stream status %d stream %p", status, halStream);
     sp<IStreamOut> streamOut;
     if (status == OK) {
-        streamOut = new StreamOut(this, halStream);
+        sp<StreamOut> streamOutImpl = new StreamOut(this, halStream);
+        addStreamStats(ioHandle, streamOutImpl->getStats());
+        streamOut = streamOutImpl;
         ++mOpenedStreamsCount;
         android::hardware::setMinSchedulerPolicy(streamOut, SCHED_NORMAL, ANDROID_PRIORITY_AUDIO);
     }
@@ -220,7 +236,9 @@ std::tuple<Result, sp<IStreamIn>> Device::openInputStreamCore(
     ALOGV("open_input_stream status %d stream %p", status, halStream);
     sp<IStreamIn> streamIn;
     if (status == OK) {
-        streamIn = new StreamIn(this, halStream);
+        sp<StreamIn> streamInImpl = new StreamIn(this, halStream);
+        addStreamStats(ioHandle, streamInImpl->getStats());
+        streamIn = streamInImpl;
         ++mOpenedStreamsCount;
         android::hardware::setMinSchedulerPolicy(streamIn, SCHED_NORMAL, ANDROID_PRIORITY_AUDIO);
     }
@@ -526,6 +544,15 @@ Return<void> Device::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& o
         }
 
         analyzeStatus("dump", mDevice->dump(mDevice, fd0));
+
+        std::lock_guard<std::mutex> lock(mStreamStatsLock);
+        for (const auto& [ioHandle, weakStats] : mStreamStats) {
+            if (auto stats = weakStats.lock()) {
+                dprintf(fd0, "\n%s stream statistics (I/O handle %d):\n",
+                        stats->isInput() ? "Input" : "Output", ioHandle);
+                stats->dump(fd0);
+            }
+        }
     }
     return Void();
 }
@@ -17,6 +17,8 @@
 #include "core/default/ParametersUtil.h"
 #include "core/default/Util.h"
 
+#include <stdio.h>
+
 #include <system/audio.h>
 
 #include <util/CoreUtils.h>
@@ -46,37 +48,89 @@ static Result getHalStatusToResult(status_t status) {
     }
 }
 
-Result ParametersUtil::getParam(const char* name, bool* value) {
-    String8 halValue;
-    Result retval = getParam(name, &halValue);
+static Result convertValue(const std::optional<String8>& halValue, bool* value) {
     *value = false;
-    if (retval == Result::OK) {
-        if (halValue.empty()) {
-            return Result::NOT_SUPPORTED;
-        }
-        *value = !(halValue == AudioParameter::valueOff);
+    if (!halValue.has_value() || halValue->empty()) {
+        return Result::NOT_SUPPORTED;
+    }
+    *value = !(*halValue == AudioParameter::valueOff);
+    return Result::OK;
+}
+
+// Follows AudioParameter::getInt.
+static Result convertValue(const std::optional<String8>& halValue, int* value) {
+    *value = 0;
+    if (!halValue.has_value()) {
+        return getHalStatusToResult(BAD_VALUE);
+    }
+    int halInt;
+    if (sscanf(halValue->string(), "%d", &halInt) != 1) {
+        return getHalStatusToResult(INVALID_OPERATION);
+    }
+    *value = halInt;
+    return Result::OK;
+}
+
+static Result convertValue(const std::optional<String8>& halValue, String8* value) {
+    if (!halValue.has_value()) {
+        return getHalStatusToResult(BAD_VALUE);
     }
-    return retval;
+    *value = *halValue;
+    return Result::OK;
+}
+
+Result ParametersUtil::getParam(const char* name, bool* value) {
+    return convertValue(getValues({name})[0], value);
 }
 
 Result ParametersUtil::getParam(const char* name, int* value) {
-    const String8 halName(name);
-    AudioParameter keys;
-    keys.addKey(halName);
-    std::unique_ptr<AudioParameter> params = getParams(keys);
-    return getHalStatusToResult(params->getInt(halName, *value));
+    return convertValue(getValues({name})[0], value);
 }
 
 Result ParametersUtil::getParam(const char* name, String8* value, AudioParameter context) {
+    if (context.size() == 0) {
+        return convertValue(getValues({name})[0], value);
+    }
+    // The value may depend on the context, so it is never cached.
     const String8 halName(name);
     context.addKey(halName);
     std::unique_ptr<AudioParameter> params = getParams(context);
     return getHalStatusToResult(params->get(halName, *value));
 }
 
+void ParametersUtil::getParams(std::vector<ParamQuery>* queries) {
+    std::vector<const char*> names;
+    names.reserve(queries->size());
+    for (const auto& query : *queries) {
+        names.push_back(query.name);
+    }
+    std::vector<std::optional<String8>> values = getValues(names);
+    for (size_t i = 0; i < queries->size(); ++i) {
+        ParamQuery& query = (*queries)[i];
+        query.result = std::visit(
+                [&](auto* value) { return convertValue(values[i], value); }, query.value);
+    }
+}
+
 void ParametersUtil::getParametersImpl(
     const hidl_vec<ParameterValue>& context, const hidl_vec<hidl_string>& keys,
     std::function<void(Result retval, const hidl_vec<ParameterValue>& parameters)> cb) {
+    if (context.size() == 0 && keys.size() != 0 && areCacheable(keys)) {
+        std::vector<const char*> names;
+        names.reserve(keys.size());
+        for (const auto& key : keys) {
+            names.push_back(key.c_str());
+        }
+        std::vector<std::optional<String8>> values = getValues(names);
+        std::vector<ParameterValue> result;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (values[i].has_value()) {
+                result.push_back(ParameterValue{keys[i], values[i]->string()});
+            }
+        }
+        cb(result.empty() ? Result::NOT_SUPPORTED : Result::OK, hidl_vec<ParameterValue>(result));
+        return;
+    }
     AudioParameter halKeys;
     for (auto& pair : context) {
         halKeys.add(String8(pair.key.c_str()), String8(pair.value.c_str()));
@@ -115,6 +169,65 @@ std::unique_ptr<AudioParameter> ParametersUtil::getParams(const AudioParameter&
     return std::unique_ptr<AudioParameter>(new AudioParameter(paramsAndValues));
 }
 
+std::vector<std::optional<String8>> ParametersUtil::getValues(
+        const std::vector<const char*>& names) {
+    std::vector<std::optional<String8>> values(names.size());
+    std::vector<bool> cached(names.size(), false);
+    AudioParameter halKeys;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mCacheLock);
+        generation = mCacheGeneration;
+        for (size_t i = 0; i < names.size(); ++i) {
+            auto it = mCachedValues.find(names[i]);
+            if (it != mCachedValues.end()) {
+                values[i] = it->second;
+                cached[i] = true;
+            } else {
+                halKeys.addKey(String8(names[i]));
+            }
+        }
+    }
+    if (halKeys.size() == 0) {
+        return values;
+    }
+    std::unique_ptr<AudioParameter> halValues = getParams(halKeys);
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    // The values are stale if a set has started since they were requested.
+    const bool canCache = generation == mCacheGeneration;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (cached[i]) continue;
+        String8 halValue;
+        if (halValues->get(String8(names[i]), halValue) == OK) {
+            values[i] = std::move(halValue);
+        }
+        if (canCache && mCacheableKeys.count(names[i]) != 0) {
+            mCachedValues.emplace(names[i], values[i]);
+        }
+    }
+    return values;
+}
+
+bool ParametersUtil::areCacheable(const hidl_vec<hidl_string>& keys) {
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    for (const auto& key : keys) {
+        if (mCacheableKeys.count(key.c_str()) == 0) return false;
+    }
+    return true;
+}
+
+void ParametersUtil::setCacheableKeys(std::initializer_list<const char*> keys) {
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    mCacheableKeys.insert(keys.begin(), keys.end());
+    mCachedValues.clear();
+}
+
+void ParametersUtil::invalidateCache() {
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    ++mCacheGeneration;
+    mCachedValues.clear();
+}
+
 Result ParametersUtil::setParam(const char* name, const char* value) {
     AudioParameter param;
     param.add(String8(name), String8(value));
@@ -163,7 +276,11 @@ Result ParametersUtil::setParam(const char* name, const DeviceAddress& address)
 }
 
 Result ParametersUtil::setParams(const AudioParameter& param) {
+    // The HAL may derive the value of any key from the ones being set, so the whole cache is
+    // dropped. Invalidating again afterwards keeps reads racing with the set out of the cache.
+    invalidateCache();
     int halStatus = halSetParameters(param.toString().string());
+    invalidateCache();
     return util::analyzeStatus(halStatus);
 }
 
@@ -25,8 +25,10 @@
 
 #include <HidlUtils.h>
 #include <android/log.h>
+#include <cutils/properties.h>
 #include <hardware/audio.h>
 #include <util/CoreUtils.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 #include <cmath>
 #include <memory>
@@ -45,11 +47,16 @@ using namespace ::android::hardware::audio::CORE_TYPES_CPP_VERSION::implementati
 
 namespace {
 
+// Lets the legacy HAL fill the shared data message queue directly, only the reads wrapping around
+// the end of the queue go through a private buffer.
+constexpr char kZeroCopyDataMQProperty[] = "vendor.audio.hal.zero_copy_data_mq";
+
 class ReadThread : public Thread {
    public:
     // ReadThread's lifespan never exceeds StreamIn's lifespan.
     ReadThread(std::atomic<bool>* stop, audio_stream_in_t* stream, StreamIn::CommandMQ* commandMQ,
-               StreamIn::DataMQ* dataMQ, StreamIn::StatusMQ* statusMQ, EventFlag* efGroup)
+               StreamIn::DataMQ* dataMQ, StreamIn::StatusMQ* statusMQ, EventFlag* efGroup,
+               StreamStats* stats)
         : Thread(false /*canCallJava*/),
           mStop(stop),
           mStream(stream),
@@ -57,9 +64,12 @@ class ReadThread : public Thread {
           mDataMQ(dataMQ),
           mStatusMQ(statusMQ),
           mEfGroup(efGroup),
-          mBuffer(nullptr) {}
+          mStats(stats),
+          mBuffer(nullptr),
+          mZeroCopy(false) {}
     bool init() {
         mBuffer.reset(new (std::nothrow) uint8_t[mDataMQ->getQuantumCount()]);
+        mZeroCopy = property_get_bool(kZeroCopyDataMQProperty, false);
         return mBuffer != nullptr;
     }
     virtual ~ReadThread() {}
@@ -71,7 +81,9 @@ class ReadThread : public Thread {
     StreamIn::DataMQ* mDataMQ;
     StreamIn::StatusMQ* mStatusMQ;
     EventFlag* mEfGroup;
+    StreamStats* mStats;
     std::unique_ptr<uint8_t[]> mBuffer;
+    bool mZeroCopy;
     IStreamIn::ReadParameters mParameters;
     IStreamIn::ReadStatus mStatus;
 
@@ -79,6 +91,8 @@ class ReadThread : public Thread {
 
     void doGetCapturePosition();
     void doRead();
+    bool doZeroCopyRead(size_t requestedToRead);
+    ssize_t readFromStream(void* data, size_t size);
 };
 
 void ReadThread::doRead() {
@@ -90,8 +104,12 @@ void ReadThread::doRead() {
             "space",
             (int32_t)requestedToRead, (int32_t)availableToWrite);
         requestedToRead = availableToWrite;
+        mStats->recordXrun();
+    }
+    if (mZeroCopy && doZeroCopyRead(requestedToRead)) {
+        return;
     }
-    ssize_t readResult = mStream->read(mStream, &mBuffer[0], requestedToRead);
+    ssize_t readResult = readFromStream(&mBuffer[0], requestedToRead);
     mStatus.retval = Result::OK;
     if (readResult >= 0) {
         mStatus.reply.read = readResult;
@@ -103,9 +121,45 @@ void ReadThread::doRead() {
     }
 }
 
+ssize_t ReadThread::readFromStream(void* data, size_t size) {
+    const nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    ssize_t readResult = mStream->read(mStream, data, size);
+    mStats->recordTransfer(systemTime(SYSTEM_TIME_MONOTONIC) - startNs, size, readResult);
+    return readResult;
+}
+
+// Returns false if the data would wrap around the end of the queue, then it has to be read through
+// the private buffer.
+bool ReadThread::doZeroCopyRead(size_t requestedToRead) {
+    StreamIn::DataMQ::MemTransaction tx;
+    if (!mDataMQ->beginWrite(requestedToRead, &tx)) {
+        return false;
+    }
+    const auto& first = tx.getFirstRegion();
+    if (first.getLength() < requestedToRead) {
+        return false;
+    }
+    ssize_t readResult = readFromStream(first.getAddress(), requestedToRead);
+    mStatus.retval = Result::OK;
+    if (readResult >= 0) {
+        mStatus.reply.read = readResult;
+        if (!mDataMQ->commitWrite(readResult)) {
+            ALOGW("data message queue commit write failed");
+        }
+    } else {
+        mStatus.retval = Stream::analyzeStatus("read", readResult);
+    }
+    return true;
+}
+
 void ReadThread::doGetCapturePosition() {
     mStatus.retval = StreamIn::getCapturePositionImpl(
         mStream, &mStatus.reply.capturePosition.frames, &mStatus.reply.capturePosition.time);
+    if (mStatus.retval == Result::OK) {
+        mStats->recordPosition(mStatus.reply.capturePosition.frames,
+                               mStatus.reply.capturePosition.time,
+                               mStream->common.get_sample_rate(&mStream->common));
+    }
 }
 
 bool ReadThread::threadLoop() {
@@ -121,6 +175,7 @@ bool ReadThread::threadLoop() {
         if (!mCommandMQ->read(&mParameters)) {
             continue;  // Nothing to do.
         }
+        const nsecs_t commandStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
         mStatus.replyTo = mParameters.command;
         switch (mParameters.command) {
             case IStreamIn::ReadCommand::READ:
@@ -137,6 +192,7 @@ bool ReadThread::threadLoop() {
         if (!mStatusMQ->write(&mStatus)) {
             ALOGW("status message queue write failed");
         }
+        mStats->recordCommand(systemTime(SYSTEM_TIME_MONOTONIC) - commandStartNs);
         mEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::NOT_EMPTY));
     }
 
@@ -150,6 +206,7 @@ StreamIn::StreamIn(const sp<Device>& device, audio_stream_in_t* stream)
       mStream(stream),
       mStreamCommon(new Stream(true /*isInput*/, &stream->common)),
       mStreamMmap(new StreamMmap<audio_stream_in_t>(stream)),
+      mStats(std::make_shared<StreamStats>(true /*isInput*/)),
       mEfGroup(nullptr),
       mStopReadThread(false) {}
 
@@ -285,7 +342,7 @@ Return<Result> StreamIn::setParameters(const hidl_vec<ParameterValue>& parameter
 }
 
 Return<void> StreamIn::debugDump(const hidl_handle& fd) {
-    return mStreamCommon->debugDump(fd);
+    return debug(fd, {} /* options */);
 }
 #elif MAJOR_VERSION >= 4
 Return<void> StreamIn::getDevices(getDevices_cb _hidl_cb) {
@@ -418,7 +475,7 @@ Return<void> StreamIn::prepareForReading(uint32_t frameSize, uint32_t framesCoun
     // Create and launch the thread.
     auto tempReadThread =
             sp<ReadThread>::make(&mStopReadThread, mStream, tempCommandMQ.get(), tempDataMQ.get(),
-                                 tempStatusMQ.get(), tempElfGroup.get());
+                                 tempStatusMQ.get(), tempElfGroup.get(), mStats.get());
     if (!tempReadThread->init()) {
         ALOGW("failed to start reader thread: %s", strerror(-status));
         sendError(Result::INVALID_ARGUMENTS);
@@ -478,7 +535,12 @@ Return<void> StreamIn::getCapturePosition(getCapturePosition_cb _hidl_cb) {
 }
 
 Return<void> StreamIn::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) {
-    return mStreamCommon->debug(fd, options);
+    mStreamCommon->debug(fd, options);
+    if (fd.getNativeHandle() != nullptr && fd->numFds == 1) {
+        dprintf(fd->data[0], "\nInput stream statistics:\n");
+        mStats->dump(fd->data[0]);
+    }
+    return Void();
 }
 
 #if MAJOR_VERSION >= 4
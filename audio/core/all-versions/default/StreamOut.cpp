@@ -29,8 +29,10 @@
 #include <HidlUtils.h>
 #include <android/log.h>
 #include <audio_utils/Metadata.h>
+#include <cutils/properties.h>
 #include <hardware/audio.h>
 #include <util/CoreUtils.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 
 namespace android {
@@ -47,12 +49,22 @@ using namespace ::android::hardware::audio::CORE_TYPES_CPP_VERSION::implementati
 
 namespace {
 
+// Lets the legacy HAL consume the data straight from the shared data message queue, only the
+// writes wrapping around the end of the queue are copied to a private buffer.
+constexpr char kZeroCopyDataMQProperty[] = "vendor.audio.hal.zero_copy_data_mq";
+
+// The age up to which a published position answers getPresentationPosition. Positions are published
+// every PublishedPosition::kPublishIntervalNs while writing, so an older one means that the stream
+// is not written to anymore, e.g. while draining, and the legacy HAL is asked instead.
+constexpr nsecs_t kMaxPublishedPositionAgeNs = 50 * 1000000;
+
 class WriteThread : public Thread {
    public:
     // WriteThread's lifespan never exceeds StreamOut's lifespan.
     WriteThread(std::atomic<bool>* stop, audio_stream_out_t* stream,
                 StreamOut::CommandMQ* commandMQ, StreamOut::DataMQ* dataMQ,
-                StreamOut::StatusMQ* statusMQ, EventFlag* efGroup)
+                StreamOut::StatusMQ* statusMQ, EventFlag* efGroup, StreamStats* stats,
+                PublishedPosition* publishedPosition)
         : Thread(false /*canCallJava*/),
           mStop(stop),
           mStream(stream),
@@ -60,9 +72,13 @@ class WriteThread : public Thread {
           mDataMQ(dataMQ),
           mStatusMQ(statusMQ),
           mEfGroup(efGroup),
-          mBuffer(nullptr) {}
+          mStats(stats),
+          mPublishedPosition(publishedPosition),
+          mBuffer(nullptr),
+          mZeroCopy(false) {}
     bool init() {
         mBuffer.reset(new (std::nothrow) uint8_t[mDataMQ->getQuantumCount()]);
+        mZeroCopy = property_get_bool(kZeroCopyDataMQProperty, false);
         return mBuffer != nullptr;
     }
     virtual ~WriteThread() {}
@@ -74,7 +90,10 @@ class WriteThread : public Thread {
     StreamOut::DataMQ* mDataMQ;
     StreamOut::StatusMQ* mStatusMQ;
     EventFlag* mEfGroup;
+    StreamStats* mStats;
+    PublishedPosition* mPublishedPosition;
     std::unique_ptr<uint8_t[]> mBuffer;
+    bool mZeroCopy;
     IStreamOut::WriteStatus mStatus;
 
     bool threadLoop() override;
@@ -82,26 +101,90 @@ class WriteThread : public Thread {
     void doGetLatency();
     void doGetPresentationPosition();
     void doWrite();
+    void publishPosition();
+    void doZeroCopyWrite(size_t availToRead);
+    void writeToStream(const uint8_t* data, size_t size);
 };
 
+void WriteThread::writeToStream(const uint8_t* data, size_t size) {
+    const nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    ssize_t writeResult = mStream->write(mStream, data, size);
+    mStats->recordTransfer(systemTime(SYSTEM_TIME_MONOTONIC) - startNs, size, writeResult);
+    if (writeResult >= 0) {
+        mStatus.reply.written = writeResult;
+        publishPosition();
+    } else {
+        mStatus.retval = Stream::analyzeStatus("write", writeResult);
+    }
+}
+
 void WriteThread::doWrite() {
     const size_t availToRead = mDataMQ->availableToRead();
     mStatus.retval = Result::OK;
     mStatus.reply.written = 0;
+    if (availToRead == 0) {
+        mStats->recordXrun();
+    }
+    if (mZeroCopy) {
+        doZeroCopyWrite(availToRead);
+        return;
+    }
     if (mDataMQ->read(&mBuffer[0], availToRead)) {
-        ssize_t writeResult = mStream->write(mStream, &mBuffer[0], availToRead);
-        if (writeResult >= 0) {
-            mStatus.reply.written = writeResult;
-        } else {
-            mStatus.retval = Stream::analyzeStatus("write", writeResult);
-        }
+        writeToStream(&mBuffer[0], availToRead);
+    }
+}
+
+void WriteThread::doZeroCopyWrite(size_t availToRead) {
+    StreamOut::DataMQ::MemTransaction tx;
+    if (!mDataMQ->beginRead(availToRead, &tx)) {
+        return;
+    }
+    const auto& first = tx.getFirstRegion();
+    const auto& second = tx.getSecondRegion();
+    if (second.getLength() == 0) {
+        writeToStream(first.getAddress(), availToRead);
+    } else {
+        // The data wraps around the end of the queue, the legacy HAL needs it contiguous.
+        memcpy(&mBuffer[0], first.getAddress(), first.getLength());
+        memcpy(&mBuffer[first.getLength()], second.getAddress(), second.getLength());
+        writeToStream(&mBuffer[0], availToRead);
+    }
+    // Same as read(), the data is consumed whatever the legacy HAL has written.
+    if (!mDataMQ->commitRead(availToRead)) {
+        ALOGE("data message queue commit read failed");
+    }
+}
+
+int64_t toNs(const TimeSpec& timeStamp) {
+    return timeStamp.tvSec * 1000000000LL + timeStamp.tvNSec;
+}
+
+void WriteThread::publishPosition() {
+    const nsecs_t nowNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (!mPublishedPosition->isPublishDue(nowNs)) {
+        return;
+    }
+    const uint32_t generation = mPublishedPosition->generation();
+    uint64_t frames;
+    TimeSpec timeStamp;
+    if (StreamOut::getPresentationPositionImpl(mStream, &frames, &timeStamp) == Result::OK) {
+        mPublishedPosition->publish(generation, frames, toNs(timeStamp), nowNs);
     }
 }
 
 void WriteThread::doGetPresentationPosition() {
+    const nsecs_t nowNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    const uint32_t generation = mPublishedPosition->generation();
     mStatus.retval =
         StreamOut::getPresentationPositionImpl(mStream, &mStatus.reply.presentationPosition.frames,
                                                &mStatus.reply.presentationPosition.timeStamp);
+    if (mStatus.retval == Result::OK) {
+        const TimeSpec& timeStamp = mStatus.reply.presentationPosition.timeStamp;
+        mPublishedPosition->publish(generation, mStatus.reply.presentationPosition.frames,
+                                    toNs(timeStamp), nowNs);
+        mStats->recordPosition(mStatus.reply.presentationPosition.frames, toNs(timeStamp),
+                               mStream->common.get_sample_rate(&mStream->common));
+    }
 }
 
 void WriteThread::doGetLatency() {
@@ -122,6 +205,7 @@ bool WriteThread::threadLoop() {
         if (!mCommandMQ->read(&mStatus.replyTo)) {
             continue;  // Nothing to do.
         }
+        const nsecs_t commandStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
         switch (mStatus.replyTo) {
             case IStreamOut::WriteCommand::WRITE:
                 doWrite();
@@ -140,6 +224,7 @@ bool WriteThread::threadLoop() {
         if (!mStatusMQ->write(&mStatus)) {
             ALOGE("status message queue write failed");
         }
+        mStats->recordCommand(systemTime(SYSTEM_TIME_MONOTONIC) - commandStartNs);
         mEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::NOT_FULL));
     }
 
@@ -153,6 +238,7 @@ StreamOut::StreamOut(const sp<Device>& device, audio_stream_out_t* stream)
       mStream(stream),
       mStreamCommon(new Stream(false /*isInput*/, &stream->common)),
       mStreamMmap(new StreamMmap<audio_stream_out_t>(stream)),
+      mStats(std::make_shared<StreamStats>(false /*isInput*/)),
       mEfGroup(nullptr),
       mStopWriteThread(false) {}
 
@@ -263,7 +349,10 @@ Return<Result> StreamOut::removeEffect(uint64_t effectId) {
 }
 
 Return<Result> StreamOut::standby() {
-    return mStreamCommon->standby();
+    // After the legacy call, so that a write racing with it cannot publish a position from before.
+    Result result = mStreamCommon->standby();
+    mPublishedPosition.invalidate();
+    return result;
 }
 
 Return<Result> StreamOut::setHwAvSync(uint32_t hwAvSync) {
@@ -293,7 +382,7 @@ Return<Result> StreamOut::setParameters(const hidl_vec<ParameterValue>& paramete
 }
 
 Return<void> StreamOut::debugDump(const hidl_handle& fd) {
-    return mStreamCommon->debugDump(fd);
+    return debug(fd, {} /* options */);
 }
 #elif MAJOR_VERSION >= 4
 Return<void> StreamOut::getDevices(getDevices_cb _hidl_cb) {
@@ -404,7 +493,8 @@ Return<void> StreamOut::prepareForWriting(uint32_t frameSize, uint32_t framesCou
     // Create and launch the thread.
     auto tempWriteThread =
             sp<WriteThread>::make(&mStopWriteThread, mStream, tempCommandMQ.get(), tempDataMQ.get(),
-                                  tempStatusMQ.get(), tempElfGroup.get());
+                                  tempStatusMQ.get(), tempElfGroup.get(), mStats.get(),
+                                  &mPublishedPosition);
     if (!tempWriteThread->init()) {
         ALOGW("failed to start writer thread: %s", strerror(-status));
         sendError(Result::INVALID_ARGUMENTS);
@@ -510,9 +600,11 @@ Return<void> StreamOut::supportsPauseAndResume(supportsPauseAndResume_cb _hidl_c
 }
 
 Return<Result> StreamOut::pause() {
-    return mStream->pause != NULL
-                   ? Stream::analyzeStatus("pause", mStream->pause(mStream), {ENOSYS} /*ignore*/)
-                   : Result::NOT_SUPPORTED;
+    Result result = mStream->pause != NULL ? Stream::analyzeStatus("pause", mStream->pause(mStream),
+                                                                   {ENOSYS} /*ignore*/)
+                                           : Result::NOT_SUPPORTED;
+    mPublishedPosition.invalidate();
+    return result;
 }
 
 Return<Result> StreamOut::resume() {
@@ -535,9 +627,11 @@ Return<Result> StreamOut::drain(AudioDrain type) {
 }
 
 Return<Result> StreamOut::flush() {
-    return mStream->flush != NULL
-                   ? Stream::analyzeStatus("flush", mStream->flush(mStream), {ENOSYS} /*ignore*/)
-                   : Result::NOT_SUPPORTED;
+    Result result = mStream->flush != NULL ? Stream::analyzeStatus("flush", mStream->flush(mStream),
+                                                                   {ENOSYS} /*ignore*/)
+                                           : Result::NOT_SUPPORTED;
+    mPublishedPosition.invalidate();
+    return result;
 }
 
 // static
@@ -564,7 +658,15 @@ Result StreamOut::getPresentationPositionImpl(audio_stream_out_t* stream, uint64
 Return<void> StreamOut::getPresentationPosition(getPresentationPosition_cb _hidl_cb) {
     uint64_t frames = 0;
     TimeSpec timeStamp = {0, 0};
-    Result retval = getPresentationPositionImpl(mStream, &frames, &timeStamp);
+    Result retval = Result::OK;
+    int64_t timeNs;
+    if (mPublishedPosition.read(systemTime(SYSTEM_TIME_MONOTONIC) - kMaxPublishedPositionAgeNs,
+                                &frames, &timeNs)) {
+        timeStamp.tvSec = timeNs / 1000000000LL;
+        timeStamp.tvNSec = timeNs % 1000000000LL;
+    } else {
+        retval = getPresentationPositionImpl(mStream, &frames, &timeStamp);
+    }
     _hidl_cb(retval, frames, timeStamp);
     return Void();
 }
@@ -587,7 +689,12 @@ Return<void> StreamOut::getMmapPosition(getMmapPosition_cb _hidl_cb) {
 }
 
 Return<void> StreamOut::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) {
-    return mStreamCommon->debug(fd, options);
+    mStreamCommon->debug(fd, options);
+    if (fd.getNativeHandle() != nullptr && fd->numFds == 1) {
+        dprintf(fd->data[0], "\nOutput stream statistics:\n");
+        mStats->dump(fd->data[0]);
+    }
+    return Void();
 }
 
 #if MAJOR_VERSION >= 4
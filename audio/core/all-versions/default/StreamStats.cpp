@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "StreamStatsHAL"
+
+#include "core/default/StreamStats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+void StreamStats::Histogram::record(int64_t valueUs) {
+    valueUs = std::max<int64_t>(valueUs, 0);
+    size_t bucket = 0;
+    if (valueUs > 0) {
+        bucket = std::min<size_t>(64 - __builtin_clzll(valueUs), kBucketCount - 1);
+    }
+    mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSumUs.fetch_add(valueUs, std::memory_order_relaxed);
+    // Only one thread records, no need for a compare-and-swap loop.
+    if (valueUs > mMaxUs.load(std::memory_order_relaxed)) {
+        mMaxUs.store(valueUs, std::memory_order_relaxed);
+    }
+}
+
+void StreamStats::Histogram::dump(int fd, const char* name) const {
+    const uint64_t count = mCount.load(std::memory_order_relaxed);
+    dprintf(fd, "  %s (us): count %" PRIu64 ", avg %" PRIu64 ", max %" PRId64 "\n", name, count,
+            count > 0 ? mSumUs.load(std::memory_order_relaxed) / count : 0,
+            mMaxUs.load(std::memory_order_relaxed));
+    if (count == 0) {
+        return;
+    }
+    dprintf(fd, "   ");
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        const uint64_t bucketCount = mBuckets[i].load(std::memory_order_relaxed);
+        if (bucketCount == 0) {
+            continue;
+        }
+        if (i == kBucketCount - 1) {
+            dprintf(fd, " >=%llu: %" PRIu64, 1ULL << (i - 1), bucketCount);
+        } else {
+            dprintf(fd, " <%llu: %" PRIu64, 1ULL << i, bucketCount);
+        }
+    }
+    dprintf(fd, "\n");
+}
+
+void StreamStats::recordTransfer(int64_t durationNs, size_t requested, ssize_t transferred) {
+    mTransferDurations.record(durationNs / 1000);
+    if (transferred < 0) {
+        mErrorCount.fetch_add(1, std::memory_order_relaxed);
+    } else if (static_cast<size_t>(transferred) < requested) {
+        mShortTransferCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void StreamStats::recordCommand(int64_t durationNs) {
+    mCommandDurations.record(durationNs / 1000);
+}
+
+void StreamStats::recordPosition(uint64_t frames, int64_t timeNs, uint32_t sampleRate) {
+    // The position restarts on standby or flush, only compare positions going forward.
+    if (sampleRate != 0 && mLastPositionTimeNs != 0 && frames > mLastFrames &&
+        timeNs > mLastPositionTimeNs) {
+        const int64_t framesUs =
+                static_cast<int64_t>((frames - mLastFrames) * 1000000 / sampleRate);
+        const int64_t elapsedUs = (timeNs - mLastPositionTimeNs) / 1000;
+        mPositionDeviations.record(std::abs(elapsedUs - framesUs));
+    }
+    mLastFrames = frames;
+    mLastPositionTimeNs = timeNs;
+}
+
+void StreamStats::dump(int fd) const {
+    mTransferDurations.dump(fd, mIsInput ? "HAL read duration" : "HAL write duration");
+    mCommandDurations.dump(fd, "command duration");
+    mPositionDeviations.dump(
+            fd, mIsInput ? "capture position deviation" : "presentation position deviation");
+    dprintf(fd, "  %s: %" PRIu64 ", short %s: %" PRIu64 ", errors: %" PRIu64 "\n",
+            mIsInput ? "overruns" : "underruns", mXrunCount.load(std::memory_order_relaxed),
+            mIsInput ? "reads" : "writes", mShortTransferCount.load(std::memory_order_relaxed),
+            mErrorCount.load(std::memory_order_relaxed));
+}
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
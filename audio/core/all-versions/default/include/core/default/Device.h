@@ -20,8 +20,12 @@
 #include PATH(android/hardware/audio/FILE_VERSION/IDevice.h)
 
 #include "ParametersUtil.h"
+#include "StreamStats.h"
 
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #include <hardware/audio.h>
 #include <media/AudioParameter.h>
@@ -177,10 +181,14 @@ struct Device : public IDevice, public ParametersUtil {
     bool mIsClosed;
     audio_hw_device_t* mDevice;
     int mOpenedStreamsCount = 0;
+    // Statistics of the opened streams by I/O handle, dumped by 'debug'.
+    std::mutex mStreamStatsLock;
+    std::vector<std::pair<int32_t, std::weak_ptr<StreamStats>>> mStreamStats;
 
     virtual ~Device();
 
     Result doClose();
+    void addStreamStats(int32_t ioHandle, const std::shared_ptr<StreamStats>& stats);
     std::tuple<Result, AudioPatchHandle> createOrUpdateAudioPatch(
             AudioPatchHandle patch, const hidl_vec<AudioPortConfig>& sources,
             const hidl_vec<AudioPortConfig>& sinks);
@@ -23,7 +23,14 @@
 // clang-format on
 
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <variant>
+#include <vector>
 
 #include <hidl/HidlSupport.h>
 #include <media/AudioParameter.h>
@@ -41,6 +48,14 @@ using namespace ::android::hardware::audio::CORE_TYPES_CPP_VERSION;
 
 class ParametersUtil {
    public:
+    // A typed value to read with getParams. The result is NOT_SUPPORTED if the HAL does not
+    // return the key, and INVALID_ARGUMENTS if its value can not be converted.
+    struct ParamQuery {
+        const char* name;
+        std::variant<bool*, int*, String8*> value;
+        Result result = Result::NOT_SUPPORTED;
+    };
+
     Result setParam(const char* name, const char* value);
     Result getParam(const char* name, bool* value);
     Result getParam(const char* name, int* value);
@@ -49,6 +64,8 @@ class ParametersUtil {
         const hidl_vec<ParameterValue>& context, const hidl_vec<hidl_string>& keys,
         std::function<void(Result retval, const hidl_vec<ParameterValue>& parameters)> cb);
     std::unique_ptr<AudioParameter> getParams(const AudioParameter& keys);
+    // Reads several values with at most one call to the HAL.
+    void getParams(std::vector<ParamQuery>* queries);
     Result setParam(const char* name, bool value);
     Result setParam(const char* name, int value);
     Result setParam(const char* name, float value);
@@ -62,6 +79,22 @@ class ParametersUtil {
 
     virtual char* halGetParameters(const char* keys) = 0;
     virtual int halSetParameters(const char* keysAndValues) = 0;
+
+    // Values of these keys are kept after being read from the HAL, until the next call to
+    // setParams. Only keys that the HAL changes solely through setParameters may be cached.
+    void setCacheableKeys(std::initializer_list<const char*> keys);
+
+   private:
+    // Returns the values of the keys, or nullopt for keys the HAL does not return.
+    std::vector<std::optional<String8>> getValues(const std::vector<const char*>& names);
+    bool areCacheable(const hidl_vec<hidl_string>& keys);
+    void invalidateCache();
+
+    std::mutex mCacheLock;
+    std::set<std::string, std::less<>> mCacheableKeys;  // Only changed on construction.
+    std::map<std::string, std::optional<String8>, std::less<>> mCachedValues;
+    // Incremented by every set, so that values read while a set is in progress are not cached.
+    uint64_t mCacheGeneration = 0;
 };
 
 }  // namespace implementation
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_AUDIO_PUBLISHEDPOSITION_H
+#define ANDROID_HARDWARE_AUDIO_PUBLISHEDPOSITION_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <commonsupport/SeqLocked.h>
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+/**
+ * The last presentation position of an output stream, published by its writer thread while it
+ * writes, so that position queries are answered without calling into the legacy HAL. Any thread
+ * reads or invalidates it without locking.
+ *
+ * The writer takes the generation before querying the legacy HAL and publishes with it, a
+ * position queried before the last invalidate() is never read.
+ */
+class PublishedPosition {
+  public:
+    // Writes closer to each other than this publish the position once only.
+    static constexpr int64_t kPublishIntervalNs = 10 * 1000000;
+
+    /** Returns whether the writer thread is to publish a position at nowNs (CLOCK_MONOTONIC). */
+    bool isPublishDue(int64_t nowNs) const {
+        return mPublishedGeneration != generation() || nowNs - mPublishedAtNs >= kPublishIntervalNs;
+    }
+    /** Returns the generation to publish a position with, taken before querying it. */
+    uint32_t generation() const { return mGeneration.load(std::memory_order_acquire); }
+    /** Called by the writer thread only, nowNs is the time isPublishDue() was checked at. */
+    void publish(uint32_t generation, uint64_t frames, int64_t timeNs, int64_t nowNs) {
+        mPosition.store({frames, timeNs, generation});
+        mPublishedGeneration = generation;
+        mPublishedAtNs = nowNs;
+    }
+    /**
+     * Drops the position and the ones being published, e.g. after the stream has stopped
+     * playing.
+     */
+    void invalidate() { mGeneration.fetch_add(1); }
+    /** Returns false without a valid position taken after minTimeNs (CLOCK_MONOTONIC). */
+    bool read(int64_t minTimeNs, uint64_t* frames, int64_t* timeNs) const {
+        const Position position = mPosition.load();
+        if (position.generation != mGeneration.load() || position.timeNs < minTimeNs) {
+            return false;
+        }
+        *frames = position.frames;
+        *timeNs = position.timeNs;
+        return true;
+    }
+
+  private:
+    struct Position {
+        uint64_t frames;
+        int64_t timeNs;
+        uint32_t generation;
+    };
+
+    std::atomic<uint32_t> mGeneration = 1;
+    ::android::SeqLocked<Position> mPosition{{0, 0, 0}};
+    // The last publish(), for the writer thread only.
+    uint32_t mPublishedGeneration = 0;
+    int64_t mPublishedAtNs = 0;
+};
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_AUDIO_PUBLISHEDPOSITION_H
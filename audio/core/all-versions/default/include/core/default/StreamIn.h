@@ -23,6 +23,7 @@
 
 #include "Device.h"
 #include "Stream.h"
+#include "StreamStats.h"
 
 #include <atomic>
 #include <memory>
@@ -131,6 +132,8 @@ struct StreamIn : public IStreamIn {
     static Result getCapturePositionImpl(audio_stream_in_t* stream, uint64_t* frames,
                                          uint64_t* time);
 
+    std::shared_ptr<StreamStats> getStats() const { return mStats; }
+
   private:
 #if MAJOR_VERSION >= 4
     Result doUpdateSinkMetadata(const SinkMetadata& sinkMetadata);
@@ -143,6 +146,7 @@ struct StreamIn : public IStreamIn {
     audio_stream_in_t* mStream;
     const sp<Stream> mStreamCommon;
     const sp<StreamMmap<audio_stream_in_t>> mStreamMmap;
+    const std::shared_ptr<StreamStats> mStats;
     std::unique_ptr<CommandMQ> mCommandMQ;
     std::unique_ptr<DataMQ> mDataMQ;
     std::unique_ptr<StatusMQ> mStatusMQ;
@@ -20,7 +20,9 @@
 #include PATH(android/hardware/audio/FILE_VERSION/IStreamOut.h)
 
 #include "Device.h"
+#include "PublishedPosition.h"
 #include "Stream.h"
+#include "StreamStats.h"
 
 #include <atomic>
 #include <memory>
@@ -148,6 +150,8 @@ struct StreamOut : public IStreamOut {
     Return<Result> setEventCallback(const sp<IStreamOutEventCallback>& callback) override;
 #endif
 
+    std::shared_ptr<StreamStats> getStats() const { return mStats; }
+
   private:
 #if MAJOR_VERSION >= 4
     Result doUpdateSourceMetadata(const SourceMetadata& sourceMetadata);
@@ -166,6 +170,8 @@ struct StreamOut : public IStreamOut {
     audio_stream_out_t* mStream;
     const sp<Stream> mStreamCommon;
     const sp<StreamMmap<audio_stream_out_t>> mStreamMmap;
+    const std::shared_ptr<StreamStats> mStats;
+    PublishedPosition mPublishedPosition;
     mediautils::atomic_sp<IStreamOutCallback> mCallback;  // for non-blocking write and drain
 #if MAJOR_VERSION >= 6
     mediautils::atomic_sp<IStreamOutEventCallback> mEventCallback;
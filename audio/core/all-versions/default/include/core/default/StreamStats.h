@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_AUDIO_STREAMSTATS_H
+#define ANDROID_HARDWARE_AUDIO_STREAMSTATS_H
+
+#include <sys/types.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+/**
+ * Timing statistics of a stream. The values are recorded by the stream writer
+ * or reader thread with atomic operations only, so the real time thread never
+ * waits on a lock held by a binder thread dumping them.
+ */
+class StreamStats {
+  public:
+    explicit StreamStats(bool isInput) : mIsInput(isInput) {}
+    StreamStats(const StreamStats&) = delete;
+    StreamStats& operator=(const StreamStats&) = delete;
+
+    /** Records a call to the legacy HAL 'write' or 'read'. */
+    void recordTransfer(int64_t durationNs, size_t requested, ssize_t transferred);
+    /** Records the time from reading a command off the command MQ to writing its status. */
+    void recordCommand(int64_t durationNs);
+    /**
+     * Records a transfer command that could not be served from the data MQ:
+     * an empty queue on output, a queue too full for the whole read on input.
+     */
+    void recordXrun() { mXrunCount.fetch_add(1, std::memory_order_relaxed); }
+    /**
+     * Records a presentation or capture position, and the deviation of the time
+     * elapsed since the previous position from the time the frames represent.
+     * Only called by the stream thread.
+     */
+    void recordPosition(uint64_t frames, int64_t timeNs, uint32_t sampleRate);
+
+    bool isInput() const { return mIsInput; }
+    void dump(int fd) const;
+
+  private:
+    // Power of 2 buckets in microseconds, the last bucket has all the larger values.
+    class Histogram {
+      public:
+        static constexpr size_t kBucketCount = 16;
+
+        void record(int64_t valueUs);
+        void dump(int fd, const char* name) const;
+
+      private:
+        std::array<std::atomic<uint64_t>, kBucketCount> mBuckets{};
+        std::atomic<uint64_t> mCount = 0;
+        std::atomic<uint64_t> mSumUs = 0;
+        std::atomic<int64_t> mMaxUs = 0;
+    };
+
+    const bool mIsInput;
+    Histogram mTransferDurations;
+    Histogram mCommandDurations;
+    Histogram mPositionDeviations;
+    std::atomic<uint64_t> mXrunCount = 0;
+    std::atomic<uint64_t> mShortTransferCount = 0;
+    std::atomic<uint64_t> mErrorCount = 0;
+    // The previous position, only used by the stream thread.
+    uint64_t mLastFrames = 0;
+    int64_t mLastPositionTimeNs = 0;
+};
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_AUDIO_STREAMSTATS_H
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <core/default/PublishedPosition.h>
+
+using ::android::hardware::audio::CPP_VERSION::implementation::PublishedPosition;
+
+static constexpr int64_t kMs = 1000000;
+
+TEST(PublishedPositionTest, NoPositionBeforePublish) {
+    PublishedPosition position;
+    uint64_t frames;
+    int64_t timeNs;
+    EXPECT_FALSE(position.read(0, &frames, &timeNs));
+    EXPECT_TRUE(position.isPublishDue(0));
+}
+
+TEST(PublishedPositionTest, ReadsThePublishedPosition) {
+    PublishedPosition position;
+    position.publish(position.generation(), 480, 100 * kMs, 101 * kMs);
+    uint64_t frames = 0;
+    int64_t timeNs = 0;
+    ASSERT_TRUE(position.read(90 * kMs, &frames, &timeNs));
+    EXPECT_EQ(480u, frames);
+    EXPECT_EQ(100 * kMs, timeNs);
+    // Older than asked for.
+    EXPECT_FALSE(position.read(100 * kMs + 1, &frames, &timeNs));
+}
+
+TEST(PublishedPositionTest, ThrottlesPublishing) {
+    PublishedPosition position;
+    position.publish(position.generation(), 480, 100 * kMs, 100 * kMs);
+    EXPECT_FALSE(position.isPublishDue(100 * kMs + PublishedPosition::kPublishIntervalNs - 1));
+    EXPECT_TRUE(position.isPublishDue(100 * kMs + PublishedPosition::kPublishIntervalNs));
+}
+
+TEST(PublishedPositionTest, InvalidateDropsThePosition) {
+    PublishedPosition position;
+    position.publish(position.generation(), 480, 100 * kMs, 100 * kMs);
+    position.invalidate();
+    uint64_t frames;
+    int64_t timeNs;
+    EXPECT_FALSE(position.read(0, &frames, &timeNs));
+    // The next write publishes again, however recent the last position is.
+    EXPECT_TRUE(position.isPublishDue(100 * kMs));
+}
+
+TEST(PublishedPositionTest, InvalidateDropsPositionsBeingPublished) {
+    PublishedPosition position;
+    // The writer queries the legacy HAL while the stream is stopped.
+    const uint32_t generation = position.generation();
+    position.invalidate();
+    position.publish(generation, 480, 100 * kMs, 100 * kMs);
+    uint64_t frames;
+    int64_t timeNs;
+    EXPECT_FALSE(position.read(0, &frames, &timeNs));
+    EXPECT_TRUE(position.isPublishDue(100 * kMs));
+
+    position.publish(position.generation(), 960, 110 * kMs, 110 * kMs);
+    ASSERT_TRUE(position.read(0, &frames, &timeNs));
+    EXPECT_EQ(960u, frames);
+}
+
+TEST(PublishedPositionTest, ReadsAreConsistentWhilePublishing) {
+    PublishedPosition position;
+    std::atomic<bool> stop = false;
+    std::thread writer([&] {
+        for (int64_t i = 1; !stop; i++) {
+            // The frames are the time in ms.
+            position.publish(position.generation(), i, i * kMs, i * kMs);
+        }
+    });
+    for (int i = 0; i < 100000; i++) {
+        uint64_t frames;
+        int64_t timeNs;
+        if (position.read(0, &frames, &timeNs)) {
+            ASSERT_EQ(static_cast<int64_t>(frames) * kMs, timeNs);
+        }
+    }
+    stop = true;
+    writer.join();
+}
@@ -20,6 +20,7 @@
 #define ATRACE_TAG ATRACE_TAG_AUDIO
 
 #include "Effect.h"
+#include "ProcessThread.h"
 #include "common/all-versions/default/EffectMap.h"
 
 #define ATRACE_TAG ATRACE_TAG_AUDIO
@@ -27,7 +28,6 @@
 #include <android/log.h>
 #include <cutils/properties.h>
 #include <media/EffectsFactoryApi.h>
-#include <mediautils/ScopedStatistics.h>
 #include <sys/syscall.h>
 #include <system/audio_effects/effect_spatializer.h>
 #include <util/EffectUtils.h>
@@ -204,102 +204,6 @@ status_t updateSpatializerPriority(pid_t tid) {
 
 }  // namespace scheduler
 
-#define SCOPED_STATS()                                                       \
-    ::android::mediautils::ScopedStatistics scopedStatistics {               \
-        std::string("EffectHal::").append(__func__), mEffectHal->mStatistics \
-    }
-
-class ProcessThread : public Thread {
-   public:
-    // ProcessThread's lifespan never exceeds Effect's lifespan.
-     ProcessThread(std::atomic<bool>* stop, effect_handle_t effect,
-                   std::atomic<audio_buffer_t*>* inBuffer, std::atomic<audio_buffer_t*>* outBuffer,
-                   Effect::StatusMQ* statusMQ, EventFlag* efGroup, Effect* effectHal)
-         : Thread(false /*canCallJava*/),
-           mStop(stop),
-           mEffect(effect),
-           mHasProcessReverse((*mEffect)->process_reverse != NULL),
-           mInBuffer(inBuffer),
-           mOutBuffer(outBuffer),
-           mStatusMQ(statusMQ),
-           mEfGroup(efGroup),
-           mEffectHal(effectHal) {}
-     virtual ~ProcessThread() {}
-
-   private:
-    std::atomic<bool>* mStop;
-    effect_handle_t mEffect;
-    bool mHasProcessReverse;
-    std::atomic<audio_buffer_t*>* mInBuffer;
-    std::atomic<audio_buffer_t*>* mOutBuffer;
-    Effect::StatusMQ* mStatusMQ;
-    EventFlag* mEfGroup;
-    Effect* const mEffectHal;
-
-    bool threadLoop() override;
-};
-
-bool ProcessThread::threadLoop() {
-    // This implementation doesn't return control back to the Thread until it decides to stop,
-    // as the Thread uses mutexes, and this can lead to priority inversion.
-    while (!std::atomic_load_explicit(mStop, std::memory_order_acquire)) {
-        uint32_t efState = 0;
-        mEfGroup->wait(static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS_ALL), &efState);
-        if (!(efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS_ALL)) ||
-            (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_QUIT))) {
-            continue;  // Nothing to do or time to quit.
-        }
-        Result retval = Result::OK;
-        if (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS_REVERSE) &&
-            !mHasProcessReverse) {
-            retval = Result::NOT_SUPPORTED;
-        }
-
-        if (retval == Result::OK) {
-            // affects both buffer pointers and their contents.
-            std::atomic_thread_fence(std::memory_order_acquire);
-            int32_t processResult;
-            audio_buffer_t* inBuffer =
-                std::atomic_load_explicit(mInBuffer, std::memory_order_relaxed);
-            audio_buffer_t* outBuffer =
-                std::atomic_load_explicit(mOutBuffer, std::memory_order_relaxed);
-            if (inBuffer != nullptr && outBuffer != nullptr) {
-                // Time this effect process
-                SCOPED_STATS();
-
-                if (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS)) {
-                    processResult = (*mEffect)->process(mEffect, inBuffer, outBuffer);
-                } else {
-                    processResult = (*mEffect)->process_reverse(mEffect, inBuffer, outBuffer);
-                }
-                std::atomic_thread_fence(std::memory_order_release);
-            } else {
-                ALOGE("processing buffers were not set before calling 'process'");
-                processResult = -ENODEV;
-            }
-            switch (processResult) {
-                case 0:
-                    retval = Result::OK;
-                    break;
-                case -ENODATA:
-                    retval = Result::INVALID_STATE;
-                    break;
-                case -EINVAL:
-                    retval = Result::INVALID_ARGUMENTS;
-                    break;
-                default:
-                    retval = Result::NOT_INITIALIZED;
-            }
-        }
-        if (!mStatusMQ->write(&retval)) {
-            ALOGW("status message queue write failed");
-        }
-        mEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::DONE_PROCESSING));
-    }
-
-    return false;
-}
-
 }  // namespace
 
 // static
@@ -309,7 +213,11 @@ const char* Effect::sContextCallFunction = sContextCallToCommand;
 const char* Effect::sContextConversion = "conversion";
 
 Effect::Effect(bool isInput, effect_handle_t handle)
-    : mIsInput(isInput), mHandle(handle), mEfGroup(nullptr), mStopProcessThread(false) {
+    : mIsInput(isInput),
+      mHandle(handle),
+      mParameterBatch(handle),
+      mEfGroup(nullptr),
+      mStopProcessThread(false) {
     (void)mIsInput;  // prevent 'unused field' warnings in pre-V7 versions.
 }
 
@@ -462,6 +370,7 @@ Result Effect::analyzeStatus(const char* funcName, const char* subFuncName,
 void Effect::getConfigImpl(int commandCode, const char* commandName, GetConfigCallback cb) {
     uint32_t halResultSize = sizeof(effect_config_t);
     effect_config_t halConfig{};
+    mParameterBatch.apply();
     status_t status =
         (*mHandle)->command(mHandle, commandCode, 0, NULL, &halResultSize, &halConfig);
     EffectConfig config;
@@ -552,13 +461,19 @@ Return<void> Effect::prepareForProcessing(prepareForProcessing_cb _hidl_cb) {
 
     // Create and launch the thread.
     mProcessThread = new ProcessThread(&mStopProcessThread, mHandle, &mHalInBufferPtr,
-                                       &mHalOutBufferPtr, tempStatusMQ.get(), mEfGroup, this);
+                                       &mHalOutBufferPtr, tempStatusMQ.get(), mEfGroup,
+                                       mStatistics, &mParameterBatch);
     status = mProcessThread->run("effect", PRIORITY_URGENT_AUDIO);
     if (status != OK) {
         ALOGW("failed to start effect processing thread: %s", strerror(-status));
         _hidl_cb(Result::INVALID_ARGUMENTS, MQDescriptorSync<Result>());
         return Void();
     }
+    {
+        std::lock_guard<std::mutex> lock(mBatchingLock);
+        mProcessThreadRunning = true;
+        updateParameterBatchingLocked();
+    }
 
     // For a spatializer effect, we perform scheduler adjustments to reduce glitches and power.
     // We do it here instead of the ProcessThread::threadLoop to ensure that mHandle is valid.
@@ -600,6 +515,7 @@ Result Effect::sendCommand(int commandCode, const char* commandName) {
 }
 
 Result Effect::sendCommand(int commandCode, const char* commandName, uint32_t size, void* data) {
+    mParameterBatch.apply();
     status_t status = (*mHandle)->command(mHandle, commandCode, size, data, 0, NULL);
     return analyzeCommandStatus(commandName, sContextCallToCommand, status);
 }
@@ -612,6 +528,7 @@ Result Effect::sendCommandReturningData(int commandCode, const char* commandName
 Result Effect::sendCommandReturningData(int commandCode, const char* commandName, uint32_t size,
                                         void* data, uint32_t* replySize, void* replyData) {
     uint32_t expectedReplySize = *replySize;
+    mParameterBatch.apply();
     status_t status = (*mHandle)->command(mHandle, commandCode, size, data, replySize, replyData);
     if (status == OK && *replySize != expectedReplySize) {
         status = -ENODATA;
@@ -635,6 +552,7 @@ Result Effect::sendCommandReturningStatusAndData(int commandCode, const char* co
                                                  uint32_t size, void* data, uint32_t* replySize,
                                                  void* replyData, uint32_t minReplySize,
                                                  CommandSuccessCallback onSuccess) {
+    mParameterBatch.apply();
     status_t status = (*mHandle)->command(mHandle, commandCode, size, data, replySize, replyData);
     Result retval;
     if (status == OK && minReplySize >= sizeof(uint32_t) && *replySize >= minReplySize) {
@@ -664,12 +582,20 @@ Result Effect::setConfigImpl(int commandCode, const char* commandName, const Eff
                                       &halConfig);
 }
 
+void Effect::updateParameterBatchingLocked() {
+    // Without a processing thread of its own, nothing would apply the batch.
+    mParameterBatch.setEnabled(mBatchingRequested && mProcessThreadRunning && !mOffloaded);
+}
+
 Result Effect::setParameterImpl(uint32_t paramSize, const void* paramData, uint32_t valueSize,
                                 const void* valueData) {
     std::vector<uint8_t> halParamBuffer;
     if (!parameterToHal(paramSize, paramData, valueSize, &valueData, &halParamBuffer)) {
         return Result::INVALID_ARGUMENTS;
     }
+    if (mParameterBatch.add(halParamBuffer)) {
+        return Result::OK;
+    }
     return sendCommandReturningStatus(EFFECT_CMD_SET_PARAM, "SET_PARAM", halParamBuffer.size(),
                                       &halParamBuffer[0]);
 }
@@ -840,6 +766,13 @@ Return<Result> Effect::setAuxChannelsConfig(const EffectAuxChannelsConfig& confi
 Return<Result> Effect::offload(const EffectOffloadParameter& param) {
     effect_offload_param_t halParam;
     effectOffloadParamToHal(param, &halParam);
+    // Offloaded effects are not processed here, so updates are no longer batched, and those
+    // already queued are applied before the command.
+    {
+        std::lock_guard<std::mutex> lock(mBatchingLock);
+        mOffloaded = param.isOffload;
+        updateParameterBatchingLocked();
+    }
     return sendCommandReturningStatus(EFFECT_CMD_OFFLOAD, "OFFLOAD", sizeof(effect_offload_param_t),
                                       &halParam);
 }
@@ -877,6 +810,15 @@ Return<void> Effect::command(uint32_t commandId, const hidl_vec<uint8_t>& data,
             }
             [[fallthrough]];  // allow 'gtid' overload (checked halDataSize and resultMaxSize).
         default:
+            if (commandId == kCommandBatchParameters && halDataSize == sizeof(int32_t) &&
+                resultMaxSize == 0) {
+                std::lock_guard<std::mutex> lock(mBatchingLock);
+                mBatchingRequested = *reinterpret_cast<int32_t*>(dataPtr) != 0;
+                updateParameterBatchingLocked();
+                status = OK;
+                break;
+            }
+            mParameterBatch.apply();
             status = (*mHandle)->command(mHandle, commandId, halDataSize, dataPtr, &halResultSize,
                                          resultPtr);
             break;
@@ -947,6 +889,11 @@ Return<Result> Effect::close() {
         return Result::INVALID_STATE;
     }
     mStopProcessThread.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(mBatchingLock);
+        mProcessThreadRunning = false;
+        updateParameterBatchingLocked();
+    }
     if (mEfGroup) {
         mEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_QUIT));
     }
@@ -966,7 +913,7 @@ Return<void> Effect::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& /
     if (fd.getNativeHandle() != nullptr && fd->numFds == 1) {
         uint32_t cmdData = fd->data[0];
         (void)sendCommand(EFFECT_CMD_DUMP, "DUMP", sizeof(cmdData), &cmdData);
-        const std::string s = mStatistics->dump();
+        const std::string s = mStatistics->dump() + mParameterBatch.dump();
         if (s.size() != 0) write(cmdData, s.c_str(), s.size());
     }
     return Void();
@@ -20,9 +20,11 @@
 #include PATH(android/hardware/audio/effect/FILE_VERSION/IEffect.h)
 
 #include "AudioBufferManager.h"
+#include "ParameterBatch.h"
 
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <fmq/EventFlag.h>
@@ -191,8 +193,20 @@ struct Effect : public IEffect {
     static const char* sContextCallToCommand;
     static const char* sContextCallFunction;
 
+    // Private command enabling parameter batching, with an int32_t 0 or 1 as data. While enabled
+    // and the effect is processed by its own thread, parameter updates are queued and applied
+    // by the processing thread before the next buffer, and always succeed.
+    static constexpr uint32_t kCommandBatchParameters = 'pbat';
+
     const bool mIsInput;
     effect_handle_t mHandle;
+    ParameterBatch mParameterBatch;
+    // Parameters are batched while all of these hold. Guarded by mBatchingLock, which is taken
+    // before the lock of mParameterBatch.
+    std::mutex mBatchingLock;
+    bool mBatchingRequested = false;
+    bool mProcessThreadRunning = false;
+    bool mOffloaded = false;
     sp<AudioBufferWrapper> mInBuffer;
     sp<AudioBufferWrapper> mOutBuffer;
     std::atomic<audio_buffer_t*> mHalInBufferPtr;
@@ -236,6 +250,7 @@ struct Effect : public IEffect {
                                              uint32_t size, void* data, uint32_t* replySize,
                                              void* replyData, uint32_t minReplySize,
                                              CommandSuccessCallback onSuccess);
+    void updateParameterBatchingLocked();
     Result setConfigImpl(int commandCode, const char* commandName, const EffectConfig& config,
                          const sp<IEffectBufferProviderCallback>& inputBufferProvider,
                          const sp<IEffectBufferProviderCallback>& outputBufferProvider);
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EffectHAL"
+
+#include "ParameterBatch.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <android-base/stringprintf.h>
+#include <android/log.h>
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace effect {
+namespace CPP_VERSION {
+namespace implementation {
+
+namespace {
+
+// Whether two effect_param_t address the same parameter, whatever their values.
+bool isSameParameter(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    const effect_param_t* paramA = reinterpret_cast<const effect_param_t*>(a.data());
+    const effect_param_t* paramB = reinterpret_cast<const effect_param_t*>(b.data());
+    return paramA->psize == paramB->psize &&
+           memcmp(paramA->data, paramB->data, paramA->psize) == 0;
+}
+
+}  // namespace
+
+bool ParameterBatch::add(const std::vector<uint8_t>& halParam) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mEnabled) return false;
+    mStats.queued++;
+    auto pendingEnd = mEntries.begin() + mCount;
+    auto same = std::find_if(mEntries.begin(), pendingEnd, [&](const std::vector<uint8_t>& e) {
+        return isSameParameter(e, halParam);
+    });
+    if (same != pendingEnd) {
+        // Move the replaced update to the end so that the updates keep the order of their last
+        // change.
+        std::rotate(same, same + 1, pendingEnd);
+        mStats.coalesced++;
+    } else {
+        if (mCount == mEntries.size()) mEntries.emplace_back();
+        mCount++;
+    }
+    // Reuses the capacity of the entry.
+    mEntries[mCount - 1].assign(halParam.begin(), halParam.end());
+    mPending.store(true, std::memory_order_release);
+    return true;
+}
+
+void ParameterBatch::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!enabled) applyLocked();
+    mEnabled = enabled;
+}
+
+void ParameterBatch::tryApply() {
+    if (!mPending.load(std::memory_order_acquire)) return;
+    std::unique_lock<std::mutex> lock(mLock, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    applyLocked();
+}
+
+void ParameterBatch::apply() {
+    if (!mPending.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(mLock);
+    applyLocked();
+}
+
+void ParameterBatch::applyLocked() {
+    for (size_t i = 0; i < mCount; i++) {
+        std::vector<uint8_t>& entry = mEntries[i];
+        int32_t replyStatus = 0;
+        uint32_t replySize = sizeof(replyStatus);
+        const int status = (*mEffect)->command(mEffect, EFFECT_CMD_SET_PARAM, entry.size(),
+                                               entry.data(), &replySize, &replyStatus);
+        if (status != 0 || replyStatus != 0) {
+            // The client has already been told that the update was accepted.
+            ALOGW_IF(mStats.failed == 0, "%s: parameter update rejected: %d, status %d", __func__,
+                     status, replyStatus);
+            mStats.failed++;
+        }
+    }
+    if (mCount > 0) {
+        mStats.applied += mCount;
+        mStats.batches++;
+        mStats.maxBatchSize = std::max(mStats.maxBatchSize, mCount);
+    }
+    mCount = 0;
+    mPending.store(false, std::memory_order_release);
+}
+
+ParameterBatch::Stats ParameterBatch::getStats() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+std::string ParameterBatch::dump() {
+    const Stats stats = getStats();
+    return base::StringPrintf("parameter batch: %" PRIu64 " queued, %" PRIu64
+                              " coalesced, %" PRIu64 " applied in %" PRIu64
+                              " batches (max %zu), %" PRIu64 " rejected\n",
+                              stats.queued, stats.coalesced, stats.applied, stats.batches,
+                              stats.maxBatchSize, stats.failed);
+}
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace effect
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
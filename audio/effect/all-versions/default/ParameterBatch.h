@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_AUDIO_EFFECT_PARAMETER_BATCH_H
+#define ANDROID_HARDWARE_AUDIO_EFFECT_PARAMETER_BATCH_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <hardware/audio_effect.h>
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace effect {
+namespace CPP_VERSION {
+namespace implementation {
+
+// Parameter updates of an effect that its processing thread applies in one go, right before it
+// processes the next buffer, instead of sending one EFFECT_CMD_SET_PARAM per update on the thread
+// of the caller. An update replaces a pending update of the same parameter, so a slider moving
+// several times between two buffers costs a single command. Updates are applied in the order of
+// their last change.
+class ParameterBatch {
+   public:
+    struct Stats {
+        uint64_t queued = 0;
+        // Updates replaced by a later update of the same parameter before being applied
+        uint64_t coalesced = 0;
+        uint64_t applied = 0;
+        // Applied updates that the effect rejected
+        uint64_t failed = 0;
+        uint64_t batches = 0;
+        size_t maxBatchSize = 0;
+    };
+
+    explicit ParameterBatch(effect_handle_t effect) : mEffect(effect) {}
+
+    // Queues an effect_param_t with its value, as sent with EFFECT_CMD_SET_PARAM. Returns false
+    // without queueing it while batching is disabled, the caller then sends it itself.
+    bool add(const std::vector<uint8_t>& halParam);
+
+    // Batching starts disabled. Disabling it applies the pending updates, so that none is left
+    // for a processing thread that may be gone.
+    void setEnabled(bool enabled);
+
+    // Applies the pending updates unless a client thread is adding or applying updates, in which
+    // case they are left for the next buffer. Never blocks; called by the processing thread.
+    void tryApply();
+
+    // Applies the pending updates, waiting for the processing thread if it is applying them.
+    // Called by the client threads before any command that may depend on the updates.
+    void apply();
+
+    Stats getStats();
+    std::string dump();
+
+   private:
+    ParameterBatch(const ParameterBatch&) = delete;
+    void operator=(const ParameterBatch&) = delete;
+
+    // mLock must be held.
+    void applyLocked();
+
+    const effect_handle_t mEffect;
+    // Tells the processing thread whether there is anything to apply, without taking mLock.
+    std::atomic<bool> mPending = false;
+    std::mutex mLock;
+    // Guarded by mLock.
+    bool mEnabled = false;
+    // Guarded by mLock. The first mCount entries are pending, the others keep their capacity for
+    // the next updates so that the processing thread never frees memory.
+    std::vector<std::vector<uint8_t>> mEntries;
+    size_t mCount = 0;
+    Stats mStats;
+};
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace effect
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_AUDIO_EFFECT_PARAMETER_BATCH_H
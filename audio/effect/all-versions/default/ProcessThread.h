@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_AUDIO_EFFECT_PROCESS_THREAD_H
+#define ANDROID_HARDWARE_AUDIO_EFFECT_PROCESS_THREAD_H
+
+#include PATH(android/hardware/audio/effect/FILE_VERSION/types.h)
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <fmq/EventFlag.h>
+#include <fmq/MessageQueue.h>
+#include <mediautils/MethodStatistics.h>
+#include <utils/Thread.h>
+
+#include <hardware/audio_effect.h>
+
+#include "ParameterBatch.h"
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace effect {
+namespace CPP_VERSION {
+namespace implementation {
+
+using namespace ::android::hardware::audio::effect::CPP_VERSION;
+
+// Waits for processing requests on the event flag of a status MQ, runs the process function of
+// the effect for each of them and writes its status. Pending parameter updates of the effect, if
+// given, are applied right before each buffer is processed.
+class ProcessThread : public Thread {
+   public:
+    typedef MessageQueue<Result, kSynchronizedReadWrite> StatusMQ;
+    using Statistics = mediautils::MethodStatistics<std::string>;
+
+    // The lifespan of the thread must not exceed the lifespan of the effect and of the objects
+    // passed by pointer.
+    ProcessThread(std::atomic<bool>* stop, effect_handle_t effect,
+                  std::atomic<audio_buffer_t*>* inBuffer, std::atomic<audio_buffer_t*>* outBuffer,
+                  StatusMQ* statusMQ, EventFlag* efGroup, std::shared_ptr<Statistics> statistics,
+                  ParameterBatch* parameters = nullptr);
+    virtual ~ProcessThread() {}
+
+   private:
+    std::atomic<bool>* mStop;
+    effect_handle_t mEffect;
+    bool mHasProcessReverse;
+    std::atomic<audio_buffer_t*>* mInBuffer;
+    std::atomic<audio_buffer_t*>* mOutBuffer;
+    StatusMQ* mStatusMQ;
+    EventFlag* mEfGroup;
+    const std::shared_ptr<Statistics> mStatistics;
+    ParameterBatch* const mParameters;
+
+    bool threadLoop() override;
+};
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace effect
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_AUDIO_EFFECT_PROCESS_THREAD_H
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ParameterBatch.h"
+
+using ::android::hardware::audio::effect::CPP_VERSION::implementation::ParameterBatch;
+
+namespace {
+
+// An effect recording the parameters it is set to, as (parameter, value) pairs.
+struct FakeEffect {
+    static int32_t command(effect_handle_t self, uint32_t cmdCode, uint32_t /*cmdSize*/,
+                           void* cmdData, uint32_t* /*replySize*/, void* replyData) {
+        FakeEffect* effect = reinterpret_cast<FakeEffect*>(self);
+        if (cmdCode != EFFECT_CMD_SET_PARAM) return -EINVAL;
+        const effect_param_t* param = static_cast<const effect_param_t*>(cmdData);
+        int32_t values[2];
+        memcpy(values, param->data, sizeof(values));
+        std::lock_guard<std::mutex> guard(effect->lock);
+        effect->applied.push_back({values[0], values[1]});
+        *static_cast<int32_t*>(replyData) = values[1] < 0 ? -EINVAL : 0;
+        return 0;
+    }
+
+    FakeEffect() { interface.command = command; }
+
+    effect_handle_t handle() { return reinterpret_cast<effect_handle_t>(this); }
+
+    std::vector<std::pair<int32_t, int32_t>> getApplied() {
+        std::lock_guard<std::mutex> guard(lock);
+        return applied;
+    }
+
+    // First, so that a pointer to the fake is an effect_handle_t.
+    const effect_interface_s* interfacePtr = &interface;
+    effect_interface_s interface{};
+    std::mutex lock;
+    std::vector<std::pair<int32_t, int32_t>> applied;
+};
+
+// An effect_param_t setting the int32_t parameter to the int32_t value.
+std::vector<uint8_t> makeParam(int32_t parameter, int32_t value) {
+    std::vector<uint8_t> halParam(sizeof(effect_param_t) + 2 * sizeof(int32_t));
+    effect_param_t* param = reinterpret_cast<effect_param_t*>(halParam.data());
+    param->psize = sizeof(int32_t);
+    param->vsize = sizeof(int32_t);
+    memcpy(param->data, &parameter, sizeof(parameter));
+    memcpy(param->data + sizeof(parameter), &value, sizeof(value));
+    return halParam;
+}
+
+}  // namespace
+
+TEST(ParameterBatchTest, DisabledByDefault) {
+    FakeEffect effect;
+    ParameterBatch batch(effect.handle());
+    EXPECT_FALSE(batch.add(makeParam(1, 10)));
+    batch.apply();
+    EXPECT_TRUE(effect.getApplied().empty());
+    EXPECT_EQ(0u, batch.getStats().queued);
+}
+
+TEST(ParameterBatchTest, AppliesQueuedUpdates) {
+    FakeEffect effect;
+    ParameterBatch batch(effect.handle());
+    batch.setEnabled(true);
+    ASSERT_TRUE(batch.add(makeParam(1, 10)));
+    ASSERT_TRUE(batch.add(makeParam(2, 20)));
+    EXPECT_TRUE(effect.getApplied().empty());
+
+    batch.tryApply();
+    EXPECT_EQ((std::vector<std::pair<int32_t, int32_t>>{{1, 10}, {2, 20}}), effect.getApplied());
+    const ParameterBatch::Stats stats = batch.getStats();
+    EXPECT_EQ(2u, stats.queued);
+    EXPECT_EQ(2u, stats.applied);
+    EXPECT_EQ(1u, stats.batches);
+    EXPECT_EQ(2u, stats.maxBatchSize);
+
+    // Nothing is left to apply.
+    batch.apply();
+    EXPECT_EQ(2u, effect.getApplied().size());
+}
+
+TEST(ParameterBatchTest, CoalescesUpdatesOfTheSameParameter) {
+    FakeEffect effect;
+    ParameterBatch batch(effect.handle());
+    batch.setEnabled(true);
+    batch.add(makeParam(1, 10));
+    batch.add(makeParam(2, 20));
+    batch.add(makeParam(1, 11));
+    batch.add(makeParam(3, 30));
+    batch.add(makeParam(1, 12));
+
+    batch.apply();
+    // In the order of their last change.
+    EXPECT_EQ((std::vector<std::pair<int32_t, int32_t>>{{2, 20}, {3, 30}, {1, 12}}),
+              effect.getApplied());
+    const ParameterBatch::Stats stats = batch.getStats();
+    EXPECT_EQ(5u, stats.queued);
+    EXPECT_EQ(2u, stats.coalesced);
+    EXPECT_EQ(3u, stats.applied);
+}
+
+TEST(ParameterBatchTest, ReusesEntriesAcrossBatches) {
+    FakeEffect effect;
+    ParameterBatch batch(effect.handle());
+    batch.setEnabled(true);
+    batch.add(makeParam(1, 10));
+    batch.add(makeParam(2, 20));
+    batch.apply();
+    batch.add(makeParam(3, 30));
+    batch.apply();
+    EXPECT_EQ((std::vector<std::pair<int32_t, int32_t>>{{1, 10}, {2, 20}, {3, 30}}),
+              effect.getApplied());
+    EXPECT_EQ(2u, batch.getStats().batches);
+}
+
+TEST(ParameterBatchTest, CountsRejectedUpdates) {
+    FakeEffect effect;
+    ParameterBatch batch(effect.handle());
+    batch.setEnabled(true);
+    batch.add(makeParam(1, -1));
+    batch.add(makeParam(2, 20));
+    batch.apply();
+    EXPECT_EQ(2u, effect.getApplied().size());
+    EXPECT_EQ(1u, batch.getStats().failed);
+}
+
+TEST(ParameterBatchTest, DisablingAppliesPendingUpdates) {
+    FakeEffect effect;
+    ParameterBatch batch(effect.handle());
+    batch.setEnabled(true);
+    batch.add(makeParam(1, 10));
+    batch.setEnabled(false);
+    EXPECT_EQ((std::vector<std::pair<int32_t, int32_t>>{{1, 10}}), effect.getApplied());
+    EXPECT_FALSE(batch.add(makeParam(2, 20)));
+}
+
+TEST(ParameterBatchTest, NoUpdateIsLeftBehindWhenDisabledConcurrently) {
+    FakeEffect effect;
+    ParameterBatch batch(effect.handle());
+    batch.setEnabled(true);
+    constexpr int32_t kUpdates = 10000;
+    int32_t queued = 0;
+    std::thread client([&] {
+        for (int32_t i = 0; i < kUpdates; i++) {
+            if (batch.add(makeParam(i, i))) queued++;
+        }
+    });
+    batch.setEnabled(false);
+    client.join();
+    // Updates refused after disabling are the caller's to send, all others are applied.
+    EXPECT_EQ(static_cast<size_t>(queued), effect.getApplied().size());
+}
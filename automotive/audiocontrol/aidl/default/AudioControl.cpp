@@ -113,6 +113,11 @@ ndk::ScopedAStatus AudioControl::onAudioFocusChange(const string& in_usage, int3
 
 ndk::ScopedAStatus AudioControl::onDevicesToDuckChange(
         const std::vector<DuckingInfo>& in_duckingInfos) {
+    // Ramps start before anything is logged.
+    for (const DuckingInfo& duckingInfo : in_duckingInfos) {
+        mGainRampEngine.setDucked(duckingInfo.deviceAddressesToUnduck, false);
+        mGainRampEngine.setDucked(duckingInfo.deviceAddressesToDuck, true);
+    }
     LOG(INFO) << "AudioControl::onDevicesToDuckChange";
     for (const DuckingInfo& duckingInfo : in_duckingInfos) {
         LOG(INFO) << "zone: " << duckingInfo.zoneId;
@@ -134,6 +139,10 @@ ndk::ScopedAStatus AudioControl::onDevicesToDuckChange(
 
 ndk::ScopedAStatus AudioControl::onDevicesToMuteChange(
         const std::vector<MutingInfo>& in_mutingInfos) {
+    for (const MutingInfo& mutingInfo : in_mutingInfos) {
+        mGainRampEngine.setMuted(mutingInfo.deviceAddressesToUnmute, false);
+        mGainRampEngine.setMuted(mutingInfo.deviceAddressesToMute, true);
+    }
     LOG(INFO) << "AudioControl::onDevicesToMuteChange";
     for (const MutingInfo& mutingInfo : in_mutingInfos) {
         LOG(INFO) << "zone: " << mutingInfo.zoneId;
@@ -221,12 +230,15 @@ binder_status_t AudioControl::dumpsys(int fd) {
         dprintf(fd, "Focus listener registered\n");
     }
     dprintf(fd, "AudioGainCallback %sregistered\n", (mAudioGainCallback == nullptr ? "NOT " : ""));
+    mGainRampEngine.dump(fd);
     return STATUS_OK;
 }
 
 binder_status_t AudioControl::cmdHelp(int fd) const {
     dprintf(fd, "Usage: \n\n");
-    dprintf(fd, "[no args]: dumps focus listener / gain callback registered status\n");
+    dprintf(fd,
+            "[no args]: dumps focus listener / gain callback registered status, and the "
+            "ducking and muting state with its apply latency\n");
     dprintf(fd, "--help: shows this help\n");
     dprintf(fd,
             "--request <USAGE> <ZONE_ID> <FOCUS_GAIN>: requests audio focus for specified "
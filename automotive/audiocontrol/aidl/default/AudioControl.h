@@ -26,6 +26,8 @@
 
 #include <aidl/android/hardware/audio/common/PlaybackTrackMetadata.h>
 
+#include "GainRampEngine.h"
+
 namespace aidl::android::hardware::automotive::audiocontrol {
 
 namespace audiohalcommon = ::aidl::android::hardware::audio::common;
@@ -67,6 +69,9 @@ class AudioControl : public BnAudioControl {
      */
     std::shared_ptr<IAudioGainCallback> mAudioGainCallback = nullptr;
 
+    // Applies the ducking and muting of the device addresses.
+    GainRampEngine mGainRampEngine;
+
     binder_status_t cmdHelp(int fd) const;
     binder_status_t cmdRequestFocus(int fd, const char** args, uint32_t numArgs);
     binder_status_t cmdAbandonFocus(int fd, const char** args, uint32_t numArgs);
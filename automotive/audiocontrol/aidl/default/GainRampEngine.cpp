@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioControl"
+
+#include "GainRampEngine.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <android-base/logging.h>
+
+namespace aidl::android::hardware::automotive::audiocontrol {
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace {
+
+// Low enough not to compete with the audio HAL's own real-time threads.
+constexpr int kEngineThreadPriority = 1;
+
+float targetGain(bool ducked, bool muted) {
+    return muted ? 0.0f : ducked ? GainRampEngine::kDuckedGain : 1.0f;
+}
+
+void logGain(const std::string& deviceAddress, float gain) {
+    LOG(VERBOSE) << "Gain of " << deviceAddress << " set to " << gain;
+}
+
+}  // namespace
+
+void GainRampEngine::LatencyStats::add(microseconds latency) {
+    count++;
+    total += latency;
+    max = std::max(max, latency);
+}
+
+GainRampEngine::GainRampEngine(GainSink sink)
+    : mSink(sink ? std::move(sink) : logGain), mThread(&GainRampEngine::threadLoop, this) {}
+
+GainRampEngine::~GainRampEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mWakeUp.notify_one();
+    mThread.join();
+}
+
+void GainRampEngine::setDucked(const std::vector<std::string>& deviceAddresses, bool ducked) {
+    update(deviceAddresses, &Device::ducked, ducked);
+}
+
+void GainRampEngine::setMuted(const std::vector<std::string>& deviceAddresses, bool muted) {
+    update(deviceAddresses, &Device::muted, muted);
+}
+
+void GainRampEngine::update(const std::vector<std::string>& deviceAddresses, bool Device::*flag,
+                            bool value) {
+    const Clock::time_point now = Clock::now();
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const std::string& address : deviceAddresses) {
+            Device& device = mDevices[address];
+            if (device.*flag == value) {
+                continue;
+            }
+            device.*flag = value;
+            mRequests++;
+            if (device.pending) {
+                mCoalesced++;
+            } else {
+                device.pending = true;
+                device.requestTime = now;
+            }
+            changed = true;
+        }
+        mHasPending |= changed;
+    }
+    if (changed) {
+        mWakeUp.notify_one();
+    }
+}
+
+bool GainRampEngine::stepLocked(Clock::time_point now, std::vector<Step>* steps) {
+    bool running = false;
+    for (auto& [address, device] : mDevices) {
+        const float target = targetGain(device.ducked, device.muted);
+        bool first = false;
+        if (device.pending) {
+            device.pending = false;
+            if (target == device.gain) {
+                // Back to where the gain already is, e.g. ducked and unducked in a row.
+                device.ramping = false;
+                continue;
+            }
+            device.ramping = true;
+            device.rampStartGain = device.gain;
+            device.rampStart = now;
+            device.rampDuration = device.muted ? kMuteRampDuration : kDuckRampDuration;
+            device.rampRequestTime = device.requestTime;
+            first = true;
+        }
+        if (!device.ramping) {
+            continue;
+        }
+        // The first step is applied right away rather than one step later.
+        const float progress =
+                std::min(1.0f, std::chrono::duration<float>(now - device.rampStart + kRampStep) /
+                                       device.rampDuration);
+        const bool last = progress >= 1.0f;
+        device.gain = last ? target : device.rampStartGain + (target - device.rampStartGain) *
+                                                                     progress;
+        device.ramping = !last;
+        steps->push_back({address, device.gain, device.rampRequestTime, first, last});
+        running |= !last;
+    }
+    mHasPending = false;
+    return running;
+}
+
+void GainRampEngine::threadLoop() {
+    sched_param param = {.sched_priority = kEngineThreadPriority};
+    if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0) {
+        LOG(WARNING) << "Gain ramps run without real-time priority: " << strerror(err);
+    }
+
+    std::vector<Step> steps;
+    std::unique_lock<std::mutex> lock(mLock);
+    while (!mExit) {
+        if (!mHasPending && !mRunning) {
+            mWakeUp.wait(lock, [this] { return mHasPending || mExit; });
+            continue;
+        }
+        const Clock::time_point now = Clock::now();
+        steps.clear();
+        const bool running = stepLocked(now, &steps);
+
+        lock.unlock();
+        for (const Step& step : steps) {
+            mSink(step.deviceAddress, step.gain);
+        }
+        const Clock::time_point applied = Clock::now();
+        lock.lock();
+
+        for (const Step& step : steps) {
+            const auto latency = duration_cast<microseconds>(applied - step.requestTime);
+            if (step.first) mApplyLatency.add(latency);
+            if (step.last) mRampLatency.add(latency);
+        }
+        mRunning = running;
+        if (mRunning) {
+            // New requests are started right away instead of at the next step.
+            mWakeUp.wait_until(lock, now + kRampStep, [this] { return mHasPending || mExit; });
+        }
+    }
+}
+
+void GainRampEngine::dump(int fd) {
+    std::lock_guard<std::mutex> lock(mLock);
+    dprintf(fd, "Gain ramp engine: %llu requests, %llu coalesced\n",
+            static_cast<unsigned long long>(mRequests),
+            static_cast<unsigned long long>(mCoalesced));
+    for (const auto& [name, stats] :
+         {std::make_pair("request to first step", &mApplyLatency),
+          std::make_pair("request to end of ramp", &mRampLatency)}) {
+        if (stats->count == 0) continue;
+        dprintf(fd, "  %s: %llu ramps, avg %lld us, max %lld us\n", name,
+                static_cast<unsigned long long>(stats->count),
+                static_cast<long long>(stats->total.count() / stats->count),
+                static_cast<long long>(stats->max.count()));
+    }
+    for (const auto& [address, device] : mDevices) {
+        dprintf(fd, "  %s: gain %.3f%s%s%s\n", address.c_str(), device.gain,
+                device.ducked ? ", ducked" : "", device.muted ? ", muted" : "",
+                device.ramping || device.pending ? ", ramping" : "");
+    }
+}
+
+}  // namespace aidl::android::hardware::automotive::audiocontrol
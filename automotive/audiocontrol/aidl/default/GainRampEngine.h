@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUTOMOTIVE_AUDIOCONTROL_AIDL_DEFAULT_GAINRAMPENGINE_H_
+#define AUTOMOTIVE_AUDIOCONTROL_AIDL_DEFAULT_GAINRAMPENGINE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace aidl::android::hardware::automotive::audiocontrol {
+
+/**
+ * Reference engine applying the ducking and muting requested by CarAudioService to device
+ * addresses.
+ *
+ * Requests only update the target gain of each address and wake up the engine thread, which
+ * starts ramping within the same wake up. Requests received before the engine gets to them are
+ * coalesced: each address ramps once, toward the target of the latest request. Muting takes
+ * precedence over ducking.
+ *
+ * The gains are handed to a GainSink. A real implementation would program the amplifier or
+ * the DSP there; by default they are only logged.
+ */
+class GainRampEngine {
+  public:
+    using Clock = std::chrono::steady_clock;
+    // Called on the engine thread for every gain step, with a linear gain in [0, 1].
+    using GainSink = std::function<void(const std::string& deviceAddress, float gain)>;
+
+    static constexpr float kDuckedGain = 0.25f;
+    static constexpr std::chrono::milliseconds kDuckRampDuration{20};
+    // Short enough to cut a stream quickly, long enough not to click.
+    static constexpr std::chrono::milliseconds kMuteRampDuration{5};
+    static constexpr std::chrono::milliseconds kRampStep{1};
+
+    explicit GainRampEngine(GainSink sink = nullptr);
+    ~GainRampEngine();
+
+    GainRampEngine(const GainRampEngine&) = delete;
+    GainRampEngine& operator=(const GainRampEngine&) = delete;
+
+    void setDucked(const std::vector<std::string>& deviceAddresses, bool ducked);
+    void setMuted(const std::vector<std::string>& deviceAddresses, bool muted);
+
+    void dump(int fd);
+
+  private:
+    struct Device {
+        bool ducked = false;
+        bool muted = false;
+        float gain = 1.0f;
+        // A request the engine hasn't started ramping for yet. If several are received in the
+        // meantime, requestTime is the time of the first one.
+        bool pending = false;
+        Clock::time_point requestTime;
+        // The running ramp, toward the gain given by ducked and muted.
+        bool ramping = false;
+        float rampStartGain = 1.0f;
+        Clock::time_point rampStart;
+        std::chrono::milliseconds rampDuration{0};
+        Clock::time_point rampRequestTime;
+    };
+
+    struct Step {
+        std::string deviceAddress;
+        float gain;
+        Clock::time_point requestTime;
+        bool first;
+        bool last;
+    };
+
+    struct LatencyStats {
+        uint64_t count = 0;
+        std::chrono::microseconds total{0};
+        std::chrono::microseconds max{0};
+
+        void add(std::chrono::microseconds latency);
+    };
+
+    void update(const std::vector<std::string>& deviceAddresses, bool Device::*flag, bool value);
+    void threadLoop();
+    // Starts the ramps of the pending devices and steps the running ones. Returns whether a
+    // ramp is still running. mLock must be held.
+    bool stepLocked(Clock::time_point now, std::vector<Step>* steps);
+
+    const GainSink mSink;
+
+    std::mutex mLock;
+    std::condition_variable mWakeUp;
+    // Guarded by mLock.
+    std::map<std::string, Device> mDevices;
+    bool mHasPending = false;
+    bool mRunning = false;
+    bool mExit = false;
+    uint64_t mRequests = 0;
+    uint64_t mCoalesced = 0;
+    // From a request to the first gain step for it, and to the end of its ramp.
+    LatencyStats mApplyLatency;
+    LatencyStats mRampLatency;
+
+    std::thread mThread;
+};
+
+}  // namespace aidl::android::hardware::automotive::audiocontrol
+
+#endif  // AUTOMOTIVE_AUDIOCONTROL_AIDL_DEFAULT_GAINRAMPENGINE_H_
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GainRampEngine.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+namespace aidl::android::hardware::automotive::audiocontrol {
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr auto kTimeout = 2s;
+
+// Records the gains applied to each address.
+class GainRecorder {
+  public:
+    GainRampEngine::GainSink sink() {
+        return [this](const std::string& deviceAddress, float gain) {
+            std::lock_guard<std::mutex> lock(mLock);
+            mGains[deviceAddress].push_back(gain);
+            mChanged.notify_all();
+        };
+    }
+
+    // Returns whether the last gain applied to the address is |gain| within kTimeout.
+    bool waitForGain(const std::string& deviceAddress, float gain) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mChanged.wait_for(lock, kTimeout, [&] {
+            const auto it = mGains.find(deviceAddress);
+            return it != mGains.end() && it->second.back() == gain;
+        });
+    }
+
+    // Returns whether a gain is applied to the address within kTimeout.
+    bool waitForStep(const std::string& deviceAddress) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mChanged.wait_for(lock, kTimeout, [&] { return mGains.count(deviceAddress) > 0; });
+    }
+
+    std::vector<float> gains(const std::string& deviceAddress) {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mGains[deviceAddress];
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mLock);
+        mGains.clear();
+    }
+
+  private:
+    std::mutex mLock;
+    std::condition_variable mChanged;
+    std::map<std::string, std::vector<float>> mGains;
+};
+
+std::string dump(GainRampEngine& engine) {
+    TemporaryFile file;
+    engine.dump(file.fd);
+    std::string out;
+    ::android::base::ReadFileToString(file.path, &out);
+    return out;
+}
+
+class GainRampEngineTest : public ::testing::Test {
+  protected:
+    GainRecorder mRecorder;
+    GainRampEngine mEngine{mRecorder.sink()};
+};
+
+TEST_F(GainRampEngineTest, RampsDownToTheDuckedGain) {
+    mEngine.setDucked({"bus0"}, true);
+
+    ASSERT_TRUE(mRecorder.waitForGain("bus0", GainRampEngine::kDuckedGain));
+    const std::vector<float> gains = mRecorder.gains("bus0");
+    // The first step is below the initial gain, and no step goes up.
+    EXPECT_LT(gains.front(), 1.0f);
+    for (size_t i = 1; i < gains.size(); i++) {
+        EXPECT_LE(gains[i], gains[i - 1]);
+    }
+}
+
+TEST_F(GainRampEngineTest, RampsBackUpWhenUnducked) {
+    mEngine.setDucked({"bus0"}, true);
+    ASSERT_TRUE(mRecorder.waitForGain("bus0", GainRampEngine::kDuckedGain));
+    mRecorder.clear();
+
+    mEngine.setDucked({"bus0"}, false);
+
+    ASSERT_TRUE(mRecorder.waitForGain("bus0", 1.0f));
+    for (float gain : mRecorder.gains("bus0")) {
+        EXPECT_GT(gain, GainRampEngine::kDuckedGain);
+    }
+}
+
+TEST_F(GainRampEngineTest, MutingTakesPrecedenceOverDucking) {
+    mEngine.setDucked({"bus0"}, true);
+    mEngine.setMuted({"bus0"}, true);
+    ASSERT_TRUE(mRecorder.waitForGain("bus0", 0.0f));
+
+    mEngine.setDucked({"bus0"}, false);
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(0.0f, mRecorder.gains("bus0").back());
+
+    mEngine.setDucked({"bus0"}, true);
+    mEngine.setMuted({"bus0"}, false);
+    EXPECT_TRUE(mRecorder.waitForGain("bus0", GainRampEngine::kDuckedGain));
+}
+
+TEST_F(GainRampEngineTest, OnlyRampsTheRequestedAddresses) {
+    mEngine.setMuted({"bus0", "bus1"}, true);
+    mEngine.setDucked({"bus2"}, true);
+
+    EXPECT_TRUE(mRecorder.waitForGain("bus0", 0.0f));
+    EXPECT_TRUE(mRecorder.waitForGain("bus1", 0.0f));
+    EXPECT_TRUE(mRecorder.waitForGain("bus2", GainRampEngine::kDuckedGain));
+    EXPECT_TRUE(mRecorder.gains("bus3").empty());
+}
+
+TEST_F(GainRampEngineTest, InterruptedRampsRestartFromTheCurrentGain) {
+    mEngine.setDucked({"bus0"}, true);
+    ASSERT_TRUE(mRecorder.waitForStep("bus0"));
+
+    mEngine.setDucked({"bus0"}, false);
+
+    ASSERT_TRUE(mRecorder.waitForGain("bus0", 1.0f));
+    // The gain went down, then back up from wherever it was, without jumping around.
+    const std::vector<float> gains = mRecorder.gains("bus0");
+    size_t lowest = 0;
+    while (lowest + 1 < gains.size() && gains[lowest + 1] <= gains[lowest]) lowest++;
+    EXPECT_GE(gains[lowest], GainRampEngine::kDuckedGain);
+    for (size_t i = lowest + 1; i < gains.size(); i++) {
+        EXPECT_GE(gains[i], gains[i - 1]);
+    }
+}
+
+TEST_F(GainRampEngineTest, IgnoresRequestsThatChangeNothing) {
+    mEngine.setDucked({"bus0"}, false);
+    mEngine.setMuted({"bus0"}, false);
+    std::this_thread::sleep_for(50ms);
+
+    EXPECT_TRUE(mRecorder.gains("bus0").empty());
+    EXPECT_NE(std::string::npos, dump(mEngine).find("0 requests"));
+}
+
+TEST_F(GainRampEngineTest, DumpsRequestsLatenciesAndGains) {
+    mEngine.setDucked({"bus0"}, true);
+    ASSERT_TRUE(mRecorder.waitForGain("bus0", GainRampEngine::kDuckedGain));
+
+    const std::string out = dump(mEngine);
+
+    EXPECT_NE(std::string::npos, out.find("1 requests")) << out;
+    EXPECT_NE(std::string::npos, out.find("request to first step: 1 ramps")) << out;
+    EXPECT_NE(std::string::npos, out.find("request to end of ramp: 1 ramps")) << out;
+    EXPECT_NE(std::string::npos, out.find("bus0: gain 0.250, ducked\n")) << out;
+}
+
+TEST(GainRampEngineLifetimeTest, StopsWhileRamping) {
+    GainRecorder recorder;
+    {
+        GainRampEngine engine(recorder.sink());
+        engine.setMuted({"bus0"}, true);
+    }
+    // Nothing is applied once the engine is gone.
+    const size_t steps = recorder.gains("bus0").size();
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(steps, recorder.gains("bus0").size());
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::automotive::audiocontrol
@@ -30,6 +30,9 @@ namespace android::hardware::automotive::can::V1_0::implementation {
 /** Whether to log sent/received packets. */
 static constexpr bool kSuperVerbose = false;
 
+/** Maximum number of kernel filters per socket (CAN_RAW_FILTER_MAX). */
+static constexpr size_t kMaxKernelFilters = 512;
+
 Return<Result> CanBus::send(const CanMessage& message) {
     std::lock_guard<std::mutex> lck(mIsUpGuard);
     if (!mIsUp) return Result::INTERFACE_DOWN;
@@ -68,16 +71,35 @@ Return<void> CanBus::listen(const hidl_vec<CanMessageFilter>& filter,
     std::lock_guard<std::mutex> lckListeners(mMsgListenersGuard);
 
     sp<CloseHandle> closeHandle = new CloseHandle([this, listenerCb]() {
-        std::lock_guard<std::mutex> lck(mMsgListenersGuard);
-        std::erase_if(mMsgListeners, [&](const auto& e) { return e.callback == listenerCb; });
+        std::vector<std::unique_ptr<ListenerQueue>> queuesToStop;
+        {
+            std::lock_guard<std::mutex> lck(mMsgListenersGuard);
+            const auto it = std::remove_if(mMsgListeners.begin(), mMsgListeners.end(),
+                                           [&](const auto& e) { return e.callback == listenerCb; });
+            if (it == mMsgListeners.end()) return;
+            std::for_each(it, mMsgListeners.end(),
+                          [&](auto& e) { queuesToStop.push_back(std::move(e.queue)); });
+            mMsgListeners.erase(it, mMsgListeners.end());
+            updateSocketFilters();
+        }
+        /* Stopping the queue waits for a pending onReceive call to finish, which must not block
+         * the reader thread. */
+        queuesToStop.clear();
     });
-    mMsgListeners.emplace_back(CanMessageListener{listenerCb, filter, closeHandle});
-    auto& listener = mMsgListeners.back();
 
     // fix message IDs to have all zeros on bits not covered by mask
-    std::for_each(listener.filter.begin(), listener.filter.end(),
+    hidl_vec<CanMessageFilter> fixedFilter = filter;
+    std::for_each(fixedFilter.begin(), fixedFilter.end(),
                   [](auto& rule) { rule.id &= rule.mask; });
 
+    std::unique_ptr<ListenerQueue> queue;
+    if (mListenerQueueConfig.has_value()) {
+        queue = std::make_unique<ListenerQueue>(listenerCb, *mListenerQueueConfig);
+    }
+    mMsgListeners.emplace_back(CanMessageListener{listenerCb, fixedFilter, closeHandle, false,
+                                                  CompiledFilter(fixedFilter), std::move(queue)});
+    updateSocketFilters();
+
     _hidl_cb(Result::OK, closeHandle);
     return {};
 }
@@ -134,13 +156,18 @@ ICanController::Result CanBus::up() {
     mDownAfterUse = !*isUp;
 
     using namespace std::placeholders;
-    CanSocket::ReadCallback rdcb = std::bind(&CanBus::onRead, this, _1, _2);
+    CanSocket::ReadCallback rdcb = std::bind(&CanBus::onRead, this, _1, _2, _3);
     CanSocket::ErrorCallback errcb = std::bind(&CanBus::onError, this, _1);
-    mSocket = CanSocket::open(mIfname, rdcb, errcb);
-    if (!mSocket) {
+    auto socket = CanSocket::open(mIfname, rdcb, errcb);
+    if (!socket) {
         if (mDownAfterUse) netdevice::down(mIfname);
         return ICanController::Result::UNKNOWN_ERROR;
     }
+    {
+        std::lock_guard<std::mutex> lckListeners(mMsgListenersGuard);
+        mSocket = std::move(socket);
+        updateSocketFilters();
+    }
 
     mIsUp = true;
     return ICanController::Result::OK;
@@ -203,7 +230,13 @@ bool CanBus::down() {
 
     clearMsgListeners();
     clearErrListeners();
-    mSocket.reset();
+    std::unique_ptr<CanSocket> socket;
+    {
+        std::lock_guard<std::mutex> lckListeners(mMsgListenersGuard);
+        socket = std::move(mSocket);
+    }
+    // The reader thread takes mMsgListenersGuard, so the socket must be closed without holding it.
+    socket.reset();
 
     bool success = true;
 
@@ -264,6 +297,80 @@ static bool match(const hidl_vec<CanMessageFilter>& filter, CanMessageId id, boo
     return !anyNonExcludeRulePresent || anyNonExcludeRuleSatisfied;
 }
 
+CanBus::CompiledFilter::CompiledFilter(const hidl_vec<CanMessageFilter>& filter)
+    : mFilter(filter), mMatchesAll(filter.size() == 0) {
+    if (mMatchesAll) return;
+
+    mStandardIdMatches.resize((CAN_SFF_MASK + 1) << 1);
+    for (CanMessageId id = 0; id <= CAN_SFF_MASK; id++) {
+        mStandardIdMatches[id << 1] = implementation::match(mFilter, id, false, false);
+        mStandardIdMatches[id << 1 | 1] = implementation::match(mFilter, id, true, false);
+    }
+}
+
+bool CanBus::CompiledFilter::match(CanMessageId id, bool isRtr, bool isExtendedId) {
+    if (mMatchesAll) return true;
+
+    if (!isExtendedId && id <= CAN_SFF_MASK) {
+        return mStandardIdMatches[id << 1 | (isRtr ? 1 : 0)];
+    }
+
+    const uint32_t key = id | (isRtr ? CAN_RTR_FLAG : 0);
+    const auto it = mExtendedIdMatches.find(key);
+    if (it != mExtendedIdMatches.end()) return it->second;
+
+    const bool matches = implementation::match(mFilter, id, isRtr, isExtendedId);
+    if (mExtendedIdMatches.size() < kMaxExtendedIdCacheSize) {
+        mExtendedIdMatches.emplace(key, matches);
+    }
+    return matches;
+}
+
+/**
+ * Translate a filter flag to the kernel filter id and mask bits.
+ *
+ * \param filterFlag FilterFlag object to translate
+ * \param canFlag CAN_*_FLAG bit the filter flag refers to
+ * \param kernelFilter kernel filter to update
+ */
+static void addKernelFilterFlag(FilterFlag filterFlag, canid_t canFlag,
+                                struct can_filter& kernelFilter) {
+    if (filterFlag == FilterFlag::DONT_CARE) return;
+    kernelFilter.can_mask |= canFlag;
+    if (filterFlag == FilterFlag::SET) kernelFilter.can_id |= canFlag;
+}
+
+void CanBus::updateSocketFilters() {
+    if (mSocket == nullptr) return;
+
+    /* Only the non-exclude rules can be pushed down to the kernel: a frame is received if it
+     * matches any of them, while the exact filter set of each listener (including exclude rules)
+     * is still applied in onRead. If any listener has no non-exclude rules (i.e. it receives
+     * everything not explicitly excluded), all frames have to be received. */
+    std::vector<struct can_filter> kernelFilters;
+    bool receiveAll = false;
+    for (const auto& listener : mMsgListeners) {
+        bool anyNonExcludeRulePresent = false;
+        for (const auto& rule : listener.filter) {
+            if (rule.exclude) continue;
+            anyNonExcludeRulePresent = true;
+
+            struct can_filter kernelFilter = {};
+            kernelFilter.can_id = rule.id & CAN_EFF_MASK;
+            kernelFilter.can_mask = rule.mask & CAN_EFF_MASK;
+            addKernelFilterFlag(rule.rtr, CAN_RTR_FLAG, kernelFilter);
+            addKernelFilterFlag(rule.extendedFormat, CAN_EFF_FLAG, kernelFilter);
+            kernelFilters.push_back(kernelFilter);
+        }
+        if (!anyNonExcludeRulePresent) receiveAll = true;
+    }
+    if (receiveAll || kernelFilters.size() > kMaxKernelFilters) {
+        kernelFilters = {{.can_id = 0, .can_mask = 0}};
+    }
+
+    mSocket->setFilters(kernelFilters);
+}
+
 void CanBus::notifyErrorListeners(ErrorEvent err, bool isFatal) {
     std::lock_guard<std::mutex> lck(mErrListenersGuard);
     for (auto& listener : mErrListeners) {
@@ -297,7 +404,8 @@ static ErrorEvent parseErrorFrame(const struct canfd_frame& frame) {
     return ErrorEvent::UNKNOWN_ERROR;
 }
 
-void CanBus::onRead(const struct canfd_frame& frame, std::chrono::nanoseconds timestamp) {
+void CanBus::onRead(const struct canfd_frame& frame, std::chrono::nanoseconds timestamp,
+                    CanSocket::TimestampSource timestampSource) {
     if ((frame.can_id & CAN_ERR_FLAG) != 0) {
         // error bit is set
         LOG(WARNING) << "CAN Error frame received";
@@ -313,14 +421,19 @@ void CanBus::onRead(const struct canfd_frame& frame, std::chrono::nanoseconds ti
     message.remoteTransmissionRequest = (frame.can_id & CAN_RTR_FLAG) != 0;
 
     if (UNLIKELY(kSuperVerbose)) {
-        LOG(VERBOSE) << "Got message " << toString(message);
+        LOG(VERBOSE) << "Got message " << toString(message) << " (timestamp source "
+                     << static_cast<int>(timestampSource) << ")";
     }
 
     std::lock_guard<std::mutex> lck(mMsgListenersGuard);
     for (auto& listener : mMsgListeners) {
-        if (!match(listener.filter, message.id, message.remoteTransmissionRequest,
-                   message.isExtendedId))
+        if (!listener.compiledFilter.match(message.id, message.remoteTransmissionRequest,
+                                           message.isExtendedId))
             continue;
+        if (listener.queue != nullptr) {
+            listener.queue->push(message);
+            continue;
+        }
         if (!listener.callback->onReceive(message).isOk() && !listener.failedOnce) {
             listener.failedOnce = true;
             LOG(WARNING) << "Failed to notify listener about message";
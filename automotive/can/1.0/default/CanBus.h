@@ -17,6 +17,7 @@
 #pragma once
 
 #include "CanSocket.h"
+#include "ListenerQueue.h"
 
 #include <android-base/unique_fd.h>
 #include <android/hardware/automotive/can/1.0/ICanBus.h>
@@ -25,6 +26,8 @@
 
 #include <atomic>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace android::hardware::automotive::can::V1_0::implementation {
 
@@ -75,18 +78,51 @@ struct CanBus : public ICanBus {
     std::string mIfname;
 
   private:
+    /**
+     * Filter set compiled to a lookup table, so matching a received message doesn't need to go
+     * through all the filter rules.
+     *
+     * Matches for all standard (11-bit) ids are computed upfront, while extended ids are matched
+     * lazily and cached (up to kMaxExtendedIdCacheSize ids).
+     */
+    struct CompiledFilter {
+        explicit CompiledFilter(const hidl_vec<CanMessageFilter>& filter);
+
+        bool match(CanMessageId id, bool isRtr, bool isExtendedId);
+
+      private:
+        static constexpr size_t kMaxExtendedIdCacheSize = 1024;
+
+        hidl_vec<CanMessageFilter> mFilter;
+        bool mMatchesAll;
+        /** Indexed by (id << 1 | isRtr) for standard ids. */
+        std::vector<bool> mStandardIdMatches;
+        /** Keyed by id | CAN_RTR_FLAG (if remote transmission request) for extended ids. */
+        std::unordered_map<uint32_t, bool> mExtendedIdMatches;
+    };
+
     struct CanMessageListener {
         sp<ICanMessageListener> callback;
         hidl_vec<CanMessageFilter> filter;
         wp<ICloseHandle> closeHandle;
         bool failedOnce = false;
+        CompiledFilter compiledFilter;
+        /** Message queue for batched delivery, or nullptr to deliver from the reader thread. */
+        std::unique_ptr<ListenerQueue> queue;
     };
     void clearMsgListeners();
+
+    /**
+     * Push the union of all listeners' filters down to the socket, so the kernel drops the frames
+     * nobody listens to.
+     */
+    void updateSocketFilters() REQUIRES(mMsgListenersGuard);
     void clearErrListeners();
 
     void notifyErrorListeners(ErrorEvent err, bool isFatal);
 
-    void onRead(const struct canfd_frame& frame, std::chrono::nanoseconds timestamp);
+    void onRead(const struct canfd_frame& frame, std::chrono::nanoseconds timestamp,
+                CanSocket::TimestampSource timestampSource);
     void onError(int errnoVal);
 
     std::mutex mMsgListenersGuard;
@@ -95,9 +131,17 @@ struct CanBus : public ICanBus {
     std::mutex mErrListenersGuard;
     std::vector<sp<ICanErrorListener>> mErrListeners GUARDED_BY(mErrListenersGuard);
 
+    /**
+     * Only modified while holding both mIsUpGuard and mMsgListenersGuard, so it's safe to access
+     * with either one of them held.
+     */
     std::unique_ptr<CanSocket> mSocket;
     bool mDownAfterUse;
 
+    /** Batched delivery configuration for new listeners, std::nullopt if disabled. */
+    const std::optional<ListenerQueue::Config> mListenerQueueConfig =
+            ListenerQueue::getConfigFromProperties();
+
     /**
      * Guard for up flag is required to be held for entire time when the interface is being used
      * (i.e. message being sent), because we don't want the interface to be torn down while
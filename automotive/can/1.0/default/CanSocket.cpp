@@ -17,12 +17,19 @@
 #include "CanSocket.h"
 
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <libnetdevice/can.h>
 #include <libnetdevice/libnetdevice.h>
 #include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
+#include <time.h>
 #include <utils/SystemClock.h>
 
+#include <array>
 #include <chrono>
+#include <cstring>
 
 namespace android::hardware::automotive::can::V1_0::implementation {
 
@@ -34,6 +41,84 @@ using namespace std::chrono_literals;
  *       down the interface. */
 static constexpr auto kReadPooling = 100ms;
 
+/** Maximum number of frames fetched from the socket with a single recvmmsg(2) call. */
+static constexpr size_t kReadBatchSize = 32;
+
+/** Whether to stamp received frames with kernel timestamps (SO_TIMESTAMPING). */
+static constexpr char kRxTimestampingProperty[] = "vendor.can.rx_timestamping";
+
+/** How often the UNIX to boot time clock offset is re-calibrated. */
+static constexpr auto kClockOffsetRefreshPeriod = 1s;
+
+/** How many clock readings are taken to calibrate the clock offset (the best one is used). */
+static constexpr int kClockOffsetSamples = 5;
+
+/* Hardware timestamps are preferred, with software RX timestamps as a fallback for controllers
+ * not supporting them. */
+static constexpr int kTimestampingFlags = SOF_TIMESTAMPING_RX_HARDWARE |
+                                          SOF_TIMESTAMPING_RAW_HARDWARE |
+                                          SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+/** Layout of SCM_TIMESTAMPING control message (see struct scm_timestamping). */
+struct ScmTimestamping {
+    struct timespec software;
+    struct timespec deprecated;
+    struct timespec hardware;
+};
+
+static std::chrono::nanoseconds toNanoseconds(const struct timespec& ts) {
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+static std::chrono::nanoseconds now(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return toNanoseconds(ts);
+}
+
+/**
+ * Offset between UNIX time (as used by SO_TIMESTAMPING) and time since boot.
+ *
+ * There is no direct way to convert between these clocks, so the offset is calibrated by querying
+ * both clocks several times and picking the reading taking the shortest time. It's refreshed
+ * periodically, in case the UNIX time was adjusted in the meantime.
+ */
+class ClockOffset {
+  public:
+    std::chrono::nanoseconds toBootTime(const struct timespec& unixTime) {
+        const auto bootTime = now(CLOCK_BOOTTIME);
+        if (!mCalibrated || bootTime - mCalibrationTime >= kClockOffsetRefreshPeriod) {
+            calibrate();
+        }
+        return toNanoseconds(unixTime) + mOffset;
+    }
+
+  private:
+    void calibrate() {
+        auto bestWindow = std::chrono::nanoseconds::max();
+        for (int i = 0; i < kClockOffsetSamples; i++) {
+            const auto before = now(CLOCK_REALTIME);
+            const auto bootTime = now(CLOCK_BOOTTIME);
+            const auto after = now(CLOCK_REALTIME);
+            const auto window = after - before;
+            if (window < bestWindow) {
+                bestWindow = window;
+                mOffset = bootTime - (before + window / 2);
+                mCalibrationTime = bootTime;
+            }
+        }
+        mCalibrated = true;
+    }
+
+    bool mCalibrated = false;
+    std::chrono::nanoseconds mOffset;
+    std::chrono::nanoseconds mCalibrationTime;
+};
+
+static bool isSet(const struct timespec& ts) {
+    return ts.tv_sec != 0 || ts.tv_nsec != 0;
+}
+
 std::unique_ptr<CanSocket> CanSocket::open(const std::string& ifname, ReadCallback rdcb,
                                            ErrorCallback errcb) {
     auto sock = netdevice::can::socket(ifname);
@@ -42,13 +127,25 @@ std::unique_ptr<CanSocket> CanSocket::open(const std::string& ifname, ReadCallba
         return nullptr;
     }
 
+    bool rxTimestamping = base::GetBoolProperty(kRxTimestampingProperty, false);
+    if (rxTimestamping) {
+        const int flags = kTimestampingFlags;
+        if (setsockopt(sock.get(), SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+            PLOG(WARNING) << "Can't enable RX timestamping on " << ifname;
+            rxTimestamping = false;
+        }
+    }
+
     // Can't use std::make_unique due to private CanSocket constructor.
-    return std::unique_ptr<CanSocket>(new CanSocket(std::move(sock), rdcb, errcb));
+    return std::unique_ptr<CanSocket>(
+            new CanSocket(std::move(sock), rxTimestamping, rdcb, errcb));
 }
 
-CanSocket::CanSocket(base::unique_fd socket, ReadCallback rdcb, ErrorCallback errcb)
+CanSocket::CanSocket(base::unique_fd socket, bool rxTimestamping, ReadCallback rdcb,
+                     ErrorCallback errcb)
     : mReadCallback(rdcb),
       mErrorCallback(errcb),
+      mRxTimestamping(rxTimestamping),
       mSocket(std::move(socket)),
       mReaderThread(&CanSocket::readerThread, this) {}
 
@@ -77,6 +174,17 @@ bool CanSocket::send(const struct canfd_frame& frame) {
     return true;
 }
 
+bool CanSocket::setFilters(const std::vector<struct can_filter>& filters) {
+    const auto res = setsockopt(mSocket.get(), SOL_CAN_RAW, CAN_RAW_FILTER,
+                                filters.empty() ? nullptr : filters.data(),
+                                filters.size() * sizeof(struct can_filter));
+    if (res < 0) {
+        PLOG(WARNING) << "Failed to set CAN_RAW_FILTER with " << filters.size() << " filters";
+        return false;
+    }
+    return true;
+}
+
 static struct timeval toTimeval(std::chrono::microseconds t) {
     struct timeval tv;
     tv.tv_sec = t / 1s;
@@ -96,7 +204,23 @@ void CanSocket::readerThread() {
     LOG(VERBOSE) << "Reader thread started";
     int errnoCopy = 0;
 
-    while (!mStopReaderThread) {
+    struct ControlBuffer {
+        alignas(struct cmsghdr) char data[CMSG_SPACE(sizeof(ScmTimestamping))];
+    };
+    std::array<struct canfd_frame, kReadBatchSize> frames;
+    std::array<struct iovec, kReadBatchSize> iovecs;
+    std::array<ControlBuffer, kReadBatchSize> controls;
+    std::array<struct mmsghdr, kReadBatchSize> msgs = {};
+    for (size_t i = 0; i < kReadBatchSize; i++) {
+        iovecs[i].iov_base = &frames[i];
+        iovecs[i].iov_len = CAN_MTU;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    ClockOffset clockOffset;
+
+    bool readFailed = false;
+    while (!mStopReaderThread && !readFailed) {
         /* The ideal would be to have a blocking read(3) call and interrupt it with shutdown(3).
          * This is unfortunately not supported for SocketCAN, so we need to rely on select(3). */
         const auto sel = selectRead(mSocket, kReadPooling);
@@ -106,35 +230,64 @@ void CanSocket::readerThread() {
             break;
         }
 
-        struct canfd_frame frame;
-        const auto nbytes = read(mSocket.get(), &frame, CAN_MTU);
+        if (mRxTimestamping) {
+            // msg_controllen is updated by each call, so it has to be reset every time.
+            for (size_t i = 0; i < kReadBatchSize; i++) {
+                msgs[i].msg_hdr.msg_control = controls[i].data;
+                msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].data);
+            }
+        }
+
+        /* Fetch all the frames queued so far (up to kReadBatchSize) with a single system call,
+         * instead of one select(3) and read(3) pair per frame. */
+        const auto nmsgs = recvmmsg(mSocket.get(), msgs.data(), kReadBatchSize, MSG_DONTWAIT,
+                                    nullptr);
 
-        /* We could use SIOCGSTAMP to get a precise UNIX timestamp for a given packet, but what
-         * we really need is a time since boot. There is no direct way to convert between these
-         * clocks. We could implement a class to calculate the difference between the clocks
-         * (querying both several times and picking the smallest difference); apply the difference
-         * to a SIOCGSTAMP returned value; re-synchronize if the elapsed time is too much in the
-         * past (indicating the UNIX timestamp might have been adjusted).
+        /* By default, frames are stamped with a local time since boot here. It's subject to the
+         * reader thread scheduling latency, but doesn't need any clock conversion. All frames of
+         * a batch get the same timestamp, since they were all queued by the time recvmmsg(2)
+         * returned.
          *
-         * Apart from the added complexity, it's possible the added calculations and system calls
-         * would add so much time to the processing pipeline so the precision of the reported time
-         * was buried under the subsystem latency. Let's just use a local time since boot here and
-         * leave precise hardware timestamps for custom proprietary implementations (if needed). */
+         * If RX timestamping is enabled, the kernel (or controller) UNIX timestamp of each frame
+         * is converted to time since boot with a calibrated clock offset instead. */
         const std::chrono::nanoseconds ts(elapsedRealtimeNano());
 
-        if (nbytes != CAN_MTU) {
-            if (nbytes >= 0) {
-                LOG(ERROR) << "Failed to read CAN packet, got " << nbytes << " bytes";
-                break;
-            }
+        if (nmsgs < 0) {
             if (errno == EAGAIN) continue;
 
             errnoCopy = errno;
-            PLOG(ERROR) << "Failed to read CAN packet";
+            PLOG(ERROR) << "Failed to read CAN packets";
             break;
         }
 
-        mReadCallback(frame, ts);
+        for (int i = 0; i < nmsgs; i++) {
+            if (msgs[i].msg_len != CAN_MTU) {
+                LOG(ERROR) << "Failed to read CAN packet, got " << msgs[i].msg_len << " bytes";
+                readFailed = true;
+                break;
+            }
+            if (!mRxTimestamping) {
+                mReadCallback(frames[i], ts, TimestampSource::RECEIVE_CALL);
+                continue;
+            }
+
+            auto source = TimestampSource::RECEIVE_CALL;
+            auto frameTs = ts;
+            for (auto cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != nullptr;
+                 cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING) continue;
+                ScmTimestamping stamps;
+                memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                if (isSet(stamps.hardware)) {
+                    source = TimestampSource::HARDWARE;
+                    frameTs = clockOffset.toBootTime(stamps.hardware);
+                } else if (isSet(stamps.software)) {
+                    source = TimestampSource::SOFTWARE;
+                    frameTs = clockOffset.toBootTime(stamps.software);
+                }
+            }
+            mReadCallback(frames[i], frameTs, source);
+        }
     }
 
     bool failed = !mStopReaderThread;
@@ -23,12 +23,24 @@
 #include <atomic>
 #include <chrono>
 #include <thread>
+#include <vector>
 
 namespace android::hardware::automotive::can::V1_0::implementation {
 
 /** Wrapper around SocketCAN socket. */
 struct CanSocket {
-    using ReadCallback = std::function<void(const struct canfd_frame&, std::chrono::nanoseconds)>;
+    /** Where the timestamp of a received frame comes from. */
+    enum class TimestampSource {
+        /** Time since boot taken after the frame was fetched from the socket. */
+        RECEIVE_CALL,
+        /** Kernel software RX timestamp, converted to time since boot. */
+        SOFTWARE,
+        /** Controller hardware RX timestamp, converted to time since boot. */
+        HARDWARE,
+    };
+
+    using ReadCallback = std::function<void(const struct canfd_frame&, std::chrono::nanoseconds,
+                                            TimestampSource)>;
     using ErrorCallback = std::function<void(int errnoVal)>;
 
     /**
@@ -51,13 +63,27 @@ struct CanSocket {
      */
     bool send(const struct canfd_frame& frame);
 
+    /**
+     * Set kernel-side receive filters (CAN_RAW_FILTER), so frames nobody listens to don't even
+     * reach the reader thread.
+     *
+     * \param filters Frames matching any of these filters are received; an empty list blocks all
+     *        frames (except error frames, which are not affected by CAN_RAW_FILTER)
+     * \return true in case of success, false otherwise
+     */
+    bool setFilters(const std::vector<struct can_filter>& filters);
+
   private:
-    CanSocket(base::unique_fd socket, ReadCallback rdcb, ErrorCallback errcb);
+    CanSocket(base::unique_fd socket, bool rxTimestamping, ReadCallback rdcb,
+              ErrorCallback errcb);
     void readerThread();
 
     ReadCallback mReadCallback;
     ErrorCallback mErrorCallback;
 
+    /** Whether SO_TIMESTAMPING is enabled on the socket. */
+    const bool mRxTimestamping;
+
     const base::unique_fd mSocket;
     std::thread mReaderThread;
     std::atomic<bool> mStopReaderThread = false;
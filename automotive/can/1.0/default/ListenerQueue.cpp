@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ListenerQueue.h"
+
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+
+#include <vector>
+
+namespace android::hardware::automotive::can::V1_0::implementation {
+
+/** Queue capacity per listener; 0 (the default) disables batched delivery. */
+static constexpr char kCapacityProperty[] = "vendor.can.listener_queue.capacity";
+static constexpr char kBatchSizeProperty[] = "vendor.can.listener_queue.batch_size";
+static constexpr char kDropNewestProperty[] = "vendor.can.listener_queue.drop_newest";
+
+static constexpr size_t kDefaultBatchSize = 32;
+
+std::optional<ListenerQueue::Config> ListenerQueue::getConfigFromProperties() {
+    const auto capacity = base::GetUintProperty<size_t>(kCapacityProperty, 0);
+    if (capacity == 0) return std::nullopt;
+
+    Config config = {};
+    config.capacity = capacity;
+    config.batchSize = base::GetUintProperty<size_t>(kBatchSizeProperty, kDefaultBatchSize);
+    if (config.batchSize == 0) config.batchSize = kDefaultBatchSize;
+    config.overflowPolicy = base::GetBoolProperty(kDropNewestProperty, false)
+                                    ? OverflowPolicy::DROP_NEWEST
+                                    : OverflowPolicy::DROP_OLDEST;
+    return config;
+}
+
+ListenerQueue::ListenerQueue(const sp<ICanMessageListener>& listener, const Config& config)
+    : mListener(listener),
+      mConfig(config),
+      mDispatcherThread(&ListenerQueue::dispatcherThread, this) {}
+
+ListenerQueue::~ListenerQueue() {
+    {
+        std::lock_guard<std::mutex> lck(mQueueGuard);
+        mStopDispatcherThread = true;
+    }
+    mQueueCv.notify_one();
+    mDispatcherThread.join();
+
+    const auto dropped = getDroppedCount();
+    if (dropped > 0) LOG(WARNING) << "Listener queue dropped " << dropped << " messages";
+}
+
+void ListenerQueue::push(const CanMessage& message) {
+    {
+        std::lock_guard<std::mutex> lck(mQueueGuard);
+        if (mQueue.size() >= mConfig.capacity) {
+            mDroppedCount++;
+            if (mConfig.overflowPolicy == OverflowPolicy::DROP_NEWEST) return;
+            mQueue.pop_front();
+        }
+        mQueue.push_back(message);
+    }
+    mQueueCv.notify_one();
+}
+
+uint64_t ListenerQueue::getDroppedCount() const {
+    return mDroppedCount;
+}
+
+void ListenerQueue::dispatcherThread() {
+    LOG(VERBOSE) << "Listener dispatcher thread started";
+    std::vector<CanMessage> batch;
+    batch.reserve(mConfig.batchSize);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lck(mQueueGuard);
+            mQueueCv.wait(lck, [this]() NO_THREAD_SAFETY_ANALYSIS {
+                return mStopDispatcherThread || !mQueue.empty();
+            });
+            if (mStopDispatcherThread) break;
+
+            const auto count = std::min(mQueue.size(), mConfig.batchSize);
+            std::move(mQueue.begin(), mQueue.begin() + count, std::back_inserter(batch));
+            mQueue.erase(mQueue.begin(), mQueue.begin() + count);
+        }
+
+        for (const auto& message : batch) {
+            if (!mListener->onReceive(message).isOk() && !mFailedOnce) {
+                mFailedOnce = true;
+                LOG(WARNING) << "Failed to notify listener about message";
+            }
+        }
+        batch.clear();
+    }
+
+    LOG(VERBOSE) << "Listener dispatcher thread stopped";
+}
+
+}  // namespace android::hardware::automotive::can::V1_0::implementation
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/macros.h>
+#include <android-base/thread_annotations.h>
+#include <android/hardware/automotive/can/1.0/ICanMessageListener.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace android::hardware::automotive::can::V1_0::implementation {
+
+/**
+ * Bounded message queue with its own dispatcher thread, delivering messages to a single listener.
+ *
+ * This decouples the socket reader thread from the listener, so a slow client doesn't stall the
+ * reader thread and other listeners.
+ */
+struct ListenerQueue {
+    /** What to do with a new message if the queue is full. */
+    enum class OverflowPolicy {
+        /** Drop the oldest queued message, the listener gets the most recent state. */
+        DROP_OLDEST,
+        /** Drop the new message, the listener gets the messages in order without a gap. */
+        DROP_NEWEST,
+    };
+
+    struct Config {
+        /** Maximum number of queued messages. */
+        size_t capacity;
+        /** Maximum number of messages taken out of the queue in a single dispatcher pass. */
+        size_t batchSize;
+        OverflowPolicy overflowPolicy;
+    };
+
+    /**
+     * Fetch batched delivery configuration from system properties.
+     *
+     * \return Configuration, or std::nullopt if batched delivery is disabled (the default)
+     */
+    static std::optional<Config> getConfigFromProperties();
+
+    ListenerQueue(const sp<ICanMessageListener>& listener, const Config& config);
+    virtual ~ListenerQueue();
+
+    /**
+     * Queue a message for delivery. Never blocks on the listener.
+     *
+     * \param message Message to deliver
+     */
+    void push(const CanMessage& message);
+
+    /** Number of messages dropped due to the queue being full. */
+    uint64_t getDroppedCount() const;
+
+  private:
+    void dispatcherThread();
+
+    const sp<ICanMessageListener> mListener;
+    const Config mConfig;
+
+    std::mutex mQueueGuard;
+    std::condition_variable mQueueCv;
+    std::deque<CanMessage> mQueue GUARDED_BY(mQueueGuard);
+    bool mStopDispatcherThread GUARDED_BY(mQueueGuard) = false;
+
+    std::atomic<uint64_t> mDroppedCount = 0;
+    bool mFailedOnce = false;
+
+    std::thread mDispatcherThread;
+
+    DISALLOW_COPY_AND_ASSIGN(ListenerQueue);
+};
+
+}  // namespace android::hardware::automotive::can::V1_0::implementation
@@ -16,6 +16,8 @@
 
 #include "common.h"
 
+#include "ifreqs.h"
+
 #include <android-base/logging.h>
 
 #include <net/if.h>
@@ -23,11 +25,12 @@
 namespace android::netdevice {
 
 unsigned int nametoindex(const std::string& ifname) {
-    const auto ifidx = if_nametoindex(ifname.c_str());
-    if (ifidx != 0) return ifidx;
+    // Unlike if_nametoindex, this doesn't open a new socket for every lookup.
+    auto ifr = ifreqs::fromName(ifname);
+    if (ifreqs::trySend(SIOCGIFINDEX, ifr)) return ifr.ifr_ifindex;
 
     if (errno != ENODEV) {
-        PLOG(ERROR) << "if_nametoindex(" << ifname << ") failed";
+        PLOG(ERROR) << "SIOCGIFINDEX(" << ifname << ") failed";
     }
     return 0;
 }
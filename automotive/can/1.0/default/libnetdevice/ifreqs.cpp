@@ -22,6 +22,7 @@
 #include <android-base/unique_fd.h>
 
 #include <map>
+#include <mutex>
 
 namespace android::netdevice::ifreqs {
 
@@ -47,20 +48,38 @@ static SocketParams getSocketParams(int domain) {
     return params;
 }
 
-bool send(unsigned long request, struct ifreq& ifr) {
-    const auto sp = getSocketParams(socketDomain);
-    base::unique_fd sock(socket(sp.domain, sp.type, sp.protocol));
+/**
+ * Control sockets, by domain. They are never closed, so a socket returned by getSocket stays
+ * valid after the lock is released.
+ */
+static std::mutex socketsGuard;
+static std::map<int, base::unique_fd> sockets;
+
+static int getSocket(int domain) {
+    std::lock_guard<std::mutex> lock(socketsGuard);
+    auto& sock = sockets[domain];
     if (!sock.ok()) {
-        LOG(ERROR) << "Can't create socket";
-        return false;
+        const auto sp = getSocketParams(domain);
+        sock.reset(socket(sp.domain, sp.type | SOCK_CLOEXEC, sp.protocol));
+        if (!sock.ok()) {
+            PLOG(ERROR) << "Can't create socket";
+            return -1;
+        }
     }
+    return sock.get();
+}
 
-    if (ioctl(sock.get(), request, &ifr) < 0) {
-        PLOG(ERROR) << "ioctl(" << std::hex << request << std::dec << ") failed";
-        return false;
-    }
+bool trySend(unsigned long request, struct ifreq& ifr) {
+    const auto sock = getSocket(socketDomain);
+    if (sock < 0) return false;
+    return ioctl(sock, request, &ifr) >= 0;
+}
+
+bool send(unsigned long request, struct ifreq& ifr) {
+    if (trySend(request, ifr)) return true;
 
-    return true;
+    PLOG(ERROR) << "ioctl(" << std::hex << request << std::dec << ") failed";
+    return false;
 }
 
 struct ifreq fromName(const std::string& ifname) {
@@ -30,12 +30,24 @@ extern std::atomic_int socketDomain;
 /**
  * Sends ioctl interface request.
  *
+ * The request is sent on a socket of the configured domain that is kept open for the lifetime of
+ * the process and shared by all requests, rather than on a new one each time.
+ *
  * \param request Request type (such as SIOCGIFFLAGS)
  * \param ifr Request data (both input and output)
  * \return true if the call succeeded, false otherwise
  */
 bool send(unsigned long request, struct ifreq& ifr);
 
+/**
+ * Sends ioctl interface request, without logging failures.
+ *
+ * \param request Request type (such as SIOCGIFFLAGS)
+ * \param ifr Request data (both input and output)
+ * \return true if the call succeeded, false otherwise (with errno set)
+ */
+bool trySend(unsigned long request, struct ifreq& ifr);
+
 /**
  * Initializes interface request with interface name.
  *
@@ -19,6 +19,8 @@
 #include <linux/if_ether.h>
 
 #include <array>
+#include <chrono>
+#include <map>
 #include <optional>
 #include <set>
 #include <string>
@@ -53,6 +55,25 @@ bool exists(std::string ifname);
  */
 std::optional<bool> isUp(std::string ifname);
 
+/**
+ * State of a network interface.
+ */
+struct LinkState {
+    unsigned int index;
+    bool up;
+};
+
+/**
+ * Fetches the state of many interfaces with a single RTM_GETLINK dump, instead of separate
+ * ioctls for each of them.
+ *
+ * \param ifnames Interfaces to fetch the state of, all of them if empty
+ * \return Map of the present interfaces to their state, leaving out those that don't exist, or
+ *         nullopt if the dump failed
+ */
+std::optional<std::map<std::string, LinkState>> getLinkStates(
+        const std::set<std::string>& ifnames = {});
+
 /**
  * Interface condition to wait for.
  */
@@ -83,6 +104,19 @@ enum class WaitCondition {
  */
 void waitFor(std::set<std::string> ifnames, WaitCondition cnd, bool allOf = true);
 
+/**
+ * Listens for interface changes until anticipated condition takes place or timeout expires.
+ *
+ * \param ifnames List of interfaces to watch for.
+ * \param cnd Awaited condition.
+ * \param timeout How long to wait for the condition at most.
+ * \param allOf true if all interfaces need to satisfy the condition, false if only one satistying
+ *        interface should stop the wait.
+ * \return true if the condition took place, false if the timeout expired first
+ */
+bool waitFor(std::set<std::string> ifnames, WaitCondition cnd, std::chrono::milliseconds timeout,
+             bool allOf = true);
+
 /**
  * Brings network interface up.
  *
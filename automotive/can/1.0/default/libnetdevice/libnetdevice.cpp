@@ -26,6 +26,7 @@
 #include <linux/can.h>
 #include <linux/rtnetlink.h>
 #include <net/if.h>
+#include <poll.h>
 
 #include <sstream>
 
@@ -100,6 +101,33 @@ std::optional<bool> isUp(std::string ifname) {
     return ifr.ifr_flags & IFF_UP;
 }
 
+std::optional<std::map<std::string, LinkState>> getLinkStates(
+        const std::set<std::string>& ifnames) {
+    nl::MessageFactory<ifinfomsg> req(RTM_GETLINK, NLM_F_REQUEST | NLM_F_DUMP);
+    nl::Socket sock(NETLINK_ROUTE);
+    if (!sock.send(req)) return std::nullopt;
+
+    std::map<std::string, LinkState> states;
+    for (const auto rawMsg : sock) {
+        if (rawMsg->nlmsg_type == NLMSG_DONE) return states;
+        if (rawMsg->nlmsg_type == NLMSG_ERROR) {
+            LOG(ERROR) << "Interface dump failed";
+            return std::nullopt;
+        }
+
+        const auto msg = nl::Message<ifinfomsg>::parse(rawMsg, {RTM_NEWLINK});
+        if (!msg.has_value()) continue;
+
+        const auto ifname = msg->attributes.get<std::string>(IFLA_IFNAME);
+        if (!ifnames.empty() && ifnames.count(ifname) == 0) continue;
+
+        states[ifname] = {static_cast<unsigned int>(msg->data.ifi_index),
+                          (msg->data.ifi_flags & IFF_UP) != 0};
+    }
+    LOG(ERROR) << "Can't read Netlink socket";
+    return std::nullopt;
+}
+
 struct WaitState {
     bool present;
     bool up;
@@ -139,15 +167,26 @@ static std::string toString(const std::set<std::string>& ifnames) {
     return str;
 }
 
-void waitFor(std::set<std::string> ifnames, WaitCondition cnd, bool allOf) {
+using Deadline = std::optional<std::chrono::steady_clock::time_point>;
+
+static bool waitFor(const std::set<std::string>& ifnames, WaitCondition cnd, bool allOf,
+                    Deadline deadline) {
+    // Subscribe before fetching the initial state, so no change is missed in between.
     nl::Socket sock(NETLINK_ROUTE, 0, RTMGRP_LINK);
 
     using StatesMap = std::map<std::string, WaitState>;
     StatesMap states = {};
-    for (const auto ifname : ifnames) {
-        const auto present = exists(ifname);
-        const auto up = present && isUp(ifname).value_or(false);
-        states[ifname] = {present, up};
+    const auto linkStates = getLinkStates(ifnames);
+    for (const auto& ifname : ifnames) {
+        if (linkStates.has_value()) {
+            const auto it = linkStates->find(ifname);
+            const auto present = it != linkStates->end();
+            states[ifname] = {present, present && it->second.up};
+        } else {
+            const auto present = exists(ifname);
+            const auto up = present && isUp(ifname).value_or(false);
+            states[ifname] = {present, up};
+        }
     }
 
     const auto mapConditionChecker = [cnd](const StatesMap::iterator::value_type& it) {
@@ -161,28 +200,58 @@ void waitFor(std::set<std::string> ifnames, WaitCondition cnd, bool allOf) {
         }
     };
 
-    if (isFullySatisfied()) return;
+    if (isFullySatisfied()) return true;
 
     LOG(DEBUG) << "Waiting for " << (allOf ? "" : "any of ") << toString(ifnames) << " to "
                << toString(cnd);
-    for (const auto rawMsg : sock) {
-        const auto msg = nl::Message<ifinfomsg>::parse(rawMsg, {RTM_NEWLINK, RTM_DELLINK});
-        if (!msg.has_value()) continue;
+    auto pfd = sock.preparePoll(POLLIN);
+    while (true) {
+        int timeoutMs = -1;
+        if (deadline.has_value()) {
+            const auto remaining = *deadline - std::chrono::steady_clock::now();
+            timeoutMs = std::max<int64_t>(
+                    std::chrono::ceil<std::chrono::milliseconds>(remaining).count(), 0);
+        }
+        const auto ready = poll(&pfd, 1, timeoutMs);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) {
+            LOG(WARNING) << "Timed out waiting for " << (allOf ? "" : "any of ")
+                         << toString(ifnames) << " to " << toString(cnd);
+            return false;
+        }
 
-        const auto ifname = msg->attributes.get<std::string>(IFLA_IFNAME);
-        if (ifnames.count(ifname) == 0) continue;
+        const auto buf = ready > 0 ? sock.receive() : std::nullopt;
+        if (!buf.has_value()) break;
 
-        const bool present = (msg->header.nlmsg_type != RTM_DELLINK);
-        const bool up = present && (msg->data.ifi_flags & IFF_UP) != 0;
-        states[ifname] = {present, up};
+        for (const auto rawMsg : *buf) {
+            const auto msg = nl::Message<ifinfomsg>::parse(rawMsg, {RTM_NEWLINK, RTM_DELLINK});
+            if (!msg.has_value()) continue;
 
-        if (isFullySatisfied()) {
-            LOG(DEBUG) << "Finished waiting for " << (allOf ? "" : "some of ") << toString(ifnames)
-                       << " to " << toString(cnd);
-            return;
+            const auto ifname = msg->attributes.get<std::string>(IFLA_IFNAME);
+            if (ifnames.count(ifname) == 0) continue;
+
+            const bool present = (msg->header.nlmsg_type != RTM_DELLINK);
+            const bool up = present && (msg->data.ifi_flags & IFF_UP) != 0;
+            states[ifname] = {present, up};
+
+            if (isFullySatisfied()) {
+                LOG(DEBUG) << "Finished waiting for " << (allOf ? "" : "some of ")
+                           << toString(ifnames) << " to " << toString(cnd);
+                return true;
+            }
         }
     }
     LOG(FATAL) << "Can't read Netlink socket";
+    return false;
+}
+
+void waitFor(std::set<std::string> ifnames, WaitCondition cnd, bool allOf) {
+    waitFor(ifnames, cnd, allOf, std::nullopt);
+}
+
+bool waitFor(std::set<std::string> ifnames, WaitCondition cnd, std::chrono::milliseconds timeout,
+             bool allOf) {
+    return waitFor(ifnames, cnd, allOf, std::chrono::steady_clock::now() + timeout);
 }
 
 }  // namespace android::netdevice
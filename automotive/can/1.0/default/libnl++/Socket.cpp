@@ -73,16 +73,74 @@ bool Socket::send(const Buffer<nlmsghdr>& msg, uint32_t destination) {
     return send(msg, sa);
 }
 
+size_t Socket::send(const std::vector<std::pair<Buffer<nlmsghdr>, sockaddr_nl>>& msgs) {
+    if constexpr (kSuperVerbose) {
+        for (const auto& [msg, sa] : msgs) {
+            LOG(VERBOSE) << (mFailed ? "(not) " : "") << "sending to " << sa.nl_pid << ": "
+                         << toString(msg, mProtocol);
+        }
+    }
+    if (mFailed) return 0;
+
+    mSendHeaders.resize(msgs.size());
+    mSendIovecs.resize(msgs.size());
+    for (size_t i = 0; i < msgs.size(); i++) {
+        const auto rawMsg = msgs[i].first.getRaw();
+        mSendIovecs[i] = {const_cast<nlmsghdr*>(rawMsg.ptr()), rawMsg.len()};
+        mSendHeaders[i] = {};
+        mSendHeaders[i].msg_hdr.msg_name = const_cast<sockaddr_nl*>(&msgs[i].second);
+        mSendHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_nl);
+        mSendHeaders[i].msg_hdr.msg_iov = &mSendIovecs[i];
+        mSendHeaders[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+    while (sent < msgs.size()) {
+        const auto count =
+                sendmmsg(mFd.get(), mSendHeaders.data() + sent, msgs.size() - sent, 0);
+        if (count < 0) {
+            PLOG(ERROR) << "Can't send Netlink messages";
+            break;
+        }
+        const auto end = sent + count;
+        for (; sent < end; sent++) {
+            if (mSendHeaders[sent].msg_len != mSendIovecs[sent].iov_len) break;
+        }
+        if (sent < end) {
+            LOG(ERROR) << "Can't send Netlink message: truncated message";
+            break;
+        }
+    }
+    if (sent > 0) mSeq = msgs[sent - 1].first->nlmsg_seq;
+    return sent;
+}
+
 bool Socket::increaseReceiveBuffer(size_t maxSize) {
     if (maxSize == 0) {
         LOG(ERROR) << "Maximum receive size should not be zero";
         return false;
     }
 
+    // Datagrams of the current batch still point into the buffer.
+    if (mPendingNext < mPending.size()) return true;
+
     if (mReceiveBuffer.size() < maxSize) mReceiveBuffer.resize(maxSize);
     return true;
 }
 
+bool Socket::setReceiveBatchSize(size_t count) {
+    if (count == 0) {
+        LOG(ERROR) << "Receive batch size should not be zero";
+        return false;
+    }
+
+    mReceiveBatchSize = count;
+    mBatchHeaders.resize(count);
+    mBatchIovecs.resize(count);
+    mBatchAddresses.resize(count);
+    return true;
+}
+
 std::optional<Buffer<nlmsghdr>> Socket::receive(size_t maxSize) {
     return receiveFrom(maxSize).first;
 }
@@ -90,6 +148,12 @@ std::optional<Buffer<nlmsghdr>> Socket::receive(size_t maxSize) {
 std::pair<std::optional<Buffer<nlmsghdr>>, sockaddr_nl> Socket::receiveFrom(size_t maxSize) {
     if (mFailed) return {std::nullopt, {}};
 
+    if (mPendingNext < mPending.size()) {
+        const auto& [msg, sa] = mPending[mPendingNext++];
+        return {msg, sa};
+    }
+    if (mReceiveBatchSize > 1) return receiveBatch(maxSize);
+
     if (!increaseReceiveBuffer(maxSize)) return {std::nullopt, {}};
 
     sockaddr_nl sa = {};
@@ -113,6 +177,56 @@ std::pair<std::optional<Buffer<nlmsghdr>>, sockaddr_nl> Socket::receiveFrom(size
     return {msg, sa};
 }
 
+bool Socket::hasPendingReceive() const {
+    return mPendingNext < mPending.size();
+}
+
+std::pair<std::optional<Buffer<nlmsghdr>>, sockaddr_nl> Socket::receiveBatch(size_t maxSize) {
+    if (!increaseReceiveBuffer(maxSize * mReceiveBatchSize)) return {std::nullopt, {}};
+
+    for (size_t i = 0; i < mReceiveBatchSize; i++) {
+        mBatchAddresses[i] = {};
+        mBatchIovecs[i] = {mReceiveBuffer.data() + i * maxSize, maxSize};
+        mBatchHeaders[i] = {};
+        mBatchHeaders[i].msg_hdr.msg_name = &mBatchAddresses[i];
+        mBatchHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_nl);
+        mBatchHeaders[i].msg_hdr.msg_iov = &mBatchIovecs[i];
+        mBatchHeaders[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Block for the first datagram only and take whatever else is already queued.
+    const auto count = recvmmsg(mFd.get(), mBatchHeaders.data(), mReceiveBatchSize,
+                                MSG_TRUNC | MSG_WAITFORONE, nullptr);
+    if (count <= 0) {
+        PLOG(ERROR) << "Failed to receive Netlink message";
+        return {std::nullopt, {}};
+    }
+
+    mPending.clear();
+    mPendingNext = 0;
+    for (int i = 0; i < count; i++) {
+        const auto bytesReceived = mBatchHeaders[i].msg_len;
+        if (bytesReceived == 0) continue;
+        if (bytesReceived > maxSize || (mBatchHeaders[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+            LOG(ERROR) << "Received data larger than maximum receive size: "  //
+                       << bytesReceived << " > " << maxSize;
+            continue;
+        }
+
+        Buffer<nlmsghdr> msg(reinterpret_cast<nlmsghdr*>(mBatchIovecs[i].iov_base),
+                             bytesReceived);
+        if constexpr (kSuperVerbose) {
+            LOG(VERBOSE) << "received from " << mBatchAddresses[i].nl_pid << ": "
+                         << toString(msg, mProtocol);
+        }
+        mPending.emplace_back(msg, mBatchAddresses[i]);
+    }
+    if (mPending.empty()) return {std::nullopt, {}};
+
+    const auto& [msg, sa] = mPending[mPendingNext++];
+    return {msg, sa};
+}
+
 bool Socket::receiveAck(uint32_t seq) {
     const auto nlerr = receive<nlmsgerr>({NLMSG_ERROR});
     if (!nlerr.has_value()) return false;
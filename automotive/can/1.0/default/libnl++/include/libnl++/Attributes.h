@@ -145,6 +145,32 @@ class Attributes : private Buffer<nlattr> {
         return val;
     }
 
+    /**
+     * Iterates over attributes in the order they appear in the buffer.
+     *
+     * This walks the underlying buffer in place without calculating the index, so it's the
+     * cheaper choice for attributes read only once (such as every entry of a large dump) or
+     * repeating the same type (such as elements of a nested list). Use parse() on the visited
+     * buffers to read their values:
+     * ```
+     * for (const auto attr : msg->attributes) {
+     *     if (attr->nla_type == IFLA_IFNAME) name = nl::Attributes::parse<std::string>(attr);
+     * }
+     * ```
+     */
+    using Buffer<nlattr>::iterator;
+    using Buffer<nlattr>::begin;
+    using Buffer<nlattr>::end;
+
+    /**
+     * Parse attribute data into a specific type.
+     *
+     * \param buf Raw attribute data.
+     * \return Parsed data.
+     */
+    template <typename T>
+    static T parse(Buffer<nlattr> buf);
+
   private:
     using Index = std::map<nlattrtype_t, Buffer<nlattr>>;
 
@@ -171,15 +197,6 @@ class Attributes : private Buffer<nlattr> {
      * \return Attribute index.
      */
     const Index& index() const;
-
-    /**
-     * Parse attribute data into a specific type.
-     *
-     * \param buf Raw attribute data.
-     * \return Parsed data.
-     */
-    template <typename T>
-    static T parse(Buffer<nlattr> buf);
 };
 
 }  // namespace android::nl
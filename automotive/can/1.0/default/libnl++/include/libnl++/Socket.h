@@ -24,6 +24,7 @@
 
 #include <linux/netlink.h>
 #include <poll.h>
+#include <sys/socket.h>
 
 #include <optional>
 #include <set>
@@ -103,6 +104,30 @@ class Socket {
      */
     bool send(const Buffer<nlmsghdr>& msg, uint32_t destination);
 
+    /**
+     * Send multiple Netlink messages with as few sendmmsg calls as possible.
+     *
+     * \param msgs Messages to send, each with its destination address.
+     * \return Number of messages sent, counted from the front. Less than msgs.size() on error.
+     */
+    size_t send(const std::vector<std::pair<Buffer<nlmsghdr>, sockaddr_nl>>& msgs);
+
+    /**
+     * Set how many datagrams a single read may fetch from the socket.
+     *
+     * With a batch size above 1, a read takes all datagrams already queued (up to the batch size)
+     * with one recvmmsg call, each into its own maxSize slot of the receive buffer, and the next
+     * reads return them in order until the batch is drained. This saves a system call per
+     * datagram when walking large (e.g. NLM_F_DUMP) replies with receive_iterator.
+     *
+     * WARNING: with batching, the data of a received datagram is valid until the batch it came in
+     * is drained and the next one is read.
+     *
+     * \param count Maximum number of datagrams per read, default is 1.
+     * \return true, if succeeded.
+     */
+    bool setReceiveBatchSize(size_t count);
+
     /**
      * Receive one or multiple Netlink messages.
      *
@@ -128,6 +153,14 @@ class Socket {
     std::pair<std::optional<Buffer<nlmsghdr>>, sockaddr_nl> receiveFrom(
             size_t maxSize = defaultReceiveSize);
 
+    /**
+     * Whether the next read returns a datagram of the current batch without a system call, and
+     * thus without blocking.
+     *
+     * \return true, if datagrams of the last batch were not returned yet.
+     */
+    bool hasPendingReceive() const;
+
     /**
      * Receive matching Netlink message of a given payload type.
      *
@@ -251,7 +284,19 @@ class Socket {
     bool mFailed = false;
     uint32_t mSeq = 0;
 
+    size_t mReceiveBatchSize = 1;
+    std::vector<mmsghdr> mBatchHeaders;
+    std::vector<iovec> mBatchIovecs;
+    std::vector<sockaddr_nl> mBatchAddresses;
+    // Datagrams of the last batch not returned yet, with their sender addresses.
+    std::vector<std::pair<Buffer<nlmsghdr>, sockaddr_nl>> mPending;
+    size_t mPendingNext = 0;
+
+    std::vector<mmsghdr> mSendHeaders;
+    std::vector<iovec> mSendIovecs;
+
     bool increaseReceiveBuffer(size_t maxSize);
+    std::pair<std::optional<Buffer<nlmsghdr>>, sockaddr_nl> receiveBatch(size_t maxSize);
     std::optional<Buffer<nlmsghdr>> receive(const std::set<nlmsgtype_t>& msgtypes, size_t maxSize);
 
     DISALLOW_COPY_AND_ASSIGN(Socket);
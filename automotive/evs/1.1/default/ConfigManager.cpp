@@ -16,13 +16,19 @@
 
 #include "ConfigManager.h"
 
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
 #include <android/hardware/camera/device/3.2/ICameraDevice.h>
 #include <hardware/gralloc.h>
 #include <utils/SystemClock.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <fstream>
 #include <sstream>
 #include <thread>
+#include <type_traits>
 
 namespace android::hardware::automotive::evs::V1_1::implementation {
 
@@ -30,6 +36,194 @@ using namespace std;
 using namespace tinyxml2;
 using hardware::camera::device::V3_2::StreamRotation;
 
+namespace {
+
+/* "EVSB" in little endian; bump the version whenever the layout below changes */
+constexpr uint32_t kBinaryMagic = 0x42535645;
+constexpr uint32_t kBinaryVersion = 1;
+
+/* 64-bit FNV-1a of the XML configuration, used to tell whether a binary copy is stale */
+uint64_t hashConfigData(const string& data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+class BinaryWriter {
+  public:
+    template <typename T>
+    void write(const T& value) {
+        static_assert(is_trivially_copyable_v<T>);
+        mData.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void writeBytes(const void* data, uint32_t size) {
+        write(size);
+        mData.append(static_cast<const char*>(data), size);
+    }
+
+    void writeString(const string& str) { writeBytes(str.data(), str.size()); }
+
+    string& data() { return mData; }
+
+  private:
+    string mData;
+};
+
+class BinaryReader {
+  public:
+    explicit BinaryReader(const string& data)
+        : mPos(data.data()), mEnd(data.data() + data.size()) {}
+
+    template <typename T>
+    bool read(T& value) {
+        static_assert(is_trivially_copyable_v<T>);
+        if (static_cast<size_t>(mEnd - mPos) < sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, mPos, sizeof(value));
+        mPos += sizeof(value);
+        return true;
+    }
+
+    /* Returns a pointer to the next size bytes, which stay owned by the buffer */
+    const char* readBytes(uint32_t& size) {
+        if (!read(size) || static_cast<size_t>(mEnd - mPos) < size) {
+            return nullptr;
+        }
+        const char* bytes = mPos;
+        mPos += size;
+        return bytes;
+    }
+
+    bool readString(string& str) {
+        uint32_t size;
+        const char* bytes = readBytes(size);
+        if (bytes == nullptr) {
+            return false;
+        }
+        str.assign(bytes, size);
+        return true;
+    }
+
+    bool atEnd() const { return mPos == mEnd; }
+
+  private:
+    const char* mPos;
+    const char* mEnd;
+};
+
+void writeStreamConfigurations(BinaryWriter& out,
+                               const unordered_map<int32_t, RawStreamConfiguration>& configs) {
+    out.write(static_cast<uint32_t>(configs.size()));
+    for (auto& [id, cfg] : configs) {
+        out.write(id);
+        out.write(cfg);
+    }
+}
+
+bool readStreamConfigurations(BinaryReader& in,
+                              unordered_map<int32_t, RawStreamConfiguration>& configs) {
+    uint32_t count;
+    if (!in.read(count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        int32_t id;
+        RawStreamConfiguration cfg;
+        if (!in.read(id) || !in.read(cfg)) {
+            return false;
+        }
+        configs.insert_or_assign(id, cfg);
+    }
+    return true;
+}
+
+void writeStringSet(BinaryWriter& out, const unordered_set<string>& strs) {
+    out.write(static_cast<uint32_t>(strs.size()));
+    for (auto& str : strs) {
+        out.writeString(str);
+    }
+}
+
+bool readStringSet(BinaryReader& in, unordered_set<string>& strs) {
+    uint32_t count;
+    if (!in.read(count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        string str;
+        if (!in.readString(str)) {
+            return false;
+        }
+        strs.emplace(std::move(str));
+    }
+    return true;
+}
+
+/*
+ * Only what clients look at is stored; cameraMetadata is merely used to build
+ * characteristics while parsing XML.
+ */
+void writeCameraInfoToBinary(BinaryWriter& out, const ConfigManager::CameraInfo& info) {
+    out.write(static_cast<uint32_t>(info.controls.size()));
+    for (auto& [id, range] : info.controls) {
+        out.write(id);
+        out.write(get<0>(range));
+        out.write(get<1>(range));
+        out.write(get<2>(range));
+    }
+
+    writeStreamConfigurations(out, info.streamConfigurations);
+
+    /* camera_metadata_t is a single relocatable buffer */
+    out.writeBytes(info.characteristics,
+                   info.characteristics ? get_camera_metadata_size(info.characteristics) : 0);
+}
+
+bool readCameraInfoFromBinary(BinaryReader& in, ConfigManager::CameraInfo* info) {
+    uint32_t count;
+    if (!in.read(count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        CameraParam id;
+        int32_t minVal, maxVal, stepVal;
+        if (!in.read(id) || !in.read(minVal) || !in.read(maxVal) || !in.read(stepVal)) {
+            return false;
+        }
+        info->controls.emplace(id, make_tuple(minVal, maxVal, stepVal));
+    }
+
+    if (!readStreamConfigurations(in, info->streamConfigurations)) {
+        return false;
+    }
+
+    uint32_t size;
+    const char* bytes = in.readBytes(size);
+    if (bytes == nullptr) {
+        return false;
+    }
+    if (size > 0) {
+        /* copy to a malloc'ed, hence aligned, buffer as free_camera_metadata() expects */
+        info->characteristics = static_cast<camera_metadata_t*>(malloc(size));
+        if (info->characteristics == nullptr) {
+            return false;
+        }
+        memcpy(info->characteristics, bytes, size);
+        const size_t expectedSize = size;
+        if (validate_camera_metadata_structure(info->characteristics, &expectedSize)) {
+            ALOGE("Binary configuration has malformed camera metadata");
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
 ConfigManager::~ConfigManager() {
     /* Nothing to do */
 }
@@ -406,13 +600,13 @@ void ConfigManager::readDisplayInfo(const XMLElement* const aDisplayElem) {
     return;
 }
 
-bool ConfigManager::readConfigDataFromXML() noexcept {
+bool ConfigManager::readConfigDataFromXML(const string& xmlData) noexcept {
     XMLDocument xmlDoc;
 
     const int64_t parsingStart = android::elapsedRealtimeNano();
 
-    /* load and parse a configuration file */
-    xmlDoc.LoadFile(mConfigFilePath);
+    /* parse a configuration file */
+    xmlDoc.Parse(xmlData.data(), xmlData.size());
     if (xmlDoc.ErrorID() != XML_SUCCESS) {
         ALOGE("Failed to load and/or parse a configuration file, %s", xmlDoc.ErrorStr());
         return false;
@@ -445,22 +639,165 @@ bool ConfigManager::readConfigDataFromXML() noexcept {
     return true;
 }
 
-std::unique_ptr<ConfigManager> ConfigManager::Create(const char* path) {
-    unique_ptr<ConfigManager> cfgMgr(new ConfigManager(path));
+bool ConfigManager::readConfigDataFromBinary(const char* binaryPath, uint64_t xmlSize,
+                                             uint64_t xmlHash) noexcept {
+    const int64_t readingStart = android::elapsedRealtimeNano();
+
+    string data;
+    if (!android::base::ReadFileToString(binaryPath, &data)) {
+        ALOGI("No binary configuration at %s", binaryPath);
+        return false;
+    }
+
+    BinaryReader in(data);
+    uint32_t magic, version;
+    uint64_t size, hash;
+    if (!in.read(magic) || !in.read(version) || !in.read(size) || !in.read(hash) ||
+        magic != kBinaryMagic || version != kBinaryVersion) {
+        ALOGI("Binary configuration %s has an unknown format", binaryPath);
+        return false;
+    }
+    if (size != xmlSize || hash != xmlHash) {
+        ALOGI("Binary configuration %s is out of date", binaryPath);
+        return false;
+    }
+
+    bool success = in.read(mSystemInfo.numCameras);
+
+    uint32_t count = 0;
+    success = success && in.read(count);
+    for (uint32_t i = 0; success && i < count; ++i) {
+        string id;
+        unique_ptr<CameraInfo> aCamera(new CameraInfo());
+        success = in.readString(id) && readCameraInfoFromBinary(in, aCamera.get());
+        mCameraInfo.insert_or_assign(id, std::move(aCamera));
+    }
+
+    success = success && in.read(count);
+    for (uint32_t i = 0; success && i < count; ++i) {
+        string id;
+        uint8_t synchronized;
+        unique_ptr<CameraGroupInfo> aGroup(new CameraGroupInfo());
+        success = in.readString(id) && readCameraInfoFromBinary(in, aGroup.get()) &&
+                  readStringSet(in, aGroup->devices) && in.read(synchronized);
+        aGroup->synchronized = synchronized;
+        mCameraGroupInfos.insert_or_assign(id, std::move(aGroup));
+    }
+
+    success = success && in.read(count);
+    for (uint32_t i = 0; success && i < count; ++i) {
+        string id;
+        unique_ptr<DisplayInfo> dpy(new DisplayInfo());
+        success = in.readString(id) && readStreamConfigurations(in, dpy->streamConfigurations);
+        mDisplayInfo.insert_or_assign(id, std::move(dpy));
+    }
+
+    success = success && in.read(count);
+    for (uint32_t i = 0; success && i < count; ++i) {
+        string pos;
+        success = in.readString(pos) && readStringSet(in, mCameraPosition[pos]);
+    }
+
+    if (!success || !in.atEnd()) {
+        ALOGE("Binary configuration %s is corrupted", binaryPath);
+        mSystemInfo = SystemInfo();
+        mCameraInfo.clear();
+        mCameraGroupInfos.clear();
+        mDisplayInfo.clear();
+        mCameraPosition.clear();
+        return false;
+    }
+
+    const int64_t readingEnd = android::elapsedRealtimeNano();
+    ALOGI("Reading binary configuration takes %lf (ms)",
+          (double)(readingEnd - readingStart) / 1000000.0);
+
+    return true;
+}
+
+void ConfigManager::writeConfigDataToBinary(const char* binaryPath, uint64_t xmlSize,
+                                            uint64_t xmlHash) noexcept {
+    BinaryWriter out;
+    out.write(kBinaryMagic);
+    out.write(kBinaryVersion);
+    out.write(xmlSize);
+    out.write(xmlHash);
+
+    out.write(mSystemInfo.numCameras);
+
+    out.write(static_cast<uint32_t>(mCameraInfo.size()));
+    for (auto& [id, aCamera] : mCameraInfo) {
+        out.writeString(id);
+        writeCameraInfoToBinary(out, *aCamera);
+    }
+
+    out.write(static_cast<uint32_t>(mCameraGroupInfos.size()));
+    for (auto& [id, aGroup] : mCameraGroupInfos) {
+        out.writeString(id);
+        writeCameraInfoToBinary(out, *aGroup);
+        writeStringSet(out, aGroup->devices);
+        out.write(static_cast<uint8_t>(aGroup->synchronized));
+    }
+
+    out.write(static_cast<uint32_t>(mDisplayInfo.size()));
+    for (auto& [id, dpy] : mDisplayInfo) {
+        out.writeString(id);
+        writeStreamConfigurations(out, dpy->streamConfigurations);
+    }
+
+    out.write(static_cast<uint32_t>(mCameraPosition.size()));
+    for (auto& [pos, ids] : mCameraPosition) {
+        out.writeString(pos);
+        writeStringSet(out, ids);
+    }
 
     /*
-     * Read a configuration from XML file
-     *
-     * If this is too slow, ConfigManager::readConfigDataFromBinary() and
-     * ConfigManager::writeConfigDataToBinary()can serialize CameraInfo object
-     * to the filesystem and construct CameraInfo instead; this was
-     * evaluated as 10x faster.
+     * Storing the file does not have to delay the clients; write it to a
+     * temporary file and rename it so that a reader never sees a partial one.
      */
-    if (!cfgMgr->readConfigDataFromXML()) {
+    thread([data = std::move(out.data()), path = string(binaryPath)]() {
+        const string tmpPath = path + ".tmp";
+        android::base::unique_fd fd(
+                open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640));
+        if (!fd.ok() || !android::base::WriteFully(fd, data.data(), data.size()) ||
+            fsync(fd.get()) != 0 || rename(tmpPath.c_str(), path.c_str()) != 0) {
+            ALOGW("Failed to store a binary configuration at %s", path.c_str());
+            unlink(tmpPath.c_str());
+            return;
+        }
+        ALOGI("Stored a binary configuration at %s", path.c_str());
+    }).detach();
+}
+
+std::unique_ptr<ConfigManager> ConfigManager::Create(const char* path, const char* binaryPath) {
+    unique_ptr<ConfigManager> cfgMgr(new ConfigManager(path));
+
+    string xmlData;
+    if (!android::base::ReadFileToString(path, &xmlData)) {
+        ALOGE("Failed to read a configuration file, %s", path);
         return nullptr;
-    } else {
+    }
+
+    /*
+     * Reading the configuration back from its binary form is about 10x faster
+     * than parsing XML.  The binary form is only used as long as the XML file
+     * it was made from is unchanged.
+     */
+    const uint64_t xmlHash = hashConfigData(xmlData);
+    if (binaryPath != nullptr &&
+        cfgMgr->readConfigDataFromBinary(binaryPath, xmlData.size(), xmlHash)) {
         return cfgMgr;
     }
+
+    /* Read a configuration from XML file */
+    if (!cfgMgr->readConfigDataFromXML(xmlData)) {
+        return nullptr;
+    }
+
+    if (binaryPath != nullptr) {
+        cfgMgr->writeConfigDataToBinary(binaryPath, xmlData.size(), xmlHash);
+    }
+    return cfgMgr;
 }
 
 }  // namespace android::hardware::automotive::evs::V1_1::implementation
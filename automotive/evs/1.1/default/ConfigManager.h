@@ -44,7 +44,18 @@ typedef std::array<int32_t, kStreamCfgSz> RawStreamConfiguration;
 
 class ConfigManager {
   public:
-    static std::unique_ptr<ConfigManager> Create(const char* path = "");
+    /*
+     * Create a ConfigManager from a given XML configuration file
+     *
+     * @param  path
+     *         A path to the XML configuration file.
+     * @param  binaryPath
+     *         A path to a binary copy of the configuration, which is read
+     *         instead of parsing XML as long as the XML file is unchanged, and
+     *         is rewritten otherwise.  No binary copy is used if this is null.
+     */
+    static std::unique_ptr<ConfigManager> Create(const char* path = "",
+                                                 const char* binaryPath = nullptr);
     ConfigManager(const ConfigManager&) = delete;
     ConfigManager& operator=(const ConfigManager&) = delete;
 
@@ -197,10 +208,41 @@ class ConfigManager {
      * Parse a given EVS configuration file and store the information
      * internally.
      *
+     * @param  xmlData
+     *         Contents of the configuration file.
+     *
      * @return bool
      *         True if it completes parsing a file successfully.
      */
-    bool readConfigDataFromXML() noexcept;
+    bool readConfigDataFromXML(const std::string& xmlData) noexcept;
+
+    /*
+     * Read the information stored by writeConfigDataToBinary().
+     *
+     * @param  binaryPath
+     *         A path to the binary configuration file.
+     * @param  xmlSize, xmlHash
+     *         Size and hash of the XML configuration file; a binary
+     *         configuration made from a different one is ignored.
+     *
+     * @return bool
+     *         False if the file is missing, stale or corrupted, in which case
+     *         nothing is stored.
+     */
+    bool readConfigDataFromBinary(const char* binaryPath, uint64_t xmlSize,
+                                  uint64_t xmlHash) noexcept;
+
+    /*
+     * Serialize the information read from XML and store it to the filesystem
+     * in the background.
+     *
+     * @param  binaryPath
+     *         A path to the binary configuration file.
+     * @param  xmlSize, xmlHash
+     *         Size and hash of the XML configuration file it was read from.
+     */
+    void writeConfigDataToBinary(const char* binaryPath, uint64_t xmlSize,
+                                 uint64_t xmlHash) noexcept;
 
     /*
      * read the information of the vehicle
@@ -22,6 +22,9 @@
 #include <ui/GraphicBufferMapper.h>
 #include <utils/SystemClock.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace {
 
 // Arbitrary limit on number of graphics buffers allowed to be allocated
@@ -44,6 +47,16 @@ constexpr uint32_t kColors[] = {
 };
 constexpr uint32_t kNumColors = sizeof(kColors) / sizeof(kColors[0]);
 
+// Frame rate used when the stream configuration does not specify one.  15 fps is enough to pass
+// the 10 fps test requirement.
+constexpr int32_t kDefaultFrameRate = 15;
+
+// The frame counter is stamped into the top-left corner of every frame as one block per bit,
+// most significant bit first; white blocks are ones and black blocks are zeros.
+constexpr unsigned kFrameCounterBits = 32;
+constexpr unsigned kFrameCounterBlockWidth = 8;
+constexpr unsigned kFrameCounterBlockHeight = 8;
+
 }  // namespace
 
 namespace android::hardware::automotive::evs::V1_1::implementation {
@@ -403,6 +416,7 @@ Return<void> EvsCamera::importExternalBuffers([[maybe_unused]] const hidl_vec<Bu
                     // Use this existing entry
                     rec.handle = memHandle;
                     rec.inUse = false;
+                    rec.patternReady = false;
 
                     stored = true;
                     break;
@@ -467,9 +481,11 @@ unsigned EvsCamera::increaseAvailableFrames_Locked(unsigned numToAdd) {
     // Acquire the graphics buffer allocator
     GraphicBufferAllocator& alloc(GraphicBufferAllocator::get());
 
-    unsigned added = 0;
-
-    while (added < numToAdd) {
+    // Allocate the whole batch before touching our buffer set, so a failure part way through
+    // leaves it as it was
+    std::vector<buffer_handle_t> handles;
+    handles.reserve(numToAdd);
+    while (handles.size() < numToAdd) {
         buffer_handle_t memHandle = nullptr;
         status_t result = alloc.allocate(mWidth, mHeight, mFormat, 1, mUsage, &memHandle, &mStride,
                                          0, "EvsCamera");
@@ -481,28 +497,37 @@ unsigned EvsCamera::increaseAvailableFrames_Locked(unsigned numToAdd) {
             ALOGE("We didn't get a buffer handle back from the allocator");
             break;
         }
+        handles.push_back(memHandle);
+    }
 
-        // Find a place to store the new buffer
-        bool stored = false;
-        for (auto&& rec : mBuffers) {
-            if (rec.handle == nullptr) {
-                // Use this existing entry
-                rec.handle = memHandle;
-                rec.inUse = false;
-                stored = true;
-                break;
-            }
-        }
-        if (!stored) {
-            // Add a BufferRecord wrapping this handle to our set of available buffers
-            mBuffers.push_back(std::move(BufferRecord(memHandle)));
+    if (handles.size() < numToAdd) {
+        for (auto&& memHandle : handles) {
+            alloc.free(memHandle);
         }
+        return 0;
+    }
 
-        mFramesAllowed++;
-        added++;
+    // Store the new buffers, reusing empty entries first
+    auto handle = handles.begin();
+    for (auto&& rec : mBuffers) {
+        if (handle == handles.end()) {
+            break;
+        }
+        if (rec.handle == nullptr) {
+            // Use this existing entry
+            rec.handle = *handle++;
+            rec.inUse = false;
+            rec.patternReady = false;
+        }
+    }
+    mBuffers.reserve(mBuffers.size() + (handles.end() - handle));
+    while (handle != handles.end()) {
+        // Add a BufferRecord wrapping this handle to our set of available buffers
+        mBuffers.emplace_back(*handle++);
     }
 
-    return added;
+    mFramesAllowed += numToAdd;
+    return numToAdd;
 }
 
 unsigned EvsCamera::decreaseAvailableFrames_Locked(unsigned numToRemove) {
@@ -535,9 +560,11 @@ unsigned EvsCamera::decreaseAvailableFrames_Locked(unsigned numToRemove) {
 void EvsCamera::generateFrames() {
     ALOGD("Frame generation loop started");
 
+    const nsecs_t targetFrameIntervalUs = 1000 * 1000 / mFrameRate;
     unsigned idx;
     while (true) {
         bool timeForFrame = false;
+        bool drawPattern = false;
         nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
         // Lock scope for updating shared state
@@ -571,6 +598,10 @@ void EvsCamera::generateFrames() {
                     mBuffers[idx].inUse = true;
                     mFramesInUse++;
                     timeForFrame = true;
+
+                    // Only a buffer we have not handed out before needs the full pattern
+                    drawPattern = !mBuffers[idx].patternReady;
+                    mBuffers[idx].patternReady = true;
                 }
             }
         }
@@ -593,7 +624,8 @@ void EvsCamera::generateFrames() {
             newBuffer.timestamp = elapsedRealtimeNano() * 1e+3;  // timestamps is in microseconds
 
             // Write test data into the image buffer
-            fillTestFrame(newBuffer);
+            fillTestFrame(newBuffer, drawPattern);
+            mFrameCount++;
 
             // Issue the (asynchronous) callback to the client -- can't be holding the lock
             auto result = mStream->deliverFrame_1_1({newBuffer});
@@ -616,13 +648,10 @@ void EvsCamera::generateFrames() {
             }
         }
 
-        // We arbitrarily choose to generate frames at 15 fps to ensure we pass the 10fps test
-        // requirement
-        static const int kTargetFrameRate = 15;
-        static const nsecs_t kTargetFrameIntervalUs = 1000 * 1000 / kTargetFrameRate;
+        // Generate frames at the rate of the stream configuration
         const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
         const nsecs_t elapsedTimeUs = (now - startTime) / 1000;
-        const nsecs_t sleepDurationUs = kTargetFrameIntervalUs - elapsedTimeUs;
+        const nsecs_t sleepDurationUs = targetFrameIntervalUs - elapsedTimeUs;
         if (sleepDurationUs > 0) {
             usleep(sleepDurationUs);
         }
@@ -639,15 +668,21 @@ void EvsCamera::generateFrames() {
     return;
 }
 
-void EvsCamera::fillTestFrame(const BufferDesc& buff) {
-    // Lock our output buffer for writing
-    uint32_t* pixels = nullptr;
+void EvsCamera::fillTestFrame(const BufferDesc& buff, bool drawPattern) {
     const AHardwareBuffer_Desc* pDesc =
             reinterpret_cast<const AHardwareBuffer_Desc*>(&buff.buffer.description);
+
+    // Lock our output buffer for writing; only the rows holding the frame counter are touched
+    // unless the pattern has to be drawn
+    const uint32_t counterHeight = std::min(kFrameCounterBlockHeight, pDesc->height);
+    const uint32_t counterWidth = std::min(kFrameCounterBits * kFrameCounterBlockWidth,
+                                           pDesc->width);
+    uint32_t* pixels = nullptr;
     GraphicBufferMapper& mapper = GraphicBufferMapper::get();
     mapper.lock(buff.buffer.nativeHandle,
                 GRALLOC_USAGE_SW_WRITE_OFTEN | GRALLOC_USAGE_SW_READ_NEVER,
-                android::Rect(pDesc->width, pDesc->height), (void**)&pixels);
+                android::Rect(pDesc->width, drawPattern ? pDesc->height : counterHeight),
+                (void**)&pixels);
 
     // If we failed to lock the pixel buffer, we're about to crash, but log it first
     if (!pixels) {
@@ -655,15 +690,32 @@ void EvsCamera::fillTestFrame(const BufferDesc& buff) {
         return;
     }
 
-    // Fill in the test pixels; the colorbar in ABGR format
-    for (unsigned row = 0; row < pDesc->height; row++) {
-        for (unsigned col = 0; col < pDesc->width; col++) {
-            const uint32_t index = col * kNumColors / pDesc->width;
-            pixels[col] = kColors[index];
+    if (drawPattern) {
+        // Build one row of the colorbar in ABGR format and copy it into every row
+        if (mPatternRow.size() != pDesc->width) {
+            mPatternRow.resize(pDesc->width);
+            for (unsigned col = 0; col < pDesc->width; col++) {
+                mPatternRow[col] = kColors[col * kNumColors / pDesc->width];
+            }
+        }
+
+        uint32_t* row = pixels;
+        for (unsigned i = 0; i < pDesc->height; i++) {
+            memcpy(row, mPatternRow.data(), pDesc->width * sizeof(uint32_t));
+            // Point to the next row
+            // NOTE:  stride retrieved from gralloc is in units of pixels
+            row = row + pDesc->stride;
+        }
+    }
+
+    // Stamp the frame counter
+    uint32_t* row = pixels;
+    for (unsigned i = 0; i < counterHeight; i++) {
+        for (unsigned col = 0; col < counterWidth; col++) {
+            const unsigned bit = kFrameCounterBits - 1 - col / kFrameCounterBlockWidth;
+            row[col] = (mFrameCount >> bit) & 1 ? kColors[0] : kColors[kNumColors - 1];
         }
-        // Point to the next row
-        // NOTE:  stride retrieved from gralloc is in units of pixels
-        pixels = pixels + pDesc->stride;
+        row = row + pDesc->stride;
     }
 
     // Release our output buffer
@@ -711,6 +763,7 @@ void EvsCamera::returnBufferLocked(const uint32_t bufferId, const buffer_handle_
             for (auto&& rec : mBuffers) {
                 if (rec.handle == nullptr) {
                     rec.handle = mBuffers[bufferId].handle;
+                    rec.patternReady = mBuffers[bufferId].patternReady;
                     mBuffers[bufferId].handle = nullptr;
                     break;
                 }
@@ -739,6 +792,7 @@ sp<EvsCamera> EvsCamera::Create(const char* deviceName,
     auto it = camInfo->streamConfigurations.begin();
     evsCamera->mWidth = it->second[1];
     evsCamera->mHeight = it->second[2];
+    evsCamera->mFrameRate = it->second[5] > 0 ? it->second[5] : kDefaultFrameRate;
     evsCamera->mDescription.v1.vendorFlags = 0xFFFFFFFF;  // Arbitrary test value
 
     evsCamera->mFormat = HAL_PIXEL_FORMAT_RGBA_8888;
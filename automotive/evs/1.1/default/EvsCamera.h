@@ -89,7 +89,9 @@ class EvsCamera : public IEvsCamera {
 
     void generateFrames();
     void fillTestFrame(const V1_0::BufferDesc& buff);
-    void fillTestFrame(const BufferDesc& buff);
+    // Stamps the frame counter into the buffer.  The colorbar pattern, which never changes,
+    // is only drawn when drawPattern is set, i.e. the first time a buffer is handed out.
+    void fillTestFrame(const BufferDesc& buff, bool drawPattern = true);
     void returnBufferLocked(const uint32_t bufferId, const buffer_handle_t memHandle);
 
     sp<EvsEnumerator> mEnumerator;  // The enumerator object that created this camera
@@ -98,19 +100,24 @@ class EvsCamera : public IEvsCamera {
 
     std::thread mCaptureThread;  // The thread we'll use to synthesize frames
 
-    uint32_t mWidth = 0;   // Horizontal pixel count in the buffers
-    uint32_t mHeight = 0;  // Vertical pixel count in the buffers
-    uint32_t mFormat = 0;  // Values from android_pixel_format_t
-    uint64_t mUsage = 0;   // Values from from Gralloc.h
-    uint32_t mStride = 0;  // Bytes per line in the buffers
+    uint32_t mWidth = 0;     // Horizontal pixel count in the buffers
+    uint32_t mHeight = 0;    // Vertical pixel count in the buffers
+    uint32_t mFormat = 0;    // Values from android_pixel_format_t
+    uint64_t mUsage = 0;     // Values from from Gralloc.h
+    uint32_t mStride = 0;    // Bytes per line in the buffers
+    int32_t mFrameRate = 0;  // Frames per second to generate
+
+    std::vector<uint32_t> mPatternRow;  // One row of the colorbar pattern, to be copied per row
+    uint32_t mFrameCount = 0;           // Number of frames generated, stamped into each frame
 
     sp<IEvsCameraStream> mStream = nullptr;  // The callback used to deliver each frame
 
     struct BufferRecord {
         buffer_handle_t handle;
         bool inUse;
+        bool patternReady;  // The colorbar pattern has already been drawn into this buffer
 
-        explicit BufferRecord(buffer_handle_t h) : handle(h), inUse(false){};
+        explicit BufferRecord(buffer_handle_t h) : handle(h), inUse(false), patternReady(false){};
     };
 
     std::vector<BufferRecord> mBuffers;  // Graphics buffers to transfer images
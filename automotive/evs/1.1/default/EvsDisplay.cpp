@@ -80,15 +80,17 @@ void EvsDisplay::forceShutdown() {
             ALOGE("EvsDisplay going down while client is holding a buffer");
         }
 
-        // Drop the graphics buffer we've been using
-        GraphicBufferAllocator& alloc(GraphicBufferAllocator::get());
-        alloc.free(mBuffer.memHandle);
-        mBuffer.memHandle = nullptr;
-
+        // Drop the EGLImage wrapping the buffer before the buffer itself
         if (mGlWrapper) {
+            mGlWrapper->releaseImageTexture(mBuffer.bufferId);
             mGlWrapper->hideWindow(mDisplayProxy, mDisplayId);
             mGlWrapper->shutdown();
         }
+
+        // Drop the graphics buffer we've been using
+        GraphicBufferAllocator& alloc(GraphicBufferAllocator::get());
+        alloc.free(mBuffer.memHandle);
+        mBuffer.memHandle = nullptr;
     }
 
     // Put this object into an unrecoverable error state since somebody else
@@ -43,7 +43,8 @@ EvsEnumerator::EvsEnumerator(sp<IAutomotiveDisplayProxyService>& windowService)
     // Add sample camera data to our list of cameras
     // In a real driver, this would be expected to can the available hardware
     sConfigManager =
-            ConfigManager::Create("/vendor/etc/automotive/evs/evs_default_configuration.xml");
+            ConfigManager::Create("/vendor/etc/automotive/evs/evs_default_configuration.xml",
+                                  "/data/vendor/evs/evs_configuration.bin");
 
     // Add available cameras
     for (auto v : sConfigManager->getCameraList()) {
@@ -286,28 +286,14 @@ bool GlWrapper::initialize(const sp<IAutomotiveDisplayProxyService>& service, ui
         return false;
     }
 
-    // Create a GL texture that will eventually wrap our externally created texture surface(s)
-    glGenTextures(1, &mTextureMap);
-    if (mTextureMap <= 0) {
-        LOG(ERROR) << "Didn't get a texture handle allocated: " << getEGLError();
-        return false;
-    }
-
-    // Turn off mip-mapping for the created texture surface
-    // (the inbound camera imagery doesn't have MIPs)
-    glBindTexture(GL_TEXTURE_2D, mTextureMap);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
+    // GL textures wrapping our externally created texture surface(s) are created as buffers
+    // arrive in updateImageTexture()
     return true;
 }
 
 void GlWrapper::shutdown() {
     // Drop our device textures
-    if (mKHRimage != EGL_NO_IMAGE_KHR) {
-        eglDestroyImageKHR(mDisplay, mKHRimage);
-        mKHRimage = EGL_NO_IMAGE_KHR;
-    }
+    releaseImageTextures();
 
     // Release all GL resources
     eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
@@ -342,7 +328,9 @@ bool GlWrapper::updateImageTexture(const V1_0::BufferDesc& buffer) {
     BufferDesc newBuffer = {
             .buffer =
                     {
-                            .nativeHandle = buffer.memHandle,
+                            // Wraps the handle without cloning it; newBuffer does not outlive
+                            // this call.
+                            .nativeHandle = buffer.memHandle.getNativeHandle(),
                     },
             .pixelSize = buffer.pixelSize,
             .bufferId = buffer.bufferId,
@@ -360,41 +348,89 @@ bool GlWrapper::updateImageTexture(const V1_0::BufferDesc& buffer) {
 }
 
 bool GlWrapper::updateImageTexture(const BufferDesc& aFrame) {
+    ImageTexture& imageTexture = mImageTextures[aFrame.bufferId];
+
     // If we haven't done it yet, create an "image" object to wrap the gralloc buffer
-    if (mKHRimage == EGL_NO_IMAGE_KHR) {
-        // create a temporary GraphicBuffer to wrap the provided handle
-        const AHardwareBuffer_Desc* pDesc =
-                reinterpret_cast<const AHardwareBuffer_Desc*>(&aFrame.buffer.description);
-        sp<GraphicBuffer> pGfxBuffer = new GraphicBuffer(
-                pDesc->width, pDesc->height, pDesc->format, pDesc->layers, pDesc->usage,
-                pDesc->stride,
-                const_cast<native_handle_t*>(aFrame.buffer.nativeHandle.getNativeHandle()),
-                false /* keep ownership */
-        );
-        if (pGfxBuffer.get() == nullptr) {
-            LOG(ERROR) << "Failed to allocate GraphicBuffer to wrap our native handle";
-            return false;
-        }
+    if (imageTexture.image == EGL_NO_IMAGE_KHR && !createImageTexture(aFrame, &imageTexture)) {
+        mImageTextures.erase(aFrame.bufferId);
+        return false;
+    }
 
-        // Get a GL compatible reference to the graphics buffer we've been given
-        EGLint eglImageAttributes[] = {EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE};
-        EGLClientBuffer cbuf = static_cast<EGLClientBuffer>(pGfxBuffer->getNativeBuffer());
-        mKHRimage = eglCreateImageKHR(mDisplay, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID, cbuf,
-                                      eglImageAttributes);
-        if (mKHRimage == EGL_NO_IMAGE_KHR) {
-            LOG(ERROR) << "Error creating EGLImage: " << getEGLError();
-            return false;
-        }
+    mTextureMap = imageTexture.texture;
+    return true;
+}
 
-        // Update the texture handle we already created to refer to this gralloc buffer
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, mTextureMap);
-        glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(mKHRimage));
+bool GlWrapper::createImageTexture(const BufferDesc& aFrame, ImageTexture* imageTexture) {
+    // create a temporary GraphicBuffer to wrap the provided handle
+    const AHardwareBuffer_Desc* pDesc =
+            reinterpret_cast<const AHardwareBuffer_Desc*>(&aFrame.buffer.description);
+    sp<GraphicBuffer> pGfxBuffer = new GraphicBuffer(
+            pDesc->width, pDesc->height, pDesc->format, pDesc->layers, pDesc->usage,
+            pDesc->stride,
+            const_cast<native_handle_t*>(aFrame.buffer.nativeHandle.getNativeHandle()),
+            false /* keep ownership */
+    );
+    if (pGfxBuffer.get() == nullptr) {
+        LOG(ERROR) << "Failed to allocate GraphicBuffer to wrap our native handle";
+        return false;
     }
 
+    // Get a GL compatible reference to the graphics buffer we've been given
+    EGLint eglImageAttributes[] = {EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE};
+    EGLClientBuffer cbuf = static_cast<EGLClientBuffer>(pGfxBuffer->getNativeBuffer());
+    EGLImageKHR image = eglCreateImageKHR(mDisplay, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID,
+                                          cbuf, eglImageAttributes);
+    if (image == EGL_NO_IMAGE_KHR) {
+        LOG(ERROR) << "Error creating EGLImage: " << getEGLError();
+        return false;
+    }
+
+    // Create a GL texture that wraps this gralloc buffer
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    if (texture <= 0) {
+        LOG(ERROR) << "Didn't get a texture handle allocated: " << getEGLError();
+        eglDestroyImageKHR(mDisplay, image);
+        return false;
+    }
+
+    // Turn off mip-mapping for the created texture surface
+    // (the inbound camera imagery doesn't have MIPs)
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(image));
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    imageTexture->image = image;
+    imageTexture->texture = texture;
     return true;
 }
 
+void GlWrapper::destroyImageTexture(ImageTexture* imageTexture) {
+    if (imageTexture->texture == mTextureMap) {
+        mTextureMap = 0;
+    }
+    glDeleteTextures(1, &imageTexture->texture);
+    eglDestroyImageKHR(mDisplay, imageTexture->image);
+    *imageTexture = {};
+}
+
+void GlWrapper::releaseImageTexture(uint32_t bufferId) {
+    auto it = mImageTextures.find(bufferId);
+    if (it != mImageTextures.end()) {
+        destroyImageTexture(&it->second);
+        mImageTextures.erase(it);
+    }
+}
+
+void GlWrapper::releaseImageTextures() {
+    for (auto& [id, imageTexture] : mImageTextures) {
+        destroyImageTexture(&imageTexture);
+    }
+    mImageTextures.clear();
+}
+
 void GlWrapper::renderImageToScreen() {
     // Set the viewport
     glViewport(0, 0, mWidth, mHeight);
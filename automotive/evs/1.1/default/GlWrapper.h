@@ -29,6 +29,8 @@
 #include <GLES3/gl3.h>
 #include <GLES3/gl3ext.h>
 
+#include <unordered_map>
+
 namespace android::hardware::automotive::evs::V1_1::implementation {
 
 using frameworks::automotive::display::V1_0::IAutomotiveDisplayProxyService;
@@ -40,10 +42,19 @@ class GlWrapper {
     bool initialize(const sp<IAutomotiveDisplayProxyService>& service, uint64_t displayId);
     void shutdown();
 
+    // Selects the texture backed by a given buffer for the next renderImageToScreen() call.  An
+    // EGLImage and a texture are created the first time a buffer id is seen and reused afterwards,
+    // until the id is released.
     bool updateImageTexture(const V1_0::BufferDesc& buffer);
     bool updateImageTexture(const BufferDesc& buffer);
     void renderImageToScreen();
 
+    // Drops the EGLImage and texture of a buffer id; this must be called before the buffer is
+    // freed or its id is reused for another buffer.
+    void releaseImageTexture(uint32_t bufferId);
+    // Drops the EGLImages and textures of all buffers seen so far.
+    void releaseImageTextures();
+
     void showWindow(sp<IAutomotiveDisplayProxyService>& service, uint64_t id);
     void hideWindow(sp<IAutomotiveDisplayProxyService>& service, uint64_t id);
 
@@ -60,11 +71,22 @@ class GlWrapper {
     unsigned mWidth = 0;
     unsigned mHeight = 0;
 
-    EGLImageKHR mKHRimage = EGL_NO_IMAGE_KHR;
+    // An EGLImage wrapping a gralloc buffer, and the texture bound to it
+    struct ImageTexture {
+        EGLImageKHR image = EGL_NO_IMAGE_KHR;
+        GLuint texture = 0;
+    };
 
+    // Cached textures keyed by buffer id
+    std::unordered_map<uint32_t, ImageTexture> mImageTextures;
+
+    // Texture selected by the last updateImageTexture() call
     GLuint mTextureMap = 0;
     GLuint mShaderProgram = 0;
 
+    bool createImageTexture(const BufferDesc& buffer, ImageTexture* imageTexture);
+    void destroyImageTexture(ImageTexture* imageTexture);
+
     // Opaque handle for a native hardware buffer defined in
     // frameworks/native/opengl/include/EGL/eglplatform.h
     ANativeWindow* mWindow;
@@ -18,11 +18,25 @@
 #define android_hardware_automotive_evs_aidl_impl_evshal_include_DefaultEvsHal_H_
 
 #include <aidl/android/hardware/automotive/evs/BnEvsEnumerator.h>
+#include <android-base/thread_annotations.h>
+
+#include <EvsMockCamera.h>
+#include <EvsMockDisplay.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace aidl::android::hardware::automotive::evs::implementation {
 
+// Enumerates the cameras of a built-in configuration, which stream a synthetic pattern, and a
+// display without a screen.
 class DefaultEvsEnumerator final
     : public ::aidl::android::hardware::automotive::evs::BnEvsEnumerator {
+  public:
+    DefaultEvsEnumerator();
+
     ::ndk::ScopedAStatus isHardware(bool* flag) override;
     ::ndk::ScopedAStatus openCamera(
             const std::string& cameraId,
@@ -59,6 +73,22 @@ class DefaultEvsEnumerator final
     ::ndk::ScopedAStatus getUltrasonicsArrayList(
             std::vector<::aidl::android::hardware::automotive::evs::UltrasonicsArrayDesc>* list)
             override;
+
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+  private:
+    struct CameraRecord {
+        ::aidl::android::hardware::automotive::evs::CameraDesc desc;
+        std::vector<::aidl::android::hardware::automotive::evs::Stream> streams;
+        // The camera opened by the last client, if it is still alive
+        std::weak_ptr<EvsMockCamera> activeInstance;
+    };
+
+    std::mutex mMutex;
+    std::unordered_map<std::string, CameraRecord> mCameras GUARDED_BY(mMutex);
+    std::weak_ptr<EvsMockDisplay> mActiveDisplay GUARDED_BY(mMutex);
+    std::shared_ptr<::aidl::android::hardware::automotive::evs::IEvsEnumeratorStatusCallback>
+            mStatusCallback GUARDED_BY(mMutex);
 };
 
 }  // namespace aidl::android::hardware::automotive::evs::implementation
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_evs_aidl_impl_evshal_include_EvsMockCamera_H_
+#define android_hardware_automotive_evs_aidl_impl_evshal_include_EvsMockCamera_H_
+
+#include <aidl/android/hardware/automotive/evs/BnEvsCamera.h>
+#include <aidl/android/hardware/automotive/evs/BufferDesc.h>
+#include <aidl/android/hardware/automotive/evs/CameraDesc.h>
+#include <aidl/android/hardware/automotive/evs/IEvsCameraStream.h>
+#include <aidl/android/hardware/automotive/evs/Stream.h>
+#include <android-base/thread_annotations.h>
+#include <android/hardware_buffer.h>
+
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace aidl::android::hardware::automotive::evs::implementation {
+
+// A camera streaming a synthetic colorbar at the rate of its stream configuration. Frames are
+// delivered as handles of buffers that are allocated, or imported, once; the pattern is drawn
+// into each buffer the first time it is handed out and only the frame counter is stamped after
+// that, so no frame is copied on its way to the client.
+class EvsMockCamera final : public BnEvsCamera {
+  public:
+    // Statistics of a video stream, reset by startVideoStream()
+    struct StreamStats {
+        uint64_t framesDelivered = 0;
+        uint64_t framesReturned = 0;
+        // Frames skipped because the client held every buffer, or the delivery failed
+        uint64_t framesDropped = 0;
+        // Time from the delivery of a frame to its doneWithFrame()
+        int64_t returnLatencySumNs = 0;
+        int64_t returnLatencyMaxNs = 0;
+        // Time spent in the deliverFrame() transaction
+        int64_t deliverSumNs = 0;
+        int64_t deliverMaxNs = 0;
+    };
+
+    EvsMockCamera(const CameraDesc& desc, const Stream& streamConfig);
+    ~EvsMockCamera() override;
+
+    // Methods from ::aidl::android::hardware::automotive::evs::IEvsCamera follow.
+    ::ndk::ScopedAStatus doneWithFrame(const std::vector<BufferDesc>& buffers) override;
+    ::ndk::ScopedAStatus forcePrimaryClient(
+            const std::shared_ptr<IEvsDisplay>& display) override;
+    ::ndk::ScopedAStatus getCameraInfo(CameraDesc* _aidl_return) override;
+    ::ndk::ScopedAStatus getExtendedInfo(int32_t opaqueIdentifier,
+                                         std::vector<uint8_t>* value) override;
+    ::ndk::ScopedAStatus getIntParameter(CameraParam id, std::vector<int32_t>* value) override;
+    ::ndk::ScopedAStatus getIntParameterRange(CameraParam id,
+                                              ParameterRange* _aidl_return) override;
+    ::ndk::ScopedAStatus getParameterList(std::vector<CameraParam>* _aidl_return) override;
+    ::ndk::ScopedAStatus getPhysicalCameraInfo(const std::string& deviceId,
+                                               CameraDesc* _aidl_return) override;
+    ::ndk::ScopedAStatus importExternalBuffers(const std::vector<BufferDesc>& buffers,
+                                               int32_t* _aidl_return) override;
+    ::ndk::ScopedAStatus pauseVideoStream() override;
+    ::ndk::ScopedAStatus resumeVideoStream() override;
+    ::ndk::ScopedAStatus setExtendedInfo(int32_t opaqueIdentifier,
+                                         const std::vector<uint8_t>& opaqueValue) override;
+    ::ndk::ScopedAStatus setIntParameter(CameraParam id, int32_t value,
+                                         std::vector<int32_t>* effectiveValue) override;
+    ::ndk::ScopedAStatus setPrimaryClient() override;
+    ::ndk::ScopedAStatus setMaxFramesInFlight(int32_t bufferCount) override;
+    ::ndk::ScopedAStatus startVideoStream(
+            const std::shared_ptr<IEvsCameraStream>& receiver) override;
+    ::ndk::ScopedAStatus stopVideoStream() override;
+    ::ndk::ScopedAStatus unsetPrimaryClient() override;
+
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+    // Stops the stream and releases every buffer; all calls fail with OWNERSHIP_LOST afterwards.
+    // Called when the camera is closed or opened by another client.
+    void shutdown();
+
+    const CameraDesc& getDesc() const { return mDesc; }
+    StreamStats getStreamStats() const;
+
+  private:
+    enum StreamState { STOPPED, RUNNING, STOPPING, DEAD };
+
+    struct BufferRecord {
+        // nullptr for free slots
+        AHardwareBuffer* buffer = nullptr;
+        bool inUse = false;
+        // Whether the colorbar has been drawn into the buffer yet
+        bool patternReady = false;
+        bool external = false;
+        // elapsedRealtimeNano() of the last delivery
+        int64_t deliveredNs = 0;
+    };
+
+    void generateFrames();
+    // Draws the colorbar if asked to, and stamps the frame counter. Called without mMutex; the
+    // buffer is owned by the frame thread until it is delivered.
+    void fillTestFrame(AHardwareBuffer* buffer, bool drawPattern, uint32_t frameCount);
+    BufferDesc makeBufferDesc(AHardwareBuffer* buffer, int32_t bufferId) const;
+
+    bool setAvailableFramesLocked(unsigned bufferCount) REQUIRES(mMutex);
+    unsigned increaseAvailableFramesLocked(unsigned numToAdd) REQUIRES(mMutex);
+    unsigned decreaseAvailableFramesLocked(unsigned numToRemove) REQUIRES(mMutex);
+    // Returns the index of a free slot of mBuffers, appending one if there is none
+    size_t getFreeSlotLocked() REQUIRES(mMutex);
+    void returnBufferLocked(int32_t bufferId) REQUIRES(mMutex);
+    void logStreamStatsLocked() const REQUIRES(mMutex);
+
+    const CameraDesc mDesc;
+    const Stream mStreamConfig;
+    const uint64_t mUsage;
+
+    // Reused by fillTestFrame(), which only runs on the frame thread
+    std::vector<uint32_t> mPatternRow;
+
+    mutable std::mutex mMutex;
+    std::vector<BufferRecord> mBuffers GUARDED_BY(mMutex);
+    unsigned mFramesAllowed GUARDED_BY(mMutex) = 0;
+    unsigned mFramesInUse GUARDED_BY(mMutex) = 0;
+    uint32_t mFrameCount GUARDED_BY(mMutex) = 0;
+    StreamState mStreamState GUARDED_BY(mMutex) = STOPPED;
+    bool mPaused GUARDED_BY(mMutex) = false;
+    std::shared_ptr<IEvsCameraStream> mStream GUARDED_BY(mMutex);
+    std::thread mCaptureThread GUARDED_BY(mMutex);
+    StreamStats mStats GUARDED_BY(mMutex);
+    std::unordered_map<int32_t, std::vector<uint8_t>> mExtInfo GUARDED_BY(mMutex);
+};
+
+}  // namespace aidl::android::hardware::automotive::evs::implementation
+
+#endif  // android_hardware_automotive_evs_aidl_impl_evshal_include_EvsMockCamera_H_
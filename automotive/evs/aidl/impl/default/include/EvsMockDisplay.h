@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_evs_aidl_impl_evshal_include_EvsMockDisplay_H_
+#define android_hardware_automotive_evs_aidl_impl_evshal_include_EvsMockDisplay_H_
+
+#include <aidl/android/hardware/automotive/evs/BnEvsDisplay.h>
+#include <aidl/android/hardware/automotive/evs/BufferDesc.h>
+#include <aidl/android/hardware/automotive/evs/DisplayDesc.h>
+#include <aidl/android/hardware/automotive/evs/DisplayState.h>
+#include <android-base/thread_annotations.h>
+#include <android/hardware_buffer.h>
+
+#include <mutex>
+
+namespace aidl::android::hardware::automotive::evs::implementation {
+
+// A display without a screen: it hands out a single target buffer and runs the display state
+// machine, counting the frames returned for display instead of presenting them.
+class EvsMockDisplay final : public BnEvsDisplay {
+  public:
+    explicit EvsMockDisplay(const DisplayDesc& desc);
+    ~EvsMockDisplay() override;
+
+    // Methods from ::aidl::android::hardware::automotive::evs::IEvsDisplay follow.
+    ::ndk::ScopedAStatus getDisplayInfo(DisplayDesc* _aidl_return) override;
+    ::ndk::ScopedAStatus getDisplayState(DisplayState* _aidl_return) override;
+    ::ndk::ScopedAStatus getTargetBuffer(BufferDesc* _aidl_return) override;
+    ::ndk::ScopedAStatus returnTargetBufferForDisplay(const BufferDesc& buffer) override;
+    ::ndk::ScopedAStatus setDisplayState(DisplayState state) override;
+
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+    // Releases the target buffer; all calls fail with OWNERSHIP_LOST afterwards. Called when the
+    // display is closed or opened by another client.
+    void forceShutdown();
+
+  private:
+    const DisplayDesc mDesc;
+
+    std::mutex mMutex;
+    DisplayState mRequestedState GUARDED_BY(mMutex) = DisplayState::NOT_VISIBLE;
+    // Allocated on the first getTargetBuffer() call
+    AHardwareBuffer* mBuffer GUARDED_BY(mMutex) = nullptr;
+    bool mFrameBusy GUARDED_BY(mMutex) = false;
+    uint64_t mFramesDisplayed GUARDED_BY(mMutex) = 0;
+};
+
+}  // namespace aidl::android::hardware::automotive::evs::implementation
+
+#endif  // android_hardware_automotive_evs_aidl_impl_evshal_include_EvsMockDisplay_H_
@@ -14,18 +14,108 @@
  * limitations under the License.
  */
 
-// TODO(b/203661081): Remove below lines to disable compiler warnings.
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wunused-parameter"
-
 #define LOG_TAG "DefaultEvsEnumerator"
 
 #include <DefaultEvsEnumerator.h>
 
-namespace aidl::android::hardware::automotive::evs::implementation {
+#include <aidl/android/hardware/automotive/evs/EvsResult.h>
+#include <android-base/logging.h>
+#include <system/camera_metadata.h>
+
+#include <cstdio>
 
+namespace {
+
+using ::aidl::android::graphics::common::BufferUsage;
+using ::aidl::android::graphics::common::PixelFormat;
+using ::aidl::android::hardware::automotive::evs::CameraDesc;
+using ::aidl::android::hardware::automotive::evs::DisplayDesc;
+using ::aidl::android::hardware::automotive::evs::EvsResult;
+using ::aidl::android::hardware::automotive::evs::Rotation;
+using ::aidl::android::hardware::automotive::evs::Stream;
+using ::aidl::android::hardware::automotive::evs::StreamType;
 using ::ndk::ScopedAStatus;
 
+// The only display; its id is also its port
+constexpr uint8_t kDisplayId = 0;
+
+// One stream configuration of a camera, matching the evs_default_configuration.xml of the HIDL
+// sample so the two implementations can be compared
+constexpr struct {
+    const char* cameraId;
+    int32_t width;
+    int32_t height;
+    PixelFormat format;
+    int32_t framerate;
+} kCameraStreams[] = {
+        {"/dev/video10", 640, 360, PixelFormat::RGBA_8888, 30},
+};
+
+constexpr struct {
+    const char* id;
+    int32_t width;
+    int32_t height;
+} kDisplay = {"display0", 1280, 720};
+
+ScopedAStatus toScopedAStatus(EvsResult result) {
+    return ScopedAStatus::fromServiceSpecificError(static_cast<int>(result));
+}
+
+// Describes the stream configurations in camera metadata, the way clients look them up:
+// {id, width, height, format, direction, framerate} per configuration.
+std::vector<uint8_t> makeCameraMetadata(const std::vector<Stream>& streams) {
+    std::vector<int32_t> configs;
+    for (const auto& stream : streams) {
+        configs.insert(configs.end(),
+                       {stream.id, stream.width, stream.height,
+                        static_cast<int32_t>(stream.format),
+                        ANDROID_SCALER_AVAILABLE_STREAM_CONFIGURATIONS_OUTPUT, stream.framerate});
+    }
+
+    camera_metadata_t* metadata =
+            allocate_camera_metadata(/* entry_capacity= */ 1, configs.size() * sizeof(int32_t));
+    if (metadata == nullptr) {
+        LOG(ERROR) << "Failed to allocate camera metadata";
+        return {};
+    }
+    if (add_camera_metadata_entry(metadata, ANDROID_SCALER_AVAILABLE_STREAM_CONFIGURATIONS,
+                                  configs.data(), configs.size()) != 0) {
+        LOG(ERROR) << "Failed to add the stream configurations to camera metadata";
+        free_camera_metadata(metadata);
+        return {};
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(metadata);
+    std::vector<uint8_t> bytes(data, data + get_camera_metadata_size(metadata));
+    free_camera_metadata(metadata);
+    return bytes;
+}
+
+}  // namespace
+
+namespace aidl::android::hardware::automotive::evs::implementation {
+
+DefaultEvsEnumerator::DefaultEvsEnumerator() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto& config : kCameraStreams) {
+        CameraRecord& record = mCameras[config.cameraId];
+        Stream stream;
+        stream.id = static_cast<int32_t>(record.streams.size());
+        stream.streamType = StreamType::OUTPUT;
+        stream.width = config.width;
+        stream.height = config.height;
+        stream.framerate = config.framerate;
+        stream.format = config.format;
+        stream.usage = BufferUsage::CAMERA_OUTPUT;
+        stream.rotation = Rotation::ROTATION_0;
+        record.streams.push_back(stream);
+    }
+    for (auto& [id, record] : mCameras) {
+        record.desc.id = id;
+        record.desc.metadata = makeCameraMetadata(record.streams);
+    }
+}
+
 ScopedAStatus DefaultEvsEnumerator::isHardware(bool* flag) {
     // This returns true always.
     *flag = true;
@@ -35,59 +125,187 @@ ScopedAStatus DefaultEvsEnumerator::isHardware(bool* flag) {
 ScopedAStatus DefaultEvsEnumerator::openCamera(const std::string& cameraId,
                                                const Stream& streamConfig,
                                                std::shared_ptr<IEvsCamera>* obj) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const auto it = mCameras.find(cameraId);
+    if (it == mCameras.end()) {
+        LOG(ERROR) << cameraId << " does not exist.";
+        return toScopedAStatus(EvsResult::INVALID_ARG);
+    }
+    CameraRecord& record = it->second;
+
+    // Use the requested configuration if it is one of ours, and the first one otherwise
+    const Stream* stream = &record.streams.front();
+    for (const auto& candidate : record.streams) {
+        if (candidate.width == streamConfig.width && candidate.height == streamConfig.height &&
+            candidate.format == streamConfig.format) {
+            stream = &candidate;
+            break;
+        }
+    }
+    if (stream->width != streamConfig.width || stream->height != streamConfig.height) {
+        LOG(WARNING) << "Requested stream configuration is not supported by " << cameraId
+                     << "; using " << stream->width << "x" << stream->height;
+    }
+
+    // Has this camera already been instantiated by another caller?
+    if (auto active = record.activeInstance.lock()) {
+        LOG(WARNING) << "Killing previous camera because of new caller";
+        active->shutdown();
+    }
+
+    auto camera = ::ndk::SharedRefBase::make<EvsMockCamera>(record.desc, *stream);
+    record.activeInstance = camera;
+    *obj = camera;
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus DefaultEvsEnumerator::closeCamera(const std::shared_ptr<IEvsCamera>& obj) {
+    if (!obj) {
+        LOG(ERROR) << "Ignoring call to closeCamera with null camera ptr";
+        return toScopedAStatus(EvsResult::INVALID_ARG);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& [id, record] : mCameras) {
+        auto active = record.activeInstance.lock();
+        if (active != nullptr && active.get() == obj.get()) {
+            active->shutdown();
+            record.activeInstance.reset();
+            return ScopedAStatus::ok();
+        }
+    }
+
+    // The camera was replaced by another client, which already shut it down
+    LOG(WARNING) << "Ignoring close of previously orphaned camera";
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus DefaultEvsEnumerator::getCameraList(std::vector<CameraDesc>* list) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    list->clear();
+    for (const auto& [id, record] : mCameras) {
+        list->push_back(record.desc);
+    }
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus DefaultEvsEnumerator::getStreamList(const CameraDesc& desc,
                                                   std::vector<Stream>* _aidl_return) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const auto it = mCameras.find(desc.id);
+    if (it == mCameras.end()) {
+        return toScopedAStatus(EvsResult::INVALID_ARG);
+    }
+    *_aidl_return = it->second.streams;
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus DefaultEvsEnumerator::openDisplay(int32_t displayId,
                                                 std::shared_ptr<IEvsDisplay>* obj) {
+    if (displayId != kDisplayId) {
+        LOG(ERROR) << "Display " << displayId << " does not exist.";
+        return toScopedAStatus(EvsResult::INVALID_ARG);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    // If we already have a display active, then we need to shut it down so we can
+    // give exclusive access to the new caller.
+    if (auto active = mActiveDisplay.lock()) {
+        LOG(WARNING) << "Killing previous display because of new caller";
+        active->forceShutdown();
+    }
+
+    DisplayDesc desc;
+    desc.id = kDisplay.id;
+    desc.width = kDisplay.width;
+    desc.height = kDisplay.height;
+    desc.orientation = Rotation::ROTATION_0;
+    auto display = ::ndk::SharedRefBase::make<EvsMockDisplay>(desc);
+    mActiveDisplay = display;
+    *obj = display;
     return ScopedAStatus::ok();
 }
 
-ScopedAStatus DefaultEvsEnumerator::closeDisplay(const std::shared_ptr<IEvsDisplay>& state) {
+ScopedAStatus DefaultEvsEnumerator::closeDisplay(const std::shared_ptr<IEvsDisplay>& obj) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto active = mActiveDisplay.lock();
+    if (active == nullptr || active.get() != obj.get()) {
+        LOG(WARNING) << "Ignoring close of a display that is not active";
+        return ScopedAStatus::ok();
+    }
+
+    active->forceShutdown();
+    mActiveDisplay.reset();
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus DefaultEvsEnumerator::getDisplayIdList(std::vector<uint8_t>* list) {
+    *list = {kDisplayId};
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus DefaultEvsEnumerator::getDisplayState(DisplayState* state) {
-    return ScopedAStatus::ok();
+    std::shared_ptr<EvsMockDisplay> active;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        active = mActiveDisplay.lock();
+    }
+    if (active == nullptr) {
+        *state = DisplayState::NOT_OPEN;
+        return ScopedAStatus::ok();
+    }
+    return active->getDisplayState(state);
 }
 
 ScopedAStatus DefaultEvsEnumerator::registerStatusCallback(
         const std::shared_ptr<IEvsEnumeratorStatusCallback>& callback) {
+    // The built-in cameras never come and go, so there is no status to report yet
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStatusCallback = callback;
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus DefaultEvsEnumerator::openUltrasonicsArray(
         const std::string& id, std::shared_ptr<IEvsUltrasonicsArray>* obj) {
-    return ScopedAStatus::ok();
+    LOG(ERROR) << "Ultrasonics array " << id << " does not exist.";
+    *obj = nullptr;
+    return toScopedAStatus(EvsResult::NOT_SUPPORTED);
 }
 
 ScopedAStatus DefaultEvsEnumerator::closeUltrasonicsArray(
-        const std::shared_ptr<IEvsUltrasonicsArray>& obj) {
-    return ScopedAStatus::ok();
+        const std::shared_ptr<IEvsUltrasonicsArray>&) {
+    return toScopedAStatus(EvsResult::NOT_SUPPORTED);
 }
 
 ScopedAStatus DefaultEvsEnumerator::getUltrasonicsArrayList(
         std::vector<UltrasonicsArrayDesc>* list) {
+    list->clear();
     return ScopedAStatus::ok();
 }
 
-}  // namespace aidl::android::hardware::automotive::evs::implementation
+binder_status_t DefaultEvsEnumerator::dump(int fd, const char** args, uint32_t numArgs) {
+    std::vector<std::shared_ptr<EvsMockCamera>> cameras;
+    std::shared_ptr<EvsMockDisplay> display;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        dprintf(fd, "%zu cameras, status callback %sregistered\n", mCameras.size(),
+                mStatusCallback ? "" : "not ");
+        for (const auto& [id, record] : mCameras) {
+            if (auto active = record.activeInstance.lock()) {
+                cameras.push_back(std::move(active));
+            }
+        }
+        display = mActiveDisplay.lock();
+    }
+
+    // The cameras and the display take their own locks
+    for (const auto& camera : cameras) {
+        camera->dump(fd, args, numArgs);
+    }
+    if (display != nullptr) {
+        display->dump(fd, args, numArgs);
+    }
+    return STATUS_OK;
+}
 
-#pragma clang diagnostic pop
+}  // namespace aidl::android::hardware::automotive::evs::implementation
@@ -0,0 +1,693 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EvsMockCamera"
+
+#include <EvsMockCamera.h>
+
+#include <aidl/android/hardware/automotive/evs/EvsEventDesc.h>
+#include <aidl/android/hardware/automotive/evs/EvsResult.h>
+#include <aidlcommonsupport/NativeHandle.h>
+#include <android-base/logging.h>
+#include <utils/SystemClock.h>
+#include <vndk/hardware_buffer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+using ::aidl::android::graphics::common::BufferUsage;
+using ::aidl::android::graphics::common::PixelFormat;
+using ::aidl::android::hardware::automotive::evs::EvsResult;
+using ::ndk::ScopedAStatus;
+
+// Arbitrary limit on number of graphics buffers allowed to be allocated
+// Safeguards against unreasonable resource consumption and provides a testable limit
+constexpr unsigned kMaxBuffersInFlight = 100;
+
+// Minimum number of buffers to run a video stream
+constexpr unsigned kMinimumBuffersInFlight = 1;
+
+// Frame rate used when the stream configuration does not specify one
+constexpr int32_t kDefaultFrameRate = 15;
+
+// Usage added to that of the stream configuration; the pattern is drawn by the CPU, and clients
+// may read or texture from the frames
+constexpr uint64_t kDefaultUsage = static_cast<uint64_t>(BufferUsage::CPU_WRITE_OFTEN) |
+                                   static_cast<uint64_t>(BufferUsage::CPU_READ_OFTEN) |
+                                   static_cast<uint64_t>(BufferUsage::GPU_TEXTURE);
+
+// Colors for the colorbar test pattern in ABGR format
+constexpr uint32_t kColors[] = {
+        0xFFFFFFFF,  // white
+        0xFF00FFFF,  // yellow
+        0xFFFFFF00,  // cyan
+        0xFF00FF00,  // green
+        0xFFFF00FF,  // fuchsia
+        0xFF0000FF,  // red
+        0xFFFF0000,  // blue
+        0xFF000000,  // black
+};
+constexpr uint32_t kNumColors = sizeof(kColors) / sizeof(kColors[0]);
+
+// The frame counter is stamped into the top-left corner of every frame as one block per bit,
+// most significant bit first; white blocks are ones and black blocks are zeros.
+constexpr unsigned kFrameCounterBits = 32;
+constexpr unsigned kFrameCounterBlockWidth = 8;
+constexpr unsigned kFrameCounterBlockHeight = 8;
+
+ScopedAStatus toScopedAStatus(EvsResult result) {
+    return ScopedAStatus::fromServiceSpecificError(static_cast<int>(result));
+}
+
+bool is32BitFormat(uint32_t format) {
+    switch (static_cast<PixelFormat>(format)) {
+        case PixelFormat::RGBA_8888:
+        case PixelFormat::RGBX_8888:
+        case PixelFormat::BGRA_8888:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int32_t getPixelSizeBytes(uint32_t format) {
+    if (is32BitFormat(format)) {
+        return 4;
+    }
+    switch (static_cast<PixelFormat>(format)) {
+        case PixelFormat::RGB_888:
+            return 3;
+        case PixelFormat::RGB_565:
+        case PixelFormat::YCBCR_422_I:
+            return 2;
+        default:
+            // Planar and semi-planar YUV formats
+            return 1;
+    }
+}
+
+}  // namespace
+
+namespace aidl::android::hardware::automotive::evs::implementation {
+
+EvsMockCamera::EvsMockCamera(const CameraDesc& desc, const Stream& streamConfig)
+    : mDesc(desc),
+      mStreamConfig(streamConfig),
+      mUsage(static_cast<uint64_t>(streamConfig.usage) | kDefaultUsage) {
+    LOG(DEBUG) << "Created camera " << mDesc.id << " streaming " << mStreamConfig.width << "x"
+               << mStreamConfig.height << " at " << mStreamConfig.framerate << " fps";
+}
+
+EvsMockCamera::~EvsMockCamera() {
+    shutdown();
+}
+
+void EvsMockCamera::shutdown() {
+    stopVideoStream();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStreamState == DEAD) {
+        return;
+    }
+
+    // Buffers held by the client stay valid for it; it owns its copies of their handles
+    for (auto& record : mBuffers) {
+        if (record.buffer != nullptr) {
+            AHardwareBuffer_release(record.buffer);
+        }
+    }
+    mBuffers.clear();
+    mFramesAllowed = 0;
+    mFramesInUse = 0;
+    mStreamState = DEAD;
+    LOG(DEBUG) << "Camera " << mDesc.id << " is shut down";
+}
+
+EvsMockCamera::StreamStats EvsMockCamera::getStreamStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+ScopedAStatus EvsMockCamera::doneWithFrame(const std::vector<BufferDesc>& buffers) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto& buffer : buffers) {
+        returnBufferLocked(buffer.bufferId);
+    }
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::forcePrimaryClient(const std::shared_ptr<IEvsDisplay>&) {
+    // Only the camera manager arbitrates between clients; a camera has a single client here
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::getCameraInfo(CameraDesc* _aidl_return) {
+    *_aidl_return = mDesc;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::getExtendedInfo(int32_t opaqueIdentifier,
+                                             std::vector<uint8_t>* value) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const auto it = mExtInfo.find(opaqueIdentifier);
+    if (it == mExtInfo.end()) {
+        value->clear();
+    } else {
+        *value = it->second;
+    }
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::getIntParameter(CameraParam, std::vector<int32_t>*) {
+    return toScopedAStatus(EvsResult::NOT_SUPPORTED);
+}
+
+ScopedAStatus EvsMockCamera::getIntParameterRange(CameraParam, ParameterRange*) {
+    return toScopedAStatus(EvsResult::NOT_SUPPORTED);
+}
+
+ScopedAStatus EvsMockCamera::getParameterList(std::vector<CameraParam>* _aidl_return) {
+    // The synthetic pattern has no adjustable parameters
+    _aidl_return->clear();
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::getPhysicalCameraInfo(const std::string&,
+                                                   CameraDesc* _aidl_return) {
+    // This camera is its own and only physical device
+    *_aidl_return = mDesc;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::importExternalBuffers(const std::vector<BufferDesc>& buffers,
+                                                   int32_t* _aidl_return) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStreamState == DEAD) {
+        LOG(ERROR) << "Ignoring importExternalBuffers call when camera has been lost.";
+        return toScopedAStatus(EvsResult::OWNERSHIP_LOST);
+    }
+
+    size_t numBuffersToAdd = buffers.size();
+    if (numBuffersToAdd > kMaxBuffersInFlight - mFramesAllowed) {
+        numBuffersToAdd = kMaxBuffersInFlight - mFramesAllowed;
+        LOG(WARNING) << "Exceeded the limit on the number of buffers; only " << numBuffersToAdd
+                     << " buffers will be imported.";
+    }
+
+    int32_t numBuffersAdded = 0;
+    for (size_t i = 0; i < numBuffersToAdd; ++i) {
+        const auto& description = buffers[i].buffer.description;
+        if (description.width != mStreamConfig.width ||
+            description.height != mStreamConfig.height ||
+            description.format != mStreamConfig.format) {
+            LOG(WARNING) << "Buffer " << buffers[i].bufferId
+                         << " does not match the stream configuration; skipping it.";
+            continue;
+        }
+
+        const AHardwareBuffer_Desc desc = {
+                static_cast<uint32_t>(description.width),
+                static_cast<uint32_t>(description.height),
+                static_cast<uint32_t>(description.layers),
+                static_cast<uint32_t>(description.format),
+                static_cast<uint64_t>(description.usage),
+                static_cast<uint32_t>(description.stride),
+                0,
+                0,
+        };
+        // The clone takes its own references, so the handle does not need to outlive this call
+        native_handle_t* handle = ::android::makeFromAidl(buffers[i].buffer.handle);
+        AHardwareBuffer* buffer = nullptr;
+        const int status = AHardwareBuffer_createFromHandle(
+                &desc, handle, AHARDWAREBUFFER_CREATE_FROM_HANDLE_METHOD_CLONE, &buffer);
+        native_handle_delete(handle);
+        if (status != 0) {
+            LOG(WARNING) << "Failed to import buffer " << buffers[i].bufferId << ": " << status;
+            continue;
+        }
+
+        const size_t slot = getFreeSlotLocked();
+        mBuffers[slot] = {.buffer = buffer, .external = true};
+        ++mFramesAllowed;
+        ++numBuffersAdded;
+    }
+
+    *_aidl_return = numBuffersAdded;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::pauseVideoStream() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStreamState == DEAD) {
+        return toScopedAStatus(EvsResult::OWNERSHIP_LOST);
+    }
+    mPaused = true;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::resumeVideoStream() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStreamState == DEAD) {
+        return toScopedAStatus(EvsResult::OWNERSHIP_LOST);
+    }
+    mPaused = false;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::setExtendedInfo(int32_t opaqueIdentifier,
+                                             const std::vector<uint8_t>& opaqueValue) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mExtInfo[opaqueIdentifier] = opaqueValue;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::setIntParameter(CameraParam, int32_t, std::vector<int32_t>*) {
+    return toScopedAStatus(EvsResult::NOT_SUPPORTED);
+}
+
+ScopedAStatus EvsMockCamera::setPrimaryClient() {
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::setMaxFramesInFlight(int32_t bufferCount) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStreamState == DEAD) {
+        LOG(ERROR) << "Ignoring setMaxFramesInFlight call when camera has been lost.";
+        return toScopedAStatus(EvsResult::OWNERSHIP_LOST);
+    }
+    if (bufferCount < static_cast<int32_t>(kMinimumBuffersInFlight)) {
+        LOG(ERROR) << "Ignoring setMaxFramesInFlight with less than one buffer requested";
+        return toScopedAStatus(EvsResult::INVALID_ARG);
+    }
+    if (!setAvailableFramesLocked(bufferCount)) {
+        return toScopedAStatus(EvsResult::BUFFER_NOT_AVAILABLE);
+    }
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::startVideoStream(const std::shared_ptr<IEvsCameraStream>& receiver) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStreamState == DEAD) {
+        LOG(ERROR) << "Ignoring startVideoStream call when camera has been lost.";
+        return toScopedAStatus(EvsResult::OWNERSHIP_LOST);
+    }
+    if (mStreamState != STOPPED) {
+        LOG(ERROR) << "Ignoring startVideoStream call when a stream is already running.";
+        return toScopedAStatus(EvsResult::STREAM_ALREADY_RUNNING);
+    }
+    if (!receiver) {
+        return toScopedAStatus(EvsResult::INVALID_ARG);
+    }
+
+    // If the client never indicated otherwise, configure ourselves for a single streaming buffer
+    if (mFramesAllowed < kMinimumBuffersInFlight &&
+        !setAvailableFramesLocked(kMinimumBuffersInFlight)) {
+        LOG(ERROR) << "Failed to start stream because we couldn't get a graphics buffer";
+        return toScopedAStatus(EvsResult::BUFFER_NOT_AVAILABLE);
+    }
+
+    mStream = receiver;
+    mStats = {};
+    mFrameCount = 0;
+    mPaused = false;
+    mStreamState = RUNNING;
+    mCaptureThread = std::thread([this] { generateFrames(); });
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::stopVideoStream() {
+    std::thread captureThread;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mStreamState != RUNNING) {
+            return ScopedAStatus::ok();
+        }
+        mStreamState = STOPPING;
+        captureThread = std::move(mCaptureThread);
+    }
+
+    // The frame thread sends STREAM_STOPPED once it is out of its loop
+    if (captureThread.joinable()) {
+        captureThread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStreamState = STOPPED;
+    mStream = nullptr;
+    logStreamStatsLocked();
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockCamera::unsetPrimaryClient() {
+    return ScopedAStatus::ok();
+}
+
+binder_status_t EvsMockCamera::dump(int fd, const char**, uint32_t) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const StreamStats& stats = mStats;
+    const uint64_t returned = std::max<uint64_t>(stats.framesReturned, 1);
+    const uint64_t delivered = std::max<uint64_t>(stats.framesDelivered, 1);
+    dprintf(fd,
+            "Camera %s: %dx%d at %d fps, state %d%s, %u/%u buffers in use\n"
+            "  delivered %" PRIu64 ", returned %" PRIu64 ", dropped %" PRIu64 "\n"
+            "  return latency avg %" PRId64 " us, max %" PRId64 " us\n"
+            "  deliverFrame avg %" PRId64 " us, max %" PRId64 " us\n",
+            mDesc.id.c_str(), mStreamConfig.width, mStreamConfig.height,
+            mStreamConfig.framerate, mStreamState, mPaused ? " (paused)" : "", mFramesInUse,
+            mFramesAllowed, stats.framesDelivered, stats.framesReturned, stats.framesDropped,
+            stats.returnLatencySumNs / static_cast<int64_t>(returned) / 1000,
+            stats.returnLatencyMaxNs / 1000,
+            stats.deliverSumNs / static_cast<int64_t>(delivered) / 1000,
+            stats.deliverMaxNs / 1000);
+    return STATUS_OK;
+}
+
+void EvsMockCamera::generateFrames() {
+    LOG(DEBUG) << "Frame generation loop started";
+
+    using std::chrono::steady_clock;
+    const int32_t frameRate =
+            mStreamConfig.framerate > 0 ? mStreamConfig.framerate : kDefaultFrameRate;
+    const auto frameInterval =
+            std::chrono::duration_cast<steady_clock::duration>(std::chrono::seconds(1)) /
+            frameRate;
+    auto nextFrameTime = steady_clock::now();
+    std::shared_ptr<IEvsCameraStream> stream;
+    while (true) {
+        AHardwareBuffer* buffer = nullptr;
+        size_t idx = 0;
+        bool drawPattern = false;
+        uint32_t frameCount = 0;
+
+        // Lock scope for updating shared state
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mStreamState != RUNNING) {
+                // Break out of our main thread loop
+                stream = mStream;
+                break;
+            }
+            stream = mStream;
+
+            if (mPaused) {
+                // Paused streams are not supposed to produce frames, so none are dropped
+            } else if (mFramesInUse >= mFramesAllowed) {
+                // Can't do anything right now -- skip this frame
+                LOG(VERBOSE) << "Skipped a frame because too many are in flight";
+                ++mStats.framesDropped;
+            } else {
+                // Identify an available buffer to fill
+                for (idx = 0; idx < mBuffers.size(); ++idx) {
+                    if (!mBuffers[idx].inUse && mBuffers[idx].buffer != nullptr) {
+                        break;
+                    }
+                }
+                if (idx < mBuffers.size()) {
+                    // We're going to make the frame busy
+                    BufferRecord& record = mBuffers[idx];
+                    record.inUse = true;
+                    ++mFramesInUse;
+                    buffer = record.buffer;
+                    drawPattern = !record.patternReady;
+                    record.patternReady = true;
+                    frameCount = mFrameCount++;
+                } else {
+                    // This shouldn't happen since we already checked mFramesInUse vs
+                    // mFramesAllowed
+                    LOG(ERROR) << "Failed to find an available buffer slot";
+                }
+            }
+        }
+
+        if (buffer != nullptr) {
+            // Write test data into the image buffer
+            fillTestFrame(buffer, drawPattern, frameCount);
+
+            std::vector<BufferDesc> frames;
+            frames.push_back(makeBufferDesc(buffer, static_cast<int32_t>(idx)));
+            const int64_t deliveredNs = ::android::elapsedRealtimeNano();
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mBuffers[idx].deliveredNs = deliveredNs;
+            }
+
+            // Issue the (asynchronous) callback to the client -- can't be holding the lock
+            const bool delivered = stream->deliverFrame(frames).isOk();
+            const int64_t deliverNs = ::android::elapsedRealtimeNano() - deliveredNs;
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (delivered) {
+                ++mStats.framesDelivered;
+                mStats.deliverSumNs += deliverNs;
+                mStats.deliverMaxNs = std::max(mStats.deliverMaxNs, deliverNs);
+            } else {
+                // This can happen if the client dies and is likely unrecoverable.
+                // To avoid consuming resources generating failing calls, we stop sending
+                // frames.  Note, however, that the stream remains in the "RUNNING" state
+                // until cleaned up on the main thread.
+                LOG(ERROR) << "Frame delivery call failed in the transport layer.";
+
+                // Since we didn't actually deliver it, mark the frame as available
+                mBuffers[idx].inUse = false;
+                --mFramesInUse;
+                ++mStats.framesDropped;
+                break;
+            }
+        }
+
+        // Generate frames at the rate of the stream configuration; ticks missed while the
+        // client held every buffer are skipped rather than caught up on
+        nextFrameTime += frameInterval;
+        const auto now = steady_clock::now();
+        if (nextFrameTime < now) {
+            nextFrameTime = now;
+        }
+        std::this_thread::sleep_until(nextFrameTime);
+    }
+
+    // If we've been asked to stop, send an event to signal the actual end of stream
+    EvsEventDesc event;
+    event.aType = EvsEventType::STREAM_STOPPED;
+    event.deviceId = mDesc.id;
+    if (!stream->notify(event).isOk()) {
+        LOG(ERROR) << "Error delivering end of stream marker";
+    }
+
+    LOG(DEBUG) << "Frame generation loop ended";
+}
+
+void EvsMockCamera::fillTestFrame(AHardwareBuffer* buffer, bool drawPattern,
+                                  uint32_t frameCount) {
+    AHardwareBuffer_Desc desc;
+    AHardwareBuffer_describe(buffer, &desc);
+    if (!is32BitFormat(desc.format)) {
+        // The pattern is only drawn into formats the colorbar can be written to as is
+        return;
+    }
+
+    // Lock our output buffer for writing; only the rows holding the frame counter are touched
+    // unless the pattern has to be drawn
+    const uint32_t counterHeight = std::min(kFrameCounterBlockHeight, desc.height);
+    const uint32_t counterWidth = std::min(kFrameCounterBits * kFrameCounterBlockWidth,
+                                           desc.width);
+    const ARect rect = {0, 0, static_cast<int32_t>(desc.width),
+                        static_cast<int32_t>(drawPattern ? desc.height : counterHeight)};
+    uint32_t* pixels = nullptr;
+    if (AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, &rect,
+                             reinterpret_cast<void**>(&pixels)) != 0 ||
+        pixels == nullptr) {
+        LOG(ERROR) << "Camera failed to gain access to image buffer for writing";
+        return;
+    }
+
+    if (drawPattern) {
+        // Build one row of the colorbar in ABGR format and copy it into every row
+        if (mPatternRow.size() != desc.width) {
+            mPatternRow.resize(desc.width);
+            for (unsigned col = 0; col < desc.width; col++) {
+                mPatternRow[col] = kColors[col * kNumColors / desc.width];
+            }
+        }
+
+        uint32_t* row = pixels;
+        for (unsigned i = 0; i < desc.height; i++) {
+            memcpy(row, mPatternRow.data(), desc.width * sizeof(uint32_t));
+            // NOTE:  the stride of an AHardwareBuffer is in units of pixels
+            row = row + desc.stride;
+        }
+    }
+
+    // Stamp the frame counter
+    uint32_t* row = pixels;
+    for (unsigned i = 0; i < counterHeight; i++) {
+        for (unsigned col = 0; col < counterWidth; col++) {
+            const unsigned bit = kFrameCounterBits - 1 - col / kFrameCounterBlockWidth;
+            row[col] = (frameCount >> bit) & 1 ? kColors[0] : kColors[kNumColors - 1];
+        }
+        row = row + desc.stride;
+    }
+
+    AHardwareBuffer_unlock(buffer, nullptr);
+}
+
+BufferDesc EvsMockCamera::makeBufferDesc(AHardwareBuffer* buffer, int32_t bufferId) const {
+    AHardwareBuffer_Desc desc;
+    AHardwareBuffer_describe(buffer, &desc);
+
+    BufferDesc bufferDesc;
+    auto& description = bufferDesc.buffer.description;
+    description.width = desc.width;
+    description.height = desc.height;
+    description.layers = desc.layers;
+    description.format = static_cast<PixelFormat>(desc.format);
+    description.usage = static_cast<BufferUsage>(desc.usage);
+    description.stride = desc.stride;
+    // Only the handle is duplicated for the transaction; the pixels stay where they are
+    bufferDesc.buffer.handle = ::android::dupToAidl(AHardwareBuffer_getNativeHandle(buffer));
+    bufferDesc.pixelSizeBytes = getPixelSizeBytes(desc.format);
+    bufferDesc.bufferId = bufferId;
+    bufferDesc.deviceId = mDesc.id;
+    // timestamps are in microseconds
+    bufferDesc.timestamp = ::android::elapsedRealtimeNano() / 1000;
+    return bufferDesc;
+}
+
+bool EvsMockCamera::setAvailableFramesLocked(unsigned bufferCount) {
+    if (bufferCount < kMinimumBuffersInFlight) {
+        LOG(ERROR) << "Ignoring request to set buffer count to zero";
+        return false;
+    }
+    if (bufferCount > kMaxBuffersInFlight) {
+        LOG(ERROR) << "Rejecting buffer request in excess of internal limit";
+        return false;
+    }
+
+    // Is an increase required?
+    if (mFramesAllowed < bufferCount) {
+        // An increase is required
+        const unsigned needed = bufferCount - mFramesAllowed;
+        LOG(DEBUG) << "Allocating " << needed << " buffers for camera frames";
+
+        const unsigned added = increaseAvailableFramesLocked(needed);
+        if (added != needed) {
+            // If we didn't add all the frames we needed, then roll back to the previous state
+            LOG(ERROR) << "Rolling back to previous frame queue size";
+            decreaseAvailableFramesLocked(added);
+            return false;
+        }
+    } else if (mFramesAllowed > bufferCount) {
+        // A decrease is required; buffers held by the client cannot be taken back
+        if (mFramesInUse > bufferCount) {
+            LOG(ERROR) << "Rejecting request to shrink below the " << mFramesInUse
+                       << " buffers in use";
+            return false;
+        }
+        decreaseAvailableFramesLocked(mFramesAllowed - bufferCount);
+    }
+    return true;
+}
+
+unsigned EvsMockCamera::increaseAvailableFramesLocked(unsigned numToAdd) {
+    const AHardwareBuffer_Desc desc = {
+            static_cast<uint32_t>(mStreamConfig.width),
+            static_cast<uint32_t>(mStreamConfig.height),
+            1,  // layers, always 1 for EVS
+            static_cast<uint32_t>(mStreamConfig.format),
+            mUsage,
+            0,  // stride, chosen by the allocator
+            0,
+            0,
+    };
+
+    unsigned added = 0;
+    while (added < numToAdd) {
+        AHardwareBuffer* buffer = nullptr;
+        if (AHardwareBuffer_allocate(&desc, &buffer) != 0 || buffer == nullptr) {
+            LOG(ERROR) << "Error allocating memory for camera frames";
+            break;
+        }
+
+        const size_t slot = getFreeSlotLocked();
+        mBuffers[slot] = {.buffer = buffer};
+        ++mFramesAllowed;
+        ++added;
+    }
+    return added;
+}
+
+unsigned EvsMockCamera::decreaseAvailableFramesLocked(unsigned numToRemove) {
+    unsigned removed = 0;
+    for (auto& record : mBuffers) {
+        if (removed == numToRemove) {
+            break;
+        }
+        // Is this record not in use, but holding a buffer that we can free?
+        if (!record.inUse && record.buffer != nullptr) {
+            AHardwareBuffer_release(record.buffer);
+            record = {};
+            --mFramesAllowed;
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+size_t EvsMockCamera::getFreeSlotLocked() {
+    for (size_t i = 0; i < mBuffers.size(); ++i) {
+        if (mBuffers[i].buffer == nullptr) {
+            return i;
+        }
+    }
+    mBuffers.emplace_back();
+    return mBuffers.size() - 1;
+}
+
+void EvsMockCamera::returnBufferLocked(int32_t bufferId) {
+    if (bufferId < 0 || static_cast<size_t>(bufferId) >= mBuffers.size()) {
+        LOG(ERROR) << "Ignoring doneWithFrame called with invalid bufferId " << bufferId;
+        return;
+    }
+    BufferRecord& record = mBuffers[bufferId];
+    if (!record.inUse) {
+        LOG(ERROR) << "Ignoring doneWithFrame called on frame " << bufferId
+                   << " which is already free";
+        return;
+    }
+
+    // Mark the frame as available
+    record.inUse = false;
+    --mFramesInUse;
+
+    const int64_t latencyNs = ::android::elapsedRealtimeNano() - record.deliveredNs;
+    ++mStats.framesReturned;
+    mStats.returnLatencySumNs += latencyNs;
+    mStats.returnLatencyMaxNs = std::max(mStats.returnLatencyMaxNs, latencyNs);
+}
+
+void EvsMockCamera::logStreamStatsLocked() const {
+    const uint64_t returned = std::max<uint64_t>(mStats.framesReturned, 1);
+    LOG(INFO) << "Camera " << mDesc.id << " stream stopped: " << mStats.framesDelivered
+              << " frames delivered, " << mStats.framesDropped << " dropped, return latency avg "
+              << mStats.returnLatencySumNs / static_cast<int64_t>(returned) / 1000 << " us, max "
+              << mStats.returnLatencyMaxNs / 1000 << " us";
+}
+
+}  // namespace aidl::android::hardware::automotive::evs::implementation
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EvsMockDisplay"
+
+#include <EvsMockDisplay.h>
+
+#include <aidl/android/hardware/automotive/evs/EvsResult.h>
+#include <aidlcommonsupport/NativeHandle.h>
+#include <android-base/logging.h>
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace {
+
+using ::aidl::android::graphics::common::BufferUsage;
+using ::aidl::android::graphics::common::PixelFormat;
+using ::aidl::android::hardware::automotive::evs::EvsResult;
+using ::ndk::ScopedAStatus;
+
+// Arbitrary magic number for self recognition
+constexpr int32_t kDefaultDisplayBufferId = 0x3870;
+
+ScopedAStatus toScopedAStatus(EvsResult result) {
+    return ScopedAStatus::fromServiceSpecificError(static_cast<int>(result));
+}
+
+}  // namespace
+
+namespace aidl::android::hardware::automotive::evs::implementation {
+
+EvsMockDisplay::EvsMockDisplay(const DisplayDesc& desc) : mDesc(desc) {}
+
+EvsMockDisplay::~EvsMockDisplay() {
+    forceShutdown();
+}
+
+void EvsMockDisplay::forceShutdown() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mBuffer != nullptr) {
+        // The client's copy of the handle stays valid until it closes it
+        AHardwareBuffer_release(mBuffer);
+        mBuffer = nullptr;
+    }
+    mFrameBusy = false;
+    mRequestedState = DisplayState::DEAD;
+}
+
+ScopedAStatus EvsMockDisplay::getDisplayInfo(DisplayDesc* _aidl_return) {
+    *_aidl_return = mDesc;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockDisplay::getDisplayState(DisplayState* _aidl_return) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    *_aidl_return = mRequestedState;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockDisplay::getTargetBuffer(BufferDesc* _aidl_return) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRequestedState == DisplayState::DEAD) {
+        LOG(ERROR) << "Rejecting buffer request from object that lost ownership of the display.";
+        return toScopedAStatus(EvsResult::OWNERSHIP_LOST);
+    }
+    if (mFrameBusy) {
+        LOG(ERROR) << "Ignoring getTargetBuffer call while previous frame is still out.";
+        return toScopedAStatus(EvsResult::BUFFER_NOT_AVAILABLE);
+    }
+
+    if (mBuffer == nullptr) {
+        const AHardwareBuffer_Desc desc = {
+                static_cast<uint32_t>(mDesc.width),
+                static_cast<uint32_t>(mDesc.height),
+                1,  // layers
+                static_cast<uint32_t>(PixelFormat::RGBA_8888),
+                static_cast<uint64_t>(BufferUsage::CPU_WRITE_OFTEN) |
+                        static_cast<uint64_t>(BufferUsage::CPU_READ_OFTEN) |
+                        static_cast<uint64_t>(BufferUsage::GPU_TEXTURE),
+                0,  // stride, chosen by the allocator
+                0,
+                0,
+        };
+        if (AHardwareBuffer_allocate(&desc, &mBuffer) != 0 || mBuffer == nullptr) {
+            LOG(ERROR) << "Error allocating memory for the display buffer";
+            mBuffer = nullptr;
+            return toScopedAStatus(EvsResult::BUFFER_NOT_AVAILABLE);
+        }
+    }
+
+    AHardwareBuffer_Desc desc;
+    AHardwareBuffer_describe(mBuffer, &desc);
+    auto& description = _aidl_return->buffer.description;
+    description.width = desc.width;
+    description.height = desc.height;
+    description.layers = desc.layers;
+    description.format = static_cast<PixelFormat>(desc.format);
+    description.usage = static_cast<BufferUsage>(desc.usage);
+    description.stride = desc.stride;
+    _aidl_return->buffer.handle = ::android::dupToAidl(AHardwareBuffer_getNativeHandle(mBuffer));
+    _aidl_return->pixelSizeBytes = 4;
+    _aidl_return->bufferId = kDefaultDisplayBufferId;
+    _aidl_return->deviceId = mDesc.id;
+
+    // Mark our buffer as busy
+    mFrameBusy = true;
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockDisplay::returnTargetBufferForDisplay(const BufferDesc& buffer) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (buffer.bufferId != kDefaultDisplayBufferId) {
+        LOG(ERROR) << "Got an unrecognized frame returned.";
+        return toScopedAStatus(EvsResult::INVALID_ARG);
+    }
+    if (!mFrameBusy) {
+        LOG(ERROR) << "A frame was returned with no outstanding frames.";
+        return toScopedAStatus(EvsResult::BUFFER_NOT_AVAILABLE);
+    }
+    mFrameBusy = false;
+
+    // If we've been displaced by another owner of the display, then we can't do anything else
+    if (mRequestedState == DisplayState::DEAD) {
+        return toScopedAStatus(EvsResult::OWNERSHIP_LOST);
+    }
+
+    // If we were waiting for a new frame, this is it!
+    if (mRequestedState == DisplayState::VISIBLE_ON_NEXT_FRAME) {
+        mRequestedState = DisplayState::VISIBLE;
+    }
+
+    // Frames returned while the display is not visible are accepted and dropped
+    if (mRequestedState == DisplayState::VISIBLE) {
+        ++mFramesDisplayed;
+    }
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus EvsMockDisplay::setDisplayState(DisplayState state) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRequestedState == DisplayState::DEAD) {
+        // This object no longer owns the display -- it's been superceeded!
+        return toScopedAStatus(EvsResult::OWNERSHIP_LOST);
+    }
+
+    switch (state) {
+        case DisplayState::NOT_VISIBLE:
+        case DisplayState::VISIBLE_ON_NEXT_FRAME:
+        case DisplayState::VISIBLE:
+            mRequestedState = state;
+            return ScopedAStatus::ok();
+        default:
+            return toScopedAStatus(EvsResult::INVALID_ARG);
+    }
+}
+
+binder_status_t EvsMockDisplay::dump(int fd, const char**, uint32_t) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    dprintf(fd, "Display %s: %dx%d, state %d, buffer %s, %" PRIu64 " frames displayed\n",
+            mDesc.id.c_str(), mDesc.width, mDesc.height, static_cast<int>(mRequestedState),
+            mFrameBusy ? "out" : "free", mFramesDisplayed);
+    return STATUS_OK;
+}
+
+}  // namespace aidl::android::hardware::automotive::evs::implementation
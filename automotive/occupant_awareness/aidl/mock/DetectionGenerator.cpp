@@ -14,8 +14,6 @@
  * limitations under the License.
  */
 
-#include <utils/SystemClock.h>
-
 #include "DetectionGenerator.h"
 
 namespace android {
@@ -30,11 +28,9 @@ using ::aidl::android::hardware::automotive::occupant_awareness::DriverMonitorin
 using ::aidl::android::hardware::automotive::occupant_awareness::OccupantDetection;
 using ::aidl::android::hardware::automotive::occupant_awareness::PresenceDetection;
 
-static int64_t kNanoSecondsPerMilliSecond = 1000 * 1000;
-
-OccupantDetections DetectionGenerator::GetNextDetections() {
+OccupantDetections DetectionGenerator::GetNextDetections(int64_t timeStampMillis) {
     OccupantDetections detections;
-    detections.timeStampMillis = android::elapsedRealtimeNano() / kNanoSecondsPerMilliSecond;
+    detections.timeStampMillis = timeStampMillis;
     int remainingRoles = getSupportedRoles();
     while (remainingRoles) {
         int currentRole = remainingRoles & (~(remainingRoles - 1));
@@ -39,7 +39,8 @@ class DetectionGenerator {
                static_cast<int>(BnOccupantAwareness::CAP_DRIVER_MONITORING_DETECTION);
     }
 
-    OccupantDetections GetNextDetections();
+    // Returns the detections of the frame captured at |timeStampMillis|.
+    OccupantDetections GetNextDetections(int64_t timeStampMillis);
 };
 
 }  // namespace implementation
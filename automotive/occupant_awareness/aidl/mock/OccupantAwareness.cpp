@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <stdio.h>
+
+#include <algorithm>
+
 #include <utils/SystemClock.h>
 
 #include "OccupantAwareness.h"
@@ -39,10 +43,32 @@ ScopedAStatus OccupantAwareness::startDetection(OccupantAwarenessStatus* status)
         return ScopedAStatus::fromExceptionCode(EX_TRANSACTION_FAILED);
     }
 
+    // No detection from a previous run.
+    publishDetections(OccupantDetections());
+    mLastCallbackTime = Clock::time_point();
+    {
+        std::lock_guard<std::mutex> statsLock(mStatsMutex);
+        mFramesCaptured = 0;
+        mFramesDropped = 0;
+        mCallbacksSent = 0;
+        mCallbacksSkipped = 0;
+        mQueueLatency = Latency();
+        mInferenceLatency = Latency();
+        mPublishLatency = Latency();
+    }
+    {
+        std::lock_guard<std::mutex> frameLock(mFrameMutex);
+        mRunning = true;
+        mPendingFrame.reset();
+    }
     mStatus = OccupantAwarenessStatus::READY;
-    mWorkerThread = std::thread(startWorkerThread, this);
-    if (mCallback) {
-        mCallback->onSystemStatusChanged(kAllCapabilities, mStatus);
+    mAcquisitionThread = std::thread(&OccupantAwareness::acquisitionThreadFunction, this);
+    mInferenceThread = std::thread(&OccupantAwareness::inferenceThreadFunction, this);
+    {
+        std::lock_guard<std::mutex> callbackLock(mCallbackMutex);
+        if (mCallback) {
+            mCallback->onSystemStatusChanged(kAllCapabilities, mStatus);
+        }
     }
 
     *status = mStatus;
@@ -56,9 +82,18 @@ ScopedAStatus OccupantAwareness::stopDetection(OccupantAwarenessStatus* status)
     }
 
     mStatus = OccupantAwarenessStatus::NOT_INITIALIZED;
-    mWorkerThread.join();
-    if (mCallback) {
-        mCallback->onSystemStatusChanged(kAllCapabilities, mStatus);
+    {
+        std::lock_guard<std::mutex> frameLock(mFrameMutex);
+        mRunning = false;
+    }
+    mFrameCondition.notify_all();
+    mAcquisitionThread.join();
+    mInferenceThread.join();
+    {
+        std::lock_guard<std::mutex> callbackLock(mCallbackMutex);
+        if (mCallback) {
+            mCallback->onSystemStatusChanged(kAllCapabilities, mStatus);
+        }
     }
 
     *status = mStatus;
@@ -104,7 +139,6 @@ ScopedAStatus OccupantAwareness::getState(Role occupantRole, int detectionCapabi
         return ScopedAStatus::ok();
     }
 
-    std::lock_guard<std::mutex> lock(mMutex);
     *status = mStatus;
     return ScopedAStatus::ok();
 }
@@ -115,22 +149,46 @@ ScopedAStatus OccupantAwareness::setCallback(
         return ScopedAStatus::fromExceptionCode(EX_TRANSACTION_FAILED);
     }
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::lock_guard<std::mutex> lock(mCallbackMutex);
     mCallback = callback;
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus OccupantAwareness::getLatestDetection(OccupantDetections* detections) {
-    std::lock_guard<std::mutex> lock(mMutex);
-
     if (mStatus != OccupantAwarenessStatus::READY) {
         return ScopedAStatus::fromExceptionCode(EX_TRANSACTION_FAILED);
     }
 
-    *detections = mLatestDetections;
+    *detections = readLatestDetections();
     return ScopedAStatus::ok();
 }
 
+binder_status_t OccupantAwareness::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    dprintf(fd, "status: %d, a frame every %lld ms, callbacks at most every %lld ms\n",
+            static_cast<int>(mStatus.load()), static_cast<long long>(kFramePeriod.count()),
+            static_cast<long long>(kMinCallbackInterval.count()));
+
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+    dprintf(fd, "%llu frames captured, %llu dropped, %llu callbacks sent, %llu skipped\n",
+            static_cast<unsigned long long>(mFramesCaptured),
+            static_cast<unsigned long long>(mFramesDropped),
+            static_cast<unsigned long long>(mCallbacksSent),
+            static_cast<unsigned long long>(mCallbacksSkipped));
+    const std::pair<const char*, const Latency&> stages[] = {
+            {"queue", mQueueLatency},
+            {"inference", mInferenceLatency},
+            {"publish", mPublishLatency},
+    };
+    for (const auto& [name, latency] : stages) {
+        using Ms = std::chrono::duration<double, std::milli>;
+        const double averageMs =
+                latency.count > 0 ? Ms(latency.total).count() / latency.count : 0.0;
+        dprintf(fd, "%s latency: %.3f ms on average, %.3f ms at most\n", name, averageMs,
+                Ms(latency.max).count());
+    }
+    return STATUS_OK;
+}
+
 bool OccupantAwareness::isValidRole(Role occupantRole) {
     int intVal = static_cast<int>(occupantRole);
     int allOccupants = static_cast<int>(Role::ALL_OCCUPANTS);
@@ -147,25 +205,103 @@ bool OccupantAwareness::isSingularCapability(int detectionCapability) {
     return (detectionCapability & (detectionCapability - 1)) == 0;
 }
 
-void OccupantAwareness::startWorkerThread(OccupantAwareness* occupantAwareness) {
-    occupantAwareness->workerThreadFunction();
+void OccupantAwareness::Latency::add(Clock::duration latency) {
+    count++;
+    total += latency;
+    max = std::max(max, latency);
+}
+
+void OccupantAwareness::acquisitionThreadFunction() {
+    Clock::time_point nextCaptureTime = Clock::now();
+    std::unique_lock<std::mutex> lock(mFrameMutex);
+    while (!mFrameCondition.wait_until(lock, nextCaptureTime, [this] { return !mRunning; })) {
+        // Capture the next frame. The previous one, if not taken yet, will not be.
+        Frame frame{android::elapsedRealtimeNano() / kNanoSecondsPerMilliSecond, Clock::now()};
+        const bool dropped = mPendingFrame.has_value();
+        mPendingFrame = frame;
+        mFrameCondition.notify_all();
+        {
+            std::lock_guard<std::mutex> statsLock(mStatsMutex);
+            mFramesCaptured++;
+            mFramesDropped += dropped ? 1 : 0;
+        }
+
+        nextCaptureTime += kFramePeriod;
+        if (nextCaptureTime < frame.captureTime) {
+            // Late by more than a frame, do not catch up with a burst.
+            nextCaptureTime = frame.captureTime + kFramePeriod;
+        }
+    }
 }
 
-void OccupantAwareness::workerThreadFunction() {
-    bool isFirstDetection = true;
-    int64_t prevDetectionTimeMs;
-    while (mStatus == OccupantAwarenessStatus::READY) {
-        int64_t currentTimeMs = android::elapsedRealtimeNano() / kNanoSecondsPerMilliSecond;
-        if ((isFirstDetection) || (currentTimeMs - prevDetectionTimeMs > mDetectionDurationMs)) {
-            std::lock_guard<std::mutex> lock(mMutex);
-            mLatestDetections = mGenerator.GetNextDetections();
-            if (mCallback != nullptr) {
-                mCallback->onDetectionEvent(mLatestDetections);
+void OccupantAwareness::inferenceThreadFunction() {
+    std::unique_lock<std::mutex> lock(mFrameMutex);
+    while (true) {
+        mFrameCondition.wait(lock, [this] { return !mRunning || mPendingFrame.has_value(); });
+        if (!mRunning) break;
+        const Frame frame = *mPendingFrame;
+        mPendingFrame.reset();
+        lock.unlock();
+
+        // The next frame is captured meanwhile.
+        const Clock::time_point inferenceStart = Clock::now();
+        OccupantDetections detections = mGenerator.GetNextDetections(frame.timeStampMillis);
+        const Clock::time_point inferenceEnd = Clock::now();
+
+        publishDetections(detections);
+        bool callbackSent = false;
+        bool callbackSkipped = false;
+        if (inferenceEnd - mLastCallbackTime >= kMinCallbackInterval) {
+            std::shared_ptr<IOccupantAwarenessClientCallback> callback;
+            {
+                std::lock_guard<std::mutex> callbackLock(mCallbackMutex);
+                callback = mCallback;
+            }
+            if (callback != nullptr) {
+                callback->onDetectionEvent(detections);
+                mLastCallbackTime = inferenceEnd;
+                callbackSent = true;
             }
-            isFirstDetection = false;
-            prevDetectionTimeMs = currentTimeMs;
+        } else {
+            callbackSkipped = true;
         }
+        const Clock::time_point publishEnd = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> statsLock(mStatsMutex);
+            mQueueLatency.add(inferenceStart - frame.captureTime);
+            mInferenceLatency.add(inferenceEnd - inferenceStart);
+            mPublishLatency.add(publishEnd - inferenceEnd);
+            mCallbacksSent += callbackSent ? 1 : 0;
+            mCallbacksSkipped += callbackSkipped ? 1 : 0;
+        }
+        lock.lock();
+    }
+}
+
+void OccupantAwareness::publishDetections(const OccupantDetections& detections) {
+    // Only one thread publishes at a time: startDetection() before the inference thread
+    // starts, then the inference thread.
+    const uint32_t next = 1 - mPublishedSnapshot.load();
+    while (mSnapshotReaders[next].load() != 0) {
+        std::this_thread::yield();
+    }
+    mSnapshots[next] = detections;
+    mPublishedSnapshot.store(next);
+}
+
+OccupantDetections OccupantAwareness::readLatestDetections() {
+    uint32_t current = mPublishedSnapshot.load();
+    mSnapshotReaders[current].fetch_add(1);
+    while (mPublishedSnapshot.load() != current) {
+        // Published again before this reader registered, the snapshot may be written to.
+        mSnapshotReaders[current].fetch_sub(1);
+        current = mPublishedSnapshot.load();
+        mSnapshotReaders[current].fetch_add(1);
     }
+    OccupantDetections detections = mSnapshots[current];
+    mSnapshotReaders[current].fetch_sub(1);
+    return detections;
 }
 
 }  // namespace implementation
@@ -16,6 +16,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
 #include <thread>
 
 #include <aidl/android/hardware/automotive/occupant_awareness/BnOccupantAwareness.h>
@@ -40,6 +45,12 @@ using ::aidl::android::hardware::automotive::occupant_awareness::Role;
 /**
  * The mock HAL can detect presence of Driver and front passenger, and driver awareness detection
  * for driver.
+ *
+ * Detection runs as a two stage pipeline at a steady frame rate: an acquisition thread captures
+ * a frame every kFramePeriod while an inference thread runs the detection of the previous one.
+ * When inference falls behind, the oldest frame not processed yet is dropped. Results are
+ * published to a double-buffered snapshot, which getLatestDetection() reads without taking a
+ * lock, and at most every kMinCallbackInterval to the callback.
  **/
 class OccupantAwareness : public BnOccupantAwareness {
   public:
@@ -54,25 +65,71 @@ class OccupantAwareness : public BnOccupantAwareness {
             const std::shared_ptr<IOccupantAwarenessClientCallback>& callback) override;
     ndk::ScopedAStatus getLatestDetection(OccupantDetections* detections) override;
 
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+    static constexpr std::chrono::milliseconds kFramePeriod{33};
+    static constexpr std::chrono::milliseconds kMinCallbackInterval{100};
+
   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        int64_t timeStampMillis;
+        Clock::time_point captureTime;
+    };
+
+    struct Latency {
+        void add(Clock::duration latency);
+        uint64_t count = 0;
+        Clock::duration total{0};
+        Clock::duration max{0};
+    };
+
     bool isValidRole(Role occupantRole);
     bool isValidDetectionCapabilities(int detectionCapabilities);
     bool isSingularCapability(int detectionCapability);
 
-    void workerThreadFunction();
-    static void startWorkerThread(OccupantAwareness* occupantAwareness);
+    void acquisitionThreadFunction();
+    void inferenceThreadFunction();
+    void publishDetections(const OccupantDetections& detections);
+    OccupantDetections readLatestDetections();
 
+    // Serializes starting and stopping the detection.
     std::mutex mMutex;
+    // Written with mMutex held, read without.
+    std::atomic<OccupantAwarenessStatus> mStatus = OccupantAwarenessStatus::NOT_INITIALIZED;
+
+    // The frame handed from acquisition to inference, guarded by mFrameMutex.
+    std::mutex mFrameMutex;
+    std::condition_variable mFrameCondition;
+    bool mRunning = false;
+    std::optional<Frame> mPendingFrame;
+
+    std::mutex mCallbackMutex;
     std::shared_ptr<IOccupantAwarenessClientCallback> mCallback = nullptr;
-    OccupantAwarenessStatus mStatus = OccupantAwarenessStatus::NOT_INITIALIZED;
 
-    OccupantDetections mLatestDetections;
-    std::thread mWorkerThread;
+    std::thread mAcquisitionThread;
+    std::thread mInferenceThread;
 
+    // Only used by the inference thread.
     DetectionGenerator mGenerator;
+    Clock::time_point mLastCallbackTime;
+
+    // The inference thread writes the snapshot not published, once no reader is left on it.
+    // Readers register on the published one, and retry if it changed meanwhile.
+    OccupantDetections mSnapshots[2];
+    std::atomic<uint32_t> mSnapshotReaders[2] = {0, 0};
+    std::atomic<uint32_t> mPublishedSnapshot = 0;
 
-    // Generate a new detection every 1ms.
-    const int64_t mDetectionDurationMs = 1;
+    // Statistics of the current detection, guarded by mStatsMutex.
+    std::mutex mStatsMutex;
+    uint64_t mFramesCaptured = 0;
+    uint64_t mFramesDropped = 0;
+    uint64_t mCallbacksSent = 0;
+    uint64_t mCallbacksSkipped = 0;
+    Latency mQueueLatency;
+    Latency mInferenceLatency;
+    Latency mPublishLatency;
 };
 
 }  // namespace implementation
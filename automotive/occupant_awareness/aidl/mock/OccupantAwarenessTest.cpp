@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "OccupantAwareness.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace occupant_awareness {
+namespace V1_0 {
+namespace implementation {
+namespace {
+
+using ::aidl::android::hardware::automotive::occupant_awareness::BnOccupantAwarenessClientCallback;
+using ::aidl::android::hardware::automotive::occupant_awareness::OccupantDetection;
+using ndk::ScopedAStatus;
+using namespace std::chrono_literals;
+
+constexpr auto kTimeout = 2s;
+
+class FakeCallback : public BnOccupantAwarenessClientCallback {
+  public:
+    ScopedAStatus onSystemStatusChanged(int32_t /*detectionFlags*/,
+                                        OccupantAwarenessStatus status) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStatuses.push_back(status);
+        return ScopedAStatus::ok();
+    }
+
+    ScopedAStatus onDetectionEvent(const OccupantDetections& detections) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEvents.push_back({std::chrono::steady_clock::now(), detections});
+        mChanged.notify_all();
+        return ScopedAStatus::ok();
+    }
+
+    // Returns whether |count| detection events were received within kTimeout.
+    bool waitForEvents(size_t count) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mChanged.wait_for(lock, kTimeout, [&] { return mEvents.size() >= count; });
+    }
+
+    std::vector<std::pair<std::chrono::steady_clock::time_point, OccupantDetections>> events() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEvents;
+    }
+
+    std::vector<OccupantAwarenessStatus> statuses() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStatuses;
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mChanged;
+    std::vector<std::pair<std::chrono::steady_clock::time_point, OccupantDetections>> mEvents;
+    std::vector<OccupantAwarenessStatus> mStatuses;
+};
+
+// The detections of one frame of the generator: the driver and the front passenger.
+void expectCompleteDetections(const OccupantDetections& detections) {
+    ASSERT_EQ(2u, detections.detections.size());
+    for (const OccupantDetection& detection : detections.detections) {
+        ASSERT_EQ(1u, detection.presenceData.size());
+        EXPECT_EQ(detections.timeStampMillis, detection.presenceData[0].detectionDurationMillis);
+        EXPECT_EQ(detection.role == Role::DRIVER ? 1u : 0u, detection.attentionData.size());
+    }
+}
+
+class OccupantAwarenessTest : public ::testing::Test {
+  protected:
+    void TearDown() override {
+        // The detection threads must not outlive the HAL.
+        OccupantAwarenessStatus status;
+        mHal->stopDetection(&status);
+    }
+
+    OccupantAwarenessStatus driverState() {
+        OccupantAwarenessStatus status = OccupantAwarenessStatus::FAILURE;
+        EXPECT_TRUE(
+                mHal->getState(Role::DRIVER, OccupantAwareness::CAP_PRESENCE_DETECTION, &status)
+                        .isOk());
+        return status;
+    }
+
+    // Returns the latest detection once a frame has been processed, within kTimeout.
+    OccupantDetections waitForDetections() {
+        OccupantDetections detections;
+        const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+        while (std::chrono::steady_clock::now() < deadline) {
+            EXPECT_TRUE(mHal->getLatestDetection(&detections).isOk());
+            if (!detections.detections.empty()) break;
+            std::this_thread::sleep_for(1ms);
+        }
+        return detections;
+    }
+
+    std::shared_ptr<OccupantAwareness> mHal = ndk::SharedRefBase::make<OccupantAwareness>();
+};
+
+TEST_F(OccupantAwarenessTest, ReportsTheCapabilitiesOfTheFrontOccupants) {
+    int32_t capabilities = -1;
+    ASSERT_TRUE(mHal->getCapabilityForRole(Role::DRIVER, &capabilities).isOk());
+    EXPECT_EQ(OccupantAwareness::CAP_PRESENCE_DETECTION |
+                      OccupantAwareness::CAP_DRIVER_MONITORING_DETECTION,
+              capabilities);
+    ASSERT_TRUE(mHal->getCapabilityForRole(Role::FRONT_PASSENGER, &capabilities).isOk());
+    EXPECT_EQ(OccupantAwareness::CAP_PRESENCE_DETECTION, capabilities);
+    ASSERT_TRUE(mHal->getCapabilityForRole(Role::ROW_2_PASSENGER_LEFT, &capabilities).isOk());
+    EXPECT_EQ(0, capabilities);
+    EXPECT_FALSE(mHal->getCapabilityForRole(Role::INVALID, &capabilities).isOk());
+}
+
+TEST_F(OccupantAwarenessTest, StartsAndStopsTheDetection) {
+    OccupantAwarenessStatus status;
+    EXPECT_EQ(OccupantAwarenessStatus::NOT_INITIALIZED, driverState());
+    EXPECT_FALSE(mHal->stopDetection(&status).isOk());
+
+    ASSERT_TRUE(mHal->startDetection(&status).isOk());
+    EXPECT_EQ(OccupantAwarenessStatus::READY, status);
+    EXPECT_EQ(OccupantAwarenessStatus::READY, driverState());
+    EXPECT_FALSE(mHal->startDetection(&status).isOk());
+
+    ASSERT_TRUE(mHal->stopDetection(&status).isOk());
+    EXPECT_EQ(OccupantAwarenessStatus::NOT_INITIALIZED, status);
+    EXPECT_EQ(OccupantAwarenessStatus::NOT_INITIALIZED, driverState());
+}
+
+TEST_F(OccupantAwarenessTest, ReportsTheStatusToTheCallback) {
+    auto callback = ndk::SharedRefBase::make<FakeCallback>();
+    ASSERT_TRUE(mHal->setCallback(callback).isOk());
+    EXPECT_FALSE(mHal->setCallback(nullptr).isOk());
+    OccupantAwarenessStatus status;
+
+    ASSERT_TRUE(mHal->startDetection(&status).isOk());
+    ASSERT_TRUE(mHal->stopDetection(&status).isOk());
+
+    EXPECT_EQ((std::vector<OccupantAwarenessStatus>{OccupantAwarenessStatus::READY,
+                                                    OccupantAwarenessStatus::NOT_INITIALIZED}),
+              callback->statuses());
+}
+
+TEST_F(OccupantAwarenessTest, PublishesTheDetectionsOfEachFrame) {
+    OccupantDetections detections;
+    EXPECT_FALSE(mHal->getLatestDetection(&detections).isOk());
+    OccupantAwarenessStatus status;
+    ASSERT_TRUE(mHal->startDetection(&status).isOk());
+
+    const OccupantDetections first = waitForDetections();
+    expectCompleteDetections(first);
+    std::this_thread::sleep_for(3 * OccupantAwareness::kFramePeriod);
+    ASSERT_TRUE(mHal->getLatestDetection(&detections).isOk());
+
+    expectCompleteDetections(detections);
+    EXPECT_GT(detections.timeStampMillis, first.timeStampMillis);
+}
+
+TEST_F(OccupantAwarenessTest, StartsWithoutTheDetectionsOfThePreviousRun) {
+    OccupantAwarenessStatus status;
+    ASSERT_TRUE(mHal->startDetection(&status).isOk());
+    waitForDetections();
+    ASSERT_TRUE(mHal->stopDetection(&status).isOk());
+
+    ASSERT_TRUE(mHal->startDetection(&status).isOk());
+    OccupantDetections detections;
+    ASSERT_TRUE(mHal->getLatestDetection(&detections).isOk());
+
+    // Unless the first frame of this run is already processed.
+    if (!detections.detections.empty()) expectCompleteDetections(detections);
+}
+
+TEST_F(OccupantAwarenessTest, ReadersNeverSeeAPartialSnapshot) {
+    OccupantAwarenessStatus status;
+    ASSERT_TRUE(mHal->startDetection(&status).isOk());
+    waitForDetections();
+
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([this, &done] {
+            int64_t lastTimeStamp = 0;
+            while (!done) {
+                OccupantDetections detections;
+                ASSERT_TRUE(mHal->getLatestDetection(&detections).isOk());
+                expectCompleteDetections(detections);
+                EXPECT_GE(detections.timeStampMillis, lastTimeStamp);
+                lastTimeStamp = detections.timeStampMillis;
+            }
+        });
+    }
+    std::this_thread::sleep_for(10 * OccupantAwareness::kFramePeriod);
+    done = true;
+    for (auto& reader : readers) reader.join();
+}
+
+TEST_F(OccupantAwarenessTest, LimitsTheRateOfDetectionEvents) {
+    auto callback = ndk::SharedRefBase::make<FakeCallback>();
+    ASSERT_TRUE(mHal->setCallback(callback).isOk());
+    OccupantAwarenessStatus status;
+    ASSERT_TRUE(mHal->startDetection(&status).isOk());
+
+    ASSERT_TRUE(callback->waitForEvents(4));
+
+    const auto events = callback->events();
+    for (size_t i = 0; i < events.size(); i++) {
+        expectCompleteDetections(events[i].second);
+        if (i == 0) continue;
+        EXPECT_GE(events[i].first - events[i - 1].first,
+                  OccupantAwareness::kMinCallbackInterval - 5ms);
+    }
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace occupant_awareness
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -19,6 +19,8 @@
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
 
+#include <algorithm>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -27,20 +29,19 @@ namespace V1_0 {
 namespace implementation {
 
 SurroundView2dSession::SurroundView2dSession() :
-    mStreamState(STOPPED) {
+    mStreamState(STOPPED),
+    mFrameInterval(std::chrono::nanoseconds(std::chrono::seconds(1)) / kDefaultFrameRate) {
     mEvsCameraIds = {"0" , "1", "2", "3"};
 
     mConfig.width = 640;
     mConfig.blending = SvQuality::HIGH;
 
-    framesRecord.frames.svBuffers.resize(1);
-    framesRecord.frames.svBuffers[0].viewId = 0;
-    framesRecord.frames.svBuffers[0].hardwareBuffer.nativeHandle =
-        new native_handle_t();
-    framesRecord.frames.svBuffers[0].hardwareBuffer.description[0] =
-        mConfig.width;
-    framesRecord.frames.svBuffers[0].hardwareBuffer.description[1] =
-        mConfig.width * 3 / 4;
+    for (auto frames : mFrames.frames()) {
+        SurroundViewFrameRing::resizeBuffers(frames, 1);
+        frames->svBuffers[0].viewId = 0;
+        frames->svBuffers[0].hardwareBuffer.description[0] = mConfig.width;
+        frames->svBuffers[0].hardwareBuffer.description[1] = mConfig.width * 3 / 4;
+    }
 }
 
 // Methods from ::android::hardware::automotive::sv::V1_0::ISurroundViewSession
@@ -80,11 +81,13 @@ Return<void> SurroundView2dSession::stopStream() {
         // already in flight
         ALOGD("Waiting for stream thread to end...");
         lock.unlock();
+        mStreamStateSignal.notify_all();
         mCaptureThread.join();
         lock.lock();
 
         mStreamState = STOPPED;
         mStream = nullptr;
+        mFrames.releaseAll();
         ALOGD("Stream marked STOPPED.");
     }
 
@@ -96,12 +99,28 @@ Return<void> SurroundView2dSession::doneWithFrames(
     ALOGD("SurroundView2dSession::doneWithFrames");
     std::unique_lock <std::mutex> lock(mAccessLock);
 
-    framesRecord.inUse = false;
+    if (!mFrames.release(svFramesDesc.sequenceId)) {
+        ALOGW("Ignoring doneWithFrames for unknown frames %u", svFramesDesc.sequenceId);
+    }
 
-    (void)svFramesDesc;
     return android::hardware::Void();
 }
 
+void SurroundView2dSession::setTargetFrameRate(int32_t framesPerSecond) {
+    std::lock_guard<std::mutex> lock(mAccessLock);
+
+    if (framesPerSecond <= 0) {
+        ALOGE("Ignoring invalid frame rate %d", framesPerSecond);
+        return;
+    }
+    mFrameInterval = std::chrono::nanoseconds(std::chrono::seconds(1)) / framesPerSecond;
+}
+
+SurroundViewFrameStats SurroundView2dSession::getFrameStats() {
+    std::lock_guard<std::mutex> lock(mAccessLock);
+    return mFrames.getStats();
+}
+
 // Methods from ISurroundView2dSession follow.
 Return<void> SurroundView2dSession::get2dMappingInfo(
     get2dMappingInfo_cb _hidl_cb) {
@@ -190,40 +209,35 @@ Return<void> SurroundView2dSession::projectCameraPoints(
 void SurroundView2dSession::generateFrames() {
     ALOGD("SurroundView2dSession::generateFrames");
 
-    int sequenceId = 0;
+    uint32_t sequenceId = 0;
+    auto nextFrameTime = std::chrono::steady_clock::now();
 
+    std::unique_lock<std::mutex> lock(mAccessLock);
     while(true) {
-        {
-            std::lock_guard<std::mutex> lock(mAccessLock);
-
-            if (mStreamState != RUNNING) {
-                // Break out of our main thread loop
-                break;
-            }
-
-            framesRecord.frames.svBuffers[0].hardwareBuffer.description[0] =
-                mConfig.width;
-            framesRecord.frames.svBuffers[0].hardwareBuffer.description[1] =
-                mConfig.width * 3 / 4;
+        // Frames are due on a fixed schedule, so the time spent producing
+        // one doesn't lower the rate. If we fell behind, start over from now
+        // rather than catching up with a burst of frames.
+        nextFrameTime = std::max(nextFrameTime + mFrameInterval,
+                                 std::chrono::steady_clock::now());
+        mStreamStateSignal.wait_until(lock, nextFrameTime,
+                                      [this]() { return mStreamState != RUNNING; });
+        if (mStreamState != RUNNING) {
+            // Break out of our main thread loop
+            break;
         }
 
-        usleep(100 * 1000);
-
-        framesRecord.frames.timestampNs = elapsedRealtimeNano();
-        framesRecord.frames.sequenceId = sequenceId++;
-
-        {
-            std::lock_guard<std::mutex> lock(mAccessLock);
-
-            if (framesRecord.inUse) {
-                ALOGD("Notify SvEvent::FRAME_DROPPED");
-                mStream->notify(SvEvent::FRAME_DROPPED);
-            } else {
-                framesRecord.inUse = true;
-                mStream->receiveFrames(framesRecord.frames);
-            }
+        SvFramesDesc* frames = mFrames.acquire(sequenceId++, elapsedRealtimeNano());
+        if (frames == nullptr) {
+            ALOGD("Notify SvEvent::FRAME_DROPPED");
+            mStream->notify(SvEvent::FRAME_DROPPED);
+            continue;
         }
+
+        frames->svBuffers[0].hardwareBuffer.description[0] = mConfig.width;
+        frames->svBuffers[0].hardwareBuffer.description[1] = mConfig.width * 3 / 4;
+        mStream->receiveFrames(*frames);
     }
+    lock.unlock();
 
     // If we've been asked to stop, send an event to signal the actual
     // end of stream
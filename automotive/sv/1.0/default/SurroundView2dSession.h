@@ -16,12 +16,16 @@
 
 #pragma once
 
+#include "SurroundViewFrameRing.h"
+
 #include <android/hardware/automotive/sv/1.0/types.h>
 #include <android/hardware/automotive/sv/1.0/ISurroundViewStream.h>
 #include <android/hardware/automotive/sv/1.0/ISurroundView2dSession.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <thread>
 
 using namespace ::android::hardware::automotive::sv::V1_0;
@@ -61,6 +65,15 @@ public:
     // Stream subscribed for the session.
     sp<ISurroundViewStream> mStream;
 
+    // Sets the rate at which frames are generated while streaming. Takes effect from the next
+    // frame.
+    void setTargetFrameRate(int32_t framesPerSecond);
+
+    // Returns frame delivery statistics since the session was created.
+    SurroundViewFrameStats getFrameStats();
+
+    static constexpr int32_t kDefaultFrameRate = 30;
+
 private:
     void generateFrames();
 
@@ -76,16 +89,18 @@ private:
 
     std::thread mCaptureThread; // The thread we'll use to synthesize frames
 
-    struct FramesRecord {
-        SvFramesDesc frames;
-        bool inUse = false;
-    };
+    // Output frames, handed out in turn and returned through doneWithFrames
+    SurroundViewFrameRing mFrames;
 
-    FramesRecord framesRecord;
+    // Time between two frames
+    std::chrono::nanoseconds mFrameInterval;
 
     // Synchronization necessary to deconflict mCaptureThread from the main service thread
     std::mutex mAccessLock;
 
+    // Wakes mCaptureThread up when the stream stops
+    std::condition_variable mStreamStateSignal;
+
     std::vector<std::string> mEvsCameraIds;
 };
 
@@ -21,6 +21,8 @@
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
 
+#include <algorithm>
+
 #include <android/hidl/memory/1.0/IMemory.h>
 #include <hidlmemory/mapping.h>
 
@@ -35,7 +37,8 @@ namespace V1_0 {
 namespace implementation {
 
 SurroundView3dSession::SurroundView3dSession() :
-    mStreamState(STOPPED){
+    mStreamState(STOPPED),
+    mFrameInterval(std::chrono::nanoseconds(std::chrono::seconds(1)) / kDefaultFrameRate) {
 
     mEvsCameraIds = {"0" , "1", "2", "3"};
 
@@ -43,11 +46,12 @@ SurroundView3dSession::SurroundView3dSession() :
     mConfig.height = 480;
     mConfig.carDetails = SvQuality::HIGH;
 
-    framesRecord.frames.svBuffers.resize(1);
-    framesRecord.frames.svBuffers[0].viewId = 0;
-    framesRecord.frames.svBuffers[0].hardwareBuffer.nativeHandle = new native_handle_t();
-    framesRecord.frames.svBuffers[0].hardwareBuffer.description[0] = mConfig.width;
-    framesRecord.frames.svBuffers[0].hardwareBuffer.description[1] = mConfig.height;
+    for (auto frames : mFrames.frames()) {
+        SurroundViewFrameRing::resizeBuffers(frames, 1);
+        frames->svBuffers[0].viewId = 0;
+        frames->svBuffers[0].hardwareBuffer.description[0] = mConfig.width;
+        frames->svBuffers[0].hardwareBuffer.description[1] = mConfig.height;
+    }
 }
 
 // Methods from ::android::hardware::automotive::sv::V1_0::ISurroundViewSession.
@@ -91,11 +95,13 @@ Return<void> SurroundView3dSession::stopStream() {
         // We won't send any more frames, but the client might still get some already in flight
         ALOGD("Waiting for stream thread to end...");
         lock.unlock();
+        mStreamStateSignal.notify_all();
         mCaptureThread.join();
         lock.lock();
 
         mStreamState = STOPPED;
         mStream = nullptr;
+        mFrames.releaseAll();
         ALOGD("Stream marked STOPPED.");
     }
 
@@ -107,12 +113,28 @@ Return<void> SurroundView3dSession::doneWithFrames(
     ALOGD("SurroundView3dSession::doneWithFrames");
     std::unique_lock <std::mutex> lock(mAccessLock);
 
-    framesRecord.inUse = false;
+    if (!mFrames.release(svFramesDesc.sequenceId)) {
+        ALOGW("Ignoring doneWithFrames for unknown frames %u", svFramesDesc.sequenceId);
+    }
 
-    (void)svFramesDesc;
     return android::hardware::Void();
 }
 
+void SurroundView3dSession::setTargetFrameRate(int32_t framesPerSecond) {
+    std::lock_guard<std::mutex> lock(mAccessLock);
+
+    if (framesPerSecond <= 0) {
+        ALOGE("Ignoring invalid frame rate %d", framesPerSecond);
+        return;
+    }
+    mFrameInterval = std::chrono::nanoseconds(std::chrono::seconds(1)) / framesPerSecond;
+}
+
+SurroundViewFrameStats SurroundView3dSession::getFrameStats() {
+    std::lock_guard<std::mutex> lock(mAccessLock);
+    return mFrames.getStats();
+}
+
 // Methods from ISurroundView3dSession follow.
 Return<SvResult> SurroundView3dSession::setViews(const hidl_vec<View3d>& views) {
     ALOGD("SurroundView3dSession::stopStream");
@@ -216,9 +238,22 @@ Return<SvResult>  SurroundView3dSession::updateOverlays(
         return SvResult::INVALID_ARG;
     }
 
+    // Publish the new set; the previous one is released outside the lock once the frame being
+    // generated is done with it
+    std::shared_ptr<const OverlaysData> overlays = std::make_shared<OverlaysData>(overlaysData);
+    {
+        std::lock_guard<std::mutex> lock(mOverlaysLock);
+        mOverlays.swap(overlays);
+    }
+
     return SvResult::OK;
 }
 
+std::shared_ptr<const OverlaysData> SurroundView3dSession::getOverlays() {
+    std::lock_guard<std::mutex> lock(mOverlaysLock);
+    return mOverlays;
+}
+
 Return<void> SurroundView3dSession::projectCameraPointsTo3dSurface(
     const hidl_vec<Point2dInt>& cameraPoints,
     const hidl_string& cameraId,
@@ -258,43 +293,43 @@ Return<void> SurroundView3dSession::projectCameraPointsTo3dSurface(
 void SurroundView3dSession::generateFrames() {
     ALOGD("SurroundView3dSession::generateFrames");
 
-    int sequenceId = 0;
+    uint32_t sequenceId = 0;
+    auto nextFrameTime = std::chrono::steady_clock::now();
 
+    std::unique_lock<std::mutex> lock(mAccessLock);
     while(true) {
-        {
-            std::lock_guard<std::mutex> lock(mAccessLock);
-
-            if (mStreamState != RUNNING) {
-                // Break out of our main thread loop
-                break;
-            }
+        // Frames are due on a fixed schedule, so the time spent producing one doesn't lower the
+        // rate. If we fell behind, start over from now rather than catching up with a burst.
+        nextFrameTime = std::max(nextFrameTime + mFrameInterval, std::chrono::steady_clock::now());
+        mStreamStateSignal.wait_until(lock, nextFrameTime,
+                                      [this]() { return mStreamState != RUNNING; });
+        if (mStreamState != RUNNING) {
+            // Break out of our main thread loop
+            break;
         }
 
-        usleep(100 * 1000);
-
-        framesRecord.frames.timestampNs = elapsedRealtimeNano();
-        framesRecord.frames.sequenceId = sequenceId++;
+        SvFramesDesc* frames = mFrames.acquire(sequenceId++, elapsedRealtimeNano());
+        if (frames == nullptr) {
+            ALOGD("Notify SvEvent::FRAME_DROPPED");
+            mStream->notify(SvEvent::FRAME_DROPPED);
+            continue;
+        }
 
-        framesRecord.frames.svBuffers.resize(mViews.size());
+        // The buffers, and their handles, are reused as long as the set of views stays the same
+        SurroundViewFrameRing::resizeBuffers(frames, mViews.size());
         for (int i=0; i<mViews.size(); i++) {
-            framesRecord.frames.svBuffers[i].viewId = mViews[i].viewId;
-            framesRecord.frames.svBuffers[i].hardwareBuffer.nativeHandle = new native_handle_t();
-            framesRecord.frames.svBuffers[i].hardwareBuffer.description[0] = mConfig.width; // width
-            framesRecord.frames.svBuffers[i].hardwareBuffer.description[1] = mConfig.height; // height
+            frames->svBuffers[i].viewId = mViews[i].viewId;
+            frames->svBuffers[i].hardwareBuffer.description[0] = mConfig.width; // width
+            frames->svBuffers[i].hardwareBuffer.description[1] = mConfig.height; // height
         }
 
-        {
-            std::lock_guard<std::mutex> lock(mAccessLock);
+        // Take this frame's overlays; a concurrent updateOverlays only affects the next frame
+        const std::shared_ptr<const OverlaysData> overlays = getOverlays();
+        ALOGV("Composing %zu overlays", overlays ? overlays->overlaysMemoryDesc.size() : 0);
 
-            if (framesRecord.inUse) {
-                ALOGD("Notify SvEvent::FRAME_DROPPED");
-                mStream->notify(SvEvent::FRAME_DROPPED);
-            } else {
-                framesRecord.inUse = true;
-                mStream->receiveFrames(framesRecord.frames);
-            }
-        }
+        mStream->receiveFrames(*frames);
     }
+    lock.unlock();
 
     // If we've been asked to stop, send an event to signal the actual end of stream
     ALOGD("Notify SvEvent::STREAM_STOPPED");
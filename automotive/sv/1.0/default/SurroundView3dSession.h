@@ -16,12 +16,17 @@
 
 #pragma once
 
+#include "SurroundViewFrameRing.h"
+
 #include <android/hardware/automotive/sv/1.0/types.h>
 #include <android/hardware/automotive/sv/1.0/ISurroundViewStream.h>
 #include <android/hardware/automotive/sv/1.0/ISurroundView3dSession.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <thread>
 
 using namespace ::android::hardware::automotive::sv::V1_0;
@@ -62,6 +67,15 @@ public:
     // TODO(tanmayp): Make private and add set/get method.
     sp<ISurroundViewStream> mStream;
 
+    // Sets the rate at which frames are generated while streaming. Takes effect from the next
+    // frame.
+    void setTargetFrameRate(int32_t framesPerSecond);
+
+    // Returns frame delivery statistics since the session was created.
+    SurroundViewFrameStats getFrameStats();
+
+    static constexpr int32_t kDefaultFrameRate = 30;
+
 private:
     void generateFrames();
 
@@ -75,16 +89,27 @@ private:
 
     std::thread mCaptureThread; // The thread we'll use to synthesize frames
 
-    struct FramesRecord {
-        SvFramesDesc frames;
-        bool inUse = false;
-    };
+    // Output frames, handed out in turn and returned through doneWithFrames
+    SurroundViewFrameRing mFrames;
 
-    FramesRecord framesRecord;
+    // Time between two frames
+    std::chrono::nanoseconds mFrameInterval;
 
     // Synchronization necessary to deconflict mCaptureThread from the main service thread
     std::mutex mAccessLock;
 
+    // Wakes mCaptureThread up when the stream stops
+    std::condition_variable mStreamStateSignal;
+
+    // Returns the overlays most recently passed to updateOverlays.
+    std::shared_ptr<const OverlaysData> getOverlays();
+
+    // Overlays to compose into the frames. A new set is verified without holding any lock and
+    // then replaces the whole set, so updateOverlays never stalls frame generation and every
+    // frame uses one consistent set.
+    std::shared_ptr<const OverlaysData> mOverlays;
+    std::mutex mOverlaysLock;
+
     std::vector<View3d> mViews;
 
     Sv3dConfig mConfig;
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SurroundViewFrameRing.h"
+
+#include <cutils/native_handle.h>
+
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace sv {
+namespace V1_0 {
+namespace implementation {
+
+namespace {
+
+void deleteHandle(SvBuffer& svBuffer) {
+    native_handle_delete(
+        const_cast<native_handle_t*>(svBuffer.hardwareBuffer.nativeHandle.getNativeHandle()));
+    svBuffer.hardwareBuffer.nativeHandle = nullptr;
+}
+
+}  // namespace
+
+SurroundViewFrameRing::SurroundViewFrameRing(size_t size) : mRecords(std::max<size_t>(size, 1)) {}
+
+SurroundViewFrameRing::~SurroundViewFrameRing() {
+    for (auto&& record : mRecords) {
+        resizeBuffers(&record.frames, 0);
+    }
+}
+
+SvFramesDesc* SurroundViewFrameRing::acquire(uint32_t sequenceId, int64_t timestampNs) {
+    // Hand the frames out in order, so the client sees each buffer as late as possible
+    for (size_t i = 0; i < mRecords.size(); i++) {
+        FramesRecord& record = mRecords[(mNext + i) % mRecords.size()];
+        if (record.inUse) {
+            continue;
+        }
+
+        mNext = (mNext + i + 1) % mRecords.size();
+        record.inUse = true;
+        record.deliveredTime = std::chrono::steady_clock::now();
+        record.frames.sequenceId = sequenceId;
+        record.frames.timestampNs = timestampNs;
+        mStats.framesDelivered++;
+        return &record.frames;
+    }
+
+    mStats.framesDropped++;
+    return nullptr;
+}
+
+bool SurroundViewFrameRing::release(uint32_t sequenceId) {
+    for (auto&& record : mRecords) {
+        if (!record.inUse || record.frames.sequenceId != sequenceId) {
+            continue;
+        }
+
+        record.inUse = false;
+        const int64_t latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - record.deliveredTime).count();
+        mTotalLatencyNs += latencyNs;
+        mStats.framesReturned++;
+        mStats.averageLatencyNs = mTotalLatencyNs / mStats.framesReturned;
+        mStats.maxLatencyNs = std::max(mStats.maxLatencyNs, latencyNs);
+        return true;
+    }
+
+    return false;
+}
+
+void SurroundViewFrameRing::releaseAll() {
+    for (auto&& record : mRecords) {
+        record.inUse = false;
+    }
+}
+
+void SurroundViewFrameRing::resizeBuffers(SvFramesDesc* frames, size_t count) {
+    auto& svBuffers = frames->svBuffers;
+    for (size_t i = count; i < svBuffers.size(); i++) {
+        deleteHandle(svBuffers[i]);
+    }
+
+    const size_t oldCount = svBuffers.size();
+    svBuffers.resize(count);
+    for (size_t i = oldCount; i < count; i++) {
+        svBuffers[i].hardwareBuffer.nativeHandle = native_handle_create(0, 0);
+    }
+}
+
+std::vector<SvFramesDesc*> SurroundViewFrameRing::frames() {
+    std::vector<SvFramesDesc*> frames;
+    frames.reserve(mRecords.size());
+    for (auto&& record : mRecords) {
+        frames.push_back(&record.frames);
+    }
+    return frames;
+}
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace sv
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
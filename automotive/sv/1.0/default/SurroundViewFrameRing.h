@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/hardware/automotive/sv/1.0/types.h>
+
+#include <chrono>
+#include <vector>
+
+using namespace ::android::hardware::automotive::sv::V1_0;
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace sv {
+namespace V1_0 {
+namespace implementation {
+
+// Frame delivery statistics of a session.
+struct SurroundViewFrameStats {
+    uint64_t framesDelivered = 0;
+    uint64_t framesDropped = 0;
+    uint64_t framesReturned = 0;
+    // Time from delivering frames to the client until it returns them through doneWithFrames.
+    int64_t averageLatencyNs = 0;
+    int64_t maxLatencyNs = 0;
+};
+
+// A fixed set of output frames that are handed to the client in turn and come back through
+// doneWithFrames, so a slow client only causes drops once every frame is outstanding.  The ring
+// is not thread safe; the owning session guards it with its own lock.
+class SurroundViewFrameRing {
+public:
+    static constexpr size_t kDefaultSize = 3;
+
+    explicit SurroundViewFrameRing(size_t size = kDefaultSize);
+    ~SurroundViewFrameRing();
+
+    // Returns frames the client does not hold and marks them as delivered with the given
+    // sequence id and timestamp, or nullptr (and counts a dropped frame) if all are in use.
+    SvFramesDesc* acquire(uint32_t sequenceId, int64_t timestampNs);
+
+    // Marks the frames with the given sequence id as returned by the client. Returns false if no
+    // delivered frames have that sequence id.
+    bool release(uint32_t sequenceId);
+
+    // Marks every frame as returned, e.g. when the stream stops.
+    void releaseAll();
+
+    // Resizes svBuffers of the frames to count buffers, giving each new buffer its own handle.
+    static void resizeBuffers(SvFramesDesc* frames, size_t count);
+
+    // Every frame in the ring, e.g. to update the buffer descriptions.
+    std::vector<SvFramesDesc*> frames();
+
+    SurroundViewFrameStats getStats() const { return mStats; }
+
+private:
+    struct FramesRecord {
+        SvFramesDesc frames;
+        bool inUse = false;
+        std::chrono::steady_clock::time_point deliveredTime;
+    };
+
+    std::vector<FramesRecord> mRecords;
+    size_t mNext = 0;
+
+    SurroundViewFrameStats mStats;
+    int64_t mTotalLatencyNs = 0;
+};
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace sv
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
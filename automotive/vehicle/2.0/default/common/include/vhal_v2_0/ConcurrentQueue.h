@@ -84,7 +84,11 @@ private:
     std::queue<T> mQueue;
 };
 
-template<typename T>
+/* Consumes items from a queue in batches. Queue could be ConcurrentQueue or any
+ * queue with the same waitForItems(), flush() and deactivate() interface, e.g.
+ * ConcurrentRingQueue.
+ */
+template<typename T, typename Queue = ConcurrentQueue<T>>
 class BatchingConsumer {
 private:
     enum class State {
@@ -102,14 +106,19 @@ public:
 
     using OnBatchReceivedFunc = std::function<void(const std::vector<T>& vec)>;
 
-    void run(ConcurrentQueue<T>* queue,
+    void run(Queue* queue,
              std::chrono::nanoseconds batchInterval,
              const OnBatchReceivedFunc& func) {
         mQueue = queue;
         mBatchInterval = batchInterval;
 
         mWorkerThread = std::thread(
-            &BatchingConsumer<T>::runInternal, this, func);
+            &BatchingConsumer<T, Queue>::runInternal, this, func);
+    }
+
+    // Takes effect from the next batch on, the consumer may be running.
+    void setBatchInterval(std::chrono::nanoseconds batchInterval) {
+        mBatchInterval = batchInterval;
     }
 
     void requestStop() {
@@ -129,7 +138,7 @@ private:
                 mQueue->waitForItems();
                 if (State::STOP_REQUESTED == mState) break;
 
-                std::this_thread::sleep_for(mBatchInterval);
+                std::this_thread::sleep_for(mBatchInterval.load());
                 if (State::STOP_REQUESTED == mState) break;
 
                 std::vector<T> items = mQueue->flush();
@@ -147,8 +156,8 @@ private:
     std::thread mWorkerThread;
 
     std::atomic<State> mState;
-    std::chrono::nanoseconds mBatchInterval;
-    ConcurrentQueue<T>* mQueue;
+    std::atomic<std::chrono::nanoseconds> mBatchInterval;
+    Queue* mQueue;
 };
 
 }  // namespace android
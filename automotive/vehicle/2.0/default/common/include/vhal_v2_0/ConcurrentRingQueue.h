@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_V2_0_ConcurrentRingQueue_H_
+#define android_hardware_automotive_vehicle_V2_0_ConcurrentRingQueue_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace android {
+
+/* A bounded multi-producer, single-consumer queue backed by ring buffers.
+ *
+ * Same interface as ConcurrentQueue, so it could be used with BatchingConsumer.
+ * push() and flush() only use atomic operations unless the queue is full with
+ * OverflowPolicy::BLOCK, or the consumer is sleeping in waitForItems() and
+ * needs to be woken up.
+ *
+ * Each policy has its own ring of the given capacity, so items of one policy
+ * never take the room of the other: DROP_OLDEST producers can't starve BLOCK
+ * producers by refilling the slots the consumer frees, and a BLOCK item at the
+ * head can't make a DROP_OLDEST push lose the newest item. Items keep their
+ * order within a policy, flush() returns the BLOCK items first.
+ */
+template<typename T>
+class ConcurrentRingQueue {
+public:
+    enum class OverflowPolicy {
+        // Drop the oldest item pushed with this policy to make room, used for
+        // continuous properties.
+        DROP_OLDEST,
+        // Wait until the consumer makes room, used for on-change properties.
+        BLOCK,
+    };
+
+    // The capacity of each ring is rounded up to the next power of 2, and is
+    // at least 2 as a slot could not tell whether it is full or empty otherwise.
+    explicit ConcurrentRingQueue(size_t capacity)
+        : mBlockRing(capacity), mDropRing(capacity) {}
+
+    ConcurrentRingQueue(const ConcurrentRingQueue &) = delete;
+    ConcurrentRingQueue &operator=(const ConcurrentRingQueue &) = delete;
+
+    void waitForItems() {
+        if (!isEmpty()) {
+            return;
+        }
+        std::unique_lock<std::mutex> g(mLock);
+        mConsumerWaiting.store(true);
+        // Pairs with the fence in push(), either the producer sees
+        // mConsumerWaiting or we see the pushed item.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (isEmpty() && mIsActive.load()) {
+            mConsumerCond.wait(g);
+        }
+        mConsumerWaiting.store(false);
+    }
+
+    std::vector<T> flush() {
+        std::vector<T> items;
+        if (!mIsActive.load()) {
+            return items;
+        }
+        mBlockRing.popAll(&items);
+        if (!items.empty()) {
+            notifyBlockedProducers();
+        }
+        mDropRing.popAll(&items);
+        return items;
+    }
+
+    void push(T&& item, OverflowPolicy policy = OverflowPolicy::BLOCK) {
+        if (!mIsActive.load()) {
+            return;
+        }
+        if (policy == OverflowPolicy::DROP_OLDEST) {
+            // Only producers of this policy and the consumer take items out of
+            // the ring, so each retry follows an item leaving it.
+            while (!mDropRing.tryPush(item)) {
+                if (mDropRing.tryPop().has_value()) {
+                    mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        } else {
+            while (!mBlockRing.tryPush(item)) {
+                if (!waitForRoom()) {
+                    return;
+                }
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mConsumerWaiting.load()) {
+            MuxGuard g(mLock);
+            mConsumerCond.notify_one();
+        }
+    }
+
+    /* Deactivates the queue, thus no one can push items to it, also
+     * notifies all waiting threads, including producers blocked on a full
+     * queue.
+     */
+    void deactivate() {
+        mIsActive.store(false);
+        MuxGuard g(mLock);
+        mConsumerCond.notify_all();
+        mProducerCond.notify_all();
+    }
+
+    // Number of items dropped because of OverflowPolicy::DROP_OLDEST.
+    uint64_t getDroppedCount() const {
+        return mDroppedCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    using MuxGuard = std::lock_guard<std::mutex>;
+
+    static constexpr size_t kCacheLineSize = 64;
+
+    // A bounded ring with a sequence number per slot, which any thread may
+    // push to and pop from.
+    class Ring {
+    public:
+        explicit Ring(size_t capacity)
+            : mCapacity(roundUpToPowerOfTwo(capacity)),
+              mMask(mCapacity - 1),
+              mSlots(new Slot[mCapacity]) {
+            for (size_t i = 0; i < mCapacity; i++) {
+                mSlots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool isEmpty() const {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            return mSlots[head & mMask].sequence.load(std::memory_order_acquire) != head + 1;
+        }
+
+        bool isFull() const {
+            return mTail.load(std::memory_order_relaxed) - mHead.load(std::memory_order_relaxed)
+                    >= mCapacity;
+        }
+
+        // Moves the item into the ring if there is room, item is untouched otherwise.
+        bool tryPush(T& item) {
+            size_t pos = mTail.load(std::memory_order_relaxed);
+            while (true) {
+                Slot& slot = mSlots[pos & mMask];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        slot.item.emplace(std::move(item));
+                        slot.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;  // Full.
+                } else {
+                    pos = mTail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Producers also pop to drop the oldest item, so the head is advanced
+        // with compare-and-swap even though there is only one consumer.
+        std::optional<T> tryPop() {
+            size_t pos = mHead.load(std::memory_order_relaxed);
+            while (true) {
+                Slot& slot = mSlots[pos & mMask];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        std::optional<T> item = std::move(slot.item);
+                        slot.item.reset();
+                        slot.sequence.store(pos + mCapacity, std::memory_order_release);
+                        return item;
+                    }
+                } else if (diff < 0) {
+                    return std::nullopt;  // Empty.
+                } else {
+                    pos = mHead.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void popAll(std::vector<T>* items) {
+            while (true) {
+                std::optional<T> item = tryPop();
+                if (!item.has_value()) {
+                    return;
+                }
+                items->push_back(std::move(*item));
+            }
+        }
+
+    private:
+        struct Slot {
+            // Ready to be written at position 'sequence', ready to be read at
+            // position 'sequence - 1'.
+            std::atomic<size_t> sequence;
+            std::optional<T> item;
+        };
+
+        static size_t roundUpToPowerOfTwo(size_t value) {
+            size_t result = 2;
+            while (result < value) {
+                result <<= 1;
+            }
+            return result;
+        }
+
+        const size_t mCapacity;
+        const size_t mMask;
+        const std::unique_ptr<Slot[]> mSlots;
+        alignas(kCacheLineSize) std::atomic<size_t> mHead = 0;
+        alignas(kCacheLineSize) std::atomic<size_t> mTail = 0;
+    };
+
+    bool isEmpty() const {
+        return mBlockRing.isEmpty() && mDropRing.isEmpty();
+    }
+
+    bool waitForRoom() {
+        std::unique_lock<std::mutex> g(mLock);
+        mBlockedProducerCount.fetch_add(1);
+        // Pairs with the fence in notifyBlockedProducers().
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (mBlockRing.isFull() && mIsActive.load()) {
+            mProducerCond.wait(g);
+        }
+        mBlockedProducerCount.fetch_sub(1);
+        return mIsActive.load();
+    }
+
+    void notifyBlockedProducers() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mBlockedProducerCount.load() > 0) {
+            MuxGuard g(mLock);
+            mProducerCond.notify_all();
+        }
+    }
+
+private:
+    Ring mBlockRing;
+    Ring mDropRing;
+    alignas(kCacheLineSize) std::atomic<bool> mIsActive = true;
+    std::atomic<bool> mConsumerWaiting = false;
+    std::atomic<size_t> mBlockedProducerCount = 0;
+    std::atomic<uint64_t> mDroppedCount = 0;
+
+    std::mutex mLock;
+    std::condition_variable mConsumerCond;
+    std::condition_variable mProducerCond;
+};
+
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_V2_0_ConcurrentRingQueue_H_
@@ -21,6 +21,8 @@
 #include <map>
 #include <set>
 #include <list>
+#include <unordered_map>
+#include <vector>
 
 #include <android/log.h>
 #include <hidl/HidlSupport.h>
@@ -50,10 +52,17 @@ public:
 
     void addOrUpdateSubscription(const SubscribeOptions &opts);
     bool isSubscribed(int32_t propId, SubscribeFlags flags);
+    // Returns SubscribeFlags::UNDEFINED if the client never subscribed to the property.
+    SubscribeFlags getSubscribeFlags(int32_t propId) const;
     std::vector<int32_t> getSubscribedProperties() const;
 
+    // Holds the values of the events being delivered to the client. Only the thread delivering
+    // events uses it, and it keeps its size from one batch to the next.
+    std::vector<VehiclePropValue>& getEventBuffer() { return mEventBuffer; }
+
 private:
     const sp<IVehicleCallback> mCallback;
+    std::vector<VehiclePropValue> mEventBuffer;
 
     std::map<int32_t, SubscribeOptions> mSubscriptions;
 };
@@ -75,7 +84,7 @@ public:
 
 struct HalClientValues {
     sp<HalClient> client;
-    std::list<VehiclePropValue *> values;
+    std::vector<VehiclePropValue *> values;
 };
 
 using ClientId = uint64_t;
@@ -92,7 +101,8 @@ public:
     SubscriptionManager(const OnPropertyUnsubscribed& onPropertyUnsubscribed)
             : mOnPropertyUnsubscribed(onPropertyUnsubscribed),
                 mCallbackDeathRecipient(new DeathRecipient(
-                    std::bind(&SubscriptionManager::onCallbackDead, this, std::placeholders::_1)))
+                    std::bind(&SubscriptionManager::onCallbackDead, this, std::placeholders::_1))),
+                mSubscriberIndex(std::make_shared<const SubscriberIndex>())
     {}
 
     ~SubscriptionManager() = default;
@@ -110,9 +120,11 @@ public:
      * Returns a list of IVehicleCallback -> list of VehiclePropValue ready for
      * dispatching to its clients.
      */
-    std::list<HalClientValues> distributeValuesToClients(
+    std::vector<HalClientValues> distributeValuesToClients(
             const std::vector<recyclable_ptr<VehiclePropValue>>& propValues,
             SubscribeFlags flags) const;
+    std::vector<HalClientValues> distributeValuesToClients(
+            const std::vector<VehiclePropValue*>& propValues, SubscribeFlags flags) const;
 
     std::list<sp<HalClient>> getSubscribedClients(int32_t propId, SubscribeFlags flags) const;
     /**
@@ -121,8 +133,16 @@ public:
      */
     void unsubscribe(ClientId clientId, int32_t propId);
 private:
-    std::list<sp<HalClient>> getSubscribedClientsLocked(int32_t propId,
-                                                        SubscribeFlags flags) const;
+    struct Subscriber {
+        sp<HalClient> client;
+        SubscribeFlags flags;
+    };
+    // The subscribers of each property.
+    using SubscriberIndex = std::unordered_map<int32_t, std::vector<Subscriber>>;
+
+    // Call after every change of mPropToClients or of the subscriptions of a client.
+    void rebuildSubscriberIndexLocked();
+    std::shared_ptr<const SubscriberIndex> getSubscriberIndex() const;
 
     bool updateHalEventSubscriptionLocked(const SubscribeOptions& opts, SubscribeOptions* out);
 
@@ -166,6 +186,11 @@ private:
 
     OnPropertyUnsubscribed mOnPropertyUnsubscribed;
     sp<DeathRecipient> mCallbackDeathRecipient;
+
+    // A snapshot of mPropToClients and the flags of the clients, rebuilt under mLock and swapped
+    // in atomically, so that events are distributed without taking mLock. Access it through
+    // std::atomic_load and std::atomic_store only.
+    std::shared_ptr<const SubscriberIndex> mSubscriberIndex;
 };
 
 
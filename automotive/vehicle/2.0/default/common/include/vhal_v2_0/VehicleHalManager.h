@@ -21,14 +21,20 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <atomic>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <android/hardware/automotive/vehicle/2.0/IVehicle.h>
 
 #include "ConcurrentQueue.h"
+#include "ConcurrentRingQueue.h"
 #include "SubscriptionManager.h"
 #include "VehicleHal.h"
 #include "VehicleObjectPool.h"
@@ -51,7 +57,8 @@ public:
     VehicleHalManager(VehicleHal* vehicleHal)
         : mHal(vehicleHal),
           mSubscriptionManager(std::bind(&VehicleHalManager::onAllClientsUnsubscribed,
-                                         this, std::placeholders::_1)) {
+                                         this, std::placeholders::_1)),
+          mEventQueue(kEventQueueCapacity) {
         init();
     }
 
@@ -75,6 +82,14 @@ public:
 
     Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
 
+    // Sets how long HAL events are collected before they are delivered to the clients as one
+    // batch. It takes effect from the next batch on.
+    void setEventBatchingWindow(std::chrono::nanoseconds window);
+
+    // With latestValueOnly set, a batch only delivers the newest value of each area of the
+    // property, and drops the older samples.
+    void setLatestValueOnly(int32_t propId, bool latestValueOnly);
+
   private:
     // Set unit test class as friend class to test private functions.
     friend class VehicleHalManagerTestHelper;
@@ -109,6 +124,8 @@ public:
     void cmdDumpOneProperty(int fd, int rowNumber, const VehiclePropConfig& config);
 
     bool cmdSetOneProperty(int fd, const hidl_vec<hidl_string>& options);
+    void cmdSetBatchingWindow(int fd, const hidl_vec<hidl_string>& options);
+    void cmdSetLatestValueOnly(int fd, const hidl_vec<hidl_string>& options);
 
     static bool checkArgumentsSize(int fd, const hidl_vec<hidl_string>& options, size_t minSize);
     static bool checkCallerHasWritePermissions(int fd);
@@ -141,14 +158,27 @@ public:
                                                     size_t* index);
 
   private:
+    // Continuous and other events each have this many slots. Once their slots are full,
+    // continuous events drop the oldest continuous event, and the other events wait for the
+    // consumer.
+    static constexpr size_t kEventQueueCapacity = 4096;
+
     VehicleHal* mHal;
     std::unique_ptr<VehiclePropConfigIndex> mConfigIndex;
     SubscriptionManager mSubscriptionManager;
 
-    hidl_vec<VehiclePropValue> mHidlVecOfVehiclePropValuePool;
+    mutable std::mutex mLatestValueOnlyLock;
+    std::unordered_set<int32_t> mLatestValueOnlyProps;  // GUARDED_BY(mLatestValueOnlyLock)
+
+    // Only used by onBatchHalEvent, kept to save allocations in the following batches.
+    std::vector<VehiclePropValue*> mBatchValues;
+    std::vector<std::pair<int32_t, int32_t>> mLatestValueKeys;
 
-    ConcurrentQueue<VehiclePropValuePtr> mEventQueue;
-    BatchingConsumer<VehiclePropValuePtr> mBatchingConsumer;
+    // Set after mConfigIndex is initialized, HAL events could arrive before that.
+    std::atomic<bool> mConfigIndexReady = false;
+    ConcurrentRingQueue<VehiclePropValuePtr> mEventQueue;
+    BatchingConsumer<VehiclePropValuePtr, ConcurrentRingQueue<VehiclePropValuePtr>>
+            mBatchingConsumer;
     VehiclePropValuePool mValueObjectPool;
 };
 
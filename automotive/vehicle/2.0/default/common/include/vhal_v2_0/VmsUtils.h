@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 
 #include <android/hardware/automotive/vehicle/2.0/types.h>
@@ -53,8 +54,9 @@ struct VmsLayer {
       public:
         // Hash of the variables is returned.
         size_t operator()(const VmsLayer& layer) const {
-            return std::hash<int>()(layer.type) ^ std::hash<int>()(layer.type) ^
-                   std::hash<int>()(layer.type);
+            size_t hash = std::hash<int>()(layer.type);
+            hash = hash * 31 + std::hash<int>()(layer.subtype);
+            return hash * 31 + std::hash<int>()(layer.version);
         }
     };
 };
@@ -94,6 +96,21 @@ struct VmsOffers {
     std::vector<VmsLayerOffering> offerings;
 };
 
+// An index of the layers offered in a VmsOffers. A publisher builds it once for its offers and
+// matches every subscriptions state against it, instead of indexing the offers on every call.
+// It is a copy: later changes to the VmsOffers are not reflected.
+class VmsOfferedLayers {
+  public:
+    explicit VmsOfferedLayers(const VmsOffers& offers);
+
+    int publisher_id() const { return publisher_id_; }
+    bool contains(const VmsLayer& layer) const { return layers_.count(layer) > 0; }
+
+  private:
+    int publisher_id_;
+    std::unordered_set<VmsLayer, VmsLayer::VmsLayerHashFunction> layers_;
+};
+
 // A VmsSubscriptionsState is delivered in response to a
 // VmsMessageType.SUBSCRIPTIONS_REQUEST or on the first SUBSCRIBE or last
 // UNSUBSCRIBE for a layer. It indicates which layers or associated_layers are
@@ -170,6 +187,13 @@ std::unique_ptr<VehiclePropValue> createSubscriptionsRequest();
 std::unique_ptr<VehiclePropValue> createDataMessageWithLayerPublisherInfo(
         const VmsLayerAndPublisher& layer_publisher, const std::string& vms_packet);
 
+// Same as createDataMessageWithLayerPublisherInfo, but writes the message into an existing
+// value, e.g. one that a publisher keeps across messages or obtains from a pool. Its buffers
+// are reused when they already have the right size, so publishing packets of a steady size
+// doesn't allocate.
+void fillDataMessageWithLayerPublisherInfo(const VmsLayerAndPublisher& layer_publisher,
+                                           std::string_view vms_packet, VehiclePropValue* message);
+
 // Creates a VehiclePropValue containing a message of type
 // VmsMessageType.PUBLISHER_ID_REQUEST with the given publisher information.
 // Returns a nullptr if the input is empty.
@@ -198,6 +222,10 @@ VmsMessageType parseMessageType(const VehiclePropValue& value);
 // function to ParseFromString.
 std::string parseData(const VehiclePropValue& value);
 
+// Same as parseData, without copying the payload. The view is valid for as long as the
+// VehiclePropValue is alive and its bytes are not modified.
+std::string_view parseDataView(const VehiclePropValue& value);
+
 // Returns the publisher ID by parsing the VehiclePropValue containing the ID.
 // Returns null if the message is invalid.
 int32_t parsePublisherIdResponse(const VehiclePropValue& publisher_id_response);
@@ -221,6 +249,12 @@ int32_t getSequenceNumberForSubscriptionsState(const VehiclePropValue& subscript
 std::vector<VmsLayer> getSubscribedLayers(const VehiclePropValue& subscriptions_state,
                                           const VmsOffers& offers);
 
+// Same as above with an index of the offers built beforehand. The layers are written into
+// |subscribed_layers|, which is cleared first, so that its capacity can be reused.
+void getSubscribedLayers(const VehiclePropValue& subscriptions_state,
+                         const VmsOfferedLayers& offered_layers,
+                         std::vector<VmsLayer>* subscribed_layers);
+
 // Takes an availability change message and returns true if the parsed message implies that
 // the service has newly started or restarted.
 // If the message has a sequence number 0, it means that the service
@@ -18,6 +18,7 @@
 
 #include "SubscriptionManager.h"
 
+#include <algorithm>
 #include <cmath>
 #include <inttypes.h>
 
@@ -74,6 +75,11 @@ bool HalClient::isSubscribed(int32_t propId,
     return res;
 }
 
+SubscribeFlags HalClient::getSubscribeFlags(int32_t propId) const {
+    auto it = mSubscriptions.find(propId);
+    return it == mSubscriptions.end() ? SubscribeFlags::UNDEFINED : it->second.flags;
+}
+
 std::vector<int32_t> HalClient::getSubscribedProperties() const {
     std::vector<int32_t> props;
     for (const auto& subscription : mSubscriptions) {
@@ -113,53 +119,62 @@ StatusCode SubscriptionManager::addOrUpdateSubscription(
             }
         }
     }
+    rebuildSubscriberIndexLocked();
 
     return StatusCode::OK;
 }
 
-std::list<HalClientValues> SubscriptionManager::distributeValuesToClients(
+std::vector<HalClientValues> SubscriptionManager::distributeValuesToClients(
         const std::vector<recyclable_ptr<VehiclePropValue>>& propValues,
         SubscribeFlags flags) const {
-    std::map<sp<HalClient>, std::list<VehiclePropValue*>> clientValuesMap;
+    std::vector<VehiclePropValue*> values;
+    values.reserve(propValues.size());
+    for (const auto& propValue : propValues) {
+        values.push_back(propValue.get());
+    }
+    return distributeValuesToClients(values, flags);
+}
 
-    {
-        MuxGuard g(mLock);
-        for (const auto& propValue: propValues) {
-            VehiclePropValue* v = propValue.get();
-            auto clients = getSubscribedClientsLocked(v->prop, flags);
-            for (const auto& client : clients) {
-                clientValuesMap[client].push_back(v);
+std::vector<HalClientValues> SubscriptionManager::distributeValuesToClients(
+        const std::vector<VehiclePropValue*>& propValues, SubscribeFlags flags) const {
+    // There are only a few clients, so they are looked up linearly rather than through a map.
+    std::vector<HalClientValues> clientValues;
+
+    std::shared_ptr<const SubscriberIndex> index = getSubscriberIndex();
+    for (VehiclePropValue* v : propValues) {
+        auto subscribers = index->find(v->prop);
+        if (subscribers == index->end()) {
+            continue;
+        }
+        for (const Subscriber& subscriber : subscribers->second) {
+            if (!(subscriber.flags & flags)) {
+                continue;
             }
+            auto it = std::find_if(clientValues.begin(), clientValues.end(),
+                                   [&subscriber](const HalClientValues& cv) {
+                                       return cv.client == subscriber.client;
+                                   });
+            if (it == clientValues.end()) {
+                clientValues.push_back(HalClientValues{.client = subscriber.client, .values = {}});
+                it = clientValues.end() - 1;
+            }
+            it->values.push_back(v);
         }
     }
 
-    std::list<HalClientValues> clientValues;
-    for (const auto& entry : clientValuesMap) {
-        clientValues.push_back(HalClientValues {
-            .client = entry.first,
-            .values = entry.second
-        });
-    }
-
     return clientValues;
 }
 
 std::list<sp<HalClient>> SubscriptionManager::getSubscribedClients(int32_t propId,
                                                                    SubscribeFlags flags) const {
-    MuxGuard g(mLock);
-    return getSubscribedClientsLocked(propId, flags);
-}
-
-std::list<sp<HalClient>> SubscriptionManager::getSubscribedClientsLocked(
-    int32_t propId, SubscribeFlags flags) const {
     std::list<sp<HalClient>> subscribedClients;
 
-    sp<HalClientVector> propClients = getClientsForPropertyLocked(propId);
-    if (propClients.get() != nullptr) {
-        for (size_t i = 0; i < propClients->size(); i++) {
-            const auto& client = propClients->itemAt(i);
-            if (client->isSubscribed(propId, flags)) {
-                subscribedClients.push_back(client);
+    std::shared_ptr<const SubscriberIndex> index = getSubscriberIndex();
+    auto subscribers = index->find(propId);
+    if (subscribers != index->end()) {
+        for (const Subscriber& subscriber : subscribers->second) {
+            if (subscriber.flags & flags) {
+                subscribedClients.push_back(subscriber.client);
             }
         }
     }
@@ -167,6 +182,26 @@ std::list<sp<HalClient>> SubscriptionManager::getSubscribedClientsLocked(
     return subscribedClients;
 }
 
+void SubscriptionManager::rebuildSubscriberIndexLocked() {
+    auto index = std::make_shared<SubscriberIndex>();
+    index->reserve(mPropToClients.size());
+    for (const auto& propClients : mPropToClients) {
+        std::vector<Subscriber>& subscribers = (*index)[propClients.first];
+        subscribers.reserve(propClients.second->size());
+        for (size_t i = 0; i < propClients.second->size(); i++) {
+            const sp<HalClient>& client = propClients.second->itemAt(i);
+            subscribers.push_back(Subscriber{
+                    .client = client, .flags = client->getSubscribeFlags(propClients.first)});
+        }
+    }
+    std::atomic_store(&mSubscriberIndex, std::shared_ptr<const SubscriberIndex>(index));
+}
+
+std::shared_ptr<const SubscriptionManager::SubscriberIndex>
+SubscriptionManager::getSubscriberIndex() const {
+    return std::atomic_load(&mSubscriberIndex);
+}
+
 bool SubscriptionManager::updateHalEventSubscriptionLocked(
         const SubscribeOptions &opts, SubscribeOptions *outUpdated) {
     bool updated = false;
@@ -265,6 +300,8 @@ void SubscriptionManager::unsubscribe(ClientId clientId,
         }
     }
 
+    rebuildSubscriberIndexLocked();
+
     if (propertyClients == nullptr || propertyClients->isEmpty()) {
         mHalEventSubscribeOptions.erase(propId);
         mOnPropertyUnsubscribed(propId);
@@ -18,6 +18,7 @@
 
 #include "VehicleHalManager.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <unordered_set>
@@ -48,6 +49,7 @@ using ::android::hardware::hidl_string;
 
 namespace {
 
+// The default batching window, vendors and the debug interface may change it.
 constexpr std::chrono::milliseconds kHalEventBatchingTimeWindow(10);
 
 const VehiclePropValue kEmptyValue{};
@@ -69,12 +71,6 @@ const std::unordered_set<std::string> kSetPropOptions = {
 
 }  // namespace
 
-/**
- * Indicates what's the maximum size of hidl_vec<VehiclePropValue> we want
- * to store in reusable object pool.
- */
-constexpr auto kMaxHidlVecOfVehiclePropValuePoolSize = 20;
-
 Return<void> VehicleHalManager::getAllPropConfigs(getAllPropConfigs_cb _hidl_cb) {
     ALOGI("getAllPropConfigs called");
     hidl_vec<VehiclePropConfig> hidlConfigs;
@@ -240,6 +236,18 @@ void VehicleHalManager::cmdDump(int fd, const hidl_vec<hidl_string>& options) {
         }
         // Ignore the return value for this.
         cmdSetOneProperty(fd, options);
+    } else if (EqualsIgnoreCase(option, "--batching-window")) {
+        if (!checkCallerHasWritePermissions(fd)) {
+            dprintf(fd, "Caller does not have write permission\n");
+            return;
+        }
+        cmdSetBatchingWindow(fd, options);
+    } else if (EqualsIgnoreCase(option, "--latest-value-only")) {
+        if (!checkCallerHasWritePermissions(fd)) {
+            dprintf(fd, "Caller does not have write permission\n");
+            return;
+        }
+        cmdSetLatestValueOnly(fd, options);
     } else {
         dprintf(fd, "Invalid option: %s\n", option.c_str());
     }
@@ -295,6 +303,38 @@ void VehicleHalManager::cmdHelp(int fd) const {
             "Notice that the string, bytes and area value can be set just once, while the other can"
             " have multiple values (so they're used in the respective array), "
             "BYTES_VALUE is in the form of 0xXXXX, e.g. 0xdeadbeef.\n");
+    dprintf(fd,
+            "--batching-window <MS>: sets how long HAL events are collected before they are "
+            "delivered to the clients\n");
+    dprintf(fd,
+            "--latest-value-only <PROP> <0|1>: sets whether only the newest value of each area "
+            "of PROP is delivered in a batch\n");
+}
+
+void VehicleHalManager::cmdSetBatchingWindow(int fd, const hidl_vec<hidl_string>& options) {
+    if (!checkArgumentsSize(fd, options, 2)) return;
+
+    int64_t windowMs;
+    if (!safelyParseInt(fd, 1, options[1], &windowMs) || windowMs < 0) {
+        dprintf(fd, "Invalid batching window: %s\n", options[1].c_str());
+        return;
+    }
+    setEventBatchingWindow(std::chrono::milliseconds(windowMs));
+    dprintf(fd, "Batching window set to %" PRId64 " ms\n", windowMs);
+}
+
+void VehicleHalManager::cmdSetLatestValueOnly(int fd, const hidl_vec<hidl_string>& options) {
+    if (!checkArgumentsSize(fd, options, 3)) return;
+
+    int32_t prop;
+    int32_t latestValueOnly;
+    if (!safelyParseInt(fd, 1, options[1], &prop) ||
+        !safelyParseInt(fd, 2, options[2], &latestValueOnly)) {
+        return;
+    }
+    setLatestValueOnly(prop, latestValueOnly != 0);
+    dprintf(fd, "Latest value only %s for property %d\n", latestValueOnly ? "set" : "cleared",
+            prop);
 }
 
 void VehicleHalManager::cmdListAllProperties(int fd) const {
@@ -414,8 +454,6 @@ bool VehicleHalManager::cmdSetOneProperty(int fd, const hidl_vec<hidl_string>& o
 void VehicleHalManager::init() {
     ALOGI("VehicleHalManager::init");
 
-    mHidlVecOfVehiclePropValuePool.resize(kMaxHidlVecOfVehiclePropValuePoolSize);
-
     mBatchingConsumer.run(&mEventQueue,
                           kHalEventBatchingTimeWindow,
                           std::bind(&VehicleHalManager::onBatchHalEvent,
@@ -429,6 +467,7 @@ void VehicleHalManager::init() {
     // Initialize index with vehicle configurations received from VehicleHal.
     auto supportedPropConfigs = mHal->listProperties();
     mConfigIndex.reset(new VehiclePropConfigIndex(supportedPropConfigs));
+    mConfigIndexReady.store(true, std::memory_order_release);
 
     std::vector<int32_t> supportedProperties(
         supportedPropConfigs.size());
@@ -447,7 +486,14 @@ VehicleHalManager::~VehicleHalManager() {
 }
 
 void VehicleHalManager::onHalEvent(VehiclePropValuePtr v) {
-    mEventQueue.push(std::move(v));
+    // A newer continuous value supersedes the older ones, so don't block the HAL event thread
+    // behind the consumer for them.
+    auto policy = ConcurrentRingQueue<VehiclePropValuePtr>::OverflowPolicy::BLOCK;
+    if (mConfigIndexReady.load(std::memory_order_acquire) && mConfigIndex->hasConfig(v->prop) &&
+        mConfigIndex->getConfig(v->prop).changeMode == VehiclePropertyChangeMode::CONTINUOUS) {
+        policy = ConcurrentRingQueue<VehiclePropValuePtr>::OverflowPolicy::DROP_OLDEST;
+    }
+    mEventQueue.push(std::move(v), policy);
 }
 
 void VehicleHalManager::onHalPropertySetError(StatusCode errorCode,
@@ -462,22 +508,52 @@ void VehicleHalManager::onHalPropertySetError(StatusCode errorCode,
 }
 
 void VehicleHalManager::onBatchHalEvent(const std::vector<VehiclePropValuePtr>& values) {
-    const auto& clientValues =
-        mSubscriptionManager.distributeValuesToClients(values, SubscribeFlags::EVENTS_FROM_CAR);
+    mBatchValues.clear();
+    {
+        std::lock_guard<std::mutex> g(mLatestValueOnlyLock);
+        if (mLatestValueOnlyProps.empty()) {
+            for (const VehiclePropValuePtr& value : values) {
+                mBatchValues.push_back(value.get());
+            }
+        } else {
+            // Walk the batch from the newest value, keeping the first value of each area of the
+            // coalesced properties.
+            mLatestValueKeys.clear();
+            for (auto it = values.rbegin(); it != values.rend(); ++it) {
+                VehiclePropValue* value = it->get();
+                if (mLatestValueOnlyProps.count(value->prop)) {
+                    auto key = std::make_pair(value->prop, value->areaId);
+                    if (std::find(mLatestValueKeys.begin(), mLatestValueKeys.end(), key) !=
+                        mLatestValueKeys.end()) {
+                        continue;
+                    }
+                    mLatestValueKeys.push_back(key);
+                }
+                mBatchValues.push_back(value);
+            }
+            std::reverse(mBatchValues.begin(), mBatchValues.end());
+        }
+    }
+
+    const auto& clientValues = mSubscriptionManager.distributeValuesToClients(
+            mBatchValues, SubscribeFlags::EVENTS_FROM_CAR);
 
     for (const HalClientValues& cv : clientValues) {
         auto vecSize = cv.values.size();
-        hidl_vec<VehiclePropValue> vec;
-        if (vecSize < kMaxHidlVecOfVehiclePropValuePoolSize) {
-            vec.setToExternal(&mHidlVecOfVehiclePropValuePool[0], vecSize);
-        } else {
-            vec.resize(vecSize);
+        std::vector<VehiclePropValue>& buffer = cv.client->getEventBuffer();
+        if (buffer.size() < vecSize) {
+            // The entries are shallow copies of values recycled since, drop them rather than
+            // copying them over.
+            buffer.clear();
+            buffer.resize(vecSize);
         }
 
         int i = 0;
         for (VehiclePropValue* pValue : cv.values) {
-            shallowCopy(&(vec)[i++], *pValue);
+            shallowCopy(&buffer[i++], *pValue);
         }
+        hidl_vec<VehiclePropValue> vec;
+        vec.setToExternal(buffer.data(), vecSize);
         auto status = cv.client->getCallback()->onPropertyEvent(vec);
         if (!status.isOk()) {
             ALOGE("Failed to notify client %s, err: %s",
@@ -487,6 +563,19 @@ void VehicleHalManager::onBatchHalEvent(const std::vector<VehiclePropValuePtr>&
     }
 }
 
+void VehicleHalManager::setEventBatchingWindow(std::chrono::nanoseconds window) {
+    mBatchingConsumer.setBatchInterval(window);
+}
+
+void VehicleHalManager::setLatestValueOnly(int32_t propId, bool latestValueOnly) {
+    std::lock_guard<std::mutex> g(mLatestValueOnlyLock);
+    if (latestValueOnly) {
+        mLatestValueOnlyProps.insert(propId);
+    } else {
+        mLatestValueOnlyProps.erase(propId);
+    }
+}
+
 bool VehicleHalManager::isSampleRateFixed(VehiclePropertyChangeMode mode) {
     return (mode & VehiclePropertyChangeMode::ON_CHANGE);
 }
@@ -16,6 +16,9 @@
 
 #include "VmsUtils.h"
 
+#include <algorithm>
+#include <iterator>
+
 #include <common/include/vhal_v2_0/VehicleUtils.h>
 
 namespace android {
@@ -46,6 +49,28 @@ static constexpr int kAvailabilitySequenceNumberIndex =
 static constexpr int kFirstMessageType = toInt(VmsMessageType::SUBSCRIBE);
 static constexpr int kLastMessageType = toInt(VmsMessageType::START_SESSION);
 
+// Copies |values| into |dest|. hidl_vec reallocates on every resize, so a buffer that already
+// has the right size is written in place.
+template <typename T, typename InputIt>
+static void assignValues(hidl_vec<T>* dest, InputIt first, InputIt last) {
+    const size_t size = std::distance(first, last);
+    if (dest->size() != size) {
+        dest->resize(size);
+    }
+    std::copy(first, last, dest->data());
+}
+
+static void assignValues(hidl_vec<int32_t>* dest, std::initializer_list<int32_t> values) {
+    assignValues(dest, values.begin(), values.end());
+}
+
+VmsOfferedLayers::VmsOfferedLayers(const VmsOffers& offers) : publisher_id_(offers.publisher_id) {
+    layers_.reserve(offers.offerings.size());
+    for (const auto& offer : offers.offerings) {
+        layers_.insert(offer.layer);
+    }
+}
+
 std::unique_ptr<VehiclePropValue> createBaseVmsMessage(size_t message_size) {
     auto result = createVehiclePropValue(VehiclePropertyType::INT32, message_size);
     result->prop = toInt(VehicleProperty::VEHICLE_MAP_SERVICE);
@@ -55,33 +80,35 @@ std::unique_ptr<VehiclePropValue> createBaseVmsMessage(size_t message_size) {
 
 std::unique_ptr<VehiclePropValue> createSubscribeMessage(const VmsLayer& layer) {
     auto result = createBaseVmsMessage(kMessageTypeSize + kLayerSize);
-    result->value.int32Values = hidl_vec<int32_t>{toInt(VmsMessageType::SUBSCRIBE), layer.type,
-                                                  layer.subtype, layer.version};
+    assignValues(&result->value.int32Values,
+                 {toInt(VmsMessageType::SUBSCRIBE), layer.type, layer.subtype, layer.version});
     return result;
 }
 
 std::unique_ptr<VehiclePropValue> createSubscribeToPublisherMessage(
     const VmsLayerAndPublisher& layer_publisher) {
     auto result = createBaseVmsMessage(kMessageTypeSize + kLayerAndPublisherSize);
-    result->value.int32Values = hidl_vec<int32_t>{
-        toInt(VmsMessageType::SUBSCRIBE_TO_PUBLISHER), layer_publisher.layer.type,
-        layer_publisher.layer.subtype, layer_publisher.layer.version, layer_publisher.publisher_id};
+    assignValues(&result->value.int32Values,
+                 {toInt(VmsMessageType::SUBSCRIBE_TO_PUBLISHER), layer_publisher.layer.type,
+                  layer_publisher.layer.subtype, layer_publisher.layer.version,
+                  layer_publisher.publisher_id});
     return result;
 }
 
 std::unique_ptr<VehiclePropValue> createUnsubscribeMessage(const VmsLayer& layer) {
     auto result = createBaseVmsMessage(kMessageTypeSize + kLayerSize);
-    result->value.int32Values = hidl_vec<int32_t>{toInt(VmsMessageType::UNSUBSCRIBE), layer.type,
-                                                  layer.subtype, layer.version};
+    assignValues(&result->value.int32Values,
+                 {toInt(VmsMessageType::UNSUBSCRIBE), layer.type, layer.subtype, layer.version});
     return result;
 }
 
 std::unique_ptr<VehiclePropValue> createUnsubscribeToPublisherMessage(
     const VmsLayerAndPublisher& layer_publisher) {
     auto result = createBaseVmsMessage(kMessageTypeSize + kLayerAndPublisherSize);
-    result->value.int32Values = hidl_vec<int32_t>{
-        toInt(VmsMessageType::UNSUBSCRIBE_TO_PUBLISHER), layer_publisher.layer.type,
-        layer_publisher.layer.subtype, layer_publisher.layer.version, layer_publisher.publisher_id};
+    assignValues(&result->value.int32Values,
+                 {toInt(VmsMessageType::UNSUBSCRIBE_TO_PUBLISHER), layer_publisher.layer.type,
+                  layer_publisher.layer.subtype, layer_publisher.layer.version,
+                  layer_publisher.publisher_id});
     return result;
 }
 
@@ -92,69 +119,68 @@ std::unique_ptr<VehiclePropValue> createOfferingMessage(const VmsOffers& offers)
     }
     auto result = createBaseVmsMessage(message_size);
 
-    std::vector<int32_t> offerings = {toInt(VmsMessageType::OFFERING), offers.publisher_id,
-                                      static_cast<int>(offers.offerings.size())};
+    int32_t* values = result->value.int32Values.data();
+    *values++ = toInt(VmsMessageType::OFFERING);
+    *values++ = offers.publisher_id;
+    *values++ = static_cast<int32_t>(offers.offerings.size());
     for (const auto& offer : offers.offerings) {
-        std::vector<int32_t> layer_vector = {offer.layer.type, offer.layer.subtype,
-                                             offer.layer.version,
-                                             static_cast<int32_t>(offer.dependencies.size())};
+        *values++ = offer.layer.type;
+        *values++ = offer.layer.subtype;
+        *values++ = offer.layer.version;
+        *values++ = static_cast<int32_t>(offer.dependencies.size());
         for (const auto& dependency : offer.dependencies) {
-            std::vector<int32_t> dependency_layer = {dependency.type, dependency.subtype,
-                                                     dependency.version};
-            layer_vector.insert(layer_vector.end(), dependency_layer.begin(),
-                                dependency_layer.end());
+            *values++ = dependency.type;
+            *values++ = dependency.subtype;
+            *values++ = dependency.version;
         }
-        offerings.insert(offerings.end(), layer_vector.begin(), layer_vector.end());
     }
-    result->value.int32Values = offerings;
     return result;
 }
 
 std::unique_ptr<VehiclePropValue> createAvailabilityRequest() {
     auto result = createBaseVmsMessage(kMessageTypeSize);
-    result->value.int32Values = hidl_vec<int32_t>{
-        toInt(VmsMessageType::AVAILABILITY_REQUEST),
-    };
+    assignValues(&result->value.int32Values, {toInt(VmsMessageType::AVAILABILITY_REQUEST)});
     return result;
 }
 
 std::unique_ptr<VehiclePropValue> createSubscriptionsRequest() {
     auto result = createBaseVmsMessage(kMessageTypeSize);
-    result->value.int32Values = hidl_vec<int32_t>{
-        toInt(VmsMessageType::SUBSCRIPTIONS_REQUEST),
-    };
+    assignValues(&result->value.int32Values, {toInt(VmsMessageType::SUBSCRIPTIONS_REQUEST)});
     return result;
 }
 
 std::unique_ptr<VehiclePropValue> createDataMessageWithLayerPublisherInfo(
         const VmsLayerAndPublisher& layer_publisher, const std::string& vms_packet) {
     auto result = createBaseVmsMessage(kMessageTypeSize + kLayerAndPublisherSize);
-    result->value.int32Values = hidl_vec<int32_t>{
-            toInt(VmsMessageType::DATA), layer_publisher.layer.type, layer_publisher.layer.subtype,
-            layer_publisher.layer.version, layer_publisher.publisher_id};
-    result->value.bytes = std::vector<uint8_t>(vms_packet.begin(), vms_packet.end());
+    fillDataMessageWithLayerPublisherInfo(layer_publisher, vms_packet, result.get());
     return result;
 }
 
+void fillDataMessageWithLayerPublisherInfo(const VmsLayerAndPublisher& layer_publisher,
+                                           std::string_view vms_packet, VehiclePropValue* message) {
+    message->prop = toInt(VehicleProperty::VEHICLE_MAP_SERVICE);
+    message->areaId = toInt(VehicleArea::GLOBAL);
+    assignValues(&message->value.int32Values,
+                 {toInt(VmsMessageType::DATA), layer_publisher.layer.type,
+                  layer_publisher.layer.subtype, layer_publisher.layer.version,
+                  layer_publisher.publisher_id});
+    assignValues(&message->value.bytes, vms_packet.begin(), vms_packet.end());
+}
+
 std::unique_ptr<VehiclePropValue> createPublisherIdRequest(
         const std::string& vms_provider_description) {
     auto result = createBaseVmsMessage(kMessageTypeSize);
-    result->value.int32Values = hidl_vec<int32_t>{
-            toInt(VmsMessageType::PUBLISHER_ID_REQUEST),
-    };
-    result->value.bytes =
-            std::vector<uint8_t>(vms_provider_description.begin(), vms_provider_description.end());
+    assignValues(&result->value.int32Values, {toInt(VmsMessageType::PUBLISHER_ID_REQUEST)});
+    assignValues(&result->value.bytes, vms_provider_description.begin(),
+                 vms_provider_description.end());
     return result;
 }
 
 std::unique_ptr<VehiclePropValue> createStartSessionMessage(const int service_id,
                                                             const int client_id) {
     auto result = createBaseVmsMessage(kMessageTypeSize + kSessionIdsSize);
-    result->value.int32Values = hidl_vec<int32_t>{
-            toInt(VmsMessageType::START_SESSION),
-            service_id,
-            client_id,
-    };
+    assignValues(&result->value.int32Values,
+                 {toInt(VmsMessageType::START_SESSION), service_id, client_id});
     return result;
 }
 
@@ -177,11 +203,16 @@ VmsMessageType parseMessageType(const VehiclePropValue& value) {
 }
 
 std::string parseData(const VehiclePropValue& value) {
+    return std::string(parseDataView(value));
+}
+
+std::string_view parseDataView(const VehiclePropValue& value) {
     if (isValidVmsMessage(value) && parseMessageType(value) == VmsMessageType::DATA &&
         value.value.bytes.size() > 0) {
-        return std::string(value.value.bytes.begin(), value.value.bytes.end());
+        return std::string_view(reinterpret_cast<const char*>(value.value.bytes.data()),
+                                value.value.bytes.size());
     } else {
-        return std::string();
+        return std::string_view();
     }
 }
 
@@ -216,18 +247,21 @@ int32_t getSequenceNumberForSubscriptionsState(const VehiclePropValue& subscript
 
 std::vector<VmsLayer> getSubscribedLayers(const VehiclePropValue& subscriptions_state,
                                           const VmsOffers& offers) {
+    std::vector<VmsLayer> subscribed_layers;
+    getSubscribedLayers(subscriptions_state, VmsOfferedLayers(offers), &subscribed_layers);
+    return subscribed_layers;
+}
+
+void getSubscribedLayers(const VehiclePropValue& subscriptions_state,
+                         const VmsOfferedLayers& offered_layers,
+                         std::vector<VmsLayer>* subscribed_layers) {
+    subscribed_layers->clear();
     if (isValidVmsMessage(subscriptions_state) &&
         (parseMessageType(subscriptions_state) == VmsMessageType::SUBSCRIPTIONS_CHANGE ||
          parseMessageType(subscriptions_state) == VmsMessageType::SUBSCRIPTIONS_RESPONSE) &&
         subscriptions_state.value.int32Values.size() >
                 toInt(VmsSubscriptionsStateIntegerValuesIndex::NUMBER_OF_LAYERS)) {
         int subscriptions_state_int_size = subscriptions_state.value.int32Values.size();
-        std::unordered_set<VmsLayer, VmsLayer::VmsLayerHashFunction> offered_layers;
-        for (const auto& offer : offers.offerings) {
-            offered_layers.insert(offer.layer);
-        }
-        std::vector<VmsLayer> subscribed_layers;
-
         int current_index = toInt(VmsSubscriptionsStateIntegerValuesIndex::SUBSCRIPTIONS_START);
 
         // Add all subscribed layers which are offered by the current publisher.
@@ -235,13 +269,14 @@ std::vector<VmsLayer> getSubscribedLayers(const VehiclePropValue& subscriptions_
                 VmsSubscriptionsStateIntegerValuesIndex::NUMBER_OF_LAYERS)];
         for (int i = 0; i < num_of_layers; i++) {
             if (subscriptions_state_int_size < current_index + kLayerSize) {
-                return {};
+                subscribed_layers->clear();
+                return;
             }
             VmsLayer layer = VmsLayer(subscriptions_state.value.int32Values[current_index],
                                       subscriptions_state.value.int32Values[current_index + 1],
                                       subscriptions_state.value.int32Values[current_index + 2]);
-            if (offered_layers.find(layer) != offered_layers.end()) {
-                subscribed_layers.push_back(std::move(layer));
+            if (offered_layers.contains(layer)) {
+                subscribed_layers->push_back(layer);
             }
             current_index += kLayerSize;
         }
@@ -256,13 +291,14 @@ std::vector<VmsLayer> getSubscribedLayers(const VehiclePropValue& subscriptions_
 
             for (int i = 0; i < num_of_associated_layers; i++) {
                 if (subscriptions_state_int_size < current_index + kLayerSize) {
-                    return {};
+                    subscribed_layers->clear();
+                    return;
                 }
                 VmsLayer layer = VmsLayer(subscriptions_state.value.int32Values[current_index],
                                           subscriptions_state.value.int32Values[current_index + 1],
                                           subscriptions_state.value.int32Values[current_index + 2]);
                 current_index += kLayerSize;
-                if (offered_layers.find(layer) != offered_layers.end() &&
+                if (offered_layers.contains(layer) &&
                     subscriptions_state_int_size > current_index) {
                     int32_t num_of_publisher_ids =
                             subscriptions_state.value.int32Values[current_index];
@@ -270,17 +306,15 @@ std::vector<VmsLayer> getSubscribedLayers(const VehiclePropValue& subscriptions_
                     for (int j = 0; j < num_of_publisher_ids; j++) {
                         if (subscriptions_state_int_size > current_index &&
                             subscriptions_state.value.int32Values[current_index] ==
-                                    offers.publisher_id) {
-                            subscribed_layers.push_back(std::move(layer));
+                                    offered_layers.publisher_id()) {
+                            subscribed_layers->push_back(layer);
                         }
                         current_index++;
                     }
                 }
             }
         }
-        return subscribed_layers;
     }
-    return {};
 }
 
 bool hasServiceNewlyStarted(const VehiclePropValue& availability_change) {
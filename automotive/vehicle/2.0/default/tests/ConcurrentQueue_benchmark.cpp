@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+#include "vhal_v2_0/ConcurrentQueue.h"
+#include "vhal_v2_0/ConcurrentRingQueue.h"
+
+namespace android {
+
+namespace {
+
+// The same size as the VehicleHalManager event queue.
+constexpr size_t RING_CAPACITY = 4096;
+
+template <typename Queue>
+std::unique_ptr<Queue> createQueue();
+
+template <>
+std::unique_ptr<ConcurrentQueue<int64_t>> createQueue() {
+    return std::make_unique<ConcurrentQueue<int64_t>>();
+}
+
+template <>
+std::unique_ptr<ConcurrentRingQueue<int64_t>> createQueue() {
+    return std::make_unique<ConcurrentRingQueue<int64_t>>(RING_CAPACITY);
+}
+
+// All the benchmark threads are producers, the same as hardware event threads. One consumer thread
+// drains the queue in the background, the same as the batching consumer.
+template <typename Queue>
+class QueueBenchmark : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State& state) override {
+        if (state.thread_index != 0) {
+            return;
+        }
+        mQueue = createQueue<Queue>();
+        mStopped = false;
+        mConsumerThread = std::thread([this] {
+            while (!mStopped) {
+                mQueue->waitForItems();
+                benchmark::DoNotOptimize(mQueue->flush());
+            }
+        });
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        if (state.thread_index != 0) {
+            return;
+        }
+        mStopped = true;
+        mQueue->deactivate();
+        mConsumerThread.join();
+        mQueue.reset();
+    }
+
+  protected:
+    std::unique_ptr<Queue> mQueue;
+
+  private:
+    std::atomic<bool> mStopped;
+    std::thread mConsumerThread;
+};
+
+BENCHMARK_TEMPLATE_DEFINE_F(QueueBenchmark, BM_ConcurrentQueuePush, ConcurrentQueue<int64_t>)
+(benchmark::State& state) {
+    int64_t value = 0;
+    for (auto _ : state) {
+        mQueue->push(value++);
+    }
+}
+BENCHMARK_REGISTER_F(QueueBenchmark, BM_ConcurrentQueuePush)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_TEMPLATE_DEFINE_F(QueueBenchmark, BM_ConcurrentRingQueuePushBlock,
+                            ConcurrentRingQueue<int64_t>)
+(benchmark::State& state) {
+    int64_t value = 0;
+    for (auto _ : state) {
+        mQueue->push(value++, ConcurrentRingQueue<int64_t>::OverflowPolicy::BLOCK);
+    }
+}
+BENCHMARK_REGISTER_F(QueueBenchmark, BM_ConcurrentRingQueuePushBlock)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+BENCHMARK_TEMPLATE_DEFINE_F(QueueBenchmark, BM_ConcurrentRingQueuePushDropOldest,
+                            ConcurrentRingQueue<int64_t>)
+(benchmark::State& state) {
+    int64_t value = 0;
+    for (auto _ : state) {
+        mQueue->push(value++, ConcurrentRingQueue<int64_t>::OverflowPolicy::DROP_OLDEST);
+    }
+}
+BENCHMARK_REGISTER_F(QueueBenchmark, BM_ConcurrentRingQueuePushDropOldest)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+}  // namespace
+
+}  // namespace android
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "vhal_v2_0/ConcurrentRingQueue.h"
+
+namespace android {
+
+namespace {
+
+using Policy = ConcurrentRingQueue<int>::OverflowPolicy;
+
+TEST(ConcurrentRingQueueTest, dropOldest) {
+    ConcurrentRingQueue<int> queue(4);
+
+    for (int i = 0; i < 6; i++) {
+        queue.push(std::move(i), Policy::DROP_OLDEST);
+    }
+
+    ASSERT_EQ(std::vector<int>({2, 3, 4, 5}), queue.flush());
+    ASSERT_EQ(2u, queue.getDroppedCount());
+}
+
+TEST(ConcurrentRingQueueTest, dropOldestKeepsBlockingItems) {
+    ConcurrentRingQueue<int> queue(4);
+
+    // An on-change event followed by continuous events.
+    queue.push(100, Policy::BLOCK);
+    for (int i = 0; i < 6; i++) {
+        queue.push(std::move(i), Policy::DROP_OLDEST);
+    }
+
+    ASSERT_EQ(std::vector<int>({100, 2, 3, 4, 5}), queue.flush());
+    ASSERT_EQ(2u, queue.getDroppedCount());
+}
+
+TEST(ConcurrentRingQueueTest, dropOldestKeepsNewestBehindFullBlockingItems) {
+    ConcurrentRingQueue<int> queue(2);
+
+    queue.push(100, Policy::BLOCK);
+    queue.push(101, Policy::BLOCK);
+    for (int i = 0; i < 3; i++) {
+        queue.push(std::move(i), Policy::DROP_OLDEST);
+    }
+
+    ASSERT_EQ(std::vector<int>({100, 101, 1, 2}), queue.flush());
+    ASSERT_EQ(1u, queue.getDroppedCount());
+}
+
+TEST(ConcurrentRingQueueTest, dropOldestAfterBlockingItemIsConsumed) {
+    ConcurrentRingQueue<int> queue(2);
+
+    queue.push(100, Policy::BLOCK);
+    queue.push(0, Policy::DROP_OLDEST);
+    ASSERT_EQ(std::vector<int>({100, 0}), queue.flush());
+
+    for (int i = 1; i < 4; i++) {
+        queue.push(std::move(i), Policy::DROP_OLDEST);
+    }
+
+    ASSERT_EQ(std::vector<int>({2, 3}), queue.flush());
+    ASSERT_EQ(1u, queue.getDroppedCount());
+}
+
+TEST(ConcurrentRingQueueTest, blockWaitsForConsumer) {
+    ConcurrentRingQueue<int> queue(2);
+    queue.push(0, Policy::BLOCK);
+    queue.push(1, Policy::BLOCK);
+
+    std::atomic<bool> pushed = false;
+    std::thread producer([&queue, &pushed] {
+        queue.push(2, Policy::BLOCK);
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_FALSE(pushed);
+    ASSERT_EQ(std::vector<int>({0, 1}), queue.flush());
+
+    producer.join();
+    ASSERT_EQ(std::vector<int>({2}), queue.flush());
+    ASSERT_EQ(0u, queue.getDroppedCount());
+}
+
+TEST(ConcurrentRingQueueTest, blockIsNotStarvedByDropOldest) {
+    ConcurrentRingQueue<int> queue(2);
+    queue.push(0, Policy::BLOCK);
+    queue.push(1, Policy::BLOCK);
+
+    std::atomic<bool> pushed = false;
+    std::thread producer([&queue, &pushed] {
+        queue.push(2, Policy::BLOCK);
+        pushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(std::vector<int>({0, 1}), queue.flush());
+    // Continuous events keep coming before the blocked producer wakes up.
+    for (int i = 0; i < 8; i++) {
+        queue.push(100 + i, Policy::DROP_OLDEST);
+    }
+
+    for (int i = 0; i < 100 && !pushed; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    bool wasPushed = pushed;
+    queue.deactivate();
+    producer.join();
+    ASSERT_TRUE(wasPushed);
+}
+
+TEST(ConcurrentRingQueueTest, multipleProducers) {
+    constexpr size_t kNumPushes = 1000;
+    ConcurrentRingQueue<int> queue(8);
+    std::vector<int> results;
+
+    std::thread blocking([&queue] {
+        for (size_t i = 0; i < kNumPushes; i++) {
+            queue.push(0, Policy::BLOCK);
+        }
+    });
+    std::thread dropping([&queue] {
+        for (size_t i = 0; i < kNumPushes; i++) {
+            queue.push(1, Policy::DROP_OLDEST);
+        }
+    });
+    // Every item is either consumed or dropped, the latter counted once it left the queue.
+    while (results.size() + queue.getDroppedCount() < 2 * kNumPushes) {
+        queue.waitForItems();
+        for (int i : queue.flush()) {
+            results.push_back(i);
+        }
+    }
+    blocking.join();
+    dropping.join();
+
+    size_t blockingCount = 0;
+    for (int i : results) {
+        if (i == 0) {
+            blockingCount++;
+        }
+    }
+    ASSERT_EQ(kNumPushes, blockingCount);
+    ASSERT_EQ(2 * kNumPushes, results.size() + queue.getDroppedCount());
+}
+
+TEST(ConcurrentRingQueueTest, deactivateWakesWaitingThreads) {
+    ConcurrentRingQueue<int> queue(2);
+    queue.push(0, Policy::BLOCK);
+    queue.push(1, Policy::BLOCK);
+    std::thread producer([&queue] {
+        // Blocks until the queue is deactivated since it is full.
+        queue.push(2, Policy::BLOCK);
+    });
+
+    ConcurrentRingQueue<int> emptyQueue(2);
+    std::thread consumer([&emptyQueue] {
+        // Blocks until the queue is deactivated since it is empty.
+        emptyQueue.waitForItems();
+    });
+
+    queue.deactivate();
+    emptyQueue.deactivate();
+    producer.join();
+    consumer.join();
+}
+
+}  // namespace
+
+}  // namespace android
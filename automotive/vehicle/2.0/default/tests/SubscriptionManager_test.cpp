@@ -112,6 +112,36 @@ TEST_F(SubscriptionManagerTest, multipleClients) {
     ASSERT_ALL_EXISTS({cb1, cb2}, extractCallbacks(clients));
 }
 
+TEST_F(SubscriptionManagerTest, distributeValues) {
+    std::list<SubscribeOptions> updatedOptions;
+    ASSERT_EQ(StatusCode::OK,
+              manager.addOrUpdateSubscription(1, cb1, subscrToProp1, &updatedOptions));
+    ASSERT_EQ(StatusCode::OK,
+              manager.addOrUpdateSubscription(2, cb2, subscrToProp1and2, &updatedOptions));
+
+    VehiclePropValue value1{.prop = PROP1};
+    VehiclePropValue value2{.prop = PROP2};
+    VehiclePropValue unsubscribedValue{.prop = toInt(VehicleProperty::AP_POWER_BOOTUP_REASON)};
+    auto clientValues = manager.distributeValuesToClients(
+            {&value1, &unsubscribedValue, &value2}, SubscribeFlags::EVENTS_FROM_CAR);
+
+    ASSERT_EQ(2u, clientValues.size());
+    for (const HalClientValues& cv : clientValues) {
+        if (cv.client->getCallback() == cb1) {
+            ASSERT_EQ(std::vector<VehiclePropValue*>({&value1}), cv.values);
+        } else {
+            ASSERT_EQ(cb2, cv.client->getCallback());
+            ASSERT_EQ(std::vector<VehiclePropValue*>({&value1, &value2}), cv.values);
+        }
+    }
+
+    // Unsubscribed clients no longer get the values.
+    manager.unsubscribe(2, PROP1);
+    clientValues = manager.distributeValuesToClients({&value1}, SubscribeFlags::EVENTS_FROM_CAR);
+    ASSERT_EQ(1u, clientValues.size());
+    ASSERT_EQ(cb1, clientValues[0].client->getCallback());
+}
+
 TEST_F(SubscriptionManagerTest, negativeCases) {
     std::list<SubscribeOptions> updatedOptions;
     ASSERT_EQ(StatusCode::OK,
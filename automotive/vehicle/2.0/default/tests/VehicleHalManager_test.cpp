@@ -299,6 +299,34 @@ TEST_F(VehicleHalManagerTest, subscribe) {
               toString(cb->getReceivedEvents().front()[0]));
 }
 
+TEST_F(VehicleHalManagerTest, subscribe_LatestValueOnly) {
+    const auto PROP = toInt(VehicleProperty::DISPLAY_BRIGHTNESS);
+
+    sp<MockedVehicleCallback> cb = new MockedVehicleCallback();
+
+    hidl_vec<SubscribeOptions> options = {
+        SubscribeOptions{.propId = PROP, .flags = SubscribeFlags::EVENTS_FROM_CAR}};
+
+    StatusCode res = manager->subscribe(cb, options);
+    ASSERT_EQ(StatusCode::OK, res);
+
+    // Make sure all the values end up in the same batch.
+    manager->setEventBatchingWindow(std::chrono::milliseconds(200));
+    manager->setLatestValueOnly(PROP, true);
+
+    for (int32_t brightness : {10, 20, 30}) {
+        auto value = objectPool->obtain(VehiclePropertyType::INT32);
+        value->prop = PROP;
+        value->value.int32Values[0] = brightness;
+        hal->sendPropEvent(std::move(value));
+    }
+
+    ASSERT_TRUE(cb->waitForExpectedEvents(1));
+    const auto& values = cb->getReceivedEvents().front();
+    ASSERT_EQ(1u, values.size());
+    ASSERT_EQ(30, values[0].value.int32Values[0]);
+}
+
 TEST_F(VehicleHalManagerTest, subscribe_WriteOnly) {
     const auto PROP = toInt(VehicleProperty::HVAC_SEAT_TEMPERATURE);
 
@@ -161,6 +161,34 @@ TEST(VmsUtilsTest, dataMessage) {
     EXPECT_EQ(memcmp(message->value.bytes.data(), bytes.data(), bytes.size()), 0);
 }
 
+TEST(VmsUtilsTest, fillDataMessageReusesBuffers) {
+    const std::string bytes = "aaa";
+    VehiclePropValue message;
+    fillDataMessageWithLayerPublisherInfo(VmsLayerAndPublisher(VmsLayer(2, 0, 1), 123), bytes,
+                                          &message);
+    const int32_t* int32_values = message.value.int32Values.data();
+    const uint8_t* byte_values = message.value.bytes.data();
+
+    const std::string other_bytes = "bbb";
+    fillDataMessageWithLayerPublisherInfo(VmsLayerAndPublisher(VmsLayer(3, 1, 2), 456),
+                                          other_bytes, &message);
+    EXPECT_TRUE(isValidVmsMessage(message));
+    EXPECT_EQ(message.prop, toInt(VehicleProperty::VEHICLE_MAP_SERVICE));
+    EXPECT_EQ(parseMessageType(message), VmsMessageType::DATA);
+    EXPECT_EQ(message.value.int32Values.data(), int32_values);
+    EXPECT_EQ(message.value.bytes.data(), byte_values);
+
+    // Layer
+    EXPECT_EQ(message.value.int32Values[1], 3);
+    EXPECT_EQ(message.value.int32Values[2], 1);
+    EXPECT_EQ(message.value.int32Values[3], 2);
+
+    // Publisher ID
+    EXPECT_EQ(message.value.int32Values[4], 456);
+
+    EXPECT_EQ(parseData(message), other_bytes);
+}
+
 TEST(VmsUtilsTest, emptyMessageInvalid) {
     VehiclePropValue empty_prop;
     EXPECT_FALSE(isValidVmsMessage(empty_prop));
@@ -190,6 +218,21 @@ TEST(VmsUtilsTest, parseInvalidDataMessage) {
     EXPECT_TRUE(data_str.empty());
 }
 
+TEST(VmsUtilsTest, parseDataViewMessage) {
+    const std::string bytes = "aaa";
+    const VmsLayerAndPublisher layer_and_publisher(VmsLayer(1, 0, 1), 123);
+    auto message = createDataMessageWithLayerPublisherInfo(layer_and_publisher, bytes);
+    auto data = parseDataView(*message);
+    EXPECT_EQ(data, bytes);
+    EXPECT_EQ(static_cast<const void*>(data.data()), message->value.bytes.data());
+}
+
+TEST(VmsUtilsTest, parseInvalidDataViewMessage) {
+    VmsLayer layer(1, 0, 2);
+    auto message = createSubscribeMessage(layer);
+    EXPECT_TRUE(parseDataView(*message).empty());
+}
+
 TEST(VmsUtilsTest, publisherIdRequest) {
     std::string bytes = "pub_id";
     auto message = createPublisherIdRequest(bytes);
@@ -298,6 +341,12 @@ void testSubscribedLayers(VmsMessageType type) {
     EXPECT_EQ(static_cast<int>(result.size()), 2);
     EXPECT_EQ(result.at(0), VmsLayer(1, 0, 1));
     EXPECT_EQ(result.at(1), VmsLayer(2, 0, 1));
+
+    // The same layers from an index of the offers, into a vector that is reused.
+    const VmsOfferedLayers offered_layers(offers);
+    std::vector<VmsLayer> indexed_result = {VmsLayer(9, 9, 9)};
+    getSubscribedLayers(*message, offered_layers, &indexed_result);
+    EXPECT_EQ(indexed_result, result);
 }
 
 TEST(VmsUtilsTest, subscribedLayersForChange) {
@@ -327,6 +376,17 @@ TEST(VmsUtilsTest, subscribedLayersForMalformedResponse) {
     testGetSubscribedLayersMalformedData(VmsMessageType::SUBSCRIPTIONS_RESPONSE);
 }
 
+TEST(VmsUtilsTest, offeredLayersMatchWholeLayer) {
+    const VmsOfferedLayers offered_layers({123, {VmsLayerOffering(VmsLayer(1, 2, 3))}});
+    EXPECT_EQ(offered_layers.publisher_id(), 123);
+    EXPECT_TRUE(offered_layers.contains(VmsLayer(1, 2, 3)));
+    EXPECT_FALSE(offered_layers.contains(VmsLayer(1, 2, 4)));
+    EXPECT_FALSE(offered_layers.contains(VmsLayer(1, 3, 3)));
+    EXPECT_FALSE(offered_layers.contains(VmsLayer(2, 2, 3)));
+    EXPECT_NE(VmsLayer::VmsLayerHashFunction()(VmsLayer(1, 2, 3)),
+              VmsLayer::VmsLayerHashFunction()(VmsLayer(1, 3, 2)));
+}
+
 void testSubscribedLayersWithDifferentSubtype(VmsMessageType type) {
     VmsOffers offers = {123, {VmsLayerOffering(VmsLayer(1, 0, 1))}};
     auto message = createBaseVmsMessage(7);
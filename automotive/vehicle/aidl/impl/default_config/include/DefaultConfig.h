@@ -66,7 +66,9 @@ struct ConfigDeclaration {
     std::map<int32_t, RawPropValues> initialAreaValues;
 };
 
-const std::vector<ConfigDeclaration> kVehicleProperties = {
+// Inline so that every translation unit including this header shares one table, instead of each
+// building its own copy during static initialization.
+inline const std::vector<ConfigDeclaration> kVehicleProperties = {
         {.config =
                  {
                          .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
@@ -20,6 +20,7 @@
 #include <VehicleHalTypes.h>
 
 #include <optional>
+#include <vector>
 
 namespace android {
 namespace hardware {
@@ -35,6 +36,19 @@ class FakeValueGenerator {
     // Returns the next event if there is one or {@code std::nullopt} if there is none.
     virtual std::optional<aidl::android::hardware::automotive::vehicle::VehiclePropValue>
     nextEvent() = 0;
+
+    // Returns the values to generate at the next tick, or an empty vector if there is none. The
+    // values are delivered together at the timestamp of the first one. Generators producing
+    // several values per tick should override this, by default it returns the next event.
+    virtual std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>
+    nextEvents() {
+        std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue> events;
+        auto maybeEvent = nextEvent();
+        if (maybeEvent.has_value()) {
+            events.push_back(std::move(maybeEvent.value()));
+        }
+        return events;
+    }
 };
 
 }  // namespace fake
@@ -24,12 +24,14 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <iostream>
 #include <mutex>
 #include <optional>
 #include <queue>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 namespace hardware {
@@ -40,13 +42,34 @@ namespace fake {
 // This is the scheduler for all VHAL event generators. It manages all generators and uses priority
 // queue to maintain generated events ordered by timestamp. The scheduler uses a single thread to
 // keep querying and updating the event queue to make sure events from all generators are produced
-// in order.
+// in order. Events of all generators that are due within kEventBatchingWindowInNano of each other
+// are delivered in one batch.
 class GeneratorHub {
   public:
     using OnHalEvent = std::function<void(
             const aidl::android::hardware::automotive::vehicle::VehiclePropValue& event)>;
+    using OnHalEvents = std::function<void(
+            const std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&
+                    events)>;
 
+    // Events due within this window of the soonest one are delivered together with it.
+    static constexpr int64_t kEventBatchingWindowInNano = 1'000'000;
+
+    // How far from their scheduled time the generated events were delivered.
+    struct Stats {
+        // The number of batches delivered and of events in them.
+        uint64_t batchCount = 0;
+        uint64_t eventCount = 0;
+        // The absolute difference between the scheduled and the actual delivery time of the
+        // events of a generator, measured once per generator and tick.
+        int64_t averageJitterInNano = 0;
+        int64_t maxJitterInNano = 0;
+    };
+
+    // Delivers the generated events one at a time.
     explicit GeneratorHub(OnHalEvent&& onHalEvent);
+    // Delivers the events generated in the same tick as one vector.
+    explicit GeneratorHub(OnHalEvents&& onHalEvents);
     ~GeneratorHub();
 
     // Register a new generator. The generator will be discarded if it could not produce next event.
@@ -57,16 +80,21 @@ class GeneratorHub {
     // function does nothing.
     void unregisterGenerator(int32_t generatorId);
 
+    Stats getStats();
+
   private:
+    // The events generated by one generator for one tick, due at the timestamp of the first one.
     struct VhalEvent {
         int32_t generatorId;
-        aidl::android::hardware::automotive::vehicle::VehiclePropValue val;
+        std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue> vals;
+
+        int64_t timestamp() const { return vals[0].timestamp; }
     };
 
     // Comparator used by priority queue to keep track of soonest event.
     struct GreaterByTime {
         bool operator()(const VhalEvent& lhs, const VhalEvent& rhs) const {
-            return lhs.val.timestamp > rhs.val.timestamp;
+            return lhs.timestamp() > rhs.timestamp();
         }
     };
 
@@ -74,7 +102,10 @@ class GeneratorHub {
     std::mutex mGeneratorsLock;
     std::unordered_map<int32_t, std::unique_ptr<FakeValueGenerator>> mGenerators
             GUARDED_BY(mGeneratorsLock);
-    OnHalEvent mOnHalEvent;
+    OnHalEvents mOnHalEvents;
+    Stats mStats GUARDED_BY(mGeneratorsLock);
+    int64_t mTotalJitterInNano GUARDED_BY(mGeneratorsLock) = 0;
+    uint64_t mJitterSampleCount GUARDED_BY(mGeneratorsLock) = 0;
     std::condition_variable mCond;
     std::thread mThread;
     std::atomic<bool> mShuttingDownFlag{false};
@@ -21,7 +21,10 @@
 
 #include <json/json.h>
 
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 namespace android {
@@ -35,13 +38,18 @@ class JsonFakeValueGenerator : public FakeValueGenerator {
     // Create a new JSON fake value generator. {@code request.value.stringValue} is the JSON file
     // name. {@code request.value.int32Values[1]} if exists, is the number of iterations. If
     // {@code int32Values} has less than 2 elements, number of iterations would be set to -1, which
-    // means iterate indefinitely.
+    // means iterate indefinitely. Files of at least {@code kStreamingFileSize} bytes are streamed.
     explicit JsonFakeValueGenerator(
             const aidl::android::hardware::automotive::vehicle::VehiclePropValue& request);
     // Create a new JSON fake value generator using the specified JSON file path. All the events
     // in the JSON file would be generated for number of {@code iteration}. If iteration is 0, no
     // value would be generated. If iteration is less than 0, it would iterate indefinitely.
     explicit JsonFakeValueGenerator(const std::string& path, int32_t iteration);
+    // Same as above, but if {@code streaming} is true, the events are read from the file while
+    // they are generated instead of being loaded up front, so only a bounded window of them is
+    // kept in memory. This is meant for long recorded traces. {@code getAllEvents} returns no
+    // events in this mode.
+    explicit JsonFakeValueGenerator(const std::string& path, int32_t iteration, bool streaming);
     // Create a new JSON fake value generator using the specified JSON file path. All the events
     // in the JSON file would be generated once.
     explicit JsonFakeValueGenerator(const std::string& path);
@@ -53,14 +61,30 @@ class JsonFakeValueGenerator : public FakeValueGenerator {
     const std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&
     getAllEvents();
 
+    // Requests for files at least this large generate their events in streaming mode.
+    static constexpr int64_t kStreamingFileSize = 8 * 1024 * 1024;
+    // The maximum number of events read ahead from the file in streaming mode.
+    static constexpr size_t kStreamingLookahead = 256;
+
   private:
     size_t mEventIndex = 0;
     std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue> mEvents;
     int64_t mLastEventTimestamp = 0;
+    // The timestamp in the file of the last generated event.
+    int64_t mLastTraceTimestamp = 0;
     int32_t mNumOfIterations = 0;
 
+    // Only used in streaming mode.
+    std::unique_ptr<std::ifstream> mStream;
+    std::streampos mStreamBegin;
+    std::unique_ptr<Json::CharReader> mJsonReader;
+    std::deque<aidl::android::hardware::automotive::vehicle::VehiclePropValue> mLookahead;
+
     void setBit(std::vector<uint8_t>& bytes, size_t idx);
-    void init(const std::string& path, int32_t iteration);
+    void init(const std::string& path, int32_t iteration, bool streaming);
+    void initStream(const std::string& path);
+    void rewindStream();
+    void fillLookahead();
 };
 
 }  // namespace fake
@@ -21,6 +21,10 @@
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -29,8 +33,18 @@ namespace fake {
 
 using ::android::base::ScopedLockAssertion;
 
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+
 GeneratorHub::GeneratorHub(OnHalEvent&& onHalEvent)
-    : mOnHalEvent(onHalEvent), mThread(&GeneratorHub::run, this) {}
+    : GeneratorHub([onHalEvent = std::move(onHalEvent)](
+                           const std::vector<VehiclePropValue>& events) {
+          for (const auto& event : events) {
+              onHalEvent(event);
+          }
+      }) {}
+
+GeneratorHub::GeneratorHub(OnHalEvents&& onHalEvents)
+    : mOnHalEvents(std::move(onHalEvents)), mThread(&GeneratorHub::run, this) {}
 
 GeneratorHub::~GeneratorHub() {
     mShuttingDownFlag.store(true);
@@ -43,13 +57,13 @@ GeneratorHub::~GeneratorHub() {
 void GeneratorHub::registerGenerator(int32_t id, std::unique_ptr<FakeValueGenerator> generator) {
     {
         std::scoped_lock<std::mutex> lockGuard(mGeneratorsLock);
-        auto maybeNextEvent = generator->nextEvent();
+        auto nextEvents = generator->nextEvents();
         // Register only if the generator can produce at least one event.
-        if (maybeNextEvent.has_value()) {
+        if (!nextEvents.empty()) {
             // Push the next event if it is a new generator
             if (mGenerators.find(id) == mGenerators.end()) {
                 ALOGI("%s: Registering new generator, id: %d", __func__, id);
-                mEventQueue.push({id, maybeNextEvent.value()});
+                mEventQueue.push({id, std::move(nextEvents)});
             }
             mGenerators[id] = std::move(generator);
             ALOGI("%s: Registered generator, id: %d", __func__, id);
@@ -67,7 +81,14 @@ void GeneratorHub::unregisterGenerator(int32_t id) {
     ALOGI("%s: Unregistered generator, id: %d", __func__, id);
 }
 
+GeneratorHub::Stats GeneratorHub::getStats() {
+    std::scoped_lock<std::mutex> lockGuard(mGeneratorsLock);
+    return mStats;
+}
+
 void GeneratorHub::run() {
+    std::vector<VehiclePropValue> batch;
+    std::vector<int32_t> firedIds;
     while (!mShuttingDownFlag.load()) {
         std::unique_lock<std::mutex> lock(mGeneratorsLock);
         ScopedLockAssertion lock_assertion(mGeneratorsLock);
@@ -83,10 +104,9 @@ void GeneratorHub::run() {
             break;
         }
 
-        const VhalEvent& curEvent = mEventQueue.top();
-        long currentTime = elapsedRealtimeNano();
-        long waitTime =
-                curEvent.val.timestamp > currentTime ? curEvent.val.timestamp - currentTime : 0;
+        int64_t currentTime = elapsedRealtimeNano();
+        int64_t eventTime = mEventQueue.top().timestamp();
+        int64_t waitTime = eventTime > currentTime ? eventTime - currentTime : 0;
         if (waitTime != 0) {
             // Wait until the soonest event happen
             if (mCond.wait_for(lock, std::chrono::nanoseconds(waitTime)) !=
@@ -97,22 +117,49 @@ void GeneratorHub::run() {
                 ALOGI("Something happened while waiting");
                 continue;
             }
+            currentTime = elapsedRealtimeNano();
         }
-        // Now it's time to handle current event.
-        mOnHalEvent(curEvent.val);
-        // Update queue by popping current event and producing next event from the same generator
-        int32_t id = curEvent.generatorId;
-        mEventQueue.pop();
-        if (mGenerators.find(id) != mGenerators.end()) {
-            auto maybeNextEvent = mGenerators[id]->nextEvent();
-            if (maybeNextEvent.has_value()) {
-                mEventQueue.push({id, maybeNextEvent.value()});
+
+        // Now it's time to handle current event, together with every other event due in the
+        // batching window. Each generator fires at most once per batch, so a generator with a zero
+        // interval could not keep the loop here forever.
+        batch.clear();
+        firedIds.clear();
+        while (!mEventQueue.empty() &&
+               mEventQueue.top().timestamp() <= currentTime + kEventBatchingWindowInNano) {
+            // The comparator only reads the timestamp, which moving the values leaves in place.
+            VhalEvent event = std::move(const_cast<VhalEvent&>(mEventQueue.top()));
+            mEventQueue.pop();
+            if (mGenerators.find(event.generatorId) == mGenerators.end()) {
                 continue;
             }
+            int64_t jitter = std::abs(currentTime - event.timestamp());
+            mTotalJitterInNano += jitter;
+            mJitterSampleCount++;
+            mStats.maxJitterInNano = std::max(mStats.maxJitterInNano, jitter);
+            std::move(event.vals.begin(), event.vals.end(), std::back_inserter(batch));
+            firedIds.push_back(event.generatorId);
+        }
+        if (!batch.empty()) {
+            mStats.batchCount++;
+            mStats.eventCount += batch.size();
+            mStats.averageJitterInNano = mTotalJitterInNano / mJitterSampleCount;
+            mOnHalEvents(batch);
         }
 
-        ALOGI("%s: Generator ended, unregister it, id: %d", __func__, id);
-        mGenerators.erase(id);
+        // Update queue by producing next event from the generators that fired
+        for (int32_t id : firedIds) {
+            if (mGenerators.find(id) != mGenerators.end()) {
+                auto nextEvents = mGenerators[id]->nextEvents();
+                if (!nextEvents.empty()) {
+                    mEventQueue.push({id, std::move(nextEvents)});
+                    continue;
+                }
+            }
+
+            ALOGI("%s: Generator ended, unregister it, id: %d", __func__, id);
+            mGenerators.erase(id);
+        }
     }
 }
 
@@ -18,6 +18,9 @@
 
 #include "JsonFakeValueGenerator.h"
 
+#include <sys/stat.h>
+
+#include <cctype>
 #include <fstream>
 #include <type_traits>
 #include <typeinfo>
@@ -99,6 +102,64 @@ std::vector<uint8_t> generateDiagnosticBytes(const RawPropValues& diagnosticValu
     return bytes;
 }
 
+std::optional<VehiclePropValue> parseFakeValueJsonEvent(const Json::Value& rawEvent) {
+    if (!rawEvent.isObject()) {
+        ALOGE("%s: VHAL JSON event should be an object, %s", __func__,
+              rawEvent.toStyledString().c_str());
+        return std::nullopt;
+    }
+    if (rawEvent["prop"].empty() || rawEvent["areaId"].empty() || rawEvent["value"].empty() ||
+        rawEvent["timestamp"].empty()) {
+        ALOGE("%s: VHAL JSON event has missing fields, skip it, %s", __func__,
+              rawEvent.toStyledString().c_str());
+        return std::nullopt;
+    }
+    VehiclePropValue event = {
+            .timestamp = rawEvent["timestamp"].asInt64(),
+            .areaId = rawEvent["areaId"].asInt(),
+            .prop = rawEvent["prop"].asInt(),
+    };
+
+    const Json::Value& rawEventValue = rawEvent["value"];
+    auto& value = event.value;
+    int32_t count;
+    switch (getPropType(event.prop)) {
+        case VehiclePropertyType::BOOLEAN:
+        case VehiclePropertyType::INT32:
+            value.int32Values.resize(1);
+            value.int32Values[0] = rawEventValue.asInt();
+            break;
+        case VehiclePropertyType::INT64:
+            value.int64Values.resize(1);
+            value.int64Values[0] = rawEventValue.asInt64();
+            break;
+        case VehiclePropertyType::FLOAT:
+            value.floatValues.resize(1);
+            value.floatValues[0] = rawEventValue.asFloat();
+            break;
+        case VehiclePropertyType::STRING:
+            value.stringValue = rawEventValue.asString();
+            break;
+        case VehiclePropertyType::INT32_VEC:
+            value.int32Values.resize(rawEventValue.size());
+            count = 0;
+            for (auto& it : rawEventValue) {
+                value.int32Values[count++] = it.asInt();
+            }
+            break;
+        case VehiclePropertyType::MIXED:
+            copyMixedValueJson(rawEventValue, value);
+            if (isDiagnosticProperty(event.prop)) {
+                value.byteValues = generateDiagnosticBytes(value);
+            }
+            break;
+        default:
+            ALOGE("%s: unsupported type for property: 0x%x", __func__, event.prop);
+            return std::nullopt;
+    }
+    return event;
+}
+
 std::vector<VehiclePropValue> parseFakeValueJson(std::istream& is) {
     std::vector<VehiclePropValue> fakeVhalEvents;
 
@@ -110,75 +171,78 @@ std::vector<VehiclePropValue> parseFakeValueJson(std::istream& is) {
         return fakeVhalEvents;
     }
 
-    for (Json::Value::ArrayIndex i = 0; i < rawEvents.size(); i++) {
-        Json::Value rawEvent = rawEvents[i];
-        if (!rawEvent.isObject()) {
-            ALOGE("%s: VHAL JSON event should be an object, %s", __func__,
-                  rawEvent.toStyledString().c_str());
-            continue;
-        }
-        if (rawEvent["prop"].empty() || rawEvent["areaId"].empty() || rawEvent["value"].empty() ||
-            rawEvent["timestamp"].empty()) {
-            ALOGE("%s: VHAL JSON event has missing fields, skip it, %s", __func__,
-                  rawEvent.toStyledString().c_str());
-            continue;
+    fakeVhalEvents.reserve(rawEvents.size());
+    for (const Json::Value& rawEvent : rawEvents) {
+        auto maybeEvent = parseFakeValueJsonEvent(rawEvent);
+        if (maybeEvent.has_value()) {
+            fakeVhalEvents.push_back(std::move(maybeEvent.value()));
         }
-        VehiclePropValue event = {
-                .timestamp = rawEvent["timestamp"].asInt64(),
-                .areaId = rawEvent["areaId"].asInt(),
-                .prop = rawEvent["prop"].asInt(),
-        };
-
-        Json::Value rawEventValue = rawEvent["value"];
-        auto& value = event.value;
-        int32_t count;
-        switch (getPropType(event.prop)) {
-            case VehiclePropertyType::BOOLEAN:
-            case VehiclePropertyType::INT32:
-                value.int32Values.resize(1);
-                value.int32Values[0] = rawEventValue.asInt();
-                break;
-            case VehiclePropertyType::INT64:
-                value.int64Values.resize(1);
-                value.int64Values[0] = rawEventValue.asInt64();
-                break;
-            case VehiclePropertyType::FLOAT:
-                value.floatValues.resize(1);
-                value.floatValues[0] = rawEventValue.asFloat();
-                break;
-            case VehiclePropertyType::STRING:
-                value.stringValue = rawEventValue.asString();
-                break;
-            case VehiclePropertyType::INT32_VEC:
-                value.int32Values.resize(rawEventValue.size());
-                count = 0;
-                for (auto& it : rawEventValue) {
-                    value.int32Values[count++] = it.asInt();
-                }
-                break;
-            case VehiclePropertyType::MIXED:
-                copyMixedValueJson(rawEventValue, value);
-                if (isDiagnosticProperty(event.prop)) {
-                    value.byteValues = generateDiagnosticBytes(value);
-                }
-                break;
-            default:
-                ALOGE("%s: unsupported type for property: 0x%x", __func__, event.prop);
-                continue;
-        }
-        fakeVhalEvents.push_back(event);
     }
     return fakeVhalEvents;
 }
 
+// Reads the text of the next element of the JSON array the stream is in, without parsing it.
+// Returns false once the end of the array or of the stream is reached.
+bool readJsonArrayElement(std::istream& is, std::string* element) {
+    element->clear();
+    char c;
+    // Skip the separator before the element.
+    while (is.get(c) && (std::isspace(static_cast<unsigned char>(c)) || c == ',')) {
+    }
+    if (!is || c == ']') {
+        return false;
+    }
+
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    do {
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+            }
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) {
+                // The end of the array, leave it for the next call.
+                is.unget();
+                break;
+            }
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            break;
+        }
+        element->push_back(c);
+    } while (is.get(c));
+    return true;
+}
+
+bool isLargeFile(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 &&
+           st.st_size >= JsonFakeValueGenerator::kStreamingFileSize;
+}
+
 }  // namespace
 
 JsonFakeValueGenerator::JsonFakeValueGenerator(const std::string& path) {
-    init(path, 1);
+    init(path, 1, /*streaming=*/false);
 }
 
 JsonFakeValueGenerator::JsonFakeValueGenerator(const std::string& path, int32_t iteration) {
-    init(path, iteration);
+    init(path, iteration, /*streaming=*/false);
+}
+
+JsonFakeValueGenerator::JsonFakeValueGenerator(const std::string& path, int32_t iteration,
+                                               bool streaming) {
+    init(path, iteration, streaming);
 }
 
 JsonFakeValueGenerator::JsonFakeValueGenerator(const VehiclePropValue& request) {
@@ -186,17 +250,66 @@ JsonFakeValueGenerator::JsonFakeValueGenerator(const VehiclePropValue& request)
     // Iterate infinitely if iteration number is not provided
     int32_t numOfIterations = v.int32Values.size() < 2 ? -1 : v.int32Values[1];
 
-    init(v.stringValue, numOfIterations);
+    init(v.stringValue, numOfIterations, isLargeFile(v.stringValue));
 }
 
-void JsonFakeValueGenerator::init(const std::string& path, int32_t iteration) {
+void JsonFakeValueGenerator::init(const std::string& path, int32_t iteration, bool streaming) {
+    mNumOfIterations = iteration;
+    if (streaming) {
+        initStream(path);
+        return;
+    }
     std::ifstream ifs(path);
     if (!ifs) {
         ALOGE("%s: couldn't open %s for parsing.", __func__, path.c_str());
         return;
     }
     mEvents = parseFakeValueJson(ifs);
-    mNumOfIterations = iteration;
+}
+
+void JsonFakeValueGenerator::initStream(const std::string& path) {
+    auto stream = std::make_unique<std::ifstream>(path);
+    if (!*stream) {
+        ALOGE("%s: couldn't open %s for parsing.", __func__, path.c_str());
+        return;
+    }
+    char c;
+    while (stream->get(c) && std::isspace(static_cast<unsigned char>(c))) {
+    }
+    if (!*stream || c != '[') {
+        ALOGE("%s: Failed to parse fake data JSON file %s. Error: not a JSON array", __func__,
+              path.c_str());
+        return;
+    }
+    mStreamBegin = stream->tellg();
+    mStream = std::move(stream);
+    mJsonReader.reset(Json::CharReaderBuilder().newCharReader());
+    fillLookahead();
+}
+
+void JsonFakeValueGenerator::rewindStream() {
+    mStream->clear();
+    mStream->seekg(mStreamBegin);
+    fillLookahead();
+}
+
+void JsonFakeValueGenerator::fillLookahead() {
+    std::string rawEventText;
+    while (mLookahead.size() < kStreamingLookahead &&
+           readJsonArrayElement(*mStream, &rawEventText)) {
+        Json::Value rawEvent;
+        std::string errorMessage;
+        if (!mJsonReader->parse(rawEventText.data(), rawEventText.data() + rawEventText.size(),
+                                &rawEvent, &errorMessage)) {
+            ALOGE("%s: Failed to parse fake data JSON event. Error: %s", __func__,
+                  errorMessage.c_str());
+            continue;
+        }
+        auto maybeEvent = parseFakeValueJsonEvent(rawEvent);
+        if (maybeEvent.has_value()) {
+            mLookahead.push_back(std::move(maybeEvent.value()));
+        }
+    }
 }
 
 const std::vector<VehiclePropValue>& JsonFakeValueGenerator::getAllEvents() {
@@ -204,11 +317,25 @@ const std::vector<VehiclePropValue>& JsonFakeValueGenerator::getAllEvents() {
 }
 
 std::optional<VehiclePropValue> JsonFakeValueGenerator::nextEvent() {
-    if (mNumOfIterations == 0 || mEvents.size() == 0) {
+    bool streaming = mStream != nullptr;
+    if (mNumOfIterations == 0 || (streaming ? mLookahead.empty() : mEvents.empty())) {
         return std::nullopt;
     }
 
-    VehiclePropValue generatedValue = mEvents[mEventIndex];
+    VehiclePropValue generatedValue;
+    bool lastInIteration;
+    if (streaming) {
+        generatedValue = std::move(mLookahead.front());
+        mLookahead.pop_front();
+        if (mLookahead.empty()) {
+            fillLookahead();
+        }
+        lastInIteration = mLookahead.empty();
+    } else {
+        generatedValue = mEvents[mEventIndex];
+        lastInIteration = mEventIndex + 1 == mEvents.size();
+    }
+    int64_t traceTimestamp = generatedValue.timestamp;
 
     if (mLastEventTimestamp == 0) {
         mLastEventTimestamp = elapsedRealtimeNano();
@@ -217,8 +344,7 @@ std::optional<VehiclePropValue> JsonFakeValueGenerator::nextEvent() {
         if (mEventIndex > 0) {
             // All events (start from 2nd one) are supposed to happen in the future with a delay
             // equals to the duration between previous and current event.
-            nextEventTime = mLastEventTimestamp +
-                            (mEvents[mEventIndex].timestamp - mEvents[mEventIndex - 1].timestamp);
+            nextEventTime = mLastEventTimestamp + (traceTimestamp - mLastTraceTimestamp);
         } else {
             // We are starting another iteration, immediately send the next event after 1ms.
             nextEventTime = mLastEventTimestamp + 1000000;
@@ -227,13 +353,17 @@ std::optional<VehiclePropValue> JsonFakeValueGenerator::nextEvent() {
         assert(nextEventTime > mLastEventTimestamp);
         mLastEventTimestamp = nextEventTime;
     }
+    mLastTraceTimestamp = traceTimestamp;
 
     mEventIndex++;
-    if (mEventIndex == mEvents.size()) {
+    if (lastInIteration) {
         mEventIndex = 0;
         if (mNumOfIterations > 0) {
             mNumOfIterations--;
         }
+        if (streaming && mNumOfIterations != 0) {
+            rewindStream();
+        }
     }
 
     generatedValue.timestamp = mLastEventTimestamp;
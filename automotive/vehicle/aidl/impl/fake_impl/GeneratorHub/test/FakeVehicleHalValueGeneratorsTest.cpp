@@ -169,6 +169,44 @@ TEST_F(FakeVehicleHalValueGeneratorsTest, testUnregisterGeneratorStopGeneration)
             << "Must stop generating event after generator is unregistered";
 }
 
+TEST_F(FakeVehicleHalValueGeneratorsTest, testBatchEventsInSameTick) {
+    std::mutex batchesLock;
+    std::condition_variable batchesCv;
+    std::vector<std::vector<VehiclePropValue>> batches;
+    auto hub = std::make_unique<GeneratorHub>([&](const std::vector<VehiclePropValue>& events) {
+        {
+            std::scoped_lock<std::mutex> lockGuard(batchesLock);
+            batches.push_back(events);
+        }
+        batchesCv.notify_all();
+    });
+
+    // Both generators fire in the same tick, far enough in the future for both to be registered.
+    int64_t timestamp = elapsedRealtimeNano() + 100'000'000;
+    for (int32_t i = 0; i < 2; i++) {
+        auto generator = std::make_unique<TestFakeValueGenerator>();
+        generator->setEvents({VehiclePropValue{
+                .prop = i,
+                .timestamp = timestamp,
+        }});
+        hub->registerGenerator(i, std::move(generator));
+    }
+
+    {
+        std::unique_lock<std::mutex> uniqueLock(batchesLock);
+        ASSERT_TRUE(batchesCv.wait_for(uniqueLock, 10s, [&batches] { return !batches.empty(); }))
+                << "didn't receive events";
+        ASSERT_EQ(batches[0].size(), 2u);
+    }
+
+    GeneratorHub::Stats stats = hub->getStats();
+    EXPECT_EQ(stats.batchCount, 1u);
+    EXPECT_EQ(stats.eventCount, 2u);
+    EXPECT_LE(stats.averageJitterInNano, stats.maxJitterInNano);
+
+    hub.reset();
+}
+
 TEST_F(FakeVehicleHalValueGeneratorsTest, testLinerFakeValueGeneratorFloat) {
     std::unique_ptr<LinearFakeValueGenerator> generator =
             std::make_unique<LinearFakeValueGenerator>(toInt(VehicleProperty::PERF_VEHICLE_SPEED),
@@ -319,6 +357,63 @@ TEST_F(FakeVehicleHalValueGeneratorsTest, testJsonFakeValueGenerator) {
     EXPECT_EQ(events, expectedValues);
 }
 
+TEST_F(FakeVehicleHalValueGeneratorsTest, testJsonFakeValueGeneratorStreaming) {
+    int64_t currentTime = elapsedRealtimeNano();
+
+    std::unique_ptr<JsonFakeValueGenerator> generator = std::make_unique<JsonFakeValueGenerator>(
+            getTestFilePath("prop.json"), 2, /*streaming=*/true);
+    ASSERT_TRUE(generator->getAllEvents().empty());
+    getHub()->registerGenerator(0, std::move(generator));
+
+    std::vector<VehiclePropValue> expectedValues = {
+            VehiclePropValue{
+                    .areaId = 0,
+                    .value.int32Values = {8},
+                    .prop = 289408000,
+            },
+            VehiclePropValue{
+                    .areaId = 0,
+                    .value.int32Values = {4},
+                    .prop = 289408000,
+            },
+            VehiclePropValue{
+                    .areaId = 0,
+                    .value.int32Values = {16},
+                    .prop = 289408000,
+            },
+            VehiclePropValue{
+                    .areaId = 0,
+                    .value.int32Values = {10},
+                    .prop = 289408000,
+            },
+    };
+
+    // We have two iterations, the second one reads the file again.
+    for (size_t i = 0; i < 4; i++) {
+        expectedValues.push_back(expectedValues[i]);
+    }
+
+    waitForEvents(expectedValues.size());
+    auto events = getEvents();
+
+    int64_t lastEventTime = currentTime;
+    for (auto& event : events) {
+        EXPECT_GT(event.timestamp, lastEventTime);
+        lastEventTime = event.timestamp;
+        event.timestamp = 0;
+    }
+
+    EXPECT_EQ(events, expectedValues);
+}
+
+TEST_F(FakeVehicleHalValueGeneratorsTest, testJsonFakeValueGeneratorStreamingInvalidFile) {
+    std::unique_ptr<JsonFakeValueGenerator> generator = std::make_unique<JsonFakeValueGenerator>(
+            getTestFilePath("prop_invalid.json"), 2, /*streaming=*/true);
+    getHub()->registerGenerator(0, std::move(generator));
+
+    ASSERT_TRUE(getEvents().empty());
+}
+
 TEST_F(FakeVehicleHalValueGeneratorsTest, testJsonFakeValueGeneratorIterateIndefinitely) {
     std::unique_ptr<JsonFakeValueGenerator> generator =
             std::make_unique<JsonFakeValueGenerator>(getTestFilePath("prop.json"), -1);
@@ -45,9 +45,15 @@ class FakeVehicleHardware : public IVehicleHardware {
   public:
     using ValueResultType = VhalResult<VehiclePropValuePool::RecyclableType>;
 
+    // Pending get and set requests are each handled by this many threads. Requests for the same
+    // property always go to the same thread, so they are handled in order, while requests for
+    // other properties may be handled concurrently.
+    static constexpr size_t kDefaultHandlerThreadCount = 1;
+
     FakeVehicleHardware();
 
-    explicit FakeVehicleHardware(std::unique_ptr<VehiclePropValuePool> valuePool);
+    explicit FakeVehicleHardware(std::unique_ptr<VehiclePropValuePool> valuePool,
+                                 size_t handlerThreadCount = kDefaultHandlerThreadCount);
 
     ~FakeVehicleHardware();
 
@@ -137,15 +143,17 @@ class FakeVehicleHardware : public IVehicleHardware {
     std::unique_ptr<const PropertySetErrorCallback> mOnPropertySetErrorCallback GUARDED_BY(mLock);
     std::unordered_map<PropIdAreaId, std::shared_ptr<RecurrentTimer::Callback>, PropIdAreaIdHash>
             mRecurrentActions GUARDED_BY(mLock);
-    // PendingRequestHandler is thread-safe.
-    mutable PendingRequestHandler<GetValuesCallback,
-                                  aidl::android::hardware::automotive::vehicle::GetValueRequest>
+    // PendingRequestHandler is thread-safe. A request goes to the handler at
+    // getPendingRequestHandlerIndex of its property ID.
+    std::vector<std::unique_ptr<PendingRequestHandler<
+            GetValuesCallback, aidl::android::hardware::automotive::vehicle::GetValueRequest>>>
             mPendingGetValueRequests;
-    mutable PendingRequestHandler<SetValuesCallback,
-                                  aidl::android::hardware::automotive::vehicle::SetValueRequest>
+    std::vector<std::unique_ptr<PendingRequestHandler<
+            SetValuesCallback, aidl::android::hardware::automotive::vehicle::SetValueRequest>>>
             mPendingSetValueRequests;
 
     void init();
+    size_t getPendingRequestHandlerIndex(int32_t propId) const;
     // Stores the initial value to property store.
     void storePropInitialValue(const defaultconfig::ConfigDeclaration& config);
     // The callback that would be called when a vehicle property value change happens.
@@ -34,6 +34,7 @@
 
 #include <dirent.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <fstream>
 #include <regex>
 #include <unordered_set>
@@ -97,6 +98,11 @@ void FakeVehicleHardware::storePropInitialValue(const defaultconfig::ConfigDecla
     // A global property will have only a single area
     bool globalProp = isGlobalProp(propId);
     size_t numAreas = globalProp ? 1 : vehiclePropConfig.areaConfigs.size();
+    if (config.initialAreaValues.empty() && config.initialValue == RawPropValues{}) {
+        // Skip empty initial values.
+        return;
+    }
+    int64_t timestamp = elapsedRealtimeNano();
 
     for (size_t i = 0; i < numAreas; i++) {
         int32_t curArea = globalProp ? 0 : vehiclePropConfig.areaConfigs[i].areaId;
@@ -105,14 +111,10 @@ void FakeVehicleHardware::storePropInitialValue(const defaultconfig::ConfigDecla
         VehiclePropValue prop = {
                 .areaId = curArea,
                 .prop = propId,
-                .timestamp = elapsedRealtimeNano(),
+                .timestamp = timestamp,
         };
 
         if (config.initialAreaValues.empty()) {
-            if (config.initialValue == RawPropValues{}) {
-                // Skip empty initial values.
-                continue;
-            }
             prop.value = config.initialValue;
         } else if (auto valueForAreaIt = config.initialAreaValues.find(curArea);
                    valueForAreaIt != config.initialAreaValues.end()) {
@@ -134,20 +136,35 @@ void FakeVehicleHardware::storePropInitialValue(const defaultconfig::ConfigDecla
 FakeVehicleHardware::FakeVehicleHardware()
     : FakeVehicleHardware(std::make_unique<VehiclePropValuePool>()) {}
 
-FakeVehicleHardware::FakeVehicleHardware(std::unique_ptr<VehiclePropValuePool> valuePool)
+FakeVehicleHardware::FakeVehicleHardware(std::unique_ptr<VehiclePropValuePool> valuePool,
+                                         size_t handlerThreadCount)
     : mValuePool(std::move(valuePool)),
       mServerSidePropStore(new VehiclePropertyStore(mValuePool)),
       mFakeObd2Frame(new obd2frame::FakeObd2Frame(mServerSidePropStore)),
       mFakeUserHal(new FakeUserHal(mValuePool)),
-      mRecurrentTimer(new RecurrentTimer()),
-      mPendingGetValueRequests(this),
-      mPendingSetValueRequests(this) {
+      mRecurrentTimer(new RecurrentTimer()) {
+    for (size_t i = 0; i < std::max<size_t>(handlerThreadCount, 1); i++) {
+        mPendingGetValueRequests.push_back(
+                std::make_unique<PendingRequestHandler<GetValuesCallback, GetValueRequest>>(
+                        this));
+        mPendingSetValueRequests.push_back(
+                std::make_unique<PendingRequestHandler<SetValuesCallback, SetValueRequest>>(
+                        this));
+    }
     init();
 }
 
 FakeVehicleHardware::~FakeVehicleHardware() {
-    mPendingGetValueRequests.stop();
-    mPendingSetValueRequests.stop();
+    for (auto& handler : mPendingGetValueRequests) {
+        handler->stop();
+    }
+    for (auto& handler : mPendingSetValueRequests) {
+        handler->stop();
+    }
+}
+
+size_t FakeVehicleHardware::getPendingRequestHandlerIndex(int32_t propId) const {
+    return static_cast<uint32_t>(propId) % mPendingGetValueRequests.size();
 }
 
 void FakeVehicleHardware::init() {
@@ -442,7 +459,8 @@ StatusCode FakeVehicleHardware::setValues(std::shared_ptr<const SetValuesCallbac
         // here in the binder thread, or you could send the request in setValue which runs in
         // the handler thread. If you decide to send the setValue request here, you should not
         // wait for the response here and the handler thread should handle the setValue response.
-        mPendingSetValueRequests.addRequest(request, callback);
+        mPendingSetValueRequests[getPendingRequestHandlerIndex(request.value.prop)]->addRequest(
+                request, callback);
     }
 
     return StatusCode::OK;
@@ -504,7 +522,8 @@ StatusCode FakeVehicleHardware::getValues(std::shared_ptr<const GetValuesCallbac
         // here in the binder thread, or you could send the request in getValue which runs in
         // the handler thread. If you decide to send the getValue request here, you should not
         // wait for the response here and the handler thread should handle the getValue response.
-        mPendingGetValueRequests.addRequest(request, callback);
+        mPendingGetValueRequests[getPendingRequestHandlerIndex(request.prop.prop)]->addRequest(
+                request, callback);
     }
 
     return StatusCode::OK;
@@ -98,7 +98,7 @@ class FakeVehicleHardwareTest : public ::testing::Test {
                 [this](std::vector<GetValueResult> results) { onGetValues(results); });
     }
 
-    FakeVehicleHardware* getHardware() { return &mHardware; }
+    virtual FakeVehicleHardware* getHardware() { return &mHardware; }
 
     StatusCode setValues(const std::vector<SetValueRequest>& requests) {
         {
@@ -443,6 +443,43 @@ TEST_F(FakeVehicleHardwareTest, testSetValues) {
     ASSERT_THAT(getSetValueResults(), ContainerEq(expectedResults));
 }
 
+class FakeVehicleHardwareHandlerPoolTest : public FakeVehicleHardwareTest {
+  protected:
+    FakeVehicleHardware* getHardware() override { return &mPooledHardware; }
+
+  private:
+    FakeVehicleHardware mPooledHardware{std::make_unique<VehiclePropValuePool>(),
+                                        /*handlerThreadCount=*/4};
+};
+
+TEST_F(FakeVehicleHardwareHandlerPoolTest, testSetValuesOfOnePropertyInOrder) {
+    const std::vector<int32_t> propIds = {toInt(VehicleProperty::PERF_VEHICLE_SPEED),
+                                          toInt(VehicleProperty::ENGINE_OIL_TEMP)};
+    std::vector<SetValueRequest> requests;
+    std::vector<SetValueResult> expectedResults;
+
+    int64_t requestId = 1;
+    for (int i = 0; i < 10; i++) {
+        for (int32_t propId : propIds) {
+            addSetValueRequest(requests, expectedResults, requestId++,
+                               VehiclePropValue{
+                                       .prop = propId,
+                                       .value = {.floatValues = {static_cast<float>(i)}},
+                               },
+                               StatusCode::OK);
+        }
+    }
+
+    ASSERT_EQ(setValues(requests), StatusCode::OK);
+
+    // The properties may be handled by different threads, but each keeps its last value.
+    for (int32_t propId : propIds) {
+        auto result = getValue(VehiclePropValue{.prop = propId});
+        ASSERT_TRUE(result.ok());
+        ASSERT_EQ(result.value().value.floatValues, std::vector<float>({9.0f}));
+    }
+}
+
 TEST_F(FakeVehicleHardwareTest, testSetValuesError) {
     std::vector<SetValueRequest> requests;
     std::vector<SetValueResult> expectedResults;
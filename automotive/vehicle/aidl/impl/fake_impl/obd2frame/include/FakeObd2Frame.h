@@ -21,6 +21,11 @@
 #include <VehiclePropertyStore.h>
 
 #include <android-base/result.h>
+#include <android-base/thread_annotations.h>
+
+#include <deque>
+#include <mutex>
+#include <unordered_set>
 
 namespace android {
 namespace hardware {
@@ -29,8 +34,14 @@ namespace vehicle {
 namespace fake {
 namespace obd2frame {
 
+// Provides the OBD2 diagnostic properties. The OBD2_FREEZE_FRAME values in the property store are
+// owned by this class, which keeps their timestamps so that looking up or listing freeze frames
+// does not copy every frame out of the store.
 class FakeObd2Frame final {
   public:
+    // The number of freeze frames kept, older ones are removed when a new one is recorded.
+    static constexpr size_t kMaxFreezeFrames = 32;
+
     explicit FakeObd2Frame(std::shared_ptr<VehiclePropertyStore> propStore)
         : mPropStore(propStore) {}
 
@@ -50,6 +61,15 @@ class FakeObd2Frame final {
   private:
     std::shared_ptr<VehiclePropertyStore> mPropStore;
 
+    mutable std::mutex mLock;
+    // The timestamps of the stored freeze frames, oldest first, and the same as a set for
+    // lookups.
+    std::deque<int64_t> mFreezeFrameTimestamps GUARDED_BY(mLock);
+    std::unordered_set<int64_t> mFreezeFrameTimestampSet GUARDED_BY(mLock);
+
+    // Stores the freeze frame, removing the oldest one if there are kMaxFreezeFrames already.
+    void writeFreezeFrameLocked(VehiclePropValuePool::RecyclableType freezeFrame) REQUIRES(mLock);
+
     std::unique_ptr<Obd2SensorStore> fillDefaultObd2Frame(size_t numVendorIntegerSensors,
                                                           size_t numVendorFloatSensors);
 };
@@ -25,6 +25,8 @@
 #include <android-base/result.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -117,11 +119,36 @@ void FakeObd2Frame::initObd2FreezeFrame(const VehiclePropConfig& propConfig) {
                                             static_cast<size_t>(propConfig.configArray[1]));
 
     static std::vector<std::string> sampleDtcs = {"P0070", "P0102", "P0123"};
+    std::scoped_lock<std::mutex> lockGuard(mLock);
     for (auto&& dtc : sampleDtcs) {
         auto freezeFrame = sensorStore->getSensorProperty(dtc);
         freezeFrame->prop = OBD2_FREEZE_FRAME;
 
-        mPropStore->writeValue(std::move(freezeFrame), /*updateStatus=*/true);
+        writeFreezeFrameLocked(std::move(freezeFrame));
+    }
+}
+
+void FakeObd2Frame::writeFreezeFrameLocked(VehiclePropValuePool::RecyclableType freezeFrame) {
+    const int64_t timestamp = freezeFrame->timestamp;
+    if (auto result = mPropStore->writeValue(std::move(freezeFrame), /*updateStatus=*/true);
+        !result.ok()) {
+        ALOGE("failed to write OBD2_FREEZE_FRAME: %s", getErrorMsg(result).c_str());
+        return;
+    }
+    // Freeze frames are keyed by timestamp, so one with the same timestamp replaced the old one.
+    if (!mFreezeFrameTimestampSet.insert(timestamp).second) {
+        return;
+    }
+    mFreezeFrameTimestamps.push_back(timestamp);
+
+    while (mFreezeFrameTimestamps.size() > kMaxFreezeFrames) {
+        const int64_t oldest = mFreezeFrameTimestamps.front();
+        mFreezeFrameTimestamps.pop_front();
+        mFreezeFrameTimestampSet.erase(oldest);
+        mPropStore->removeValue(VehiclePropValue{
+                .timestamp = oldest,
+                .prop = OBD2_FREEZE_FRAME,
+        });
     }
 }
 
@@ -131,18 +158,19 @@ VhalResult<VehiclePropValuePool::RecyclableType> FakeObd2Frame::getObd2FreezeFra
         return StatusError(StatusCode::INVALID_ARG)
                << "asked for OBD2_FREEZE_FRAME without valid timestamp";
     }
-    auto readValuesResult = mPropStore->readValuesForProperty(OBD2_FREEZE_FRAME);
-    if (!readValuesResult.ok()) {
-        return StatusError(StatusCode::INTERNAL_ERROR)
-               << "failed to read OBD2_FREEZE_FRAME property: "
-               << readValuesResult.error().message();
-    }
-    if (readValuesResult.value().size() == 0) {
-        // Should no freeze frame be available at the given timestamp, a response of NOT_AVAILABLE
-        // must be returned by the implementation
-        return StatusError(StatusCode::NOT_AVAILABLE);
-    }
     auto timestamp = requestedPropValue.value.int64Values[0];
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        if (mFreezeFrameTimestamps.empty()) {
+            // Should no freeze frame be available at the given timestamp, a response of
+            // NOT_AVAILABLE must be returned by the implementation
+            return StatusError(StatusCode::NOT_AVAILABLE);
+        }
+        if (mFreezeFrameTimestampSet.find(timestamp) == mFreezeFrameTimestampSet.end()) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "asked for OBD2_FREEZE_FRAME at invalid timestamp";
+        }
+    }
     auto readValueResult = mPropStore->readValue(OBD2_FREEZE_FRAME, /*area=*/0, timestamp);
     if (!readValueResult.ok()) {
         return StatusError(StatusCode::INVALID_ARG)
@@ -152,35 +180,35 @@ VhalResult<VehiclePropValuePool::RecyclableType> FakeObd2Frame::getObd2FreezeFra
 }
 
 VhalResult<VehiclePropValuePool::RecyclableType> FakeObd2Frame::getObd2DtcInfo() const {
-    std::vector<int64_t> timestamps;
-    auto result = mPropStore->readValuesForProperty(OBD2_FREEZE_FRAME);
-    if (!result.ok()) {
-        return StatusError(StatusCode::INTERNAL_ERROR)
-               << "failed to read OBD2_FREEZE_FRAME property: " << result.error().message();
-    }
-    for (const auto& freezeFrame : result.value()) {
-        timestamps.push_back(freezeFrame->timestamp);
-    }
-    auto outValue =
-            mPropStore->getValuePool()->obtain(VehiclePropertyType::INT64_VEC, timestamps.size());
-    outValue->value.int64Values = timestamps;
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    auto outValue = mPropStore->getValuePool()->obtain(VehiclePropertyType::INT64_VEC,
+                                                       mFreezeFrameTimestamps.size());
+    outValue->value.int64Values.assign(mFreezeFrameTimestamps.begin(),
+                                       mFreezeFrameTimestamps.end());
     outValue->prop = OBD2_FREEZE_FRAME_INFO;
     return outValue;
 }
 
 VhalResult<void> FakeObd2Frame::clearObd2FreezeFrames(const VehiclePropValue& propValue) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
     if (propValue.value.int64Values.size() == 0) {
         mPropStore->removeValuesForProperty(OBD2_FREEZE_FRAME);
+        mFreezeFrameTimestamps.clear();
+        mFreezeFrameTimestampSet.clear();
         return {};
     }
     for (int64_t timestamp : propValue.value.int64Values) {
-        auto result = mPropStore->readValue(OBD2_FREEZE_FRAME, 0, timestamp);
-        if (!result.ok()) {
+        if (mFreezeFrameTimestampSet.erase(timestamp) == 0) {
             return StatusError(StatusCode::INVALID_ARG)
-                   << "asked for OBD2_FREEZE_FRAME at invalid timestamp, error: %s"
-                   << result.error().message();
+                   << "asked for OBD2_FREEZE_FRAME at invalid timestamp: " << timestamp;
         }
-        mPropStore->removeValue(*result.value());
+        mFreezeFrameTimestamps.erase(std::find(mFreezeFrameTimestamps.begin(),
+                                               mFreezeFrameTimestamps.end(), timestamp));
+        // Freeze frames are keyed by their timestamp only.
+        mPropStore->removeValue(VehiclePropValue{
+                .timestamp = timestamp,
+                .prop = OBD2_FREEZE_FRAME,
+        });
     }
     return {};
 }
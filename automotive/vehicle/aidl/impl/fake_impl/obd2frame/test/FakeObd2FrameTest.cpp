@@ -124,6 +124,30 @@ TEST_F(FakeObd2FrameTest, testInitFreezeFrame) {
     ASSERT_EQ(result.value().size(), static_cast<size_t>(3));
 }
 
+TEST_F(FakeObd2FrameTest, testFreezeFramesAreBounded) {
+    // Each call records 3 new freeze frames.
+    for (size_t i = 0; i < FakeObd2Frame::kMaxFreezeFrames / 3 + 1; i++) {
+        getFakeObd2Frame()->initObd2FreezeFrame(getObd2FreezeFrameConfig());
+    }
+
+    auto result = getPropertyStore()->readValuesForProperty(OBD2_FREEZE_FRAME);
+
+    ASSERT_TRUE(result.ok());
+    ASSERT_EQ(result.value().size(), FakeObd2Frame::kMaxFreezeFrames);
+
+    auto dtcInfoResult = getFakeObd2Frame()->getObd2DtcInfo();
+
+    ASSERT_TRUE(dtcInfoResult.ok());
+    ASSERT_EQ(dtcInfoResult.value()->value.int64Values.size(), FakeObd2Frame::kMaxFreezeFrames);
+    for (int64_t timestamp : dtcInfoResult.value()->value.int64Values) {
+        EXPECT_TRUE(getFakeObd2Frame()
+                            ->getObd2FreezeFrame(VehiclePropValue{
+                                    .value.int64Values = {timestamp},
+                            })
+                            .ok());
+    }
+}
+
 TEST_F(FakeObd2FrameTest, testGetObd2DtcInfo) {
     getFakeObd2Frame()->initObd2FreezeFrame(getObd2FreezeFrameConfig());
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ProtoMessageConverter.h>
+#include <VehicleHalTypes.h>
+#include <android/hardware/automotive/vehicle/VehiclePropValue.pb.h>
+#include <android/hardware/automotive/vehicle/VehiclePropValues.pb.h>
+#include <benchmark/benchmark.h>
+#include <google/protobuf/arena.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace proto_msg_converter {
+
+namespace {
+
+namespace proto = ::android::hardware::automotive::vehicle::proto;
+namespace aidl_vehicle = ::aidl::android::hardware::automotive::vehicle;
+
+// Values the size of a typical sensor update: a few ints and a float.
+std::vector<aidl_vehicle::VehiclePropValue> prepareTestValues(size_t count) {
+    std::vector<aidl_vehicle::VehiclePropValue> values(count);
+    for (size_t i = 0; i < count; i++) {
+        values[i].timestamp = static_cast<int64_t>(i);
+        values[i].prop = static_cast<int32_t>(i);
+        values[i].value.int32Values = {1, 2, 3};
+        values[i].value.floatValues = {1.f};
+    }
+    return values;
+}
+
+}  // namespace
+
+// Sends every value in its own message, the way a unary RPC per update would.
+static void BM_SerializeValuesOneByOne(benchmark::State& state) {
+    auto values = prepareTestValues(state.range(0));
+    std::string buffer;
+    for (auto _ : state) {
+        for (const auto& value : values) {
+            proto::VehiclePropValue protoVal;
+            aidlToProto(value, &protoVal);
+            protoVal.SerializeToString(&buffer);
+            benchmark::DoNotOptimize(buffer);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_SerializeValuesOneByOne)->Arg(1)->Arg(64)->Arg(1024);
+
+// Sends the values as one batch allocated on an arena.
+static void BM_SerializeValuesBatch(benchmark::State& state) {
+    auto values = prepareTestValues(state.range(0));
+    std::string buffer;
+    for (auto _ : state) {
+        google::protobuf::Arena arena;
+        auto* protoVals = google::protobuf::Arena::CreateMessage<proto::VehiclePropValues>(&arena);
+        aidlToProto(values, protoVals);
+        protoVals->SerializeToString(&buffer);
+        benchmark::DoNotOptimize(buffer);
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_SerializeValuesBatch)->Arg(1)->Arg(64)->Arg(1024);
+
+static void BM_DeserializeValuesBatch(benchmark::State& state) {
+    auto values = prepareTestValues(state.range(0));
+    proto::VehiclePropValues protoVals;
+    aidlToProto(values, &protoVals);
+    std::string buffer = protoVals.SerializeAsString();
+    std::vector<aidl_vehicle::VehiclePropValue> aidlVals;
+    for (auto _ : state) {
+        google::protobuf::Arena arena;
+        auto* parsedVals = google::protobuf::Arena::CreateMessage<proto::VehiclePropValues>(&arena);
+        parsedVals->ParseFromString(buffer);
+        protoToAidl(*parsedVals, &aidlVals);
+        benchmark::DoNotOptimize(aidlVals);
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_DeserializeValuesBatch)->Arg(1)->Arg(64)->Arg(1024);
+
+}  // namespace proto_msg_converter
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -21,10 +21,13 @@
 #include <android/hardware/automotive/vehicle/VehicleAreaConfig.pb.h>
 #include <android/hardware/automotive/vehicle/VehiclePropConfig.pb.h>
 #include <android/hardware/automotive/vehicle/VehiclePropValue.pb.h>
+#include <android/hardware/automotive/vehicle/VehiclePropValues.pb.h>
 #include <android/hardware/automotive/vehicle/VehiclePropertyAccess.pb.h>
 #include <android/hardware/automotive/vehicle/VehiclePropertyChangeMode.pb.h>
 #include <android/hardware/automotive/vehicle/VehiclePropertyStatus.pb.h>
 
+#include <vector>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -46,6 +49,18 @@ void aidlToProto(const ::aidl::android::hardware::automotive::vehicle::VehiclePr
 void protoToAidl(
         const ::android::hardware::automotive::vehicle::proto::VehiclePropValue& inProtoVal,
         ::aidl::android::hardware::automotive::vehicle::VehiclePropValue* outAidlVal);
+// Convert a batch of AIDL VehiclePropValues to one Protobuf VehiclePropValues message, replacing
+// its values. Allocate outProtoVals on an arena to allocate the values there too.
+void aidlToProto(
+        const std::vector<::aidl::android::hardware::automotive::vehicle::VehiclePropValue>&
+                inAidlVals,
+        ::android::hardware::automotive::vehicle::proto::VehiclePropValues* outProtoVals);
+// Convert a Protobuf VehiclePropValues message to AIDL VehiclePropValues, replacing the content of
+// outAidlVals.
+void protoToAidl(
+        const ::android::hardware::automotive::vehicle::proto::VehiclePropValues& inProtoVals,
+        std::vector<::aidl::android::hardware::automotive::vehicle::VehiclePropValue>*
+                outAidlVals);
 
 }  // namespace proto_msg_converter
 }  // namespace vehicle
@@ -51,6 +51,21 @@ namespace proto = ::android::hardware::automotive::vehicle::proto;
     CAST_COPY_PROTOBUF_VEC_TO_VHAL_TYPE(                                            \
             PROTO_VALUE, PROTO_VECNAME, VHAL_TYPE_VALUE, VHAL_TYPE_VECNAME, /*NO CAST*/)
 
+namespace {
+
+// Replaces the content of the repeated field with the vector, allocating the field only once
+// instead of growing it value by value.
+template <typename T>
+void copyToRepeatedField(const std::vector<T>& in, google::protobuf::RepeatedField<T>* out) {
+    out->Clear();
+    out->Reserve(in.size());
+    for (const T& value : in) {
+        out->AddAlreadyReserved(value);
+    }
+}
+
+}  // namespace
+
 void aidlToProto(const aidl_vehicle::VehiclePropConfig& in, proto::VehiclePropConfig* out) {
     out->set_prop(in.prop);
     out->set_access(static_cast<proto::VehiclePropertyAccess>(toInt(in.access)));
@@ -108,17 +123,9 @@ void aidlToProto(const aidl_vehicle::VehiclePropValue& in, proto::VehiclePropVal
     out->set_string_value(in.value.stringValue);
     out->set_byte_values(in.value.byteValues.data(), in.value.byteValues.size());
 
-    for (auto& int32Value : in.value.int32Values) {
-        out->add_int32_values(int32Value);
-    }
-
-    for (auto& int64Value : in.value.int64Values) {
-        out->add_int64_values(int64Value);
-    }
-
-    for (auto& floatValue : in.value.floatValues) {
-        out->add_float_values(floatValue);
-    }
+    copyToRepeatedField(in.value.int32Values, out->mutable_int32_values());
+    copyToRepeatedField(in.value.int64Values, out->mutable_int64_values());
+    copyToRepeatedField(in.value.floatValues, out->mutable_float_values());
 }
 
 void protoToAidl(const proto::VehiclePropValue& in, aidl_vehicle::VehiclePropValue* out) {
@@ -127,13 +134,31 @@ void protoToAidl(const proto::VehiclePropValue& in, aidl_vehicle::VehiclePropVal
     out->status = static_cast<aidl_vehicle::VehiclePropertyStatus>(in.status());
     out->areaId = in.area_id();
     out->value.stringValue = in.string_value();
-    for (const char& byte : in.byte_values()) {
-        out->value.byteValues.push_back(byte);
+    out->value.byteValues.assign(in.byte_values().begin(), in.byte_values().end());
+
+    out->value.int32Values.assign(in.int32_values().begin(), in.int32_values().end());
+    out->value.int64Values.assign(in.int64_values().begin(), in.int64_values().end());
+    out->value.floatValues.assign(in.float_values().begin(), in.float_values().end());
+}
+
+void aidlToProto(const std::vector<aidl_vehicle::VehiclePropValue>& in,
+                 proto::VehiclePropValues* out) {
+    auto* values = out->mutable_values();
+    values->Clear();
+    values->Reserve(in.size());
+    for (const auto& value : in) {
+        aidlToProto(value, values->Add());
     }
+}
 
-    COPY_PROTOBUF_VEC_TO_VHAL_TYPE(in, int32_values, out, value.int32Values);
-    COPY_PROTOBUF_VEC_TO_VHAL_TYPE(in, int64_values, out, value.int64Values);
-    COPY_PROTOBUF_VEC_TO_VHAL_TYPE(in, float_values, out, value.floatValues);
+void protoToAidl(const proto::VehiclePropValues& in,
+                 std::vector<aidl_vehicle::VehiclePropValue>* out) {
+    out->clear();
+    out->resize(in.values_size());
+    size_t idx = 0;
+    for (const auto& value : in.values()) {
+        protoToAidl(value, &(*out)[idx++]);
+    }
 }
 
 #undef COPY_PROTOBUF_VEC_TO_VHAL_TYPE
@@ -22,6 +22,8 @@
 #include <android-base/format.h>
 #include <android/hardware/automotive/vehicle/VehiclePropConfig.pb.h>
 #include <android/hardware/automotive/vehicle/VehiclePropValue.pb.h>
+#include <android/hardware/automotive/vehicle/VehiclePropValues.pb.h>
+#include <google/protobuf/arena.h>
 #include <gtest/gtest.h>
 
 namespace android {
@@ -84,6 +86,20 @@ TEST_P(PropValueConversionTest, testConversion) {
     EXPECT_EQ(aidlVal, GetParam());
 }
 
+TEST(PropValuesConversionTest, testConversion) {
+    google::protobuf::Arena arena;
+    auto* protoVals = google::protobuf::Arena::CreateMessage<proto::VehiclePropValues>(&arena);
+    std::vector<aidl_vehicle::VehiclePropValue> aidlVals = {aidl_vehicle::VehiclePropValue{}};
+    std::vector<aidl_vehicle::VehiclePropValue> testValues = prepareTestValues();
+
+    // Converting again must replace the previous values, not append to them.
+    aidlToProto(testValues, protoVals);
+    aidlToProto(testValues, protoVals);
+    protoToAidl(*protoVals, &aidlVals);
+
+    EXPECT_EQ(aidlVals, testValues);
+}
+
 INSTANTIATE_TEST_SUITE_P(DefaultConfigs, PropConfigConversionTest,
                          ::testing::ValuesIn(prepareTestConfigs()),
                          [](const ::testing::TestParamInfo<aidl_vehicle::VehiclePropConfig>& info) {
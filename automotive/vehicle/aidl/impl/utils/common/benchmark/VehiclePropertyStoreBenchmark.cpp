@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <VehicleHalTypes.h>
+#include <VehiclePropertyStore.h>
+#include <VehicleUtils.h>
+
+#include <benchmark/benchmark.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehicleArea;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropConfig;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyAccess;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyChangeMode;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyGroup;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyType;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+
+// Roughly the number of properties supported by the default config.
+constexpr int32_t PROPERTY_COUNT = 128;
+
+int32_t getPropId(int32_t index) {
+    return (index + 1) | toInt(VehiclePropertyGroup::VENDOR) | toInt(VehicleArea::GLOBAL) |
+           toInt(VehiclePropertyType::INT32);
+}
+
+// The store is shared by all the benchmark threads, the same as how binder threads share the store
+// in FakeVehicleHardware.
+class VehiclePropertyStoreBenchmark : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State& state) override {
+        if (state.thread_index != 0) {
+            return;
+        }
+        mValuePool = std::make_shared<VehiclePropValuePool>();
+        mStore = std::make_unique<VehiclePropertyStore>(mValuePool);
+        for (int32_t i = 0; i < PROPERTY_COUNT; i++) {
+            mStore->registerProperty(VehiclePropConfig{
+                    .prop = getPropId(i),
+                    .access = VehiclePropertyAccess::READ_WRITE,
+                    .changeMode = VehiclePropertyChangeMode::CONTINUOUS,
+            });
+            writeValue(i, 0);
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        if (state.thread_index != 0) {
+            return;
+        }
+        mStore.reset();
+        mValuePool.reset();
+    }
+
+  protected:
+    std::shared_ptr<VehiclePropValuePool> mValuePool;
+    std::unique_ptr<VehiclePropertyStore> mStore;
+
+    void writeValue(int32_t index, int64_t timestamp) {
+        auto value = mValuePool->obtainInt32(static_cast<int32_t>(timestamp));
+        value->prop = getPropId(index);
+        value->timestamp = timestamp;
+        mStore->writeValue(std::move(value), /*updateStatus=*/false,
+                           VehiclePropertyStore::EventMode::NEVER);
+    }
+};
+
+// All threads read values.
+BENCHMARK_DEFINE_F(VehiclePropertyStoreBenchmark, BM_ReadValue)(benchmark::State& state) {
+    int32_t index = state.thread_index;
+    for (auto _ : state) {
+        auto result = mStore->readValue(getPropId(index));
+        benchmark::DoNotOptimize(result);
+        index = (index + 1) % PROPERTY_COUNT;
+    }
+}
+BENCHMARK_REGISTER_F(VehiclePropertyStoreBenchmark, BM_ReadValue)->ThreadRange(1, 8)->UseRealTime();
+
+// Thread 0 keeps writing continuous property values, the same as a RecurrentTimer refreshing
+// values, while other threads read values.
+BENCHMARK_DEFINE_F(VehiclePropertyStoreBenchmark, BM_ReadValueWithWriter)
+(benchmark::State& state) {
+    int32_t index = state.thread_index;
+    int64_t timestamp = 1;
+    for (auto _ : state) {
+        if (state.thread_index == 0) {
+            writeValue(index, timestamp++);
+        } else {
+            auto result = mStore->readValue(getPropId(index));
+            benchmark::DoNotOptimize(result);
+        }
+        index = (index + 1) % PROPERTY_COUNT;
+    }
+}
+BENCHMARK_REGISTER_F(VehiclePropertyStoreBenchmark, BM_ReadValueWithWriter)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+BENCHMARK_DEFINE_F(VehiclePropertyStoreBenchmark, BM_ReadAllValues)(benchmark::State& state) {
+    for (auto _ : state) {
+        auto values = mStore->readAllValues();
+        benchmark::DoNotOptimize(values);
+    }
+}
+BENCHMARK_REGISTER_F(VehiclePropertyStoreBenchmark, BM_ReadAllValues)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -22,7 +22,10 @@
 #include <android-base/thread_annotations.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
@@ -34,6 +37,10 @@ namespace automotive {
 namespace vehicle {
 
 // A thread-safe pending request pool that tracks whether each request has timed-out.
+//
+// The requests of each client are guarded by their own lock, so finishing requests of one client
+// does not wait for other clients or for the timeout check. The timeout thread sleeps until the
+// earliest deadline instead of polling.
 class PendingRequestPool final {
   public:
     using TimeoutCallbackFunc = std::function<void(const std::unordered_set<int64_t>&)>;
@@ -80,19 +87,47 @@ class PendingRequestPool final {
         std::shared_ptr<const TimeoutCallbackFunc> callback;
     };
 
+    struct ClientRequests {
+        std::mutex lock;
+        // Guarded by lock. Ordered by timeoutTimestamp, since all requests use the same timeout.
+        std::list<PendingRequest> requests;
+    };
+
+    struct Deadline {
+        int64_t timeoutTimestamp;
+        const void* clientId;
+    };
+
     int64_t mTimeoutInNano;
+    // Guards the client map and the deadlines. The lock of a client is only taken while holding
+    // mLock, or after being handed over from it, so that no client is removed while in use.
     mutable std::mutex mLock;
-    std::unordered_map<const void*, std::list<PendingRequest>> mPendingRequestsByClient
+    std::unordered_map<const void*, std::unique_ptr<ClientRequests>> mPendingRequestsByClient
             GUARDED_BY(mLock);
+    // One deadline per added batch, in the order they expire. A deadline may refer to requests
+    // that were finished already, which only wakes the thread up needlessly.
+    std::deque<Deadline> mDeadlines GUARDED_BY(mLock);
     std::thread mThread;
     std::atomic<bool> mThreadStop = false;
     std::condition_variable mCv;
     std::mutex mCvLock;
+    // Set when a deadline was added while there were none, so the thread does not miss it.
+    bool mNewDeadline GUARDED_BY(mCvLock) = false;
+
+    // Returns the requests of the client with its lock held in clientLock, or nullptr if the
+    // client has no requests.
+    ClientRequests* lockClient(const void* clientId, std::unique_lock<std::mutex>* clientLock) const
+            EXCLUDES(mLock);
+
+    static bool isRequestPendingLocked(const ClientRequests& client, int64_t requestId);
 
-    bool isRequestPendingLocked(const void* clientId, int64_t requestId) const REQUIRES(mLock);
+    // Waits for the earliest deadline and reports the requests that timed out, run in a separate
+    // thread.
+    void threadLoop();
 
-    // Checks whether the requests in the pool has timed-out, run periodically in a separate thread.
-    void checkTimeout();
+    // Reports the requests in the pool that have timed-out. Returns the next deadline, or -1 if
+    // there are none.
+    int64_t checkTimeout();
 };
 
 }  // namespace vehicle
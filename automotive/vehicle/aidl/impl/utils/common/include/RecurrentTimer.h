@@ -19,11 +19,17 @@
 
 #include <android-base/thread_annotations.h>
 
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace android {
@@ -32,12 +38,24 @@ namespace automotive {
 namespace vehicle {
 
 // A thread-safe recurrent timer.
+//
+// Callbacks are kept in a hierarchical timing wheel with {@code TICK_IN_NANO} resolution, so
+// registering and unregistering a callback are O(1) no matter how many callbacks there are. All
+// callbacks due in the same tick are collected under one lock and run as one batch.
 class RecurrentTimer final {
   public:
     // The class for the function that would be called recurrently.
     using Callback = std::function<void()>;
 
-    RecurrentTimer();
+    // The resolution of the timer. A callback may run at most one tick later than its scheduled
+    // time, but the delay does not accumulate since the schedule is always aligned to its
+    // interval.
+    static constexpr int64_t TICK_IN_NANO = 1'000'000;
+
+    // If {@code workerThreadCount} is 0, callbacks run on the timer thread one after another.
+    // Otherwise callbacks run on a pool of worker threads, so one slow callback does not delay the
+    // others. In this case, a callback is skipped if its previous run has not finished yet.
+    explicit RecurrentTimer(size_t workerThreadCount = 0);
 
     ~RecurrentTimer();
 
@@ -52,40 +70,67 @@ class RecurrentTimer final {
     // friend class for unit testing.
     friend class RecurrentTimerTest;
 
+    // Each level has 256 slots, and each slot in level N covers 256^N ticks. 4 levels cover 2^32
+    // ticks, about 49 days.
+    static constexpr size_t WHEEL_LEVEL_COUNT = 4;
+    static constexpr size_t WHEEL_SLOT_BITS = 8;
+    static constexpr size_t WHEEL_SLOT_COUNT = 1 << WHEEL_SLOT_BITS;
+    static constexpr int64_t WHEEL_SLOT_MASK = WHEEL_SLOT_COUNT - 1;
+
+    struct CallbackInfo;
+    using WheelSlot = std::list<CallbackInfo*>;
+
     struct CallbackInfo {
         std::shared_ptr<Callback> callback;
         int64_t interval;
         int64_t nextTime;
-        // A flag to indicate whether this CallbackInfo is already outdated and should be ignored.
-        // The reason we need this flag is because we cannot easily remove an element from a heap.
-        bool outdated = false;
-
-        static bool cmp(const std::unique_ptr<CallbackInfo>& lhs,
-                        const std::unique_ptr<CallbackInfo>& rhs);
+        // The tick when the callback should run, which is nextTime rounded up to a tick.
+        int64_t expireTick;
+        // The position of this CallbackInfo in mWheel.
+        size_t level;
+        size_t slot;
+        WheelSlot::iterator position;
     };
 
     std::mutex mLock;
     std::thread mThread;
     std::condition_variable mCond;
     bool mStopRequested GUARDED_BY(mLock) = false;
-    // A map to map each callback to its current active CallbackInfo in the mCallbackQueue.
-    std::unordered_map<std::shared_ptr<Callback>, CallbackInfo*> mCallbacks GUARDED_BY(mLock);
-    // A min-heap sorted by nextTime. Note that because we cannot remove arbitrary element from the
-    // heap, a single Callback can have multiple entries in this queue, all but one should be valid.
-    // The rest should be mark as outdated. The valid one is one stored in mCallbacks.
-    std::vector<std::unique_ptr<CallbackInfo>> mCallbackQueue GUARDED_BY(mLock);
+    // The next tick to process. All the ticks before this one have been processed.
+    int64_t mCurrentTick GUARDED_BY(mLock);
+    // The tick the timer thread is going to wake up at. INT64_MAX if it is waiting for callbacks.
+    int64_t mWakeUpTick GUARDED_BY(mLock) = INT64_MAX;
+    // A map to map each callback to its current CallbackInfo in mWheel.
+    std::unordered_map<std::shared_ptr<Callback>, std::unique_ptr<CallbackInfo>> mCallbacks
+            GUARDED_BY(mLock);
+    std::array<std::array<WheelSlot, WHEEL_SLOT_COUNT>, WHEEL_LEVEL_COUNT> mWheel GUARDED_BY(mLock);
+
+    // Only used if there are worker threads.
+    std::mutex mWorkerLock;
+    std::condition_variable mWorkerCond;
+    std::vector<std::thread> mWorkerThreads;
+    bool mWorkerStopRequested GUARDED_BY(mWorkerLock) = false;
+    std::deque<std::shared_ptr<Callback>> mPendingCallbacks GUARDED_BY(mWorkerLock);
+    // Callbacks that are either pending or running on a worker thread.
+    std::unordered_set<const Callback*> mActiveCallbacks GUARDED_BY(mWorkerLock);
 
     void loop();
-
-    // Mark the callbackInfo as outdated and should be ignored when popped from the heap.
-    void markOutdatedLocked(CallbackInfo* callback) REQUIRES(mLock);
-    // Remove all outdated callbackInfos from the top of the heap. This function must be called
-    // each time we might introduce outdated elements to the top. We must make sure the heap is
-    // always valid from the top.
-    void removeInvalidCallbackLocked() REQUIRES(mLock);
-    // Gets the next calblack to run (must be valid) from the heap, update its nextTime and put
-    // it back to the heap.
-    std::shared_ptr<Callback> getNextCallbackLocked(int64_t now) REQUIRES(mLock);
+    void workerLoop();
+
+    // Runs a batch of callbacks, either inline or on the worker threads.
+    void runCallbacks(const std::vector<std::shared_ptr<Callback>>& callbacks);
+
+    // Puts the callbackInfo into the wheel slot for its expireTick.
+    void insertLocked(CallbackInfo* info) REQUIRES(mLock);
+    // Removes the callbackInfo from its wheel slot.
+    void removeLocked(CallbackInfo* info) REQUIRES(mLock);
+    // Processes all the ticks up to and including {@code nowTick}, collects all the callbacks
+    // that are due and reschedules them.
+    void advanceLocked(int64_t now, int64_t nowTick,
+                       std::vector<std::shared_ptr<Callback>>* callbacksToRun) REQUIRES(mLock);
+    // Gets the next tick that either has callbacks to run or needs callbacks moved down from a
+    // higher level.
+    int64_t getWakeUpTickLocked() REQUIRES(mLock);
 };
 
 }  // namespace vehicle
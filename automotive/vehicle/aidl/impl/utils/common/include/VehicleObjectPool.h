@@ -17,10 +17,13 @@
 #ifndef android_hardware_automotive_vehicle_utils_include_VehicleObjectPool_H_
 #define android_hardware_automotive_vehicle_utils_include_VehicleObjectPool_H_
 
+#include <array>
+#include <atomic>
 #include <deque>
-#include <map>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 
 #include <VehicleHalTypes.h>
 
@@ -39,11 +42,19 @@ struct PoolStats {
     std::atomic<uint32_t> Created{0};
     std::atomic<uint32_t> Recycled{0};
     std::atomic<uint32_t> Deleted{0};
+    // Objects obtained from or recycled to the per-thread caches, a subset of Obtained and
+    // Recycled.
+    std::atomic<uint32_t> CacheObtained{0};
+    std::atomic<uint32_t> CacheRecycled{0};
+    // Objects that are not recyclable and are allocated every time.
+    std::atomic<uint32_t> Disposable{0};
 
     static PoolStats* instance() {
         static PoolStats inst;
         return &inst;
     }
+
+    std::string dump() const;
 };
 
 template <typename T>
@@ -66,8 +77,15 @@ struct Deleter {
 template <typename T>
 using recyclable_ptr = typename std::unique_ptr<T, Deleter<T>>;
 
+// Returns a small index that is unique for the calling thread, used to pick the per-thread cache.
+size_t getThreadCacheIndex();
+
 // Generic abstract object pool class. Users of this class must implement {@Code createObject}.
 //
+// Each pool has a few lock-free cache slots in front of the shared object list. A thread always
+// uses the same cache slot, so a thread that obtains and recycles objects in a loop never takes
+// {@code mLock}.
+//
 // This class is thread-safe. Concurrent calls to {@Code obtain} from multiple threads is OK, also
 // client can obtain an object in one thread and then move ownership to another thread.
 template <typename T>
@@ -77,11 +95,21 @@ class ObjectPool {
 
     ObjectPool(size_t maxPoolObjectsSize, GetSizeFunc getSizeFunc)
         : mMaxPoolObjectsSize(maxPoolObjectsSize), mGetSizeFunc(getSizeFunc){};
-    virtual ~ObjectPool() = default;
+    virtual ~ObjectPool() {
+        for (auto& slot : mThreadCaches) {
+            delete slot.load();
+        }
+    }
 
     virtual recyclable_ptr<T> obtain() {
-        std::scoped_lock<std::mutex> lock(mLock);
         INC_METRIC_IF_DEBUG(Obtained)
+        if (T* cached = getThreadCache().exchange(nullptr, std::memory_order_acquire);
+            cached != nullptr) {
+            INC_METRIC_IF_DEBUG(CacheObtained)
+            return wrap(cached);
+        }
+
+        std::scoped_lock<std::mutex> lock(mLock);
         if (mObjects.empty()) {
             INC_METRIC_IF_DEBUG(Created)
             return wrap(createObject());
@@ -100,11 +128,23 @@ class ObjectPool {
     virtual T* createObject() = 0;
 
     virtual void recycle(T* o) {
-        std::scoped_lock<std::mutex> lock(mLock);
         size_t objectSize = mGetSizeFunc(*o);
+        if (objectSize > mMaxPoolObjectsSize) {
+            INC_METRIC_IF_DEBUG(Deleted)
+            delete o;
+            return;
+        }
+
+        T* expected = nullptr;
+        if (getThreadCache().compare_exchange_strong(expected, o, std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+            INC_METRIC_IF_DEBUG(Recycled)
+            INC_METRIC_IF_DEBUG(CacheRecycled)
+            return;
+        }
 
-        if (objectSize > mMaxPoolObjectsSize ||
-            mPoolObjectsSize > mMaxPoolObjectsSize - objectSize) {
+        std::scoped_lock<std::mutex> lock(mLock);
+        if (mPoolObjectsSize > mMaxPoolObjectsSize - objectSize) {
             INC_METRIC_IF_DEBUG(Deleted)
 
             // We have no space left in the pool.
@@ -121,22 +161,25 @@ class ObjectPool {
     const size_t mMaxPoolObjectsSize;
 
   private:
-    const Deleter<T>& getDeleter() {
-        if (!mDeleter.get()) {
-            Deleter<T>* d =
-                    new Deleter<T>(std::bind(&ObjectPool::recycle, this, std::placeholders::_1));
-            mDeleter.reset(d);
-        }
-        return *mDeleter.get();
+    static constexpr size_t THREAD_CACHE_COUNT = 16;
+
+    std::atomic<T*>& getThreadCache() {
+        return mThreadCaches[getThreadCacheIndex() % THREAD_CACHE_COUNT];
     }
 
-    recyclable_ptr<T> wrap(T* raw) { return recyclable_ptr<T>{raw, getDeleter()}; }
+    recyclable_ptr<T> wrap(T* raw) { return recyclable_ptr<T>{raw, mDeleter}; }
 
     mutable std::mutex mLock;
     std::deque<std::unique_ptr<T>> mObjects GUARDED_BY(mLock);
-    std::unique_ptr<Deleter<T>> mDeleter;
-    size_t mPoolObjectsSize GUARDED_BY(mLock);
+    // Created up front since objects could be wrapped without holding mLock. The lambda is small
+    // enough to be stored inline in std::function, so copying it into each recyclable_ptr does not
+    // allocate.
+    const Deleter<T> mDeleter{[this](T* o) { recycle(o); }};
+    size_t mPoolObjectsSize GUARDED_BY(mLock) = 0;
     GetSizeFunc mGetSizeFunc;
+    // Each slot holds at most one free object. Objects in the slots are not counted in
+    // mPoolObjectsSize.
+    std::array<std::atomic<T*>, THREAD_CACHE_COUNT> mThreadCaches = {};
 };
 
 #undef INC_METRIC_IF_DEBUG
@@ -180,9 +223,13 @@ class VehiclePropValuePool {
     // @param maxPoolObjectsSize - The approximate upper bound of memory each internal recycling
     // pool could take. We have 4 different type pools, each with 4 different vector size, so
     // approximately this pool would at-most take 4 * 4 * 10240 = 160k memory.
-    VehiclePropValuePool(size_t maxRecyclableVectorSize = 4, size_t maxPoolObjectsSize = 10240)
-        : mMaxRecyclableVectorSize(maxRecyclableVectorSize),
-          mMaxPoolObjectsSize(maxPoolObjectsSize){};
+    //
+    // Vector values are pooled by size classes (power of 2, up to maxRecyclableVectorSize), so a
+    // recycled value could be reused for any vector size in the same class without reallocating
+    // its vector storage.
+    VehiclePropValuePool(size_t maxRecyclableVectorSize = 4, size_t maxPoolObjectsSize = 10240);
+
+    ~VehiclePropValuePool();
 
     // Obtain a recyclable VehiclePropertyValue object from the pool for the given type. If the
     // given type is not MIXED or STRING, the internal value vector size would be set to 1.
@@ -245,9 +292,19 @@ class VehiclePropValuePool {
             aidl::android::hardware::automotive::vehicle::VehiclePropertyType type,
             size_t vectorSize);
 
+    class InternalPool;
+
+    // Gets the pool for the type and size class, creating one if it does not exist yet. Returns
+    // nullptr if the type is not recyclable.
+    InternalPool* getOrCreatePool(
+            aidl::android::hardware::automotive::vehicle::VehiclePropertyType type,
+            size_t sizeClassIndex);
+
     class InternalPool
         : public ObjectPool<aidl::android::hardware::automotive::vehicle::VehiclePropValue> {
       public:
+        // {@code vectorSize} is the size class, values from this pool have at least this much
+        // capacity in their vector for the type.
         InternalPool(aidl::android::hardware::automotive::vehicle::VehiclePropertyType type,
                      size_t vectorSize, size_t maxPoolObjectsSize,
                      ObjectPool::GetSizeFunc getSizeFunc)
@@ -264,7 +321,10 @@ class VehiclePropValuePool {
 
         template <typename VecType>
         bool check(std::vector<VecType>* vec, bool isVectorType) {
-            return vec->size() == (isVectorType ? mVectorSize : 0);
+            if (!isVectorType) {
+                return vec->size() == 0;
+            }
+            return vec->size() <= mVectorSize && vec->capacity() >= mVectorSize;
         }
 
       private:
@@ -277,12 +337,18 @@ class VehiclePropValuePool {
                         delete v;
                     }};
 
+    // BOOLEAN, INT32, INT32_VEC, INT64, INT64_VEC, FLOAT, FLOAT_VEC and BYTES.
+    static constexpr size_t RECYCLABLE_TYPE_COUNT = 8;
+
+    // Only used to create new pools.
     mutable std::mutex mLock;
     const size_t mMaxRecyclableVectorSize;
     const size_t mMaxPoolObjectsSize;
-    // A map with 'property_type' | 'value_vector_size' as key and a recyclable object pool as
-    // value. We would create a recyclable pool for each property type and vector size combination.
-    std::map<int32_t, std::unique_ptr<InternalPool>> mValueTypePools GUARDED_BY(mLock);
+    const size_t mSizeClassCount;
+    // A recyclable object pool for each recyclable type and size class combination, indexed by
+    // 'type_index' * mSizeClassCount + 'size_class_index'. Pools are created lazily and never
+    // removed, so they could be looked up without taking mLock.
+    const std::unique_ptr<std::atomic<InternalPool*>[]> mValueTypePools;
 };
 
 }  // namespace vehicle
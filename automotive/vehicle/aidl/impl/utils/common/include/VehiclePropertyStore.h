@@ -17,10 +17,12 @@
 #ifndef android_hardware_automotive_vehicle_aidl_impl_utils_common_include_VehiclePropertyStore_H_
 #define android_hardware_automotive_vehicle_aidl_impl_utils_common_include_VehiclePropertyStore_H_
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include <VehicleHalTypes.h>
@@ -40,7 +42,11 @@ namespace vehicle {
 // VehiclePropertyValues stored in a sorted map thus it makes easier to get range of values, e.g.
 // to get value for all areas for particular property.
 //
-// This class is thread-safe, however it uses blocking synchronization across all methods.
+// This class is thread-safe. Records are split into {@code SHARD_COUNT} shards by property ID and
+// each shard is guarded by its own reader-writer lock, so reads could happen concurrently and
+// writes only block operations on properties in the same shard. Operations across all properties,
+// e.g. {@code readAllValues}, lock one shard at a time, so they are not an atomic snapshot of the
+// whole store.
 class VehiclePropertyStore final {
   public:
     using ValueResultType = VhalResult<VehiclePropValuePool::RecyclableType>;
@@ -163,15 +169,28 @@ class VehiclePropertyStore final {
         std::unordered_map<RecordId, VehiclePropValuePool::RecyclableType, RecordIdHash> values;
     };
 
+    struct Shard {
+        mutable std::shared_mutex lock;
+        std::unordered_map<int32_t, Record> recordsByPropId GUARDED_BY(lock);
+    };
+
+    // Must be a power of 2.
+    static constexpr size_t SHARD_COUNT = 16;
+
     // {@code VehiclePropValuePool} is thread-safe.
     std::shared_ptr<VehiclePropValuePool> mValuePool;
-    mutable std::mutex mLock;
-    std::unordered_map<int32_t, Record> mRecordsByPropId GUARDED_BY(mLock);
-    OnValueChangeCallback mOnValueChangeCallback GUARDED_BY(mLock);
+    std::array<Shard, SHARD_COUNT> mShards;
+    mutable std::shared_mutex mCallbackLock;
+    OnValueChangeCallback mOnValueChangeCallback GUARDED_BY(mCallbackLock);
+
+    Shard& getShard(int32_t propId);
+
+    const Shard& getShard(int32_t propId) const;
 
-    const Record* getRecordLocked(int32_t propId) const;
+    const Record* getRecordLocked(const Shard& shard, int32_t propId) const
+            REQUIRES_SHARED(shard.lock);
 
-    Record* getRecordLocked(int32_t propId);
+    Record* getRecordLocked(Shard& shard, int32_t propId) REQUIRES(shard.lock);
 
     RecordId getRecordIdLocked(
             const aidl::android::hardware::automotive::vehicle::VehiclePropValue& propValue,
@@ -24,6 +24,9 @@
 #include <math/HashCombine.h>
 #include <utils/Log.h>
 
+#include <limits>
+#include <unordered_map>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -231,6 +234,62 @@ android::base::Result<void> checkValueRange(
         const aidl::android::hardware::automotive::vehicle::VehiclePropValue& value,
         const aidl::android::hardware::automotive::vehicle::VehicleAreaConfig* config);
 
+// Validates values of one property like getAreaConfig, checkPropValue and checkValueRange do, but
+// with everything that only depends on the config derived once when the validator is created:
+// the expected number of values, the config of each area and which range applies.
+// The config must outlive the validator.
+class PropValueValidator final {
+  public:
+    explicit PropValueValidator(
+            const aidl::android::hardware::automotive::vehicle::VehiclePropConfig& config);
+
+    // Same as getAreaConfig(config.prop, areaId, config).
+    const aidl::android::hardware::automotive::vehicle::VehicleAreaConfig* getAreaConfig(
+            int32_t areaId) const;
+
+    // Same as checkPropValue(value, &config). value.prop must be config.prop.
+    android::base::Result<void> checkPropValue(
+            const aidl::android::hardware::automotive::vehicle::VehiclePropValue& value) const;
+
+    // Same as checkValueRange(value, areaConfig). value.prop must be config.prop.
+    android::base::Result<void> checkValueRange(
+            const aidl::android::hardware::automotive::vehicle::VehiclePropValue& value,
+            const aidl::android::hardware::automotive::vehicle::VehicleAreaConfig* areaConfig)
+            const;
+
+  private:
+    // The allowed number of elements of one of the value vectors.
+    struct SizeRange {
+        size_t min = 0;
+        size_t max = std::numeric_limits<size_t>::max();
+
+        bool contains(size_t size) const { return size >= min && size <= max; }
+    };
+
+    // The value vector that checkValueRange looks at.
+    enum class RangedValues {
+        NONE,
+        INT32,
+        INT64,
+        FLOAT,
+    };
+
+    const aidl::android::hardware::automotive::vehicle::VehiclePropConfig& mConfig;
+    bool mIsGlobal;
+    // Set for property types checkPropValue does not know.
+    bool mUnknownType = false;
+    // Set for vendor mixed properties whose configArray does not describe all the values.
+    bool mInvalidMixedConfig = false;
+    SizeRange mInt32Sizes;
+    SizeRange mInt64Sizes;
+    SizeRange mFloatSizes;
+    SizeRange mByteSizes;
+    RangedValues mRangedValues = RangedValues::NONE;
+    std::unordered_map<int32_t,
+                       const aidl::android::hardware::automotive::vehicle::VehicleAreaConfig*>
+            mAreaConfigsById;
+};
+
 // VhalError is a wrapper class for {@code StatusCode} that could act as E in {@code Result<T,E>}.
 class VhalError final {
   public:
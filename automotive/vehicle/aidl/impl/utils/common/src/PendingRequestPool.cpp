@@ -34,25 +34,21 @@ namespace {
 using ::aidl::android::hardware::automotive::vehicle::StatusCode;
 using ::android::base::Result;
 
-// At least check every 1s.
-constexpr int64_t CHECK_TIME_IN_NANO = 1'000'000'000;
-
 }  // namespace
 
 PendingRequestPool::PendingRequestPool(int64_t timeoutInNano)
     : mTimeoutInNano(timeoutInNano), mThread([this] {
           // [this] must be alive within this thread because destructor would wait for this thread
           // to exit.
-          int64_t sleepTime = std::min(mTimeoutInNano, static_cast<int64_t>(CHECK_TIME_IN_NANO));
-          std::unique_lock<std::mutex> lk(mCvLock);
-          while (!mCv.wait_for(lk, std::chrono::nanoseconds(sleepTime),
-                               [this] { return mThreadStop.load(); })) {
-              checkTimeout();
-          }
+          threadLoop();
       }) {}
 
 PendingRequestPool::~PendingRequestPool() {
     mThreadStop = true;
+    {
+        // Pairs with the wait in threadLoop so that the notification cannot be missed.
+        std::scoped_lock<std::mutex> lockGuard(mCvLock);
+    }
     mCv.notify_all();
     if (mThread.joinable()) {
         mThread.join();
@@ -62,66 +58,126 @@ PendingRequestPool::~PendingRequestPool() {
     {
         std::scoped_lock<std::mutex> lockGuard(mLock);
 
-        for (auto& [_, pendingRequests] : mPendingRequestsByClient) {
-            for (const auto& request : pendingRequests) {
+        for (auto& [_, client] : mPendingRequestsByClient) {
+            std::scoped_lock<std::mutex> clientLockGuard(client->lock);
+            for (const auto& request : client->requests) {
                 (*request.callback)(request.requestIds);
             }
         }
         mPendingRequestsByClient.clear();
+        mDeadlines.clear();
+    }
+}
+
+void PendingRequestPool::threadLoop() {
+    while (true) {
+        int64_t nextDeadline = checkTimeout();
+
+        std::unique_lock<std::mutex> lk(mCvLock);
+        auto shouldWakeUp = [this] { return mThreadStop.load() || mNewDeadline; };
+        if (nextDeadline < 0) {
+            mCv.wait(lk, shouldWakeUp);
+        } else {
+            mCv.wait_for(lk, std::chrono::nanoseconds(nextDeadline - elapsedRealtimeNano()),
+                         shouldWakeUp);
+        }
+        if (mThreadStop) {
+            return;
+        }
+        mNewDeadline = false;
+    }
+}
+
+PendingRequestPool::ClientRequests* PendingRequestPool::lockClient(
+        const void* clientId, std::unique_lock<std::mutex>* clientLock) const {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    auto it = mPendingRequestsByClient.find(clientId);
+    if (it == mPendingRequestsByClient.end()) {
+        return nullptr;
     }
+    // Take the client lock before releasing mLock, checkTimeout only removes a client while
+    // holding both.
+    *clientLock = std::unique_lock<std::mutex>(it->second->lock);
+    return it->second.get();
 }
 
 VhalResult<void> PendingRequestPool::addRequests(
         const void* clientId, const std::unordered_set<int64_t>& requestIds,
         std::shared_ptr<const TimeoutCallbackFunc> callback) {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
-    std::list<PendingRequest>* pendingRequests;
+    std::unique_lock<std::mutex> clientLock;
+    ClientRequests* client = nullptr;
+    bool firstDeadline = false;
+    int64_t timeoutTimestamp = 0;
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+
+        auto& clientRequests = mPendingRequestsByClient[clientId];
+        if (clientRequests == nullptr) {
+            clientRequests = std::make_unique<ClientRequests>();
+        }
+        client = clientRequests.get();
+        clientLock = std::unique_lock<std::mutex>(client->lock);
+
+        // The deadline is added before the requests are checked, so that the deadlines stay in
+        // order. If the requests are rejected it is simply ignored.
+        timeoutTimestamp = elapsedRealtimeNano() + mTimeoutInNano;
+        firstDeadline = mDeadlines.empty();
+        mDeadlines.push_back({
+                .timeoutTimestamp = timeoutTimestamp,
+                .clientId = clientId,
+        });
+    }
+    // Later deadlines are found by the thread when it wakes up for the earlier ones.
+    if (firstDeadline) {
+        {
+            std::scoped_lock<std::mutex> lockGuard(mCvLock);
+            mNewDeadline = true;
+        }
+        mCv.notify_one();
+    }
+
     size_t pendingRequestCount = 0;
-    if (mPendingRequestsByClient.find(clientId) != mPendingRequestsByClient.end()) {
-        pendingRequests = &mPendingRequestsByClient[clientId];
-        for (const auto& pendingRequest : *pendingRequests) {
-            const auto& pendingRequestIds = pendingRequest.requestIds;
-            for (int64_t requestId : requestIds) {
-                if (pendingRequestIds.find(requestId) != pendingRequestIds.end()) {
-                    return StatusError(StatusCode::INVALID_ARG)
-                           << "duplicate request ID: " << requestId;
-                }
+    for (const auto& pendingRequest : client->requests) {
+        const auto& pendingRequestIds = pendingRequest.requestIds;
+        for (int64_t requestId : requestIds) {
+            if (pendingRequestIds.find(requestId) != pendingRequestIds.end()) {
+                return StatusError(StatusCode::INVALID_ARG)
+                       << "duplicate request ID: " << requestId;
             }
-            pendingRequestCount += pendingRequestIds.size();
         }
-    } else {
-        // Create a new empty list for this client.
-        pendingRequests = &mPendingRequestsByClient[clientId];
+        pendingRequestCount += pendingRequestIds.size();
     }
 
     if (requestIds.size() > MAX_PENDING_REQUEST_PER_CLIENT - pendingRequestCount) {
         return StatusError(StatusCode::TRY_AGAIN) << "too many pending requests";
     }
 
-    int64_t currentTime = elapsedRealtimeNano();
-    int64_t timeoutTimestamp = currentTime + mTimeoutInNano;
-
-    pendingRequests->push_back({
+    client->requests.push_back({
             .requestIds = std::unordered_set<int64_t>(requestIds.begin(), requestIds.end()),
             .timeoutTimestamp = timeoutTimestamp,
             .callback = callback,
     });
-
     return {};
 }
 
 bool PendingRequestPool::isRequestPending(const void* clientId, int64_t requestId) const {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
+    std::unique_lock<std::mutex> clientLock;
+    const ClientRequests* client = lockClient(clientId, &clientLock);
+    if (client == nullptr) {
+        return false;
+    }
 
-    return isRequestPendingLocked(clientId, requestId);
+    return isRequestPendingLocked(*client, requestId);
 }
 
 size_t PendingRequestPool::countPendingRequests() const {
     std::scoped_lock<std::mutex> lockGuard(mLock);
 
     size_t count = 0;
-    for (const auto& [clientId, requests] : mPendingRequestsByClient) {
-        for (const auto& request : requests) {
+    for (const auto& [clientId, client] : mPendingRequestsByClient) {
+        std::scoped_lock<std::mutex> clientLockGuard(client->lock);
+        for (const auto& request : client->requests) {
             count += request.requestIds.size();
         }
     }
@@ -129,27 +185,22 @@ size_t PendingRequestPool::countPendingRequests() const {
 }
 
 size_t PendingRequestPool::countPendingRequests(const void* clientId) const {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
-
-    auto it = mPendingRequestsByClient.find(clientId);
-    if (it == mPendingRequestsByClient.end()) {
+    std::unique_lock<std::mutex> clientLock;
+    const ClientRequests* client = lockClient(clientId, &clientLock);
+    if (client == nullptr) {
         return 0;
     }
 
     size_t count = 0;
-    for (const auto& pendingRequest : it->second) {
+    for (const auto& pendingRequest : client->requests) {
         count += pendingRequest.requestIds.size();
     }
 
     return count;
 }
 
-bool PendingRequestPool::isRequestPendingLocked(const void* clientId, int64_t requestId) const {
-    auto it = mPendingRequestsByClient.find(clientId);
-    if (it == mPendingRequestsByClient.end()) {
-        return false;
-    }
-    for (const auto& pendingRequest : it->second) {
+bool PendingRequestPool::isRequestPendingLocked(const ClientRequests& client, int64_t requestId) {
+    for (const auto& pendingRequest : client.requests) {
         const auto& requestIds = pendingRequest.requestIds;
         if (requestIds.find(requestId) != requestIds.end()) {
             return true;
@@ -158,32 +209,45 @@ bool PendingRequestPool::isRequestPendingLocked(const void* clientId, int64_t re
     return false;
 }
 
-void PendingRequestPool::checkTimeout() {
+int64_t PendingRequestPool::checkTimeout() {
     std::vector<PendingRequest> timeoutRequests;
+    int64_t nextDeadline = -1;
     {
         std::scoped_lock<std::mutex> lockGuard(mLock);
 
         int64_t currentTime = elapsedRealtimeNano();
 
-        std::vector<const void*> clientsWithEmptyRequests;
+        // Only the clients with an expired deadline need to be looked at.
+        while (!mDeadlines.empty() && mDeadlines.front().timeoutTimestamp < currentTime) {
+            const void* clientId = mDeadlines.front().clientId;
+            mDeadlines.pop_front();
 
-        for (auto& [clientId, pendingRequests] : mPendingRequestsByClient) {
-            auto it = pendingRequests.begin();
-            while (it != pendingRequests.end()) {
-                if (it->timeoutTimestamp >= currentTime) {
-                    break;
+            auto clientIt = mPendingRequestsByClient.find(clientId);
+            if (clientIt == mPendingRequestsByClient.end()) {
+                continue;
+            }
+            bool empty = false;
+            {
+                std::scoped_lock<std::mutex> clientLockGuard(clientIt->second->lock);
+                auto& pendingRequests = clientIt->second->requests;
+                auto it = pendingRequests.begin();
+                while (it != pendingRequests.end()) {
+                    if (it->timeoutTimestamp >= currentTime) {
+                        break;
+                    }
+                    timeoutRequests.push_back(std::move(*it));
+                    it = pendingRequests.erase(it);
                 }
-                timeoutRequests.push_back(std::move(*it));
-                it = pendingRequests.erase(it);
+                empty = pendingRequests.empty();
             }
-
-            if (pendingRequests.empty()) {
-                clientsWithEmptyRequests.push_back(clientId);
+            // Nobody else can hold the client lock now, as it is only taken under mLock.
+            if (empty) {
+                mPendingRequestsByClient.erase(clientIt);
             }
         }
 
-        for (const void* clientId : clientsWithEmptyRequests) {
-            mPendingRequestsByClient.erase(clientId);
+        if (!mDeadlines.empty()) {
+            nextDeadline = mDeadlines.front().timeoutTimestamp;
         }
     }
 
@@ -191,19 +255,22 @@ void PendingRequestPool::checkTimeout() {
     for (const auto& request : timeoutRequests) {
         (*request.callback)(request.requestIds);
     }
+    return nextDeadline;
 }
 
 std::unordered_set<int64_t> PendingRequestPool::tryFinishRequests(
         const void* clientId, const std::unordered_set<int64_t>& requestIds) {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
-
     std::unordered_set<int64_t> foundIds;
 
-    if (mPendingRequestsByClient.find(clientId) == mPendingRequestsByClient.end()) {
+    std::unique_lock<std::mutex> clientLock;
+    ClientRequests* client = lockClient(clientId, &clientLock);
+    if (client == nullptr) {
         return foundIds;
     }
 
-    auto& pendingRequests = mPendingRequestsByClient[clientId];
+    // An empty client is removed when its last deadline expires rather than here, so that this
+    // does not need mLock.
+    auto& pendingRequests = client->requests;
     auto it = pendingRequests.begin();
     while (it != pendingRequests.end()) {
         auto& pendingRequestIds = it->requestIds;
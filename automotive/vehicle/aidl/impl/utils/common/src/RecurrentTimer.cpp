@@ -20,7 +20,8 @@
 #include <utils/SystemClock.h>
 
 #include <inttypes.h>
-#include <math.h>
+
+#include <algorithm>
 
 namespace android {
 namespace hardware {
@@ -29,7 +30,26 @@ namespace vehicle {
 
 using ::android::base::ScopedLockAssertion;
 
-RecurrentTimer::RecurrentTimer() : mThread(&RecurrentTimer::loop, this) {}
+namespace {
+
+int64_t toTickFloor(int64_t timeInNano) {
+    return timeInNano / RecurrentTimer::TICK_IN_NANO;
+}
+
+int64_t toTickCeil(int64_t timeInNano) {
+    return (timeInNano + RecurrentTimer::TICK_IN_NANO - 1) / RecurrentTimer::TICK_IN_NANO;
+}
+
+}  // namespace
+
+RecurrentTimer::RecurrentTimer(size_t workerThreadCount)
+    : mCurrentTick(toTickFloor(uptimeNanos())) {
+    // Start the threads after all the members are initialized.
+    mThread = std::thread(&RecurrentTimer::loop, this);
+    for (size_t i = 0; i < workerThreadCount; i++) {
+        mWorkerThreads.emplace_back(&RecurrentTimer::workerLoop, this);
+    }
+}
 
 RecurrentTimer::~RecurrentTimer() {
     {
@@ -40,80 +60,142 @@ RecurrentTimer::~RecurrentTimer() {
     if (mThread.joinable()) {
         mThread.join();
     }
+    {
+        std::scoped_lock<std::mutex> lockGuard(mWorkerLock);
+        mWorkerStopRequested = true;
+    }
+    mWorkerCond.notify_all();
+    for (auto& thread : mWorkerThreads) {
+        thread.join();
+    }
 }
 
 void RecurrentTimer::registerTimerCallback(int64_t intervalInNano,
                                            std::shared_ptr<RecurrentTimer::Callback> callback) {
+    bool needWakeUp = false;
     {
         std::scoped_lock<std::mutex> lockGuard(mLock);
 
-        // Aligns the nextTime to multiply of interval.
-        int64_t nextTime = ceil(uptimeNanos() / intervalInNano) * intervalInNano;
-
-        std::unique_ptr<CallbackInfo> info = std::make_unique<CallbackInfo>();
-        info->callback = callback;
-        info->interval = intervalInNano;
-        info->nextTime = nextTime;
+        int64_t now = uptimeNanos();
+        if (mCallbacks.empty()) {
+            // The timer thread does not advance the wheel while there is no callback.
+            mCurrentTick = toTickFloor(now);
+        }
 
+        CallbackInfo* info;
         auto it = mCallbacks.find(callback);
         if (it != mCallbacks.end()) {
             ALOGI("Replacing an existing timer callback with a new interval, current: %" PRId64
                   " ns, new: %" PRId64 " ns",
                   it->second->interval, intervalInNano);
-            markOutdatedLocked(it->second);
+            info = it->second.get();
+            removeLocked(info);
+        } else {
+            auto newInfo = std::make_unique<CallbackInfo>();
+            info = newInfo.get();
+            info->callback = callback;
+            mCallbacks[callback] = std::move(newInfo);
         }
-        mCallbacks[callback] = info.get();
-        mCallbackQueue.push_back(std::move(info));
-        // Insert the last element into the heap.
-        std::push_heap(mCallbackQueue.begin(), mCallbackQueue.end(), CallbackInfo::cmp);
+
+        // Aligns the nextTime to multiply of interval.
+        info->interval = intervalInNano;
+        info->nextTime = (now / intervalInNano) * intervalInNano;
+        info->expireTick = toTickCeil(info->nextTime);
+        insertLocked(info);
+
+        // Only wake up the timer thread if it would otherwise sleep past this callback.
+        needWakeUp = info->expireTick < mWakeUpTick;
+    }
+    if (needWakeUp) {
+        mCond.notify_one();
     }
-    mCond.notify_one();
 }
 
 void RecurrentTimer::unregisterTimerCallback(std::shared_ptr<RecurrentTimer::Callback> callback) {
-    {
-        std::scoped_lock<std::mutex> lockGuard(mLock);
-
-        auto it = mCallbacks.find(callback);
-        if (it == mCallbacks.end()) {
-            ALOGE("No event found to unregister");
-            return;
-        }
+    std::scoped_lock<std::mutex> lockGuard(mLock);
 
-        markOutdatedLocked(it->second);
-        mCallbacks.erase(it);
+    auto it = mCallbacks.find(callback);
+    if (it == mCallbacks.end()) {
+        ALOGE("No event found to unregister");
+        return;
     }
 
-    mCond.notify_one();
+    removeLocked(it->second.get());
+    mCallbacks.erase(it);
+    // No need to wake up the timer thread, it would find nothing to run in the slot.
 }
 
-void RecurrentTimer::markOutdatedLocked(RecurrentTimer::CallbackInfo* info) {
-    info->outdated = true;
-    info->callback = nullptr;
-    // Make sure the first element is always valid.
-    removeInvalidCallbackLocked();
+void RecurrentTimer::insertLocked(RecurrentTimer::CallbackInfo* info) {
+    // A callback that is already overdue would run in the next processed tick.
+    int64_t delta = std::max<int64_t>(info->expireTick - mCurrentTick, 0);
+    int64_t slotTick = mCurrentTick + delta;
+    size_t level = 0;
+    while (level < WHEEL_LEVEL_COUNT - 1 &&
+           delta >= (static_cast<int64_t>(1) << (WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    int64_t levelSpan = static_cast<int64_t>(1) << (WHEEL_SLOT_BITS * (level + 1));
+    if (delta >= levelSpan) {
+        // Beyond the last level, put it in the furthest slot and it would be moved again once
+        // that slot is reached.
+        slotTick = mCurrentTick + levelSpan - 1;
+    }
+    info->level = level;
+    info->slot = (slotTick >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+    WheelSlot& slot = mWheel[level][info->slot];
+    info->position = slot.insert(slot.end(), info);
 }
 
-void RecurrentTimer::removeInvalidCallbackLocked() {
-    while (mCallbackQueue.size() != 0 && mCallbackQueue[0]->outdated) {
-        std::pop_heap(mCallbackQueue.begin(), mCallbackQueue.end(), CallbackInfo::cmp);
-        mCallbackQueue.pop_back();
-    }
+void RecurrentTimer::removeLocked(RecurrentTimer::CallbackInfo* info) {
+    mWheel[info->level][info->slot].erase(info->position);
 }
 
-std::shared_ptr<RecurrentTimer::Callback> RecurrentTimer::getNextCallbackLocked(int64_t now) {
-    std::pop_heap(mCallbackQueue.begin(), mCallbackQueue.end(), CallbackInfo::cmp);
-    auto& callbackInfo = mCallbackQueue[mCallbackQueue.size() - 1];
-    auto nextCallback = callbackInfo->callback;
-    // intervalCount is the number of interval we have to advance until we pass now.
-    size_t intervalCount = (now - callbackInfo->nextTime) / callbackInfo->interval + 1;
-    callbackInfo->nextTime += intervalCount * callbackInfo->interval;
-    std::push_heap(mCallbackQueue.begin(), mCallbackQueue.end(), CallbackInfo::cmp);
+void RecurrentTimer::advanceLocked(int64_t now, int64_t nowTick,
+                                   std::vector<std::shared_ptr<Callback>>* callbacksToRun) {
+    WheelSlot pending;
+    for (; mCurrentTick <= nowTick; mCurrentTick++) {
+        int64_t tick = mCurrentTick;
+        // Move callbacks down from higher levels once all the lower levels wrap around.
+        for (size_t level = 1; level < WHEEL_LEVEL_COUNT; level++) {
+            if ((tick & ((static_cast<int64_t>(1) << (WHEEL_SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            size_t slotIndex = (tick >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+            pending.splice(pending.end(), mWheel[level][slotIndex]);
+            while (!pending.empty()) {
+                CallbackInfo* info = pending.front();
+                pending.pop_front();
+                insertLocked(info);
+            }
+        }
 
-    // Make sure the first element is always valid.
-    removeInvalidCallbackLocked();
+        pending.splice(pending.end(), mWheel[0][tick & WHEEL_SLOT_MASK]);
+        while (!pending.empty()) {
+            CallbackInfo* info = pending.front();
+            pending.pop_front();
+            if (info->expireTick > tick) {
+                insertLocked(info);
+                continue;
+            }
+            callbacksToRun->push_back(info->callback);
+            // intervalCount is the number of interval we have to advance until we pass now.
+            int64_t intervalCount = (now - info->nextTime) / info->interval + 1;
+            info->nextTime += intervalCount * info->interval;
+            info->expireTick = toTickCeil(info->nextTime);
+            insertLocked(info);
+        }
+    }
+}
 
-    return nextCallback;
+int64_t RecurrentTimer::getWakeUpTickLocked() {
+    for (size_t i = 0; i < WHEEL_SLOT_COUNT; i++) {
+        int64_t tick = mCurrentTick + i;
+        if ((tick & WHEEL_SLOT_MASK) == 0 || !mWheel[0][tick & WHEEL_SLOT_MASK].empty()) {
+            return tick;
+        }
+    }
+    // Not reachable, the loop always hits a level 0 wrap around.
+    return mCurrentTick + WHEEL_SLOT_COUNT;
 }
 
 void RecurrentTimer::loop() {
@@ -122,56 +204,78 @@ void RecurrentTimer::loop() {
         {
             std::unique_lock<std::mutex> uniqueLock(mLock);
             ScopedLockAssertion lockAssertion(mLock);
-            // Wait until the timer exits or we have at least one recurrent callback.
-            mCond.wait(uniqueLock, [this] {
-                ScopedLockAssertion lockAssertion(mLock);
-                return mStopRequested || mCallbackQueue.size() != 0;
-            });
-
-            int64_t interval;
-            if (mStopRequested) {
-                return;
-            }
-            // The first element is the nearest next event.
-            int64_t nextTime = mCallbackQueue[0]->nextTime;
-            int64_t now = uptimeNanos();
-
-            if (nextTime > now) {
-                interval = nextTime - now;
-            } else {
-                interval = 0;
-            }
-
-            // Wait for the next event or the timer exits.
-            if (mCond.wait_for(uniqueLock, std::chrono::nanoseconds(interval), [this] {
-                    ScopedLockAssertion lockAssertion(mLock);
-                    return mStopRequested;
-                })) {
-                return;
-            }
-
-            now = uptimeNanos();
-            callbacksToRun.clear();
-            while (mCallbackQueue.size() > 0) {
-                int64_t nextTime = mCallbackQueue[0]->nextTime;
-                if (nextTime > now) {
+            int64_t now;
+            while (true) {
+                if (mStopRequested) {
+                    return;
+                }
+                now = uptimeNanos();
+                if (mCallbacks.empty()) {
+                    // Wait until the timer exits or we have at least one recurrent callback.
+                    mWakeUpTick = INT64_MAX;
+                    mCond.wait(uniqueLock);
+                    continue;
+                }
+                mWakeUpTick = getWakeUpTickLocked();
+                int64_t wakeUpTime = mWakeUpTick * TICK_IN_NANO;
+                if (wakeUpTime <= now) {
                     break;
                 }
-
-                callbacksToRun.push_back(getNextCallbackLocked(now));
+                // Wait for the next tick, a new callback that is due earlier or the timer exits.
+                mCond.wait_for(uniqueLock, std::chrono::nanoseconds(wakeUpTime - now));
             }
+
+            callbacksToRun.clear();
+            advanceLocked(now, toTickFloor(now), &callbacksToRun);
         }
 
         // Do not execute the callback while holding the lock.
-        for (size_t i = 0; i < callbacksToRun.size(); i++) {
-            (*callbacksToRun[i])();
+        runCallbacks(callbacksToRun);
+    }
+}
+
+void RecurrentTimer::runCallbacks(const std::vector<std::shared_ptr<Callback>>& callbacks) {
+    if (mWorkerThreads.empty()) {
+        for (const auto& callback : callbacks) {
+            (*callback)();
         }
+        return;
     }
+    {
+        std::scoped_lock<std::mutex> lockGuard(mWorkerLock);
+        for (const auto& callback : callbacks) {
+            if (!mActiveCallbacks.insert(callback.get()).second) {
+                // The previous run has not finished yet, skip this one instead of piling up.
+                continue;
+            }
+            mPendingCallbacks.push_back(callback);
+        }
+    }
+    mWorkerCond.notify_all();
 }
 
-bool RecurrentTimer::CallbackInfo::cmp(const std::unique_ptr<RecurrentTimer::CallbackInfo>& lhs,
-                                       const std::unique_ptr<RecurrentTimer::CallbackInfo>& rhs) {
-    return lhs->nextTime > rhs->nextTime;
+void RecurrentTimer::workerLoop() {
+    while (true) {
+        std::shared_ptr<Callback> callback;
+        {
+            std::unique_lock<std::mutex> uniqueLock(mWorkerLock);
+            ScopedLockAssertion lockAssertion(mWorkerLock);
+            mWorkerCond.wait(uniqueLock, [this] {
+                ScopedLockAssertion lockAssertion(mWorkerLock);
+                return mWorkerStopRequested || !mPendingCallbacks.empty();
+            });
+            if (mWorkerStopRequested) {
+                return;
+            }
+            callback = std::move(mPendingCallbacks.front());
+            mPendingCallbacks.pop_front();
+        }
+
+        (*callback)();
+
+        std::scoped_lock<std::mutex> lockGuard(mWorkerLock);
+        mActiveCallbacks.erase(callback.get());
+    }
 }
 
 }  // namespace vehicle
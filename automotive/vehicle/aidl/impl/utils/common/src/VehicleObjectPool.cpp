@@ -20,7 +20,9 @@
 
 #include <VehicleUtils.h>
 
+#include <android-base/stringprintf.h>
 #include <assert.h>
+#include <inttypes.h>
 #include <utils/Log.h>
 
 namespace android {
@@ -32,6 +34,105 @@ using ::aidl::android::hardware::automotive::vehicle::RawPropValues;
 using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyType;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::android::base::StringPrintf;
+
+namespace {
+
+// Returns the index of the smallest power of 2 that is not smaller than vectorSize.
+size_t getSizeClassIndex(size_t vectorSize) {
+    size_t index = 0;
+    while ((static_cast<size_t>(1) << index) < vectorSize) {
+        index++;
+    }
+    return index;
+}
+
+// Returns the index among recyclable types, or -1 if the type is not recyclable.
+int getRecyclableTypeIndex(VehiclePropertyType type) {
+    switch (type) {
+        case VehiclePropertyType::BOOLEAN:
+            return 0;
+        case VehiclePropertyType::INT32:
+            return 1;
+        case VehiclePropertyType::INT32_VEC:
+            return 2;
+        case VehiclePropertyType::INT64:
+            return 3;
+        case VehiclePropertyType::INT64_VEC:
+            return 4;
+        case VehiclePropertyType::FLOAT:
+            return 5;
+        case VehiclePropertyType::FLOAT_VEC:
+            return 6;
+        case VehiclePropertyType::BYTES:
+            return 7;
+        default:
+            return -1;
+    }
+}
+
+// Resizes the value vector for the type. The vector already has enough capacity for its size
+// class, so this never reallocates.
+void resizeValueVector(RawPropValues* value, VehiclePropertyType type, size_t vectorSize) {
+    switch (type) {
+        case VehiclePropertyType::BOOLEAN:
+            [[fallthrough]];
+        case VehiclePropertyType::INT32:
+            [[fallthrough]];
+        case VehiclePropertyType::INT32_VEC:
+            value->int32Values.resize(vectorSize);
+            break;
+        case VehiclePropertyType::INT64:
+            [[fallthrough]];
+        case VehiclePropertyType::INT64_VEC:
+            value->int64Values.resize(vectorSize);
+            break;
+        case VehiclePropertyType::FLOAT:
+            [[fallthrough]];
+        case VehiclePropertyType::FLOAT_VEC:
+            value->floatValues.resize(vectorSize);
+            break;
+        case VehiclePropertyType::BYTES:
+            value->byteValues.resize(vectorSize);
+            break;
+        default:
+            break;
+    }
+}
+
+}  // namespace
+
+size_t getThreadCacheIndex() {
+    static std::atomic<size_t> nextIndex = 0;
+    static thread_local size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+std::string PoolStats::dump() const {
+    return StringPrintf("Value pool: obtained: %" PRIu32 " (%" PRIu32
+                        " from thread cache), created: %" PRIu32 ", recycled: %" PRIu32
+                        " (%" PRIu32 " to thread cache), deleted: %" PRIu32
+                        ", disposable: %" PRIu32 "\n",
+                        Obtained.load(), CacheObtained.load(), Created.load(), Recycled.load(),
+                        CacheRecycled.load(), Deleted.load(), Disposable.load());
+}
+
+VehiclePropValuePool::VehiclePropValuePool(size_t maxRecyclableVectorSize,
+                                           size_t maxPoolObjectsSize)
+    : mMaxRecyclableVectorSize(maxRecyclableVectorSize),
+      mMaxPoolObjectsSize(maxPoolObjectsSize),
+      mSizeClassCount(getSizeClassIndex(maxRecyclableVectorSize) + 1),
+      mValueTypePools(new std::atomic<InternalPool*>[RECYCLABLE_TYPE_COUNT * mSizeClassCount]) {
+    for (size_t i = 0; i < RECYCLABLE_TYPE_COUNT * mSizeClassCount; i++) {
+        mValueTypePools[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+VehiclePropValuePool::~VehiclePropValuePool() {
+    for (size_t i = 0; i < RECYCLABLE_TYPE_COUNT * mSizeClassCount; i++) {
+        delete mValueTypePools[i].load();
+    }
+}
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtain(VehiclePropertyType type) {
     if (isComplexType(type)) {
@@ -103,19 +204,38 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainComplex() {
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainRecyclable(
         VehiclePropertyType type, size_t vectorSize) {
-    std::scoped_lock<std::mutex> lock(mLock);
     assert(vectorSize > 0);
 
-    // VehiclePropertyType is not overlapping with vectorSize.
-    int32_t key = static_cast<int32_t>(type) | static_cast<int32_t>(vectorSize);
-    auto it = mValueTypePools.find(key);
+    InternalPool* pool = getOrCreatePool(type, getSizeClassIndex(vectorSize));
+    if (pool == nullptr) {
+        return obtainDisposable(type, vectorSize);
+    }
+    auto value = pool->obtain();
+    resizeValueVector(&value->value, type, vectorSize);
+    return value;
+}
 
-    if (it == mValueTypePools.end()) {
-        auto newPool(std::make_unique<InternalPool>(type, vectorSize, mMaxPoolObjectsSize,
-                                                    getVehiclePropValueSize));
-        it = mValueTypePools.emplace(key, std::move(newPool)).first;
+VehiclePropValuePool::InternalPool* VehiclePropValuePool::getOrCreatePool(
+        VehiclePropertyType type, size_t sizeClassIndex) {
+    int typeIndex = getRecyclableTypeIndex(type);
+    if (typeIndex < 0) {
+        return nullptr;
+    }
+    std::atomic<InternalPool*>& slot =
+            mValueTypePools[static_cast<size_t>(typeIndex) * mSizeClassCount + sizeClassIndex];
+    if (InternalPool* pool = slot.load(std::memory_order_acquire); pool != nullptr) {
+        return pool;
+    }
+
+    std::scoped_lock<std::mutex> lock(mLock);
+    if (InternalPool* pool = slot.load(std::memory_order_relaxed); pool != nullptr) {
+        return pool;
     }
-    return it->second->obtain();
+    InternalPool* pool =
+            new InternalPool(type, static_cast<size_t>(1) << sizeClassIndex, mMaxPoolObjectsSize,
+                             getVehiclePropValueSize);
+    slot.store(pool, std::memory_order_release);
+    return pool;
 }
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainBoolean(bool value) {
@@ -124,6 +244,7 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainBoolean(bool va
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainDisposable(
         VehiclePropertyType valueType, size_t vectorSize) const {
+    PoolStats::instance()->Disposable++;
     return RecyclableType{createVehiclePropValueVec(valueType, vectorSize).release(),
                           mDisposableDeleter};
 }
@@ -137,8 +258,9 @@ void VehiclePropValuePool::InternalPool::recycle(VehiclePropValue* o) {
     if (!check(&o->value)) {
         ALOGE("Discarding value for prop 0x%x because it contains "
               "data that is not consistent with this pool. "
-              "Expected type: %d, vector size: %zu",
+              "Expected type: %d, vector size class: %zu",
               o->prop, toInt(mPropType), mVectorSize);
+        PoolStats::instance()->Deleted++;
         delete o;
     } else {
         ObjectPool<VehiclePropValue>::recycle(o);
@@ -39,6 +39,23 @@ using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
 using ::android::base::Result;
 using ::android::base::StringPrintf;
 
+namespace {
+
+// A scoped guard that holds a shared (reader) lock, annotated for thread-safety analysis.
+class SCOPED_CAPABILITY SharedLockGuard final {
+  public:
+    explicit SharedLockGuard(std::shared_mutex& lock) ACQUIRE_SHARED(lock) : mLock(lock) {
+        mLock.lock_shared();
+    }
+
+    ~SharedLockGuard() RELEASE() { mLock.unlock_shared(); }
+
+  private:
+    std::shared_mutex& mLock;
+};
+
+}  // namespace
+
 bool VehiclePropertyStore::RecordId::operator==(const VehiclePropertyStore::RecordId& other) const {
     return area == other.area && token == other.token;
 }
@@ -55,28 +72,35 @@ size_t VehiclePropertyStore::RecordIdHash::operator()(RecordId const& recordId)
 }
 
 VehiclePropertyStore::~VehiclePropertyStore() {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
-
     // Recycling record requires mValuePool, so need to recycle them before destroying mValuePool.
-    mRecordsByPropId.clear();
+    for (Shard& shard : mShards) {
+        std::scoped_lock<std::shared_mutex> lockGuard(shard.lock);
+        shard.recordsByPropId.clear();
+    }
     mValuePool.reset();
 }
 
-const VehiclePropertyStore::Record* VehiclePropertyStore::getRecordLocked(int32_t propId) const
-        REQUIRES(mLock) {
-    auto RecordIt = mRecordsByPropId.find(propId);
-    return RecordIt == mRecordsByPropId.end() ? nullptr : &RecordIt->second;
+VehiclePropertyStore::Shard& VehiclePropertyStore::getShard(int32_t propId) {
+    return mShards[static_cast<uint32_t>(propId) & (SHARD_COUNT - 1)];
+}
+
+const VehiclePropertyStore::Shard& VehiclePropertyStore::getShard(int32_t propId) const {
+    return mShards[static_cast<uint32_t>(propId) & (SHARD_COUNT - 1)];
 }
 
-VehiclePropertyStore::Record* VehiclePropertyStore::getRecordLocked(int32_t propId)
-        REQUIRES(mLock) {
-    auto RecordIt = mRecordsByPropId.find(propId);
-    return RecordIt == mRecordsByPropId.end() ? nullptr : &RecordIt->second;
+const VehiclePropertyStore::Record* VehiclePropertyStore::getRecordLocked(const Shard& shard,
+                                                                          int32_t propId) const {
+    auto RecordIt = shard.recordsByPropId.find(propId);
+    return RecordIt == shard.recordsByPropId.end() ? nullptr : &RecordIt->second;
+}
+
+VehiclePropertyStore::Record* VehiclePropertyStore::getRecordLocked(Shard& shard, int32_t propId) {
+    auto RecordIt = shard.recordsByPropId.find(propId);
+    return RecordIt == shard.recordsByPropId.end() ? nullptr : &RecordIt->second;
 }
 
 VehiclePropertyStore::RecordId VehiclePropertyStore::getRecordIdLocked(
-        const VehiclePropValue& propValue, const VehiclePropertyStore::Record& record) const
-        REQUIRES(mLock) {
+        const VehiclePropValue& propValue, const VehiclePropertyStore::Record& record) const {
     VehiclePropertyStore::RecordId recId{
             .area = isGlobalProp(propValue.prop) ? 0 : propValue.areaId, .token = 0};
 
@@ -87,7 +111,7 @@ VehiclePropertyStore::RecordId VehiclePropertyStore::getRecordIdLocked(
 }
 
 VhalResult<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readValueLocked(
-        const RecordId& recId, const Record& record) const REQUIRES(mLock) {
+        const RecordId& recId, const Record& record) const {
     if (auto it = record.values.find(recId); it != record.values.end()) {
         return mValuePool->obtain(*(it->second));
     }
@@ -97,9 +121,10 @@ VhalResult<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readValue
 
 void VehiclePropertyStore::registerProperty(const VehiclePropConfig& config,
                                             VehiclePropertyStore::TokenFunction tokenFunc) {
-    std::scoped_lock<std::mutex> g(mLock);
+    Shard& shard = getShard(config.prop);
+    std::scoped_lock<std::shared_mutex> g(shard.lock);
 
-    mRecordsByPropId[config.prop] = Record{
+    shard.recordsByPropId[config.prop] = Record{
             .propConfig = config,
             .tokenFunction = tokenFunc,
     };
@@ -108,11 +133,11 @@ void VehiclePropertyStore::registerProperty(const VehiclePropConfig& config,
 VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::RecyclableType propValue,
                                                   bool updateStatus,
                                                   VehiclePropertyStore::EventMode eventMode) {
-    std::scoped_lock<std::mutex> g(mLock);
-
     int32_t propId = propValue->prop;
+    Shard& shard = getShard(propId);
+    std::scoped_lock<std::shared_mutex> g(shard.lock);
 
-    VehiclePropertyStore::Record* record = getRecordLocked(propId);
+    VehiclePropertyStore::Record* record = getRecordLocked(shard, propId);
     if (record == nullptr) {
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
     }
@@ -151,16 +176,22 @@ VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::Recyclab
         return {};
     }
 
-    if ((eventMode == EventMode::ALWAYS || valueUpdated) && mOnValueChangeCallback != nullptr) {
-        mOnValueChangeCallback(*(record->values[recId]));
+    if (eventMode == EventMode::ALWAYS || valueUpdated) {
+        // The callback is still invoked while holding the shard lock so that events for the same
+        // property are delivered in the order they are written.
+        SharedLockGuard callbackGuard(mCallbackLock);
+        if (mOnValueChangeCallback != nullptr) {
+            mOnValueChangeCallback(*(record->values[recId]));
+        }
     }
     return {};
 }
 
 void VehiclePropertyStore::removeValue(const VehiclePropValue& propValue) {
-    std::scoped_lock<std::mutex> g(mLock);
+    Shard& shard = getShard(propValue.prop);
+    std::scoped_lock<std::shared_mutex> g(shard.lock);
 
-    VehiclePropertyStore::Record* record = getRecordLocked(propValue.prop);
+    VehiclePropertyStore::Record* record = getRecordLocked(shard, propValue.prop);
     if (record == nullptr) {
         return;
     }
@@ -172,9 +203,10 @@ void VehiclePropertyStore::removeValue(const VehiclePropValue& propValue) {
 }
 
 void VehiclePropertyStore::removeValuesForProperty(int32_t propId) {
-    std::scoped_lock<std::mutex> g(mLock);
+    Shard& shard = getShard(propId);
+    std::scoped_lock<std::shared_mutex> g(shard.lock);
 
-    VehiclePropertyStore::Record* record = getRecordLocked(propId);
+    VehiclePropertyStore::Record* record = getRecordLocked(shard, propId);
     if (record == nullptr) {
         return;
     }
@@ -183,13 +215,14 @@ void VehiclePropertyStore::removeValuesForProperty(int32_t propId) {
 }
 
 std::vector<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readAllValues() const {
-    std::scoped_lock<std::mutex> g(mLock);
-
     std::vector<VehiclePropValuePool::RecyclableType> allValues;
 
-    for (auto const& [_, record] : mRecordsByPropId) {
-        for (auto const& [_, value] : record.values) {
-            allValues.push_back(std::move(mValuePool->obtain(*value)));
+    for (const Shard& shard : mShards) {
+        SharedLockGuard g(shard.lock);
+        for (auto const& [_, record] : shard.recordsByPropId) {
+            for (auto const& [_, value] : record.values) {
+                allValues.push_back(std::move(mValuePool->obtain(*value)));
+            }
         }
     }
 
@@ -198,11 +231,12 @@ std::vector<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readAllV
 
 VehiclePropertyStore::ValuesResultType VehiclePropertyStore::readValuesForProperty(
         int32_t propId) const {
-    std::scoped_lock<std::mutex> g(mLock);
+    const Shard& shard = getShard(propId);
+    SharedLockGuard g(shard.lock);
 
     std::vector<VehiclePropValuePool::RecyclableType> values;
 
-    const VehiclePropertyStore::Record* record = getRecordLocked(propId);
+    const VehiclePropertyStore::Record* record = getRecordLocked(shard, propId);
     if (record == nullptr) {
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
     }
@@ -215,10 +249,11 @@ VehiclePropertyStore::ValuesResultType VehiclePropertyStore::readValuesForProper
 
 VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(
         const VehiclePropValue& propValue) const {
-    std::scoped_lock<std::mutex> g(mLock);
-
     int32_t propId = propValue.prop;
-    const VehiclePropertyStore::Record* record = getRecordLocked(propId);
+    const Shard& shard = getShard(propId);
+    SharedLockGuard g(shard.lock);
+
+    const VehiclePropertyStore::Record* record = getRecordLocked(shard, propId);
     if (record == nullptr) {
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
     }
@@ -230,9 +265,10 @@ VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(
 VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(int32_t propId,
                                                                       int32_t areaId,
                                                                       int64_t token) const {
-    std::scoped_lock<std::mutex> g(mLock);
+    const Shard& shard = getShard(propId);
+    SharedLockGuard g(shard.lock);
 
-    const VehiclePropertyStore::Record* record = getRecordLocked(propId);
+    const VehiclePropertyStore::Record* record = getRecordLocked(shard, propId);
     if (record == nullptr) {
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
     }
@@ -242,20 +278,21 @@ VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(int32_t pr
 }
 
 std::vector<VehiclePropConfig> VehiclePropertyStore::getAllConfigs() const {
-    std::scoped_lock<std::mutex> g(mLock);
-
     std::vector<VehiclePropConfig> configs;
-    configs.reserve(mRecordsByPropId.size());
-    for (auto& [_, config] : mRecordsByPropId) {
-        configs.push_back(config.propConfig);
+    for (const Shard& shard : mShards) {
+        SharedLockGuard g(shard.lock);
+        for (auto& [_, config] : shard.recordsByPropId) {
+            configs.push_back(config.propConfig);
+        }
     }
     return configs;
 }
 
 VhalResult<const VehiclePropConfig*> VehiclePropertyStore::getConfig(int32_t propId) const {
-    std::scoped_lock<std::mutex> g(mLock);
+    const Shard& shard = getShard(propId);
+    SharedLockGuard g(shard.lock);
 
-    const VehiclePropertyStore::Record* record = getRecordLocked(propId);
+    const VehiclePropertyStore::Record* record = getRecordLocked(shard, propId);
     if (record == nullptr) {
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
     }
@@ -265,7 +302,7 @@ VhalResult<const VehiclePropConfig*> VehiclePropertyStore::getConfig(int32_t pro
 
 void VehiclePropertyStore::setOnValueChangeCallback(
         const VehiclePropertyStore::OnValueChangeCallback& callback) {
-    std::scoped_lock<std::mutex> g(mLock);
+    std::scoped_lock<std::shared_mutex> g(mCallbackLock);
 
     mOnValueChangeCallback = callback;
 }
@@ -16,6 +16,8 @@
 
 #include "VehicleUtils.h"
 
+#include <algorithm>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -205,6 +207,141 @@ Result<void> checkValueRange(const VehiclePropValue& value, const VehicleAreaCon
     return {};
 }
 
+namespace {
+
+// Whether any of the values is outside of [min, max], if a range is set.
+template <class T>
+bool isOutOfRange(const std::vector<T>& values, T min, T max) {
+    if (min == 0 && max == 0) {
+        return false;
+    }
+    return std::any_of(values.begin(), values.end(),
+                       [min, max](T value) { return value < min || value > max; });
+}
+
+}  // namespace
+
+PropValueValidator::PropValueValidator(const VehiclePropConfig& config)
+    : mConfig(config), mIsGlobal(isGlobalProp(config.prop)) {
+    switch (getPropType(config.prop)) {
+        case VehiclePropertyType::BOOLEAN:
+            mInt32Sizes = {.min = 1, .max = 1};
+            break;
+        case VehiclePropertyType::INT32:
+            mInt32Sizes = {.min = 1, .max = 1};
+            mRangedValues = RangedValues::INT32;
+            break;
+        case VehiclePropertyType::INT32_VEC:
+            mInt32Sizes.min = 1;
+            mRangedValues = RangedValues::INT32;
+            break;
+        case VehiclePropertyType::INT64:
+            mInt64Sizes = {.min = 1, .max = 1};
+            mRangedValues = RangedValues::INT64;
+            break;
+        case VehiclePropertyType::INT64_VEC:
+            mInt64Sizes.min = 1;
+            mRangedValues = RangedValues::INT64;
+            break;
+        case VehiclePropertyType::FLOAT:
+            mFloatSizes = {.min = 1, .max = 1};
+            mRangedValues = RangedValues::FLOAT;
+            break;
+        case VehiclePropertyType::FLOAT_VEC:
+            mFloatSizes.min = 1;
+            mRangedValues = RangedValues::FLOAT;
+            break;
+        case VehiclePropertyType::BYTES:
+            [[fallthrough]];
+        case VehiclePropertyType::STRING:
+            break;
+        case VehiclePropertyType::MIXED: {
+            if (getPropGroup(config.prop) != VehiclePropertyGroup::VENDOR) {
+                break;
+            }
+            // See checkVendorMixedPropValue for the meaning of each element.
+            const auto& configArray = config.configArray;
+            if (configArray.size() < 9) {
+                mInvalidMixedConfig = true;
+                break;
+            }
+            auto exactly = [](size_t count) { return SizeRange{.min = count, .max = count}; };
+            mInt32Sizes = exactly((configArray[1] == 1) + (configArray[2] == 1) +
+                                  static_cast<size_t>(configArray[3]));
+            mInt64Sizes = exactly((configArray[4] == 1) + static_cast<size_t>(configArray[5]));
+            mFloatSizes = exactly((configArray[6] == 1) + static_cast<size_t>(configArray[7]));
+            if (configArray[8] != 0) {
+                mByteSizes = exactly(static_cast<size_t>(configArray[8]));
+            }
+            break;
+        }
+        default:
+            mUnknownType = true;
+    }
+
+    if (!mIsGlobal) {
+        for (const auto& areaConfig : config.areaConfigs) {
+            // Like getAreaConfig, the first config of an area wins.
+            mAreaConfigsById.emplace(areaConfig.areaId, &areaConfig);
+        }
+    }
+}
+
+const VehicleAreaConfig* PropValueValidator::getAreaConfig(int32_t areaId) const {
+    if (mConfig.areaConfigs.empty()) {
+        return nullptr;
+    }
+    if (mIsGlobal) {
+        return &mConfig.areaConfigs[0];
+    }
+    auto it = mAreaConfigsById.find(areaId);
+    return it == mAreaConfigsById.end() ? nullptr : it->second;
+}
+
+Result<void> PropValueValidator::checkPropValue(const VehiclePropValue& value) const {
+    if (mInvalidMixedConfig) {
+        return Error() << "invalid mixed property config, expect 9 configArray elements, got "
+                       << mConfig.configArray.size();
+    }
+    if (!mUnknownType && mInt32Sizes.contains(value.value.int32Values.size()) &&
+        mInt64Sizes.contains(value.value.int64Values.size()) &&
+        mFloatSizes.contains(value.value.floatValues.size()) &&
+        mByteSizes.contains(value.value.byteValues.size())) {
+        return {};
+    }
+    // Only invalid values get here, let the reference check describe what is wrong.
+    return vehicle::checkPropValue(value, &mConfig);
+}
+
+Result<void> PropValueValidator::checkValueRange(const VehiclePropValue& value,
+                                                 const VehicleAreaConfig* areaConfig) const {
+    if (areaConfig == nullptr) {
+        return {};
+    }
+    bool outOfRange = false;
+    switch (mRangedValues) {
+        case RangedValues::INT32:
+            outOfRange = isOutOfRange(value.value.int32Values, areaConfig->minInt32Value,
+                                      areaConfig->maxInt32Value);
+            break;
+        case RangedValues::INT64:
+            outOfRange = isOutOfRange(value.value.int64Values, areaConfig->minInt64Value,
+                                      areaConfig->maxInt64Value);
+            break;
+        case RangedValues::FLOAT:
+            outOfRange = isOutOfRange(value.value.floatValues, areaConfig->minFloatValue,
+                                      areaConfig->maxFloatValue);
+            break;
+        case RangedValues::NONE:
+            break;
+    }
+    if (!outOfRange) {
+        return {};
+    }
+    // Only invalid values get here, let the reference check describe what is wrong.
+    return vehicle::checkValueRange(value, areaConfig);
+}
+
 StatusCode VhalError::value() const {
     return mCode;
 }
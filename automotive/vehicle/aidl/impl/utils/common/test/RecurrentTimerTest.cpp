@@ -19,6 +19,7 @@
 #include <android-base/thread_annotations.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <mutex>
@@ -50,7 +51,18 @@ class RecurrentTimerTest : public testing::Test {
 
     size_t countTimerCallbackQueue(RecurrentTimer* timer) {
         std::scoped_lock<std::mutex> lockGuard(timer->mLock);
-        return timer->mCallbackQueue.size();
+        size_t count = 0;
+        for (const auto& level : timer->mWheel) {
+            for (const auto& slot : level) {
+                count += slot.size();
+            }
+        }
+        return count;
+    }
+
+    size_t countCalledCallbacks(size_t token) {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        return std::count(mCallbacks.begin(), mCallbacks.end(), token);
     }
 
   private:
@@ -213,6 +225,68 @@ TEST_F(RecurrentTimerTest, testRegisterCallbackMultipleTimesNoDeadLock) {
     timer.reset();
 }
 
+TEST_F(RecurrentTimerTest, testRegisterManyCallbacks) {
+    RecurrentTimer timer;
+    // 0.01s
+    int64_t interval = 10000000;
+
+    std::vector<std::shared_ptr<RecurrentTimer::Callback>> actions;
+    for (size_t i = 0; i < 1000; i++) {
+        actions.push_back(getCallback(i));
+        timer.registerTimerCallback(interval, actions.back());
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    for (const auto& action : actions) {
+        timer.unregisterTimerCallback(action);
+    }
+
+    ASSERT_EQ(countTimerCallbackQueue(&timer), static_cast<size_t>(0));
+    for (size_t i = 0; i < 1000; i++) {
+        // Theoretically trigger 10 times, but check for at least 8 times to be stable.
+        ASSERT_GE(countCalledCallbacks(i), static_cast<size_t>(8)) << "callback " << i;
+    }
+}
+
+TEST_F(RecurrentTimerTest, testRegisterCallbackLongInterval) {
+    RecurrentTimer timer;
+    // 0.3s, longer than the first level of the timing wheel.
+    int64_t interval = 300000000;
+
+    auto action = getCallback(0);
+    timer.registerTimerCallback(interval, action);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    timer.unregisterTimerCallback(action);
+
+    // Theoretically trigger 4 times including the first one, but check for at least 3 times to
+    // be stable.
+    ASSERT_GE(getCalledCallbacks().size(), static_cast<size_t>(3));
+    ASSERT_LE(getCalledCallbacks().size(), static_cast<size_t>(5));
+}
+
+TEST_F(RecurrentTimerTest, testSlowCallbackNotDelayOthersWithWorkerThreads) {
+    RecurrentTimer timer(/*workerThreadCount=*/2);
+    // 0.01s
+    int64_t interval = 10000000;
+
+    auto slowAction = std::make_shared<RecurrentTimer::Callback>(
+            [] { std::this_thread::sleep_for(std::chrono::milliseconds(200)); });
+    timer.registerTimerCallback(interval, slowAction);
+    auto action = getCallback(0);
+    timer.registerTimerCallback(interval, action);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    timer.unregisterTimerCallback(action);
+    timer.unregisterTimerCallback(slowAction);
+
+    // Theoretically trigger 20 times, but check for at least 15 times to be stable.
+    ASSERT_GE(getCalledCallbacks().size(), static_cast<size_t>(15));
+}
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
@@ -137,6 +137,9 @@ class VehicleObjectPoolTest : public ::testing::Test {
         mStats->Created = 0;
         mStats->Recycled = 0;
         mStats->Deleted = 0;
+        mStats->CacheObtained = 0;
+        mStats->CacheRecycled = 0;
+        mStats->Disposable = 0;
     }
 };
 
@@ -187,6 +190,49 @@ TEST_F(VehicleObjectPoolTest, testObtainNewObject) {
     ASSERT_EQ(mStats->Created, 2u);
 }
 
+TEST_F(VehicleObjectPoolTest, testRecycleSameSizeClass) {
+    auto value = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 3);
+    void* raw = value.get();
+    const int32_t* data = value->value.int32Values.data();
+    value.reset();
+
+    // 3 and 4 are in the same size class, the value and its vector storage should be reused.
+    auto newValue = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 4);
+
+    ASSERT_EQ(newValue.get(), raw);
+    ASSERT_EQ(newValue->value.int32Values.size(), 4u);
+    ASSERT_EQ(newValue->value.int32Values.data(), data);
+    ASSERT_EQ(mStats->Created, 1u);
+}
+
+TEST_F(VehicleObjectPoolTest, testRecycleDifferentSizeClass) {
+    auto value = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 1);
+    void* raw = value.get();
+    value.reset();
+
+    ASSERT_NE(mValuePool->obtain(VehiclePropertyType::INT32_VEC, 4).get(), raw);
+    ASSERT_EQ(mStats->Created, 2u);
+}
+
+TEST_F(VehicleObjectPoolTest, testObtainFromThreadCache) {
+    mValuePool->obtain(VehiclePropertyType::INT32).reset();
+    mValuePool->obtain(VehiclePropertyType::INT32).reset();
+
+    ASSERT_EQ(mStats->Obtained, 2u);
+    ASSERT_EQ(mStats->CacheObtained, 1u);
+    ASSERT_EQ(mStats->CacheRecycled, 2u);
+}
+
+TEST_F(VehicleObjectPoolTest, testRecycleVectorResizedTooLarge) {
+    auto value = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 2);
+    void* raw = value.get();
+    // Not consistent with the size class any more, must not be recycled.
+    value->value.int32Values.resize(100);
+    value.reset();
+
+    ASSERT_NE(mValuePool->obtain(VehiclePropertyType::INT32_VEC, 2).get(), raw);
+}
+
 TEST_F(VehicleObjectPoolTest, testObtainStrings) {
     mValuePool->obtain(VehiclePropertyType::STRING);
     auto stringProp = mValuePool->obtain(VehiclePropertyType::STRING);
@@ -21,6 +21,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -509,6 +511,40 @@ TEST_F(VehiclePropertyStoreTest, testPropertyChangeCallbackForceNoUpdate) {
     ASSERT_EQ(updatedValue.prop, INVALID_PROP_ID);
 }
 
+TEST_F(VehiclePropertyStoreTest, testConcurrentReadWrite) {
+    auto values = getTestPropValues();
+    for (const auto& value : values) {
+        ASSERT_RESULT_OK(mStore->writeValue(mValuePool->obtain(value)));
+    }
+
+    std::vector<std::thread> threads;
+    // One writer keeps refreshing the tire pressure while other threads read all the properties.
+    threads.emplace_back([this, value = values[1]]() mutable {
+        for (int64_t i = 1; i <= 1000; i++) {
+            value.timestamp = i;
+            value.value.floatValues[0] = static_cast<float>(i);
+            mStore->writeValue(mValuePool->obtain(value));
+        }
+    });
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([this]() {
+            for (int j = 0; j < 1000; j++) {
+                ASSERT_RESULT_OK(mStore->readValue(toInt(VehicleProperty::INFO_FUEL_CAPACITY)));
+                ASSERT_RESULT_OK(
+                        mStore->readValue(toInt(VehicleProperty::TIRE_PRESSURE), WHEEL_FRONT_LEFT));
+                ASSERT_EQ(mStore->readAllValues().size(), 3u);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto result = mStore->readValue(toInt(VehicleProperty::TIRE_PRESSURE), WHEEL_FRONT_LEFT);
+    ASSERT_RESULT_OK(result);
+    ASSERT_EQ(result.value()->value.floatValues[0], 1000.0f);
+}
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
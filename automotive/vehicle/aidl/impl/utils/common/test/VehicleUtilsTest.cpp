@@ -802,6 +802,71 @@ TEST_P(InvalidValueRangeTest, testCheckValueRange) {
     ASSERT_EQ(tc.valid, result.ok());
 }
 
+TEST_P(InvalidPropValueTest, testPropValueValidatorCheckPropValue) {
+    InvalidPropValueTestCase tc = GetParam();
+    tc.config.prop = tc.value.prop;
+    PropValueValidator validator(tc.config);
+
+    auto result = validator.checkPropValue(tc.value);
+
+    ASSERT_EQ(tc.valid, result.ok());
+    if (!result.ok()) {
+        ASSERT_EQ(result.error().message(),
+                  checkPropValue(tc.value, &tc.config).error().message());
+    }
+}
+
+TEST_P(InvalidValueRangeTest, testPropValueValidatorCheckValueRange) {
+    InvalidValueRangeTestCase tc = GetParam();
+    VehiclePropConfig config = {
+            .prop = tc.value.prop,
+            .areaConfigs = {tc.config},
+    };
+    PropValueValidator validator(config);
+
+    auto result = validator.checkValueRange(tc.value, &tc.config);
+
+    ASSERT_EQ(tc.valid, result.ok());
+    if (!result.ok()) {
+        ASSERT_EQ(result.error().message(),
+                  checkValueRange(tc.value, &tc.config).error().message());
+    }
+}
+
+TEST(VehicleUtilsTest, testPropValueValidatorGetAreaConfig) {
+    int32_t areaProp = toInt(VehicleProperty::HVAC_TEMPERATURE_SET);
+    VehiclePropConfig config = {
+            .prop = areaProp,
+            .areaConfigs = {{.areaId = 1, .minFloatValue = 1.f},
+                            {.areaId = 2, .minFloatValue = 2.f},
+                            {.areaId = 1, .minFloatValue = 3.f}},
+    };
+    PropValueValidator validator(config);
+
+    for (int32_t areaId : {0, 1, 2, 3}) {
+        ASSERT_EQ(validator.getAreaConfig(areaId), getAreaConfig(areaProp, areaId, config))
+                << "area ID: " << areaId;
+    }
+
+    VehiclePropConfig globalConfig = {
+            .prop = int32Prop,
+            .areaConfigs = {{.areaId = 0}},
+    };
+    PropValueValidator globalValidator(globalConfig);
+
+    ASSERT_EQ(globalValidator.getAreaConfig(1), &globalConfig.areaConfigs[0]);
+}
+
+TEST(VehicleUtilsTest, testPropValueValidatorShortMixedConfig) {
+    VehiclePropConfig config = {
+            .prop = kMixedTypePropertyForTest,
+            .configArray = {0, 1},
+    };
+    PropValueValidator validator(config);
+
+    ASSERT_FALSE(validator.checkPropValue({.prop = config.prop}).ok());
+}
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
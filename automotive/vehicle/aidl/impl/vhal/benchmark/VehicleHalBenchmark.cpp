@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <LargeParcelableBase.h>
+#include <VehicleHalTypes.h>
+#include <VehicleUtils.h>
+#include <aidl/android/hardware/automotive/vehicle/BnVehicleCallback.h>
+#include <aidl/android/hardware/automotive/vehicle/IVehicle.h>
+#include <benchmark/benchmark.h>
+#include <hal-benchmark/AidlHalBenchmark.h>
+
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::BnVehicleCallback;
+using ::aidl::android::hardware::automotive::vehicle::GetValueRequest;
+using ::aidl::android::hardware::automotive::vehicle::GetValueRequests;
+using ::aidl::android::hardware::automotive::vehicle::GetValueResults;
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
+using ::aidl::android::hardware::automotive::vehicle::SetValueRequest;
+using ::aidl::android::hardware::automotive::vehicle::SetValueRequests;
+using ::aidl::android::hardware::automotive::vehicle::SetValueResults;
+using ::aidl::android::hardware::automotive::vehicle::SubscribeOptions;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropErrors;
+using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValues;
+using ::android::automotive::car_binder_lib::LargeParcelableBase;
+using ::android::hardware::hal_benchmark::AidlHalBenchmark;
+using ::android::hardware::hal_benchmark::CompletionCounter;
+using ::android::hardware::hal_benchmark::ScopedLatency;
+
+// A continuous property that every reference configuration can read.
+const int32_t kReadProp = toInt(VehicleProperty::PERF_VEHICLE_SPEED);
+// A global on-change property that every reference configuration can write.
+const int32_t kWriteProp = toInt(VehicleProperty::DISPLAY_BRIGHTNESS);
+constexpr std::chrono::seconds kTimeout{1};
+
+// Returns the number of results in a batch, which large batches carry in shared memory.
+template <class T>
+uint32_t countPayloads(const T& parcelable) {
+    if (!parcelable.payloads.empty()) {
+        return parcelable.payloads.size();
+    }
+    auto result = LargeParcelableBase::stableLargeParcelableToParcelable(parcelable);
+    if (!result.ok() || result.value().getObject() == nullptr) {
+        return 0;
+    }
+    return result.value().getObject()->payloads.size();
+}
+
+class BenchmarkCallback final : public BnVehicleCallback {
+  public:
+    ndk::ScopedAStatus onGetValues(const GetValueResults& results) override {
+        getValueResults.notify(countPayloads(results));
+        return ndk::ScopedAStatus::ok();
+    }
+
+    ndk::ScopedAStatus onSetValues(const SetValueResults& results) override {
+        setValueResults.notify(countPayloads(results));
+        return ndk::ScopedAStatus::ok();
+    }
+
+    ndk::ScopedAStatus onPropertyEvent(const VehiclePropValues& values,
+                                       int32_t /*sharedMemoryFileCount*/) override {
+        propertyEvents.notify(countPayloads(values));
+        return ndk::ScopedAStatus::ok();
+    }
+
+    ndk::ScopedAStatus onPropertySetError(const VehiclePropErrors& /*errors*/) override {
+        return ndk::ScopedAStatus::ok();
+    }
+
+    CompletionCounter getValueResults;
+    CompletionCounter setValueResults;
+    CompletionCounter propertyEvents;
+};
+
+// Talks to the IVehicle service of the device, so the numbers include binder, the VHAL and its
+// hardware. The argument of batched benchmarks is the number of requests per call.
+class VehicleHalBenchmark : public AidlHalBenchmark<IVehicle> {
+  public:
+    void SetUp(::benchmark::State& state) override {
+        AidlHalBenchmark<IVehicle>::SetUp(state);
+        mCallback = ndk::SharedRefBase::make<BenchmarkCallback>();
+    }
+
+    static void BatchArgs(::benchmark::internal::Benchmark* b) {
+        b->ArgName("Batch")->Arg(1)->Arg(8)->Arg(32);
+    }
+
+  protected:
+    // Returns the first of count request IDs that no pending request uses.
+    int64_t reserveRequestIds(size_t count) {
+        int64_t first = mRequestId;
+        mRequestId += count;
+        return first;
+    }
+
+    std::shared_ptr<BenchmarkCallback> mCallback;
+
+  private:
+    // Request IDs of a client start at 1.
+    int64_t mRequestId = 1;
+};
+
+SetValueRequests makeSetValueRequests(int64_t firstRequestId, size_t count, int32_t value) {
+    SetValueRequests requests;
+    for (size_t i = 0; i < count; i++) {
+        requests.payloads.push_back(SetValueRequest{
+                .requestId = firstRequestId + static_cast<int64_t>(i),
+                .value = {.prop = kWriteProp, .value.int32Values = {value}},
+        });
+    }
+    return requests;
+}
+
+}  // namespace
+
+// Time from getValues until the callback has received every result.
+BENCHMARK_DEFINE_F(VehicleHalBenchmark, getValues)(::benchmark::State& state) {
+    if (!checkHal(state)) {
+        return;
+    }
+    const size_t batch = state.range(0);
+    uint32_t expected = 0;
+    for (auto _ : state) {
+        ScopedLatency latency(&mLatency);
+        GetValueRequests requests;
+        const int64_t firstRequestId = reserveRequestIds(batch);
+        for (size_t i = 0; i < batch; i++) {
+            requests.payloads.push_back(GetValueRequest{
+                    .requestId = firstRequestId + static_cast<int64_t>(i),
+                    .prop = {.prop = kReadProp},
+            });
+        }
+        expected += batch;
+        if (!mHal->getValues(mCallback, requests).isOk() ||
+            !mCallback->getValueResults.waitFor(expected, kTimeout)) {
+            state.SkipWithError("getValues failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK_REGISTER_F(VehicleHalBenchmark, getValues)
+        ->Apply(VehicleHalBenchmark::DefaultConfig)
+        ->Apply(VehicleHalBenchmark::BatchArgs);
+
+// Time from setValues until the callback has received every result.
+BENCHMARK_DEFINE_F(VehicleHalBenchmark, setValues)(::benchmark::State& state) {
+    if (!checkHal(state)) {
+        return;
+    }
+    const size_t batch = state.range(0);
+    uint32_t expected = 0;
+    int32_t value = 0;
+    for (auto _ : state) {
+        ScopedLatency latency(&mLatency);
+        SetValueRequests requests = makeSetValueRequests(reserveRequestIds(batch), batch, value);
+        value = (value + 1) % 100;
+        expected += batch;
+        if (!mHal->setValues(mCallback, requests).isOk() ||
+            !mCallback->setValueResults.waitFor(expected, kTimeout)) {
+            state.SkipWithError("setValues failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK_REGISTER_F(VehicleHalBenchmark, setValues)
+        ->Apply(VehicleHalBenchmark::DefaultConfig)
+        ->Apply(VehicleHalBenchmark::BatchArgs);
+
+// Cost of setting up and tearing down a subscription to a continuous property.
+BENCHMARK_DEFINE_F(VehicleHalBenchmark, subscribe)(::benchmark::State& state) {
+    if (!checkHal(state)) {
+        return;
+    }
+    const std::vector<SubscribeOptions> options = {{.propId = kReadProp, .sampleRate = 10.0f}};
+    for (auto _ : state) {
+        ScopedLatency latency(&mLatency);
+        if (!mHal->subscribe(mCallback, options, /*maxSharedMemoryFileCount=*/0).isOk() ||
+            !mHal->unsubscribe(mCallback, {kReadProp}).isOk()) {
+            state.SkipWithError("subscribe failed");
+            break;
+        }
+    }
+}
+BENCHMARK_REGISTER_F(VehicleHalBenchmark, subscribe)->Apply(VehicleHalBenchmark::DefaultConfig);
+
+// Time from setting an on-change property until the subscriber receives the change event.
+BENCHMARK_DEFINE_F(VehicleHalBenchmark, propertyEvent)(::benchmark::State& state) {
+    if (!checkHal(state)) {
+        return;
+    }
+    if (!mHal->subscribe(mCallback, {{.propId = kWriteProp}}, /*maxSharedMemoryFileCount=*/0)
+                 .isOk()) {
+        state.SkipWithError("subscribe failed");
+        return;
+    }
+    uint32_t expected = mCallback->propertyEvents.get();
+    int32_t value = 0;
+    for (auto _ : state) {
+        ScopedLatency latency(&mLatency);
+        // Alternate the value, an unchanged value does not generate an event.
+        value = (value + 1) % 2;
+        ++expected;
+        SetValueRequests requests = makeSetValueRequests(reserveRequestIds(1), 1, value);
+        if (!mHal->setValues(mCallback, requests).isOk() ||
+            !mCallback->propertyEvents.waitFor(expected, kTimeout)) {
+            state.SkipWithError("no property event");
+            break;
+        }
+    }
+    mHal->unsubscribe(mCallback, {kWriteProp});
+}
+BENCHMARK_REGISTER_F(VehicleHalBenchmark, propertyEvent)
+        ->Apply(VehicleHalBenchmark::DefaultConfig);
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+HAL_BENCHMARK_MAIN();
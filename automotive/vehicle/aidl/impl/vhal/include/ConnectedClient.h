@@ -18,6 +18,7 @@
 #define android_hardware_automotive_vehicle_aidl_impl_vhal_include_ConnectedClient_H_
 
 #include "PendingRequestPool.h"
+#include "SharedMemoryPool.h"
 
 #include <IVehicleHardware.h>
 #include <VehicleHalTypes.h>
@@ -25,8 +26,13 @@
 
 #include <aidl/android/hardware/automotive/vehicle/IVehicleCallback.h>
 #include <android-base/result.h>
+#include <android-base/thread_annotations.h>
 
+#include <array>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
@@ -87,16 +93,48 @@ class GetSetValuesClient final : public ConnectedClient {
     void sendResultsSeparately(const std::vector<ResultType>& results);
 
     // Gets the callback to be called when the request for this client has finished.
+    //
+    // If coalescing is enabled, the finished results are queued instead and are sent together
+    // with other queued results at the next {@code flushCoalescedResults} or once
+    // {@code maxResults} results are queued.
     std::shared_ptr<const std::function<void(std::vector<ResultType>)>> getResultCallback();
 
+    // Enables coalescing for the results from hardware if {@code windowInNano} is positive,
+    // disables it otherwise. Timeout results and the results sent through {@code sendResults} are
+    // never queued. Caller must call {@code flushCoalescedResults} every {@code windowInNano}.
+    void setCoalescingConfig(int64_t windowInNano, size_t maxResults);
+
+    // Sends all the queued results in one callback.
+    void flushCoalescedResults();
+
   protected:
     // Gets the callback to be called when the request for this client has timeout.
     std::shared_ptr<const PendingRequestPool::TimeoutCallbackFunc> getTimeoutCallback() override;
 
   private:
+    // The results queued for coalescing. This is shared with the result callback, which the
+    // hardware may still call after this client is removed.
+    struct CoalescedResults {
+        // lock is also held while sending the queued results, so that they are delivered in
+        // order.
+        std::mutex lock;
+        int64_t windowInNano GUARDED_BY(lock) = 0;
+        size_t maxResults GUARDED_BY(lock) = 0;
+        std::vector<ResultType> results GUARDED_BY(lock);
+
+        // Sends all the queued results in one callback.
+        void flushLocked(const CallbackType& callback) REQUIRES(lock);
+    };
+
     // The following members are only initialized during construction.
     std::shared_ptr<const PendingRequestPool::TimeoutCallbackFunc> mTimeoutCallback;
     std::shared_ptr<const std::function<void(std::vector<ResultType>)>> mResultCallback;
+    std::shared_ptr<CoalescedResults> mCoalescedResults;
+
+    static void onResults(const void* clientId, CallbackType callback,
+                          std::shared_ptr<PendingRequestPool> requestPool,
+                          std::shared_ptr<CoalescedResults> coalescedResults,
+                          std::vector<ResultType>&& results);
 };
 
 // A class to represent a client that calls {@code IVehicle.subscribe}.
@@ -108,9 +146,40 @@ class SubscriptionClient final : public ConnectedClient {
     std::shared_ptr<const IVehicleHardware::GetValuesCallback> getResultCallback();
 
     // Marshals the updated values into largeParcelable and sents it through {@code onPropertyEvent}
-    // callback.
+    // callback. If a shared memory file is required, it is taken from this client's shared memory
+    // pool.
+    //
+    // If batching is enabled, the values are queued instead and are sent together with other
+    // queued values at the next {@code flushBatchedValues} or once the queued values exceed the
+    // byte budget.
+    void sendUpdatedValues(
+            std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&&
+                    updatedValues);
+
+    // Enables batching for property events if {@code windowInNano} is positive, disables it
+    // otherwise. {@code byteBudget} is the approximate payload size that triggers an immediate
+    // flush. Caller must call {@code flushBatchedValues} every {@code windowInNano}.
+    void setBatchingConfig(int64_t windowInNano, size_t byteBudget);
+
+    // Sends all the queued values in one {@code onPropertyEvent} callback.
+    void flushBatchedValues();
+
+    // Returns a shared memory file previously sent through {@code onPropertyEvent} back to this
+    // client's shared memory pool.
+    VhalResult<void> returnSharedMemory(int64_t sharedMemoryId);
+
+    // Sets the maximum number of shared memory files that could be in use by this client, at most
+    // {@code SharedMemoryPool::MAX_IN_USE_COUNT_LIMIT}.
+    void setMaxSharedMemoryFileCount(int32_t maxSharedMemoryFileCount);
+
+    // Dumps the statistics for shared memory pool and batching.
+    std::string dump();
+
+    // Marshals the updated values into largeParcelable and sents it through {@code onPropertyEvent}
+    // callback. {@code sharedMemoryPool} could be {@code nullptr}, in which case an unpooled shared
+    // memory file would be used if required.
     static void sendUpdatedValues(
-            CallbackType callback,
+            CallbackType callback, std::shared_ptr<SharedMemoryPool> sharedMemoryPool,
             std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&&
                     updatedValues);
 
@@ -123,10 +192,46 @@ class SubscriptionClient final : public ConnectedClient {
     std::shared_ptr<const PendingRequestPool::TimeoutCallbackFunc> mTimeoutCallback;
     std::shared_ptr<const IVehicleHardware::GetValuesCallback> mResultCallback;
     std::shared_ptr<const IVehicleHardware::PropertyChangeCallback> mPropertyChangeCallback;
+    // SharedMemoryPool is thread-safe.
+    std::shared_ptr<SharedMemoryPool> mSharedMemoryPool;
+
+    // Histogram upper bounds (inclusive) for the number of values in one batch, the last bucket
+    // holds the rest.
+    static constexpr std::array<size_t, 5> BATCH_SIZE_BUCKETS = {1, 4, 16, 64, 256};
+    // Histogram upper bounds (inclusive) for the time between the first value is queued and the
+    // batch is sent, the last bucket holds the rest.
+    static constexpr std::array<int64_t, 5> BATCH_LATENCY_BUCKETS_IN_NANO = {
+            1'000'000, 5'000'000, 10'000'000, 50'000'000, 100'000'000};
+
+    // mBatchLock is never held while calling {@code onPropertyEvent}. The batches to send are
+    // queued in mPendingBatches and sent by a single thread at a time, so that they are delivered
+    // in order.
+    std::mutex mBatchLock;
+    int64_t mBatchingWindowInNano GUARDED_BY(mBatchLock) = 0;
+    size_t mBatchingByteBudget GUARDED_BY(mBatchLock) = 0;
+    std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue> mBatchedValues
+            GUARDED_BY(mBatchLock);
+    size_t mBatchedBytes GUARDED_BY(mBatchLock) = 0;
+    int64_t mBatchStartTimeInNano GUARDED_BY(mBatchLock) = 0;
+    std::array<uint64_t, BATCH_SIZE_BUCKETS.size() + 1> mBatchSizeHistogram GUARDED_BY(mBatchLock) =
+            {};
+    std::array<uint64_t, BATCH_LATENCY_BUCKETS_IN_NANO.size() + 1> mBatchLatencyHistogram
+            GUARDED_BY(mBatchLock) = {};
+    std::deque<std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>>
+            mPendingBatches GUARDED_BY(mBatchLock);
+    bool mSendingBatches GUARDED_BY(mBatchLock) = false;
+
+    // Moves the queued values to mPendingBatches, the caller must call {@code sendPendingBatches}
+    // after releasing mBatchLock.
+    void flushBatchedValuesLocked() REQUIRES(mBatchLock);
+
+    // Sends the batches in mPendingBatches, unless another thread is already sending them.
+    void sendPendingBatches() EXCLUDES(mBatchLock);
 
     static void onGetValueResults(
             const void* clientId, CallbackType callback,
             std::shared_ptr<PendingRequestPool> requestPool,
+            std::shared_ptr<SharedMemoryPool> sharedMemoryPool,
             std::vector<aidl::android::hardware::automotive::vehicle::GetValueResult> results);
 };
 
@@ -47,7 +47,26 @@ class DefaultVehicleHal final : public aidl::android::hardware::automotive::vehi
     using CallbackType =
             std::shared_ptr<aidl::android::hardware::automotive::vehicle::IVehicleCallback>;
 
-    explicit DefaultVehicleHal(std::unique_ptr<IVehicleHardware> hardware);
+    // The default approximate payload size for a batch of property events that triggers an
+    // immediate flush. This keeps a batch small enough to not require a shared memory file.
+    static constexpr size_t DEFAULT_EVENT_BATCHING_BYTE_BUDGET = 4096;
+    // The default number of coalesced getValues or setValues results that triggers an immediate
+    // flush.
+    static constexpr size_t DEFAULT_RESULT_COALESCING_MAX_RESULTS = 32;
+
+    // If {@code eventBatchingWindowInNano} is positive, property events for each subscription
+    // client are batched and sent together every {@code eventBatchingWindowInNano}, or once the
+    // batch exceeds {@code eventBatchingByteBudget}.
+    //
+    // If {@code resultCoalescingWindowInNano} is positive, the getValues and setValues results
+    // from hardware for each client are coalesced and sent together every
+    // {@code resultCoalescingWindowInNano}, or once {@code resultCoalescingMaxResults} results are
+    // queued.
+    explicit DefaultVehicleHal(
+            std::unique_ptr<IVehicleHardware> hardware, int64_t eventBatchingWindowInNano = 0,
+            size_t eventBatchingByteBudget = DEFAULT_EVENT_BATCHING_BYTE_BUDGET,
+            int64_t resultCoalescingWindowInNano = 0,
+            size_t resultCoalescingMaxResults = DEFAULT_RESULT_COALESCING_MAX_RESULTS);
 
     ~DefaultVehicleHal();
 
@@ -105,7 +124,11 @@ class DefaultVehicleHal final : public aidl::android::hardware::automotive::vehi
     // callbacks.
     class SubscriptionClients {
       public:
-        SubscriptionClients(std::shared_ptr<PendingRequestPool> pool) : mPendingRequestPool(pool) {}
+        SubscriptionClients(std::shared_ptr<PendingRequestPool> pool,
+                            int64_t eventBatchingWindowInNano, size_t eventBatchingByteBudget)
+            : mPendingRequestPool(pool),
+              mEventBatchingWindowInNano(eventBatchingWindowInNano),
+              mEventBatchingByteBudget(eventBatchingByteBudget) {}
 
         std::shared_ptr<SubscriptionClient> maybeAddClient(const CallbackType& callback);
 
@@ -115,12 +138,17 @@ class DefaultVehicleHal final : public aidl::android::hardware::automotive::vehi
 
         size_t countClients();
 
+        std::unordered_map<const AIBinder*, std::shared_ptr<SubscriptionClient>> getAllClients();
+
       private:
         std::mutex mLock;
         std::unordered_map<const AIBinder*, std::shared_ptr<SubscriptionClient>> mClients
                 GUARDED_BY(mLock);
         // PendingRequestPool is thread-safe.
         std::shared_ptr<PendingRequestPool> mPendingRequestPool;
+        // Only initialized during construction.
+        const int64_t mEventBatchingWindowInNano;
+        const size_t mEventBatchingByteBudget;
     };
 
     // A wrapper for binder operations to enable stubbing for test.
@@ -170,8 +198,17 @@ class DefaultVehicleHal final : public aidl::android::hardware::automotive::vehi
     // lock guard them.
     std::unordered_map<int32_t, aidl::android::hardware::automotive::vehicle::VehiclePropConfig>
             mConfigsByPropId;
+    // The validators of the configs in mConfigsByPropId, used to check the values of setValues.
+    // Only modified in constructor, so thread-safe.
+    std::unordered_map<int32_t, PropValueValidator> mValidatorsByPropId;
     // Only modified in constructor, so thread-safe.
     std::unique_ptr<ndk::ScopedFileDescriptor> mConfigFile;
+    // The configs returned by getAllPropConfigs if they are small enough not to need mConfigFile,
+    // built once so a call only has to copy them. Only modified in constructor, so thread-safe.
+    std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropConfig> mConfigPayloads;
+    // Only initialized during construction.
+    const int64_t mResultCoalescingWindowInNano;
+    const size_t mResultCoalescingMaxResults;
     // PendingRequestPool is thread-safe.
     std::shared_ptr<PendingRequestPool> mPendingRequestPool;
     // SubscriptionManager is thread-safe.
@@ -191,6 +228,10 @@ class DefaultVehicleHal final : public aidl::android::hardware::automotive::vehi
 
     // Only initialized once.
     std::shared_ptr<std::function<void()>> mRecurrentAction;
+    // Only initialized once, nullptr if event batching is disabled.
+    std::shared_ptr<std::function<void()>> mFlushBatchedEventsAction;
+    // Only initialized once, nullptr if result coalescing is disabled.
+    std::shared_ptr<std::function<void()>> mFlushCoalescedResultsAction;
     // RecurrentTimer is thread-safe.
     RecurrentTimer mRecurrentTimer;
 
@@ -240,6 +281,9 @@ class DefaultVehicleHal final : public aidl::android::hardware::automotive::vehi
     // mBinderEvents.
     void onBinderDiedUnlinkedHandler();
 
+    // Sends the coalesced results of all getValues and setValues clients.
+    void flushCoalescedResults();
+
     // Gets or creates a {@code T} object for the client to or from {@code clients}.
     template <class T>
     static std::shared_ptr<T> getOrCreateClient(
@@ -248,11 +292,15 @@ class DefaultVehicleHal final : public aidl::android::hardware::automotive::vehi
 
     static void onPropertyChangeEvent(
             std::weak_ptr<SubscriptionManager> subscriptionManager,
+            std::weak_ptr<SubscriptionClients> subscriptionClients,
             const std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&
                     updatedValues);
 
+    static void flushBatchedEvents(std::weak_ptr<SubscriptionClients> subscriptionClients);
+
     static void checkHealth(IVehicleHardware* hardware,
-                            std::weak_ptr<SubscriptionManager> subscriptionManager);
+                            std::weak_ptr<SubscriptionManager> subscriptionManager,
+                            std::weak_ptr<SubscriptionClients> subscriptionClients);
 
     static void onBinderDied(void* cookie);
 
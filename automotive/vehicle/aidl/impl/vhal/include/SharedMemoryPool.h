@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
+#define android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
+
+#include <VehicleHalTypes.h>
+#include <VehicleUtils.h>
+
+#include <android-base/result.h>
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <android/binder_auto_utils.h>
+#include <android/binder_parcel.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A pool of shared memory files used to deliver large parcelables to one client.
+//
+// Every shared memory file is created once, mapped read-write for VHAL and then restricted to
+// read-only for any later mapping, so the client could only read it. The file is handed out with
+// a unique memory ID and is put back into the pool when the client calls
+// {@code returnSharedMemory} with that ID. Free files are grouped by size classes (power of two,
+// at least one page) so that a returned file could be reused for any payload of a similar size.
+//
+// This class is thread-safe.
+class SharedMemoryPool final {
+  public:
+    // A shared memory file handed out to the client.
+    struct Lease {
+        // The unique ID for the memory file, never INVALID_MEMORY_ID.
+        int64_t memoryId;
+        // A read-only dup of the memory file descriptor for the client.
+        ndk::ScopedFileDescriptor fd;
+        // The number of memory files that are currently handed out to the client, including this
+        // one.
+        int32_t inUseCount;
+    };
+
+    struct Stats {
+        uint64_t hitCount;
+        uint64_t missCount;
+        uint64_t fallbackCount;
+        size_t inUseCount;
+        size_t freeCount;
+        size_t freeBytes;
+    };
+
+    // The smallest size class, one page.
+    static constexpr size_t MIN_SIZE_CLASS = 4096;
+    // Payload larger than this would not be pooled.
+    static constexpr size_t MAX_SIZE_CLASS = 16 * 1024 * 1024;
+    // The maximum number of free memory files kept for each size class.
+    static constexpr size_t MAX_FREE_COUNT_PER_SIZE_CLASS = 4;
+    // The default maximum number of memory files that could be handed out at the same time.
+    static constexpr size_t DEFAULT_MAX_IN_USE_COUNT = 16;
+    // The largest maximum number of memory files a client could ask for. Each memory file could
+    // be up to MAX_SIZE_CLASS, so this bounds the shared memory one client could hold.
+    static constexpr size_t MAX_IN_USE_COUNT_LIMIT = 32;
+
+    explicit SharedMemoryPool(size_t maxInUseCount = DEFAULT_MAX_IN_USE_COUNT);
+
+    ~SharedMemoryPool();
+
+    // Marshals {@code parcel} into a memory file from the pool, creating one if no free file is
+    // available for the size class.
+    //
+    // Returns error if the payload is too large to be pooled, if there are already
+    // {@code maxInUseCount} files handed out, or if creating the shared memory file fails. Caller
+    // should fall back to an unpooled shared memory file in this case.
+    android::base::Result<Lease> write(const AParcel* parcel);
+
+    // Returns a memory file previously handed out by {@code write} back to the pool.
+    //
+    // Returns {@code INVALID_ARG} if the memory ID does not match any memory file in use.
+    VhalResult<void> returnMemory(int64_t memoryId);
+
+    // Records one large parcelable that had to use an unpooled shared memory file.
+    void recordFallback();
+
+    // Sets the maximum number of memory files that could be handed out at the same time.
+    void setMaxInUseCount(size_t maxInUseCount);
+
+    Stats getStats();
+
+    std::string dump();
+
+    // Gets the size class for the payload size. Visible for testing.
+    static size_t getSizeClass(size_t size);
+
+  private:
+    struct Memory {
+        android::base::unique_fd fd;
+        void* addr = nullptr;
+        size_t capacity = 0;
+        // The number of bytes written by the last user. Bytes after this are known to be zero.
+        size_t dirtySize = 0;
+
+        ~Memory();
+    };
+
+    std::mutex mLock;
+    size_t mMaxInUseCount GUARDED_BY(mLock);
+    int64_t mNextMemoryId GUARDED_BY(mLock) = 1;
+    std::unordered_map<size_t, std::vector<std::unique_ptr<Memory>>> mFreeMemoryBySizeClass
+            GUARDED_BY(mLock);
+    std::unordered_map<int64_t, std::unique_ptr<Memory>> mInUseMemoryById GUARDED_BY(mLock);
+    uint64_t mHitCount GUARDED_BY(mLock) = 0;
+    uint64_t mMissCount GUARDED_BY(mLock) = 0;
+    uint64_t mFallbackCount GUARDED_BY(mLock) = 0;
+
+    static android::base::Result<std::unique_ptr<Memory>> createMemory(size_t capacity);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
@@ -19,7 +19,11 @@
 
 #include <VehicleHalTypes.h>
 
+#include <aidl/android/hardware/automotive/vehicle/IVehicle.h>
+#include <android-base/stringprintf.h>
+#include <android/binder_parcel.h>
 #include <utils/Log.h>
+#include <utils/SystemClock.h>
 
 #include <inttypes.h>
 #include <unordered_set>
@@ -34,6 +38,7 @@ namespace {
 
 using ::aidl::android::hardware::automotive::vehicle::GetValueResult;
 using ::aidl::android::hardware::automotive::vehicle::GetValueResults;
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
 using ::aidl::android::hardware::automotive::vehicle::IVehicleCallback;
 using ::aidl::android::hardware::automotive::vehicle::SetValueResult;
 using ::aidl::android::hardware::automotive::vehicle::SetValueResults;
@@ -41,7 +46,14 @@ using ::aidl::android::hardware::automotive::vehicle::StatusCode;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropValues;
 using ::android::base::Result;
+using ::android::base::StringPrintf;
+using ::ndk::ScopedAParcel;
 using ::ndk::ScopedAStatus;
+using ::ndk::ScopedFileDescriptor;
+
+// Payload larger than this would be sent through shared memory file. This must be the same as the
+// threshold used by LargeParcelableBase.
+constexpr int32_t MAX_DIRECT_PAYLOAD_SIZE = 4096;
 
 // A function to call the specific callback based on results type.
 template <class T>
@@ -59,6 +71,54 @@ ScopedAStatus callCallback<SetValueResults>(std::shared_ptr<IVehicleCallback> ca
     return callback->onSetValues(results);
 }
 
+// Gets the approximate number of bytes the value takes in a parcel.
+size_t getApproximateSize(const VehiclePropValue& value) {
+    return sizeof(VehiclePropValue) + value.value.int32Values.size() * sizeof(int32_t) +
+           value.value.floatValues.size() * sizeof(float) +
+           value.value.int64Values.size() * sizeof(int64_t) + value.value.byteValues.size() +
+           value.value.stringValue.size() * sizeof(char16_t);
+}
+
+// Turns the values into a stable large parcelable, the same as {@code
+// vectorToStableLargeParcelable}, except that if a shared memory file is required, it is taken
+// from {@code sharedMemoryPool} and {@code output->sharedMemoryId} is filled in, so that the client
+// could return it through {@code returnSharedMemory}. If the pool is not available or full, an
+// unpooled shared memory file is used instead.
+ScopedAStatus vectorToPooledStableLargeParcelable(std::vector<VehiclePropValue>&& values,
+                                                  SharedMemoryPool* sharedMemoryPool,
+                                                  VehiclePropValues* output,
+                                                  int32_t* sharedMemoryFileCount) {
+    output->sharedMemoryId = IVehicle::INVALID_MEMORY_ID;
+    if (sharedMemoryPool == nullptr) {
+        return vectorToStableLargeParcelable(std::move(values), output);
+    }
+
+    output->payloads = std::move(values);
+    output->sharedMemoryFd = ScopedFileDescriptor();
+    ScopedAParcel parcel(AParcel_create());
+    if (binder_status_t status = output->writeToParcel(parcel.get()); status != STATUS_OK) {
+        return ScopedAStatus::fromServiceSpecificErrorWithMessage(
+                toInt(StatusCode::INTERNAL_ERROR), "failed to write values to parcel");
+    }
+    if (AParcel_getDataSize(parcel.get()) <= MAX_DIRECT_PAYLOAD_SIZE) {
+        // Do not modify payloads.
+        return ScopedAStatus::ok();
+    }
+
+    auto result = sharedMemoryPool->write(parcel.get());
+    if (!result.ok()) {
+        ALOGW("failed to use pooled shared memory, fall back to unpooled one, error: %s",
+              result.error().message().c_str());
+        sharedMemoryPool->recordFallback();
+        return vectorToStableLargeParcelable(std::move(output->payloads), output);
+    }
+    output->payloads.clear();
+    output->sharedMemoryId = result.value().memoryId;
+    output->sharedMemoryFd = std::move(result.value().fd);
+    *sharedMemoryFileCount = result.value().inUseCount;
+    return ScopedAStatus::ok();
+}
+
 // Send a single GetValue/SetValue result through the callback.
 template <class ResultType, class ResultsType>
 void sendGetOrSetValueResult(std::shared_ptr<IVehicleCallback> callback, const ResultType& result) {
@@ -123,35 +183,30 @@ void onTimeout(
     sendGetOrSetValueResults<ResultType, ResultsType>(callback, std::move(timeoutResults));
 }
 
-// The on-results callback for GetValues/SetValues.
-template <class ResultType, class ResultsType>
-void getOrSetValuesCallback(
-        const void* clientId,
-        std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicleCallback> callback,
-        std::vector<ResultType>&& results, std::shared_ptr<PendingRequestPool> requestPool) {
+// Removes the results that are no longer pending, e.g. because they have timed out, and marks
+// the rest as finished.
+template <class ResultType>
+void removeUnfinishedResults(const void* clientId, PendingRequestPool* requestPool,
+                             std::vector<ResultType>* results) {
     std::unordered_set<int64_t> requestIds;
-    for (const auto& result : results) {
+    for (const auto& result : *results) {
         requestIds.insert(result.requestId);
     }
 
     auto finishedRequests = requestPool->tryFinishRequests(clientId, requestIds);
 
-    auto it = results.begin();
-    while (it != results.end()) {
+    auto it = results->begin();
+    while (it != results->end()) {
         int64_t requestId = it->requestId;
         if (finishedRequests.find(requestId) == finishedRequests.end()) {
             ALOGD("no pending request for the result from hardware, "
                   "possibly already time-out, ID: %" PRId64,
                   requestId);
-            it = results.erase(it);
+            it = results->erase(it);
         } else {
             it++;
         }
     }
-
-    if (!results.empty()) {
-        sendGetOrSetValueResults<ResultType, ResultsType>(callback, std::move(results));
-    }
 }
 
 // Specify the functions for GetValues and SetValues types.
@@ -177,14 +232,12 @@ template void onTimeout<SetValueResult, SetValueResults>(
         std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicleCallback> callback,
         const std::unordered_set<int64_t>& timeoutIds);
 
-template void getOrSetValuesCallback<GetValueResult, GetValueResults>(
-        const void* clientId,
-        std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicleCallback> callback,
-        std::vector<GetValueResult>&& results, std::shared_ptr<PendingRequestPool> requestPool);
-template void getOrSetValuesCallback<SetValueResult, SetValueResults>(
-        const void* clientId,
-        std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicleCallback> callback,
-        std::vector<SetValueResult>&& results, std::shared_ptr<PendingRequestPool> requestPool);
+template void removeUnfinishedResults<GetValueResult>(const void* clientId,
+                                                      PendingRequestPool* requestPool,
+                                                      std::vector<GetValueResult>* results);
+template void removeUnfinishedResults<SetValueResult>(const void* clientId,
+                                                      PendingRequestPool* requestPool,
+                                                      std::vector<SetValueResult>* results);
 
 }  // namespace
 
@@ -214,14 +267,72 @@ GetSetValuesClient<ResultType, ResultsType>::GetSetValuesClient(
                 return onTimeout<ResultType, ResultsType>(callback, timeoutIds);
             });
     auto requestPoolCopy = mRequestPool;
+    mCoalescedResults = std::make_shared<CoalescedResults>();
+    auto coalescedResultsCopy = mCoalescedResults;
     const void* clientId = id();
     mResultCallback = std::make_shared<const std::function<void(std::vector<ResultType>)>>(
-            [clientId, callback, requestPoolCopy](std::vector<ResultType> results) {
-                return getOrSetValuesCallback<ResultType, ResultsType>(
-                        clientId, callback, std::move(results), requestPoolCopy);
+            [clientId, callback, requestPoolCopy,
+             coalescedResultsCopy](std::vector<ResultType> results) {
+                return onResults(clientId, callback, requestPoolCopy, coalescedResultsCopy,
+                                 std::move(results));
             });
 }
 
+template <class ResultType, class ResultsType>
+void GetSetValuesClient<ResultType, ResultsType>::onResults(
+        const void* clientId, CallbackType callback,
+        std::shared_ptr<PendingRequestPool> requestPool,
+        std::shared_ptr<CoalescedResults> coalescedResults, std::vector<ResultType>&& results) {
+    removeUnfinishedResults(clientId, requestPool.get(), &results);
+    if (results.empty()) {
+        return;
+    }
+
+    {
+        std::scoped_lock<std::mutex> lockGuard(coalescedResults->lock);
+        if (coalescedResults->windowInNano > 0) {
+            for (auto& result : results) {
+                coalescedResults->results.push_back(std::move(result));
+            }
+            if (coalescedResults->results.size() >= coalescedResults->maxResults) {
+                coalescedResults->flushLocked(callback);
+            }
+            return;
+        }
+    }
+    sendGetOrSetValueResults<ResultType, ResultsType>(callback, std::move(results));
+}
+
+template <class ResultType, class ResultsType>
+void GetSetValuesClient<ResultType, ResultsType>::setCoalescingConfig(int64_t windowInNano,
+                                                                      size_t maxResults) {
+    std::scoped_lock<std::mutex> lockGuard(mCoalescedResults->lock);
+    if (windowInNano <= 0) {
+        // Do not leave results behind once coalescing is disabled.
+        mCoalescedResults->flushLocked(mCallback);
+    }
+    mCoalescedResults->windowInNano = windowInNano;
+    mCoalescedResults->maxResults = maxResults;
+}
+
+template <class ResultType, class ResultsType>
+void GetSetValuesClient<ResultType, ResultsType>::flushCoalescedResults() {
+    std::scoped_lock<std::mutex> lockGuard(mCoalescedResults->lock);
+    mCoalescedResults->flushLocked(mCallback);
+}
+
+template <class ResultType, class ResultsType>
+void GetSetValuesClient<ResultType, ResultsType>::CoalescedResults::flushLocked(
+        const CallbackType& callback) {
+    if (results.empty()) {
+        return;
+    }
+
+    std::vector<ResultType> flushedResults = std::move(results);
+    results.clear();
+    sendGetOrSetValueResults<ResultType, ResultsType>(callback, std::move(flushedResults));
+}
+
 template <class ResultType, class ResultsType>
 std::shared_ptr<const std::function<void(std::vector<ResultType>)>>
 GetSetValuesClient<ResultType, ResultsType>::getResultCallback() {
@@ -250,7 +361,8 @@ template class GetSetValuesClient<SetValueResult, SetValueResults>;
 
 SubscriptionClient::SubscriptionClient(std::shared_ptr<PendingRequestPool> requestPool,
                                        std::shared_ptr<IVehicleCallback> callback)
-    : ConnectedClient(requestPool, callback) {
+    : ConnectedClient(requestPool, callback),
+      mSharedMemoryPool(std::make_shared<SharedMemoryPool>()) {
     mTimeoutCallback = std::make_shared<const PendingRequestPool::TimeoutCallbackFunc>(
             [](std::unordered_set<int64_t> timeoutIds) {
                 for (int64_t id : timeoutIds) {
@@ -261,10 +373,13 @@ SubscriptionClient::SubscriptionClient(std::shared_ptr<PendingRequestPool> reque
                 }
             });
     auto requestPoolCopy = mRequestPool;
+    auto sharedMemoryPoolCopy = mSharedMemoryPool;
     const void* clientId = reinterpret_cast<const void*>(this);
     mResultCallback = std::make_shared<const IVehicleHardware::GetValuesCallback>(
-            [clientId, callback, requestPoolCopy](std::vector<GetValueResult> results) {
-                onGetValueResults(clientId, callback, requestPoolCopy, results);
+            [clientId, callback, requestPoolCopy,
+             sharedMemoryPoolCopy](std::vector<GetValueResult> results) {
+                onGetValueResults(clientId, callback, requestPoolCopy, sharedMemoryPoolCopy,
+                                  results);
             });
 }
 
@@ -278,17 +393,172 @@ SubscriptionClient::getTimeoutCallback() {
     return mTimeoutCallback;
 }
 
+void SubscriptionClient::sendUpdatedValues(std::vector<VehiclePropValue>&& updatedValues) {
+    if (updatedValues.empty()) {
+        return;
+    }
+
+    {
+        std::scoped_lock<std::mutex> lockGuard(mBatchLock);
+        if (mBatchingWindowInNano <= 0) {
+            if (mSendingBatches || !mPendingBatches.empty()) {
+                // Delivered after the batches queued before them.
+                mPendingBatches.push_back(std::move(updatedValues));
+                updatedValues.clear();
+            }
+        } else {
+            if (mBatchedValues.empty()) {
+                mBatchStartTimeInNano = elapsedRealtimeNano();
+            }
+            for (auto& value : updatedValues) {
+                mBatchedBytes += getApproximateSize(value);
+                mBatchedValues.push_back(std::move(value));
+            }
+            updatedValues.clear();
+            if (mBatchedBytes >= mBatchingByteBudget) {
+                flushBatchedValuesLocked();
+            }
+        }
+    }
+    if (!updatedValues.empty()) {
+        sendUpdatedValues(mCallback, mSharedMemoryPool, std::move(updatedValues));
+        return;
+    }
+    sendPendingBatches();
+}
+
+void SubscriptionClient::setBatchingConfig(int64_t windowInNano, size_t byteBudget) {
+    {
+        std::scoped_lock<std::mutex> lockGuard(mBatchLock);
+        if (windowInNano <= 0) {
+            // Do not leave values behind once batching is disabled.
+            flushBatchedValuesLocked();
+        }
+        mBatchingWindowInNano = windowInNano;
+        mBatchingByteBudget = byteBudget;
+    }
+    sendPendingBatches();
+}
+
+void SubscriptionClient::flushBatchedValues() {
+    {
+        std::scoped_lock<std::mutex> lockGuard(mBatchLock);
+        flushBatchedValuesLocked();
+    }
+    sendPendingBatches();
+}
+
+void SubscriptionClient::flushBatchedValuesLocked() {
+    if (mBatchedValues.empty()) {
+        return;
+    }
+
+    size_t batchSize = mBatchedValues.size();
+    size_t sizeBucket = 0;
+    while (sizeBucket < BATCH_SIZE_BUCKETS.size() && batchSize > BATCH_SIZE_BUCKETS[sizeBucket]) {
+        sizeBucket++;
+    }
+    mBatchSizeHistogram[sizeBucket]++;
+    int64_t latency = elapsedRealtimeNano() - mBatchStartTimeInNano;
+    size_t latencyBucket = 0;
+    while (latencyBucket < BATCH_LATENCY_BUCKETS_IN_NANO.size() &&
+           latency > BATCH_LATENCY_BUCKETS_IN_NANO[latencyBucket]) {
+        latencyBucket++;
+    }
+    mBatchLatencyHistogram[latencyBucket]++;
+
+    mPendingBatches.push_back(std::move(mBatchedValues));
+    mBatchedValues.clear();
+    mBatchedBytes = 0;
+}
+
+void SubscriptionClient::sendPendingBatches() {
+    {
+        std::scoped_lock<std::mutex> lockGuard(mBatchLock);
+        if (mSendingBatches) {
+            // The sending thread picks up the new batches before it stops.
+            return;
+        }
+        mSendingBatches = true;
+    }
+    while (true) {
+        std::vector<VehiclePropValue> values;
+        {
+            std::scoped_lock<std::mutex> lockGuard(mBatchLock);
+            if (mPendingBatches.empty()) {
+                mSendingBatches = false;
+                return;
+            }
+            values = std::move(mPendingBatches.front());
+            mPendingBatches.pop_front();
+        }
+        sendUpdatedValues(mCallback, mSharedMemoryPool, std::move(values));
+    }
+}
+
+VhalResult<void> SubscriptionClient::returnSharedMemory(int64_t sharedMemoryId) {
+    return mSharedMemoryPool->returnMemory(sharedMemoryId);
+}
+
+void SubscriptionClient::setMaxSharedMemoryFileCount(int32_t maxSharedMemoryFileCount) {
+    if (maxSharedMemoryFileCount <= 0) {
+        return;
+    }
+    size_t maxInUseCount = static_cast<size_t>(maxSharedMemoryFileCount);
+    if (maxInUseCount > SharedMemoryPool::MAX_IN_USE_COUNT_LIMIT) {
+        ALOGW("subscribe: max shared memory file count: %zu is larger than the limit: %zu, "
+              "use the limit instead",
+              maxInUseCount, SharedMemoryPool::MAX_IN_USE_COUNT_LIMIT);
+        maxInUseCount = SharedMemoryPool::MAX_IN_USE_COUNT_LIMIT;
+    }
+    mSharedMemoryPool->setMaxInUseCount(maxInUseCount);
+}
+
+std::string SubscriptionClient::dump() {
+    std::string result = mSharedMemoryPool->dump();
+    std::scoped_lock<std::mutex> lockGuard(mBatchLock);
+    if (mBatchingWindowInNano <= 0) {
+        return result + "batching: disabled\n";
+    }
+    result += StringPrintf("batching: window: %" PRId64 "ns, byte budget: %zu\n",
+                           mBatchingWindowInNano, mBatchingByteBudget);
+    result += "batch size histogram:";
+    for (size_t i = 0; i < mBatchSizeHistogram.size(); i++) {
+        if (i < BATCH_SIZE_BUCKETS.size()) {
+            result += StringPrintf(" [<=%zu]: %" PRIu64, BATCH_SIZE_BUCKETS[i],
+                                   mBatchSizeHistogram[i]);
+        } else {
+            result += StringPrintf(" [>%zu]: %" PRIu64, BATCH_SIZE_BUCKETS.back(),
+                                   mBatchSizeHistogram[i]);
+        }
+    }
+    result += "\nbatch latency histogram:";
+    for (size_t i = 0; i < mBatchLatencyHistogram.size(); i++) {
+        if (i < BATCH_LATENCY_BUCKETS_IN_NANO.size()) {
+            result += StringPrintf(" [<=%" PRId64 "ms]: %" PRIu64,
+                                   BATCH_LATENCY_BUCKETS_IN_NANO[i] / 1'000'000,
+                                   mBatchLatencyHistogram[i]);
+        } else {
+            result += StringPrintf(" [>%" PRId64 "ms]: %" PRIu64,
+                                   BATCH_LATENCY_BUCKETS_IN_NANO.back() / 1'000'000,
+                                   mBatchLatencyHistogram[i]);
+        }
+    }
+    return result + "\n";
+}
+
 void SubscriptionClient::sendUpdatedValues(std::shared_ptr<IVehicleCallback> callback,
+                                           std::shared_ptr<SharedMemoryPool> sharedMemoryPool,
                                            std::vector<VehiclePropValue>&& updatedValues) {
     if (updatedValues.empty()) {
         return;
     }
 
-    // TODO(b/205189110): Use memory pool here and fill in sharedMemoryId.
     VehiclePropValues vehiclePropValues;
     int32_t sharedMemoryFileCount = 0;
     ScopedAStatus status =
-            vectorToStableLargeParcelable(std::move(updatedValues), &vehiclePropValues);
+            vectorToPooledStableLargeParcelable(std::move(updatedValues), sharedMemoryPool.get(),
+                                                &vehiclePropValues, &sharedMemoryFileCount);
     if (!status.isOk()) {
         int statusCode = status.getServiceSpecificError();
         ALOGE("subscribe: failed to marshal result into large parcelable, error: "
@@ -304,12 +574,18 @@ void SubscriptionClient::sendUpdatedValues(std::shared_ptr<IVehicleCallback> cal
               "exception: %d, service specific error: %d",
               callback->asBinder().get(), callbackStatus.getMessage(),
               callbackStatus.getExceptionCode(), callbackStatus.getServiceSpecificError());
+        if (sharedMemoryPool != nullptr &&
+            vehiclePropValues.sharedMemoryId != IVehicle::INVALID_MEMORY_ID) {
+            // The client would never return the memory since it did not receive it.
+            sharedMemoryPool->returnMemory(vehiclePropValues.sharedMemoryId);
+        }
     }
 }
 
 void SubscriptionClient::onGetValueResults(const void* clientId,
                                            std::shared_ptr<IVehicleCallback> callback,
                                            std::shared_ptr<PendingRequestPool> requestPool,
+                                           std::shared_ptr<SharedMemoryPool> sharedMemoryPool,
                                            std::vector<GetValueResult> results) {
     std::unordered_set<int64_t> requestIds;
     for (const auto& result : results) {
@@ -341,7 +617,7 @@ void SubscriptionClient::onGetValueResults(const void* clientId,
         propValues.push_back(std::move(result.prop.value()));
     }
 
-    sendUpdatedValues(callback, std::move(propValues));
+    sendUpdatedValues(callback, sharedMemoryPool, std::move(propValues));
 }
 
 }  // namespace vehicle
@@ -20,6 +20,7 @@
 
 #include <LargeParcelableBase.h>
 #include <VehicleHalTypes.h>
+#include <VehicleObjectPool.h>
 #include <VehicleUtils.h>
 
 #include <android-base/result.h>
@@ -93,7 +94,10 @@ float getDefaultSampleRate(float sampleRate, float minSampleRate, float maxSampl
 std::shared_ptr<SubscriptionClient> DefaultVehicleHal::SubscriptionClients::maybeAddClient(
         const CallbackType& callback) {
     std::scoped_lock<std::mutex> lockGuard(mLock);
-    return getOrCreateClient(&mClients, callback, mPendingRequestPool);
+    std::shared_ptr<SubscriptionClient> client =
+            getOrCreateClient(&mClients, callback, mPendingRequestPool);
+    client->setBatchingConfig(mEventBatchingWindowInNano, mEventBatchingByteBudget);
+    return client;
 }
 
 std::shared_ptr<SubscriptionClient> DefaultVehicleHal::SubscriptionClients::getClient(
@@ -123,13 +127,28 @@ size_t DefaultVehicleHal::SubscriptionClients::countClients() {
     return mClients.size();
 }
 
-DefaultVehicleHal::DefaultVehicleHal(std::unique_ptr<IVehicleHardware> hardware)
+std::unordered_map<const AIBinder*, std::shared_ptr<SubscriptionClient>>
+DefaultVehicleHal::SubscriptionClients::getAllClients() {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    return mClients;
+}
+
+DefaultVehicleHal::DefaultVehicleHal(std::unique_ptr<IVehicleHardware> hardware,
+                                     int64_t eventBatchingWindowInNano,
+                                     size_t eventBatchingByteBudget,
+                                     int64_t resultCoalescingWindowInNano,
+                                     size_t resultCoalescingMaxResults)
     : mVehicleHardware(std::move(hardware)),
+      mResultCoalescingWindowInNano(resultCoalescingWindowInNano),
+      mResultCoalescingMaxResults(resultCoalescingMaxResults),
       mPendingRequestPool(std::make_shared<PendingRequestPool>(TIMEOUT_IN_NANO)) {
     auto configs = mVehicleHardware->getAllPropertyConfigs();
     for (auto& config : configs) {
         mConfigsByPropId[config.prop] = config;
     }
+    for (const auto& [propId, config] : mConfigsByPropId) {
+        mValidatorsByPropId.emplace(propId, PropValueValidator(config));
+    }
     VehiclePropConfigs vehiclePropConfigs;
     vehiclePropConfigs.payloads = std::move(configs);
     auto result = LargeParcelableBase::parcelableToStableLargeParcelable(vehiclePropConfigs);
@@ -141,29 +160,52 @@ DefaultVehicleHal::DefaultVehicleHal(std::unique_ptr<IVehicleHardware> hardware)
 
     if (result.value() != nullptr) {
         mConfigFile = std::move(result.value());
+    } else {
+        // The configs fit in the payloads, keep them instead of rebuilding them on every call.
+        mConfigPayloads = std::move(vehiclePropConfigs.payloads);
     }
 
-    mSubscriptionClients = std::make_shared<SubscriptionClients>(mPendingRequestPool);
-    mSubscriptionClients = std::make_shared<SubscriptionClients>(mPendingRequestPool);
+    mSubscriptionClients = std::make_shared<SubscriptionClients>(
+            mPendingRequestPool, eventBatchingWindowInNano, eventBatchingByteBudget);
 
     auto subscribeIdByClient = std::make_shared<SubscribeIdByClient>();
     IVehicleHardware* hardwarePtr = mVehicleHardware.get();
     mSubscriptionManager = std::make_shared<SubscriptionManager>(hardwarePtr);
 
     std::weak_ptr<SubscriptionManager> subscriptionManagerCopy = mSubscriptionManager;
+    std::weak_ptr<SubscriptionClients> subscriptionClientsCopy = mSubscriptionClients;
     mVehicleHardware->registerOnPropertyChangeEvent(
             std::make_unique<IVehicleHardware::PropertyChangeCallback>(
-                    [subscriptionManagerCopy](std::vector<VehiclePropValue> updatedValues) {
-                        onPropertyChangeEvent(subscriptionManagerCopy, updatedValues);
+                    [subscriptionManagerCopy,
+                     subscriptionClientsCopy](std::vector<VehiclePropValue> updatedValues) {
+                        onPropertyChangeEvent(subscriptionManagerCopy, subscriptionClientsCopy,
+                                              updatedValues);
                     }));
 
     // Register heartbeat event.
-    mRecurrentAction =
-            std::make_shared<std::function<void()>>([hardwarePtr, subscriptionManagerCopy]() {
-                checkHealth(hardwarePtr, subscriptionManagerCopy);
+    mRecurrentAction = std::make_shared<std::function<void()>>(
+            [hardwarePtr, subscriptionManagerCopy, subscriptionClientsCopy]() {
+                checkHealth(hardwarePtr, subscriptionManagerCopy, subscriptionClientsCopy);
             });
     mRecurrentTimer.registerTimerCallback(HEART_BEAT_INTERVAL_IN_NANO, mRecurrentAction);
 
+    if (eventBatchingWindowInNano > 0) {
+        mFlushBatchedEventsAction =
+                std::make_shared<std::function<void()>>([subscriptionClientsCopy]() {
+                    flushBatchedEvents(subscriptionClientsCopy);
+                });
+        mRecurrentTimer.registerTimerCallback(eventBatchingWindowInNano,
+                                              mFlushBatchedEventsAction);
+    }
+
+    if (resultCoalescingWindowInNano > 0) {
+        // mRecurrentTimer is declared after the clients, so it stops before they are destroyed.
+        mFlushCoalescedResultsAction =
+                std::make_shared<std::function<void()>>([this]() { flushCoalescedResults(); });
+        mRecurrentTimer.registerTimerCallback(resultCoalescingWindowInNano,
+                                              mFlushCoalescedResultsAction);
+    }
+
     mBinderImpl = std::make_unique<AIBinderImpl>();
     mOnBinderDiedUnlinkedHandlerThread = std::thread([this] { onBinderDiedUnlinkedHandler(); });
     mDeathRecipient = ScopedAIBinder_DeathRecipient(
@@ -182,6 +224,12 @@ DefaultVehicleHal::~DefaultVehicleHal() {
     // mRecurrentAction uses pointer to mVehicleHardware, so it has to be unregistered before
     // mVehicleHardware.
     mRecurrentTimer.unregisterTimerCallback(mRecurrentAction);
+    if (mFlushBatchedEventsAction != nullptr) {
+        mRecurrentTimer.unregisterTimerCallback(mFlushBatchedEventsAction);
+    }
+    if (mFlushCoalescedResultsAction != nullptr) {
+        mRecurrentTimer.unregisterTimerCallback(mFlushCoalescedResultsAction);
+    }
     // mSubscriptionManager uses pointer to mVehicleHardware, so it has to be destroyed before
     // mVehicleHardware.
     mSubscriptionManager.reset();
@@ -190,19 +238,60 @@ DefaultVehicleHal::~DefaultVehicleHal() {
 
 void DefaultVehicleHal::onPropertyChangeEvent(
         std::weak_ptr<SubscriptionManager> subscriptionManager,
+        std::weak_ptr<SubscriptionClients> subscriptionClients,
         const std::vector<VehiclePropValue>& updatedValues) {
     auto manager = subscriptionManager.lock();
     if (manager == nullptr) {
         ALOGW("the SubscriptionManager is destroyed, DefaultVehicleHal is ending");
         return;
     }
+    auto clients = subscriptionClients.lock();
     auto updatedValuesByClients = manager->getSubscribedClients(updatedValues);
     for (const auto& [callback, valuePtrs] : updatedValuesByClients) {
         std::vector<VehiclePropValue> values;
         for (const VehiclePropValue* valuePtr : valuePtrs) {
             values.push_back(*valuePtr);
         }
-        SubscriptionClient::sendUpdatedValues(callback, std::move(values));
+        std::shared_ptr<SubscriptionClient> client =
+                clients == nullptr ? nullptr : clients->getClient(callback);
+        if (client == nullptr) {
+            // The client is being removed, send without using its shared memory pool.
+            SubscriptionClient::sendUpdatedValues(callback, nullptr, std::move(values));
+            continue;
+        }
+        client->sendUpdatedValues(std::move(values));
+    }
+}
+
+void DefaultVehicleHal::flushBatchedEvents(
+        std::weak_ptr<SubscriptionClients> subscriptionClients) {
+    auto clients = subscriptionClients.lock();
+    if (clients == nullptr) {
+        return;
+    }
+    for (const auto& [_, client] : clients->getAllClients()) {
+        client->flushBatchedValues();
+    }
+}
+
+void DefaultVehicleHal::flushCoalescedResults() {
+    std::vector<std::shared_ptr<GetValuesClient>> getValuesClients;
+    std::vector<std::shared_ptr<SetValuesClient>> setValuesClients;
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        for (const auto& [_, client] : mGetValuesClients) {
+            getValuesClients.push_back(client);
+        }
+        for (const auto& [_, client] : mSetValuesClients) {
+            setValuesClients.push_back(client);
+        }
+    }
+    // Send the results without holding mLock, since the callbacks may block.
+    for (const auto& client : getValuesClients) {
+        client->flushCoalescedResults();
+    }
+    for (const auto& client : setValuesClients) {
+        client->flushCoalescedResults();
     }
 }
 
@@ -307,10 +396,7 @@ ScopedAStatus DefaultVehicleHal::getAllPropConfigs(VehiclePropConfigs* output) {
         output->sharedMemoryFd.set(dup(mConfigFile->get()));
         return ScopedAStatus::ok();
     }
-    output->payloads.reserve(mConfigsByPropId.size());
-    for (const auto& [_, config] : mConfigsByPropId) {
-        output->payloads.push_back(config);
-    }
+    output->payloads = mConfigPayloads;
     return ScopedAStatus::ok();
 }
 
@@ -324,23 +410,23 @@ Result<const VehiclePropConfig*> DefaultVehicleHal::getConfig(int32_t propId) co
 
 Result<void> DefaultVehicleHal::checkProperty(const VehiclePropValue& propValue) {
     int32_t propId = propValue.prop;
-    auto result = getConfig(propId);
-    if (!result.ok()) {
-        return result.error();
+    auto it = mValidatorsByPropId.find(propId);
+    if (it == mValidatorsByPropId.end()) {
+        return Error() << "no config for property, ID: " << propId;
     }
-    const VehiclePropConfig* config = result.value();
-    const VehicleAreaConfig* areaConfig = getAreaConfig(propValue, *config);
+    const PropValueValidator& validator = it->second;
+    const VehicleAreaConfig* areaConfig = validator.getAreaConfig(propValue.areaId);
     if (!isGlobalProp(propId) && areaConfig == nullptr) {
         // Ignore areaId for global property. For non global property, check whether areaId is
         // allowed. areaId must appear in areaConfig.
         return Error() << "invalid area ID: " << propValue.areaId << " for prop ID: " << propId
                        << ", not listed in config";
     }
-    if (auto result = checkPropValue(propValue, config); !result.ok()) {
+    if (auto result = validator.checkPropValue(propValue); !result.ok()) {
         return Error() << "invalid property value: " << propValue.toString()
                        << ", error: " << getErrorMsg(result);
     }
-    if (auto result = checkValueRange(propValue, areaConfig); !result.ok()) {
+    if (auto result = validator.checkValueRange(propValue, areaConfig); !result.ok()) {
         return Error() << "property value out of range: " << propValue.toString()
                        << ", error: " << getErrorMsg(result);
     }
@@ -399,6 +485,7 @@ ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
 
         client = getOrCreateClient(&mGetValuesClients, callback, mPendingRequestPool);
     }
+    client->setCoalescingConfig(mResultCoalescingWindowInNano, mResultCoalescingMaxResults);
 
     // Register the pending hardware requests and also check for duplicate request Ids.
     if (auto addRequestResult = client->addRequests(hardwareRequestIds); !addRequestResult.ok()) {
@@ -491,6 +578,7 @@ ScopedAStatus DefaultVehicleHal::setValues(const CallbackType& callback,
         }
         client = getOrCreateClient(&mSetValuesClients, callback, mPendingRequestPool);
     }
+    client->setCoalescingConfig(mResultCoalescingWindowInNano, mResultCoalescingMaxResults);
 
     // Register the pending hardware requests and also check for duplicate request Ids.
     if (auto addRequestResult = client->addRequests(hardwareRequestIds); !addRequestResult.ok()) {
@@ -623,8 +711,7 @@ VhalResult<void> DefaultVehicleHal::checkSubscribeOptions(
 
 ScopedAStatus DefaultVehicleHal::subscribe(const CallbackType& callback,
                                            const std::vector<SubscribeOptions>& options,
-                                           [[maybe_unused]] int32_t maxSharedMemoryFileCount) {
-    // TODO(b/205189110): Use shared memory file count.
+                                           int32_t maxSharedMemoryFileCount) {
     if (auto result = checkSubscribeOptions(options); !result.ok()) {
         ALOGE("subscribe: invalid subscribe options: %s", getErrorMsg(result).c_str());
         return toScopedAStatus(result);
@@ -667,7 +754,8 @@ ScopedAStatus DefaultVehicleHal::subscribe(const CallbackType& callback,
         }
 
         // Create a new SubscriptionClient if there isn't an existing one.
-        mSubscriptionClients->maybeAddClient(callback);
+        std::shared_ptr<SubscriptionClient> client = mSubscriptionClients->maybeAddClient(callback);
+        client->setMaxSharedMemoryFileCount(maxSharedMemoryFileCount);
 
         // Since we have already check the sample rates, the following functions must succeed.
         if (!onChangeSubscriptions.empty()) {
@@ -688,8 +776,18 @@ ScopedAStatus DefaultVehicleHal::unsubscribe(const CallbackType& callback,
     return toScopedAStatus(mSubscriptionManager->unsubscribe(callback->asBinder().get(), propIds));
 }
 
-ScopedAStatus DefaultVehicleHal::returnSharedMemory(const CallbackType&, int64_t) {
-    // TODO(b/200737967): implement this.
+ScopedAStatus DefaultVehicleHal::returnSharedMemory(const CallbackType& callback,
+                                                    int64_t sharedMemoryId) {
+    std::shared_ptr<SubscriptionClient> client = mSubscriptionClients->getClient(callback);
+    if (client == nullptr) {
+        ALOGE("returnSharedMemory: no subscription client for the callback");
+        return ScopedAStatus::fromServiceSpecificErrorWithMessage(
+                toInt(StatusCode::INVALID_ARG), "no subscription client for the callback");
+    }
+    if (auto result = client->returnSharedMemory(sharedMemoryId); !result.ok()) {
+        ALOGE("returnSharedMemory: %s", getErrorMsg(result).c_str());
+        return toScopedAStatus(result);
+    }
     return ScopedAStatus::ok();
 }
 
@@ -730,7 +828,8 @@ VhalResult<void> DefaultVehicleHal::checkReadPermission(const VehiclePropValue&
 }
 
 void DefaultVehicleHal::checkHealth(IVehicleHardware* hardware,
-                                    std::weak_ptr<SubscriptionManager> subscriptionManager) {
+                                    std::weak_ptr<SubscriptionManager> subscriptionManager,
+                                    std::weak_ptr<SubscriptionClients> subscriptionClients) {
     StatusCode status = hardware->checkHealth();
     if (status != StatusCode::OK) {
         ALOGE("VHAL check health returns non-okay status");
@@ -742,7 +841,7 @@ void DefaultVehicleHal::checkHealth(IVehicleHardware* hardware,
             .status = VehiclePropertyStatus::AVAILABLE,
             .value.int64Values = {uptimeMillis()},
     }};
-    onPropertyChangeEvent(subscriptionManager, values);
+    onPropertyChangeEvent(subscriptionManager, subscriptionClients, values);
     return;
 }
 
@@ -790,6 +889,10 @@ binder_status_t DefaultVehicleHal::dump(int fd, const char** args, uint32_t numA
         dprintf(fd, "Currently have %zu subscription clients\n",
                 mSubscriptionClients->countClients());
     }
+    dprintf(fd, "%s", PoolStats::instance()->dump().c_str());
+    for (const auto& [clientId, client] : mSubscriptionClients->getAllClients()) {
+        dprintf(fd, "Subscription client %p %s", clientId, client->dump().c_str());
+    }
     return STATUS_OK;
 }
 
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SharedMemoryPool"
+
+#include "SharedMemoryPool.h"
+
+#include <android-base/stringprintf.h>
+#include <cutils/ashmem.h>
+#include <utils/Log.h>
+
+#include <inttypes.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::StatusCode;
+using ::android::base::Error;
+using ::android::base::Result;
+using ::android::base::StringPrintf;
+using ::android::base::unique_fd;
+using ::ndk::ScopedFileDescriptor;
+
+}  // namespace
+
+SharedMemoryPool::Memory::~Memory() {
+    if (addr != nullptr) {
+        munmap(addr, capacity);
+    }
+}
+
+SharedMemoryPool::SharedMemoryPool(size_t maxInUseCount) : mMaxInUseCount(maxInUseCount) {}
+
+SharedMemoryPool::~SharedMemoryPool() = default;
+
+size_t SharedMemoryPool::getSizeClass(size_t size) {
+    size_t sizeClass = MIN_SIZE_CLASS;
+    while (sizeClass < size) {
+        sizeClass <<= 1;
+    }
+    return sizeClass;
+}
+
+Result<std::unique_ptr<SharedMemoryPool::Memory>> SharedMemoryPool::createMemory(
+        size_t capacity) {
+    unique_fd fd(ashmem_create_region("VehicleHalSharedMemory", capacity));
+    if (!fd.ok()) {
+        return Error() << "failed to create ashmem region, size: " << capacity;
+    }
+    // Map the memory as read-write before restricting the protection. Existing mappings are not
+    // affected by ashmem_set_prot_region, so VHAL could keep writing to it while the client could
+    // only map it as read-only.
+    void* addr = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (addr == MAP_FAILED) {
+        return Error() << "failed to map ashmem region, errno: " << errno;
+    }
+    auto memory = std::make_unique<Memory>();
+    memory->fd = std::move(fd);
+    memory->addr = addr;
+    memory->capacity = capacity;
+    if (ashmem_set_prot_region(memory->fd.get(), PROT_READ) != 0) {
+        return Error() << "failed to set ashmem region to read-only, errno: " << errno;
+    }
+    return memory;
+}
+
+Result<SharedMemoryPool::Lease> SharedMemoryPool::write(const AParcel* parcel) {
+    size_t size = static_cast<size_t>(AParcel_getDataSize(parcel));
+    if (size > MAX_SIZE_CLASS) {
+        return Error() << "payload size: " << size << " is too large to be pooled";
+    }
+    size_t sizeClass = getSizeClass(size);
+
+    std::unique_ptr<Memory> memory;
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        if (mInUseMemoryById.size() >= mMaxInUseCount) {
+            return Error() << "too many shared memory files in use: " << mInUseMemoryById.size()
+                           << ", client might not have returned them";
+        }
+        auto& freeList = mFreeMemoryBySizeClass[sizeClass];
+        if (!freeList.empty()) {
+            memory = std::move(freeList.back());
+            freeList.pop_back();
+            mHitCount++;
+        } else {
+            mMissCount++;
+        }
+    }
+
+    if (memory == nullptr) {
+        auto result = createMemory(sizeClass);
+        if (!result.ok()) {
+            return Error() << result.error().message();
+        }
+        memory = std::move(result.value());
+    }
+
+    if (binder_status_t status =
+                AParcel_marshal(parcel, static_cast<uint8_t*>(memory->addr), 0, size);
+        status != STATUS_OK) {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        mFreeMemoryBySizeClass[sizeClass].push_back(std::move(memory));
+        return Error() << "failed to marshal parcel into shared memory, status: " << status;
+    }
+    if (memory->dirtySize > size) {
+        // Clear the rest of the payload from the previous user.
+        memset(static_cast<uint8_t*>(memory->addr) + size, 0, memory->dirtySize - size);
+    }
+    memory->dirtySize = size;
+
+    int clientFd = dup(memory->fd.get());
+    if (clientFd < 0) {
+        int error = errno;
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        mFreeMemoryBySizeClass[sizeClass].push_back(std::move(memory));
+        return Error() << "failed to dup shared memory fd, errno: " << error;
+    }
+
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    int64_t memoryId = mNextMemoryId++;
+    mInUseMemoryById[memoryId] = std::move(memory);
+    return Lease{
+            .memoryId = memoryId,
+            .fd = ScopedFileDescriptor(clientFd),
+            .inUseCount = static_cast<int32_t>(mInUseMemoryById.size()),
+    };
+}
+
+VhalResult<void> SharedMemoryPool::returnMemory(int64_t memoryId) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    auto it = mInUseMemoryById.find(memoryId);
+    if (it == mInUseMemoryById.end()) {
+        return StatusError(StatusCode::INVALID_ARG)
+               << StringPrintf("no shared memory in use with ID: %" PRId64, memoryId);
+    }
+    std::unique_ptr<Memory> memory = std::move(it->second);
+    mInUseMemoryById.erase(it);
+    auto& freeList = mFreeMemoryBySizeClass[memory->capacity];
+    if (freeList.size() < MAX_FREE_COUNT_PER_SIZE_CLASS) {
+        freeList.push_back(std::move(memory));
+    }
+    return {};
+}
+
+void SharedMemoryPool::recordFallback() {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    mFallbackCount++;
+}
+
+void SharedMemoryPool::setMaxInUseCount(size_t maxInUseCount) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    mMaxInUseCount = maxInUseCount;
+}
+
+SharedMemoryPool::Stats SharedMemoryPool::getStats() {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    Stats stats = {
+            .hitCount = mHitCount,
+            .missCount = mMissCount,
+            .fallbackCount = mFallbackCount,
+            .inUseCount = mInUseMemoryById.size(),
+            .freeCount = 0,
+            .freeBytes = 0,
+    };
+    for (const auto& [sizeClass, freeList] : mFreeMemoryBySizeClass) {
+        stats.freeCount += freeList.size();
+        stats.freeBytes += sizeClass * freeList.size();
+    }
+    return stats;
+}
+
+std::string SharedMemoryPool::dump() {
+    Stats stats = getStats();
+    return StringPrintf("shared memory pool: hit: %" PRIu64 ", miss: %" PRIu64
+                        ", fallback: %" PRIu64 ", in use: %zu, free: %zu (%zu bytes)\n",
+                        stats.hitCount, stats.missCount, stats.fallbackCount, stats.inUseCount,
+                        stats.freeCount, stats.freeBytes);
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -19,17 +19,25 @@
 #include <DefaultVehicleHal.h>
 #include <FakeVehicleHardware.h>
 
+#include <android-base/properties.h>
 #include <android/binder_manager.h>
 #include <android/binder_process.h>
 #include <utils/Log.h>
 
+using ::android::base::GetIntProperty;
 using ::android::hardware::automotive::vehicle::DefaultVehicleHal;
 using ::android::hardware::automotive::vehicle::fake::FakeVehicleHardware;
 
 int main(int /* argc */, char* /* argv */[]) {
     std::unique_ptr<FakeVehicleHardware> hardware = std::make_unique<FakeVehicleHardware>();
-    std::shared_ptr<DefaultVehicleHal> vhal =
-            ::ndk::SharedRefBase::make<DefaultVehicleHal>(std::move(hardware));
+    // Property events are sent immediately unless a batching window is configured.
+    int64_t eventBatchingWindowInNano =
+            GetIntProperty<int64_t>("ro.vendor.vhal.event_batching_window_ms", 0) * 1'000'000;
+    size_t eventBatchingByteBudget = GetIntProperty<size_t>(
+            "ro.vendor.vhal.event_batching_byte_budget",
+            DefaultVehicleHal::DEFAULT_EVENT_BATCHING_BYTE_BUDGET);
+    std::shared_ptr<DefaultVehicleHal> vhal = ::ndk::SharedRefBase::make<DefaultVehicleHal>(
+            std::move(hardware), eventBatchingWindowInNano, eventBatchingByteBudget);
 
     ALOGI("Registering as service...");
     binder_exception_t err = AServiceManager_addService(
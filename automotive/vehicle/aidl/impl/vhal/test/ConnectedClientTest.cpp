@@ -214,6 +214,156 @@ TEST_F(ConnectedClientTest, testSetValuesGetResultCallback) {
     ASSERT_EQ(maybeSetValueResults.value().payloads, results);
 }
 
+TEST_F(ConnectedClientTest, testSubscriptionClientSendUpdatedValuesNoBatching) {
+    SubscriptionClient client(getPool(), getCallbackClient());
+
+    client.sendUpdatedValues({VehiclePropValue{.prop = 0}});
+    client.sendUpdatedValues({VehiclePropValue{.prop = 1}});
+
+    ASSERT_EQ(getCallback()->countOnPropertyEventResults(), 2u);
+}
+
+TEST_F(ConnectedClientTest, testSubscriptionClientBatchUntilFlush) {
+    SubscriptionClient client(getPool(), getCallbackClient());
+    client.setBatchingConfig(/*windowInNano=*/1'000'000'000, /*byteBudget=*/4096);
+
+    client.sendUpdatedValues({VehiclePropValue{.prop = 0}});
+    client.sendUpdatedValues({VehiclePropValue{.prop = 1}});
+
+    ASSERT_EQ(getCallback()->countOnPropertyEventResults(), 0u);
+
+    client.flushBatchedValues();
+
+    auto maybeResults = getCallback()->nextOnPropertyEventResults();
+    ASSERT_TRUE(maybeResults.has_value());
+    ASSERT_EQ(maybeResults.value().payloads,
+              std::vector<VehiclePropValue>({VehiclePropValue{.prop = 0},
+                                             VehiclePropValue{.prop = 1}}));
+    ASSERT_EQ(getCallback()->countOnPropertyEventResults(), 0u);
+}
+
+TEST_F(ConnectedClientTest, testSubscriptionClientBatchFlushOnByteBudget) {
+    SubscriptionClient client(getPool(), getCallbackClient());
+    client.setBatchingConfig(/*windowInNano=*/1'000'000'000,
+                             /*byteBudget=*/sizeof(VehiclePropValue) + 1);
+
+    client.sendUpdatedValues({VehiclePropValue{.prop = 0}});
+
+    ASSERT_EQ(getCallback()->countOnPropertyEventResults(), 0u);
+
+    client.sendUpdatedValues({VehiclePropValue{.prop = 1}});
+
+    ASSERT_EQ(getCallback()->countOnPropertyEventResults(), 1u);
+}
+
+TEST_F(ConnectedClientTest, testSubscriptionClientDisableBatchingFlushes) {
+    SubscriptionClient client(getPool(), getCallbackClient());
+    client.setBatchingConfig(/*windowInNano=*/1'000'000'000, /*byteBudget=*/4096);
+    client.sendUpdatedValues({VehiclePropValue{.prop = 0}});
+
+    client.setBatchingConfig(/*windowInNano=*/0, /*byteBudget=*/0);
+
+    ASSERT_EQ(getCallback()->countOnPropertyEventResults(), 1u);
+}
+
+TEST_F(ConnectedClientTest, testSubscriptionClientDoesNotHoldLockInCallback) {
+    SubscriptionClient client(getPool(), getCallbackClient());
+    // Taking the batching lock from the callback would deadlock if it was held.
+    getCallback()->setOnPropertyEventHook([&client] { client.dump(); });
+
+    client.sendUpdatedValues({VehiclePropValue{.prop = 0}});
+
+    ASSERT_EQ(getCallback()->countOnPropertyEventResults(), 1u);
+}
+
+TEST_F(ConnectedClientTest, testSubscriptionClientValuesSentDuringFlushKeepOrder) {
+    SubscriptionClient client(getPool(), getCallbackClient());
+    client.setBatchingConfig(/*windowInNano=*/1'000'000'000, /*byteBudget=*/4096);
+    bool sentFromCallback = false;
+    getCallback()->setOnPropertyEventHook([&client, &sentFromCallback] {
+        if (!sentFromCallback) {
+            sentFromCallback = true;
+            client.sendUpdatedValues({VehiclePropValue{.prop = 2}});
+            client.flushBatchedValues();
+        }
+    });
+    client.sendUpdatedValues({VehiclePropValue{.prop = 0}});
+    client.sendUpdatedValues({VehiclePropValue{.prop = 1}});
+
+    client.flushBatchedValues();
+
+    auto maybeResults = getCallback()->nextOnPropertyEventResults();
+    ASSERT_TRUE(maybeResults.has_value());
+    ASSERT_EQ(maybeResults.value().payloads,
+              std::vector<VehiclePropValue>({VehiclePropValue{.prop = 0},
+                                             VehiclePropValue{.prop = 1}}));
+    maybeResults = getCallback()->nextOnPropertyEventResults();
+    ASSERT_TRUE(maybeResults.has_value());
+    ASSERT_EQ(maybeResults.value().payloads,
+              std::vector<VehiclePropValue>({VehiclePropValue{.prop = 2}}));
+    ASSERT_EQ(getCallback()->countOnPropertyEventResults(), 0u);
+}
+
+TEST_F(ConnectedClientTest, testGetValuesCoalesceUntilFlush) {
+    GetValuesClient client(getPool(), getCallbackClient());
+    client.setCoalescingConfig(/*windowInNano=*/1'000'000'000, /*maxResults=*/32);
+    client.addRequests({0, 1});
+
+    (*(client.getResultCallback()))({GetValueResult{.requestId = 0, .status = StatusCode::OK}});
+    (*(client.getResultCallback()))({GetValueResult{.requestId = 1, .status = StatusCode::OK}});
+
+    ASSERT_FALSE(getCallback()->nextGetValueResults().has_value());
+
+    client.flushCoalescedResults();
+
+    auto maybeGetValueResults = getCallback()->nextGetValueResults();
+    ASSERT_TRUE(maybeGetValueResults.has_value());
+    ASSERT_EQ(maybeGetValueResults.value().payloads,
+              std::vector<GetValueResult>(
+                      {GetValueResult{.requestId = 0, .status = StatusCode::OK},
+                       GetValueResult{.requestId = 1, .status = StatusCode::OK}}));
+    ASSERT_FALSE(getCallback()->nextGetValueResults().has_value());
+}
+
+TEST_F(ConnectedClientTest, testSetValuesCoalesceFlushOnMaxResults) {
+    SetValuesClient client(getPool(), getCallbackClient());
+    client.setCoalescingConfig(/*windowInNano=*/1'000'000'000, /*maxResults=*/2);
+    client.addRequests({0, 1});
+
+    (*(client.getResultCallback()))({SetValueResult{.requestId = 0, .status = StatusCode::OK}});
+
+    ASSERT_FALSE(getCallback()->nextSetValueResults().has_value());
+
+    (*(client.getResultCallback()))({SetValueResult{.requestId = 1, .status = StatusCode::OK}});
+
+    auto maybeSetValueResults = getCallback()->nextSetValueResults();
+    ASSERT_TRUE(maybeSetValueResults.has_value());
+    ASSERT_EQ(maybeSetValueResults.value().payloads.size(), 2u);
+}
+
+TEST_F(ConnectedClientTest, testCoalescingIgnoresFinishedRequests) {
+    GetValuesClient client(getPool(), getCallbackClient());
+    client.setCoalescingConfig(/*windowInNano=*/1'000'000'000, /*maxResults=*/32);
+    client.addRequests({0});
+    client.tryFinishRequests({0});
+
+    (*(client.getResultCallback()))({GetValueResult{.requestId = 0, .status = StatusCode::OK}});
+    client.flushCoalescedResults();
+
+    ASSERT_FALSE(getCallback()->nextGetValueResults().has_value());
+}
+
+TEST_F(ConnectedClientTest, testDisableCoalescingFlushes) {
+    GetValuesClient client(getPool(), getCallbackClient());
+    client.setCoalescingConfig(/*windowInNano=*/1'000'000'000, /*maxResults=*/32);
+    client.addRequests({0});
+    (*(client.getResultCallback()))({GetValueResult{.requestId = 0, .status = StatusCode::OK}});
+
+    client.setCoalescingConfig(/*windowInNano=*/0, /*maxResults=*/0);
+
+    ASSERT_TRUE(getCallback()->nextGetValueResults().has_value());
+}
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
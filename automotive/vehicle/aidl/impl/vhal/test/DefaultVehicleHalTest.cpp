@@ -1520,6 +1520,111 @@ TEST_F(DefaultVehicleHalTest, testUnsubscribeFailure) {
     ASSERT_EQ(status.getServiceSpecificError(), toInt(StatusCode::INVALID_ARG));
 }
 
+TEST_F(DefaultVehicleHalTest, testReturnSharedMemoryNoSubscription) {
+    auto status = getClient()->returnSharedMemory(getCallbackClient(), 1);
+
+    ASSERT_FALSE(status.isOk()) << "returnSharedMemory without subscription must fail";
+    ASSERT_EQ(status.getServiceSpecificError(), toInt(StatusCode::INVALID_ARG));
+}
+
+TEST_F(DefaultVehicleHalTest, testReturnSharedMemoryInvalidId) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = GLOBAL_ON_CHANGE_PROP,
+            },
+    };
+    auto status = getClient()->subscribe(getCallbackClient(), options, 0);
+    ASSERT_TRUE(status.isOk()) << "subscribe failed: " << status.getMessage();
+
+    status = getClient()->returnSharedMemory(getCallbackClient(), 1);
+
+    ASSERT_FALSE(status.isOk()) << "returnSharedMemory with unknown ID must fail";
+    ASSERT_EQ(status.getServiceSpecificError(), toInt(StatusCode::INVALID_ARG));
+}
+
+TEST_F(DefaultVehicleHalTest, testSubscribeLargeEventUsesPooledSharedMemory) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = GLOBAL_ON_CHANGE_PROP,
+            },
+    };
+    auto status = getClient()->subscribe(getCallbackClient(), options,
+                                         /*maxSharedMemoryFileCount=*/1);
+    ASSERT_TRUE(status.isOk()) << "subscribe failed: " << status.getMessage();
+
+    // Too large to be sent directly.
+    VehiclePropValue testValue{
+            .prop = GLOBAL_ON_CHANGE_PROP,
+            .value.int32Values = std::vector<int32_t>(4096, 1),
+    };
+    getHardware()->sendOnPropertyChangeEvent({testValue});
+
+    auto maybeResults = getCallback()->nextOnPropertyEventResults();
+    ASSERT_TRUE(maybeResults.has_value()) << "no results in callback";
+    ASSERT_TRUE(maybeResults.value().payloads.empty());
+    int64_t sharedMemoryId = maybeResults.value().sharedMemoryId;
+    ASSERT_NE(sharedMemoryId, IVehicle::INVALID_MEMORY_ID) << "expect a pooled shared memory file";
+    ASSERT_EQ(getCallback()->getSharedMemoryFileCount(), 1);
+    auto result = LargeParcelableBase::stableLargeParcelableToParcelable(maybeResults.value());
+    ASSERT_TRUE(result.ok()) << "failed to parse result shared memory file: "
+                             << result.error().message();
+    ASSERT_EQ(result.value().getObject()->payloads, std::vector<VehiclePropValue>({testValue}));
+
+    // The only pooled file is still in use, an unpooled one is sent instead.
+    getHardware()->sendOnPropertyChangeEvent({testValue});
+
+    maybeResults = getCallback()->nextOnPropertyEventResults();
+    ASSERT_TRUE(maybeResults.has_value()) << "no results in callback";
+    ASSERT_EQ(maybeResults.value().sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    result = LargeParcelableBase::stableLargeParcelableToParcelable(maybeResults.value());
+    ASSERT_TRUE(result.ok()) << "failed to parse result shared memory file: "
+                             << result.error().message();
+    ASSERT_EQ(result.value().getObject()->payloads, std::vector<VehiclePropValue>({testValue}));
+
+    status = getClient()->returnSharedMemory(getCallbackClient(), sharedMemoryId);
+    ASSERT_TRUE(status.isOk()) << "returnSharedMemory failed: " << status.getMessage();
+
+    // The returned file is handed out again.
+    getHardware()->sendOnPropertyChangeEvent({testValue});
+
+    maybeResults = getCallback()->nextOnPropertyEventResults();
+    ASSERT_TRUE(maybeResults.has_value()) << "no results in callback";
+    ASSERT_NE(maybeResults.value().sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    ASSERT_EQ(getCallback()->getSharedMemoryFileCount(), 1);
+    status = getClient()->returnSharedMemory(getCallbackClient(), sharedMemoryId);
+    ASSERT_FALSE(status.isOk()) << "returning a shared memory file twice must fail";
+}
+
+TEST_F(DefaultVehicleHalTest, testSubscribeMaxSharedMemoryFileCountIsLimited) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = GLOBAL_ON_CHANGE_PROP,
+            },
+    };
+    auto status = getClient()->subscribe(getCallbackClient(), options,
+                                         /*maxSharedMemoryFileCount=*/INT32_MAX);
+    ASSERT_TRUE(status.isOk()) << "subscribe failed: " << status.getMessage();
+
+    VehiclePropValue testValue{
+            .prop = GLOBAL_ON_CHANGE_PROP,
+            .value.int32Values = std::vector<int32_t>(4096, 1),
+    };
+    for (size_t i = 0; i < SharedMemoryPool::MAX_IN_USE_COUNT_LIMIT; i++) {
+        getHardware()->sendOnPropertyChangeEvent({testValue});
+
+        auto maybeResults = getCallback()->nextOnPropertyEventResults();
+        ASSERT_TRUE(maybeResults.has_value()) << "no results in callback";
+        ASSERT_NE(maybeResults.value().sharedMemoryId, IVehicle::INVALID_MEMORY_ID)
+                << "expect a pooled shared memory file for event: " << i;
+    }
+    getHardware()->sendOnPropertyChangeEvent({testValue});
+
+    auto maybeResults = getCallback()->nextOnPropertyEventResults();
+    ASSERT_TRUE(maybeResults.has_value()) << "no results in callback";
+    ASSERT_EQ(maybeResults.value().sharedMemoryId, IVehicle::INVALID_MEMORY_ID)
+            << "expect no more pooled shared memory files than the limit";
+}
+
 TEST_F(DefaultVehicleHalTest, testHeartbeatEvent) {
     std::vector<SubscribeOptions> options = {{
             .propId = toInt(VehicleProperty::VHAL_HEARTBEAT),
@@ -57,10 +57,19 @@ ScopedAStatus MockVehicleCallback::onSetValues(const SetValueResults& results) {
 
 ScopedAStatus MockVehicleCallback::onPropertyEvent(const VehiclePropValues& results,
                                                    int32_t sharedMemoryFileCount) {
-    std::scoped_lock<std::mutex> lockGuard(mLock);
-
-    mSharedMemoryFileCount = sharedMemoryFileCount;
-    return storeResults(results, &mOnPropertyEventResults);
+    std::function<void()> hook;
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+
+        mSharedMemoryFileCount = sharedMemoryFileCount;
+        storeResults(results, &mOnPropertyEventResults);
+        mOnPropertyEventResults.back().sharedMemoryId = results.sharedMemoryId;
+        hook = mOnPropertyEventHook;
+    }
+    if (hook) {
+        hook();
+    }
+    return ScopedAStatus::ok();
 }
 
 ScopedAStatus MockVehicleCallback::onPropertySetError(const VehiclePropErrors&) {
@@ -87,6 +96,16 @@ size_t MockVehicleCallback::countOnPropertyEventResults() {
     return mOnPropertyEventResults.size();
 }
 
+int32_t MockVehicleCallback::getSharedMemoryFileCount() {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    return mSharedMemoryFileCount;
+}
+
+void MockVehicleCallback::setOnPropertyEventHook(std::function<void()> hook) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    mOnPropertyEventHook = std::move(hook);
+}
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
@@ -22,6 +22,7 @@
 #include <aidl/android/hardware/automotive/vehicle/BnVehicleCallback.h>
 #include <android-base/thread_annotations.h>
 
+#include <functional>
 #include <list>
 #include <mutex>
 #include <optional>
@@ -63,6 +64,10 @@ class MockVehicleCallback final
     std::optional<aidl::android::hardware::automotive::vehicle::VehiclePropValues>
     nextOnPropertyEventResults();
     size_t countOnPropertyEventResults();
+    // Gets the shared memory file count passed to the last onPropertyEvent call.
+    int32_t getSharedMemoryFileCount();
+    // Sets a function called at the end of each onPropertyEvent call.
+    void setOnPropertyEventHook(std::function<void()> hook);
 
   private:
     std::mutex mLock;
@@ -72,7 +77,8 @@ class MockVehicleCallback final
             GUARDED_BY(mLock);
     std::list<aidl::android::hardware::automotive::vehicle::VehiclePropValues>
             mOnPropertyEventResults GUARDED_BY(mLock);
-    int32_t mSharedMemoryFileCount GUARDED_BY(mLock);
+    int32_t mSharedMemoryFileCount GUARDED_BY(mLock) = 0;
+    std::function<void()> mOnPropertyEventHook GUARDED_BY(mLock);
 };
 
 }  // namespace vehicle
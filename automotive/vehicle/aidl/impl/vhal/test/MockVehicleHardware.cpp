@@ -130,6 +130,13 @@ void MockVehicleHardware::registerOnPropertyChangeEvent(
     mPropertyChangeCallback = std::move(callback);
 }
 
+void MockVehicleHardware::sendOnPropertyChangeEvent(const std::vector<VehiclePropValue>& values) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    if (mPropertyChangeCallback != nullptr) {
+        (*mPropertyChangeCallback)(values);
+    }
+}
+
 void MockVehicleHardware::registerOnPropertySetErrorEvent(
         std::unique_ptr<const PropertySetErrorCallback>) {
     // TODO(b/200737967): mock this.
@@ -85,6 +85,10 @@ class MockVehicleHardware final : public IVehicleHardware {
                    aidl::android::hardware::automotive::vehicle::StatusCode status);
     void setSleepTime(int64_t timeInNano);
     void setDumpResult(DumpResult result);
+    // Sends the values through the registered property change callback.
+    void sendOnPropertyChangeEvent(
+            const std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&
+                    values);
 
   private:
     mutable std::mutex mLock;
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedMemoryPool.h"
+
+#include <aidl/android/hardware/automotive/vehicle/IVehicle.h>
+#include <android/binder_parcel.h>
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
+using ::aidl::android::hardware::automotive::vehicle::StatusCode;
+using ::ndk::ScopedAParcel;
+
+class SharedMemoryPoolTest : public testing::Test {
+  protected:
+    ScopedAParcel createParcel(size_t int32Count) {
+        ScopedAParcel parcel(AParcel_create());
+        for (size_t i = 0; i < int32Count; i++) {
+            AParcel_writeInt32(parcel.get(), static_cast<int32_t>(i));
+        }
+        return parcel;
+    }
+};
+
+TEST_F(SharedMemoryPoolTest, testGetSizeClass) {
+    ASSERT_EQ(SharedMemoryPool::getSizeClass(1), SharedMemoryPool::MIN_SIZE_CLASS);
+    ASSERT_EQ(SharedMemoryPool::getSizeClass(4096), 4096u);
+    ASSERT_EQ(SharedMemoryPool::getSizeClass(4097), 8192u);
+    ASSERT_EQ(SharedMemoryPool::getSizeClass(100000), 131072u);
+}
+
+TEST_F(SharedMemoryPoolTest, testWriteReadOnlyForClient) {
+    SharedMemoryPool pool;
+    ScopedAParcel parcel = createParcel(2000);
+
+    auto result = pool.write(parcel.get());
+
+    ASSERT_TRUE(result.ok()) << result.error().message();
+    ASSERT_NE(result.value().memoryId, IVehicle::INVALID_MEMORY_ID);
+    ASSERT_EQ(result.value().inUseCount, 1);
+
+    int fd = result.value().fd.get();
+    ASSERT_EQ(mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0), MAP_FAILED)
+            << "client must not be able to map the shared memory as writable";
+    void* addr = mmap(nullptr, 8192, PROT_READ, MAP_SHARED, fd, 0);
+    ASSERT_NE(addr, MAP_FAILED);
+    ASSERT_EQ(reinterpret_cast<const int32_t*>(addr)[1], 1);
+    munmap(addr, 8192);
+}
+
+TEST_F(SharedMemoryPoolTest, testReturnMemoryReused) {
+    SharedMemoryPool pool;
+    ScopedAParcel parcel = createParcel(2000);
+
+    auto result = pool.write(parcel.get());
+    ASSERT_TRUE(result.ok()) << result.error().message();
+    ASSERT_TRUE(pool.returnMemory(result.value().memoryId).ok());
+
+    // Same size class, must reuse the returned memory.
+    ScopedAParcel otherParcel = createParcel(1500);
+    auto otherResult = pool.write(otherParcel.get());
+    ASSERT_TRUE(otherResult.ok()) << otherResult.error().message();
+
+    SharedMemoryPool::Stats stats = pool.getStats();
+    ASSERT_EQ(stats.hitCount, 1u);
+    ASSERT_EQ(stats.missCount, 1u);
+    ASSERT_EQ(stats.inUseCount, 1u);
+    ASSERT_EQ(stats.freeCount, 0u);
+    ASSERT_NE(result.value().memoryId, otherResult.value().memoryId);
+}
+
+TEST_F(SharedMemoryPoolTest, testReturnMemoryInvalidId) {
+    SharedMemoryPool pool;
+
+    auto result = pool.returnMemory(1);
+
+    ASSERT_FALSE(result.ok());
+    ASSERT_EQ(result.error().code(), StatusCode::INVALID_ARG);
+}
+
+TEST_F(SharedMemoryPoolTest, testReturnMemoryTwice) {
+    SharedMemoryPool pool;
+    ScopedAParcel parcel = createParcel(2000);
+    auto result = pool.write(parcel.get());
+    ASSERT_TRUE(result.ok()) << result.error().message();
+
+    ASSERT_TRUE(pool.returnMemory(result.value().memoryId).ok());
+    ASSERT_FALSE(pool.returnMemory(result.value().memoryId).ok());
+}
+
+TEST_F(SharedMemoryPoolTest, testWriteTooManyInUse) {
+    SharedMemoryPool pool(/*maxInUseCount=*/2);
+    ScopedAParcel parcel = createParcel(2000);
+
+    ASSERT_TRUE(pool.write(parcel.get()).ok());
+    ASSERT_TRUE(pool.write(parcel.get()).ok());
+    ASSERT_FALSE(pool.write(parcel.get()).ok());
+
+    pool.setMaxInUseCount(3);
+
+    ASSERT_TRUE(pool.write(parcel.get()).ok());
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
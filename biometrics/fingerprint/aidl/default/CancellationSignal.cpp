@@ -29,7 +29,7 @@ ndk::ScopedAStatus CancellationSignal::cancel() {
     return ndk::ScopedAStatus::ok();
 }
 
-bool shouldCancel(const std::future<void>& f) {
+bool shouldCancel(const std::shared_future<void>& f) {
     CHECK(f.valid());
     return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
 }
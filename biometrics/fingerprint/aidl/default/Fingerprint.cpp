@@ -16,6 +16,8 @@
 
 #include "Fingerprint.h"
 
+#include <android-base/file.h>
+
 #include "Session.h"
 
 namespace aidl::android::hardware::biometrics::fingerprint {
@@ -69,4 +71,9 @@ ndk::ScopedAStatus Fingerprint::createSession(int32_t sensorId, int32_t userId,
     return ndk::ScopedAStatus::ok();
 }
 
+binder_status_t Fingerprint::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    ::android::base::WriteStringToFd(mWorker.dump(), fd);
+    return STATUS_OK;
+}
+
 }  // namespace aidl::android::hardware::biometrics::fingerprint
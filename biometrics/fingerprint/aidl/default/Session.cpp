@@ -70,7 +70,7 @@ ndk::ScopedAStatus Session::generateChallenge() {
         enterStateOrCrash(SessionState::GENERATING_CHALLENGE);
         mEngine->generateChallengeImpl(mCb.get());
         enterIdling();
-    }));
+    }), "generateChallenge", WorkerThread::Priority::NORMAL);
 
     return ndk::ScopedAStatus::ok();
 }
@@ -83,7 +83,7 @@ ndk::ScopedAStatus Session::revokeChallenge(int64_t challenge) {
         enterStateOrCrash(SessionState::REVOKING_CHALLENGE);
         mEngine->revokeChallengeImpl(mCb.get(), challenge);
         enterIdling();
-    }));
+    }), "revokeChallenge", WorkerThread::Priority::NORMAL);
 
     return ndk::ScopedAStatus::ok();
 }
@@ -94,9 +94,9 @@ ndk::ScopedAStatus Session::enroll(const keymaster::HardwareAuthToken& hat,
     scheduleStateOrCrash(SessionState::ENROLLING);
 
     std::promise<void> cancellationPromise;
-    auto cancFuture = cancellationPromise.get_future();
+    auto cancFuture = cancellationPromise.get_future().share();
 
-    mWorker->schedule(Callable::from([this, hat, cancFuture = std::move(cancFuture)] {
+    mWorker->schedule(Callable::from([this, hat, cancFuture] {
         enterStateOrCrash(SessionState::ENROLLING);
         if (shouldCancel(cancFuture)) {
             mCb->onError(Error::CANCELED, 0 /* vendorCode */);
@@ -104,7 +104,7 @@ ndk::ScopedAStatus Session::enroll(const keymaster::HardwareAuthToken& hat,
             mEngine->enrollImpl(mCb.get(), hat);
         }
         enterIdling();
-    }));
+    }), "enroll", WorkerThread::Priority::NORMAL, cancFuture);
 
     *out = SharedRefBase::make<CancellationSignal>(std::move(cancellationPromise));
     return ndk::ScopedAStatus::ok();
@@ -116,9 +116,9 @@ ndk::ScopedAStatus Session::authenticate(int64_t operationId,
     scheduleStateOrCrash(SessionState::AUTHENTICATING);
 
     std::promise<void> cancPromise;
-    auto cancFuture = cancPromise.get_future();
+    auto cancFuture = cancPromise.get_future().share();
 
-    mWorker->schedule(Callable::from([this, operationId, cancFuture = std::move(cancFuture)] {
+    mWorker->schedule(Callable::from([this, operationId, cancFuture] {
         enterStateOrCrash(SessionState::AUTHENTICATING);
         if (shouldCancel(cancFuture)) {
             mCb->onError(Error::CANCELED, 0 /* vendorCode */);
@@ -126,7 +126,7 @@ ndk::ScopedAStatus Session::authenticate(int64_t operationId,
             mEngine->authenticateImpl(mCb.get(), operationId);
         }
         enterIdling();
-    }));
+    }), "authenticate", WorkerThread::Priority::HIGH, cancFuture);
 
     *out = SharedRefBase::make<CancellationSignal>(std::move(cancPromise));
     return ndk::ScopedAStatus::ok();
@@ -137,9 +137,9 @@ ndk::ScopedAStatus Session::detectInteraction(std::shared_ptr<common::ICancellat
     scheduleStateOrCrash(SessionState::DETECTING_INTERACTION);
 
     std::promise<void> cancellationPromise;
-    auto cancFuture = cancellationPromise.get_future();
+    auto cancFuture = cancellationPromise.get_future().share();
 
-    mWorker->schedule(Callable::from([this, cancFuture = std::move(cancFuture)] {
+    mWorker->schedule(Callable::from([this, cancFuture] {
         enterStateOrCrash(SessionState::DETECTING_INTERACTION);
         if (shouldCancel(cancFuture)) {
             mCb->onError(Error::CANCELED, 0 /* vendorCode */);
@@ -147,7 +147,7 @@ ndk::ScopedAStatus Session::detectInteraction(std::shared_ptr<common::ICancellat
             mEngine->detectInteractionImpl(mCb.get());
         }
         enterIdling();
-    }));
+    }), "detectInteraction", WorkerThread::Priority::HIGH, cancFuture);
 
     *out = SharedRefBase::make<CancellationSignal>(std::move(cancellationPromise));
     return ndk::ScopedAStatus::ok();
@@ -161,7 +161,7 @@ ndk::ScopedAStatus Session::enumerateEnrollments() {
         enterStateOrCrash(SessionState::ENUMERATING_ENROLLMENTS);
         mEngine->enumerateEnrollmentsImpl(mCb.get());
         enterIdling();
-    }));
+    }), "enumerateEnrollments", WorkerThread::Priority::NORMAL);
 
     return ndk::ScopedAStatus::ok();
 }
@@ -174,7 +174,7 @@ ndk::ScopedAStatus Session::removeEnrollments(const std::vector<int32_t>& enroll
         enterStateOrCrash(SessionState::REMOVING_ENROLLMENTS);
         mEngine->removeEnrollmentsImpl(mCb.get(), enrollmentIds);
         enterIdling();
-    }));
+    }), "removeEnrollments", WorkerThread::Priority::NORMAL);
 
     return ndk::ScopedAStatus::ok();
 }
@@ -187,7 +187,7 @@ ndk::ScopedAStatus Session::getAuthenticatorId() {
         enterStateOrCrash(SessionState::GETTING_AUTHENTICATOR_ID);
         mEngine->getAuthenticatorIdImpl(mCb.get());
         enterIdling();
-    }));
+    }), "getAuthenticatorId", WorkerThread::Priority::NORMAL);
 
     return ndk::ScopedAStatus::ok();
 }
@@ -200,7 +200,7 @@ ndk::ScopedAStatus Session::invalidateAuthenticatorId() {
         enterStateOrCrash(SessionState::INVALIDATING_AUTHENTICATOR_ID);
         mEngine->invalidateAuthenticatorIdImpl(mCb.get());
         enterIdling();
-    }));
+    }), "invalidateAuthenticatorId", WorkerThread::Priority::NORMAL);
 
     return ndk::ScopedAStatus::ok();
 }
@@ -213,7 +213,7 @@ ndk::ScopedAStatus Session::resetLockout(const keymaster::HardwareAuthToken& hat
         enterStateOrCrash(SessionState::RESETTING_LOCKOUT);
         mEngine->resetLockoutImpl(mCb.get(), hat);
         enterIdling();
-    }));
+    }), "resetLockout", WorkerThread::Priority::NORMAL);
 
     return ndk::ScopedAStatus::ok();
 }
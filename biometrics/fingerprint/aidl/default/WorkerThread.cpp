@@ -16,6 +16,10 @@
 
 #include "WorkerThread.h"
 
+#include <algorithm>
+
+#include <android-base/stringprintf.h>
+
 namespace aidl::android::hardware::biometrics::fingerprint {
 
 // It's important that mThread is initialized after everything else because it runs a member
@@ -23,6 +27,7 @@ namespace aidl::android::hardware::biometrics::fingerprint {
 WorkerThread::WorkerThread(size_t maxQueueSize)
     : mMaxSize(maxQueueSize),
       mIsDestructing(false),
+      mHighPriorityQueue(),
       mQueue(),
       mQueueMutex(),
       mQueueCond(),
@@ -37,31 +42,84 @@ WorkerThread::~WorkerThread() {
 }
 
 bool WorkerThread::schedule(std::unique_ptr<Callable> task) {
+    return schedule(std::move(task), "task", Priority::NORMAL);
+}
+
+bool WorkerThread::schedule(std::unique_ptr<Callable> task, const char* operation,
+                            Priority priority, std::shared_future<void> cancellation) {
     if (mIsDestructing) {
         return false;
     }
 
     std::unique_lock<std::mutex> lock(mQueueMutex);
-    if (mQueue.size() >= mMaxSize) {
+    if (mHighPriorityQueue.size() + mQueue.size() >= mMaxSize) {
         return false;
     }
-    mQueue.push_back(std::move(task));
+    auto& queue = priority == Priority::HIGH ? mHighPriorityQueue : mQueue;
+    queue.push_back(Task{std::move(task), operation, std::move(cancellation),
+                         std::chrono::steady_clock::now()});
     lock.unlock();
     mQueueCond.notify_one();
     return true;
 }
 
+std::string WorkerThread::dump() {
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    std::string result = ::android::base::StringPrintf(
+            "WorkerThread: %zu high priority and %zu normal tasks queued\n",
+            mHighPriorityQueue.size(), mQueue.size());
+    for (const auto& [operation, stats] : mStats) {
+        ::android::base::StringAppendF(
+                &result, "  %s: %llu tasks, %llu cancelled, wait avg %lld us, max %lld us\n",
+                operation.c_str(), static_cast<unsigned long long>(stats.count),
+                static_cast<unsigned long long>(stats.cancelled),
+                static_cast<long long>(stats.totalWait.count() / stats.count),
+                static_cast<long long>(stats.maxWait.count()));
+    }
+    return result;
+}
+
+WorkerThread::Task WorkerThread::popNextTaskLocked() {
+    auto isCancelled = [](const Task& task) {
+        return task.cancellation.valid() &&
+               task.cancellation.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    auto* queue = &mHighPriorityQueue;
+    auto it = std::find_if(queue->begin(), queue->end(), isCancelled);
+    if (it == queue->end()) {
+        queue = &mQueue;
+        it = std::find_if(queue->begin(), queue->end(), isCancelled);
+    }
+    const bool cancelled = it != queue->end();
+    if (!cancelled) {
+        queue = mHighPriorityQueue.empty() ? &mQueue : &mHighPriorityQueue;
+        it = queue->begin();
+    }
+    Task task = std::move(*it);
+    queue->erase(it);
+
+    const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - task.scheduledTime);
+    OperationStats& stats = mStats[task.operation];
+    stats.count++;
+    if (cancelled) stats.cancelled++;
+    stats.totalWait += wait;
+    stats.maxWait = std::max(stats.maxWait, wait);
+    return task;
+}
+
 void WorkerThread::threadFunc() {
     while (!mIsDestructing) {
         std::unique_lock<std::mutex> lock(mQueueMutex);
-        mQueueCond.wait(lock, [this] { return !mQueue.empty() || mIsDestructing; });
+        mQueueCond.wait(lock, [this] {
+            return !mHighPriorityQueue.empty() || !mQueue.empty() || mIsDestructing;
+        });
         if (mIsDestructing) {
             return;
         }
-        std::unique_ptr<Callable> task = std::move(mQueue.front());
-        mQueue.pop_front();
+        Task task = popNextTaskLocked();
         lock.unlock();
-        (*task)();
+        (*task.callable)();
     }
 }
 
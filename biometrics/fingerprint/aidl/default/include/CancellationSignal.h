@@ -37,6 +37,6 @@ class CancellationSignal : public common::BnCancellationSignal {
 
 // Returns whether the given cancellation future is ready, i.e. whether the operation corresponding
 // to this future should be cancelled.
-bool shouldCancel(const std::future<void>& cancellationFuture);
+bool shouldCancel(const std::shared_future<void>& cancellationFuture);
 
 }  // namespace aidl::android::hardware::biometrics::fingerprint
@@ -16,9 +16,13 @@
 
 #pragma once
 
+#include <chrono>
+#include <future>
+#include <map>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <string>
 #include <thread>
 
 #include "Callable.h"
@@ -27,8 +31,18 @@ namespace aidl::android::hardware::biometrics::fingerprint {
 
 // A class that encapsulates a worker thread and a task queue, and provides a convenient interface
 // for a Session to schedule its tasks for asynchronous execution.
+//
+// Tasks run one at a time. Latency-critical tasks go to a high priority lane that is always
+// drained first, and a queued task that has been cancelled runs before any other, so that its
+// client hears about the cancellation without waiting for the tasks queued before it.
 class WorkerThread final {
   public:
+    enum class Priority {
+        NORMAL,
+        // For the operations the user waits on, e.g. authentication and pointer events.
+        HIGH,
+    };
+
     // Internally creates a queue that cannot exceed maxQueueSize elements and a new thread that
     // polls the queue for tasks until this instance is destructed.
     explicit WorkerThread(size_t maxQueueSize);
@@ -54,7 +68,34 @@ class WorkerThread final {
     // so heap-allocated tasks that share a common interface (Callable) were chosen instead.
     bool schedule(std::unique_ptr<Callable> task);
 
+    // Same as above, for a task of the given priority. |operation| names the task in dump() and
+    // must outlive this instance, e.g. a string literal. If |cancellation| becomes ready while
+    // the task is queued, the task runs next; it is still up to the task to check it.
+    bool schedule(std::unique_ptr<Callable> task, const char* operation, Priority priority,
+                  std::shared_future<void> cancellation = {});
+
+    // Returns how long the tasks of each operation waited in the queue.
+    std::string dump();
+
   private:
+    struct Task {
+        std::unique_ptr<Callable> callable;
+        const char* operation;
+        std::shared_future<void> cancellation;
+        std::chrono::steady_clock::time_point scheduledTime;
+    };
+
+    struct OperationStats {
+        uint64_t count = 0;
+        // Tasks that ran ahead of their turn because they were cancelled.
+        uint64_t cancelled = 0;
+        std::chrono::microseconds totalWait{0};
+        std::chrono::microseconds maxWait{0};
+    };
+
+    // Removes and returns the task to run next. mQueueMutex must be held.
+    Task popNextTaskLocked();
+
     // The function that runs on the internal thread. Sequentially runs the available tasks from
     // the queue. If the queue is empty, waits until a new task is added. If the worker is being
     // destructed, finishes its current task and gracefully exits.
@@ -67,11 +108,15 @@ class WorkerThread final {
     // tells schedule to avoid doing any work.
     std::atomic<bool> mIsDestructing;
 
-    // Queue that's guarded by mQueueMutex and mQueueCond.
-    std::deque<std::unique_ptr<Callable>> mQueue;
+    // Queues that are guarded by mQueueMutex and mQueueCond. mMaxSize bounds their total size.
+    std::deque<Task> mHighPriorityQueue;
+    std::deque<Task> mQueue;
     std::mutex mQueueMutex;
     std::condition_variable mQueueCond;
 
+    // Guarded by mQueueMutex. Keyed by operation name.
+    std::map<std::string, OperationStats> mStats;
+
     // The internal thread that works on the tasks from the queue.
     std::thread mThread;
 };
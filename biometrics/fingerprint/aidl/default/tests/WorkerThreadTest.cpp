@@ -27,6 +27,7 @@ namespace {
 
 using aidl::android::hardware::biometrics::fingerprint::Callable;
 using aidl::android::hardware::biometrics::fingerprint::WorkerThread;
+using Priority = WorkerThread::Priority;
 using namespace std::chrono_literals;
 
 TEST(WorkerThreadTest, ScheduleReturnsTrueWhenQueueHasSpace) {
@@ -100,6 +101,97 @@ TEST(WorkerThreadTest, TasksExecuteInOrder) {
     EXPECT_TRUE(std::is_sorted(results.begin(), results.end()));
 }
 
+// Schedules a task that blocks the worker until the returned promise is set.
+std::promise<void> blockWorker(WorkerThread* worker) {
+    std::promise<void> started;
+    std::promise<void> unblock;
+    auto startedFuture = started.get_future();
+    EXPECT_TRUE(worker->schedule(Callable::from(
+            [started = std::move(started), unblocked = unblock.get_future()]() mutable {
+                started.set_value();
+                unblocked.wait();
+            })));
+    startedFuture.wait();
+    return unblock;
+}
+
+TEST(WorkerThreadTest, HighPriorityTasksExecuteFirst) {
+    WorkerThread worker(10 /*maxQueueSize*/);
+    std::promise<void> unblock = blockWorker(&worker);
+
+    std::mutex mut;
+    std::vector<int> results;
+    auto record = [&mut, &results](int i) {
+        return Callable::from([&mut, &results, i] {
+            auto lock = std::lock_guard(mut);
+            results.push_back(i);
+        });
+    };
+    ASSERT_TRUE(worker.schedule(record(2), "normal", Priority::NORMAL));
+    ASSERT_TRUE(worker.schedule(record(3), "normal", Priority::NORMAL));
+    ASSERT_TRUE(worker.schedule(record(0), "high", Priority::HIGH));
+    ASSERT_TRUE(worker.schedule(record(1), "high", Priority::HIGH));
+
+    std::promise<void> finished;
+    auto finishedFuture = finished.get_future();
+    ASSERT_TRUE(worker.schedule(Callable::from([finished = std::move(finished)]() mutable {
+                                    finished.set_value();
+                                }),
+                                "last", Priority::NORMAL));
+    unblock.set_value();
+    finishedFuture.wait();
+
+    auto lock = std::lock_guard(mut);
+    EXPECT_EQ(results, (std::vector<int>{0, 1, 2, 3}));
+}
+
+TEST(WorkerThreadTest, QueueSizeIncludesAllPriorities) {
+    WorkerThread worker(2 /*maxQueueSize*/);
+    std::promise<void> unblock = blockWorker(&worker);
+
+    ASSERT_TRUE(worker.schedule(Callable::from([] {}), "normal", Priority::NORMAL));
+    ASSERT_TRUE(worker.schedule(Callable::from([] {}), "high", Priority::HIGH));
+    EXPECT_FALSE(worker.schedule(Callable::from([] {}), "high", Priority::HIGH));
+    unblock.set_value();
+}
+
+TEST(WorkerThreadTest, CancelledTaskExecutesNext) {
+    WorkerThread worker(10 /*maxQueueSize*/);
+    std::promise<void> unblock = blockWorker(&worker);
+
+    std::mutex mut;
+    std::vector<int> results;
+    auto record = [&mut, &results](int i) {
+        return Callable::from([&mut, &results, i] {
+            auto lock = std::lock_guard(mut);
+            results.push_back(i);
+        });
+    };
+    std::promise<void> cancellation;
+    ASSERT_TRUE(worker.schedule(record(1), "high", Priority::HIGH));
+    ASSERT_TRUE(worker.schedule(record(2), "normal", Priority::NORMAL));
+    ASSERT_TRUE(worker.schedule(record(0), "cancellable", Priority::NORMAL,
+                                cancellation.get_future().share()));
+    cancellation.set_value();
+
+    std::promise<void> finished;
+    auto finishedFuture = finished.get_future();
+    ASSERT_TRUE(worker.schedule(Callable::from([finished = std::move(finished)]() mutable {
+                                    finished.set_value();
+                                }),
+                                "last", Priority::NORMAL));
+    unblock.set_value();
+    finishedFuture.wait();
+
+    {
+        auto lock = std::lock_guard(mut);
+        EXPECT_EQ(results, (std::vector<int>{0, 1, 2}));
+    }
+    const std::string dump = worker.dump();
+    EXPECT_NE(dump.find("cancellable: 1 tasks, 1 cancelled"), std::string::npos) << dump;
+    EXPECT_NE(dump.find("normal: 1 tasks, 0 cancelled"), std::string::npos) << dump;
+}
+
 TEST(WorkerThreadTest, ExecutionStopsAfterWorkerIsDestroyed) {
     std::promise<void> promise1;
     std::promise<void> promise2;
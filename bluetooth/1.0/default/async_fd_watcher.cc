@@ -27,24 +27,56 @@
 #include <thread>
 #include <vector>
 #include "fcntl.h"
-#include "sys/select.h"
+#include "sys/epoll.h"
+#include "sys/timerfd.h"
 #include "unistd.h"
 
 static const int INVALID_FD = -1;
 
 static const int BT_RT_PRIORITY = 1;
 
+// Enough for every file descriptor of the HCI, MCT and vendor interfaces to
+// be handled in a single wakeup.
+static const int MAX_EPOLL_EVENTS = 8;
+
+static int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
 namespace android {
 namespace hardware {
 namespace bluetooth {
 namespace async {
 
 int AsyncFdWatcher::WatchFdForNonBlockingReads(
-    int file_descriptor, const ReadCallback& on_read_fd_ready_callback) {
+    int file_descriptor, const ReadCallback& on_read_fd_ready_callback,
+    bool edge_triggered) {
   // Add file descriptor and callback
   {
     std::unique_lock<std::mutex> guard(internal_mutex_);
-    watched_fds_[file_descriptor] = on_read_fd_ready_callback;
+    if (epoll_fd_ == INVALID_FD && openFds()) {
+      ALOGE("%s unable to set up epoll: %s", __func__, strerror(errno));
+      closeFds();
+      return -1;
+    }
+
+    std::unique_ptr<WatchedFd>& watched = watched_fds_[file_descriptor];
+    const bool added = watched == nullptr;
+    if (added) watched.reset(new WatchedFd{file_descriptor, nullptr});
+    watched->callback = on_read_fd_ready_callback;
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN | (edge_triggered ? EPOLLET : 0);
+    event.data.ptr = watched.get();
+    if (epoll_ctl(epoll_fd_, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                  file_descriptor, &event)) {
+      ALOGE("%s unable to watch fd %d: %s", __func__, file_descriptor,
+            strerror(errno));
+      if (added) watched_fds_.erase(file_descriptor);
+      return -1;
+    }
   }
 
   // Start the thread if not started yet
@@ -55,32 +87,73 @@ int AsyncFdWatcher::ConfigureTimeout(
     const std::chrono::milliseconds timeout,
     const TimeoutCallback& on_timeout_callback) {
   // Add timeout and callback
+  std::unique_lock<std::mutex> guard(timeout_mutex_);
+  timeout_cb_ = on_timeout_callback;
+  timeout_ms_ = timeout;
+  last_activity_ns_ = NowNs();
+
+  // Without a timer yet, it is armed once the first file descriptor is added.
+  if (timer_.fd == INVALID_FD) return 0;
+  return armTimer(timeout_ms_);
+}
+
+void AsyncFdWatcher::StopWatchingFileDescriptors() { stopThread(); }
+
+AsyncFdWatcher::LatencyHistogram AsyncFdWatcher::GetLatencyHistogram() const {
+  LatencyHistogram histogram;
+  for (size_t i = 0; i < kLatencyBuckets; i++) {
+    histogram[i] = latency_histogram_[i].load(std::memory_order_relaxed);
+  }
+  return histogram;
+}
+
+AsyncFdWatcher::~AsyncFdWatcher() {}
+
+// Call with internal_mutex_ held, and closeFds() when it fails.
+int AsyncFdWatcher::openFds() {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ == INVALID_FD) return -1;
+
+  // Set up the communication channel
+  int pipe_fds[2];
+  if (pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC)) return -1;
+  notification_.fd = pipe_fds[0];
+  notification_write_fd_ = pipe_fds[1];
+
   {
     std::unique_lock<std::mutex> guard(timeout_mutex_);
-    timeout_cb_ = on_timeout_callback;
-    timeout_ms_ = timeout;
+    timer_.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_.fd == INVALID_FD) return -1;
+    last_activity_ns_ = NowNs();
+    if (armTimer(timeout_ms_)) return -1;
   }
 
-  notifyThread();
+  for (WatchedFd* watched : {&notification_, &timer_}) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = watched;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, watched->fd, &event)) return -1;
+  }
   return 0;
 }
 
-void AsyncFdWatcher::StopWatchingFileDescriptors() { stopThread(); }
+// Call with internal_mutex_ held and the thread stopped.
+void AsyncFdWatcher::closeFds() {
+  for (int* fd : {&epoll_fd_, &notification_.fd, &notification_write_fd_}) {
+    if (*fd != INVALID_FD) close(*fd);
+    *fd = INVALID_FD;
+  }
 
-AsyncFdWatcher::~AsyncFdWatcher() {}
+  std::unique_lock<std::mutex> guard(timeout_mutex_);
+  if (timer_.fd != INVALID_FD) close(timer_.fd);
+  timer_.fd = INVALID_FD;
+}
 
 // Make sure to call this with at least one file descriptor ready to be
 // watched upon or the thread routine will return immediately
 int AsyncFdWatcher::tryStartThread() {
   if (std::atomic_exchange(&running_, true)) return 0;
 
-  // Set up the communication channel
-  int pipe_fds[2];
-  if (pipe2(pipe_fds, O_NONBLOCK)) return -1;
-
-  notification_listen_fd_ = pipe_fds[0];
-  notification_write_fd_ = pipe_fds[1];
-
   thread_ = std::thread([this]() { ThreadRoutine(); });
   if (!thread_.joinable()) return -1;
 
@@ -95,18 +168,16 @@ int AsyncFdWatcher::stopThread() {
     thread_.join();
   }
 
-  {
-    std::unique_lock<std::mutex> guard(internal_mutex_);
-    watched_fds_.clear();
-  }
-
   {
     std::unique_lock<std::mutex> guard(timeout_mutex_);
     timeout_cb_ = nullptr;
   }
 
-  close(notification_listen_fd_);
-  close(notification_write_fd_);
+  {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    watched_fds_.clear();
+    closeFds();
+  }
 
   return 0;
 }
@@ -119,6 +190,42 @@ int AsyncFdWatcher::notifyThread() {
   return 0;
 }
 
+// Call with timeout_mutex_ held.  A zero delay disarms the timer.
+int AsyncFdWatcher::armTimer(std::chrono::nanoseconds delay) {
+  struct itimerspec spec = {};
+  if (delay > std::chrono::nanoseconds(0)) {
+    spec.it_value.tv_sec = delay.count() / 1000000000;
+    spec.it_value.tv_nsec = delay.count() % 1000000000;
+  }
+  return timerfd_settime(timer_.fd, 0, &spec, nullptr);
+}
+
+void AsyncFdWatcher::onTimerExpired() {
+  uint64_t expirations;
+  TEMP_FAILURE_RETRY(read(timer_.fd, &expirations, sizeof(expirations)));
+
+  // Allow the timeout callback to modify the timeout.
+  TimeoutCallback saved_cb;
+  {
+    std::unique_lock<std::mutex> guard(timeout_mutex_);
+    if (timeout_ms_ <= std::chrono::milliseconds(0)) return;
+
+    // File descriptors that became ready since the timer was armed postpone
+    // the timeout, which saves re-arming the timer on every wakeup.
+    const int64_t now_ns = NowNs();
+    const std::chrono::nanoseconds idle(now_ns - last_activity_ns_);
+    if (idle < timeout_ms_) {
+      armTimer(timeout_ms_ - idle);
+      return;
+    }
+
+    saved_cb = timeout_cb_;
+    last_activity_ns_ = now_ns;
+    armTimer(timeout_ms_);
+  }
+  if (saved_cb != nullptr) saved_cb();
+}
+
 void AsyncFdWatcher::ThreadRoutine() {
   // Make watching thread RT.
   struct sched_param rt_params;
@@ -128,60 +235,49 @@ void AsyncFdWatcher::ThreadRoutine() {
           getpid(), gettid(), strerror(errno));
   }
 
+  struct epoll_event events[MAX_EPOLL_EVENTS];
   while (running_) {
-    fd_set read_fds;
-    FD_ZERO(&read_fds);
-    FD_SET(notification_listen_fd_, &read_fds);
-    int max_read_fd = INVALID_FD;
-    for (auto& it : watched_fds_) {
-      FD_SET(it.first, &read_fds);
-      max_read_fd = std::max(max_read_fd, it.first);
-    }
-
-    struct timeval timeout;
-    struct timeval* timeout_ptr = NULL;
-    if (timeout_ms_ > std::chrono::milliseconds(0)) {
-      timeout.tv_sec = timeout_ms_.count() / 1000;
-      timeout.tv_usec = (timeout_ms_.count() % 1000) * 1000;
-      timeout_ptr = &timeout;
-    }
-
     // Wait until there is data available to read on some FD.
-    int nfds = std::max(notification_listen_fd_, max_read_fd);
-    int retval = select(nfds + 1, &read_fds, NULL, NULL, timeout_ptr);
+    int count = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, -1);
 
     // There was some error.
-    if (retval < 0) continue;
-
-    // Timeout.
-    if (retval == 0) {
-      // Allow the timeout callback to modify the timeout.
-      TimeoutCallback saved_cb;
-      {
-        std::unique_lock<std::mutex> guard(timeout_mutex_);
-        if (timeout_ms_ > std::chrono::milliseconds(0)) saved_cb = timeout_cb_;
+    if (count < 0) continue;
+
+    const int64_t ready_ns = NowNs();
+    bool timer_expired = false;
+    int ready_fds = 0;
+    for (int i = 0; i < count; i++) {
+      WatchedFd* watched = static_cast<WatchedFd*>(events[i].data.ptr);
+      if (watched == &notification_) {
+        // Read data from the notification FD.
+        char buffer[16];
+        TEMP_FAILURE_RETRY(read(notification_.fd, buffer, sizeof(buffer)));
+      } else if (watched == &timer_) {
+        timer_expired = true;
+      } else {
+        events[ready_fds++] = events[i];
       }
-      if (saved_cb != nullptr) saved_cb();
-      continue;
-    }
-
-    // Read data from the notification FD.
-    if (FD_ISSET(notification_listen_fd_, &read_fds)) {
-      char buffer[] = {0};
-      TEMP_FAILURE_RETRY(read(notification_listen_fd_, buffer, 1));
-      continue;
     }
 
     // Invoke the data ready callbacks if appropriate.
-    {
+    if (ready_fds > 0) {
+      last_activity_ns_ = ready_ns;
+
       // Hold the mutex to make sure that the callbacks are still valid.
       std::unique_lock<std::mutex> guard(internal_mutex_);
-      for (auto& it : watched_fds_) {
-        if (FD_ISSET(it.first, &read_fds)) {
-          it.second(it.first);
+      for (int i = 0; i < ready_fds && running_; i++) {
+        WatchedFd* watched = static_cast<WatchedFd*>(events[i].data.ptr);
+        size_t bucket = 0;
+        for (int64_t us = (NowNs() - ready_ns) / 1000;
+             us > 0 && bucket < kLatencyBuckets - 1; us >>= 1) {
+          bucket++;
         }
+        latency_histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+        watched->callback(watched->fd);
       }
     }
+
+    if (timer_expired && running_) onTimerExpired();
   }
 }
 
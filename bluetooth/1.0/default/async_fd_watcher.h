@@ -16,7 +16,12 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -30,22 +35,45 @@ using TimeoutCallback = std::function<void(void)>;
 
 class AsyncFdWatcher {
  public:
+  // Bucket 0 of the latency histogram counts callbacks entered within a
+  // microsecond of epoll reporting their file descriptor, bucket i those
+  // entered within [2^(i-1), 2^i) microseconds and the last one all others.
+  static const size_t kLatencyBuckets = 16;
+  using LatencyHistogram = std::array<uint64_t, kLatencyBuckets>;
+
   AsyncFdWatcher() = default;
   ~AsyncFdWatcher();
 
+  // With edge_triggered set, the callback is only called again once more data
+  // arrives, so it must read until the file descriptor returns EAGAIN.
   int WatchFdForNonBlockingReads(int file_descriptor,
-                                 const ReadCallback& on_read_fd_ready_callback);
+                                 const ReadCallback& on_read_fd_ready_callback,
+                                 bool edge_triggered = false);
+  // The timeout callback is called after the watched file descriptors have
+  // been idle for the timeout, and again after every further timeout.
   int ConfigureTimeout(const std::chrono::milliseconds timeout,
                        const TimeoutCallback& on_timeout_callback);
   void StopWatchingFileDescriptors();
 
+  LatencyHistogram GetLatencyHistogram() const;
+
  private:
   AsyncFdWatcher(const AsyncFdWatcher&) = delete;
   AsyncFdWatcher& operator=(const AsyncFdWatcher&) = delete;
 
+  // The epoll data of every registered file descriptor points to its entry.
+  struct WatchedFd {
+    int fd;
+    ReadCallback callback;
+  };
+
+  int openFds();
+  void closeFds();
   int tryStartThread();
   int stopThread();
   int notifyThread();
+  int armTimer(std::chrono::nanoseconds delay);
+  void onTimerExpired();
   void ThreadRoutine();
 
   std::atomic_bool running_{false};
@@ -53,11 +81,20 @@ class AsyncFdWatcher {
   std::mutex internal_mutex_;
   std::mutex timeout_mutex_;
 
-  std::map<int, ReadCallback> watched_fds_;
-  int notification_listen_fd_;
-  int notification_write_fd_;
+  std::map<int, std::unique_ptr<WatchedFd>> watched_fds_;
+  int epoll_fd_{-1};
+  WatchedFd notification_{-1, nullptr};
+  int notification_write_fd_{-1};
+  // Guarded by both mutexes, so either of them is enough to use it.
+  WatchedFd timer_{-1, nullptr};
   TimeoutCallback timeout_cb_;
-  std::chrono::milliseconds timeout_ms_;
+  std::chrono::milliseconds timeout_ms_{0};
+  // Time of the last wakeup for a watched file descriptor, in steady clock
+  // nanoseconds.  The timer fires at the timeout after the last
+  // configuration, and is re-armed from here if anything happened since.
+  std::atomic<int64_t> last_activity_ns_{0};
+
+  std::array<std::atomic<uint64_t>, kLatencyBuckets> latency_histogram_{};
 };
 
 }  // namespace async
@@ -132,6 +132,14 @@ Return<void> BluetoothHci::sendScoData(const hidl_vec<uint8_t>& data) {
   return Void();
 }
 
+Return<void> BluetoothHci::debug(const hidl_handle& handle,
+                                 const hidl_vec<hidl_string>& /* options */) {
+  if (handle == nullptr || handle->numFds < 1) return Void();
+  VendorInterface* vendor_interface = VendorInterface::get();
+  if (vendor_interface != nullptr) vendor_interface->Dump(handle->data[0]);
+  return Void();
+}
+
 void BluetoothHci::sendDataToController(const uint8_t type,
                                         const hidl_vec<uint8_t>& data) {
   VendorInterface::get()->Send(type, data.data(), data.size());
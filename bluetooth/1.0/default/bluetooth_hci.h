@@ -29,6 +29,8 @@ namespace bluetooth {
 namespace V1_0 {
 namespace implementation {
 
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 
@@ -43,6 +45,8 @@ class BluetoothHci : public IBluetoothHci {
   Return<void> sendAclData(const hidl_vec<uint8_t>& data) override;
   Return<void> sendScoData(const hidl_vec<uint8_t>& data) override;
   Return<void> close() override;
+  Return<void> debug(const hidl_handle& handle,
+                     const hidl_vec<hidl_string>& options) override;
 
  private:
   void sendDataToController(const uint8_t type, const hidl_vec<uint8_t>& data);
@@ -18,50 +18,98 @@
 
 #define LOG_TAG "android.hardware.bluetooth-hci-h4"
 
+#include <algorithm>
+
 #include <errno.h>
 #include <fcntl.h>
 #include <log/log.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+namespace {
+
+// The largest packet is an ACL packet with a 16 bit payload length.
+const size_t kReadBufferSize = 1 + HCI_ACL_PREAMBLE_SIZE + 0xFFFF;
+
+// Packets coalesced into a single writev(), well below IOV_MAX.
+const size_t kMaxPacketsPerWrite = 32;
+
+}  // namespace
+
 namespace android {
 namespace hardware {
 namespace bluetooth {
 namespace hci {
 
+H4Protocol::H4Protocol(int fd, PacketReadCallback event_cb,
+                       PacketReadCallback acl_cb, PacketReadCallback sco_cb,
+                       PacketReadCallback iso_cb)
+    : uart_fd_(fd),
+      event_cb_(event_cb),
+      acl_cb_(acl_cb),
+      sco_cb_(sco_cb),
+      iso_cb_(iso_cb),
+      read_buffer_(kReadBufferSize) {}
+
 size_t H4Protocol::Send(uint8_t type, const uint8_t* data, size_t length) {
-  struct iovec iov_array[] = {{&type, sizeof(type)},
-                              {const_cast<uint8_t*>(data), length}};
-  struct iovec* iov = iov_array;
-  int iovcnt = sizeof(iov_array) / sizeof(iov_array[0]);
+  TxPacket packet = {type, data, length, 0, false};
+
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  tx_queue_.push_back(&packet);
+  UpdateQueueDepth(tx_queue_.size());
+
+  // Whoever finds nobody writing writes the queue, up to its own packet.
+  while (!packet.done) {
+    if (tx_writing_) {
+      tx_cv_.wait(lock);
+      continue;
+    }
+    tx_writing_ = true;
+    WriteQueuedPackets(lock);
+    tx_writing_ = false;
+    tx_cv_.notify_all();
+  }
+  return packet.written;
+}
+
+void H4Protocol::WriteQueuedPackets(std::unique_lock<std::mutex>& lock) {
+  // Each packet takes an iovec for its type and one for its data.
+  struct iovec iov_array[2 * kMaxPacketsPerWrite];
+  TxPacket* packets[kMaxPacketsPerWrite];
+  size_t packet_count = std::min(tx_queue_.size(), kMaxPacketsPerWrite);
   size_t total_bytes = 0;
-  for (int i = 0; i < iovcnt; i++) {
-    total_bytes += iov_array[i].iov_len;
+  for (size_t i = 0; i < packet_count; i++) {
+    packets[i] = tx_queue_.front();
+    tx_queue_.pop_front();
+    iov_array[2 * i] = {&packets[i]->type, sizeof(packets[i]->type)};
+    iov_array[2 * i + 1] = {const_cast<uint8_t*>(packets[i]->data),
+                            packets[i]->length};
+    total_bytes += sizeof(packets[i]->type) + packets[i]->length;
   }
+  UpdateQueueDepth(tx_queue_.size());
+  lock.unlock();
+
+  struct iovec* iov = iov_array;
+  int iovcnt = 2 * packet_count;
   size_t bytes_written = 0;
   size_t remaining_bytes = total_bytes;
 
   while (remaining_bytes > 0) {
     ssize_t ret = TEMP_FAILURE_RETRY(writev(uart_fd_, iov, iovcnt));
     if (ret == -1) {
-      if (errno == EAGAIN) continue;
+      if (errno == EAGAIN && WaitForWritable(uart_fd_)) continue;
       ALOGE("%s error writing to UART (%s)", __func__, strerror(errno));
       break;
     } else if (ret == 0) {
       // Nothing written
       ALOGE("%s zero bytes written - something went wrong...", __func__);
       break;
-    } else if (ret == remaining_bytes) {
-      // Everything written
-      bytes_written += ret;
-      break;
     }
 
+    tx_writes_++;
     bytes_written += ret;
     remaining_bytes -= ret;
-    ALOGW("%s: %d/%d bytes written - retrying remaining %d bytes", __func__,
-          static_cast<int>(bytes_written), static_cast<int>(total_bytes),
-          static_cast<int>(remaining_bytes));
+    if (remaining_bytes == 0) break;
 
     // Remove iovs which are written from the list
     while (ret >= iov->iov_len) {
@@ -75,60 +123,98 @@ size_t H4Protocol::Send(uint8_t type, const uint8_t* data, size_t length) {
       iov->iov_len -= ret;
     }
   }
-  return bytes_written;
+
+  lock.lock();
+  tx_packets_ += packet_count;
+  for (size_t i = 0; i < packet_count; i++) {
+    size_t packet_bytes = sizeof(packets[i]->type) + packets[i]->length;
+    packets[i]->written = std::min(bytes_written, packet_bytes);
+    packets[i]->done = true;
+    bytes_written -= packets[i]->written;
+  }
 }
 
-void H4Protocol::OnPacketReady() {
-  switch (hci_packet_type_) {
+void H4Protocol::OnPacketReady(HciPacketType type, const uint8_t* data,
+                               size_t length) {
+  // The callbacks do not keep the packet, so it does not need a copy.
+  hidl_vec<uint8_t> packet;
+  packet.setToExternal(const_cast<uint8_t*>(data), length);
+  switch (type) {
     case HCI_PACKET_TYPE_EVENT:
-      event_cb_(hci_packetizer_.GetPacket());
+      event_cb_(packet);
       break;
     case HCI_PACKET_TYPE_ACL_DATA:
-      acl_cb_(hci_packetizer_.GetPacket());
+      acl_cb_(packet);
       break;
     case HCI_PACKET_TYPE_SCO_DATA:
-      sco_cb_(hci_packetizer_.GetPacket());
+      sco_cb_(packet);
       break;
     case HCI_PACKET_TYPE_ISO_DATA:
-      iso_cb_(hci_packetizer_.GetPacket());
+      iso_cb_(packet);
       break;
     default:
       LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__,
-                       static_cast<int>(hci_packet_type_));
+                       static_cast<int>(type));
   }
-  // Get ready for the next type byte.
-  hci_packet_type_ = HCI_PACKET_TYPE_UNKNOWN;
 }
 
-void H4Protocol::OnDataReady(int fd) {
-  if (hci_packet_type_ == HCI_PACKET_TYPE_UNKNOWN) {
-    uint8_t buffer[1] = {0};
-    ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer, 1));
-    if (bytes_read != 1) {
-      if (bytes_read == 0) {
-        // This is only expected if the UART got closed when shutting down.
-        ALOGE("%s: Unexpected EOF reading the packet type!", __func__);
-        sleep(5);  // Expect to be shut down within 5 seconds.
-        return;
-      } else if (bytes_read < 0) {
-        LOG_ALWAYS_FATAL("%s: Read packet type error: %s", __func__,
-                         strerror(errno));
-      } else {
-        LOG_ALWAYS_FATAL("%s: More bytes read than expected (%u)!", __func__,
-                         static_cast<unsigned int>(bytes_read));
-      }
-    }
-    hci_packet_type_ = static_cast<HciPacketType>(buffer[0]);
-    if (hci_packet_type_ != HCI_PACKET_TYPE_ACL_DATA &&
-        hci_packet_type_ != HCI_PACKET_TYPE_SCO_DATA &&
-        hci_packet_type_ != HCI_PACKET_TYPE_ISO_DATA &&
-        hci_packet_type_ != HCI_PACKET_TYPE_EVENT) {
+void H4Protocol::ProcessReadBuffer() {
+  while (read_begin_ < read_end_) {
+    const uint8_t* packet = read_buffer_.data() + read_begin_;
+    const size_t available = read_end_ - read_begin_;
+    const HciPacketType type = static_cast<HciPacketType>(packet[0]);
+    if (type != HCI_PACKET_TYPE_ACL_DATA && type != HCI_PACKET_TYPE_SCO_DATA &&
+        type != HCI_PACKET_TYPE_ISO_DATA && type != HCI_PACKET_TYPE_EVENT) {
       LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__,
-                       static_cast<int>(hci_packet_type_));
+                       static_cast<int>(type));
+    }
+
+    const size_t preamble_size = HciPacketizer::GetPreambleSize(type);
+    if (available < 1 + preamble_size) {
+      break;
+    }
+    const size_t packet_size =
+        1 + preamble_size + HciPacketizer::GetPayloadLength(type, packet + 1);
+    if (available < packet_size) {
+      break;
+    }
+    OnPacketReady(type, packet + 1, packet_size - 1);
+    read_begin_ += packet_size;
+  }
+
+  if (read_begin_ == read_end_) {
+    read_begin_ = 0;
+    read_end_ = 0;
+  }
+}
+
+void H4Protocol::OnDataReady(int fd) {
+  // Move the start of a partial packet to the front, where the rest of the
+  // largest packet still fits behind it.
+  if (read_begin_ > 0) {
+    memmove(read_buffer_.data(), read_buffer_.data() + read_begin_,
+            read_end_ - read_begin_);
+    read_end_ -= read_begin_;
+    read_begin_ = 0;
+  }
+
+  ssize_t bytes_read = TEMP_FAILURE_RETRY(read(
+      fd, read_buffer_.data() + read_end_, read_buffer_.size() - read_end_));
+  if (bytes_read == 0) {
+    // This is only expected if the UART got closed when shutting down.
+    ALOGE("%s: Unexpected EOF reading from the UART!", __func__);
+    sleep(5);  // Expect to be shut down within 5 seconds.
+    return;
+  }
+  if (bytes_read < 0) {
+    if (errno == EAGAIN) {
+      return;
     }
-  } else {
-    hci_packetizer_.OnDataReady(fd, hci_packet_type_);
+    LOG_ALWAYS_FATAL("%s: Read error: %s", __func__, strerror(errno));
   }
+  read_end_ += bytes_read;
+
+  ProcessReadBuffer();
 }
 
 }  // namespace hci
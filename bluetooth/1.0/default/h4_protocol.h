@@ -16,6 +16,11 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
 #include <hidl/HidlSupport.h>
 
 #include "async_fd_watcher.h"
@@ -31,30 +36,54 @@ namespace hci {
 class H4Protocol : public HciProtocol {
  public:
   H4Protocol(int fd, PacketReadCallback event_cb, PacketReadCallback acl_cb,
-             PacketReadCallback sco_cb, PacketReadCallback iso_cb)
-      : uart_fd_(fd),
-        event_cb_(event_cb),
-        acl_cb_(acl_cb),
-        sco_cb_(sco_cb),
-        iso_cb_(iso_cb),
-        hci_packetizer_([this]() { OnPacketReady(); }) {}
+             PacketReadCallback sco_cb, PacketReadCallback iso_cb);
 
+  // Returns once the packet is written. Packets sent from several threads at
+  // once are queued, and written together by one of them.
   size_t Send(uint8_t type, const uint8_t* data, size_t length);
 
-  void OnPacketReady();
-
+  // Reads as much as the UART has and delivers every complete packet.
   void OnDataReady(int fd);
 
  private:
+  // Delivers the packets at the start of the read buffer, and returns once
+  // only part of a packet is left.
+  void ProcessReadBuffer();
+
+  // Sends a packet, without its type byte, to the callback of its type. The
+  // packet is a view of the read buffer, valid only during the callback.
+  void OnPacketReady(HciPacketType type, const uint8_t* data, size_t length);
+
+  // A queued packet. It lives on the stack of the Send() waiting for it.
+  struct TxPacket {
+    uint8_t type;
+    const uint8_t* data;
+    size_t length;
+    size_t written;
+    bool done;
+  };
+
+  // Writes the packets at the head of the queue with as few writev() calls as
+  // the UART allows. The lock is held on entry and exit, but not meanwhile.
+  void WriteQueuedPackets(std::unique_lock<std::mutex>& lock);
+
   int uart_fd_;
 
+  // Guarded by write_mutex_.
+  std::deque<TxPacket*> tx_queue_;
+  bool tx_writing_{false};
+  std::condition_variable tx_cv_;
+
   PacketReadCallback event_cb_;
   PacketReadCallback acl_cb_;
   PacketReadCallback sco_cb_;
   PacketReadCallback iso_cb_;
 
-  HciPacketType hci_packet_type_{HCI_PACKET_TYPE_UNKNOWN};
-  hci::HciPacketizer hci_packetizer_;
+  // Bytes read from the UART, in [read_begin_, read_end_), that are not
+  // delivered yet. Large enough for the largest packet.
+  std::vector<uint8_t> read_buffer_;
+  size_t read_begin_{0};
+  size_t read_end_{0};
 };
 
 }  // namespace hci
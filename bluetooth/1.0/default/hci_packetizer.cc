@@ -58,6 +58,15 @@ namespace hci {
 
 const hidl_vec<uint8_t>& HciPacketizer::GetPacket() const { return packet_; }
 
+size_t HciPacketizer::GetPreambleSize(HciPacketType packet_type) {
+  return preamble_size_for_type[packet_type];
+}
+
+size_t HciPacketizer::GetPayloadLength(HciPacketType packet_type,
+                                       const uint8_t* preamble) {
+  return HciGetPacketLengthForType(packet_type, preamble);
+}
+
 void HciPacketizer::OnDataReady(int fd, HciPacketType packet_type) {
   switch (state_) {
     case HCI_PREAMBLE: {
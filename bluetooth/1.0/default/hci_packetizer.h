@@ -37,6 +37,12 @@ class HciPacketizer {
   void OnDataReady(int fd, HciPacketType packet_type);
   const hidl_vec<uint8_t>& GetPacket() const;
 
+  // Size of the preamble of packets of the given type.
+  static size_t GetPreambleSize(HciPacketType packet_type);
+  // Payload length from the preamble of a packet of the given type.
+  static size_t GetPayloadLength(HciPacketType packet_type,
+                                 const uint8_t* preamble);
+
  protected:
   enum State { HCI_PREAMBLE, HCI_PAYLOAD };
   State state_{HCI_PREAMBLE};
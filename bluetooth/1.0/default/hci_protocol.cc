@@ -21,6 +21,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <log/log.h>
+#include <poll.h>
 #include <unistd.h>
 
 namespace android {
@@ -28,14 +29,27 @@ namespace hardware {
 namespace bluetooth {
 namespace hci {
 
+TxStats HciProtocol::GetTxStats() const {
+  TxStats stats;
+  stats.packets = tx_packets_;
+  stats.writes = tx_writes_;
+  stats.stalls = tx_stalls_;
+  stats.queue_depth = tx_queue_depth_;
+  stats.max_queue_depth = tx_max_queue_depth_;
+  return stats;
+}
+
 size_t HciProtocol::WriteSafely(int fd, const uint8_t* data, size_t length) {
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  tx_packets_++;
+
   size_t transmitted_length = 0;
   while (length > 0) {
     ssize_t ret =
         TEMP_FAILURE_RETRY(write(fd, data + transmitted_length, length));
 
     if (ret == -1) {
-      if (errno == EAGAIN) continue;
+      if (errno == EAGAIN && WaitForWritable(fd)) continue;
       ALOGE("%s error writing to UART (%s)", __func__, strerror(errno));
       break;
 
@@ -45,6 +59,7 @@ size_t HciProtocol::WriteSafely(int fd, const uint8_t* data, size_t length) {
       break;
     }
 
+    tx_writes_++;
     transmitted_length += ret;
     length -= ret;
   }
@@ -52,6 +67,18 @@ size_t HciProtocol::WriteSafely(int fd, const uint8_t* data, size_t length) {
   return transmitted_length;
 }
 
+bool HciProtocol::WaitForWritable(int fd) {
+  tx_stalls_++;
+  struct pollfd pfd = {fd, POLLOUT, 0};
+  // Errors of the UART are left for the next write to report.
+  return TEMP_FAILURE_RETRY(poll(&pfd, 1, -1)) >= 0;
+}
+
+void HciProtocol::UpdateQueueDepth(uint64_t depth) {
+  tx_queue_depth_ = depth;
+  if (depth > tx_max_queue_depth_) tx_max_queue_depth_ = depth;
+}
+
 }  // namespace hci
 }  // namespace bluetooth
 }  // namespace hardware
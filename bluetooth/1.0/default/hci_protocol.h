@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
+
 #include <hidl/HidlSupport.h>
 
 #include "bt_vendor_lib.h"
@@ -30,6 +33,18 @@ namespace hci {
 using ::android::hardware::hidl_vec;
 using PacketReadCallback = std::function<void(const hidl_vec<uint8_t>&)>;
 
+// Counters of the packets sent over a transport.
+struct TxStats {
+  uint64_t packets = 0;
+  // Writes to the UART, which may carry several packets each.
+  uint64_t writes = 0;
+  // Times a write found the UART full and waited for it to drain.
+  uint64_t stalls = 0;
+  // Packets waiting to be written, and the most there ever were.
+  uint64_t queue_depth = 0;
+  uint64_t max_queue_depth = 0;
+};
+
 // Implementation of HCI protocol bits common to different transports
 class HciProtocol {
  public:
@@ -39,8 +54,25 @@ class HciProtocol {
   // Protocol-specific implementation of sending packets.
   virtual size_t Send(uint8_t type, const uint8_t* data, size_t length) = 0;
 
+  TxStats GetTxStats() const;
+
  protected:
-  static size_t WriteSafely(int fd, const uint8_t* data, size_t length);
+  // Writes all of data unless the UART fails, one writer at a time.
+  size_t WriteSafely(int fd, const uint8_t* data, size_t length);
+
+  // Waits until fd can take more data instead of retrying the write.
+  bool WaitForWritable(int fd);
+
+  // Call with the queue locked.
+  void UpdateQueueDepth(uint64_t depth);
+
+  std::mutex write_mutex_;
+
+  std::atomic<uint64_t> tx_packets_{0};
+  std::atomic<uint64_t> tx_writes_{0};
+  std::atomic<uint64_t> tx_stalls_{0};
+  std::atomic<uint64_t> tx_queue_depth_{0};
+  std::atomic<uint64_t> tx_max_queue_depth_{0};
 };
 
 }  // namespace hci
@@ -18,6 +18,7 @@
 
 #include "async_fd_watcher.h"
 #include <gtest/gtest.h>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <vector>
@@ -385,6 +386,44 @@ TEST_F(AsyncFdWatcherSocketTest, RepeatedTimeOutTest) {
   CleanUpServer();
 }
 
+// An edge-triggered callback is only called again when more data arrives.
+TEST_F(AsyncFdWatcherSocketTest, EdgeTriggeredReads) {
+  int sockfd[2];
+  socketpair(AF_LOCAL, SOCK_STREAM, 0, sockfd);
+  std::atomic<int> cb_calls{0};
+  std::atomic<int>* cb_calls_ptr = &cb_calls;
+
+  AsyncFdWatcher watcher;
+  watcher.WatchFdForNonBlockingReads(
+      sockfd[0],
+      [cb_calls_ptr](int fd) {
+        // Leave the rest of the data unread.
+        char read_buf[1] = {0};
+        int n = TEMP_FAILURE_RETRY(read(fd, read_buf, sizeof(read_buf)));
+        ASSERT_TRUE(n == sizeof(read_buf));
+        (*cb_calls_ptr)++;
+      },
+      true);
+
+  char buf[2] = {'1', '2'};
+  TEMP_FAILURE_RETRY(write(sockfd[1], buf, sizeof(buf)));
+  sleep(1);
+  EXPECT_EQ(1, cb_calls);
+
+  TEMP_FAILURE_RETRY(write(sockfd[1], buf, sizeof(buf)));
+  sleep(1);
+  EXPECT_EQ(2, cb_calls);
+
+  // Every callback is accounted for in the latency histogram.
+  uint64_t latencies = 0;
+  for (uint64_t count : watcher.GetLatencyHistogram()) latencies += count;
+  EXPECT_EQ(2u, latencies);
+
+  watcher.StopWatchingFileDescriptors();
+  close(sockfd[0]);
+  close(sockfd[1]);
+}
+
 }  // namespace implementation
 }  // namespace V1_0
 }  // namespace bluetooth
@@ -19,12 +19,15 @@
 #include "h4_protocol.h"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <condition_variable>
 #include <cstdint>
 #include <cstring>
 #include <mutex>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
 #include <log/log.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -122,24 +125,23 @@ class H4ProtocolTest : public ::testing::Test {
     preamble[3] = length & 0xFF;
     preamble[4] = (length >> 8) & 0xFF;
 
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(acl_cb_, Call(HidlVecMatches(preamble + 1, sizeof(preamble) - 1,
                                              payload)))
         .WillOnce(Notify(&mutex, &done));
+    // Locked before writing, so the notification can not come before the wait.
+    std::unique_lock<std::mutex> lock(mutex);
+
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
 
+    ALOGD("%s waiting", __func__);
     // Fail if it takes longer than 100 ms.
     auto timeout_time =
         std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      done.wait_until(lock, timeout_time);
-    }
+    done.wait_until(lock, timeout_time);
   }
 
   void WriteAndExpectInboundScoData(char* payload) {
@@ -147,45 +149,46 @@ class H4ProtocolTest : public ::testing::Test {
     char preamble[4] = {HCI_PACKET_TYPE_SCO_DATA, 20, 17, 0};
     preamble[3] = strlen(payload) & 0xFF;
 
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(sco_cb_, Call(HidlVecMatches(preamble + 1, sizeof(preamble) - 1,
                                              payload)))
         .WillOnce(Notify(&mutex, &done));
+    // Locked before writing, so the notification can not come before the wait.
+    std::unique_lock<std::mutex> lock(mutex);
 
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
+
+    ALOGD("%s waiting", __func__);
     // Fail if it takes longer than 100 ms.
     auto timeout_time =
         std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      done.wait_until(lock, timeout_time);
-    }
+    done.wait_until(lock, timeout_time);
   }
 
   void WriteAndExpectInboundEvent(char* payload) {
     // h4 type[1] + event_code[1] + size[1]
     char preamble[3] = {HCI_PACKET_TYPE_EVENT, 9, 0};
     preamble[2] = strlen(payload) & 0xFF;
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(event_cb_, Call(HidlVecMatches(preamble + 1,
                                                sizeof(preamble) - 1, payload)))
         .WillOnce(Notify(&mutex, &done));
+    // Locked before writing, so the notification can not come before the wait.
+    std::unique_lock<std::mutex> lock(mutex);
 
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      done.wait(lock);
-    }
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
+
+    ALOGD("%s waiting", __func__);
+    // Fail if it takes longer than 100 ms.
+    auto timeout_time =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    done.wait_until(lock, timeout_time);
   }
 
   void WriteAndExpectInboundIsoData(char* payload) {
@@ -195,23 +198,39 @@ class H4ProtocolTest : public ::testing::Test {
     preamble[3] = length & 0xFF;
     preamble[4] = (length >> 8) & 0x3F;
 
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(iso_cb_, Call(HidlVecMatches(preamble + 1, sizeof(preamble) - 1,
                                              payload)))
         .WillOnce(Notify(&mutex, &done));
+    // Locked before writing, so the notification can not come before the wait.
+    std::unique_lock<std::mutex> lock(mutex);
+
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
 
+    ALOGD("%s waiting", __func__);
     // Fail if it takes longer than 100 ms.
     auto timeout_time =
         std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      done.wait_until(lock, timeout_time);
+    done.wait_until(lock, timeout_time);
+  }
+
+  // Writes the packets with the given type byte, preamble and payload to the
+  // UART as one stream, in chunks of chunk_size bytes.
+  void WriteInboundPackets(
+      const std::vector<std::pair<std::vector<uint8_t>, char*>>& packets,
+      size_t chunk_size) {
+    std::vector<uint8_t> stream;
+    for (const auto& packet : packets) {
+      stream.insert(stream.end(), packet.first.begin(), packet.first.end());
+      stream.insert(stream.end(), packet.second,
+                    packet.second + strlen(packet.second));
+    }
+    for (size_t offset = 0; offset < stream.size(); offset += chunk_size) {
+      size_t length = std::min(chunk_size, stream.size() - offset);
+      TEMP_FAILURE_RETRY(write(fake_uart_, stream.data() + offset, length));
     }
   }
 
@@ -232,6 +251,47 @@ TEST_F(H4ProtocolTest, TestSends) {
   SendAndReadUartOutbound(HCI_PACKET_TYPE_ISO_DATA, sample_data4);
 }
 
+// Ensure a send to a full UART waits for it to drain and then completes
+TEST(H4ProtocolSendTest, TestSendToFullUart) {
+  int sockfd[2];
+  socketpair(AF_LOCAL, SOCK_STREAM, 0, sockfd);
+  fcntl(sockfd[0], F_SETFL, fcntl(sockfd[0], F_GETFL) | O_NONBLOCK);
+  int buffer_size = 4096;
+  setsockopt(sockfd[0], SOL_SOCKET, SO_SNDBUF, &buffer_size,
+             sizeof(buffer_size));
+  H4Protocol h4_hci(sockfd[0], nullptr, nullptr, nullptr, nullptr);
+
+  std::vector<uint8_t> packet(0xFFFF);
+  for (size_t i = 0; i < packet.size(); i++) packet[i] = i & 0xFF;
+  size_t written = 0;
+  std::thread sender([&]() {
+    written = h4_hci.Send(HCI_PACKET_TYPE_ACL_DATA, packet.data(),
+                          packet.size());
+  });
+
+  // Let the sender fill the socket before draining it.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::vector<uint8_t> received;
+  while (received.size() < packet.size() + 1) {
+    uint8_t buffer[4096];
+    ssize_t ret = TEMP_FAILURE_RETRY(read(sockfd[1], buffer, sizeof(buffer)));
+    ASSERT_GT(ret, 0);
+    received.insert(received.end(), buffer, buffer + ret);
+  }
+  sender.join();
+
+  EXPECT_EQ(packet.size() + 1, written);
+  EXPECT_EQ(HCI_PACKET_TYPE_ACL_DATA, received[0]);
+  EXPECT_TRUE(std::equal(packet.begin(), packet.end(), received.begin() + 1));
+  hci::TxStats stats = h4_hci.GetTxStats();
+  EXPECT_EQ(1u, stats.packets);
+  EXPECT_LT(0u, stats.stalls);
+  EXPECT_EQ(0u, stats.queue_depth);
+
+  close(sockfd[0]);
+  close(sockfd[1]);
+}
+
 // Ensure we properly parse data coming from the UART
 TEST_F(H4ProtocolTest, TestReads) {
   WriteAndExpectInboundAclData(acl_data);
@@ -240,6 +300,57 @@ TEST_F(H4ProtocolTest, TestReads) {
   WriteAndExpectInboundIsoData(iso_data);
 }
 
+// Ensure packets are split out of reads that hold several of them
+TEST_F(H4ProtocolTest, TestReadsOfSeveralPackets) {
+  std::vector<uint8_t> acl = {HCI_PACKET_TYPE_ACL_DATA, 19, 92,
+                              static_cast<uint8_t>(strlen(acl_data)), 0};
+  std::vector<uint8_t> event = {HCI_PACKET_TYPE_EVENT, 9,
+                                static_cast<uint8_t>(strlen(event_data))};
+  std::vector<uint8_t> iso = {HCI_PACKET_TYPE_ISO_DATA, 19, 92,
+                              static_cast<uint8_t>(strlen(iso_data)), 0};
+
+  std::mutex mutex;
+  std::condition_variable done;
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(acl_cb_, Call(HidlVecMatches(acl.data() + 1, acl.size() - 1,
+                                             acl_data)));
+    EXPECT_CALL(event_cb_, Call(HidlVecMatches(event.data() + 1,
+                                               event.size() - 1, event_data)));
+    EXPECT_CALL(iso_cb_, Call(HidlVecMatches(iso.data() + 1, iso.size() - 1,
+                                             iso_data)))
+        .WillOnce(Notify(&mutex, &done));
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  WriteInboundPackets({{acl, acl_data}, {event, event_data}, {iso, iso_data}},
+                      SIZE_MAX);
+  done.wait_for(lock, std::chrono::milliseconds(100));
+}
+
+// Ensure packets are put back together from reads of a few bytes
+TEST_F(H4ProtocolTest, TestFragmentedReads) {
+  std::vector<uint8_t> sco = {HCI_PACKET_TYPE_SCO_DATA, 20, 17,
+                              static_cast<uint8_t>(strlen(sco_data))};
+  std::vector<uint8_t> acl = {HCI_PACKET_TYPE_ACL_DATA, 19, 92,
+                              static_cast<uint8_t>(strlen(acl_data)), 0};
+
+  std::mutex mutex;
+  std::condition_variable done;
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(sco_cb_, Call(HidlVecMatches(sco.data() + 1, sco.size() - 1,
+                                             sco_data)));
+    EXPECT_CALL(acl_cb_, Call(HidlVecMatches(acl.data() + 1, acl.size() - 1,
+                                             acl_data)))
+        .WillOnce(Notify(&mutex, &done));
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  WriteInboundPackets({{sco, sco_data}, {acl, acl_data}}, 3);
+  done.wait_for(lock, std::chrono::milliseconds(100));
+}
+
 }  // namespace implementation
 }  // namespace V1_0
 }  // namespace bluetooth
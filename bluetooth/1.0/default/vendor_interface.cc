@@ -22,6 +22,8 @@
 
 #include <dlfcn.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
 
 #include "bluetooth_address.h"
 #include "h4_protocol.h"
@@ -51,6 +53,8 @@ struct {
 bool lpm_wake_deasserted;
 uint32_t lpm_timeout_ms;
 bool recent_activity_flag;
+// Sends still writing to the UART, which keep wake asserted.
+int sends_in_flight;
 
 VendorInterface* g_vendor_interface = nullptr;
 std::mutex wakeup_mutex_;
@@ -316,6 +320,7 @@ void VendorInterface::Close() {
 size_t VendorInterface::Send(uint8_t type, const uint8_t* data, size_t length) {
   std::unique_lock<std::mutex> lock(wakeup_mutex_);
   recent_activity_flag = true;
+  sends_in_flight++;
 
   if (lpm_wake_deasserted == true) {
     // Restart the timer.
@@ -328,7 +333,26 @@ size_t VendorInterface::Send(uint8_t type, const uint8_t* data, size_t length) {
     ALOGV("%s: Sent wake before (%02x)", __func__, data[0] | (data[1] << 8));
   }
 
-  return hci_->Send(type, data, length);
+  // Unlocked while writing, so packets sent from several threads at once can
+  // be coalesced by the protocol.
+  lock.unlock();
+  size_t bytes_written = hci_->Send(type, data, length);
+
+  lock.lock();
+  sends_in_flight--;
+  recent_activity_flag = true;
+  return bytes_written;
+}
+
+void VendorInterface::Dump(int fd) {
+  if (hci_ == nullptr) return;
+  hci::TxStats stats = hci_->GetTxStats();
+  dprintf(fd,
+          "TX: %" PRIu64 " packets in %" PRIu64 " writes, %" PRIu64
+          " stalls on a full UART, queue depth %" PRIu64 " (max %" PRIu64
+          ")\n",
+          stats.packets, stats.writes, stats.stalls, stats.queue_depth,
+          stats.max_queue_depth);
 }
 
 void VendorInterface::OnFirmwareConfigured(uint8_t result) {
@@ -358,7 +382,7 @@ void VendorInterface::OnFirmwareConfigured(uint8_t result) {
 void VendorInterface::OnTimeout() {
   ALOGV("%s", __func__);
   std::unique_lock<std::mutex> lock(wakeup_mutex_);
-  if (recent_activity_flag == false) {
+  if (recent_activity_flag == false && sends_in_flight == 0) {
     lpm_wake_deasserted = true;
     bt_vendor_lpm_wake_state_t wakeState = BT_VND_LPM_WAKE_DEASSERT;
     lib_interface_->op(BT_VND_OP_LPM_WAKE_SET_STATE, &wakeState);
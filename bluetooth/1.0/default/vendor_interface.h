@@ -44,6 +44,9 @@ class VendorInterface {
 
   size_t Send(uint8_t type, const uint8_t* data, size_t length);
 
+  // Writes the transmit counters of the transport to fd.
+  void Dump(int fd);
+
   void OnFirmwareConfigured(uint8_t result);
 
  private:
@@ -112,7 +112,7 @@ ndk::ScopedAStatus BluetoothAudioProviderFactory::getProviderCapabilities(
              session_type ==
                  SessionType::
                      LE_AUDIO_BROADCAST_HARDWARE_OFFLOAD_ENCODING_DATAPATH) {
-    std::vector<LeAudioCodecCapabilitiesSetting> db_codec_capabilities =
+    const std::vector<LeAudioCodecCapabilitiesSetting>& db_codec_capabilities =
         BluetoothAudioCodecs::GetLeAudioOffloadCodecCapabilities(session_type);
     if (db_codec_capabilities.size()) {
       _aidl_return->resize(db_codec_capabilities.size());
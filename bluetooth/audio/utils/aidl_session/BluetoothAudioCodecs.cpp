@@ -96,8 +96,6 @@ const std::vector<CodecCapabilities> kDefaultOffloadA2dpCodecCapabilities = {
     {.codecType = CodecType::APTX_HD, .capabilities = {}},
     {.codecType = CodecType::OPUS, .capabilities = {}}};
 
-std::vector<LeAudioCodecCapabilitiesSetting> kDefaultOffloadLeAudioCapabilities;
-
 template <class T>
 bool BluetoothAudioCodecs::ContainedInVector(
     const std::vector<T>& vector, const typename identity<T>::type& target) {
@@ -385,7 +383,7 @@ bool BluetoothAudioCodecs::IsOffloadCodecConfigurationValid(
   return false;
 }
 
-std::vector<LeAudioCodecCapabilitiesSetting>
+const std::vector<LeAudioCodecCapabilitiesSetting>&
 BluetoothAudioCodecs::GetLeAudioOffloadCodecCapabilities(
     const SessionType& session_type) {
   if (session_type !=
@@ -394,16 +392,19 @@ BluetoothAudioCodecs::GetLeAudioOffloadCodecCapabilities(
           SessionType::LE_AUDIO_HARDWARE_OFFLOAD_DECODING_DATAPATH &&
       session_type !=
           SessionType::LE_AUDIO_BROADCAST_HARDWARE_OFFLOAD_ENCODING_DATAPATH) {
-    return std::vector<LeAudioCodecCapabilitiesSetting>(0);
+    static const std::vector<LeAudioCodecCapabilitiesSetting> kNoCapabilities;
+    return kNoCapabilities;
   }
 
-  if (kDefaultOffloadLeAudioCapabilities.empty()) {
-    auto le_audio_offload_setting =
-        BluetoothLeAudioCodecsProvider::ParseFromLeAudioOffloadSettingFile();
-    kDefaultOffloadLeAudioCapabilities =
-        BluetoothLeAudioCodecsProvider::GetLeAudioCodecCapabilities(
+  // The setting file is parsed once, on the first query, even if it is missing
+  // or invalid, and the capabilities don't change afterwards.
+  static const std::vector<LeAudioCodecCapabilitiesSetting>
+      kDefaultOffloadLeAudioCapabilities = [] {
+        auto le_audio_offload_setting = BluetoothLeAudioCodecsProvider::
+            ParseFromLeAudioOffloadSettingFile();
+        return BluetoothLeAudioCodecsProvider::GetLeAudioCodecCapabilities(
             le_audio_offload_setting);
-  }
+      }();
 
   return kDefaultOffloadLeAudioCapabilities;
 }
@@ -44,7 +44,7 @@ class BluetoothAudioCodecs {
   static bool IsOffloadCodecConfigurationValid(
       const SessionType& session_type, const CodecConfiguration& codec_config);
 
-  static std::vector<LeAudioCodecCapabilitiesSetting>
+  static const std::vector<LeAudioCodecCapabilitiesSetting>&
   GetLeAudioOffloadCodecCapabilities(const SessionType& session_type);
 
  private:
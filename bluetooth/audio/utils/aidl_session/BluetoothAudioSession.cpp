@@ -23,6 +23,9 @@
 
 #include "BluetoothAudioSession.h"
 
+#include <algorithm>
+#include <thread>
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -32,8 +35,13 @@ namespace audio {
 static constexpr int kFmqSendTimeoutMs = 1000;  // 1000 ms timeout for sending
 static constexpr int kFmqReceiveTimeoutMs =
     1000;                               // 1000 ms timeout for receiving
-static constexpr int kWritePollMs = 1;  // polled non-blocking interval
-static constexpr int kReadPollMs = 1;   // polled non-blocking interval
+// polled interval, used until the peer is seen waking the EventFlag up
+static constexpr auto kPollInterval = std::chrono::milliseconds(1);
+// max time to block on the EventFlag at once, in case the peer stops waking it
+static constexpr auto kMaxEventFlagWait = std::chrono::milliseconds(20);
+// same bits as the audio HAL MessageQueueFlagBits
+static constexpr uint32_t kFmqNotEmpty = 1 << 0;
+static constexpr uint32_t kFmqNotFull = 1 << 1;
 
 BluetoothAudioSession::BluetoothAudioSession(const SessionType& session_type)
     : session_type_(session_type), stack_iface_(nullptr), data_mq_(nullptr) {}
@@ -310,18 +318,76 @@ void BluetoothAudioSession::StopStream() {
  ***/
 
 bool BluetoothAudioSession::UpdateDataPath(const DataMQDesc* mq_desc) {
+  if (data_mq_ != nullptr) {
+    LOG(INFO) << __func__ << " - SessionType=" << toString(session_type_)
+              << ", overflow=" << data_path_stats_.overflow_count
+              << ", underrun=" << data_path_stats_.underrun_count
+              << ", wake_up=" << data_path_stats_.wake_up_count
+              << ", max_wake_up_latency_us="
+              << data_path_stats_.max_wake_up_latency_us;
+  }
+  data_mq_event_flag_ = nullptr;
+  data_path_stats_ = {};
   if (mq_desc == nullptr) {
     // usecase of reset by nullptr
     data_mq_ = nullptr;
     return true;
   }
-  std::unique_ptr<DataMQ> temp_mq;
-  temp_mq.reset(new DataMQ(*mq_desc));
+  std::shared_ptr<DataMQ> temp_mq = std::make_shared<DataMQ>(*mq_desc);
   if (!temp_mq || !temp_mq->isValid()) {
     data_mq_ = nullptr;
     return false;
   }
   data_mq_ = std::move(temp_mq);
+
+  EventFlag* event_flag = nullptr;
+  if (data_mq_->getEventFlagWord() != nullptr &&
+      EventFlag::createEventFlag(data_mq_->getEventFlagWord(), &event_flag) ==
+          ::android::OK) {
+    // the EventFlag maps the flag word of the FMQ, so keep the FMQ alive too
+    data_mq_event_flag_ = std::shared_ptr<EventFlag>(
+        event_flag, [data_mq = data_mq_](EventFlag* flag) {
+          EventFlag::deleteEventFlag(&flag);
+        });
+  } else {
+    LOG(WARNING) << __func__ << " - SessionType=" << toString(session_type_)
+                 << ", no EventFlag, polling the FMQ";
+  }
+  return true;
+}
+
+bool BluetoothAudioSession::WaitForDataPath(
+    const std::shared_ptr<EventFlag>& event_flag, uint32_t bits,
+    std::chrono::steady_clock::time_point deadline) {
+  const auto start = std::chrono::steady_clock::now();
+  if (start >= deadline) {
+    return false;
+  }
+  auto timeout = std::min<std::chrono::steady_clock::duration>(
+      deadline - start,
+      peer_wakes_event_flag_ ? kMaxEventFlagWait : kPollInterval);
+  if (event_flag == nullptr) {
+    std::this_thread::sleep_for(timeout);
+    return true;
+  }
+
+  uint32_t ef_state = 0;
+  auto status = event_flag->wait(
+      bits, &ef_state,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count(),
+      true /* retry */);
+  if (status != ::android::OK || (ef_state & bits) == 0) {
+    return true;
+  }
+  peer_wakes_event_flag_ = true;
+  uint64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+  std::lock_guard<std::recursive_mutex> guard(mutex_);
+  data_path_stats_.wake_up_count++;
+  data_path_stats_.total_wake_up_latency_us += latency_us;
+  data_path_stats_.max_wake_up_latency_us =
+      std::max(data_path_stats_.max_wake_up_latency_us, latency_us);
   return true;
 }
 
@@ -397,19 +463,26 @@ size_t BluetoothAudioSession::OutWritePcmData(const void* buffer,
     return 0;
   }
   size_t total_written = 0;
-  int timeout_ms = kFmqSendTimeoutMs;
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(kFmqSendTimeoutMs);
   do {
-    std::unique_lock<std::recursive_mutex> lock(mutex_);
-    if (!IsSessionReady()) {
-      break;
+    std::shared_ptr<DataMQ> data_mq;
+    std::shared_ptr<EventFlag> event_flag;
+    {
+      std::lock_guard<std::recursive_mutex> guard(mutex_);
+      if (!IsSessionReady()) {
+        break;
+      }
+      data_mq = data_mq_;
+      event_flag = data_mq_event_flag_;
     }
-    size_t num_bytes_to_write = data_mq_->availableToWrite();
+    size_t num_bytes_to_write = data_mq->availableToWrite();
     if (num_bytes_to_write) {
       if (num_bytes_to_write > (bytes - total_written)) {
         num_bytes_to_write = bytes - total_written;
       }
 
-      if (!data_mq_->write(
+      if (!data_mq->write(
               static_cast<const MQDataType*>(buffer) + total_written,
               num_bytes_to_write)) {
         LOG(ERROR) << "FMQ datapath writing " << total_written << "/" << bytes
@@ -417,56 +490,140 @@ size_t BluetoothAudioSession::OutWritePcmData(const void* buffer,
         return total_written;
       }
       total_written += num_bytes_to_write;
-    } else if (timeout_ms >= kWritePollMs) {
-      lock.unlock();
-      usleep(kWritePollMs * 1000);
-      timeout_ms -= kWritePollMs;
-    } else {
+      if (event_flag != nullptr) {
+        event_flag->wake(kFmqNotEmpty);
+      }
+    } else if (!WaitForDataPath(event_flag, kFmqNotFull, deadline)) {
       LOG(DEBUG) << "Data " << total_written << "/" << bytes << " overflow "
-                 << (kFmqSendTimeoutMs - timeout_ms) << " ms";
+                 << kFmqSendTimeoutMs << " ms";
+      std::lock_guard<std::recursive_mutex> guard(mutex_);
+      data_path_stats_.overflow_count++;
       return total_written;
     }
   } while (total_written < bytes);
   return total_written;
 }
 
+size_t BluetoothAudioSession::OutBeginWritePcmData(
+    size_t bytes, DataMQ::MemTransaction* tx) {
+  if (tx == nullptr || bytes <= 0) {
+    return 0;
+  }
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(kFmqSendTimeoutMs);
+  while (true) {
+    std::shared_ptr<DataMQ> data_mq;
+    std::shared_ptr<EventFlag> event_flag;
+    {
+      std::lock_guard<std::recursive_mutex> guard(mutex_);
+      if (!IsSessionReady()) {
+        return 0;
+      }
+      data_mq = data_mq_;
+      event_flag = data_mq_event_flag_;
+    }
+    size_t num_bytes_to_write = data_mq->availableToWrite();
+    if (num_bytes_to_write) {
+      if (num_bytes_to_write > bytes) {
+        num_bytes_to_write = bytes;
+      }
+      if (!data_mq->beginWrite(num_bytes_to_write, tx)) {
+        LOG(ERROR) << "FMQ datapath reserving " << num_bytes_to_write
+                   << " failed";
+        return 0;
+      }
+      std::lock_guard<std::recursive_mutex> guard(mutex_);
+      pending_write_mq_ = data_mq;
+      return num_bytes_to_write;
+    }
+    if (!WaitForDataPath(event_flag, kFmqNotFull, deadline)) {
+      LOG(DEBUG) << "Data 0/" << bytes << " overflow " << kFmqSendTimeoutMs
+                 << " ms";
+      std::lock_guard<std::recursive_mutex> guard(mutex_);
+      data_path_stats_.overflow_count++;
+      return 0;
+    }
+  }
+}
+
+bool BluetoothAudioSession::OutCommitWritePcmData(size_t bytes) {
+  std::shared_ptr<DataMQ> data_mq;
+  std::shared_ptr<EventFlag> event_flag;
+  {
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    data_mq = std::move(pending_write_mq_);
+    pending_write_mq_ = nullptr;
+    if (data_mq == nullptr) {
+      LOG(ERROR) << __func__ << " - no memory reserved";
+      return false;
+    }
+    if (!IsSessionReady() || data_mq != data_mq_) {
+      // the data path was changed after the memory was reserved
+      LOG(WARNING) << __func__ << " - SessionType=" << toString(session_type_)
+                   << ", dropping " << bytes << " bytes for a closed FMQ";
+      return false;
+    }
+    event_flag = data_mq_event_flag_;
+  }
+  if (!data_mq->commitWrite(bytes)) {
+    LOG(ERROR) << "FMQ datapath committing " << bytes << " failed";
+    return false;
+  }
+  if (event_flag != nullptr) {
+    event_flag->wake(kFmqNotEmpty);
+  }
+  return true;
+}
+
 size_t BluetoothAudioSession::InReadPcmData(void* buffer, size_t bytes) {
   if (buffer == nullptr || bytes <= 0) {
     return 0;
   }
   size_t total_read = 0;
-  int timeout_ms = kFmqReceiveTimeoutMs;
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(kFmqReceiveTimeoutMs);
   do {
-    std::unique_lock<std::recursive_mutex> lock(mutex_);
-    if (!IsSessionReady()) {
-      break;
+    std::shared_ptr<DataMQ> data_mq;
+    std::shared_ptr<EventFlag> event_flag;
+    {
+      std::lock_guard<std::recursive_mutex> guard(mutex_);
+      if (!IsSessionReady()) {
+        break;
+      }
+      data_mq = data_mq_;
+      event_flag = data_mq_event_flag_;
     }
-    size_t num_bytes_to_read = data_mq_->availableToRead();
+    size_t num_bytes_to_read = data_mq->availableToRead();
     if (num_bytes_to_read) {
       if (num_bytes_to_read > (bytes - total_read)) {
         num_bytes_to_read = bytes - total_read;
       }
-      if (!data_mq_->read(static_cast<MQDataType*>(buffer) + total_read,
-                          num_bytes_to_read)) {
+      if (!data_mq->read(static_cast<MQDataType*>(buffer) + total_read,
+                         num_bytes_to_read)) {
         LOG(ERROR) << "FMQ datapath reading " << total_read << "/" << bytes
                    << " failed";
         return total_read;
       }
       total_read += num_bytes_to_read;
-    } else if (timeout_ms >= kReadPollMs) {
-      lock.unlock();
-      usleep(kReadPollMs * 1000);
-      timeout_ms -= kReadPollMs;
-      continue;
-    } else {
-      LOG(DEBUG) << "Data " << total_read << "/" << bytes << " overflow "
-                 << (kFmqReceiveTimeoutMs - timeout_ms) << " ms";
+      if (event_flag != nullptr) {
+        event_flag->wake(kFmqNotFull);
+      }
+    } else if (!WaitForDataPath(event_flag, kFmqNotEmpty, deadline)) {
+      LOG(DEBUG) << "Data " << total_read << "/" << bytes << " underrun "
+                 << kFmqReceiveTimeoutMs << " ms";
+      std::lock_guard<std::recursive_mutex> guard(mutex_);
+      data_path_stats_.underrun_count++;
       return total_read;
     }
   } while (total_read < bytes);
   return total_read;
 }
 
+DataPathStats BluetoothAudioSession::GetDataPathStats() {
+  std::lock_guard<std::recursive_mutex> guard(mutex_);
+  return data_path_stats_;
+}
+
 /***
  *
  * Other methods
@@ -23,8 +23,11 @@
 #include <aidl/android/hardware/bluetooth/audio/LatencyMode.h>
 #include <aidl/android/hardware/bluetooth/audio/SessionType.h>
 #include <fmq/AidlMessageQueue.h>
+#include <fmq/EventFlag.h>
 #include <hardware/audio.h>
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -38,6 +41,7 @@ namespace audio {
 using ::aidl::android::hardware::common::fmq::MQDescriptor;
 using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
 using ::android::AidlMessageQueue;
+using ::android::hardware::EventFlag;
 
 using ::aidl::android::hardware::audio::common::SinkMetadata;
 using ::aidl::android::hardware::audio::common::SourceMetadata;
@@ -49,6 +53,18 @@ using DataMQDesc =
     ::aidl::android::hardware::common::fmq::MQDescriptor<MQDataType,
                                                          MQDataMode>;
 
+// Statistics of the software FMQ data path of a session
+struct DataPathStats {
+  // writes that timed out on a full FMQ
+  uint64_t overflow_count = 0;
+  // reads that timed out on an empty FMQ
+  uint64_t underrun_count = 0;
+  // times the data path was blocked and woken up by the peer
+  uint64_t wake_up_count = 0;
+  uint64_t total_wake_up_latency_us = 0;
+  uint64_t max_wake_up_latency_us = 0;
+};
+
 static constexpr uint16_t kObserversCookieSize = 0x0010;  // 0x0000 ~ 0x000f
 static constexpr uint16_t kObserversCookieUndefined =
     (static_cast<uint16_t>(SessionType::UNKNOWN) << 8 & 0xff00);
@@ -202,8 +218,18 @@ class BluetoothAudioSession {
 
   // The control function writes stream to FMQ
   size_t OutWritePcmData(const void* buffer, size_t bytes);
+  // The control function reserves up to bytes in the FMQ to render the stream
+  // into directly, waiting for room like OutWritePcmData. The reserved memory
+  // is in tx, which could be split into two regions on the FMQ wraparound.
+  // Returns the reserved size, 0 on timeout or if the session isn't ready.
+  size_t OutBeginWritePcmData(size_t bytes, DataMQ::MemTransaction* tx);
+  // The control function makes the first bytes rendered into the memory
+  // reserved by OutBeginWritePcmData available to the reader
+  bool OutCommitWritePcmData(size_t bytes);
   // The control function read stream from FMQ
   size_t InReadPcmData(void* buffer, size_t bytes);
+  // The control function gets the FMQ data path statistics of this session
+  DataPathStats GetDataPathStats();
 
   // Return if IBluetoothAudioProviderFactory implementation existed
   static bool IsAidlAvailable();
@@ -215,8 +241,17 @@ class BluetoothAudioSession {
 
   // audio control path to use for both software and offloading
   std::shared_ptr<IBluetoothAudioPort> stack_iface_;
-  // audio data path (FMQ) for software encoding
-  std::unique_ptr<DataMQ> data_mq_;
+  // audio data path (FMQ) for software encoding. The data path functions keep
+  // a reference while accessing the FMQ without holding mutex_.
+  std::shared_ptr<DataMQ> data_mq_;
+  // the EventFlag of data_mq_ to block on, nullptr if the FMQ has none
+  std::shared_ptr<EventFlag> data_mq_event_flag_;
+  // the FMQ with memory reserved by OutBeginWritePcmData, not committed yet
+  std::shared_ptr<DataMQ> pending_write_mq_;
+  DataPathStats data_path_stats_;
+  // whether the peer was seen waking the EventFlag up; until then, the
+  // EventFlag is only waited on for the polling interval
+  std::atomic<bool> peer_wakes_event_flag_ = false;
   // audio data configuration for both software and offloading
   std::unique_ptr<AudioConfiguration> audio_config_;
   std::unique_ptr<AudioConfiguration> leaudio_connection_map_;
@@ -230,6 +265,11 @@ class BluetoothAudioSession {
       observers_;
 
   bool UpdateDataPath(const DataMQDesc* mq_desc);
+  // blocks until the peer wakes the bits up, the polling interval passed or the
+  // deadline passed; returns false if the deadline already passed
+  bool WaitForDataPath(const std::shared_ptr<EventFlag>& event_flag,
+                       uint32_t bits,
+                       std::chrono::steady_clock::time_point deadline);
   bool UpdateAudioConfig(const AudioConfiguration& audio_config);
   // invoking the registered session_changed_cb_
   void ReportSessionStatus();
@@ -207,6 +207,32 @@ class BluetoothAudioSessionControl {
     return 0;
   }
 
+  /***
+   * The control API reserves FMQ memory to render the stream into directly
+   ***/
+  static size_t OutBeginWritePcmData(const SessionType& session_type,
+                                     size_t bytes, DataMQ::MemTransaction* tx) {
+    std::shared_ptr<BluetoothAudioSession> session_ptr =
+        BluetoothAudioSessionInstance::GetSessionInstance(session_type);
+    if (session_ptr != nullptr) {
+      return session_ptr->OutBeginWritePcmData(bytes, tx);
+    }
+    return 0;
+  }
+
+  /***
+   * The control API commits the stream rendered into the reserved FMQ memory
+   ***/
+  static bool OutCommitWritePcmData(const SessionType& session_type,
+                                    size_t bytes) {
+    std::shared_ptr<BluetoothAudioSession> session_ptr =
+        BluetoothAudioSessionInstance::GetSessionInstance(session_type);
+    if (session_ptr != nullptr) {
+      return session_ptr->OutCommitWritePcmData(bytes);
+    }
+    return false;
+  }
+
   /***
    * The control API reads stream from FMQ
    ***/
@@ -219,6 +245,18 @@ class BluetoothAudioSessionControl {
     }
     return 0;
   }
+
+  /***
+   * The control API gets the FMQ data path statistics
+   ***/
+  static DataPathStats GetDataPathStats(const SessionType& session_type) {
+    std::shared_ptr<BluetoothAudioSession> session_ptr =
+        BluetoothAudioSessionInstance::GetSessionInstance(session_type);
+    if (session_ptr != nullptr) {
+      return session_ptr->GetDataPathStats();
+    }
+    return DataPathStats{};
+  }
 };
 
 }  // namespace audio
@@ -101,16 +101,42 @@ BluetoothLeAudioCodecsProvider::GetLeAudioCodecCapabilities(
       ComposeLeAudioCodecCapabilities(supported_scenarios);
   isInvalidFileContent = leAudioCodecCapabilities.empty();
 
+  for (size_t i = 0; i < leAudioCodecCapabilities.size(); i++) {
+    const auto& encode = leAudioCodecCapabilities[i].unicastEncodeCapability;
+    const auto& decode = leAudioCodecCapabilities[i].unicastDecodeCapability;
+    capability_index_[{encode.codecType, encode.supportedChannel}].push_back(i);
+    if (decode.codecType != encode.codecType ||
+        decode.supportedChannel != encode.supportedChannel) {
+      capability_index_[{decode.codecType, decode.supportedChannel}].push_back(
+          i);
+    }
+  }
+
   return leAudioCodecCapabilities;
 }
 
 void BluetoothLeAudioCodecsProvider::ClearLeAudioCodecCapabilities() {
   leAudioCodecCapabilities.clear();
+  capability_index_.clear();
   configuration_map_.clear();
   codec_configuration_map_.clear();
   strategy_configuration_map_.clear();
 }
 
+std::vector<LeAudioCodecCapabilitiesSetting>
+BluetoothLeAudioCodecsProvider::FindLeAudioCodecCapabilities(
+    const CodecType& codec_type, const AudioLocation& audio_location) {
+  std::vector<LeAudioCodecCapabilitiesSetting> capabilities;
+  auto index_iter = capability_index_.find({codec_type, audio_location});
+  if (index_iter == capability_index_.end()) {
+    return capabilities;
+  }
+  for (const auto& position : index_iter->second) {
+    capabilities.push_back(leAudioCodecCapabilities[position]);
+  }
+  return capabilities;
+}
+
 std::vector<setting::Scenario> BluetoothLeAudioCodecsProvider::GetScenarios(
     const std::optional<setting::LeAudioOffloadSetting>&
         le_audio_offload_setting) {
@@ -19,6 +19,7 @@
 #include <aidl/android/hardware/bluetooth/audio/LeAudioCodecCapabilitiesSetting.h>
 #include <android-base/logging.h>
 
+#include <map>
 #include <unordered_map>
 
 #include "aidl_android_hardware_bluetooth_audio_setting.h"
@@ -38,8 +39,18 @@ class BluetoothLeAudioCodecsProvider {
       const std::optional<setting::LeAudioOffloadSetting>&
           le_audio_offload_setting);
   static void ClearLeAudioCodecCapabilities();
+  // Capabilities composed by the last GetLeAudioCodecCapabilities call with a
+  // unicast encode or decode capability of the given codec and audio location
+  static std::vector<LeAudioCodecCapabilitiesSetting>
+  FindLeAudioCodecCapabilities(const CodecType& codec_type,
+                               const AudioLocation& audio_location);
 
  private:
+  // positions in leAudioCodecCapabilities by codec type and audio location
+  static inline std::map<std::pair<CodecType, AudioLocation>,
+                         std::vector<size_t>>
+      capability_index_;
+
   static inline std::unordered_map<std::string, setting::Configuration>
       configuration_map_;
   static inline std::unordered_map<std::string, setting::CodecConfiguration>
@@ -325,6 +325,24 @@ TEST_P(ComposeLeAudioCodecCapabilitiesTest, CodecCapabilitiesNotEmpty) {
   ASSERT_TRUE(!le_audio_codec_capabilities.empty());
 }
 
+TEST_P(ComposeLeAudioCodecCapabilitiesTest, FindByCodecTypeAndAudioLocation) {
+  using aidl::android::hardware::bluetooth::audio::AudioLocation;
+  using aidl::android::hardware::bluetooth::audio::CodecType;
+  static const AudioLocation kStereoAudio = static_cast<AudioLocation>(
+      static_cast<uint8_t>(AudioLocation::FRONT_LEFT) |
+      static_cast<uint8_t>(AudioLocation::FRONT_RIGHT));
+
+  Initialize();
+  auto le_audio_codec_capabilities = RunTestCase();
+  auto stereo_capabilities =
+      BluetoothLeAudioCodecsProvider::FindLeAudioCodecCapabilities(
+          CodecType::LC3, kStereoAudio);
+  ASSERT_EQ(stereo_capabilities, le_audio_codec_capabilities);
+  ASSERT_TRUE(BluetoothLeAudioCodecsProvider::FindLeAudioCodecCapabilities(
+                  CodecType::LC3, AudioLocation::UNKNOWN)
+                  .empty());
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(GetScenariosTest);
 INSTANTIATE_TEST_SUITE_P(
     BluetoothLeAudioCodecsProviderTest, GetScenariosTest,
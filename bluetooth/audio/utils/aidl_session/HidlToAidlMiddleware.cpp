@@ -21,8 +21,11 @@
 #include <aidl/android/hardware/bluetooth/audio/SessionType.h>
 #include <android-base/logging.h>
 
+#include <array>
 #include <functional>
+#include <optional>
 #include <unordered_map>
+#include <utility>
 
 #include "../aidl_session/BluetoothAudioSession.h"
 #include "../aidl_session/BluetoothAudioSessionControl.h"
@@ -87,107 +90,125 @@ std::unordered_map<
     std::unordered_map<uint16_t, std::shared_ptr<PortStatusCallbacks_2_0>>>
     legacy_callback_table;
 
-const static std::unordered_map<SessionType_2_1, SessionType>
-    session_type_2_1_to_aidl_map{
-        {SessionType_2_1::A2DP_SOFTWARE_ENCODING_DATAPATH,
-         SessionType::A2DP_SOFTWARE_ENCODING_DATAPATH},
-        {SessionType_2_1::A2DP_HARDWARE_OFFLOAD_DATAPATH,
-         SessionType::A2DP_HARDWARE_OFFLOAD_ENCODING_DATAPATH},
-        {SessionType_2_1::HEARING_AID_SOFTWARE_ENCODING_DATAPATH,
-         SessionType::HEARING_AID_SOFTWARE_ENCODING_DATAPATH},
-        {SessionType_2_1::LE_AUDIO_SOFTWARE_ENCODING_DATAPATH,
-         SessionType::LE_AUDIO_SOFTWARE_ENCODING_DATAPATH},
-        {SessionType_2_1::LE_AUDIO_SOFTWARE_DECODED_DATAPATH,
-         SessionType::LE_AUDIO_SOFTWARE_DECODING_DATAPATH},
-        {SessionType_2_1::LE_AUDIO_HARDWARE_OFFLOAD_ENCODING_DATAPATH,
-         SessionType::LE_AUDIO_HARDWARE_OFFLOAD_ENCODING_DATAPATH},
-        {SessionType_2_1::LE_AUDIO_HARDWARE_OFFLOAD_DECODING_DATAPATH,
-         SessionType::LE_AUDIO_HARDWARE_OFFLOAD_DECODING_DATAPATH},
-    };
-
-const static std::unordered_map<int32_t, SampleRate_2_1>
-    sample_rate_to_hidl_2_1_map{
-        {44100, SampleRate_2_1::RATE_44100},
-        {48000, SampleRate_2_1::RATE_48000},
-        {88200, SampleRate_2_1::RATE_88200},
-        {96000, SampleRate_2_1::RATE_96000},
-        {176400, SampleRate_2_1::RATE_176400},
-        {192000, SampleRate_2_1::RATE_192000},
-        {16000, SampleRate_2_1::RATE_16000},
-        {24000, SampleRate_2_1::RATE_24000},
-        {8000, SampleRate_2_1::RATE_8000},
-        {32000, SampleRate_2_1::RATE_32000},
-    };
-
-const static std::unordered_map<CodecType, CodecType_2_0>
-    codec_type_to_hidl_2_0_map{
-        {CodecType::UNKNOWN, CodecType_2_0::UNKNOWN},
-        {CodecType::SBC, CodecType_2_0::SBC},
-        {CodecType::AAC, CodecType_2_0::AAC},
-        {CodecType::APTX, CodecType_2_0::APTX},
-        {CodecType::APTX_HD, CodecType_2_0::APTX_HD},
-        {CodecType::LDAC, CodecType_2_0::LDAC},
-        {CodecType::LC3, CodecType_2_0::UNKNOWN},
-    };
-
-const static std::unordered_map<SbcChannelMode, SbcChannelMode_2_0>
-    sbc_channel_mode_to_hidl_2_0_map{
-        {SbcChannelMode::UNKNOWN, SbcChannelMode_2_0::UNKNOWN},
-        {SbcChannelMode::JOINT_STEREO, SbcChannelMode_2_0::JOINT_STEREO},
-        {SbcChannelMode::STEREO, SbcChannelMode_2_0::STEREO},
-        {SbcChannelMode::DUAL, SbcChannelMode_2_0::DUAL},
-        {SbcChannelMode::MONO, SbcChannelMode_2_0::MONO},
-    };
-
-const static std::unordered_map<int8_t, SbcBlockLength_2_0>
-    sbc_block_length_to_hidl_map{
+// Indexed by the value of the source enum, which starts at 0 and has no gaps.
+constexpr std::array<SessionType, 8> session_type_2_1_to_aidl_table{
+    SessionType::UNKNOWN,
+    SessionType::A2DP_SOFTWARE_ENCODING_DATAPATH,
+    SessionType::A2DP_HARDWARE_OFFLOAD_ENCODING_DATAPATH,
+    SessionType::HEARING_AID_SOFTWARE_ENCODING_DATAPATH,
+    SessionType::LE_AUDIO_SOFTWARE_ENCODING_DATAPATH,
+    SessionType::LE_AUDIO_SOFTWARE_DECODING_DATAPATH,
+    SessionType::LE_AUDIO_HARDWARE_OFFLOAD_ENCODING_DATAPATH,
+    SessionType::LE_AUDIO_HARDWARE_OFFLOAD_DECODING_DATAPATH,
+};
+static_assert(
+    static_cast<size_t>(
+        SessionType_2_1::LE_AUDIO_HARDWARE_OFFLOAD_DECODING_DATAPATH) ==
+    session_type_2_1_to_aidl_table.size() - 1);
+
+constexpr std::pair<int32_t, SampleRate_2_1> sample_rate_to_hidl_2_1_table[]{
+    {44100, SampleRate_2_1::RATE_44100},
+    {48000, SampleRate_2_1::RATE_48000},
+    {88200, SampleRate_2_1::RATE_88200},
+    {96000, SampleRate_2_1::RATE_96000},
+    {176400, SampleRate_2_1::RATE_176400},
+    {192000, SampleRate_2_1::RATE_192000},
+    {16000, SampleRate_2_1::RATE_16000},
+    {24000, SampleRate_2_1::RATE_24000},
+    {8000, SampleRate_2_1::RATE_8000},
+    {32000, SampleRate_2_1::RATE_32000},
+};
+
+constexpr std::array<CodecType_2_0, 7> codec_type_to_hidl_2_0_table{
+    CodecType_2_0::UNKNOWN,  // UNKNOWN
+    CodecType_2_0::SBC,      // SBC
+    CodecType_2_0::AAC,      // AAC
+    CodecType_2_0::APTX,     // APTX
+    CodecType_2_0::APTX_HD,  // APTX_HD
+    CodecType_2_0::LDAC,     // LDAC
+    CodecType_2_0::UNKNOWN,  // LC3
+};
+static_assert(static_cast<size_t>(CodecType::LC3) ==
+              codec_type_to_hidl_2_0_table.size() - 1);
+
+constexpr std::array<SbcChannelMode_2_0, 5> sbc_channel_mode_to_hidl_2_0_table{
+    SbcChannelMode_2_0::UNKNOWN,       // UNKNOWN
+    SbcChannelMode_2_0::JOINT_STEREO,  // JOINT_STEREO
+    SbcChannelMode_2_0::STEREO,        // STEREO
+    SbcChannelMode_2_0::DUAL,          // DUAL
+    SbcChannelMode_2_0::MONO,          // MONO
+};
+static_assert(static_cast<size_t>(SbcChannelMode::MONO) ==
+              sbc_channel_mode_to_hidl_2_0_table.size() - 1);
+
+constexpr std::pair<int8_t, SbcBlockLength_2_0>
+    sbc_block_length_to_hidl_table[]{
         {4, SbcBlockLength_2_0::BLOCKS_4},
         {8, SbcBlockLength_2_0::BLOCKS_8},
         {12, SbcBlockLength_2_0::BLOCKS_12},
         {16, SbcBlockLength_2_0::BLOCKS_16},
     };
 
-const static std::unordered_map<int8_t, SbcNumSubbands_2_0>
-    sbc_subbands_to_hidl_map{
-        {4, SbcNumSubbands_2_0::SUBBAND_4},
-        {8, SbcNumSubbands_2_0::SUBBAND_8},
-    };
-
-const static std::unordered_map<SbcAllocMethod, SbcAllocMethod_2_0>
-    sbc_alloc_method_to_hidl_map{
-        {SbcAllocMethod::ALLOC_MD_S, SbcAllocMethod_2_0::ALLOC_MD_S},
-        {SbcAllocMethod::ALLOC_MD_L, SbcAllocMethod_2_0::ALLOC_MD_L},
-    };
-
-const static std::unordered_map<AacObjectType, AacObjectType_2_0>
-    aac_object_type_to_hidl_map{
-        {AacObjectType::MPEG2_LC, AacObjectType_2_0::MPEG2_LC},
-        {AacObjectType::MPEG4_LC, AacObjectType_2_0::MPEG4_LC},
-        {AacObjectType::MPEG4_LTP, AacObjectType_2_0::MPEG4_LTP},
-        {AacObjectType::MPEG4_SCALABLE, AacObjectType_2_0::MPEG4_SCALABLE},
-    };
-
-const static std::unordered_map<LdacChannelMode, LdacChannelMode_2_0>
-    ldac_channel_mode_to_hidl_map{
-        {LdacChannelMode::UNKNOWN, LdacChannelMode_2_0::UNKNOWN},
-        {LdacChannelMode::STEREO, LdacChannelMode_2_0::STEREO},
-        {LdacChannelMode::DUAL, LdacChannelMode_2_0::DUAL},
-        {LdacChannelMode::MONO, LdacChannelMode_2_0::MONO},
-    };
-
-const static std::unordered_map<LdacQualityIndex, LdacQualityIndex_2_0>
-    ldac_qindex_to_hidl_map{
-        {LdacQualityIndex::HIGH, LdacQualityIndex_2_0::QUALITY_HIGH},
-        {LdacQualityIndex::MID, LdacQualityIndex_2_0::QUALITY_MID},
-        {LdacQualityIndex::LOW, LdacQualityIndex_2_0::QUALITY_LOW},
-        {LdacQualityIndex::ABR, LdacQualityIndex_2_0::QUALITY_ABR},
-    };
+constexpr std::pair<int8_t, SbcNumSubbands_2_0> sbc_subbands_to_hidl_table[]{
+    {4, SbcNumSubbands_2_0::SUBBAND_4},
+    {8, SbcNumSubbands_2_0::SUBBAND_8},
+};
+
+constexpr std::array<SbcAllocMethod_2_0, 2> sbc_alloc_method_to_hidl_table{
+    SbcAllocMethod_2_0::ALLOC_MD_S,  // ALLOC_MD_S
+    SbcAllocMethod_2_0::ALLOC_MD_L,  // ALLOC_MD_L
+};
+static_assert(static_cast<size_t>(SbcAllocMethod::ALLOC_MD_L) ==
+              sbc_alloc_method_to_hidl_table.size() - 1);
+
+constexpr std::array<AacObjectType_2_0, 4> aac_object_type_to_hidl_table{
+    AacObjectType_2_0::MPEG2_LC,        // MPEG2_LC
+    AacObjectType_2_0::MPEG4_LC,        // MPEG4_LC
+    AacObjectType_2_0::MPEG4_LTP,       // MPEG4_LTP
+    AacObjectType_2_0::MPEG4_SCALABLE,  // MPEG4_SCALABLE
+};
+static_assert(static_cast<size_t>(AacObjectType::MPEG4_SCALABLE) ==
+              aac_object_type_to_hidl_table.size() - 1);
+
+constexpr std::array<LdacChannelMode_2_0, 4> ldac_channel_mode_to_hidl_table{
+    LdacChannelMode_2_0::UNKNOWN,  // UNKNOWN
+    LdacChannelMode_2_0::STEREO,   // STEREO
+    LdacChannelMode_2_0::DUAL,     // DUAL
+    LdacChannelMode_2_0::MONO,     // MONO
+};
+static_assert(static_cast<size_t>(LdacChannelMode::MONO) ==
+              ldac_channel_mode_to_hidl_table.size() - 1);
+
+constexpr std::array<LdacQualityIndex_2_0, 4> ldac_qindex_to_hidl_table{
+    LdacQualityIndex_2_0::QUALITY_HIGH,  // HIGH
+    LdacQualityIndex_2_0::QUALITY_MID,   // MID
+    LdacQualityIndex_2_0::QUALITY_LOW,   // LOW
+    LdacQualityIndex_2_0::QUALITY_ABR,   // ABR
+};
+static_assert(static_cast<size_t>(LdacQualityIndex::ABR) ==
+              ldac_qindex_to_hidl_table.size() - 1);
+
+template <typename Key, typename Value, size_t N>
+constexpr std::optional<Value> lookup(const std::array<Value, N>& table,
+                                      Key key) {
+  const auto index = static_cast<size_t>(key);
+  if (index >= N) return std::nullopt;
+  return table[index];
+}
+
+template <typename Key, typename Value, size_t N>
+constexpr std::optional<Value> lookup(const std::pair<Key, Value> (&table)[N],
+                                      Key key) {
+  for (const auto& [table_key, value] : table) {
+    if (table_key == key) return value;
+  }
+  return std::nullopt;
+}
 
 inline SessionType from_session_type_2_1(
     const SessionType_2_1& session_type_hidl) {
-  auto it = session_type_2_1_to_aidl_map.find(session_type_hidl);
-  if (it != session_type_2_1_to_aidl_map.end()) return it->second;
-  return SessionType::UNKNOWN;
+  return lookup(session_type_2_1_to_aidl_table, session_type_hidl)
+      .value_or(SessionType::UNKNOWN);
 }
 
 inline SessionType from_session_type_2_0(
@@ -207,15 +228,13 @@ inline HidlStatus to_hidl_status(const BluetoothAudioStatus& status) {
 }
 
 inline SampleRate_2_1 to_hidl_sample_rate_2_1(const int32_t sample_rate_hz) {
-  auto it = sample_rate_to_hidl_2_1_map.find(sample_rate_hz);
-  if (it != sample_rate_to_hidl_2_1_map.end()) return it->second;
-  return SampleRate_2_1::RATE_UNKNOWN;
+  return lookup(sample_rate_to_hidl_2_1_table, sample_rate_hz)
+      .value_or(SampleRate_2_1::RATE_UNKNOWN);
 }
 
 inline SampleRate_2_0 to_hidl_sample_rate_2_0(const int32_t sample_rate_hz) {
-  auto it = sample_rate_to_hidl_2_1_map.find(sample_rate_hz);
-  if (it != sample_rate_to_hidl_2_1_map.end())
-    return static_cast<SampleRate_2_0>(it->second);
+  auto sample_rate = lookup(sample_rate_to_hidl_2_1_table, sample_rate_hz);
+  if (sample_rate) return static_cast<SampleRate_2_0>(*sample_rate);
   return SampleRate_2_0::RATE_UNKNOWN;
 }
 
@@ -254,9 +273,8 @@ inline PcmConfig_2_0 to_hidl_pcm_config_2_0(
 }
 
 inline CodecType_2_0 to_hidl_codec_type_2_0(const CodecType codec_type) {
-  auto it = codec_type_to_hidl_2_0_map.find(codec_type);
-  if (it != codec_type_to_hidl_2_0_map.end()) return it->second;
-  return CodecType_2_0::UNKNOWN;
+  return lookup(codec_type_to_hidl_2_0_table, codec_type)
+      .value_or(CodecType_2_0::UNKNOWN);
 }
 
 inline SbcConfig_2_0 to_hidl_sbc_config(const SbcConfiguration sbc_config) {
@@ -266,25 +284,21 @@ inline SbcConfig_2_0 to_hidl_sbc_config(const SbcConfiguration sbc_config) {
   hidl_sbc_config.sampleRate = to_hidl_sample_rate_2_0(sbc_config.sampleRateHz);
   hidl_sbc_config.bitsPerSample =
       to_hidl_bits_per_sample(sbc_config.bitsPerSample);
-  if (sbc_channel_mode_to_hidl_2_0_map.find(sbc_config.channelMode) !=
-      sbc_channel_mode_to_hidl_2_0_map.end()) {
-    hidl_sbc_config.channelMode =
-        sbc_channel_mode_to_hidl_2_0_map.at(sbc_config.channelMode);
+  if (auto channel_mode = lookup(sbc_channel_mode_to_hidl_2_0_table,
+                                 sbc_config.channelMode)) {
+    hidl_sbc_config.channelMode = *channel_mode;
   }
-  if (sbc_block_length_to_hidl_map.find(sbc_config.blockLength) !=
-      sbc_block_length_to_hidl_map.end()) {
-    hidl_sbc_config.blockLength =
-        sbc_block_length_to_hidl_map.at(sbc_config.blockLength);
+  if (auto block_length =
+          lookup(sbc_block_length_to_hidl_table, sbc_config.blockLength)) {
+    hidl_sbc_config.blockLength = *block_length;
   }
-  if (sbc_subbands_to_hidl_map.find(sbc_config.numSubbands) !=
-      sbc_subbands_to_hidl_map.end()) {
-    hidl_sbc_config.numSubbands =
-        sbc_subbands_to_hidl_map.at(sbc_config.numSubbands);
+  if (auto num_subbands =
+          lookup(sbc_subbands_to_hidl_table, sbc_config.numSubbands)) {
+    hidl_sbc_config.numSubbands = *num_subbands;
   }
-  if (sbc_alloc_method_to_hidl_map.find(sbc_config.allocMethod) !=
-      sbc_alloc_method_to_hidl_map.end()) {
-    hidl_sbc_config.allocMethod =
-        sbc_alloc_method_to_hidl_map.at(sbc_config.allocMethod);
+  if (auto alloc_method =
+          lookup(sbc_alloc_method_to_hidl_table, sbc_config.allocMethod)) {
+    hidl_sbc_config.allocMethod = *alloc_method;
   }
   return hidl_sbc_config;
 }
@@ -295,10 +309,9 @@ inline AacConfig_2_0 to_hidl_aac_config(const AacConfiguration aac_config) {
   hidl_aac_config.bitsPerSample =
       to_hidl_bits_per_sample(aac_config.bitsPerSample);
   hidl_aac_config.channelMode = to_hidl_channel_mode(aac_config.channelMode);
-  if (aac_object_type_to_hidl_map.find(aac_config.objectType) !=
-      aac_object_type_to_hidl_map.end()) {
-    hidl_aac_config.objectType =
-        aac_object_type_to_hidl_map.at(aac_config.objectType);
+  if (auto object_type =
+          lookup(aac_object_type_to_hidl_table, aac_config.objectType)) {
+    hidl_aac_config.objectType = *object_type;
   }
   hidl_aac_config.variableBitRateEnabled = aac_config.variableBitRateEnabled
                                                ? AacVarBitRate_2_0::ENABLED
@@ -312,15 +325,13 @@ inline LdacConfig_2_0 to_hidl_ldac_config(const LdacConfiguration ldac_config) {
       to_hidl_sample_rate_2_0(ldac_config.sampleRateHz);
   hidl_ldac_config.bitsPerSample =
       to_hidl_bits_per_sample(ldac_config.bitsPerSample);
-  if (ldac_channel_mode_to_hidl_map.find(ldac_config.channelMode) !=
-      ldac_channel_mode_to_hidl_map.end()) {
-    hidl_ldac_config.channelMode =
-        ldac_channel_mode_to_hidl_map.at(ldac_config.channelMode);
+  if (auto channel_mode =
+          lookup(ldac_channel_mode_to_hidl_table, ldac_config.channelMode)) {
+    hidl_ldac_config.channelMode = *channel_mode;
   }
-  if (ldac_qindex_to_hidl_map.find(ldac_config.qualityIndex) !=
-      ldac_qindex_to_hidl_map.end()) {
-    hidl_ldac_config.qualityIndex =
-        ldac_qindex_to_hidl_map.at(ldac_config.qualityIndex);
+  if (auto quality_index =
+          lookup(ldac_qindex_to_hidl_table, ldac_config.qualityIndex)) {
+    hidl_ldac_config.qualityIndex = *quality_index;
   }
   return hidl_ldac_config;
 }
@@ -479,6 +490,38 @@ inline AudioConfig_2_1 to_hidl_audio_config_2_1(
   return hidl_audio_config;
 }
 
+// The HIDL configuration last converted for a session type, and the AIDL one
+// it was converted from. A session or configuration change shows as a
+// different AIDL configuration.
+template <typename HidlConfig>
+struct CachedAudioConfig {
+  AudioConfiguration aidl_config;
+  HidlConfig hidl_config;
+};
+
+std::mutex audio_config_cache_lock;
+std::unordered_map<SessionType, CachedAudioConfig<AudioConfig_2_0>>
+    audio_config_2_0_cache;
+std::unordered_map<SessionType, CachedAudioConfig<AudioConfig_2_1>>
+    audio_config_2_1_cache;
+
+template <typename HidlConfig, typename Converter>
+HidlConfig GetCachedAudioConfig(
+    std::unordered_map<SessionType, CachedAudioConfig<HidlConfig>>& cache,
+    const SessionType& session_type, Converter convert) {
+  const AudioConfiguration audio_config =
+      BluetoothAudioSessionControl::GetAudioConfig(session_type);
+  std::lock_guard<std::mutex> guard(audio_config_cache_lock);
+  auto it = cache.find(session_type);
+  if (it == cache.end() || !(it->second.aidl_config == audio_config)) {
+    it = cache.insert_or_assign(session_type,
+                                CachedAudioConfig<HidlConfig>{
+                                    audio_config, convert(audio_config)})
+             .first;
+  }
+  return it->second.hidl_config;
+}
+
 /***
  *
  * 2.0
@@ -550,8 +593,9 @@ void HidlToAidlMiddleware_2_0::UnregisterControlResultCback(
 
 const AudioConfig_2_0 HidlToAidlMiddleware_2_0::GetAudioConfig(
     const SessionType_2_0& session_type) {
-  return to_hidl_audio_config_2_0(BluetoothAudioSessionControl::GetAudioConfig(
-      from_session_type_2_0(session_type)));
+  return GetCachedAudioConfig(audio_config_2_0_cache,
+                              from_session_type_2_0(session_type),
+                              to_hidl_audio_config_2_0);
 }
 
 bool HidlToAidlMiddleware_2_0::StartStream(
@@ -621,8 +665,9 @@ bool HidlToAidlMiddleware_2_0::IsAidlAvailable() {
 
 const AudioConfig_2_1 HidlToAidlMiddleware_2_1::GetAudioConfig(
     const SessionType_2_1& session_type) {
-  return to_hidl_audio_config_2_1(BluetoothAudioSessionControl::GetAudioConfig(
-      from_session_type_2_1(session_type)));
+  return GetCachedAudioConfig(audio_config_2_1_cache,
+                              from_session_type_2_1(session_type),
+                              to_hidl_audio_config_2_1);
 }
 
 }  // namespace audio
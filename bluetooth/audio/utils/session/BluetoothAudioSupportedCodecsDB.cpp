@@ -114,18 +114,10 @@ const std::vector<CodecCapabilities> kDefaultOffloadA2dpCodecCapabilities = {
     {.codecType = CodecType::APTX, .capabilities = {}},
     {.codecType = CodecType::APTX_HD, .capabilities = {}}};
 
+// Whether exactly one bit of the bitfield is set in the bitmasks
 static bool IsSingleBit(uint32_t bitmasks, uint32_t bitfield) {
-  bool single = false;
-  uint32_t test_bit = 0x00000001;
-  while (test_bit <= bitmasks && test_bit <= bitfield) {
-    if (bitfield & test_bit && bitmasks & test_bit) {
-      if (single) return false;
-      single = true;
-    }
-    if (test_bit == 0x80000000) break;
-    test_bit <<= 1;
-  }
-  return single;
+  const uint32_t bits = bitmasks & bitfield;
+  return bits != 0 && (bits & (bits - 1)) == 0;
 }
 
 static bool IsOffloadSbcConfigurationValid(
@@ -300,11 +292,7 @@ std::vector<PcmParameters> GetSoftwarePcmCapabilities() {
   return std::vector<PcmParameters>(1, kDefaultSoftwarePcmCapabilities);
 }
 
-std::vector<CodecCapabilities> GetOffloadCodecCapabilities(
-    const SessionType& session_type) {
-  if (session_type != SessionType::A2DP_HARDWARE_OFFLOAD_DATAPATH) {
-    return std::vector<CodecCapabilities>(0);
-  }
+static std::vector<CodecCapabilities> BuildOffloadA2dpCodecCapabilities() {
   std::vector<CodecCapabilities> offload_a2dp_codec_capabilities =
       kDefaultOffloadA2dpCodecCapabilities;
   for (auto& codec_capability : offload_a2dp_codec_capabilities) {
@@ -337,6 +325,17 @@ std::vector<CodecCapabilities> GetOffloadCodecCapabilities(
   return offload_a2dp_codec_capabilities;
 }
 
+std::vector<CodecCapabilities> GetOffloadCodecCapabilities(
+    const SessionType& session_type) {
+  if (session_type != SessionType::A2DP_HARDWARE_OFFLOAD_DATAPATH) {
+    return std::vector<CodecCapabilities>(0);
+  }
+  // The capabilities never change, so they are only filled in once
+  static const std::vector<CodecCapabilities> offload_a2dp_codec_capabilities =
+      BuildOffloadA2dpCodecCapabilities();
+  return offload_a2dp_codec_capabilities;
+}
+
 bool IsSoftwarePcmConfigurationValid(const PcmParameters& pcm_config) {
   if ((pcm_config.sampleRate != SampleRate::RATE_44100 &&
        pcm_config.sampleRate != SampleRate::RATE_48000 &&
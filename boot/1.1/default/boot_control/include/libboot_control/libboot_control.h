@@ -16,10 +16,13 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include <android/hardware/boot/1.1/IBootControl.h>
 
+struct bootloader_control;
+
 namespace android {
 namespace bootable {
 
@@ -28,6 +31,9 @@ class BootControl {
   using MergeStatus = ::android::hardware::boot::V1_1::MergeStatus;
 
  public:
+  BootControl();
+  ~BootControl();
+
   bool Init();
   unsigned int GetNumberSlots();
   unsigned int GetCurrentSlot();
@@ -61,6 +67,17 @@ class BootControl {
 
   // The slot where we are running from.
   unsigned int current_slot_ = 0;
+
+  // Returns the copy of the bootloader_control in misc, reading it only if
+  // no valid copy is cached yet, or nullptr if it could not be read.
+  bootloader_control* GetBootloaderControl();
+  // Writes the cached bootloader_control to misc.
+  bool SaveBootloaderControl();
+
+  // The bootloader_control as last read from or written to misc. Only the
+  // bootloader and this HAL write it, so while Android runs the slot queries
+  // are answered from memory.
+  std::unique_ptr<bootloader_control> boot_ctrl_;
 };
 
 // Helper functions to write the Virtual A/B merge status message. These are
@@ -189,6 +189,10 @@ int SlotSuffixToIndex(const char* suffix) {
   return -1;
 }
 
+BootControl::BootControl() = default;
+
+BootControl::~BootControl() = default;
+
 // Initialize the boot_control_private struct with the information from
 // the bootloader_message buffer stored in |boot_ctrl|. Returns whether the
 // initialization succeeded.
@@ -212,8 +216,8 @@ bool BootControl::Init() {
     return false;
   }
 
-  bootloader_control boot_ctrl;
-  if (!LoadBootloaderControl(device.c_str(), &boot_ctrl)) {
+  auto boot_ctrl = std::make_unique<bootloader_control>();
+  if (!LoadBootloaderControl(device.c_str(), boot_ctrl.get())) {
     LOG(ERROR) << "Failed to load bootloader control block";
     return false;
   }
@@ -225,19 +229,44 @@ bool BootControl::Init() {
 
   // Validate the loaded data, otherwise we will destroy it and re-initialize it
   // with the current information.
-  uint32_t computed_crc32 = BootloaderControlLECRC(&boot_ctrl);
-  if (boot_ctrl.crc32_le != computed_crc32) {
+  uint32_t computed_crc32 = BootloaderControlLECRC(boot_ctrl.get());
+  if (boot_ctrl->crc32_le != computed_crc32) {
     LOG(WARNING) << "Invalid boot control found, expected CRC-32 0x" << std::hex << computed_crc32
-                 << " but found 0x" << std::hex << boot_ctrl.crc32_le << ". Re-initializing.";
-    InitDefaultBootloaderControl(this, &boot_ctrl);
-    UpdateAndSaveBootloaderControl(device.c_str(), &boot_ctrl);
+                 << " but found 0x" << std::hex << boot_ctrl->crc32_le << ". Re-initializing.";
+    InitDefaultBootloaderControl(this, boot_ctrl.get());
+    UpdateAndSaveBootloaderControl(device.c_str(), boot_ctrl.get());
   }
+  boot_ctrl_ = std::move(boot_ctrl);
 
   if (!InitMiscVirtualAbMessageIfNeeded()) {
     return false;
   }
 
-  num_slots_ = boot_ctrl.nb_slot;
+  num_slots_ = boot_ctrl_->nb_slot;
+  return true;
+}
+
+bootloader_control* BootControl::GetBootloaderControl() {
+  // Only trust the cached copy while it matches its own CRC-32, e.g. after a
+  // failed write it is dropped and read back from misc.
+  if (boot_ctrl_ && boot_ctrl_->crc32_le == BootloaderControlLECRC(boot_ctrl_.get())) {
+    return boot_ctrl_.get();
+  }
+  auto boot_ctrl = std::make_unique<bootloader_control>();
+  if (!LoadBootloaderControl(misc_device_, boot_ctrl.get())) {
+    boot_ctrl_.reset();
+    return nullptr;
+  }
+  boot_ctrl_ = std::move(boot_ctrl);
+  return boot_ctrl_.get();
+}
+
+bool BootControl::SaveBootloaderControl() {
+  if (!UpdateAndSaveBootloaderControl(misc_device_, boot_ctrl_.get())) {
+    // We don't know what made it to the disk, read it again next time.
+    boot_ctrl_.reset();
+    return false;
+  }
   return true;
 }
 
@@ -250,28 +279,28 @@ unsigned int BootControl::GetCurrentSlot() {
 }
 
 bool BootControl::MarkBootSuccessful() {
-  bootloader_control bootctrl;
-  if (!LoadBootloaderControl(misc_device_, &bootctrl)) return false;
+  bootloader_control* bootctrl = GetBootloaderControl();
+  if (!bootctrl) return false;
 
-  bootctrl.slot_info[current_slot_].successful_boot = 1;
+  bootctrl->slot_info[current_slot_].successful_boot = 1;
   // tries_remaining == 0 means that the slot is not bootable anymore, make
   // sure we mark the current slot as bootable if it succeeds in the last
   // attempt.
-  bootctrl.slot_info[current_slot_].tries_remaining = 1;
-  return UpdateAndSaveBootloaderControl(misc_device_, &bootctrl);
+  bootctrl->slot_info[current_slot_].tries_remaining = 1;
+  return SaveBootloaderControl();
 }
 
 unsigned int BootControl::GetActiveBootSlot() {
-  bootloader_control bootctrl;
-  if (!LoadBootloaderControl(misc_device_, &bootctrl)) return false;
+  bootloader_control* bootctrl = GetBootloaderControl();
+  if (!bootctrl) return false;
 
   // Use the current slot by default.
   unsigned int active_boot_slot = current_slot_;
-  unsigned int max_priority = bootctrl.slot_info[current_slot_].priority;
+  unsigned int max_priority = bootctrl->slot_info[current_slot_].priority;
   // Find the slot with the highest priority.
   for (unsigned int i = 0; i < num_slots_; ++i) {
-    if (bootctrl.slot_info[i].priority > max_priority) {
-      max_priority = bootctrl.slot_info[i].priority;
+    if (bootctrl->slot_info[i].priority > max_priority) {
+      max_priority = bootctrl->slot_info[i].priority;
       active_boot_slot = i;
     }
   }
@@ -285,32 +314,32 @@ bool BootControl::SetActiveBootSlot(unsigned int slot) {
     return false;
   }
 
-  bootloader_control bootctrl;
-  if (!LoadBootloaderControl(misc_device_, &bootctrl)) return false;
+  bootloader_control* bootctrl = GetBootloaderControl();
+  if (!bootctrl) return false;
 
   // Set every other slot with a lower priority than the new "active" slot.
   const unsigned int kActivePriority = 15;
   const unsigned int kActiveTries = 6;
   for (unsigned int i = 0; i < num_slots_; ++i) {
     if (i != slot) {
-      if (bootctrl.slot_info[i].priority >= kActivePriority)
-        bootctrl.slot_info[i].priority = kActivePriority - 1;
+      if (bootctrl->slot_info[i].priority >= kActivePriority)
+        bootctrl->slot_info[i].priority = kActivePriority - 1;
     }
   }
 
   // Note that setting a slot as active doesn't change the successful bit.
   // The successful bit will only be changed by setSlotAsUnbootable().
-  bootctrl.slot_info[slot].priority = kActivePriority;
-  bootctrl.slot_info[slot].tries_remaining = kActiveTries;
+  bootctrl->slot_info[slot].priority = kActivePriority;
+  bootctrl->slot_info[slot].tries_remaining = kActiveTries;
 
   // Setting the current slot as active is a way to revert the operation that
   // set *another* slot as active at the end of an updater. This is commonly
   // used to cancel the pending update. We should only reset the verity_corrpted
   // bit when attempting a new slot, otherwise the verity bit on the current
   // slot would be flip.
-  if (slot != current_slot_) bootctrl.slot_info[slot].verity_corrupted = 0;
+  if (slot != current_slot_) bootctrl->slot_info[slot].verity_corrupted = 0;
 
-  return UpdateAndSaveBootloaderControl(misc_device_, &bootctrl);
+  return SaveBootloaderControl();
 }
 
 bool BootControl::SetSlotAsUnbootable(unsigned int slot) {
@@ -319,14 +348,14 @@ bool BootControl::SetSlotAsUnbootable(unsigned int slot) {
     return false;
   }
 
-  bootloader_control bootctrl;
-  if (!LoadBootloaderControl(misc_device_, &bootctrl)) return false;
+  bootloader_control* bootctrl = GetBootloaderControl();
+  if (!bootctrl) return false;
 
   // The only way to mark a slot as unbootable, regardless of the priority is to
   // set the tries_remaining to 0.
-  bootctrl.slot_info[slot].successful_boot = 0;
-  bootctrl.slot_info[slot].tries_remaining = 0;
-  return UpdateAndSaveBootloaderControl(misc_device_, &bootctrl);
+  bootctrl->slot_info[slot].successful_boot = 0;
+  bootctrl->slot_info[slot].tries_remaining = 0;
+  return SaveBootloaderControl();
 }
 
 bool BootControl::IsSlotBootable(unsigned int slot) {
@@ -335,10 +364,10 @@ bool BootControl::IsSlotBootable(unsigned int slot) {
     return false;
   }
 
-  bootloader_control bootctrl;
-  if (!LoadBootloaderControl(misc_device_, &bootctrl)) return false;
+  bootloader_control* bootctrl = GetBootloaderControl();
+  if (!bootctrl) return false;
 
-  return bootctrl.slot_info[slot].tries_remaining != 0;
+  return bootctrl->slot_info[slot].tries_remaining != 0;
 }
 
 bool BootControl::IsSlotMarkedSuccessful(unsigned int slot) {
@@ -347,10 +376,10 @@ bool BootControl::IsSlotMarkedSuccessful(unsigned int slot) {
     return false;
   }
 
-  bootloader_control bootctrl;
-  if (!LoadBootloaderControl(misc_device_, &bootctrl)) return false;
+  bootloader_control* bootctrl = GetBootloaderControl();
+  if (!bootctrl) return false;
 
-  return bootctrl.slot_info[slot].successful_boot && bootctrl.slot_info[slot].tries_remaining;
+  return bootctrl->slot_info[slot].successful_boot && bootctrl->slot_info[slot].tries_remaining;
 }
 
 bool BootControl::IsValidSlot(unsigned int slot) {
@@ -34,7 +34,6 @@ using utils::tunesTo;
 using std::lock_guard;
 using std::move;
 using std::mutex;
-using std::sort;
 using std::vector;
 
 namespace delay {
@@ -46,8 +45,9 @@ static constexpr auto list = 1s;
 
 }  // namespace delay
 
-TunerSession::TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& callback)
-    : mCallback(callback), mModule(module) {
+TunerSession::TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& callback,
+                           size_t maxChunkSize)
+    : mCallback(callback), mModule(module), mMaxChunkSize(std::max<size_t>(maxChunkSize, 1)) {
     auto&& ranges = module.getAmFmConfig().ranges;
     if (ranges.size() > 0) {
         tuneInternalLocked(utils::make_selector_amfm(ranges[0].lowerBound));
@@ -125,7 +125,7 @@ Return<Result> TunerSession::scan(bool directionUp, bool skipSubChannel) {
 
     cancelLocked();
 
-    auto list = virtualRadio().getProgramList();
+    auto&& list = virtualRadio().getProgramList();
 
     if (list.empty()) {
         mIsTuneCompleted = false;
@@ -139,9 +139,7 @@ Return<Result> TunerSession::scan(bool directionUp, bool skipSubChannel) {
         return Result::OK;
     }
 
-    // Not optimal (O(sort) instead of O(n)), but not a big deal here;
-    // also, it's likely that list is already sorted (so O(n) anyway).
-    sort(list.begin(), list.end());
+    // The list is sorted in scan order already.
     auto current = mCurrentProgram;
     auto found = lower_bound(list.begin(), list.end(), VirtualProgram({current}));
     if (directionUp) {
@@ -234,30 +232,64 @@ Return<Result> TunerSession::startProgramListUpdates(const ProgramFilter& filter
     lock_guard<mutex> lk(mMut);
     if (mIsClosed) return Result::INVALID_STATE;
 
-    auto list = virtualRadio().getProgramList();
-    vector<VirtualProgram> filteredList;
-    auto filterCb = [&filter](const VirtualProgram& program) {
-        return utils::satisfies(filter, program.selector);
-    };
-    std::copy_if(list.begin(), list.end(), std::back_inserter(filteredList), filterCb);
+    auto list = virtualRadio().getProgramList(filter);
+    mIsProgramListActive = true;
 
     auto task = [this, list]() {
         lock_guard<mutex> lk(mMut);
+        if (!mIsProgramListActive) return;
 
-        ProgramListChunk chunk = {};
-        chunk.purge = true;
-        chunk.complete = true;
-        chunk.modified = hidl_vec<ProgramInfo>(list.begin(), list.end());
-
-        mCallback->onProgramListUpdated(chunk);
+        sendProgramListLocked(list);
     };
     mThread.schedule(task, delay::list);
 
     return Result::OK;
 }
 
+void TunerSession::sendProgramListLocked(const vector<VirtualProgram>& list) {
+    std::set<std::pair<uint32_t, uint64_t>> ids;
+    for (auto&& program : list) {
+        ids.emplace(program.selector.primaryId.type, program.selector.primaryId.value);
+    }
+
+    // If the client has the list for a previous filter, only send what the new filter changed.
+    const bool purge = !mSentProgramIds.has_value();
+    vector<ProgramInfo> modified;
+    vector<ProgramIdentifier> removed;
+    for (auto&& program : list) {
+        auto&& id = program.selector.primaryId;
+        if (purge || mSentProgramIds->count({id.type, id.value}) == 0) modified.push_back(program);
+    }
+    if (!purge) {
+        for (auto&& [type, value] : *mSentProgramIds) {
+            if (ids.count({type, value}) == 0) removed.push_back({type, value});
+        }
+    }
+    mSentProgramIds = move(ids);
+
+    // Removed identifiers go with the first chunk, modified programs are split into chunks of
+    // at most mMaxChunkSize, and only the last chunk marks the update complete.
+    size_t sent = 0;
+    do {
+        const size_t count = std::min(mMaxChunkSize, modified.size() - sent);
+
+        ProgramListChunk chunk = {};
+        chunk.purge = purge && sent == 0;
+        chunk.complete = sent + count == modified.size();
+        chunk.modified = hidl_vec<ProgramInfo>(modified.begin() + sent,
+                                               modified.begin() + sent + count);
+        if (sent == 0) chunk.removed = removed;
+
+        mCallback->onProgramListUpdated(chunk);
+        sent += count;
+    } while (sent < modified.size());
+}
+
 Return<void> TunerSession::stopProgramListUpdates() {
     LOG(DEBUG) << "requested program list updates to stop";
+    lock_guard<mutex> lk(mMut);
+    mIsProgramListActive = false;
+    mSentProgramIds.reset();
     return {};
 }
 
@@ -23,6 +23,7 @@
 #include <broadcastradio-utils/WorkerThread.h>
 
 #include <optional>
+#include <set>
 
 namespace android {
 namespace hardware {
@@ -33,7 +34,14 @@ namespace implementation {
 struct BroadcastRadio;
 
 struct TunerSession : public ITunerSession {
-    TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& callback);
+    static constexpr size_t kDefaultMaxChunkSize = 100;
+
+    /**
+     * \param maxChunkSize Maximum number of modified programs sent in a single
+     *        ProgramListChunk.
+     */
+    TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& callback,
+                 size_t maxChunkSize = kDefaultMaxChunkSize);
 
     // V2_0::ITunerSession methods
     virtual Return<Result> tune(const ProgramSelector& program) override;
@@ -63,7 +71,14 @@ struct TunerSession : public ITunerSession {
     bool mIsTuneCompleted = false;
     ProgramSelector mCurrentProgram = {};
 
+    const size_t mMaxChunkSize;
+    bool mIsProgramListActive = false;
+    // Primary identifiers (type, value) of the programs the client got with the last update,
+    // or nullopt if it has to be sent the whole list.
+    std::optional<std::set<std::pair<uint32_t, uint64_t>>> mSentProgramIds;
+
     void cancelLocked();
+    void sendProgramListLocked(const std::vector<VirtualProgram>& list);
     void tuneInternalLocked(const ProgramSelector& sel);
     const VirtualRadio& virtualRadio() const;
     const BroadcastRadio& module() const;
@@ -17,15 +17,14 @@
 
 #include <broadcastradio-utils-2x/Utils.h>
 
+#include <algorithm>
+
 namespace android {
 namespace hardware {
 namespace broadcastradio {
 namespace V2_0 {
 namespace implementation {
 
-using std::lock_guard;
-using std::move;
-using std::mutex;
 using std::vector;
 using utils::make_selector_amfm;
 using utils::make_selector_dab;
@@ -52,21 +51,80 @@ VirtualRadio gDabRadio(
     });
 // clang-format on
 
+static vector<VirtualProgram> sortPrograms(vector<VirtualProgram> programs) {
+    std::sort(programs.begin(), programs.end());
+    return programs;
+}
+
 VirtualRadio::VirtualRadio(const std::string& name, const vector<VirtualProgram>& initialList)
-    : mName(name), mPrograms(initialList) {}
+    : mName(name), mPrograms(sortPrograms(initialList)), mIndex([this] {
+          Index index;
+          for (size_t i = 0; i < mPrograms.size(); i++) {
+              for (auto&& id : mPrograms[i].selector) {
+                  index[id.type].emplace(id.value, i);
+              }
+          }
+          return index;
+      }()) {}
 
 std::string VirtualRadio::getName() const {
     return mName;
 }
 
-vector<VirtualProgram> VirtualRadio::getProgramList() const {
-    lock_guard<mutex> lk(mMut);
+const vector<VirtualProgram>& VirtualRadio::getProgramList() const {
     return mPrograms;
 }
 
+vector<VirtualProgram> VirtualRadio::getProgramList(const ProgramFilter& filter) const {
+    // Only programs carrying one of the filter's identifiers (or identifier types) can satisfy it,
+    // so only those are checked.
+    vector<size_t> candidates;
+    if (filter.identifiers.size() > 0) {
+        for (auto&& id : filter.identifiers) {
+            auto byType = mIndex.find(id.type);
+            if (byType == mIndex.end()) continue;
+            auto range = byType->second.equal_range(id.value);
+            for (auto it = range.first; it != range.second; it++) {
+                candidates.push_back(it->second);
+            }
+        }
+    } else if (filter.identifierTypes.size() > 0) {
+        for (auto&& type : filter.identifierTypes) {
+            auto byType = mIndex.find(type);
+            if (byType == mIndex.end()) continue;
+            for (auto&& [value, position] : byType->second) {
+                candidates.push_back(position);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < mPrograms.size(); i++) candidates.push_back(i);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    vector<VirtualProgram> programs;
+    for (auto position : candidates) {
+        auto&& program = mPrograms[position];
+        if (utils::satisfies(filter, program.selector)) programs.push_back(program);
+    }
+    return programs;
+}
+
 bool VirtualRadio::getProgram(const ProgramSelector& selector, VirtualProgram& programOut) const {
-    lock_guard<mutex> lk(mMut);
-    for (auto&& program : mPrograms) {
+    // A program can only be tuned to by a selector sharing one of its identifiers.
+    vector<size_t> candidates;
+    for (auto&& id : selector) {
+        auto byType = mIndex.find(id.type);
+        if (byType == mIndex.end()) continue;
+        auto range = byType->second.equal_range(id.value);
+        for (auto it = range.first; it != range.second; it++) {
+            candidates.push_back(it->second);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (auto position : candidates) {
+        auto&& program = mPrograms[position];
         if (utils::tunesTo(selector, program.selector)) {
             programOut = program;
             return true;
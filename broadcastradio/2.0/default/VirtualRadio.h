@@ -18,7 +18,7 @@
 
 #include "VirtualProgram.h"
 
-#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
@@ -40,13 +40,27 @@ class VirtualRadio {
     VirtualRadio(const std::string& name, const std::vector<VirtualProgram>& initialList);
 
     std::string getName() const;
-    std::vector<VirtualProgram> getProgramList() const;
+
+    /**
+     * All programs, in the order ITunerSession::scan() visits them.
+     *
+     * The programs on the air don't change after construction, so the list is valid for the
+     * lifetime of the radio and can be used without locking.
+     */
+    const std::vector<VirtualProgram>& getProgramList() const;
+
+    /** Programs matching the filter, looked up through the identifier index. */
+    std::vector<VirtualProgram> getProgramList(const ProgramFilter& filter) const;
+
     bool getProgram(const ProgramSelector& selector, VirtualProgram& program) const;
 
    private:
-    mutable std::mutex mMut;
-    std::string mName;
-    std::vector<VirtualProgram> mPrograms;
+    // For each identifier type, positions in mPrograms of the programs by identifier value.
+    using Index = std::unordered_map<uint32_t, std::unordered_multimap<uint64_t, size_t>>;
+
+    const std::string mName;
+    const std::vector<VirtualProgram> mPrograms;
+    const Index mIndex;
 };
 
 /** AM/FM virtual radio space. */
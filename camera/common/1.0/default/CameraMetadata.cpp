@@ -20,6 +20,9 @@
 #include <log/log.h>
 #include <utils/Errors.h>
 
+#include <atomic>
+#include <vector>
+
 #include "CameraMetadata.h"
 #include "VendorTagDescriptor.h"
 
@@ -33,6 +36,8 @@ namespace helper {
 #define ALIGN_TO(val, alignment) \
     (((uintptr_t)(val) + ((alignment) - 1)) & ~((alignment) - 1))
 
+static std::atomic<uint64_t> sResizeCount{0};
+
 CameraMetadata::CameraMetadata() :
         mBuffer(NULL), mLocked(false) {
 }
@@ -347,6 +352,83 @@ status_t CameraMetadata::updateImpl(uint32_t tag, const void *data,
     return res;
 }
 
+status_t CameraMetadata::merge(const CameraMetadata &other) {
+    if (mLocked) {
+        ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
+        return INVALID_OPERATION;
+    }
+    if (other.mBuffer == NULL || other.mBuffer == mBuffer) {
+        return OK;
+    }
+    size_t otherEntryCount = get_camera_metadata_entry_count(other.mBuffer);
+    size_t otherDataCount = get_camera_metadata_data_count(other.mBuffer);
+    // Covers every entry being added or growing, so nothing below reallocates
+    status_t res = resizeIfNeeded(otherEntryCount, otherDataCount);
+    if (res != OK) {
+        return res;
+    }
+
+    // The updates of existing entries keep the buffer sorted, so they all use binary search
+    sort();
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < otherEntryCount; i++) {
+        camera_metadata_ro_entry_t entry;
+        get_camera_metadata_ro_entry(other.mBuffer, i, &entry);
+        camera_metadata_entry_t existing;
+        res = find_camera_metadata_entry(mBuffer, entry.tag, &existing);
+        if (res == NAME_NOT_FOUND) {
+            missing.push_back(i);
+            continue;
+        }
+        if (res == OK) {
+            res = update_camera_metadata_entry(mBuffer, existing.index, entry.data.u8,
+                    entry.count, NULL);
+        }
+        if (res != OK) {
+            ALOGE("%s: Unable to update metadata entry %x: %s (%d)", __FUNCTION__, entry.tag,
+                    strerror(-res), res);
+            return res;
+        }
+    }
+    for (size_t i : missing) {
+        camera_metadata_ro_entry_t entry;
+        get_camera_metadata_ro_entry(other.mBuffer, i, &entry);
+        res = add_camera_metadata_entry(mBuffer, entry.tag, entry.data.u8, entry.count);
+        if (res != OK) {
+            ALOGE("%s: Unable to add metadata entry %x: %s (%d)", __FUNCTION__, entry.tag,
+                    strerror(-res), res);
+            return res;
+        }
+    }
+    return missing.empty() ? OK : sort();
+}
+
+status_t CameraMetadata::reserve(size_t entryCapacity, size_t dataCapacity) {
+    if (mLocked) {
+        ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
+        return INVALID_OPERATION;
+    }
+    if (mBuffer != NULL && get_camera_metadata_entry_capacity(mBuffer) >= entryCapacity &&
+            get_camera_metadata_data_capacity(mBuffer) >= dataCapacity) {
+        return OK;
+    }
+    camera_metadata_t *newBuffer = allocate_camera_metadata(entryCapacity, dataCapacity);
+    if (newBuffer == NULL) {
+        ALOGE("%s: Can't allocate larger metadata buffer", __FUNCTION__);
+        return NO_MEMORY;
+    }
+    if (mBuffer != NULL) {
+        append_camera_metadata(newBuffer, mBuffer);
+        free_camera_metadata(mBuffer);
+    }
+    mBuffer = newBuffer;
+    return OK;
+}
+
+uint64_t CameraMetadata::getResizeCount() {
+    return sResizeCount.load(std::memory_order_relaxed);
+}
+
 bool CameraMetadata::exists(uint32_t tag) const {
     camera_metadata_ro_entry entry;
     return find_camera_metadata_ro_entry(mBuffer, tag, &entry) == 0;
@@ -441,6 +523,7 @@ status_t CameraMetadata::resizeIfNeeded(size_t extraEntries, size_t extraData) {
             }
             append_camera_metadata(mBuffer, oldBuffer);
             free_camera_metadata(oldBuffer);
+            sResizeCount.fetch_add(1, std::memory_order_relaxed);
         }
     }
     return OK;
@@ -18,6 +18,9 @@
 #define ATRACE_TAG ATRACE_TAG_CAMERA
 //#define LOG_NDEBUG 0
 
+#include <thread>
+#include <vector>
+
 #include <utils/Trace.h>
 
 #include "CameraModule.h"
@@ -225,7 +228,8 @@ void CameraModule::appendAvailableKeys(CameraMetadata &chars,
     chars.update(keyTag, availableKeys);
 }
 
-CameraModule::CameraModule(camera_module_t *module) : mNumberOfCameras(0) {
+CameraModule::CameraModule(camera_module_t *module) : mNumberOfCameras(0),
+        mCameraInfoCache(std::make_shared<const CameraInfoCache>()) {
     if (module == NULL) {
         ALOGE("%s: camera hardware module must not be null", __FUNCTION__);
         assert(0);
@@ -233,24 +237,81 @@ CameraModule::CameraModule(camera_module_t *module) : mNumberOfCameras(0) {
     mModule = module;
 }
 
-CameraModule::~CameraModule()
-{
-    while (mCameraInfoMap.size() > 0) {
-        camera_info cameraInfo = mCameraInfoMap.editValueAt(0);
-        if (cameraInfo.static_camera_characteristics != NULL) {
-            free_camera_metadata(
-                    const_cast<camera_metadata_t*>(cameraInfo.static_camera_characteristics));
-        }
-        mCameraInfoMap.removeItemsAt(0);
+CameraModule::~CameraModule() {}
+
+std::shared_ptr<const CameraModule::CameraInfoEntry> CameraModule::createCameraInfoEntry(
+        const camera_info& rawInfo) {
+    CameraMetadata m;
+    m.append(rawInfo.static_camera_characteristics);
+    deriveCameraCharacteristicsKeys(rawInfo.device_version, m);
+    auto entry = std::make_shared<CameraInfoEntry>();
+    entry->info = rawInfo;
+    entry->characteristics.acquire(m);
+    // Lock it before it is shared, it must not change anymore
+    entry->info.static_camera_characteristics = entry->characteristics.getAndLock();
+    return entry;
+}
+
+std::shared_ptr<const CameraModule::CameraInfoEntry> CameraModule::createPhysicalCameraInfoEntry(
+        const camera_metadata_t* rawInfo) {
+    // The camera_metadata_t returned by get_physical_camera_info could be using
+    // more memory than necessary due to unused reserved space. Reduce the
+    // size by appending it to a new CameraMetadata object, which internally
+    // calls resizeIfNeeded.
+    auto entry = std::make_shared<CameraInfoEntry>();
+    entry->info = {};
+    entry->characteristics.append(rawInfo);
+    entry->info.static_camera_characteristics = entry->characteristics.getAndLock();
+    return entry;
+}
+
+std::shared_ptr<const CameraModule::CameraInfoCache> CameraModule::loadCameraInfoCache() const {
+    return std::atomic_load(&mCameraInfoCache);
+}
+
+void CameraModule::publishCameraInfoCacheLocked(std::shared_ptr<const CameraInfoCache> cache) {
+    std::atomic_store(&mCameraInfoCache, std::move(cache));
+}
+
+void CameraModule::populateCameraInfoCache() {
+    ATRACE_CALL();
+    if (getModuleApiVersion() < CAMERA_MODULE_API_VERSION_2_0) {
+        return;
     }
 
-    while (mPhysicalCameraInfoMap.size() > 0) {
-        camera_metadata_t* metadata = mPhysicalCameraInfoMap.editValueAt(0);
-        if (metadata != NULL) {
-            free_camera_metadata(metadata);
+    Mutex::Autolock lock(mCameraInfoLock);
+    // The module isn't required to handle concurrent calls, only deriving the keys runs in
+    // parallel. Cameras that fail here are left to getCameraInfo, which reports the failure.
+    std::vector<std::pair<int, camera_info>> rawInfos;
+    for (int i = 0; i < mNumberOfCameras; i++) {
+        camera_info rawInfo;
+        ATRACE_BEGIN("camera_module->get_camera_info");
+        int ret = mModule->get_camera_info(i, &rawInfo);
+        ATRACE_END();
+        if (ret == 0 && rawInfo.device_version >= CAMERA_DEVICE_API_VERSION_3_0) {
+            rawInfos.emplace_back(i, rawInfo);
         }
-        mPhysicalCameraInfoMap.removeItemsAt(0);
     }
+
+    std::vector<std::shared_ptr<const CameraInfoEntry>> entries(rawInfos.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < rawInfos.size(); i++) {
+        threads.emplace_back([&rawInfos, &entries, i] {
+            entries[i] = createCameraInfoEntry(rawInfos[i].second);
+        });
+    }
+    if (!rawInfos.empty()) {
+        entries[0] = createCameraInfoEntry(rawInfos[0].second);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto cache = std::make_shared<CameraInfoCache>(*loadCameraInfoCache());
+    for (size_t i = 0; i < rawInfos.size(); i++) {
+        cache->cameras[rawInfos[i].first] = std::move(entries[i]);
+    }
+    publishCameraInfoCacheLocked(std::move(cache));
 }
 
 int CameraModule::init() {
@@ -263,13 +324,14 @@ int CameraModule::init() {
         ATRACE_END();
     }
     mNumberOfCameras = getNumberOfCameras();
-    mCameraInfoMap.setCapacity(mNumberOfCameras);
+    if (res == OK) {
+        populateCameraInfoCache();
+    }
     return res;
 }
 
 int CameraModule::getCameraInfo(int cameraId, struct camera_info *info) {
     ATRACE_CALL();
-    Mutex::Autolock lock(mCameraInfoLock);
     if (cameraId < 0) {
         ALOGE("%s: Invalid camera ID %d", __FUNCTION__, cameraId);
         return -EINVAL;
@@ -278,6 +340,7 @@ int CameraModule::getCameraInfo(int cameraId, struct camera_info *info) {
     // Only override static_camera_characteristics for API2 devices
     int apiVersion = mModule->common.module_api_version;
     if (apiVersion < CAMERA_MODULE_API_VERSION_2_0) {
+        Mutex::Autolock lock(mCameraInfoLock);
         int ret;
         ATRACE_BEGIN("camera_module->get_camera_info");
         ret = mModule->get_camera_info(cameraId, info);
@@ -288,39 +351,70 @@ int CameraModule::getCameraInfo(int cameraId, struct camera_info *info) {
         return ret;
     }
 
-    ssize_t index = mCameraInfoMap.indexOfKey(cameraId);
-    if (index == NAME_NOT_FOUND) {
-        // Get camera info from raw module and cache it
-        camera_info rawInfo, cameraInfo;
-        ATRACE_BEGIN("camera_module->get_camera_info");
-        int ret = mModule->get_camera_info(cameraId, &rawInfo);
-        ATRACE_END();
-        if (ret != 0) {
-            return ret;
-        }
-        int deviceVersion = rawInfo.device_version;
-        if (deviceVersion < CAMERA_DEVICE_API_VERSION_3_0) {
-            // static_camera_characteristics is invalid
-            *info = rawInfo;
-            return ret;
+    auto cache = loadCameraInfoCache();
+    auto it = cache->cameras.find(cameraId);
+    if (it == cache->cameras.end()) {
+        Mutex::Autolock lock(mCameraInfoLock);
+        // Another thread may have cached it in the meantime
+        cache = loadCameraInfoCache();
+        it = cache->cameras.find(cameraId);
+        if (it == cache->cameras.end()) {
+            // Get camera info from raw module and cache it
+            camera_info rawInfo;
+            ATRACE_BEGIN("camera_module->get_camera_info");
+            int ret = mModule->get_camera_info(cameraId, &rawInfo);
+            ATRACE_END();
+            if (ret != 0) {
+                return ret;
+            }
+            int deviceVersion = rawInfo.device_version;
+            if (deviceVersion < CAMERA_DEVICE_API_VERSION_3_0) {
+                // static_camera_characteristics is invalid
+                *info = rawInfo;
+                return ret;
+            }
+            auto newCache = std::make_shared<CameraInfoCache>(*cache);
+            it = newCache->cameras.emplace(cameraId, createCameraInfoEntry(rawInfo)).first;
+            cache = newCache;
+            publishCameraInfoCacheLocked(std::move(newCache));
         }
-        CameraMetadata m;
-        m.append(rawInfo.static_camera_characteristics);
-        deriveCameraCharacteristicsKeys(rawInfo.device_version, m);
-        cameraInfo = rawInfo;
-        cameraInfo.static_camera_characteristics = m.release();
-        index = mCameraInfoMap.add(cameraId, cameraInfo);
     }
 
-    assert(index != NAME_NOT_FOUND);
     // return the cached camera info
-    *info = mCameraInfoMap[index];
+    *info = it->second->info;
     return OK;
 }
 
+std::shared_ptr<const camera_metadata_t> CameraModule::getCameraCharacteristics(int cameraId) {
+    auto cache = loadCameraInfoCache();
+    auto it = cache->cameras.find(cameraId);
+    if (it == cache->cameras.end()) {
+        camera_info info;
+        if (getCameraInfo(cameraId, &info) != OK) {
+            return nullptr;
+        }
+        cache = loadCameraInfoCache();
+        it = cache->cameras.find(cameraId);
+        if (it == cache->cameras.end()) {
+            return nullptr;
+        }
+    }
+    return std::shared_ptr<const camera_metadata_t>(
+            it->second, it->second->info.static_camera_characteristics);
+}
+
 int CameraModule::getPhysicalCameraInfo(int physicalCameraId, camera_metadata_t **physicalInfo) {
+    std::shared_ptr<const camera_metadata_t> characteristics;
+    int ret = getPhysicalCameraCharacteristics(physicalCameraId, &characteristics);
+    if (ret == OK) {
+        *physicalInfo = const_cast<camera_metadata_t*>(characteristics.get());
+    }
+    return ret;
+}
+
+int CameraModule::getPhysicalCameraCharacteristics(int physicalCameraId,
+        std::shared_ptr<const camera_metadata_t>* characteristics) {
     ATRACE_CALL();
-    Mutex::Autolock lock(mCameraInfoLock);
     if (physicalCameraId < mNumberOfCameras) {
         ALOGE("%s: Invalid physical camera ID %d", __FUNCTION__, physicalCameraId);
         return -EINVAL;
@@ -338,29 +432,32 @@ int CameraModule::getPhysicalCameraInfo(int physicalCameraId, camera_metadata_t
         return -EINVAL;
     }
 
-    ssize_t index = mPhysicalCameraInfoMap.indexOfKey(physicalCameraId);
-    if (index == NAME_NOT_FOUND) {
-        // Get physical camera characteristics, and cache it
-        camera_metadata_t *info = nullptr;
-        ATRACE_BEGIN("camera_module->get_physical_camera_info");
-        int ret = mModule->get_physical_camera_info(physicalCameraId, &info);
-        ATRACE_END();
-        if (ret != 0) {
-            return ret;
-        }
+    auto cache = loadCameraInfoCache();
+    auto it = cache->physicalCameras.find(physicalCameraId);
+    if (it == cache->physicalCameras.end()) {
+        Mutex::Autolock lock(mCameraInfoLock);
+        cache = loadCameraInfoCache();
+        it = cache->physicalCameras.find(physicalCameraId);
+        if (it == cache->physicalCameras.end()) {
+            // Get physical camera characteristics, and cache it
+            camera_metadata_t *info = nullptr;
+            ATRACE_BEGIN("camera_module->get_physical_camera_info");
+            int ret = mModule->get_physical_camera_info(physicalCameraId, &info);
+            ATRACE_END();
+            if (ret != 0) {
+                return ret;
+            }
 
-        // The camera_metadata_t returned by get_physical_camera_info could be using
-        // more memory than necessary due to unused reserved space. Reduce the
-        // size by appending it to a new CameraMetadata object, which internally
-        // calls resizeIfNeeded.
-        CameraMetadata m;
-        m.append(info);
-        camera_metadata_t* derivedMetadata = m.release();
-        index = mPhysicalCameraInfoMap.add(physicalCameraId, derivedMetadata);
+            auto newCache = std::make_shared<CameraInfoCache>(*cache);
+            it = newCache->physicalCameras.emplace(physicalCameraId,
+                    createPhysicalCameraInfoEntry(info)).first;
+            cache = newCache;
+            publishCameraInfoCacheLocked(std::move(newCache));
+        }
     }
 
-    assert(index != NAME_NOT_FOUND);
-    *physicalInfo = mPhysicalCameraInfoMap[index];
+    *characteristics = std::shared_ptr<const camera_metadata_t>(
+            it->second, it->second->info.static_camera_characteristics);
     return OK;
 }
 
@@ -529,29 +626,28 @@ status_t CameraModule::filterOpenErrorCode(status_t err) {
 }
 
 void CameraModule::removeCamera(int cameraId) {
-    // Skip HAL1 devices which isn't cached in mCameraInfoMap and don't advertise
+    Mutex::Autolock lock(mCameraInfoLock);
+    auto cache = loadCameraInfoCache();
+    // Skip HAL1 devices which aren't cached and don't advertise
     // static_camera_characteristics
-    if (getDeviceVersion(cameraId) >= CAMERA_DEVICE_API_VERSION_3_0) {
+    auto it = cache->cameras.find(cameraId);
+    if (it != cache->cameras.end()) {
+        auto newCache = std::make_shared<CameraInfoCache>(*cache);
         std::unordered_set<std::string> physicalIds;
-        camera_metadata_t *metadata = const_cast<camera_metadata_t*>(
-                mCameraInfoMap.valueFor(cameraId).static_camera_characteristics);
-        common::V1_0::helper::CameraMetadata hidlMetadata(metadata);
-
-        if (isLogicalMultiCamera(hidlMetadata, &physicalIds)) {
+        if (isLogicalMultiCamera(it->second->characteristics, &physicalIds)) {
             for (const auto& id : physicalIds) {
                 int idInt = std::stoi(id);
-                if (mPhysicalCameraInfoMap.indexOfKey(idInt) >= 0) {
-                    free_camera_metadata(mPhysicalCameraInfoMap[idInt]);
-                    mPhysicalCameraInfoMap.removeItem(idInt);
-                } else {
+                if (newCache->physicalCameras.erase(idInt) == 0) {
                     ALOGE("%s: Cannot find corresponding static metadata for physical id %s",
                             __FUNCTION__, id.c_str());
                 }
             }
         }
+        newCache->cameras.erase(cameraId);
+        // The metadata is freed once no reader holds the previous cache anymore
+        publishCameraInfoCacheLocked(std::move(newCache));
     }
 
-    mCameraInfoMap.removeItem(cameraId);
     mDeviceVersionMap.removeItem(cameraId);
 }
 
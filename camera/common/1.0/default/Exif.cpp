@@ -23,6 +23,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdint.h>
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -49,6 +50,15 @@ namespace common {
 namespace V1_0 {
 namespace helper {
 
+// An entry of an IFD in a serialized APP1 segment.
+struct App1Entry {
+    ExifTag tag;
+    ExifFormat format;
+    unsigned long components;
+    // The offset and size of the entry data in the APP1 segment.
+    size_t offset;
+    size_t size;
+};
 
 class ExifUtilsImpl : public ExifUtils {
   public:
@@ -303,9 +313,25 @@ class ExifUtilsImpl : public ExifUtils {
                            const std::string& buffer,
                            const std::string& msg);
 
+    // Removes the entry of |tag| from |exif_data_| if it exists.
+    virtual void removeEntry(ExifIfd ifd, ExifTag tag);
+
     // Destroys the buffer of APP1 segment if exists.
     virtual void destroyApp1();
 
+    // Records where the data of each entry and the thumbnail are in
+    // |app1_buffer_|, so that the next generateApp1() with the same set of tags
+    // can patch the buffer instead of serializing |exif_data_| again.
+    virtual void buildApp1Template(bool has_thumbnail);
+
+    // Returns true if every entry of |exif_data_| has an entry of the same tag
+    // and size in the template.
+    virtual bool matchesApp1Template();
+
+    // Copies the data of the entries and the thumbnail into |app1_buffer_|.
+    // Returns false if the template does not match the current tags.
+    virtual bool patchApp1Template(const void* thumbnail_buffer, uint32_t size);
+
     // The Exif data (APP1). Owned by this class.
     ExifData* exif_data_;
     // The raw data of APP1 segment. It's allocated by ExifMem in |exif_data_| but
@@ -314,6 +340,15 @@ class ExifUtilsImpl : public ExifUtils {
     // The length of |app1_buffer_|.
     unsigned int app1_length_;
 
+    // Whether |app1_buffer_| can be patched by patchApp1Template().
+    bool template_valid_;
+    // The entries of each IFD in |app1_buffer_|, without the IFD pointers and
+    // the thumbnail tags that libexif generates.
+    std::vector<App1Entry> template_entries_[EXIF_IFD_COUNT];
+    // The offset of the thumbnail in |app1_buffer_|, 0 if there is none.
+    size_t template_thumbnail_offset_;
+    // The offset of the JPEGInterchangeFormatLength value in |app1_buffer_|.
+    size_t template_thumbnail_length_offset_;
 };
 
 #define SET_SHORT(ifd, tag, value)                      \
@@ -369,8 +404,65 @@ ExifUtils *ExifUtils::create() {
 ExifUtils::~ExifUtils() {
 }
 
+// The APP1 segment starts with the "Exif\0\0" identifier, followed by the TIFF
+// header. Offsets in the TIFF structure are relative to the TIFF header.
+static const size_t kTiffHeaderOffset = 6;
+// An IFD entry holds the tag, format, component count and value or value offset.
+static const size_t kIfdEntrySize = 12;
+
+// Reads the entries of the IFD at |ifd_offset| of the TIFF structure in |app1|
+// and the offset of the next IFD, which is 0 if there is none.
+// Returns false if the IFD or the data of an entry is out of bounds.
+static bool readApp1Ifd(const uint8_t* app1, size_t length, uint32_t ifd_offset,
+                        std::vector<App1Entry>* entries, uint32_t* next_ifd_offset) {
+    const uint8_t* tiff = app1 + kTiffHeaderOffset;
+    const uint64_t tiff_length = length - kTiffHeaderOffset;
+    if (uint64_t(ifd_offset) + 2 > tiff_length) {
+        return false;
+    }
+    const uint16_t count = exif_get_short(tiff + ifd_offset, EXIF_BYTE_ORDER_INTEL);
+    const uint64_t entries_offset = uint64_t(ifd_offset) + 2;
+    if (entries_offset + count * kIfdEntrySize + 4 > tiff_length) {
+        return false;
+    }
+    entries->clear();
+    for (uint16_t i = 0; i < count; i++) {
+        const uint8_t* data = tiff + entries_offset + i * kIfdEntrySize;
+        App1Entry entry;
+        entry.tag = static_cast<ExifTag>(exif_get_short(data, EXIF_BYTE_ORDER_INTEL));
+        entry.format = static_cast<ExifFormat>(exif_get_short(data + 2, EXIF_BYTE_ORDER_INTEL));
+        entry.components = exif_get_long(data + 4, EXIF_BYTE_ORDER_INTEL);
+        const uint64_t size = uint64_t(exif_format_get_size(entry.format)) * entry.components;
+        // Values of up to 4 bytes are stored in the entry itself.
+        uint64_t data_offset = data + 8 - tiff;
+        if (size > 4) {
+            data_offset = exif_get_long(data + 8, EXIF_BYTE_ORDER_INTEL);
+        }
+        if (data_offset + size > tiff_length) {
+            return false;
+        }
+        entry.offset = kTiffHeaderOffset + data_offset;
+        entry.size = size;
+        entries->push_back(entry);
+    }
+    *next_ifd_offset = exif_get_long(tiff + entries_offset + count * kIfdEntrySize,
+                                     EXIF_BYTE_ORDER_INTEL);
+    return true;
+}
+
+static const App1Entry* findApp1Entry(const std::vector<App1Entry>& entries, ExifTag tag) {
+    for (const App1Entry& entry : entries) {
+        if (entry.tag == tag) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
 ExifUtilsImpl::ExifUtilsImpl()
-        : exif_data_(nullptr), app1_buffer_(nullptr), app1_length_(0) {}
+        : exif_data_(nullptr), app1_buffer_(nullptr), app1_length_(0),
+          template_valid_(false), template_thumbnail_offset_(0),
+          template_thumbnail_length_offset_(0) {}
 
 ExifUtilsImpl::~ExifUtilsImpl() {
     reset();
@@ -756,6 +848,9 @@ bool ExifUtilsImpl::setYResolution(uint32_t numerator, uint32_t denominator) {
 }
 
 bool ExifUtilsImpl::generateApp1(const void* thumbnail_buffer, uint32_t size) {
+    if (patchApp1Template(thumbnail_buffer, size)) {
+        return true;
+    }
     destroyApp1();
     exif_data_->data = const_cast<uint8_t*>(static_cast<const uint8_t*>(thumbnail_buffer));
     exif_data_->size = size;
@@ -774,6 +869,144 @@ bool ExifUtilsImpl::generateApp1(const void* thumbnail_buffer, uint32_t size) {
         ALOGE("%s: The size of APP1 segment is too large", __FUNCTION__);
         return false;
     }
+    buildApp1Template(thumbnail_buffer != nullptr && size > 0);
+    return true;
+}
+
+void ExifUtilsImpl::buildApp1Template(bool has_thumbnail) {
+    template_valid_ = false;
+    template_thumbnail_offset_ = 0;
+    template_thumbnail_length_offset_ = 0;
+    if (app1_length_ < kTiffHeaderOffset + 8) {
+        return;
+    }
+
+    // IFD0 links to IFD1 and points to the EXIF and GPS IFDs, and the EXIF IFD
+    // points to the interoperability IFD. IFDs that are not written stay at 0.
+    uint32_t ifd_offsets[EXIF_IFD_COUNT] = {};
+    ifd_offsets[EXIF_IFD_0] = exif_get_long(app1_buffer_ + kTiffHeaderOffset + 4,
+                                            EXIF_BYTE_ORDER_INTEL);
+    const ExifIfd kIfdOrder[] = {EXIF_IFD_0, EXIF_IFD_EXIF, EXIF_IFD_GPS,
+                                 EXIF_IFD_INTEROPERABILITY, EXIF_IFD_1};
+    uint32_t thumbnail_offset = 0;
+    for (ExifIfd ifd : kIfdOrder) {
+        std::vector<App1Entry>& entries = template_entries_[ifd];
+        entries.clear();
+        if (ifd_offsets[ifd] == 0) {
+            continue;
+        }
+        uint32_t next_ifd_offset = 0;
+        if (!readApp1Ifd(app1_buffer_, app1_length_, ifd_offsets[ifd], &entries,
+                         &next_ifd_offset)) {
+            ALOGW("%s: Cannot parse IFD %d of APP1 segment", __FUNCTION__, ifd);
+            return;
+        }
+        if (ifd == EXIF_IFD_0) {
+            ifd_offsets[EXIF_IFD_1] = next_ifd_offset;
+        }
+
+        // Drop the entries libexif generates, they are not in |exif_data_|.
+        auto generated = [&](const App1Entry& entry) {
+            const uint32_t value = exif_get_long(app1_buffer_ + entry.offset,
+                                                 EXIF_BYTE_ORDER_INTEL);
+            switch (entry.tag) {
+                case EXIF_TAG_EXIF_IFD_POINTER:
+                    ifd_offsets[EXIF_IFD_EXIF] = value;
+                    return true;
+                case EXIF_TAG_GPS_INFO_IFD_POINTER:
+                    ifd_offsets[EXIF_IFD_GPS] = value;
+                    return true;
+                case EXIF_TAG_INTEROPERABILITY_IFD_POINTER:
+                    ifd_offsets[EXIF_IFD_INTEROPERABILITY] = value;
+                    return true;
+                case EXIF_TAG_JPEG_INTERCHANGE_FORMAT:
+                    if (ifd != EXIF_IFD_1) {
+                        return false;
+                    }
+                    thumbnail_offset = value;
+                    return true;
+                case EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LENGTH:
+                    if (ifd != EXIF_IFD_1) {
+                        return false;
+                    }
+                    template_thumbnail_length_offset_ = entry.offset;
+                    return true;
+                default:
+                    return false;
+            }
+        };
+        entries.erase(std::remove_if(entries.begin(), entries.end(), generated), entries.end());
+    }
+
+    if (has_thumbnail) {
+        // The thumbnail is written last, so it can be replaced by one of any size.
+        if (thumbnail_offset == 0 || template_thumbnail_length_offset_ == 0 ||
+                kTiffHeaderOffset + thumbnail_offset + exif_data_->size != app1_length_) {
+            ALOGW("%s: Thumbnail is not at the end of APP1 segment", __FUNCTION__);
+            return;
+        }
+        template_thumbnail_offset_ = kTiffHeaderOffset + thumbnail_offset;
+    } else if (thumbnail_offset != 0) {
+        return;
+    }
+    template_valid_ = matchesApp1Template();
+}
+
+bool ExifUtilsImpl::matchesApp1Template() {
+    for (int ifd = 0; ifd < EXIF_IFD_COUNT; ifd++) {
+        const ExifContent* content = exif_data_->ifd[ifd];
+        const std::vector<App1Entry>& entries = template_entries_[ifd];
+        if (content->count != entries.size()) {
+            return false;
+        }
+        for (unsigned int i = 0; i < content->count; i++) {
+            const ExifEntry* entry = content->entries[i];
+            const App1Entry* app1Entry = findApp1Entry(entries, entry->tag);
+            if (app1Entry == nullptr || app1Entry->format != entry->format ||
+                    app1Entry->components != entry->components ||
+                    app1Entry->size != entry->size) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ExifUtilsImpl::patchApp1Template(const void* thumbnail_buffer, uint32_t size) {
+    const bool has_thumbnail = thumbnail_buffer != nullptr && size > 0;
+    if (!template_valid_ || has_thumbnail != (template_thumbnail_offset_ != 0) ||
+            !matchesApp1Template()) {
+        return false;
+    }
+
+    if (has_thumbnail) {
+        const size_t length = template_thumbnail_offset_ + size;
+        if (length > 65533) {
+            return false;
+        }
+        if (length != app1_length_) {
+            // |app1_buffer_| comes from the default allocator of libexif, see
+            // destroyApp1().
+            uint8_t* buffer = static_cast<uint8_t*>(realloc(app1_buffer_, length));
+            if (buffer == nullptr) {
+                return false;
+            }
+            app1_buffer_ = buffer;
+            app1_length_ = length;
+        }
+        memcpy(app1_buffer_ + template_thumbnail_offset_, thumbnail_buffer, size);
+        exif_set_long(app1_buffer_ + template_thumbnail_length_offset_, EXIF_BYTE_ORDER_INTEL,
+                      size);
+    }
+
+    for (int ifd = 0; ifd < EXIF_IFD_COUNT; ifd++) {
+        const ExifContent* content = exif_data_->ifd[ifd];
+        for (unsigned int i = 0; i < content->count; i++) {
+            const ExifEntry* entry = content->entries[i];
+            const App1Entry* app1Entry = findApp1Entry(template_entries_[ifd], entry->tag);
+            memcpy(app1_buffer_ + app1Entry->offset, entry->data, entry->size);
+        }
+    }
     return true;
 }
 
@@ -957,6 +1190,14 @@ void ExifUtilsImpl::destroyApp1() {
     free(app1_buffer_);
     app1_buffer_ = nullptr;
     app1_length_ = 0;
+    template_valid_ = false;
+}
+
+void ExifUtilsImpl::removeEntry(ExifIfd ifd, ExifTag tag) {
+    ExifEntry* entry = exif_content_get_entry(exif_data_->ifd[ifd], tag);
+    if (entry) {
+        exif_content_remove_entry(exif_data_->ifd[ifd], entry);
+    }
 }
 
 bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
@@ -992,6 +1233,7 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
         }
     } else {
         ALOGV("%s: Cannot find focal length in metadata.", __FUNCTION__);
+        removeEntry(EXIF_IFD_EXIF, EXIF_TAG_FOCAL_LENGTH);
     }
 
     if (metadata.exists(ANDROID_JPEG_GPS_COORDINATES)) {
@@ -1012,6 +1254,13 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: setting gps altitude failed.", __FUNCTION__);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_LATITUDE_REF));
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_LATITUDE));
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_LONGITUDE_REF));
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_LONGITUDE));
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_ALTITUDE_REF));
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_ALTITUDE));
     }
 
     if (metadata.exists(ANDROID_JPEG_GPS_PROCESSING_METHOD)) {
@@ -1021,6 +1270,8 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: setting gps processing method failed.", __FUNCTION__);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_PROCESSING_METHOD));
     }
 
     if (time_available && metadata.exists(ANDROID_JPEG_GPS_TIMESTAMP)) {
@@ -1035,6 +1286,9 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: Time tranformation failed.", __FUNCTION__);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_DATE_STAMP));
+        removeEntry(EXIF_IFD_GPS, static_cast<ExifTag>(EXIF_TAG_GPS_TIME_STAMP));
     }
 
     if (metadata.exists(ANDROID_JPEG_ORIENTATION)) {
@@ -1043,6 +1297,8 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: setting orientation failed.", __FUNCTION__);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_0, EXIF_TAG_ORIENTATION);
     }
 
     if (metadata.exists(ANDROID_SENSOR_EXPOSURE_TIME)) {
@@ -1052,6 +1308,8 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: setting exposure time failed.", __FUNCTION__);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_EXIF, EXIF_TAG_EXPOSURE_TIME);
     }
 
     if (metadata.exists(ANDROID_LENS_APERTURE)) {
@@ -1062,6 +1320,8 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: setting F number failed.", __FUNCTION__);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_EXIF, EXIF_TAG_FNUMBER);
     }
 
     if (metadata.exists(ANDROID_FLASH_INFO_AVAILABLE)) {
@@ -1076,6 +1336,8 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: Unsupported flash info: %d",__FUNCTION__, entry.data.u8[0]);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_EXIF, EXIF_TAG_FLASH);
     }
 
     if (metadata.exists(ANDROID_CONTROL_AWB_MODE)) {
@@ -1090,6 +1352,8 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: Unsupported awb mode: %d", __FUNCTION__, entry.data.u8[0]);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_EXIF, EXIF_TAG_WHITE_BALANCE);
     }
 
     if (time_available) {
@@ -1102,6 +1366,10 @@ bool ExifUtilsImpl::setFromMetadata(const CameraMetadata& metadata,
             ALOGE("%s: setting subsec time failed.", __FUNCTION__);
             return false;
         }
+    } else {
+        removeEntry(EXIF_IFD_EXIF, EXIF_TAG_SUB_SEC_TIME);
+        removeEntry(EXIF_IFD_EXIF, EXIF_TAG_SUB_SEC_TIME_ORIGINAL);
+        removeEntry(EXIF_IFD_EXIF, EXIF_TAG_SUB_SEC_TIME_DIGITIZED);
     }
 
     return true;
@@ -21,6 +21,12 @@
 #include "aidl/android/hardware/graphics/common/Smpte2086.h"
 #include <log/log.h>
 
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <iterator>
+
 namespace android {
 namespace hardware {
 namespace camera {
@@ -39,40 +45,55 @@ using MapperErrorV4 = android::hardware::graphics::mapper::V4_0::Error;
 using IMapperV3 = android::hardware::graphics::mapper::V3_0::IMapper;
 using IMapperV4 = android::hardware::graphics::mapper::V4_0::IMapper;
 
-HandleImporter::HandleImporter() : mInitialized(false) {}
-
-void HandleImporter::initializeLocked() {
-    if (mInitialized) {
-        return;
+// Times one per-buffer operation into its stats.
+class HandleImporter::ScopedOpTimer {
+public:
+    ScopedOpTimer(HandleImporter* importer, Op op)
+        : mStats(importer->mStats[static_cast<size_t>(op)]),
+          mStart(std::chrono::steady_clock::now()) {}
+
+    ~ScopedOpTimer() {
+        const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - mStart).count();
+        mStats.count.fetch_add(1, std::memory_order_relaxed);
+        mStats.totalNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t maxNs = mStats.maxNs.load(std::memory_order_relaxed);
+        while (ns > maxNs &&
+                !mStats.maxNs.compare_exchange_weak(maxNs, ns, std::memory_order_relaxed)) {
+        }
     }
 
-    mMapperV4 = IMapperV4::getService();
-    if (mMapperV4 != nullptr) {
-        mInitialized = true;
-        return;
-    }
+private:
+    AtomicOpStats& mStats;
+    const std::chrono::steady_clock::time_point mStart;
+};
 
-    mMapperV3 = IMapperV3::getService();
-    if (mMapperV3 != nullptr) {
-        mInitialized = true;
-        return;
-    }
+HandleImporter::HandleImporter() : mOps(nullptr) {}
 
-    mMapperV2 = IMapper::getService();
-    if (mMapperV2 == nullptr) {
-        ALOGE("%s: cannnot acccess graphics mapper HAL!", __FUNCTION__);
-        return;
-    }
+template<>
+const sp<IMapperV4>& HandleImporter::getMapper<IMapperV4>() const {
+    return mMapperV4;
+}
 
-    mInitialized = true;
-    return;
+template<>
+const sp<IMapperV3>& HandleImporter::getMapper<IMapperV3>() const {
+    return mMapperV3;
 }
 
-void HandleImporter::cleanup() {
-    mMapperV4.clear();
-    mMapperV3.clear();
-    mMapperV2.clear();
-    mInitialized = false;
+template<>
+const sp<IMapper>& HandleImporter::getMapper<IMapper>() const {
+    return mMapperV2;
+}
+
+const HandleImporter::MapperOps* HandleImporter::getOps() {
+    const MapperOps* ops = mOps.load(std::memory_order_acquire);
+    if (ops != nullptr) {
+        return ops;
+    }
+
+    Mutex::Autolock lock(mLock);
+    initializeLocked();
+    return mOps.load(std::memory_order_relaxed);
 }
 
 template<class M, class E>
@@ -239,6 +260,23 @@ YCbCrLayout HandleImporter::lockYCbCrInternal<IMapperV4, MapperErrorV4>(
     return layout;
 }
 
+// Returns a dup of the fence FD in a release fence handle, or -1 if there is none.
+int dupReleaseFence(const native_handle_t* fenceHandle) {
+    if (!fenceHandle) {
+        return -1;
+    }
+    if (fenceHandle->numInts != 0 || fenceHandle->numFds != 1) {
+        ALOGE("%s: bad release fence numInts %d numFds %d",
+                __FUNCTION__, fenceHandle->numInts, fenceHandle->numFds);
+        return -1;
+    }
+    int releaseFence = dup(fenceHandle->data[0]);
+    if (releaseFence < 0) {
+        ALOGE("%s: bad release fence FD %d", __FUNCTION__, releaseFence);
+    }
+    return releaseFence;
+}
+
 template<class M, class E>
 int HandleImporter::unlockInternal(const sp<M> mapper, buffer_handle_t& buf) {
     int releaseFence = -1;
@@ -247,19 +285,7 @@ int HandleImporter::unlockInternal(const sp<M> mapper, buffer_handle_t& buf) {
     mapper->unlock(
         buffer, [&](const auto& tmpError, const auto& tmpReleaseFence) {
             if (tmpError == E::NONE) {
-                auto fenceHandle = tmpReleaseFence.getNativeHandle();
-                if (fenceHandle) {
-                    if (fenceHandle->numInts != 0 || fenceHandle->numFds != 1) {
-                        ALOGE("%s: bad release fence numInts %d numFds %d",
-                                __FUNCTION__, fenceHandle->numInts, fenceHandle->numFds);
-                        return;
-                    }
-                    releaseFence = dup(fenceHandle->data[0]);
-                    if (releaseFence < 0) {
-                        ALOGE("%s: bad release fence FD %d",
-                                __FUNCTION__, releaseFence);
-                    }
-                }
+                releaseFence = dupReleaseFence(tmpReleaseFence.getNativeHandle());
             } else {
                 ALOGE("%s: failed to unlock error %d!", __FUNCTION__, tmpError);
             }
@@ -267,34 +293,121 @@ int HandleImporter::unlockInternal(const sp<M> mapper, buffer_handle_t& buf) {
     return releaseFence;
 }
 
-// In IComposer, any buffer_handle_t is owned by the caller and we need to
-// make a clone for hwcomposer2.  We also need to translate empty handle
-// to nullptr.  This function does that, in-place.
-bool HandleImporter::importBuffer(buffer_handle_t& handle) {
-    if (!handle->numFds && !handle->numInts) {
-        handle = nullptr;
-        return true;
+template<class M, class E>
+void* HandleImporter::lockInternal(const sp<M> mapper, buffer_handle_t& buf, uint64_t cpuUsage,
+        const IMapper::Rect& accessRegion) {
+    hidl_handle acquireFenceHandle;
+    auto buffer = const_cast<native_handle_t*>(buf);
+    void* ret = nullptr;
+
+    typename M::Rect accessRegionCopy = {accessRegion.left, accessRegion.top,
+            accessRegion.width, accessRegion.height};
+    mapper->lock(buffer, cpuUsage, accessRegionCopy, acquireFenceHandle,
+            [&](const auto& tmpError, const auto& tmpPtr) {
+                if (tmpError == E::NONE) {
+                    ret = tmpPtr;
+                } else {
+                    ALOGE("%s: failed to lock error %d!", __FUNCTION__, tmpError);
+                }
+           });
+    return ret;
+}
+
+template<>
+void* HandleImporter::lockInternal<IMapperV3, MapperErrorV3>(const sp<IMapperV3> mapper,
+        buffer_handle_t& buf, uint64_t cpuUsage, const IMapper::Rect& accessRegion) {
+    hidl_handle acquireFenceHandle;
+    auto buffer = const_cast<native_handle_t*>(buf);
+    void* ret = nullptr;
+
+    IMapperV3::Rect accessRegionV3{accessRegion.left, accessRegion.top, accessRegion.width,
+                                   accessRegion.height};
+    mapper->lock(buffer, cpuUsage, accessRegionV3, acquireFenceHandle,
+                 [&](const auto& tmpError, const auto& tmpPtr, const auto& /*bytesPerPixel*/,
+                     const auto& /*bytesPerStride*/) {
+                     if (tmpError == MapperErrorV3::NONE) {
+                         ret = tmpPtr;
+                     } else {
+                         ALOGE("%s: failed to lock error %d!", __FUNCTION__, tmpError);
+                     }
+                 });
+    return ret;
+}
+
+template<class M>
+void HandleImporter::freeBufferInternal(const sp<M> mapper, buffer_handle_t handle) {
+    auto ret = mapper->freeBuffer(const_cast<native_handle_t*>(handle));
+    if (!ret.isOk()) {
+        ALOGE("%s: mapper freeBuffer failed: %s", __FUNCTION__, ret.description().c_str());
     }
+}
 
-    Mutex::Autolock lock(mLock);
-    if (!mInitialized) {
-        initializeLocked();
+template<class M, class E>
+const HandleImporter::MapperOps HandleImporter::kMapperOps = {
+    [](HandleImporter* importer, buffer_handle_t& handle) {
+        return importer->importBufferInternal<M, E>(importer->getMapper<M>(), handle);
+    },
+    [](HandleImporter* importer, buffer_handle_t handle) {
+        importer->freeBufferInternal<M>(importer->getMapper<M>(), handle);
+    },
+    [](HandleImporter* importer, buffer_handle_t& buf, uint64_t cpuUsage,
+            const IMapper::Rect& accessRegion) {
+        return importer->lockInternal<M, E>(importer->getMapper<M>(), buf, cpuUsage,
+                accessRegion);
+    },
+    [](HandleImporter* importer, buffer_handle_t& buf, uint64_t cpuUsage,
+            const IMapper::Rect& accessRegion) {
+        return importer->lockYCbCrInternal<M, E>(importer->getMapper<M>(), buf, cpuUsage,
+                accessRegion);
+    },
+    [](HandleImporter* importer, buffer_handle_t& buf) {
+        return importer->unlockInternal<M, E>(importer->getMapper<M>(), buf);
+    },
+};
+
+void HandleImporter::initializeLocked() {
+    if (mOps.load(std::memory_order_relaxed) != nullptr) {
+        return;
     }
 
+    mMapperV4 = IMapperV4::getService();
     if (mMapperV4 != nullptr) {
-        return importBufferInternal<IMapperV4, MapperErrorV4>(mMapperV4, handle);
+        mOps.store(&kMapperOps<IMapperV4, MapperErrorV4>, std::memory_order_release);
+        return;
     }
 
+    mMapperV3 = IMapperV3::getService();
     if (mMapperV3 != nullptr) {
-        return importBufferInternal<IMapperV3, MapperErrorV3>(mMapperV3, handle);
+        mOps.store(&kMapperOps<IMapperV3, MapperErrorV3>, std::memory_order_release);
+        return;
     }
 
-    if (mMapperV2 != nullptr) {
-        return importBufferInternal<IMapper, MapperErrorV2>(mMapperV2, handle);
+    mMapperV2 = IMapper::getService();
+    if (mMapperV2 == nullptr) {
+        ALOGE("%s: cannnot acccess graphics mapper HAL!", __FUNCTION__);
+        return;
     }
 
-    ALOGE("%s: mMapperV4, mMapperV3 and mMapperV2 are all null!", __FUNCTION__);
-    return false;
+    mOps.store(&kMapperOps<IMapper, MapperErrorV2>, std::memory_order_release);
+}
+
+// In IComposer, any buffer_handle_t is owned by the caller and we need to
+// make a clone for hwcomposer2.  We also need to translate empty handle
+// to nullptr.  This function does that, in-place.
+bool HandleImporter::importBuffer(buffer_handle_t& handle) {
+    if (!handle->numFds && !handle->numInts) {
+        handle = nullptr;
+        return true;
+    }
+
+    const MapperOps* ops = getOps();
+    if (ops == nullptr) {
+        ALOGE("%s: mMapperV4, mMapperV3 and mMapperV2 are all null!", __FUNCTION__);
+        return false;
+    }
+
+    ScopedOpTimer timer(this, Op::IMPORT);
+    return ops->importBuffer(this, handle);
 }
 
 void HandleImporter::freeBuffer(buffer_handle_t handle) {
@@ -302,29 +415,19 @@ void HandleImporter::freeBuffer(buffer_handle_t handle) {
         return;
     }
 
-    Mutex::Autolock lock(mLock);
-    if (!mInitialized) {
-        initializeLocked();
+    const MapperOps* ops = getOps();
+    if (ops == nullptr) {
+        ALOGE("%s: mMapperV4, mMapperV3 and mMapperV2 are all null!", __FUNCTION__);
+        return;
     }
 
-    if (mMapperV4 != nullptr) {
-        auto ret = mMapperV4->freeBuffer(const_cast<native_handle_t*>(handle));
-        if (!ret.isOk()) {
-            ALOGE("%s: mapper freeBuffer failed: %s", __FUNCTION__, ret.description().c_str());
-        }
-    } else if (mMapperV3 != nullptr) {
-        auto ret = mMapperV3->freeBuffer(const_cast<native_handle_t*>(handle));
-        if (!ret.isOk()) {
-            ALOGE("%s: mapper freeBuffer failed: %s",
-                    __FUNCTION__, ret.description().c_str());
-        }
-    } else {
-        auto ret = mMapperV2->freeBuffer(const_cast<native_handle_t*>(handle));
-        if (!ret.isOk()) {
-            ALOGE("%s: mapper freeBuffer failed: %s",
-                    __FUNCTION__, ret.description().c_str());
-        }
+    {
+        Mutex::Autolock lock(mMappingsLock);
+        unlockPersistentLocked(handle);
     }
+
+    ScopedOpTimer timer(this, Op::FREE);
+    ops->freeBuffer(this, handle);
 }
 
 bool HandleImporter::importFence(const native_handle_t* handle, int& fd) const {
@@ -359,55 +462,16 @@ void* HandleImporter::lock(
 
 void* HandleImporter::lock(buffer_handle_t& buf, uint64_t cpuUsage,
                            const IMapper::Rect& accessRegion) {
-    Mutex::Autolock lock(mLock);
-
-    if (!mInitialized) {
-        initializeLocked();
-    }
-
-    void* ret = nullptr;
-
-    if (mMapperV4 == nullptr && mMapperV3 == nullptr && mMapperV2 == nullptr) {
+    const MapperOps* ops = getOps();
+    if (ops == nullptr) {
         ALOGE("%s: mMapperV4, mMapperV3 and mMapperV2 are all null!", __FUNCTION__);
-        return ret;
+        return nullptr;
     }
 
-    hidl_handle acquireFenceHandle;
-    auto buffer = const_cast<native_handle_t*>(buf);
-    if (mMapperV4 != nullptr) {
-        IMapperV4::Rect accessRegionV4{accessRegion.left, accessRegion.top, accessRegion.width,
-                                       accessRegion.height};
-
-        mMapperV4->lock(buffer, cpuUsage, accessRegionV4, acquireFenceHandle,
-                        [&](const auto& tmpError, const auto& tmpPtr) {
-                            if (tmpError == MapperErrorV4::NONE) {
-                                ret = tmpPtr;
-                            } else {
-                                ALOGE("%s: failed to lock error %d!", __FUNCTION__, tmpError);
-                            }
-                        });
-    } else if (mMapperV3 != nullptr) {
-        IMapperV3::Rect accessRegionV3{accessRegion.left, accessRegion.top, accessRegion.width,
-                                       accessRegion.height};
-
-        mMapperV3->lock(buffer, cpuUsage, accessRegionV3, acquireFenceHandle,
-                        [&](const auto& tmpError, const auto& tmpPtr, const auto& /*bytesPerPixel*/,
-                            const auto& /*bytesPerStride*/) {
-                            if (tmpError == MapperErrorV3::NONE) {
-                                ret = tmpPtr;
-                            } else {
-                                ALOGE("%s: failed to lock error %d!", __FUNCTION__, tmpError);
-                            }
-                        });
-    } else {
-        mMapperV2->lock(buffer, cpuUsage, accessRegion, acquireFenceHandle,
-                [&](const auto& tmpError, const auto& tmpPtr) {
-                    if (tmpError == MapperErrorV2::NONE) {
-                        ret = tmpPtr;
-                    } else {
-                        ALOGE("%s: failed to lock error %d!", __FUNCTION__, tmpError);
-                    }
-               });
+    void* ret;
+    {
+        ScopedOpTimer timer(this, Op::LOCK);
+        ret = ops->lock(this, buf, cpuUsage, accessRegion);
     }
 
     ALOGV("%s: ptr %p accessRegion.top: %d accessRegion.left: %d accessRegion.width: %d "
@@ -420,28 +484,14 @@ void* HandleImporter::lock(buffer_handle_t& buf, uint64_t cpuUsage,
 YCbCrLayout HandleImporter::lockYCbCr(
         buffer_handle_t& buf, uint64_t cpuUsage,
         const IMapper::Rect& accessRegion) {
-    Mutex::Autolock lock(mLock);
-
-    if (!mInitialized) {
-        initializeLocked();
-    }
-
-    if (mMapperV4 != nullptr) {
-        return lockYCbCrInternal<IMapperV4, MapperErrorV4>(mMapperV4, buf, cpuUsage, accessRegion);
-    }
-
-    if (mMapperV3 != nullptr) {
-        return lockYCbCrInternal<IMapperV3, MapperErrorV3>(
-                mMapperV3, buf, cpuUsage, accessRegion);
-    }
-
-    if (mMapperV2 != nullptr) {
-        return lockYCbCrInternal<IMapper, MapperErrorV2>(
-                mMapperV2, buf, cpuUsage, accessRegion);
+    const MapperOps* ops = getOps();
+    if (ops == nullptr) {
+        ALOGE("%s: mMapperV4, mMapperV3 and mMapperV2 are all null!", __FUNCTION__);
+        return {};
     }
 
-    ALOGE("%s: mMapperV4, mMapperV3 and mMapperV2 are all null!", __FUNCTION__);
-    return {};
+    ScopedOpTimer timer(this, Op::LOCK_YCBCR);
+    return ops->lockYCbCr(this, buf, cpuUsage, accessRegion);
 }
 
 status_t HandleImporter::getMonoPlanarStrideBytes(buffer_handle_t &buf, uint32_t *stride /*out*/) {
@@ -449,13 +499,7 @@ status_t HandleImporter::getMonoPlanarStrideBytes(buffer_handle_t &buf, uint32_t
         return BAD_VALUE;
     }
 
-    Mutex::Autolock lock(mLock);
-
-    if (!mInitialized) {
-        initializeLocked();
-    }
-
-    if (mMapperV4 != nullptr) {
+    if (getOps() != nullptr && mMapperV4 != nullptr) {
         std::vector<PlaneLayout> planeLayouts = getPlaneLayouts(mMapperV4, buf);
         if (planeLayouts.size() != 1) {
             ALOGE("%s: Unexpected number of planes %zu!",  __FUNCTION__, planeLayouts.size());
@@ -472,28 +516,105 @@ status_t HandleImporter::getMonoPlanarStrideBytes(buffer_handle_t &buf, uint32_t
 }
 
 int HandleImporter::unlock(buffer_handle_t& buf) {
-    if (mMapperV4 != nullptr) {
-        return unlockInternal<IMapperV4, MapperErrorV4>(mMapperV4, buf);
+    const MapperOps* ops = getOps();
+    if (ops == nullptr) {
+        ALOGE("%s: mMapperV4, mMapperV3 and mMapperV2 are all null!", __FUNCTION__);
+        return -1;
     }
-    if (mMapperV3 != nullptr) {
-        return unlockInternal<IMapperV3, MapperErrorV3>(mMapperV3, buf);
+
+    ScopedOpTimer timer(this, Op::UNLOCK);
+    return ops->unlock(this, buf);
+}
+
+bool HandleImporter::supportsPersistentLock() {
+    return getOps() != nullptr && mMapperV4 != nullptr;
+}
+
+const HandleImporter::PersistentMapping* HandleImporter::lockPersistentLocked(
+        buffer_handle_t& buf, uint64_t cpuUsage, const IMapper::Rect& accessRegion,
+        bool isYCbCr) {
+    auto it = mMappings.find(buf);
+    if (it != mMappings.end()) {
+        const PersistentMapping& mapping = it->second;
+        if (mapping.cpuUsage == cpuUsage && mapping.isYCbCr == isYCbCr &&
+                mapping.accessRegion.left == accessRegion.left &&
+                mapping.accessRegion.top == accessRegion.top &&
+                mapping.accessRegion.width == accessRegion.width &&
+                mapping.accessRegion.height == accessRegion.height) {
+            return &mapping;
+        }
+        unlockPersistentLocked(buf);
     }
-    if (mMapperV2 != nullptr) {
-        return unlockInternal<IMapper, MapperErrorV2>(mMapperV2, buf);
+
+    PersistentMapping mapping{cpuUsage, accessRegion, isYCbCr, nullptr, {}};
+    if (isYCbCr) {
+        mapping.layout = lockYCbCr(buf, cpuUsage, accessRegion);
+        if (mapping.layout.y == nullptr) {
+            return nullptr;
+        }
+    } else {
+        mapping.ptr = lock(buf, cpuUsage, accessRegion);
+        if (mapping.ptr == nullptr) {
+            return nullptr;
+        }
     }
+    return &mMappings.emplace(buf, mapping).first->second;
+}
 
-    ALOGE("%s: mMapperV4, mMapperV3 and mMapperV2 are all null!", __FUNCTION__);
-    return -1;
+void HandleImporter::unlockPersistentLocked(buffer_handle_t buf) {
+    auto it = mMappings.find(buf);
+    if (it == mMappings.end()) {
+        return;
+    }
+    mMappings.erase(it);
+    closeFence(unlock(buf));
 }
 
-bool HandleImporter::isSmpte2086Present(const buffer_handle_t& buf) {
-    Mutex::Autolock lock(mLock);
+void* HandleImporter::lockPersistent(buffer_handle_t& buf, uint64_t cpuUsage, size_t size) {
+    IMapper::Rect accessRegion{0, 0, static_cast<int>(size), 1};
+    Mutex::Autolock lock(mMappingsLock);
+    const PersistentMapping* mapping =
+            lockPersistentLocked(buf, cpuUsage, accessRegion, /*isYCbCr*/false);
+    return mapping != nullptr ? mapping->ptr : nullptr;
+}
 
-    if (!mInitialized) {
-        initializeLocked();
+YCbCrLayout HandleImporter::lockYCbCrPersistent(buffer_handle_t& buf, uint64_t cpuUsage,
+        const IMapper::Rect& accessRegion) {
+    Mutex::Autolock lock(mMappingsLock);
+    const PersistentMapping* mapping =
+            lockPersistentLocked(buf, cpuUsage, accessRegion, /*isYCbCr*/true);
+    return mapping != nullptr ? mapping->layout : YCbCrLayout{};
+}
+
+int HandleImporter::flushPersistent(buffer_handle_t& buf) {
+    if (!supportsPersistentLock()) {
+        ALOGE("%s: mMapperV4 is null! Flush not supported!", __FUNCTION__);
+        return -1;
     }
 
-    if (mMapperV4 != nullptr) {
+    ScopedOpTimer timer(this, Op::FLUSH);
+    int releaseFence = -1;
+    auto ret = mMapperV4->flushLockedBuffer(const_cast<native_handle_t*>(buf),
+            [&](const auto& tmpError, const auto& tmpReleaseFence) {
+                if (tmpError == MapperErrorV4::NONE) {
+                    releaseFence = dupReleaseFence(tmpReleaseFence.getNativeHandle());
+                } else {
+                    ALOGE("%s: failed to flush error %d!", __FUNCTION__, tmpError);
+                }
+            });
+    if (!ret.isOk()) {
+        ALOGE("%s: mapper flushLockedBuffer failed: %s", __FUNCTION__, ret.description().c_str());
+    }
+    return releaseFence;
+}
+
+void HandleImporter::unlockPersistent(buffer_handle_t buf) {
+    Mutex::Autolock lock(mMappingsLock);
+    unlockPersistentLocked(buf);
+}
+
+bool HandleImporter::isSmpte2086Present(const buffer_handle_t& buf) {
+    if (getOps() != nullptr && mMapperV4 != nullptr) {
         return isMetadataPesent(mMapperV4, buf, gralloc4::MetadataType_Smpte2086);
     } else {
         ALOGE("%s: mMapperV4 is null! Query not supported!", __FUNCTION__);
@@ -503,13 +624,7 @@ bool HandleImporter::isSmpte2086Present(const buffer_handle_t& buf) {
 }
 
 bool HandleImporter::isSmpte2094_10Present(const buffer_handle_t& buf) {
-    Mutex::Autolock lock(mLock);
-
-    if (!mInitialized) {
-        initializeLocked();
-    }
-
-    if (mMapperV4 != nullptr) {
+    if (getOps() != nullptr && mMapperV4 != nullptr) {
         return isMetadataPesent(mMapperV4, buf, gralloc4::MetadataType_Smpte2094_10);
     } else {
         ALOGE("%s: mMapperV4 is null! Query not supported!", __FUNCTION__);
@@ -519,13 +634,7 @@ bool HandleImporter::isSmpte2094_10Present(const buffer_handle_t& buf) {
 }
 
 bool HandleImporter::isSmpte2094_40Present(const buffer_handle_t& buf) {
-    Mutex::Autolock lock(mLock);
-
-    if (!mInitialized) {
-        initializeLocked();
-    }
-
-    if (mMapperV4 != nullptr) {
+    if (getOps() != nullptr && mMapperV4 != nullptr) {
         return isMetadataPesent(mMapperV4, buf, gralloc4::MetadataType_Smpte2094_40);
     } else {
         ALOGE("%s: mMapperV4 is null! Query not supported!", __FUNCTION__);
@@ -534,6 +643,25 @@ bool HandleImporter::isSmpte2094_40Present(const buffer_handle_t& buf) {
     return false;
 }
 
+HandleImporter::OpStats HandleImporter::getStats(Op op) const {
+    const AtomicOpStats& stats = mStats[static_cast<size_t>(op)];
+    return {stats.count.load(std::memory_order_relaxed),
+            stats.totalNs.load(std::memory_order_relaxed),
+            stats.maxNs.load(std::memory_order_relaxed)};
+}
+
+void HandleImporter::dump(int fd) const {
+    static const char* const kOpNames[] = {"import", "free", "lock", "lockYCbCr", "unlock",
+                                           "flush"};
+    static_assert(std::size(kOpNames) == static_cast<size_t>(Op::COUNT));
+    dprintf(fd, "HandleImporter buffer operations:\n");
+    for (size_t i = 0; i < static_cast<size_t>(Op::COUNT); i++) {
+        const OpStats stats = getStats(static_cast<Op>(i));
+        dprintf(fd, "  %s: count %" PRIu64 " avg %" PRIu64 "us max %" PRIu64 "us\n", kOpNames[i],
+                stats.count, stats.count > 0 ? stats.totalNs / stats.count / 1000 : 0,
+                stats.maxNs / 1000);
+    }
+}
 
 } // namespace helper
 } // namespace V1_0
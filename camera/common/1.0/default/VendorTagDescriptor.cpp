@@ -35,10 +35,6 @@ namespace camera2 {
 namespace params {
 
 VendorTagDescriptor::~VendorTagDescriptor() {
-    size_t len = mReverseMapping.size();
-    for (size_t i = 0; i < len; ++i)  {
-        delete mReverseMapping[i];
-    }
 }
 
 VendorTagDescriptor::VendorTagDescriptor() :
@@ -58,28 +54,75 @@ VendorTagDescriptor& VendorTagDescriptor::operator=(const VendorTagDescriptor& r
 void VendorTagDescriptor::copyFrom(const VendorTagDescriptor& src) {
     if (this == &src) return;
 
-    size_t len = mReverseMapping.size();
-    for (size_t i = 0; i < len; ++i) {
-        delete mReverseMapping[i];
-    }
-    mReverseMapping.clear();
-
-    len = src.mReverseMapping.size();
-    // Have to copy KeyedVectors inside mReverseMapping
-    for (size_t i = 0; i < len; ++i) {
-        KeyedVector<String8, uint32_t>* nameMapper = new KeyedVector<String8, uint32_t>();
-        *nameMapper = *(src.mReverseMapping.valueAt(i));
-        mReverseMapping.add(src.mReverseMapping.keyAt(i), nameMapper);
-    }
-    // Everything else is simple
     mTagToNameMap = src.mTagToNameMap;
-    mTagToSectionMap = src.mTagToSectionMap;
-    mTagToTypeMap = src.mTagToTypeMap;
+    mTagEntries = src.mTagEntries;
+    mTagSlots = src.mTagSlots;
+    mNameSlots = src.mNameSlots;
     mSections = src.mSections;
     mTagCount = src.mTagCount;
     mVendorOps = src.mVendorOps;
 }
 
+uint32_t VendorTagDescriptor::hashTag(uint32_t tag) {
+    // Tags of a section are consecutive, so spread them over the table
+    return tag * 0x9E3779B1u;
+}
+
+uint32_t VendorTagDescriptor::hashName(const char* section, const char* name) {
+    // FNV-1a over the section and the tag name, separated by '.'
+    uint32_t hash = 2166136261u;
+    for (const char* c = section; *c != '\0'; ++c) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    hash = (hash ^ '.') * 16777619u;
+    for (const char* c = name; *c != '\0'; ++c) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    return hash;
+}
+
+void VendorTagDescriptor::buildLookupTables() {
+    // At most half full, so probe sequences stay short
+    size_t size = 1;
+    while (size < mTagEntries.size() * 2) {
+        size <<= 1;
+    }
+    const uint32_t mask = size - 1;
+    mTagSlots.assign(size, kEmptySlot);
+    mNameSlots.assign(size, NameSlot{0, kEmptySlot});
+
+    for (size_t i = 0; i < mTagEntries.size(); ++i) {
+        const TagEntry& entry = mTagEntries[i];
+        uint32_t slot = hashTag(entry.tag) & mask;
+        while (mTagSlots[slot] != kEmptySlot) {
+            slot = (slot + 1) & mask;
+        }
+        mTagSlots[slot] = i;
+
+        uint32_t hash = hashName(mSections[entry.sectionIndex].string(),
+                mTagToNameMap.valueAt(i).string());
+        slot = hash & mask;
+        while (mNameSlots[slot].entryIndex != kEmptySlot) {
+            slot = (slot + 1) & mask;
+        }
+        mNameSlots[slot] = NameSlot{hash, static_cast<uint32_t>(i)};
+    }
+}
+
+ssize_t VendorTagDescriptor::findTagEntry(uint32_t tag) const {
+    if (mTagSlots.empty()) {
+        return -1;
+    }
+    const uint32_t mask = mTagSlots.size() - 1;
+    for (uint32_t slot = hashTag(tag) & mask; mTagSlots[slot] != kEmptySlot;
+            slot = (slot + 1) & mask) {
+        if (mTagEntries[mTagSlots[slot]].tag == tag) {
+            return mTagSlots[slot];
+        }
+    }
+    return -1;
+}
+
 int VendorTagDescriptor::getTagCount() const {
     size_t size = mTagToNameMap.size();
     if (size == 0) {
@@ -96,19 +139,23 @@ void VendorTagDescriptor::getTagArray(uint32_t* tagArray) const {
 }
 
 const char* VendorTagDescriptor::getSectionName(uint32_t tag) const {
-    ssize_t index = mTagToSectionMap.indexOfKey(tag);
+    ssize_t index = findTagEntry(tag);
     if (index < 0) {
         return VENDOR_SECTION_NAME_ERR;
     }
-    return mSections[mTagToSectionMap.valueAt(index)].string();
+    return mSections[mTagEntries[index].sectionIndex].string();
 }
 
 ssize_t VendorTagDescriptor::getSectionIndex(uint32_t tag) const {
-    return mTagToSectionMap.valueFor(tag);
+    ssize_t index = findTagEntry(tag);
+    if (index < 0) {
+        return -1;
+    }
+    return mTagEntries[index].sectionIndex;
 }
 
 const char* VendorTagDescriptor::getTagName(uint32_t tag) const {
-    ssize_t index = mTagToNameMap.indexOfKey(tag);
+    ssize_t index = findTagEntry(tag);
     if (index < 0) {
         return VENDOR_TAG_NAME_ERR;
     }
@@ -116,11 +163,11 @@ const char* VendorTagDescriptor::getTagName(uint32_t tag) const {
 }
 
 int VendorTagDescriptor::getTagType(uint32_t tag) const {
-    auto iter = mTagToTypeMap.find(tag);
-    if (iter == mTagToTypeMap.end()) {
+    ssize_t index = findTagEntry(tag);
+    if (index < 0) {
         return VENDOR_TAG_TYPE_ERR;
     }
-    return iter->second;
+    return mTagEntries[index].type;
 }
 
 const SortedVector<String8>* VendorTagDescriptor::getAllSectionNames() const {
@@ -128,22 +175,31 @@ const SortedVector<String8>* VendorTagDescriptor::getAllSectionNames() const {
 }
 
 status_t VendorTagDescriptor::lookupTag(const String8& name, const String8& section, /*out*/uint32_t* tag) const {
-    ssize_t index = mReverseMapping.indexOfKey(section);
-    if (index < 0) {
-        ALOGE("%s: Section '%s' does not exist.", __FUNCTION__, section.string());
-        return BAD_VALUE;
+    if (!mNameSlots.empty()) {
+        const uint32_t mask = mNameSlots.size() - 1;
+        const uint32_t hash = hashName(section.string(), name.string());
+        for (uint32_t slot = hash & mask; mNameSlots[slot].entryIndex != kEmptySlot;
+                slot = (slot + 1) & mask) {
+            if (mNameSlots[slot].hash != hash) {
+                continue;
+            }
+            uint32_t index = mNameSlots[slot].entryIndex;
+            const TagEntry& entry = mTagEntries[index];
+            if (mTagToNameMap.valueAt(index) == name && mSections[entry.sectionIndex] == section) {
+                if (tag != NULL) {
+                    *tag = entry.tag;
+                }
+                return OK;
+            }
+        }
     }
 
-    ssize_t nameIndex = mReverseMapping[index]->indexOfKey(name);
-    if (nameIndex < 0) {
+    if (mSections.indexOf(section) < 0) {
+        ALOGE("%s: Section '%s' does not exist.", __FUNCTION__, section.string());
+    } else {
         ALOGE("%s: Tag name '%s' does not exist.", __FUNCTION__, name.string());
-        return BAD_VALUE;
     }
-
-    if (tag != NULL) {
-        *tag = mReverseMapping[index]->valueAt(nameIndex);
-    }
-    return OK;
+    return BAD_VALUE;
 }
 
 void VendorTagDescriptor::dump(int fd, int verbosity, int indentation) const {
@@ -165,9 +221,8 @@ void VendorTagDescriptor::dump(int fd, int verbosity, int indentation) const {
             continue;
         }
         String8 name = mTagToNameMap.valueAt(i);
-        uint32_t sectionId = mTagToSectionMap.valueFor(tag);
-        String8 sectionName = mSections[sectionId];
-        int type = mTagToTypeMap.at(tag);
+        String8 sectionName = mSections[mTagEntries[i].sectionIndex];
+        int type = mTagEntries[i].type;
         const char* typeName = (type >= 0 && type < NUM_TYPES) ?
                 camera_metadata_type_names[type] : "UNKNOWN";
         dprintf(fd, "%*s0x%x (%s) with type %d (%s) defined in section %s\n", indentation + 2,
@@ -316,6 +371,7 @@ status_t VendorTagDescriptor::createDescriptorFromOps(const vendor_tag_ops_t* vO
 
     SortedVector<String8> sections;
     KeyedVector<uint32_t, String8> tagToSectionMap;
+    std::unordered_map<uint32_t, int32_t> tagToTypeMap;
 
     for (size_t i = 0; i < static_cast<size_t>(tagCount); ++i) {
         uint32_t tag = tagArray[i];
@@ -345,28 +401,24 @@ status_t VendorTagDescriptor::createDescriptorFromOps(const vendor_tag_ops_t* vO
             ALOGE("%s: tag type %d from vendor ops does not exist.", __FUNCTION__, tagType);
             return BAD_VALUE;
         }
-        desc->mTagToTypeMap.insert(std::make_pair(tag, tagType));
+        tagToTypeMap.insert(std::make_pair(tag, tagType));
     }
 
     desc->mSections = sections;
 
-    for (size_t i = 0; i < static_cast<size_t>(tagCount); ++i) {
-        uint32_t tag = tagArray[i];
+    // Set up the tag entries in the order of mTagToNameMap, which holds each tag once
+    size_t size = desc->mTagToNameMap.size();
+    desc->mTagEntries.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        uint32_t tag = desc->mTagToNameMap.keyAt(i);
         const String8& sectionString = tagToSectionMap.valueFor(tag);
 
-        // Set up tag to section index map
         ssize_t index = sections.indexOf(sectionString);
         LOG_ALWAYS_FATAL_IF(index < 0, "index %zd must be non-negative", index);
-        desc->mTagToSectionMap.add(tag, static_cast<uint32_t>(index));
-
-        // Set up reverse mapping
-        ssize_t reverseIndex = -1;
-        if ((reverseIndex = desc->mReverseMapping.indexOfKey(sectionString)) < 0) {
-            KeyedVector<String8, uint32_t>* nameMapper = new KeyedVector<String8, uint32_t>();
-            reverseIndex = desc->mReverseMapping.add(sectionString, nameMapper);
-        }
-        desc->mReverseMapping[reverseIndex]->add(desc->mTagToNameMap.valueFor(tag), tag);
+        desc->mTagEntries.push_back(
+                TagEntry{tag, tagToTypeMap.at(tag), static_cast<uint32_t>(index)});
     }
+    desc->buildLookupTables();
 
     descriptor = desc;
     return OK;
@@ -152,6 +152,24 @@ class CameraMetadata {
         return update(tag, data.array(), data.size());
     }
 
+    /**
+     * Update metadata entries with all the entries of other, e.g. a template of the tags
+     * every capture result has. The buffer is reallocated at most once, and is sorted
+     * afterwards.
+     */
+    status_t merge(const CameraMetadata &other);
+
+    /**
+     * Make room for at least entryCapacity entries and dataCapacity bytes of data, so that
+     * later updates within that space don't reallocate the buffer.
+     */
+    status_t reserve(size_t entryCapacity, size_t dataCapacity);
+
+    /**
+     * Number of times any CameraMetadata had to reallocate its buffer to grow it.
+     */
+    static uint64_t getResizeCount();
+
     /**
      * Check if a metadata entry exists for a given tag id
      *
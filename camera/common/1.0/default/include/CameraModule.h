@@ -17,7 +17,9 @@
 #ifndef CAMERA_COMMON_1_0_CAMERAMODULE_H
 #define CAMERA_COMMON_1_0_CAMERAMODULE_H
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <hardware/camera.h>
@@ -49,7 +51,13 @@ public:
     // Returns OK on success, NO_INIT on failure
     int init();
 
+    // static_camera_characteristics points into the cache, and is freed when the camera is
+    // removed. Use getCameraCharacteristics() to keep them.
     int getCameraInfo(int cameraId, struct camera_info *info);
+    // Returns the cached, derived characteristics of a camera device of version 3.0 or newer
+    // without copying them, or nullptr. They stay valid for as long as the returned pointer is
+    // held, even if the camera is removed in the meantime.
+    std::shared_ptr<const camera_metadata_t> getCameraCharacteristics(int cameraId);
     int getDeviceVersion(int cameraId);
     int getNumberOfCameras(void);
     int open(const char* id, struct hw_device_t** device);
@@ -68,7 +76,11 @@ public:
     void *getDso();
     // Only used by CameraProvider
     void removeCamera(int cameraId);
+    // Like getCameraInfo(), |*physicalInfo| is freed when its logical camera is removed.
     int getPhysicalCameraInfo(int physicalCameraId, camera_metadata_t **physicalInfo);
+    // The characteristics stay valid for as long as |*characteristics| is held.
+    int getPhysicalCameraCharacteristics(int physicalCameraId,
+            std::shared_ptr<const camera_metadata_t>* characteristics);
     int isStreamCombinationSupported(int cameraId, camera_stream_combination_t *streams);
     void notifyDeviceStateChange(uint64_t deviceState);
 
@@ -83,11 +95,34 @@ private:
     static void appendAvailableKeys(CameraMetadata &chars,
             int32_t keyTag, const Vector<int32_t>& appendKeys);
     status_t filterOpenErrorCode(status_t err);
+
+    struct CameraInfoEntry {
+        // static_camera_characteristics points into characteristics. Physical cameras only fill
+        // in static_camera_characteristics.
+        camera_info info;
+        CameraMetadata characteristics;
+    };
+    // The cached camera info. A published cache is never modified: it is copied, updated and
+    // published again under mCameraInfoLock, so readers only need to load the current one.
+    struct CameraInfoCache {
+        std::unordered_map<int, std::shared_ptr<const CameraInfoEntry>> cameras;
+        std::unordered_map<int, std::shared_ptr<const CameraInfoEntry>> physicalCameras;
+    };
+    static std::shared_ptr<const CameraInfoEntry> createCameraInfoEntry(
+            const camera_info& rawInfo);
+    static std::shared_ptr<const CameraInfoEntry> createPhysicalCameraInfoEntry(
+            const camera_metadata_t* rawInfo);
+    // Fetches the info of all cameras from the module and publishes it, deriving the
+    // characteristics keys of the cameras in parallel
+    void populateCameraInfoCache();
+    std::shared_ptr<const CameraInfoCache> loadCameraInfoCache() const;
+    void publishCameraInfoCacheLocked(std::shared_ptr<const CameraInfoCache> cache);
+
     camera_module_t *mModule;
     int mNumberOfCameras;
-    KeyedVector<int, camera_info> mCameraInfoMap;
     KeyedVector<int, int> mDeviceVersionMap;
-    KeyedVector<int, camera_metadata_t*> mPhysicalCameraInfoMap;
+    std::shared_ptr<const CameraInfoCache> mCameraInfoCache;
+    // Serializes updates of mCameraInfoCache
     Mutex mCameraInfoLock;
 };
 
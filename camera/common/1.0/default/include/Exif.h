@@ -32,6 +32,10 @@ namespace helper {
 // ExifUtils can generate APP1 segment with tags which caller set. ExifUtils can
 // also add a thumbnail in the APP1 segment if thumbnail size is specified.
 // ExifUtils can be reused with different images by calling initialize().
+// It can also be reused without initialize(), keeping the tags set for the
+// previous image. As long as the same tags with the same sizes are set,
+// GenerateApp1() then patches the values and the thumbnail into the previous
+// APP1 segment instead of serializing all tags again.
 //
 // Example of using this class :
 //  std::unique_ptr<ExifUtils> utils(ExifUtils::Create());
@@ -54,7 +58,8 @@ class ExifUtils {
     // cleared.
     virtual bool initialize() = 0;
 
-    // Set all known fields from a metadata structure
+    // Set all known fields from a metadata structure. The tags of optional
+    // fields missing from the metadata are removed.
     virtual bool setFromMetadata(const CameraMetadata& metadata,
                                  const size_t imageWidth,
                                  const size_t imageHeight) = 0;
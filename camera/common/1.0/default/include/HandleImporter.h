@@ -23,6 +23,9 @@
 #include <cutils/native_handle.h>
 #include <utils/Mutex.h>
 
+#include <atomic>
+#include <unordered_map>
+
 using android::hardware::graphics::mapper::V2_0::IMapper;
 using android::hardware::graphics::mapper::V2_0::YCbCrLayout;
 
@@ -61,14 +64,82 @@ public:
 
     int unlock(buffer_handle_t& buf); // returns release fence
 
+    // Persistent CPU mappings, which keep a buffer locked across frames. The first call locks the
+    // buffer and the following ones with the same usage and region return the same mapping.
+    // flushPersistent takes the place of unlock after each CPU write. The mapping is released
+    // by unlockPersistent or freeBuffer. Only mapper 4.0 can flush a locked buffer, so
+    // supportsPersistentLock is false with older mappers.
+    bool supportsPersistentLock();
+    void* lockPersistent(buffer_handle_t& buf, uint64_t cpuUsage, size_t size);
+    YCbCrLayout lockYCbCrPersistent(buffer_handle_t& buf, uint64_t cpuUsage,
+                                    const IMapper::Rect& accessRegion);
+    int flushPersistent(buffer_handle_t& buf); // returns release fence
+    void unlockPersistent(buffer_handle_t buf);
+
     // Query Gralloc4 metadata
     bool isSmpte2086Present(const buffer_handle_t& buf);
     bool isSmpte2094_10Present(const buffer_handle_t& buf);
     bool isSmpte2094_40Present(const buffer_handle_t& buf);
 
+    // Per-buffer operations whose latency is tracked.
+    enum class Op { IMPORT, FREE, LOCK, LOCK_YCBCR, UNLOCK, FLUSH, COUNT };
+
+    struct OpStats {
+        uint64_t count;
+        uint64_t totalNs;
+        uint64_t maxNs;
+    };
+
+    OpStats getStats(Op op) const;
+
+    // Writes the latency of each per-buffer operation.
+    void dump(int fd) const;
+
 private:
+    // The mapper calls of one mapper version. The mapper services are thread safe, so once a
+    // version has been picked the per-buffer operations run without taking mLock.
+    struct MapperOps {
+        bool (*importBuffer)(HandleImporter* importer, buffer_handle_t& handle);
+        void (*freeBuffer)(HandleImporter* importer, buffer_handle_t handle);
+        void* (*lock)(HandleImporter* importer, buffer_handle_t& buf, uint64_t cpuUsage,
+                      const IMapper::Rect& accessRegion);
+        YCbCrLayout (*lockYCbCr)(HandleImporter* importer, buffer_handle_t& buf,
+                                 uint64_t cpuUsage, const IMapper::Rect& accessRegion);
+        int (*unlock)(HandleImporter* importer, buffer_handle_t& buf);
+    };
+
+    struct AtomicOpStats {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> maxNs{0};
+    };
+
+    class ScopedOpTimer;
+
+    struct PersistentMapping {
+        uint64_t cpuUsage;
+        IMapper::Rect accessRegion;
+        bool isYCbCr;
+        void* ptr;
+        YCbCrLayout layout;
+    };
+
+    // Returns the mapping of buf, locking it first if it has no mapping with this usage and
+    // region, or nullptr if locking fails.
+    const PersistentMapping* lockPersistentLocked(buffer_handle_t& buf, uint64_t cpuUsage,
+                                                  const IMapper::Rect& accessRegion,
+                                                  bool isYCbCr);
+    void unlockPersistentLocked(buffer_handle_t buf);
+
+    // Returns the operations of the mapper version in use, connecting to the mapper service on
+    // the first call, or nullptr if no mapper service is available.
+    const MapperOps* getOps();
     void initializeLocked();
-    void cleanup();
+
+    template<class M>
+    const sp<M>& getMapper() const;
+    template<class M, class E>
+    static const MapperOps kMapperOps;
 
     template<class M, class E>
     bool importBufferInternal(const sp<M> mapper, buffer_handle_t& handle);
@@ -77,9 +148,19 @@ private:
             const IMapper::Rect& accessRegion);
     template<class M, class E>
     int unlockInternal(const sp<M> mapper, buffer_handle_t& buf);
+    template<class M, class E>
+    void* lockInternal(const sp<M> mapper, buffer_handle_t& buf, uint64_t cpuUsage,
+            const IMapper::Rect& accessRegion);
+    template<class M>
+    void freeBufferInternal(const sp<M> mapper, buffer_handle_t handle);
 
+    // Guards the initialization only. The mappers are set before mOps is published and are not
+    // changed afterwards.
     Mutex mLock;
-    bool mInitialized;
+    std::atomic<const MapperOps*> mOps;
+    AtomicOpStats mStats[static_cast<size_t>(Op::COUNT)];
+    Mutex mMappingsLock;
+    std::unordered_map<buffer_handle_t, PersistentMapping> mMappings;
     sp<IMapper> mMapperV2;
     sp<graphics::mapper::V3_0::IMapper> mMapperV3;
     sp<graphics::mapper::V4_0::IMapper> mMapperV4;
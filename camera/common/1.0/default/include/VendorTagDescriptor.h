@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 namespace hardware {
@@ -92,11 +93,32 @@ class VendorTagDescriptor {
         void dump(int fd, int verbosity, int indentation) const;
 
     protected:
-        KeyedVector<String8, KeyedVector<String8, uint32_t>*> mReverseMapping;
-        KeyedVector<uint32_t, String8> mTagToNameMap;
-        KeyedVector<uint32_t, uint32_t> mTagToSectionMap; // Value is offset in mSections
+        struct TagEntry {
+            uint32_t tag;
+            int32_t type;
+            uint32_t sectionIndex; // Offset in mSections
+        };
+        struct NameSlot {
+            uint32_t hash;
+            uint32_t entryIndex;
+        };
+        static constexpr uint32_t kEmptySlot = UINT32_MAX;
+
+        static uint32_t hashTag(uint32_t tag);
+        static uint32_t hashName(const char* section, const char* name);
+        // Builds the open addressing tables below from mTagEntries. Must be called once the
+        // tags are all known, they are looked up per tag of every metadata buffer.
+        void buildLookupTables();
+        // Returns the index in mTagEntries and mTagToNameMap of a tag, or -1
+        ssize_t findTagEntry(uint32_t tag) const;
 
-        std::unordered_map<uint32_t, int32_t> mTagToTypeMap;
+        KeyedVector<uint32_t, String8> mTagToNameMap;
+        // In the order of mTagToNameMap
+        std::vector<TagEntry> mTagEntries;
+        // Indexes in mTagEntries, or kEmptySlot
+        std::vector<uint32_t> mTagSlots;
+        // Indexes in mTagEntries by section and tag name
+        std::vector<NameSlot> mNameSlots;
         SortedVector<String8> mSections;
         // must be int32_t to be compatible with Parcel::writeInt32
         int32_t mTagCount;
@@ -145,12 +145,13 @@ Return<void> CameraDevice::getCameraCharacteristics(
         ICameraDevice::getCameraCharacteristics_cb _hidl_cb)  {
     Status status = initStatus();
     CameraMetadata cameraCharacteristics;
+    std::shared_ptr<const camera_metadata_t> characteristics;
     if (status == Status::OK) {
         //Module 2.1+ codepath.
-        struct camera_info info;
-        int ret = mModule->getCameraInfo(mCameraIdInt, &info);
-        if (ret == OK) {
-            convertToHidl(info.static_camera_characteristics, &cameraCharacteristics);
+        // Held until the callback returns, as cameraCharacteristics points into it
+        characteristics = mModule->getCameraCharacteristics(mCameraIdInt);
+        if (characteristics != nullptr) {
+            convertToHidl(characteristics.get(), &cameraCharacteristics);
         } else {
             ALOGE("%s: get camera info failed!", __FUNCTION__);
             status = Status::INTERNAL_ERROR;
@@ -233,9 +234,10 @@ Return<void> CameraDevice::open(const sp<ICameraDeviceCallback>& callback,
             return Void();
         }
 
-        struct camera_info info;
-        res = mModule->getCameraInfo(mCameraIdInt, &info);
-        if (res != OK) {
+        // Held until the session has copied them, the camera may be removed meanwhile
+        std::shared_ptr<const camera_metadata_t> characteristics =
+                mModule->getCameraCharacteristics(mCameraIdInt);
+        if (characteristics == nullptr) {
             ALOGE("%s: Could not open camera: getCameraInfo failed", __FUNCTION__);
             device->common.close(&device->common);
             mLock.unlock();
@@ -243,8 +245,7 @@ Return<void> CameraDevice::open(const sp<ICameraDeviceCallback>& callback,
             return Void();
         }
 
-        session = createSession(
-                device, info.static_camera_characteristics, callback);
+        session = createSession(device, characteristics.get(), callback);
         if (session == nullptr) {
             ALOGE("%s: camera device session allocation failed", __FUNCTION__);
             mLock.unlock();
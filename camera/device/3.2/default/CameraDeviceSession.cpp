@@ -194,6 +194,7 @@ void CameraDeviceSession::dumpState(const native_handle_t* fd) {
     if (!isClosed()) {
         mDevice->ops->dump(mDevice, fd->data[0]);
     }
+    sHandleImporter.dump(fd->data[0]);
 }
 
 /**
@@ -271,6 +272,14 @@ Status CameraDeviceSession::importBuffer(int32_t streamId,
         uint64_t bufId, buffer_handle_t buf,
         /*out*/buffer_handle_t** outBufPtr,
         bool allowEmptyBuf) {
+    Mutex::Autolock _l(mInflightLock);
+    return importBufferLocked(streamId, bufId, buf, outBufPtr, allowEmptyBuf);
+}
+
+Status CameraDeviceSession::importBufferLocked(int32_t streamId,
+        uint64_t bufId, buffer_handle_t buf,
+        /*out*/buffer_handle_t** outBufPtr,
+        bool allowEmptyBuf) {
 
     if (buf == nullptr && bufId == BUFFER_ID_NO_BUFFER) {
         if (allowEmptyBuf) {
@@ -282,20 +291,19 @@ Status CameraDeviceSession::importBuffer(int32_t streamId,
         }
     }
 
-    Mutex::Autolock _l(mInflightLock);
     CirculatingBuffers& cbs = mCirculatingBuffers[streamId];
-    if (cbs.count(bufId) == 0) {
+    auto it = cbs.find(bufId);
+    if (it == cbs.end()) {
         // Register a newly seen buffer
         buffer_handle_t importedBuf = buf;
         sHandleImporter.importBuffer(importedBuf);
         if (importedBuf == nullptr) {
             ALOGE("%s: output buffer for stream %d is invalid!", __FUNCTION__, streamId);
             return Status::INTERNAL_ERROR;
-        } else {
-            cbs[bufId] = importedBuf;
         }
+        it = cbs.emplace(bufId, importedBuf).first;
     }
-    *outBufPtr = &cbs[bufId];
+    *outBufPtr = &it->second;
     return Status::OK;
 }
 
@@ -337,15 +345,19 @@ Status CameraDeviceSession::importRequestImpl(
         streamIds[numOutputBufs] = request.inputBuffer.streamId;
     }
 
-    for (size_t i = 0; i < numBufs; i++) {
-        Status st = importBuffer(
-                streamIds[i], allBufIds[i], allBufs[i], &allBufPtrs[i],
-                // Disallow empty buf for input stream, otherwise follow
-                // the allowEmptyBuf argument.
-                (hasInputBuf && i == numOutputBufs) ? false : allowEmptyBuf);
-        if (st != Status::OK) {
-            // Detailed error logs printed in importBuffer
-            return st;
+    {
+        // Import all buffers of the request under one lock
+        Mutex::Autolock _l(mInflightLock);
+        for (size_t i = 0; i < numBufs; i++) {
+            Status st = importBufferLocked(
+                    streamIds[i], allBufIds[i], allBufs[i], &allBufPtrs[i],
+                    // Disallow empty buf for input stream, otherwise follow
+                    // the allowEmptyBuf argument.
+                    (hasInputBuf && i == numOutputBufs) ? false : allowEmptyBuf);
+            if (st != Status::OK) {
+                // Detailed error logs printed in importBufferLocked
+                return st;
+            }
         }
     }
 
@@ -378,6 +390,52 @@ void CameraDeviceSession::cleanupInflightFences(
     }
 }
 
+camera3_stream_buffer_t* CameraDeviceSession::InflightBuffers::emplace(
+        int streamId, uint32_t frameNumber) {
+    Entry* entry = find(streamId, frameNumber);
+    if (entry == nullptr) {
+        FrameSlot& slot = mSlots[frameNumber % kNumFrameSlots];
+        for (auto& e : slot) {
+            if (!e->mInUse) {
+                entry = e.get();
+                break;
+            }
+        }
+        if (entry == nullptr) {
+            slot.push_back(std::make_unique<Entry>());
+            entry = slot.back().get();
+        }
+        entry->mInUse = true;
+        entry->mStreamId = streamId;
+        entry->mFrameNumber = frameNumber;
+        mSize++;
+    }
+    entry->mBuffer = camera3_stream_buffer_t{};
+    return &entry->mBuffer;
+}
+
+bool CameraDeviceSession::InflightBuffers::contains(int streamId, uint32_t frameNumber) const {
+    return find(streamId, frameNumber) != nullptr;
+}
+
+void CameraDeviceSession::InflightBuffers::erase(int streamId, uint32_t frameNumber) {
+    Entry* entry = find(streamId, frameNumber);
+    if (entry != nullptr) {
+        entry->mInUse = false;
+        mSize--;
+    }
+}
+
+CameraDeviceSession::InflightBuffers::Entry* CameraDeviceSession::InflightBuffers::find(
+        int streamId, uint32_t frameNumber) const {
+    for (const auto& e : mSlots[frameNumber % kNumFrameSlots]) {
+        if (e->mInUse && e->mStreamId == streamId && e->mFrameNumber == frameNumber) {
+            return e.get();
+        }
+    }
+    return nullptr;
+}
+
 CameraDeviceSession::ResultBatcher::ResultBatcher(
         const sp<ICameraDeviceCallback>& callback) : mCallback(callback) {};
 
@@ -466,18 +524,15 @@ void CameraDeviceSession::ResultBatcher::checkAndRemoveFirstBatch() {
     }
 }
 
-void CameraDeviceSession::ResultBatcher::sendBatchShutterCbsLocked(
-        std::shared_ptr<InflightBatch> batch) {
+void CameraDeviceSession::ResultBatcher::stageBatchShutterCbsLocked(
+        std::shared_ptr<InflightBatch> batch, StagedResults* staged) {
     if (batch->mShutterDelivered) {
         ALOGW("%s: batch shutter callback already sent!", __FUNCTION__);
         return;
     }
 
-    auto ret = mCallback->notify(batch->mShutterMsgs);
-    if (!ret.isOk()) {
-        ALOGE("%s: notify shutter transaction failed: %s",
-                __FUNCTION__, ret.description().c_str());
-    }
+    staged->mShutterMsgs.insert(staged->mShutterMsgs.end(), batch->mShutterMsgs.begin(),
+            batch->mShutterMsgs.end());
     batch->mShutterDelivered = true;
     batch->mShutterMsgs.clear();
 }
@@ -525,13 +580,14 @@ void CameraDeviceSession::ResultBatcher::pushStreamBuffer(
     }
 }
 
-void CameraDeviceSession::ResultBatcher::sendBatchBuffersLocked(
-        std::shared_ptr<InflightBatch> batch) {
-    sendBatchBuffersLocked(batch, mStreamsToBatch);
+void CameraDeviceSession::ResultBatcher::stageBatchBuffersLocked(
+        std::shared_ptr<InflightBatch> batch, StagedResults* staged) {
+    stageBatchBuffersLocked(batch, mStreamsToBatch, staged);
 }
 
-void CameraDeviceSession::ResultBatcher::sendBatchBuffersLocked(
-        std::shared_ptr<InflightBatch> batch, const std::vector<int>& streams) {
+void CameraDeviceSession::ResultBatcher::stageBatchBuffersLocked(
+        std::shared_ptr<InflightBatch> batch, const std::vector<int>& streams,
+        StagedResults* staged) {
     size_t batchSize = 0;
     for (int streamId : streams) {
         auto it = batch->mBatchBufs.find(streamId);
@@ -563,7 +619,7 @@ void CameraDeviceSession::ResultBatcher::sendBatchBuffersLocked(
         return;
     }
 
-    hidl_vec<CaptureResult> results;
+    hidl_vec<CaptureResult>& results = staged->mBufferResults;
     results.resize(batchSize);
     for (size_t i = 0; i < batchSize; i++) {
         results[i].frameNumber = batch->mFirstFrame + i;
@@ -593,8 +649,6 @@ void CameraDeviceSession::ResultBatcher::sendBatchBuffersLocked(
             moveStreamBuffer(std::move(outBufs[j]), results[i].outputBuffers[j]);
         }
     }
-    invokeProcessCaptureResultCallback(results, /* tryWriteFmq */false);
-    freeReleaseFences(results);
     for (int streamId : streams) {
         auto it = batch->mBatchBufs.find(streamId);
         if (it == batch->mBatchBufs.end()) {
@@ -607,15 +661,16 @@ void CameraDeviceSession::ResultBatcher::sendBatchBuffersLocked(
     }
 }
 
-void CameraDeviceSession::ResultBatcher::sendBatchMetadataLocked(
-    std::shared_ptr<InflightBatch> batch, uint32_t lastPartialResultIdx) {
+void CameraDeviceSession::ResultBatcher::stageBatchMetadataLocked(
+        std::shared_ptr<InflightBatch> batch, uint32_t lastPartialResultIdx,
+        StagedResults* staged) {
     if (lastPartialResultIdx <= batch->mPartialResultProgress) {
         // Result has been delivered. Return
         ALOGW("%s: partial result %u has been delivered", __FUNCTION__, lastPartialResultIdx);
         return;
     }
 
-    std::vector<CaptureResult> results;
+    std::vector<CaptureResult>& results = staged->mMetadataResults;
     std::vector<uint32_t> toBeRemovedIdxes;
     for (auto& pair : batch->mResultMds) {
         uint32_t partialIdx = pair.first;
@@ -624,7 +679,7 @@ void CameraDeviceSession::ResultBatcher::sendBatchMetadataLocked(
         }
         toBeRemovedIdxes.push_back(partialIdx);
         InflightBatch::MetadataBatch& mb = pair.second;
-        for (const auto& p : mb.mMds) {
+        for (auto& p : mb.mMds) {
             CaptureResult result;
             result.frameNumber = p.first;
             result.result = std::move(p.second);
@@ -637,15 +692,42 @@ void CameraDeviceSession::ResultBatcher::sendBatchMetadataLocked(
         }
         mb.mMds.clear();
     }
-    hidl_vec<CaptureResult> hResults;
-    hResults.setToExternal(results.data(), results.size());
-    invokeProcessCaptureResultCallback(hResults, /* tryWriteFmq */true);
     batch->mPartialResultProgress = lastPartialResultIdx;
     for (uint32_t partialIdx : toBeRemovedIdxes) {
         batch->mResultMds.erase(partialIdx);
     }
 }
 
+void CameraDeviceSession::ResultBatcher::sendStagedResults(StagedResults& staged) {
+    if (staged.mShutterMsgs.size() > 0) {
+        auto ret = mCallback->notify(staged.mShutterMsgs);
+        if (!ret.isOk()) {
+            ALOGE("%s: notify shutter transaction failed: %s",
+                    __FUNCTION__, ret.description().c_str());
+        }
+        staged.mShutterMsgs.clear();
+    }
+
+    size_t numResults = staged.mMetadataResults.size() + staged.mBufferResults.size();
+    if (numResults == 0) {
+        return;
+    }
+    // Metadata first, then buffers, so that the batch takes a single processCaptureResult call
+    hidl_vec<CaptureResult> results;
+    results.resize(numResults);
+    size_t i = 0;
+    for (auto& result : staged.mMetadataResults) {
+        results[i++] = std::move(result);
+    }
+    for (auto& result : staged.mBufferResults) {
+        results[i++] = std::move(result);
+    }
+    staged.mMetadataResults.clear();
+    staged.mBufferResults.resize(0);
+    invokeProcessCaptureResultCallback(results, /* tryWriteFmq */true);
+    freeReleaseFences(results);
+}
+
 void CameraDeviceSession::ResultBatcher::notifySingleMsg(NotifyMsg& msg) {
     auto ret = mCallback->notify({msg});
     if (!ret.isOk()) {
@@ -672,22 +754,29 @@ void CameraDeviceSession::ResultBatcher::notify(NotifyMsg& msg) {
 
     // When error happened, stop batching for all batches earlier
     if (CC_UNLIKELY(msg.type == MsgType::ERROR)) {
-        Mutex::Autolock _l(mLock);
-        for (int i = 0; i <= batchIdx; i++) {
-            // Send batched data up
-            std::shared_ptr<InflightBatch> batch = mInflightBatches[0];
-            {
-                Mutex::Autolock _l(batch->mLock);
-                sendBatchShutterCbsLocked(batch);
-                sendBatchBuffersLocked(batch);
-                sendBatchMetadataLocked(batch, mNumPartialResults);
-                if (!batch->allDelivered()) {
-                    ALOGE("%s: error: some batch data not sent back to framework!",
-                            __FUNCTION__);
+        // Batches are sent in order once they are staged, after all locks are released
+        std::vector<StagedResults> stagedBatches(batchIdx + 1);
+        {
+            Mutex::Autolock _l(mLock);
+            for (int i = 0; i <= batchIdx; i++) {
+                std::shared_ptr<InflightBatch> batch = mInflightBatches[0];
+                {
+                    Mutex::Autolock _l(batch->mLock);
+                    stageBatchShutterCbsLocked(batch, &stagedBatches[i]);
+                    stageBatchBuffersLocked(batch, &stagedBatches[i]);
+                    stageBatchMetadataLocked(batch, mNumPartialResults, &stagedBatches[i]);
+                    if (!batch->allDelivered()) {
+                        ALOGE("%s: error: some batch data not sent back to framework!",
+                                __FUNCTION__);
+                    }
+                    batch->mRemoved = true;
                 }
-                batch->mRemoved = true;
+                mInflightBatches.pop_front();
             }
-            mInflightBatches.pop_front();
+        }
+        // Send batched data up
+        for (auto& staged : stagedBatches) {
+            sendStagedResults(staged);
         }
         // Send the error up
         notifySingleMsg(msg);
@@ -695,20 +784,21 @@ void CameraDeviceSession::ResultBatcher::notify(NotifyMsg& msg) {
     }
     // Queue shutter callbacks for future delivery
     std::shared_ptr<InflightBatch> batch = pair.second;
+    StagedResults staged;
     {
         Mutex::Autolock _l(batch->mLock);
         // Check if the batch is removed (mostly by notify error) before lock was acquired
         if (batch->mRemoved) {
             // Fall back to non-batch path
-            notifySingleMsg(msg);
-            return;
-        }
-
-        batch->mShutterMsgs.push_back(msg);
-        if (frameNumber == batch->mLastFrame) {
-            sendBatchShutterCbsLocked(batch);
+            staged.mShutterMsgs.push_back(msg);
+        } else {
+            batch->mShutterMsgs.push_back(msg);
+            if (frameNumber == batch->mLastFrame) {
+                stageBatchShutterCbsLocked(batch, &staged);
+            }
         }
     } // end of batch lock scope
+    sendStagedResults(staged);
 
     // see if the batch is complete
     if (frameNumber == batch->mLastFrame) {
@@ -726,21 +816,25 @@ void CameraDeviceSession::ResultBatcher::invokeProcessCaptureResultCallback(
             return;
         }
     }
-    if (tryWriteFmq && mResultMetadataQueue->availableToWrite() > 0) {
-        for (CaptureResult &result : results) {
-            if (result.result.size() > 0) {
-                if (mResultMetadataQueue->write(result.result.data(), result.result.size())) {
-                    result.fmqResultSize = result.result.size();
-                    result.result.resize(0);
-                } else {
-                    ALOGW("%s: couldn't utilize fmq, fall back to hwbinder, result size: %zu,"
-                    "shared message queue available size: %zu",
-                        __FUNCTION__, result.result.size(),
-                        mResultMetadataQueue->availableToWrite());
-                    result.fmqResultSize = 0;
-                }
+    bool useFmq = tryWriteFmq && mResultMetadataQueue->availableToWrite() > 0;
+    for (CaptureResult &result : results) {
+        if (result.result.size() == 0) {
+            continue;
+        }
+        if (useFmq) {
+            size_t written = sWriteMetadataToFmq(mResultMetadataQueue.get(), result.result);
+            if (written > 0) {
+                result.fmqResultSize = written;
+                result.result.resize(0);
+                continue;
             }
+            ALOGW("%s: couldn't utilize fmq, fall back to hwbinder, result size: %zu,"
+            "shared message queue available size: %zu",
+                __FUNCTION__, result.result.size(),
+                mResultMetadataQueue->availableToWrite());
         }
+        result.fmqResultSize = 0;
+        sShrinkMetadata(&result.result);
     }
     auto ret = mCallback->processCaptureResult(results);
     if (!ret.isOk()) {
@@ -767,64 +861,75 @@ void CameraDeviceSession::ResultBatcher::processCaptureResult(CaptureResult& res
         return;
     }
     std::shared_ptr<InflightBatch> batch = pair.second;
+    bool removed = false;
+    bool hasNonBatchedResult = false;
+    CaptureResult nonBatchedResult;
+    StagedResults staged;
     {
         Mutex::Autolock _l(batch->mLock);
         // Check if the batch is removed (mostly by notify error) before lock was acquired
-        if (batch->mRemoved) {
-            // Fall back to non-batch path
-            processOneCaptureResult(result);
-            return;
-        }
-
-        // queue metadata
-        if (result.result.size() != 0) {
-            // Save a copy of metadata
-            batch->mResultMds[result.partialResult].mMds.push_back(
-                    std::make_pair(result.frameNumber, result.result));
-        }
-
-        // queue buffer
-        std::vector<int> filledStreams;
-        std::vector<StreamBuffer> nonBatchedBuffers;
-        for (auto& buffer : result.outputBuffers) {
-            auto it = batch->mBatchBufs.find(buffer.streamId);
-            if (it != batch->mBatchBufs.end()) {
-                InflightBatch::BufferBatch& bb = it->second;
-                auto id = buffer.streamId;
-                pushStreamBuffer(std::move(buffer), bb.mBuffers);
-                filledStreams.push_back(id);
-            } else {
-                pushStreamBuffer(std::move(buffer), nonBatchedBuffers);
+        removed = batch->mRemoved;
+        if (!removed) {
+            // queue metadata
+            if (result.result.size() != 0) {
+                // Save a copy of metadata
+                auto& mds = batch->mResultMds[result.partialResult].mMds;
+                mds.emplace_back(result.frameNumber, CameraMetadata());
+                sCopyMetadata(result.result, &mds.back().second);
             }
-        }
 
-        // send non-batched buffers up
-        if (nonBatchedBuffers.size() > 0 || result.inputBuffer.streamId != -1) {
-            CaptureResult nonBatchedResult;
-            nonBatchedResult.frameNumber = result.frameNumber;
-            nonBatchedResult.fmqResultSize = 0;
-            nonBatchedResult.outputBuffers.resize(nonBatchedBuffers.size());
-            for (size_t i = 0; i < nonBatchedBuffers.size(); i++) {
-                moveStreamBuffer(
-                        std::move(nonBatchedBuffers[i]), nonBatchedResult.outputBuffers[i]);
+            // queue buffer
+            std::vector<int> filledStreams;
+            std::vector<StreamBuffer> nonBatchedBuffers;
+            for (auto& buffer : result.outputBuffers) {
+                auto it = batch->mBatchBufs.find(buffer.streamId);
+                if (it != batch->mBatchBufs.end()) {
+                    InflightBatch::BufferBatch& bb = it->second;
+                    auto id = buffer.streamId;
+                    pushStreamBuffer(std::move(buffer), bb.mBuffers);
+                    filledStreams.push_back(id);
+                } else {
+                    pushStreamBuffer(std::move(buffer), nonBatchedBuffers);
+                }
             }
-            moveStreamBuffer(std::move(result.inputBuffer), nonBatchedResult.inputBuffer);
-            nonBatchedResult.partialResult = 0; // 0 for buffer only results
-            processOneCaptureResult(nonBatchedResult);
-        }
 
-        if (result.frameNumber == batch->mLastFrame) {
-            // Send data up
-            if (result.partialResult > 0) {
-                sendBatchMetadataLocked(batch, result.partialResult);
+            // non-batched buffers are sent up after the batch lock is released
+            if (nonBatchedBuffers.size() > 0 || result.inputBuffer.streamId != -1) {
+                hasNonBatchedResult = true;
+                nonBatchedResult.frameNumber = result.frameNumber;
+                nonBatchedResult.fmqResultSize = 0;
+                nonBatchedResult.outputBuffers.resize(nonBatchedBuffers.size());
+                for (size_t i = 0; i < nonBatchedBuffers.size(); i++) {
+                    moveStreamBuffer(
+                            std::move(nonBatchedBuffers[i]), nonBatchedResult.outputBuffers[i]);
+                }
+                moveStreamBuffer(std::move(result.inputBuffer), nonBatchedResult.inputBuffer);
+                nonBatchedResult.partialResult = 0; // 0 for buffer only results
             }
-            // send buffer up
-            if (filledStreams.size() > 0) {
-                sendBatchBuffersLocked(batch, filledStreams);
+
+            if (result.frameNumber == batch->mLastFrame) {
+                // Stage data to be sent up
+                if (result.partialResult > 0) {
+                    stageBatchMetadataLocked(batch, result.partialResult, &staged);
+                }
+                // stage buffer
+                if (filledStreams.size() > 0) {
+                    stageBatchBuffersLocked(batch, filledStreams, &staged);
+                }
             }
         }
     } // end of batch lock scope
 
+    if (removed) {
+        // Fall back to non-batch path
+        processOneCaptureResult(result);
+        return;
+    }
+    if (hasNonBatchedResult) {
+        processOneCaptureResult(nonBatchedResult);
+    }
+    sendStagedResults(staged);
+
     // see if the batch is complete
     if (result.frameNumber == batch->mLastFrame) {
         checkAndRemoveFirstBatch();
@@ -1220,26 +1325,26 @@ Status CameraDeviceSession::processOneCaptureRequest(const CaptureRequest& reque
     {
         Mutex::Autolock _l(mInflightLock);
         if (hasInputBuf) {
-            auto key = std::make_pair(request.inputBuffer.streamId, request.frameNumber);
-            auto& bufCache = mInflightBuffers[key] = camera3_stream_buffer_t{};
+            camera3_stream_buffer_t* bufCache = mInflightBuffers.emplace(
+                    request.inputBuffer.streamId, request.frameNumber);
             convertFromHidl(
                     allBufPtrs[numOutputBufs], request.inputBuffer.status,
                     &mStreamMap[request.inputBuffer.streamId], allFences[numOutputBufs],
-                    &bufCache);
-            halRequest.input_buffer = &bufCache;
+                    bufCache);
+            halRequest.input_buffer = bufCache;
         } else {
             halRequest.input_buffer = nullptr;
         }
 
         halRequest.num_output_buffers = numOutputBufs;
         for (size_t i = 0; i < numOutputBufs; i++) {
-            auto key = std::make_pair(request.outputBuffers[i].streamId, request.frameNumber);
-            auto& bufCache = mInflightBuffers[key] = camera3_stream_buffer_t{};
+            camera3_stream_buffer_t* bufCache = mInflightBuffers.emplace(
+                    request.outputBuffers[i].streamId, request.frameNumber);
             convertFromHidl(
                     allBufPtrs[i], request.outputBuffers[i].status,
                     &mStreamMap[request.outputBuffers[i].streamId], allFences[i],
-                    &bufCache);
-            outHalBufs[i] = bufCache;
+                    bufCache);
+            outHalBufs[i] = *bufCache;
         }
         halRequest.output_buffers = outHalBufs.data();
 
@@ -1267,12 +1372,10 @@ Status CameraDeviceSession::processOneCaptureRequest(const CaptureRequest& reque
 
         cleanupInflightFences(allFences, numBufs);
         if (hasInputBuf) {
-            auto key = std::make_pair(request.inputBuffer.streamId, request.frameNumber);
-            mInflightBuffers.erase(key);
+            mInflightBuffers.erase(request.inputBuffer.streamId, request.frameNumber);
         }
         for (size_t i = 0; i < numOutputBufs; i++) {
-            auto key = std::make_pair(request.outputBuffers[i].streamId, request.frameNumber);
-            mInflightBuffers.erase(key);
+            mInflightBuffers.erase(request.outputBuffers[i].streamId, request.frameNumber);
         }
         if (aeCancelTriggerNeeded) {
             mInflightAETriggerOverrides.erase(request.frameNumber);
@@ -1354,8 +1457,7 @@ status_t CameraDeviceSession::constructCaptureResult(CaptureResult& result,
         if (hasInputBuf) {
             int streamId = static_cast<Camera3Stream*>(hal_result->input_buffer->stream)->mId;
             // validate if buffer is inflight
-            auto key = std::make_pair(streamId, frameNumber);
-            if (mInflightBuffers.count(key) != 1) {
+            if (!mInflightBuffers.contains(streamId, frameNumber)) {
                 ALOGE("%s: input buffer for stream %d frame %d is not inflight!",
                         __FUNCTION__, streamId, frameNumber);
                 return -EINVAL;
@@ -1365,8 +1467,7 @@ status_t CameraDeviceSession::constructCaptureResult(CaptureResult& result,
         for (size_t i = 0; i < numOutputBufs; i++) {
             int streamId = static_cast<Camera3Stream*>(hal_result->output_buffers[i].stream)->mId;
             // validate if buffer is inflight
-            auto key = std::make_pair(streamId, frameNumber);
-            if (mInflightBuffers.count(key) != 1) {
+            if (!mInflightBuffers.contains(streamId, frameNumber)) {
                 ALOGE("%s: output buffer for stream %d frame %d is not inflight!",
                         __FUNCTION__, streamId, frameNumber);
                 return -EINVAL;
@@ -1483,14 +1584,12 @@ status_t CameraDeviceSession::constructCaptureResult(CaptureResult& result,
         Mutex::Autolock _l(mInflightLock);
         if (hasInputBuf) {
             int streamId = static_cast<Camera3Stream*>(hal_result->input_buffer->stream)->mId;
-            auto key = std::make_pair(streamId, frameNumber);
-            mInflightBuffers.erase(key);
+            mInflightBuffers.erase(streamId, frameNumber);
         }
 
         for (size_t i = 0; i < numOutputBufs; i++) {
             int streamId = static_cast<Camera3Stream*>(hal_result->output_buffers[i].stream)->mId;
-            auto key = std::make_pair(streamId, frameNumber);
-            mInflightBuffers.erase(key);
+            mInflightBuffers.erase(streamId, frameNumber);
         }
 
         if (mInflightBuffers.empty()) {
@@ -1508,11 +1607,7 @@ void CameraDeviceSession::sShrinkCaptureResult(
         bool handlePhysCam) {
     *dst = *src;
     // Reserve maximum number of entries to avoid metadata re-allocation.
-    mds->reserve(1 + (handlePhysCam ? src->num_physcam_metadata : 0));
-    if (sShouldShrink(src->result)) {
-        mds->emplace_back(sCreateCompactCopy(src->result));
-        dst->result = mds->back().getAndLock();
-    }
+    mds->reserve(handlePhysCam ? src->num_physcam_metadata : 0);
 
     if (handlePhysCam) {
         // First determine if we need to create new camera_metadata_t* array
@@ -1558,6 +1653,57 @@ camera_metadata_t* CameraDeviceSession::sCreateCompactCopy(const camera_metadata
     return copy_camera_metadata(buffer, compactSize, src);
 }
 
+size_t CameraDeviceSession::sWriteMetadataToFmq(
+        ResultMetadataQueue* queue, const CameraMetadata& md) {
+    const camera_metadata_t* src = reinterpret_cast<const camera_metadata_t*>(md.data());
+    if (!sShouldShrink(src)) {
+        return queue->write(md.data(), md.size()) ? md.size() : 0;
+    }
+
+    size_t compactSize = get_camera_metadata_compact_size(src);
+    ResultMetadataQueue::MemTransaction tx;
+    if (!queue->beginWrite(compactSize, &tx)) {
+        return 0;
+    }
+    const auto& region = tx.getFirstRegion();
+    if (region.getLength() >= compactSize &&
+            reinterpret_cast<uintptr_t>(region.getAddress()) % alignof(uint64_t) == 0) {
+        copy_camera_metadata(region.getAddress(), compactSize, src);
+    } else {
+        // The free space wraps around the end of the queue or is not aligned for metadata
+        std::vector<uint8_t> compact(compactSize);
+        copy_camera_metadata(compact.data(), compactSize, src);
+        if (!tx.copyTo(compact.data(), 0, compactSize)) {
+            return 0;
+        }
+    }
+    if (!queue->commitWrite(compactSize)) {
+        return 0;
+    }
+    return compactSize;
+}
+
+void CameraDeviceSession::sCopyMetadata(const CameraMetadata& src, CameraMetadata* dst) {
+    const camera_metadata_t* md = reinterpret_cast<const camera_metadata_t*>(src.data());
+    if (src.size() == 0 || !sShouldShrink(md)) {
+        *dst = src;
+        return;
+    }
+    size_t compactSize = get_camera_metadata_compact_size(md);
+    dst->resize(compactSize);
+    copy_camera_metadata(dst->data(), compactSize, md);
+}
+
+void CameraDeviceSession::sShrinkMetadata(CameraMetadata* md) {
+    if (md->size() == 0 ||
+            !sShouldShrink(reinterpret_cast<const camera_metadata_t*>(md->data()))) {
+        return;
+    }
+    CameraMetadata compact;
+    sCopyMetadata(*md, &compact);
+    *md = std::move(compact);
+}
+
 /**
  * Static callback forwarding methods from HAL to instance
  */
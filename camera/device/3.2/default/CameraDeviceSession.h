@@ -23,9 +23,12 @@
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 #include <include/convert.h>
+#include <array>
 #include <deque>
 #include <map>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 #include "CameraMetadata.h"
 #include "HandleImporter.h"
 #include "hardware/camera3.h"
@@ -151,9 +154,40 @@ protected:
     // Stream ID -> Camera3Stream cache
     std::map<int, Camera3Stream> mStreamMap;
 
-    mutable Mutex mInflightLock; // protecting mInflightBuffers and mCirculatingBuffers
     // (streamID, frameNumber) -> inflight buffer cache
-    std::map<std::pair<int, uint32_t>, camera3_stream_buffer_t>  mInflightBuffers;
+    // Frames are indexed by frame number modulo kNumFrameSlots, and each slot keeps the entries
+    // of its frames for every stream, so that lookups only scan a few entries. Entries are
+    // allocated once and then reused by later frames, and the address of an entry does not change
+    // until it is erased since the HAL holds a pointer to the input buffer entry.
+    class InflightBuffers {
+    public:
+        // Returns a zero-initialized entry for the buffer, replacing any existing one
+        camera3_stream_buffer_t* emplace(int streamId, uint32_t frameNumber);
+        bool contains(int streamId, uint32_t frameNumber) const;
+        void erase(int streamId, uint32_t frameNumber);
+        size_t size() const { return mSize; }
+        bool empty() const { return mSize == 0; }
+
+    private:
+        // More than the number of requests the camera service keeps inflight
+        static constexpr uint32_t kNumFrameSlots = 64;
+
+        struct Entry {
+            bool mInUse = false;
+            int mStreamId = 0;
+            uint32_t mFrameNumber = 0;
+            camera3_stream_buffer_t mBuffer = {};
+        };
+        using FrameSlot = std::vector<std::unique_ptr<Entry>>;
+
+        Entry* find(int streamId, uint32_t frameNumber) const;
+
+        std::array<FrameSlot, kNumFrameSlots> mSlots;
+        size_t mSize = 0;
+    };
+
+    mutable Mutex mInflightLock; // protecting mInflightBuffers and mCirculatingBuffers
+    InflightBuffers mInflightBuffers;
 
     // (frameNumber, AETriggerOverride) -> inflight request AETriggerOverrides
     std::map<uint32_t, AETriggerCancelOverride> mInflightAETriggerOverrides;
@@ -169,7 +203,8 @@ protected:
     // when the its stream is deleted or camera device session is closed
     typedef std::unordered_map<uint64_t, buffer_handle_t> CirculatingBuffers;
     // Stream ID -> circulating buffers map
-    std::map<int, CirculatingBuffers> mCirculatingBuffers;
+    // The buffers are not kept in a flat array, as the HAL holds pointers to the imported handles
+    std::unordered_map<int, CirculatingBuffers> mCirculatingBuffers;
 
     static HandleImporter sHandleImporter;
     static buffer_handle_t sEmptyBuffer;
@@ -199,7 +234,7 @@ protected:
         struct InflightBatch {
             // Protect access to entire struct. Acquire this lock before read/write any data or
             // calling any methods. processCaptureResult and notify will compete for this lock
-            // HIDL IPCs might be issued while the lock is held
+            // Do NOT issue HIDL IPCs while holding this lock; stage the data to be sent instead
             Mutex mLock;
 
             bool allDelivered() const;
@@ -256,22 +291,37 @@ protected:
         void moveStreamBuffer(StreamBuffer&& src, StreamBuffer& dst);
         void pushStreamBuffer(StreamBuffer&& src, std::vector<StreamBuffer>& dst);
 
-        void sendBatchMetadataLocked(
-                std::shared_ptr<InflightBatch> batch, uint32_t lastPartialResultIdx);
+        // Data taken out of a batch while InflightBatch::mLock is held, to be sent up by
+        // sendStagedResults once the lock is released
+        struct StagedResults {
+            std::vector<NotifyMsg> mShutterMsgs;
+            // Metadata only results, which hold no native handles
+            std::vector<CaptureResult> mMetadataResults;
+            // Buffer only results, one per frame of the batch
+            hidl_vec<CaptureResult> mBufferResults;
+        };
 
         // Check if the first batch in mInflightBatches is ready to be removed, and remove it if so
         // This method will hold ResultBatcher::mLock briefly
         void checkAndRemoveFirstBatch();
 
-        // The following sendXXXX methods must be called while the InflightBatch::mLock is locked
-        // HIDL IPC methods will be called during these methods.
-        void sendBatchShutterCbsLocked(std::shared_ptr<InflightBatch> batch);
-        // send buffers for all batched streams
-        void sendBatchBuffersLocked(std::shared_ptr<InflightBatch> batch);
-        // send buffers for specified streams
-        void sendBatchBuffersLocked(
-                std::shared_ptr<InflightBatch> batch, const std::vector<int>& streams);
-       // End of sendXXXX methods
+        // The following stageXXXX methods must be called while the InflightBatch::mLock is locked
+        // They move the data to be sent into staged and mark it as delivered, without issuing
+        // HIDL IPCs. Buffers can only be staged once per StagedResults.
+        void stageBatchShutterCbsLocked(
+                std::shared_ptr<InflightBatch> batch, StagedResults* staged);
+        // stage buffers for all batched streams
+        void stageBatchBuffersLocked(std::shared_ptr<InflightBatch> batch, StagedResults* staged);
+        // stage buffers for specified streams
+        void stageBatchBuffersLocked(std::shared_ptr<InflightBatch> batch,
+                const std::vector<int>& streams, StagedResults* staged);
+        void stageBatchMetadataLocked(std::shared_ptr<InflightBatch> batch,
+                uint32_t lastPartialResultIdx, StagedResults* staged);
+       // End of stageXXXX methods
+
+        // Sends the staged shutters in one notify call, then the staged metadata and buffers in
+        // one processCaptureResult call. Must be called without holding any batch lock.
+        void sendStagedResults(StagedResults& staged);
 
         // helper methods
         void freeReleaseFences(hidl_vec<CaptureResult>&);
@@ -320,6 +370,12 @@ protected:
             /*out*/buffer_handle_t** outBufPtr,
             bool allowEmptyBuf);
 
+    // Needs to get called after acquiring 'mInflightLock'
+    Status importBufferLocked(int32_t streamId,
+            uint64_t bufId, buffer_handle_t buf,
+            /*out*/buffer_handle_t** outBufPtr,
+            bool allowEmptyBuf);
+
     static void cleanupInflightFences(
             hidl_vec<int>& allFences, size_t numFences);
 
@@ -354,8 +410,10 @@ protected:
     status_t constructCaptureResult(CaptureResult& result,
                                 const camera3_capture_result *hal_result);
 
-    // Static helper method to copy/shrink capture result metadata sent by HAL
+    // Static helper method to copy/shrink physical camera metadata sent by HAL
     // Temporarily allocated metadata copy will be hold in mds
+    // The result metadata itself is not copied here; it is shrunk while it is written into the
+    // result FMQ or copied into a batch, see sWriteMetadataToFmq and sCopyMetadata
     static void sShrinkCaptureResult(
             camera3_capture_result* dst, const camera3_capture_result* src,
             std::vector<::android::hardware::camera::common::V1_0::helper::CameraMetadata>* mds,
@@ -364,6 +422,14 @@ protected:
     static bool sShouldShrink(const camera_metadata_t* md);
     static camera_metadata_t* sCreateCompactCopy(const camera_metadata_t* src);
 
+    // Writes the metadata directly into the result FMQ, compacting it on the way if it should
+    // be shrunk. Returns the number of bytes written, or 0 if it does not fit.
+    static size_t sWriteMetadataToFmq(ResultMetadataQueue* queue, const CameraMetadata& md);
+    // Copies the metadata in one pass, compacting it on the way if it should be shrunk
+    static void sCopyMetadata(const CameraMetadata& src, CameraMetadata* dst);
+    // Replaces the metadata with a compact copy if it should be shrunk
+    static void sShrinkMetadata(CameraMetadata* md);
+
 private:
 
     struct TrampolineSessionInterface_3_2 : public ICameraDeviceSession {
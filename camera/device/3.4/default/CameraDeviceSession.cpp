@@ -400,14 +400,14 @@ Status CameraDeviceSession::processOneCaptureRequest_3_4(const V3_4::CaptureRequ
         Mutex::Autolock _l(mInflightLock);
         if (hasInputBuf) {
             auto streamId = request.v3_2.inputBuffer.streamId;
-            auto key = std::make_pair(request.v3_2.inputBuffer.streamId, request.v3_2.frameNumber);
-            auto& bufCache = mInflightBuffers[key] = camera3_stream_buffer_t{};
+            camera3_stream_buffer_t* bufCache =
+                    mInflightBuffers.emplace(streamId, request.v3_2.frameNumber);
             convertFromHidl(
                     allBufPtrs[numOutputBufs], request.v3_2.inputBuffer.status,
                     &mStreamMap[request.v3_2.inputBuffer.streamId], allFences[numOutputBufs],
-                    &bufCache);
-            bufCache.stream->physical_camera_id = mPhysicalCameraIdMap[streamId].c_str();
-            halRequest.input_buffer = &bufCache;
+                    bufCache);
+            bufCache->stream->physical_camera_id = mPhysicalCameraIdMap[streamId].c_str();
+            halRequest.input_buffer = bufCache;
         } else {
             halRequest.input_buffer = nullptr;
         }
@@ -415,14 +415,14 @@ Status CameraDeviceSession::processOneCaptureRequest_3_4(const V3_4::CaptureRequ
         halRequest.num_output_buffers = numOutputBufs;
         for (size_t i = 0; i < numOutputBufs; i++) {
             auto streamId = request.v3_2.outputBuffers[i].streamId;
-            auto key = std::make_pair(streamId, request.v3_2.frameNumber);
-            auto& bufCache = mInflightBuffers[key] = camera3_stream_buffer_t{};
+            camera3_stream_buffer_t* bufCache =
+                    mInflightBuffers.emplace(streamId, request.v3_2.frameNumber);
             convertFromHidl(
                     allBufPtrs[i], request.v3_2.outputBuffers[i].status,
                     &mStreamMap[streamId], allFences[i],
-                    &bufCache);
-            bufCache.stream->physical_camera_id = mPhysicalCameraIdMap[streamId].c_str();
-            outHalBufs[i] = bufCache;
+                    bufCache);
+            bufCache->stream->physical_camera_id = mPhysicalCameraIdMap[streamId].c_str();
+            outHalBufs[i] = *bufCache;
         }
         halRequest.output_buffers = outHalBufs.data();
 
@@ -496,13 +496,11 @@ Status CameraDeviceSession::processOneCaptureRequest_3_4(const V3_4::CaptureRequ
 
         cleanupInflightFences(allFences, numBufs);
         if (hasInputBuf) {
-            auto key = std::make_pair(request.v3_2.inputBuffer.streamId, request.v3_2.frameNumber);
-            mInflightBuffers.erase(key);
+            mInflightBuffers.erase(request.v3_2.inputBuffer.streamId, request.v3_2.frameNumber);
         }
         for (size_t i = 0; i < numOutputBufs; i++) {
-            auto key = std::make_pair(request.v3_2.outputBuffers[i].streamId,
+            mInflightBuffers.erase(request.v3_2.outputBuffers[i].streamId,
                     request.v3_2.frameNumber);
-            mInflightBuffers.erase(key);
         }
         if (aeCancelTriggerNeeded) {
             mInflightAETriggerOverrides.erase(request.v3_2.frameNumber);
@@ -633,64 +631,76 @@ void CameraDeviceSession::ResultBatcher_3_4::processCaptureResult_3_4(CaptureRes
         return;
     }
     std::shared_ptr<InflightBatch> batch = pair.second;
+    bool removed = false;
+    bool hasNonBatchedResult = false;
+    CaptureResult nonBatchedResult;
+    StagedResults staged;
     {
         Mutex::Autolock _l(batch->mLock);
         // Check if the batch is removed (mostly by notify error) before lock was acquired
-        if (batch->mRemoved) {
-            // Fall back to non-batch path
-            processOneCaptureResult_3_4(result);
-            return;
-        }
-
-        // queue metadata
-        if (result.v3_2.result.size() != 0) {
-            // Save a copy of metadata
-            batch->mResultMds[result.v3_2.partialResult].mMds.push_back(
-                    std::make_pair(result.v3_2.frameNumber, result.v3_2.result));
-        }
-
-        // queue buffer
-        std::vector<int> filledStreams;
-        std::vector<V3_2::StreamBuffer> nonBatchedBuffers;
-        for (auto& buffer : result.v3_2.outputBuffers) {
-            auto it = batch->mBatchBufs.find(buffer.streamId);
-            if (it != batch->mBatchBufs.end()) {
-                InflightBatch::BufferBatch& bb = it->second;
-                auto id = buffer.streamId;
-                pushStreamBuffer(std::move(buffer), bb.mBuffers);
-                filledStreams.push_back(id);
-            } else {
-                pushStreamBuffer(std::move(buffer), nonBatchedBuffers);
+        removed = batch->mRemoved;
+        if (!removed) {
+            // queue metadata
+            if (result.v3_2.result.size() != 0) {
+                // Save a copy of metadata
+                auto& mds = batch->mResultMds[result.v3_2.partialResult].mMds;
+                mds.emplace_back(result.v3_2.frameNumber, V3_2::CameraMetadata());
+                sCopyMetadata(result.v3_2.result, &mds.back().second);
             }
-        }
 
-        // send non-batched buffers up
-        if (nonBatchedBuffers.size() > 0 || result.v3_2.inputBuffer.streamId != -1) {
-            CaptureResult nonBatchedResult;
-            nonBatchedResult.v3_2.frameNumber = result.v3_2.frameNumber;
-            nonBatchedResult.v3_2.fmqResultSize = 0;
-            nonBatchedResult.v3_2.outputBuffers.resize(nonBatchedBuffers.size());
-            for (size_t i = 0; i < nonBatchedBuffers.size(); i++) {
-                moveStreamBuffer(
-                        std::move(nonBatchedBuffers[i]), nonBatchedResult.v3_2.outputBuffers[i]);
+            // queue buffer
+            std::vector<int> filledStreams;
+            std::vector<V3_2::StreamBuffer> nonBatchedBuffers;
+            for (auto& buffer : result.v3_2.outputBuffers) {
+                auto it = batch->mBatchBufs.find(buffer.streamId);
+                if (it != batch->mBatchBufs.end()) {
+                    InflightBatch::BufferBatch& bb = it->second;
+                    auto id = buffer.streamId;
+                    pushStreamBuffer(std::move(buffer), bb.mBuffers);
+                    filledStreams.push_back(id);
+                } else {
+                    pushStreamBuffer(std::move(buffer), nonBatchedBuffers);
+                }
             }
-            moveStreamBuffer(std::move(result.v3_2.inputBuffer), nonBatchedResult.v3_2.inputBuffer);
-            nonBatchedResult.v3_2.partialResult = 0; // 0 for buffer only results
-            processOneCaptureResult_3_4(nonBatchedResult);
-        }
 
-        if (result.v3_2.frameNumber == batch->mLastFrame) {
-            // Send data up
-            if (result.v3_2.partialResult > 0) {
-                sendBatchMetadataLocked(batch, result.v3_2.partialResult);
+            // non-batched buffers are sent up after the batch lock is released
+            if (nonBatchedBuffers.size() > 0 || result.v3_2.inputBuffer.streamId != -1) {
+                hasNonBatchedResult = true;
+                nonBatchedResult.v3_2.frameNumber = result.v3_2.frameNumber;
+                nonBatchedResult.v3_2.fmqResultSize = 0;
+                nonBatchedResult.v3_2.outputBuffers.resize(nonBatchedBuffers.size());
+                for (size_t i = 0; i < nonBatchedBuffers.size(); i++) {
+                    moveStreamBuffer(std::move(nonBatchedBuffers[i]),
+                            nonBatchedResult.v3_2.outputBuffers[i]);
+                }
+                moveStreamBuffer(std::move(result.v3_2.inputBuffer),
+                        nonBatchedResult.v3_2.inputBuffer);
+                nonBatchedResult.v3_2.partialResult = 0; // 0 for buffer only results
             }
-            // send buffer up
-            if (filledStreams.size() > 0) {
-                sendBatchBuffersLocked(batch, filledStreams);
+
+            if (result.v3_2.frameNumber == batch->mLastFrame) {
+                // Stage data to be sent up
+                if (result.v3_2.partialResult > 0) {
+                    stageBatchMetadataLocked(batch, result.v3_2.partialResult, &staged);
+                }
+                // stage buffer
+                if (filledStreams.size() > 0) {
+                    stageBatchBuffersLocked(batch, filledStreams, &staged);
+                }
             }
         }
     } // end of batch lock scope
 
+    if (removed) {
+        // Fall back to non-batch path
+        processOneCaptureResult_3_4(result);
+        return;
+    }
+    if (hasNonBatchedResult) {
+        processOneCaptureResult_3_4(nonBatchedResult);
+    }
+    sendStagedResults(staged);
+
     // see if the batch is complete
     if (result.v3_2.frameNumber == batch->mLastFrame) {
         checkAndRemoveFirstBatch();
@@ -719,9 +729,10 @@ void CameraDeviceSession::ResultBatcher_3_4::invokeProcessCaptureResultCallback_
     if (tryWriteFmq && mResultMetadataQueue->availableToWrite() > 0) {
         for (CaptureResult &result : results) {
             if (result.v3_2.result.size() > 0) {
-                if (mResultMetadataQueue->write(result.v3_2.result.data(),
-                        result.v3_2.result.size())) {
-                    result.v3_2.fmqResultSize = result.v3_2.result.size();
+                size_t written = sWriteMetadataToFmq(mResultMetadataQueue.get(),
+                        result.v3_2.result);
+                if (written > 0) {
+                    result.v3_2.fmqResultSize = written;
                     result.v3_2.result.resize(0);
                 } else {
                     ALOGW("%s: couldn't utilize fmq, fall back to hwbinder", __FUNCTION__);
@@ -741,6 +752,10 @@ void CameraDeviceSession::ResultBatcher_3_4::invokeProcessCaptureResultCallback_
             }
         }
     }
+    for (CaptureResult &result : results) {
+        // Results not sent through the FMQ go over hwbinder, so keep them small
+        sShrinkMetadata(&result.v3_2.result);
+    }
     mCallback_3_4->processCaptureResult_3_4(results);
     mProcessCaptureResultLock.unlock();
 }
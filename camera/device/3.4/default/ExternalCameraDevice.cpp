@@ -952,6 +952,7 @@ void ExternalCameraDevice::updateFpsBounds(
 }
 
 void ExternalCameraDevice::initSupportedFormatsLocked(int fd) {
+    mStreamCombinationCache.clear();
     std::vector<SupportedV4L2Format> horizontalFmts = getCandidateSupportedFormatsLocked(
         fd, HORIZONTAL, mCfg.fpsLimits, mCfg.depthFpsLimits, mCfg.minStreamSize, mCfg.depthEnabled);
     std::vector<SupportedV4L2Format> verticalFmts = getCandidateSupportedFormatsLocked(
@@ -146,6 +146,10 @@ bool ExternalCameraDeviceSession::initialize() {
         return true;
     }
     mOutputThread->setExifMakeModel(mExifMake, mExifModel);
+    mOutputThread->setMjpegDecoder(createMjpegDecoder(mCfg));
+    mOutputThread->setPersistentBufferMapping(
+            mCfg.persistentBufferMapping && sHandleImporter.supportsPersistentLock());
+    mOutputThread->setResultBatchSize(mCfg.resultBatchSize);
 
     status_t status = initDefaultRequests();
     if (status != OK) {
@@ -153,6 +157,12 @@ bool ExternalCameraDeviceSession::initialize() {
         return true;
     }
 
+    camera_metadata_ro_entry activeArraySize =
+            mCameraCharacteristics.find(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE);
+    if (initCaptureResultTemplate(mResultTemplate, activeArraySize) != OK) {
+        ALOGW("%s: init capture result template failed", __FUNCTION__);
+    }
+
     mRequestMetadataQueue = std::make_unique<RequestMetadataQueue>(
             kMetadataMsgQueueSize, false /* non blocking */);
     if (!mRequestMetadataQueue->isValid()) {
@@ -293,6 +303,9 @@ void ExternalCameraDeviceSession::dumpState(const native_handle_t* handle) {
     dprintf(fd, "\n");
     mOutputThread->dump(fd);
     dprintf(fd, "\n");
+    sHandleImporter.dump(fd);
+    dprintf(fd, "CameraMetadata buffer reallocations: %" PRIu64 "\n",
+            common::V1_0::helper::CameraMetadata::getResizeCount());
 
     if (intfLocked) {
         mInterfaceLock.unlock();
@@ -825,50 +838,50 @@ Status ExternalCameraDeviceSession::processCaptureRequestError(
     return Status::OK;
 }
 
-Status ExternalCameraDeviceSession::processCaptureResult(std::shared_ptr<HalRequest>& req) {
-    ATRACE_CALL();
+void ExternalCameraDeviceSession::prepareCaptureResult(std::shared_ptr<HalRequest>& req,
+        /*out*/std::vector<NotifyMsg>* msgs, /*out*/CaptureResult* result) {
     // Return V4L2 buffer to V4L2 buffer queue
     sp<V3_4::implementation::V4L2Frame> v4l2Frame =
             static_cast<V3_4::implementation::V4L2Frame*>(req->frameIn.get());
     enqueueV4l2Frame(v4l2Frame);
 
-    // NotifyShutter
-    notifyShutter(req->frameNumber, req->shutterTs);
+    NotifyMsg shutter;
+    shutter.type = MsgType::SHUTTER;
+    shutter.msg.shutter.frameNumber = req->frameNumber;
+    shutter.msg.shutter.timestamp = req->shutterTs;
+    msgs->push_back(shutter);
 
     // Fill output buffers
-    hidl_vec<CaptureResult> results;
-    results.resize(1);
-    CaptureResult& result = results[0];
-    result.frameNumber = req->frameNumber;
-    result.partialResult = 1;
-    result.inputBuffer.streamId = -1;
-    result.outputBuffers.resize(req->buffers.size());
+    result->frameNumber = req->frameNumber;
+    result->partialResult = 1;
+    result->inputBuffer.streamId = -1;
+    result->outputBuffers.resize(req->buffers.size());
     for (size_t i = 0; i < req->buffers.size(); i++) {
-        result.outputBuffers[i].streamId = req->buffers[i].streamId;
-        result.outputBuffers[i].bufferId = req->buffers[i].bufferId;
+        result->outputBuffers[i].streamId = req->buffers[i].streamId;
+        result->outputBuffers[i].bufferId = req->buffers[i].bufferId;
         if (req->buffers[i].fenceTimeout) {
-            result.outputBuffers[i].status = BufferStatus::ERROR;
-            if (req->buffers[i].acquireFence >= 0) {
-                native_handle_t* handle = native_handle_create(/*numFds*/1, /*numInts*/0);
-                handle->data[0] = req->buffers[i].acquireFence;
-                result.outputBuffers[i].releaseFence.setTo(handle, /*shouldOwn*/false);
-            }
-            notifyError(req->frameNumber, req->buffers[i].streamId, ErrorCode::ERROR_BUFFER);
+            result->outputBuffers[i].status = BufferStatus::ERROR;
+            NotifyMsg error;
+            error.type = MsgType::ERROR;
+            error.msg.error.frameNumber = req->frameNumber;
+            error.msg.error.errorStreamId = req->buffers[i].streamId;
+            error.msg.error.errorCode = ErrorCode::ERROR_BUFFER;
+            msgs->push_back(error);
         } else {
-            result.outputBuffers[i].status = BufferStatus::OK;
-            // TODO: refactor
-            if (req->buffers[i].acquireFence >= 0) {
-                native_handle_t* handle = native_handle_create(/*numFds*/1, /*numInts*/0);
-                handle->data[0] = req->buffers[i].acquireFence;
-                result.outputBuffers[i].releaseFence.setTo(handle, /*shouldOwn*/false);
-            }
+            result->outputBuffers[i].status = BufferStatus::OK;
+        }
+        // TODO: refactor
+        if (req->buffers[i].acquireFence >= 0) {
+            native_handle_t* handle = native_handle_create(/*numFds*/1, /*numInts*/0);
+            handle->data[0] = req->buffers[i].acquireFence;
+            result->outputBuffers[i].releaseFence.setTo(handle, /*shouldOwn*/false);
         }
     }
 
     // Fill capture result metadata
     fillCaptureResult(req->setting, req->shutterTs);
     const camera_metadata_t *rawResult = req->setting.getAndLock();
-    V3_2::implementation::convertToHidl(rawResult, &result.result);
+    V3_2::implementation::convertToHidl(rawResult, &result->result);
     req->setting.unlock(rawResult);
 
     // update inflight records
@@ -876,7 +889,33 @@ Status ExternalCameraDeviceSession::processCaptureResult(std::shared_ptr<HalRequ
         std::lock_guard<std::mutex> lk(mInflightFramesLock);
         mInflightFrames.erase(req->frameNumber);
     }
+}
 
+Status ExternalCameraDeviceSession::processCaptureResult(std::shared_ptr<HalRequest>& req) {
+    ATRACE_CALL();
+    std::vector<NotifyMsg> msgs;
+    hidl_vec<CaptureResult> results;
+    results.resize(1);
+    prepareCaptureResult(req, &msgs, &results[0]);
+
+    mCallback->notify(msgs);
+    // Callback into framework
+    invokeProcessCaptureResultCallback(results, /* tryWriteFmq */true);
+    freeReleaseFences(results);
+    return Status::OK;
+}
+
+Status ExternalCameraDeviceSession::processCaptureResults(
+        std::vector<std::shared_ptr<HalRequest>>& reqs) {
+    ATRACE_CALL();
+    std::vector<NotifyMsg> msgs;
+    hidl_vec<CaptureResult> results;
+    results.resize(reqs.size());
+    for (size_t i = 0; i < reqs.size(); i++) {
+        prepareCaptureResult(reqs[i], &msgs, &results[i]);
+    }
+
+    mCallback->notify(msgs);
     // Callback into framework
     invokeProcessCaptureResultCallback(results, /* tryWriteFmq */true);
     freeReleaseFences(results);
@@ -921,18 +960,49 @@ void ExternalCameraDeviceSession::invokeProcessCaptureResultCallback(
 ExternalCameraDeviceSession::OutputThread::OutputThread(
         wp<OutputThreadInterface> parent, CroppingType ct,
         const common::V1_0::helper::CameraMetadata& chars) :
-        mParent(parent), mCroppingType(ct), mCameraCharacteristics(chars) {}
+        mParent(parent), mCroppingType(ct), mCameraCharacteristics(chars),
+        mMjpegDecoder(std::make_unique<LibyuvMjpegDecoder>()) {}
 
-ExternalCameraDeviceSession::OutputThread::~OutputThread() {}
+ExternalCameraDeviceSession::OutputThread::~OutputThread() {
+    std::unique_lock<std::mutex> lk(mPendingResultLock);
+    sp<JpegEncodeThread> thread = mJpegEncodeThread;
+    lk.unlock();
+    if (thread != nullptr) {
+        waitForPendingResults();
+        thread->requestExit();
+        mPendingResultCond.notify_all();
+        thread->join();
+    }
+}
 
 void ExternalCameraDeviceSession::OutputThread::setExifMakeModel(
         const std::string& make, const std::string& model) {
+    std::lock_guard<std::mutex> lk(mExifLock);
     mExifMake = make;
     mExifModel = model;
+    mExifUtils.reset();
+}
+
+void ExternalCameraDeviceSession::OutputThread::setMjpegDecoder(
+        std::unique_ptr<MjpegDecoder> decoder) {
+    mMjpegDecoder = std::move(decoder);
+}
+
+void ExternalCameraDeviceSession::OutputThread::setPersistentBufferMapping(bool enabled) {
+    mPersistentBufferMapping = enabled;
+}
+
+void ExternalCameraDeviceSession::OutputThread::setResultBatchSize(uint32_t size) {
+    mResultBatchSize = std::max(size, 1u);
+    mBatchedRequests.reserve(mResultBatchSize);
 }
 
 int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
-        sp<AllocatedFrame>& in, const Size& outSz, YCbCrLayout* out) {
+        sp<AllocatedFrame>& in, const Size& outSz, YCbCrLayout* out,
+        const YCbCrLayout* dst, bool* scaledToDst) {
+    if (scaledToDst != nullptr) {
+        *scaledToDst = false;
+    }
     Size inSz = {in->mWidth, in->mHeight};
 
     int ret;
@@ -970,9 +1040,19 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
     }
 
     auto it = mScaledYu12Frames.find(outSz);
-    sp<AllocatedFrame> scaledYu12Buf;
     if (it != mScaledYu12Frames.end()) {
-        scaledYu12Buf = it->second;
+        // Already scaled for another stream of the same size in this request
+        ret = it->second->getLayout(out);
+        if (ret != 0) {
+            ALOGE("%s: failed to get scaled buffer layout", __FUNCTION__);
+        }
+        return ret;
+    }
+
+    YCbCrLayout outLayout;
+    sp<AllocatedFrame> scaledYu12Buf;
+    if (dst != nullptr && scaledToDst != nullptr) {
+        outLayout = *dst;
     } else {
         it = mIntermediateBuffers.find(outSz);
         if (it == mIntermediateBuffers.end()) {
@@ -981,14 +1061,14 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
             return -1;
         }
         scaledYu12Buf = it->second;
+        ret = scaledYu12Buf->getLayout(&outLayout);
+        if (ret != 0) {
+            ALOGE("%s: failed to get output buffer layout", __FUNCTION__);
+            return ret;
+        }
     }
+
     // Scale
-    YCbCrLayout outLayout;
-    ret = scaledYu12Buf->getLayout(&outLayout);
-    if (ret != 0) {
-        ALOGE("%s: failed to get output buffer layout", __FUNCTION__);
-        return ret;
-    }
 
     ret = libyuv::I420Scale(
             static_cast<uint8_t*>(croppedLayout.y),
@@ -1018,7 +1098,11 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
     }
 
     *out = outLayout;
-    mScaledYu12Frames.insert({outSz, scaledYu12Buf});
+    if (scaledYu12Buf == nullptr) {
+        *scaledToDst = true;
+    } else {
+        mScaledYu12Frames.insert({outSz, scaledYu12Buf});
+    }
     return 0;
 }
 
@@ -1236,6 +1320,20 @@ ssize_t ExternalCameraDeviceSession::getJpegBufferSize(
 int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
         HalStreamBuffer &halBuf,
         const common::V1_0::helper::CameraMetadata& setting)
+{
+    ATRACE_CALL();
+    JpegJob job;
+    int ret = prepareJpegLocked(halBuf, setting, /*copyFrames*/false, &job);
+    if (ret != 0) {
+        return ret;
+    }
+    return encodeJpeg(halBuf, setting, job);
+}
+
+int ExternalCameraDeviceSession::OutputThread::prepareJpegLocked(
+        const HalStreamBuffer &halBuf,
+        const common::V1_0::helper::CameraMetadata& setting,
+        bool copyFrames, JpegJob* job)
 {
     ATRACE_CALL();
     int ret;
@@ -1260,14 +1358,12 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
           __FUNCTION__,
           mYu12Frame->mWidth, mYu12Frame->mHeight);
 
-    int jpegQuality, thumbQuality;
-    Size thumbSize;
-    bool outputThumbnail = true;
+    job->outputThumbnail = true;
 
     if (setting.exists(ANDROID_JPEG_QUALITY)) {
         camera_metadata_ro_entry entry =
             setting.find(ANDROID_JPEG_QUALITY);
-        jpegQuality = entry.data.u8[0];
+        job->jpegQuality = entry.data.u8[0];
     } else {
         return lfail("%s: ANDROID_JPEG_QUALITY not set",__FUNCTION__);
     }
@@ -1275,7 +1371,7 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     if (setting.exists(ANDROID_JPEG_THUMBNAIL_QUALITY)) {
         camera_metadata_ro_entry entry =
             setting.find(ANDROID_JPEG_THUMBNAIL_QUALITY);
-        thumbQuality = entry.data.u8[0];
+        job->thumbQuality = entry.data.u8[0];
     } else {
         return lfail(
             "%s: ANDROID_JPEG_THUMBNAIL_QUALITY not set",
@@ -1285,45 +1381,35 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     if (setting.exists(ANDROID_JPEG_THUMBNAIL_SIZE)) {
         camera_metadata_ro_entry entry =
             setting.find(ANDROID_JPEG_THUMBNAIL_SIZE);
-        thumbSize = Size { static_cast<uint32_t>(entry.data.i32[0]),
-                           static_cast<uint32_t>(entry.data.i32[1])
+        job->thumbSize = Size { static_cast<uint32_t>(entry.data.i32[0]),
+                                static_cast<uint32_t>(entry.data.i32[1])
         };
-        if (thumbSize.width == 0 && thumbSize.height == 0) {
-            outputThumbnail = false;
+        if (job->thumbSize.width == 0 && job->thumbSize.height == 0) {
+            job->outputThumbnail = false;
         }
     } else {
         return lfail(
             "%s: ANDROID_JPEG_THUMBNAIL_SIZE not set", __FUNCTION__);
     }
 
-    /* Cropped and scaled YU12 buffer for main and thumbnail */
-    YCbCrLayout yu12Main;
-    Size jpegSize { halBuf.width, halBuf.height };
+    job->jpegSize = Size { halBuf.width, halBuf.height };
 
     /* Compute temporary buffer sizes accounting for the following:
      * thumbnail can't exceed APP1 size of 64K
      * main image needs to hold APP1, headers, and at most a poorly
      * compressed image */
-    const ssize_t maxThumbCodeSize = 64 * 1024;
-    const ssize_t maxJpegCodeSize = mBlobBufferSize == 0 ?
-            parent->getJpegBufferSize(jpegSize.width, jpegSize.height) :
+    job->maxJpegCodeSize = mBlobBufferSize == 0 ?
+            parent->getJpegBufferSize(job->jpegSize.width, job->jpegSize.height) :
             mBlobBufferSize;
 
     /* Check that getJpegBufferSize did not return an error */
-    if (maxJpegCodeSize < 0) {
+    if (job->maxJpegCodeSize < 0) {
         return lfail(
-            "%s: getJpegBufferSize returned %zd",__FUNCTION__,maxJpegCodeSize);
+            "%s: getJpegBufferSize returned %zd",__FUNCTION__,job->maxJpegCodeSize);
     }
 
-
-    /* Hold actual thumbnail and main image code sizes */
-    size_t thumbCodeSize = 0, jpegCodeSize = 0;
-    /* Temporary thumbnail code buffer */
-    std::vector<uint8_t> thumbCode(outputThumbnail ? maxThumbCodeSize : 0);
-
-    YCbCrLayout yu12Thumb;
-    if (outputThumbnail) {
-        ret = cropAndScaleThumbLocked(mYu12Frame, thumbSize, &yu12Thumb);
+    if (job->outputThumbnail) {
+        ret = cropAndScaleThumbLocked(mYu12Frame, job->thumbSize, &job->yu12Thumb);
 
         if (ret != 0) {
             return lfail(
@@ -1332,16 +1418,63 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     }
 
     /* Scale and crop main jpeg */
-    ret = cropAndScaleLocked(mYu12Frame, jpegSize, &yu12Main);
+    ret = cropAndScaleLocked(mYu12Frame, job->jpegSize, &job->yu12Main);
 
     if (ret != 0) {
         return lfail("%s: crop and scale main failed!", __FUNCTION__);
     }
 
+    if (!copyFrames) {
+        return 0;
+    }
+
+    /* The intermediate buffers are overwritten by the next request, keep a copy
+     * of the images for the JpegEncodeThread */
+    auto copyFrame = [&](const Size& sz, YCbCrLayout* layout, sp<AllocatedFrame>* frame) {
+        *frame = getFreeFrameLocked(sz);
+        YCbCrLayout frameLayout;
+        if (*frame == nullptr || (*frame)->getLayout(&frameLayout) != 0 ||
+                formatConvert(*layout, frameLayout, sz, V4L2_PIX_FMT_YUV420) != 0) {
+            return -1;
+        }
+        *layout = frameLayout;
+        return 0;
+    };
+    if (job->outputThumbnail &&
+            copyFrame(job->thumbSize, &job->yu12Thumb, &job->thumbFrame) != 0) {
+        return lfail("%s: copying thumbnail failed!", __FUNCTION__);
+    }
+    if (copyFrame(job->jpegSize, &job->yu12Main, &job->mainFrame) != 0) {
+        return lfail("%s: copying main image failed!", __FUNCTION__);
+    }
+    return 0;
+}
+
+int ExternalCameraDeviceSession::OutputThread::encodeJpeg(
+        HalStreamBuffer &halBuf,
+        const common::V1_0::helper::CameraMetadata& setting,
+        const JpegJob& job)
+{
+    ATRACE_CALL();
+    int ret;
+    auto lfail = [&](auto... args) {
+        ALOGE(args...);
+
+        return 1;
+    };
+
+    const ssize_t maxThumbCodeSize = 64 * 1024;
+    const ssize_t maxJpegCodeSize = job.maxJpegCodeSize;
+
+    /* Hold actual thumbnail and main image code sizes */
+    size_t thumbCodeSize = 0, jpegCodeSize = 0;
+    /* Temporary thumbnail code buffer */
+    std::vector<uint8_t> thumbCode(job.outputThumbnail ? maxThumbCodeSize : 0);
+
     /* Encode the thumbnail image */
-    if (outputThumbnail) {
-        ret = encodeJpegYU12(thumbSize, yu12Thumb,
-                thumbQuality, 0, 0,
+    if (job.outputThumbnail) {
+        ret = encodeJpegYU12(job.thumbSize, job.yu12Thumb,
+                job.thumbQuality, 0, 0,
                 &thumbCode[0], maxThumbCodeSize, thumbCodeSize);
 
         if (ret != 0) {
@@ -1354,16 +1487,27 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     common::V1_0::helper::CameraMetadata meta(mCameraCharacteristics);
     meta.append(setting);
 
-    /* Generate EXIF object */
-    std::unique_ptr<ExifUtils> utils(ExifUtils::create());
-    /* Make sure it's initialized */
-    utils->initialize();
+    /* Generate EXIF object. It is kept across captures, so that its APP1 segment
+     * only needs patching while the set of tags stays the same */
+    std::lock_guard<std::mutex> exifLock(mExifLock);
+    if (mExifUtils == nullptr) {
+        mExifUtils.reset(ExifUtils::create());
+        /* Make sure it's initialized */
+        mExifUtils->initialize();
+        mExifUtils->setMake(mExifMake);
+        mExifUtils->setModel(mExifModel);
+    }
+    ExifUtils* utils = mExifUtils.get();
 
-    utils->setFromMetadata(meta, jpegSize.width, jpegSize.height);
-    utils->setMake(mExifMake);
-    utils->setModel(mExifModel);
+    if (!utils->setFromMetadata(meta, job.jpegSize.width, job.jpegSize.height)) {
+        /* Drop the tags of previous captures the failed call did not get to */
+        utils->initialize();
+        utils->setFromMetadata(meta, job.jpegSize.width, job.jpegSize.height);
+        utils->setMake(mExifMake);
+        utils->setModel(mExifModel);
+    }
 
-    ret = utils->generateApp1(outputThumbnail ? &thumbCode[0] : 0, thumbCodeSize);
+    ret = utils->generateApp1(job.outputThumbnail ? &thumbCode[0] : 0, thumbCodeSize);
 
     if (!ret) {
         return lfail("%s: generating APP1 failed", __FUNCTION__);
@@ -1382,8 +1526,8 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     }
 
     /* Encode the main jpeg image */
-    ret = encodeJpegYU12(jpegSize, yu12Main,
-            jpegQuality, exifData, exifDataSize,
+    ret = encodeJpegYU12(job.jpegSize, job.yu12Main,
+            job.jpegQuality, exifData, exifDataSize,
             bufPtr, maxJpegCodeSize, jpegCodeSize);
 
     /* TODO: Not sure this belongs here, maybe better to pass jpegCodeSize out
@@ -1408,7 +1552,7 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     }
 
     ALOGV("%s: encoded JPEG (ret:%d) with Q:%d max size: %zu",
-          __FUNCTION__, ret, jpegQuality, maxJpegCodeSize);
+          __FUNCTION__, ret, job.jpegQuality, maxJpegCodeSize);
 
     return 0;
 }
@@ -1426,12 +1570,18 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
     //       when app doesn't program a preveiw request
     waitForNextRequest(&req);
     if (req == nullptr) {
+        if (!mBatchedRequests.empty()) {
+            // The request list drained, don't hold the results any longer
+            deliverBatchedResults(parent);
+            signalRequestDone();
+        }
         // No new request, wait again
         return true;
     }
 
     auto onDeviceError = [&](auto... args) {
         ALOGE(args...);
+        deliverBatchedResults(parent);
         parent->notifyError(
                 req->frameNumber, /*stream*/-1, ErrorCode::ERROR_DEVICE);
         signalRequestDone();
@@ -1499,12 +1649,16 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                     mYu12Frame->mWidth, mYu12Frame->mHeight, mYu12Frame->mWidth,
                     mYu12Frame->mHeight, libyuv::kRotate0, libyuv::FOURCC_RAW);
         } else {
-            res = libyuv::MJPGToI420(
-                    inData, inDataSize, static_cast<uint8_t*>(mYu12FrameLayout.y),
-                    mYu12FrameLayout.yStride, static_cast<uint8_t*>(mYu12FrameLayout.cb),
-                    mYu12FrameLayout.cStride, static_cast<uint8_t*>(mYu12FrameLayout.cr),
-                    mYu12FrameLayout.cStride, mYu12Frame->mWidth, mYu12Frame->mHeight,
-                    mYu12Frame->mWidth, mYu12Frame->mHeight);
+            nsecs_t decodeStart = systemTime(SYSTEM_TIME_MONOTONIC);
+            res = mMjpegDecoder->decode(
+                    inData, inDataSize, {mYu12Frame->mWidth, mYu12Frame->mHeight},
+                    mYu12FrameLayout);
+            uint64_t decodeUs = ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - decodeStart);
+            mMjpegDecodeCount++;
+            mMjpegDecodeTotalUs += decodeUs;
+            if (decodeUs > mMjpegDecodeMaxUs) {
+                mMjpegDecodeMaxUs = decodeUs;
+            }
         }
         ATRACE_END();
 
@@ -1532,7 +1686,17 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
     }
 
     ALOGV("%s processing new request", __FUNCTION__);
+    // Number of YUV output buffers of each size, a size only needed once can be scaled
+    // directly into the output buffer
+    std::unordered_map<Size, int, SizeHasher> yuvSizeCounts;
+    for (const auto& halBuf : req->buffers) {
+        if (halBuf.format == PixelFormat::YCBCR_420_888 || halBuf.format == PixelFormat::YV12) {
+            yuvSizeCounts[Size{halBuf.width, halBuf.height}]++;
+        }
+    }
+
     const int kSyncWaitTimeoutMs = 500;
+    std::vector<JpegJob> jpegJobs;
     for (auto& halBuf : req->buffers) {
         if (*(halBuf.bufPtr) == nullptr) {
             ALOGW("%s: buffer for stream %d missing", __FUNCTION__, halBuf.streamId);
@@ -1554,20 +1718,30 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
         // Gralloc lockYCbCr the buffer
         switch (halBuf.format) {
             case PixelFormat::BLOB: {
-                int ret = createJpegLocked(halBuf, req->setting);
+                // Only crop and scale here, the JpegEncodeThread encodes the image
+                // so the next frames are not held up by the encoding
+                JpegJob job;
+                int ret = prepareJpegLocked(halBuf, req->setting, /*copyFrames*/true, &job);
 
                 if(ret != 0) {
                     lk.unlock();
-                    return onDeviceError("%s: createJpegLocked failed with %d",
+                    return onDeviceError("%s: prepareJpegLocked failed with %d",
                           __FUNCTION__, ret);
                 }
+                job.bufferIndex = &halBuf - &req->buffers[0];
+                jpegJobs.push_back(std::move(job));
             } break;
             case PixelFormat::Y16: {
-                void* outLayout = sHandleImporter.lock(*(halBuf.bufPtr), halBuf.usage, inDataSize);
+                void* outLayout = mPersistentBufferMapping
+                        ? sHandleImporter.lockPersistent(*(halBuf.bufPtr), halBuf.usage,
+                                                         inDataSize)
+                        : sHandleImporter.lock(*(halBuf.bufPtr), halBuf.usage, inDataSize);
 
                 std::memcpy(outLayout, inData, inDataSize);
 
-                int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
+                int relFence = mPersistentBufferMapping
+                        ? sHandleImporter.flushPersistent(*(halBuf.bufPtr))
+                        : sHandleImporter.unlock(*(halBuf.bufPtr));
                 if (relFence >= 0) {
                     halBuf.acquireFence = relFence;
                 }
@@ -1577,8 +1751,10 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                 IMapper::Rect outRect {0, 0,
                         static_cast<int32_t>(halBuf.width),
                         static_cast<int32_t>(halBuf.height)};
-                YCbCrLayout outLayout = sHandleImporter.lockYCbCr(
-                        *(halBuf.bufPtr), halBuf.usage, outRect);
+                YCbCrLayout outLayout = mPersistentBufferMapping
+                        ? sHandleImporter.lockYCbCrPersistent(
+                                *(halBuf.bufPtr), halBuf.usage, outRect)
+                        : sHandleImporter.lockYCbCr(*(halBuf.bufPtr), halBuf.usage, outRect);
                 ALOGV("%s: outLayout y %p cb %p cr %p y_str %d c_str %d c_step %d",
                         __FUNCTION__, outLayout.y, outLayout.cb, outLayout.cr,
                         outLayout.yStride, outLayout.cStride, outLayout.chromaStep);
@@ -1591,27 +1767,35 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                         (outputFourcc >> 16) & 0xFF,
                         (outputFourcc >> 24) & 0xFF);
 
+                Size sz {halBuf.width, halBuf.height};
+                // Planar outputs have the same layout as the intermediate YU12 frames
+                bool planarOutput = outputFourcc == V4L2_PIX_FMT_YUV420 ||
+                        outputFourcc == V4L2_PIX_FMT_YVU420;
+                bool scaledToOutput = false;
                 YCbCrLayout cropAndScaled;
                 ATRACE_BEGIN("cropAndScaleLocked");
                 int ret = cropAndScaleLocked(
-                        mYu12Frame,
-                        Size { halBuf.width, halBuf.height },
-                        &cropAndScaled);
+                        mYu12Frame, sz, &cropAndScaled,
+                        (planarOutput && yuvSizeCounts[sz] == 1) ? &outLayout : nullptr,
+                        &scaledToOutput);
                 ATRACE_END();
                 if (ret != 0) {
                     lk.unlock();
                     return onDeviceError("%s: crop and scale failed!", __FUNCTION__);
                 }
 
-                Size sz {halBuf.width, halBuf.height};
-                ATRACE_BEGIN("formatConvert");
-                ret = formatConvert(cropAndScaled, outLayout, sz, outputFourcc);
-                ATRACE_END();
-                if (ret != 0) {
-                    lk.unlock();
-                    return onDeviceError("%s: format coversion failed!", __FUNCTION__);
+                if (!scaledToOutput) {
+                    ATRACE_BEGIN("formatConvert");
+                    ret = formatConvert(cropAndScaled, outLayout, sz, outputFourcc);
+                    ATRACE_END();
+                    if (ret != 0) {
+                        lk.unlock();
+                        return onDeviceError("%s: format coversion failed!", __FUNCTION__);
+                    }
                 }
-                int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
+                int relFence = mPersistentBufferMapping
+                        ? sHandleImporter.flushPersistent(*(halBuf.bufPtr))
+                        : sHandleImporter.unlock(*(halBuf.bufPtr));
                 if (relFence >= 0) {
                     halBuf.acquireFence = relFence;
                 }
@@ -1625,6 +1809,26 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
 
     // Don't hold the lock while calling back to parent
     lk.unlock();
+    if (!jpegJobs.empty() || hasPendingResults()) {
+        // Results are delivered in order, so this one has to wait for the JPEG encoding
+        // of the previous ones too
+        deliverBatchedResults(parent);
+        if (!submitPendingResult(req, std::move(jpegJobs))) {
+            return onDeviceError("%s: failed to start JPEG encode thread!", __FUNCTION__);
+        }
+        signalRequestDone();
+        return true;
+    }
+    if (mResultBatchSize > 1) {
+        mBatchedRequests.push_back(req);
+        if (mBatchedRequests.size() < mResultBatchSize && hasQueuedRequests()) {
+            // Still processing as far as flush() is concerned
+            return true;
+        }
+        deliverBatchedResults(parent);
+        signalRequestDone();
+        return true;
+    }
     Status st = parent->processCaptureResult(req);
     if (st != Status::OK) {
         return onDeviceError("%s: failed to process capture result!", __FUNCTION__);
@@ -1633,6 +1837,118 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
     return true;
 }
 
+bool ExternalCameraDeviceSession::OutputThread::hasQueuedRequests() {
+    std::lock_guard<std::mutex> lk(mRequestListLock);
+    return !mRequestList.empty();
+}
+
+void ExternalCameraDeviceSession::OutputThread::deliverBatchedResults(
+        const sp<OutputThreadInterface>& parent) {
+    if (mBatchedRequests.empty()) {
+        return;
+    }
+    if (parent->processCaptureResults(mBatchedRequests) != Status::OK) {
+        ALOGE("%s: failed to process %zu capture results", __FUNCTION__,
+                mBatchedRequests.size());
+    }
+    mBatchedRequests.clear();
+}
+
+bool ExternalCameraDeviceSession::OutputThread::hasPendingResults() {
+    std::lock_guard<std::mutex> lk(mPendingResultLock);
+    return !mPendingResults.empty();
+}
+
+bool ExternalCameraDeviceSession::OutputThread::submitPendingResult(
+        const std::shared_ptr<HalRequest>& req, std::vector<JpegJob>&& jpegJobs) {
+    ATRACE_CALL();
+    std::unique_lock<std::mutex> lk(mPendingResultLock);
+    if (mJpegEncodeThread == nullptr) {
+        sp<JpegEncodeThread> thread = new JpegEncodeThread(this);
+        status_t res = thread->run("ExtCamJpeg", PRIORITY_DISPLAY);
+        if (res != OK) {
+            ALOGE("%s: failed to run JPEG encode thread: %d", __FUNCTION__, res);
+            return false;
+        }
+        mJpegEncodeThread = thread;
+    }
+    // Bounded, the V4L2 buffers are only returned when the results are delivered
+    while (mPendingResults.size() >= kMaxPendingResults) {
+        mPendingResultCond.wait(lk);
+    }
+    mPendingResults.push_back({req, std::move(jpegJobs)});
+    lk.unlock();
+    mPendingResultCond.notify_all();
+    return true;
+}
+
+bool ExternalCameraDeviceSession::OutputThread::processPendingResult(
+        JpegEncodeThread* thread) {
+    std::unique_lock<std::mutex> lk(mPendingResultLock);
+    while (mPendingResults.empty()) {
+        if (thread->isExitPending()) {
+            return false;
+        }
+        mPendingResultCond.wait_for(lk, std::chrono::milliseconds(kReqWaitTimeoutMs));
+    }
+    // Stays in the list until the result is delivered, so the OutputThread does not deliver
+    // a later result first
+    PendingResult& result = mPendingResults.front();
+    lk.unlock();
+
+    std::shared_ptr<HalRequest>& req = result.req;
+    for (auto& job : result.jpegJobs) {
+        HalStreamBuffer& halBuf = req->buffers[job.bufferIndex];
+        if (encodeJpeg(halBuf, req->setting, job) != 0) {
+            ALOGE("%s: encodeJpeg failed for frame %d", __FUNCTION__, req->frameNumber);
+            // Returned as a buffer error
+            halBuf.fenceTimeout = true;
+        }
+        std::lock_guard<std::mutex> bufferLock(mBufferLock);
+        recycleFrameLocked(job.mainFrame);
+        recycleFrameLocked(job.thumbFrame);
+    }
+
+    auto parent = mParent.promote();
+    if (parent == nullptr) {
+        ALOGE("%s: session has been disconnected!", __FUNCTION__);
+    } else if (parent->processCaptureResult(req) != Status::OK) {
+        ALOGE("%s: failed to process capture result of frame %d", __FUNCTION__,
+                req->frameNumber);
+    }
+
+    lk.lock();
+    mPendingResults.pop_front();
+    lk.unlock();
+    mPendingResultCond.notify_all();
+    return true;
+}
+
+void ExternalCameraDeviceSession::OutputThread::waitForPendingResults() {
+    std::unique_lock<std::mutex> lk(mPendingResultLock);
+    std::chrono::seconds timeout = std::chrono::seconds(kFlushWaitTimeoutSec);
+    if (!mPendingResultCond.wait_for(lk, timeout, [this] { return mPendingResults.empty(); })) {
+        ALOGE("%s: wait for pending results timeout!", __FUNCTION__);
+    }
+}
+
+void ExternalCameraDeviceSession::OutputThread::requestExit() {
+    Thread::requestExit();
+    std::unique_lock<std::mutex> lk(mPendingResultLock);
+    if (mJpegEncodeThread != nullptr) {
+        mJpegEncodeThread->requestExit();
+    }
+    lk.unlock();
+    mPendingResultCond.notify_all();
+}
+
+ExternalCameraDeviceSession::OutputThread::JpegEncodeThread::JpegEncodeThread(
+        OutputThread* outputThread) : mOutputThread(outputThread) {}
+
+bool ExternalCameraDeviceSession::OutputThread::JpegEncodeThread::threadLoop() {
+    return mOutputThread->processPendingResult(this);
+}
+
 Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
         const Size& v4lSize, const Size& thumbSize,
         const hidl_vec<Stream>& streams,
@@ -1647,10 +1963,9 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
     // Allocating intermediate YU12 frame
     if (mYu12Frame == nullptr || mYu12Frame->mWidth != v4lSize.width ||
             mYu12Frame->mHeight != v4lSize.height) {
-        mYu12Frame.clear();
-        mYu12Frame = new AllocatedFrame(v4lSize.width, v4lSize.height);
-        int ret = mYu12Frame->allocate(&mYu12FrameLayout);
-        if (ret != 0) {
+        recycleFrameLocked(mYu12Frame);
+        mYu12Frame = getFreeFrameLocked(v4lSize);
+        if (mYu12Frame == nullptr || mYu12Frame->getLayout(&mYu12FrameLayout) != 0) {
             ALOGE("%s: allocating YU12 frame failed!", __FUNCTION__);
             return Status::INTERNAL_ERROR;
         }
@@ -1660,35 +1975,16 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
     if (mYu12ThumbFrame == nullptr ||
         mYu12ThumbFrame->mWidth != thumbSize.width ||
         mYu12ThumbFrame->mHeight != thumbSize.height) {
-        mYu12ThumbFrame.clear();
-        mYu12ThumbFrame = new AllocatedFrame(thumbSize.width, thumbSize.height);
-        int ret = mYu12ThumbFrame->allocate(&mYu12ThumbFrameLayout);
-        if (ret != 0) {
+        recycleFrameLocked(mYu12ThumbFrame);
+        mYu12ThumbFrame = getFreeFrameLocked(thumbSize);
+        if (mYu12ThumbFrame == nullptr ||
+                mYu12ThumbFrame->getLayout(&mYu12ThumbFrameLayout) != 0) {
             ALOGE("%s: allocating YU12 thumb frame failed!", __FUNCTION__);
             return Status::INTERNAL_ERROR;
         }
     }
 
-    // Allocating scaled buffers
-    for (const auto& stream : streams) {
-        Size sz = {stream.width, stream.height};
-        if (sz == v4lSize) {
-            continue; // Don't need an intermediate buffer same size as v4lBuffer
-        }
-        if (mIntermediateBuffers.count(sz) == 0) {
-            // Create new intermediate buffer
-            sp<AllocatedFrame> buf = new AllocatedFrame(stream.width, stream.height);
-            int ret = buf->allocate();
-            if (ret != 0) {
-                ALOGE("%s: allocating intermediate YU12 frame %dx%d failed!",
-                            __FUNCTION__, stream.width, stream.height);
-                return Status::INTERNAL_ERROR;
-            }
-            mIntermediateBuffers[sz] = buf;
-        }
-    }
-
-    // Remove unconfigured buffers
+    // Move unconfigured buffers back to the free frames
     auto it = mIntermediateBuffers.begin();
     while (it != mIntermediateBuffers.end()) {
         bool configured = false;
@@ -1702,10 +1998,28 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
         if (configured) {
             it++;
         } else {
+            recycleFrameLocked(it->second);
             it = mIntermediateBuffers.erase(it);
         }
     }
 
+    // Allocating scaled buffers
+    for (const auto& stream : streams) {
+        Size sz = {stream.width, stream.height};
+        if (sz == v4lSize) {
+            continue; // Don't need an intermediate buffer same size as v4lBuffer
+        }
+        if (mIntermediateBuffers.count(sz) == 0) {
+            sp<AllocatedFrame> buf = getFreeFrameLocked(sz);
+            if (buf == nullptr) {
+                ALOGE("%s: allocating intermediate YU12 frame %dx%d failed!",
+                            __FUNCTION__, stream.width, stream.height);
+                return Status::INTERNAL_ERROR;
+            }
+            mIntermediateBuffers[sz] = buf;
+        }
+    }
+
     // Allocate mute test pattern frame
     mMuteTestPatternFrame.resize(mYu12Frame->mWidth * mYu12Frame->mHeight * 3);
 
@@ -1713,11 +2027,40 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
     return Status::OK;
 }
 
+sp<AllocatedFrame> ExternalCameraDeviceSession::OutputThread::getFreeFrameLocked(
+        const Size& sz) {
+    for (auto it = mFreeFrames.begin(); it != mFreeFrames.end(); it++) {
+        if ((*it)->mWidth == sz.width && (*it)->mHeight == sz.height) {
+            sp<AllocatedFrame> frame = *it;
+            mFreeFrames.erase(it);
+            return frame;
+        }
+    }
+    sp<AllocatedFrame> frame = new AllocatedFrame(sz.width, sz.height);
+    if (frame->allocate() != 0) {
+        return nullptr;
+    }
+    return frame;
+}
+
+void ExternalCameraDeviceSession::OutputThread::recycleFrameLocked(
+        const sp<AllocatedFrame>& frame) {
+    if (frame == nullptr) {
+        return;
+    }
+    // Most recently used first
+    mFreeFrames.push_front(frame);
+    if (mFreeFrames.size() > kMaxFreeFrames) {
+        mFreeFrames.pop_back();
+    }
+}
+
 void ExternalCameraDeviceSession::OutputThread::clearIntermediateBuffers() {
     std::lock_guard<std::mutex> lk(mBufferLock);
     mYu12Frame.clear();
     mYu12ThumbFrame.clear();
     mIntermediateBuffers.clear();
+    mFreeFrames.clear();
     mMuteTestPatternFrame.clear();
     mBlobBufferSize = 0;
 }
@@ -1752,6 +2095,7 @@ void ExternalCameraDeviceSession::OutputThread::flush() {
 
     ALOGV("%s: flusing inflight requests", __FUNCTION__);
     lk.unlock();
+    waitForPendingResults();
     for (const auto& req : reqs) {
         parent->processCaptureRequestError(req);
     }
@@ -1778,6 +2122,7 @@ ExternalCameraDeviceSession::OutputThread::switchToOffline() {
         }
     }
     lk.unlock();
+    waitForPendingResults();
     clearIntermediateBuffers();
     ALOGV("%s: returning %zu request for offline processing", __FUNCTION__, reqs.size());
     return reqs;
@@ -1794,7 +2139,7 @@ void ExternalCameraDeviceSession::OutputThread::waitForNextRequest(
     std::unique_lock<std::mutex> lk(mRequestListLock);
     int waitTimes = 0;
     while (mRequestList.empty()) {
-        if (exitPending()) {
+        if (exitPending() || !mBatchedRequests.empty()) {
             return;
         }
         std::chrono::milliseconds timeout = std::chrono::milliseconds(kReqWaitTimeoutMs);
@@ -1833,6 +2178,20 @@ void ExternalCameraDeviceSession::OutputThread::dump(int fd) {
         dprintf(fd, "%d, ", req->frameNumber);
     }
     dprintf(fd, "\n");
+
+    std::lock_guard<std::mutex> pendingLk(mPendingResultLock);
+    dprintf(fd, "OutputThread pending results of frame: ");
+    for (const auto& result : mPendingResults) {
+        dprintf(fd, "%d, ", result.req->frameNumber);
+    }
+    dprintf(fd, "\n");
+
+    uint64_t decodeCount = mMjpegDecodeCount;
+    dprintf(fd, "OutputThread MJPEG decoder %s: %" PRIu64 " frames, avg %" PRIu64 "us,"
+            " max %" PRIu64 "us\n", mMjpegDecoder->getName(), decodeCount,
+            decodeCount == 0 ? 0 : mMjpegDecodeTotalUs.load() / decodeCount,
+            mMjpegDecodeMaxUs.load());
+    mMjpegDecoder->dump(fd);
 }
 
 void ExternalCameraDeviceSession::cleanupBuffersLocked(int id) {
@@ -2633,6 +2992,16 @@ status_t ExternalCameraDeviceSession::fillCaptureResult(
     } else {
         afState = ANDROID_CONTROL_AF_STATE_INACTIVE;
     }
+    if (!mResultTemplate.isEmpty()) {
+        status_t res = md.merge(mResultTemplate);
+        if (res != OK) {
+            return res;
+        }
+        // Both are in the template, so these only overwrite the placeholders
+        md.find(ANDROID_CONTROL_AF_STATE).data.u8[0] = afState;
+        md.find(ANDROID_SENSOR_TIMESTAMP).data.i64[0] = timestamp;
+        return OK;
+    }
     UPDATE(md, ANDROID_CONTROL_AF_STATE, &afState, 1);
 
     camera_metadata_ro_entry activeArraySize =
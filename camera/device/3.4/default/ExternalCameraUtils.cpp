@@ -17,9 +17,15 @@
 //#define LOG_NDEBUG 0
 #include <log/log.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 #include <linux/videodev2.h>
 
 #define HAVE_JPEG // required for libyuv.h to export MJPEG decode APIs
@@ -560,6 +566,430 @@ int encodeJpegYU12(
     return 0;
 }
 
+int LibyuvMjpegDecoder::decode(const uint8_t* inData, size_t inDataSize, const Size& sz,
+        const YCbCrLayout& out) {
+    return libyuv::MJPGToI420(
+            inData, inDataSize,
+            static_cast<uint8_t*>(out.y), out.yStride,
+            static_cast<uint8_t*>(out.cb), out.cStride,
+            static_cast<uint8_t*>(out.cr), out.cStride,
+            sz.width, sz.height, sz.width, sz.height);
+}
+
+std::unique_ptr<V4l2M2mMjpegDecoder> V4l2M2mMjpegDecoder::create(const std::string& devicePath) {
+    int fd = TEMP_FAILURE_RETRY(open(devicePath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC));
+    if (fd < 0) {
+        ALOGE("%s: open %s failed: %s", __FUNCTION__, devicePath.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    v4l2_capability capability{};
+    if (TEMP_FAILURE_RETRY(ioctl(fd, VIDIOC_QUERYCAP, &capability)) < 0) {
+        ALOGE("%s: VIDIOC_QUERYCAP on %s failed: %s", __FUNCTION__, devicePath.c_str(),
+                strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    uint32_t caps = (capability.capabilities & V4L2_CAP_DEVICE_CAPS) ?
+            capability.device_caps : capability.capabilities;
+    bool mplane = (caps & V4L2_CAP_VIDEO_M2M_MPLANE) != 0;
+    if (!(caps & V4L2_CAP_STREAMING) || (!mplane && !(caps & V4L2_CAP_VIDEO_M2M))) {
+        ALOGE("%s: %s is not a streaming M2M device (caps 0x%x)", __FUNCTION__,
+                devicePath.c_str(), caps);
+        close(fd);
+        return nullptr;
+    }
+
+    uint32_t inputFourcc = 0;
+    v4l2_fmtdesc fmtdesc{};
+    fmtdesc.type = mplane ? V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE : V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    for (; TEMP_FAILURE_RETRY(ioctl(fd, VIDIOC_ENUM_FMT, &fmtdesc)) == 0; fmtdesc.index++) {
+        if (fmtdesc.pixelformat == V4L2_PIX_FMT_JPEG ||
+                fmtdesc.pixelformat == V4L2_PIX_FMT_MJPEG) {
+            inputFourcc = fmtdesc.pixelformat;
+            break;
+        }
+    }
+    if (inputFourcc == 0) {
+        ALOGE("%s: %s does not decode JPEG", __FUNCTION__, devicePath.c_str());
+        close(fd);
+        return nullptr;
+    }
+
+    ALOGI("%s: using %s (%s) as MJPEG decoder", __FUNCTION__, devicePath.c_str(),
+            reinterpret_cast<const char*>(capability.card));
+    return std::unique_ptr<V4l2M2mMjpegDecoder>(
+            new V4l2M2mMjpegDecoder(fd, mplane, inputFourcc));
+}
+
+V4l2M2mMjpegDecoder::V4l2M2mMjpegDecoder(int fd, bool mplane, uint32_t inputFourcc) :
+        mFd(fd), mMplane(mplane), mInputFourcc(inputFourcc) {}
+
+V4l2M2mMjpegDecoder::~V4l2M2mMjpegDecoder() {
+    releaseBuffers();
+    close(mFd);
+}
+
+uint32_t V4l2M2mMjpegDecoder::bufferType(bool output) const {
+    if (mMplane) {
+        return output ? V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE : V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    }
+    return output ? V4L2_BUF_TYPE_VIDEO_OUTPUT : V4L2_BUF_TYPE_VIDEO_CAPTURE;
+}
+
+void V4l2M2mMjpegDecoder::releaseBuffers() {
+    if (mStreaming) {
+        for (bool output : {true, false}) {
+            uint32_t type = bufferType(output);
+            if (TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_STREAMOFF, &type)) < 0) {
+                ALOGE("%s: STREAMOFF failed: %s", __FUNCTION__, strerror(errno));
+            }
+        }
+        mStreaming = false;
+    }
+    for (MappedBuffer* buffer : {&mOutputBuffer, &mCaptureBuffer}) {
+        if (buffer->addr != nullptr) {
+            munmap(buffer->addr, buffer->length);
+            buffer->addr = nullptr;
+            buffer->length = 0;
+        }
+    }
+    for (bool output : {true, false}) {
+        v4l2_requestbuffers reqBuffers{};
+        reqBuffers.type = bufferType(output);
+        reqBuffers.memory = V4L2_MEMORY_MMAP;
+        reqBuffers.count = 0;
+        TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_REQBUFS, &reqBuffers));
+    }
+    mSize = {0, 0};
+}
+
+int V4l2M2mMjpegDecoder::mapBuffer(bool output, MappedBuffer* buffer) {
+    v4l2_requestbuffers reqBuffers{};
+    reqBuffers.type = bufferType(output);
+    reqBuffers.memory = V4L2_MEMORY_MMAP;
+    reqBuffers.count = 1;
+    if (TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_REQBUFS, &reqBuffers)) < 0 ||
+            reqBuffers.count < 1) {
+        ALOGE("%s: REQBUFS failed: %s", __FUNCTION__, strerror(errno));
+        return -errno;
+    }
+
+    v4l2_buffer buffer_info{};
+    v4l2_plane plane{};
+    buffer_info.type = reqBuffers.type;
+    buffer_info.memory = V4L2_MEMORY_MMAP;
+    buffer_info.index = 0;
+    if (mMplane) {
+        buffer_info.m.planes = &plane;
+        buffer_info.length = 1;
+    }
+    if (TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_QUERYBUF, &buffer_info)) < 0) {
+        ALOGE("%s: QUERYBUF failed: %s", __FUNCTION__, strerror(errno));
+        return -errno;
+    }
+
+    size_t length = mMplane ? plane.length : buffer_info.length;
+    off_t offset = mMplane ? plane.m.mem_offset : buffer_info.m.offset;
+    void* addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, offset);
+    if (addr == MAP_FAILED) {
+        ALOGE("%s: mmap failed: %s", __FUNCTION__, strerror(errno));
+        return -EINVAL;
+    }
+    buffer->addr = addr;
+    buffer->length = length;
+    return 0;
+}
+
+int V4l2M2mMjpegDecoder::configure(const Size& sz, size_t inDataSize) {
+    if (mStreaming && mSize == sz && inDataSize <= mOutputBuffer.length) {
+        return 0;
+    }
+    releaseBuffers();
+
+    // A JPEG frame is rarely larger than its uncompressed luma plane
+    uint32_t inputBufferSize = std::max<uint32_t>(inDataSize, sz.width * sz.height);
+    v4l2_format fmt{};
+    fmt.type = bufferType(/*output*/true);
+    if (mMplane) {
+        fmt.fmt.pix_mp.width = sz.width;
+        fmt.fmt.pix_mp.height = sz.height;
+        fmt.fmt.pix_mp.pixelformat = mInputFourcc;
+        fmt.fmt.pix_mp.num_planes = 1;
+        fmt.fmt.pix_mp.plane_fmt[0].sizeimage = inputBufferSize;
+    } else {
+        fmt.fmt.pix.width = sz.width;
+        fmt.fmt.pix.height = sz.height;
+        fmt.fmt.pix.pixelformat = mInputFourcc;
+        fmt.fmt.pix.sizeimage = inputBufferSize;
+    }
+    if (TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_S_FMT, &fmt)) < 0) {
+        ALOGE("%s: S_FMT on output queue failed: %s", __FUNCTION__, strerror(errno));
+        return -errno;
+    }
+
+    fmt = {};
+    fmt.type = bufferType(/*output*/false);
+    if (mMplane) {
+        fmt.fmt.pix_mp.width = sz.width;
+        fmt.fmt.pix_mp.height = sz.height;
+        fmt.fmt.pix_mp.pixelformat = V4L2_PIX_FMT_YUV420;
+        fmt.fmt.pix_mp.num_planes = 1;
+    } else {
+        fmt.fmt.pix.width = sz.width;
+        fmt.fmt.pix.height = sz.height;
+        fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUV420;
+    }
+    if (TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_S_FMT, &fmt)) < 0) {
+        ALOGE("%s: S_FMT on capture queue failed: %s", __FUNCTION__, strerror(errno));
+        return -errno;
+    }
+    if (mMplane) {
+        if (fmt.fmt.pix_mp.num_planes != 1) {
+            ALOGE("%s: multi-planar capture format is not supported", __FUNCTION__);
+            return -EINVAL;
+        }
+        mCaptureFourcc = fmt.fmt.pix_mp.pixelformat;
+        mCaptureBytesPerLine = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+        mCaptureHeight = fmt.fmt.pix_mp.height;
+    } else {
+        mCaptureFourcc = fmt.fmt.pix.pixelformat;
+        mCaptureBytesPerLine = fmt.fmt.pix.bytesperline;
+        mCaptureHeight = fmt.fmt.pix.height;
+    }
+    switch (mCaptureFourcc) {
+        case V4L2_PIX_FMT_YUV420:
+        case V4L2_PIX_FMT_NV12:
+        case V4L2_PIX_FMT_NV21:
+        case V4L2_PIX_FMT_YUYV:
+            break;
+        default:
+            ALOGE("%s: unsupported capture format %c%c%c%c", __FUNCTION__,
+                    mCaptureFourcc & 0xFF, (mCaptureFourcc >> 8) & 0xFF,
+                    (mCaptureFourcc >> 16) & 0xFF, (mCaptureFourcc >> 24) & 0xFF);
+            return -EINVAL;
+    }
+    if (mCaptureHeight < sz.height) {
+        ALOGE("%s: capture height %u is smaller than %u", __FUNCTION__, mCaptureHeight,
+                sz.height);
+        return -EINVAL;
+    }
+
+    // The bytes decode() reads from the capture buffer, see the conversions there
+    const size_t lumaSize = static_cast<size_t>(mCaptureBytesPerLine) * mCaptureHeight;
+    size_t minBytesPerLine = (sz.width + 1) & ~1u;
+    size_t captureSize = 0;
+    switch (mCaptureFourcc) {
+        case V4L2_PIX_FMT_YUV420:
+            captureSize = lumaSize + static_cast<size_t>(mCaptureBytesPerLine / 2) * mCaptureHeight;
+            break;
+        case V4L2_PIX_FMT_NV12:
+        case V4L2_PIX_FMT_NV21:
+            captureSize = lumaSize +
+                    static_cast<size_t>(mCaptureBytesPerLine) * ((mCaptureHeight + 1) / 2);
+            break;
+        case V4L2_PIX_FMT_YUYV:
+            minBytesPerLine = 2 * minBytesPerLine;
+            captureSize = lumaSize;
+            break;
+    }
+    if (mCaptureBytesPerLine < minBytesPerLine) {
+        ALOGE("%s: capture stride %u is smaller than %zu", __FUNCTION__, mCaptureBytesPerLine,
+                minBytesPerLine);
+        return -EINVAL;
+    }
+
+    int ret = mapBuffer(/*output*/true, &mOutputBuffer);
+    if (ret != 0) {
+        return ret;
+    }
+    // The driver may have lowered the requested sizeimage
+    if (mOutputBuffer.length < inDataSize) {
+        ALOGE("%s: output buffer of %zu bytes cannot take a %zu bytes frame", __FUNCTION__,
+                mOutputBuffer.length, inDataSize);
+        return -ENOSPC;
+    }
+    ret = mapBuffer(/*output*/false, &mCaptureBuffer);
+    if (ret != 0) {
+        return ret;
+    }
+    if (mCaptureBuffer.length < captureSize) {
+        ALOGE("%s: capture buffer of %zu bytes is smaller than the %zu bytes of the frame",
+                __FUNCTION__, mCaptureBuffer.length, captureSize);
+        return -EINVAL;
+    }
+
+    for (bool output : {true, false}) {
+        uint32_t type = bufferType(output);
+        if (TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_STREAMON, &type)) < 0) {
+            ALOGE("%s: STREAMON failed: %s", __FUNCTION__, strerror(errno));
+            return -errno;
+        }
+        // Set after the first STREAMON so releaseBuffers turns both queues off
+        mStreaming = true;
+    }
+    mSize = sz;
+    return 0;
+}
+
+int V4l2M2mMjpegDecoder::queueBuffer(bool output, size_t bytesUsed) {
+    v4l2_buffer buffer{};
+    v4l2_plane plane{};
+    buffer.type = bufferType(output);
+    buffer.memory = V4L2_MEMORY_MMAP;
+    buffer.index = 0;
+    if (mMplane) {
+        plane.bytesused = bytesUsed;
+        buffer.m.planes = &plane;
+        buffer.length = 1;
+    } else {
+        buffer.bytesused = bytesUsed;
+    }
+    if (TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_QBUF, &buffer)) < 0) {
+        ALOGE("%s: QBUF failed: %s", __FUNCTION__, strerror(errno));
+        return -errno;
+    }
+    return 0;
+}
+
+int V4l2M2mMjpegDecoder::dequeueBuffer(bool output, uint32_t* flags) {
+    struct pollfd pfd = {mFd, static_cast<short>(output ? POLLOUT : POLLIN), 0};
+    int ret = TEMP_FAILURE_RETRY(poll(&pfd, 1, kDecodeTimeoutMs));
+    if (ret <= 0 || (pfd.revents & (POLLERR | POLLNVAL))) {
+        ALOGE("%s: poll failed or timed out: ret %d, revents 0x%x", __FUNCTION__, ret,
+                pfd.revents);
+        return ret < 0 ? -errno : -ETIMEDOUT;
+    }
+
+    v4l2_buffer buffer{};
+    v4l2_plane plane{};
+    buffer.type = bufferType(output);
+    buffer.memory = V4L2_MEMORY_MMAP;
+    if (mMplane) {
+        buffer.m.planes = &plane;
+        buffer.length = 1;
+    }
+    if (TEMP_FAILURE_RETRY(ioctl(mFd, VIDIOC_DQBUF, &buffer)) < 0) {
+        ALOGE("%s: DQBUF failed: %s", __FUNCTION__, strerror(errno));
+        return -errno;
+    }
+    *flags = buffer.flags;
+    return 0;
+}
+
+int V4l2M2mMjpegDecoder::decode(const uint8_t* inData, size_t inDataSize, const Size& sz,
+        const YCbCrLayout& out) {
+    int ret = configure(sz, inDataSize);
+    if (ret != 0) {
+        releaseBuffers();
+        return ret;
+    }
+
+    if (inDataSize > mOutputBuffer.length) {
+        releaseBuffers();
+        return -ENOSPC;
+    }
+    memcpy(mOutputBuffer.addr, inData, inDataSize);
+    uint32_t outputFlags = 0;
+    uint32_t captureFlags = 0;
+    ret = queueBuffer(/*output*/true, inDataSize);
+    if (ret == 0) {
+        ret = queueBuffer(/*output*/false, 0);
+    }
+    if (ret == 0) {
+        ret = dequeueBuffer(/*output*/false, &captureFlags);
+    }
+    if (ret == 0) {
+        ret = dequeueBuffer(/*output*/true, &outputFlags);
+    }
+    if (ret == 0 && ((captureFlags | outputFlags) & V4L2_BUF_FLAG_ERROR)) {
+        ALOGE("%s: hardware decode failed", __FUNCTION__);
+        ret = -EIO;
+    }
+    if (ret != 0) {
+        // STREAMOFF takes back whatever is still queued, start over on the next frame
+        releaseBuffers();
+        return ret;
+    }
+
+    const uint8_t* src = static_cast<const uint8_t*>(mCaptureBuffer.addr);
+    uint8_t* dstY = static_cast<uint8_t*>(out.y);
+    uint8_t* dstU = static_cast<uint8_t*>(out.cb);
+    uint8_t* dstV = static_cast<uint8_t*>(out.cr);
+    const uint32_t stride = mCaptureBytesPerLine;
+    const uint8_t* srcUV = src + stride * mCaptureHeight;
+    switch (mCaptureFourcc) {
+        case V4L2_PIX_FMT_YUV420: {
+            const uint32_t cStride = stride / 2;
+            const uint8_t* srcV = srcUV + cStride * (mCaptureHeight / 2);
+            return libyuv::I420Copy(src, stride, srcUV, cStride, srcV, cStride,
+                    dstY, out.yStride, dstU, out.cStride, dstV, out.cStride,
+                    sz.width, sz.height);
+        }
+        case V4L2_PIX_FMT_NV12:
+            return libyuv::NV12ToI420(src, stride, srcUV, stride,
+                    dstY, out.yStride, dstU, out.cStride, dstV, out.cStride,
+                    sz.width, sz.height);
+        case V4L2_PIX_FMT_NV21:
+            return libyuv::NV21ToI420(src, stride, srcUV, stride,
+                    dstY, out.yStride, dstU, out.cStride, dstV, out.cStride,
+                    sz.width, sz.height);
+        case V4L2_PIX_FMT_YUYV:
+            return libyuv::YUY2ToI420(src, stride,
+                    dstY, out.yStride, dstU, out.cStride, dstV, out.cStride,
+                    sz.width, sz.height);
+        default:
+            return -EINVAL;
+    }
+}
+
+FallbackMjpegDecoder::FallbackMjpegDecoder(std::unique_ptr<MjpegDecoder> primary) :
+        mPrimary(std::move(primary)), mPrimaryDisabled(false), mFallbackCount(0) {}
+
+const char* FallbackMjpegDecoder::getName() const {
+    return mPrimaryDisabled ? mFallback.getName() : mPrimary->getName();
+}
+
+int FallbackMjpegDecoder::decode(const uint8_t* inData, size_t inDataSize, const Size& sz,
+        const YCbCrLayout& out) {
+    if (!mPrimaryDisabled) {
+        int ret = mPrimary->decode(inData, inDataSize, sz, out);
+        if (ret == 0) {
+            mConsecutiveFailures = 0;
+            return 0;
+        }
+        if (++mConsecutiveFailures >= kMaxConsecutiveFailures) {
+            ALOGE("%s: %s decoder failed %d times in a row, switching to %s", __FUNCTION__,
+                    mPrimary->getName(), mConsecutiveFailures, mFallback.getName());
+            mPrimaryDisabled = true;
+        }
+        mFallbackCount++;
+    }
+    return mFallback.decode(inData, inDataSize, sz, out);
+}
+
+void FallbackMjpegDecoder::dump(int fd) {
+    dprintf(fd, "MJPEG decoder: %s (configured %s), %" PRIu64 " frames fell back to %s\n",
+            getName(), mPrimary->getName(), mFallbackCount.load(), mFallback.getName());
+}
+
+std::unique_ptr<MjpegDecoder> createMjpegDecoder(
+        const ::android::hardware::camera::external::common::ExternalCameraConfig& cfg) {
+    using ::android::hardware::camera::external::common::ExternalCameraConfig;
+    std::unique_ptr<MjpegDecoder> primary;
+    if (cfg.mjpegDecoder == ExternalCameraConfig::MJPEG_DECODER_V4L2_M2M) {
+        primary = V4l2M2mMjpegDecoder::create(cfg.mjpegDecoderDevice);
+        if (primary == nullptr) {
+            ALOGE("%s: MJPEG decoder %s not available, using libyuv", __FUNCTION__,
+                    cfg.mjpegDecoderDevice.c_str());
+        }
+    }
+    if (primary == nullptr) {
+        return std::make_unique<LibyuvMjpegDecoder>();
+    }
+    return std::make_unique<FallbackMjpegDecoder>(std::move(primary));
+}
+
 Size getMaxThumbnailResolution(const common::V1_0::helper::CameraMetadata& chars) {
     Size thumbSize { 0, 0 };
     camera_metadata_ro_entry entry =
@@ -659,9 +1089,67 @@ status_t fillCaptureResultCommon(
     return OK;
 }
 
+status_t initCaptureResultTemplate(common::V1_0::helper::CameraMetadata& tmpl,
+        camera_metadata_ro_entry& activeArraySize) {
+    tmpl.clear();
+    const uint8_t afState = ANDROID_CONTROL_AF_STATE_INACTIVE;
+    UPDATE(tmpl, ANDROID_CONTROL_AF_STATE, &afState, 1);
+    status_t res = fillCaptureResultCommon(tmpl, /*timestamp*/0, activeArraySize);
+    if (res != OK) {
+        tmpl.clear();
+        return res;
+    }
+    return tmpl.sort();
+}
+
 #undef ARRAY_SIZE
 #undef UPDATE
 
+bool StreamCombinationCache::lookup(const V3_2::StreamConfiguration& config,
+        /*out*/::android::hardware::camera::common::V1_0::Status* status) {
+    const std::string key = getKey(config);
+    std::lock_guard<std::mutex> lk(mLock);
+    auto it = mEntries.find(key);
+    if (it == mEntries.end()) {
+        return false;
+    }
+    *status = it->second;
+    return true;
+}
+
+void StreamCombinationCache::insert(const V3_2::StreamConfiguration& config,
+        ::android::hardware::camera::common::V1_0::Status status) {
+    std::string key = getKey(config);
+    std::lock_guard<std::mutex> lk(mLock);
+    if (mEntries.size() >= kMaxEntries) {
+        // Probing is bursty, starting over is good enough
+        mEntries.clear();
+    }
+    mEntries.emplace(std::move(key), status);
+}
+
+void StreamCombinationCache::clear() {
+    std::lock_guard<std::mutex> lk(mLock);
+    mEntries.clear();
+}
+
+std::string StreamCombinationCache::getKey(const V3_2::StreamConfiguration& config) {
+    std::string key;
+    auto append = [&key](auto value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    append(config.operationMode);
+    for (const auto& stream : config.streams) {
+        append(stream.streamType);
+        append(stream.width);
+        append(stream.height);
+        append(stream.format);
+        append(stream.dataSpace);
+        append(stream.rotation);
+    }
+    return key;
+}
+
 }  // namespace implementation
 }  // namespace V3_4
 
@@ -707,6 +1195,7 @@ namespace {
     const int kDefaultJpegBufSize = 5 << 20; // 5MB
     const int kDefaultNumVideoBuffer = 4;
     const int kDefaultNumStillBuffer = 2;
+    const unsigned kDefaultResultBatchSize = 1; // no batching
     const int kDefaultOrientation = 0; // suitable for natural landscape displays like tablet/TV
                                        // For phone devices 270 is better
 } // anonymous namespace
@@ -834,6 +1323,38 @@ ExternalCameraConfig ExternalCameraConfig::loadFromCfg(const char* cfgPath) {
         ret.orientation = orientation->IntAttribute("degree", /*Default*/kDefaultOrientation);
     }
 
+    XMLElement *mjpegDecoder = deviceCfg->FirstChildElement("MjpegDecoder");
+    if (mjpegDecoder == nullptr) {
+        ALOGI("%s: no MJPEG decoder specified", __FUNCTION__);
+    } else {
+        const char* backend = mjpegDecoder->Attribute("backend");
+        const char* device = mjpegDecoder->Attribute("device");
+        if (backend == nullptr || strcmp(backend, "libyuv") == 0) {
+            ret.mjpegDecoder = MJPEG_DECODER_LIBYUV;
+        } else if (strcmp(backend, "v4l2_m2m") == 0 && device != nullptr) {
+            ret.mjpegDecoder = MJPEG_DECODER_V4L2_M2M;
+            ret.mjpegDecoderDevice = device;
+        } else {
+            ALOGE("%s: unsupported MJPEG decoder %s (device %s), using libyuv", __FUNCTION__,
+                    backend, device == nullptr ? "none" : device);
+        }
+    }
+
+    XMLElement *persistentMapping = deviceCfg->FirstChildElement("PersistentBufferMapping");
+    if (persistentMapping == nullptr) {
+        ALOGI("%s: persistent buffer mapping is not enabled", __FUNCTION__);
+    } else {
+        ret.persistentBufferMapping = persistentMapping->BoolAttribute("enabled", false);
+    }
+
+    XMLElement *resultBatch = deviceCfg->FirstChildElement("ResultBatch");
+    if (resultBatch == nullptr) {
+        ALOGI("%s: no result batch size specified", __FUNCTION__);
+    } else {
+        ret.resultBatchSize = std::max(
+                1u, resultBatch->UnsignedAttribute("size", /*Default*/kDefaultResultBatchSize));
+    }
+
     ALOGI("%s: external camera cfg loaded: maxJpgBufSize %d,"
             " num video buffers %d, num still buffers %d, orientation %d",
             __FUNCTION__, ret.maxJpegBufSize,
@@ -848,6 +1369,9 @@ ExternalCameraConfig ExternalCameraConfig::loadFromCfg(const char* cfgPath) {
     }
     ALOGI("%s: minStreamSize: %dx%d" , __FUNCTION__,
          ret.minStreamSize.width, ret.minStreamSize.height);
+    ALOGI("%s: MJPEG decoder: %s %s", __FUNCTION__,
+            ret.mjpegDecoder == MJPEG_DECODER_V4L2_M2M ? "v4l2_m2m" : "libyuv",
+            ret.mjpegDecoderDevice.c_str());
     return ret;
 }
 
@@ -885,7 +1409,10 @@ ExternalCameraConfig::ExternalCameraConfig() :
         numVideoBuffers(kDefaultNumVideoBuffer),
         numStillBuffers(kDefaultNumStillBuffer),
         depthEnabled(false),
-        orientation(kDefaultOrientation) {
+        orientation(kDefaultOrientation),
+        mjpegDecoder(MJPEG_DECODER_LIBYUV),
+        persistentBufferMapping(false),
+        resultBatchSize(kDefaultResultBatchSize) {
     fpsLimits.push_back({/*Size*/{ 640,  480}, /*FPS upper bound*/30.0});
     fpsLimits.push_back({/*Size*/{1280,  720}, /*FPS upper bound*/7.5});
     fpsLimits.push_back({/*Size*/{1920, 1080}, /*FPS upper bound*/5.0});
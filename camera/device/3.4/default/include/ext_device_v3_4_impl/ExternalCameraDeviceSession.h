@@ -125,8 +125,17 @@ struct ExternalCameraDeviceSession : public virtual RefBase,
         void flush();
         void dump(int fd);
         virtual bool threadLoop() override;
+        // Also stops the JpegEncodeThread
+        virtual void requestExit() override;
 
         void setExifMakeModel(const std::string& make, const std::string& model);
+        // Must be called before the first request is submitted
+        void setMjpegDecoder(std::unique_ptr<MjpegDecoder> decoder);
+        // Must be called before the first request is submitted. The mapper must support
+        // persistent locks.
+        void setPersistentBufferMapping(bool enabled);
+        // Must be called before the first request is submitted
+        void setResultBatchSize(uint32_t size);
 
         // The remaining request list is returned for offline processing
         std::list<std::shared_ptr<HalRequest>> switchToOffline();
@@ -142,25 +151,95 @@ struct ExternalCameraDeviceSession : public virtual RefBase,
         static const int kReqWaitTimeoutMs = 33;   // 33ms
         static const int kReqWaitTimesMax = 90;    // 33ms * 90 ~= 3 sec
 
+        // Returns without a request if results are held for batching and no request is queued
         void waitForNextRequest(std::shared_ptr<HalRequest>* out);
         void signalRequestDone();
+        bool hasQueuedRequests();
+        // Delivers the results held for batching, if any
+        void deliverBatchedResults(const sp<OutputThreadInterface>& parent);
 
+        // If dst and scaledToDst are not null, a frame that needs scaling is scaled directly
+        // into dst, which must be a planar YUV420 layout, and *scaledToDst is set to true.
         int cropAndScaleLocked(
                 sp<AllocatedFrame>& in, const Size& outSize,
-                YCbCrLayout* out);
+                YCbCrLayout* out, const YCbCrLayout* dst = nullptr,
+                bool* scaledToDst = nullptr);
 
         int cropAndScaleThumbLocked(
                 sp<AllocatedFrame>& in, const Size& outSize,
                 YCbCrLayout* out);
 
+        // The crop and scaled YU12 images of a JPEG output and its encoding parameters
+        struct JpegJob {
+            size_t bufferIndex = 0; // in HalRequest::buffers
+            Size jpegSize;
+            Size thumbSize;
+            int jpegQuality = 0;
+            int thumbQuality = 0;
+            bool outputThumbnail = false;
+            ssize_t maxJpegCodeSize = 0;
+            YCbCrLayout yu12Main;
+            YCbCrLayout yu12Thumb;
+            // Own the images when the job is encoded by the JpegEncodeThread
+            sp<AllocatedFrame> mainFrame;
+            sp<AllocatedFrame> thumbFrame;
+        };
+
+        // A processed request waiting for its JPEG outputs to be encoded, or for the
+        // results before it to be delivered
+        struct PendingResult {
+            std::shared_ptr<HalRequest> req;
+            std::vector<JpegJob> jpegJobs;
+        };
+
+        // Encodes the JPEG outputs and delivers the pending results in order, so the
+        // OutputThread can go on with the next frames
+        class JpegEncodeThread : public android::Thread {
+        public:
+            // The OutputThread stops and joins this thread before it is destroyed
+            explicit JpegEncodeThread(OutputThread* outputThread);
+            virtual bool threadLoop() override;
+            bool isExitPending() const { return exitPending(); }
+
+        private:
+            OutputThread* const mOutputThread;
+        };
+
+        // Prepares and encodes a JPEG output synchronously
         int createJpegLocked(HalStreamBuffer &halBuf,
                 const common::V1_0::helper::CameraMetadata& settings);
 
+        // Reads the JPEG settings and crops and scales the images to encode. If copyFrames is
+        // true the images are copied out of the intermediate buffers.
+        int prepareJpegLocked(const HalStreamBuffer &halBuf,
+                const common::V1_0::helper::CameraMetadata& settings,
+                bool copyFrames, JpegJob* job);
+
+        // Encodes a prepared JPEG output into halBuf, doesn't need mBufferLock
+        int encodeJpeg(HalStreamBuffer &halBuf,
+                const common::V1_0::helper::CameraMetadata& settings,
+                const JpegJob& job);
+
+        bool hasPendingResults();
+        // Blocks while there are already kMaxPendingResults pending results
+        bool submitPendingResult(const std::shared_ptr<HalRequest>& req,
+                std::vector<JpegJob>&& jpegJobs);
+        // Called by the JpegEncodeThread
+        bool processPendingResult(JpegEncodeThread* thread);
+        void waitForPendingResults();
+
         void clearIntermediateBuffers();
 
+        // Takes a frame of the given size from mFreeFrames, or allocates one if there is none.
+        // Returns nullptr if the allocation fails.
+        sp<AllocatedFrame> getFreeFrameLocked(const Size& sz);
+        // Keeps a frame no longer used by the current configuration in mFreeFrames
+        void recycleFrameLocked(const sp<AllocatedFrame>& frame);
+
         const wp<OutputThreadInterface> mParent;
         const CroppingType mCroppingType;
         const common::V1_0::helper::CameraMetadata mCameraCharacteristics;
+        bool mPersistentBufferMapping = false;
 
         mutable std::mutex mRequestListLock;      // Protect acccess to mRequestList,
                                                   // mProcessingRequest and mProcessingFrameNumer
@@ -170,6 +249,12 @@ struct ExternalCameraDeviceSession : public virtual RefBase,
         bool mProcessingRequest = false;
         uint32_t mProcessingFrameNumer = 0;
 
+        // Processed requests whose results are delivered together. Only used by the thread
+        // loop, which keeps mProcessingRequest set until they are delivered so that flush()
+        // waits for them.
+        uint32_t mResultBatchSize = 1;
+        std::vector<std::shared_ptr<HalRequest>> mBatchedRequests;
+
         // V4L2 frameIn
         // (MJPG decode)-> mYu12Frame
         // (Scale)-> mScaledYu12Frames
@@ -179,6 +264,9 @@ struct ExternalCameraDeviceSession : public virtual RefBase,
         sp<AllocatedFrame> mYu12ThumbFrame;
         std::unordered_map<Size, sp<AllocatedFrame>, SizeHasher> mIntermediateBuffers;
         std::unordered_map<Size, sp<AllocatedFrame>, SizeHasher> mScaledYu12Frames;
+        // Intermediate frames of previous configurations, reused when they are configured again
+        static const size_t kMaxFreeFrames = 4;
+        std::list<sp<AllocatedFrame>> mFreeFrames;
         YCbCrLayout mYu12FrameLayout;
         YCbCrLayout mYu12ThumbFrameLayout;
         std::vector<uint8_t> mMuteTestPatternFrame;
@@ -186,8 +274,23 @@ struct ExternalCameraDeviceSession : public virtual RefBase,
         bool mCameraMuted = false;
         uint32_t mBlobBufferSize = 0; // 0 -> HAL derive buffer size, else: use given size
 
+        std::mutex mExifLock; // Protect access to mExifUtils and the EXIF make and model
         std::string mExifMake;
         std::string mExifModel;
+        // Kept across captures, its APP1 segment is patched instead of regenerated
+        std::unique_ptr<ExifUtils> mExifUtils;
+
+        std::unique_ptr<MjpegDecoder> mMjpegDecoder;
+        // MJPEG decode latency, in microseconds
+        std::atomic<uint64_t> mMjpegDecodeCount = 0;
+        std::atomic<uint64_t> mMjpegDecodeTotalUs = 0;
+        std::atomic<uint64_t> mMjpegDecodeMaxUs = 0;
+
+        static const size_t kMaxPendingResults = 2;
+        std::mutex mPendingResultLock; // Protect access to mPendingResults and mJpegEncodeThread
+        std::condition_variable mPendingResultCond; // signaled when mPendingResults changes
+        std::list<PendingResult> mPendingResults;
+        sp<JpegEncodeThread> mJpegEncodeThread;
     };
 
 protected:
@@ -238,6 +341,10 @@ protected:
 
     virtual Status processCaptureResult(std::shared_ptr<HalRequest>&) override;
 
+    // Sends the shutters and errors of all the requests with one notify call and their results
+    // with one processCaptureResult call
+    virtual Status processCaptureResults(std::vector<std::shared_ptr<HalRequest>>&) override;
+
     virtual Status processCaptureRequestError(const std::shared_ptr<HalRequest>&,
         /*out*/std::vector<NotifyMsg>* msgs = nullptr,
         /*out*/std::vector<CaptureResult>* results = nullptr) override;
@@ -307,6 +414,9 @@ protected:
     Status processOneCaptureRequest(const CaptureRequest& request);
 
     void notifyShutter(uint32_t frameNumber, nsecs_t shutterTs);
+    // Returns the V4L2 frame of a processed request and fills its messages and result
+    void prepareCaptureResult(std::shared_ptr<HalRequest>& req,
+            /*out*/std::vector<NotifyMsg>* msgs, /*out*/CaptureResult* result);
     void invokeProcessCaptureResultCallback(
             hidl_vec<CaptureResult> &results, bool tryWriteFmq);
 
@@ -322,6 +432,9 @@ protected:
     const sp<ICameraDeviceCallback> mCallback;
     const ExternalCameraConfig& mCfg;
     const common::V1_0::helper::CameraMetadata mCameraCharacteristics;
+    // The result tags every capture result has, merged into the request settings of each
+    // frame. Empty if it could not be built, and then the tags are updated one by one.
+    common::V1_0::helper::CameraMetadata mResultTemplate;
     const std::vector<SupportedV4L2Format> mSupportedFormats;
     const CroppingType mCroppingType;
     const std::string mCameraId;
@@ -152,6 +152,8 @@ protected:
     std::string mDevicePath;
     const ExternalCameraConfig& mCfg;
     std::vector<SupportedV4L2Format> mSupportedFormats;
+    // Answers of isStreamCombinationSupported for mSupportedFormats
+    StreamCombinationCache mStreamCombinationCache;
     CroppingType mCroppingType;
 
     wp<ExternalCameraDeviceSession> mSession = nullptr;
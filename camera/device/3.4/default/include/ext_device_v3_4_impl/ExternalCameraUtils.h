@@ -22,7 +22,10 @@
 #include <android/hardware/graphics/common/1.0/types.h>
 #include <android/hardware/graphics/mapper/2.0/IMapper.h>
 #include <inttypes.h>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -102,6 +105,27 @@ struct ExternalCameraConfig {
     // The value of android.sensor.orientation
     int32_t orientation;
 
+    // Decoder used for MJPEG V4L2 frames
+    enum MjpegDecoderType {
+        MJPEG_DECODER_LIBYUV,
+        // Hardware JPEG decoder exposed as a V4L2 memory-to-memory device
+        MJPEG_DECODER_V4L2_M2M
+    };
+    MjpegDecoderType mjpegDecoder;
+
+    // Video node of the MJPEG_DECODER_V4L2_M2M decoder
+    std::string mjpegDecoderDevice;
+
+    // Keep the YUV and Y16 output buffers mapped for the life of their stream and flush the
+    // CPU writes of each frame, instead of locking and unlocking them every frame. Only used
+    // with graphics mapper 4.0.
+    bool persistentBufferMapping;
+
+    // Maximal number of capture results delivered with one callback. Results are only held
+    // back while more requests are queued, so a value above 1 adds no latency when the
+    // request rate is low.
+    uint32_t resultBatchSize;
+
 private:
     ExternalCameraConfig();
     static bool updateFpsList(tinyxml2::XMLElement* fpsList, std::vector<FpsLimitation>& fpsLimits);
@@ -248,6 +272,90 @@ int encodeJpegYU12(const Size &inSz,
         void *out, size_t maxOutSize,
         size_t &actualCodeSize);
 
+// Decodes MJPEG V4L2 frames to YU12 frames
+class MjpegDecoder {
+public:
+    virtual ~MjpegDecoder() {}
+    virtual const char* getName() const = 0;
+    // Decodes inData into out, which is a YU12 layout of size sz. Returns non-zero on failure.
+    virtual int decode(const uint8_t* inData, size_t inDataSize, const Size& sz,
+            const YCbCrLayout& out) = 0;
+    virtual void dump(int /*fd*/) {}
+};
+
+class LibyuvMjpegDecoder : public MjpegDecoder {
+public:
+    const char* getName() const override { return "libyuv"; }
+    int decode(const uint8_t* inData, size_t inDataSize, const Size& sz,
+            const YCbCrLayout& out) override;
+};
+
+// Hardware JPEG decoder exposed as a V4L2 memory-to-memory device. The JPEG goes to the OUTPUT
+// queue and the decoded frame comes from the CAPTURE queue, one buffer each.
+class V4l2M2mMjpegDecoder : public MjpegDecoder {
+public:
+    // Returns nullptr if the device is not a usable JPEG decoder
+    static std::unique_ptr<V4l2M2mMjpegDecoder> create(const std::string& devicePath);
+    ~V4l2M2mMjpegDecoder() override;
+
+    const char* getName() const override { return "V4L2 M2M"; }
+    int decode(const uint8_t* inData, size_t inDataSize, const Size& sz,
+            const YCbCrLayout& out) override;
+
+private:
+    struct MappedBuffer {
+        void* addr = nullptr;
+        size_t length = 0;
+    };
+
+    V4l2M2mMjpegDecoder(int fd, bool mplane, uint32_t inputFourcc);
+
+    uint32_t bufferType(bool output) const;
+    int configure(const Size& sz, size_t inDataSize);
+    int mapBuffer(bool output, MappedBuffer* buffer);
+    int queueBuffer(bool output, size_t bytesUsed);
+    int dequeueBuffer(bool output, uint32_t* flags);
+    void releaseBuffers();
+
+    static const int kDecodeTimeoutMs = 100;
+
+    const int mFd;
+    const bool mMplane;
+    const uint32_t mInputFourcc;
+    bool mStreaming = false;
+    Size mSize = {0, 0};
+    uint32_t mCaptureFourcc = 0;
+    uint32_t mCaptureBytesPerLine = 0;
+    uint32_t mCaptureHeight = 0;
+    MappedBuffer mOutputBuffer;
+    MappedBuffer mCaptureBuffer;
+};
+
+// Decodes with the configured decoder, and with libyuv when the configured decoder is not
+// available or fails. The configured decoder is dropped after kMaxConsecutiveFailures failures
+// in a row.
+class FallbackMjpegDecoder : public MjpegDecoder {
+public:
+    explicit FallbackMjpegDecoder(std::unique_ptr<MjpegDecoder> primary);
+
+    const char* getName() const override;
+    int decode(const uint8_t* inData, size_t inDataSize, const Size& sz,
+            const YCbCrLayout& out) override;
+    void dump(int fd) override;
+
+private:
+    static const int kMaxConsecutiveFailures = 10;
+
+    std::unique_ptr<MjpegDecoder> mPrimary;
+    LibyuvMjpegDecoder mFallback;
+    int mConsecutiveFailures = 0;
+    std::atomic<bool> mPrimaryDisabled;
+    std::atomic<uint64_t> mFallbackCount;
+};
+
+std::unique_ptr<MjpegDecoder> createMjpegDecoder(
+        const ::android::hardware::camera::external::common::ExternalCameraConfig& cfg);
+
 Size getMaxThumbnailResolution(const common::V1_0::helper::CameraMetadata&);
 
 void freeReleaseFences(hidl_vec<V3_2::CaptureResult>&);
@@ -255,6 +363,34 @@ void freeReleaseFences(hidl_vec<V3_2::CaptureResult>&);
 status_t fillCaptureResultCommon(common::V1_0::helper::CameraMetadata& md, nsecs_t timestamp,
         camera_metadata_ro_entry& activeArraySize);
 
+// Fills the result tags of fillCaptureResultCommon and ANDROID_CONTROL_AF_STATE into tmpl, with
+// placeholders for the timestamp and AF state, which are set in place for each frame
+status_t initCaptureResultTemplate(common::V1_0::helper::CameraMetadata& tmpl,
+        camera_metadata_ro_entry& activeArraySize);
+
+// Remembers the answers to stream combination queries of a device, which only depend on the
+// queried streams once the supported formats of the device are known. Apps probe many
+// combinations when they open a camera, often the same ones each time.
+class StreamCombinationCache {
+public:
+    // Returns false if the combination is not cached
+    bool lookup(const V3_2::StreamConfiguration& config,
+            /*out*/::android::hardware::camera::common::V1_0::Status* status);
+    void insert(const V3_2::StreamConfiguration& config,
+            ::android::hardware::camera::common::V1_0::Status status);
+    // Must be called when the supported formats change
+    void clear();
+
+private:
+    static const size_t kMaxEntries = 64;
+
+    // The stream fields isStreamCombinationSupported looks at
+    static std::string getKey(const V3_2::StreamConfiguration& config);
+
+    std::mutex mLock;
+    std::unordered_map<std::string, ::android::hardware::camera::common::V1_0::Status> mEntries;
+};
+
 // Interface for OutputThread calling back to parent
 struct OutputThreadInterface : public virtual RefBase {
     virtual ::android::hardware::camera::common::V1_0::Status importBuffer(
@@ -274,6 +410,19 @@ struct OutputThreadInterface : public virtual RefBase {
     virtual ::android::hardware::camera::common::V1_0::Status processCaptureResult(
             std::shared_ptr<HalRequest>&) = 0;
 
+    // Delivers the results of several requests, in order. The default implementation delivers
+    // them one at a time.
+    virtual ::android::hardware::camera::common::V1_0::Status processCaptureResults(
+            std::vector<std::shared_ptr<HalRequest>>& reqs) {
+        for (auto& req : reqs) {
+            auto status = processCaptureResult(req);
+            if (status != ::android::hardware::camera::common::V1_0::Status::OK) {
+                return status;
+            }
+        }
+        return ::android::hardware::camera::common::V1_0::Status::OK;
+    }
+
     virtual ssize_t getJpegBufferSize(uint32_t width, uint32_t height) const = 0;
 };
 
@@ -59,6 +59,8 @@ Return<void> CameraDevice::getPhysicalCameraCharacteristics(const hidl_string& p
         V3_5::ICameraDevice::getPhysicalCameraCharacteristics_cb _hidl_cb) {
     Status status = initStatus();
     CameraMetadata cameraCharacteristics;
+    // Held until the callback returns, as cameraCharacteristics points into it
+    std::shared_ptr<const camera_metadata_t> physicalInfo;
     if (status == Status::OK) {
         // Require module 2.5+ version.
         if (mModule->getModuleApiVersion() < CAMERA_MODULE_API_VERSION_2_5) {
@@ -75,10 +77,10 @@ Return<void> CameraDevice::getPhysicalCameraCharacteristics(const hidl_string& p
                 ALOGE("%s: Invalid physicalCameraId %s", __FUNCTION__, physicalCameraId.c_str());
                 status = Status::ILLEGAL_ARGUMENT;
             } else {
-                camera_metadata_t *physicalInfo = nullptr;
-                int ret = mModule->getPhysicalCameraInfo((int)id, &physicalInfo);
+                int ret = mModule->getPhysicalCameraCharacteristics((int)id, &physicalInfo);
                 if (ret == OK) {
-                    V3_2::implementation::convertToHidl(physicalInfo, &cameraCharacteristics);
+                    V3_2::implementation::convertToHidl(physicalInfo.get(),
+                            &cameraCharacteristics);
                 } else if (ret == -EINVAL) {
                     ALOGE("%s: %s is not a valid physical camera Id outside of getCameraIdList()",
                             __FUNCTION__, physicalCameraId.c_str());
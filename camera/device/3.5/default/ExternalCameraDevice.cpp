@@ -102,8 +102,12 @@ Return<void> ExternalCameraDevice::isStreamCombinationSupported(
         streamsV3_2[i++] = it.v3_2;
     }
     V3_2::StreamConfiguration streamConfig = {streamsV3_2, streams.operationMode};
-    auto status = ExternalCameraDeviceSession::isStreamCombinationSupported(streamConfig,
-            mSupportedFormats, mCfg);
+    Status status;
+    if (!mStreamCombinationCache.lookup(streamConfig, &status)) {
+        status = ExternalCameraDeviceSession::isStreamCombinationSupported(streamConfig,
+                mSupportedFormats, mCfg);
+        mStreamCombinationCache.insert(streamConfig, status);
+    }
     _hidl_cb(Status::OK, Status::OK == status);
     return Void();
 }
@@ -296,6 +296,10 @@ Status ExternalCameraDeviceSession::switchToOffline(const hidl_vec<int32_t>& off
         size_t idx = 0;
         for(auto streamId : offlineStreams) {
             circulatingBuffers[streamId] = mCirculatingBuffers.at(streamId);
+            // The offline session locks the buffers per frame
+            for (auto& pair : circulatingBuffers[streamId]) {
+                sHandleImporter.unlockPersistent(pair.second);
+            }
             mCirculatingBuffers.erase(streamId);
             streamInfos[idx++] = mStreamMap.at(streamId);
             mStreamMap.erase(streamId);
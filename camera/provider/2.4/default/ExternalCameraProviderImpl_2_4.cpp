@@ -63,6 +63,39 @@ bool matchDeviceName(int cameraIdOffset,
     return false;
 }
 
+// Reads the first line of a sysfs attribute, or returns an empty string if it does not exist.
+std::string readSysfsAttribute(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "re");
+    if (file == nullptr) {
+        return "";
+    }
+    char buf[128] = {};
+    if (fgets(buf, sizeof(buf), file) == nullptr) {
+        buf[0] = '\0';
+    }
+    fclose(file);
+    buf[strcspn(buf, "\n")] = '\0';
+    return buf;
+}
+
+// Returns a key identifying a V4L2 device node of a USB device across replugs: the vendor id,
+// product id and serial number of the USB device, and the interface and index of the node
+// within it. Returns an empty string for devices not on USB.
+std::string getUsbDeviceKey(const char* devName) {
+    const std::string sysfsPath = std::string("/sys/class/video4linux/") +
+            (devName + strlen(kDevicePath));
+    // "device" links to the USB interface, whose parent is the USB device
+    const std::string vendorId = readSysfsAttribute(sysfsPath + "/device/../idVendor");
+    const std::string productId = readSysfsAttribute(sysfsPath + "/device/../idProduct");
+    if (vendorId.empty() || productId.empty()) {
+        return "";
+    }
+    return vendorId + ":" + productId + ":" +
+            readSysfsAttribute(sysfsPath + "/device/../serial") + ":" +
+            readSysfsAttribute(sysfsPath + "/device/bInterfaceNumber") + ":" +
+            readSysfsAttribute(sysfsPath + "/index");
+}
+
 } // anonymous namespace
 
 ExternalCameraProviderImpl_2_4::ExternalCameraProviderImpl_2_4()
@@ -85,10 +118,25 @@ ExternalCameraProviderImpl_2_4::ExternalCameraProviderImpl_2_4()
                     mPreferredHal3MinorVersion);
             mPreferredHal3MinorVersion = 4;
     }
+
+    // Started last, adding a camera depends on mPreferredHal3MinorVersion
+    for (size_t i = 0; i < kProbeThreadCount; i++) {
+        sp<ProbeThread> thread = sp<ProbeThread>::make(this);
+        thread->run("ExtCamProbe", PRIORITY_BACKGROUND);
+        mProbeThreads.push_back(thread);
+    }
 }
 
 ExternalCameraProviderImpl_2_4::~ExternalCameraProviderImpl_2_4() {
     mHotPlugThread->requestExit();
+    {
+        std::lock_guard<std::mutex> lk(mProbeLock);
+        mProbeExit = true;
+    }
+    mProbeCond.notify_all();
+    for (auto& thread : mProbeThreads) {
+        thread->requestExitAndWait();
+    }
 }
 
 
@@ -103,6 +151,8 @@ Return<Status> ExternalCameraProviderImpl_2_4::setCallback(
     }
     // Send a callback for all devices to initialize
     {
+        // Devices are added by the probe threads concurrently
+        Mutex::Autolock _l(mLock);
         for (const auto& pair : mCameraStatusMap) {
             mCallbacks->cameraDeviceStatusChange(pair.first, pair.second);
         }
@@ -229,23 +279,32 @@ void ExternalCameraProviderImpl_2_4::addExternalCamera(const char* devName) {
 }
 
 void ExternalCameraProviderImpl_2_4::deviceAdded(const char* devName) {
+    {
+        std::lock_guard<std::mutex> lk(mProbeLock);
+        uint64_t generation = ++mProbeGenerations[devName];
+        mProbeQueue.push_back({devName, generation});
+    }
+    mProbeCond.notify_one();
+}
+
+bool ExternalCameraProviderImpl_2_4::probeDevice(const char* devName) {
     {
         base::unique_fd fd(::open(devName, O_RDWR));
         if (fd.get() < 0) {
             ALOGE("%s open v4l2 device %s failed:%s", __FUNCTION__, devName, strerror(errno));
-            return;
+            return false;
         }
 
         struct v4l2_capability capability;
         int ret = ioctl(fd.get(), VIDIOC_QUERYCAP, &capability);
         if (ret < 0) {
             ALOGE("%s v4l2 QUERYCAP %s failed", __FUNCTION__, devName);
-            return;
+            return false;
         }
 
         if (!(capability.device_caps & V4L2_CAP_VIDEO_CAPTURE)) {
             ALOGW("%s device %s does not support VIDEO_CAPTURE", __FUNCTION__, devName);
-            return;
+            return false;
         }
     }
     // See if we can initialize ExternalCameraDevice correctly
@@ -253,15 +312,52 @@ void ExternalCameraProviderImpl_2_4::deviceAdded(const char* devName) {
             new device::V3_4::implementation::ExternalCameraDevice(devName, mCfg);
     if (deviceImpl == nullptr || deviceImpl->isInitFailed()) {
         ALOGW("%s: Attempt to init camera device %s failed!", __FUNCTION__, devName);
-        return;
+        return false;
+    }
+    return true;
+}
+
+bool ExternalCameraProviderImpl_2_4::processDeviceProbe(ProbeThread* thread) {
+    std::unique_lock<std::mutex> lk(mProbeLock);
+    while (mProbeQueue.empty()) {
+        if (mProbeExit || thread->isExitPending()) {
+            return false;
+        }
+        mProbeCond.wait(lk);
+    }
+    ProbeRequest req = std::move(mProbeQueue.front());
+    mProbeQueue.pop_front();
+    if (mProbeGenerations[req.devName] != req.generation) {
+        // Removed or added again since it was queued
+        return true;
+    }
+
+    lk.unlock();
+    const std::string key = getUsbDeviceKey(req.devName.c_str());
+    lk.lock();
+    bool supported = !key.empty() && mProbeCache.count(key) > 0;
+    if (supported) {
+        ALOGV("%s: %s (%s) was probed before", __FUNCTION__, req.devName.c_str(), key.c_str());
+    } else {
+        lk.unlock();
+        supported = probeDevice(req.devName.c_str());
+        lk.lock();
+        // Failures are not cached, they may be transient
+        if (supported && !key.empty()) {
+            mProbeCache.insert(key);
+        }
     }
-    deviceImpl.clear();
 
-    addExternalCamera(devName);
-    return;
+    if (supported && mProbeGenerations[req.devName] == req.generation) {
+        addExternalCamera(req.devName.c_str());
+    }
+    return true;
 }
 
 void ExternalCameraProviderImpl_2_4::deviceRemoved(const char* devName) {
+    std::lock_guard<std::mutex> probeLock(mProbeLock);
+    // Drops the result of a probe of the device still queued or running
+    ++mProbeGenerations[devName];
     Mutex::Autolock _l(mLock);
     std::string deviceName;
     std::string cameraId = std::to_string(mCfg.cameraIdOffset +
@@ -283,6 +379,17 @@ void ExternalCameraProviderImpl_2_4::deviceRemoved(const char* devName) {
     }
 }
 
+ExternalCameraProviderImpl_2_4::ProbeThread::ProbeThread(
+        ExternalCameraProviderImpl_2_4* parent) :
+        Thread(/*canCallJava*/false),
+        mParent(parent) {}
+
+ExternalCameraProviderImpl_2_4::ProbeThread::~ProbeThread() {}
+
+bool ExternalCameraProviderImpl_2_4::ProbeThread::threadLoop() {
+    return mParent->processDeviceProbe(this);
+}
+
 ExternalCameraProviderImpl_2_4::HotplugThread::HotplugThread(
         ExternalCameraProviderImpl_2_4* parent) :
         Thread(/*canCallJava*/false),
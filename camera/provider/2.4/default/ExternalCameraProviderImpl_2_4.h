@@ -17,9 +17,13 @@
 #ifndef ANDROID_HARDWARE_CAMERA_PROVIDER_V2_4_EXTCAMERAPROVIDER_H
 #define ANDROID_HARDWARE_CAMERA_PROVIDER_V2_4_EXTCAMERAPROVIDER_H
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <utils/Mutex.h>
 #include <utils/Thread.h>
 #include <hidl/Status.h>
@@ -79,10 +83,30 @@ private:
 
     void addExternalCamera(const char* devName);
 
+    // Queues the device to be probed by a ProbeThread, which adds it if it can be used
     void deviceAdded(const char* devName);
 
     void deviceRemoved(const char* devName);
 
+    // Returns true if the device is a V4L2 capture device ExternalCameraDevice can initialize
+    bool probeDevice(const char* devName);
+
+    class ProbeThread : public android::Thread {
+    public:
+        ProbeThread(ExternalCameraProviderImpl_2_4* parent);
+        ~ProbeThread();
+
+        virtual bool threadLoop() override;
+
+        bool isExitPending() const { return exitPending(); }
+
+    private:
+        ExternalCameraProviderImpl_2_4* mParent = nullptr;
+    };
+
+    // Probes the next queued device. Returns false once the provider is being destroyed.
+    bool processDeviceProbe(ProbeThread* thread);
+
     class HotplugThread : public android::Thread {
     public:
         HotplugThread(ExternalCameraProviderImpl_2_4* parent);
@@ -104,6 +128,24 @@ private:
     const ExternalCameraConfig mCfg;
     sp<HotplugThread> mHotPlugThread;
     int mPreferredHal3MinorVersion;
+
+    struct ProbeRequest {
+        std::string devName;
+        uint64_t generation;
+    };
+    static const size_t kProbeThreadCount = 2;
+    // Protect access to the probe queue, generations and cache. Held while adding the camera
+    // of a probed device, so a removal is either seen by the probe or comes after the add.
+    std::mutex mProbeLock;
+    std::condition_variable mProbeCond; // signaled when mProbeQueue or mProbeExit changes
+    std::deque<ProbeRequest> mProbeQueue;
+    // Device path -> generation, bumped when the device is added or removed, so the result of
+    // a probe still running when the device goes away is dropped
+    std::unordered_map<std::string, uint64_t> mProbeGenerations;
+    // Keys of the USB devices probed successfully, so that replugging one does not probe it again
+    std::unordered_set<std::string> mProbeCache;
+    bool mProbeExit = false;
+    std::vector<sp<ProbeThread>> mProbeThreads;
 };
 
 
@@ -313,21 +313,32 @@ bool LegacyCameraProviderImpl_2_4::initialize() {
     }
 
     mNumberOfLegacyCameras = mModule->getNumberOfCameras();
+    // CameraModule::init() has already fetched the info of every camera and derived their
+    // characteristics in parallel, so this only reads the published cache. All cameras are
+    // checked before any of them is published, then they are published in camera id order.
+    ATRACE_BEGIN("checkLegacyCameras");
     for (int i = 0; i < mNumberOfLegacyCameras; i++) {
         struct camera_info info;
         auto rc = mModule->getCameraInfo(i, &info);
         if (rc != NO_ERROR) {
             ALOGE("%s: Camera info query failed!", __func__);
             mModule.clear();
+            ATRACE_END();
             return true;
         }
 
         if (checkCameraVersion(i, info) != OK) {
             ALOGE("%s: Camera version check failed!", __func__);
             mModule.clear();
+            ATRACE_END();
             return true;
         }
+    }
+    ATRACE_END();
 
+    // Probing open_legacy stays sequential: the module isn't required to handle concurrent opens.
+    ATRACE_BEGIN("addLegacyCameras");
+    for (int i = 0; i < mNumberOfLegacyCameras; i++) {
         char cameraId[kMaxCameraIdLen];
         snprintf(cameraId, sizeof(cameraId), "%d", i);
         std::string cameraIdStr(cameraId);
@@ -335,6 +346,7 @@ bool LegacyCameraProviderImpl_2_4::initialize() {
 
         addDeviceNames(i);
     }
+    ATRACE_END();
 
     return false; // mInitFailed
 }
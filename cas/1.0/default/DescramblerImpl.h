@@ -19,6 +19,10 @@
 
 #include <media/stagefright/foundation/ABase.h>
 #include <android/hardware/cas/native/1.0/IDescrambler.h>
+#include <android/hidl/memory/1.0/IMemory.h>
+
+#include <list>
+#include <mutex>
 
 namespace android {
 struct DescramblerPlugin;
@@ -54,9 +58,25 @@ public:
     virtual Return<Status> release() override;
 
 private:
+    struct MappedHeap {
+        // Keeps a dup of the fd of the heap, to recognize the heap by when
+        // it is passed again.
+        hidl_memory heap;
+        sp<::android::hidl::memory::V1_0::IMemory> memory;
+    };
+
     sp<SharedLibrary> mLibrary;
     std::shared_ptr<DescramblerPlugin> mPluginHolder;
 
+    // The heaps mapped last, most recently used first. A heap stays mapped
+    // until it drops out of the list or the descrambler is released, even if
+    // the client has freed it meanwhile.
+    std::mutex mMappedHeapsLock;
+    std::list<MappedHeap> mMappedHeaps;
+
+    // Maps the heap, or returns its mapping from a previous call.
+    sp<::android::hidl::memory::V1_0::IMemory> mapHeap(const hidl_memory& heap);
+
     DISALLOW_EVIL_CONSTRUCTORS(DescramblerImpl);
 };
 
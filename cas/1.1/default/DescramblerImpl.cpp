@@ -19,9 +19,12 @@
 
 #include <hidlmemory/mapping.h>
 #include <inttypes.h>
+#include <linux/kcmp.h>
 #include <media/cas/DescramblerAPI.h>
 #include <media/hardware/CryptoAPI.h>
 #include <media/stagefright/foundation/AUtils.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <utils/Log.h>
 
 #include "DescramblerImpl.h"
@@ -48,6 +51,9 @@ namespace implementation {
 CHECK_SUBSAMPLE_DEF(DescramblerPlugin);
 CHECK_SUBSAMPLE_DEF(CryptoPlugin);
 
+// Enough for the heaps of the few services descrambled at the same time.
+static constexpr size_t kMaxMappedHeaps = 4;
+
 DescramblerImpl::DescramblerImpl(const sp<SharedLibrary>& library, DescramblerPlugin* plugin)
     : mLibrary(library), mPluginHolder(plugin) {
     ALOGV("CTOR: plugin=%p", mPluginHolder.get());
@@ -82,6 +88,49 @@ static inline bool validateRangeForSize(uint64_t offset, uint64_t length, uint64
     return isInRange<uint64_t, uint64_t>(0, size, offset, length);
 }
 
+static inline int getHeapFd(const hidl_memory& heap) {
+    const native_handle_t* handle = heap.handle();
+    return handle != nullptr && handle->numFds > 0 ? handle->data[0] : -1;
+}
+
+// Whether both fds refer to the same open file. The fd of a heap differs from call to call, as
+// every transaction installs a new one, but they all refer to the file the client opened.
+static bool isSameFile(int fd1, int fd2) {
+    const pid_t pid = getpid();
+    return syscall(SYS_kcmp, pid, pid, KCMP_FILE, fd1, fd2) == 0;
+}
+
+sp<IMemory> DescramblerImpl::mapHeap(const hidl_memory& heap) {
+    const int fd = getHeapFd(heap);
+    if (fd < 0) {
+        return mapMemory(heap);
+    }
+    // Without kcmp, heaps cannot be told apart and every call maps its heap again.
+    static const bool canCompareFiles = isSameFile(fd, fd);
+    if (!canCompareFiles) {
+        return mapMemory(heap);
+    }
+
+    std::lock_guard<std::mutex> lock(mMappedHeapsLock);
+    for (auto it = mMappedHeaps.begin(); it != mMappedHeaps.end(); ++it) {
+        if (it->heap.size() == heap.size() && it->heap.name() == heap.name() &&
+            isSameFile(getHeapFd(it->heap), fd)) {
+            mMappedHeaps.splice(mMappedHeaps.begin(), mMappedHeaps, it);
+            return it->memory;
+        }
+    }
+
+    sp<IMemory> memory = mapMemory(heap);
+    if (memory == NULL) {
+        return NULL;
+    }
+    mMappedHeaps.push_front({heap, memory});
+    if (mMappedHeaps.size() > kMaxMappedHeaps) {
+        mMappedHeaps.pop_back();
+    }
+    return memory;
+}
+
 Return<void> DescramblerImpl::descramble(ScramblingControl scramblingControl,
                                          const hidl_vec<SubSample>& subSamples,
                                          const SharedBuffer& srcBuffer, uint64_t srcOffset,
@@ -99,7 +148,7 @@ Return<void> DescramblerImpl::descramble(ScramblingControl scramblingControl,
         return Void();
     }
 
-    sp<IMemory> srcMem = mapMemory(srcBuffer.heapBase);
+    sp<IMemory> srcMem = mapHeap(srcBuffer.heapBase);
 
     // Validate if the offset and size in the SharedBuffer is consistent with the
     // mapped ashmem, since the offset and size is controlled by client.
@@ -186,6 +235,9 @@ Return<Status> DescramblerImpl::release() {
     std::shared_ptr<DescramblerPlugin> holder(nullptr);
     std::atomic_store(&mPluginHolder, holder);
 
+    std::lock_guard<std::mutex> lock(mMappedHeapsLock);
+    mMappedHeaps.clear();
+
     return Status::OK;
 }
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hal-benchmark/EventFlagWorker.h>
+
+namespace android {
+namespace hardware {
+namespace hal_benchmark {
+
+EventFlagWorker::EventFlagWorker(EventFlag* eventFlag, uint32_t requestBit, uint32_t replyBit,
+                                 std::function<void()> handler)
+    : mEventFlag(eventFlag),
+      mRequestBit(requestBit),
+      mReplyBit(replyBit),
+      mHandler(std::move(handler)),
+      mThread(&EventFlagWorker::threadLoop, this) {}
+
+EventFlagWorker::~EventFlagWorker() {
+    mStop.store(true, std::memory_order_release);
+    mEventFlag->wake(mRequestBit);
+    mThread.join();
+}
+
+bool EventFlagWorker::roundTrip(std::chrono::nanoseconds timeout) {
+    mEventFlag->wake(mRequestBit);
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        const int64_t remainingNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                            deadline - std::chrono::steady_clock::now())
+                                            .count();
+        if (remainingNs <= 0) {
+            return false;
+        }
+        uint32_t efState = 0;
+        mEventFlag->wait(mReplyBit, &efState, remainingNs);
+        if (efState & mReplyBit) {
+            return true;
+        }
+    }
+}
+
+void EventFlagWorker::threadLoop() {
+    while (!mStop.load(std::memory_order_acquire)) {
+        uint32_t efState = 0;
+        mEventFlag->wait(mRequestBit, &efState);
+        if (!(efState & mRequestBit) || mStop.load(std::memory_order_acquire)) {
+            continue;
+        }
+        mHandler();
+        mEventFlag->wake(mReplyBit);
+    }
+}
+
+}  // namespace hal_benchmark
+}  // namespace hardware
+}  // namespace android
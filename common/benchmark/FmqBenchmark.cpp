@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hal-benchmark/EventFlagWorker.h>
+#include <hal-benchmark/Latency.h>
+
+#include <benchmark/benchmark.h>
+#include <fmq/EventFlag.h>
+#include <fmq/MessageQueue.h>
+
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace hal_benchmark {
+
+namespace {
+
+// The flag bits and the shape of the queues of an audio output stream: the client writes a
+// burst to the data queue and a command to the command queue, wakes NOT_EMPTY and waits for the
+// stream's write thread to post the status and wake NOT_FULL.
+constexpr uint32_t kNotEmpty = 1 << 0;
+constexpr uint32_t kNotFull = 1 << 1;
+constexpr size_t kFrameSize = 4;  // 16 bit stereo
+constexpr size_t kBurstsInQueue = 2;
+constexpr std::chrono::seconds kTimeout{1};
+
+enum class WriteCommand : int32_t { WRITE };
+
+struct WriteStatus {
+    int32_t retval;
+    uint64_t written;
+};
+
+using DataMQ = MessageQueue<uint8_t, kSynchronizedReadWrite>;
+using CommandMQ = MessageQueue<WriteCommand, kSynchronizedReadWrite>;
+using StatusMQ = MessageQueue<WriteStatus, kSynchronizedReadWrite>;
+
+// The argument is the burst size in frames, e.g. 240 frames are 5 ms at 48 kHz.
+class StreamWriteBenchmark : public ::benchmark::Fixture {
+  public:
+    void SetUp(const ::benchmark::State& state) override {
+        const size_t burstSize = state.range(0) * kFrameSize;
+        mDataMQ = std::make_unique<DataMQ>(burstSize * kBurstsInQueue, true /* EventFlag */);
+        mCommandMQ = std::make_unique<CommandMQ>(1);
+        mStatusMQ = std::make_unique<StatusMQ>(1);
+        EventFlag::createEventFlag(mDataMQ->getEventFlagWord(), &mEventFlag);
+        mBurst.resize(burstSize);
+        mSink.resize(burstSize);
+        mWorker = std::make_unique<EventFlagWorker>(mEventFlag, kNotEmpty, kNotFull,
+                                                    [this] { doWrite(); });
+        mLatency.clear();
+    }
+
+    void TearDown(const ::benchmark::State& /*state*/) override {
+        mWorker.reset();
+        EventFlag::deleteEventFlag(&mEventFlag);
+        mStatusMQ.reset();
+        mCommandMQ.reset();
+        mDataMQ.reset();
+    }
+
+  protected:
+    // Runs on the worker thread, the way the write thread of the stream consumes a burst.
+    void doWrite() {
+        WriteCommand command;
+        if (!mCommandMQ->read(&command)) {
+            return;
+        }
+        WriteStatus status = {.retval = 0, .written = 0};
+        const size_t available = mDataMQ->availableToRead();
+        if (mDataMQ->read(mSink.data(), available)) {
+            ::benchmark::DoNotOptimize(mSink.data());
+            status.written = available;
+        }
+        mStatusMQ->write(&status);
+    }
+
+    std::unique_ptr<DataMQ> mDataMQ;
+    std::unique_ptr<CommandMQ> mCommandMQ;
+    std::unique_ptr<StatusMQ> mStatusMQ;
+    EventFlag* mEventFlag = nullptr;
+    std::unique_ptr<EventFlagWorker> mWorker;
+    std::vector<uint8_t> mBurst;
+    std::vector<uint8_t> mSink;
+    LatencyRecorder mLatency;
+};
+
+}  // namespace
+
+// Time for a burst to be handed to the stream and its status to come back.
+BENCHMARK_DEFINE_F(StreamWriteBenchmark, BM_StreamWrite)(::benchmark::State& state) {
+    const WriteCommand command = WriteCommand::WRITE;
+    WriteStatus status;
+    for (auto _ : state) {
+        ScopedLatency latency(&mLatency);
+        if (!mDataMQ->write(mBurst.data(), mBurst.size()) || !mCommandMQ->write(&command) ||
+            !mWorker->roundTrip(kTimeout) || !mStatusMQ->read(&status)) {
+            state.SkipWithError("write round trip failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * mBurst.size());
+    mLatency.report(state);
+}
+BENCHMARK_REGISTER_F(StreamWriteBenchmark, BM_StreamWrite)
+        ->Arg(192)
+        ->Arg(240)
+        ->Arg(480)
+        ->Arg(960)
+        ->Unit(::benchmark::kMicrosecond);
+
+}  // namespace hal_benchmark
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hal-benchmark/Latency.h>
+
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace hal_benchmark {
+
+namespace {
+
+double percentileUs(std::vector<int64_t>& sortedNs, double percentile) {
+    const size_t index = std::min(sortedNs.size() - 1,
+                                  static_cast<size_t>(sortedNs.size() * percentile / 100));
+    return sortedNs[index] / 1000.0;
+}
+
+}  // namespace
+
+void LatencyRecorder::report(::benchmark::State& state) {
+    if (mLatencies.empty()) {
+        return;
+    }
+    std::sort(mLatencies.begin(), mLatencies.end());
+    state.counters["p50_us"] = percentileUs(mLatencies, 50);
+    state.counters["p99_us"] = percentileUs(mLatencies, 99);
+    state.counters["max_us"] = mLatencies.back() / 1000.0;
+}
+
+void CompletionCounter::notify(uint32_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCompletions += count;
+    }
+    mCondition.notify_all();
+}
+
+bool CompletionCounter::waitFor(uint32_t count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mCondition.wait_for(lock, timeout, [&] { return mCompletions >= count; });
+}
+
+uint32_t CompletionCounter::get() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCompletions;
+}
+
+}  // namespace hal_benchmark
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <hal-benchmark/Latency.h>
+
+#include <android/binder_manager.h>
+#include <android/binder_process.h>
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace hal_benchmark {
+
+// Returns the given instance of an AIDL service, or nullptr if the device does not declare it.
+template <typename I>
+std::shared_ptr<I> getAidlService(const std::string& instance = "default") {
+    const std::string name = std::string(I::descriptor) + "/" + instance;
+    if (!AServiceManager_isDeclared(name.c_str())) {
+        return nullptr;
+    }
+    return I::fromBinder(ndk::SpAIBinder(AServiceManager_waitForService(name.c_str())));
+}
+
+// Base of benchmarks that talk to an AIDL HAL service. Benchmarks are skipped on devices that
+// do not declare the service, and report latency percentiles of whatever they record.
+template <typename I>
+class AidlHalBenchmark : public ::benchmark::Fixture {
+  public:
+    void SetUp(::benchmark::State& /*state*/) override {
+        mHal = getAidlService<I>();
+        mLatency.clear();
+    }
+
+    void TearDown(::benchmark::State& state) override { mLatency.report(state); }
+
+    static void DefaultConfig(::benchmark::internal::Benchmark* b) {
+        b->Unit(::benchmark::kMicrosecond);
+    }
+
+  protected:
+    // Returns whether the service is available, skipping the benchmark if it is not.
+    bool checkHal(::benchmark::State& state) {
+        if (mHal == nullptr) {
+            state.SkipWithError("service not declared");
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<I> mHal;
+    LatencyRecorder mLatency;
+};
+
+}  // namespace hal_benchmark
+}  // namespace hardware
+}  // namespace android
+
+// Like BENCHMARK_MAIN, but starts a binder thread pool first so HAL callbacks are delivered.
+#define HAL_BENCHMARK_MAIN()                                        \
+    int main(int argc, char** argv) {                               \
+        ABinderProcess_startThreadPool();                           \
+        ::benchmark::Initialize(&argc, argv);                       \
+        if (::benchmark::ReportUnrecognizedArguments(argc, argv)) { \
+            return 1;                                               \
+        }                                                           \
+        ::benchmark::RunSpecifiedBenchmarks();                      \
+        return 0;                                                   \
+    }
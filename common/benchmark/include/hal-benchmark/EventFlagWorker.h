@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fmq/EventFlag.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace android {
+namespace hardware {
+namespace hal_benchmark {
+
+// Services requests posted through an event flag on its own thread, the way the stream and
+// effect worker threads of the audio HAL service their fast message queues, so a benchmark can
+// time the round trip of a request. The handler runs on the worker thread each time requestBit
+// is woken, and replyBit is woken once it returns.
+class EventFlagWorker {
+  public:
+    EventFlagWorker(EventFlag* eventFlag, uint32_t requestBit, uint32_t replyBit,
+                    std::function<void()> handler);
+    ~EventFlagWorker();
+
+    // Wakes the worker and waits until it has handled the request. Returns false on timeout.
+    bool roundTrip(std::chrono::nanoseconds timeout);
+
+  private:
+    void threadLoop();
+
+    EventFlag* const mEventFlag;
+    const uint32_t mRequestBit;
+    const uint32_t mReplyBit;
+    const std::function<void()> mHandler;
+    std::atomic<bool> mStop = false;
+    std::thread mThread;
+};
+
+}  // namespace hal_benchmark
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace hal_benchmark {
+
+// Collects the latency of each operation of a benchmark run, so the tail is reported next to
+// the average time Google Benchmark computes.
+class LatencyRecorder {
+  public:
+    void record(std::chrono::nanoseconds latency) { mLatencies.push_back(latency.count()); }
+
+    void clear() { mLatencies.clear(); }
+
+    // Sets the p50_us, p99_us and max_us counters of state from the recorded latencies.
+    void report(::benchmark::State& state);
+
+  private:
+    std::vector<int64_t> mLatencies;
+};
+
+// Records the time from its construction until its destruction.
+class ScopedLatency {
+  public:
+    explicit ScopedLatency(LatencyRecorder* recorder)
+        : mRecorder(recorder), mStart(std::chrono::steady_clock::now()) {}
+
+    ~ScopedLatency() { mRecorder->record(std::chrono::steady_clock::now() - mStart); }
+
+  private:
+    LatencyRecorder* mRecorder;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+// Counts completions reported by HAL callbacks, which arrive on binder threads, so a benchmark
+// can wait for the asynchronous part of an operation.
+class CompletionCounter {
+  public:
+    void notify(uint32_t count = 1);
+
+    // Waits until notify has been called for count completions in total. Returns false on
+    // timeout.
+    bool waitFor(uint32_t count, std::chrono::milliseconds timeout);
+
+    uint32_t get();
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    uint32_t mCompletions = 0;
+};
+
+}  // namespace hal_benchmark
+}  // namespace hardware
+}  // namespace android
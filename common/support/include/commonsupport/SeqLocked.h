@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace android {
+
+/**
+ * A small value that any thread loads or stores as a whole without locking, e.g. a clock
+ * reference or a position published by a real-time thread. Loads retry while a store is in
+ * progress, and stores wait for each other. Stores are not ordered with respect to each other
+ * beyond that, so a read-modify-write of the value needs a lock or a single writer.
+ */
+template <typename T>
+class SeqLocked {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLocked values are copied bytewise");
+
+  public:
+    explicit SeqLocked(const T& value) { storeWords(value); }
+
+    SeqLocked(const SeqLocked&) = delete;
+    SeqLocked& operator=(const SeqLocked&) = delete;
+
+    T load() const {
+        std::array<uint64_t, kWords> words;
+        uint32_t seq;
+        do {
+            seq = mSeq.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kWords; i++) {
+                words[i] = mWords[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) != 0 || seq != mSeq.load(std::memory_order_relaxed));
+        T value;
+        memcpy(&value, words.data(), sizeof(T));
+        return value;
+    }
+
+    void store(const T& value) {
+        uint32_t seq = mSeq.load(std::memory_order_relaxed);
+        while ((seq & 1) != 0 ||
+               !mSeq.compare_exchange_weak(seq, seq + 1, std::memory_order_relaxed)) {
+            seq = mSeq.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        storeWords(value);
+        mSeq.store(seq + 2, std::memory_order_release);
+    }
+
+  private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    void storeWords(const T& value) {
+        std::array<uint64_t, kWords> words{};
+        memcpy(words.data(), &value, sizeof(T));
+        for (size_t i = 0; i < kWords; i++) {
+            mWords[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint32_t> mSeq{0};
+    std::array<std::atomic<uint64_t>, kWords> mWords;
+};
+
+}  // namespace android
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <commonsupport/SeqLocked.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+// Not a multiple of 8 bytes, so the last word is partly padding.
+struct Value {
+    int64_t a;
+    int64_t b;
+    int32_t c;
+};
+
+}  // namespace
+
+TEST(SeqLockedTest, LoadsWhatWasStored) {
+    SeqLocked<Value> value({1, 2, 3});
+    Value loaded = value.load();
+    EXPECT_EQ(1, loaded.a);
+    EXPECT_EQ(2, loaded.b);
+    EXPECT_EQ(3, loaded.c);
+
+    value.store({-1, INT64_MAX, INT32_MIN});
+    loaded = value.load();
+    EXPECT_EQ(-1, loaded.a);
+    EXPECT_EQ(INT64_MAX, loaded.b);
+    EXPECT_EQ(INT32_MIN, loaded.c);
+}
+
+TEST(SeqLockedTest, LoadsAreNeverTorn) {
+    // Every value stored has all of its fields equal.
+    SeqLocked<Value> value({0, 0, 0});
+    std::atomic_bool done = false;
+    std::atomic_bool sawTornValue = false;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back([&value, &done, &sawTornValue] {
+            while (!done) {
+                const Value loaded = value.load();
+                if (loaded.a != loaded.b || loaded.b != loaded.c) sawTornValue = true;
+            }
+        });
+    }
+    // Two writers, which must not interleave either.
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back([&value, i] {
+            for (int32_t n = i; n < 200000; n += 2) value.store({n, n, n});
+        });
+    }
+    threads[2].join();
+    threads[3].join();
+    done = true;
+    threads[0].join();
+    threads[1].join();
+
+    EXPECT_FALSE(sawTornValue);
+}
+
+}  // namespace android
@@ -38,18 +38,19 @@ MonotonicClockTimeStamper::TimeStamp MonotonicClockTimeStamper::now() {
 
 support::NullOr<support::hmac_t> HMacImplementation::hmac256(
     const support::auth_token_key_t& key, std::initializer_list<support::ByteBufferProxy> buffers) {
-    HMAC_CTX hmacCtx;
-    HMAC_CTX_init(&hmacCtx);
-    if (!HMAC_Init_ex(&hmacCtx, key.data(), key.size(), EVP_sha256(), nullptr)) {
+    // Cleaned up on every path, which frees the digest state and wipes the key schedule.
+    bssl::ScopedHMAC_CTX hmacCtx;
+    if (!HMAC_Init_ex(hmacCtx.get(), key.data(), key.size(), EVP_sha256(), nullptr)) {
         return {};
     }
+    // The buffers are MACed in place, one after the other, without being assembled first.
     for (auto& buffer : buffers) {
-        if (!HMAC_Update(&hmacCtx, buffer.data(), buffer.size())) {
+        if (!HMAC_Update(hmacCtx.get(), buffer.data(), buffer.size())) {
             return {};
         }
     }
     support::hmac_t result;
-    if (!HMAC_Final(&hmacCtx, result.data(), nullptr)) {
+    if (!HMAC_Final(hmacCtx.get(), result.data(), nullptr)) {
         return {};
     }
     return result;
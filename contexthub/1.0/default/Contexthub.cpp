@@ -17,8 +17,12 @@
 #include "Contexthub.h"
 
 #include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
 
 #include <log/log.h>
+#include <utils/Timers.h>
 
 #include <android/hardware/contexthub/1.0/IContexthub.h>
 #include <hardware/context_hub.h>
@@ -161,18 +165,64 @@ Return<Result> Contexthub::sendMessageToHub(uint32_t hubId,
         txMsg.message = &placeholder;
     }
 
-    ALOGI("Sending msg of type %" PRIu32 ", size %" PRIu32 " to app 0x%" PRIx64,
+    // Nanoapps may exchange thousands of messages per second, so don't log each of them.
+    ALOGV("Sending msg of type %" PRIu32 ", size %" PRIu32 " to app 0x%" PRIx64,
           txMsg.message_type,
           txMsg.message_len,
           txMsg.app_name.id);
 
+    nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
     if(mContextHubModule->send_message(hubId, &txMsg) != 0) {
         return Result::TRANSACTION_FAILED;
     }
 
+    std::lock_guard<std::mutex> lock(mMessageStatsLock);
+    mMessageStats[msg.appName].sent.record(txMsg.message_len, startNs,
+                                           systemTime(SYSTEM_TIME_MONOTONIC));
     return Result::OK;
 }
 
+void Contexthub::MessageStats::record(size_t messageBytes, nsecs_t startNs, nsecs_t endNs) {
+    if (count == 0) {
+        firstTimeNs = startNs;
+    }
+    count++;
+    bytes += messageBytes;
+    lastTimeNs = endNs;
+    totalLatencyNs += endNs - startNs;
+    maxLatencyNs = std::max(maxLatencyNs, endNs - startNs);
+}
+
+Return<void> Contexthub::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& /*options*/) {
+    if (fd == nullptr || fd->numFds < 1) {
+        return Void();
+    }
+    int out = fd->data[0];
+
+    auto printStats = [out](const char* direction, const MessageStats& stats) {
+        if (stats.count == 0) {
+            return;
+        }
+        nsecs_t spanNs = stats.lastTimeNs - stats.firstTimeNs;
+        double rate = spanNs > 0 ? stats.count * 1e9 / spanNs : 0;
+        dprintf(out,
+                "  %s: %" PRIu64 " msgs, %" PRIu64 " bytes, %.1f msgs/s, latency avg %" PRId64
+                " us max %" PRId64 " us\n",
+                direction, stats.count, stats.bytes, rate,
+                static_cast<int64_t>(stats.totalLatencyNs / stats.count / 1000),
+                static_cast<int64_t>(stats.maxLatencyNs / 1000));
+    };
+
+    std::lock_guard<std::mutex> lock(mMessageStatsLock);
+    dprintf(out, "Nanoapp messages (latency of send_message, or of the client callback):\n");
+    for (const auto& entry : mMessageStats) {
+        dprintf(out, "app 0x%016" PRIx64 "\n", entry.first);
+        printStats("to hub", entry.second.sent);
+        printStats("from hub", entry.second.received);
+    }
+    return Void();
+}
+
 Return<Result> Contexthub::reboot(uint32_t hubId) {
     if (!isInitialized()) {
       return Result::NOT_INIT;
@@ -384,11 +434,18 @@ int Contexthub::contextHubCb(uint32_t hubId,
         msg.appName = rxMsg->app_name.id;
         msg.msgType = rxMsg->message_type;
         msg.hostEndPoint = static_cast<uint16_t>(HostEndPoint::BROADCAST);
-        msg.msg = std::vector<uint8_t>(static_cast<const uint8_t *>(rxMsg->message),
-                                       static_cast<const uint8_t *>(rxMsg->message) +
-                                       rxMsg->message_len);
+        // The message is only borrowed for the duration of the call, which serializes it, so
+        // there is no need to copy it. The callee gets it as const and copies it to keep it.
+        msg.msg.setToExternal(
+                const_cast<uint8_t *>(static_cast<const uint8_t *>(rxMsg->message)),
+                rxMsg->message_len);
 
+        nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
         cb->handleClientMsg(msg);
+
+        std::lock_guard<std::mutex> lock(obj->mMessageStatsLock);
+        obj->mMessageStats[msg.appName].received.record(rxMsg->message_len, startNs,
+                                                         systemTime(SYSTEM_TIME_MONOTONIC));
     }
 
     return 0;
@@ -17,6 +17,8 @@
 #ifndef ANDROID_HARDWARE_CONTEXTHUB_V1_0_CONTEXTHUB_H_
 #define ANDROID_HARDWARE_CONTEXTHUB_V1_0_CONTEXTHUB_H_
 
+#include <map>
+#include <mutex>
 #include <unordered_map>
 
 #include <android-base/macros.h>
@@ -60,6 +62,8 @@ struct Contexthub : public ::android::hardware::contexthub::V1_0::IContexthub {
 
     Return<Result> reboot(uint32_t hubId);
 
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
+
     bool isInitialized();
 
 private:
@@ -69,6 +73,24 @@ private:
         sp<IContexthubCallback> callback;
     };
 
+    // Traffic of one nanoapp in one direction, with the time spent in the hub module when
+    // sending, or in the callback when receiving.
+    struct MessageStats {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+        nsecs_t firstTimeNs = 0;
+        nsecs_t lastTimeNs = 0;
+        nsecs_t totalLatencyNs = 0;
+        nsecs_t maxLatencyNs = 0;
+
+        void record(size_t messageBytes, nsecs_t startNs, nsecs_t endNs);
+    };
+
+    struct NanoAppMessageStats {
+        MessageStats sent;
+        MessageStats received;
+    };
+
     class DeathRecipient : public hidl_death_recipient {
     public:
         DeathRecipient(const sp<Contexthub> contexthub);
@@ -89,6 +111,11 @@ private:
     bool mIsTransactionPending;
     uint32_t mTransactionId;
 
+    // Keyed by app ID. Messages are sent from binder threads and received on the thread of the
+    // hub module.
+    std::mutex mMessageStatsLock;
+    std::map<uint64_t, NanoAppMessageStats> mMessageStats;
+
     bool isValidHubId(uint32_t hubId);
 
     sp<IContexthubCallback> getCallBackForHubId(uint32_t hubId);
@@ -53,10 +53,15 @@ namespace implementation {
             uint32_t bufferId) {
         sp<IMemory> hidlMemory = mapMemory(base);
 
-        std::lock_guard<std::mutex> shared_buffer_lock(mSharedBufferLock);
-
         // allow mapMemory to return nullptr
-        mSharedBufferMap[bufferId] = hidlMemory;
+        SharedBufferEntry entry = {.memory = hidlMemory, .base = nullptr, .size = 0};
+        if (hidlMemory != nullptr) {
+            entry.base = static_cast<uint8_t *>(static_cast<void *>(hidlMemory->getPointer()));
+            entry.size = hidlMemory->getSize();
+        }
+
+        std::lock_guard<std::mutex> shared_buffer_lock(mSharedBufferLock);
+        mSharedBufferMap[bufferId] = std::move(entry);
         return Void();
     }
 
@@ -67,20 +72,30 @@ namespace implementation {
             const SharedBuffer& source, uint64_t offset,
             const DestinationBuffer& destination,
             decrypt_cb _hidl_cb) {
+        // Look each buffer up once. The copies keep the memory mapped while the legacy plugin
+        // decrypts, even if setSharedBufferBase replaces it meanwhile.
         std::unique_lock<std::mutex> shared_buffer_lock(mSharedBufferLock);
-        if (mSharedBufferMap.find(source.bufferId) == mSharedBufferMap.end()) {
+        auto sourceEntry = mSharedBufferMap.find(source.bufferId);
+        if (sourceEntry == mSharedBufferMap.end()) {
             _hidl_cb(Status::ERROR_DRM_CANNOT_HANDLE, 0, "source decrypt buffer base not set");
             return Void();
         }
+        const SharedBufferEntry sourceBase = sourceEntry->second;
 
+        SharedBufferEntry destBase = {.memory = nullptr, .base = nullptr, .size = 0};
         if (destination.type == BufferType::SHARED_MEMORY) {
             const SharedBuffer& dest = destination.nonsecureMemory;
-            if (mSharedBufferMap.find(dest.bufferId) == mSharedBufferMap.end()) {
+            auto destEntry = mSharedBufferMap.find(dest.bufferId);
+            if (destEntry == mSharedBufferMap.end()) {
                 _hidl_cb(Status::ERROR_DRM_CANNOT_HANDLE, 0, "destination decrypt buffer base not set");
                 return Void();
             }
+            destBase = destEntry->second;
         }
 
+        // release mSharedBufferLock
+        shared_buffer_lock.unlock();
+
         android::CryptoPlugin::Mode legacyMode = android::CryptoPlugin::kMode_Unencrypted;
         switch(mode) {
         case Mode::UNENCRYPTED:
@@ -120,8 +135,7 @@ namespace implementation {
         }
 
         AString detailMessage;
-        sp<IMemory> sourceBase = mSharedBufferMap[source.bufferId];
-        if (sourceBase == nullptr) {
+        if (sourceBase.memory == nullptr) {
             _hidl_cb(Status::ERROR_DRM_CANNOT_HANDLE, 0, "source is a nullptr");
             return Void();
         }
@@ -129,28 +143,25 @@ namespace implementation {
         size_t totalSize = 0;
         if (__builtin_add_overflow(source.offset, offset, &totalSize) ||
             __builtin_add_overflow(totalSize, source.size, &totalSize) ||
-            totalSize > sourceBase->getSize()) {
+            totalSize > sourceBase.size) {
             android_errorWriteLog(0x534e4554, "176496160");
             _hidl_cb(Status::ERROR_DRM_CANNOT_HANDLE, 0, "invalid buffer size");
             return Void();
         }
 
-        uint8_t *base = static_cast<uint8_t *>
-                (static_cast<void *>(sourceBase->getPointer()));
-        void *srcPtr = static_cast<void *>(base + source.offset + offset);
+        void *srcPtr = static_cast<void *>(sourceBase.base + source.offset + offset);
 
         void *destPtr = NULL;
         if (destination.type == BufferType::SHARED_MEMORY) {
             const SharedBuffer& destBuffer = destination.nonsecureMemory;
-            sp<IMemory> destBase = mSharedBufferMap[destBuffer.bufferId];
-            if (destBase == nullptr) {
+            if (destBase.memory == nullptr) {
                 _hidl_cb(Status::ERROR_DRM_CANNOT_HANDLE, 0, "destination is a nullptr");
                 return Void();
             }
 
             size_t totalSize = 0;
             if (__builtin_add_overflow(destBuffer.offset, destBuffer.size, &totalSize) ||
-                totalSize > destBase->getSize()) {
+                totalSize > destBase.size) {
                 android_errorWriteLog(0x534e4554, "176496353");
                 _hidl_cb(Status::ERROR_DRM_CANNOT_HANDLE, 0, "invalid buffer size");
                 return Void();
@@ -161,8 +172,7 @@ namespace implementation {
                 return Void();
             }
 
-            base = static_cast<uint8_t *>(static_cast<void *>(destBase->getPointer()));
-            destPtr = static_cast<void*>(base + destination.nonsecureMemory.offset);
+            destPtr = static_cast<void*>(destBase.base + destination.nonsecureMemory.offset);
         } else if (destination.type == BufferType::NATIVE_HANDLE) {
             if (!secure) {
                 _hidl_cb(Status::BAD_VALUE, 0, "native handle destination must be secure");
@@ -176,9 +186,6 @@ namespace implementation {
             return Void();
         }
 
-        // release mSharedBufferLock
-        shared_buffer_lock.unlock();
-
         ssize_t result = mLegacyPlugin->decrypt(secure, keyId.data(), iv.data(),
                 legacyMode, legacyPattern, srcPtr, legacySubSamples.get(),
                 subSamples.size(), destPtr, &detailMessage);
@@ -24,6 +24,7 @@
 #include <media/hardware/CryptoAPI.h>
 
 #include <mutex>
+#include <unordered_map>
 
 namespace android {
 namespace hardware {
@@ -70,8 +71,17 @@ struct CryptoPlugin : public ICryptoPlugin {
             decrypt_cb _hidl_cb) override NO_THREAD_SAFETY_ANALYSIS;  // use unique_lock
 
   private:
+    // A shared buffer mapped by setSharedBufferBase, with its base pointer and size looked
+    // up once rather than through IMemory on every decrypt.
+    struct SharedBufferEntry {
+        sp<IMemory> memory;  // nullptr if the memory could not be mapped
+        uint8_t *base;
+        size_t size;
+    };
+
     android::CryptoPlugin *mLegacyPlugin;
-    std::map<uint32_t, sp<IMemory>> mSharedBufferMap GUARDED_BY(mSharedBufferLock);
+    std::unordered_map<uint32_t, SharedBufferEntry> mSharedBufferMap
+            GUARDED_BY(mSharedBufferLock);
 
     CryptoPlugin() = delete;
     CryptoPlugin(const CryptoPlugin &) = delete;
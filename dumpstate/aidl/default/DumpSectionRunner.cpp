@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DumpSectionRunner.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <log/log.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using ::android::base::StringPrintf;
+using ::android::base::unique_fd;
+using ::android::base::WriteStringToFd;
+using ::std::chrono::milliseconds;
+using ::std::chrono::steady_clock;
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace dumpstate {
+
+namespace {
+
+enum class SegmentStatus { PENDING, RUNNING, DONE, TIMED_OUT, SKIPPED };
+
+struct Segment {
+    std::string name;
+    DumpSectionRunner::DumpFunction dump;
+    milliseconds budget;
+    unique_fd fd;
+    SegmentStatus status = SegmentStatus::PENDING;
+    steady_clock::time_point start;
+    steady_clock::time_point end;
+};
+
+// Shared with the workers, which may outlive run() when a section is abandoned.
+struct RunState {
+    std::mutex lock;
+    std::condition_variable condition;
+    std::vector<Segment> segments;
+    size_t next = 0;
+};
+
+void workerLoop(const std::shared_ptr<RunState>& state) {
+    std::unique_lock<std::mutex> lock(state->lock);
+    while (state->next < state->segments.size()) {
+        Segment& segment = state->segments[state->next++];
+        if (segment.status != SegmentStatus::PENDING) {
+            continue;
+        }
+        segment.status = SegmentStatus::RUNNING;
+        segment.start = steady_clock::now();
+        state->condition.notify_all();
+
+        lock.unlock();
+        if (segment.fd.ok()) {
+            segment.dump(segment.fd.get());
+        }
+        lock.lock();
+
+        segment.end = steady_clock::now();
+        if (segment.status == SegmentStatus::RUNNING) {
+            segment.status = SegmentStatus::DONE;
+        }
+        state->condition.notify_all();
+    }
+}
+
+// Copies what the section wrote so far. pread leaves the file offset of the section alone, so
+// this is safe while an abandoned section is still writing.
+void copySegment(const Segment& segment, int fd) {
+    struct stat st;
+    if (!segment.fd.ok() || fstat(segment.fd.get(), &st) != 0) {
+        return;
+    }
+    char buffer[16 * 1024];
+    off_t offset = 0;
+    while (offset < st.st_size) {
+        const size_t count = std::min<off_t>(sizeof(buffer), st.st_size - offset);
+        const ssize_t read = TEMP_FAILURE_RETRY(pread(segment.fd.get(), buffer, count, offset));
+        if (read <= 0 || !::android::base::WriteFully(fd, buffer, read)) {
+            return;
+        }
+        offset += read;
+    }
+}
+
+}  // namespace
+
+DumpSectionRunner::DumpSectionRunner(size_t workers) : mWorkers(std::max<size_t>(workers, 1)) {}
+
+void DumpSectionRunner::add(std::string name, DumpFunction dump, milliseconds budget) {
+    mSections.push_back({std::move(name), std::move(dump), budget});
+}
+
+void DumpSectionRunner::run(int fd, milliseconds timeout) {
+    const steady_clock::time_point runStart = steady_clock::now();
+    const steady_clock::time_point deadline =
+            timeout.count() > 0 ? runStart + timeout : steady_clock::time_point::max();
+
+    auto state = std::make_shared<RunState>();
+    for (auto& section : mSections) {
+        Segment segment;
+        segment.name = std::move(section.name);
+        segment.dump = std::move(section.dump);
+        segment.budget = section.budget;
+        segment.fd.reset(memfd_create(segment.name.c_str(), MFD_CLOEXEC));
+        if (!segment.fd.ok()) {
+            ALOGE("Failed to create a buffer for section %s: %s", segment.name.c_str(),
+                  strerror(errno));
+        }
+        state->segments.push_back(std::move(segment));
+    }
+    mSections.clear();
+
+    // Detached, so that a section that never returns cannot block the binder thread.
+    const size_t workers = std::min(mWorkers, state->segments.size());
+    for (size_t i = 0; i < workers; i++) {
+        std::thread([state] { workerLoop(state); }).detach();
+    }
+
+    std::vector<milliseconds> durations;
+    for (Segment& segment : state->segments) {
+        std::unique_lock<std::mutex> lock(state->lock);
+        while (true) {
+            if (segment.status == SegmentStatus::DONE) {
+                break;
+            }
+            steady_clock::time_point sectionDeadline = deadline;
+            if (segment.status == SegmentStatus::RUNNING) {
+                sectionDeadline = std::min(sectionDeadline, segment.start + segment.budget);
+            }
+            if (steady_clock::now() >= sectionDeadline) {
+                segment.status = segment.status == SegmentStatus::RUNNING
+                                         ? SegmentStatus::TIMED_OUT
+                                         : SegmentStatus::SKIPPED;
+                segment.end = steady_clock::now();
+                break;
+            }
+            if (sectionDeadline == steady_clock::time_point::max()) {
+                state->condition.wait(lock);
+            } else {
+                state->condition.wait_until(lock, sectionDeadline);
+            }
+        }
+        const SegmentStatus status = segment.status;
+        durations.push_back(std::chrono::duration_cast<milliseconds>(segment.end - segment.start));
+        lock.unlock();
+
+        if (status == SegmentStatus::SKIPPED) {
+            WriteStringToFd(StringPrintf("*** %s: skipped, dump deadline passed\n",
+                                         segment.name.c_str()),
+                            fd);
+            continue;
+        }
+        copySegment(segment, fd);
+        if (status == SegmentStatus::TIMED_OUT) {
+            const std::string reason =
+                    durations.back() >= segment.budget
+                            ? StringPrintf("exceeded %lld ms budget",
+                                           static_cast<long long>(segment.budget.count()))
+                            : "dump deadline passed";
+            WriteStringToFd(StringPrintf("\n*** %s: output truncated, %s\n", segment.name.c_str(),
+                                         reason.c_str()),
+                            fd);
+        }
+    }
+
+    std::string report = "------ dumpstateBoard section durations ------\n";
+    for (size_t i = 0; i < state->segments.size(); i++) {
+        const Segment& segment = state->segments[i];
+        if (segment.status == SegmentStatus::SKIPPED) {
+            report += StringPrintf("%s: skipped\n", segment.name.c_str());
+            continue;
+        }
+        report += StringPrintf("%s: %lld ms%s\n", segment.name.c_str(),
+                               static_cast<long long>(durations[i].count()),
+                               segment.status == SegmentStatus::TIMED_OUT ? " (timed out)" : "");
+    }
+    report += StringPrintf("total: %lld ms\n",
+                           static_cast<long long>(std::chrono::duration_cast<milliseconds>(
+                                                          steady_clock::now() - runStart)
+                                                          .count()));
+    WriteStringToFd(report, fd);
+}
+
+}  // namespace dumpstate
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace dumpstate {
+
+// Runs the sections of a board dump on a pool of worker threads. Each section writes into its own
+// buffer, and the buffers are streamed to the dump fd in the order the sections were added, so the
+// output reads the same as a sequential dump.
+//
+// A section that runs past its budget, or is still running when the overall deadline passes, is
+// abandoned: whatever it wrote so far is streamed with a note, and its worker is left to finish in
+// the background without touching the dump fd. Commands run from a section should still be given a
+// timeout within the section budget, so abandoned workers do not pile up.
+class DumpSectionRunner {
+  public:
+    using DumpFunction = std::function<void(int fd)>;
+
+    static constexpr size_t kDefaultWorkers = 4;
+    static constexpr std::chrono::milliseconds kDefaultBudget{5000};
+
+    explicit DumpSectionRunner(size_t workers = kDefaultWorkers);
+
+    void add(std::string name, DumpFunction dump,
+             std::chrono::milliseconds budget = kDefaultBudget);
+
+    // Runs every section added so far, writing their output to fd, followed by the time each of
+    // them took. A timeout of zero or less only enforces the budgets of the sections.
+    void run(int fd, std::chrono::milliseconds timeout);
+
+  private:
+    struct Section {
+        std::string name;
+        DumpFunction dump;
+        std::chrono::milliseconds budget;
+    };
+
+    const size_t mWorkers;
+    std::vector<Section> mSections;
+};
+
+}  // namespace dumpstate
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
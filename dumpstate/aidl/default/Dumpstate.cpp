@@ -18,6 +18,7 @@
 #include <log/log.h>
 #include "DumpstateUtil.h"
 
+#include "DumpSectionRunner.h"
 #include "Dumpstate.h"
 
 using android::os::dumpstate::DumpFileToFd;
@@ -32,8 +33,6 @@ const char kVerboseLoggingProperty[] = "persist.dumpstate.verbose_logging.enable
 ndk::ScopedAStatus Dumpstate::dumpstateBoard(const std::vector<::ndk::ScopedFileDescriptor>& in_fds,
                                              IDumpstateDevice::DumpstateMode in_mode,
                                              int64_t in_timeoutMillis) {
-    (void)in_timeoutMillis;
-
     if (in_fds.size() < 1) {
         return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
                                                                 "No file descriptor");
@@ -47,10 +46,10 @@ ndk::ScopedAStatus Dumpstate::dumpstateBoard(const std::vector<::ndk::ScopedFile
 
     switch (in_mode) {
         case IDumpstateDevice::DumpstateMode::FULL:
-            return dumpstateBoardImpl(fd, true);
+            return dumpstateBoardImpl(fd, true, in_timeoutMillis);
 
         case IDumpstateDevice::DumpstateMode::DEFAULT:
-            return dumpstateBoardImpl(fd, false);
+            return dumpstateBoardImpl(fd, false, in_timeoutMillis);
 
         case IDumpstateDevice::DumpstateMode::INTERACTIVE:
         case IDumpstateDevice::DumpstateMode::REMOTE:
@@ -83,14 +82,27 @@ bool Dumpstate::getVerboseLoggingEnabledImpl() {
     return ::android::base::GetBoolProperty(kVerboseLoggingProperty, false);
 }
 
-ndk::ScopedAStatus Dumpstate::dumpstateBoardImpl(const int fd, const bool full) {
+ndk::ScopedAStatus Dumpstate::dumpstateBoardImpl(const int fd, const bool full,
+                                                 const int64_t timeoutMillis) {
     ALOGD("DumpstateDevice::dumpstateBoard() FD: %d\n", fd);
 
-    dprintf(fd, "verbose logging: %s\n", getVerboseLoggingEnabledImpl() ? "enabled" : "disabled");
-    dprintf(fd, "[%s] %s\n", (full ? "full" : "default"), "Hello, world!");
+    // Sections run in parallel and write to their own fd, which is streamed to the dump in the
+    // order the sections are added. Slow sections should get a budget of their own.
+    DumpSectionRunner runner;
+    runner.add("verbose logging", [this](int sectionFd) {
+        dprintf(sectionFd, "verbose logging: %s\n",
+                getVerboseLoggingEnabledImpl() ? "enabled" : "disabled");
+    });
+    runner.add("greeting", [full](int sectionFd) {
+        dprintf(sectionFd, "[%s] %s\n", (full ? "full" : "default"), "Hello, world!");
+    });
 
     // Shows an example on how to use the libdumpstateutil API.
-    DumpFileToFd(fd, "cmdline", "/proc/self/cmdline");
+    runner.add("cmdline", [](int sectionFd) {
+        DumpFileToFd(sectionFd, "cmdline", "/proc/self/cmdline");
+    });
+
+    runner.run(fd, std::chrono::milliseconds(timeoutMillis));
 
     return ndk::ScopedAStatus::ok();
 }
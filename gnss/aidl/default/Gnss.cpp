@@ -45,7 +45,10 @@ constexpr int TTFF_MILLIS = 2200;
 
 std::shared_ptr<IGnssCallback> Gnss::sGnssCallback = nullptr;
 
-Gnss::Gnss() : mMinIntervalMs(1000), mFirstFixReceived(false) {}
+Gnss::Gnss()
+    : mMinIntervalMs(1000),
+      mFirstFixReceived(false),
+      mScheduler(std::make_shared<GnssScheduler>()) {}
 
 ScopedAStatus Gnss::setCallback(const std::shared_ptr<IGnssCallback>& callback) {
     ALOGD("setCallback");
@@ -95,48 +98,45 @@ ScopedAStatus Gnss::start() {
     }
 
     mIsActive = true;
-    mThreadBlocker.reset();
     // notify measurement engine to update measurement interval
     mGnssMeasurementInterface->setLocationEnabled(true);
     this->reportGnssStatusValue(IGnssCallback::GnssStatusValue::SESSION_BEGIN);
-    mThread = std::thread([this]() {
-        this->reportSvStatus();
-        if (!mFirstFixReceived) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(TTFF_MILLIS));
-            mFirstFixReceived = true;
-        }
-        do {
-            if (!mIsActive) {
-                break;
-            }
-            this->reportSvStatus();
-            this->reportNmea();
-
-            auto currentLocation = getLocationFromHW();
-            mGnssPowerIndication->notePowerConsumption();
-            if (currentLocation != nullptr) {
-                this->reportLocation(*currentLocation);
-            } else {
-                const auto location = Utils::getMockLocation();
-                this->reportLocation(location);
-            }
-        } while (mIsActive && mThreadBlocker.wait_for(std::chrono::milliseconds(mMinIntervalMs)));
-    });
+    this->reportSvStatus();
+    const auto ttff = std::chrono::milliseconds(mFirstFixReceived ? 0 : TTFF_MILLIS);
+    mScheduler->start(
+            GnssScheduler::Stream::LOCATION, this, std::chrono::milliseconds(mMinIntervalMs),
+            [this](int64_t elapsedRealtimeNs) { this->reportFix(elapsedRealtimeNs); }, ttff);
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus Gnss::stop() {
     ALOGD("stop");
     mIsActive = false;
+    mScheduler->stop(GnssScheduler::Stream::LOCATION, this);
     mGnssMeasurementInterface->setLocationEnabled(false);
     this->reportGnssStatusValue(IGnssCallback::GnssStatusValue::SESSION_END);
-    mThreadBlocker.notify();
-    if (mThread.joinable()) {
-        mThread.join();
-    }
     return ScopedAStatus::ok();
 }
 
+void Gnss::reportFix(const int64_t elapsedRealtimeNs) {
+    mFirstFixReceived = true;
+    this->reportSvStatus();
+    this->reportNmea();
+
+    auto currentLocation = getLocationFromHW();
+    mGnssPowerIndication->notePowerConsumption();
+    GnssLocation location =
+            (currentLocation != nullptr) ? *currentLocation : Utils::getMockLocation();
+    // Stamp the fix with its tick, which the measurements of the same tick carry too
+    if (location.elapsedRealtime.flags & ElapsedRealtime::HAS_TIMESTAMP_NS) {
+        location.timestampMillis +=
+                (elapsedRealtimeNs - location.elapsedRealtime.timestampNs) / 1000000;
+    }
+    location.elapsedRealtime.flags |= ElapsedRealtime::HAS_TIMESTAMP_NS;
+    location.elapsedRealtime.timestampNs = elapsedRealtimeNs;
+    this->reportLocation(location);
+}
+
 ScopedAStatus Gnss::close() {
     ALOGD("close");
     sGnssCallback = nullptr;
@@ -274,6 +274,9 @@ ScopedAStatus Gnss::setPositionMode(const PositionModeOptions& options) {
     ALOGD("setPositionMode. minIntervalMs:%d, lowPowerMode:%d", options.minIntervalMs,
           (int)options.lowPowerMode);
     mMinIntervalMs = std::max(1000, options.minIntervalMs);
+    // Does nothing while the location is not scheduled
+    mScheduler->setInterval(GnssScheduler::Stream::LOCATION, this,
+                            std::chrono::milliseconds(mMinIntervalMs));
     mGnssMeasurementInterface->setLocationInterval(mMinIntervalMs);
     return ScopedAStatus::ok();
 }
@@ -309,7 +312,7 @@ ScopedAStatus Gnss::getExtensionGnssMeasurement(
         std::shared_ptr<IGnssMeasurementInterface>* iGnssMeasurement) {
     ALOGD("getExtensionGnssMeasurement");
     if (mGnssMeasurementInterface == nullptr) {
-        mGnssMeasurementInterface = SharedRefBase::make<GnssMeasurementInterface>();
+        mGnssMeasurementInterface = SharedRefBase::make<GnssMeasurementInterface>(mScheduler);
     }
     *iGnssMeasurement = mGnssMeasurementInterface;
     return ScopedAStatus::ok();
@@ -333,7 +336,7 @@ ScopedAStatus Gnss::getExtensionGnssNavigationMessage(
         std::shared_ptr<IGnssNavigationMessageInterface>* iGnssNavigationMessage) {
     ALOGD("getExtensionGnssNavigationMessage");
 
-    *iGnssNavigationMessage = SharedRefBase::make<GnssNavigationMessageInterface>();
+    *iGnssNavigationMessage = SharedRefBase::make<GnssNavigationMessageInterface>(mScheduler);
     return ScopedAStatus::ok();
 }
 
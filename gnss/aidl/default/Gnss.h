@@ -30,10 +30,10 @@
 #include <aidl/android/hardware/gnss/visibility_control/BnGnssVisibilityControl.h>
 #include <atomic>
 #include <mutex>
-#include <thread>
 #include "GnssConfiguration.h"
 #include "GnssMeasurementInterface.h"
 #include "GnssPowerIndication.h"
+#include "GnssScheduler.h"
 #include "Utils.h"
 
 namespace aidl::android::hardware::gnss {
@@ -89,6 +89,7 @@ class Gnss : public BnGnss {
     std::shared_ptr<GnssMeasurementInterface> mGnssMeasurementInterface;
 
   private:
+    void reportFix(const int64_t elapsedRealtimeNs);
     void reportLocation(const GnssLocation&) const;
     void reportSvStatus() const;
     void reportSvStatus(const std::vector<IGnssCallback::GnssSvInfo>& svInfoList) const;
@@ -105,8 +106,8 @@ class Gnss : public BnGnss {
     std::atomic<bool> mIsSvStatusActive;
     std::atomic<bool> mIsNmeaActive;
     std::atomic<bool> mFirstFixReceived;
-    std::thread mThread;
-    ::android::hardware::gnss::common::ThreadBlocker mThreadBlocker;
+    // Shared with the extensions reporting periodically, so all reports share one timebase
+    const std::shared_ptr<GnssScheduler> mScheduler;
 
     mutable std::mutex mMutex;
 };
@@ -32,9 +32,12 @@ constexpr int BATCH_SIZE = 10;
 std::shared_ptr<IGnssBatchingCallback> GnssBatching::sCallback = nullptr;
 
 GnssBatching::GnssBatching()
-    : mMinIntervalMs(1000),
+    : mIsActive(false),
+      mMinIntervalMs(1000),
       mWakeUpOnFifoFull(false),
-      mBatchedLocations(std::vector<GnssLocation>()) {}
+      mBatchedLocations(BATCH_SIZE),
+      mBatchHead(0),
+      mBatchCount(0) {}
 GnssBatching::~GnssBatching() {
     cleanup();
 }
@@ -48,7 +51,7 @@ ndk::ScopedAStatus GnssBatching::init(const std::shared_ptr<IGnssBatchingCallbac
 
 ndk::ScopedAStatus GnssBatching::getBatchSize(int* size) {
     ALOGD("getBatchingSize");
-    *size = BATCH_SIZE;
+    *size = static_cast<int>(mBatchedLocations.size());
     return ndk::ScopedAStatus::ok();
 }
 
@@ -67,12 +70,12 @@ ndk::ScopedAStatus GnssBatching::start(const Options& options) {
     mMinDistanceMeters = options.minDistanceMeters;
 
     mIsActive = true;
+    mThreadBlocker.reset();
     mThread = std::thread([this]() {
-        while (mIsActive == true) {
+        do {
             const auto location = common::Utils::getMockLocation();
             this->batchLocation(location);
-            std::this_thread::sleep_for(std::chrono::milliseconds(mMinIntervalMs));
-        }
+        } while (mIsActive && mThreadBlocker.wait_for(std::chrono::milliseconds(mMinIntervalMs)));
     });
 
     return ndk::ScopedAStatus::ok();
@@ -80,23 +83,21 @@ ndk::ScopedAStatus GnssBatching::start(const Options& options) {
 
 ndk::ScopedAStatus GnssBatching::flush() {
     ALOGD("flush");
-    std::vector<GnssLocation> copy = std::vector<GnssLocation>(mBatchedLocations);
-    ndk::ScopedAStatus status;
-    if (sCallback != nullptr) {
-        sCallback->gnssLocationBatchCb(copy);
-        status = ndk::ScopedAStatus::ok();
-    } else {
+    const std::vector<GnssLocation> locations = takeBatchedLocations();
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (sCallback == nullptr) {
         ALOGE("GnssBatchingCallback is null. flush() failed.");
-        status = ndk::ScopedAStatus::fromServiceSpecificError(IGnss::ERROR_GENERIC);
+        return ndk::ScopedAStatus::fromServiceSpecificError(IGnss::ERROR_GENERIC);
     }
-    mBatchedLocations.clear();
-    return status;
+    sCallback->gnssLocationBatchCb(locations);
+    return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus GnssBatching::stop() {
     ALOGD("stop");
     // Do not call flush() at stop()
     mIsActive = false;
+    mThreadBlocker.notify();
     if (mThread.joinable()) {
         mThread.join();
     }
@@ -105,24 +106,55 @@ ndk::ScopedAStatus GnssBatching::stop() {
 
 ndk::ScopedAStatus GnssBatching::cleanup() {
     ALOGD("cleanup");
-    std::unique_lock<std::mutex> lock(mMutex);
     if (mIsActive) {
         stop();
     }
     flush();
 
+    std::unique_lock<std::mutex> lock(mMutex);
     sCallback = nullptr;
     return ndk::ScopedAStatus::ok();
 }
 
 void GnssBatching::batchLocation(const GnssLocation& location) {
-    if (mBatchedLocations.size() > BATCH_SIZE) {
-        mBatchedLocations.erase(mBatchedLocations.begin());
+    {
+        std::unique_lock<std::mutex> lock(mBatchMutex);
+        const size_t capacity = mBatchedLocations.size();
+        mBatchedLocations[(mBatchHead + mBatchCount) % capacity] = location;
+        if (mBatchCount < capacity) {
+            mBatchCount++;
+        } else {
+            // Overwrite the oldest fix.
+            mBatchHead = (mBatchHead + 1) % capacity;
+        }
+        if (!mWakeUpOnFifoFull || mBatchCount < capacity) {
+            return;
+        }
     }
-    mBatchedLocations.push_back(location);
-    if (mWakeUpOnFifoFull && mBatchedLocations.size() == BATCH_SIZE) {
-        flush();
+    // The FIFO is full, wake up the AP with the whole batch.
+    reportBatchedLocations(takeBatchedLocations());
+}
+
+std::vector<GnssLocation> GnssBatching::takeBatchedLocations() {
+    std::unique_lock<std::mutex> lock(mBatchMutex);
+    const size_t capacity = mBatchedLocations.size();
+    std::vector<GnssLocation> locations;
+    locations.reserve(mBatchCount);
+    for (size_t i = 0; i < mBatchCount; i++) {
+        locations.push_back(std::move(mBatchedLocations[(mBatchHead + i) % capacity]));
+    }
+    mBatchHead = 0;
+    mBatchCount = 0;
+    return locations;
+}
+
+void GnssBatching::reportBatchedLocations(const std::vector<GnssLocation>& locations) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (sCallback == nullptr) {
+        ALOGE("%s: GnssBatchingCallback is null.", __func__);
+        return;
     }
+    sCallback->gnssLocationBatchCb(locations);
 }
 
 }  // namespace aidl::android::hardware::gnss
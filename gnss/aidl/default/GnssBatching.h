@@ -18,7 +18,10 @@
 
 #include <aidl/android/hardware/gnss/BnGnssBatching.h>
 #include <atomic>
+#include <mutex>
 #include <thread>
+#include <vector>
+#include "Utils.h"
 
 namespace aidl::android::hardware::gnss {
 
@@ -34,7 +37,12 @@ struct GnssBatching : public BnGnssBatching {
     ndk::ScopedAStatus cleanup() override;
 
   private:
+    // Stores the fix in the batch FIFO. When the FIFO is full, the batch is either delivered or the
+    // oldest fix is overwritten, depending on WAKEUP_ON_FIFO_FULL.
     void batchLocation(const GnssLocation&);
+    // Moves the batched fixes out of the FIFO, oldest first.
+    std::vector<GnssLocation> takeBatchedLocations();
+    void reportBatchedLocations(const std::vector<GnssLocation>& locations);
 
     // Guarded by mMutex
     static std::shared_ptr<IGnssBatchingCallback> sCallback;
@@ -44,11 +52,17 @@ struct GnssBatching : public BnGnssBatching {
     std::atomic<long> mMinIntervalMs;
     std::atomic<float> mMinDistanceMeters;
     std::atomic<bool> mWakeUpOnFifoFull;
+    ::android::hardware::gnss::common::ThreadBlocker mThreadBlocker;
 
     // Synchronization lock for sCallback
     mutable std::mutex mMutex;
 
+    // Ring buffer of getBatchSize() fixes, filled by mThread without any callback.
+    // Guarded by mBatchMutex.
+    std::mutex mBatchMutex;
     std::vector<GnssLocation> mBatchedLocations;
+    size_t mBatchHead;
+    size_t mBatchCount;
 };
 
 }  // namespace aidl::android::hardware::gnss
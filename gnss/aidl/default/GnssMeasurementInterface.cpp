@@ -33,11 +33,13 @@ using DeviceFileReader = ::android::hardware::gnss::common::DeviceFileReader;
 
 std::shared_ptr<IGnssMeasurementCallback> GnssMeasurementInterface::sCallback = nullptr;
 
-GnssMeasurementInterface::GnssMeasurementInterface()
-    : mIntervalMs(1000), mLocationIntervalMs(1000), mFutures(std::vector<std::future<void>>()) {}
+GnssMeasurementInterface::GnssMeasurementInterface(std::shared_ptr<GnssScheduler> scheduler)
+    : mScheduler(std::move(scheduler)), mIntervalMs(1000), mLocationIntervalMs(1000) {}
 
 GnssMeasurementInterface::~GnssMeasurementInterface() {
-    waitForStoppingThreads();
+    if (mIsActive) {
+        stop();
+    }
 }
 
 ndk::ScopedAStatus GnssMeasurementInterface::setCallback(
@@ -98,46 +100,40 @@ void GnssMeasurementInterface::start(const bool enableCorrVecOutputs) {
         ALOGD("restarting since measurement has started");
         stop();
     }
-    // Wait for stopping previous thread.
-    waitForStoppingThreads();
 
     mIsActive = true;
-    mThreadBlocker.reset();
-    mThread = std::thread([this, enableCorrVecOutputs]() {
-        int intervalMs;
-        do {
-            if (!mIsActive) {
-                break;
-            }
-            std::string rawMeasurementStr = "";
-            if (ReplayUtils::hasGnssDeviceFile() &&
-                ReplayUtils::isGnssRawMeasurement(
-                        rawMeasurementStr =
-                                DeviceFileReader::Instance().getGnssRawMeasurementData())) {
-                ALOGD("rawMeasurementStr(size: %zu) from device file: %s", rawMeasurementStr.size(),
-                      rawMeasurementStr.c_str());
-                auto measurement =
-                        GnssRawMeasurementParser::getMeasurementFromStrs(rawMeasurementStr);
-                if (measurement != nullptr) {
-                    this->reportMeasurement(*measurement);
-                }
-            } else {
-                auto measurement = Utils::getMockMeasurement(enableCorrVecOutputs);
-                this->reportMeasurement(measurement);
-            }
-            intervalMs =
-                    (mLocationEnabled) ? std::min(mLocationIntervalMs, mIntervalMs) : mIntervalMs;
-        } while (mIsActive && mThreadBlocker.wait_for(std::chrono::milliseconds(intervalMs)));
-    });
+    mScheduler->start(GnssScheduler::Stream::MEASUREMENT, this, getReportingInterval(),
+                      [this, enableCorrVecOutputs](int64_t elapsedRealtimeNs) {
+                          this->reportMeasurement(enableCorrVecOutputs, elapsedRealtimeNs);
+                      });
 }
 
 void GnssMeasurementInterface::stop() {
     ALOGD("stop");
     mIsActive = false;
-    mThreadBlocker.notify();
-    if (mThread.joinable()) {
-        mFutures.push_back(std::async(std::launch::async, [this] { mThread.join(); }));
+    mScheduler->stop(GnssScheduler::Stream::MEASUREMENT, this);
+}
+
+void GnssMeasurementInterface::reportMeasurement(const bool enableCorrVecOutputs,
+                                                 const int64_t elapsedRealtimeNs) {
+    std::string rawMeasurementStr = "";
+    std::unique_ptr<GnssData> measurement;
+    if (ReplayUtils::hasGnssDeviceFile() &&
+        ReplayUtils::isGnssRawMeasurement(
+                rawMeasurementStr = DeviceFileReader::Instance().getGnssRawMeasurementData())) {
+        ALOGD("rawMeasurementStr(size: %zu) from device file: %s", rawMeasurementStr.size(),
+              rawMeasurementStr.c_str());
+        measurement = GnssRawMeasurementParser::getMeasurementFromStrs(rawMeasurementStr);
+    } else {
+        measurement = std::make_unique<GnssData>(Utils::getMockMeasurement(enableCorrVecOutputs));
     }
+    if (measurement == nullptr) {
+        return;
+    }
+    // Stamp the measurement with its tick, which the location of the same tick carries too
+    measurement->elapsedRealtime.flags |= ElapsedRealtime::HAS_TIMESTAMP_NS;
+    measurement->elapsedRealtime.timestampNs = elapsedRealtimeNs;
+    this->reportMeasurement(*measurement);
 }
 
 void GnssMeasurementInterface::reportMeasurement(const GnssData& data) {
@@ -156,19 +152,24 @@ void GnssMeasurementInterface::reportMeasurement(const GnssData& data) {
 
 void GnssMeasurementInterface::setLocationInterval(const int intervalMs) {
     mLocationIntervalMs = intervalMs;
+    updateReportingInterval();
 }
 
 void GnssMeasurementInterface::setLocationEnabled(const bool enabled) {
     mLocationEnabled = enabled;
+    updateReportingInterval();
 }
 
-void GnssMeasurementInterface::waitForStoppingThreads() {
-    for (auto& future : mFutures) {
-        ALOGD("Stopping previous thread.");
-        future.wait();
-        ALOGD("Done stopping thread.");
-    }
-    mFutures.clear();
+std::chrono::milliseconds GnssMeasurementInterface::getReportingInterval() const {
+    const long intervalMs =
+            (mLocationEnabled) ? std::min(mLocationIntervalMs.load(), mIntervalMs.load())
+                               : mIntervalMs.load();
+    return std::chrono::milliseconds(intervalMs);
+}
+
+void GnssMeasurementInterface::updateReportingInterval() {
+    // Does nothing while the measurement is not scheduled
+    mScheduler->setInterval(GnssScheduler::Stream::MEASUREMENT, this, getReportingInterval());
 }
 
 }  // namespace aidl::android::hardware::gnss
@@ -19,16 +19,15 @@
 #include <aidl/android/hardware/gnss/BnGnssMeasurementCallback.h>
 #include <aidl/android/hardware/gnss/BnGnssMeasurementInterface.h>
 #include <atomic>
-#include <future>
+#include <memory>
 #include <mutex>
-#include <thread>
-#include "Utils.h"
+#include "GnssScheduler.h"
 
 namespace aidl::android::hardware::gnss {
 
 struct GnssMeasurementInterface : public BnGnssMeasurementInterface {
   public:
-    GnssMeasurementInterface();
+    explicit GnssMeasurementInterface(std::shared_ptr<GnssScheduler> scheduler);
     ~GnssMeasurementInterface();
     ndk::ScopedAStatus setCallback(const std::shared_ptr<IGnssMeasurementCallback>& callback,
                                    const bool enableFullTracking,
@@ -43,16 +42,17 @@ struct GnssMeasurementInterface : public BnGnssMeasurementInterface {
   private:
     void start(const bool enableCorrVecOutputs);
     void stop();
+    void reportMeasurement(const bool enableCorrVecOutputs, const int64_t elapsedRealtimeNs);
     void reportMeasurement(const GnssData&);
-    void waitForStoppingThreads();
+    // Measurements are reported at least as often as locations while locations are enabled
+    std::chrono::milliseconds getReportingInterval() const;
+    void updateReportingInterval();
 
+    const std::shared_ptr<GnssScheduler> mScheduler;
     std::atomic<long> mIntervalMs;
     std::atomic<long> mLocationIntervalMs;
     std::atomic<bool> mIsActive;
     std::atomic<bool> mLocationEnabled;
-    std::thread mThread;
-    std::vector<std::future<void>> mFutures;
-    ::android::hardware::gnss::common::ThreadBlocker mThreadBlocker;
 
     // Guarded by mMutex
     static std::shared_ptr<IGnssMeasurementCallback> sCallback;
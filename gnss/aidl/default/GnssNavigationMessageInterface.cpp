@@ -29,17 +29,24 @@ using GnssNavigationMessageType = GnssNavigationMessage::GnssNavigationMessageTy
 
 std::shared_ptr<IGnssNavigationMessageCallback> GnssNavigationMessageInterface::sCallback = nullptr;
 
-GnssNavigationMessageInterface::GnssNavigationMessageInterface() : mMinIntervalMillis(1000) {}
+GnssNavigationMessageInterface::GnssNavigationMessageInterface(
+        std::shared_ptr<GnssScheduler> scheduler)
+    : mScheduler(std::move(scheduler)), mMinIntervalMillis(1000) {}
 
 GnssNavigationMessageInterface::~GnssNavigationMessageInterface() {
-    waitForStoppingThreads();
+    if (mIsActive) {
+        stop();
+    }
 }
 
 ndk::ScopedAStatus GnssNavigationMessageInterface::setCallback(
         const std::shared_ptr<IGnssNavigationMessageCallback>& callback) {
     ALOGD("setCallback");
-    std::unique_lock<std::mutex> lock(mMutex);
-    sCallback = callback;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        sCallback = callback;
+    }
+    // Not under mMutex, as stopping waits for a report in flight, which takes it
     start();
     return ndk::ScopedAStatus::ok();
 }
@@ -61,36 +68,27 @@ void GnssNavigationMessageInterface::start() {
         ALOGD("restarting since nav msg has started");
         stop();
     }
-    // Wait for stopping previous thread.
-    waitForStoppingThreads();
 
     mIsActive = true;
-    mThread = std::thread([this]() {
-        do {
-            if (!mIsActive) {
-                break;
-            }
-            GnssNavigationMessage message = {
-                    .svid = 19,
-                    .type = GnssNavigationMessageType::GPS_L1CA,
-                    .status = GnssNavigationMessage::STATUS_PARITY_PASSED,
-                    .messageId = 2,
-                    .submessageId = 3,
-                    .data = std::vector<uint8_t>(40, 0xF9),
-            };
-            this->reportMessage(message);
-        } while (mIsActive &&
-                 mThreadBlocker.wait_for(std::chrono::milliseconds(mMinIntervalMillis)));
-    });
+    // Takes the stream over from another instance, which can't stop it anymore
+    mScheduler->start(GnssScheduler::Stream::NAVIGATION_MESSAGE, this,
+                      std::chrono::milliseconds(mMinIntervalMillis), [this](int64_t) {
+                          GnssNavigationMessage message = {
+                                  .svid = 19,
+                                  .type = GnssNavigationMessageType::GPS_L1CA,
+                                  .status = GnssNavigationMessage::STATUS_PARITY_PASSED,
+                                  .messageId = 2,
+                                  .submessageId = 3,
+                                  .data = std::vector<uint8_t>(40, 0xF9),
+                          };
+                          this->reportMessage(message);
+                      });
 }
 
 void GnssNavigationMessageInterface::stop() {
     ALOGD("stop");
     mIsActive = false;
-    mThreadBlocker.notify();
-    if (mThread.joinable()) {
-        mFutures.push_back(std::async(std::launch::async, [this] { mThread.join(); }));
-    }
+    mScheduler->stop(GnssScheduler::Stream::NAVIGATION_MESSAGE, this);
 }
 
 void GnssNavigationMessageInterface::reportMessage(const GnssNavigationMessage& message) {
@@ -107,13 +105,4 @@ void GnssNavigationMessageInterface::reportMessage(const GnssNavigationMessage&
     callbackCopy->gnssNavigationMessageCb(message);
 }
 
-void GnssNavigationMessageInterface::waitForStoppingThreads() {
-    for (auto& future : mFutures) {
-        ALOGD("Stopping previous thread.");
-        future.wait();
-        ALOGD("Done stopping thread.");
-    }
-    mFutures.clear();
-}
-
 }  // namespace aidl::android::hardware::gnss
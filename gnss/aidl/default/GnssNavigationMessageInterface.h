@@ -18,15 +18,15 @@
 
 #include <aidl/android/hardware/gnss/BnGnssNavigationMessageInterface.h>
 #include <atomic>
-#include <future>
-#include <thread>
-#include "Utils.h"
+#include <memory>
+#include <mutex>
+#include "GnssScheduler.h"
 
 namespace aidl::android::hardware::gnss {
 
 struct GnssNavigationMessageInterface : public BnGnssNavigationMessageInterface {
   public:
-    GnssNavigationMessageInterface();
+    explicit GnssNavigationMessageInterface(std::shared_ptr<GnssScheduler> scheduler);
     ~GnssNavigationMessageInterface();
     ndk::ScopedAStatus setCallback(
             const std::shared_ptr<IGnssNavigationMessageCallback>& callback) override;
@@ -36,13 +36,10 @@ struct GnssNavigationMessageInterface : public BnGnssNavigationMessageInterface
     void start();
     void stop();
     void reportMessage(const IGnssNavigationMessageCallback::GnssNavigationMessage& message);
-    void waitForStoppingThreads();
 
+    const std::shared_ptr<GnssScheduler> mScheduler;
     std::atomic<long> mMinIntervalMillis;
     std::atomic<bool> mIsActive;
-    std::thread mThread;
-    std::vector<std::future<void>> mFutures;
-    ::android::hardware::gnss::common::ThreadBlocker mThreadBlocker;
 
     // Guarded by mMutex
     static std::shared_ptr<IGnssNavigationMessageCallback> sCallback;
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "GnssSchedulerAidl"
+
+#include "GnssScheduler.h"
+#include <log/log.h>
+#include <utils/SystemClock.h>
+#include <algorithm>
+
+namespace aidl::android::hardware::gnss {
+
+GnssScheduler::GnssScheduler() : mEpoch(Clock::now()), mThread([this] { threadLoop(); }) {}
+
+GnssScheduler::~GnssScheduler() {
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+void GnssScheduler::start(Stream stream, const void* owner, std::chrono::milliseconds interval,
+                          Callback callback, std::chrono::milliseconds startDelay) {
+    interval = std::max(interval, std::chrono::milliseconds(1));
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mStreams[stream] = {owner, interval, std::move(callback),
+                            alignToTick(Clock::now() + startDelay, interval)};
+    }
+    mCondition.notify_all();
+}
+
+void GnssScheduler::setInterval(Stream stream, const void* owner,
+                                std::chrono::milliseconds interval) {
+    interval = std::max(interval, std::chrono::milliseconds(1));
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto it = mStreams.find(stream);
+        if (it == mStreams.end() || it->second.owner != owner ||
+            it->second.interval == interval) {
+            return;
+        }
+        it->second.interval = interval;
+        it->second.nextTick = alignToTick(Clock::now(), interval);
+    }
+    mCondition.notify_all();
+}
+
+void GnssScheduler::stop(Stream stream, const void* owner) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto it = mStreams.find(stream);
+    if (it != mStreams.end() && it->second.owner == owner) {
+        mStreams.erase(it);
+    }
+    if (std::this_thread::get_id() == mThread.get_id()) {
+        return;
+    }
+    // The callback of owner may still run after the stream was taken over
+    const auto firing = std::make_pair(stream, owner);
+    mCondition.wait(lock, [this, &firing] { return mFiring != firing; });
+}
+
+GnssScheduler::Clock::time_point GnssScheduler::alignToTick(
+        Clock::time_point time, std::chrono::milliseconds interval) const {
+    if (time <= mEpoch) {
+        return mEpoch;
+    }
+    const auto ticks = (time - mEpoch + interval - Clock::duration(1)) / interval;
+    return mEpoch + ticks * interval;
+}
+
+void GnssScheduler::threadLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mStop) {
+        // The first stream due, with streams due at the same tick in the order of Stream
+        auto next = std::min_element(mStreams.begin(), mStreams.end(),
+                                     [](const auto& a, const auto& b) {
+                                         return a.second.nextTick < b.second.nextTick;
+                                     });
+        if (next == mStreams.end()) {
+            mCondition.wait(lock);
+            continue;
+        }
+        const auto tick = next->second.nextTick;
+        const auto now = Clock::now();
+        if (now < tick) {
+            mCondition.wait_until(lock, tick);
+            continue;
+        }
+
+        // Ticks missed while the thread was busy are skipped, not caught up on.
+        Entry& entry = next->second;
+        entry.nextTick = std::max(tick + entry.interval, alignToTick(now, entry.interval));
+        const Callback callback = entry.callback;
+        if (tick != mLastTick) {
+            // elapsedRealtimeNano() keeps counting in suspend, unlike Clock
+            mLastTick = tick;
+            mLastTickElapsedRealtimeNs =
+                    ::android::elapsedRealtimeNano() -
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - tick).count();
+        }
+        const int64_t elapsedRealtimeNs = mLastTickElapsedRealtimeNs;
+        mFiring = std::make_pair(next->first, entry.owner);
+
+        lock.unlock();
+        callback(elapsedRealtimeNs);
+        lock.lock();
+
+        mFiring.reset();
+        mCondition.notify_all();
+    }
+}
+
+}  // namespace aidl::android::hardware::gnss
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace aidl::android::hardware::gnss {
+
+// Drives the periodic outputs of the HAL from a single thread. Every stream ticks on the same
+// timebase, at the epoch of the scheduler plus a multiple of its interval, so streams with the
+// same interval fire together. Each call gets the elapsed realtime of its tick, read once when the
+// tick fires, so the outputs of a tick (e.g. a fix and the measurements it was computed from)
+// carry the same time.
+//
+// A stream is scheduled by one owner at a time, the object passed to start(). Starting a stream
+// takes it over from its previous owner, and the previous owner can no longer change or stop it.
+class GnssScheduler {
+  public:
+    // Streams due at the same tick fire in this order.
+    enum class Stream { LOCATION, MEASUREMENT, NAVIGATION_MESSAGE };
+    // Called on the scheduler thread with the elapsed realtime of the tick, in nanoseconds.
+    using Callback = std::function<void(int64_t elapsedRealtimeNs)>;
+
+    GnssScheduler();
+    ~GnssScheduler();
+
+    // Calls the callback on every tick of the interval, from the first tick at least startDelay
+    // from now on. Replaces the stream if it is scheduled already.
+    void start(Stream stream, const void* owner, std::chrono::milliseconds interval,
+               Callback callback,
+               std::chrono::milliseconds startDelay = std::chrono::milliseconds(0));
+    // Moves the stream to another interval from its next tick on. Does nothing if the stream is
+    // not scheduled by owner.
+    void setInterval(Stream stream, const void* owner, std::chrono::milliseconds interval);
+    // Unschedules the stream if it is scheduled by owner. Once this returns, no callback of owner
+    // for the stream is running anymore, unless called from the callback itself.
+    void stop(Stream stream, const void* owner);
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        const void* owner;
+        std::chrono::milliseconds interval;
+        Callback callback;
+        Clock::time_point nextTick;
+    };
+
+    // Returns the first tick of the interval at or after time.
+    Clock::time_point alignToTick(Clock::time_point time, std::chrono::milliseconds interval) const;
+    void threadLoop();
+
+    const Clock::time_point mEpoch;
+
+    std::mutex mMutex;
+    // Signals changes of mStreams, mFiring and mStop. Guarded by mMutex, like the members below.
+    std::condition_variable mCondition;
+    std::map<Stream, Entry> mStreams;
+    // The stream whose callback is running, and its owner
+    std::optional<std::pair<Stream, const void*>> mFiring;
+    bool mStop = false;
+    // The last tick fired, and the elapsed realtime the streams due at that tick get
+    Clock::time_point mLastTick;
+    int64_t mLastTickElapsedRealtimeNs = 0;
+
+    // Declared last, as it uses the members above
+    std::thread mThread;
+};
+
+}  // namespace aidl::android::hardware::gnss
@@ -15,86 +15,136 @@
  */
 #include "DeviceFileReader.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
 namespace android {
 namespace hardware {
 namespace gnss {
 namespace common {
 
-void DeviceFileReader::getDataFromDeviceFile(const std::string& command, int mMinIntervalMs) {
-    char inputBuffer[INPUT_BUFFER_SIZE];
-    std::string deviceFilePath = "";
-    if (command == CMD_GET_LOCATION) {
-        deviceFilePath = ReplayUtils::getFixedLocationPath();
-    } else if (command == CMD_GET_RAWMEASUREMENT) {
-        deviceFilePath = ReplayUtils::getGnssPath();
-    } else {
-        // Invalid command
-        return;
+namespace {
+// End of frame mark written by the device after each response.
+constexpr std::string_view kEndOfFrame = "\n\n\n\n";
+}  // namespace
+
+const DeviceFileReader::DeviceFile* DeviceFileReader::getDeviceFile(
+        const std::string& deviceFilePath) {
+    auto it = device_files_.find(deviceFilePath);
+    if (it != device_files_.end()) {
+        return &it->second;
     }
 
     int gnss_fd, epoll_fd;
-    if ((gnss_fd = open(deviceFilePath.c_str(), O_RDWR | O_NONBLOCK)) == -1) {
-        return;
-    }
-    if (write(gnss_fd, command.c_str(), command.size()) <= 0) {
-        close(gnss_fd);
-        return;
+    if ((gnss_fd = open(deviceFilePath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC)) == -1) {
+        return nullptr;
     }
 
     // Create an epoll instance.
     if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
         close(gnss_fd);
-        return;
+        return nullptr;
     }
 
     // Add file descriptor to epoll instance.
-    struct epoll_event ev, events[1];
+    struct epoll_event ev;
     memset(&ev, 0, sizeof(ev));
     ev.data.fd = gnss_fd;
     ev.events = EPOLLIN;
     if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, gnss_fd, &ev) == -1) {
         close(gnss_fd);
         close(epoll_fd);
+        return nullptr;
+    }
+    return &(device_files_[deviceFilePath] = {gnss_fd, epoll_fd});
+}
+
+void DeviceFileReader::closeDeviceFile(const std::string& deviceFilePath) {
+    auto it = device_files_.find(deviceFilePath);
+    if (it == device_files_.end()) {
         return;
     }
+    close(it->second.gnss_fd);
+    close(it->second.epoll_fd);
+    device_files_.erase(it);
+}
+
+bool DeviceFileReader::takeFrame(std::string* frame) {
+    // Only search the bytes appended since the previous call, plus the ones that may hold the
+    // beginning of a split end of frame mark.
+    const size_t pos = s_buffer_.find(kEndOfFrame, scanned_size_);
+    if (pos == std::string::npos) {
+        scanned_size_ = s_buffer_.size() < kEndOfFrame.size()
+                                ? 0
+                                : s_buffer_.size() - kEndOfFrame.size() + 1;
+        return false;
+    }
+    frame->assign(s_buffer_, 0, pos);
+    s_buffer_.erase(0, pos + kEndOfFrame.size());
+    scanned_size_ = 0;
+    return true;
+}
+
+void DeviceFileReader::getDataFromDeviceFile(const std::string& command, int mMinIntervalMs) {
+    std::string deviceFilePath = "";
+    if (command == CMD_GET_LOCATION) {
+        deviceFilePath = ReplayUtils::getFixedLocationPath();
+    } else if (command == CMD_GET_RAWMEASUREMENT) {
+        deviceFilePath = ReplayUtils::getGnssPath();
+    } else {
+        // Invalid command
+        return;
+    }
+
+    // The device file is kept open across requests. Reopen it once if the command cannot be
+    // written, e.g. because the device was reset.
+    const DeviceFile* device = getDeviceFile(deviceFilePath);
+    if (device != nullptr && write(device->gnss_fd, command.c_str(), command.size()) <= 0) {
+        closeDeviceFile(deviceFilePath);
+        device = getDeviceFile(deviceFilePath);
+        if (device != nullptr && write(device->gnss_fd, command.c_str(), command.size()) <= 0) {
+            closeDeviceFile(deviceFilePath);
+            return;
+        }
+    }
+    if (device == nullptr) {
+        return;
+    }
+    const int gnss_fd = device->gnss_fd;
 
     // Wait for device file event.
-    if (epoll_wait(epoll_fd, events, 1, mMinIntervalMs) == -1) {
-        close(gnss_fd);
-        close(epoll_fd);
+    struct epoll_event events[1];
+    if (epoll_wait(device->epoll_fd, events, 1, mMinIntervalMs) == -1) {
         return;
     }
 
-    // Handle event and write data to string buffer.
-    int bytes_read = -1;
-    std::string inputStr = "";
+    // Handle event and append data straight to the string buffer.
     while (true) {
-        memset(inputBuffer, 0, INPUT_BUFFER_SIZE);
-        bytes_read = read(gnss_fd, &inputBuffer, INPUT_BUFFER_SIZE);
+        const size_t size = s_buffer_.size();
+        s_buffer_.resize(size + INPUT_BUFFER_SIZE);
+        const ssize_t bytes_read = read(gnss_fd, s_buffer_.data() + size, INPUT_BUFFER_SIZE);
+        s_buffer_.resize(size + std::max<ssize_t>(bytes_read, 0));
         if (bytes_read <= 0) {
             break;
         }
-        s_buffer_ += std::string(inputBuffer, bytes_read);
     }
-    close(gnss_fd);
-    close(epoll_fd);
 
     // Trim end of file mark(\n\n\n\n).
-    auto pos = s_buffer_.find("\n\n\n\n");
-    if (pos != std::string::npos) {
-        inputStr = s_buffer_.substr(0, pos);
-        s_buffer_ = s_buffer_.substr(pos + 4);
-    } else {
+    std::string inputStr;
+    if (!takeFrame(&inputStr)) {
         return;
     }
 
     // Cache the injected data.
     if (command == CMD_GET_LOCATION) {
         // TODO validate data
-        data_[CMD_GET_LOCATION] = inputStr;
+        data_[CMD_GET_LOCATION] = std::move(inputStr);
     } else if (command == CMD_GET_RAWMEASUREMENT) {
         if (ReplayUtils::isGnssRawMeasurement(inputStr)) {
-            data_[CMD_GET_RAWMEASUREMENT] = inputStr;
+            data_[CMD_GET_RAWMEASUREMENT] = std::move(inputStr);
         }
     }
 }
@@ -113,7 +163,12 @@ std::string DeviceFileReader::getGnssRawMeasurementData() {
 
 DeviceFileReader::DeviceFileReader() {}
 
-DeviceFileReader::~DeviceFileReader() {}
+DeviceFileReader::~DeviceFileReader() {
+    for (const auto& [path, device] : device_files_) {
+        close(device.gnss_fd);
+        close(device.epoll_fd);
+    }
+}
 
 }  // namespace common
 }  // namespace gnss
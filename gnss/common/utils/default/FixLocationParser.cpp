@@ -25,7 +25,7 @@ using aidl::android::hardware::gnss::ElapsedRealtime;
 using aidl::android::hardware::gnss::GnssLocation;
 
 std::unique_ptr<GnssLocation> FixLocationParser::getLocationFromInputStr(
-        const std::string& locationStr) {
+        std::string_view locationStr) {
     /*
      * Fix,Provider,LatitudeDegrees,LongitudeDegrees,AltitudeMeters,SpeedMps,
      * AccuracyMeters,BearingDegrees,UnixTimeMillis,SpeedAccuracyMps,BearingAccuracyDegrees,
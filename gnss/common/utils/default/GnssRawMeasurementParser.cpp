@@ -16,6 +16,12 @@
 
 #include "GnssRawMeasurementParser.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
 namespace android {
 namespace hardware {
 namespace gnss {
@@ -31,6 +37,64 @@ using aidl::android::hardware::gnss::GnssSignalType;
 
 using ParseUtils = ::android::hardware::gnss::common::ParseUtils;
 
+namespace {
+
+// Longest numeric field worth parsing, GnssLogger never writes more than a few dozen digits.
+constexpr size_t kMaxNumberLength = 63;
+
+// Splits the line into views of its fields. Unlike ParseUtils::splitStr a trailing empty field is
+// kept, so that every field of the header has a value in the record.
+void splitFields(std::string_view line, std::vector<std::string_view>& out) {
+    out.clear();
+    size_t start = 0;
+    while (true) {
+        size_t end = line.find(COMMA_SEPARATOR, start);
+        if (end == std::string_view::npos) {
+            out.push_back(line.substr(start));
+            return;
+        }
+        out.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+// Returns the next line of the input and advances the position past it, or std::nullopt at the
+// end of the input. Empty lines are returned too, like ParseUtils::splitStr does.
+std::optional<std::string_view> nextLine(std::string_view input, size_t* pos) {
+    if (*pos >= input.size()) {
+        return std::nullopt;
+    }
+    size_t end = input.find(LINE_SEPARATOR, *pos);
+    if (end == std::string_view::npos) {
+        end = input.size();
+    }
+    std::string_view line = input.substr(*pos, end - *pos);
+    *pos = end + 1;
+    return line;
+}
+
+template <typename T>
+T parseInteger(std::string_view s, T defaultVal = 0) {
+    T value;
+    auto [_, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    return ec == std::errc() ? value : defaultVal;
+}
+
+// std::from_chars has no floating point support in our libc++, strtod needs a terminated copy.
+double parseDouble(std::string_view s, double defaultVal = 0) {
+    if (s.empty() || s.size() > kMaxNumberLength) {
+        return defaultVal;
+    }
+    char buffer[kMaxNumberLength + 1];
+    memcpy(buffer, s.data(), s.size());
+    buffer[s.size()] = '\0';
+    char* end;
+    double value = strtod(buffer, &end);
+    return end == buffer ? defaultVal : value;
+}
+
+}  // namespace
+
 std::unordered_map<std::string, int> GnssRawMeasurementParser::getColumnIdNameMappingFromHeader(
         const std::string& header) {
     std::vector<std::string> columnNames;
@@ -55,77 +119,143 @@ std::unordered_map<std::string, int> GnssRawMeasurementParser::getColumnIdNameMa
     return columnNameIdMapping;
 }
 
+std::optional<GnssRawMeasurementParser::ColumnLayout>
+GnssRawMeasurementParser::getColumnLayoutFromHeader(std::string_view header) {
+    static std::mutex cacheMutex;
+    static std::string cachedHeader;
+    static std::optional<ColumnLayout> cachedLayout;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (cachedLayout.has_value() && header == cachedHeader) {
+        return cachedLayout;
+    }
+
+    std::unordered_map<std::string, int> columnNameIdMapping =
+            getColumnIdNameMappingFromHeader(std::string(header));
+    if (columnNameIdMapping.size() < 37 || !ParseUtils::isValidHeader(columnNameIdMapping)) {
+        return std::nullopt;
+    }
+
+    size_t maxColumnId = 0;
+    auto columnId = [&](const char* name) {
+        size_t id = columnNameIdMapping.at(name);
+        maxColumnId = std::max(maxColumnId, id);
+        return id;
+    };
+    ColumnLayout layout = {
+            .leapSecond = columnId("LeapSecond"),
+            .timeNanos = columnId("TimeNanos"),
+            .timeUncertaintyNanos = columnId("TimeUncertaintyNanos"),
+            .fullBiasNanos = columnId("FullBiasNanos"),
+            .biasNanos = columnId("BiasNanos"),
+            .biasUncertaintyNanos = columnId("BiasUncertaintyNanos"),
+            .driftNanosPerSecond = columnId("DriftNanosPerSecond"),
+            .driftUncertaintyNanosPerSecond = columnId("DriftUncertaintyNanosPerSecond"),
+            .hardwareClockDiscontinuityCount = columnId("HardwareClockDiscontinuityCount"),
+            .svid = columnId("Svid"),
+            .state = columnId("State"),
+            .receivedSvTimeNanos = columnId("ReceivedSvTimeNanos"),
+            .receivedSvTimeUncertaintyNanos = columnId("ReceivedSvTimeUncertaintyNanos"),
+            .cn0DbHz = columnId("Cn0DbHz"),
+            .pseudorangeRateMetersPerSecond = columnId("PseudorangeRateMetersPerSecond"),
+            .pseudorangeRateUncertaintyMetersPerSecond =
+                    columnId("PseudorangeRateUncertaintyMetersPerSecond"),
+            .accumulatedDeltaRangeState = columnId("AccumulatedDeltaRangeState"),
+            .accumulatedDeltaRangeMeters = columnId("AccumulatedDeltaRangeMeters"),
+            .accumulatedDeltaRangeUncertaintyMeters =
+                    columnId("AccumulatedDeltaRangeUncertaintyMeters"),
+            .carrierFrequencyHz = columnId("CarrierFrequencyHz"),
+            .carrierCycles = columnId("CarrierCycles"),
+            .carrierPhase = columnId("CarrierPhase"),
+            .carrierPhaseUncertainty = columnId("CarrierPhaseUncertainty"),
+            .snrInDb = columnId("SnrInDb"),
+            .constellationType = columnId("ConstellationType"),
+            .agcDb = columnId("AgcDb"),
+            .basebandCn0DbHz = columnId("BasebandCn0DbHz"),
+            .fullInterSignalBiasNanos = columnId("FullInterSignalBiasNanos"),
+            .fullInterSignalBiasUncertaintyNanos =
+                    columnId("FullInterSignalBiasUncertaintyNanos"),
+            .satelliteInterSignalBiasNanos = columnId("SatelliteInterSignalBiasNanos"),
+            .satelliteInterSignalBiasUncertaintyNanos =
+                    columnId("SatelliteInterSignalBiasUncertaintyNanos"),
+            .codeType = columnId("CodeType"),
+            .chipsetElapsedRealtimeNanos = columnId("ChipsetElapsedRealtimeNanos"),
+            // Initializers are evaluated in order, all columnId() calls above are done.
+            .maxColumnId = maxColumnId,
+    };
+
+    cachedHeader = header;
+    cachedLayout = layout;
+    return layout;
+}
+
 int GnssRawMeasurementParser::getClockFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
-        const std::unordered_map<std::string, int>& columnNameIdMapping) {
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const ColumnLayout& columnLayout) {
     int clockFlags = 0;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("LeapSecond")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.leapSecond].empty()) {
         clockFlags |= GnssClock::HAS_LEAP_SECOND;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullBiasNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.fullBiasNanos].empty()) {
         clockFlags |= GnssClock::HAS_FULL_BIAS;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("BiasNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.biasNanos].empty()) {
         clockFlags |= GnssClock::HAS_BIAS;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("BiasUncertaintyNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.biasUncertaintyNanos].empty()) {
         clockFlags |= GnssClock::HAS_BIAS_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.driftNanosPerSecond].empty()) {
         clockFlags |= GnssClock::HAS_DRIFT;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("DriftUncertaintyNanosPerSecond")]
-                 .empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.driftUncertaintyNanosPerSecond].empty()) {
         clockFlags |= GnssClock::HAS_DRIFT_UNCERTAINTY;
     }
     return clockFlags;
 }
 
 int GnssRawMeasurementParser::getElapsedRealtimeFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
-        const std::unordered_map<std::string, int>& columnNameIdMapping) {
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const ColumnLayout& columnLayout) {
     int elapsedRealtimeFlags = ElapsedRealtime::HAS_TIMESTAMP_NS;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("TimeUncertaintyNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.timeUncertaintyNanos].empty()) {
         elapsedRealtimeFlags |= ElapsedRealtime::HAS_TIME_UNCERTAINTY_NS;
     }
     return elapsedRealtimeFlags;
 }
 
 int GnssRawMeasurementParser::getRawMeasurementFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
-        const std::unordered_map<std::string, int>& columnNameIdMapping) {
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const ColumnLayout& columnLayout) {
     int rawMeasurementFlags = 0;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("SnrInDb")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.snrInDb].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SNR;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierFrequencyHz")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.carrierFrequencyHz].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_FREQUENCY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierCycles")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.carrierCycles].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_CYCLES;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierPhase")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.carrierPhase].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_PHASE;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierPhaseUncertainty")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.carrierPhaseUncertainty].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_PHASE_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("AgcDb")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.agcDb].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_AUTOMATIC_GAIN_CONTROL;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullInterSignalBiasNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.fullInterSignalBiasNanos].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_FULL_ISB;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullInterSignalBiasUncertaintyNanos")]
-                 .empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.fullInterSignalBiasUncertaintyNanos].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_FULL_ISB_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("SatelliteInterSignalBiasNanos")]
-                 .empty()) {
+    if (!rawMeasurementRecordValues[columnLayout.satelliteInterSignalBiasNanos].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SATELLITE_ISB;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at(
-                                            "SatelliteInterSignalBiasUncertaintyNanos")]
+    if (!rawMeasurementRecordValues[columnLayout.satelliteInterSignalBiasUncertaintyNanos]
                  .empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SATELLITE_ISB_UNCERTAINTY;
     }
@@ -165,7 +295,7 @@ GnssConstellationType GnssRawMeasurementParser::getGnssConstellationType(int con
 }
 
 std::unique_ptr<GnssData> GnssRawMeasurementParser::getMeasurementFromStrs(
-        std::string& rawMeasurementStr) {
+        std::string_view rawMeasurementStr) {
     /*
      * Raw,utcTimeMillis,TimeNanos,LeapSecond,TimeUncertaintyNanos,FullBiasNanos,BiasNanos,
      * BiasUncertaintyNanos,DriftNanosPerSecond,DriftUncertaintyNanosPerSecond,
@@ -182,121 +312,93 @@ std::unique_ptr<GnssData> GnssRawMeasurementParser::getMeasurementFromStrs(
     if (rawMeasurementStr.empty()) {
         return nullptr;
     }
-    std::vector<std::string> rawMeasurementStrRecords;
-    ParseUtils::splitStr(rawMeasurementStr, LINE_SEPARATOR, rawMeasurementStrRecords);
-    if (rawMeasurementStrRecords.size() <= 1) {
+    size_t pos = 0;
+    std::optional<std::string_view> header = nextLine(rawMeasurementStr, &pos);
+    std::optional<std::string_view> line = nextLine(rawMeasurementStr, &pos);
+    if (!header.has_value() || !line.has_value()) {
         ALOGE("Raw GNSS Measurements parser failed. (No records) ");
         return nullptr;
     }
 
-    // Get the column name mapping from the header.
-    std::unordered_map<std::string, int> columnNameIdMapping =
-            getColumnIdNameMappingFromHeader(rawMeasurementStrRecords[0]);
-
-    if (columnNameIdMapping.size() < 37 || !ParseUtils::isValidHeader(columnNameIdMapping)) {
+    // Get the column layout from the header.
+    std::optional<ColumnLayout> columnLayout = getColumnLayoutFromHeader(*header);
+    if (!columnLayout.has_value()) {
         ALOGE("Raw GNSS Measurements parser failed. (No header or missing columns.) ");
         return nullptr;
     }
+    const ColumnLayout& layout = *columnLayout;
 
     // Set GnssClock from 1st record.
-    std::size_t pointer = 1;
-    std::vector<std::string> firstRecordValues;
-    ParseUtils::splitStr(rawMeasurementStrRecords[pointer], COMMA_SEPARATOR, firstRecordValues);
+    std::vector<std::string_view> values;
+    splitFields(*line, values);
+    if (values.size() <= layout.maxColumnId) {
+        ALOGE("Raw GNSS Measurements parser failed. (Truncated record) ");
+        return nullptr;
+    }
     GnssClock clock = {
-            .gnssClockFlags = getClockFlags(firstRecordValues, columnNameIdMapping),
-            .timeNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("TimeNanos")], 0),
-            .fullBiasNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("FullBiasNanos")], 0),
-            .biasNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("BiasNanos")], 0),
-            .biasUncertaintyNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("BiasUncertaintyNanos")], 0),
-            .driftNsps = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")], 0),
-            .driftUncertaintyNsps = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")], 0),
-            .hwClockDiscontinuityCount = ParseUtils::tryParseInt(
-                    firstRecordValues[columnNameIdMapping.at("HardwareClockDiscontinuityCount")],
-                    0)};
+            .gnssClockFlags = getClockFlags(values, layout),
+            .timeNs = parseInteger<int64_t>(values[layout.timeNanos]),
+            .fullBiasNs = parseInteger<int64_t>(values[layout.fullBiasNanos]),
+            .biasNs = parseDouble(values[layout.biasNanos]),
+            .biasUncertaintyNs = parseDouble(values[layout.biasUncertaintyNanos]),
+            .driftNsps = parseDouble(values[layout.driftNanosPerSecond]),
+            .driftUncertaintyNsps = parseDouble(values[layout.driftNanosPerSecond]),
+            .hwClockDiscontinuityCount =
+                    parseInteger<int32_t>(values[layout.hardwareClockDiscontinuityCount])};
 
     ElapsedRealtime timestamp = {
-            .flags = getElapsedRealtimeFlags(firstRecordValues, columnNameIdMapping),
-            .timestampNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("ChipsetElapsedRealtimeNanos")]),
-            .timeUncertaintyNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("TimeUncertaintyNanos")], 0)};
+            .flags = getElapsedRealtimeFlags(values, layout),
+            .timestampNs = parseInteger<int64_t>(values[layout.chipsetElapsedRealtimeNanos]),
+            .timeUncertaintyNs = parseDouble(values[layout.timeUncertaintyNanos])};
 
     std::vector<GnssMeasurement> measurementsVec;
-    for (pointer = 1; pointer < rawMeasurementStrRecords.size(); pointer++) {
-        std::vector<std::string> rawMeasurementValues;
-        std::string line = rawMeasurementStrRecords[pointer];
-        ParseUtils::splitStr(line, COMMA_SEPARATOR, rawMeasurementValues);
+    do {
+        splitFields(*line, values);
+        if (values.size() <= layout.maxColumnId) {
+            ALOGE("Raw GNSS Measurements parser skipped a truncated record.");
+            continue;
+        }
         GnssSignalType signalType = {
-                .constellation = getGnssConstellationType(ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("ConstellationType")], 0)),
-                .carrierFrequencyHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("CarrierFrequencyHz")], 0),
-                .codeType = rawMeasurementValues[columnNameIdMapping.at("CodeType")],
+                .constellation = getGnssConstellationType(
+                        parseInteger<int32_t>(values[layout.constellationType])),
+                .carrierFrequencyHz = parseDouble(values[layout.carrierFrequencyHz]),
+                .codeType = std::string(values[layout.codeType]),
         };
-        GnssMeasurement measurement = {
-                .flags = getRawMeasurementFlags(rawMeasurementValues, columnNameIdMapping),
-                .svid = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("Svid")], 0),
-                .signalType = signalType,
-                .receivedSvTimeInNs = ParseUtils::tryParseLongLong(
-                        rawMeasurementValues[columnNameIdMapping.at("ReceivedSvTimeNanos")], 0),
+        measurementsVec.push_back({
+                .flags = getRawMeasurementFlags(values, layout),
+                .svid = parseInteger<int32_t>(values[layout.svid]),
+                .signalType = std::move(signalType),
+                .receivedSvTimeInNs = parseInteger<int64_t>(values[layout.receivedSvTimeNanos]),
                 .receivedSvTimeUncertaintyInNs =
-                        ParseUtils::tryParseLongLong(rawMeasurementValues[columnNameIdMapping.at(
-                                                             "ReceivedSvTimeUncertaintyNanos")],
-                                                     0),
-                .antennaCN0DbHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("Cn0DbHz")], 0),
-                .basebandCN0DbHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("BasebandCn0DbHz")], 0),
-                .agcLevelDb = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("AgcDb")], 0),
-                .pseudorangeRateMps =
-                        ParseUtils::tryParseDouble(rawMeasurementValues[columnNameIdMapping.at(
-                                                           "PseudorangeRateMetersPerSecond")],
-                                                   0),
-                .pseudorangeRateUncertaintyMps = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "PseudorangeRateUncertaintyMetersPerSecond")],
-                        0),
-                .accumulatedDeltaRangeState = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("AccumulatedDeltaRangeState")],
-                        0),
-                .accumulatedDeltaRangeM = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("AccumulatedDeltaRangeMeters")],
-                        0),
-                .accumulatedDeltaRangeUncertaintyM = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "AccumulatedDeltaRangeUncertaintyMeters")],
-                        0),
+                        parseInteger<int64_t>(values[layout.receivedSvTimeUncertaintyNanos]),
+                .antennaCN0DbHz = parseDouble(values[layout.cn0DbHz]),
+                .basebandCN0DbHz = parseDouble(values[layout.basebandCn0DbHz]),
+                .agcLevelDb = parseDouble(values[layout.agcDb]),
+                .pseudorangeRateMps = parseDouble(values[layout.pseudorangeRateMetersPerSecond]),
+                .pseudorangeRateUncertaintyMps =
+                        parseDouble(values[layout.pseudorangeRateUncertaintyMetersPerSecond]),
+                .accumulatedDeltaRangeState =
+                        parseInteger<int32_t>(values[layout.accumulatedDeltaRangeState]),
+                .accumulatedDeltaRangeM = parseDouble(values[layout.accumulatedDeltaRangeMeters]),
+                .accumulatedDeltaRangeUncertaintyM =
+                        parseDouble(values[layout.accumulatedDeltaRangeUncertaintyMeters]),
                 .multipathIndicator = GnssMultipathIndicator::UNKNOWN,  // Not in GnssLogger yet.
-                .state = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("State")], 0),
-                .fullInterSignalBiasNs = ParseUtils::tryParseDouble(rawMeasurementValues[31], 0),
-                .fullInterSignalBiasUncertaintyNs = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("FullInterSignalBiasNanos")],
-                        0),
+                .state = parseInteger<int32_t>(values[layout.state]),
+                .fullInterSignalBiasNs = parseDouble(values[layout.fullInterSignalBiasNanos]),
+                .fullInterSignalBiasUncertaintyNs =
+                        parseDouble(values[layout.fullInterSignalBiasNanos]),
                 .satelliteInterSignalBiasNs =
-                        ParseUtils::tryParseDouble(rawMeasurementValues[columnNameIdMapping.at(
-                                                           "SatelliteInterSignalBiasNanos")],
-                                                   0),
-                .satelliteInterSignalBiasUncertaintyNs = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "SatelliteInterSignalBiasUncertaintyNanos")],
-                        0),
+                        parseDouble(values[layout.satelliteInterSignalBiasNanos]),
+                .satelliteInterSignalBiasUncertaintyNs =
+                        parseDouble(values[layout.satelliteInterSignalBiasUncertaintyNanos]),
                 .satellitePvt = {},
-                .correlationVectors = {}};
-        measurementsVec.push_back(measurement);
-    }
+                .correlationVectors = {}});
+    } while ((line = nextLine(rawMeasurementStr, &pos)).has_value());
 
-    GnssData gnssData = {
-            .measurements = measurementsVec, .clock = clock, .elapsedRealtime = timestamp};
-    return std::make_unique<GnssData>(gnssData);
+    GnssData gnssData = {.measurements = std::move(measurementsVec),
+                         .clock = clock,
+                         .elapsedRealtime = timestamp};
+    return std::make_unique<GnssData>(std::move(gnssData));
 }
 
 }  // namespace common
@@ -24,10 +24,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <utils/SystemClock.h>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
-#include <sstream>
 #include <string>
-#include <vector>
 
 namespace android {
 namespace hardware {
@@ -37,17 +40,63 @@ namespace common {
 using aidl::android::hardware::gnss::ElapsedRealtime;
 using aidl::android::hardware::gnss::GnssLocation;
 
-NmeaFixInfo::NmeaFixInfo() : hasGMCRecord(false), hasGGARecord(false) {}
+namespace {
 
-float NmeaFixInfo::getAltitudeMeters() const {
-    return altitudeMeters;
+// GGA, the longest sentence parsed, has 15 fields. Any fields past these are ignored.
+constexpr size_t kMaxSentenceFields = 20;
+// Longest numeric field worth parsing, NMEA fields are at most a dozen characters.
+constexpr size_t kMaxNumberLength = 31;
+
+// std::from_chars has no floating point support in our libc++, strtof needs a terminated copy.
+float parseFloat(std::string_view s) {
+    if (s.empty() || s.size() > kMaxNumberLength) {
+        return std::numeric_limits<float>::quiet_NaN();
+    }
+    char buffer[kMaxNumberLength + 1];
+    memcpy(buffer, s.data(), s.size());
+    buffer[s.size()] = '\0';
+    char* end;
+    float value = strtof(buffer, &end);
+    return end == buffer + s.size() ? value : std::numeric_limits<float>::quiet_NaN();
 }
 
-float NmeaFixInfo::checkAndConvertToFloat(const std::string& sentence) {
-    if (sentence.empty()) {
+// Parses a field holding degrees followed by decimal minutes, e.g. 3725.371240 for 37°25.37'.
+float parseDegreesMinutes(std::string_view s, size_t degreeDigits) {
+    if (s.size() <= degreeDigits) {
         return std::numeric_limits<float>::quiet_NaN();
     }
-    return std::stof(sentence);
+    return parseFloat(s.substr(0, degreeDigits)) + parseFloat(s.substr(degreeDigits)) / 60.0;
+}
+
+// Parses two decimal digits at pos of s, returns -1 if there are none.
+int parseTwoDigits(std::string_view s, size_t pos) {
+    int value;
+    if (s.size() < pos + 2) {
+        return -1;
+    }
+    auto [end, ec] = std::from_chars(s.data() + pos, s.data() + pos + 2, value);
+    return ec == std::errc() && end == s.data() + pos + 2 ? value : -1;
+}
+
+int hexDigitValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+}  // namespace
+
+struct NmeaFixInfo::Sentence {
+    // fields[0] is the tag, e.g. "$GPGGA"
+    std::array<std::string_view, kMaxSentenceFields> fields;
+    size_t size = 0;
+};
+
+NmeaFixInfo::NmeaFixInfo() : hasGMCRecord(false), hasGGARecord(false) {}
+
+float NmeaFixInfo::getAltitudeMeters() const {
+    return altitudeMeters;
 }
 
 float NmeaFixInfo::getBearingAccuracyDegrees() const {
@@ -89,7 +138,7 @@ float NmeaFixInfo::getVerticalAccuracyMeters() const {
     return kMockVerticalAccuracyMeters;
 }
 
-int64_t NmeaFixInfo::nmeaPartsToTimestamp(const std::string& timeStr, const std::string& dateStr) {
+int64_t NmeaFixInfo::nmeaPartsToTimestamp(std::string_view timeStr, std::string_view dateStr) {
     /**
      * In NMEA format, the full time can only get from the $GPRMC record, see
      * the following example:
@@ -98,14 +147,18 @@ int64_t NmeaFixInfo::nmeaPartsToTimestamp(const std::string& timeStr, const std:
      * 2019/08/29 21:32:04, however for in unix the year starts from 1900, we
      * need to add the offset.
      */
-    struct tm tm;
+    struct tm tm = {};
     const int32_t unixYearOffset = 100;
-    tm.tm_mday = std::stoi(dateStr.substr(0, 2).c_str());
-    tm.tm_mon = std::stoi(dateStr.substr(2, 2).c_str()) - 1;
-    tm.tm_year = std::stoi(dateStr.substr(4, 2).c_str()) + unixYearOffset;
-    tm.tm_hour = std::stoi(timeStr.substr(0, 2).c_str());
-    tm.tm_min = std::stoi(timeStr.substr(2, 2).c_str());
-    tm.tm_sec = std::stoi(timeStr.substr(4, 2).c_str());
+    tm.tm_mday = parseTwoDigits(dateStr, 0);
+    tm.tm_mon = parseTwoDigits(dateStr, 2) - 1;
+    tm.tm_year = parseTwoDigits(dateStr, 4) + unixYearOffset;
+    tm.tm_hour = parseTwoDigits(timeStr, 0);
+    tm.tm_min = parseTwoDigits(timeStr, 2);
+    tm.tm_sec = parseTwoDigits(timeStr, 4);
+    if (tm.tm_mday < 0 || tm.tm_mon < 0 || tm.tm_year < unixYearOffset || tm.tm_hour < 0 ||
+        tm.tm_min < 0 || tm.tm_sec < 0) {
+        return -1;
+    }
     return static_cast<int64_t>(mktime(&tm) - timezone);
 }
 
@@ -113,38 +166,32 @@ bool NmeaFixInfo::isValidFix() const {
     return hasGMCRecord && hasGGARecord;
 }
 
-void NmeaFixInfo::parseGGALine(const std::vector<std::string>& sentenceValues) {
-    if (sentenceValues.size() == 0 || sentenceValues[0].compare(GPGA_RECORD_TAG) != 0) {
-        return;
-    }
+void NmeaFixInfo::parseGGALine(const Sentence& sentence) {
+    const auto& values = sentence.fields;
     // LatDeg, need covert to degree, if it is 'N', should be negative value
-    this->latDeg = std::stof(sentenceValues[2].substr(0, 2)) +
-                   (std::stof(sentenceValues[2].substr(2)) / 60.0);
-    if (sentenceValues[3].compare("N") != 0) {
-        this->latDeg *= -1;
-    }
-
+    const float latDeg = parseDegreesMinutes(values[2], 2);
     // LngDeg, need covert to degree, if it is 'E', should be negative value
-    this->lngDeg = std::stof(sentenceValues[4].substr(0, 3)) +
-                   std::stof(sentenceValues[4].substr(3)) / 60.0;
-    if (sentenceValues[5].compare("E") != 0) {
-        this->lngDeg *= -1;
+    const float lngDeg = parseDegreesMinutes(values[4], 3);
+    const float altitudeMeters = parseFloat(values[9]);
+    if (std::isnan(latDeg) || std::isnan(lngDeg) || std::isnan(altitudeMeters)) {
+        return;
     }
-
-    this->altitudeMeters = std::stof(sentenceValues[9]);
-
-    this->hDop = sentenceValues[8].empty() ? std::numeric_limits<float>::quiet_NaN()
-                                           : std::stof(sentenceValues[8]);
+    this->latDeg = values[3] == "N" ? latDeg : -latDeg;
+    this->lngDeg = values[5] == "E" ? lngDeg : -lngDeg;
+    this->altitudeMeters = altitudeMeters;
+    this->hDop = parseFloat(values[8]);
     this->hasGGARecord = true;
 }
 
-void NmeaFixInfo::parseRMCLine(const std::vector<std::string>& sentenceValues) {
-    if (sentenceValues.size() == 0 || sentenceValues[0].compare(GPRMC_RECORD_TAG) != 0) {
+void NmeaFixInfo::parseRMCLine(const Sentence& sentence) {
+    const auto& values = sentence.fields;
+    const int64_t timestamp = nmeaPartsToTimestamp(values[1], values[9]);
+    if (timestamp < 0) {
         return;
     }
-    this->speedMetersPerSec = checkAndConvertToFloat(sentenceValues[7]);
-    this->bearingDegrees = checkAndConvertToFloat(sentenceValues[8]);
-    this->timestamp = nmeaPartsToTimestamp(sentenceValues[1], sentenceValues[9]);
+    this->speedMetersPerSec = parseFloat(values[7]);
+    this->bearingDegrees = parseFloat(values[8]);
+    this->timestamp = timestamp;
     this->hasGMCRecord = true;
 }
 
@@ -164,13 +211,42 @@ void NmeaFixInfo::reset() {
     this->timestamp = 0;
 }
 
-void NmeaFixInfo::splitStr(const std::string& line, const char& delimiter,
-                           std::vector<std::string>& out) {
-    std::istringstream iss(line);
-    std::string item;
-    while (std::getline(iss, item, delimiter)) {
-        out.push_back(item);
+bool NmeaFixInfo::parseSentence(std::string_view line, Sentence* sentence) {
+    // $<fields>*<checksum>, the checksum being the XOR of the characters between $ and *
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
     }
+    const size_t checksumPos = line.rfind('*');
+    if (line.empty() || line[0] != '$' || checksumPos == std::string_view::npos ||
+        line.size() != checksumPos + 3) {
+        // Also drops a sentence cut short at the end of the input
+        return false;
+    }
+    const int high = hexDigitValue(line[checksumPos + 1]);
+    const int low = hexDigitValue(line[checksumPos + 2]);
+    uint8_t checksum = 0;
+    for (size_t i = 1; i < checksumPos; i++) {
+        checksum ^= static_cast<uint8_t>(line[i]);
+    }
+    if (high < 0 || low < 0 || checksum != ((high << 4) | low)) {
+        ALOGW("Dropped NMEA sentence with a bad checksum: %.*s", static_cast<int>(line.size()),
+              line.data());
+        return false;
+    }
+
+    // Unlike std::getline, a trailing empty field is kept
+    const std::string_view body = line.substr(0, checksumPos);
+    sentence->size = 0;
+    size_t start = 0;
+    while (sentence->size < sentence->fields.size()) {
+        const size_t end = body.find(COMMA_SEPARATOR, start);
+        sentence->fields[sentence->size++] = body.substr(start, end - start);
+        if (end == std::string_view::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return sentence->size >= static_cast<size_t>(MIN_COL_NUM);
 }
 
 NmeaFixInfo& NmeaFixInfo::operator=(const NmeaFixInfo& rhs) {
@@ -198,23 +274,27 @@ NmeaFixInfo& NmeaFixInfo::operator=(const NmeaFixInfo& rhs) {
  */
 std::unique_ptr<V2_0::GnssLocation> NmeaFixInfo::getLocationFromInputStr(
         const std::string& inputStr) {
-    std::vector<std::string> nmeaRecords;
-    splitStr(inputStr, LINE_SEPARATOR, nmeaRecords);
+    const std::string_view input = inputStr;
     NmeaFixInfo nmeaFixInfo;
     NmeaFixInfo candidateFixInfo;
+    Sentence sentence;
     uint32_t fixId = 0;
     double lastTimeStamp = 0;
-    for (const auto& line : nmeaRecords) {
-        if (line.compare(0, strlen(GPGA_RECORD_TAG), GPGA_RECORD_TAG) != 0 &&
-            line.compare(0, strlen(GPRMC_RECORD_TAG), GPRMC_RECORD_TAG) != 0) {
-            continue;
+    for (size_t pos = 0; pos < input.size();) {
+        size_t end = input.find(LINE_SEPARATOR, pos);
+        if (end == std::string_view::npos) {
+            end = input.size();
         }
-        std::vector<std::string> sentenceValues;
-        splitStr(line, COMMA_SEPARATOR, sentenceValues);
-        if (sentenceValues.size() < MIN_COL_NUM) {
+        const std::string_view line = input.substr(pos, end - pos);
+        pos = end + 1;
+
+        // Sentences of other types are skipped before verifying their checksum
+        const bool isGGA = line.substr(0, strlen(GPGA_RECORD_TAG)) == GPGA_RECORD_TAG;
+        const bool isRMC = line.substr(0, strlen(GPRMC_RECORD_TAG)) == GPRMC_RECORD_TAG;
+        if ((!isGGA && !isRMC) || !parseSentence(line, &sentence)) {
             continue;
         }
-        double currentTimeStamp = std::stof(sentenceValues[1]);
+        double currentTimeStamp = parseFloat(sentence.fields[1]);
         // If see a new timestamp, report correct location.
         if ((currentTimeStamp - lastTimeStamp) > TIMESTAMP_EPSILON &&
             candidateFixInfo.isValidFix()) {
@@ -222,11 +302,11 @@ std::unique_ptr<V2_0::GnssLocation> NmeaFixInfo::getLocationFromInputStr(
             candidateFixInfo.reset();
             fixId++;
         }
-        if (line.compare(0, strlen(GPGA_RECORD_TAG), GPGA_RECORD_TAG) == 0) {
+        if (isGGA) {
             candidateFixInfo.fixId = fixId;
-            candidateFixInfo.parseGGALine(sentenceValues);
-        } else if (line.compare(0, strlen(GPRMC_RECORD_TAG), GPRMC_RECORD_TAG) == 0) {
-            candidateFixInfo.parseRMCLine(sentenceValues);
+            candidateFixInfo.parseGGALine(sentence);
+        } else {
+            candidateFixInfo.parseRMCLine(sentence);
         }
     }
     if (candidateFixInfo.isValidFix()) {
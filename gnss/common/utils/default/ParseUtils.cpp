@@ -15,7 +15,6 @@
  */
 
 #include <ParseUtils.h>
-#include <sstream>
 #include <stdexcept>
 
 namespace android {
@@ -63,12 +62,17 @@ long long ParseUtils::tryParseLongLong(const std::string& s, long long defaultVa
     }
 }
 
-void ParseUtils::splitStr(const std::string& line, const char& delimiter,
+void ParseUtils::splitStr(std::string_view line, const char& delimiter,
                           std::vector<std::string>& out) {
-    std::istringstream iss(line);
-    std::string item;
-    while (std::getline(iss, item, delimiter)) {
-        out.push_back(item);
+    // Same items as std::getline would produce: a trailing delimiter does not add an empty item.
+    size_t start = 0;
+    while (start < line.size()) {
+        size_t end = line.find(delimiter, start);
+        if (end == std::string_view::npos) {
+            end = line.size();
+        }
+        out.emplace_back(line.substr(start, end - start));
+        start = end + 1;
     }
 }
 
@@ -41,8 +41,24 @@ class DeviceFileReader {
   private:
     DeviceFileReader();
     ~DeviceFileReader();
+
+    // A device file and the epoll instance waiting on it, kept open across requests.
+    struct DeviceFile {
+        int gnss_fd;
+        int epoll_fd;
+    };
+
+    // Returns the opened device file, opening it on first use. Returns nullptr on failure.
+    const DeviceFile* getDeviceFile(const std::string& deviceFilePath);
+    void closeDeviceFile(const std::string& deviceFilePath);
+    // Moves the oldest complete frame out of s_buffer_, returns false if there is none yet.
+    bool takeFrame(std::string* frame);
+
     std::unordered_map<std::string, std::string> data_;
     std::string s_buffer_;
+    // Bytes at the start of s_buffer_ known not to hold the start of an end of frame mark.
+    size_t scanned_size_ = 0;
+    std::unordered_map<std::string, DeviceFile> device_files_;
     std::mutex mMutex;
 };
 }  // namespace common
@@ -21,6 +21,7 @@
 
 #include <utils/SystemClock.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <Constants.h>
@@ -37,7 +38,7 @@ namespace common {
 struct FixLocationParser {
   public:
     static std::unique_ptr<aidl::android::hardware::gnss::GnssLocation> getLocationFromInputStr(
-            const std::string& inputStr);
+            std::string_view inputStr);
 };
 
 }  // namespace common
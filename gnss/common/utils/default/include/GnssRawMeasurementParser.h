@@ -20,8 +20,11 @@
 #include <aidl/android/hardware/gnss/BnGnss.h>
 #include <log/log.h>
 #include <utils/SystemClock.h>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include "Constants.h"
 #include "ParseUtils.h"
@@ -32,18 +35,60 @@ namespace gnss {
 namespace common {
 
 struct GnssRawMeasurementParser {
+    // Indices of the columns read from each record, resolved once per header.
+    struct ColumnLayout {
+        size_t leapSecond;
+        size_t timeNanos;
+        size_t timeUncertaintyNanos;
+        size_t fullBiasNanos;
+        size_t biasNanos;
+        size_t biasUncertaintyNanos;
+        size_t driftNanosPerSecond;
+        size_t driftUncertaintyNanosPerSecond;
+        size_t hardwareClockDiscontinuityCount;
+        size_t svid;
+        size_t state;
+        size_t receivedSvTimeNanos;
+        size_t receivedSvTimeUncertaintyNanos;
+        size_t cn0DbHz;
+        size_t pseudorangeRateMetersPerSecond;
+        size_t pseudorangeRateUncertaintyMetersPerSecond;
+        size_t accumulatedDeltaRangeState;
+        size_t accumulatedDeltaRangeMeters;
+        size_t accumulatedDeltaRangeUncertaintyMeters;
+        size_t carrierFrequencyHz;
+        size_t carrierCycles;
+        size_t carrierPhase;
+        size_t carrierPhaseUncertainty;
+        size_t snrInDb;
+        size_t constellationType;
+        size_t agcDb;
+        size_t basebandCn0DbHz;
+        size_t fullInterSignalBiasNanos;
+        size_t fullInterSignalBiasUncertaintyNanos;
+        size_t satelliteInterSignalBiasNanos;
+        size_t satelliteInterSignalBiasUncertaintyNanos;
+        size_t codeType;
+        size_t chipsetElapsedRealtimeNanos;
+        // A record must have more fields than this to be parsed.
+        size_t maxColumnId;
+    };
+
     static std::unique_ptr<aidl::android::hardware::gnss::GnssData> getMeasurementFromStrs(
-            std::string& rawMeasurementStr);
-    static int getClockFlags(const std::vector<std::string>& rawMeasurementRecordValues,
-                             const std::unordered_map<std::string, int>& columnNameIdMapping);
+            std::string_view rawMeasurementStr);
+    static int getClockFlags(const std::vector<std::string_view>& rawMeasurementRecordValues,
+                             const ColumnLayout& columnLayout);
     static int getElapsedRealtimeFlags(
-            const std::vector<std::string>& rawMeasurementRecordValues,
-            const std::unordered_map<std::string, int>& columnNameIdMapping);
+            const std::vector<std::string_view>& rawMeasurementRecordValues,
+            const ColumnLayout& columnLayout);
     static int getRawMeasurementFlags(
-            const std::vector<std::string>& rawMeasurementRecordValues,
-            const std::unordered_map<std::string, int>& columnNameIdMapping);
+            const std::vector<std::string_view>& rawMeasurementRecordValues,
+            const ColumnLayout& columnLayout);
     static std::unordered_map<std::string, int> getColumnIdNameMappingFromHeader(
             const std::string& header);
+    // Returns the layout of the header, or std::nullopt if required columns are missing. The
+    // layout of the last header seen is cached, as every measurement from a log repeats it.
+    static std::optional<ColumnLayout> getColumnLayoutFromHeader(std::string_view header);
     static aidl::android::hardware::gnss::GnssConstellationType getGnssConstellationType(
             int constellationType);
 };
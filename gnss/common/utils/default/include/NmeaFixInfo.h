@@ -22,6 +22,7 @@
 #include <hidl/Status.h>
 #include <ctime>
 #include <string>
+#include <string_view>
 #include "aidl/android/hardware/gnss/IGnss.h"
 namespace android {
 namespace hardware {
@@ -50,14 +51,15 @@ class NmeaFixInfo {
             const std::string& inputStr);
 
   private:
-    static void splitStr(const std::string& line, const char& delimiter,
-                         std::vector<std::string>& out);
-    static float checkAndConvertToFloat(const std::string& sentence);
-    static int64_t nmeaPartsToTimestamp(const std::string& timeStr, const std::string& dateStr);
+    // The fields of a sentence whose checksum matched, viewing into the input.
+    struct Sentence;
+
+    static bool parseSentence(std::string_view line, Sentence* sentence);
+    static int64_t nmeaPartsToTimestamp(std::string_view timeStr, std::string_view dateStr);
 
     NmeaFixInfo();
-    void parseGGALine(const std::vector<std::string>& sentenceValues);
-    void parseRMCLine(const std::vector<std::string>& sentenceValues);
+    void parseGGALine(const Sentence& sentence);
+    void parseRMCLine(const Sentence& sentence);
     std::unique_ptr<V2_0::GnssLocation> toGnssLocation() const;
 
     // Getters
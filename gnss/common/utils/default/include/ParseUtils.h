@@ -19,6 +19,7 @@
 
 #include <log/log.h>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -33,7 +34,7 @@ struct ParseUtils {
     static double tryParseDouble(const std::string& s, double defaultVal = 0.0);
     static long tryParseLong(const std::string& s, long defaultVal = 0);
     static long long tryParseLongLong(const std::string& s, long long defaultVal = 0);
-    static void splitStr(const std::string& line, const char& delimiter,
+    static void splitStr(std::string_view line, const char& delimiter,
                          std::vector<std::string>& out);
     static bool isValidHeader(const std::unordered_map<std::string, int>& columnNameIdMapping);
 };
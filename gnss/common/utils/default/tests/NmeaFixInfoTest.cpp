@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <NmeaFixInfo.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace gnss {
+namespace common {
+namespace {
+
+// 2019/08/29 21:32:04 UTC
+constexpr int64_t kFixTimestamp = 1567114324;
+constexpr double kFixLatDeg = 37 + 25.371240 / 60;
+constexpr double kFixLngDeg = -(122 + 5.589239 / 60);
+constexpr float kFixAltitudeMeters = 5.2;
+constexpr double kDegreesTolerance = 1e-5;
+
+// Appends the checksum of the sentence, the XOR of the characters after the '$'.
+std::string withChecksum(const std::string& body) {
+    uint8_t checksum = 0;
+    for (size_t i = 1; i < body.size(); i++) {
+        checksum ^= static_cast<uint8_t>(body[i]);
+    }
+    char suffix[4];
+    snprintf(suffix, sizeof(suffix), "*%02X", checksum);
+    return body + suffix;
+}
+
+const std::string kGga =
+        withChecksum("$GPGGA,213204.00,3725.371240,N,12205.589239,W,1,07,1.0,5.2,M,-25.0,M,,");
+const std::string kRmc =
+        withChecksum("$GPRMC,213204.00,A,3725.371240,N,12205.589239,W,001.5,090.0,290819,,,A");
+
+void expectFixLocation(const std::unique_ptr<V2_0::GnssLocation>& location) {
+    ASSERT_NE(location, nullptr);
+    EXPECT_NEAR(location->v1_0.latitudeDegrees, kFixLatDeg, kDegreesTolerance);
+    EXPECT_NEAR(location->v1_0.longitudeDegrees, kFixLngDeg, kDegreesTolerance);
+    EXPECT_FLOAT_EQ(location->v1_0.altitudeMeters, kFixAltitudeMeters);
+    EXPECT_FLOAT_EQ(location->v1_0.speedMetersPerSec, 1.5);
+    EXPECT_FLOAT_EQ(location->v1_0.bearingDegrees, 90.0);
+    EXPECT_EQ(location->v1_0.timestamp, kFixTimestamp);
+}
+
+TEST(NmeaFixInfoTest, parsesGgaAndRmcPair) {
+    expectFixLocation(NmeaFixInfo::getLocationFromInputStr(kGga + "\n" + kRmc + "\n"));
+}
+
+TEST(NmeaFixInfoTest, skipsOtherSentences) {
+    const std::string gsv = withChecksum("$GPGSV,1,1,01,05,45,120,40");
+
+    expectFixLocation(
+            NmeaFixInfo::getLocationFromInputStr(gsv + "\n" + kGga + "\n" + gsv + "\n" + kRmc));
+}
+
+TEST(NmeaFixInfoTest, dropsSentenceWithBadChecksum) {
+    std::string badRmc = kRmc;
+    badRmc.back() = badRmc.back() == '0' ? '1' : '0';
+
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr(kGga + "\n" + badRmc + "\n"), nullptr);
+}
+
+TEST(NmeaFixInfoTest, dropsSentenceWithoutChecksum) {
+    const std::string rmcBody = kRmc.substr(0, kRmc.rfind('*'));
+
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr(kGga + "\n" + rmcBody + "\n"), nullptr);
+}
+
+TEST(NmeaFixInfoTest, acceptsTrailingCarriageReturn) {
+    expectFixLocation(NmeaFixInfo::getLocationFromInputStr(kGga + "\r\n" + kRmc + "\r\n"));
+    expectFixLocation(NmeaFixInfo::getLocationFromInputStr(kGga + "\r\n" + kRmc + "\r"));
+}
+
+TEST(NmeaFixInfoTest, dropsSentenceCutShortAtEndOfFrame) {
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr(kGga + "\n" + kRmc.substr(0, 40)), nullptr);
+    // Only the checksum is missing a digit.
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr(kGga + "\n" +
+                                                   kRmc.substr(0, kRmc.size() - 1)),
+              nullptr);
+}
+
+TEST(NmeaFixInfoTest, keepsLastFullFixBeforeCutShortSentence) {
+    const std::string nextGga = withChecksum(
+            "$GPGGA,213205.00,3725.371240,N,12205.589239,W,1,07,1.0,5.2,M,-25.0,M,,");
+
+    expectFixLocation(NmeaFixInfo::getLocationFromInputStr(kGga + "\n" + kRmc + "\n" +
+                                                           nextGga.substr(0, 30)));
+}
+
+TEST(NmeaFixInfoTest, ignoresEmptyNumericFields) {
+    const std::string emptyGga = withChecksum("$GPGGA,,,,,,,,,,,,,,");
+    const std::string emptyRmc = withChecksum("$GPRMC,,,,,,,,,,,,");
+    const std::string noAltitudeGga =
+            withChecksum("$GPGGA,213204.00,3725.371240,N,12205.589239,W,1,07,1.0,,M,-25.0,M,,");
+    const std::string noDateRmc =
+            withChecksum("$GPRMC,213204.00,A,3725.371240,N,12205.589239,W,001.5,090.0,,,,A");
+
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr(emptyGga + "\n" + emptyRmc + "\n"), nullptr);
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr(noAltitudeGga + "\n" + kRmc + "\n"), nullptr);
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr(kGga + "\n" + noDateRmc + "\n"), nullptr);
+}
+
+TEST(NmeaFixInfoTest, returnsNullForEmptyInput) {
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr(""), nullptr);
+    EXPECT_EQ(NmeaFixInfo::getLocationFromInputStr("\n\r\n"), nullptr);
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace gnss
+}  // namespace hardware
+}  // namespace android
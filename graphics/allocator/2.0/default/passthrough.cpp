@@ -14,12 +14,36 @@
  * limitations under the License.
  */
 
+#include <allocator-passthrough/2.0/BufferPoolHal.h>
 #include <allocator-passthrough/2.0/GrallocLoader.h>
+#include <android-base/properties.h>
 #include <android/hardware/graphics/allocator/2.0/IAllocator.h>
 
 using android::hardware::graphics::allocator::V2_0::IAllocator;
+using android::hardware::graphics::allocator::V2_0::passthrough::BufferPoolHal;
 using android::hardware::graphics::allocator::V2_0::passthrough::GrallocLoader;
 
 extern "C" IAllocator* HIDL_FETCH_IAllocator(const char* /* name */) {
-    return GrallocLoader::load();
+    const hw_module_t* module = GrallocLoader::loadModule();
+    if (!module) {
+        return nullptr;
+    }
+    auto hal = GrallocLoader::createHal(module);
+    if (!hal) {
+        return nullptr;
+    }
+
+    // Keeping spare buffers for repeated allocations is opt-in, as it costs memory
+    const uint64_t poolKb =
+            android::base::GetUintProperty<uint64_t>("ro.vendor.gralloc.pool_kb", 0);
+    if (poolKb > 0) {
+        const BufferPoolHal::Options options = {
+                .byteBudget = static_cast<size_t>(poolKb * 1024),
+                .ttl = std::chrono::milliseconds(android::base::GetUintProperty<uint64_t>(
+                        "ro.vendor.gralloc.pool_ttl_ms", 5000)),
+        };
+        hal = std::make_unique<BufferPoolHal>(std::move(hal), options);
+    }
+
+    return GrallocLoader::createAllocator(std::move(hal));
 }
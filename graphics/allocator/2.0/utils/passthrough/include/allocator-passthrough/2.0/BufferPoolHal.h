@@ -0,0 +1,339 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef LOG_TAG
+#warning "BufferPoolHal.h included without LOG_TAG"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <allocator-hal/2.0/AllocatorHal.h>
+#include <log/log.h>
+#include <mapper-passthrough/2.0/GrallocBufferDescriptor.h>
+
+namespace android {
+namespace hardware {
+namespace graphics {
+namespace allocator {
+namespace V2_0 {
+namespace passthrough {
+
+namespace detail {
+
+using common::V1_0::PixelFormat;
+using mapper::V2_0::BufferDescriptor;
+using mapper::V2_0::Error;
+using mapper::V2_0::passthrough::grallocDecodeBufferDescriptor;
+
+// BufferPoolHalImpl wraps another V2_*::hal::AllocatorHal and keeps spare buffers for the
+// descriptors that are allocated repeatedly, so that allocating them again does not wait for the
+// vendor allocator.
+//
+// Buffers handed out to a client are owned by the client from then on and are never seen by the
+// allocator again, so they cannot be recycled. Instead, once a descriptor has been allocated
+// twice within the TTL, the pool allocates as many spare buffers as the last request asked for
+// in the background, within the byte budget. Spares unused for the TTL are freed, and all of them
+// are freed when the wrapped HAL runs out of resources.
+template <typename Hal>
+class BufferPoolHalImpl : public Hal {
+   public:
+    struct Options {
+        // Upper bound of the estimated size of all spare buffers
+        size_t byteBudget;
+        // How long spare buffers are kept without a request for their descriptor
+        std::chrono::milliseconds ttl;
+    };
+
+    BufferPoolHalImpl(std::unique_ptr<Hal> hal, const Options& options)
+        : mHal(std::move(hal)), mOptions(options), mThread([this] { threadLoop(); }) {}
+
+    ~BufferPoolHalImpl() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        mThread.join();
+        trim();
+    }
+
+    std::string dumpDebugInfo() override {
+        std::ostringstream os;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            os << "buffer pool: " << mEntries.size() << " descriptors, " << mPooledBytes << "/"
+               << mOptions.byteBudget << " bytes, " << mHits << " hits, " << mMisses
+               << " misses, " << mTrims << " trims\n";
+        }
+        return mHal->dumpDebugInfo() + os.str();
+    }
+
+    Error allocateBuffers(const BufferDescriptor& descriptor, uint32_t count, uint32_t* outStride,
+                          std::vector<const native_handle_t*>* outBuffers) override {
+        if (takeSpareBuffers(descriptor, count, outStride, outBuffers)) {
+            return Error::NONE;
+        }
+
+        Error error = mHal->allocateBuffers(descriptor, count, outStride, outBuffers);
+        if (error == Error::NO_RESOURCES && trim()) {
+            error = mHal->allocateBuffers(descriptor, count, outStride, outBuffers);
+        }
+        return error;
+    }
+
+    void freeBuffers(const std::vector<const native_handle_t*>& buffers) override {
+        mHal->freeBuffers(buffers);
+    }
+
+   private:
+    struct Entry {
+        std::chrono::steady_clock::time_point lastRequest;
+        // The number of buffers of the last request, kept ready once the descriptor repeats
+        uint32_t wanted = 0;
+        uint32_t stride = 0;
+        size_t bufferBytes = 0;
+        std::vector<const native_handle_t*> buffers;
+    };
+
+    // Frees all spare buffers, and stops refilling them until their descriptor is requested
+    // again. Returns whether there were any.
+    bool trim() {
+        std::vector<const native_handle_t*> buffers;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto& entry : mEntries) {
+                releaseSpareBuffersLocked(&entry.second, &buffers);
+                entry.second.wanted = 0;
+            }
+            if (!buffers.empty()) {
+                mTrims++;
+            }
+        }
+
+        if (buffers.empty()) {
+            return false;
+        }
+        ALOGD("trimmed %zu spare buffers", buffers.size());
+        mHal->freeBuffers(buffers);
+        return true;
+    }
+
+    static uint32_t getBitsPerPixel(PixelFormat format) {
+        switch (format) {
+            case PixelFormat::RGBA_FP16:
+                return 64;
+            case PixelFormat::RGB_888:
+                return 24;
+            case PixelFormat::RGB_565:
+            case PixelFormat::YCBCR_422_SP:
+            case PixelFormat::YCBCR_422_I:
+            case PixelFormat::RAW16:
+            case PixelFormat::Y16:
+                return 16;
+            case PixelFormat::YCRCB_420_SP:
+            case PixelFormat::YCBCR_420_888:
+            case PixelFormat::YV12:
+            case PixelFormat::RAW12:
+                return 12;
+            case PixelFormat::RAW10:
+                return 10;
+            case PixelFormat::BLOB:
+            case PixelFormat::Y8:
+                return 8;
+            default:
+                // The layout of the remaining formats is up to the vendor; assume 32 bpp
+                return 32;
+        }
+    }
+
+    // Estimates the size of a buffer, since the allocator HAL does not report it
+    static size_t estimateBufferBytes(const BufferDescriptor& descriptor, uint32_t stride) {
+        mapper::V2_0::IMapper::BufferDescriptorInfo info;
+        if (!grallocDecodeBufferDescriptor(descriptor, &info)) {
+            return 0;
+        }
+        const uint64_t pixels = static_cast<uint64_t>(std::max(stride, info.width)) * info.height *
+                                std::max(info.layerCount, 1u);
+        return pixels * getBitsPerPixel(info.format) / 8;
+    }
+
+    bool takeSpareBuffers(const BufferDescriptor& descriptor, uint32_t count, uint32_t* outStride,
+                          std::vector<const native_handle_t*>* outBuffers) {
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const std::vector<uint32_t> key = descriptor;
+        auto it = mEntries.find(key);
+        if (it == mEntries.end()) {
+            Entry entry;
+            entry.lastRequest = now;
+            mEntries.emplace(key, std::move(entry));
+            mMisses++;
+            return false;
+        }
+
+        Entry& entry = it->second;
+        entry.lastRequest = now;
+        entry.wanted = count;
+        mCondition.notify_one();
+
+        if (count == 0 || entry.buffers.size() < count) {
+            mMisses++;
+            return false;
+        }
+
+        outBuffers->assign(entry.buffers.end() - count, entry.buffers.end());
+        entry.buffers.resize(entry.buffers.size() - count);
+        mPooledBytes -= entry.bufferBytes * count;
+        *outStride = entry.stride;
+        mHits++;
+        return true;
+    }
+
+    void releaseSpareBuffersLocked(Entry* entry, std::vector<const native_handle_t*>* outBuffers) {
+        outBuffers->insert(outBuffers->end(), entry->buffers.begin(), entry->buffers.end());
+        mPooledBytes -= entry->bufferBytes * entry->buffers.size();
+        entry->buffers.clear();
+    }
+
+    // Frees the spare buffers of descriptors not requested within the TTL and returns a
+    // descriptor that needs more spare buffers and how many, if any.
+    bool updateEntriesLocked(BufferDescriptor* outDescriptor, uint32_t* outCount,
+                             std::vector<const native_handle_t*>* outExpiredBuffers) {
+        const auto now = std::chrono::steady_clock::now();
+        bool found = false;
+        for (auto it = mEntries.begin(); it != mEntries.end();) {
+            Entry& entry = it->second;
+            if (now - entry.lastRequest > mOptions.ttl) {
+                releaseSpareBuffersLocked(&entry, outExpiredBuffers);
+                it = mEntries.erase(it);
+                continue;
+            }
+
+            const size_t missing =
+                    entry.wanted > entry.buffers.size() ? entry.wanted - entry.buffers.size() : 0;
+            if (!found && missing > 0 &&
+                mPooledBytes + entry.bufferBytes * missing <= mOptions.byteBudget) {
+                *outDescriptor = it->first;
+                *outCount = missing;
+                found = true;
+            }
+            ++it;
+        }
+        return found;
+    }
+
+    void threadLoop() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStop) {
+            BufferDescriptor descriptor;
+            uint32_t count = 0;
+            std::vector<const native_handle_t*> expiredBuffers;
+            const bool refill = updateEntriesLocked(&descriptor, &count, &expiredBuffers);
+
+            lock.unlock();
+            if (!expiredBuffers.empty()) {
+                mHal->freeBuffers(expiredBuffers);
+            }
+            std::vector<const native_handle_t*> buffers;
+            uint32_t stride = 0;
+            const bool allocated =
+                    refill && mHal->allocateBuffers(descriptor, count, &stride, &buffers) ==
+                                      Error::NONE;
+            lock.lock();
+
+            if (allocated) {
+                addSpareBuffersLocked(descriptor, stride, &buffers);
+                if (buffers.empty()) {
+                    // there may be more descriptors to refill
+                    continue;
+                }
+                lock.unlock();
+                mHal->freeBuffers(buffers);
+                lock.lock();
+            }
+
+            if (mStop) {
+                break;
+            }
+            mCondition.wait_for(lock, mOptions.ttl);
+        }
+    }
+
+    // Moves the buffers to the pool if they still fit, leaving those that do not in buffers
+    void addSpareBuffersLocked(const BufferDescriptor& descriptor, uint32_t stride,
+                               std::vector<const native_handle_t*>* buffers) {
+        auto it = mEntries.find(static_cast<std::vector<uint32_t>>(descriptor));
+        if (buffers->empty() || it == mEntries.end()) {
+            return;
+        }
+
+        Entry& entry = it->second;
+        if (!entry.buffers.empty() && entry.stride != stride) {
+            return;
+        }
+        entry.stride = stride;
+        entry.bufferBytes = estimateBufferBytes(descriptor, stride);
+
+        const size_t bytes = entry.bufferBytes * buffers->size();
+        if (entry.buffers.size() + buffers->size() > entry.wanted ||
+            mPooledBytes + bytes > mOptions.byteBudget) {
+            return;
+        }
+
+        entry.buffers.insert(entry.buffers.end(), buffers->begin(), buffers->end());
+        mPooledBytes += bytes;
+        buffers->clear();
+    }
+
+    const std::unique_ptr<Hal> mHal;
+    const Options mOptions;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStop = false;
+    // hidl_vec has no ordering, so the descriptors are keyed as std::vector
+    std::map<std::vector<uint32_t>, Entry> mEntries;
+    size_t mPooledBytes = 0;
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+    uint64_t mTrims = 0;
+
+    // Declared last, as it uses the members above
+    std::thread mThread;
+};
+
+}  // namespace detail
+
+using BufferPoolHal = detail::BufferPoolHalImpl<hal::AllocatorHal>;
+
+}  // namespace passthrough
+}  // namespace V2_0
+}  // namespace allocator
+}  // namespace graphics
+}  // namespace hardware
+}  // namespace android
@@ -20,7 +20,13 @@
 #warning "Gralloc1Hal.h included without LOG_TAG"
 #endif
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstring>  // for strerror
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include <allocator-hal/2.0/AllocatorHal.h>
 #include <hardware/gralloc1.h>
@@ -41,6 +47,40 @@ using mapper::V2_0::BufferDescriptor;
 using mapper::V2_0::Error;
 using mapper::V2_0::passthrough::grallocDecodeBufferDescriptor;
 
+// Counts allocateBuffers calls by latency in power-of-two buckets of milliseconds, for
+// dumpDebugInfo. It may be updated from several binder threads at once.
+class AllocationLatencyHistogram {
+   public:
+    void record(std::chrono::steady_clock::duration latency) {
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(latency).count();
+        size_t bucket = 0;
+        while (bucket + 1 < kBucketCount && ms >= (int64_t{1} << bucket)) {
+            bucket++;
+        }
+        mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::string dump() const {
+        std::ostringstream os;
+        os << "allocateBuffers latency:";
+        for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+            if (bucket + 1 < kBucketCount) {
+                os << " <" << (1 << bucket) << "ms=";
+            } else {
+                os << " >=" << (1 << (bucket - 1)) << "ms=";
+            }
+            os << mBuckets[bucket].load(std::memory_order_relaxed);
+        }
+        os << "\n";
+        return os.str();
+    }
+
+   private:
+    // <1ms, <2ms, ... <512ms and >=512ms
+    static constexpr size_t kBucketCount = 11;
+    std::array<std::atomic<uint64_t>, kBucketCount> mBuckets = {};
+};
+
 // Gralloc1HalImpl implements V2_*::hal::AllocatorHal on top of gralloc1
 template <typename Hal>
 class Gralloc1HalImpl : public Hal {
@@ -78,7 +118,7 @@ class Gralloc1HalImpl : public Hal {
         buf.resize(len + 1);
         buf[len] = '\0';
 
-        return buf.data();
+        return buf.data() + mAllocationLatency.dump();
     }
 
     Error allocateBuffers(const BufferDescriptor& descriptor, uint32_t count, uint32_t* outStride,
@@ -94,31 +134,28 @@ class Gralloc1HalImpl : public Hal {
             return error;
         }
 
+        const auto start = std::chrono::steady_clock::now();
+
         uint32_t stride = 0;
         std::vector<const native_handle_t*> buffers;
-        buffers.reserve(count);
-
-        // allocate the buffers
-        for (uint32_t i = 0; i < count; i++) {
-            const native_handle_t* tmpBuffer;
-            uint32_t tmpStride;
-            error = allocateOneBuffer(desc, &tmpBuffer, &tmpStride);
-            if (error != Error::NONE) {
-                break;
-            }
-
-            buffers.push_back(tmpBuffer);
-
-            if (stride == 0) {
+        error = allocateBufferBatch(desc, count, &buffers);
+
+        // query the strides, which must be uniform
+        for (uint32_t i = 0; error == Error::NONE && i < count; i++) {
+            uint32_t tmpStride = 0;
+            int32_t err = mDispatch.getStride(mDevice, buffers[i], &tmpStride);
+            if (err != GRALLOC1_ERROR_NONE && err != GRALLOC1_ERROR_UNDEFINED) {
+                error = toError(err);
+            } else if (i == 0) {
                 stride = tmpStride;
             } else if (stride != tmpStride) {
                 // non-uniform strides
                 error = Error::UNSUPPORTED;
-                break;
             }
         }
 
         mDispatch.destroyDescriptor(mDevice, desc);
+        mAllocationLatency.record(std::chrono::steady_clock::now() - start);
 
         if (error != Error::NONE) {
             freeBuffers(buffers);
@@ -310,29 +347,31 @@ class Gralloc1HalImpl : public Hal {
         return toError(error);
     }
 
-    Error allocateOneBuffer(gralloc1_buffer_descriptor_t descriptor,
-                            const native_handle_t** outBuffer, uint32_t* outStride) {
-        const native_handle_t* buffer = nullptr;
-        int32_t error = mDispatch.allocate(mDevice, 1, &descriptor, &buffer);
-        if (error != GRALLOC1_ERROR_NONE && error != GRALLOC1_ERROR_NOT_SHARED) {
-            return toError(error);
+    // Allocates count buffers with a single call into the device. gralloc1 allocates either all
+    // of the buffers or none of them.
+    Error allocateBufferBatch(gralloc1_buffer_descriptor_t descriptor, uint32_t count,
+                              std::vector<const native_handle_t*>* outBuffers) {
+        if (count == 0) {
+            outBuffers->clear();
+            return Error::NONE;
         }
 
-        uint32_t stride = 0;
-        error = mDispatch.getStride(mDevice, buffer, &stride);
-        if (error != GRALLOC1_ERROR_NONE && error != GRALLOC1_ERROR_UNDEFINED) {
-            mDispatch.release(mDevice, buffer);
+        const std::vector<gralloc1_buffer_descriptor_t> descriptors(count, descriptor);
+        std::vector<const native_handle_t*> buffers(count, nullptr);
+        int32_t error = mDispatch.allocate(mDevice, count, descriptors.data(), buffers.data());
+        if (error != GRALLOC1_ERROR_NONE && error != GRALLOC1_ERROR_NOT_SHARED) {
             return toError(error);
         }
 
-        *outBuffer = buffer;
-        *outStride = stride;
+        *outBuffers = std::move(buffers);
 
         return Error::NONE;
     }
 
     gralloc1_device_t* mDevice = nullptr;
 
+    AllocationLatencyHistogram mAllocationLatency;
+
     struct {
         bool layeredBuffers;
     } mCapabilities = {};
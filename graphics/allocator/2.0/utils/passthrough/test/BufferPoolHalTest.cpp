@@ -0,0 +1,257 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BufferPoolHalTest"
+
+#include <allocator-passthrough/2.0/BufferPoolHal.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cutils/native_handle.h>
+#include <gtest/gtest.h>
+
+namespace android {
+namespace hardware {
+namespace graphics {
+namespace allocator {
+namespace V2_0 {
+namespace passthrough {
+namespace {
+
+using common::V1_0::PixelFormat;
+using mapper::V2_0::BufferDescriptor;
+using mapper::V2_0::Error;
+using mapper::V2_0::IMapper;
+using mapper::V2_0::passthrough::grallocEncodeBufferDescriptor;
+using namespace std::chrono_literals;
+
+constexpr auto kTimeout = 2s;
+constexpr uint32_t kStride = 64;
+// The estimated size of the buffers of makeDescriptor(kStride, 16).
+constexpr size_t kBufferBytes = kStride * 16 * 4;
+
+BufferDescriptor makeDescriptor(uint32_t width, uint32_t height) {
+    return grallocEncodeBufferDescriptor(
+            IMapper::BufferDescriptorInfo{width, height, 1, PixelFormat::RGBA_8888, 0});
+}
+
+// An allocator HAL that tracks the buffers it handed out, and runs out of resources on request.
+class FakeAllocatorHal : public hal::AllocatorHal {
+  public:
+    // Every buffer is freed by the end of each test, spares included.
+    ~FakeAllocatorHal() { EXPECT_TRUE(mLive.empty()); }
+
+    std::string dumpDebugInfo() override { return ""; }
+
+    Error allocateBuffers(const BufferDescriptor& /* descriptor */, uint32_t count,
+                          uint32_t* outStride,
+                          std::vector<const native_handle_t*>* outBuffers) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mAllocations++;
+        mChanged.notify_all();
+        if (mFailuresLeft > 0) {
+            mFailuresLeft--;
+            return Error::NO_RESOURCES;
+        }
+        outBuffers->clear();
+        for (uint32_t i = 0; i < count; i++) {
+            const native_handle_t* buffer = native_handle_create(0, 0);
+            mLive.insert(buffer);
+            outBuffers->push_back(buffer);
+        }
+        *outStride = kStride;
+        return Error::NONE;
+    }
+
+    void freeBuffers(const std::vector<const native_handle_t*>& buffers) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const native_handle_t* buffer : buffers) {
+            EXPECT_EQ(1u, mLive.erase(buffer));
+            native_handle_delete(const_cast<native_handle_t*>(buffer));
+        }
+        mChanged.notify_all();
+    }
+
+    // Returns whether the HAL was asked for allocations count times within kTimeout.
+    bool waitForAllocations(uint32_t count) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mChanged.wait_for(lock, kTimeout, [&] { return mAllocations >= count; });
+    }
+
+    // Returns whether no more than count buffers are left within kTimeout.
+    bool waitForLiveBuffers(size_t count) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mChanged.wait_for(lock, kTimeout, [&] { return mLive.size() <= count; });
+    }
+
+    uint32_t allocations() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mAllocations;
+    }
+
+    size_t liveBuffers() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mLive.size();
+    }
+
+    std::set<const native_handle_t*> live() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mLive;
+    }
+
+    void failNextAllocations(uint32_t count) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFailuresLeft = count;
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mChanged;
+    uint32_t mAllocations = 0;
+    uint32_t mFailuresLeft = 0;
+    std::set<const native_handle_t*> mLive;
+};
+
+class BufferPoolHalTest : public ::testing::Test {
+  protected:
+    void createPool(size_t byteBudget, std::chrono::milliseconds ttl) {
+        auto hal = std::make_unique<FakeAllocatorHal>();
+        mHal = hal.get();
+        mPool = std::make_unique<BufferPoolHal>(std::move(hal), BufferPoolHal::Options{
+                                                                        .byteBudget = byteBudget,
+                                                                        .ttl = ttl,
+                                                                });
+    }
+
+    std::vector<const native_handle_t*> allocate(const BufferDescriptor& descriptor,
+                                                 uint32_t count) {
+        uint32_t stride = 0;
+        std::vector<const native_handle_t*> buffers;
+        EXPECT_EQ(Error::NONE, mPool->allocateBuffers(descriptor, count, &stride, &buffers));
+        EXPECT_EQ(kStride, stride);
+        EXPECT_EQ(count, buffers.size());
+        return buffers;
+    }
+
+    // Allocates the descriptor twice, which has the pool keep that many spares of bytes each,
+    // and waits for them to be pooled.
+    void fillSpares(const BufferDescriptor& descriptor, uint32_t count, size_t bytes) {
+        mPool->freeBuffers(allocate(descriptor, count));
+        mPool->freeBuffers(allocate(descriptor, count));
+        ASSERT_TRUE(waitForPooledBytes(count * bytes));
+    }
+
+    // The pool only reports the estimated size of its spares through its dump.
+    bool waitForPooledBytes(size_t bytes) {
+        const std::string pooled = " " + std::to_string(bytes) + "/";
+        const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+        while (mPool->dumpDebugInfo().find(pooled) == std::string::npos) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    FakeAllocatorHal* mHal = nullptr;
+    std::unique_ptr<BufferPoolHal> mPool;
+};
+
+TEST_F(BufferPoolHalTest, ServesRepeatedDescriptorsFromSpares) {
+    createPool(1024 * 1024, 10s);
+    const BufferDescriptor descriptor = makeDescriptor(kStride, 16);
+    fillSpares(descriptor, 2, kBufferBytes);
+    const std::set<const native_handle_t*> spares = mHal->live();
+    ASSERT_EQ(2u, spares.size());
+
+    const auto buffers = allocate(descriptor, 2);
+
+    // The spares were handed out, and are refilled in the background.
+    for (const native_handle_t* buffer : buffers) {
+        EXPECT_EQ(1u, spares.count(buffer));
+    }
+    EXPECT_TRUE(waitForPooledBytes(2 * kBufferBytes));
+    mPool->freeBuffers(buffers);
+}
+
+TEST_F(BufferPoolHalTest, KeepsSparesWithinTheByteBudget) {
+    createPool(kBufferBytes, 10s);
+    const BufferDescriptor descriptor = makeDescriptor(kStride, 16);
+    mPool->freeBuffers(allocate(descriptor, 2));
+    mPool->freeBuffers(allocate(descriptor, 2));
+    ASSERT_TRUE(mHal->waitForAllocations(3));
+
+    // The two spares went back to the HAL, as they do not fit.
+    EXPECT_TRUE(mHal->waitForLiveBuffers(0));
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(0u, mHal->liveBuffers());
+}
+
+TEST_F(BufferPoolHalTest, FreesSparesOfIdleDescriptors) {
+    createPool(1024 * 1024, 200ms);
+    fillSpares(makeDescriptor(kStride, 16), 2, kBufferBytes);
+
+    EXPECT_TRUE(mHal->waitForLiveBuffers(0));
+}
+
+TEST_F(BufferPoolHalTest, TrimsSparesWhenTheHalRunsOutOfResources) {
+    createPool(1024 * 1024, 10s);
+    fillSpares(makeDescriptor(kStride, 16), 2, kBufferBytes);
+    const uint32_t allocations = mHal->allocations();
+
+    mHal->failNextAllocations(1);
+    const auto buffers = allocate(makeDescriptor(kStride, 32), 1);
+
+    // The spares were freed before the allocation was retried, and are not refilled until
+    // their descriptor is requested again.
+    EXPECT_EQ(allocations + 2, mHal->allocations());
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(1u, mHal->liveBuffers());
+    mPool->freeBuffers(buffers);
+}
+
+TEST_F(BufferPoolHalTest, DoesNotRetryWithoutSpares) {
+    createPool(1024 * 1024, 10s);
+    mHal->failNextAllocations(1);
+
+    uint32_t stride = 0;
+    std::vector<const native_handle_t*> buffers;
+    EXPECT_EQ(Error::NO_RESOURCES,
+              mPool->allocateBuffers(makeDescriptor(kStride, 16), 1, &stride, &buffers));
+    EXPECT_EQ(1u, mHal->allocations());
+}
+
+TEST_F(BufferPoolHalTest, FreesSparesWhenDestroyed) {
+    createPool(1024 * 1024, 10s);
+    fillSpares(makeDescriptor(kStride, 16), 2, kBufferBytes);
+
+    // The destructor of the fake HAL, which goes with the pool, checks that they were freed.
+    mPool.reset();
+}
+
+}  // namespace
+}  // namespace passthrough
+}  // namespace V2_0
+}  // namespace allocator
+}  // namespace graphics
+}  // namespace hardware
+}  // namespace android
@@ -56,22 +56,35 @@ class CommandWriterBase {
    public:
     CommandWriterBase(uint32_t initialMaxSize) : mDataMaxSize(initialMaxSize) {
         mData = std::make_unique<uint32_t[]>(mDataMaxSize);
+        mDataHandles.reserve(kInitialHandleCapacity);
+        mTemporaryHandles.reserve(kInitialHandleCapacity);
         reset();
     }
 
-    virtual ~CommandWriterBase() { reset(); }
+    virtual ~CommandWriterBase() {
+        reset();
+        for (auto handle : mFreeFenceHandles) {
+            native_handle_delete(handle);
+        }
+    }
 
     void reset() {
         mDataWritten = 0;
         mCommandEnd = 0;
 
-        // handles in mDataHandles are owned by the caller
+        // handles in mDataHandles are owned by the caller; clear() keeps the
+        // capacity, so the vector is not regrown every frame
         mDataHandles.clear();
 
-        // handles in mTemporaryHandles are owned by the writer
+        // handles in mTemporaryHandles are owned by the writer; fence handles
+        // are kept for reuse by the next frame once their fds are closed
         for (auto handle : mTemporaryHandles) {
             native_handle_close(handle);
-            native_handle_delete(handle);
+            if (handle->numFds == 1 && handle->numInts == 0) {
+                mFreeFenceHandles.push_back(handle);
+            } else {
+                native_handle_delete(handle);
+            }
         }
         mTemporaryHandles.clear();
     }
@@ -108,7 +121,9 @@ class CommandWriterBase {
             }
         }
 
-        // write data to queue, optionally resizing it
+        // write data to queue, optionally resizing it; mDataMaxSize never
+        // shrinks, so the queue is only replaced when a frame needs more room
+        // than every frame before it
         if (mQueue && (mDataMaxSize <= mQueue->getQuantumCount())) {
             if (!mQueue->write(mData.get(), mDataWritten)) {
                 ALOGE("failed to write commands to message queue");
@@ -530,7 +545,13 @@ class CommandWriterBase {
     }
 
     native_handle_t* getTemporaryHandle(int numFds, int numInts) {
-        native_handle_t* handle = native_handle_create(numFds, numInts);
+        native_handle_t* handle = nullptr;
+        if (numFds == 1 && numInts == 0 && !mFreeFenceHandles.empty()) {
+            handle = mFreeFenceHandles.back();
+            mFreeFenceHandles.pop_back();
+        } else {
+            handle = native_handle_create(numFds, numInts);
+        }
         if (handle) {
             mTemporaryHandles.push_back(handle);
         }
@@ -539,6 +560,9 @@ class CommandWriterBase {
 
     static constexpr uint16_t kMaxLength = std::numeric_limits<uint16_t>::max();
 
+    // a buffer and a fence for each of a few dozen layers
+    static constexpr size_t kInitialHandleCapacity = 64;
+
     std::unique_ptr<uint32_t[]> mData;
     uint32_t mDataWritten;
 
@@ -571,6 +595,8 @@ class CommandWriterBase {
 
     std::vector<hidl_handle> mDataHandles;
     std::vector<native_handle_t*> mTemporaryHandles;
+    // closed fence handles from earlier frames, ready to be reused
+    std::vector<native_handle_t*> mFreeFenceHandles;
 
     std::unique_ptr<CommandQueueType> mQueue;
 };
@@ -23,8 +23,10 @@
 #include <array>
 #include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include <android/hardware/graphics/composer/2.1/IComposer.h>
@@ -82,7 +84,14 @@ class ComposerImpl : public Interface {
     }
 
     Return<void> dumpDebugInfo(IComposer::dumpDebugInfo_cb hidl_cb) override {
-        hidl_cb(mHal->dumpDebugInfo());
+        std::string debugInfo = mHal->dumpDebugInfo();
+        {
+            std::lock_guard<std::mutex> lock(mClientMutex);
+            if (mDumpClientCommandStats) {
+                debugInfo += mDumpClientCommandStats();
+            }
+        }
+        hidl_cb(debugInfo);
         return Void();
     }
 
@@ -126,9 +135,16 @@ class ComposerImpl : public Interface {
         return mClient == nullptr;
     }
 
+    // Makes dumpDebugInfo include the command statistics of client until it is destroyed.
+    template <typename Client>
+    void setDumpClientCommandStatsLocked(Client* client) {
+        mDumpClientCommandStats = [client]() { return client->dumpCommandStats(); };
+    }
+
     void onClientDestroyed() {
         std::lock_guard<std::mutex> lock(mClientMutex);
         mClient.clear();
+        mDumpClientCommandStats = nullptr;
         mClientDestroyedCondition.notify_all();
     }
 
@@ -140,6 +156,7 @@ class ComposerImpl : public Interface {
 
         auto clientDestroyed = [this]() { onClientDestroyed(); };
         client->setOnClientDestroyed(clientDestroyed);
+        setDumpClientCommandStatsLocked(client.get());
 
         return client.release();
     }
@@ -148,6 +165,7 @@ class ComposerImpl : public Interface {
 
     std::mutex mClientMutex;
     wp<IComposerClient> mClient;
+    std::function<std::string()> mDumpClientCommandStats;
     std::condition_variable mClientDestroyedCondition;
 };
 
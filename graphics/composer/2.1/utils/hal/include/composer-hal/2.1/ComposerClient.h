@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include <android/hardware/graphics/composer/2.1/IComposerClient.h>
@@ -83,6 +84,12 @@ class ComposerClientImpl : public Interface {
         mOnClientDestroyed = onClientDestroyed;
     }
 
+    // Returns how often each command was executed and how long it took, for dumpDebugInfo.
+    std::string dumpCommandStats() {
+        std::lock_guard<std::mutex> lock(mCommandEngineMutex);
+        return mCommandEngine ? mCommandEngine->dumpCommandStats() : std::string();
+    }
+
     // IComposerClient 2.1 interface
 
     class HalEventCallback : public Hal::EventCallback {
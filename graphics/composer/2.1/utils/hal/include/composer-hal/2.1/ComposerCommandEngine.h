@@ -20,6 +20,11 @@
 #warning "ComposerCommandEngine.h included without LOG_TAG"
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include <composer-command-buffer/2.1/ComposerCommandBuffer.h>
@@ -42,6 +47,7 @@ class ComposerCommandEngine : protected CommandReaderBase {
      ComposerCommandEngine(ComposerHal* hal, ComposerResources* resources)
          : mHal(hal), mResources(resources) {
          mWriter = createCommandWriter(kWriterInitialSize);
+         registerCommandHandlers();
      }
 
     virtual ~ComposerCommandEngine() = default;
@@ -63,7 +69,15 @@ class ComposerCommandEngine : protected CommandReaderBase {
                 break;
             }
 
+            CommandEntry* entry = getCommandEntry(command);
+            const auto start = std::chrono::steady_clock::now();
             bool parsed = executeCommand(command, length);
+            if (entry) {
+                const auto duration = std::chrono::steady_clock::now() - start;
+                entry->count++;
+                entry->totalTime += duration;
+                entry->maxTime = std::max<std::chrono::nanoseconds>(entry->maxTime, duration);
+            }
             endCommand();
 
             if (!parsed) {
@@ -88,57 +102,99 @@ class ComposerCommandEngine : protected CommandReaderBase {
         mWriter->reset();
     }
 
+    // Returns how often each command was executed and how long it took, the most expensive
+    // commands first.
+    std::string dumpCommandStats() const {
+        std::vector<const CommandEntry*> entries;
+        for (const auto& entry : mCommandEntries) {
+            if (entry.count > 0) {
+                entries.push_back(&entry);
+            }
+        }
+        std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) {
+            return a->totalTime > b->totalTime;
+        });
+
+        std::ostringstream os;
+        os << "Command statistics (count, total/avg/max us):\n";
+        for (const auto* entry : entries) {
+            const auto toUs = [](std::chrono::nanoseconds time) { return time.count() / 1000.0; };
+            os << "  " << entry->name << ": " << entry->count << ", " << toUs(entry->totalTime)
+               << "/" << toUs(entry->totalTime / entry->count) << "/" << toUs(entry->maxTime)
+               << "\n";
+        }
+        return os.str();
+    }
+
    protected:
+    using CommandHandler = std::function<bool(uint16_t length)>;
+
+    // Makes executeCommand dispatch command to handler, replacing any handler registered for
+    // command before. Engines register the commands of their version in their constructor.
+    template <typename Command>
+    void registerCommandHandler(Command command, CommandHandler handler) {
+        const uint32_t opcode = getOpcode(static_cast<IComposerClient::Command>(command));
+        if (opcode >= mCommandEntryIndices.size()) {
+            mCommandEntryIndices.resize(opcode + 1, kNoCommandEntry);
+        }
+
+        uint8_t& index = mCommandEntryIndices[opcode];
+        if (index == kNoCommandEntry) {
+            LOG_ALWAYS_FATAL_IF(mCommandEntries.size() >= kNoCommandEntry,
+                                "too many command handlers");
+            index = static_cast<uint8_t>(mCommandEntries.size());
+            mCommandEntries.emplace_back();
+        }
+        mCommandEntries[index].name = toString(command);
+        mCommandEntries[index].handler = std::move(handler);
+    }
+
     virtual bool executeCommand(IComposerClient::Command command, uint16_t length) {
-        switch (command) {
-            case IComposerClient::Command::SELECT_DISPLAY:
-                return executeSelectDisplay(length);
-            case IComposerClient::Command::SELECT_LAYER:
-                return executeSelectLayer(length);
-            case IComposerClient::Command::SET_COLOR_TRANSFORM:
-                return executeSetColorTransform(length);
-            case IComposerClient::Command::SET_CLIENT_TARGET:
-                return executeSetClientTarget(length);
-            case IComposerClient::Command::SET_OUTPUT_BUFFER:
-                return executeSetOutputBuffer(length);
-            case IComposerClient::Command::VALIDATE_DISPLAY:
-                return executeValidateDisplay(length);
-            case IComposerClient::Command::PRESENT_OR_VALIDATE_DISPLAY:
-                return executePresentOrValidateDisplay(length);
-            case IComposerClient::Command::ACCEPT_DISPLAY_CHANGES:
-                return executeAcceptDisplayChanges(length);
-            case IComposerClient::Command::PRESENT_DISPLAY:
-                return executePresentDisplay(length);
-            case IComposerClient::Command::SET_LAYER_CURSOR_POSITION:
-                return executeSetLayerCursorPosition(length);
-            case IComposerClient::Command::SET_LAYER_BUFFER:
-                return executeSetLayerBuffer(length);
-            case IComposerClient::Command::SET_LAYER_SURFACE_DAMAGE:
-                return executeSetLayerSurfaceDamage(length);
-            case IComposerClient::Command::SET_LAYER_BLEND_MODE:
-                return executeSetLayerBlendMode(length);
-            case IComposerClient::Command::SET_LAYER_COLOR:
-                return executeSetLayerColor(length);
-            case IComposerClient::Command::SET_LAYER_COMPOSITION_TYPE:
-                return executeSetLayerCompositionType(length);
-            case IComposerClient::Command::SET_LAYER_DATASPACE:
-                return executeSetLayerDataspace(length);
-            case IComposerClient::Command::SET_LAYER_DISPLAY_FRAME:
-                return executeSetLayerDisplayFrame(length);
-            case IComposerClient::Command::SET_LAYER_PLANE_ALPHA:
-                return executeSetLayerPlaneAlpha(length);
-            case IComposerClient::Command::SET_LAYER_SIDEBAND_STREAM:
-                return executeSetLayerSidebandStream(length);
-            case IComposerClient::Command::SET_LAYER_SOURCE_CROP:
-                return executeSetLayerSourceCrop(length);
-            case IComposerClient::Command::SET_LAYER_TRANSFORM:
-                return executeSetLayerTransform(length);
-            case IComposerClient::Command::SET_LAYER_VISIBLE_REGION:
-                return executeSetLayerVisibleRegion(length);
-            case IComposerClient::Command::SET_LAYER_Z_ORDER:
-                return executeSetLayerZOrder(length);
-            default:
-                return false;
+        CommandEntry* entry = getCommandEntry(command);
+        return entry ? entry->handler(length) : false;
+    }
+
+    void registerCommandHandlers() {
+        using Command = IComposerClient::Command;
+        const std::pair<Command, bool (ComposerCommandEngine::*)(uint16_t)> handlers[] = {
+                {Command::SELECT_DISPLAY, &ComposerCommandEngine::executeSelectDisplay},
+                {Command::SELECT_LAYER, &ComposerCommandEngine::executeSelectLayer},
+                {Command::SET_COLOR_TRANSFORM, &ComposerCommandEngine::executeSetColorTransform},
+                {Command::SET_CLIENT_TARGET, &ComposerCommandEngine::executeSetClientTarget},
+                {Command::SET_OUTPUT_BUFFER, &ComposerCommandEngine::executeSetOutputBuffer},
+                {Command::VALIDATE_DISPLAY, &ComposerCommandEngine::executeValidateDisplay},
+                {Command::PRESENT_OR_VALIDATE_DISPLAY,
+                 &ComposerCommandEngine::executePresentOrValidateDisplay},
+                {Command::ACCEPT_DISPLAY_CHANGES,
+                 &ComposerCommandEngine::executeAcceptDisplayChanges},
+                {Command::PRESENT_DISPLAY, &ComposerCommandEngine::executePresentDisplay},
+                {Command::SET_LAYER_CURSOR_POSITION,
+                 &ComposerCommandEngine::executeSetLayerCursorPosition},
+                {Command::SET_LAYER_BUFFER, &ComposerCommandEngine::executeSetLayerBuffer},
+                {Command::SET_LAYER_SURFACE_DAMAGE,
+                 &ComposerCommandEngine::executeSetLayerSurfaceDamage},
+                {Command::SET_LAYER_BLEND_MODE, &ComposerCommandEngine::executeSetLayerBlendMode},
+                {Command::SET_LAYER_COLOR, &ComposerCommandEngine::executeSetLayerColor},
+                {Command::SET_LAYER_COMPOSITION_TYPE,
+                 &ComposerCommandEngine::executeSetLayerCompositionType},
+                {Command::SET_LAYER_DATASPACE, &ComposerCommandEngine::executeSetLayerDataspace},
+                {Command::SET_LAYER_DISPLAY_FRAME,
+                 &ComposerCommandEngine::executeSetLayerDisplayFrame},
+                {Command::SET_LAYER_PLANE_ALPHA,
+                 &ComposerCommandEngine::executeSetLayerPlaneAlpha},
+                {Command::SET_LAYER_SIDEBAND_STREAM,
+                 &ComposerCommandEngine::executeSetLayerSidebandStream},
+                {Command::SET_LAYER_SOURCE_CROP,
+                 &ComposerCommandEngine::executeSetLayerSourceCrop},
+                {Command::SET_LAYER_TRANSFORM, &ComposerCommandEngine::executeSetLayerTransform},
+                {Command::SET_LAYER_VISIBLE_REGION,
+                 &ComposerCommandEngine::executeSetLayerVisibleRegion},
+                {Command::SET_LAYER_Z_ORDER, &ComposerCommandEngine::executeSetLayerZOrder},
+        };
+        for (const auto& [command, handler] : handlers) {
+            registerCommandHandler(command, [this, handler = handler](uint16_t length) {
+                return (this->*handler)(length);
+            });
         }
     }
 
@@ -585,6 +641,35 @@ class ComposerCommandEngine : protected CommandReaderBase {
 
     Display mCurrentDisplay = 0;
     Layer mCurrentLayer = 0;
+
+   private:
+    struct CommandEntry {
+        std::string name;
+        CommandHandler handler;
+        uint64_t count = 0;
+        std::chrono::nanoseconds totalTime{0};
+        std::chrono::nanoseconds maxTime{0};
+    };
+
+    static constexpr uint8_t kNoCommandEntry = 0xff;
+
+    static uint32_t getOpcode(IComposerClient::Command command) {
+        return static_cast<uint32_t>(command) >>
+               static_cast<uint32_t>(IComposerClient::Command::OPCODE_SHIFT);
+    }
+
+    CommandEntry* getCommandEntry(IComposerClient::Command command) {
+        const uint32_t opcode = getOpcode(command);
+        if (opcode >= mCommandEntryIndices.size() ||
+            mCommandEntryIndices[opcode] == kNoCommandEntry) {
+            return nullptr;
+        }
+        return &mCommandEntries[mCommandEntryIndices[opcode]];
+    }
+
+    // Opcodes are sparse, so the table maps them to indices into the dense mCommandEntries
+    std::vector<uint8_t> mCommandEntryIndices;
+    std::vector<CommandEntry> mCommandEntries;
 };
 
 }  // namespace hal
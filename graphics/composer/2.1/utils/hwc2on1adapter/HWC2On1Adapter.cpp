@@ -27,6 +27,7 @@
 
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 
 #include <hardware/hwcomposer.h>
@@ -511,6 +512,7 @@ HWC2On1Adapter::Display::Display(HWC2On1Adapter& device, HWC2::DisplayType type)
     mDevice(device),
     mStateMutex(),
     mHwc1RequestedContents(nullptr),
+    mHwc1RequestedContentsSize(0),
     mRetireFence(),
     mChanges(),
     mHwc1Id(-1),
@@ -528,7 +530,8 @@ HWC2On1Adapter::Display::Display(HWC2On1Adapter& device, HWC2::DisplayType type)
     mHwc1LayerMap(),
     mNumAvailableRects(0),
     mNextAvailableRect(nullptr),
-    mGeometryChanged(false)
+    mGeometryChanged(false),
+    mLayoutChanged(true)
     {}
 
 Error HWC2On1Adapter::Display::acceptChanges() {
@@ -566,7 +569,7 @@ Error HWC2On1Adapter::Display::createLayer(hwc2_layer_t* outLayerId) {
     mDevice.mLayers.emplace(std::make_pair(layer->getId(), layer));
     *outLayerId = layer->getId();
     ALOGV("[%" PRIu64 "] created layer %" PRIu64, mId, *outLayerId);
-    markGeometryChanged();
+    markLayoutChanged();
     return Error::None;
 }
 
@@ -589,7 +592,7 @@ Error HWC2On1Adapter::Display::destroyLayer(hwc2_layer_t layerId) {
         }
     }
     ALOGV("[%" PRIu64 "] destroyed layer %" PRIu64, mId, layerId);
-    markGeometryChanged();
+    markLayoutChanged();
     return Error::None;
 }
 
@@ -1023,7 +1026,7 @@ Error HWC2On1Adapter::Display::updateLayerZ(hwc2_layer_t layerId, uint32_t z) {
 
     layer->setZ(z);
     mLayers.emplace(std::move(layer));
-    markGeometryChanged();
+    markLayoutChanged();
 
     return Error::None;
 }
@@ -1214,8 +1217,13 @@ bool HWC2On1Adapter::Display::prepare() {
         return false;
     }
 
-    allocateRequestedContents();
-    assignHwc1LayerIds();
+    // Layers keep their HWC1 index and rects until the layout changes, so the
+    // contents of the last frame only need the changed state applied to them
+    const bool relayout = mLayoutChanged || !mHwc1RequestedContents;
+    if (relayout) {
+        allocateRequestedContents();
+        assignHwc1LayerIds();
+    }
 
     mHwc1RequestedContents->retireFenceFd = -1;
     mHwc1RequestedContents->flags = 0;
@@ -1232,12 +1240,13 @@ bool HWC2On1Adapter::Display::prepare() {
         hwc1Layer.releaseFenceFd = -1;
         hwc1Layer.acquireFenceFd = -1;
         ALOGV("Applying states for layer %" PRIu64 " ", layer->getId());
-        layer->applyState(hwc1Layer);
+        layer->applyState(hwc1Layer, relayout);
     }
 
     prepareFramebufferTarget();
 
     resetGeometryMarker();
+    mLayoutChanged = false;
 
     return true;
 }
@@ -1807,8 +1816,14 @@ void HWC2On1Adapter::Display::allocateRequestedContents() {
     size_t size = sizeof(hwc_display_contents_1_t) +
             sizeof(hwc_layer_1_t) * numLayers +
             sizeof(hwc_rect_t) * numRects;
-    auto contents = static_cast<hwc_display_contents_1_t*>(std::calloc(size, 1));
-    mHwc1RequestedContents.reset(contents);
+    if (size > mHwc1RequestedContentsSize) {
+        mHwc1RequestedContents.reset(
+                static_cast<hwc_display_contents_1_t*>(std::calloc(size, 1)));
+        mHwc1RequestedContentsSize = size;
+    } else {
+        std::memset(mHwc1RequestedContents.get(), 0, mHwc1RequestedContentsSize);
+    }
+    auto contents = mHwc1RequestedContents.get();
     mNextAvailableRect = reinterpret_cast<hwc_rect_t*>(&contents->hwLayers[numLayers]);
     mNumAvailableRects = numRects;
 }
@@ -1886,8 +1901,12 @@ void HWC2On1Adapter::Display::prepareFramebufferTarget() {
     hwc1Target.displayFrame = {0, 0, width, height};
     hwc1Target.planeAlpha = 255;
 
-    hwc1Target.visibleRegionScreen.numRects = 1;
-    hwc_rect_t* rects = GetRects(1);
+    // The rect is only allocated when the contents are laid out again
+    hwc_rect_t* rects = const_cast<hwc_rect_t*>(hwc1Target.visibleRegionScreen.rects);
+    if (rects == nullptr) {
+        hwc1Target.visibleRegionScreen.numRects = 1;
+        rects = GetRects(1);
+    }
     rects[0].left = 0;
     rects[0].top = 0;
     rects[0].right = width;
@@ -1919,7 +1938,8 @@ HWC2On1Adapter::Layer::Layer(Display& display)
     mZ(0),
     mReleaseFence(),
     mHwc1Id(0),
-    mHasUnsupportedPlaneAlpha(false) {}
+    mHasUnsupportedPlaneAlpha(false),
+    mStateChanged(true) {}
 
 bool HWC2On1Adapter::SortLayersByZ::operator()(const std::shared_ptr<Layer>& lhs,
                                                const std::shared_ptr<Layer>& rhs) const {
@@ -1963,7 +1983,7 @@ Error HWC2On1Adapter::Layer::setSurfaceDamage(hwc_region_t damage) {
 
 Error HWC2On1Adapter::Layer::setBlendMode(BlendMode mode) {
     mBlendMode = mode;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
@@ -1985,13 +2005,13 @@ Error HWC2On1Adapter::Layer::setDataspace(android_dataspace_t) {
 
 Error HWC2On1Adapter::Layer::setDisplayFrame(hwc_rect_t frame) {
     mDisplayFrame = frame;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
 Error HWC2On1Adapter::Layer::setPlaneAlpha(float alpha) {
     mPlaneAlpha = alpha;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
@@ -2003,13 +2023,13 @@ Error HWC2On1Adapter::Layer::setSidebandStream(const native_handle_t* stream) {
 
 Error HWC2On1Adapter::Layer::setSourceCrop(hwc_frect_t crop) {
     mSourceCrop = crop;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
 Error HWC2On1Adapter::Layer::setTransform(Transform transform) {
     mTransform = transform;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
@@ -2024,9 +2044,13 @@ Error HWC2On1Adapter::Layer::setVisibleRegion(hwc_region_t visible) {
     if ((getNumVisibleRegions() != visible.numRects) ||
         !std::equal(mVisibleRegion.begin(), mVisibleRegion.end(), visible.rects,
                     compareRects)) {
+        if (getNumVisibleRegions() != visible.numRects) {
+            // The rects of the layers are packed, so lay them out again
+            mDisplay.markLayoutChanged();
+        }
         mVisibleRegion.resize(visible.numRects);
         std::copy_n(visible.rects, visible.numRects, mVisibleRegion.begin());
-        mDisplay.markGeometryChanged();
+        markStateChanged();
     }
     return Error::None;
 }
@@ -2045,8 +2069,18 @@ const sp<MiniFence>& HWC2On1Adapter::Layer::getReleaseFence() const {
     return mReleaseFence.get();
 }
 
-void HWC2On1Adapter::Layer::applyState(hwc_layer_1_t& hwc1Layer) {
-    applyCommonState(hwc1Layer);
+void HWC2On1Adapter::Layer::markStateChanged() {
+    mStateChanged = true;
+    mDisplay.markGeometryChanged();
+}
+
+void HWC2On1Adapter::Layer::applyState(hwc_layer_1_t& hwc1Layer, bool force) {
+    if (force || mStateChanged) {
+        applyCommonState(hwc1Layer);
+        mStateChanged = false;
+    }
+    // HWC1 writes back hints during prepare, so start over from none
+    hwc1Layer.hints = 0;
     applyCompositionType(hwc1Layer);
     switch (mCompositionType) {
         case Composition::SolidColor : applySolidColorState(hwc1Layer); break;
@@ -2151,10 +2185,15 @@ void HWC2On1Adapter::Layer::applyCommonState(hwc_layer_1_t& hwc1Layer) {
 
     hwc1Layer.transform = static_cast<uint32_t>(mTransform);
 
+    // Rects are only allocated when the contents are laid out again; until
+    // then the number of visible rects of the layer does not change.
     auto& hwc1VisibleRegion = hwc1Layer.visibleRegionScreen;
-    hwc1VisibleRegion.numRects = mVisibleRegion.size();
-    hwc_rect_t* rects = mDisplay.GetRects(hwc1VisibleRegion.numRects);
-    hwc1VisibleRegion.rects = rects;
+    hwc_rect_t* rects = const_cast<hwc_rect_t*>(hwc1VisibleRegion.rects);
+    if (rects == nullptr) {
+        hwc1VisibleRegion.numRects = mVisibleRegion.size();
+        rects = mDisplay.GetRects(hwc1VisibleRegion.numRects);
+        hwc1VisibleRegion.rects = rects;
+    }
     for (size_t i = 0; i < mVisibleRegion.size(); i++) {
         rects[i] = mVisibleRegion[i];
     }
@@ -278,6 +278,13 @@ private:
 
             void markGeometryChanged() { mGeometryChanged = true; }
             void resetGeometryMarker() { mGeometryChanged = false;}
+
+            // Forces the next prepare() to lay out the HWC1 contents again,
+            // e.g. because layers were added, removed or reordered.
+            void markLayoutChanged() {
+                mLayoutChanged = true;
+                mGeometryChanged = true;
+            }
         private:
             class Config {
                 public:
@@ -410,12 +417,16 @@ private:
 
             // Allocate RAM able to store all layers and rects used for
             // communication with HWC1. Place allocated RAM in variable
-            // mHwc1RequestedContents.
+            // mHwc1RequestedContents, reusing the previous allocation (cleared)
+            // if it is large enough.
             void allocateRequestedContents();
 
             // Array of structs exchanged between client and hwc1 device.
-            // Sent to device upon calling prepare().
+            // Sent to device upon calling prepare(). It is kept from frame to
+            // frame so that only layers whose state changed are translated
+            // again, unless the layout changed.
             std::unique_ptr<hwc_display_contents_1> mHwc1RequestedContents;
+            size_t mHwc1RequestedContentsSize;
     private:
             DeferredFence mRetireFence;
 
@@ -458,6 +469,10 @@ private:
             // updated with anything other than a buffer since last call to
             // Display::set()
             bool mGeometryChanged;
+
+            // True if the layers or their order, or the number of rects they
+            // need, changed since the last call to Display::prepare()
+            bool mLayoutChanged;
     };
 
     // Utility template calling a Display object method directly based on the
@@ -560,8 +575,10 @@ private:
             void setHwc1Id(size_t id) { mHwc1Id = id; }
             size_t getHwc1Id() const { return mHwc1Id; }
 
-            // Write state to HWC1 communication struct.
-            void applyState(struct hwc_layer_1& hwc1Layer);
+            // Write state to HWC1 communication struct. Unless force is set,
+            // the state that has not changed since the last call is assumed to
+            // be in hwc1Layer already.
+            void applyState(struct hwc_layer_1& hwc1Layer, bool force);
 
             std::string dump() const;
 
@@ -576,6 +593,8 @@ private:
                         !mDisplay.getDevice().supportsBackgroundColor());
             }
         private:
+            void markStateChanged();
+
             void applyCommonState(struct hwc_layer_1& hwc1Layer);
             void applySolidColorState(struct hwc_layer_1& hwc1Layer);
             void applySidebandState(struct hwc_layer_1& hwc1Layer);
@@ -605,6 +624,10 @@ private:
 
             size_t mHwc1Id;
             bool mHasUnsupportedPlaneAlpha;
+
+            // True if the state written by applyCommonState() changed since
+            // it was last applied
+            bool mStateChanged;
     };
 
     // Utility tempate calling a Layer object method based on ID parameters:
@@ -24,10 +24,12 @@
 #include <type_traits>
 
 #include <inttypes.h>
+#include <string.h>
 #include <time.h>
 #include <sys/prctl.h>
 #include <unistd.h> // for close
 
+#include <cutils/properties.h>
 #include <hardware/fb.h>
 #include <log/log.h>
 #include <sync/sync.h>
@@ -38,6 +40,16 @@ namespace android {
 
 namespace {
 
+// Number of posts presentDisplay may leave pending, 0 to post synchronously.
+constexpr char kPostQueueDepthProperty[] = "ro.vendor.hwc2onfb.post_queue_depth";
+constexpr int32_t kMaxPostQueueDepth = 2;
+// Whether to anchor vsync to the completion of posts instead of only timing it
+// from the fps of the fb device.
+constexpr char kVsyncFromPostProperty[] = "ro.vendor.hwc2onfb.vsync_from_post";
+// Fraction of the phase error to a post completion that vsync is moved by,
+// so one late post doesn't shift vsync by much.
+constexpr int64_t kVsyncAnchorWeight = 4;
+
 void dumpHook(hwc2_device_t* device, uint32_t* outSize, char* outBuffer) {
     auto& adapter = HWC2OnFbAdapter::cast(device);
     if (outBuffer) {
@@ -664,6 +676,14 @@ HWC2OnFbAdapter::HWC2OnFbAdapter(framebuffer_device_t* fbDevice)
     mCapabilities.insert(Capability::PresentFenceIsNotReliable);
 
     mVsyncThread.start(0, mFbInfo.vsync_period_ns);
+
+    mAnchorVsyncToPost = property_get_bool(kVsyncFromPostProperty, false);
+    int32_t postQueueDepth =
+            std::clamp(property_get_int32(kPostQueueDepthProperty, 0), 0, kMaxPostQueueDepth);
+    if (postQueueDepth > 0) {
+        mPostThread.start(mFbDevice, postQueueDepth,
+                          [this](int64_t timestamp) { onBufferPosted(timestamp); });
+    }
 }
 
 HWC2OnFbAdapter& HWC2OnFbAdapter::cast(hw_device_t* device) {
@@ -683,6 +703,9 @@ hwc2_config_t HWC2OnFbAdapter::getConfigId() {
 }
 
 void HWC2OnFbAdapter::close() {
+    if (mPostThread.isStarted()) {
+        mPostThread.stop();
+    }
     mVsyncThread.stop();
     framebuffer_close(mFbDevice);
 }
@@ -773,6 +796,10 @@ void HWC2OnFbAdapter::clearDirtyLayers() {
  * SurfaceFlinger assumes the front buffer is available for rendering again
  * immediately after the back buffer is posted.  The locking semantics
  * hopefully are strong enough that the rendering will be blocked.
+ *
+ * When kPostQueueDepthProperty is set, post is called from PostThread and
+ * presentDisplay only blocks once that many posts are pending.  That relies
+ * on the same locking semantics, with one more buffer in flight.
  */
 void HWC2OnFbAdapter::setBuffer(buffer_handle_t buffer) {
     if (mFbDevice->compositionComplete) {
@@ -782,14 +809,26 @@ void HWC2OnFbAdapter::setBuffer(buffer_handle_t buffer) {
 }
 
 bool HWC2OnFbAdapter::postBuffer() {
-    int error = 0;
-    if (mBuffer) {
-        error = mFbDevice->post(mFbDevice, mBuffer);
+    if (!mBuffer) {
+        return true;
+    }
+    if (mPostThread.isStarted()) {
+        return mPostThread.post(mBuffer);
     }
 
+    int error = mFbDevice->post(mFbDevice, mBuffer);
+    if (error == 0) {
+        onBufferPosted(VsyncThread::now());
+    }
     return error == 0;
 }
 
+void HWC2OnFbAdapter::onBufferPosted(int64_t timestamp) {
+    if (mAnchorVsyncToPost) {
+        mVsyncThread.anchorTo(timestamp);
+    }
+}
+
 void HWC2OnFbAdapter::setVsyncCallback(HWC2_PFN_VSYNC callback, hwc2_callback_data_t data) {
     mVsyncThread.setCallback(callback, data);
 }
@@ -870,6 +909,21 @@ void HWC2OnFbAdapter::VsyncThread::enableCallback(bool enable) {
     mCondition.notify_all();
 }
 
+void HWC2OnFbAdapter::VsyncThread::anchorTo(int64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Phase error of the timestamp to the closest software vsync, in
+    // [-mPeriod / 2, mPeriod / 2).
+    int64_t error = (timestamp - mNextVsync) % mPeriod;
+    if (error < 0) {
+        error += mPeriod;
+    }
+    if (error >= mPeriod / 2) {
+        error -= mPeriod;
+    }
+    mPhaseShift = error / kVsyncAnchorWeight;
+}
+
 void HWC2OnFbAdapter::VsyncThread::vsyncLoop() {
     prctl(PR_SET_NAME, "VsyncThread", 0, 0, 0);
 
@@ -886,15 +940,18 @@ void HWC2OnFbAdapter::VsyncThread::vsyncLoop() {
             }
         }
 
-        lock.unlock();
-
         // adjust mNextVsync if necessary
         int64_t t = now();
         if (mNextVsync < t) {
             int64_t n = (t - mNextVsync + mPeriod - 1) / mPeriod;
             mNextVsync += mPeriod * n;
         }
-        bool fire = sleepUntil(mNextVsync);
+        // anchorTo reads mNextVsync while we sleep
+        const int64_t nextVsync = mNextVsync;
+
+        lock.unlock();
+
+        bool fire = sleepUntil(nextVsync);
 
         lock.lock();
 
@@ -905,6 +962,70 @@ void HWC2OnFbAdapter::VsyncThread::vsyncLoop() {
             }
             mNextVsync += mPeriod;
         }
+        mNextVsync += mPhaseShift;
+        mPhaseShift = 0;
+    }
+}
+
+void HWC2OnFbAdapter::PostThread::start(framebuffer_device_t* device, size_t depth,
+                                        std::function<void(int64_t)> onPosted) {
+    mDevice = device;
+    mDepth = depth;
+    mOnPosted = std::move(onPosted);
+    mStarted = true;
+    mThread = std::thread(&PostThread::postLoop, this);
+}
+
+void HWC2OnFbAdapter::PostThread::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStarted = false;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+bool HWC2OnFbAdapter::PostThread::post(buffer_handle_t buffer) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] { return mQueue.size() < mDepth || !mStarted; });
+    if (!mStarted) {
+        return false;
+    }
+    mQueue.push_back(buffer);
+    mCondition.notify_all();
+
+    bool succeeded = !mPostFailed;
+    mPostFailed = false;
+    return succeeded;
+}
+
+void HWC2OnFbAdapter::PostThread::postLoop() {
+    prctl(PR_SET_NAME, "PostThread", 0, 0, 0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        // Pending posts are still done when stopping, the buffers are ours
+        // until then.
+        mCondition.wait(lock, [this] { return !mQueue.empty() || !mStarted; });
+        if (mQueue.empty()) {
+            break;
+        }
+        buffer_handle_t buffer = mQueue.front();
+        lock.unlock();
+
+        int error = mDevice->post(mDevice, buffer);
+        if (error == 0) {
+            mOnPosted(VsyncThread::now());
+        } else {
+            ALOGE("failed to post buffer: %s", strerror(-error));
+        }
+
+        lock.lock();
+        // Only free the slot once the post is done, so at most |depth| frames
+        // are ahead of the panel.
+        mQueue.pop_front();
+        mPostFailed |= error != 0;
+        mCondition.notify_all();
     }
 }
 
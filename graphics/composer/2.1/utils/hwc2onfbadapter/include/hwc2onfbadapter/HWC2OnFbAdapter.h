@@ -18,6 +18,8 @@
 #define ANDROID_SF_HWC2_ON_FB_ADAPTER_H
 
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -97,6 +99,11 @@ private:
 
     std::unordered_set<HWC2::Capability> mCapabilities;
 
+    // Whether vsync follows the times posts complete, which on most fb
+    // devices wait for the flip at the panel's vsync.
+    bool mAnchorVsyncToPost{false};
+    void onBufferPosted(int64_t timestamp);
+
     class VsyncThread {
     public:
         static int64_t now();
@@ -106,6 +113,9 @@ private:
         void stop();
         void setCallback(HWC2_PFN_VSYNC callback, hwc2_callback_data_t data);
         void enableCallback(bool enable);
+        // Moves the phase of the following vsyncs part of the way towards
+        // |timestamp|, a time the panel is known to have been at vsync.
+        void anchorTo(int64_t timestamp);
 
     private:
         void vsyncLoop();
@@ -121,8 +131,39 @@ private:
         HWC2_PFN_VSYNC mCallback{nullptr};
         hwc2_callback_data_t mCallbackData{nullptr};
         bool mCallbackEnabled{false};
+        // Phase shift from anchorTo, applied by vsyncLoop to mNextVsync.
+        int64_t mPhaseShift{0};
     };
     VsyncThread mVsyncThread;
+
+    // Posts client targets to the fb device in order, letting presentDisplay
+    // return while up to |depth| posts are waiting for their flip, so the
+    // composition of the next frame overlaps the scan-out of this one.
+    class PostThread {
+    public:
+        void start(framebuffer_device_t* device, size_t depth,
+                   std::function<void(int64_t)> onPosted);
+        void stop();
+        bool isStarted() const { return mThread.joinable(); }
+        // Queues |buffer|, blocking while |depth| posts are pending. Returns
+        // false if an earlier post failed.
+        bool post(buffer_handle_t buffer);
+
+    private:
+        void postLoop();
+
+        framebuffer_device_t* mDevice{nullptr};
+        size_t mDepth{0};
+        std::function<void(int64_t)> mOnPosted;
+        std::thread mThread;
+
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mStarted{false};
+        std::deque<buffer_handle_t> mQueue;
+        bool mPostFailed{false};
+    };
+    PostThread mPostThread;
 };
 
 } // namespace android
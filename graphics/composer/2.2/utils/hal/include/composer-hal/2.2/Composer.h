@@ -52,6 +52,7 @@ class ComposerImpl : public V2_1::hal::detail::ComposerImpl<Interface, Hal> {
 
         auto clientDestroyed = [this]() { onClientDestroyed(); };
         client->setOnClientDestroyed(clientDestroyed);
+        setDumpClientCommandStatsLocked(client.get());
 
         return client.release();
     }
@@ -60,6 +61,7 @@ class ComposerImpl : public V2_1::hal::detail::ComposerImpl<Interface, Hal> {
     using BaseType2_1 = V2_1::hal::detail::ComposerImpl<Interface, Hal>;
     using BaseType2_1::mHal;
     using BaseType2_1::onClientDestroyed;
+    using BaseType2_1::setDumpClientCommandStatsLocked;
 };
 
 }  // namespace detail
@@ -35,20 +35,17 @@ namespace hal {
 class ComposerCommandEngine : public V2_1::hal::ComposerCommandEngine {
    public:
     ComposerCommandEngine(ComposerHal* hal, ComposerResources* resources)
-        : BaseType2_1(hal, resources), mHal(hal) {}
-
-   protected:
-    bool executeCommand(V2_1::IComposerClient::Command command, uint16_t length) override {
-        switch (static_cast<IComposerClient::Command>(command)) {
-            case IComposerClient::Command::SET_LAYER_PER_FRAME_METADATA:
-                return executeSetLayerPerFrameMetadata(length);
-            case IComposerClient::Command::SET_LAYER_FLOAT_COLOR:
-                return executeSetLayerFloatColor(length);
-            default:
-                return BaseType2_1::executeCommand(command, length);
-        }
+        : BaseType2_1(hal, resources), mHal(hal) {
+        registerCommandHandler(IComposerClient::Command::SET_LAYER_PER_FRAME_METADATA,
+                               [this](uint16_t length) {
+                                   return executeSetLayerPerFrameMetadata(length);
+                               });
+        registerCommandHandler(
+                IComposerClient::Command::SET_LAYER_FLOAT_COLOR,
+                [this](uint16_t length) { return executeSetLayerFloatColor(length); });
     }
 
+   protected:
     std::unique_ptr<V2_1::CommandWriterBase> createCommandWriter(
             size_t writerInitialSize) override {
         return std::make_unique<CommandWriterBase>(writerInitialSize);
@@ -60,6 +60,7 @@ class ComposerImpl : public V2_3::hal::detail::ComposerImpl<Interface, Hal> {
 
         auto clientDestroyed = [this]() { onClientDestroyed(); };
         client->setOnClientDestroyed(clientDestroyed);
+        setDumpClientCommandStatsLocked(client.get());
 
         mClient = client;
         hidl_cb(Error::NONE, client);
@@ -74,6 +75,7 @@ class ComposerImpl : public V2_3::hal::detail::ComposerImpl<Interface, Hal> {
     using BaseType2_1::mClientMutex;
     using BaseType2_1::mHal;
     using BaseType2_1::onClientDestroyed;
+    using BaseType2_1::setDumpClientCommandStatsLocked;
     using BaseType2_1::waitForClientDestroyedLocked;
 };
 
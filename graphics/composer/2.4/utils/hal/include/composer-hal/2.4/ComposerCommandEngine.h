@@ -36,7 +36,11 @@ namespace hal {
 class ComposerCommandEngine : public V2_3::hal::ComposerCommandEngine {
   public:
     ComposerCommandEngine(ComposerHal* hal, V2_2::hal::ComposerResources* resources)
-        : BaseType2_3(hal, resources), mHal(hal) {}
+        : BaseType2_3(hal, resources), mHal(hal) {
+        registerCommandHandler(
+                IComposerClient::Command::SET_LAYER_GENERIC_METADATA,
+                [this](uint16_t length) { return executeSetLayerGenericMetadata(length); });
+    }
 
   protected:
     std::unique_ptr<V2_1::CommandWriterBase> createCommandWriter(
@@ -74,15 +78,6 @@ class ComposerCommandEngine : public V2_3::hal::ComposerCommandEngine {
 
     CommandWriterBase* getWriter() { return static_cast<CommandWriterBase*>(mWriter.get()); }
 
-    bool executeCommand(V2_1::IComposerClient::Command command, uint16_t length) override {
-        switch (static_cast<IComposerClient::Command>(command)) {
-            case IComposerClient::Command::SET_LAYER_GENERIC_METADATA:
-                return executeSetLayerGenericMetadata(length);
-            default:
-                return BaseType2_3::executeCommand(command, length);
-        }
-    }
-
     bool executeSetLayerGenericMetadata(uint16_t length) {
         // We expect at least two buffer lengths and a mandatory flag
         if (length < 3) {
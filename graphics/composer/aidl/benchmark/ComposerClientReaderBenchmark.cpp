@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/hardware/graphics/composer3/ComposerClientReader.h>
+#include <benchmark/benchmark.h>
+
+namespace aidl::android::hardware::graphics::composer3 {
+
+namespace {
+
+constexpr int64_t kDisplayCount = 3;
+constexpr int64_t kLayerCount = 10;
+
+// The results of presenting a frame on every display: the release fences of all layers, and a
+// changed composition type and a layer request for one of them.
+std::vector<CommandResultPayload> makeResults() {
+    std::vector<CommandResultPayload> results;
+    for (int64_t display = 0; display < kDisplayCount; display++) {
+        ReleaseFences releaseFences;
+        releaseFences.display = display;
+        for (int64_t layer = 0; layer < kLayerCount; layer++) {
+            ReleaseFences::Layer releasedLayer;
+            releasedLayer.layer = layer;
+            releaseFences.layers.push_back(std::move(releasedLayer));
+        }
+        results.emplace_back(std::move(releaseFences));
+
+        ChangedCompositionTypes changedTypes;
+        changedTypes.display = display;
+        changedTypes.layers.push_back({.layer = 0, .composition = Composition::CLIENT});
+        results.emplace_back(std::move(changedTypes));
+
+        DisplayRequest displayRequest;
+        displayRequest.display = display;
+        displayRequest.layerRequests.push_back(
+                {.layer = 0, .mask = DisplayRequest::LayerRequest::CLEAR_CLIENT_TARGET});
+        results.emplace_back(std::move(displayRequest));
+
+        PresentOrValidate presentOrValidate;
+        presentOrValidate.display = display;
+        presentOrValidate.result = PresentOrValidate::Result::Presented;
+        results.emplace_back(std::move(presentOrValidate));
+    }
+    return results;
+}
+
+}  // namespace
+
+// Parses the results of a frame and reads them, by taking them out of the reader or, with
+// storage reuse enabled, in place.
+static void BM_ParseFrame(benchmark::State& state) {
+    const bool reuseStorage = state.range(0);
+    ComposerClientReader reader;
+    reader.setStorageReuseEnabled(reuseStorage);
+    size_t layers = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto results = makeResults();
+        state.ResumeTiming();
+
+        reader.parse(std::move(results));
+        for (int64_t display = 0; display < kDisplayCount; display++) {
+            if (reuseStorage) {
+                layers += reader.getReleaseFences(display).size();
+                layers += reader.getChangedCompositionTypes(display).size();
+                layers += reader.getDisplayRequests(display).layerRequests.size();
+            } else {
+                layers += reader.takeReleaseFences(display).size();
+                layers += reader.takeChangedCompositionTypes(display).size();
+                layers += reader.takeDisplayRequests(display).layerRequests.size();
+            }
+        }
+    }
+    benchmark::DoNotOptimize(layers);
+}
+BENCHMARK(BM_ParseFrame)->Arg(false)->Arg(true);
+
+}  // namespace aidl::android::hardware::graphics::composer3
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/binder_parcel.h>
+#include <android/hardware/graphics/composer3/ComposerClientWriter.h>
+#include <benchmark/benchmark.h>
+
+#include <functional>
+
+namespace aidl::android::hardware::graphics::composer3 {
+
+namespace {
+
+constexpr int64_t kDisplay = 1;
+constexpr int32_t kWidth = 1080;
+constexpr int32_t kHeight = 2340;
+
+// Sends the full state of a layer, the way a client that does not track what changed does.
+void writeLayer(ComposerClientWriter& writer, int64_t layer, const Rect& frame, uint32_t z,
+                float alpha, const std::vector<Rect>& damage = {}) {
+    const std::vector<Rect> region = {frame};
+    writer.setLayerCompositionType(kDisplay, layer, Composition::DEVICE);
+    writer.setLayerBlendMode(kDisplay, layer, BlendMode::PREMULTIPLIED);
+    writer.setLayerDataspace(kDisplay, layer, Dataspace::SRGB);
+    writer.setLayerDisplayFrame(kDisplay, layer, frame);
+    writer.setLayerSourceCrop(
+            kDisplay, layer,
+            FRect{0.f, 0.f, static_cast<float>(frame.right - frame.left),
+                  static_cast<float>(frame.bottom - frame.top)});
+    writer.setLayerPlaneAlpha(kDisplay, layer, alpha);
+    writer.setLayerTransform(kDisplay, layer, static_cast<Transform>(0));
+    writer.setLayerVisibleRegion(kDisplay, layer, region);
+    writer.setLayerSurfaceDamage(kDisplay, layer, damage);
+    writer.setLayerZOrder(kDisplay, layer, z);
+    writer.setLayerBrightness(kDisplay, layer, 1.f);
+}
+
+// Serializes the commands of a frame the way the binder call to executeCommands would.
+size_t serialize(const std::vector<DisplayCommand>& commands) {
+    AParcel* parcel = AParcel_create();
+    for (const auto& command : commands) {
+        command.writeToParcel(parcel);
+    }
+    const size_t size = AParcel_getDataSize(parcel);
+    AParcel_delete(parcel);
+    return size;
+}
+
+void runFrames(benchmark::State& state, ComposerClientWriter& writer,
+               const std::function<void(ComposerClientWriter&, uint32_t)>& writeFrame) {
+    writer.setLayerStateCacheEnabled(state.range(0));
+    uint32_t frame = 0;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        writeFrame(writer, frame++);
+        writer.validateDisplay(kDisplay, ComposerClientWriter::kNoTimestamp);
+        bytes += serialize(writer.getPendingCommands());
+        writer.reset();
+    }
+    state.counters["bytes_per_frame"] =
+            benchmark::Counter(bytes / static_cast<double>(state.iterations()));
+}
+
+}  // namespace
+
+// A launcher: wallpaper, app grid, status and navigation bars and a few widgets, with only the
+// scrolled app grid getting a new buffer each frame.
+static void BM_LauncherFrame(benchmark::State& state) {
+    constexpr int32_t kLayerCount = 10;
+    constexpr int32_t kLayerHeight = kHeight / kLayerCount;
+    ComposerClientWriter writer;
+    runFrames(state, writer, [](ComposerClientWriter& writer, uint32_t frame) {
+        for (int32_t layer = 0; layer < kLayerCount; layer++) {
+            const int32_t top = layer * kLayerHeight;
+            writeLayer(writer, layer, Rect{0, top, kWidth, top + kLayerHeight},
+                       static_cast<uint32_t>(layer), 1.f);
+        }
+        writer.setLayerBuffer(kDisplay, 1, frame % 3, nullptr, -1);
+    });
+}
+BENCHMARK(BM_LauncherFrame)->Arg(false)->Arg(true);
+
+// Video playback: a full screen video layer with a new buffer and damage every frame, and
+// static controls and subtitles above it.
+static void BM_VideoFrame(benchmark::State& state) {
+    ComposerClientWriter writer;
+    runFrames(state, writer, [](ComposerClientWriter& writer, uint32_t frame) {
+        const Rect fullScreen = {0, 0, kWidth, kHeight};
+        writeLayer(writer, 0, fullScreen, 0, 1.f, {fullScreen});
+        writer.setLayerBuffer(kDisplay, 0, frame % 3, nullptr, -1);
+        writeLayer(writer, 1, Rect{0, kHeight - 300, kWidth, kHeight}, 1, 0.8f);
+        writeLayer(writer, 2, Rect{0, kHeight - 500, kWidth, kHeight - 300}, 2, 1.f);
+    });
+}
+BENCHMARK(BM_VideoFrame)->Arg(false)->Arg(true);
+
+}  // namespace aidl::android::hardware::graphics::composer3
+
+BENCHMARK_MAIN();
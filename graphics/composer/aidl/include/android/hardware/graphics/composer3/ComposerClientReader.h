@@ -19,8 +19,10 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <inttypes.h>
@@ -43,6 +45,20 @@ class ComposerClientReader {
   public:
     ~ComposerClientReader() { resetData(); }
 
+    // With storage reuse enabled, parse() keeps the results slot of every display from one frame
+    // to the next instead of allocating a map node per display and frame. The result vectors are
+    // adopted from the parsed payloads, whose buffers were allocated when reading them anyway.
+    // Read the results in place with the get*() accessors, or take them out with take*().
+    void setStorageReuseEnabled(bool enabled) {
+        mStorageReuseEnabled = enabled;
+        mReturnData.clear();
+    }
+
+    // With storage reuse enabled, the slot of a display without results for this many parse()
+    // calls in a row is freed by the next one, which bounds the storage kept for displays that
+    // were disconnected.
+    static constexpr uint32_t kMaxIdleParses = 64;
+
     // Parse and execute commands from the command queue.  The commands are
     // actually return values from the server and will be saved in ReturnData.
     void parse(std::vector<CommandResultPayload>&& results) {
@@ -85,14 +101,14 @@ class ComposerClientReader {
 
     void hasChanges(int64_t display, uint32_t* outNumChangedCompositionTypes,
                     uint32_t* outNumLayerRequestMasks) const {
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        const ReturnData* found = findReturnData(display);
+        if (found == nullptr) {
             *outNumChangedCompositionTypes = 0;
             *outNumLayerRequestMasks = 0;
             return;
         }
 
-        const ReturnData& data = found->second;
+        const ReturnData& data = *found;
 
         *outNumChangedCompositionTypes = static_cast<uint32_t>(data.changedLayers.size());
         *outNumLayerRequestMasks = static_cast<uint32_t>(data.displayRequests.layerRequests.size());
@@ -100,126 +116,216 @@ class ComposerClientReader {
 
     // Get and clear saved changed composition types.
     std::vector<ChangedCompositionLayer> takeChangedCompositionTypes(int64_t display) {
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findReturnData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.changedLayers);
     }
 
     // Get and clear saved display requests.
     DisplayRequest takeDisplayRequests(int64_t display) {
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findReturnData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.displayRequests);
     }
 
     // Get and clear saved release fences.
     std::vector<ReleaseFences::Layer> takeReleaseFences(int64_t display) {
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findReturnData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.releasedLayers);
     }
 
     // Get and clear saved present fence.
     ndk::ScopedFileDescriptor takePresentFence(int64_t display) {
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
+        ReturnData* found = findReturnData(display);
+        if (found == nullptr) {
             return {};
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.presentFence);
     }
 
     // Get what stage succeeded during PresentOrValidate: Present or Validate
     std::optional<PresentOrValidate::Result> takePresentOrValidateStage(int64_t display) {
-        auto found = mReturnData.find(display);
-        if (found == mReturnData.end()) {
-            return std::nullopt;
-        }
-        ReturnData& data = found->second;
-        return data.presentOrValidateState;
+        return getPresentOrValidateStage(display);
     }
 
     // Get the client target properties requested by hardware composer.
     ClientTargetPropertyWithBrightness takeClientTargetProperty(int64_t display) {
-        auto found = mReturnData.find(display);
+        ReturnData* found = findReturnData(display);
 
         // If not found, return the default values.
-        if (found == mReturnData.end()) {
-            return ClientTargetPropertyWithBrightness{
-                    .clientTargetProperty = {common::PixelFormat::RGBA_8888, Dataspace::UNKNOWN},
-                    .brightness = 1.f,
-            };
+        if (found == nullptr) {
+            return emptyReturnData().clientTargetProperty;
         }
 
-        ReturnData& data = found->second;
+        ReturnData& data = *found;
         return std::move(data.clientTargetProperty);
     }
 
+    // Accessors to the results of the last parse() that leave them in place. The references
+    // are valid until the next parse(); displays without results get the default values.
+    const std::vector<CommandError>& getErrors() const { return mErrors; }
+
+    const std::vector<ChangedCompositionLayer>& getChangedCompositionTypes(int64_t display) const {
+        return getReturnData(display).changedLayers;
+    }
+
+    const DisplayRequest& getDisplayRequests(int64_t display) const {
+        return getReturnData(display).displayRequests;
+    }
+
+    const std::vector<ReleaseFences::Layer>& getReleaseFences(int64_t display) const {
+        return getReturnData(display).releasedLayers;
+    }
+
+    const ndk::ScopedFileDescriptor& getPresentFence(int64_t display) const {
+        return getReturnData(display).presentFence;
+    }
+
+    std::optional<PresentOrValidate::Result> getPresentOrValidateStage(int64_t display) const {
+        const ReturnData* found = findReturnData(display);
+        if (found == nullptr) {
+            return std::nullopt;
+        }
+        return found->presentOrValidateState;
+    }
+
+    const ClientTargetPropertyWithBrightness& getClientTargetProperty(int64_t display) const {
+        return getReturnData(display).clientTargetProperty;
+    }
+
+    // The number of displays results are stored for, including the idle ones whose slot is kept
+    // for reuse.
+    size_t getStorageSlotCount() const { return mReturnData.size(); }
+
   private:
+    struct ReturnData {
+        DisplayRequest displayRequests;
+        std::vector<ChangedCompositionLayer> changedLayers;
+        ndk::ScopedFileDescriptor presentFence;
+        std::vector<ReleaseFences::Layer> releasedLayers;
+        PresentOrValidate::Result presentOrValidateState;
+
+        ClientTargetPropertyWithBrightness clientTargetProperty = {
+                .clientTargetProperty = {common::PixelFormat::RGBA_8888, Dataspace::UNKNOWN},
+                .brightness = 1.f,
+        };
+
+        // Whether the last parse() had results for the display; slots without are kept when
+        // storage is reused
+        bool hasResults = false;
+        // The number of parse() calls in a row without results for the display
+        uint32_t idleParses = 0;
+
+        // Resets the results in place
+        void clear() {
+            displayRequests.mask = 0;
+            displayRequests.layerRequests.clear();
+            changedLayers.clear();
+            presentFence.set(-1);
+            releasedLayers.clear();
+            presentOrValidateState = {};
+            clientTargetProperty = emptyReturnData().clientTargetProperty;
+            hasResults = false;
+        }
+    };
+
+    static const ReturnData& emptyReturnData() {
+        static const ReturnData kEmpty{};
+        return kEmpty;
+    }
+
+    const ReturnData* findReturnData(int64_t display) const {
+        auto found = mReturnData.find(display);
+        if (found == mReturnData.end() || !found->second.hasResults) {
+            return nullptr;
+        }
+        return &found->second;
+    }
+
+    ReturnData* findReturnData(int64_t display) {
+        return const_cast<ReturnData*>(std::as_const(*this).findReturnData(display));
+    }
+
+    const ReturnData& getReturnData(int64_t display) const {
+        const ReturnData* found = findReturnData(display);
+        return found == nullptr ? emptyReturnData() : *found;
+    }
+
+    // Returns the slot to parse results of the display into
+    ReturnData& getReturnDataSlot(int64_t display) {
+        auto& data = mReturnData[display];
+        data.hasResults = true;
+        return data;
+    }
+
     void resetData() {
         mErrors.clear();
-        mReturnData.clear();
+        if (!mStorageReuseEnabled) {
+            mReturnData.clear();
+            return;
+        }
+
+        for (auto it = mReturnData.begin(); it != mReturnData.end();) {
+            ReturnData& data = it->second;
+            data.idleParses = data.hasResults ? 0 : data.idleParses + 1;
+            if (data.idleParses >= kMaxIdleParses) {
+                it = mReturnData.erase(it);
+                continue;
+            }
+            data.clear();
+            ++it;
+        }
     }
 
     void parseSetError(CommandError&& error) { mErrors.emplace_back(error); }
 
     void parseSetChangedCompositionTypes(ChangedCompositionTypes&& changedCompositionTypes) {
-        auto& data = mReturnData[changedCompositionTypes.display];
+        auto& data = getReturnDataSlot(changedCompositionTypes.display);
         data.changedLayers = std::move(changedCompositionTypes.layers);
     }
 
     void parseSetDisplayRequests(DisplayRequest&& displayRequest) {
-        auto& data = mReturnData[displayRequest.display];
+        auto& data = getReturnDataSlot(displayRequest.display);
         data.displayRequests = std::move(displayRequest);
     }
 
     void parseSetPresentFence(PresentFence&& presentFence) {
-        auto& data = mReturnData[presentFence.display];
+        auto& data = getReturnDataSlot(presentFence.display);
         data.presentFence = std::move(presentFence.fence);
     }
 
     void parseSetReleaseFences(ReleaseFences&& releaseFences) {
-        auto& data = mReturnData[releaseFences.display];
+        auto& data = getReturnDataSlot(releaseFences.display);
         data.releasedLayers = std::move(releaseFences.layers);
     }
 
     void parseSetPresentOrValidateDisplayResult(const PresentOrValidate&& presentOrValidate) {
-        auto& data = mReturnData[presentOrValidate.display];
+        auto& data = getReturnDataSlot(presentOrValidate.display);
         data.presentOrValidateState = std::move(presentOrValidate.result);
     }
 
     void parseSetClientTargetProperty(
             const ClientTargetPropertyWithBrightness&& clientTargetProperty) {
-        auto& data = mReturnData[clientTargetProperty.display];
+        auto& data = getReturnDataSlot(clientTargetProperty.display);
         data.clientTargetProperty = std::move(clientTargetProperty);
     }
 
-    struct ReturnData {
-        DisplayRequest displayRequests;
-        std::vector<ChangedCompositionLayer> changedLayers;
-        ndk::ScopedFileDescriptor presentFence;
-        std::vector<ReleaseFences::Layer> releasedLayers;
-        PresentOrValidate::Result presentOrValidateState;
-
-        ClientTargetPropertyWithBrightness clientTargetProperty = {
-                .clientTargetProperty = {common::PixelFormat::RGBA_8888, Dataspace::UNKNOWN},
-                .brightness = 1.f,
-        };
-    };
-
+    bool mStorageReuseEnabled = false;
     std::vector<CommandError> mErrors;
     std::unordered_map<int64_t, ReturnData> mReturnData;
 };
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -73,6 +74,30 @@ class ComposerClientWriter {
         mCommands.clear();
     }
 
+    // With the layer state cache enabled, a layer setter called with the same value as the
+    // previous call for that layer is dropped, so only changed state is sent. Layer state is
+    // sticky in the composer, so this is only correct while the composer applied everything we
+    // sent: invalidate the cache when commands failed, layers were destroyed or displays were
+    // reconnected. Buffers and sideband streams are always sent, and surface damage is sent again
+    // after each new buffer.
+    void setLayerStateCacheEnabled(bool enabled) {
+        mLayerStateCacheEnabled = enabled;
+        invalidateLayerStateCache();
+    }
+
+    // Forgets all cached layer state, so the next frame sends the full state of every layer.
+    void invalidateLayerStateCache() {
+        mLayerStates.clear();
+        mCurrentLayerState = nullptr;
+    }
+
+    // Forgets the cached state of one layer, e.g. after it was destroyed.
+    void invalidateLayerStateCache(int64_t display, int64_t layer) {
+        auto displayStates = mLayerStates.find(display);
+        if (displayStates != mLayerStates.end()) displayStates->second.erase(layer);
+        mCurrentLayerState = nullptr;
+    }
+
     void setColorTransform(int64_t display, const float* matrix) {
         std::vector<float> matVec;
         matVec.reserve(16);
@@ -124,45 +149,55 @@ class ComposerClientWriter {
         common::Point cursorPosition;
         cursorPosition.x = x;
         cursorPosition.y = y;
+        if (!layerStateChanged(display, layer, &LayerState::cursorPosition, cursorPosition)) return;
         getLayerCommand(display, layer).cursorPosition.emplace(std::move(cursorPosition));
     }
 
     void setLayerBuffer(int64_t display, int64_t layer, uint32_t slot,
                         const native_handle_t* buffer, int acquireFence) {
+        // Surface damage is relative to the previous buffer, send it again with the next one
+        if (mLayerStateCacheEnabled) getLayerState(display, layer).damage.reset();
         getLayerCommand(display, layer).buffer = getBuffer(slot, buffer, acquireFence);
     }
 
     void setLayerSurfaceDamage(int64_t display, int64_t layer, const std::vector<Rect>& damage) {
+        if (!layerStateChanged(display, layer, &LayerState::damage, damage)) return;
         getLayerCommand(display, layer).damage.emplace(damage.begin(), damage.end());
     }
 
     void setLayerBlendMode(int64_t display, int64_t layer, BlendMode mode) {
+        if (!layerStateChanged(display, layer, &LayerState::blendMode, mode)) return;
         ParcelableBlendMode parcelableBlendMode;
         parcelableBlendMode.blendMode = mode;
         getLayerCommand(display, layer).blendMode.emplace(std::move(parcelableBlendMode));
     }
 
     void setLayerColor(int64_t display, int64_t layer, Color color) {
+        if (!layerStateChanged(display, layer, &LayerState::color, color)) return;
         getLayerCommand(display, layer).color.emplace(std::move(color));
     }
 
     void setLayerCompositionType(int64_t display, int64_t layer, Composition type) {
+        if (!layerStateChanged(display, layer, &LayerState::composition, type)) return;
         ParcelableComposition compositionPayload;
         compositionPayload.composition = type;
         getLayerCommand(display, layer).composition.emplace(std::move(compositionPayload));
     }
 
     void setLayerDataspace(int64_t display, int64_t layer, Dataspace dataspace) {
+        if (!layerStateChanged(display, layer, &LayerState::dataspace, dataspace)) return;
         ParcelableDataspace dataspacePayload;
         dataspacePayload.dataspace = dataspace;
         getLayerCommand(display, layer).dataspace.emplace(std::move(dataspacePayload));
     }
 
     void setLayerDisplayFrame(int64_t display, int64_t layer, const Rect& frame) {
+        if (!layerStateChanged(display, layer, &LayerState::displayFrame, frame)) return;
         getLayerCommand(display, layer).displayFrame.emplace(frame);
     }
 
     void setLayerPlaneAlpha(int64_t display, int64_t layer, float alpha) {
+        if (!layerStateChanged(display, layer, &LayerState::planeAlpha, alpha)) return;
         PlaneAlpha planeAlpha;
         planeAlpha.alpha = alpha;
         getLayerCommand(display, layer).planeAlpha.emplace(std::move(planeAlpha));
@@ -175,20 +210,24 @@ class ComposerClientWriter {
     }
 
     void setLayerSourceCrop(int64_t display, int64_t layer, const FRect& crop) {
+        if (!layerStateChanged(display, layer, &LayerState::sourceCrop, crop)) return;
         getLayerCommand(display, layer).sourceCrop.emplace(crop);
     }
 
     void setLayerTransform(int64_t display, int64_t layer, Transform transform) {
+        if (!layerStateChanged(display, layer, &LayerState::transform, transform)) return;
         ParcelableTransform transformPayload;
         transformPayload.transform = transform;
         getLayerCommand(display, layer).transform.emplace(std::move(transformPayload));
     }
 
     void setLayerVisibleRegion(int64_t display, int64_t layer, const std::vector<Rect>& visible) {
+        if (!layerStateChanged(display, layer, &LayerState::visibleRegion, visible)) return;
         getLayerCommand(display, layer).visibleRegion.emplace(visible.begin(), visible.end());
     }
 
     void setLayerZOrder(int64_t display, int64_t layer, uint32_t z) {
+        if (!layerStateChanged(display, layer, &LayerState::z, z)) return;
         ZOrder zorder;
         zorder.z = static_cast<int32_t>(z);
         getLayerCommand(display, layer).z.emplace(std::move(zorder));
@@ -196,26 +235,35 @@ class ComposerClientWriter {
 
     void setLayerPerFrameMetadata(int64_t display, int64_t layer,
                                   const std::vector<PerFrameMetadata>& metadataVec) {
+        if (!layerStateChanged(display, layer, &LayerState::perFrameMetadata, metadataVec)) return;
         getLayerCommand(display, layer)
                 .perFrameMetadata.emplace(metadataVec.begin(), metadataVec.end());
     }
 
     void setLayerColorTransform(int64_t display, int64_t layer, const float* matrix) {
+        if (mLayerStateCacheEnabled &&
+            !layerStateChanged(display, layer, &LayerState::colorTransform,
+                               std::vector<float>(matrix, matrix + 16))) {
+            return;
+        }
         getLayerCommand(display, layer).colorTransform.emplace(matrix, matrix + 16);
     }
 
     void setLayerPerFrameMetadataBlobs(int64_t display, int64_t layer,
                                        const std::vector<PerFrameMetadataBlob>& metadata) {
+        if (!layerStateChanged(display, layer, &LayerState::perFrameMetadataBlob, metadata)) return;
         getLayerCommand(display, layer)
                 .perFrameMetadataBlob.emplace(metadata.begin(), metadata.end());
     }
 
     void setLayerBrightness(int64_t display, int64_t layer, float brightness) {
+        if (!layerStateChanged(display, layer, &LayerState::brightness, brightness)) return;
         getLayerCommand(display, layer)
                 .brightness.emplace(LayerBrightness{.brightness = brightness});
     }
 
     void setLayerBlockingRegion(int64_t display, int64_t layer, const std::vector<Rect>& blocking) {
+        if (!layerStateChanged(display, layer, &LayerState::blockingRegion, blocking)) return;
         getLayerCommand(display, layer).blockingRegion.emplace(blocking.begin(), blocking.end());
     }
 
@@ -226,10 +274,60 @@ class ComposerClientWriter {
     }
 
   private:
+    // The layer state last sent to the composer, for the layer state cache
+    struct LayerState {
+        std::optional<common::Point> cursorPosition;
+        std::optional<std::vector<Rect>> damage;
+        std::optional<BlendMode> blendMode;
+        std::optional<Color> color;
+        std::optional<Composition> composition;
+        std::optional<Dataspace> dataspace;
+        std::optional<Rect> displayFrame;
+        std::optional<float> planeAlpha;
+        std::optional<FRect> sourceCrop;
+        std::optional<Transform> transform;
+        std::optional<std::vector<Rect>> visibleRegion;
+        std::optional<uint32_t> z;
+        std::optional<std::vector<PerFrameMetadata>> perFrameMetadata;
+        std::optional<std::vector<float>> colorTransform;
+        std::optional<std::vector<PerFrameMetadataBlob>> perFrameMetadataBlob;
+        std::optional<float> brightness;
+        std::optional<std::vector<Rect>> blockingRegion;
+    };
+
     std::optional<DisplayCommand> mDisplayCommand;
     std::optional<LayerCommand> mLayerCommand;
     std::vector<DisplayCommand> mCommands;
 
+    bool mLayerStateCacheEnabled = false;
+    std::unordered_map<int64_t, std::unordered_map<int64_t, LayerState>> mLayerStates;
+    // The last looked up entry of mLayerStates, setters usually come in runs for one layer
+    LayerState* mCurrentLayerState = nullptr;
+    int64_t mCurrentLayerStateDisplay = 0;
+    int64_t mCurrentLayerStateLayer = 0;
+
+    LayerState& getLayerState(int64_t display, int64_t layer) {
+        if (!mCurrentLayerState || mCurrentLayerStateDisplay != display ||
+            mCurrentLayerStateLayer != layer) {
+            mCurrentLayerState = &mLayerStates[display][layer];
+            mCurrentLayerStateDisplay = display;
+            mCurrentLayerStateLayer = layer;
+        }
+        return *mCurrentLayerState;
+    }
+
+    // Returns whether value has to be sent, i.e. the cache is disabled or the value differs from
+    // the one last sent for the layer, and remembers it as sent.
+    template <typename T>
+    bool layerStateChanged(int64_t display, int64_t layer, std::optional<T> LayerState::*field,
+                           const T& value) {
+        if (!mLayerStateCacheEnabled) return true;
+        std::optional<T>& cached = getLayerState(display, layer).*field;
+        if (cached.has_value() && *cached == value) return false;
+        cached = value;
+        return true;
+    }
+
     Buffer getBuffer(uint32_t slot, const native_handle_t* bufferHandle, int fence) {
         Buffer bufferCommand;
         bufferCommand.slot = static_cast<int32_t>(slot);
@@ -22,61 +22,88 @@
 #include <string.h>
 
 #include <algorithm>
+#include <array>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Util.h"
 
 namespace aidl::android::hardware::graphics::composer3::impl {
 
+// The changed composition types, display requests and release fences of a display are each
+// coalesced into one result per batch: a later set*() call replaces what an earlier one wrote, as
+// clients only keep the last result of a display anyway, and the emplace*() calls append to it in
+// place. The layer arrays of these results are pre-sized from the previous batch of their display.
 class ComposerServiceWriter {
   public:
     ComposerServiceWriter() { reset(); }
 
     virtual ~ComposerServiceWriter() { reset(); }
 
-    void reset() { mCommandsResults.clear(); }
+    void reset() {
+        mCommandsResults.clear();
+        for (auto& [display, slot] : mDisplaySlots) {
+            slot.pending.fill(kNoResult);
+        }
+    }
 
     void setError(int32_t index, int32_t errorCode) {
         CommandError error;
         error.commandIndex = index;
         error.errorCode = errorCode;
-        mCommandsResults.emplace_back(std::move(error));
+        addResult(std::move(error));
     }
 
     void setPresentOrValidateResult(int64_t display, PresentOrValidate::Result result) {
         PresentOrValidate presentOrValidate;
         presentOrValidate.display = display;
         presentOrValidate.result = result;
-        mCommandsResults.emplace_back(std::move(presentOrValidate));
+        addResult(std::move(presentOrValidate));
     }
 
     void setChangedCompositionTypes(int64_t display, const std::vector<int64_t>& layers,
                                     const std::vector<Composition>& types) {
-        ChangedCompositionTypes changedCompositionTypes;
-        changedCompositionTypes.display = display;
-        changedCompositionTypes.layers.reserve(layers.size());
+        auto& changedLayers =
+                getPendingLayers<CommandResultPayload::Tag::changedCompositionTypes>(display, true);
+        changedLayers.reserve(layers.size());
         for (int i = 0; i < layers.size(); i++) {
-            auto layer = ChangedCompositionLayer{.layer = layers[i], .composition = types[i]};
-            changedCompositionTypes.layers.emplace_back(std::move(layer));
+            changedLayers.push_back({.layer = layers[i], .composition = types[i]});
         }
-        mCommandsResults.emplace_back(std::move(changedCompositionTypes));
+    }
+
+    // Adds one layer to the changed composition types of the display.
+    void emplaceChangedCompositionType(int64_t display, int64_t layer, Composition type) {
+        getPendingLayers<CommandResultPayload::Tag::changedCompositionTypes>(display, false)
+                .push_back({.layer = layer, .composition = type});
     }
 
     void setDisplayRequests(int64_t display, int32_t displayRequestMask,
                             const std::vector<int64_t>& layers,
                             const std::vector<int32_t>& layerRequestMasks) {
-        DisplayRequest displayRequest;
-        displayRequest.display = display;
-        displayRequest.mask = displayRequestMask;
-        displayRequest.layerRequests.reserve(layers.size());
+        auto& layerRequests =
+                getPendingLayers<CommandResultPayload::Tag::displayRequest>(display, true);
+        layerRequests.reserve(layers.size());
         for (int i = 0; i < layers.size(); i++) {
-            auto layerRequest =
-                    DisplayRequest::LayerRequest{.layer = layers[i], .mask = layerRequestMasks[i]};
-            displayRequest.layerRequests.emplace_back(std::move(layerRequest));
+            layerRequests.push_back({.layer = layers[i], .mask = layerRequestMasks[i]});
         }
-        mCommandsResults.emplace_back(std::move(displayRequest));
+        setDisplayRequestMask(display, displayRequestMask);
+    }
+
+    // Sets the display request mask of the display, keeping the layer requests added so far.
+    void setDisplayRequestMask(int64_t display, int32_t displayRequestMask) {
+        getPendingResult<CommandResultPayload::Tag::displayRequest>(display).mask =
+                displayRequestMask;
+    }
+
+    // Adds one layer to the display requests of the display.
+    void emplaceLayerRequest(int64_t display, int64_t layer, int32_t layerRequestMask) {
+        getPendingLayers<CommandResultPayload::Tag::displayRequest>(display, false)
+                .push_back({.layer = layer, .mask = layerRequestMask});
     }
 
     void setPresentFence(int64_t display, ::ndk::ScopedFileDescriptor presentFence) {
@@ -84,7 +111,7 @@ class ComposerServiceWriter {
             PresentFence presentFenceCommand;
             presentFenceCommand.fence = std::move(presentFence);
             presentFenceCommand.display = display;
-            mCommandsResults.emplace_back(std::move(presentFenceCommand));
+            addResult(std::move(presentFenceCommand));
         } else {
             LOG(WARNING) << __func__ << ": invalid present fence " << presentFence.get();
         }
@@ -92,19 +119,19 @@ class ComposerServiceWriter {
 
     void setReleaseFences(int64_t display, const std::vector<int64_t>& layers,
                           std::vector<::ndk::ScopedFileDescriptor> releaseFences) {
-        ReleaseFences releaseFencesCommand;
-        releaseFencesCommand.display = display;
+        auto& releasedLayers =
+                getPendingLayers<CommandResultPayload::Tag::releaseFences>(display, true);
         for (int i = 0; i < layers.size(); i++) {
-            if (releaseFences[i].get() >= 0) {
-                ReleaseFences::Layer layer;
-                layer.layer = layers[i];
-                layer.fence = std::move(releaseFences[i]);
-                releaseFencesCommand.layers.emplace_back(std::move(layer));
-            } else {
-                LOG(WARNING) << __func__ << ": invalid release fence " << releaseFences[i].get();
-            }
+            addReleaseFence(&releasedLayers, layers[i], std::move(releaseFences[i]));
         }
-        mCommandsResults.emplace_back(std::move(releaseFencesCommand));
+    }
+
+    // Adds the release fence of one layer to the release fences of the display.
+    void emplaceReleaseFence(int64_t display, int64_t layer,
+                             ::ndk::ScopedFileDescriptor releaseFence) {
+        addReleaseFence(
+                &getPendingLayers<CommandResultPayload::Tag::releaseFences>(display, false),
+                layer, std::move(releaseFence));
     }
 
     void setClientTargetProperty(int64_t display, const ClientTargetProperty& clientTargetProperty,
@@ -114,15 +141,137 @@ class ComposerServiceWriter {
         clientTargetPropertyWithBrightness.clientTargetProperty = clientTargetProperty;
         clientTargetPropertyWithBrightness.brightness = brightness;
         clientTargetPropertyWithBrightness.dimmingStage = dimmingStage;
-        mCommandsResults.emplace_back(std::move(clientTargetPropertyWithBrightness));
+        addResult(std::move(clientTargetPropertyWithBrightness));
     }
 
     std::vector<CommandResultPayload> getPendingCommandResults() {
-        return std::move(mCommandsResults);
+        for (auto it = mDisplaySlots.begin(); it != mDisplaySlots.end();) {
+            DisplaySlot& slot = it->second;
+            bool hasResults = false;
+            for (size_t kind = 0; kind < kLayerResultCount; kind++) {
+                if (slot.pending[kind] != kNoResult) {
+                    slot.layerCounts[kind] = getLayerCount(mCommandsResults[slot.pending[kind]]);
+                    slot.pending[kind] = kNoResult;
+                    hasResults = true;
+                }
+            }
+            slot.idleBatches = hasResults ? 0 : slot.idleBatches + 1;
+            it = slot.idleBatches > kMaxIdleBatches ? mDisplaySlots.erase(it) : std::next(it);
+        }
+
+        mResultCountHint = mCommandsResults.size();
+        std::vector<CommandResultPayload> results = std::move(mCommandsResults);
+        mCommandsResults.clear();
+        return results;
     }
 
   private:
+    // The results coalesced per display, indexing DisplaySlot::pending and layerCounts
+    static constexpr size_t kLayerResultCount = 3;
+    static constexpr size_t kNoResult = std::numeric_limits<size_t>::max();
+    // Slots of displays without coalesced results for this many batches are freed
+    static constexpr uint32_t kMaxIdleBatches = 64;
+
+    struct DisplaySlot {
+        // Indices in mCommandsResults of the results of the current batch
+        std::array<size_t, kLayerResultCount> pending = {kNoResult, kNoResult, kNoResult};
+        // Layer counts of the same results in the last batch that had them
+        std::array<size_t, kLayerResultCount> layerCounts = {};
+        uint32_t idleBatches = 0;
+    };
+
+    static constexpr size_t getLayerResultKind(CommandResultPayload::Tag tag) {
+        switch (tag) {
+            case CommandResultPayload::Tag::changedCompositionTypes:
+                return 0;
+            case CommandResultPayload::Tag::displayRequest:
+                return 1;
+            default:
+                return 2;
+        }
+    }
+
+    static std::vector<ChangedCompositionLayer>& getLayers(ChangedCompositionTypes& result) {
+        return result.layers;
+    }
+    static std::vector<DisplayRequest::LayerRequest>& getLayers(DisplayRequest& result) {
+        return result.layerRequests;
+    }
+    static std::vector<ReleaseFences::Layer>& getLayers(ReleaseFences& result) {
+        return result.layers;
+    }
+
+    static void addReleaseFence(std::vector<ReleaseFences::Layer>* releasedLayers, int64_t layer,
+                                ::ndk::ScopedFileDescriptor releaseFence) {
+        if (releaseFence.get() >= 0) {
+            ReleaseFences::Layer& releasedLayer = releasedLayers->emplace_back();
+            releasedLayer.layer = layer;
+            releasedLayer.fence = std::move(releaseFence);
+        } else {
+            LOG(WARNING) << __func__ << ": invalid release fence " << releaseFence.get();
+        }
+    }
+
+    static size_t getLayerCount(CommandResultPayload& result) {
+        switch (result.getTag()) {
+            case CommandResultPayload::Tag::changedCompositionTypes:
+                return getLayers(result.get<CommandResultPayload::Tag::changedCompositionTypes>())
+                        .size();
+            case CommandResultPayload::Tag::displayRequest:
+                return getLayers(result.get<CommandResultPayload::Tag::displayRequest>()).size();
+            case CommandResultPayload::Tag::releaseFences:
+                return getLayers(result.get<CommandResultPayload::Tag::releaseFences>()).size();
+            default:
+                return 0;
+        }
+    }
+
+    template <CommandResultPayload::Tag tag>
+    using ResultOf = std::decay_t<decltype(std::declval<CommandResultPayload&>().get<tag>())>;
+    template <CommandResultPayload::Tag tag>
+    using Layers = std::decay_t<decltype(getLayers(std::declval<ResultOf<tag>&>()))>;
+
+    // Reserves the results of a batch to the size of the previous one with its first result, so
+    // that batches without results do not allocate.
+    template <typename T>
+    void addResult(T&& result) {
+        if (mCommandsResults.empty()) {
+            mCommandsResults.reserve(mResultCountHint);
+        }
+        mCommandsResults.emplace_back(std::forward<T>(result));
+    }
+
+    // Returns the result of the display for the current batch, adding it if there is none
+    template <CommandResultPayload::Tag tag>
+    ResultOf<tag>& getPendingResult(int64_t display) {
+        DisplaySlot& slot = mDisplaySlots[display];
+        const size_t kind = getLayerResultKind(tag);
+        if (slot.pending[kind] == kNoResult) {
+            slot.pending[kind] = mCommandsResults.size();
+            addResult(CommandResultPayload::make<tag>());
+            auto& result = mCommandsResults.back().get<tag>();
+            result.display = display;
+            getLayers(result).reserve(slot.layerCounts[kind]);
+            return result;
+        }
+        return mCommandsResults[slot.pending[kind]].get<tag>();
+    }
+
+    // Returns the layer array of the result of the display for the current batch, emptied if
+    // clear is set, as a later set*() call replaces the layers of an earlier one.
+    template <CommandResultPayload::Tag tag>
+    Layers<tag>& getPendingLayers(int64_t display, bool clear) {
+        auto& layers = getLayers(getPendingResult<tag>(display));
+        if (clear) {
+            layers.clear();
+        }
+        return layers;
+    }
+
     std::vector<CommandResultPayload> mCommandsResults;
+    // The number of results of the last batch
+    size_t mResultCountHint = 0;
+    std::unordered_map<int64_t, DisplaySlot> mDisplaySlots;
 };
 
 }  // namespace aidl::android::hardware::graphics::composer3::impl
\ No newline at end of file
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/hardware/graphics/composer3/ComposerClientReader.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+
+namespace aidl::android::hardware::graphics::composer3 {
+namespace {
+
+constexpr int64_t kDisplay = 1;
+constexpr int64_t kOtherDisplay = 2;
+
+ReleaseFences makeReleaseFences(int64_t display, std::vector<int64_t> layers) {
+    ReleaseFences releaseFences;
+    releaseFences.display = display;
+    for (int64_t layer : layers) {
+        ReleaseFences::Layer releasedLayer;
+        releasedLayer.layer = layer;
+        releaseFences.layers.push_back(std::move(releasedLayer));
+    }
+    return releaseFences;
+}
+
+ChangedCompositionTypes makeChangedCompositionTypes(int64_t display, int64_t layer) {
+    ChangedCompositionTypes changedTypes;
+    changedTypes.display = display;
+    changedTypes.layers.push_back({.layer = layer, .composition = Composition::CLIENT});
+    return changedTypes;
+}
+
+DisplayRequest makeDisplayRequest(int64_t display, int64_t layer) {
+    DisplayRequest displayRequest;
+    displayRequest.display = display;
+    displayRequest.mask = DisplayRequest::FLIP_CLIENT_TARGET;
+    displayRequest.layerRequests.push_back(
+            {.layer = layer, .mask = DisplayRequest::LayerRequest::CLEAR_CLIENT_TARGET});
+    return displayRequest;
+}
+
+PresentFence makePresentFence(int64_t display) {
+    PresentFence presentFence;
+    presentFence.display = display;
+    presentFence.fence = ndk::ScopedFileDescriptor(open("/dev/null", O_RDONLY | O_CLOEXEC));
+    return presentFence;
+}
+
+PresentOrValidate makePresentOrValidate(int64_t display) {
+    PresentOrValidate presentOrValidate;
+    presentOrValidate.display = display;
+    presentOrValidate.result = PresentOrValidate::Result::Presented;
+    return presentOrValidate;
+}
+
+// The results of a frame presented on kDisplay.
+std::vector<CommandResultPayload> makeFrame() {
+    std::vector<CommandResultPayload> results;
+    results.emplace_back(makeReleaseFences(kDisplay, {10, 11}));
+    results.emplace_back(makeChangedCompositionTypes(kDisplay, 10));
+    results.emplace_back(makeDisplayRequest(kDisplay, 11));
+    results.emplace_back(makePresentFence(kDisplay));
+    results.emplace_back(makePresentOrValidate(kDisplay));
+    return results;
+}
+
+void expectNoResults(const ComposerClientReader& reader, int64_t display) {
+    EXPECT_TRUE(reader.getReleaseFences(display).empty());
+    EXPECT_TRUE(reader.getChangedCompositionTypes(display).empty());
+    EXPECT_EQ(0, reader.getDisplayRequests(display).mask);
+    EXPECT_TRUE(reader.getDisplayRequests(display).layerRequests.empty());
+    EXPECT_EQ(-1, reader.getPresentFence(display).get());
+    EXPECT_EQ(std::nullopt, reader.getPresentOrValidateStage(display));
+    const ClientTargetPropertyWithBrightness& property = reader.getClientTargetProperty(display);
+    EXPECT_EQ(common::PixelFormat::RGBA_8888, property.clientTargetProperty.pixelFormat);
+    EXPECT_EQ(Dataspace::UNKNOWN, property.clientTargetProperty.dataspace);
+    EXPECT_EQ(1.f, property.brightness);
+}
+
+void expectFrameResults(const ComposerClientReader& reader) {
+    const auto& releasedLayers = reader.getReleaseFences(kDisplay);
+    ASSERT_EQ(2u, releasedLayers.size());
+    EXPECT_EQ(10, releasedLayers[0].layer);
+    EXPECT_EQ(11, releasedLayers[1].layer);
+    const auto& changedLayers = reader.getChangedCompositionTypes(kDisplay);
+    ASSERT_EQ(1u, changedLayers.size());
+    EXPECT_EQ(10, changedLayers[0].layer);
+    EXPECT_EQ(Composition::CLIENT, changedLayers[0].composition);
+    const DisplayRequest& displayRequest = reader.getDisplayRequests(kDisplay);
+    EXPECT_EQ(DisplayRequest::FLIP_CLIENT_TARGET, displayRequest.mask);
+    ASSERT_EQ(1u, displayRequest.layerRequests.size());
+    EXPECT_EQ(11, displayRequest.layerRequests[0].layer);
+    EXPECT_NE(-1, reader.getPresentFence(kDisplay).get());
+    EXPECT_EQ(PresentOrValidate::Result::Presented, reader.getPresentOrValidateStage(kDisplay));
+}
+
+class ComposerClientReaderTest : public ::testing::TestWithParam<bool> {
+  protected:
+    void SetUp() override { mReader.setStorageReuseEnabled(GetParam()); }
+
+    ComposerClientReader mReader;
+};
+
+TEST_P(ComposerClientReaderTest, NoResultsBeforeParse) {
+    expectNoResults(mReader, kDisplay);
+    EXPECT_TRUE(mReader.getErrors().empty());
+}
+
+TEST_P(ComposerClientReaderTest, GetReadsTheResultsInPlace) {
+    mReader.parse(makeFrame());
+    expectFrameResults(mReader);
+    // Reading again sees the same results.
+    expectFrameResults(mReader);
+    expectNoResults(mReader, kOtherDisplay);
+
+    uint32_t changedCompositionTypes;
+    uint32_t layerRequestMasks;
+    mReader.hasChanges(kDisplay, &changedCompositionTypes, &layerRequestMasks);
+    EXPECT_EQ(1u, changedCompositionTypes);
+    EXPECT_EQ(1u, layerRequestMasks);
+}
+
+TEST_P(ComposerClientReaderTest, TakeMovesTheResultsOut) {
+    mReader.parse(makeFrame());
+    EXPECT_EQ(2u, mReader.takeReleaseFences(kDisplay).size());
+    EXPECT_EQ(1u, mReader.takeChangedCompositionTypes(kDisplay).size());
+    EXPECT_EQ(1u, mReader.takeDisplayRequests(kDisplay).layerRequests.size());
+    EXPECT_NE(-1, mReader.takePresentFence(kDisplay).get());
+
+    EXPECT_TRUE(mReader.getReleaseFences(kDisplay).empty());
+    EXPECT_TRUE(mReader.getChangedCompositionTypes(kDisplay).empty());
+    EXPECT_TRUE(mReader.getDisplayRequests(kDisplay).layerRequests.empty());
+    EXPECT_EQ(-1, mReader.getPresentFence(kDisplay).get());
+
+    // The next frame parses into the slot the results were taken from.
+    mReader.parse(makeFrame());
+    expectFrameResults(mReader);
+}
+
+TEST_P(ComposerClientReaderTest, ParseDropsTheResultsOfThePreviousFrame) {
+    mReader.parse(makeFrame());
+    std::vector<CommandResultPayload> results;
+    results.emplace_back(makeReleaseFences(kOtherDisplay, {20}));
+    results.emplace_back(CommandResultPayload::make<CommandResultPayload::Tag::error>(
+            CommandError{.commandIndex = 3, .errorCode = 8}));
+    mReader.parse(std::move(results));
+
+    expectNoResults(mReader, kDisplay);
+    ASSERT_EQ(1u, mReader.getReleaseFences(kOtherDisplay).size());
+    EXPECT_EQ(20, mReader.getReleaseFences(kOtherDisplay)[0].layer);
+    ASSERT_EQ(1u, mReader.getErrors().size());
+    EXPECT_EQ(3, mReader.getErrors()[0].commandIndex);
+    EXPECT_EQ(8, mReader.getErrors()[0].errorCode);
+
+    // A display with results in none of the two frames.
+    uint32_t changedCompositionTypes;
+    uint32_t layerRequestMasks;
+    mReader.hasChanges(kDisplay, &changedCompositionTypes, &layerRequestMasks);
+    EXPECT_EQ(0u, changedCompositionTypes);
+    EXPECT_EQ(0u, layerRequestMasks);
+}
+
+TEST_P(ComposerClientReaderTest, ClientTargetPropertyIsResetByParse) {
+    std::vector<CommandResultPayload> results;
+    results.emplace_back(ClientTargetPropertyWithBrightness{
+            .display = kDisplay,
+            .clientTargetProperty = {common::PixelFormat::RGBA_1010102, Dataspace::DISPLAY_P3},
+            .brightness = 0.5f,
+    });
+    mReader.parse(std::move(results));
+    EXPECT_EQ(0.5f, mReader.getClientTargetProperty(kDisplay).brightness);
+
+    // The display still has results, but no client target property.
+    mReader.parse(makeFrame());
+    EXPECT_EQ(1.f, mReader.getClientTargetProperty(kDisplay).brightness);
+    EXPECT_EQ(common::PixelFormat::RGBA_8888,
+              mReader.takeClientTargetProperty(kDisplay).clientTargetProperty.pixelFormat);
+}
+
+INSTANTIATE_TEST_SUITE_P(StorageReuse, ComposerClientReaderTest, ::testing::Bool(),
+                         [](const auto& info) { return info.param ? "Enabled" : "Disabled"; });
+
+TEST(ComposerClientReaderStorageTest, WithoutReuseKeepsOnlyTheDisplaysOfTheLastFrame) {
+    ComposerClientReader reader;
+    reader.parse(makeFrame());
+    EXPECT_EQ(1u, reader.getStorageSlotCount());
+    reader.parse({});
+    EXPECT_EQ(0u, reader.getStorageSlotCount());
+}
+
+TEST(ComposerClientReaderStorageTest, ReuseKeepsTheSlotsOfIdleDisplays) {
+    ComposerClientReader reader;
+    reader.setStorageReuseEnabled(true);
+    reader.parse(makeFrame());
+    for (uint32_t i = 0; i < ComposerClientReader::kMaxIdleParses; i++) {
+        reader.parse({});
+        expectNoResults(reader, kDisplay);
+    }
+    EXPECT_EQ(1u, reader.getStorageSlotCount());
+}
+
+TEST(ComposerClientReaderStorageTest, ReuseFreesTheSlotsOfDisplaysIdleForTooLong) {
+    ComposerClientReader reader;
+    reader.setStorageReuseEnabled(true);
+    reader.parse(makeFrame());
+    const auto parseOtherDisplayFrame = [&reader] {
+        std::vector<CommandResultPayload> results;
+        results.emplace_back(makeReleaseFences(kOtherDisplay, {20}));
+        reader.parse(std::move(results));
+    };
+    for (uint32_t i = 0; i < ComposerClientReader::kMaxIdleParses; i++) {
+        parseOtherDisplayFrame();
+    }
+    EXPECT_EQ(2u, reader.getStorageSlotCount());
+
+    // Only the display still presenting is left.
+    parseOtherDisplayFrame();
+    EXPECT_EQ(1u, reader.getStorageSlotCount());
+    expectNoResults(reader, kDisplay);
+    EXPECT_EQ(1u, reader.getReleaseFences(kOtherDisplay).size());
+
+    // A display coming back gets a new slot.
+    reader.parse(makeFrame());
+    EXPECT_EQ(2u, reader.getStorageSlotCount());
+    expectFrameResults(reader);
+}
+
+TEST(ComposerClientReaderStorageTest, DisablingReuseFreesTheSlots) {
+    ComposerClientReader reader;
+    reader.setStorageReuseEnabled(true);
+    reader.parse(makeFrame());
+    reader.setStorageReuseEnabled(false);
+    EXPECT_EQ(0u, reader.getStorageSlotCount());
+    expectNoResults(reader, kDisplay);
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::graphics::composer3
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/hardware/graphics/composer3/ComposerServiceWriter.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+
+namespace aidl::android::hardware::graphics::composer3::impl {
+namespace {
+
+constexpr int64_t kDisplay = 1;
+constexpr int64_t kOtherDisplay = 2;
+
+::ndk::ScopedFileDescriptor makeFence() {
+    return ::ndk::ScopedFileDescriptor(open("/dev/null", O_RDONLY | O_CLOEXEC));
+}
+
+std::vector<int64_t> getChangedLayers(const CommandResultPayload& result) {
+    std::vector<int64_t> layers;
+    for (const auto& changedLayer :
+         result.get<CommandResultPayload::Tag::changedCompositionTypes>().layers) {
+        layers.push_back(changedLayer.layer);
+    }
+    return layers;
+}
+
+std::vector<CommandResultPayload::Tag> getTags(const std::vector<CommandResultPayload>& results) {
+    std::vector<CommandResultPayload::Tag> tags;
+    for (const auto& result : results) tags.push_back(result.getTag());
+    return tags;
+}
+
+TEST(ComposerServiceWriterTest, NoResults) {
+    ComposerServiceWriter writer;
+    EXPECT_TRUE(writer.getPendingCommandResults().empty());
+}
+
+TEST(ComposerServiceWriterTest, KeepsTheOrderOfTheResults) {
+    ComposerServiceWriter writer;
+    writer.setError(0, IComposerClient::EX_BAD_LAYER);
+    writer.setChangedCompositionTypes(kDisplay, {10}, {Composition::CLIENT});
+    writer.setPresentOrValidateResult(kDisplay, PresentOrValidate::Result::Validated);
+    writer.setDisplayRequests(kDisplay, DisplayRequest::FLIP_CLIENT_TARGET, {}, {});
+
+    EXPECT_EQ((std::vector<CommandResultPayload::Tag>{
+                      CommandResultPayload::Tag::error,
+                      CommandResultPayload::Tag::changedCompositionTypes,
+                      CommandResultPayload::Tag::presentOrValidateResult,
+                      CommandResultPayload::Tag::displayRequest,
+              }),
+              getTags(writer.getPendingCommandResults()));
+}
+
+TEST(ComposerServiceWriterTest, CoalescesTheResultsOfADisplay) {
+    ComposerServiceWriter writer;
+    writer.setChangedCompositionTypes(kDisplay, {10, 11},
+                                      {Composition::CLIENT, Composition::CLIENT});
+    writer.setChangedCompositionTypes(kOtherDisplay, {20}, {Composition::DEVICE});
+    // Replaces the layers of the first call, in its place.
+    writer.setChangedCompositionTypes(kDisplay, {12}, {Composition::DEVICE});
+
+    const auto results = writer.getPendingCommandResults();
+    ASSERT_EQ(2u, results.size());
+    EXPECT_EQ(kDisplay,
+              results[0].get<CommandResultPayload::Tag::changedCompositionTypes>().display);
+    EXPECT_EQ(std::vector<int64_t>{12}, getChangedLayers(results[0]));
+    EXPECT_EQ(Composition::DEVICE,
+              results[0].get<CommandResultPayload::Tag::changedCompositionTypes>()
+                      .layers[0]
+                      .composition);
+    EXPECT_EQ(kOtherDisplay,
+              results[1].get<CommandResultPayload::Tag::changedCompositionTypes>().display);
+    EXPECT_EQ(std::vector<int64_t>{20}, getChangedLayers(results[1]));
+}
+
+TEST(ComposerServiceWriterTest, EmplaceAppendsToThePendingResult) {
+    ComposerServiceWriter writer;
+    writer.emplaceChangedCompositionType(kDisplay, 10, Composition::CLIENT);
+    writer.setChangedCompositionTypes(kDisplay, {11}, {Composition::CLIENT});
+    writer.emplaceChangedCompositionType(kDisplay, 12, Composition::DEVICE);
+
+    const auto results = writer.getPendingCommandResults();
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ((std::vector<int64_t>{11, 12}), getChangedLayers(results[0]));
+}
+
+TEST(ComposerServiceWriterTest, DisplayRequestMaskAndLayerRequests) {
+    ComposerServiceWriter writer;
+    writer.emplaceLayerRequest(kDisplay, 10, DisplayRequest::LayerRequest::CLEAR_CLIENT_TARGET);
+    writer.setDisplayRequestMask(kDisplay, DisplayRequest::FLIP_CLIENT_TARGET);
+    writer.emplaceLayerRequest(kDisplay, 11, DisplayRequest::LayerRequest::CLEAR_CLIENT_TARGET);
+
+    const auto results = writer.getPendingCommandResults();
+    ASSERT_EQ(1u, results.size());
+    const auto& displayRequest = results[0].get<CommandResultPayload::Tag::displayRequest>();
+    EXPECT_EQ(kDisplay, displayRequest.display);
+    EXPECT_EQ(DisplayRequest::FLIP_CLIENT_TARGET, displayRequest.mask);
+    ASSERT_EQ(2u, displayRequest.layerRequests.size());
+    EXPECT_EQ(10, displayRequest.layerRequests[0].layer);
+    EXPECT_EQ(11, displayRequest.layerRequests[1].layer);
+}
+
+TEST(ComposerServiceWriterTest, SetDisplayRequestsReplacesTheLayerRequests) {
+    ComposerServiceWriter writer;
+    writer.emplaceLayerRequest(kDisplay, 10, DisplayRequest::LayerRequest::CLEAR_CLIENT_TARGET);
+    writer.setDisplayRequests(kDisplay, 0, {11},
+                              {DisplayRequest::LayerRequest::CLEAR_CLIENT_TARGET});
+
+    const auto results = writer.getPendingCommandResults();
+    ASSERT_EQ(1u, results.size());
+    const auto& displayRequest = results[0].get<CommandResultPayload::Tag::displayRequest>();
+    EXPECT_EQ(0, displayRequest.mask);
+    ASSERT_EQ(1u, displayRequest.layerRequests.size());
+    EXPECT_EQ(11, displayRequest.layerRequests[0].layer);
+}
+
+TEST(ComposerServiceWriterTest, SkipsInvalidReleaseFences) {
+    ComposerServiceWriter writer;
+    std::vector<::ndk::ScopedFileDescriptor> fences;
+    fences.push_back(makeFence());
+    fences.emplace_back();
+    writer.setReleaseFences(kDisplay, {10, 11}, std::move(fences));
+    writer.emplaceReleaseFence(kDisplay, 12, ::ndk::ScopedFileDescriptor());
+    writer.emplaceReleaseFence(kDisplay, 13, makeFence());
+
+    const auto results = writer.getPendingCommandResults();
+    ASSERT_EQ(1u, results.size());
+    const auto& layers = results[0].get<CommandResultPayload::Tag::releaseFences>().layers;
+    ASSERT_EQ(2u, layers.size());
+    EXPECT_EQ(10, layers[0].layer);
+    EXPECT_NE(-1, layers[0].fence.get());
+    EXPECT_EQ(13, layers[1].layer);
+    EXPECT_NE(-1, layers[1].fence.get());
+}
+
+TEST(ComposerServiceWriterTest, BatchesAreNotCoalesced) {
+    ComposerServiceWriter writer;
+    writer.setChangedCompositionTypes(kDisplay, {10}, {Composition::CLIENT});
+    writer.getPendingCommandResults();
+    writer.emplaceChangedCompositionType(kDisplay, 11, Composition::CLIENT);
+
+    const auto results = writer.getPendingCommandResults();
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ(std::vector<int64_t>{11}, getChangedLayers(results[0]));
+}
+
+TEST(ComposerServiceWriterTest, ResetDropsThePendingResults) {
+    ComposerServiceWriter writer;
+    writer.setChangedCompositionTypes(kDisplay, {10}, {Composition::CLIENT});
+    writer.reset();
+    EXPECT_TRUE(writer.getPendingCommandResults().empty());
+
+    writer.emplaceChangedCompositionType(kDisplay, 11, Composition::CLIENT);
+    const auto results = writer.getPendingCommandResults();
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ(std::vector<int64_t>{11}, getChangedLayers(results[0]));
+}
+
+TEST(ComposerServiceWriterTest, PresizesFromThePreviousBatch) {
+    ComposerServiceWriter writer;
+    for (int64_t layer = 0; layer < 8; layer++) {
+        writer.emplaceReleaseFence(kDisplay, layer, makeFence());
+    }
+    writer.setError(0, IComposerClient::EX_BAD_LAYER);
+    writer.setError(1, IComposerClient::EX_BAD_LAYER);
+    writer.getPendingCommandResults();
+
+    writer.emplaceReleaseFence(kDisplay, 0, makeFence());
+    const auto results = writer.getPendingCommandResults();
+    EXPECT_GE(results.capacity(), 3u);
+    ASSERT_EQ(1u, results.size());
+    EXPECT_GE(results[0].get<CommandResultPayload::Tag::releaseFences>().layers.capacity(), 8u);
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::graphics::composer3::impl
@@ -135,16 +135,15 @@ class Gralloc0HalImpl : public Hal {
             result = mModule->lockAsync_ycbcr(mModule, bufferHandle, cpuUsage, accessRegion.left,
                                               accessRegion.top, accessRegion.width,
                                               accessRegion.height, &ycbcr, fenceFd.release());
-        } else {
+        } else if (mModule->lock_ycbcr) {
             waitFenceFd(fenceFd, "Gralloc0Hal::lockYCbCr");
 
-            if (mModule->lock_ycbcr) {
-                result = mModule->lock_ycbcr(mModule, bufferHandle, cpuUsage, accessRegion.left,
-                                             accessRegion.top, accessRegion.width,
-                                             accessRegion.height, &ycbcr);
-            } else {
-                result = -EINVAL;
-            }
+            result = mModule->lock_ycbcr(mModule, bufferHandle, cpuUsage, accessRegion.left,
+                                         accessRegion.top, accessRegion.width, accessRegion.height,
+                                         &ycbcr);
+        } else {
+            // Not worth waiting for the fence to fail.
+            result = -EINVAL;
         }
 
         if (result) {
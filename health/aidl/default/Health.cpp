@@ -115,16 +115,22 @@ ndk::ScopedAStatus Health::getChargeStatus(BatteryStatus* out) {
                        BatteryStatus::UNKNOWN, out);
 }
 
-ndk::ScopedAStatus Health::getDiskStats(std::vector<DiskStats>*) {
-    // This implementation does not support DiskStats. An implementation may extend this
-    // class and override this function to support disk stats.
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Health::getDiskStats(std::vector<DiskStats>* out) {
+    // Devices without storage devices in sysfs do not support DiskStats. An implementation may
+    // extend this class and override this function to support disk stats.
+    if (!storage_health_.GetDiskStats(out)) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Health::getStorageInfo(std::vector<StorageInfo>*) {
-    // This implementation does not support StorageInfo. An implementation may extend this
-    // class and override this function to support storage info.
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Health::getStorageInfo(std::vector<StorageInfo>* out) {
+    // Devices without eMMC or UFS health nodes in sysfs do not support StorageInfo. An
+    // implementation may extend this class and override this function to support storage info.
+    if (!storage_health_.GetStorageInfo(out)) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+    return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Health::getHealthInfo(HealthInfo* out) {
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "health-impl/StorageHealth.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <set>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/strings.h>
+
+using ::android::base::unique_fd;
+
+namespace aidl::android::hardware::health {
+
+namespace {
+
+// Large enough for the 17 fields of the stat file of recent kernels.
+constexpr size_t kStatBufferSize = 256;
+constexpr size_t kHealthNodeBufferSize = 32;
+
+// The UFS health descriptor is an attribute of the host controller, a few levels above the
+// SCSI device of a LUN.
+constexpr int kMaxUfsHostDepth = 4;
+
+unique_fd OpenAttribute(const std::string& path) {
+    return unique_fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+}
+
+// Reads the whole attribute again from the start. Returns the number of bytes read, with a
+// terminating NUL, or -1.
+ssize_t ReadAttribute(const unique_fd& fd, char* buf, size_t size) {
+    if (fd.get() < 0) return -1;
+    ssize_t len = TEMP_FAILURE_RETRY(pread(fd.get(), buf, size - 1, 0));
+    if (len < 0) return -1;
+    buf[len] = '\0';
+    return len;
+}
+
+// Parses the next unsigned decimal field of a space separated line.
+bool ParseField(const char** p, int64_t* out) {
+    const char* s = *p;
+    while (*s == ' ' || *s == '\t') s++;
+    if (*s < '0' || *s > '9') return false;
+    uint64_t value = 0;
+    for (; *s >= '0' && *s <= '9'; s++) {
+        value = value * 10 + (*s - '0');
+    }
+    // DiskStats fields are to be interpreted as unsigned.
+    *out = static_cast<int64_t>(value);
+    *p = s;
+    return true;
+}
+
+// Documented in Documentation/block/stat.rst. Only the first 11 fields are reported; newer
+// kernels append discard and flush statistics.
+bool ParseDiskStats(const char* p, DiskStats* out) {
+    return ParseField(&p, &out->reads) && ParseField(&p, &out->readMerges) &&
+           ParseField(&p, &out->readSectors) && ParseField(&p, &out->readTicks) &&
+           ParseField(&p, &out->writes) && ParseField(&p, &out->writeMerges) &&
+           ParseField(&p, &out->writeSectors) && ParseField(&p, &out->writeTicks) &&
+           ParseField(&p, &out->ioInFlight) && ParseField(&p, &out->ioTicks) &&
+           ParseField(&p, &out->ioInQueue);
+}
+
+// Parses the next hexadecimal value ("0x01") of a health node. Values out of [0, max] are
+// reported as 0, which is "not defined" in JEDEC.
+int32_t ParseHealthValue(const char** p, int32_t max) {
+    char* end;
+    long value = strtol(*p, &end, 16);
+    if (end == *p) return 0;
+    *p = end;
+    return value >= 0 && value <= max ? value : 0;
+}
+
+int32_t ReadHealthValue(const unique_fd& fd, int32_t max) {
+    char buf[kHealthNodeBufferSize];
+    if (ReadAttribute(fd, buf, sizeof(buf)) < 0) return 0;
+    const char* p = buf;
+    return ParseHealthValue(&p, max);
+}
+
+// Returns the directory of the UFS health descriptor of a SCSI device, or an empty string.
+std::string FindUfsHealthDescriptor(const std::string& device_path) {
+    char real_path[PATH_MAX];
+    if (realpath(device_path.c_str(), real_path) == nullptr) return "";
+    std::string dir = real_path;
+    for (int i = 0; i < kMaxUfsHostDepth && dir.size() > 1; i++) {
+        std::string descriptor = dir + "/health_descriptor";
+        if (access((descriptor + "/eol_info").c_str(), R_OK) == 0) return descriptor;
+        dir = ::android::base::Dirname(dir);
+    }
+    return "";
+}
+
+}  // namespace
+
+StorageHealth::StorageHealth(std::string_view sysfs_block) : sysfs_block_(sysfs_block) {}
+
+void StorageHealth::SetMaxAge(std::chrono::milliseconds max_age) {
+    std::lock_guard<std::mutex> lock(lock_);
+    max_age_ = max_age;
+}
+
+void StorageHealth::DiscoverLocked() {
+    if (discovered_) return;
+    discovered_ = true;
+
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(sysfs_block_.c_str()), closedir);
+    if (dir == nullptr) {
+        PLOG(WARNING) << "Cannot open " << sysfs_block_;
+        return;
+    }
+    // Health nodes already taken by another block device of the same storage: the boot and
+    // rpmb partitions of an eMMC, or the LUNs of a UFS device.
+    std::set<std::string> health_nodes;
+    while (struct dirent* entry = readdir(dir.get())) {
+        if (entry->d_name[0] == '.') continue;
+        const std::string path = sysfs_block_ + "/" + entry->d_name;
+        const std::string device_path = path + "/device";
+        // Virtual block devices (loop, dm, zram) have no backing device.
+        if (access(device_path.c_str(), F_OK) != 0) continue;
+
+        BlockDevice device;
+        device.name = entry->d_name;
+        device.stat_fd = OpenAttribute(path + "/stat");
+
+        if (access((device_path + "/pre_eol_info").c_str(), R_OK) == 0) {
+            char real_path[PATH_MAX];
+            if (realpath(device_path.c_str(), real_path) != nullptr &&
+                health_nodes.insert(real_path).second) {
+                device.eol_fd = OpenAttribute(device_path + "/pre_eol_info");
+                device.lifetime_a_fd = OpenAttribute(device_path + "/life_time");
+            }
+        } else if (std::string descriptor = FindUfsHealthDescriptor(device_path);
+                   !descriptor.empty() && health_nodes.insert(descriptor).second) {
+            device.eol_fd = OpenAttribute(descriptor + "/eol_info");
+            device.lifetime_a_fd = OpenAttribute(descriptor + "/life_time_estimation_a");
+            device.lifetime_b_fd = OpenAttribute(descriptor + "/life_time_estimation_b");
+        }
+        if (device.eol_fd.get() >= 0) {
+            std::string version;
+            if (::android::base::ReadFileToString(device_path + "/rev", &version)) {
+                device.version = ::android::base::Trim(version);
+            }
+        }
+
+        if (device.stat_fd.get() < 0 && device.eol_fd.get() < 0) continue;
+        LOG(DEBUG) << "Found storage device " << device.name
+                   << (device.eol_fd.get() >= 0 ? " with health info" : "");
+        devices_.push_back(std::move(device));
+    }
+}
+
+bool StorageHealth::IsFresh(std::chrono::steady_clock::time_point time) const {
+    return max_age_.count() > 0 && std::chrono::steady_clock::now() - time < max_age_;
+}
+
+bool StorageHealth::GetDiskStats(std::vector<DiskStats>* out) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (disk_stats_.values.empty() || !IsFresh(disk_stats_.time)) {
+        DiscoverLocked();
+        disk_stats_.values.clear();
+        char buf[kStatBufferSize];
+        for (const BlockDevice& device : devices_) {
+            DiskStats stats;
+            if (ReadAttribute(device.stat_fd, buf, sizeof(buf)) < 0) continue;
+            if (!ParseDiskStats(buf, &stats)) {
+                LOG(DEBUG) << "Cannot parse stat of " << device.name << ": " << buf;
+                continue;
+            }
+            disk_stats_.values.push_back(std::move(stats));
+        }
+        disk_stats_.time = std::chrono::steady_clock::now();
+    }
+    *out = disk_stats_.values;
+    return !out->empty();
+}
+
+bool StorageHealth::GetStorageInfo(std::vector<StorageInfo>* out) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (storage_info_.values.empty() || !IsFresh(storage_info_.time)) {
+        DiscoverLocked();
+        storage_info_.values.clear();
+        for (const BlockDevice& device : devices_) {
+            if (device.eol_fd.get() < 0) continue;
+            StorageInfo info;
+            info.eol = ReadHealthValue(device.eol_fd, 3);
+            if (device.lifetime_b_fd.get() >= 0) {
+                info.lifetimeA = ReadHealthValue(device.lifetime_a_fd, 0x0B);
+                info.lifetimeB = ReadHealthValue(device.lifetime_b_fd, 0x0B);
+            } else {
+                // eMMC: "0x01 0x02", type A then type B.
+                char buf[kHealthNodeBufferSize];
+                if (ReadAttribute(device.lifetime_a_fd, buf, sizeof(buf)) >= 0) {
+                    const char* p = buf;
+                    info.lifetimeA = ParseHealthValue(&p, 0x0B);
+                    info.lifetimeB = ParseHealthValue(&p, 0x0B);
+                }
+            }
+            info.version = device.version;
+            storage_info_.values.push_back(std::move(info));
+        }
+        storage_info_.time = std::chrono::steady_clock::now();
+    }
+    *out = storage_info_.values;
+    return !out->empty();
+}
+
+}  // namespace aidl::android::hardware::health
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "health-impl/StorageHealth.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+using ::android::base::WriteStringToFile;
+using namespace std::chrono_literals;
+
+namespace aidl::android::hardware::health {
+namespace {
+
+// All 17 fields of a recent kernel; only the first 11 are reported.
+std::string StatLine(int64_t reads) {
+    return "    " + std::to_string(reads) + " 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17\n";
+}
+
+std::vector<int64_t> Reads(const std::vector<DiskStats>& stats) {
+    std::vector<int64_t> reads;
+    for (const DiskStats& s : stats) reads.push_back(s.reads);
+    std::sort(reads.begin(), reads.end());
+    return reads;
+}
+
+// Lays out a sysfs block directory under a temporary directory, with the backing devices next
+// to it as sysfs has them under /sys/devices.
+class StorageHealthTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        block_ = std::string(root_.path) + "/block";
+        devices_ = std::string(root_.path) + "/devices";
+        ASSERT_EQ(0, mkdir(block_.c_str(), 0700));
+        ASSERT_EQ(0, mkdir(devices_.c_str(), 0700));
+    }
+
+    void MakeDir(const std::string& path) { ASSERT_EQ(0, mkdir(path.c_str(), 0700)) << path; }
+
+    void Write(const std::string& path, const std::string& content) {
+        ASSERT_TRUE(WriteStringToFile(content, path)) << path;
+    }
+
+    // A block device with a stat node, backed by |device| unless it is empty.
+    void AddBlockDevice(const std::string& name, const std::string& device, int64_t reads) {
+        MakeDir(block_ + "/" + name);
+        Write(block_ + "/" + name + "/stat", StatLine(reads));
+        if (!device.empty()) {
+            ASSERT_EQ(0, symlink(device.c_str(), (block_ + "/" + name + "/device").c_str()));
+        }
+    }
+
+    // An eMMC device, with its health nodes next to the device.
+    std::string AddEmmc(const std::string& health, const std::string& life_time) {
+        const std::string mmc = devices_ + "/mmc0";
+        MakeDir(mmc);
+        Write(mmc + "/pre_eol_info", health);
+        Write(mmc + "/life_time", life_time);
+        Write(mmc + "/rev", "0x8\n");
+        return mmc;
+    }
+
+    // A UFS host with |luns| SCSI devices; the health descriptor is an attribute of the host.
+    std::vector<std::string> AddUfs(int luns, const std::string& eol,
+                                    const std::string& life_time_a,
+                                    const std::string& life_time_b) {
+        const std::string ufs = devices_ + "/ufs";
+        const std::string host = ufs + "/host0";
+        MakeDir(ufs);
+        MakeDir(host);
+        MakeDir(ufs + "/health_descriptor");
+        Write(ufs + "/health_descriptor/eol_info", eol);
+        Write(ufs + "/health_descriptor/life_time_estimation_a", life_time_a);
+        Write(ufs + "/health_descriptor/life_time_estimation_b", life_time_b);
+        std::vector<std::string> paths;
+        for (int i = 0; i < luns; i++) {
+            paths.push_back(host + "/0:0:0:" + std::to_string(i));
+            MakeDir(paths.back());
+        }
+        return paths;
+    }
+
+    TemporaryDir root_;
+    std::string block_;
+    std::string devices_;
+};
+
+TEST_F(StorageHealthTest, ReadsDiskStatsOfBackedDevicesOnly) {
+    const std::string mmc = AddEmmc("0x01\n", "0x02 0x03\n");
+    AddBlockDevice("mmcblk0", mmc, 100);
+    AddBlockDevice("loop0", "", 200);
+    AddBlockDevice("zram0", "", 300);
+    StorageHealth storage(block_);
+
+    std::vector<DiskStats> stats;
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+
+    ASSERT_EQ(1u, stats.size());
+    EXPECT_EQ(100, stats[0].reads);
+    EXPECT_EQ(2, stats[0].readMerges);
+    EXPECT_EQ(3, stats[0].readSectors);
+    EXPECT_EQ(4, stats[0].readTicks);
+    EXPECT_EQ(5, stats[0].writes);
+    EXPECT_EQ(6, stats[0].writeMerges);
+    EXPECT_EQ(7, stats[0].writeSectors);
+    EXPECT_EQ(8, stats[0].writeTicks);
+    EXPECT_EQ(9, stats[0].ioInFlight);
+    EXPECT_EQ(10, stats[0].ioTicks);
+    EXPECT_EQ(11, stats[0].ioInQueue);
+}
+
+TEST_F(StorageHealthTest, SkipsMalformedStatLines) {
+    const std::string mmc = AddEmmc("0x01\n", "0x02 0x03\n");
+    AddBlockDevice("mmcblk0", mmc, 100);
+    AddBlockDevice("mmcblk0boot0", mmc, 200);
+    Write(block_ + "/mmcblk0boot0/stat", "1 2 3\n");
+    StorageHealth storage(block_);
+
+    std::vector<DiskStats> stats;
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+
+    EXPECT_EQ(std::vector<int64_t>{100}, Reads(stats));
+}
+
+TEST_F(StorageHealthTest, ReportsOneStorageInfoPerEmmc) {
+    const std::string mmc = AddEmmc("0x01\n", "0x02 0x03\n");
+    AddBlockDevice("mmcblk0", mmc, 100);
+    AddBlockDevice("mmcblk0boot0", mmc, 200);
+    AddBlockDevice("mmcblk0rpmb", mmc, 300);
+    StorageHealth storage(block_);
+
+    std::vector<StorageInfo> infos;
+    ASSERT_TRUE(storage.GetStorageInfo(&infos));
+
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(1, infos[0].eol);
+    EXPECT_EQ(2, infos[0].lifetimeA);
+    EXPECT_EQ(3, infos[0].lifetimeB);
+    EXPECT_EQ("0x8", infos[0].version);
+}
+
+TEST_F(StorageHealthTest, ReportsOneStorageInfoPerUfsHost) {
+    const std::vector<std::string> luns = AddUfs(2, "0x02\n", "0x0A\n", "0x0B\n");
+    AddBlockDevice("sda", luns[0], 100);
+    AddBlockDevice("sdb", luns[1], 200);
+    StorageHealth storage(block_);
+
+    std::vector<StorageInfo> infos;
+    ASSERT_TRUE(storage.GetStorageInfo(&infos));
+    std::vector<DiskStats> stats;
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(2, infos[0].eol);
+    EXPECT_EQ(0x0A, infos[0].lifetimeA);
+    EXPECT_EQ(0x0B, infos[0].lifetimeB);
+    EXPECT_EQ((std::vector<int64_t>{100, 200}), Reads(stats));
+}
+
+TEST_F(StorageHealthTest, ReportsHealthValuesOutOfRangeAsUndefined) {
+    const std::string mmc = AddEmmc("0x04\n", "0x0C 0x01\n");
+    AddBlockDevice("mmcblk0", mmc, 100);
+    StorageHealth storage(block_);
+
+    std::vector<StorageInfo> infos;
+    ASSERT_TRUE(storage.GetStorageInfo(&infos));
+
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(0, infos[0].eol);
+    EXPECT_EQ(0, infos[0].lifetimeA);
+    EXPECT_EQ(1, infos[0].lifetimeB);
+}
+
+TEST_F(StorageHealthTest, RereadsTheOpenNodesOnEveryCall) {
+    const std::string mmc = AddEmmc("0x01\n", "0x02 0x03\n");
+    AddBlockDevice("mmcblk0", mmc, 100);
+    StorageHealth storage(block_);
+    std::vector<DiskStats> stats;
+    std::vector<StorageInfo> infos;
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+    ASSERT_TRUE(storage.GetStorageInfo(&infos));
+
+    Write(block_ + "/mmcblk0/stat", StatLine(101));
+    Write(mmc + "/pre_eol_info", "0x02\n");
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+    ASSERT_TRUE(storage.GetStorageInfo(&infos));
+
+    EXPECT_EQ(std::vector<int64_t>{101}, Reads(stats));
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(2, infos[0].eol);
+}
+
+TEST_F(StorageHealthTest, ReturnsCachedValuesWithinTheMaxAge) {
+    const std::string mmc = AddEmmc("0x01\n", "0x02 0x03\n");
+    AddBlockDevice("mmcblk0", mmc, 100);
+    StorageHealth storage(block_);
+    storage.SetMaxAge(1h);
+    std::vector<DiskStats> stats;
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+
+    Write(block_ + "/mmcblk0/stat", StatLine(101));
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+    EXPECT_EQ(std::vector<int64_t>{100}, Reads(stats));
+
+    storage.SetMaxAge(0ms);
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+    EXPECT_EQ(std::vector<int64_t>{101}, Reads(stats));
+}
+
+TEST_F(StorageHealthTest, DiscoversDevicesOnlyOnce) {
+    const std::string mmc = AddEmmc("0x01\n", "0x02 0x03\n");
+    AddBlockDevice("mmcblk0", mmc, 100);
+    StorageHealth storage(block_);
+    std::vector<DiskStats> stats;
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+
+    AddBlockDevice("mmcblk0boot0", mmc, 200);
+    ASSERT_TRUE(storage.GetDiskStats(&stats));
+
+    EXPECT_EQ(std::vector<int64_t>{100}, Reads(stats));
+}
+
+TEST_F(StorageHealthTest, FailsWithoutStorageDevices) {
+    AddBlockDevice("loop0", "", 100);
+    StorageHealth storage(block_);
+
+    std::vector<DiskStats> stats;
+    std::vector<StorageInfo> infos;
+    EXPECT_FALSE(storage.GetDiskStats(&stats));
+    EXPECT_FALSE(storage.GetStorageInfo(&infos));
+    EXPECT_FALSE(StorageHealth(block_ + "/missing").GetDiskStats(&stats));
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::health
@@ -23,6 +23,7 @@
 #include <aidl/android/hardware/health/IHealthInfoCallback.h>
 #include <android/binder_auto_utils.h>
 #include <health-impl/HalHealthLoop.h>
+#include <health-impl/StorageHealth.h>
 #include <healthd/BatteryMonitor.h>
 #include <healthd/healthd.h>
 
@@ -68,7 +69,8 @@ class Health : public BnHealth, public HalHealthLoopCallback {
     ndk::ScopedAStatus getEnergyCounterNwh(int64_t* out) override;
 
     // A subclass may override these for a specific device.
-    // The default implementations return nothing in |out|.
+    // The default implementations read the block devices and the eMMC or UFS health nodes
+    // from sysfs; see StorageHealth.
     ndk::ScopedAStatus getDiskStats(std::vector<DiskStats>* out) override;
     ndk::ScopedAStatus getStorageInfo(std::vector<StorageInfo>* out) override;
 
@@ -96,6 +98,10 @@ class Health : public BnHealth, public HalHealthLoopCallback {
     // See implementation of Health for code samples.
     virtual void UpdateHealthInfo(HealthInfo* health_info);
 
+    // Reads the values of the default getDiskStats and getStorageInfo. A subclass may enable
+    // its cache in the constructor, e.g. storage_health()->SetMaxAge(...).
+    StorageHealth* storage_health() { return &storage_health_; }
+
   private:
     friend LinkedCallback;  // for exposing death_recipient_
 
@@ -104,6 +110,7 @@ class Health : public BnHealth, public HalHealthLoopCallback {
     std::string instance_name_;
     ::android::BatteryMonitor battery_monitor_;
     std::unique_ptr<struct healthd_config> healthd_config_;
+    StorageHealth storage_health_;
 
     ndk::ScopedAIBinder_DeathRecipient death_recipient_;
     int binder_fd_ = -1;
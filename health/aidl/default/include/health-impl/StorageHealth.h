@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <aidl/android/hardware/health/DiskStats.h>
+#include <aidl/android/hardware/health/StorageInfo.h>
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+
+namespace aidl::android::hardware::health {
+
+// Reads DiskStats and StorageInfo of the storage devices from sysfs.
+//
+// Block devices backed by a device (not loop, dm or zram) are discovered once, on first use.
+// Their sysfs attributes are kept open and re-read with pread, so that a call does not walk or
+// open anything.
+//
+// getHealthInfo() is called on every battery update, so the values may be cached: with a
+// non-zero max age, values younger than that are returned without reading sysfs.
+//
+// Thread-safe.
+class StorageHealth {
+  public:
+    // |sysfs_block| is the directory of the block devices; a different one may be given for
+    // testing.
+    explicit StorageHealth(std::string_view sysfs_block = "/sys/block");
+
+    // Values read within |max_age| are returned again instead of reading sysfs. Zero disables
+    // the cache.
+    void SetMaxAge(std::chrono::milliseconds max_age);
+
+    // Returns false if no storage device has been found, or if all of them failed to be read.
+    bool GetDiskStats(std::vector<DiskStats>* out);
+    bool GetStorageInfo(std::vector<StorageInfo>* out);
+
+  private:
+    struct BlockDevice {
+        std::string name;
+        ::android::base::unique_fd stat_fd;
+        // eMMC pre_eol_info or UFS eol_info
+        ::android::base::unique_fd eol_fd;
+        // eMMC life_time holds both estimations; UFS has one node for each.
+        ::android::base::unique_fd lifetime_a_fd;
+        ::android::base::unique_fd lifetime_b_fd;
+        // Does not change while the device is up.
+        std::string version;
+    };
+
+    template <typename T>
+    struct Cache {
+        std::vector<T> values;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    void DiscoverLocked() REQUIRES(lock_);
+    bool IsFresh(std::chrono::steady_clock::time_point time) const REQUIRES(lock_);
+
+    const std::string sysfs_block_;
+    std::mutex lock_;
+    bool discovered_ GUARDED_BY(lock_) = false;
+    std::vector<BlockDevice> devices_ GUARDED_BY(lock_);
+    std::chrono::milliseconds max_age_ GUARDED_BY(lock_){0};
+    Cache<DiskStats> disk_stats_ GUARDED_BY(lock_);
+    Cache<StorageInfo> storage_info_ GUARDED_BY(lock_);
+};
+
+}  // namespace aidl::android::hardware::health
@@ -23,6 +23,7 @@
 
 using ::android::hardware::health::storage::DebugDump;
 using ::android::hardware::health::storage::GarbageCollect;
+using ::android::hardware::health::storage::GarbageCollectProgress;
 
 using HResult = android::hardware::health::storage::V1_0::Result;
 using AResult = aidl::android::hardware::health::storage::Result;
@@ -35,7 +36,14 @@ namespace aidl::android::hardware::health::storage {
 
 ndk::ScopedAStatus Storage::garbageCollect(
         int64_t timeout_seconds, const std::shared_ptr<IGarbageCollectCallback>& callback) {
-    AResult result = static_cast<AResult>(GarbageCollect(static_cast<uint64_t>(timeout_seconds)));
+    AResult result = static_cast<AResult>(GarbageCollect(
+            static_cast<uint64_t>(timeout_seconds), [&](const GarbageCollectProgress& progress) {
+                LOG(DEBUG) << "Dev GC " << progress.require_gc << ", WB available "
+                           << progress.wb_available << "/10";
+                // Nobody is left to be told about the result, e.g. the maintenance job was
+                // killed for foreground work. The next request picks up from here.
+                return callback == nullptr || AIBinder_isAlive(callback->asBinder().get());
+            }));
     if (callback != nullptr) {
         auto status = callback->onFinish(result);
         if (!status.isOk()) {
@@ -15,12 +15,18 @@
  */
 #include <health-storage-impl/common.h>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include <android-base/chrono_utils.h>
 #include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <android-base/strings.h>
 #include <fstab/fstab.h>
 
+using ::android::base::ParseInt;
 using ::android::base::ReadFileToString;
 using ::android::base::Timer;
 using ::android::base::Trim;
@@ -59,6 +65,10 @@ static std::string GetWriteBoosterPath() {
 }
 
 Result GarbageCollect(uint64_t timeout_seconds) {
+    return GarbageCollect(timeout_seconds, [](const GarbageCollectProgress&) { return true; });
+}
+
+Result GarbageCollect(uint64_t timeout_seconds, const GarbageCollectProgressCallback& on_progress) {
     std::string gc_path = GetGarbageCollectPath();
 
     if (gc_path.empty()) {
@@ -66,6 +76,7 @@ Result GarbageCollect(uint64_t timeout_seconds) {
         return Result::UNKNOWN_ERROR;
     }
 
+    std::string wb_path = GetWriteBoosterPath();
     Result result = Result::SUCCESS;
     Timer timer;
     LOG(INFO) << "Start Dev GC on " << gc_path;
@@ -78,7 +89,6 @@ Result GarbageCollect(uint64_t timeout_seconds) {
         }
         require_gc = Trim(require_gc);
 
-        std::string wb_path = GetWriteBoosterPath();
         // Let's flush WB till 100% available
         std::string wb_avail = "0x0000000A";
         if (!wb_path.empty() && !ReadFileToString(wb_path, &wb_avail)) {
@@ -86,6 +96,13 @@ Result GarbageCollect(uint64_t timeout_seconds) {
         }
         wb_avail = Trim(wb_avail);
 
+        GarbageCollectProgress progress{.require_gc = require_gc};
+        ParseInt(wb_avail, &progress.wb_available, 0, 10);
+        if (!on_progress(progress)) {
+            LOG(INFO) << "Dev GC cancelled";
+            break;
+        }
+
         if (require_gc == "disabled") {
             LOG(DEBUG) << "Disabled Dev GC";
             break;
@@ -101,12 +118,15 @@ Result GarbageCollect(uint64_t timeout_seconds) {
             result = Result::IO_ERROR;
             break;
         }
-        if (timer.duration() >= std::chrono::seconds(timeout_seconds)) {
+        const auto remaining = std::chrono::seconds(timeout_seconds) - timer.duration();
+        if (remaining <= std::chrono::milliseconds::zero()) {
             LOG(WARNING) << "Dev GC timeout";
             // Timeout is not treated as an error. Try next time.
             break;
         }
-        sleep(2);
+        std::this_thread::sleep_for(std::min<std::chrono::milliseconds>(
+                std::chrono::seconds(2),
+                std::chrono::duration_cast<std::chrono::milliseconds>(remaining)));
     }
     LOG(INFO) << "Stop Dev GC on " << gc_path;
     if (!WriteStringToFile("0", gc_path)) {
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <android/hardware/health/storage/1.0/types.h>
+#include <functional>
 #include <string>
 
 namespace android::hardware::health::storage {
@@ -24,8 +25,27 @@ namespace android::hardware::health::storage {
 // Run debug on fd
 void DebugDump(int fd);
 
+// State of the device each time garbage collection polls it.
+struct GarbageCollectProgress {
+    // Contents of the manual_gc node, e.g. "on", "off" or "disabled".
+    std::string require_gc;
+    // Available WriteBooster buffer in units of 10%, or -1 if unknown.
+    int wb_available = -1;
+};
+
+// Called after each poll of the device. Returning false stops garbage
+// collection early; the device keeps what it did, so the next run resumes
+// from there.
+using GarbageCollectProgressCallback = std::function<bool(const GarbageCollectProgress&)>;
+
 // Run garbage collection on GetGarbageCollectPath(). Blocks until garbage
 // collect finishes or |timeout_seconds| has reached.
 V1_0::Result GarbageCollect(uint64_t timeout_seconds);
 
+// Same as above, reporting the progress to |on_progress|, which may cancel
+// the garbage collection. Short timeouts are honored, so callers can run
+// garbage collection in slices between foreground I/O.
+V1_0::Result GarbageCollect(uint64_t timeout_seconds,
+                            const GarbageCollectProgressCallback& on_progress);
+
 }  // namespace android::hardware::health::storage
@@ -43,6 +43,10 @@ using android::hardware::health::V2_1::IHealth;
 
 using ScreenOn = decltype(healthd_config::screen_on);
 
+// How long one sweep of the battery properties serves getHealthInfo*() and the getters. update()
+// always sweeps, so a change signalled through a uevent is never hidden by the snapshot.
+static constexpr std::chrono::milliseconds kSnapshotMaxAge{500};
+
 namespace android {
 namespace hardware {
 namespace health {
@@ -79,6 +83,12 @@ Return<Result> Health::unregisterCallback(const sp<V2_0::IHealthInfoCallback>&)
 }
 
 Return<Result> Health::update() {
+    {
+        // Always sweep on update(), it is called when the battery state may have changed.
+        std::lock_guard<std::mutex> lock(snapshot_lock_);
+        UpdateSnapshotLocked();
+    }
+
     Result result = Result::UNKNOWN;
     getHealthInfo_2_1([&](auto res, const auto& health_info) {
         result = res;
@@ -97,17 +107,29 @@ Return<Result> Health::update() {
 //
 
 template <typename T>
-static Return<void> GetProperty(BatteryMonitor* monitor, int id, T defaultValue,
-                                const std::function<void(Result, T)>& callback) {
+Return<void> Health::GetProperty(int id, T defaultValue,
+                                 const std::function<T(const HealthInfo&)>& fromSnapshot,
+                                 const std::function<void(Result, T)>& callback) {
     struct BatteryProperty prop;
     T ret = defaultValue;
+    status_t err;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_lock_);
+        if (fromSnapshot && supported_properties_.count(id) != 0 && IsSnapshotFreshLocked()) {
+            ret = fromSnapshot(*snapshot_);
+            err = OK;
+        } else {
+            err = battery_monitor_.getProperty(id, &prop);
+            if (err == OK) {
+                ret = static_cast<T>(prop.valueInt64);
+                supported_properties_.insert(id);
+            }
+        }
+    }
     Result result = Result::SUCCESS;
-    status_t err = monitor->getProperty(static_cast<int>(id), &prop);
     if (err != OK) {
         LOG(DEBUG) << "getProperty(" << id << ")"
                    << " fails: (" << err << ") " << strerror(-err);
-    } else {
-        ret = static_cast<T>(prop.valueInt64);
     }
     switch (err) {
         case OK:
@@ -125,28 +147,38 @@ static Return<void> GetProperty(BatteryMonitor* monitor, int id, T defaultValue,
 }
 
 Return<void> Health::getChargeCounter(getChargeCounter_cb _hidl_cb) {
-    return GetProperty<int32_t>(&battery_monitor_, BATTERY_PROP_CHARGE_COUNTER, 0, _hidl_cb);
+    return GetProperty<int32_t>(
+            BATTERY_PROP_CHARGE_COUNTER, 0,
+            [](const auto& info) { return info.legacy.legacy.batteryChargeCounter; }, _hidl_cb);
 }
 
 Return<void> Health::getCurrentNow(getCurrentNow_cb _hidl_cb) {
-    return GetProperty<int32_t>(&battery_monitor_, BATTERY_PROP_CURRENT_NOW, 0, _hidl_cb);
+    return GetProperty<int32_t>(
+            BATTERY_PROP_CURRENT_NOW, 0,
+            [](const auto& info) { return info.legacy.legacy.batteryCurrent; }, _hidl_cb);
 }
 
 Return<void> Health::getCurrentAverage(getCurrentAverage_cb _hidl_cb) {
-    return GetProperty<int32_t>(&battery_monitor_, BATTERY_PROP_CURRENT_AVG, 0, _hidl_cb);
+    return GetProperty<int32_t>(
+            BATTERY_PROP_CURRENT_AVG, 0,
+            [](const auto& info) { return info.legacy.batteryCurrentAverage; }, _hidl_cb);
 }
 
 Return<void> Health::getCapacity(getCapacity_cb _hidl_cb) {
-    return GetProperty<int32_t>(&battery_monitor_, BATTERY_PROP_CAPACITY, 0, _hidl_cb);
+    return GetProperty<int32_t>(
+            BATTERY_PROP_CAPACITY, 0,
+            [](const auto& info) { return info.legacy.legacy.batteryLevel; }, _hidl_cb);
 }
 
 Return<void> Health::getEnergyCounter(getEnergyCounter_cb _hidl_cb) {
-    return GetProperty<int64_t>(&battery_monitor_, BATTERY_PROP_ENERGY_COUNTER, 0, _hidl_cb);
+    // The energy counter is not part of HealthInfo, so it is always read from sysfs.
+    return GetProperty<int64_t>(BATTERY_PROP_ENERGY_COUNTER, 0, nullptr, _hidl_cb);
 }
 
 Return<void> Health::getChargeStatus(getChargeStatus_cb _hidl_cb) {
-    return GetProperty(&battery_monitor_, BATTERY_PROP_BATTERY_STATUS, BatteryStatus::UNKNOWN,
-                       _hidl_cb);
+    return GetProperty<BatteryStatus>(
+            BATTERY_PROP_BATTERY_STATUS, BatteryStatus::UNKNOWN,
+            [](const auto& info) { return info.legacy.legacy.batteryStatus; }, _hidl_cb);
 }
 
 Return<void> Health::getStorageInfo(getStorageInfo_cb _hidl_cb) {
@@ -176,10 +208,26 @@ Return<void> Health::getHealthInfo(getHealthInfo_cb _hidl_cb) {
             [&](auto res, const auto& health_info) { _hidl_cb(res, health_info.legacy); });
 }
 
-Return<void> Health::getHealthInfo_2_1(getHealthInfo_2_1_cb _hidl_cb) {
+void Health::UpdateSnapshotLocked() {
     battery_monitor_.updateValues();
+    snapshot_ = battery_monitor_.getHealthInfo_2_1();
+    snapshot_time_ = std::chrono::steady_clock::now();
+}
+
+bool Health::IsSnapshotFreshLocked() const {
+    return snapshot_.has_value() &&
+           std::chrono::steady_clock::now() - snapshot_time_ <= kSnapshotMaxAge;
+}
 
-    HealthInfo health_info = battery_monitor_.getHealthInfo_2_1();
+Return<void> Health::getHealthInfo_2_1(getHealthInfo_2_1_cb _hidl_cb) {
+    HealthInfo health_info;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_lock_);
+        if (!IsSnapshotFreshLocked()) {
+            UpdateSnapshotLocked();
+        }
+        health_info = *snapshot_;
+    }
 
     // Fill in storage infos; these aren't retrieved by BatteryMonitor.
     GetHealthInfoField(this, &Health::getStorageInfo, &health_info.legacy.storageInfos);
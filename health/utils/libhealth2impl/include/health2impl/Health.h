@@ -15,8 +15,12 @@
  */
 #pragma once
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <vector>
 
 #include <android-base/unique_fd.h>
@@ -76,9 +80,28 @@ class Health : public IHealth {
   private:
     bool unregisterCallbackInternal(const sp<IBase>& callback);
 
+    // Reads all battery properties through battery_monitor_ into snapshot_.
+    void UpdateSnapshotLocked();
+    bool IsSnapshotFreshLocked() const;
+    // Serves the property from a fresh snapshot when possible, reads it through
+    // battery_monitor_ otherwise.
+    template <typename T>
+    Return<void> GetProperty(int id, T defaultValue,
+                             const std::function<T(const HealthInfo&)>& fromSnapshot,
+                             const std::function<void(::android::hardware::health::V2_0::Result,
+                                                      T)>& callback);
+
     BatteryMonitor battery_monitor_;
     std::unique_ptr<healthd_config> healthd_config_;
 
+    // One sweep of the battery properties, shared by update(), getHealthInfo*() and the getters
+    // called shortly after it. Holds the values before UpdateHealthInfo() is applied.
+    std::mutex snapshot_lock_;
+    std::optional<HealthInfo> snapshot_;
+    std::chrono::steady_clock::time_point snapshot_time_;
+    // Properties that battery_monitor_ has reported at least once.
+    std::set<int> supported_properties_;
+
     std::mutex callbacks_lock_;
     std::vector<std::unique_ptr<Callback>> callbacks_;
 };
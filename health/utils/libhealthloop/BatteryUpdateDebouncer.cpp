@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <health/BatteryUpdateDebouncer.h>
+
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace health {
+
+bool BatteryUpdateDebouncer::OnUevent(Clock::time_point now) {
+    if (now - last_update_ < interval_) {
+        pending_ = true;
+        return false;
+    }
+    return true;
+}
+
+void BatteryUpdateDebouncer::OnBatteryUpdate(Clock::time_point now) {
+    pending_ = false;
+    last_update_ = now;
+}
+
+int BatteryUpdateDebouncer::PendingTimeout(Clock::time_point now) const {
+    if (!pending_) return -1;
+    auto remaining = last_update_ + interval_ - now;
+    // Rounded up, so that the loop does not wake up right before the update is due.
+    return std::max<int>(0, std::chrono::ceil<std::chrono::milliseconds>(remaining).count());
+}
+
+}  // namespace health
+}  // namespace hardware
+}  // namespace android
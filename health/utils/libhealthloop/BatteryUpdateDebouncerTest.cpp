@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <health/BatteryUpdateDebouncer.h>
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace android {
+namespace hardware {
+namespace health {
+namespace {
+
+using Clock = BatteryUpdateDebouncer::Clock;
+
+class BatteryUpdateDebouncerTest : public ::testing::Test {
+  protected:
+    // Runs the update the debouncer asks for, as HealthLoop does.
+    bool Uevent(Clock::duration at) {
+        if (!debouncer_.OnUevent(start_ + at)) return false;
+        debouncer_.OnBatteryUpdate(start_ + at);
+        return true;
+    }
+
+    int PendingTimeout(Clock::duration at) { return debouncer_.PendingTimeout(start_ + at); }
+
+    BatteryUpdateDebouncer debouncer_{20ms};
+    // Far from the epoch of the steady clock, as on a device that has been up for a while.
+    const Clock::time_point start_ = Clock::time_point() + 1h;
+};
+
+TEST_F(BatteryUpdateDebouncerTest, UpdatesRightAwayForTheFirstUevent) {
+    EXPECT_TRUE(Uevent(0ms));
+    EXPECT_EQ(-1, PendingTimeout(0ms));
+}
+
+TEST_F(BatteryUpdateDebouncerTest, MergesTheUeventsOfABurst) {
+    ASSERT_TRUE(Uevent(0ms));
+
+    EXPECT_FALSE(Uevent(2ms));
+    EXPECT_FALSE(Uevent(5ms));
+    EXPECT_FALSE(Uevent(19ms));
+
+    // A single update is pending, at the end of the interval of the first one.
+    EXPECT_EQ(1, PendingTimeout(19ms));
+    EXPECT_EQ(0, PendingTimeout(20ms));
+    EXPECT_EQ(0, PendingTimeout(50ms));
+}
+
+TEST_F(BatteryUpdateDebouncerTest, RoundsTheTimeoutUp) {
+    ASSERT_TRUE(Uevent(0ms));
+    ASSERT_FALSE(Uevent(1ms));
+
+    EXPECT_EQ(20, PendingTimeout(1us));
+    EXPECT_EQ(11, PendingTimeout(9500us));
+}
+
+TEST_F(BatteryUpdateDebouncerTest, UpdatesClearThePendingUevents) {
+    ASSERT_TRUE(Uevent(0ms));
+    ASSERT_FALSE(Uevent(5ms));
+
+    // The pending update, or periodic chores.
+    debouncer_.OnBatteryUpdate(start_ + 20ms);
+
+    EXPECT_EQ(-1, PendingTimeout(20ms));
+    // A new interval starts with that update.
+    EXPECT_FALSE(Uevent(30ms));
+    EXPECT_EQ(10, PendingTimeout(30ms));
+}
+
+TEST_F(BatteryUpdateDebouncerTest, UpdatesRightAwayAfterTheInterval) {
+    ASSERT_TRUE(Uevent(0ms));
+
+    EXPECT_TRUE(Uevent(20ms));
+    EXPECT_TRUE(Uevent(100ms));
+    EXPECT_EQ(-1, PendingTimeout(100ms));
+}
+
+TEST_F(BatteryUpdateDebouncerTest, ZeroIntervalUpdatesForEveryUevent) {
+    debouncer_.SetInterval(0ms);
+
+    EXPECT_TRUE(Uevent(0ms));
+    EXPECT_TRUE(Uevent(0ms));
+    EXPECT_TRUE(Uevent(1ms));
+    EXPECT_EQ(-1, PendingTimeout(1ms));
+}
+
+}  // namespace
+}  // namespace health
+}  // namespace hardware
+}  // namespace android
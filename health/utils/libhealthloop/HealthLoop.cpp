@@ -44,7 +44,10 @@ namespace android {
 namespace hardware {
 namespace health {
 
-HealthLoop::HealthLoop() {
+// Fuel gauges and chargers emit their change events within a few milliseconds of each other.
+static constexpr std::chrono::milliseconds kDefaultBatteryUpdateDebounceInterval = 20ms;
+
+HealthLoop::HealthLoop() : battery_update_debouncer_(kDefaultBatteryUpdateDebounceInterval) {
     InitHealthdConfig(&healthd_config_);
     awake_poll_interval_ = -1;
     wakealarm_wake_interval_ = healthd_config_.periodic_chores_interval_fast;
@@ -118,7 +121,17 @@ void HealthLoop::AdjustWakealarmPeriods(bool charger_online) {
                                        : healthd_config_.periodic_chores_interval_fast * 1000;
 }
 
+void HealthLoop::SetBatteryUpdateDebounceInterval(std::chrono::milliseconds interval) {
+    battery_update_debouncer_.SetInterval(interval);
+}
+
 void HealthLoop::PeriodicChores() {
+    BatteryUpdate();
+}
+
+void HealthLoop::BatteryUpdate() {
+    // Also covers the uevents received since the last update.
+    battery_update_debouncer_.OnBatteryUpdate(std::chrono::steady_clock::now());
     ScheduleBatteryUpdate();
 }
 
@@ -130,25 +143,36 @@ void HealthLoop::UeventEvent(uint32_t /*epevents*/) {
     char msg[UEVENT_MSG_LEN + 2];
     char* cp;
     int n;
+    bool power_supply_changed = false;
+
+    // Drain the socket, a burst of uevents results in a single battery update.
+    while (true) {
+        n = uevent_kernel_multicast_recv(uevent_fd_, msg, UEVENT_MSG_LEN);
+        if (n < 0 && errno == EIO) continue; /* not from the kernel -- ignored */
+        if (n <= 0) break;
+        if (n >= UEVENT_MSG_LEN) /* overflow -- discard */
+            continue;
+        if (power_supply_changed) continue;
+
+        msg[n] = '\0';
+        msg[n + 1] = '\0';
+        cp = msg;
+
+        while (*cp) {
+            if (!strcmp(cp, "SUBSYSTEM=power_supply")) {
+                power_supply_changed = true;
+                break;
+            }
 
-    n = uevent_kernel_multicast_recv(uevent_fd_, msg, UEVENT_MSG_LEN);
-    if (n <= 0) return;
-    if (n >= UEVENT_MSG_LEN) /* overflow -- discard */
-        return;
-
-    msg[n] = '\0';
-    msg[n + 1] = '\0';
-    cp = msg;
-
-    while (*cp) {
-        if (!strcmp(cp, "SUBSYSTEM=power_supply")) {
-            ScheduleBatteryUpdate();
-            break;
+            /* advance to after the next \0 */
+            while (*cp++)
+                ;
         }
+    }
 
-        /* advance to after the next \0 */
-        while (*cp++)
-            ;
+    if (power_supply_changed &&
+        battery_update_debouncer_.OnUevent(std::chrono::steady_clock::now())) {
+        BatteryUpdate();
     }
 }
 
@@ -208,6 +232,11 @@ void HealthLoop::MainLoop(void) {
 
         mode_timeout = PrepareToWait();
         if (timeout < 0 || (mode_timeout > 0 && mode_timeout < timeout)) timeout = mode_timeout;
+        int update_timeout =
+                battery_update_debouncer_.PendingTimeout(std::chrono::steady_clock::now());
+        if (update_timeout >= 0 && (timeout < 0 || update_timeout < timeout)) {
+            timeout = update_timeout;
+        }
         nevents = epoll_wait(epollfd_, events, eventct, timeout);
         if (nevents == -1) {
             if (errno == EINTR) continue;
@@ -221,6 +250,12 @@ void HealthLoop::MainLoop(void) {
                 event_handler->func(event_handler->object, events[n].events);
             }
         }
+
+        // When nevents is 0, the periodic chores at the top of the loop do the pending update.
+        if (nevents > 0 &&
+            battery_update_debouncer_.PendingTimeout(std::chrono::steady_clock::now()) == 0) {
+            BatteryUpdate();
+        }
     }
 
     return;
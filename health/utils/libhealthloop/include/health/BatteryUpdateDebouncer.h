@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+
+namespace android {
+namespace hardware {
+namespace health {
+
+// Decides when the power_supply uevents of HealthLoop update the battery. The first uevent of a
+// burst updates it right away; the ones received within the interval of that update are merged
+// into a single update at the end of the interval.
+class BatteryUpdateDebouncer {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit BatteryUpdateDebouncer(std::chrono::milliseconds interval) : interval_(interval) {}
+
+    // Zero updates the battery for every uevent.
+    void SetInterval(std::chrono::milliseconds interval) { interval_ = interval; }
+
+    // Returns whether the battery is to be updated now for a uevent received at |now|.
+    // Otherwise, an update is pending until the end of the interval.
+    bool OnUevent(Clock::time_point now);
+
+    // Records a battery update at |now|, which also covers the pending uevents.
+    void OnBatteryUpdate(Clock::time_point now);
+
+    // Returns the epoll timeout until the pending battery update, or -1.
+    int PendingTimeout(Clock::time_point now) const;
+
+  private:
+    std::chrono::milliseconds interval_;
+    Clock::time_point last_update_;
+    // A uevent has been received since the last battery update.
+    bool pending_ = false;
+};
+
+}  // namespace health
+}  // namespace hardware
+}  // namespace android
@@ -15,11 +15,13 @@
  */
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <vector>
 
 #include <android-base/unique_fd.h>
+#include <health/BatteryUpdateDebouncer.h>
 #include <healthd/healthd.h>
 
 namespace android {
@@ -78,6 +80,11 @@ class HealthLoop {
     // then reset wake alarm interval by calling AdjustWakealarmPeriods.
     void AdjustWakealarmPeriods(bool charger_online);
 
+    // The first power_supply uevent of a burst updates the battery right away. The ones
+    // received within |interval| of that update are merged into a single update at the end of
+    // the interval. Zero updates the battery for every uevent. May be called from Init().
+    void SetBatteryUpdateDebounceInterval(std::chrono::milliseconds interval);
+
   private:
     struct EventHandler {
         HealthLoop* object = nullptr;
@@ -93,6 +100,7 @@ class HealthLoop {
     void UeventEvent(uint32_t);
     void WakeAlarmSetInterval(int interval);
     void PeriodicChores();
+    void BatteryUpdate();
 
     // These are fixed after InitInternal() is called.
     struct healthd_config healthd_config_;
@@ -104,6 +112,8 @@ class HealthLoop {
     int awake_poll_interval_;  // -1 for no epoll timeout
     int wakealarm_wake_interval_;
 
+    BatteryUpdateDebouncer battery_update_debouncer_;
+
     // If set to true, future RegisterEvent() will be rejected. This is to ensure all
     // events are registered before StartLoop().
     bool reject_event_register_ = false;
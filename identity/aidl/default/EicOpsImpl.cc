@@ -145,6 +145,84 @@ bool eicNextId(uint32_t* id) {
     return true;
 }
 
+namespace {
+
+constexpr size_t kAes128GcmKeySize = 16;
+constexpr size_t kAesGcmIvSize = 12;
+constexpr size_t kAesGcmTagSize = 16;
+
+// AES-128-GCM contexts for the keys used most recently on this thread, with their key schedules
+// already set up. A presentation decrypts every entry it retrieves with the same storage key, so
+// the key is expanded once per session and each entry only sets a new nonce.
+class Aes128GcmContextCache {
+  public:
+    ~Aes128GcmContextCache() {
+        for (Entry& entry : mEntries) {
+            clear(entry);
+        }
+    }
+
+    // Returns the context for |key| and the given direction with the key set, or NULL on error.
+    EVP_CIPHER_CTX* get(const uint8_t* key, bool encrypt) {
+        Entry* found = nullptr;
+        for (Entry& entry : mEntries) {
+            if (entry.valid && CRYPTO_memcmp(entry.key, key, kAes128GcmKeySize) == 0) {
+                found = &entry;
+                break;
+            }
+        }
+        if (found == nullptr) {
+            found = &mEntries[mNext];
+            mNext = (mNext + 1) % kNumEntries;
+            clear(*found);
+            memcpy(found->key, key, kAes128GcmKeySize);
+            found->valid = true;
+        }
+
+        EVP_CIPHER_CTX*& ctx = encrypt ? found->encryptCtx : found->decryptCtx;
+        if (ctx != nullptr) {
+            return ctx;
+        }
+        ctx = EVP_CIPHER_CTX_new();
+        if (ctx == nullptr ||
+            EVP_CipherInit_ex(ctx, EVP_aes_128_gcm(), NULL, NULL, NULL, encrypt) != 1 ||
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, kAesGcmIvSize, NULL) != 1 ||
+            EVP_CipherInit_ex(ctx, NULL, NULL, key, NULL, encrypt) != 1) {
+            LOG(ERROR) << "Error setting up AES-128-GCM context";
+            EVP_CIPHER_CTX_free(ctx);
+            ctx = nullptr;
+        }
+        return ctx;
+    }
+
+  private:
+    struct Entry {
+        bool valid = false;
+        uint8_t key[kAes128GcmKeySize];
+        EVP_CIPHER_CTX* encryptCtx = nullptr;
+        EVP_CIPHER_CTX* decryptCtx = nullptr;
+    };
+
+    static void clear(Entry& entry) {
+        EVP_CIPHER_CTX_free(entry.encryptCtx);
+        EVP_CIPHER_CTX_free(entry.decryptCtx);
+        entry.encryptCtx = nullptr;
+        entry.decryptCtx = nullptr;
+        OPENSSL_cleanse(entry.key, sizeof(entry.key));
+        entry.valid = false;
+    }
+
+    static constexpr size_t kNumEntries = 4;
+    Entry mEntries[kNumEntries];
+    size_t mNext = 0;
+};
+
+thread_local Aes128GcmContextCache aes128GcmContexts;
+
+}  // namespace
+
+// Encrypts |data| using |key|, |nonce| and |additionalAuthenticationData| into |encryptedData|,
+// which must be of size |dataSize| + 28: the nonce, the ciphertext and the tag.
 bool eicOpsEncryptAes128Gcm(
         const uint8_t* key,    // Must be 16 bytes
         const uint8_t* nonce,  // Must be 12 bytes
@@ -152,34 +230,39 @@ bool eicOpsEncryptAes128Gcm(
         size_t dataSize,
         const uint8_t* additionalAuthenticationData,  // May be NULL if size is 0
         size_t additionalAuthenticationDataSize, uint8_t* encryptedData) {
-    vector<uint8_t> cppKey;
-    cppKey.resize(16);
-    memcpy(cppKey.data(), key, 16);
-
-    vector<uint8_t> cppData;
-    cppData.resize(dataSize);
-    if (dataSize > 0) {
-        memcpy(cppData.data(), data, dataSize);
-    }
-
-    vector<uint8_t> cppAAD;
-    cppAAD.resize(additionalAuthenticationDataSize);
-    if (additionalAuthenticationDataSize > 0) {
-        memcpy(cppAAD.data(), additionalAuthenticationData, additionalAuthenticationDataSize);
+    EVP_CIPHER_CTX* ctx = aes128GcmContexts.get(key, true /* encrypt */);
+    if (ctx == nullptr) {
+        return false;
     }
 
-    vector<uint8_t> cppNonce;
-    cppNonce.resize(12);
-    memcpy(cppNonce.data(), nonce, 12);
+    uint8_t* cipherText = encryptedData + kAesGcmIvSize;
+    uint8_t* tag = cipherText + dataSize;
+    memcpy(encryptedData, nonce, kAesGcmIvSize);
 
-    optional<vector<uint8_t>> cppEncryptedData =
-            android::hardware::identity::support::encryptAes128Gcm(cppKey, cppNonce, cppData,
-                                                                   cppAAD);
-    if (!cppEncryptedData.has_value()) {
+    int numWritten;
+    if (EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, nonce) != 1) {
+        LOG(ERROR) << "EVP_EncryptInit_ex: failed setting nonce";
+        return false;
+    }
+    if (additionalAuthenticationDataSize > 0 &&
+        EVP_EncryptUpdate(ctx, NULL, &numWritten, additionalAuthenticationData,
+                          additionalAuthenticationDataSize) != 1) {
+        LOG(ERROR) << "EVP_EncryptUpdate: failed for additionalAuthenticationData";
+        return false;
+    }
+    if (dataSize > 0 && (EVP_EncryptUpdate(ctx, cipherText, &numWritten, data, dataSize) != 1 ||
+                         size_t(numWritten) != dataSize)) {
+        LOG(ERROR) << "EVP_EncryptUpdate: failed for data";
+        return false;
+    }
+    if (EVP_EncryptFinal_ex(ctx, cipherText + dataSize, &numWritten) != 1 || numWritten != 0) {
+        LOG(ERROR) << "EVP_EncryptFinal_ex: failed";
+        return false;
+    }
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, kAesGcmTagSize, tag) != 1) {
+        LOG(ERROR) << "EVP_CIPHER_CTX_ctrl: failed getting tag";
         return false;
     }
-
-    memcpy(encryptedData, cppEncryptedData.value().data(), cppEncryptedData.value().size());
     return true;
 }
 
@@ -192,37 +275,33 @@ bool eicOpsDecryptAes128Gcm(const uint8_t* key,  // Must be 16 bytes
                             const uint8_t* encryptedData, size_t encryptedDataSize,
                             const uint8_t* additionalAuthenticationData,
                             size_t additionalAuthenticationDataSize, uint8_t* data) {
-    vector<uint8_t> keyVec;
-    keyVec.resize(16);
-    memcpy(keyVec.data(), key, 16);
-
-    vector<uint8_t> encryptedDataVec;
-    encryptedDataVec.resize(encryptedDataSize);
-    if (encryptedDataSize > 0) {
-        memcpy(encryptedDataVec.data(), encryptedData, encryptedDataSize);
-    }
-
-    vector<uint8_t> aadVec;
-    aadVec.resize(additionalAuthenticationDataSize);
-    if (additionalAuthenticationDataSize > 0) {
-        memcpy(aadVec.data(), additionalAuthenticationData, additionalAuthenticationDataSize);
-    }
-
-    optional<vector<uint8_t>> decryptedDataVec =
-            android::hardware::identity::support::decryptAes128Gcm(keyVec, encryptedDataVec,
-                                                                   aadVec);
-    if (!decryptedDataVec.has_value()) {
-        eicDebug("Error decrypting data");
+    if (encryptedDataSize < kAesGcmIvSize + kAesGcmTagSize) {
+        eicDebug("Encrypted data is size %zd, too small", encryptedDataSize);
         return false;
     }
-    if (decryptedDataVec.value().size() != encryptedDataSize - 28) {
-        eicDebug("Decrypted data is size %zd, expected %zd", decryptedDataVec.value().size(),
-                 encryptedDataSize - 28);
+    EVP_CIPHER_CTX* ctx = aes128GcmContexts.get(key, false /* encrypt */);
+    if (ctx == nullptr) {
         return false;
     }
 
-    if (decryptedDataVec.value().size() > 0) {
-        memcpy(data, decryptedDataVec.value().data(), decryptedDataVec.value().size());
+    const size_t cipherTextSize = encryptedDataSize - kAesGcmIvSize - kAesGcmTagSize;
+    const uint8_t* nonce = encryptedData;
+    const uint8_t* cipherText = nonce + kAesGcmIvSize;
+    const uint8_t* tag = cipherText + cipherTextSize;
+
+    int numWritten;
+    if (EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, nonce) != 1 ||
+        (additionalAuthenticationDataSize > 0 &&
+         EVP_DecryptUpdate(ctx, NULL, &numWritten, additionalAuthenticationData,
+                           additionalAuthenticationDataSize) != 1) ||
+        (cipherTextSize > 0 &&
+         (EVP_DecryptUpdate(ctx, data, &numWritten, cipherText, cipherTextSize) != 1 ||
+          size_t(numWritten) != cipherTextSize)) ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, kAesGcmTagSize, (void*)tag) != 1 ||
+        EVP_DecryptFinal_ex(ctx, data + cipherTextSize, &numWritten) != 1) {
+        eicDebug("Error decrypting data");
+        eicMemSet(data, 0, cipherTextSize);
+        return false;
     }
     return true;
 }
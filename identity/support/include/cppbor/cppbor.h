@@ -22,6 +22,7 @@
 #include <memory>
 #include <numeric>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace cppbor {
@@ -58,6 +59,8 @@ class Nint;
 class Int;
 class Tstr;
 class Bstr;
+class ViewTstr;
+class ViewBstr;
 class Simple;
 class Bool;
 class Array;
@@ -116,6 +119,8 @@ class Item {
     virtual const Nint* asNint() const { return nullptr; }
     virtual const Tstr* asTstr() const { return nullptr; }
     virtual const Bstr* asBstr() const { return nullptr; }
+    virtual const ViewTstr* asViewTstr() const { return nullptr; }
+    virtual const ViewBstr* asViewBstr() const { return nullptr; }
     virtual const Simple* asSimple() const { return nullptr; }
     virtual const Map* asMap() const { return nullptr; }
     virtual const Array* asArray() const { return nullptr; }
@@ -161,22 +166,22 @@ class Item {
     }
 
     /**
-     * Encodes the Item into a new std::vector<uint8_t>.
+     * Encodes the Item into a new std::vector<uint8_t>.  The size is computed first, so that the
+     * encoding is written in place into a buffer allocated exactly once.
      */
     std::vector<uint8_t> encode() const {
-        std::vector<uint8_t> retval;
-        retval.reserve(encodedSize());
-        encode(std::back_inserter(retval));
+        std::vector<uint8_t> retval(encodedSize());
+        encode(retval.data(), retval.data() + retval.size());
         return retval;
     }
 
     /**
-     * Encodes the Item into a new std::string.
+     * Encodes the Item into a new std::string, sized like encode() above.
      */
     std::string toString() const {
-        std::string retval;
-        retval.reserve(encodedSize());
-        encode([&](uint8_t v) { retval.push_back(v); });
+        std::string retval(encodedSize(), '\0');
+        uint8_t* data = reinterpret_cast<uint8_t*>(retval.data());
+        encode(data, data + retval.size());
         return retval;
     }
 
@@ -332,6 +337,48 @@ class Bstr : public Item {
     std::vector<uint8_t> mValue;
 };
 
+/**
+ * ViewBstr is a concrete Item that implements major type 2 without owning its contents.  It only
+ * references the bytes, which must outlive it and any clone() of it.  parseWithViews() produces
+ * these instead of Bstr, so that large byte strings are not copied out of the input buffer.
+ */
+class ViewBstr : public Item {
+  public:
+    static constexpr MajorType kMajorType = BSTR;
+
+    // Construct from a basic_string_view
+    explicit ViewBstr(std::basic_string_view<uint8_t> v) : mView(v) {}
+
+    // Construct from a pointer/size pair
+    explicit ViewBstr(const uint8_t* begin, size_t size) : mView(begin, size) {}
+
+    // Construct from a pointer range
+    ViewBstr(const uint8_t* begin, const uint8_t* end) : mView(begin, end - begin) {}
+
+    bool operator==(const ViewBstr& other) const& { return mView == other.mView; }
+
+    MajorType type() const override { return kMajorType; }
+    const ViewBstr* asViewBstr() const override { return this; }
+    size_t encodedSize() const override { return headerSize(mView.size()) + mView.size(); }
+    using Item::encode;
+    uint8_t* encode(uint8_t* pos, const uint8_t* end) const override;
+    void encode(EncodeCallback encodeCallback) const override {
+        encodeHeader(mView.size(), encodeCallback);
+        encodeValue(encodeCallback);
+    }
+
+    std::basic_string_view<uint8_t> view() const { return mView; }
+
+    virtual std::unique_ptr<Item> clone() const override {
+        return std::make_unique<ViewBstr>(mView);
+    }
+
+  private:
+    void encodeValue(EncodeCallback encodeCallback) const;
+
+    std::basic_string_view<uint8_t> mView;
+};
+
 /**
  * Bstr is a concrete Item that implements major type 3.
  */
@@ -382,6 +429,46 @@ class Tstr : public Item {
     std::string mValue;
 };
 
+/**
+ * ViewTstr is a concrete Item that implements major type 3 without owning its contents.  It only
+ * references the characters, which must outlive it and any clone() of it.  parseWithViews()
+ * produces these instead of Tstr.
+ */
+class ViewTstr : public Item {
+  public:
+    static constexpr MajorType kMajorType = TSTR;
+
+    // Construct from a string_view
+    explicit ViewTstr(std::string_view v) : mView(v) {}
+
+    // Construct from a pointer range
+    ViewTstr(const uint8_t* begin, const uint8_t* end)
+        : mView(reinterpret_cast<const char*>(begin), end - begin) {}
+
+    bool operator==(const ViewTstr& other) const& { return mView == other.mView; }
+
+    MajorType type() const override { return kMajorType; }
+    const ViewTstr* asViewTstr() const override { return this; }
+    size_t encodedSize() const override { return headerSize(mView.size()) + mView.size(); }
+    using Item::encode;
+    uint8_t* encode(uint8_t* pos, const uint8_t* end) const override;
+    void encode(EncodeCallback encodeCallback) const override {
+        encodeHeader(mView.size(), encodeCallback);
+        encodeValue(encodeCallback);
+    }
+
+    std::string_view view() const { return mView; }
+
+    virtual std::unique_ptr<Item> clone() const override {
+        return std::make_unique<ViewTstr>(mView);
+    }
+
+  private:
+    void encodeValue(EncodeCallback encodeCallback) const;
+
+    std::string_view mView;
+};
+
 /**
  * CompoundItem is an abstract Item that provides common functionality for Items that contain other
  * items, i.e. Arrays (CBOR type 4) and Maps (CBOR type 5).
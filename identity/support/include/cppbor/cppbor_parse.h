@@ -66,6 +66,22 @@ inline ParseResult parse(const uint8_t* begin, size_t size) {
     return parse(begin, begin + size);
 }
 
+/**
+ * Parse the first CBOR data item (possibly compound) from the range [begin, end), like parse()
+ * above, except that byte and text strings are returned as ViewBstr and ViewTstr items referencing
+ * the input rather than as Bstr and Tstr copies of it.  The buffer must outlive the returned Item.
+ * This avoids copying large payloads, e.g. encrypted entry values, out of the input.
+ */
+ParseResult parseWithViews(const uint8_t* begin, const uint8_t* end);
+
+/**
+ * Parse the first CBOR data item (possibly compound) from the range [begin, begin + size), like
+ * parseWithViews(begin, end) above.  The buffer must outlive the returned Item.
+ */
+inline ParseResult parseWithViews(const uint8_t* begin, size_t size) {
+    return parseWithViews(begin, begin + size);
+}
+
 class ParseClient;
 
 /**
@@ -82,6 +98,15 @@ inline void parse(const std::vector<uint8_t>& encoding, ParseClient* parseClient
     return parse(encoding.data(), encoding.data() + encoding.size(), parseClient);
 }
 
+/**
+ * Parse the CBOR data in the range [begin, end) in streaming fashion, like parse() above, except
+ * that byte and text strings are passed to parseClient as ViewBstr and ViewTstr items referencing
+ * the input.  Combined with a ParseClient that ignores everything between the item() and itemEnd()
+ * calls for a compound item, this skips over parts of a document, e.g. namespaces the caller is not
+ * interested in, without copying anything out of them.
+ */
+void parseWithViews(const uint8_t* begin, const uint8_t* end, ParseClient* parseClient);
+
 /**
  * A pure interface that callers of the streaming parse functions must implement.
  */
@@ -41,6 +41,21 @@ void writeBigEndian(T value, std::function<void(uint8_t)>& cb) {
     }
 }
 
+// Returns the contents of a BSTR or TSTR item, whether it owns them or is a view.
+std::basic_string_view<uint8_t> stringContents(const Item& item) {
+    if (auto bstr = item.asBstr()) return {bstr->value().data(), bstr->value().size()};
+    if (auto viewBstr = item.asViewBstr()) return viewBstr->view();
+    std::string_view tstr;
+    if (auto owned = item.asTstr()) {
+        tstr = owned->value();
+    } else if (auto viewTstr = item.asViewTstr()) {
+        tstr = viewTstr->view();
+    } else {
+        CHECK(false);  // Impossible to get here.
+    }
+    return {reinterpret_cast<const uint8_t*>(tstr.data()), tstr.size()};
+}
+
 }  // namespace
 
 size_t headerSize(uint64_t addlInfo) {
@@ -112,9 +127,9 @@ bool Item::operator==(const Item& other) const& {
         case NINT:
             return *asNint() == *(other.asNint());
         case BSTR:
-            return *asBstr() == *(other.asBstr());
         case TSTR:
-            return *asTstr() == *(other.asTstr());
+            // Either side may be a view, compare the contents.
+            return stringContents(*this) == stringContents(other);
         case ARRAY:
             return *asArray() == *(other.asArray());
         case MAP:
@@ -171,6 +186,30 @@ void Tstr::encodeValue(EncodeCallback encodeCallback) const {
     }
 }
 
+uint8_t* ViewBstr::encode(uint8_t* pos, const uint8_t* end) const {
+    pos = encodeHeader(mView.size(), pos, end);
+    if (!pos || end - pos < static_cast<ptrdiff_t>(mView.size())) return nullptr;
+    return std::copy(mView.begin(), mView.end(), pos);
+}
+
+void ViewBstr::encodeValue(EncodeCallback encodeCallback) const {
+    for (auto c : mView) {
+        encodeCallback(c);
+    }
+}
+
+uint8_t* ViewTstr::encode(uint8_t* pos, const uint8_t* end) const {
+    pos = encodeHeader(mView.size(), pos, end);
+    if (!pos || end - pos < static_cast<ptrdiff_t>(mView.size())) return nullptr;
+    return std::copy(mView.begin(), mView.end(), pos);
+}
+
+void ViewTstr::encodeValue(EncodeCallback encodeCallback) const {
+    for (auto c : mView) {
+        encodeCallback(static_cast<uint8_t>(c));
+    }
+}
+
 bool CompoundItem::operator==(const CompoundItem& other) const& {
     return type() == other.type()             //
            && addlInfo() == other.addlInfo()  //
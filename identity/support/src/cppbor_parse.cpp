@@ -51,6 +51,7 @@ std::tuple<bool, uint64_t, const uint8_t*> parseLength(const uint8_t* pos, const
 }
 
 std::tuple<const uint8_t*, ParseClient*> parseRecursively(const uint8_t* begin, const uint8_t* end,
+                                                          bool emitViews,
                                                           ParseClient* parseClient);
 
 std::tuple<const uint8_t*, ParseClient*> handleUint(uint64_t value, const uint8_t* hdrBegin,
@@ -88,17 +89,22 @@ std::tuple<const uint8_t*, ParseClient*> handleNull(const uint8_t* hdrBegin, con
             parseClient->item(item, hdrBegin, hdrEnd /* valueBegin */, hdrEnd /* itemEnd */)};
 }
 
-template <typename T>
+template <typename T, typename ViewT>
 std::tuple<const uint8_t*, ParseClient*> handleString(uint64_t length, const uint8_t* hdrBegin,
                                                       const uint8_t* valueBegin, const uint8_t* end,
-                                                      const std::string& errLabel,
+                                                      const std::string& errLabel, bool emitViews,
                                                       ParseClient* parseClient) {
     if (end - valueBegin < static_cast<ssize_t>(length)) {
         parseClient->error(hdrBegin, insufficientLengthString(length, end - valueBegin, errLabel));
         return {hdrBegin, nullptr /* end parsing */};
     }
 
-    std::unique_ptr<Item> item = std::make_unique<T>(valueBegin, valueBegin + length);
+    std::unique_ptr<Item> item;
+    if (emitViews) {
+        item = std::make_unique<ViewT>(valueBegin, valueBegin + length);
+    } else {
+        item = std::make_unique<T>(valueBegin, valueBegin + length);
+    }
     return {valueBegin + length,
             parseClient->item(item, hdrBegin, valueBegin, valueBegin + length)};
 }
@@ -156,7 +162,7 @@ class IncompleteSemantic : public Semantic, public IncompleteItem {
 
 std::tuple<const uint8_t*, ParseClient*> handleEntries(size_t entryCount, const uint8_t* hdrBegin,
                                                        const uint8_t* pos, const uint8_t* end,
-                                                       const std::string& typeName,
+                                                       const std::string& typeName, bool emitViews,
                                                        ParseClient* parseClient) {
     while (entryCount > 0) {
         --entryCount;
@@ -164,7 +170,7 @@ std::tuple<const uint8_t*, ParseClient*> handleEntries(size_t entryCount, const
             parseClient->error(hdrBegin, "Not enough entries for " + typeName + ".");
             return {hdrBegin, nullptr /* end parsing */};
         }
-        std::tie(pos, parseClient) = parseRecursively(pos, end, parseClient);
+        std::tie(pos, parseClient) = parseRecursively(pos, end, emitViews, parseClient);
         if (!parseClient) return {hdrBegin, nullptr};
     }
     return {pos, parseClient};
@@ -173,20 +179,21 @@ std::tuple<const uint8_t*, ParseClient*> handleEntries(size_t entryCount, const
 std::tuple<const uint8_t*, ParseClient*> handleCompound(
         std::unique_ptr<Item> item, uint64_t entryCount, const uint8_t* hdrBegin,
         const uint8_t* valueBegin, const uint8_t* end, const std::string& typeName,
-        ParseClient* parseClient) {
+        bool emitViews, ParseClient* parseClient) {
     parseClient =
             parseClient->item(item, hdrBegin, valueBegin, valueBegin /* don't know the end yet */);
     if (!parseClient) return {hdrBegin, nullptr};
 
     const uint8_t* pos;
     std::tie(pos, parseClient) =
-            handleEntries(entryCount, hdrBegin, valueBegin, end, typeName, parseClient);
+            handleEntries(entryCount, hdrBegin, valueBegin, end, typeName, emitViews, parseClient);
     if (!parseClient) return {hdrBegin, nullptr};
 
     return {pos, parseClient->itemEnd(item, hdrBegin, valueBegin, pos)};
 }
 
 std::tuple<const uint8_t*, ParseClient*> parseRecursively(const uint8_t* begin, const uint8_t* end,
+                                                          bool emitViews,
                                                           ParseClient* parseClient) {
     const uint8_t* pos = begin;
 
@@ -232,22 +239,24 @@ std::tuple<const uint8_t*, ParseClient*> parseRecursively(const uint8_t* begin,
             return handleNint(addlData, begin, pos, parseClient);
 
         case BSTR:
-            return handleString<Bstr>(addlData, begin, pos, end, "byte string", parseClient);
+            return handleString<Bstr, ViewBstr>(addlData, begin, pos, end, "byte string",
+                                                emitViews, parseClient);
 
         case TSTR:
-            return handleString<Tstr>(addlData, begin, pos, end, "text string", parseClient);
+            return handleString<Tstr, ViewTstr>(addlData, begin, pos, end, "text string",
+                                                emitViews, parseClient);
 
         case ARRAY:
             return handleCompound(std::make_unique<IncompleteArray>(addlData), addlData, begin, pos,
-                                  end, "array", parseClient);
+                                  end, "array", emitViews, parseClient);
 
         case MAP:
             return handleCompound(std::make_unique<IncompleteMap>(addlData), addlData * 2, begin,
-                                  pos, end, "map", parseClient);
+                                  pos, end, "map", emitViews, parseClient);
 
         case SEMANTIC:
             return handleCompound(std::make_unique<IncompleteSemantic>(addlData), 1, begin, pos,
-                                  end, "semantic", parseClient);
+                                  end, "semantic", emitViews, parseClient);
 
         case SIMPLE:
             switch (addlData) {
@@ -337,7 +346,11 @@ class FullParseClient : public ParseClient {
 }  // anonymous namespace
 
 void parse(const uint8_t* begin, const uint8_t* end, ParseClient* parseClient) {
-    parseRecursively(begin, end, parseClient);
+    parseRecursively(begin, end, false /* emitViews */, parseClient);
+}
+
+void parseWithViews(const uint8_t* begin, const uint8_t* end, ParseClient* parseClient) {
+    parseRecursively(begin, end, true /* emitViews */, parseClient);
 }
 
 std::tuple<std::unique_ptr<Item> /* result */, const uint8_t* /* newPos */,
@@ -348,4 +361,10 @@ parse(const uint8_t* begin, const uint8_t* end) {
     return parseClient.parseResult();
 }
 
+ParseResult parseWithViews(const uint8_t* begin, const uint8_t* end) {
+    FullParseClient parseClient;
+    parseWithViews(begin, end, &parseClient);
+    return parseClient.parseResult();
+}
+
 }  // namespace cppbor
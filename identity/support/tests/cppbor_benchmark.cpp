@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "cppbor.h"
+
+namespace {
+
+using cppbor::Array;
+using cppbor::Bstr;
+using cppbor::Map;
+using cppbor::Semantic;
+using cppbor::Tstr;
+
+// Roughly the shape of an ISO 18013-5 DeviceResponse: one document with a single namespace
+// holding the given number of IssuerSignedItems, each carrying a digest, random and a value.
+// The portrait is a large bstr, which is where most of the bytes of a real mDL go.
+Map makeDeviceResponse(size_t numItems) {
+    Array issuerSignedItems;
+    for (size_t i = 0; i < numItems; i++) {
+        Map item;
+        item.add("digestID", i);
+        item.add("random", Bstr(std::vector<uint8_t>(16, static_cast<uint8_t>(i))));
+        item.add("elementIdentifier", "element_" + std::to_string(i));
+        item.add("elementValue", "value of element number " + std::to_string(i));
+        issuerSignedItems.add(Semantic(24, Bstr(item.encode())));
+    }
+    issuerSignedItems.add(Map("digestID", numItems,                                    //
+                              "elementIdentifier", "portrait",                          //
+                              "elementValue", Bstr(std::vector<uint8_t>(16 * 1024, 0x42))));
+
+    Map nameSpaces;
+    nameSpaces.add("org.iso.18013.5.1", std::move(issuerSignedItems));
+    Map issuerSigned;
+    issuerSigned.add("nameSpaces", std::move(nameSpaces));
+    issuerSigned.add("issuerAuth", Array(Bstr(std::vector<uint8_t>(64, 0x01)), Map(),
+                                         Bstr(std::vector<uint8_t>(1024, 0x02)),
+                                         Bstr(std::vector<uint8_t>(64, 0x03))));
+
+    Map document;
+    document.add("docType", "org.iso.18013.5.1.mDL");
+    document.add("issuerSigned", std::move(issuerSigned));
+    document.add("deviceSigned", Map("nameSpaces", Semantic(24, Bstr(Map().encode()))));
+
+    Map deviceResponse;
+    deviceResponse.add("version", "1.0");
+    deviceResponse.add("documents", Array(std::move(document)));
+    deviceResponse.add("status", 0);
+    return deviceResponse;
+}
+
+void BM_EncodeVector(benchmark::State& state) {
+    const Map response = makeDeviceResponse(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(response.encode());
+    }
+    state.SetBytesProcessed(state.iterations() * response.encodedSize());
+}
+BENCHMARK(BM_EncodeVector)->Arg(8)->Arg(32)->Arg(128);
+
+void BM_EncodeString(benchmark::State& state) {
+    const Map response = makeDeviceResponse(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(response.toString());
+    }
+    state.SetBytesProcessed(state.iterations() * response.encodedSize());
+}
+BENCHMARK(BM_EncodeString)->Arg(8)->Arg(32)->Arg(128);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2021, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "cppbor.h"
+#include "cppbor_parse.h"
+
+using namespace cppbor;
+using namespace std;
+
+using ::testing::ByRef;
+using ::testing::ElementsAre;
+
+MATCHER_P(MatchesItem, value, "") {
+    return arg && *arg == value;
+}
+
+TEST(ViewParserTest, Tstr) {
+    Tstr val("Hello");
+
+    auto encoded = val.encode();
+    auto [item, pos, message] = parseWithViews(encoded.data(), encoded.size());
+    ASSERT_NE(nullptr, item);
+    EXPECT_EQ(nullptr, item->asTstr());
+    ASSERT_NE(nullptr, item->asViewTstr());
+    EXPECT_EQ("Hello", item->asViewTstr()->view());
+    EXPECT_EQ(reinterpret_cast<const char*>(encoded.data() + 1), item->asViewTstr()->view().data());
+    EXPECT_THAT(item, MatchesItem(val));
+}
+
+TEST(ViewParserTest, Bstr) {
+    Bstr val("\x00\x01\0x02"s);
+
+    auto encoded = val.encode();
+    auto [item, pos, message] = parseWithViews(encoded.data(), encoded.size());
+    ASSERT_NE(nullptr, item);
+    EXPECT_EQ(nullptr, item->asBstr());
+    ASSERT_NE(nullptr, item->asViewBstr());
+    EXPECT_EQ(encoded.data() + 1, item->asViewBstr()->view().data());
+    EXPECT_THAT(item, MatchesItem(val));
+    EXPECT_EQ(encoded, item->encode());
+}
+
+TEST(ViewParserTest, Complex) {
+    vector<uint8_t> vec = {0x01, 0x02, 0x08, 0x03};
+    Map val("Outer1",
+            Array(Map("Inner1", 99,  //
+                      "Inner2", vec),
+                  "foo"),
+            "Outer2", 10);
+
+    auto encoded = val.encode();
+    auto [item, pos, message] = parseWithViews(encoded.data(), encoded.data() + encoded.size());
+    EXPECT_THAT(item, MatchesItem(ByRef(val)));
+    EXPECT_EQ(pos, encoded.data() + encoded.size());
+    EXPECT_EQ("", message);
+    EXPECT_EQ(encoded, item->encode());
+    EXPECT_THAT(item->clone(), MatchesItem(ByRef(val)));
+}
+
+TEST(ViewParserTest, IncompleteString) {
+    Tstr val("hello");
+
+    auto encoding = val.encode();
+    auto [item, pos, message] = parseWithViews(encoding.data(), encoding.size() - 2);
+    EXPECT_EQ(nullptr, item.get());
+    EXPECT_EQ(encoding.data(), pos);
+    EXPECT_EQ("Need 5 byte(s) for text string, have 3.", message);
+}
+
+// Collects views of the text values of a top-level map, skipping over the entry whose key is
+// skippedKey without looking at anything inside it.
+class SkippingParseClient : public ParseClient {
+  public:
+    explicit SkippingParseClient(std::string_view skippedKey) : mSkippedKey(skippedKey) {}
+
+    ParseClient* item(std::unique_ptr<Item>& item, const uint8_t*, const uint8_t*,
+                      const uint8_t*) override {
+        if (mDepth++ == 1) {
+            if (mNextIsValue) {
+                if (!mSkipping) mValues.push_back(item->asViewTstr()->view());
+                mSkipping = false;
+            } else {
+                mSkipping = item->asViewTstr()->view() == mSkippedKey;
+            }
+            mNextIsValue = !mNextIsValue;
+        }
+        if (!item->isCompound()) --mDepth;
+        return this;
+    }
+
+    ParseClient* itemEnd(std::unique_ptr<Item>&, const uint8_t*, const uint8_t*,
+                         const uint8_t*) override {
+        if (--mDepth == 1) {
+            mSkipping = false;
+        }
+        return this;
+    }
+
+    void error(const uint8_t*, const std::string&) override { ADD_FAILURE(); }
+
+    std::vector<std::string_view> mValues;
+
+  private:
+    std::string_view mSkippedKey;
+    int mDepth = 0;
+    bool mNextIsValue = false;
+    bool mSkipping = false;
+};
+
+TEST(ViewParserTest, StreamingSkipsUninterestingEntries) {
+    Map val("org.iso.18013.5.1", "wanted",               //
+            "org.example.skipped", Map("a", Bstr("xx"))  //
+                                           .add("b", Array(1, 2, 3)),
+            "org.example.other", "also wanted");
+
+    auto encoded = val.encode();
+    SkippingParseClient client("org.example.skipped");
+    parseWithViews(encoded.data(), encoded.data() + encoded.size(), &client);
+    EXPECT_THAT(client.mValues, ElementsAre("wanted", "also wanted"));
+}
+
+TEST(EqualityTest, Views) {
+    std::string hello = "hello";
+    std::vector<uint8_t> bytes = {0x01, 0x02};
+    const Item& viewTstr = ViewTstr(hello);
+    const Item& viewBstr = ViewBstr(bytes.data(), bytes.size());
+
+    EXPECT_EQ(viewTstr, Tstr("hello"));
+    EXPECT_EQ(static_cast<const Item&>(Tstr("hello")), viewTstr);
+    EXPECT_NE(viewTstr, Tstr("hellO"));
+    EXPECT_EQ(viewBstr, Bstr(bytes));
+    EXPECT_EQ(static_cast<const Item&>(Bstr(bytes)), viewBstr);
+    EXPECT_NE(viewBstr, Bstr(std::vector<uint8_t>{0x01}));
+    EXPECT_NE(viewBstr, Tstr("\x01\x02"));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -20,6 +20,8 @@
 #include <android/hardware/input/classifier/1.0/IInputClassifier.h>
 #include <hidl/Status.h>
 
+#include "MotionClassifier.h"
+
 namespace android {
 namespace hardware {
 namespace input {
@@ -37,6 +39,10 @@ struct InputClassifier : public IInputClassifier {
 
     Return<void> reset() override;
     Return<void> resetDevice(int32_t deviceId) override;
+
+  private:
+    // The service has a single binder thread, which serializes the calls
+    MotionClassifier mClassifier;
 };
 
 }  // namespace implementation
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MotionClassifier.h"
+
+#include <algorithm>
+
+using namespace android::hardware::input::common::V1_0;
+
+namespace android {
+namespace hardware {
+namespace input {
+namespace classifier {
+namespace V1_0 {
+namespace implementation {
+
+namespace {
+
+/**
+ * Returns the value of an axis, or 0 if it is not present. The bits follow the BitSet64 layout
+ * of the framework's PointerCoords: axis n is bit 63 - n, and the values are packed in the order
+ * of the axes.
+ */
+float getAxisValue(const PointerCoords& coords, Axis axis) {
+    const uint64_t bits = coords.bits;
+    const uint32_t n = static_cast<uint32_t>(axis);
+    const uint64_t bit = 0x8000000000000000ULL >> n;
+    if ((bits & bit) == 0) {
+        return 0;
+    }
+    const size_t index = __builtin_popcountll(bits & ~(0xFFFFFFFFFFFFFFFFULL >> n));
+    return index < coords.values.size() ? coords.values[index] : 0;
+}
+
+}  // namespace
+
+void MotionClassifier::DeviceState::resetGesture() {
+    for (uint32_t ids = downPointers; ids != 0; ids &= ids - 1) {
+        PointerState& pointer = pointers[__builtin_ctz(ids)];
+        pointer.down = false;
+        pointer.count = 0;
+    }
+    downPointers = 0;
+    decided = false;
+    classification = Classification::NONE;
+}
+
+MotionClassifier::MotionClassifier() {
+    mDevices.reserve(kMaxDevices);
+}
+
+MotionClassifier::DeviceState& MotionClassifier::getDevice(int32_t deviceId) {
+    for (auto& device : mDevices) {
+        if (device.deviceId == deviceId) {
+            return device;
+        }
+    }
+
+    DeviceState* device;
+    if (mDevices.size() < kMaxDevices) {
+        device = &mDevices.emplace_back();
+    } else {
+        device = &*std::min_element(mDevices.begin(), mDevices.end(),
+                                    [](const DeviceState& a, const DeviceState& b) {
+                                        return a.lastUsed < b.lastUsed;
+                                    });
+        device->resetGesture();
+        device->usualDownPressure = 0;
+    }
+    device->deviceId = deviceId;
+    return *device;
+}
+
+void MotionClassifier::addSample(PointerState& pointer, const Sample& sample) {
+    pointer.history[pointer.head] = sample;
+    pointer.head = (pointer.head + 1) % kHistorySize;
+    if (pointer.count < kHistorySize) {
+        ++pointer.count;
+    }
+}
+
+void MotionClassifier::addDownPressure(DeviceState& device, float pressure) {
+    float& usual = device.usualDownPressure;
+    usual = usual == 0 ? pressure : usual + kDownPressureWeight * (pressure - usual);
+}
+
+Classification MotionClassifier::classify(const MotionEvent& event) {
+    const uint32_t touchscreen = static_cast<uint32_t>(Source::TOUCHSCREEN);
+    if ((static_cast<uint32_t>(event.source) & touchscreen) != touchscreen) {
+        return Classification::NONE;
+    }
+
+    DeviceState& device = getDevice(event.deviceId);
+    device.lastUsed = ++mEventCount;
+    switch (event.action) {
+        case Action::DOWN:
+            device.resetGesture();
+            break;
+        case Action::UP:
+        case Action::CANCEL:
+            device.resetGesture();
+            return Classification::NONE;
+        case Action::MOVE:
+        case Action::POINTER_DOWN:
+        case Action::POINTER_UP:
+            break;
+        default:
+            // Hover, scroll and button events do not belong to a touch gesture
+            return Classification::NONE;
+    }
+    if (device.downPointers == 0) {
+        device.downTime = event.downTime;
+    }
+
+    const size_t pointerCount =
+            std::min(event.pointerProperties.size(), event.pointerCoords.size());
+    for (size_t i = 0; i < pointerCount; i++) {
+        const PointerProperties& properties = event.pointerProperties[i];
+        if (properties.id < 0 || static_cast<size_t>(properties.id) >= kMaxPointerIds) {
+            continue;
+        }
+        PointerState& pointer = device.pointers[properties.id];
+        const uint32_t idBit = 1u << properties.id;
+        if (event.action == Action::POINTER_UP && i == event.actionIndex) {
+            pointer.down = false;
+            pointer.count = 0;
+            device.downPointers &= ~idBit;
+            continue;
+        }
+        if (properties.toolType != ToolType::FINGER) {
+            // Stylus pressure does not mean the same thing
+            device.decided = true;
+            device.classification = Classification::NONE;
+        }
+
+        const PointerCoords& coords = event.pointerCoords[i];
+        const Sample sample = {event.eventTime, getAxisValue(coords, Axis::X),
+                               getAxisValue(coords, Axis::Y), getAxisValue(coords, Axis::PRESSURE)};
+        if (!pointer.down) {
+            pointer.down = true;
+            pointer.downX = sample.x;
+            pointer.downY = sample.y;
+            pointer.downPressure = sample.pressure;
+            pointer.count = 0;
+            device.downPointers |= idBit;
+            if (event.action == Action::DOWN && properties.toolType == ToolType::FINGER) {
+                addDownPressure(device, sample.pressure);
+            }
+        }
+        addSample(pointer, sample);
+    }
+    return decide(device, event.eventTime);
+}
+
+Classification MotionClassifier::decide(DeviceState& device, int64_t eventTime) {
+    if (device.decided) {
+        return device.classification;
+    }
+
+    // Only a single finger can deep press; anything else is decided as soon as it is seen
+    const uint32_t ids = device.downPointers;
+    const float usualPressure = device.usualDownPressure;
+    if (ids == 0 || (ids & (ids - 1)) != 0 || usualPressure <= 0) {
+        device.decided = true;
+        device.classification = Classification::NONE;
+        return device.classification;
+    }
+    const PointerState& pointer = device.pointers[__builtin_ctz(ids)];
+    const Sample& latest = pointer.history[(pointer.head + kHistorySize - 1) % kHistorySize];
+    const Sample& oldest = pointer.history[(pointer.head + kHistorySize - pointer.count) %
+                                           kHistorySize];
+
+    const float dx = latest.x - pointer.downX;
+    const float dy = latest.y - pointer.downY;
+    if (dx * dx + dy * dy > kTouchSlopPx * kTouchSlopPx) {
+        device.decided = true;
+        device.classification = Classification::NONE;
+    } else if (latest.pressure >= kDeepPressPressure * usualPressure &&
+               latest.pressure - pointer.downPressure >= kDeepPressRise * usualPressure) {
+        device.decided = true;
+        device.classification = Classification::DEEP_PRESS;
+    } else if (eventTime - device.downTime > kMaxAmbiguousNs) {
+        device.decided = true;
+        device.classification = Classification::NONE;
+    } else if (latest.pressure - oldest.pressure > kPressureRiseEpsilon * usualPressure) {
+        return Classification::AMBIGUOUS_GESTURE;
+    } else {
+        return Classification::NONE;
+    }
+    return device.classification;
+}
+
+void MotionClassifier::reset() {
+    // Keeps the capacity, so that no device allocates again
+    mDevices.clear();
+}
+
+void MotionClassifier::resetDevice(int32_t deviceId) {
+    mDevices.erase(std::remove_if(mDevices.begin(), mDevices.end(),
+                                  [deviceId](const DeviceState& device) {
+                                      return device.deviceId == deviceId;
+                                  }),
+                   mDevices.end());
+}
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace classifier
+}  // namespace input
+}  // namespace hardware
+}  // namespace android
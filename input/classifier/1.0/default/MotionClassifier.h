@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_INPUT_CLASSIFIER_V1_0_MOTIONCLASSIFIER_H
+#define ANDROID_HARDWARE_INPUT_CLASSIFIER_V1_0_MOTIONCLASSIFIER_H
+
+#include <android/hardware/input/common/1.0/types.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace input {
+namespace classifier {
+namespace V1_0 {
+namespace implementation {
+
+/**
+ * Classifies touchscreen gestures from their pressure profile.
+ *
+ * A single finger that stays within the touch slop and presses harder than it touched down is
+ * reported as AMBIGUOUS_GESTURE while its pressure rises, and as DEEP_PRESS once it crosses the
+ * deep press threshold. Any other gesture is reported as NONE. The decision is latched for the
+ * rest of the gesture, and a gesture that is still undecided after kMaxAmbiguousNs is NONE.
+ *
+ * Touchscreens do not agree on the scale of their pressure axis, so the pressure thresholds are
+ * relative to the usual touch down pressure of each device, averaged over its gestures. Devices
+ * without a pressure axis are never classified.
+ *
+ * The work per event is bounded: the state of a device is a fixed table of pointers, each with a
+ * fixed ring of recent samples, and at most kMaxDevices devices are tracked. Nothing is
+ * allocated once a device has been seen. Not thread-safe.
+ */
+class MotionClassifier {
+  public:
+    static constexpr size_t kMaxDevices = 4;
+    // Pointer ids are below MAX_POINTER_ID + 1 of the framework
+    static constexpr size_t kMaxPointerIds = 32;
+    static constexpr size_t kHistorySize = 8;
+
+    // Decision parameters. The pressure ones are multiples of the usual touch down pressure of
+    // the device.
+    static constexpr float kTouchSlopPx = 24.f;
+    static constexpr float kDeepPressPressure = 2.f;
+    // How much harder than at touch down a deep press has to be
+    static constexpr float kDeepPressRise = 0.6f;
+    // The pressure has to rise by this much over the history to look like a deep press
+    static constexpr float kPressureRiseEpsilon = 0.03f;
+    static constexpr int64_t kMaxAmbiguousNs = 400'000'000;  // the default long press timeout
+    // The weight of a gesture in the usual touch down pressure of its device
+    static constexpr float kDownPressureWeight = 0.125f;
+
+    MotionClassifier();
+
+    common::V1_0::Classification classify(const common::V1_0::MotionEvent& event);
+    void reset();
+    void resetDevice(int32_t deviceId);
+
+  private:
+    struct Sample {
+        int64_t eventTime;
+        float x;
+        float y;
+        float pressure;
+    };
+
+    struct PointerState {
+        bool down = false;
+        float downX = 0;
+        float downY = 0;
+        float downPressure = 0;
+        // Ring of the last kHistorySize samples; head is the next slot written
+        std::array<Sample, kHistorySize> history;
+        uint8_t head = 0;
+        uint8_t count = 0;
+    };
+
+    struct DeviceState {
+        int32_t deviceId = -1;
+        // Bumped on each event, to find the least recently used device
+        uint64_t lastUsed = 0;
+        int64_t downTime = 0;
+        // The moving average of the pressure of the first finger of the gestures, 0 before the
+        // first one
+        float usualDownPressure = 0;
+        uint32_t downPointers = 0;  // bitmask of pointer ids
+        bool decided = false;
+        common::V1_0::Classification classification = common::V1_0::Classification::NONE;
+        std::array<PointerState, kMaxPointerIds> pointers;
+
+        void resetGesture();
+    };
+
+    // Returns the state of deviceId, replacing the least recently used device if all are taken
+    DeviceState& getDevice(int32_t deviceId);
+    static void addSample(PointerState& pointer, const Sample& sample);
+    static void addDownPressure(DeviceState& device, float pressure);
+    static common::V1_0::Classification decide(DeviceState& device, int64_t eventTime);
+
+    std::vector<DeviceState> mDevices;
+    uint64_t mEventCount = 0;
+};
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace classifier
+}  // namespace input
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_INPUT_CLASSIFIER_V1_0_MOTIONCLASSIFIER_H
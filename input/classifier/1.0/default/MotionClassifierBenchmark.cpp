@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MotionClassifier.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace android::hardware::input::common::V1_0;
+using android::hardware::input::classifier::V1_0::implementation::MotionClassifier;
+
+namespace {
+
+constexpr int64_t kFrameNs = 8'333'333;  // 120Hz touch reports
+
+// The axes of a touchscreen event, in the BitSet64 layout of the framework
+PointerCoords makeCoords(float x, float y, float pressure) {
+    PointerCoords coords;
+    coords.bits = (0x8000000000000000ULL >> static_cast<uint32_t>(Axis::X)) |
+                  (0x8000000000000000ULL >> static_cast<uint32_t>(Axis::Y)) |
+                  (0x8000000000000000ULL >> static_cast<uint32_t>(Axis::PRESSURE));
+    coords.values = {x, y, pressure};
+    return coords;
+}
+
+MotionEvent makeEvent(Action action, size_t pointerCount, int64_t eventTime, float pressure) {
+    MotionEvent event;
+    event.deviceId = 1;
+    event.source = Source::TOUCHSCREEN;
+    event.action = action;
+    event.downTime = 0;
+    event.eventTime = eventTime;
+    event.actionIndex = 0;
+    event.pointerProperties.resize(pointerCount);
+    event.pointerCoords.resize(pointerCount);
+    for (size_t i = 0; i < pointerCount; i++) {
+        event.pointerProperties[i].id = i;
+        event.pointerProperties[i].toolType = ToolType::FINGER;
+        event.pointerCoords[i] = makeCoords(100.f + 200.f * i, 500.f, pressure);
+    }
+    return event;
+}
+
+// One gesture per iteration: a down, state.range(1) moves with a rising pressure and an up,
+// with state.range(0) pointers. Reports the cost per event.
+void BM_ClassifyGesture(benchmark::State& state) {
+    const size_t pointerCount = state.range(0);
+    const size_t moveCount = state.range(1);
+    std::vector<MotionEvent> events;
+    events.push_back(makeEvent(Action::DOWN, pointerCount, 0, 0.3f));
+    for (size_t i = 1; i <= moveCount; i++) {
+        events.push_back(makeEvent(Action::MOVE, pointerCount, i * kFrameNs,
+                                   0.3f + 0.6f * i / moveCount));
+    }
+    events.push_back(makeEvent(Action::UP, pointerCount, (moveCount + 1) * kFrameNs, 0.f));
+
+    MotionClassifier classifier;
+    for (auto _ : state) {
+        for (const auto& event : events) {
+            benchmark::DoNotOptimize(classifier.classify(event));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_ClassifyGesture)->Args({1, 4})->Args({1, 32})->Args({2, 32})->Args({10, 32});
+
+// A finger resting at a steady pressure: the gesture stays undecided, so every event runs the
+// whole decision
+void BM_ClassifyMove(benchmark::State& state) {
+    MotionClassifier classifier;
+    classifier.classify(makeEvent(Action::DOWN, 1, 0, 0.3f));
+    MotionEvent move = makeEvent(Action::MOVE, 1, kFrameNs, 0.3f);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(classifier.classify(move));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClassifyMove);
+
+}  // namespace
+
+BENCHMARK_MAIN();
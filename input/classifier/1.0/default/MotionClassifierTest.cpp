@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MotionClassifier.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace android::hardware::input::common::V1_0;
+using android::hardware::input::classifier::V1_0::implementation::MotionClassifier;
+
+namespace {
+
+constexpr int64_t kFrameNs = 8'333'333;  // 120Hz touch reports
+constexpr int32_t kDeviceId = 1;
+
+struct Pointer {
+    float x = 100.f;
+    float y = 500.f;
+    float pressure = 0.3f;
+    ToolType toolType = ToolType::FINGER;
+};
+
+PointerCoords makeCoords(const Pointer& pointer) {
+    PointerCoords coords;
+    coords.bits = (0x8000000000000000ULL >> static_cast<uint32_t>(Axis::X)) |
+                  (0x8000000000000000ULL >> static_cast<uint32_t>(Axis::Y)) |
+                  (0x8000000000000000ULL >> static_cast<uint32_t>(Axis::PRESSURE));
+    coords.values = {pointer.x, pointer.y, pointer.pressure};
+    return coords;
+}
+
+MotionEvent makeEvent(Action action, int64_t frame, const std::vector<Pointer>& pointers,
+                      int32_t deviceId = kDeviceId, uint32_t actionIndex = 0) {
+    MotionEvent event;
+    event.deviceId = deviceId;
+    event.source = Source::TOUCHSCREEN;
+    event.action = action;
+    event.downTime = 0;
+    event.eventTime = frame * kFrameNs;
+    event.actionIndex = actionIndex;
+    event.pointerProperties.resize(pointers.size());
+    event.pointerCoords.resize(pointers.size());
+    for (size_t i = 0; i < pointers.size(); i++) {
+        event.pointerProperties[i].id = i;
+        event.pointerProperties[i].toolType = pointers[i].toolType;
+        event.pointerCoords[i] = makeCoords(pointers[i]);
+    }
+    return event;
+}
+
+MotionEvent makeEvent(Action action, int64_t frame, float pressure,
+                      int32_t deviceId = kDeviceId) {
+    Pointer pointer;
+    pointer.pressure = pressure;
+    return makeEvent(action, frame, std::vector<Pointer>{pointer}, deviceId);
+}
+
+// Presses a single finger from downPressure to 2.5 times as hard over 4 frames, and returns the
+// classification of each move.
+std::vector<Classification> press(MotionClassifier& classifier, float downPressure,
+                                  int32_t deviceId = kDeviceId) {
+    std::vector<Classification> classifications;
+    EXPECT_EQ(Classification::NONE,
+              classifier.classify(makeEvent(Action::DOWN, 0, downPressure, deviceId)));
+    for (int64_t frame = 1; frame <= 4; frame++) {
+        const float pressure = downPressure * (1.f + 1.5f * frame / 4);
+        classifications.push_back(
+                classifier.classify(makeEvent(Action::MOVE, frame, pressure, deviceId)));
+    }
+    return classifications;
+}
+
+const std::vector<Classification> kDeepPress = {
+        Classification::AMBIGUOUS_GESTURE, Classification::AMBIGUOUS_GESTURE,
+        Classification::DEEP_PRESS, Classification::DEEP_PRESS};
+
+}  // namespace
+
+TEST(MotionClassifierTest, IgnoresOtherSources) {
+    MotionClassifier classifier;
+    MotionEvent event = makeEvent(Action::DOWN, 0, 0.3f);
+    event.source = Source::MOUSE;
+    EXPECT_EQ(Classification::NONE, classifier.classify(event));
+}
+
+TEST(MotionClassifierTest, ClassifiesADeepPress) {
+    MotionClassifier classifier;
+    EXPECT_EQ(kDeepPress, press(classifier, 0.3f));
+
+    // The decision holds until the gesture ends, however the pressure goes on.
+    EXPECT_EQ(Classification::DEEP_PRESS, classifier.classify(makeEvent(Action::MOVE, 5, 0.3f)));
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::UP, 6, 0.f)));
+}
+
+TEST(MotionClassifierTest, SteadyPressureIsNotADeepPress) {
+    MotionClassifier classifier;
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::DOWN, 0, 0.3f)));
+    for (int64_t frame = 1; frame <= 10; frame++) {
+        EXPECT_EQ(Classification::NONE,
+                  classifier.classify(makeEvent(Action::MOVE, frame, 0.3f)));
+    }
+}
+
+TEST(MotionClassifierTest, MovingIsNotADeepPress) {
+    MotionClassifier classifier;
+    classifier.classify(makeEvent(Action::DOWN, 0, 0.3f));
+    Pointer moved;
+    moved.x += 2 * MotionClassifier::kTouchSlopPx;
+    moved.pressure = 0.35f;
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::MOVE, 1, {moved})));
+
+    // Latched, a deep press after moving is not one.
+    moved.pressure = 1.f;
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::MOVE, 2, {moved})));
+}
+
+TEST(MotionClassifierTest, ASecondPointerIsNotADeepPress) {
+    MotionClassifier classifier;
+    classifier.classify(makeEvent(Action::DOWN, 0, 0.3f));
+    Pointer first;
+    Pointer second;
+    second.x = 400.f;
+    EXPECT_EQ(Classification::NONE,
+              classifier.classify(makeEvent(Action::POINTER_DOWN, 1, {first, second},
+                                            kDeviceId, 1)));
+    first.pressure = 1.f;
+    EXPECT_EQ(Classification::NONE,
+              classifier.classify(makeEvent(Action::MOVE, 2, {first, second})));
+}
+
+TEST(MotionClassifierTest, AStylusIsNotADeepPress) {
+    MotionClassifier classifier;
+    Pointer stylus;
+    stylus.toolType = ToolType::STYLUS;
+    classifier.classify(makeEvent(Action::DOWN, 0, {stylus}));
+    stylus.pressure = 1.f;
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::MOVE, 1, {stylus})));
+}
+
+TEST(MotionClassifierTest, UndecidedGesturesTimeOut) {
+    MotionClassifier classifier;
+    classifier.classify(makeEvent(Action::DOWN, 0, 0.3f));
+    EXPECT_EQ(Classification::AMBIGUOUS_GESTURE,
+              classifier.classify(makeEvent(Action::MOVE, 1, 0.32f)));
+    const int64_t lateFrame = MotionClassifier::kMaxAmbiguousNs / kFrameNs + 1;
+    EXPECT_EQ(Classification::NONE,
+              classifier.classify(makeEvent(Action::MOVE, lateFrame, 0.33f)));
+    EXPECT_EQ(Classification::NONE,
+              classifier.classify(makeEvent(Action::MOVE, lateFrame + 1, 0.9f)));
+}
+
+TEST(MotionClassifierTest, ThresholdsFollowThePressureScaleOfTheDevice) {
+    MotionClassifier classifier;
+    // A touchscreen reporting raw pressures.
+    EXPECT_EQ(kDeepPress, press(classifier, 30.f, 1));
+    classifier.classify(makeEvent(Action::UP, 5, 0.f, 1));
+    // A touchscreen whose pressures stay far below 1.
+    EXPECT_EQ(kDeepPress, press(classifier, 0.04f, 2));
+    classifier.classify(makeEvent(Action::UP, 5, 0.f, 2));
+
+    // A pressure that is deep for the second one is a light touch on the first one.
+    classifier.classify(makeEvent(Action::DOWN, 0, 30.f, 1));
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::MOVE, 1, 30.f, 1)));
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::MOVE, 2, 30.1f, 1)));
+}
+
+TEST(MotionClassifierTest, UsualPressureFollowsTheGestures) {
+    MotionClassifier classifier;
+    for (int i = 0; i < 40; i++) {
+        classifier.classify(makeEvent(Action::DOWN, 0, 0.1f));
+        classifier.classify(makeEvent(Action::UP, 1, 0.f));
+    }
+    // 0.25 is 2.5 times the usual touch down pressure of the device now.
+    classifier.classify(makeEvent(Action::DOWN, 0, 0.1f));
+    EXPECT_EQ(Classification::DEEP_PRESS,
+              classifier.classify(makeEvent(Action::MOVE, 1, 0.25f)));
+}
+
+TEST(MotionClassifierTest, DevicesWithoutPressureAreNotClassified) {
+    MotionClassifier classifier;
+    classifier.classify(makeEvent(Action::DOWN, 0, 0.f));
+    for (int64_t frame = 1; frame <= 4; frame++) {
+        EXPECT_EQ(Classification::NONE,
+                  classifier.classify(makeEvent(Action::MOVE, frame, 0.f)));
+    }
+}
+
+TEST(MotionClassifierTest, ResetDropsTheGestures) {
+    MotionClassifier classifier;
+    EXPECT_EQ(kDeepPress, press(classifier, 0.3f));
+    classifier.reset();
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::MOVE, 5, 0.75f)));
+
+    EXPECT_EQ(kDeepPress, press(classifier, 0.3f));
+    classifier.resetDevice(kDeviceId);
+    EXPECT_EQ(Classification::NONE, classifier.classify(makeEvent(Action::MOVE, 5, 0.75f)));
+}
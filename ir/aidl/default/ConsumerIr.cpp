@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ConsumerIr.h"
+
+#include <fcntl.h>
+#include <linux/lirc.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include <android-base/logging.h>
+
+namespace aidl::android::hardware::ir {
+
+namespace {
+
+const std::vector<ConsumerIrFreqRange> kSupportedFreqs = {
+        {2000, 4000},
+        {10000, 30000},
+};
+
+// The most durations older rc-core kernels accept in a single write.
+constexpr size_t kMaxLircDurations = 256;
+
+bool isSupportedFreq(int32_t freq) {
+    for (const auto& range : kSupportedFreqs) {
+        if (freq >= range.minHz && freq <= range.maxHz) return true;
+    }
+    return false;
+}
+
+// Appends a pulse (at even indices of the pattern) or a space, merging it with the previous
+// duration of the same kind. lirc does not take zero durations.
+void appendDuration(bool pulse, uint32_t durationUs, std::vector<uint32_t>* durationsUs) {
+    if (durationUs == 0) return;
+    if (durationsUs->empty() && !pulse) {
+        durationsUs->push_back(0);
+    }
+    const bool lastIsPulse = durationsUs->size() % 2 == 1;
+    if (!durationsUs->empty() && lastIsPulse == pulse) {
+        durationsUs->back() += durationUs;
+    } else {
+        durationsUs->push_back(durationUs);
+    }
+}
+
+}  // namespace
+
+ConsumerIr::ConsumerIr(const std::string& lirc_device) {
+    openLirc(lirc_device);
+    mThread = std::thread(&ConsumerIr::threadLoop, this);
+}
+
+ConsumerIr::~ConsumerIr() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mQueued.notify_one();
+    mThread.join();
+}
+
+void ConsumerIr::openLirc(const std::string& lirc_device) {
+    ::android::base::unique_fd fd(
+            TEMP_FAILURE_RETRY(open(lirc_device.c_str(), O_RDWR | O_CLOEXEC)));
+    if (fd.get() < 0) {
+        PLOG(INFO) << "Cannot open " << lirc_device << ", transmits are only simulated";
+        return;
+    }
+    uint32_t features = 0;
+    if (ioctl(fd.get(), LIRC_GET_FEATURES, &features) != 0 ||
+        (features & LIRC_CAN_SEND_PULSE) == 0) {
+        LOG(WARNING) << lirc_device << " cannot send pulses, transmits are only simulated";
+        return;
+    }
+    uint32_t mode = LIRC_MODE_PULSE;
+    if (ioctl(fd.get(), LIRC_SET_SEND_MODE, &mode) != 0) {
+        PLOG(WARNING) << "Cannot set the send mode of " << lirc_device;
+        return;
+    }
+    if ((features & LIRC_CAN_SET_SEND_CARRIER) == 0) {
+        LOG(INFO) << lirc_device << " has a fixed carrier frequency";
+        // Never set.
+        mCarrierFreqHz = -1;
+    }
+    mLircFd = std::move(fd);
+}
+
+::ndk::ScopedAStatus ConsumerIr::getCarrierFreqs(std::vector<ConsumerIrFreqRange>* _aidl_return) {
+    *_aidl_return = kSupportedFreqs;
+    return ::ndk::ScopedAStatus::ok();
+}
+
+::ndk::ScopedAStatus ConsumerIr::transmit(int32_t in_carrierFreqHz,
+                                          const std::vector<int32_t>& in_pattern) {
+    if (!isSupportedFreq(in_carrierFreqHz)) {
+        // unsupported operation
+        return ::ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+    if (std::any_of(in_pattern.begin(), in_pattern.end(), [](int32_t d) { return d < 0; })) {
+        return ::ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    // Each integer of the pattern is a number of microseconds in an alternating on/off state.
+    auto transmit = std::make_shared<Transmit>();
+    transmit->carrierFreqHz = in_carrierFreqHz;
+    for (size_t i = 0; i < in_pattern.size(); i++) {
+        appendDuration(i % 2 == 0, in_pattern[i], &transmit->durationsUs);
+    }
+
+    std::unique_lock<std::mutex> lock(mLock);
+    mQueue.push_back(transmit);
+    mQueued.notify_one();
+    mDone.wait(lock, [&] { return transmit->done; });
+    if (!transmit->ok) {
+        return ::ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_STATE,
+                                                                  "Transmit failed");
+    }
+    return ::ndk::ScopedAStatus::ok();
+}
+
+void ConsumerIr::threadLoop() {
+    std::vector<std::shared_ptr<Transmit>> batch;
+    std::vector<uint32_t> durationsUs;
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mQueued.wait(lock, [this] { return !mQueue.empty() || mExit; });
+        if (mExit) break;
+
+        // The patterns that follow each other at the same frequency. A pattern ending with a
+        // pulse would merge with the first pulse of the next one, so it ends the batch.
+        const int32_t carrierFreqHz = mQueue.front()->carrierFreqHz;
+        batch.clear();
+        durationsUs.clear();
+        while (!mQueue.empty() && mQueue.front()->carrierFreqHz == carrierFreqHz &&
+               durationsUs.size() % 2 == 0) {
+            const std::vector<uint32_t>& next = mQueue.front()->durationsUs;
+            for (size_t i = 0; i < next.size(); i++) {
+                appendDuration(i % 2 == 0, next[i], &durationsUs);
+            }
+            batch.push_back(std::move(mQueue.front()));
+            mQueue.pop_front();
+        }
+        mTransmits += batch.size();
+
+        lock.unlock();
+        const bool ok = send(carrierFreqHz, durationsUs);
+        lock.lock();
+
+        for (const auto& transmit : batch) {
+            transmit->done = true;
+            transmit->ok = ok;
+        }
+        mDone.notify_all();
+    }
+    // Not expected to be destroyed with pending transmits, but do not leave them waiting.
+    for (const auto& transmit : mQueue) {
+        transmit->done = true;
+    }
+    mQueue.clear();
+    mDone.notify_all();
+}
+
+bool ConsumerIr::send(int32_t carrierFreqHz, const std::vector<uint32_t>& durationsUs) {
+    if (mLircFd.get() < 0) {
+        usleep(std::accumulate(durationsUs.begin(), durationsUs.end(), 0u));
+        return true;
+    }
+
+    if (mCarrierFreqHz != -1 && mCarrierFreqHz != carrierFreqHz) {
+        uint32_t carrier = carrierFreqHz;
+        if (ioctl(mLircFd.get(), LIRC_SET_SEND_CARRIER, &carrier) != 0) {
+            PLOG(ERROR) << "Cannot set the carrier frequency to " << carrierFreqHz;
+            mCarrierFreqHz = 0;
+            return false;
+        }
+        mCarrierFreqHz = carrierFreqHz;
+        std::lock_guard<std::mutex> lock(mLock);
+        mCarrierChanges++;
+    }
+
+    // A write must start and end with a pulse, and blocks until it has been sent. The spaces
+    // in between writes, including the last one, are waited for instead.
+    size_t i = 0;
+    while (i < durationsUs.size()) {
+        size_t end = std::min(durationsUs.size(), i + kMaxLircDurations);
+        if ((end - i) % 2 == 0) end--;
+        if (durationsUs[i] > 0) {
+            const ssize_t size = (end - i) * sizeof(uint32_t);
+            if (TEMP_FAILURE_RETRY(write(mLircFd.get(), &durationsUs[i], size)) != size) {
+                PLOG(ERROR) << "Cannot transmit " << end - i << " durations";
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(mLock);
+            mWrites++;
+        } else {
+            // Leading space: wait for it, and write from the next pulse.
+            end = i + 1;
+        }
+        if (end < durationsUs.size()) {
+            usleep(durationsUs[end]);
+        }
+        i = end + 1;
+    }
+    return true;
+}
+
+binder_status_t ConsumerIr::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    std::lock_guard<std::mutex> lock(mLock);
+    dprintf(fd, "lirc: %s\n", mLircFd.get() >= 0 ? "open" : "none, transmits are simulated");
+    dprintf(fd, "%llu transmits in %llu writes, %llu carrier changes, %zu queued\n",
+            static_cast<unsigned long long>(mTransmits), static_cast<unsigned long long>(mWrites),
+            static_cast<unsigned long long>(mCarrierChanges), mQueue.size());
+    return STATUS_OK;
+}
+
+}  // namespace aidl::android::hardware::ir
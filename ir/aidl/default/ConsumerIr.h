@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <aidl/android/hardware/ir/BnConsumerIr.h>
+#include <android-base/unique_fd.h>
+
+namespace aidl::android::hardware::ir {
+
+// Transmits through a lirc device, or only waits for the duration of the patterns when there is
+// none.
+//
+// Transmits are queued to a single transmit thread, so that the binder threads stay available
+// while a long pattern is sent. As the HAL requires, transmit() still returns once its own
+// pattern has been sent, so the queue never holds more transmits than there are binder threads.
+//
+// Patterns queued back-to-back at the same carrier frequency are written to the device in one
+// go, and the carrier is only set when it changes.
+class ConsumerIr : public BnConsumerIr {
+  public:
+    explicit ConsumerIr(const std::string& lirc_device = "/dev/lirc0");
+    ~ConsumerIr();
+
+    ::ndk::ScopedAStatus getCarrierFreqs(std::vector<ConsumerIrFreqRange>* _aidl_return) override;
+    ::ndk::ScopedAStatus transmit(int32_t in_carrierFreqHz,
+                                  const std::vector<int32_t>& in_pattern) override;
+
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+  private:
+    struct Transmit {
+        int32_t carrierFreqHz;
+        // Pulses at even indices, spaces at odd ones, without zeros. The first pulse is 0 when
+        // the pattern starts with a space.
+        std::vector<uint32_t> durationsUs;
+        bool done = false;
+        bool ok = false;
+    };
+
+    void openLirc(const std::string& lirc_device);
+    void threadLoop();
+    bool send(int32_t carrierFreqHz, const std::vector<uint32_t>& durationsUs);
+
+    // Only used by the transmit thread, after the constructor.
+    ::android::base::unique_fd mLircFd;
+    int32_t mCarrierFreqHz = 0;
+
+    std::mutex mLock;
+    std::condition_variable mQueued;
+    std::condition_variable mDone;
+    // Guarded by mLock.
+    std::deque<std::shared_ptr<Transmit>> mQueue;
+    bool mExit = false;
+    uint64_t mTransmits = 0;
+    uint64_t mWrites = 0;
+    uint64_t mCarrierChanges = 0;
+
+    std::thread mThread;
+};
+
+}  // namespace aidl::android::hardware::ir
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ConsumerIr.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace aidl::android::hardware::ir {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Without a lirc device, transmits only last as long as their pattern.
+class ConsumerIrTest : public ::testing::Test {
+  protected:
+    std::string dump() {
+        TemporaryFile file;
+        EXPECT_EQ(STATUS_OK, mIr->dump(file.fd, nullptr, 0));
+        std::string out;
+        ::android::base::ReadFileToString(file.path, &out);
+        return out;
+    }
+
+    std::shared_ptr<ConsumerIr> mIr = ::ndk::SharedRefBase::make<ConsumerIr>("/nonexistent");
+};
+
+TEST_F(ConsumerIrTest, ReportsTheSupportedFrequencies) {
+    std::vector<ConsumerIrFreqRange> freqs;
+
+    ASSERT_TRUE(mIr->getCarrierFreqs(&freqs).isOk());
+
+    ASSERT_EQ(2u, freqs.size());
+    EXPECT_EQ(2000, freqs[0].minHz);
+    EXPECT_EQ(4000, freqs[0].maxHz);
+    EXPECT_EQ(10000, freqs[1].minHz);
+    EXPECT_EQ(30000, freqs[1].maxHz);
+}
+
+TEST_F(ConsumerIrTest, RejectsUnsupportedFrequencies) {
+    EXPECT_EQ(EX_UNSUPPORTED_OPERATION, mIr->transmit(5000, {100, 100}).getExceptionCode());
+    EXPECT_EQ(EX_UNSUPPORTED_OPERATION, mIr->transmit(0, {100, 100}).getExceptionCode());
+}
+
+TEST_F(ConsumerIrTest, RejectsNegativeDurations) {
+    EXPECT_EQ(EX_ILLEGAL_ARGUMENT, mIr->transmit(20000, {100, -1, 100}).getExceptionCode());
+    EXPECT_NE(std::string::npos, dump().find("0 transmits"));
+}
+
+TEST_F(ConsumerIrTest, ReturnsOnceThePatternIsSent) {
+    const auto start = Clock::now();
+
+    ASSERT_TRUE(mIr->transmit(20000, {10000, 0, 10000, 5000}).isOk());
+
+    EXPECT_GE(Clock::now() - start, 25ms);
+}
+
+TEST_F(ConsumerIrTest, TransmitsEmptyPatterns) {
+    EXPECT_TRUE(mIr->transmit(20000, {}).isOk());
+    EXPECT_TRUE(mIr->transmit(20000, {0, 0}).isOk());
+}
+
+TEST_F(ConsumerIrTest, ServesOtherCallsWhileTransmitting) {
+    std::thread transmitter([this] { EXPECT_TRUE(mIr->transmit(20000, {300000}).isOk()); });
+    std::this_thread::sleep_for(20ms);
+    const auto start = Clock::now();
+
+    std::vector<ConsumerIrFreqRange> freqs;
+    EXPECT_TRUE(mIr->getCarrierFreqs(&freqs).isOk());
+    const std::string out = dump();
+
+    EXPECT_LT(Clock::now() - start, 100ms);
+    EXPECT_NE(std::string::npos, out.find("lirc: none")) << out;
+    transmitter.join();
+}
+
+TEST_F(ConsumerIrTest, CompletesConcurrentTransmits) {
+    constexpr int kCallers = 8;
+    std::vector<std::thread> callers;
+    for (int i = 0; i < kCallers; i++) {
+        // Alternating frequencies, so that not all of them go in one batch.
+        const int32_t freq = i % 2 ? 20000 : 3000;
+        callers.emplace_back([this, freq] {
+            EXPECT_TRUE(mIr->transmit(freq, {1000, 1000}).isOk());
+        });
+    }
+    for (auto& caller : callers) caller.join();
+
+    const std::string out = dump();
+    EXPECT_NE(std::string::npos, out.find("8 transmits")) << out;
+    EXPECT_NE(std::string::npos, out.find("0 queued")) << out;
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::ir
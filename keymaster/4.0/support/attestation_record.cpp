@@ -19,8 +19,11 @@
 #include <android-base/logging.h>
 #include <assert.h>
 
+#include <algorithm>
+
 #include <openssl/asn1t.h>
 #include <openssl/bn.h>
+#include <openssl/bytestring.h>
 #include <openssl/evp.h>
 #include <openssl/x509.h>
 
@@ -400,6 +403,264 @@ ErrorCode parse_root_of_trust(const uint8_t* asn1_key_desc, size_t asn1_key_desc
     return ErrorCode::OK;  // KM_ERROR_OK;
 }
 
+namespace {
+
+// The tags extract_auth_list() copies.
+constexpr Tag kAuthListTags[] = {
+        Tag::ACTIVE_DATETIME,
+        Tag::ALGORITHM,
+        Tag::APPLICATION_ID,
+        Tag::AUTH_TIMEOUT,
+        Tag::CREATION_DATETIME,
+        Tag::DIGEST,
+        Tag::EC_CURVE,
+        Tag::KEY_SIZE,
+        Tag::NO_AUTH_REQUIRED,
+        Tag::ORIGIN,
+        Tag::ORIGINATION_EXPIRE_DATETIME,
+        Tag::OS_PATCHLEVEL,
+        Tag::OS_VERSION,
+        Tag::PADDING,
+        Tag::PURPOSE,
+        Tag::ROLLBACK_RESISTANCE,
+        Tag::RSA_PUBLIC_EXPONENT,
+        Tag::USAGE_EXPIRE_DATETIME,
+        Tag::USER_AUTH_TYPE,
+        Tag::ATTESTATION_APPLICATION_ID,
+        Tag::ATTESTATION_ID_BRAND,
+        Tag::ATTESTATION_ID_DEVICE,
+        Tag::ATTESTATION_ID_PRODUCT,
+        Tag::ATTESTATION_ID_SERIAL,
+        Tag::ATTESTATION_ID_IMEI,
+        Tag::ATTESTATION_ID_MEID,
+        Tag::ATTESTATION_ID_MANUFACTURER,
+        Tag::ATTESTATION_ID_MODEL,
+        Tag::VENDOR_PATCHLEVEL,
+        Tag::BOOT_PATCHLEVEL,
+        Tag::TRUSTED_USER_PRESENCE_REQUIRED,
+        Tag::TRUSTED_CONFIRMATION_REQUIRED,
+        Tag::UNLOCKED_DEVICE_REQUIRED,
+};
+
+constexpr unsigned kExplicitTagClass = CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED;
+
+uint32_t tagNumber(Tag tag) {
+    return static_cast<uint32_t>(tag) & 0x0FFFFFFF;
+}
+
+// Decodes a non-negative INTEGER that fits in 32 bits. Like all the INTEGERs of the record, it
+// must be minimally encoded DER.
+bool getUint32(CBS* cbs, uint32_t* value) {
+    uint64_t value64;
+    if (!CBS_get_asn1_uint64(cbs, &value64) || value64 > UINT32_MAX) return false;
+    *value = static_cast<uint32_t>(value64);
+    return true;
+}
+
+// Decodes a non-negative ENUMERATED that fits in 32 bits, with the DER rules
+// CBS_get_asn1_uint64() applies to INTEGERs.
+bool getEnumerated(CBS* cbs, uint32_t* value) {
+    CBS contents;
+    if (!CBS_get_asn1(cbs, &contents, CBS_ASN1_ENUMERATED)) return false;
+    const uint8_t* data = CBS_data(&contents);
+    size_t len = CBS_len(&contents);
+    // Empty, negative, or with a leading zero that does not keep the sign bit clear.
+    if (len == 0 || (data[0] & 0x80) || (data[0] == 0 && len > 1 && !(data[1] & 0x80))) {
+        return false;
+    }
+    if (data[0] == 0) {
+        ++data;
+        --len;
+    }
+    if (len > sizeof(*value)) return false;
+    *value = 0;
+    for (size_t i = 0; i < len; ++i) {
+        *value = (*value << 8) | data[i];
+    }
+    return true;
+}
+
+void copyBytes(const CBS& contents, hidl_vec<uint8_t>* out) {
+    out->resize(CBS_len(&contents));
+    if (CBS_len(&contents) > 0) memcpy(out->data(), CBS_data(&contents), CBS_len(&contents));
+}
+
+// Decodes the value of an authorization from the contents of its explicit tag.
+bool decodeAuthorization(Tag tag, CBS* element, AuthorizationSet* auth_list) {
+    KeyParameter param;
+    param.tag = tag;
+    switch (typeFromTag(tag)) {
+        case TagType::ENUM_REP:
+        case TagType::UINT_REP:
+        case TagType::ULONG_REP: {
+            CBS set;
+            if (!CBS_get_asn1(element, &set, CBS_ASN1_SET)) return false;
+            while (CBS_len(&set) > 0) {
+                if (typeFromTag(tag) == TagType::ULONG_REP) {
+                    if (!CBS_get_asn1_uint64(&set, &param.f.longInteger)) return false;
+                } else {
+                    if (!getUint32(&set, &param.f.integer)) return false;
+                }
+                auth_list->push_back(param);
+            }
+            return CBS_len(element) == 0;
+        }
+        case TagType::ENUM:
+        case TagType::UINT:
+            if (!getUint32(element, &param.f.integer)) return false;
+            break;
+        case TagType::ULONG:
+            if (!CBS_get_asn1_uint64(element, &param.f.longInteger)) return false;
+            break;
+        case TagType::DATE:
+            if (!CBS_get_asn1_uint64(element, &param.f.dateTime)) return false;
+            break;
+        case TagType::BOOL: {
+            CBS null;
+            if (!CBS_get_asn1(element, &null, CBS_ASN1_NULL) || CBS_len(&null) != 0) return false;
+            param.f.boolValue = true;
+            break;
+        }
+        case TagType::BYTES:
+        case TagType::BIGNUM: {
+            CBS bytes;
+            if (!CBS_get_asn1(element, &bytes, CBS_ASN1_OCTETSTRING)) return false;
+            copyBytes(bytes, &param.blob);
+            break;
+        }
+        default:
+            return false;
+    }
+    if (CBS_len(element) != 0) return false;
+    auth_list->push_back(std::move(param));
+    return true;
+}
+
+}  // namespace
+
+ErrorCode AttestationRecordView::init(const uint8_t* asn1_key_desc, size_t asn1_key_desc_len) {
+    CBS input, record, challenge, unique_id, software_enforced, tee_enforced;
+    uint32_t attestation_version, attestation_security_level, keymaster_version,
+            keymaster_security_level;
+    CBS_init(&input, asn1_key_desc, asn1_key_desc_len);
+    if (!CBS_get_asn1(&input, &record, CBS_ASN1_SEQUENCE) ||
+        !getUint32(&record, &attestation_version) ||
+        !getEnumerated(&record, &attestation_security_level) ||
+        !getUint32(&record, &keymaster_version) ||
+        !getEnumerated(&record, &keymaster_security_level) ||
+        !CBS_get_asn1(&record, &challenge, CBS_ASN1_OCTETSTRING) ||
+        !CBS_get_asn1(&record, &unique_id, CBS_ASN1_OCTETSTRING) ||
+        !CBS_get_asn1(&record, &software_enforced, CBS_ASN1_SEQUENCE) ||
+        !CBS_get_asn1(&record, &tee_enforced, CBS_ASN1_SEQUENCE) || CBS_len(&record) != 0) {
+        return ErrorCode::UNKNOWN_ERROR;
+    }
+
+    attestation_version_ = attestation_version;
+    attestation_security_level_ = static_cast<SecurityLevel>(attestation_security_level);
+    keymaster_version_ = keymaster_version;
+    keymaster_security_level_ = static_cast<SecurityLevel>(keymaster_security_level);
+    attestation_challenge_ = {CBS_data(&challenge), CBS_len(&challenge)};
+    unique_id_ = {CBS_data(&unique_id), CBS_len(&unique_id)};
+    software_enforced_ = {CBS_data(&software_enforced), CBS_len(&software_enforced)};
+    tee_enforced_ = {CBS_data(&tee_enforced), CBS_len(&tee_enforced)};
+    return ErrorCode::OK;
+}
+
+hidl_vec<uint8_t> AttestationRecordView::attestationChallenge() const {
+    return hidl_vec<uint8_t>(attestation_challenge_.data,
+                             attestation_challenge_.data + attestation_challenge_.size);
+}
+
+hidl_vec<uint8_t> AttestationRecordView::uniqueId() const {
+    return hidl_vec<uint8_t>(unique_id_.data, unique_id_.data + unique_id_.size);
+}
+
+ErrorCode AttestationRecordView::getAuthorizations(Span list, const Tag* tags, size_t tag_count,
+                                                   AuthorizationSet* auth_list) {
+    CBS cbs;
+    CBS_init(&cbs, list.data, list.size);
+    while (CBS_len(&cbs) > 0) {
+        CBS element;
+        unsigned asn1_tag;
+        if (!CBS_get_any_asn1(&cbs, &element, &asn1_tag) ||
+            (asn1_tag & ~CBS_ASN1_TAG_NUMBER_MASK) != kExplicitTagClass) {
+            return ErrorCode::UNKNOWN_ERROR;
+        }
+        const uint32_t number = asn1_tag & CBS_ASN1_TAG_NUMBER_MASK;
+        const Tag* tag = std::find_if(tags, tags + tag_count,
+                                      [number](Tag t) { return tagNumber(t) == number; });
+        if (tag == tags + tag_count || *tag == Tag::ROOT_OF_TRUST) continue;
+        if (!decodeAuthorization(*tag, &element, auth_list)) return ErrorCode::UNKNOWN_ERROR;
+    }
+    return ErrorCode::OK;
+}
+
+ErrorCode AttestationRecordView::getAuthorizations(std::initializer_list<Tag> tags,
+                                                   AuthorizationSet* software_enforced,
+                                                   AuthorizationSet* tee_enforced) const {
+    ErrorCode error =
+            getAuthorizations(software_enforced_, tags.begin(), tags.size(), software_enforced);
+    if (error != ErrorCode::OK) return error;
+    return getAuthorizations(tee_enforced_, tags.begin(), tags.size(), tee_enforced);
+}
+
+ErrorCode AttestationRecordView::getAuthorizations(AuthorizationSet* software_enforced,
+                                                   AuthorizationSet* tee_enforced) const {
+    constexpr size_t kTagCount = sizeof(kAuthListTags) / sizeof(kAuthListTags[0]);
+    ErrorCode error = getAuthorizations(software_enforced_, kAuthListTags, kTagCount,
+                                        software_enforced);
+    if (error != ErrorCode::OK) return error;
+    return getAuthorizations(tee_enforced_, kAuthListTags, kTagCount, tee_enforced);
+}
+
+bool AttestationRecordView::findRootOfTrust(Span list, Span* root_of_trust) {
+    CBS cbs;
+    CBS_init(&cbs, list.data, list.size);
+    const unsigned asn1_tag = kExplicitTagClass | tagNumber(Tag::ROOT_OF_TRUST);
+    while (CBS_len(&cbs) > 0) {
+        CBS element;
+        unsigned element_tag;
+        if (!CBS_get_any_asn1(&cbs, &element, &element_tag)) return false;
+        if (element_tag != asn1_tag) continue;
+        *root_of_trust = {CBS_data(&element), CBS_len(&element)};
+        return true;
+    }
+    return false;
+}
+
+ErrorCode AttestationRecordView::getRootOfTrust(hidl_vec<uint8_t>* verified_boot_key,
+                                                keymaster_verified_boot_t* verified_boot_state,
+                                                bool* device_locked,
+                                                hidl_vec<uint8_t>* verified_boot_hash) const {
+    if (!verified_boot_key || !verified_boot_state || !device_locked || !verified_boot_hash) {
+        LOG(ERROR) << AT << "null pointer input(s)";
+        return ErrorCode::INVALID_ARGUMENT;
+    }
+    Span span;
+    if (!findRootOfTrust(tee_enforced_, &span) && !findRootOfTrust(software_enforced_, &span)) {
+        LOG(ERROR) << AT << " Failed root of trust parsing";
+        return ErrorCode::INVALID_ARGUMENT;
+    }
+
+    CBS element, root_of_trust, key, hash;
+    int locked;
+    uint32_t state;
+    CBS_init(&element, span.data, span.size);
+    if (!CBS_get_asn1(&element, &root_of_trust, CBS_ASN1_SEQUENCE) ||
+        !CBS_get_asn1(&root_of_trust, &key, CBS_ASN1_OCTETSTRING) ||
+        !CBS_get_asn1_bool(&root_of_trust, &locked) ||
+        !getEnumerated(&root_of_trust, &state) ||
+        !CBS_get_asn1(&root_of_trust, &hash, CBS_ASN1_OCTETSTRING)) {
+        LOG(ERROR) << AT << " Failed root of trust parsing";
+        return ErrorCode::INVALID_ARGUMENT;
+    }
+    copyBytes(key, verified_boot_key);
+    *verified_boot_state = static_cast<keymaster_verified_boot_t>(state);
+    *device_locked = locked;
+    copyBytes(hash, verified_boot_hash);
+    return ErrorCode::OK;
+}
+
 }  // namespace V4_0
 }  // namespace keymaster
 }  // namespace hardware
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <keymasterV4_0/attestation_record.h>
+
+#include <benchmark/benchmark.h>
+
+#include <keymasterV4_0/authorization_set.h>
+
+#include "attestation_record_test_utils.h"
+
+namespace android::hardware::keymaster::V4_0 {
+
+namespace {
+
+using test::makeAttestationRecord;
+
+// What a verifier does today: decode the whole record, then decode it again for the root of
+// trust.
+void BM_ParseAttestationRecord(benchmark::State& state) {
+    const std::vector<uint8_t> record = makeAttestationRecord();
+    for (auto _ : state) {
+        uint32_t attestation_version, keymaster_version;
+        SecurityLevel attestation_security_level, keymaster_security_level;
+        hidl_vec<uint8_t> challenge, unique_id, verified_boot_key, verified_boot_hash;
+        AuthorizationSet software_enforced, tee_enforced;
+        keymaster_verified_boot_t verified_boot_state;
+        bool device_locked;
+        benchmark::DoNotOptimize(parse_attestation_record(
+                record.data(), record.size(), &attestation_version, &attestation_security_level,
+                &keymaster_version, &keymaster_security_level, &challenge, &software_enforced,
+                &tee_enforced, &unique_id));
+        benchmark::DoNotOptimize(parse_root_of_trust(record.data(), record.size(),
+                                                     &verified_boot_key, &verified_boot_state,
+                                                     &device_locked, &verified_boot_hash));
+    }
+}
+BENCHMARK(BM_ParseAttestationRecord);
+
+// The same results from a single view.
+void BM_ViewAllTags(benchmark::State& state) {
+    const std::vector<uint8_t> record = makeAttestationRecord();
+    for (auto _ : state) {
+        AttestationRecordView view;
+        AuthorizationSet software_enforced, tee_enforced;
+        hidl_vec<uint8_t> verified_boot_key, verified_boot_hash;
+        keymaster_verified_boot_t verified_boot_state;
+        bool device_locked;
+        benchmark::DoNotOptimize(view.init(record.data(), record.size()));
+        benchmark::DoNotOptimize(view.attestationChallenge());
+        benchmark::DoNotOptimize(view.getAuthorizations(&software_enforced, &tee_enforced));
+        benchmark::DoNotOptimize(view.getRootOfTrust(&verified_boot_key, &verified_boot_state,
+                                                     &device_locked, &verified_boot_hash));
+    }
+}
+BENCHMARK(BM_ViewAllTags);
+
+// A chain validator checking the security level, the origin, the patch level and the root of
+// trust.
+void BM_ViewFewTags(benchmark::State& state) {
+    const std::vector<uint8_t> record = makeAttestationRecord();
+    for (auto _ : state) {
+        AttestationRecordView view;
+        AuthorizationSet software_enforced, tee_enforced;
+        hidl_vec<uint8_t> verified_boot_key, verified_boot_hash;
+        keymaster_verified_boot_t verified_boot_state;
+        bool device_locked;
+        benchmark::DoNotOptimize(view.init(record.data(), record.size()));
+        benchmark::DoNotOptimize(view.keymasterSecurityLevel());
+        benchmark::DoNotOptimize(view.getAuthorizations({Tag::ORIGIN, Tag::OS_PATCHLEVEL},
+                                                        &software_enforced, &tee_enforced));
+        benchmark::DoNotOptimize(view.getRootOfTrust(&verified_boot_key, &verified_boot_state,
+                                                     &device_locked, &verified_boot_hash));
+    }
+}
+BENCHMARK(BM_ViewFewTags);
+
+}  // namespace
+
+}  // namespace android::hardware::keymaster::V4_0
+
+BENCHMARK_MAIN();
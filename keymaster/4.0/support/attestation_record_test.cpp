@@ -0,0 +1,253 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <keymasterV4_0/attestation_record.h>
+
+#include <gtest/gtest.h>
+
+#include <keymasterV4_0/authorization_set.h>
+#include <keymasterV4_0/key_param_output.h>
+
+#include "attestation_record_test_utils.h"
+
+namespace android::hardware::keymaster::V4_0::test {
+namespace {
+
+void addNothing(CBB*) {}
+
+// The attestation record of an RSA encryption key whose root of trust is software-enforced,
+// with entries of most tag types.
+std::vector<uint8_t> makeSoftwareRootOfTrustRecord() {
+    return makeRecord(
+            addTeeVersions,
+            [](CBB* software) {
+                addUint(software, Tag::ACTIVE_DATETIME, 1633392000000);
+                addUint(software, Tag::USAGE_EXPIRE_DATETIME, 1664928000000);
+                addUint(software, Tag::CREATION_DATETIME, 1633392000000);
+                addRootOfTrust(software, KM_VERIFIED_BOOT_UNVERIFIED);
+                addOctetString(software, Tag::ATTESTATION_APPLICATION_ID, {1, 2, 3});
+            },
+            [](CBB* tee) {
+                addUintSet(tee, Tag::PURPOSE,
+                           {static_cast<uint64_t>(KeyPurpose::ENCRYPT),
+                            static_cast<uint64_t>(KeyPurpose::DECRYPT)});
+                addUint(tee, Tag::ALGORITHM, static_cast<uint64_t>(Algorithm::RSA));
+                addUint(tee, Tag::KEY_SIZE, 2048);
+                addUintSet(tee, Tag::DIGEST, {static_cast<uint64_t>(Digest::SHA_2_256)});
+                addUintSet(tee, Tag::PADDING,
+                           {static_cast<uint64_t>(PaddingMode::RSA_OAEP),
+                            static_cast<uint64_t>(PaddingMode::RSA_PKCS1_1_5_ENCRYPT)});
+                addUint(tee, Tag::RSA_PUBLIC_EXPONENT, 65537);
+                addNull(tee, Tag::ROLLBACK_RESISTANCE);
+                addUint(tee, Tag::USER_AUTH_TYPE,
+                        static_cast<uint64_t>(HardwareAuthenticatorType::FINGERPRINT));
+                addUint(tee, Tag::AUTH_TIMEOUT, 300);
+                addNull(tee, Tag::TRUSTED_USER_PRESENCE_REQUIRED);
+                addNull(tee, Tag::UNLOCKED_DEVICE_REQUIRED);
+                addUint(tee, Tag::ORIGIN, static_cast<uint64_t>(KeyOrigin::GENERATED));
+                addUint(tee, Tag::OS_VERSION, 110000);
+                addUint(tee, Tag::OS_PATCHLEVEL, 202110);
+                addOctetString(tee, Tag::ATTESTATION_ID_BRAND, {'b', 'r', 'a', 'n', 'd'});
+                addOctetString(tee, Tag::ATTESTATION_ID_MODEL, {'m', 'o', 'd', 'e', 'l'});
+                addUint(tee, Tag::VENDOR_PATCHLEVEL, 20211005);
+                addUint(tee, Tag::BOOT_PATCHLEVEL, 20211005);
+            });
+}
+
+// Expects the view to return what parse_attestation_record() and parse_root_of_trust() return.
+void expectViewMatchesParser(const std::vector<uint8_t>& record) {
+    uint32_t attestation_version, keymaster_version;
+    SecurityLevel attestation_security_level, keymaster_security_level;
+    hidl_vec<uint8_t> challenge, unique_id;
+    AuthorizationSet software_enforced, tee_enforced;
+    ASSERT_EQ(ErrorCode::OK,
+              parse_attestation_record(record.data(), record.size(), &attestation_version,
+                                       &attestation_security_level, &keymaster_version,
+                                       &keymaster_security_level, &challenge, &software_enforced,
+                                       &tee_enforced, &unique_id));
+    hidl_vec<uint8_t> verified_boot_key, verified_boot_hash;
+    keymaster_verified_boot_t verified_boot_state;
+    bool device_locked;
+    ASSERT_EQ(ErrorCode::OK,
+              parse_root_of_trust(record.data(), record.size(), &verified_boot_key,
+                                  &verified_boot_state, &device_locked, &verified_boot_hash));
+
+    AttestationRecordView view;
+    ASSERT_EQ(ErrorCode::OK, view.init(record.data(), record.size()));
+    EXPECT_EQ(attestation_version, view.attestationVersion());
+    EXPECT_EQ(attestation_security_level, view.attestationSecurityLevel());
+    EXPECT_EQ(keymaster_version, view.keymasterVersion());
+    EXPECT_EQ(keymaster_security_level, view.keymasterSecurityLevel());
+    EXPECT_EQ(challenge, view.attestationChallenge());
+    EXPECT_EQ(unique_id, view.uniqueId());
+
+    // The view returns the entries in their encoded order, the parser in its own.
+    AuthorizationSet view_software_enforced, view_tee_enforced;
+    ASSERT_EQ(ErrorCode::OK,
+              view.getAuthorizations(&view_software_enforced, &view_tee_enforced));
+    software_enforced.Sort();
+    tee_enforced.Sort();
+    view_software_enforced.Sort();
+    view_tee_enforced.Sort();
+    EXPECT_EQ(software_enforced.hidl_data(), view_software_enforced.hidl_data());
+    EXPECT_EQ(tee_enforced.hidl_data(), view_tee_enforced.hidl_data());
+
+    hidl_vec<uint8_t> view_verified_boot_key, view_verified_boot_hash;
+    keymaster_verified_boot_t view_verified_boot_state;
+    bool view_device_locked;
+    ASSERT_EQ(ErrorCode::OK,
+              view.getRootOfTrust(&view_verified_boot_key, &view_verified_boot_state,
+                                  &view_device_locked, &view_verified_boot_hash));
+    EXPECT_EQ(verified_boot_key, view_verified_boot_key);
+    EXPECT_EQ(verified_boot_state, view_verified_boot_state);
+    EXPECT_EQ(device_locked, view_device_locked);
+    EXPECT_EQ(verified_boot_hash, view_verified_boot_hash);
+}
+
+ErrorCode initView(const std::function<void(CBB*)>& addVersions) {
+    const std::vector<uint8_t> record = makeRecord(addVersions, addNothing, addNothing);
+    AttestationRecordView view;
+    return view.init(record.data(), record.size());
+}
+
+ErrorCode getTeeEnforced(const std::function<void(CBB*)>& addTeeEnforced,
+                         AuthorizationSet* tee_enforced) {
+    const std::vector<uint8_t> record = makeRecord(addTeeVersions, addNothing, addTeeEnforced);
+    AttestationRecordView view;
+    ErrorCode error = view.init(record.data(), record.size());
+    if (error != ErrorCode::OK) return error;
+    AuthorizationSet software_enforced;
+    return view.getAuthorizations(&software_enforced, tee_enforced);
+}
+
+// An INTEGER entry with the given contents.
+void addRawUint(CBB* list, Tag tag, const std::vector<uint8_t>& contents) {
+    CBB element;
+    CBB_add_asn1(list, &element, explicitTag(tag));
+    addRaw(&element, CBS_ASN1_INTEGER, contents);
+    CBB_flush(list);
+}
+
+// The versions of a TEE-backed attestation with the given attestation security level contents.
+std::function<void(CBB*)> withSecurityLevel(const std::vector<uint8_t>& contents) {
+    return [contents](CBB* record) {
+        CBB_add_asn1_uint64(record, 3);
+        addRaw(record, CBS_ASN1_ENUMERATED, contents);
+        CBB_add_asn1_uint64(record, 4);
+        addEnumerated(record, static_cast<uint8_t>(SecurityLevel::TRUSTED_ENVIRONMENT));
+    };
+}
+
+TEST(AttestationRecordViewTest, MatchesParser) {
+    expectViewMatchesParser(makeAttestationRecord());
+}
+
+TEST(AttestationRecordViewTest, MatchesParserWithSoftwareRootOfTrust) {
+    expectViewMatchesParser(makeSoftwareRootOfTrustRecord());
+}
+
+TEST(AttestationRecordViewTest, ReturnsOnlyRequestedTags) {
+    const std::vector<uint8_t> record = makeAttestationRecord();
+    AttestationRecordView view;
+    ASSERT_EQ(ErrorCode::OK, view.init(record.data(), record.size()));
+
+    AuthorizationSet software_enforced, tee_enforced;
+    ASSERT_EQ(ErrorCode::OK, view.getAuthorizations({Tag::PURPOSE, Tag::CREATION_DATETIME},
+                                                    &software_enforced, &tee_enforced));
+    EXPECT_EQ(AuthorizationSetBuilder()
+                      .Authorization(TAG_CREATION_DATETIME, 1633392000000)
+                      .hidl_data(),
+              software_enforced.hidl_data());
+    EXPECT_EQ(AuthorizationSetBuilder().SigningKey().hidl_data(), tee_enforced.hidl_data());
+}
+
+TEST(AttestationRecordViewTest, DecodesFullRangeValues) {
+    auto addLargestValues = [](CBB* tee) {
+        addUint(tee, Tag::KEY_SIZE, UINT32_MAX);
+        addUint(tee, Tag::RSA_PUBLIC_EXPONENT, UINT64_MAX);
+    };
+    AuthorizationSet tee_enforced;
+    ASSERT_EQ(ErrorCode::OK, getTeeEnforced(addLargestValues, &tee_enforced));
+    EXPECT_EQ(UINT32_MAX, tee_enforced.GetTagValue(TAG_KEY_SIZE).value());
+    EXPECT_EQ(UINT64_MAX, tee_enforced.GetTagValue(TAG_RSA_PUBLIC_EXPONENT).value());
+
+    // A leading zero is needed to keep the sign bit clear.
+    const std::vector<uint8_t> record = makeRecord(withSecurityLevel({0x00, 0x80}), addNothing,
+                                                   addNothing);
+    AttestationRecordView view;
+    ASSERT_EQ(ErrorCode::OK, view.init(record.data(), record.size()));
+    EXPECT_EQ(0x80u, static_cast<uint32_t>(view.attestationSecurityLevel()));
+}
+
+TEST(AttestationRecordViewTest, RejectsValuesOutOfRange) {
+    AuthorizationSet tee_enforced;
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR,
+              getTeeEnforced([](CBB* tee) { addUint(tee, Tag::KEY_SIZE, UINT64_C(1) << 32); },
+                             &tee_enforced));
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR,
+              getTeeEnforced(
+                      [](CBB* tee) { addUintSet(tee, Tag::PURPOSE, {UINT64_C(1) << 32}); },
+                      &tee_enforced));
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR,
+              getTeeEnforced(
+                      [](CBB* tee) {
+                          addRawUint(tee, Tag::RSA_PUBLIC_EXPONENT,
+                                     {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});
+                      },
+                      &tee_enforced));
+
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR, initView([](CBB* record) {
+                  CBB_add_asn1_uint64(record, UINT64_C(1) << 32);
+                  addEnumerated(record, static_cast<uint8_t>(SecurityLevel::TRUSTED_ENVIRONMENT));
+                  CBB_add_asn1_uint64(record, 4);
+                  addEnumerated(record, static_cast<uint8_t>(SecurityLevel::TRUSTED_ENVIRONMENT));
+              }));
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR,
+              initView(withSecurityLevel({0x01, 0x00, 0x00, 0x00, 0x00})));
+}
+
+TEST(AttestationRecordViewTest, RejectsNonDerIntegers) {
+    AuthorizationSet tee_enforced;
+    // Not minimally encoded.
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR,
+              getTeeEnforced([](CBB* tee) { addRawUint(tee, Tag::KEY_SIZE, {0x00, 0x05}); },
+                             &tee_enforced));
+    // Negative.
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR,
+              getTeeEnforced([](CBB* tee) { addRawUint(tee, Tag::KEY_SIZE, {0xff}); },
+                             &tee_enforced));
+    // Empty.
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR,
+              getTeeEnforced([](CBB* tee) { addRawUint(tee, Tag::KEY_SIZE, {}); },
+                             &tee_enforced));
+
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR, initView([](CBB* record) {
+                  addRaw(record, CBS_ASN1_INTEGER, {0x00, 0x03});
+                  addEnumerated(record, static_cast<uint8_t>(SecurityLevel::TRUSTED_ENVIRONMENT));
+                  CBB_add_asn1_uint64(record, 4);
+                  addEnumerated(record, static_cast<uint8_t>(SecurityLevel::TRUSTED_ENVIRONMENT));
+              }));
+}
+
+TEST(AttestationRecordViewTest, RejectsNonDerEnumerateds) {
+    EXPECT_EQ(ErrorCode::OK, initView(withSecurityLevel({0x01})));
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR, initView(withSecurityLevel({0x00, 0x01})));
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR, initView(withSecurityLevel({0x80})));
+    EXPECT_EQ(ErrorCode::UNKNOWN_ERROR, initView(withSecurityLevel({})));
+}
+
+}  // namespace
+}  // namespace android::hardware::keymaster::V4_0::test
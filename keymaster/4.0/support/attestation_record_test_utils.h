@@ -0,0 +1,163 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+#include <openssl/bytestring.h>
+#include <openssl/mem.h>
+
+#include <keymasterV4_0/attestation_record.h>
+
+namespace android::hardware::keymaster::V4_0::test {
+
+// DER encoding helpers for building KeyDescriptions in tests and benchmarks.
+
+inline unsigned explicitTag(Tag tag) {
+    return CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED |
+           (static_cast<uint32_t>(tag) & 0x0FFFFFFF);
+}
+
+inline void addUint(CBB* list, Tag tag, uint64_t value) {
+    CBB element;
+    CBB_add_asn1(list, &element, explicitTag(tag));
+    CBB_add_asn1_uint64(&element, value);
+    CBB_flush(list);
+}
+
+inline void addUintSet(CBB* list, Tag tag, std::initializer_list<uint64_t> values) {
+    CBB element, set;
+    CBB_add_asn1(list, &element, explicitTag(tag));
+    CBB_add_asn1(&element, &set, CBS_ASN1_SET);
+    for (uint64_t value : values) CBB_add_asn1_uint64(&set, value);
+    CBB_flush(list);
+}
+
+inline void addNull(CBB* list, Tag tag) {
+    CBB element, null;
+    CBB_add_asn1(list, &element, explicitTag(tag));
+    CBB_add_asn1(&element, &null, CBS_ASN1_NULL);
+    CBB_flush(list);
+}
+
+inline void addOctetString(CBB* parent, const std::vector<uint8_t>& bytes) {
+    CBB octets;
+    CBB_add_asn1(parent, &octets, CBS_ASN1_OCTETSTRING);
+    CBB_add_bytes(&octets, bytes.data(), bytes.size());
+    CBB_flush(parent);
+}
+
+inline void addOctetString(CBB* list, Tag tag, const std::vector<uint8_t>& bytes) {
+    CBB element;
+    CBB_add_asn1(list, &element, explicitTag(tag));
+    addOctetString(&element, bytes);
+    CBB_flush(list);
+}
+
+// Adds an element with the given tag and contents, which need not be valid DER.
+inline void addRaw(CBB* parent, unsigned asn1_tag, const std::vector<uint8_t>& contents) {
+    CBB element;
+    CBB_add_asn1(parent, &element, asn1_tag);
+    CBB_add_bytes(&element, contents.data(), contents.size());
+    CBB_flush(parent);
+}
+
+inline void addEnumerated(CBB* parent, uint8_t value) {
+    addRaw(parent, CBS_ASN1_ENUMERATED, {value});
+}
+
+inline void addRootOfTrust(CBB* list, keymaster_verified_boot_t verified_boot_state) {
+    CBB element, root_of_trust;
+    CBB_add_asn1(list, &element, explicitTag(Tag::ROOT_OF_TRUST));
+    CBB_add_asn1(&element, &root_of_trust, CBS_ASN1_SEQUENCE);
+    addOctetString(&root_of_trust, std::vector<uint8_t>(32, 0x5b));
+    CBB_add_asn1_bool(&root_of_trust, 1);
+    addEnumerated(&root_of_trust, verified_boot_state);
+    addOctetString(&root_of_trust, std::vector<uint8_t>(32, 0x3c));
+    CBB_flush(list);
+}
+
+// The versions and security levels of a TEE-backed keymaster 4.0 attestation.
+inline void addTeeVersions(CBB* record) {
+    CBB_add_asn1_uint64(record, 3);
+    addEnumerated(record, static_cast<uint8_t>(SecurityLevel::TRUSTED_ENVIRONMENT));
+    CBB_add_asn1_uint64(record, 4);
+    addEnumerated(record, static_cast<uint8_t>(SecurityLevel::TRUSTED_ENVIRONMENT));
+}
+
+/**
+ * Builds a KeyDescription. addVersions adds the versions and security levels, the other
+ * callbacks add the entries of the authorization lists, which parse_attestation_record() expects
+ * in tag order.
+ */
+inline std::vector<uint8_t> makeRecord(const std::function<void(CBB*)>& addVersions,
+                                       const std::function<void(CBB*)>& addSoftwareEnforced,
+                                       const std::function<void(CBB*)>& addTeeEnforced) {
+    bssl::ScopedCBB cbb;
+    CBB record, software, tee;
+    CBB_init(cbb.get(), 1024);
+    CBB_add_asn1(cbb.get(), &record, CBS_ASN1_SEQUENCE);
+    addVersions(&record);
+    addOctetString(&record, std::vector<uint8_t>(32, 0xc4));  // challenge
+    addOctetString(&record, {});                             // unique id
+    CBB_add_asn1(&record, &software, CBS_ASN1_SEQUENCE);
+    addSoftwareEnforced(&software);
+    CBB_flush(&record);
+    CBB_add_asn1(&record, &tee, CBS_ASN1_SEQUENCE);
+    addTeeEnforced(&tee);
+    CBB_flush(&record);
+
+    uint8_t* data;
+    size_t size;
+    CBB_finish(cbb.get(), &data, &size);
+    bssl::UniquePtr<uint8_t> owned(data);
+    return std::vector<uint8_t>(data, data + size);
+}
+
+// The attestation record of a hardware-backed EC signing key, with the tags a TEE usually
+// reports.
+inline std::vector<uint8_t> makeAttestationRecord() {
+    return makeRecord(
+            addTeeVersions,
+            [](CBB* software) {
+                addUint(software, Tag::CREATION_DATETIME, 1633392000000);
+                addOctetString(software, Tag::ATTESTATION_APPLICATION_ID,
+                               std::vector<uint8_t>(120, 0xa5));
+            },
+            [](CBB* tee) {
+                addUintSet(tee, Tag::PURPOSE,
+                           {static_cast<uint64_t>(KeyPurpose::SIGN),
+                            static_cast<uint64_t>(KeyPurpose::VERIFY)});
+                addUint(tee, Tag::ALGORITHM, static_cast<uint64_t>(Algorithm::EC));
+                addUint(tee, Tag::KEY_SIZE, 256);
+                addUintSet(tee, Tag::DIGEST,
+                           {static_cast<uint64_t>(Digest::NONE),
+                            static_cast<uint64_t>(Digest::SHA_2_256)});
+                addUint(tee, Tag::EC_CURVE, static_cast<uint64_t>(EcCurve::P_256));
+                addNull(tee, Tag::NO_AUTH_REQUIRED);
+                addUint(tee, Tag::ORIGIN, static_cast<uint64_t>(KeyOrigin::GENERATED));
+                addRootOfTrust(tee, KM_VERIFIED_BOOT_VERIFIED);
+                addUint(tee, Tag::OS_VERSION, 110000);
+                addUint(tee, Tag::OS_PATCHLEVEL, 202110);
+                addUint(tee, Tag::VENDOR_PATCHLEVEL, 20211005);
+                addUint(tee, Tag::BOOT_PATCHLEVEL, 20211005);
+            });
+}
+
+}  // namespace android::hardware::keymaster::V4_0::test
@@ -18,6 +18,8 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 #include <android-base/logging.h>
 
 namespace android {
@@ -25,6 +27,16 @@ namespace hardware {
 namespace keymaster {
 namespace V4_0 {
 
+namespace {
+
+// Orders KeyParameters by tag alone, for binary searching a sorted set.
+struct TagLess {
+    bool operator()(const KeyParameter& param, Tag tag) const { return param.tag < tag; }
+    bool operator()(Tag tag, const KeyParameter& param) const { return tag < param.tag; }
+};
+
+}  // namespace
+
 bool keyParamLess(const KeyParameter& a, const KeyParameter& b) {
     if (a.tag != b.tag) return a.tag < b.tag;
     int retval;
@@ -85,26 +97,15 @@ bool keyParamEqual(const KeyParameter& a, const KeyParameter& b) {
 
 void AuthorizationSet::Sort() {
     std::sort(data_.begin(), data_.end(), keyParamLess);
+    sorted_ = true;
 }
 
 void AuthorizationSet::Deduplicate() {
-    if (data_.empty()) return;
-
     Sort();
-    std::vector<KeyParameter> result;
-
-    auto curr = data_.begin();
-    auto prev = curr++;
-    for (; curr != data_.end(); ++prev, ++curr) {
-        if (prev->tag == Tag::INVALID) continue;
-
-        if (!keyParamEqual(*prev, *curr)) {
-            result.push_back(std::move(*prev));
-        }
-    }
-    result.push_back(std::move(*prev));
-
-    std::swap(data_, result);
+    data_.erase(std::remove_if(data_.begin(), data_.end(),
+                               [](const KeyParameter& param) { return param.tag == Tag::INVALID; }),
+                data_.end());
+    data_.erase(std::unique(data_.begin(), data_.end(), keyParamEqual), data_.end());
 }
 
 void AuthorizationSet::Union(const AuthorizationSet& other) {
@@ -140,6 +141,7 @@ void AuthorizationSet::Filter(std::function<bool(const KeyParameter&)> doKeep) {
 }
 
 KeyParameter& AuthorizationSet::operator[](int at) {
+    sorted_ = false;  // The caller may change the tag through the reference.
     return data_[at];
 }
 
@@ -149,9 +151,14 @@ const KeyParameter& AuthorizationSet::operator[](int at) const {
 
 void AuthorizationSet::Clear() {
     data_.clear();
+    sorted_ = true;
 }
 
 size_t AuthorizationSet::GetTagCount(Tag tag) const {
+    if (sorted_) {
+        auto [first, last] = std::equal_range(data_.begin(), data_.end(), tag, TagLess());
+        return last - first;
+    }
     size_t count = 0;
     for (int pos = -1; (pos = find(tag, pos)) != -1;) ++count;
     return count;
@@ -160,6 +167,13 @@ size_t AuthorizationSet::GetTagCount(Tag tag) const {
 int AuthorizationSet::find(Tag tag, int begin) const {
     auto iter = data_.begin() + (1 + begin);
 
+    if (sorted_) {
+        // All entries for tag are contiguous, start at the first one unless begin is past it.
+        iter = std::max(iter, std::lower_bound(data_.begin(), data_.end(), tag, TagLess()));
+        if (iter != data_.end() && iter->tag == tag) return iter - data_.begin();
+        return -1;
+    }
+
     while (iter != data_.end() && iter->tag != tag) ++iter;
 
     if (iter != data_.end()) return iter - data_.begin();
@@ -450,6 +464,7 @@ void AuthorizationSet::Serialize(std::ostream* out) const {
 
 void AuthorizationSet::Deserialize(std::istream* in) {
     deserialize(*in, &data_);
+    sorted_ = false;
 }
 
 AuthorizationSetBuilder& AuthorizationSetBuilder::RsaKey(uint32_t key_size,
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <keymasterV4_0/authorization_set.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace android {
+namespace hardware {
+namespace keymaster {
+namespace V4_0 {
+namespace {
+
+const Tag kLookedUpTags[] = {Tag::ALGORITHM, Tag::PURPOSE,         Tag::DIGEST,
+                             Tag::KEY_SIZE,  Tag::NO_AUTH_REQUIRED, Tag::USER_SECURE_ID};
+
+// Built in tag order, so that the set is sorted without a call to Sort().
+AuthorizationSet makeSortedSet() {
+    return AuthorizationSetBuilder()
+            .Authorization(TAG_ALGORITHM, Algorithm::EC)
+            .Authorization(TAG_PURPOSE, KeyPurpose::SIGN)
+            .Digest(Digest::SHA_2_256)
+            .Authorization(TAG_KEY_SIZE, 256);
+}
+
+// DIGEST sorts after ALGORITHM and PURPOSE, KEY_SIZE before NO_AUTH_REQUIRED.
+AuthorizationSet makeUnsortedSet() {
+    return AuthorizationSetBuilder()
+            .Digest(Digest::NONE, Digest::SHA_2_256)
+            .EcdsaSigningKey(EcCurve::P_256)
+            .Authorization(TAG_NO_AUTH_REQUIRED)
+            .Authorization(TAG_KEY_SIZE, 256);
+}
+
+// A copy of set that is no longer known to be in tag order, so its lookups scan linearly.
+AuthorizationSet unsortedCopy(AuthorizationSet set) {
+    if (!set.empty()) (void)set[0];
+    return set;
+}
+
+bool isInTagOrder(const AuthorizationSet& set) {
+    return std::is_sorted(set.begin(), set.end(), [](const KeyParameter& a, const KeyParameter& b) {
+        return a.tag < b.tag;
+    });
+}
+
+std::vector<int> findAll(const AuthorizationSet& set, Tag tag) {
+    std::vector<int> positions;
+    for (int pos = -1; (pos = set.find(tag, pos)) != -1;) positions.push_back(pos);
+    return positions;
+}
+
+// Expects the lookups of set to see what a linear scan sees.
+void expectLookupsMatchLinearScan(const AuthorizationSet& set) {
+    const AuthorizationSet reference = unsortedCopy(set);
+    for (Tag tag : kLookedUpTags) {
+        SCOPED_TRACE(toString(tag));
+        EXPECT_EQ(findAll(reference, tag), findAll(set, tag));
+        EXPECT_EQ(reference.GetTagCount(tag), set.GetTagCount(tag));
+        EXPECT_EQ(reference.Contains(tag), set.Contains(tag));
+    }
+    EXPECT_EQ(reference.Contains(TAG_PURPOSE, KeyPurpose::VERIFY),
+              set.Contains(TAG_PURPOSE, KeyPurpose::VERIFY));
+    EXPECT_EQ(reference.Contains(TAG_DIGEST, Digest::SHA_2_256),
+              set.Contains(TAG_DIGEST, Digest::SHA_2_256));
+    EXPECT_EQ(reference.GetTagValue(TAG_KEY_SIZE).isOk(), set.GetTagValue(TAG_KEY_SIZE).isOk());
+}
+
+TEST(AuthorizationSetTest, SortedLookupsMatchLinearScan) {
+    AuthorizationSet set = makeUnsortedSet();
+    set.Sort();
+    ASSERT_TRUE(isInTagOrder(set));
+
+    EXPECT_EQ(2u, set.GetTagCount(Tag::PURPOSE));
+    EXPECT_EQ(2u, set.GetTagCount(Tag::DIGEST));
+    EXPECT_EQ(0u, set.GetTagCount(Tag::PADDING));
+    EXPECT_TRUE(set.Contains(TAG_PURPOSE, KeyPurpose::VERIFY));
+    EXPECT_FALSE(set.Contains(TAG_PURPOSE, KeyPurpose::ENCRYPT));
+    EXPECT_FALSE(set.Contains(Tag::USER_SECURE_ID));
+    auto keySize = set.GetTagValue(TAG_KEY_SIZE);
+    ASSERT_TRUE(keySize.isOk());
+    EXPECT_EQ(256u, keySize.value());
+    expectLookupsMatchLinearScan(set);
+}
+
+TEST(AuthorizationSetTest, PushBackOutOfTagOrder) {
+    AuthorizationSet set = makeSortedSet();
+    set.push_back(Authorization(TAG_NO_AUTH_REQUIRED));
+    expectLookupsMatchLinearScan(set);
+
+    // PURPOSE sorts before NO_AUTH_REQUIRED, so the set is no longer in tag order.
+    set.push_back(Authorization(TAG_PURPOSE, KeyPurpose::VERIFY));
+    EXPECT_EQ(2u, set.GetTagCount(Tag::PURPOSE));
+    EXPECT_TRUE(set.Contains(TAG_PURPOSE, KeyPurpose::VERIFY));
+    EXPECT_EQ(std::vector<int>({1, 5}), findAll(set, Tag::PURPOSE));
+    expectLookupsMatchLinearScan(set);
+}
+
+TEST(AuthorizationSetTest, TagChangedThroughOperatorBracket) {
+    AuthorizationSet set = makeSortedSet();
+    set[0] = Authorization(TAG_KEY_SIZE, 128);
+
+    EXPECT_FALSE(set.Contains(Tag::ALGORITHM));
+    EXPECT_EQ(2u, set.GetTagCount(Tag::KEY_SIZE));
+    auto keySize = set.GetTagValue(TAG_KEY_SIZE);
+    ASSERT_TRUE(keySize.isOk());
+    EXPECT_EQ(128u, keySize.value());
+    expectLookupsMatchLinearScan(set);
+}
+
+TEST(AuthorizationSetTest, AssignedFromHidlVec) {
+    AuthorizationSet set = makeSortedSet();
+    set = makeUnsortedSet().hidl_data();
+
+    EXPECT_EQ(2u, set.GetTagCount(Tag::PURPOSE));
+    EXPECT_TRUE(set.Contains(TAG_DIGEST, Digest::NONE));
+    expectLookupsMatchLinearScan(set);
+}
+
+TEST(AuthorizationSetTest, Deserialized) {
+    std::stringstream stream;
+    makeUnsortedSet().Serialize(&stream);
+    AuthorizationSet set = makeSortedSet();
+    set.Deserialize(&stream);
+    ASSERT_FALSE(stream.bad());
+
+    EXPECT_EQ(makeUnsortedSet().size(), set.size());
+    EXPECT_EQ(2u, set.GetTagCount(Tag::PURPOSE));
+    EXPECT_TRUE(set.Contains(TAG_DIGEST, Digest::NONE));
+    expectLookupsMatchLinearScan(set);
+}
+
+TEST(AuthorizationSetTest, FilterKeepsTagOrder) {
+    AuthorizationSet set = makeUnsortedSet();
+    set.Sort();
+    set.Filter([](const KeyParameter& param) { return param.tag != Tag::PURPOSE; });
+
+    EXPECT_TRUE(isInTagOrder(set));
+    EXPECT_FALSE(set.Contains(Tag::PURPOSE));
+    EXPECT_EQ(2u, set.GetTagCount(Tag::DIGEST));
+    expectLookupsMatchLinearScan(set);
+}
+
+TEST(AuthorizationSetTest, ClearStartsInTagOrder) {
+    AuthorizationSet set = makeUnsortedSet();
+    set.Clear();
+    EXPECT_TRUE(set.empty());
+
+    set.push_back(makeSortedSet());
+    EXPECT_EQ(std::vector<int>({1}), findAll(set, Tag::PURPOSE));
+    expectLookupsMatchLinearScan(set);
+}
+
+TEST(AuthorizationSetTest, DeduplicateRemovesInvalidAndDuplicateEntries) {
+    AuthorizationSet set = makeUnsortedSet();
+    set.push_back(KeyParameter{});
+    set.push_back(makeUnsortedSet());
+    set.push_back(Authorization(TAG_DIGEST, Digest::SHA_2_512));
+    set.push_back(KeyParameter{});
+
+    set.Deduplicate();
+    EXPECT_TRUE(isInTagOrder(set));
+    EXPECT_EQ(makeUnsortedSet().size() + 1, set.size());
+    EXPECT_FALSE(set.Contains(Tag::INVALID));
+    EXPECT_EQ(3u, set.GetTagCount(Tag::DIGEST));
+    EXPECT_EQ(1u, set.GetTagCount(Tag::NO_AUTH_REQUIRED));
+    expectLookupsMatchLinearScan(set);
+}
+
+TEST(AuthorizationSetTest, DeduplicateOfInvalidEntriesOnly) {
+    AuthorizationSet set;
+    set.push_back(KeyParameter{});
+    set.push_back(KeyParameter{});
+
+    set.Deduplicate();
+    EXPECT_TRUE(set.empty());
+}
+
+TEST(AuthorizationSetTest, UnionAndSubtract) {
+    AuthorizationSet set = makeUnsortedSet();
+    AuthorizationSet other = AuthorizationSetBuilder()
+                                     .Digest(Digest::SHA_2_256, Digest::SHA_2_512)
+                                     .Authorization(TAG_USER_SECURE_ID, 42);
+
+    set.Union(other);
+    EXPECT_TRUE(isInTagOrder(set));
+    EXPECT_EQ(3u, set.GetTagCount(Tag::DIGEST));
+    EXPECT_TRUE(set.Contains(Tag::USER_SECURE_ID));
+    expectLookupsMatchLinearScan(set);
+
+    set.Subtract(other);
+    EXPECT_TRUE(isInTagOrder(set));
+    EXPECT_EQ(1u, set.GetTagCount(Tag::DIGEST));
+    EXPECT_TRUE(set.Contains(TAG_DIGEST, Digest::NONE));
+    EXPECT_FALSE(set.Contains(Tag::USER_SECURE_ID));
+    expectLookupsMatchLinearScan(set);
+
+    // Removing entries from a sorted set keeps it sorted.
+    ASSERT_TRUE(set.erase(set.find(Tag::ALGORITHM)));
+    EXPECT_FALSE(set.Contains(Tag::ALGORITHM));
+    expectLookupsMatchLinearScan(set);
+}
+
+}  // namespace
+}  // namespace V4_0
+}  // namespace keymaster
+}  // namespace hardware
+}  // namespace android
@@ -14,6 +14,7 @@
  * limitations under the License.
  *
  */
+#include <android-base/logging.h>
 #include <android/hardware/keymaster/4.0/IKeymasterDevice.h>
 #include <keymasterV4_0/attestation_record.h>
 #include <keymasterV4_0/openssl_utils.h>
@@ -137,8 +138,47 @@ bool KeyMaster4AttestationFuzzer::verifyAttestationRecord(
     bool device_locked;
     hidl_vec<uint8_t> verifiedBootHash;
 
-    parse_root_of_trust(attestRecord->data, attestRecord->length, &verifiedBootKey,
-                        &verifiedBootState, &device_locked, &verifiedBootHash);
+    ErrorCode rootOfTrustError =
+            parse_root_of_trust(attestRecord->data, attestRecord->length, &verifiedBootKey,
+                                &verifiedBootState, &device_locked, &verifiedBootHash);
+
+    // The view rejects some records the parser accepts, such as out of range or non-DER
+    // integers, but whatever both accept they must decode alike.
+    AttestationRecordView view;
+    if (view.init(attestRecord->data, attestRecord->length) != ErrorCode::OK) {
+        return true;
+    }
+    CHECK(view.attestationVersion() == attestationVersion);
+    CHECK(view.attestationSecurityLevel() == securityLevel);
+    CHECK(view.keymasterVersion() == keymasterVersion);
+    CHECK(view.keymasterSecurityLevel() == keymasterSecurityLevel);
+    CHECK(view.attestationChallenge() == attestationChallenge);
+    CHECK(view.uniqueId() == attestationUniqueId);
+
+    // The view keeps the encoded order of the entries.
+    AuthorizationSet viewSwEnforced;
+    AuthorizationSet viewHwEnforced;
+    if (view.getAuthorizations(&viewSwEnforced, &viewHwEnforced) == ErrorCode::OK) {
+        attestationSwEnforced.Sort();
+        attestationHwEnforced.Sort();
+        viewSwEnforced.Sort();
+        viewHwEnforced.Sort();
+        CHECK(viewSwEnforced.hidl_data() == attestationSwEnforced.hidl_data());
+        CHECK(viewHwEnforced.hidl_data() == attestationHwEnforced.hidl_data());
+    }
+
+    hidl_vec<uint8_t> viewVerifiedBootKey;
+    keymaster_verified_boot_t viewVerifiedBootState;
+    bool viewDeviceLocked;
+    hidl_vec<uint8_t> viewVerifiedBootHash;
+    ErrorCode viewRootOfTrustError = view.getRootOfTrust(
+            &viewVerifiedBootKey, &viewVerifiedBootState, &viewDeviceLocked, &viewVerifiedBootHash);
+    if (rootOfTrustError == ErrorCode::OK && viewRootOfTrustError == ErrorCode::OK) {
+        CHECK(viewVerifiedBootKey == verifiedBootKey);
+        CHECK(viewVerifiedBootState == verifiedBootState);
+        CHECK(viewDeviceLocked == device_locked);
+        CHECK(viewVerifiedBootHash == verifiedBootHash);
+    }
     return true;
 }
 
@@ -19,6 +19,8 @@
 
 #include <android/hardware/keymaster/4.0/IKeymasterDevice.h>
 
+#include <initializer_list>
+
 namespace android {
 namespace hardware {
 namespace keymaster {
@@ -64,6 +66,70 @@ ErrorCode parse_root_of_trust(const uint8_t* asn1_key_desc, size_t asn1_key_desc
                               keymaster_verified_boot_t* verified_boot_state, bool* device_locked,
                               hidl_vec<uint8_t>* verified_boot_hash);
 
+/**
+ * A view of a DER-encoded attestation record that decodes only what is asked for.
+ *
+ * init() locates the fields of the KeyDescription without copying anything.  The authorization
+ * lists are only walked when queried, once per list and query, and only the requested tags are
+ * decoded, so that a verifier needing a few tags and the root of trust pays for a single framing
+ * pass instead of two full decodes.  Tags this version does not know are skipped rather than
+ * rejected, and the entries of each list are returned in their encoded order.
+ *
+ * The view points into the buffer given to init(), which must outlive it.
+ */
+class AttestationRecordView {
+   public:
+    ErrorCode init(const uint8_t* asn1_key_desc, size_t asn1_key_desc_len);
+
+    uint32_t attestationVersion() const { return attestation_version_; }
+    SecurityLevel attestationSecurityLevel() const { return attestation_security_level_; }
+    uint32_t keymasterVersion() const { return keymaster_version_; }
+    SecurityLevel keymasterSecurityLevel() const { return keymaster_security_level_; }
+    hidl_vec<uint8_t> attestationChallenge() const;
+    hidl_vec<uint8_t> uniqueId() const;
+
+    /**
+     * Appends the entries of \p tags found in the software-enforced and TEE-enforced lists.
+     * TAG_ROOT_OF_TRUST is not an authorization; use getRootOfTrust().
+     */
+    ErrorCode getAuthorizations(std::initializer_list<Tag> tags,
+                                AuthorizationSet* software_enforced,
+                                AuthorizationSet* tee_enforced) const;
+
+    /**
+     * Appends every entry that parse_attestation_record() returns.
+     */
+    ErrorCode getAuthorizations(AuthorizationSet* software_enforced,
+                                AuthorizationSet* tee_enforced) const;
+
+    /**
+     * Same as parse_root_of_trust(), from the TEE-enforced list or else the software-enforced one.
+     */
+    ErrorCode getRootOfTrust(hidl_vec<uint8_t>* verified_boot_key,
+                             keymaster_verified_boot_t* verified_boot_state, bool* device_locked,
+                             hidl_vec<uint8_t>* verified_boot_hash) const;
+
+   private:
+    struct Span {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    static ErrorCode getAuthorizations(Span list, const Tag* tags, size_t tag_count,
+                                       AuthorizationSet* auth_list);
+    static bool findRootOfTrust(Span list, Span* root_of_trust);
+
+    uint32_t attestation_version_ = 0;
+    SecurityLevel attestation_security_level_ = SecurityLevel::SOFTWARE;
+    uint32_t keymaster_version_ = 0;
+    SecurityLevel keymaster_security_level_ = SecurityLevel::SOFTWARE;
+    Span attestation_challenge_;
+    Span unique_id_;
+    // Contents of the AuthorizationList sequences.
+    Span software_enforced_;
+    Span tee_enforced_;
+};
+
 }  // namespace V4_0
 }  // namespace keymaster
 }  // namespace hardware
@@ -33,6 +33,11 @@ class AuthorizationSetBuilder;
  * An ordered collection of KeyParameters. It provides memory ownership and some convenient
  * functionality for sorting, deduplicating, joining, and subtracting sets of KeyParameters.
  * For serialization, wrap the backing store of this structure in a hidl_vec<KeyParameter>.
+ *
+ * Once the set has been sorted (or deduplicated), tag lookups are logarithmic until it is modified
+ * through anything but push_back() of a parameter that keeps the tags in order, erase() or
+ * Filter().  Do not change the tag of an entry through a reference obtained before the set was
+ * sorted.
  */
 class AuthorizationSet {
    public:
@@ -44,10 +49,11 @@ class AuthorizationSet {
     AuthorizationSet(){};
 
     // Copy constructor.
-    AuthorizationSet(const AuthorizationSet& other) : data_(other.data_) {}
+    AuthorizationSet(const AuthorizationSet& other) : data_(other.data_), sorted_(other.sorted_) {}
 
     // Move constructor.
-    AuthorizationSet(AuthorizationSet&& other) noexcept : data_(std::move(other.data_)) {}
+    AuthorizationSet(AuthorizationSet&& other) noexcept
+        : data_(std::move(other.data_)), sorted_(other.sorted_) {}
 
     // Constructor from hidl_vec<KeyParameter>
     AuthorizationSet(const hidl_vec<KeyParameter>& other) { *this = other; }
@@ -55,12 +61,14 @@ class AuthorizationSet {
     // Copy assignment.
     AuthorizationSet& operator=(const AuthorizationSet& other) {
         data_ = other.data_;
+        sorted_ = other.sorted_;
         return *this;
     }
 
     // Move assignment.
     AuthorizationSet& operator=(AuthorizationSet&& other) noexcept {
         data_ = std::move(other.data_);
+        sorted_ = other.sorted_;
         return *this;
     }
 
@@ -72,6 +80,7 @@ class AuthorizationSet {
                  * See assignment operator/copy constructor of hidl_vec.*/
                 data_[i] = other[i];
             }
+            sorted_ = false;
         }
         return *this;
     }
@@ -169,8 +178,8 @@ class AuthorizationSet {
     template <TagType tag_type, Tag tag, typename ValueT, typename Comparator = std::equal_to<>>
     bool Contains(TypedTag<tag_type, tag> ttag, const ValueT& value,
                   Comparator cmp = Comparator()) const {
-        for (const auto& param : data_) {
-            auto entry = authorizationValue(ttag, param);
+        for (int pos = -1; (pos = find(tag, pos)) != -1;) {
+            auto entry = authorizationValue(ttag, data_[pos]);
             if (entry.isOk() && cmp(static_cast<ValueT>(entry.value()), value)) return true;
         }
         return false;
@@ -187,8 +196,14 @@ class AuthorizationSet {
         return {};
     }
 
-    void push_back(const KeyParameter& param) { data_.push_back(param); }
-    void push_back(KeyParameter&& param) { data_.push_back(std::move(param)); }
+    void push_back(const KeyParameter& param) {
+        KeepSorted(param);
+        data_.push_back(param);
+    }
+    void push_back(KeyParameter&& param) {
+        KeepSorted(param);
+        data_.push_back(std::move(param));
+    }
     void push_back(const AuthorizationSet& set) {
         for (auto& entry : set) {
             push_back(entry);
@@ -227,7 +242,15 @@ class AuthorizationSet {
    private:
     NullOr<const KeyParameter&> GetEntry(Tag tag) const;
 
+    // Appending keeps the set sorted by tag as long as the tags don't go down.
+    void KeepSorted(const KeyParameter& param) {
+        sorted_ = sorted_ && (data_.empty() || !(param.tag < data_.back().tag));
+    }
+
     std::vector<KeyParameter> data_;
+    // True while data_ is ordered by tag, so that the entries for one tag are contiguous and can
+    // be found by binary search.
+    bool sorted_ = true;
 };
 
 class AuthorizationSetBuilder : public AuthorizationSet {
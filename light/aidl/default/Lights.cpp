@@ -16,23 +16,392 @@
 
 #include "Lights.h"
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <optional>
+
+#include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+using ::android::base::unique_fd;
 
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace light {
 
+namespace {
+
+// Matched against the function of the LED name. The first match wins, so the backlights of the
+// keyboard and of the buttons come before the one of the display.
+constexpr std::pair<const char*, LightType> kFunctions[] = {
+        {"kbd", LightType::KEYBOARD},          {"keyboard", LightType::KEYBOARD},
+        {"button", LightType::BUTTONS},        {"backlight", LightType::BACKLIGHT},
+        {"charging", LightType::BATTERY},      {"battery", LightType::BATTERY},
+        {"notification", LightType::NOTIFICATIONS}, {"indicator", LightType::NOTIFICATIONS},
+        {"status", LightType::NOTIFICATIONS},  {"attention", LightType::ATTENTION},
+        {"bluetooth", LightType::BLUETOOTH},   {"wlan", LightType::WIFI},
+        {"wifi", LightType::WIFI},             {"mic", LightType::MICROPHONE},
+        {"camera", LightType::CAMERA},
+};
+
+constexpr const char* kColors[] = {"red", "green", "blue"};
+
+struct LedName {
+    std::string device;
+    std::string color;
+    std::string function;
+};
+
+// "devicename:color:function", where the device name is optional. Older drivers only give the
+// color ("red") or the function ("lcd-backlight").
+LedName parseLedName(const std::string& name) {
+    std::vector<std::string> parts = ::android::base::Split(name, ":");
+    if (parts.size() == 1) {
+        for (const char* color : kColors) {
+            if (name == color) return {"", name, ""};
+        }
+        return {"", "", name};
+    }
+    if (parts.size() == 2) return {"", parts[0], parts[1]};
+    return {parts[0], parts[1], parts[2]};
+}
+
+std::optional<LightType> typeOfLed(const LedName& name) {
+    if (name.function.empty()) {
+        // The red, green and blue LEDs of older devices are the notification light.
+        if (!name.color.empty()) return LightType::NOTIFICATIONS;
+        return std::nullopt;
+    }
+    for (const auto& [match, type] : kFunctions) {
+        if (name.function.find(match) != std::string::npos) return type;
+    }
+    return std::nullopt;
+}
+
+bool readInt(const std::string& path, int* out) {
+    std::string content;
+    return ::android::base::ReadFileToString(path, &content) &&
+           ::android::base::ParseInt(::android::base::Trim(content), out);
+}
+
+// The trigger attribute lists the available triggers, the current one in brackets.
+void readTriggers(const std::string& path, std::set<std::string>* triggers, std::string* current) {
+    std::string content;
+    if (!::android::base::ReadFileToString(path, &content)) return;
+    for (std::string trigger : ::android::base::Split(::android::base::Trim(content), " ")) {
+        if (trigger.size() > 2 && trigger.front() == '[' && trigger.back() == ']') {
+            trigger = trigger.substr(1, trigger.size() - 2);
+            *current = trigger;
+        }
+        triggers->insert(trigger);
+    }
+}
+
+unique_fd openAttribute(const std::string& path) {
+    return unique_fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_WRONLY | O_CLOEXEC)));
+}
+
+// From the documentation of HwLightState::color, for lights with a single LED.
+int luminance(int color) {
+    const int red = (color >> 16) & 0xff;
+    const int green = (color >> 8) & 0xff;
+    const int blue = color & 0xff;
+    return (77 * red + 150 * green + 29 * blue) >> 8;
+}
+
+// Scales a [0, 255] channel to the range of the LED, without turning a dim color off.
+int scale(int value, int maxBrightness) {
+    if (value == 0) return 0;
+    return std::max(1, (value * maxBrightness + 127) / 255);
+}
+
+std::string toSysfs(int value) {
+    return std::to_string(value);
+}
+
+const std::string& toSysfs(const std::string& value) {
+    return value;
+}
+
+void forget(int* value) {
+    *value = -1;
+}
+
+void forget(std::string* value) {
+    value->clear();
+}
+
+}  // namespace
+
+Lights::Lights(const std::string& sysfs_leds) {
+    discover(sysfs_leds);
+    mThread = std::thread(&Lights::threadLoop, this);
+}
+
+Lights::~Lights() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mWakeUp.notify_one();
+    mThread.join();
+}
+
+void Lights::discover(const std::string& sysfs_leds) {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(sysfs_leds.c_str()), closedir);
+    if (dir == nullptr) {
+        PLOG(WARNING) << "Cannot open " << sysfs_leds;
+        return;
+    }
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(dir.get())) {
+        if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+    }
+    // For stable ids and ordinals.
+    std::sort(names.begin(), names.end());
+
+    // The red, green and blue LEDs of each device and function.
+    std::map<std::pair<std::string, std::string>, std::pair<LightType, std::vector<Led>>> groups;
+    std::vector<std::pair<LightType, Led>> singles;
+    for (const std::string& name : names) {
+        LedName ledName = parseLedName(name);
+        std::optional<LightType> type = typeOfLed(ledName);
+        if (!type.has_value()) continue;
+
+        Led led;
+        led.name = name;
+        led.path = sysfs_leds + "/" + name;
+        if (!readInt(led.path + "/max_brightness", &led.maxBrightness) || led.maxBrightness <= 0) {
+            continue;
+        }
+        readInt(led.path + "/brightness", &led.brightness);
+        readTriggers(led.path + "/trigger", &led.triggers, &led.trigger);
+        led.brightnessFd = openAttribute(led.path + "/brightness");
+        led.triggerFd = openAttribute(led.path + "/trigger");
+        if (led.brightnessFd.get() < 0) {
+            PLOG(WARNING) << "Cannot open the brightness of " << name;
+            continue;
+        }
+
+        if (std::find(std::begin(kColors), std::end(kColors), ledName.color) != std::end(kColors)) {
+            auto& group = groups[{ledName.device, ledName.function}];
+            group.first = *type;
+            group.second.push_back(std::move(led));
+        } else {
+            singles.emplace_back(*type, std::move(led));
+        }
+    }
+
+    std::map<LightType, int> ordinals;
+    auto addLight = [&](LightType type) -> Light& {
+        Light& light = mLights.emplace_back();
+        light.info.id = mLights.size() - 1;
+        light.info.ordinal = ordinals[type]++;
+        light.info.type = type;
+        return light;
+    };
+    for (auto& [key, group] : groups) {
+        auto& [type, leds] = group;
+        // In red, green, blue order, as the channels of the color.
+        std::vector<size_t> rgb;
+        for (const char* color : kColors) {
+            for (size_t i = 0; i < leds.size(); i++) {
+                if (parseLedName(leds[i].name).color == color) {
+                    rgb.push_back(i);
+                    break;
+                }
+            }
+        }
+        if (leds.size() == std::size(kColors) && rgb.size() == std::size(kColors)) {
+            Light& light = addLight(type);
+            for (size_t i : rgb) light.leds.push_back(std::move(leds[i]));
+            continue;
+        }
+        // Not a set of one LED of each color, each LED is a light of its own.
+        for (Led& led : leds) {
+            addLight(type).leds.push_back(std::move(led));
+        }
+    }
+    for (auto& [type, led] : singles) {
+        addLight(type).leds.push_back(std::move(led));
+    }
+    for (const Light& light : mLights) {
+        LOG(INFO) << "Found " << toString(light.info.type) << " light " << light.info.id
+                  << " with " << light.leds.size() << " LED(s), " << light.leds.front().name;
+    }
+}
+
 ndk::ScopedAStatus Lights::setLightState(int id, const HwLightState& state) {
-    LOG(INFO) << "Lights setting state for id=" << id << " to color " << std::hex << state.color;
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    if (state.brightnessMode == BrightnessMode::LOW_PERSISTENCE) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (id < 0 || id >= static_cast<int>(mLights.size())) {
+            return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+        }
+        Light& light = mLights[id];
+        mRequests++;
+        if (light.pending) {
+            mCoalesced++;
+        }
+        light.requested = state;
+        light.pending = true;
+        mHasPending = true;
+    }
+    mWakeUp.notify_one();
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Lights::getLights(std::vector<HwLight>* /*lights*/) {
-    LOG(INFO) << "Lights reporting supported lights";
+ndk::ScopedAStatus Lights::getLights(std::vector<HwLight>* lights) {
+    std::lock_guard<std::mutex> lock(mLock);
+    for (const Light& light : mLights) {
+        lights->push_back(light.info);
+    }
     return ndk::ScopedAStatus::ok();
 }
 
+void Lights::threadLoop() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mWakeUp.wait(lock, [this] { return mHasPending || mExit; });
+        if (mExit) return;
+        mHasPending = false;
+        for (Light& light : mLights) {
+            if (!light.pending) continue;
+            light.pending = false;
+            const HwLightState state = light.requested;
+            // Only this thread touches the LEDs.
+            lock.unlock();
+            apply(&light, state);
+            lock.lock();
+        }
+    }
+}
+
+void Lights::apply(Light* light, const HwLightState& state) {
+    if (light->leds.size() == 1) {
+        Led& led = light->leds.front();
+        applyToLed(&led, scale(luminance(state.color), led.maxBrightness), state);
+        return;
+    }
+    for (size_t i = 0; i < light->leds.size(); i++) {
+        Led& led = light->leds[i];
+        const int channel = (state.color >> (16 - 8 * i)) & 0xff;
+        applyToLed(&led, scale(channel, led.maxBrightness), state);
+    }
+}
+
+void Lights::applyToLed(Led* led, int brightness, const HwLightState& state) {
+    const bool flashing = state.flashMode != FlashMode::NONE && state.flashOnMs > 0 &&
+                          state.flashOffMs > 0 && brightness > 0;
+    if (flashing && led->triggers.count("timer")) {
+        if (led->trigger == "timer" && led->brightness != brightness) {
+            // The timer blinks up to the brightness the LED had when it was set.
+            setTrigger(led, "none");
+        }
+        if (led->trigger != "timer") {
+            writeValue(*led, led->brightnessFd, "brightness", &led->brightness, brightness);
+            if (!setTrigger(led, "timer")) return;
+        }
+        writeValue(*led, led->delayOnFd, "delay_on", &led->delayOn, state.flashOnMs);
+        writeValue(*led, led->delayOffFd, "delay_off", &led->delayOff, state.flashOffMs);
+        return;
+    }
+    if (flashing && led->triggers.count("pattern")) {
+        if (!setTrigger(led, "pattern")) return;
+        // Steps between on and off, rather than ramps.
+        const std::string pattern = ::android::base::StringPrintf(
+                "%d %d %d 0 0 %d 0 0", brightness, state.flashOnMs, brightness, state.flashOffMs);
+        writeValue(*led, led->patternFd, "pattern", &led->pattern, pattern);
+        return;
+    }
+    if (flashing) {
+        LOG(DEBUG) << led->name << " cannot flash, keeping it on";
+    }
+    if (led->trigger != "none" && !led->trigger.empty()) {
+        setTrigger(led, "none");
+    }
+    writeValue(*led, led->brightnessFd, "brightness", &led->brightness, brightness);
+}
+
+bool Lights::setTrigger(Led* led, const std::string& trigger) {
+    std::string current = led->trigger;
+    if (!writeValue(*led, led->triggerFd, "trigger", &current, trigger)) return false;
+    if (led->trigger == trigger) return true;
+    led->trigger = trigger;
+
+    // The attributes of the previous trigger are gone, the ones of the new trigger start from
+    // the defaults.
+    led->delayOnFd.reset();
+    led->delayOffFd.reset();
+    led->patternFd.reset();
+    led->delayOn = -1;
+    led->delayOff = -1;
+    led->pattern.clear();
+    if (trigger == "none") {
+        // Removing a trigger turns the LED off.
+        led->brightness = 0;
+    } else if (trigger == "timer") {
+        led->delayOnFd = openAttribute(led->path + "/delay_on");
+        led->delayOffFd = openAttribute(led->path + "/delay_off");
+    } else {
+        led->brightness = -1;
+        if (trigger == "pattern") led->patternFd = openAttribute(led->path + "/pattern");
+    }
+    return true;
+}
+
+template <typename T>
+bool Lights::writeValue(const Led& led, const unique_fd& fd, const char* attribute, T* cached,
+                        const T& value) {
+    if (*cached == value) {
+        mSkippedWrites++;
+        return true;
+    }
+    const std::string content = toSysfs(value);
+    if (fd.get() < 0 ||
+        TEMP_FAILURE_RETRY(pwrite(fd.get(), content.data(), content.size(), 0)) < 0) {
+        PLOG(WARNING) << "Cannot write " << content << " to the " << attribute << " of "
+                      << led.name;
+        // Whatever the attribute holds now, it is written again next time.
+        forget(cached);
+        return false;
+    }
+    mWrites++;
+    *cached = value;
+    return true;
+}
+
+binder_status_t Lights::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    std::lock_guard<std::mutex> lock(mLock);
+    dprintf(fd, "%zu lights, %llu requests, %llu coalesced, %llu writes, %llu skipped\n",
+            mLights.size(), static_cast<unsigned long long>(mRequests),
+            static_cast<unsigned long long>(mCoalesced),
+            static_cast<unsigned long long>(mWrites.load()),
+            static_cast<unsigned long long>(mSkippedWrites.load()));
+    for (const Light& light : mLights) {
+        std::vector<std::string> names;
+        for (const Led& led : light.leds) names.push_back(led.name);
+        dprintf(fd, "  %d: %s %d (%s): color 0x%08x, flash %s %d/%d ms\n", light.info.id,
+                toString(light.info.type).c_str(), light.info.ordinal,
+                ::android::base::Join(names, ", ").c_str(), light.requested.color,
+                toString(light.requested.flashMode).c_str(), light.requested.flashOnMs,
+                light.requested.flashOffMs);
+    }
+    return STATUS_OK;
+}
+
 }  // namespace light
 }  // namespace hardware
 }  // namespace android
@@ -16,17 +16,100 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <aidl/android/hardware/light/BnLights.h>
+#include <android-base/unique_fd.h>
 
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace light {
 
-// Default implementation that reports no supported lights.
+// Default implementation driving the LEDs of /sys/class/leds.
+//
+// The LEDs are discovered once, when the service starts. Their names follow the kernel
+// "devicename:color:function" convention; the function gives the type of the light, and the
+// red, green and blue LEDs of the same function are driven together as one light. LEDs of an
+// unknown function (disk or network activity...) are not reported.
+//
+// setLightState only records the requested state, a worker thread writes it to sysfs. States
+// requested for a light before the worker gets to it are coalesced, only the latest one is
+// written. Attributes that already have the right value are not written again.
+//
+// Flashing is left to the kernel: the timer trigger if the LED has it, the pattern trigger
+// otherwise, so that no write is needed while the light blinks.
 class Lights : public BnLights {
+  public:
+    // |sysfs_leds| is the directory of the LEDs; a different one may be given for testing.
+    explicit Lights(const std::string& sysfs_leds = "/sys/class/leds");
+    ~Lights();
+
     ndk::ScopedAStatus setLightState(int id, const HwLightState& state) override;
     ndk::ScopedAStatus getLights(std::vector<HwLight>* types) override;
+
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+  private:
+    // One LED of /sys/class/leds, with the values last written to it.
+    struct Led {
+        std::string name;
+        std::string path;
+        int maxBrightness = 0;
+        std::set<std::string> triggers;
+        ::android::base::unique_fd brightnessFd;
+        ::android::base::unique_fd triggerFd;
+        // Only exist while the timer, or the pattern, trigger is set.
+        ::android::base::unique_fd delayOnFd;
+        ::android::base::unique_fd delayOffFd;
+        ::android::base::unique_fd patternFd;
+
+        // -1 or empty when unknown.
+        int brightness = -1;
+        std::string trigger;
+        int delayOn = -1;
+        int delayOff = -1;
+        std::string pattern;
+    };
+
+    struct Light {
+        HwLight info;
+        // A single LED, or the red, green and blue ones.
+        std::vector<Led> leds;
+        HwLightState requested;
+        bool pending = false;
+    };
+
+    void discover(const std::string& sysfs_leds);
+    void threadLoop();
+    void apply(Light* light, const HwLightState& state);
+    void applyToLed(Led* led, int brightness, const HwLightState& state);
+    bool setTrigger(Led* led, const std::string& trigger);
+    // Writes |value| unless |*cached| already is |value|.
+    template <typename T>
+    bool writeValue(const Led& led, const ::android::base::unique_fd& fd, const char* attribute,
+                    T* cached, const T& value);
+
+    std::mutex mLock;
+    std::condition_variable mWakeUp;
+    // The lights are discovered before the worker starts, and then only their requested state
+    // changes. Guarded by mLock.
+    std::vector<Light> mLights;
+    bool mHasPending = false;
+    bool mExit = false;
+    uint64_t mRequests = 0;
+    uint64_t mCoalesced = 0;
+    // Updated by the worker thread.
+    std::atomic<uint64_t> mWrites = 0;
+    std::atomic<uint64_t> mSkippedWrites = 0;
+
+    std::thread mThread;
 };
 
 }  // namespace light
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Lights.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <gtest/gtest.h>
+
+using ::android::base::ReadFileToString;
+using ::android::base::WriteStringToFile;
+using namespace std::chrono_literals;
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+namespace {
+
+constexpr auto kTimeout = 2s;
+
+HwLightState solid(int color) {
+    HwLightState state;
+    state.color = color;
+    state.flashMode = FlashMode::NONE;
+    state.brightnessMode = BrightnessMode::USER;
+    return state;
+}
+
+HwLightState flashing(int color, int onMs, int offMs) {
+    HwLightState state = solid(color);
+    state.flashMode = FlashMode::TIMED;
+    state.flashOnMs = onMs;
+    state.flashOffMs = offMs;
+    return state;
+}
+
+// Lays out LEDs in a temporary directory, the way /sys/class/leds has them.
+//
+// Unlike sysfs, a write to a regular file does not replace its content; the attributes are
+// emptied once the LEDs are discovered, and each time the test has seen the value it waits for.
+class LightsTest : public ::testing::Test {
+  protected:
+    void addLed(const std::string& name, int maxBrightness = 255,
+                const std::string& triggers = "[none]") {
+        const std::string path = std::string(mDir.path) + "/" + name;
+        mLeds.push_back(path);
+        ASSERT_EQ(0, mkdir(path.c_str(), 0700)) << path;
+        ASSERT_TRUE(WriteStringToFile(std::to_string(maxBrightness) + "\n",
+                                      path + "/max_brightness"));
+        ASSERT_TRUE(WriteStringToFile("0\n", path + "/brightness"));
+        ASSERT_TRUE(WriteStringToFile(triggers + "\n", path + "/trigger"));
+        // Only exist with the timer or the pattern trigger in sysfs.
+        for (const char* attribute : {"delay_on", "delay_off", "pattern"}) {
+            ASSERT_TRUE(WriteStringToFile("", path + "/" + attribute));
+        }
+    }
+
+    void start() {
+        mLights = ndk::SharedRefBase::make<Lights>(mDir.path);
+        for (const std::string& path : mLeds) {
+            ASSERT_EQ(0, truncate((path + "/brightness").c_str(), 0));
+            ASSERT_EQ(0, truncate((path + "/trigger").c_str(), 0));
+        }
+    }
+
+    std::vector<HwLight> lights() {
+        std::vector<HwLight> lights;
+        EXPECT_TRUE(mLights->getLights(&lights).isOk());
+        return lights;
+    }
+
+    // Returns whether |value| is written to the attribute of the LED within kTimeout.
+    bool waitForAttribute(const std::string& led, const std::string& attribute,
+                          const std::string& value) {
+        const std::string path = std::string(mDir.path) + "/" + led + "/" + attribute;
+        const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+        std::string content;
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (ReadFileToString(path, &content) &&
+                ::android::base::Trim(content) == value) {
+                return truncate(path.c_str(), 0) == 0;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+        ADD_FAILURE() << path << " is \"" << content << "\", not \"" << value << "\"";
+        return false;
+    }
+
+    std::string dump() {
+        TemporaryFile file;
+        EXPECT_EQ(STATUS_OK, mLights->dump(file.fd, nullptr, 0));
+        std::string out;
+        ReadFileToString(file.path, &out);
+        return out;
+    }
+
+    // Returns whether the dump has |text| within kTimeout.
+    bool waitForDump(const std::string& text) {
+        const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+        while (dump().find(text) == std::string::npos) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    TemporaryDir mDir;
+    std::vector<std::string> mLeds;
+    std::shared_ptr<Lights> mLights;
+};
+
+TEST_F(LightsTest, ReportsTheLightsOfKnownFunctions) {
+    addLed("red");
+    addLed("green");
+    addLed("blue");
+    addLed("lcd-backlight");
+    addLed("button-backlight");
+    addLed("white:kbd_backlight");
+    addLed("mmc0::");
+    start();
+
+    const std::vector<HwLight> found = lights();
+
+    // The RGB group first, then the single LEDs by name.
+    ASSERT_EQ(4u, found.size());
+    EXPECT_EQ(LightType::NOTIFICATIONS, found[0].type);
+    EXPECT_EQ(LightType::BUTTONS, found[1].type);
+    EXPECT_EQ(LightType::BACKLIGHT, found[2].type);
+    EXPECT_EQ(LightType::KEYBOARD, found[3].type);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(i, found[i].id);
+        EXPECT_EQ(0, found[i].ordinal);
+    }
+}
+
+TEST_F(LightsTest, ReportsEachLedOfAnIncompleteGroup) {
+    addLed("red:status");
+    addLed("green:status");
+    start();
+
+    const std::vector<HwLight> found = lights();
+
+    ASSERT_EQ(2u, found.size());
+    EXPECT_EQ(LightType::NOTIFICATIONS, found[0].type);
+    EXPECT_EQ(0, found[0].ordinal);
+    EXPECT_EQ(LightType::NOTIFICATIONS, found[1].type);
+    EXPECT_EQ(1, found[1].ordinal);
+}
+
+TEST_F(LightsTest, SkipsLedsWithoutBrightness) {
+    addLed("lcd-backlight", 0);
+    start();
+
+    EXPECT_TRUE(lights().empty());
+}
+
+TEST_F(LightsTest, WritesTheLuminanceOfSingleLeds) {
+    addLed("lcd-backlight");
+    start();
+
+    ASSERT_TRUE(mLights->setLightState(0, solid(0xff808080)).isOk());
+
+    EXPECT_TRUE(waitForAttribute("lcd-backlight", "brightness", "128"));
+}
+
+TEST_F(LightsTest, WritesEachChannelToItsLed) {
+    addLed("red");
+    addLed("green");
+    addLed("blue", 100);
+    start();
+
+    ASSERT_TRUE(mLights->setLightState(0, solid(0xff1122ff)).isOk());
+
+    EXPECT_TRUE(waitForAttribute("red", "brightness", "17"));
+    EXPECT_TRUE(waitForAttribute("green", "brightness", "34"));
+    EXPECT_TRUE(waitForAttribute("blue", "brightness", "100"));
+}
+
+TEST_F(LightsTest, KeepsDimColorsOn) {
+    addLed("lcd-backlight", 1);
+    start();
+
+    ASSERT_TRUE(mLights->setLightState(0, solid(0xff010101)).isOk());
+
+    EXPECT_TRUE(waitForAttribute("lcd-backlight", "brightness", "1"));
+}
+
+TEST_F(LightsTest, FlashesWithTheTimerTrigger) {
+    addLed("white:notification", 255, "[none] timer pattern");
+    start();
+
+    ASSERT_TRUE(mLights->setLightState(0, flashing(0xffffffff, 500, 1000)).isOk());
+
+    EXPECT_TRUE(waitForAttribute("white:notification", "brightness", "255"));
+    EXPECT_TRUE(waitForAttribute("white:notification", "trigger", "timer"));
+    EXPECT_TRUE(waitForAttribute("white:notification", "delay_on", "500"));
+    EXPECT_TRUE(waitForAttribute("white:notification", "delay_off", "1000"));
+}
+
+TEST_F(LightsTest, FlashesWithThePatternTriggerWithoutTimer) {
+    addLed("white:notification", 255, "[none] pattern");
+    start();
+
+    ASSERT_TRUE(mLights->setLightState(0, flashing(0xffffffff, 500, 1000)).isOk());
+
+    EXPECT_TRUE(waitForAttribute("white:notification", "trigger", "pattern"));
+    EXPECT_TRUE(
+            waitForAttribute("white:notification", "pattern", "255 500 255 0 0 1000 0 0"));
+}
+
+TEST_F(LightsTest, StaysOnWithoutFlashingTriggers) {
+    addLed("white:notification");
+    start();
+
+    ASSERT_TRUE(mLights->setLightState(0, flashing(0xffffffff, 500, 1000)).isOk());
+
+    EXPECT_TRUE(waitForAttribute("white:notification", "brightness", "255"));
+}
+
+TEST_F(LightsTest, DoesNotRewriteUnchangedValues) {
+    addLed("lcd-backlight");
+    start();
+    ASSERT_TRUE(mLights->setLightState(0, solid(0xff808080)).isOk());
+    ASSERT_TRUE(waitForAttribute("lcd-backlight", "brightness", "128"));
+
+    ASSERT_TRUE(mLights->setLightState(0, solid(0xff808080)).isOk());
+
+    EXPECT_TRUE(waitForDump("1 writes, 1 skipped"));
+    std::string content;
+    ASSERT_TRUE(ReadFileToString(std::string(mDir.path) + "/lcd-backlight/brightness", &content));
+    EXPECT_EQ("", content);
+}
+
+TEST_F(LightsTest, RejectsUnsupportedStates) {
+    addLed("lcd-backlight");
+    start();
+    HwLightState lowPersistence = solid(0xffffffff);
+    lowPersistence.brightnessMode = BrightnessMode::LOW_PERSISTENCE;
+
+    EXPECT_EQ(EX_UNSUPPORTED_OPERATION,
+              mLights->setLightState(0, lowPersistence).getExceptionCode());
+    EXPECT_EQ(EX_UNSUPPORTED_OPERATION,
+              mLights->setLightState(1, solid(0xffffffff)).getExceptionCode());
+    EXPECT_EQ(EX_UNSUPPORTED_OPERATION,
+              mLights->setLightState(-1, solid(0xffffffff)).getExceptionCode());
+    EXPECT_NE(std::string::npos, dump().find("1 lights, 0 requests"));
+}
+
+TEST(LightsWithoutLedsTest, ReportsNoLights) {
+    auto lights = ndk::SharedRefBase::make<Lights>("/nonexistent");
+    std::vector<HwLight> found;
+
+    ASSERT_TRUE(lights->getLights(&found).isOk());
+
+    EXPECT_TRUE(found.empty());
+}
+
+}  // namespace
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DmabufIndex.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace memtrack {
+
+namespace {
+
+// How many updates may pass before the processes that exited are dropped from the index.
+constexpr uint32_t kPruneInterval = 64;
+
+bool isDmabufLink(const std::string& target) {
+    // Named buffers show up as /dmabuf:<name>, older kernels use an anonymous inode.
+    return ::android::base::StartsWith(target, "/dmabuf:") || target == "anon_inode:dmabuf";
+}
+
+}  // namespace
+
+DmabufIndex::DmabufIndex(std::string procRoot, std::string dmabufSysfsRoot)
+    : mProcRoot(std::move(procRoot)), mDmabufSysfsRoot(std::move(dmabufSysfsRoot)) {}
+
+bool DmabufIndex::scanFds(pid_t pid, Process* process,
+                          std::unordered_map<ino_t, uint64_t>* buffers) {
+    const std::string fdDir = ::android::base::StringPrintf("%s/%d/fd", mProcRoot.c_str(), pid);
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(fdDir.c_str()), closedir);
+    if (dir == nullptr) {
+        return false;
+    }
+
+    std::unordered_map<int, FdEntry> fds;
+    while (dirent* entry = readdir(dir.get())) {
+        int fd;
+        if (!::android::base::ParseInt(entry->d_name, &fd)) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(dirfd(dir.get()), entry->d_name, &st, 0) != 0) {
+            continue;  // Closed while scanning.
+        }
+
+        FdEntry fdEntry{.inode = st.st_ino};
+        auto cached = process->fds.find(fd);
+        if (cached != process->fds.end() && cached->second.inode == st.st_ino) {
+            // Still the same file, no need to look at the link target again.
+            fdEntry = cached->second;
+        } else {
+            std::string target;
+            fdEntry.isDmabuf = ::android::base::Readlink(fdDir + "/" + entry->d_name, &target) &&
+                               isDmabufLink(target);
+            // The inode of a DMA-BUF has the size of the buffer.
+            fdEntry.size = fdEntry.isDmabuf ? static_cast<uint64_t>(st.st_size) : 0;
+        }
+        if (fdEntry.isDmabuf) {
+            buffers->emplace(fdEntry.inode, fdEntry.size);
+        }
+        fds.emplace(fd, fdEntry);
+    }
+    process->fds = std::move(fds);
+    return true;
+}
+
+void DmabufIndex::scanMaps(pid_t pid, std::unordered_map<ino_t, uint64_t>* buffers) {
+    std::string maps;
+    if (!::android::base::ReadFileToString(
+                ::android::base::StringPrintf("%s/%d/maps", mProcRoot.c_str(), pid), &maps)) {
+        return;
+    }
+    for (const auto& line : ::android::base::Split(maps, "\n")) {
+        // address perms offset dev inode path
+        if (line.find("/dmabuf") == std::string::npos) {
+            continue;
+        }
+        std::vector<std::string> fields = ::android::base::Tokenize(line, " ");
+        ino_t inode;
+        if (fields.size() >= 6 && isDmabufLink(fields[5]) &&
+            ::android::base::ParseUint(fields[4], &inode)) {
+            buffers->emplace(inode, 0);
+        }
+    }
+}
+
+void DmabufIndex::addBuffer(ino_t inode, uint64_t size) {
+    Buffer& buffer = mBuffers[inode];
+    buffer.processCount++;
+    if (buffer.size != 0) {
+        return;
+    }
+    if (size == 0) {
+        // Only mapped, so the size comes from the DMA-BUF sysfs stats, if the kernel has them.
+        std::string sizeString;
+        ::android::base::ReadFileToString(
+                ::android::base::StringPrintf("%s/%llu/size", mDmabufSysfsRoot.c_str(),
+                                              static_cast<unsigned long long>(inode)),
+                &sizeString);
+        ::android::base::ParseUint(::android::base::Trim(sizeString), &size);
+    }
+    buffer.size = size;
+}
+
+void DmabufIndex::removeBuffer(ino_t inode) {
+    auto it = mBuffers.find(inode);
+    if (it != mBuffers.end() && --it->second.processCount == 0) {
+        mBuffers.erase(it);
+    }
+}
+
+void DmabufIndex::removeProcess(pid_t pid) {
+    auto it = mProcesses.find(pid);
+    if (it == mProcesses.end()) {
+        return;
+    }
+    for (ino_t inode : it->second.buffers) {
+        removeBuffer(inode);
+    }
+    mProcesses.erase(it);
+}
+
+void DmabufIndex::pruneExitedProcesses() {
+    std::vector<pid_t> exited;
+    for (const auto& entry : mProcesses) {
+        const std::string path =
+                ::android::base::StringPrintf("%s/%d", mProcRoot.c_str(), entry.first);
+        if (access(path.c_str(), F_OK) != 0) {
+            exited.push_back(entry.first);
+        }
+    }
+    for (pid_t pid : exited) {
+        removeProcess(pid);
+    }
+}
+
+std::optional<uint64_t> DmabufIndex::updateAndGetPss(pid_t pid) {
+    if (++mUpdatesSincePrune >= kPruneInterval) {
+        mUpdatesSincePrune = 0;
+        pruneExitedProcesses();
+    }
+
+    Process& process = mProcesses[pid];
+    std::unordered_map<ino_t, uint64_t> buffers;
+    if (!scanFds(pid, &process, &buffers)) {
+        removeProcess(pid);
+        return std::nullopt;
+    }
+    scanMaps(pid, &buffers);
+
+    // Only the buffers that were added or dropped since the last update change the index.
+    for (auto it = process.buffers.begin(); it != process.buffers.end();) {
+        if (buffers.count(*it) == 0) {
+            removeBuffer(*it);
+            it = process.buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const auto& [inode, size] : buffers) {
+        if (process.buffers.insert(inode).second) {
+            addBuffer(inode, size);
+        }
+    }
+
+    uint64_t pss = 0;
+    for (ino_t inode : process.buffers) {
+        const Buffer& buffer = mBuffers[inode];
+        pss += buffer.size / buffer.processCount;
+    }
+    return pss;
+}
+
+uint64_t DmabufIndex::getTotalSize() const {
+    uint64_t total = 0;
+    for (const auto& entry : mBuffers) {
+        total += entry.second.size;
+    }
+    return total;
+}
+
+}  // namespace memtrack
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
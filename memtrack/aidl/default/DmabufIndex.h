@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace memtrack {
+
+// Tracks the DMA-BUFs each process holds through its fds or maps into its address space, and
+// how many processes share each of them, so the proportional share of a process can be
+// computed by scanning only that process. Entries of other processes are kept from their last
+// update, which is current enough when callers like dumpsys meminfo walk every process in turn.
+// Not thread safe.
+class DmabufIndex {
+  public:
+    explicit DmabufIndex(std::string procRoot = "/proc",
+                         std::string dmabufSysfsRoot = "/sys/kernel/dmabuf/buffers");
+
+    // Rescans the fds and mappings of pid, updates the index with the changes and returns the
+    // proportional set size of the DMA-BUFs of pid in bytes, or nullopt if the process can't
+    // be read, e.g. because it has exited.
+    std::optional<uint64_t> updateAndGetPss(pid_t pid);
+
+    // Total size of the DMA-BUFs held by all the processes in the index, in bytes.
+    uint64_t getTotalSize() const;
+
+    size_t getProcessCount() const { return mProcesses.size(); }
+
+  private:
+    struct FdEntry {
+        ino_t inode = 0;
+        bool isDmabuf = false;
+        uint64_t size = 0;
+    };
+
+    struct Process {
+        // The fds that were open at the last update, so only new or reused fds are classified.
+        std::unordered_map<int, FdEntry> fds;
+        std::unordered_set<ino_t> buffers;
+    };
+
+    struct Buffer {
+        uint64_t size = 0;
+        uint32_t processCount = 0;
+    };
+
+    // Maps the inodes of the DMA-BUFs pid holds through fds to their sizes, updating the cached
+    // fds of process. Returns false if the fds of pid can't be read.
+    bool scanFds(pid_t pid, Process* process, std::unordered_map<ino_t, uint64_t>* buffers);
+    // Adds the inodes of the DMA-BUFs mapped by pid to buffers, with an unknown size.
+    void scanMaps(pid_t pid, std::unordered_map<ino_t, uint64_t>* buffers);
+    // Adds a reference to a buffer, reading its size from sysfs if size is 0.
+    void addBuffer(ino_t inode, uint64_t size);
+    void removeBuffer(ino_t inode);
+    void removeProcess(pid_t pid);
+    // Drops the processes that have exited since they were last updated.
+    void pruneExitedProcesses();
+
+    const std::string mProcRoot;
+    const std::string mDmabufSysfsRoot;
+    std::unordered_map<pid_t, Process> mProcesses;
+    std::unordered_map<ino_t, Buffer> mBuffers;
+    uint32_t mUpdatesSincePrune = 0;
+};
+
+}  // namespace memtrack
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
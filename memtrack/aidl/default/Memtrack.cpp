@@ -16,11 +16,52 @@
 
 #include "Memtrack.h"
 
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <memory>
+
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace memtrack {
 
+namespace {
+
+constexpr char kDrmClassRoot[] = "/sys/class/drm";
+
+// Returns the name of the driver of each DRM card, e.g. card0, in the order of their minor.
+std::vector<std::string> getDrmDriverNames() {
+    std::vector<std::string> cards;
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(kDrmClassRoot), closedir);
+    if (dir == nullptr) {
+        return {};
+    }
+    while (dirent* entry = readdir(dir.get())) {
+        std::string name = entry->d_name;
+        // Skip render nodes and connectors like card0-HDMI-A-1.
+        if (::android::base::StartsWith(name, "card") &&
+            name.find('-') == std::string::npos) {
+            cards.push_back(std::move(name));
+        }
+    }
+    std::sort(cards.begin(), cards.end());
+
+    std::vector<std::string> drivers;
+    for (const auto& card : cards) {
+        std::string driver;
+        if (::android::base::Readlink(
+                    std::string(kDrmClassRoot) + "/" + card + "/device/driver", &driver)) {
+            drivers.push_back(::android::base::Basename(driver));
+        }
+    }
+    return drivers;
+}
+
+}  // namespace
+
 ndk::ScopedAStatus Memtrack::getMemory(int pid, MemtrackType type,
                                        std::vector<MemtrackRecord>* _aidl_return) {
     if (pid < 0) {
@@ -31,13 +72,29 @@ ndk::ScopedAStatus Memtrack::getMemory(int pid, MemtrackType type,
         return ndk::ScopedAStatus(AStatus_fromExceptionCode(EX_UNSUPPORTED_OPERATION));
     }
     _aidl_return->clear();
+    // Only the DMA-BUFs of a process are reported, as GRAPHICS memory not accounted in its
+    // smaps. GPU private memory has no driver independent source, and PID 0 reports nothing.
+    if (type != MemtrackType::GRAPHICS || pid == 0) {
+        return ndk::ScopedAStatus::ok();
+    }
+    std::optional<uint64_t> pss = mDmabufIndex.updateAndGetPss(pid);
+    if (pss.has_value()) {
+        _aidl_return->push_back({.flags = MemtrackRecord::FLAG_SMAPS_UNACCOUNTED,
+                                 .sizeInBytes = static_cast<int64_t>(*pss)});
+    }
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Memtrack::getGpuDeviceInfo(std::vector<DeviceInfo>* _aidl_return) {
     _aidl_return->clear();
-    DeviceInfo dev_info = {.id = 0, .name = "virtio_gpu"};
-    _aidl_return->emplace_back(dev_info);
+    std::vector<std::string> drivers = getDrmDriverNames();
+    if (drivers.empty()) {
+        // The emulated GPU of virtual devices.
+        drivers.push_back("virtio_gpu");
+    }
+    for (size_t i = 0; i < drivers.size(); i++) {
+        _aidl_return->push_back({.id = static_cast<int32_t>(i), .name = drivers[i]});
+    }
     return ndk::ScopedAStatus::ok();
 }
 
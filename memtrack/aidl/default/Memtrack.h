@@ -21,6 +21,8 @@
 #include <aidl/android/hardware/memtrack/MemtrackRecord.h>
 #include <aidl/android/hardware/memtrack/MemtrackType.h>
 
+#include "DmabufIndex.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -31,6 +33,9 @@ class Memtrack : public BnMemtrack {
                                  std::vector<MemtrackRecord>* _aidl_return) override;
 
     ndk::ScopedAStatus getGpuDeviceInfo(std::vector<DeviceInfo>* _aidl_return) override;
+
+    // The service has a single binder thread, so the index is not locked.
+    DmabufIndex mDmabufIndex;
 };
 
 }  // namespace memtrack
@@ -167,7 +167,9 @@ class RequestChannelReceiver final {
      * @param requestChannel Descriptor for the request channel.
      * @param pollingTimeWindow How much time (in microseconds) the RequestChannelReceiver is
      *     allowed to poll the FMQ before waiting on the blocking futex. Polling may result in lower
-     *     latencies at the potential cost of more power usage.
+     *     latencies at the potential cost of more power usage. The receiver polls for less time
+     *     when requests recently arrived well within the window, and not at all while they take
+     *     longer than the window.
      * @return RequestChannelReceiver on successful creation, nullptr otherwise.
      */
     static nn::GeneralResult<std::unique_ptr<RequestChannelReceiver>> create(
@@ -202,6 +204,8 @@ class RequestChannelReceiver final {
     MessageQueue<FmqRequestDatum, kSynchronizedReadWrite> mFmqRequestChannel;
     std::atomic<bool> mTeardown{false};
     const std::chrono::microseconds kPollingTimeWindow;
+    // How long the previous call to getPacketBlocking waited, used to adapt the polling time.
+    std::chrono::nanoseconds mLastWaitTime = kPollingTimeWindow;
 };
 
 /**
@@ -258,7 +262,9 @@ class ResultChannelReceiver final : public neuralnetworks::utils::IProtectedCall
      * @param channelLength Number of elements in the FMQ.
      * @param pollingTimeWindow How much time (in microseconds) the ResultChannelReceiver is allowed
      *     to poll the FMQ before waiting on the blocking futex. Polling may result in lower
-     *     latencies at the potential cost of more power usage.
+     *     latencies at the potential cost of more power usage. The receiver polls for less time
+     *     when results recently arrived well within the window, and not at all while they take
+     *     longer than the window.
      * @return A pair of ResultChannelReceiver and the FMQ descriptor on successful creation, or
      *     GeneralError otherwise.
      */
@@ -273,6 +279,8 @@ class ResultChannelReceiver final : public neuralnetworks::utils::IProtectedCall
      * 1) The packet has been retrieved, or
      * 2) The receiver has been invalidated
      *
+     * Only one packet is read even if more are already queued. Must not be called concurrently.
+     *
      * @return Result object if successfully received, otherwise an appropriate message if error or
      *     if the receiver object was invalidated.
      */
@@ -294,6 +302,8 @@ class ResultChannelReceiver final : public neuralnetworks::utils::IProtectedCall
     MessageQueue<FmqResultDatum, kSynchronizedReadWrite> mFmqResultChannel;
     std::atomic<bool> mValid{true};
     const std::chrono::microseconds kPollingTimeWindow;
+    // How long the previous call to getPacketBlocking waited, used to adapt the polling time.
+    std::chrono::nanoseconds mLastWaitTime = kPollingTimeWindow;
 };
 
 }  // namespace android::hardware::neuralnetworks::V1_2::utils
@@ -27,8 +27,10 @@
 #include <nnapi/Types.h>
 #include <nnapi/hal/1.0/ProtectCallback.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstring>
 #include <memory>
 #include <thread>
 #include <tuple>
@@ -54,6 +56,77 @@ std::chrono::microseconds getPollingTimeWindow(const std::string& property) {
 #endif  // NN_DEBUGGABLE
 }
 
+// Returns how long a receiver should poll before waiting on the futex, given how long it waited for
+// the previous packet. Polling stops after twice the previous wait (but at least
+// kMinAdaptivePollingTime) so that a receiver whose packets usually arrive quickly does not spin
+// for the whole window when one is late, and is skipped entirely while packets take longer than the
+// window to arrive.
+std::chrono::nanoseconds getAdaptivePollingTime(std::chrono::microseconds pollingTimeWindow,
+                                                std::chrono::nanoseconds lastWaitTime) {
+    constexpr std::chrono::nanoseconds kMinAdaptivePollingTime = std::chrono::microseconds(20);
+    if (lastWaitTime > pollingTimeWindow) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::min<std::chrono::nanoseconds>(
+            pollingTimeWindow, std::max(2 * lastWaitTime, kMinAdaptivePollingTime));
+}
+
+void relaxCpu() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Polls the FMQ until data is available, `isValid` returns false, or `pollingTime` has elapsed.
+// The first iterations busy wait, which has the lowest wake-up latency, longer waits yield the CPU
+// to other threads.
+template <typename Datum, typename IsValid>
+void pollForData(const MessageQueue<Datum, kSynchronizedReadWrite>& fmq,
+                 std::chrono::nanoseconds pollingTime, const IsValid& isValid) {
+    constexpr size_t kBusyPollCount = 64;
+    auto& getCurrentTime = std::chrono::high_resolution_clock::now;
+    const auto timeToStopPolling = getCurrentTime() + pollingTime;
+    for (size_t i = 0; getCurrentTime() < timeToStopPolling; ++i) {
+        if (!isValid() || fmq.availableToRead() > 0) {
+            return;
+        }
+        if (i < kBusyPollCount) {
+            relaxCpu();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Reads the rest of the packet starting with `first` from the FMQ.
+//
+// NOTE: all of the data is already available at this point, so there's no need to do a blocking
+// wait to wait for more data. This is known because in FMQ, all writes are published (made
+// available) atomically. Currently, the producer always publishes the entire packet in one function
+// call, so if the first element of the packet is available, the remaining elements are also
+// available. Only the elements of this packet are read, the FMQ may already hold the next packet of
+// a pipelined burst. If the packet size is not readable, everything that is available is read and
+// deserialization reports the malformed packet.
+template <typename Datum>
+bool readRestOfPacket(MessageQueue<Datum, kSynchronizedReadWrite>* fmq, const Datum& first,
+                      std::vector<Datum>* packet) {
+    const size_t available = fmq->availableToRead();
+    size_t count = available;
+    if (first.getDiscriminator() == Datum::hidl_discriminator::packetInformation) {
+        const size_t packetSize = first.packetInformation().packetSize;
+        if (packetSize > 0 && packetSize - 1 <= available) {
+            count = packetSize - 1;
+        }
+    }
+    packet->resize(count + 1);
+    std::memcpy(&packet->front(), &first, sizeof(first));
+    // readBlocking returns immediately because the data is available, and unlike read it wakes up a
+    // producer waiting for space in the FMQ.
+    return count == 0 || fmq->readBlocking(packet->data() + 1, count);
+}
+
 }  // namespace
 
 std::chrono::microseconds getBurstControllerPollingTimeWindow() {
@@ -508,47 +581,28 @@ nn::Result<std::vector<FmqRequestDatum>> RequestChannelReceiver::getPacketBlocki
     // First spend time polling if results are available in FMQ instead of waiting on the futex.
     // Polling is more responsive (yielding lower latencies), but can take up more power, so only
     // poll for a limited period of time.
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    const auto isValid = [this] { return !mTeardown.load(std::memory_order_relaxed); };
+    pollForData(mFmqRequestChannel, getAdaptivePollingTime(kPollingTimeWindow, mLastWaitTime),
+                isValid);
 
-    auto& getCurrentTime = std::chrono::high_resolution_clock::now;
-    const auto timeToStopPolling = getCurrentTime() + kPollingTimeWindow;
-
-    while (getCurrentTime() < timeToStopPolling) {
-        // if class is being torn down, immediately return
-        if (mTeardown.load(std::memory_order_relaxed)) {
-            return NN_ERROR() << "FMQ object is being torn down";
-        }
-
-        // Check if data is available. If it is, immediately retrieve it and return.
-        const size_t available = mFmqRequestChannel.availableToRead();
-        if (available > 0) {
-            std::vector<FmqRequestDatum> packet(available);
-            const bool success = mFmqRequestChannel.readBlocking(packet.data(), available);
-            if (!success) {
-                return NN_ERROR() << "Error receiving packet";
-            }
-            return packet;
-        }
-
-        std::this_thread::yield();
+    // if class is being torn down, immediately return
+    if (mTeardown) {
+        return NN_ERROR() << "FMQ object is being torn down";
     }
 
-    // If we get to this point, we either stopped polling because it was taking too long or polling
-    // was not allowed. Instead, perform a blocking call which uses a futex to save power.
+    // If no data is available at this point, we either stopped polling because it was taking too
+    // long or polling was not allowed. Instead, perform a blocking call which uses a futex to save
+    // power.
 
     // wait for request packet and read first element of request packet
     FmqRequestDatum datum;
     bool success = mFmqRequestChannel.readBlocking(&datum, 1);
+    mLastWaitTime = std::chrono::high_resolution_clock::now() - startTime;
 
     // retrieve remaining elements
-    // NOTE: all of the data is already available at this point, so there's no need to do a blocking
-    // wait to wait for more data. This is known because in FMQ, all writes are published (made
-    // available) atomically. Currently, the producer always publishes the entire packet in one
-    // function call, so if the first element of the packet is available, the remaining elements are
-    // also available.
-    const size_t count = mFmqRequestChannel.availableToRead();
-    std::vector<FmqRequestDatum> packet(count + 1);
-    std::memcpy(&packet.front(), &datum, sizeof(datum));
-    success &= mFmqRequestChannel.read(packet.data() + 1, count);
+    std::vector<FmqRequestDatum> packet;
+    success = success && readRestOfPacket(&mFmqRequestChannel, datum, &packet);
 
     // terminate loop
     if (mTeardown) {
@@ -655,47 +709,28 @@ nn::Result<std::vector<FmqResultDatum>> ResultChannelReceiver::getPacketBlocking
     // First spend time polling if results are available in FMQ instead of waiting on the futex.
     // Polling is more responsive (yielding lower latencies), but can take up more power, so only
     // poll for a limited period of time.
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    const auto isValid = [this] { return mValid.load(std::memory_order_relaxed); };
+    pollForData(mFmqResultChannel, getAdaptivePollingTime(kPollingTimeWindow, mLastWaitTime),
+                isValid);
 
-    auto& getCurrentTime = std::chrono::high_resolution_clock::now;
-    const auto timeToStopPolling = getCurrentTime() + kPollingTimeWindow;
-
-    while (getCurrentTime() < timeToStopPolling) {
-        // if class is being torn down, immediately return
-        if (!mValid.load(std::memory_order_relaxed)) {
-            return NN_ERROR() << "FMQ object is invalid";
-        }
-
-        // Check if data is available. If it is, immediately retrieve it and return.
-        const size_t available = mFmqResultChannel.availableToRead();
-        if (available > 0) {
-            std::vector<FmqResultDatum> packet(available);
-            const bool success = mFmqResultChannel.readBlocking(packet.data(), available);
-            if (!success) {
-                return NN_ERROR() << "Error receiving packet";
-            }
-            return packet;
-        }
-
-        std::this_thread::yield();
+    // if class is being torn down, immediately return
+    if (!mValid) {
+        return NN_ERROR() << "FMQ object is invalid";
     }
 
-    // If we get to this point, we either stopped polling because it was taking too long or polling
-    // was not allowed. Instead, perform a blocking call which uses a futex to save power.
+    // If no data is available at this point, we either stopped polling because it was taking too
+    // long or polling was not allowed. Instead, perform a blocking call which uses a futex to save
+    // power.
 
     // wait for result packet and read first element of result packet
     FmqResultDatum datum;
     bool success = mFmqResultChannel.readBlocking(&datum, 1);
+    mLastWaitTime = std::chrono::high_resolution_clock::now() - startTime;
 
     // retrieve remaining elements
-    // NOTE: all of the data is already available at this point, so there's no need to do a blocking
-    // wait to wait for more data. This is known because in FMQ, all writes are published (made
-    // available) atomically. Currently, the producer always publishes the entire packet in one
-    // function call, so if the first element of the packet is available, the remaining elements are
-    // also available.
-    const size_t count = mFmqResultChannel.availableToRead();
-    std::vector<FmqResultDatum> packet(count + 1);
-    std::memcpy(&packet.front(), &datum, sizeof(datum));
-    success &= mFmqResultChannel.read(packet.data() + 1, count);
+    std::vector<FmqResultDatum> packet;
+    success = success && readRestOfPacket(&mFmqResultChannel, datum, &packet);
 
     if (!mValid) {
         return NN_ERROR() << "FMQ object is invalid";
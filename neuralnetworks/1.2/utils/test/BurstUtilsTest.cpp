@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <nnapi/hal/1.2/BurstUtils.h>
+
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::V1_2::utils {
+namespace {
+
+constexpr size_t kChannelLength = 1024;
+constexpr auto kPollingTimeWindow = std::chrono::microseconds(50);
+constexpr auto kNoTiming = V1_2::Timing{.timeOnDevice = std::numeric_limits<uint64_t>::max(),
+                                        .timeInDriver = std::numeric_limits<uint64_t>::max()};
+
+TEST(BurstUtilsTest, resultChannelReadsOnePacketAtATime) {
+    // setup test
+    auto [receiver, descriptor] =
+            ResultChannelReceiver::create(kChannelLength, kPollingTimeWindow).value();
+    const auto sender = ResultChannelSender::create(*descriptor).value();
+    const std::vector<V1_2::OutputShape> outputShapes = {
+            {.dimensions = {1, 2}, .isSufficient = true}};
+    const auto timing = V1_2::Timing{.timeOnDevice = 1, .timeInDriver = 2};
+
+    // run test
+    sender->send(V1_0::ErrorStatus::NONE, outputShapes, timing);
+    sender->send(V1_0::ErrorStatus::OUTPUT_INSUFFICIENT_SIZE, {}, kNoTiming);
+    const auto first = receiver->getBlocking();
+    const auto second = receiver->getBlocking();
+
+    // verify result
+    ASSERT_TRUE(first.has_value()) << first.error();
+    EXPECT_EQ(std::get<0>(first.value()), V1_0::ErrorStatus::NONE);
+    EXPECT_EQ(std::get<1>(first.value()), outputShapes);
+    EXPECT_EQ(std::get<2>(first.value()), timing);
+    ASSERT_TRUE(second.has_value()) << second.error();
+    EXPECT_EQ(std::get<0>(second.value()), V1_0::ErrorStatus::OUTPUT_INSUFFICIENT_SIZE);
+    EXPECT_TRUE(std::get<1>(second.value()).empty());
+}
+
+TEST(BurstUtilsTest, requestChannelReadsOnePacketAtATime) {
+    // setup test
+    auto [sender, descriptor] = RequestChannelSender::create(kChannelLength).value();
+    const auto receiver = RequestChannelReceiver::create(*descriptor, kPollingTimeWindow).value();
+
+    // run test
+    ASSERT_TRUE(sender->send({}, V1_2::MeasureTiming::YES, {1, 2}).has_value());
+    ASSERT_TRUE(sender->send({}, V1_2::MeasureTiming::NO, {3}).has_value());
+    const auto first = receiver->getBlocking();
+    const auto second = receiver->getBlocking();
+
+    // verify result
+    ASSERT_TRUE(first.has_value()) << first.error();
+    EXPECT_EQ(std::get<1>(first.value()), std::vector<int32_t>({1, 2}));
+    EXPECT_EQ(std::get<2>(first.value()), V1_2::MeasureTiming::YES);
+    ASSERT_TRUE(second.has_value()) << second.error();
+    EXPECT_EQ(std::get<1>(second.value()), std::vector<int32_t>({3}));
+    EXPECT_EQ(std::get<2>(second.value()), V1_2::MeasureTiming::NO);
+}
+
+TEST(BurstUtilsTest, resultChannelWaitsForLateResult) {
+    // setup test
+    auto [receiver, descriptor] =
+            ResultChannelReceiver::create(kChannelLength, kPollingTimeWindow).value();
+    const auto sender = ResultChannelSender::create(*descriptor).value();
+
+    // run test
+    // Later than the polling time window, so that the receiver waits on the futex.
+    std::thread lateSender([&sender = sender] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        sender->send(V1_0::ErrorStatus::NONE, {}, kNoTiming);
+    });
+    const auto result = receiver->getBlocking();
+    lateSender.join();
+
+    // verify result
+    ASSERT_TRUE(result.has_value()) << result.error();
+    EXPECT_EQ(std::get<0>(result.value()), V1_0::ErrorStatus::NONE);
+}
+
+TEST(BurstUtilsTest, resultChannelUnblocksWhenDead) {
+    // setup test
+    auto [receiver, descriptor] =
+            ResultChannelReceiver::create(kChannelLength, kPollingTimeWindow).value();
+
+    // run test
+    std::thread notifier([&receiver = receiver] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        receiver->notifyAsDeadObject();
+    });
+    const auto result = receiver->getBlocking();
+    notifier.join();
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+}  // namespace
+}  // namespace android::hardware::neuralnetworks::V1_2::utils
@@ -20,11 +20,13 @@
 #include <android-base/macros.h>
 #include <android-base/thread_annotations.h>
 
+#include <array>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <queue>
 #include <set>
-#include <stack>
 #include <utility>
 #include <vector>
 
@@ -97,21 +99,50 @@ class AidlBufferTracker : public std::enable_shared_from_this<AidlBufferTracker>
     }
 
     // Prefer AidlBufferTracker::create.
-    AidlBufferTracker() : mTokenToBuffers(1) {}
+    AidlBufferTracker() = default;
+    ~AidlBufferTracker();
 
+    // Returns nullptr if the buffer is nullptr or all kMaxSlots tokens are in use.
     std::unique_ptr<Token> add(std::shared_ptr<AidlManagedBuffer> buffer);
+    // Lock-free, so that resolving the tokens of concurrent executions does not serialize them.
+    // Returns nullptr for a token that is unknown or was freed.
     std::shared_ptr<AidlManagedBuffer> get(uint32_t token) const;
 
   private:
-    void free(uint32_t token);
-
-    mutable std::mutex mMutex;
-    std::stack<uint32_t, std::vector<uint32_t>> mFreeTokens GUARDED_BY(mMutex);
+    // A token is the index of its slot in the low kSlotBits bits, tagged with the generation of
+    // the slot in the bits above, up to bit 30 since tokens are positive int32_t in the HAL. The
+    // generation is never 0, so neither is the token, and it changes whenever the slot is
+    // reused, so that stale tokens are detected until the generation wraps around.
+    static constexpr uint32_t kSlotBits = 16;
+    static constexpr uint32_t kMaxSlots = 1u << kSlotBits;
+    static constexpr uint32_t kMaxGeneration = (1u << (31 - kSlotBits)) - 1;
+    static constexpr uint32_t kSlotsPerChunk = 256;
+    static constexpr uint32_t kMaxChunks = kMaxSlots / kSlotsPerChunk;
+
+    struct Slot {
+        // The token of the buffer in the slot, 0 while the slot is free.
+        std::atomic<uint32_t> token = 0;
+        // The number of get calls reading the slot, which free waits out before releasing buffer.
+        std::atomic<uint32_t> readers = 0;
+        // Only written while token is 0 and, when releasing it, while there are no readers.
+        std::shared_ptr<AidlManagedBuffer> buffer;
+        uint32_t generation = 0;
+    };
+    using Chunk = std::array<Slot, kSlotsPerChunk>;
 
-    // Since the tokens are allocated in a non-sparse way, we use a vector to represent the mapping.
-    // The index of the vector is the token. When the token gets freed, the corresponding entry is
-    // set to nullptr. mTokenToBuffers[0] is always set to nullptr because 0 is an invalid token.
-    std::vector<std::shared_ptr<AidlManagedBuffer>> mTokenToBuffers GUARDED_BY(mMutex);
+    void free(uint32_t token);
+    // Returns nullptr if the chunk of the slot is not allocated.
+    Slot* getSlot(uint32_t slot) const;
+
+    // Slots are allocated in chunks that never move, so that get can read them without locking.
+    // Chunks are only added under mMutex and freed with the tracker.
+    std::array<std::atomic<Chunk*>, kMaxChunks> mChunks = {};
+
+    // Serializes add and free.
+    std::mutex mMutex;
+    // Freed slots are reused oldest first, so that their generation changes as rarely as possible.
+    std::queue<uint32_t> mFreeSlots GUARDED_BY(mMutex);
+    uint32_t mNextSlot GUARDED_BY(mMutex) = 0;
 };
 
 }  // namespace android::nn
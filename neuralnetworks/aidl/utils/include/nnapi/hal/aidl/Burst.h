@@ -26,11 +26,13 @@
 #include <nnapi/hal/CommonUtils.h>
 
 #include <atomic>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 // See hardware/interfaces/neuralnetworks/utils/README.md for more information on AIDL interface
 // lifetimes across processes and for protecting asynchronous calls across AIDL.
@@ -42,9 +44,24 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
     struct PrivateConstructorTag {};
 
   public:
+    /**
+     * Default number of bytes of memory objects a burst keeps cached after the executions that
+     * used them, see MemoryCache::getOrRetainMemory.
+     */
+    static constexpr size_t kDefaultRetainedMemoryBudget = 16 * 1024 * 1024;
+
+    /**
+     * Most memory objects a burst keeps cached after the executions that used them, whatever
+     * their size. Each of them holds a mapping in the driver.
+     */
+    static constexpr size_t kMaxRetainedMemories = 64;
+
     /**
      * Thread-safe, self-cleaning cache that relates an nn::Memory object to a unique int64_t
      * identifier.
+     *
+     * The identifiers are scoped to the aidl_hal::IBurst object, so the cache cannot be shared
+     * with other bursts.
      */
     class MemoryCache : public std::enable_shared_from_this<MemoryCache> {
       public:
@@ -53,7 +70,16 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
         using SharedCleanup = std::shared_ptr<const Cleanup>;
         using WeakCleanup = std::weak_ptr<const Cleanup>;
 
-        explicit MemoryCache(std::shared_ptr<aidl_hal::IBurst> burst);
+        /**
+         * Counters of the lookups made through MemoryCache::getOrRetainMemory.
+         */
+        struct Statistics {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+        };
+
+        MemoryCache(std::shared_ptr<aidl_hal::IBurst> burst, size_t retainedMemoryBudget);
 
         /**
          * Get or cache a memory object in the MemoryCache object.
@@ -76,22 +102,65 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
         std::optional<std::pair<int64_t, SharedCleanup>> getMemoryIfAvailable(
                 const nn::SharedMemory& memory);
 
+        /**
+         * Get the cache entry of a memory object used by an execution.
+         *
+         * Unlike MemoryCache::getMemoryIfAvailable, a memory object that is not cached yet is
+         * cached, and the cache keeps its own hold on the entry so that later executions using the
+         * same memory object do not send it to the driver again. The held memory objects are
+         * limited to the retained memory budget in bytes and to kMaxRetainedMemories, the least
+         * recently used ones are released first.
+         *
+         * @param memory Memory object used by the execution.
+         * @return A pair of (1) a unique identifier for the cache entry and (2) a ref-counted
+         *     "hold" object which preserves the cache as long as the hold object is alive. If the
+         *     memory object is not cached and is larger than the budget, std::nullopt is returned
+         *     instead.
+         */
+        std::optional<std::pair<int64_t, SharedCleanup>> getOrRetainMemory(
+                const nn::SharedMemory& memory);
+
+        Statistics getStatistics();
+
       private:
+        struct RetainedMemory {
+            nn::SharedMemory memory;
+            SharedCleanup hold;
+            // The bytes it counts against the budget
+            size_t size;
+        };
+        using RetainedList = std::list<RetainedMemory>;
+
+        std::pair<int64_t, SharedCleanup> getOrCacheMemoryLocked(const nn::SharedMemory& memory)
+                REQUIRES(mMutex);
+        std::optional<std::pair<int64_t, SharedCleanup>> getMemoryIfAvailableLocked(
+                const nn::SharedMemory& memory) REQUIRES(mMutex);
         void tryFreeMemory(const nn::SharedMemory& memory, int64_t identifier);
 
         const std::shared_ptr<aidl_hal::IBurst> kBurst;
+        const size_t kRetainedMemoryBudget;
         std::mutex mMutex;
         int64_t mUnusedIdentifier GUARDED_BY(mMutex) = 0;
         std::unordered_map<nn::SharedMemory, std::pair<int64_t, WeakCleanup>> mCache
                 GUARDED_BY(mMutex);
+        // Holds kept by getOrRetainMemory, most recently used first.
+        RetainedList mRetained GUARDED_BY(mMutex);
+        std::unordered_map<nn::SharedMemory, RetainedList::iterator> mRetainedIndex
+                GUARDED_BY(mMutex);
+        size_t mRetainedBytes GUARDED_BY(mMutex) = 0;
+        Statistics mStatistics GUARDED_BY(mMutex);
     };
 
     // featureLevel is for testing purposes.
     static nn::GeneralResult<std::shared_ptr<const Burst>> create(
-            std::shared_ptr<aidl_hal::IBurst> burst, nn::Version featureLevel);
+            std::shared_ptr<aidl_hal::IBurst> burst, nn::Version featureLevel,
+            size_t retainedMemoryBudget = kDefaultRetainedMemoryBudget);
 
     Burst(PrivateConstructorTag tag, std::shared_ptr<aidl_hal::IBurst> burst,
-          nn::Version featureLevel);
+          nn::Version featureLevel, size_t retainedMemoryBudget);
+
+    // Counters of the memory cache lookups made by the executions of this burst.
+    MemoryCache::Statistics getMemoryCacheStatistics() const;
 
     // See IBurst::cacheMemory for information.
     OptionalCacheHold cacheMemory(const nn::SharedMemory& memory) const override;
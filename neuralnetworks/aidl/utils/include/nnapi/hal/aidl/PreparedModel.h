@@ -19,12 +19,15 @@
 
 #include <aidl/android/hardware/neuralnetworks/IPreparedModel.h>
 #include <aidl/android/hardware/neuralnetworks/Request.h>
+#include <android-base/thread_annotations.h>
 #include <nnapi/IPreparedModel.h>
 #include <nnapi/Result.h>
+#include <nnapi/SharedMemory.h>
 #include <nnapi/Types.h>
 #include <nnapi/hal/CommonUtils.h>
 
 #include <memory>
+#include <mutex>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -40,6 +43,32 @@ class PreparedModel final : public nn::IPreparedModel,
     struct PrivateConstructorTag {};
 
   public:
+    // Shared memory that execute() copies the pointer arguments of a request into, kept for later
+    // executions instead of creating and mapping new memory each time. Each memory is used by one
+    // execution at a time. A request that fits none of the free memories gets a new one of its
+    // size, so the kept memories grow to the largest requests seen.
+    class StagingMemoryPool {
+      public:
+        struct Memory {
+            nn::SharedMemory memory;
+            nn::Mapping mapping;
+            size_t size;
+        };
+
+        // Returns a mapped memory of at least size bytes.
+        nn::GeneralResult<std::unique_ptr<Memory>> acquire(size_t size);
+
+        // Makes the memory available to later calls to acquire.
+        void release(std::unique_ptr<Memory> memory);
+
+      private:
+        // Enough for a few concurrent executions
+        static constexpr size_t kMaxFreeMemories = 2;
+
+        std::mutex mMutex;
+        std::vector<std::unique_ptr<Memory>> mFreeMemories GUARDED_BY(mMutex);
+    };
+
     // featureLevel is for testing purposes.
     static nn::GeneralResult<std::shared_ptr<const PreparedModel>> create(
             std::shared_ptr<aidl_hal::IPreparedModel> preparedModel, nn::Version featureLevel);
@@ -90,6 +119,7 @@ class PreparedModel final : public nn::IPreparedModel,
   private:
     const std::shared_ptr<aidl_hal::IPreparedModel> kPreparedModel;
     const nn::Version kFeatureLevel;
+    const std::shared_ptr<StagingMemoryPool> kStagingMemoryPool;
 };
 
 }  // namespace aidl::android::hardware::neuralnetworks::utils
@@ -21,10 +21,11 @@
 #include <android-base/macros.h>
 #include <nnapi/TypeUtils.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <set>
-#include <stack>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -187,41 +188,84 @@ void AidlManagedBuffer::setInitialized(bool initialized) {
     mInitialized = initialized;
 }
 
+AidlBufferTracker::~AidlBufferTracker() {
+    for (const auto& chunk : mChunks) {
+        delete chunk.load(std::memory_order_relaxed);
+    }
+}
+
 std::unique_ptr<AidlBufferTracker::Token> AidlBufferTracker::add(
         std::shared_ptr<AidlManagedBuffer> buffer) {
     if (buffer == nullptr) {
         return nullptr;
     }
     std::lock_guard<std::mutex> guard(mMutex);
-    uint32_t token = 0;
-    if (mFreeTokens.empty()) {
-        token = mTokenToBuffers.size();
-        mTokenToBuffers.push_back(std::move(buffer));
+    uint32_t index = 0;
+    if (!mFreeSlots.empty()) {
+        index = mFreeSlots.front();
+        mFreeSlots.pop();
+    } else if (mNextSlot < kMaxSlots) {
+        index = mNextSlot++;
+        auto& chunk = mChunks[index / kSlotsPerChunk];
+        if (chunk.load(std::memory_order_relaxed) == nullptr) {
+            chunk.store(new Chunk(), std::memory_order_release);
+        }
     } else {
-        token = mFreeTokens.top();
-        mFreeTokens.pop();
-        mTokenToBuffers[token] = std::move(buffer);
+        LOG(ERROR) << "AidlBufferTracker::add -- too many buffers";
+        return nullptr;
     }
+
+    // The slot is free, so get does not read its buffer until the store of the token publishes it.
+    Slot& slot = *getSlot(index);
+    slot.generation = slot.generation % kMaxGeneration + 1;
+    slot.buffer = std::move(buffer);
+    const uint32_t token = (slot.generation << kSlotBits) | index;
+    slot.token.store(token, std::memory_order_release);
     VLOG(MEMORY) << "AidlBufferTracker::add -- new token = " << token;
     return std::make_unique<Token>(token, shared_from_this());
 }
 
+AidlBufferTracker::Slot* AidlBufferTracker::getSlot(uint32_t slot) const {
+    Chunk* chunk = mChunks[slot / kSlotsPerChunk].load(std::memory_order_acquire);
+    return chunk != nullptr ? &(*chunk)[slot % kSlotsPerChunk] : nullptr;
+}
+
 std::shared_ptr<AidlManagedBuffer> AidlBufferTracker::get(uint32_t token) const {
-    std::lock_guard<std::mutex> guard(mMutex);
-    if (mTokenToBuffers.size() <= token || mTokenToBuffers[token] == nullptr) {
+    Slot* slot = getSlot(token % kMaxSlots);
+    std::shared_ptr<AidlManagedBuffer> buffer;
+    if (token != 0 && slot != nullptr) {
+        // Registering as a reader before checking the token keeps free from releasing the buffer
+        // while it is copied. Both need to be sequentially consistent, along with the matching
+        // operations in free.
+        slot->readers.fetch_add(1);
+        if (slot->token.load() == token) {
+            buffer = slot->buffer;
+        }
+        slot->readers.fetch_sub(1, std::memory_order_release);
+    }
+    if (buffer == nullptr) {
         LOG(ERROR) << "AidlBufferTracker::get -- unknown token " << token;
-        return nullptr;
     }
-    return mTokenToBuffers[token];
+    return buffer;
 }
 
 void AidlBufferTracker::free(uint32_t token) {
-    std::lock_guard<std::mutex> guard(mMutex);
-    CHECK_LT(token, mTokenToBuffers.size());
-    CHECK(mTokenToBuffers[token] != nullptr);
+    const uint32_t index = token % kMaxSlots;
+    Slot* slot = getSlot(index);
+    CHECK(slot != nullptr);
+    CHECK_EQ(slot->token.load(std::memory_order_relaxed), token);
     VLOG(MEMORY) << "AidlBufferTracker::free -- release token = " << token;
-    mTokenToBuffers[token] = nullptr;
-    mFreeTokens.push(token);
+
+    // Once the token is cleared, new readers leave the buffer alone. Wait out the ones that may
+    // be copying it.
+    slot->token.store(0);
+    while (slot->readers.load() != 0) {
+        std::this_thread::yield();
+    }
+    slot->buffer.reset();
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    mFreeSlots.push(index);
 }
 
 }  // namespace android::nn
@@ -27,14 +27,37 @@
 #include <nnapi/TypeUtils.h>
 #include <nnapi/Types.h>
 
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <utility>
 
+#ifdef __ANDROID__
+#include <android/hardware_buffer.h>
+#endif  // __ANDROID__
+
 namespace aidl::android::hardware::neuralnetworks::utils {
 namespace {
 
+// The number of bytes a retained memory object counts against the budget. nn::getSize is 0 for
+// hardware buffers that are not BLOBs, so their size is estimated from their description, with
+// the 8 bytes of the widest pixel formats.
+size_t getRetainedSize(const nn::SharedMemory& memory) {
+    const size_t size = nn::getSize(memory);
+#ifdef __ANDROID__
+    if (const auto* hardwareBuffer = std::get_if<nn::Memory::HardwareBuffer>(&memory->handle);
+        size == 0 && hardwareBuffer != nullptr) {
+        AHardwareBuffer_Desc desc;
+        AHardwareBuffer_describe(hardwareBuffer->handle.get(), &desc);
+        constexpr size_t kMaxBytesPerPixel = 8;
+        return static_cast<size_t>(std::max(desc.stride, desc.width)) * desc.height *
+               desc.layers * kMaxBytesPerPixel;
+    }
+#endif  // __ANDROID__
+    return size;
+}
+
 class BurstExecution final : public nn::IExecution,
                              public std::enable_shared_from_this<BurstExecution> {
     struct PrivateConstructorTag {};
@@ -81,13 +104,18 @@ nn::GeneralResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> convertEx
 
 }  // namespace
 
-Burst::MemoryCache::MemoryCache(std::shared_ptr<aidl_hal::IBurst> burst)
-    : kBurst(std::move(burst)) {}
+Burst::MemoryCache::MemoryCache(std::shared_ptr<aidl_hal::IBurst> burst,
+                                size_t retainedMemoryBudget)
+    : kBurst(std::move(burst)), kRetainedMemoryBudget(retainedMemoryBudget) {}
 
 std::pair<int64_t, Burst::MemoryCache::SharedCleanup> Burst::MemoryCache::getOrCacheMemory(
         const nn::SharedMemory& memory) {
     std::lock_guard lock(mMutex);
+    return getOrCacheMemoryLocked(memory);
+}
 
+std::pair<int64_t, Burst::MemoryCache::SharedCleanup> Burst::MemoryCache::getOrCacheMemoryLocked(
+        const nn::SharedMemory& memory) {
     // Get the cache payload or create it (with default values) if it does not exist.
     auto& cachedPayload = mCache[memory];
     {
@@ -123,7 +151,11 @@ std::pair<int64_t, Burst::MemoryCache::SharedCleanup> Burst::MemoryCache::getOrC
 std::optional<std::pair<int64_t, Burst::MemoryCache::SharedCleanup>>
 Burst::MemoryCache::getMemoryIfAvailable(const nn::SharedMemory& memory) {
     std::lock_guard lock(mMutex);
+    return getMemoryIfAvailableLocked(memory);
+}
 
+std::optional<std::pair<int64_t, Burst::MemoryCache::SharedCleanup>>
+Burst::MemoryCache::getMemoryIfAvailableLocked(const nn::SharedMemory& memory) {
     // Get the existing cached entry if it exists.
     const auto iter = mCache.find(memory);
     if (iter != mCache.end()) {
@@ -138,6 +170,46 @@ Burst::MemoryCache::getMemoryIfAvailable(const nn::SharedMemory& memory) {
     return std::nullopt;
 }
 
+std::optional<std::pair<int64_t, Burst::MemoryCache::SharedCleanup>>
+Burst::MemoryCache::getOrRetainMemory(const nn::SharedMemory& memory) {
+    // Evicted holds must be released after mMutex is unlocked, because releasing the last hold of
+    // an entry calls tryFreeMemory.
+    std::vector<SharedCleanup> evicted;
+    std::lock_guard lock(mMutex);
+
+    if (auto cached = getMemoryIfAvailableLocked(memory)) {
+        ++mStatistics.hits;
+        if (const auto iter = mRetainedIndex.find(memory); iter != mRetainedIndex.end()) {
+            mRetained.splice(mRetained.begin(), mRetained, iter->second);
+        }
+        return cached;
+    }
+    ++mStatistics.misses;
+    const size_t size = getRetainedSize(memory);
+    if (size > kRetainedMemoryBudget) {
+        return std::nullopt;
+    }
+
+    auto result = getOrCacheMemoryLocked(memory);
+    mRetained.push_front({memory, result.second, size});
+    mRetainedIndex[memory] = mRetained.begin();
+    mRetainedBytes += size;
+    while (mRetainedBytes > kRetainedMemoryBudget || mRetained.size() > kMaxRetainedMemories) {
+        RetainedMemory& leastRecentlyUsed = mRetained.back();
+        mRetainedBytes -= leastRecentlyUsed.size;
+        mRetainedIndex.erase(leastRecentlyUsed.memory);
+        evicted.push_back(std::move(leastRecentlyUsed.hold));
+        mRetained.pop_back();
+        ++mStatistics.evictions;
+    }
+    return result;
+}
+
+Burst::MemoryCache::Statistics Burst::MemoryCache::getStatistics() {
+    std::lock_guard lock(mMutex);
+    return mStatistics;
+}
+
 void Burst::MemoryCache::tryFreeMemory(const nn::SharedMemory& memory, int64_t identifier) {
     {
         std::lock_guard guard(mMutex);
@@ -155,23 +227,29 @@ void Burst::MemoryCache::tryFreeMemory(const nn::SharedMemory& memory, int64_t i
 }
 
 nn::GeneralResult<std::shared_ptr<const Burst>> Burst::create(
-        std::shared_ptr<aidl_hal::IBurst> burst, nn::Version featureLevel) {
+        std::shared_ptr<aidl_hal::IBurst> burst, nn::Version featureLevel,
+        size_t retainedMemoryBudget) {
     if (burst == nullptr) {
         return NN_ERROR(nn::ErrorStatus::GENERAL_FAILURE)
                << "aidl_hal::utils::Burst::create must have non-null burst";
     }
 
-    return std::make_shared<const Burst>(PrivateConstructorTag{}, std::move(burst), featureLevel);
+    return std::make_shared<const Burst>(PrivateConstructorTag{}, std::move(burst), featureLevel,
+                                         retainedMemoryBudget);
 }
 
 Burst::Burst(PrivateConstructorTag /*tag*/, std::shared_ptr<aidl_hal::IBurst> burst,
-             nn::Version featureLevel)
+             nn::Version featureLevel, size_t retainedMemoryBudget)
     : kBurst(std::move(burst)),
-      kMemoryCache(std::make_shared<MemoryCache>(kBurst)),
+      kMemoryCache(std::make_shared<MemoryCache>(kBurst, retainedMemoryBudget)),
       kFeatureLevel(featureLevel) {
     CHECK(kBurst != nullptr);
 }
 
+Burst::MemoryCache::Statistics Burst::getMemoryCacheStatistics() const {
+    return kMemoryCache->getStatistics();
+}
+
 Burst::OptionalCacheHold Burst::cacheMemory(const nn::SharedMemory& memory) const {
     auto [identifier, hold] = kMemoryCache->getOrCacheMemory(memory);
     return hold;
@@ -200,7 +278,7 @@ nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> Burst::
     holds.reserve(requestInShared.pools.size());
     for (const auto& memoryPool : requestInShared.pools) {
         if (const auto* memory = std::get_if<nn::SharedMemory>(&memoryPool)) {
-            if (auto cached = kMemoryCache->getMemoryIfAvailable(*memory)) {
+            if (auto cached = kMemoryCache->getOrRetainMemory(*memory)) {
                 auto& [identifier, hold] = *cached;
                 memoryIdentifierTokens.push_back(identifier);
                 holds.push_back(std::move(hold));
@@ -283,7 +361,7 @@ nn::GeneralResult<nn::SharedExecution> Burst::createReusableExecution(
     holds.reserve(requestInShared.pools.size());
     for (const auto& memoryPool : requestInShared.pools) {
         if (const auto* memory = std::get_if<nn::SharedMemory>(&memoryPool)) {
-            if (auto cached = kMemoryCache->getMemoryIfAvailable(*memory)) {
+            if (auto cached = kMemoryCache->getOrRetainMemory(*memory)) {
                 auto& [identifier, hold] = *cached;
                 memoryIdentifierTokens.push_back(identifier);
                 holds.push_back(std::move(hold));
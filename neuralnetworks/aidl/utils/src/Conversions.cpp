@@ -34,6 +34,7 @@
 #include <nnapi/Types.h>
 #include <nnapi/Validation.h>
 #include <nnapi/hal/CommonUtils.h>
+#include <nnapi/hal/WorkerPool.h>
 
 #include <algorithm>
 #include <chrono>
@@ -60,6 +61,9 @@ namespace {
 
 constexpr int64_t kNoTiming = -1;
 
+// Each range converted by unvalidatedConvertVecInParallel has at least this many elements.
+constexpr size_t kMinElementsPerConversionRange = 2048;
+
 }  // namespace
 
 namespace android::nn {
@@ -83,6 +87,41 @@ GeneralResult<std::vector<UnvalidatedConvertOutput<Type>>> unvalidatedConvertVec
     return canonical;
 }
 
+// Same as unvalidatedConvertVec, but splits vectors large enough to be worth it, such as the
+// operands and operations of large models, into ranges converted on the shared worker pool. If
+// several elements fail to convert, the error of the first range with a failure is returned.
+template <typename Type>
+GeneralResult<std::vector<UnvalidatedConvertOutput<Type>>> unvalidatedConvertVecInParallel(
+        const std::vector<Type>& arguments) {
+    auto& pool = ::android::hardware::neuralnetworks::utils::WorkerPool::get();
+    const size_t rangeCount = std::min<size_t>(pool.getWorkerCount() + 1,
+                                               arguments.size() / kMinElementsPerConversionRange);
+    if (rangeCount < 2) {
+        return unvalidatedConvertVec(arguments);
+    }
+
+    std::vector<UnvalidatedConvertOutput<Type>> canonical(arguments.size());
+    const auto convertRange = [&arguments, &canonical](size_t begin,
+                                                       size_t end) -> GeneralResult<void> {
+        for (size_t i = begin; i < end; ++i) {
+            canonical[i] = NN_TRY(nn::unvalidatedConvert(arguments[i]));
+        }
+        return {};
+    };
+
+    const size_t rangeSize = (arguments.size() + rangeCount - 1) / rangeCount;
+    std::vector<GeneralResult<void>> results(rangeCount);
+    pool.run(rangeCount, [&convertRange, &results, &arguments, rangeSize](size_t range) {
+        const size_t begin = range * rangeSize;
+        results[range] = convertRange(begin, std::min(begin + rangeSize, arguments.size()));
+    });
+
+    for (auto& result : results) {
+        NN_TRY(std::move(result));
+    }
+    return canonical;
+}
+
 template <typename Type>
 GeneralResult<std::vector<UnvalidatedConvertOutput<Type>>> unvalidatedConvert(
         const std::vector<Type>& arguments) {
@@ -310,8 +349,8 @@ GeneralResult<Model> unvalidatedConvert(const aidl_hal::Model& model) {
 }
 
 GeneralResult<Model::Subgraph> unvalidatedConvert(const aidl_hal::Subgraph& subgraph) {
-    auto operands = NN_TRY(unvalidatedConvert(subgraph.operands));
-    auto operations = NN_TRY(unvalidatedConvert(subgraph.operations));
+    auto operands = NN_TRY(unvalidatedConvertVecInParallel(subgraph.operands));
+    auto operations = NN_TRY(unvalidatedConvertVecInParallel(subgraph.operations));
     auto inputIndexes = NN_TRY(toUnsigned(subgraph.inputIndexes));
     auto outputIndexes = NN_TRY(toUnsigned(subgraph.outputIndexes));
     return Model::Subgraph{
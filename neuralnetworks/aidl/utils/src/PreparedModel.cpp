@@ -31,9 +31,13 @@
 #include <nnapi/Types.h>
 #include <nnapi/hal/CommonUtils.h>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <tuple>
 #include <utility>
+#include <variant>
 #include <vector>
 
 // See hardware/interfaces/neuralnetworks/utils/README.md for more information on AIDL interface
@@ -108,8 +112,139 @@ handleFencedExecutionResult(const FencedExecutionResult& result,
     return std::make_pair(std::move(resultSyncFence), std::move(resultCallback));
 }
 
+size_t roundUp(size_t size, size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+// Pointer arguments of a request that were copied into memory from the staging pool. The memory
+// goes back to the pool when this is destroyed.
+class StagedPointerArguments {
+  public:
+    explicit StagedPointerArguments(std::shared_ptr<PreparedModel::StagingMemoryPool> pool)
+        : mPool(std::move(pool)) {}
+    ~StagedPointerArguments() {
+        if (mMemory != nullptr) {
+            mPool->release(std::move(mMemory));
+        }
+    }
+
+    // Returns a copy of request in which the pointer arguments refer to a staging memory instead,
+    // with the inputs copied into it.
+    nn::GeneralResult<nn::Request> stage(const nn::Request& request) {
+        nn::Request requestInShared = request;
+        size_t size = 0;
+        const auto layOut = [&size](nn::Request::Argument* argument) {
+            if (argument->lifetime != nn::Request::Argument::LifeTime::POINTER) {
+                return;
+            }
+            const size_t offset = roundUp(size, nn::kDefaultRequestMemoryAlignment);
+            const size_t length = argument->location.length;
+            const size_t paddedLength = roundUp(length, nn::kDefaultRequestMemoryPadding);
+            // Checked to fit in uint32_t below, as offset + paddedLength <= size
+            argument->location.offset = static_cast<uint32_t>(offset);
+            argument->location.padding = static_cast<uint32_t>(paddedLength - length);
+            size = offset + paddedLength;
+        };
+        std::for_each(requestInShared.inputs.begin(), requestInShared.inputs.end(),
+                      [&layOut](auto& input) { layOut(&input); });
+        std::for_each(requestInShared.outputs.begin(), requestInShared.outputs.end(),
+                      [&layOut](auto& output) { layOut(&output); });
+        if (size > std::numeric_limits<uint32_t>::max()) {
+            return NN_ERROR(nn::ErrorStatus::INVALID_ARGUMENT)
+                   << "Pointer arguments of " << size << " bytes do not fit in shared memory";
+        }
+
+        mMemory = NN_TRY(mPool->acquire(std::max<size_t>(size, 1)));
+        auto* base = static_cast<uint8_t*>(std::get<void*>(mMemory->mapping.pointer));
+        const auto poolIndex = static_cast<uint32_t>(requestInShared.pools.size());
+        requestInShared.pools.push_back(mMemory->memory);
+
+        for (auto& input : requestInShared.inputs) {
+            if (input.lifetime != nn::Request::Argument::LifeTime::POINTER) {
+                continue;
+            }
+            const void* data = std::visit([](auto* ptr) { return static_cast<const void*>(ptr); },
+                                          input.location.pointer);
+            std::memcpy(base + input.location.offset, data, input.location.length);
+            input.lifetime = nn::Request::Argument::LifeTime::POOL;
+            input.location.pointer = {};
+            input.location.poolIndex = poolIndex;
+        }
+        for (auto& output : requestInShared.outputs) {
+            if (output.lifetime != nn::Request::Argument::LifeTime::POINTER) {
+                continue;
+            }
+            void* const* data = std::get_if<void*>(&output.location.pointer);
+            if (data == nullptr) {
+                return NN_ERROR(nn::ErrorStatus::INVALID_ARGUMENT)
+                       << "Output arguments must not point to const memory";
+            }
+            mOutputs.push_back({*data, base + output.location.offset, output.location.length});
+            output.lifetime = nn::Request::Argument::LifeTime::POOL;
+            output.location.pointer = {};
+            output.location.poolIndex = poolIndex;
+        }
+        return requestInShared;
+    }
+
+    // Copies the outputs from the staging memory back to where the request pointed.
+    void flushOutputs() const {
+        for (const auto& output : mOutputs) {
+            std::memcpy(output.destination, output.source, output.length);
+        }
+    }
+
+  private:
+    struct Output {
+        void* destination;
+        const uint8_t* source;
+        size_t length;
+    };
+
+    const std::shared_ptr<PreparedModel::StagingMemoryPool> mPool;
+    std::unique_ptr<PreparedModel::StagingMemoryPool::Memory> mMemory;
+    std::vector<Output> mOutputs;
+};
+
 }  // namespace
 
+nn::GeneralResult<std::unique_ptr<PreparedModel::StagingMemoryPool::Memory>>
+PreparedModel::StagingMemoryPool::acquire(size_t size) {
+    {
+        std::lock_guard guard(mMutex);
+        // Take the smallest free memory that is large enough
+        auto best = mFreeMemories.end();
+        for (auto it = mFreeMemories.begin(); it != mFreeMemories.end(); ++it) {
+            if ((*it)->size >= size &&
+                (best == mFreeMemories.end() || (*it)->size < (*best)->size)) {
+                best = it;
+            }
+        }
+        if (best != mFreeMemories.end()) {
+            auto memory = std::move(*best);
+            mFreeMemories.erase(best);
+            return memory;
+        }
+    }
+
+    auto memory = NN_TRY(nn::createSharedMemory(size));
+    auto mapping = NN_TRY(nn::map(memory));
+    return std::make_unique<Memory>(
+            Memory{.memory = std::move(memory), .mapping = std::move(mapping), .size = size});
+}
+
+void PreparedModel::StagingMemoryPool::release(std::unique_ptr<Memory> memory) {
+    std::lock_guard guard(mMutex);
+    mFreeMemories.push_back(std::move(memory));
+    if (mFreeMemories.size() > kMaxFreeMemories) {
+        // Only keep the largest memories
+        const auto smallest = std::min_element(
+                mFreeMemories.begin(), mFreeMemories.end(),
+                [](const auto& lhs, const auto& rhs) { return lhs->size < rhs->size; });
+        mFreeMemories.erase(smallest);
+    }
+}
+
 nn::GeneralResult<std::shared_ptr<const PreparedModel>> PreparedModel::create(
         std::shared_ptr<aidl_hal::IPreparedModel> preparedModel, nn::Version featureLevel) {
     if (preparedModel == nullptr) {
@@ -124,26 +259,35 @@ nn::GeneralResult<std::shared_ptr<const PreparedModel>> PreparedModel::create(
 PreparedModel::PreparedModel(PrivateConstructorTag /*tag*/,
                              std::shared_ptr<aidl_hal::IPreparedModel> preparedModel,
                              nn::Version featureLevel)
-    : kPreparedModel(std::move(preparedModel)), kFeatureLevel(featureLevel) {}
+    : kPreparedModel(std::move(preparedModel)),
+      kFeatureLevel(featureLevel),
+      kStagingMemoryPool(std::make_shared<StagingMemoryPool>()) {}
 
 nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> PreparedModel::execute(
         const nn::Request& request, nn::MeasureTiming measure,
         const nn::OptionalTimePoint& deadline, const nn::OptionalDuration& loopTimeoutDuration,
         const std::vector<nn::TokenValuePair>& hints,
         const std::vector<nn::ExtensionNameAndPrefix>& extensionNameToPrefix) const {
-    // Ensure that request is ready for IPC.
+    // Ensure that request is ready for IPC. The execution is done when this returns, so pointer
+    // arguments are copied into staging memory that later executions reuse.
+    StagedPointerArguments staged(kStagingMemoryPool);
     std::optional<nn::Request> maybeRequestInShared;
-    hal::utils::RequestRelocation relocation;
-    const nn::Request& requestInShared = NN_TRY(hal::utils::convertRequestFromPointerToShared(
-            &request, nn::kDefaultRequestMemoryAlignment, nn::kDefaultRequestMemoryPadding,
-            &maybeRequestInShared, &relocation));
+    if (!hal::utils::hasNoPointerData(request)) {
+        maybeRequestInShared = NN_TRY(staged.stage(request));
+    }
+    const nn::Request& requestInShared =
+            maybeRequestInShared.has_value() ? *maybeRequestInShared : request;
 
     const auto aidlRequest = NN_TRY(convert(requestInShared));
     const auto aidlMeasure = NN_TRY(convert(measure));
     const auto aidlDeadline = NN_TRY(convert(deadline));
     const auto aidlLoopTimeoutDuration = NN_TRY(convert(loopTimeoutDuration));
-    return executeInternal(aidlRequest, aidlMeasure, aidlDeadline, aidlLoopTimeoutDuration, hints,
-                           extensionNameToPrefix, relocation);
+    auto result = executeInternal(aidlRequest, aidlMeasure, aidlDeadline, aidlLoopTimeoutDuration,
+                                  hints, extensionNameToPrefix, {});
+    if (result.has_value()) {
+        staged.flushOutputs();
+    }
+    return result;
 }
 
 nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>>
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <nnapi/hal/aidl/BufferTracker.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace android::nn {
+namespace {
+
+// The layout of the tokens: the slot in the low bits, tagged with its generation.
+constexpr uint32_t kSlotBits = 16;
+constexpr uint32_t kMaxSlots = 1u << kSlotBits;
+constexpr uint32_t kMaxGeneration = (1u << (31 - kSlotBits)) - 1;
+
+std::shared_ptr<AidlManagedBuffer> makeBuffer() {
+    Operand operand;
+    operand.type = OperandType::TENSOR_FLOAT32;
+    operand.dimensions = {1};
+    return AidlManagedBuffer::create(sizeof(float), {}, operand);
+}
+
+TEST(BufferTrackerTest, getReturnsTheAddedBuffer) {
+    const auto tracker = AidlBufferTracker::create();
+    const auto buffer = makeBuffer();
+    ASSERT_NE(buffer, nullptr);
+
+    const auto token = tracker->add(buffer);
+
+    ASSERT_NE(token, nullptr);
+    EXPECT_NE(token->get(), 0u);
+    EXPECT_EQ(tracker->get(token->get()), buffer);
+}
+
+TEST(BufferTrackerTest, getRejectsUnknownTokens) {
+    const auto tracker = AidlBufferTracker::create();
+    const auto token = tracker->add(makeBuffer());
+    ASSERT_NE(token, nullptr);
+
+    EXPECT_EQ(tracker->get(0), nullptr);
+    // A slot of a chunk that is not allocated yet.
+    EXPECT_EQ(tracker->get(kMaxSlots - 1), nullptr);
+    // The right slot with another generation.
+    EXPECT_EQ(tracker->get(token->get() + kMaxSlots), nullptr);
+}
+
+TEST(BufferTrackerTest, addRejectsNullBuffers) {
+    const auto tracker = AidlBufferTracker::create();
+
+    EXPECT_EQ(tracker->add(nullptr), nullptr);
+}
+
+TEST(BufferTrackerTest, staleTokenIsRejectedAfterTheSlotIsReused) {
+    const auto tracker = AidlBufferTracker::create();
+    auto token = tracker->add(makeBuffer());
+    ASSERT_NE(token, nullptr);
+    const uint32_t staleToken = token->get();
+    token.reset();
+    EXPECT_EQ(tracker->get(staleToken), nullptr);
+
+    const auto buffer = makeBuffer();
+    token = tracker->add(buffer);
+
+    // The same slot is handed out again, with another token.
+    ASSERT_NE(token, nullptr);
+    EXPECT_EQ(token->get() % kMaxSlots, staleToken % kMaxSlots);
+    EXPECT_NE(token->get(), staleToken);
+    EXPECT_EQ(tracker->get(staleToken), nullptr);
+    EXPECT_EQ(tracker->get(token->get()), buffer);
+}
+
+TEST(BufferTrackerTest, addFailsOnceAllSlotsAreInUse) {
+    const auto tracker = AidlBufferTracker::create();
+    const auto buffer = makeBuffer();
+    std::vector<std::unique_ptr<AidlBufferTracker::Token>> tokens;
+    for (uint32_t i = 0; i < kMaxSlots; i++) {
+        tokens.push_back(tracker->add(buffer));
+        ASSERT_NE(tokens.back(), nullptr) << "add " << i;
+    }
+
+    EXPECT_EQ(tracker->add(buffer), nullptr);
+
+    // Freeing any buffer makes room for another one.
+    const uint32_t freedToken = tokens[kMaxSlots / 2]->get();
+    tokens[kMaxSlots / 2].reset();
+    const auto token = tracker->add(buffer);
+    ASSERT_NE(token, nullptr);
+    EXPECT_EQ(token->get() % kMaxSlots, freedToken % kMaxSlots);
+    EXPECT_EQ(tracker->get(tokens.front()->get()), buffer);
+    EXPECT_EQ(tracker->get(tokens.back()->get()), buffer);
+}
+
+TEST(BufferTrackerTest, generationWrapsAroundWithoutZeroTokens) {
+    const auto tracker = AidlBufferTracker::create();
+    const auto buffer = makeBuffer();
+    auto token = tracker->add(buffer);
+    ASSERT_NE(token, nullptr);
+    const uint32_t firstToken = token->get();
+
+    // Every generation of the slot, up to the first one again.
+    for (uint32_t i = 1; i < kMaxGeneration; i++) {
+        token.reset();
+        token = tracker->add(buffer);
+        ASSERT_NE(token, nullptr);
+        ASSERT_EQ(token->get() % kMaxSlots, firstToken % kMaxSlots);
+        ASSERT_NE(token->get(), firstToken) << "generation " << i;
+        ASSERT_GT(token->get(), 0u);
+        ASSERT_LT(token->get(), 1u << 31);
+    }
+    token.reset();
+    token = tracker->add(buffer);
+
+    ASSERT_NE(token, nullptr);
+    EXPECT_EQ(token->get(), firstToken);
+    EXPECT_EQ(tracker->get(firstToken), buffer);
+}
+
+TEST(BufferTrackerTest, concurrentGetDuringFree) {
+    constexpr size_t kNumReaders = 4;
+    constexpr uint32_t kNumRounds = 500;
+    const auto tracker = AidlBufferTracker::create();
+    std::vector<std::shared_ptr<AidlManagedBuffer>> buffers;
+    for (uint32_t i = 0; i < kNumRounds; i++) {
+        buffers.push_back(makeBuffer());
+        ASSERT_NE(buffers.back(), nullptr);
+    }
+
+    // The round in the high bits and the token of its buffer in the low bits.
+    std::atomic<uint64_t> current = 0;
+    std::atomic_bool done = false;
+    std::atomic<size_t> numFound = 0;
+
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < kNumReaders; i++) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                const uint64_t snapshot = current.load();
+                const uint32_t round = snapshot >> 32;
+                const uint32_t token = static_cast<uint32_t>(snapshot);
+                // The buffer may be freed meanwhile, but never swapped for another one.
+                const auto buffer = tracker->get(token);
+                if (buffer != nullptr) {
+                    ASSERT_EQ(buffer, buffers[round]);
+                    numFound++;
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+    for (uint32_t i = 0; i < kNumRounds; i++) {
+        const auto token = tracker->add(buffers[i]);
+        ASSERT_NE(token, nullptr);
+        current.store((uint64_t{i} << 32) | token->get());
+        std::this_thread::yield();
+    }
+    done.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_GT(numFound.load(), 0u);
+}
+
+}  // namespace
+}  // namespace android::nn
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MockBurst.h"
+
+#include <android/binder_auto_utils.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <nnapi/SharedMemory.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/Burst.h>
+
+#include <memory>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::utils {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+
+constexpr size_t kMemorySize = 4;
+
+constexpr auto makeStatusOk = [] { return ndk::ScopedAStatus::ok(); };
+
+std::shared_ptr<Burst::MemoryCache> createMemoryCache(const std::shared_ptr<MockBurst>& mockBurst,
+                                                      size_t retainedMemoryBudget) {
+    return std::make_shared<Burst::MemoryCache>(mockBurst, retainedMemoryBudget);
+}
+
+}  // namespace
+
+TEST(BurstMemoryCacheTest, getOrRetainMemoryCachesNewMemory) {
+    // setup test
+    const auto mockBurst = ndk::SharedRefBase::make<MockBurst>();
+    EXPECT_CALL(*mockBurst, releaseMemoryResource(_)).Times(0);
+    const auto memoryCache = createMemoryCache(mockBurst, kMemorySize);
+    const auto memory = nn::createSharedMemory(kMemorySize).value();
+
+    // run test
+    const auto first = memoryCache->getOrRetainMemory(memory);
+    const auto second = memoryCache->getOrRetainMemory(memory);
+
+    // verify result
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(first->first, second->first);
+    const auto statistics = memoryCache->getStatistics();
+    EXPECT_EQ(statistics.hits, 1u);
+    EXPECT_EQ(statistics.misses, 1u);
+    EXPECT_EQ(statistics.evictions, 0u);
+}
+
+TEST(BurstMemoryCacheTest, getOrRetainMemoryKeepsMemoryCachedWithoutHolds) {
+    // setup test
+    const auto mockBurst = ndk::SharedRefBase::make<MockBurst>();
+    EXPECT_CALL(*mockBurst, releaseMemoryResource(_)).Times(0);
+    const auto memoryCache = createMemoryCache(mockBurst, kMemorySize);
+    const auto memory = nn::createSharedMemory(kMemorySize).value();
+    const int64_t identifier = memoryCache->getOrRetainMemory(memory).value().first;
+
+    // run test
+    const auto cached = memoryCache->getMemoryIfAvailable(memory);
+
+    // verify result
+    ASSERT_TRUE(cached.has_value());
+    EXPECT_EQ(cached->first, identifier);
+}
+
+TEST(BurstMemoryCacheTest, getOrRetainMemoryEvictsLeastRecentlyUsed) {
+    // setup test
+    const auto mockBurst = ndk::SharedRefBase::make<MockBurst>();
+    const auto memoryCache = createMemoryCache(mockBurst, 2 * kMemorySize);
+    const auto memory1 = nn::createSharedMemory(kMemorySize).value();
+    const auto memory2 = nn::createSharedMemory(kMemorySize).value();
+    const auto memory3 = nn::createSharedMemory(kMemorySize).value();
+    memoryCache->getOrRetainMemory(memory1);
+    const int64_t identifier2 = memoryCache->getOrRetainMemory(memory2).value().first;
+    memoryCache->getOrRetainMemory(memory1);
+    EXPECT_CALL(*mockBurst, releaseMemoryResource(identifier2))
+            .Times(1)
+            .WillOnce(Invoke(makeStatusOk));
+
+    // run test
+    memoryCache->getOrRetainMemory(memory3);
+
+    // verify result
+    EXPECT_TRUE(memoryCache->getMemoryIfAvailable(memory1).has_value());
+    EXPECT_FALSE(memoryCache->getMemoryIfAvailable(memory2).has_value());
+    EXPECT_TRUE(memoryCache->getMemoryIfAvailable(memory3).has_value());
+    const auto statistics = memoryCache->getStatistics();
+    EXPECT_EQ(statistics.hits, 1u);
+    EXPECT_EQ(statistics.misses, 3u);
+    EXPECT_EQ(statistics.evictions, 1u);
+}
+
+TEST(BurstMemoryCacheTest, getOrRetainMemoryIgnoresMemoryLargerThanBudget) {
+    // setup test
+    const auto mockBurst = ndk::SharedRefBase::make<MockBurst>();
+    const auto memoryCache = createMemoryCache(mockBurst, kMemorySize - 1);
+    const auto memory = nn::createSharedMemory(kMemorySize).value();
+
+    // run test
+    const auto result = memoryCache->getOrRetainMemory(memory);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+    EXPECT_FALSE(memoryCache->getMemoryIfAvailable(memory).has_value());
+    EXPECT_EQ(memoryCache->getStatistics().misses, 1u);
+}
+
+TEST(BurstMemoryCacheTest, getOrRetainMemoryLimitsRetainedMemoryCount) {
+    // setup test
+    const auto mockBurst = ndk::SharedRefBase::make<MockBurst>();
+    const auto memoryCache =
+            createMemoryCache(mockBurst, (Burst::kMaxRetainedMemories + 1) * kMemorySize);
+    std::vector<nn::SharedMemory> memories;
+    for (size_t i = 0; i < Burst::kMaxRetainedMemories + 1; i++) {
+        memories.push_back(nn::createSharedMemory(kMemorySize).value());
+    }
+    const int64_t firstIdentifier = memoryCache->getOrRetainMemory(memories[0]).value().first;
+    for (size_t i = 1; i < Burst::kMaxRetainedMemories; i++) {
+        memoryCache->getOrRetainMemory(memories[i]);
+    }
+    EXPECT_CALL(*mockBurst, releaseMemoryResource(firstIdentifier))
+            .Times(1)
+            .WillOnce(Invoke(makeStatusOk));
+
+    // run test
+    memoryCache->getOrRetainMemory(memories.back());
+
+    // verify result
+    EXPECT_FALSE(memoryCache->getMemoryIfAvailable(memories[0]).has_value());
+    EXPECT_TRUE(memoryCache->getMemoryIfAvailable(memories[1]).has_value());
+    EXPECT_TRUE(memoryCache->getMemoryIfAvailable(memories.back()).has_value());
+    EXPECT_EQ(memoryCache->getStatistics().evictions, 1u);
+}
+
+}  // namespace aidl::android::hardware::neuralnetworks::utils
@@ -25,12 +25,16 @@
 #include <gtest/gtest.h>
 #include <nnapi/IExecution.h>
 #include <nnapi/IPreparedModel.h>
+#include <nnapi/SharedMemory.h>
 #include <nnapi/TypeUtils.h>
 #include <nnapi/Types.h>
+#include <nnapi/hal/aidl/Conversions.h>
 #include <nnapi/hal/aidl/PreparedModel.h>
 
+#include <cstring>
 #include <functional>
 #include <memory>
+#include <variant>
 
 namespace aidl::android::hardware::neuralnetworks::utils {
 namespace {
@@ -85,6 +89,36 @@ auto makeFencedExecutionWithConfigResult(
     };
 }
 
+nn::Request::Argument makePointerArgument(std::variant<const void*, void*> pointer,
+                                          uint32_t length) {
+    nn::Request::Argument argument;
+    argument.lifetime = nn::Request::Argument::LifeTime::POINTER;
+    argument.location.pointer = pointer;
+    argument.location.length = length;
+    return argument;
+}
+
+// Doubles the float input of a request with pointer arguments, reading and writing the shared
+// memory the pointer arguments were moved to.
+constexpr auto doubleStagedInput = [](const Request& request, bool /*measureTiming*/,
+                                      int64_t /*deadline*/, int64_t /*loopTimeoutDuration*/,
+                                      ExecutionResult* executionResult) {
+    const auto& pool = request.pools.back().get<RequestMemoryPool::Tag::pool>();
+    const auto memory = nn::convert(pool).value();
+    const auto mapping = nn::map(memory).value();
+    auto* base = static_cast<uint8_t*>(std::get<void*>(mapping.pointer));
+    float value;
+    std::memcpy(&value, base + request.inputs[0].location.offset, sizeof(value));
+    value *= 2;
+    std::memcpy(base + request.outputs[0].location.offset, &value, sizeof(value));
+    *executionResult = ExecutionResult{
+            .outputSufficientSize = true,
+            .outputShapes = {},
+            .timing = kNoTiming,
+    };
+    return ndk::ScopedAStatus::ok();
+};
+
 }  // namespace
 
 TEST_P(PreparedModelTest, invalidPreparedModel) {
@@ -138,6 +172,33 @@ TEST_P(PreparedModelTest, executeSyncError) {
     EXPECT_EQ(result.error().code, nn::ErrorStatus::GENERAL_FAILURE);
 }
 
+TEST_P(PreparedModelTest, executeSyncStagesPointerArguments) {
+    if (kVersion.level >= nn::Version::Level::FEATURE_LEVEL_8) return;
+
+    // setup call
+    const auto mockPreparedModel = MockPreparedModel::create();
+    const auto preparedModel = PreparedModel::create(mockPreparedModel, kVersion).value();
+    EXPECT_CALL(*mockPreparedModel, executeSynchronously(_, _, _, _, _))
+            .Times(2)
+            .WillRepeatedly(Invoke(doubleStagedInput));
+    float input = 0.0f;
+    float output = 0.0f;
+    nn::Request request;
+    request.inputs = {makePointerArgument(static_cast<const void*>(&input), sizeof(input))};
+    request.outputs = {makePointerArgument(static_cast<void*>(&output), sizeof(output))};
+
+    // run test, twice so that the second execution reuses the staging memory of the first
+    for (const float value : {1.5f, 4.0f}) {
+        input = value;
+        const auto result = preparedModel->execute(request, {}, {}, {}, {}, {});
+
+        // verify result
+        ASSERT_TRUE(result.has_value())
+                << "Failed with " << result.error().code << ": " << result.error().message;
+        EXPECT_EQ(output, value * 2);
+    }
+}
+
 TEST_P(PreparedModelTest, executeSyncTransportFailure) {
     if (kVersion.level >= nn::Version::Level::FEATURE_LEVEL_8) return;
 
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_CURRENT_OBJECT_H
+#define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_CURRENT_OBJECT_H
+
+#include <android-base/thread_annotations.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+
+// The current object of a Resilient* wrapper, which the calls made through the wrapper reach
+// without taking its mutex or copying a shared pointer.
+//
+// A call pins the object for as long as it uses it. The owner keeps the current object alive and
+// hands the ones it replaces over to `replace`, which frees them once no call pinned before the
+// replacement is left. Calls that keep overlapping delay this until there is a moment without
+// any.
+//
+// This class is thread safe.
+template <typename Interface>
+class CurrentObject final {
+  public:
+    // Keeps the object of a call alive until it is destroyed.
+    class Pin final {
+      public:
+        Pin(Pin&& other) noexcept
+            : mOwner(std::exchange(other.mOwner, nullptr)), mObject(other.mObject) {}
+        ~Pin() {
+            if (mOwner != nullptr) mOwner->unpin();
+        }
+
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        Pin& operator=(Pin&&) = delete;
+
+        const Interface* get() const { return mObject; }
+        const Interface& operator*() const { return *mObject; }
+        const Interface* operator->() const { return mObject; }
+
+      private:
+        friend class CurrentObject;
+        Pin(const CurrentObject* owner, const Interface* object)
+            : mOwner(owner), mObject(object) {}
+
+        const CurrentObject* mOwner;
+        const Interface* mObject;
+    };
+
+    explicit CurrentObject(const Interface* object) : mObject(object) {}
+
+    Pin pin() const {
+        // Counted before the load, so that `replace` cannot miss a call using the object.
+        mPins.fetch_add(1);
+        return Pin(this, mObject.load());
+    }
+
+    // Makes `object` current. `previous` is freed once the calls that may be using it are done.
+    void replace(const Interface* object, std::shared_ptr<const Interface> previous)
+            EXCLUDES(mMutex) {
+        mObject.store(object);
+        std::vector<std::shared_ptr<const Interface>> freed;
+        {
+            std::lock_guard guard(mMutex);
+            mReplaced.push_back(std::move(previous));
+            mHasReplaced.store(true);
+            freeReplacedIfUnpinnedLocked(&freed);
+        }
+    }
+
+  private:
+    void unpin() const EXCLUDES(mMutex) {
+        if (mPins.fetch_sub(1) != 1 || !mHasReplaced.load()) return;
+        std::vector<std::shared_ptr<const Interface>> freed;
+        {
+            std::lock_guard guard(mMutex);
+            freeReplacedIfUnpinnedLocked(&freed);
+        }
+    }
+
+    // Moves the replaced objects to `freed`, so that they are destroyed without the mutex held.
+    // Calls pinned from now on see the current object, which is never among them.
+    void freeReplacedIfUnpinnedLocked(std::vector<std::shared_ptr<const Interface>>* freed) const
+            REQUIRES(mMutex) {
+        if (mPins.load() != 0) return;
+        freed->swap(mReplaced);
+        mHasReplaced.store(false);
+    }
+
+    std::atomic<const Interface*> mObject;
+    mutable std::atomic<size_t> mPins = 0;
+    mutable std::atomic_bool mHasReplaced = false;
+    mutable std::mutex mMutex;
+    mutable std::vector<std::shared_ptr<const Interface>> mReplaced GUARDED_BY(mMutex);
+};
+
+}  // namespace android::hardware::neuralnetworks::utils
+
+#endif  // ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_CURRENT_OBJECT_H
@@ -28,6 +28,8 @@
 #include <optional>
 #include <utility>
 
+#include "CurrentObject.h"
+
 namespace android::hardware::neuralnetworks::utils {
 
 class ResilientBurst final : public nn::IBurst,
@@ -41,7 +43,8 @@ class ResilientBurst final : public nn::IBurst,
 
     ResilientBurst(PrivateConstructorTag tag, Factory makeBurst, nn::SharedBurst burst);
 
-    nn::SharedBurst getBurst() const;
+    nn::SharedBurst getBurst() const EXCLUDES(mMutex);
+    CurrentObject<nn::IBurst>::Pin pinCurrentBurst() const;
     nn::GeneralResult<nn::SharedBurst> recover(const nn::IBurst* failingBurst) const;
 
     OptionalCacheHold cacheMemory(const nn::SharedMemory& memory) const override;
@@ -69,6 +72,7 @@ class ResilientBurst final : public nn::IBurst,
     const Factory kMakeBurst;
     mutable std::mutex mMutex;
     mutable nn::SharedBurst mBurst GUARDED_BY(mMutex);
+    mutable CurrentObject<nn::IBurst> mCurrentBurst;
 };
 
 }  // namespace android::hardware::neuralnetworks::utils
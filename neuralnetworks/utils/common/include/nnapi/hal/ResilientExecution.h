@@ -28,6 +28,8 @@
 #include <utility>
 #include <vector>
 
+#include "CurrentObject.h"
+
 namespace android::hardware::neuralnetworks::utils {
 
 class ResilientExecution final : public nn::IExecution,
@@ -43,7 +45,8 @@ class ResilientExecution final : public nn::IExecution,
     ResilientExecution(PrivateConstructorTag tag, Factory makeExecution,
                        nn::SharedExecution execution);
 
-    nn::SharedExecution getExecution() const;
+    nn::SharedExecution getExecution() const EXCLUDES(mMutex);
+    CurrentObject<nn::IExecution>::Pin pinCurrentExecution() const;
     nn::GeneralResult<nn::SharedExecution> recover(const nn::IExecution* failingExecution) const;
 
     nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> compute(
@@ -59,6 +62,7 @@ class ResilientExecution final : public nn::IExecution,
     const Factory kMakeExecution;
     mutable std::mutex mMutex;
     mutable nn::SharedExecution mExecution GUARDED_BY(mMutex);
+    mutable CurrentObject<nn::IExecution> mCurrentExecution;
 };
 
 }  // namespace android::hardware::neuralnetworks::utils
@@ -23,11 +23,14 @@
 #include <nnapi/Types.h>
 
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <utility>
 #include <vector>
 
+#include "CurrentObject.h"
+
 namespace android::hardware::neuralnetworks::utils {
 
 class ResilientPreparedModel final : public nn::IPreparedModel,
@@ -43,9 +46,13 @@ class ResilientPreparedModel final : public nn::IPreparedModel,
     explicit ResilientPreparedModel(PrivateConstructorTag tag, Factory makePreparedModel,
                                     nn::SharedPreparedModel preparedModel);
 
-    nn::SharedPreparedModel getPreparedModel() const;
+    nn::SharedPreparedModel getPreparedModel() const EXCLUDES(mMutex);
+    // Reaches the current prepared model without mMutex, for the calls made through the wrapper.
+    CurrentObject<nn::IPreparedModel>::Pin pinCurrentPreparedModel() const;
+    // Concurrent callers recovering the same failing prepared model share a single recovery,
+    // which runs without holding mMutex.
     nn::GeneralResult<nn::SharedPreparedModel> recover(
-            const nn::IPreparedModel* failingPreparedModel) const;
+            const nn::IPreparedModel* failingPreparedModel) const EXCLUDES(mMutex);
 
     nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> execute(
             const nn::Request& request, nn::MeasureTiming measure,
@@ -83,6 +90,10 @@ class ResilientPreparedModel final : public nn::IPreparedModel,
     const Factory kMakePreparedModel;
     mutable std::mutex mMutex;
     mutable nn::SharedPreparedModel mPreparedModel GUARDED_BY(mMutex);
+    mutable CurrentObject<nn::IPreparedModel> mCurrentPreparedModel;
+    // Valid while a recovery of mPreparedModel is running.
+    mutable std::shared_future<nn::GeneralResult<nn::SharedPreparedModel>> mRecovery
+            GUARDED_BY(mMutex);
 };
 
 }  // namespace android::hardware::neuralnetworks::utils
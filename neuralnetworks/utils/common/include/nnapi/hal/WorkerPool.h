@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_WORKER_POOL_H
+#define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_WORKER_POOL_H
+
+#include <android-base/thread_annotations.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+
+// A fixed set of threads that run the parts of a task in parallel, so that callers splitting
+// their work do not start threads of their own each time.
+//
+// The calling thread runs parts of its task as well, and only waits for the parts the workers
+// took. A task is therefore never starved by the tasks of other callers, and may itself call
+// `run`.
+//
+// This class is thread safe.
+class WorkerPool final {
+  public:
+    // The pool shared by the whole process, with one worker less than the hardware threads, and
+    // at most kMaxSharedWorkers.
+    static WorkerPool& get();
+    static constexpr size_t kMaxSharedWorkers = 7;
+
+    explicit WorkerPool(size_t workerCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t getWorkerCount() const { return mWorkers.size(); }
+
+    // Calls `part` with each index in [0, count), and returns once all of them returned.
+    void run(size_t count, const std::function<void(size_t)>& part) EXCLUDES(mMutex);
+
+  private:
+    struct Task {
+        const std::function<void(size_t)>* part;
+        size_t count;
+        size_t next = 0;
+        size_t running = 0;
+    };
+
+    void workerLoop() EXCLUDES(mMutex);
+    // Takes the next index of `task`, which leaves the queue once all of them are taken.
+    size_t takeIndexLocked(Task* task) REQUIRES(mMutex);
+
+    std::mutex mMutex;
+    std::condition_variable mQueued;
+    std::condition_variable mPartDone;
+    std::deque<Task*> mTasks GUARDED_BY(mMutex);
+    bool mStopping GUARDED_BY(mMutex) = false;
+    std::vector<std::thread> mWorkers;
+};
+
+}  // namespace android::hardware::neuralnetworks::utils
+
+#endif  // ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_WORKER_POOL_H
@@ -39,7 +39,7 @@ namespace {
 template <typename FnType>
 auto protect(const ResilientBurst& resilientBurst, const FnType& fn)
         -> decltype(fn(*resilientBurst.getBurst())) {
-    auto burst = resilientBurst.getBurst();
+    const auto burst = resilientBurst.pinCurrentBurst();
     auto result = fn(*burst);
 
     // Immediately return if burst is not dead.
@@ -56,9 +56,9 @@ auto protect(const ResilientBurst& resilientBurst, const FnType& fn)
         result.error().message += oss.str();
         return result;
     }
-    burst = std::move(maybeBurst).value();
+    const auto recoveredBurst = std::move(maybeBurst).value();
 
-    return fn(*burst);
+    return fn(*recoveredBurst);
 }
 
 }  // namespace
@@ -76,7 +76,7 @@ nn::GeneralResult<std::shared_ptr<const ResilientBurst>> ResilientBurst::create(
 
 ResilientBurst::ResilientBurst(PrivateConstructorTag /*tag*/, Factory makeBurst,
                                nn::SharedBurst burst)
-    : kMakeBurst(std::move(makeBurst)), mBurst(std::move(burst)) {
+    : kMakeBurst(std::move(makeBurst)), mBurst(std::move(burst)), mCurrentBurst(mBurst.get()) {
     CHECK(kMakeBurst != nullptr);
     CHECK(mBurst != nullptr);
 }
@@ -86,6 +86,10 @@ nn::SharedBurst ResilientBurst::getBurst() const {
     return mBurst;
 }
 
+CurrentObject<nn::IBurst>::Pin ResilientBurst::pinCurrentBurst() const {
+    return mCurrentBurst.pin();
+}
+
 nn::GeneralResult<nn::SharedBurst> ResilientBurst::recover(const nn::IBurst* failingBurst) const {
     std::lock_guard guard(mMutex);
 
@@ -94,7 +98,9 @@ nn::GeneralResult<nn::SharedBurst> ResilientBurst::recover(const nn::IBurst* fai
         return mBurst;
     }
 
-    mBurst = NN_TRY(kMakeBurst());
+    auto burst = NN_TRY(kMakeBurst());
+    std::swap(mBurst, burst);
+    mCurrentBurst.replace(mBurst.get(), std::move(burst));
     return mBurst;
 }
 
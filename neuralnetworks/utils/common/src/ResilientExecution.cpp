@@ -39,7 +39,7 @@ namespace {
 template <typename FnType>
 auto protect(const ResilientExecution& resilientExecution, const FnType& fn)
         -> decltype(fn(*resilientExecution.getExecution())) {
-    auto execution = resilientExecution.getExecution();
+    const auto execution = resilientExecution.pinCurrentExecution();
     auto result = fn(*execution);
 
     // Immediately return if prepared model is not dead.
@@ -56,9 +56,9 @@ auto protect(const ResilientExecution& resilientExecution, const FnType& fn)
         result.error().message += oss.str();
         return result;
     }
-    execution = std::move(maybeExecution).value();
+    const auto recoveredExecution = std::move(maybeExecution).value();
 
-    return fn(*execution);
+    return fn(*recoveredExecution);
 }
 
 }  // namespace
@@ -77,7 +77,9 @@ nn::GeneralResult<std::shared_ptr<const ResilientExecution>> ResilientExecution:
 
 ResilientExecution::ResilientExecution(PrivateConstructorTag /*tag*/, Factory makeExecution,
                                        nn::SharedExecution execution)
-    : kMakeExecution(std::move(makeExecution)), mExecution(std::move(execution)) {
+    : kMakeExecution(std::move(makeExecution)),
+      mExecution(std::move(execution)),
+      mCurrentExecution(mExecution.get()) {
     CHECK(kMakeExecution != nullptr);
     CHECK(mExecution != nullptr);
 }
@@ -87,6 +89,10 @@ nn::SharedExecution ResilientExecution::getExecution() const {
     return mExecution;
 }
 
+CurrentObject<nn::IExecution>::Pin ResilientExecution::pinCurrentExecution() const {
+    return mCurrentExecution.pin();
+}
+
 nn::GeneralResult<nn::SharedExecution> ResilientExecution::recover(
         const nn::IExecution* failingExecution) const {
     std::lock_guard guard(mMutex);
@@ -96,7 +102,9 @@ nn::GeneralResult<nn::SharedExecution> ResilientExecution::recover(
         return mExecution;
     }
 
-    mExecution = NN_TRY(kMakeExecution());
+    auto execution = NN_TRY(kMakeExecution());
+    std::swap(mExecution, execution);
+    mCurrentExecution.replace(mExecution.get(), std::move(execution));
     return mExecution;
 }
 
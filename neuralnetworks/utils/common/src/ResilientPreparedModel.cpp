@@ -29,6 +29,7 @@
 #include <nnapi/Types.h>
 
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <sstream>
@@ -41,7 +42,7 @@ namespace {
 template <typename FnType>
 auto protect(const ResilientPreparedModel& resilientPreparedModel, const FnType& fn)
         -> decltype(fn(*resilientPreparedModel.getPreparedModel())) {
-    auto preparedModel = resilientPreparedModel.getPreparedModel();
+    const auto preparedModel = resilientPreparedModel.pinCurrentPreparedModel();
     auto result = fn(*preparedModel);
 
     // Immediately return if prepared model is not dead.
@@ -58,9 +59,9 @@ auto protect(const ResilientPreparedModel& resilientPreparedModel, const FnType&
         result.error().message += oss.str();
         return result;
     }
-    preparedModel = std::move(maybePreparedModel).value();
+    const auto recoveredPreparedModel = std::move(maybePreparedModel).value();
 
-    return fn(*preparedModel);
+    return fn(*recoveredPreparedModel);
 }
 
 }  // namespace
@@ -80,7 +81,9 @@ nn::GeneralResult<std::shared_ptr<const ResilientPreparedModel>> ResilientPrepar
 ResilientPreparedModel::ResilientPreparedModel(PrivateConstructorTag /*tag*/,
                                                Factory makePreparedModel,
                                                nn::SharedPreparedModel preparedModel)
-    : kMakePreparedModel(std::move(makePreparedModel)), mPreparedModel(std::move(preparedModel)) {
+    : kMakePreparedModel(std::move(makePreparedModel)),
+      mPreparedModel(std::move(preparedModel)),
+      mCurrentPreparedModel(mPreparedModel.get()) {
     CHECK(kMakePreparedModel != nullptr);
     CHECK(mPreparedModel != nullptr);
 }
@@ -90,17 +93,44 @@ nn::SharedPreparedModel ResilientPreparedModel::getPreparedModel() const {
     return mPreparedModel;
 }
 
+CurrentObject<nn::IPreparedModel>::Pin ResilientPreparedModel::pinCurrentPreparedModel() const {
+    return mCurrentPreparedModel.pin();
+}
+
 nn::GeneralResult<nn::SharedPreparedModel> ResilientPreparedModel::recover(
         const nn::IPreparedModel* failingPreparedModel) const {
-    std::lock_guard guard(mMutex);
+    std::promise<nn::GeneralResult<nn::SharedPreparedModel>> promise;
+    std::shared_future<nn::GeneralResult<nn::SharedPreparedModel>> recovery;
+    {
+        std::lock_guard guard(mMutex);
+
+        // Another caller updated the failing prepared model.
+        if (mPreparedModel.get() != failingPreparedModel) {
+            return mPreparedModel;
+        }
+
+        recovery = mRecovery;
+        if (!recovery.valid()) {
+            mRecovery = promise.get_future().share();
+        }
+    }
 
-    // Another caller updated the failing prepared model.
-    if (mPreparedModel.get() != failingPreparedModel) {
-        return mPreparedModel;
+    // Another caller is recovering the failing prepared model.
+    if (recovery.valid()) {
+        return recovery.get();
     }
 
-    mPreparedModel = NN_TRY(kMakePreparedModel());
-    return mPreparedModel;
+    auto result = kMakePreparedModel();
+    {
+        std::lock_guard guard(mMutex);
+        if (result.has_value()) {
+            auto previous = std::exchange(mPreparedModel, result.value());
+            mCurrentPreparedModel.replace(mPreparedModel.get(), std::move(previous));
+        }
+        mRecovery = {};
+    }
+    promise.set_value(result);
+    return result;
 }
 
 nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>>
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WorkerPool.h"
+
+#include <android-base/thread_annotations.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace android::hardware::neuralnetworks::utils {
+
+WorkerPool& WorkerPool::get() {
+    // Never destroyed, so that no task runs into a pool stopped at exit.
+    static WorkerPool* const pool = new WorkerPool(std::min<size_t>(
+            std::max(std::thread::hardware_concurrency(), 1u) - 1, kMaxSharedWorkers));
+    return *pool;
+}
+
+WorkerPool::WorkerPool(size_t workerCount) {
+    mWorkers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        mWorkers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard guard(mMutex);
+        mStopping = true;
+    }
+    mQueued.notify_all();
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& part) {
+    if (count == 0) return;
+    Task task{.part = &part, .count = count};
+    std::unique_lock lock(mMutex);
+    base::ScopedLockAssertion lockAssertion(mMutex);
+    if (count > 1 && !mWorkers.empty()) {
+        mTasks.push_back(&task);
+        mQueued.notify_all();
+    }
+    while (task.next < task.count) {
+        const size_t index = takeIndexLocked(&task);
+        lock.unlock();
+        part(index);
+        lock.lock();
+        --task.running;
+    }
+    // The workers may still be running the last parts they took.
+    mPartDone.wait(lock, [&task] { return task.running == 0; });
+}
+
+size_t WorkerPool::takeIndexLocked(Task* task) {
+    const size_t index = task->next++;
+    ++task->running;
+    if (task->next == task->count) {
+        const auto it = std::find(mTasks.begin(), mTasks.end(), task);
+        if (it != mTasks.end()) mTasks.erase(it);
+    }
+    return index;
+}
+
+void WorkerPool::workerLoop() {
+    std::unique_lock lock(mMutex);
+    base::ScopedLockAssertion lockAssertion(mMutex);
+    while (true) {
+        mQueued.wait(lock, [this]() REQUIRES(mMutex) { return mStopping || !mTasks.empty(); });
+        if (mStopping) return;
+        Task* const task = mTasks.front();
+        const size_t index = takeIndexLocked(task);
+        lock.unlock();
+        (*task->part)(index);
+        lock.lock();
+        // `task` is gone once its caller sees the last part done.
+        if (--task->running == 0) mPartDone.notify_all();
+    }
+}
+
+}  // namespace android::hardware::neuralnetworks::utils
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <nnapi/hal/CurrentObject.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+namespace {
+
+constexpr int kAlive = 0x600d;
+
+struct Object {
+    ~Object() { state = 0; }
+    std::atomic<int> state = kAlive;
+};
+
+using SharedObject = std::shared_ptr<const Object>;
+
+}  // namespace
+
+TEST(CurrentObjectTest, pin) {
+    // setup call
+    const auto object = std::make_shared<const Object>();
+    const CurrentObject<Object> current(object.get());
+
+    // run test
+    const auto pin = current.pin();
+
+    // verify result
+    EXPECT_EQ(pin.get(), object.get());
+}
+
+TEST(CurrentObjectTest, replaceWithoutPins) {
+    // setup call
+    auto object = std::make_shared<const Object>();
+    const std::weak_ptr<const Object> weakObject = object;
+    const auto replacement = std::make_shared<const Object>();
+    CurrentObject<Object> current(object.get());
+
+    // run test
+    current.replace(replacement.get(), std::move(object));
+
+    // verify result
+    EXPECT_TRUE(weakObject.expired());
+    EXPECT_EQ(current.pin().get(), replacement.get());
+}
+
+TEST(CurrentObjectTest, replaceKeepsPinnedObject) {
+    // setup call
+    auto object = std::make_shared<const Object>();
+    const std::weak_ptr<const Object> weakObject = object;
+    const auto replacement = std::make_shared<const Object>();
+    CurrentObject<Object> current(object.get());
+    auto pin = std::make_unique<CurrentObject<Object>::Pin>(current.pin());
+
+    // run test
+    current.replace(replacement.get(), std::move(object));
+
+    // verify result
+    EXPECT_FALSE(weakObject.expired());
+    EXPECT_EQ((*pin)->state, kAlive);
+    EXPECT_EQ(current.pin().get(), replacement.get());
+    pin.reset();
+    EXPECT_TRUE(weakObject.expired());
+}
+
+TEST(CurrentObjectTest, overlappingPinsDelayFreeing) {
+    // setup call
+    auto object = std::make_shared<const Object>();
+    const std::weak_ptr<const Object> weakObject = object;
+    const auto replacement = std::make_shared<const Object>();
+    CurrentObject<Object> current(object.get());
+    auto pinBeforeReplace = std::make_unique<CurrentObject<Object>::Pin>(current.pin());
+    current.replace(replacement.get(), std::move(object));
+    auto pinAfterReplace = std::make_unique<CurrentObject<Object>::Pin>(current.pin());
+
+    // run test
+    pinBeforeReplace.reset();
+
+    // verify result
+    EXPECT_FALSE(weakObject.expired());
+    pinAfterReplace.reset();
+    EXPECT_TRUE(weakObject.expired());
+}
+
+TEST(CurrentObjectTest, concurrentPinsAndReplaces) {
+    // setup call
+    constexpr int kReaders = 4;
+    constexpr int kReplacements = 1000;
+    auto owned = std::make_shared<const Object>();
+    CurrentObject<Object> current(owned.get());
+    std::atomic_bool done = false;
+    std::atomic_bool sawFreedObject = false;
+
+    // run test
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; ++i) {
+        readers.emplace_back([&current, &done, &sawFreedObject] {
+            while (!done) {
+                const auto pin = current.pin();
+                for (int j = 0; j < 10; ++j) {
+                    if (pin->state != kAlive) sawFreedObject = true;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < kReplacements; ++i) {
+        auto replacement = std::make_shared<const Object>();
+        std::swap(owned, replacement);
+        current.replace(owned.get(), std::move(replacement));
+    }
+    done = true;
+    for (auto& reader : readers) reader.join();
+
+    // verify result
+    EXPECT_FALSE(sawFreedObject);
+}
+
+}  // namespace android::hardware::neuralnetworks::utils
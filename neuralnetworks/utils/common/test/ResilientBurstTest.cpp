@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <nnapi/TypeUtils.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/ResilientBurst.h>
+#include <utility>
+#include "MockBurst.h"
+
+namespace android::hardware::neuralnetworks::utils {
+namespace {
+
+using ::testing::_;
+using ::testing::Return;
+
+using SharedMockBurst = std::shared_ptr<const nn::MockBurst>;
+using MockBurstFactory = ::testing::MockFunction<nn::GeneralResult<nn::SharedBurst>()>;
+
+SharedMockBurst createMockBurst() {
+    return std::make_shared<const nn::MockBurst>();
+}
+
+std::tuple<SharedMockBurst, std::unique_ptr<MockBurstFactory>,
+           std::shared_ptr<const ResilientBurst>>
+setup() {
+    auto mockBurst = std::make_shared<const nn::MockBurst>();
+
+    auto mockBurstFactory = std::make_unique<MockBurstFactory>();
+    EXPECT_CALL(*mockBurstFactory, Call()).Times(1).WillOnce(Return(mockBurst));
+
+    auto burst = ResilientBurst::create(mockBurstFactory->AsStdFunction()).value();
+    return std::make_tuple(std::move(mockBurst), std::move(mockBurstFactory), std::move(burst));
+}
+
+constexpr auto makeError = [](nn::ErrorStatus status) {
+    return [status](const auto&... /*args*/) { return nn::error(status); };
+};
+const auto kReturnGeneralFailure = makeError(nn::ErrorStatus::GENERAL_FAILURE);
+const auto kReturnDeadObject = makeError(nn::ErrorStatus::DEAD_OBJECT);
+
+const auto kNoExecutionError =
+        nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>>{};
+const auto kNoCreateReusableExecutionError = nn::GeneralResult<nn::SharedExecution>{};
+
+}  // namespace
+
+TEST(ResilientBurstTest, invalidBurstFactory) {
+    // setup call
+    const auto invalidBurstFactory = ResilientBurst::Factory{};
+
+    // run test
+    const auto result = ResilientBurst::create(invalidBurstFactory);
+
+    // verify result
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().code, nn::ErrorStatus::INVALID_ARGUMENT);
+}
+
+TEST(ResilientBurstTest, burstFactoryFailure) {
+    // setup call
+    const auto invalidBurstFactory = kReturnGeneralFailure;
+
+    // run test
+    const auto result = ResilientBurst::create(invalidBurstFactory);
+
+    // verify result
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().code, nn::ErrorStatus::GENERAL_FAILURE);
+}
+
+TEST(ResilientBurstTest, getBurst) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+
+    // run test
+    const auto result = burst->getBurst();
+
+    // verify result
+    EXPECT_TRUE(result == mockBurst);
+}
+
+TEST(ResilientBurstTest, execute) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    EXPECT_CALL(*mockBurst, execute(_, _, _, _, _, _)).Times(1).WillOnce(Return(kNoExecutionError));
+
+    // run test
+    const auto result = burst->execute({}, {}, {}, {}, {}, {});
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+}
+
+TEST(ResilientBurstTest, executeError) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    EXPECT_CALL(*mockBurst, execute(_, _, _, _, _, _)).Times(1).WillOnce(kReturnGeneralFailure);
+
+    // run test
+    const auto result = burst->execute({}, {}, {}, {}, {}, {});
+
+    // verify result
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().code, nn::ErrorStatus::GENERAL_FAILURE);
+}
+
+TEST(ResilientBurstTest, executeDeadObjectFailedRecovery) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    EXPECT_CALL(*mockBurst, execute(_, _, _, _, _, _)).Times(1).WillOnce(kReturnDeadObject);
+    EXPECT_CALL(*mockBurstFactory, Call()).Times(1).WillOnce(kReturnGeneralFailure);
+
+    // run test
+    const auto result = burst->execute({}, {}, {}, {}, {}, {});
+
+    // verify result
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().code, nn::ErrorStatus::DEAD_OBJECT);
+}
+
+TEST(ResilientBurstTest, executeDeadObjectSuccessfulRecovery) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    EXPECT_CALL(*mockBurst, execute(_, _, _, _, _, _)).Times(1).WillOnce(kReturnDeadObject);
+    const auto recoveredMockBurst = createMockBurst();
+    EXPECT_CALL(*recoveredMockBurst, execute(_, _, _, _, _, _))
+            .Times(1)
+            .WillOnce(Return(kNoExecutionError));
+    EXPECT_CALL(*mockBurstFactory, Call()).Times(1).WillOnce(Return(recoveredMockBurst));
+
+    // run test
+    const auto result = burst->execute({}, {}, {}, {}, {}, {});
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+    EXPECT_TRUE(burst->getBurst() == recoveredMockBurst);
+}
+
+TEST(ResilientBurstTest, createReusableExecution) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    EXPECT_CALL(*mockBurst, createReusableExecution(_, _, _, _, _))
+            .Times(1)
+            .WillOnce(Return(kNoCreateReusableExecutionError));
+
+    // run test
+    const auto result = burst->createReusableExecution({}, {}, {}, {}, {});
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+}
+
+TEST(ResilientBurstTest, createReusableExecutionDeadObjectSuccessfulRecovery) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    EXPECT_CALL(*mockBurst, createReusableExecution(_, _, _, _, _))
+            .Times(1)
+            .WillOnce(kReturnDeadObject);
+    const auto recoveredMockBurst = createMockBurst();
+    EXPECT_CALL(*recoveredMockBurst, createReusableExecution(_, _, _, _, _))
+            .Times(1)
+            .WillOnce(Return(kNoCreateReusableExecutionError));
+    EXPECT_CALL(*mockBurstFactory, Call()).Times(1).WillOnce(Return(recoveredMockBurst));
+
+    // run test
+    const auto result = burst->createReusableExecution({}, {}, {}, {}, {});
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+}
+
+TEST(ResilientBurstTest, recover) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    const auto recoveredMockBurst = createMockBurst();
+    EXPECT_CALL(*mockBurstFactory, Call()).Times(1).WillOnce(Return(recoveredMockBurst));
+
+    // run test
+    const auto result = burst->recover(mockBurst.get());
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+    EXPECT_TRUE(result.value() == recoveredMockBurst);
+    EXPECT_EQ(burst->pinCurrentBurst().get(), recoveredMockBurst.get());
+}
+
+TEST(ResilientBurstTest, recoverFailure) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    EXPECT_CALL(*mockBurstFactory, Call()).Times(1).WillOnce(kReturnGeneralFailure);
+
+    // run test
+    const auto result = burst->recover(mockBurst.get());
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+    EXPECT_EQ(burst->pinCurrentBurst().get(), mockBurst.get());
+}
+
+TEST(ResilientBurstTest, someoneElseRecovered) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    const auto recoveredMockBurst = createMockBurst();
+    EXPECT_CALL(*mockBurstFactory, Call()).Times(1).WillOnce(Return(recoveredMockBurst));
+    burst->recover(mockBurst.get());
+
+    // run test
+    const auto result = burst->recover(mockBurst.get());
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+    EXPECT_TRUE(result.value() == recoveredMockBurst);
+}
+
+TEST(ResilientBurstTest, replacedBurstOutlivesTheCallsUsingIt) {
+    // setup call
+    const auto [mockBurst, mockBurstFactory, burst] = setup();
+    EXPECT_CALL(*mockBurst, execute(_, _, _, _, _, _)).Times(1).WillOnce(kReturnDeadObject);
+    const auto recoveredMockBurst = createMockBurst();
+    EXPECT_CALL(*mockBurstFactory, Call()).Times(1).WillOnce(Return(recoveredMockBurst));
+    const long useCountBeforeCall = mockBurst.use_count();
+    long useCountDuringCall = 0;
+    EXPECT_CALL(*recoveredMockBurst, execute(_, _, _, _, _, _))
+            .Times(1)
+            .WillOnce([&mockBurst = mockBurst, &useCountDuringCall](const auto&... /*args*/) {
+                useCountDuringCall = mockBurst.use_count();
+                return kNoExecutionError;
+            });
+
+    // run test
+    const auto result = burst->execute({}, {}, {}, {}, {}, {});
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+    EXPECT_EQ(useCountDuringCall, useCountBeforeCall);
+    EXPECT_EQ(mockBurst.use_count(), useCountBeforeCall - 1);
+}
+
+}  // namespace android::hardware::neuralnetworks::utils
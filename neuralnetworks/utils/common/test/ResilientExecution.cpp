@@ -226,6 +226,7 @@ TEST(ResilientExecutionTest, recover) {
     ASSERT_TRUE(result.has_value())
             << "Failed with " << result.error().code << ": " << result.error().message;
     EXPECT_TRUE(result.value() == recoveredMockExecution);
+    EXPECT_EQ(execution->pinCurrentExecution().get(), recoveredMockExecution.get());
 }
 
 TEST(ResilientExecutionTest, recoverFailure) {
@@ -239,6 +240,7 @@ TEST(ResilientExecutionTest, recoverFailure) {
 
     // verify result
     EXPECT_FALSE(result.has_value());
+    EXPECT_EQ(execution->pinCurrentExecution().get(), mockExecution.get());
 }
 
 TEST(ResilientExecutionTest, someoneElseRecovered) {
@@ -257,4 +259,30 @@ TEST(ResilientExecutionTest, someoneElseRecovered) {
     EXPECT_TRUE(result.value() == recoveredMockExecution);
 }
 
+TEST(ResilientExecutionTest, replacedExecutionOutlivesTheCallsUsingIt) {
+    // setup call
+    const auto [mockExecution, mockExecutionFactory, execution] = setup();
+    EXPECT_CALL(*mockExecution, compute(_)).Times(1).WillOnce(kReturnDeadObject);
+    const auto recoveredMockExecution = createMockExecution();
+    EXPECT_CALL(*mockExecutionFactory, Call()).Times(1).WillOnce(Return(recoveredMockExecution));
+    const long useCountBeforeCall = mockExecution.use_count();
+    long useCountDuringCall = 0;
+    EXPECT_CALL(*recoveredMockExecution, compute(_))
+            .Times(1)
+            .WillOnce([&mockExecution = mockExecution,
+                       &useCountDuringCall](const nn::OptionalTimePoint& /*deadline*/) {
+                useCountDuringCall = mockExecution.use_count();
+                return kNoExecutionError;
+            });
+
+    // run test
+    const auto result = execution->compute({});
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+    EXPECT_EQ(useCountDuringCall, useCountBeforeCall);
+    EXPECT_EQ(mockExecution.use_count(), useCountBeforeCall - 1);
+}
+
 }  // namespace android::hardware::neuralnetworks::utils
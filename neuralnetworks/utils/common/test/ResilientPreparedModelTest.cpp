@@ -18,6 +18,7 @@
 #include <nnapi/TypeUtils.h>
 #include <nnapi/Types.h>
 #include <nnapi/hal/ResilientPreparedModel.h>
+#include <future>
 #include <utility>
 #include "MockPreparedModel.h"
 
@@ -296,6 +297,51 @@ TEST(ResilientPreparedModelTest, recover) {
     EXPECT_TRUE(result.value() == recoveredMockPreparedModel);
 }
 
+TEST(ResilientPreparedModelTest, pinCurrentPreparedModel) {
+    // setup call
+    const auto [mockPreparedModel, mockPreparedModelFactory, preparedModel] = setup();
+    const auto recoveredMockPreparedModel = createConfiguredMockPreparedModel();
+    EXPECT_CALL(*mockPreparedModelFactory, Call())
+            .Times(1)
+            .WillOnce(Return(recoveredMockPreparedModel));
+    const auto* currentBeforeRecovery = preparedModel->pinCurrentPreparedModel().get();
+
+    // run test
+    preparedModel->recover(mockPreparedModel.get());
+
+    // verify result
+    EXPECT_EQ(currentBeforeRecovery, mockPreparedModel.get());
+    EXPECT_EQ(preparedModel->pinCurrentPreparedModel().get(), recoveredMockPreparedModel.get());
+}
+
+TEST(ResilientPreparedModelTest, replacedPreparedModelOutlivesTheCallsUsingIt) {
+    // setup call
+    const auto [mockPreparedModel, mockPreparedModelFactory, preparedModel] = setup();
+    const auto recoveredMockPreparedModel = createConfiguredMockPreparedModel();
+    EXPECT_CALL(*mockPreparedModel, execute(_, _, _, _, _, _)).Times(1).WillOnce(kReturnDeadObject);
+    EXPECT_CALL(*mockPreparedModelFactory, Call())
+            .Times(1)
+            .WillOnce(Return(recoveredMockPreparedModel));
+    const long useCountBeforeCall = mockPreparedModel.use_count();
+    long useCountDuringCall = 0;
+    EXPECT_CALL(*recoveredMockPreparedModel, execute(_, _, _, _, _, _))
+            .Times(1)
+            .WillOnce([&mockPreparedModel = mockPreparedModel, &useCountDuringCall](
+                              const auto&... /*args*/) {
+                useCountDuringCall = mockPreparedModel.use_count();
+                return kNoExecutionError;
+            });
+
+    // run test
+    const auto result = preparedModel->execute({}, {}, {}, {}, {}, {});
+
+    // verify result
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+    EXPECT_EQ(useCountDuringCall, useCountBeforeCall);
+    EXPECT_EQ(mockPreparedModel.use_count(), useCountBeforeCall - 1);
+}
+
 TEST(ResilientPreparedModelTest, recoverFailure) {
     // setup call
     const auto [mockPreparedModel, mockPreparedModelFactory, preparedModel] = setup();
@@ -327,4 +373,38 @@ TEST(ResilientPreparedModelTest, someoneElseRecovered) {
     EXPECT_TRUE(result.value() == recoveredMockPreparedModel);
 }
 
+TEST(ResilientPreparedModelTest, recoverDoesNotBlockGetPreparedModel) {
+    // setup call
+    const auto [mockPreparedModel, mockPreparedModelFactory, preparedModel] = setup();
+    const auto recoveredMockPreparedModel = createConfiguredMockPreparedModel();
+    std::promise<void> recoveryStarted;
+    std::promise<void> finishRecovery;
+    EXPECT_CALL(*mockPreparedModelFactory, Call())
+            .Times(1)
+            .WillOnce([&]() -> nn::GeneralResult<nn::SharedPreparedModel> {
+                recoveryStarted.set_value();
+                finishRecovery.get_future().wait();
+                return recoveredMockPreparedModel;
+            });
+    auto recovery = std::async(std::launch::async, [&preparedModel = preparedModel,
+                                                    failing = mockPreparedModel.get()] {
+        return preparedModel->recover(failing);
+    });
+    recoveryStarted.get_future().wait();
+
+    // run test
+    const auto preparedModelDuringRecovery = preparedModel->getPreparedModel();
+    const auto* currentDuringRecovery = preparedModel->pinCurrentPreparedModel().get();
+    finishRecovery.set_value();
+    const auto result = recovery.get();
+
+    // verify result
+    EXPECT_TRUE(preparedModelDuringRecovery == mockPreparedModel);
+    EXPECT_EQ(currentDuringRecovery, mockPreparedModel.get());
+    ASSERT_TRUE(result.has_value())
+            << "Failed with " << result.error().code << ": " << result.error().message;
+    EXPECT_TRUE(result.value() == recoveredMockPreparedModel);
+    EXPECT_TRUE(preparedModel->getPreparedModel() == recoveredMockPreparedModel);
+}
+
 }  // namespace android::hardware::neuralnetworks::utils
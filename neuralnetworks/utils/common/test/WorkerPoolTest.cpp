@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <nnapi/hal/WorkerPool.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+
+TEST(WorkerPoolTest, runsEachPartOnce) {
+    // setup call
+    constexpr size_t kParts = 1000;
+    WorkerPool pool(3);
+    std::vector<std::atomic<int>> calls(kParts);
+
+    // run test
+    pool.run(kParts, [&calls](size_t index) { ++calls[index]; });
+
+    // verify result
+    for (size_t i = 0; i < kParts; ++i) {
+        EXPECT_EQ(calls[i], 1) << "part " << i;
+    }
+}
+
+TEST(WorkerPoolTest, runsWithoutWorkers) {
+    // setup call
+    WorkerPool pool(0);
+    std::vector<size_t> indexes;
+
+    // run test
+    pool.run(3, [&indexes](size_t index) { indexes.push_back(index); });
+
+    // verify result
+    EXPECT_EQ(indexes, (std::vector<size_t>{0, 1, 2}));
+}
+
+TEST(WorkerPoolTest, usesNoMoreThreadsThanItsWorkersAndTheCaller) {
+    // setup call
+    constexpr size_t kWorkers = 2;
+    WorkerPool pool(kWorkers);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+
+    // run test
+    for (int i = 0; i < 10; ++i) {
+        pool.run(100, [&mutex, &threads](size_t /*index*/) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            std::lock_guard guard(mutex);
+            threads.insert(std::this_thread::get_id());
+        });
+    }
+
+    // verify result
+    EXPECT_EQ(pool.getWorkerCount(), kWorkers);
+    EXPECT_LE(threads.size(), kWorkers + 1);
+    EXPECT_EQ(threads.count(std::this_thread::get_id()), 1u);
+}
+
+TEST(WorkerPoolTest, returnsOnceEveryPartReturned) {
+    // setup call
+    WorkerPool pool(4);
+    std::atomic<size_t> done = 0;
+
+    // run test
+    pool.run(8, [&done](size_t /*index*/) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ++done;
+    });
+
+    // verify result
+    EXPECT_EQ(done, 8u);
+}
+
+TEST(WorkerPoolTest, runsNestedTasks) {
+    // setup call
+    WorkerPool pool(2);
+    std::atomic<size_t> calls = 0;
+
+    // run test
+    pool.run(4, [&pool, &calls](size_t /*index*/) {
+        pool.run(4, [&calls](size_t /*index*/) { ++calls; });
+    });
+
+    // verify result
+    EXPECT_EQ(calls, 16u);
+}
+
+TEST(WorkerPoolTest, runsTasksOfConcurrentCallers) {
+    // setup call
+    constexpr int kCallers = 4;
+    constexpr size_t kParts = 500;
+    WorkerPool pool(2);
+    std::atomic<size_t> calls = 0;
+
+    // run test
+    std::vector<std::thread> callers;
+    for (int i = 0; i < kCallers; ++i) {
+        callers.emplace_back([&pool, &calls] {
+            for (int j = 0; j < 10; ++j) {
+                pool.run(kParts / 10, [&calls](size_t /*index*/) { ++calls; });
+            }
+        });
+    }
+    for (auto& caller : callers) caller.join();
+
+    // verify result
+    EXPECT_EQ(calls, kCallers * kParts);
+}
+
+TEST(WorkerPoolTest, sharedPoolIsBounded) {
+    EXPECT_LE(WorkerPool::get().getWorkerCount(), WorkerPool::kMaxSharedWorkers);
+    EXPECT_EQ(&WorkerPool::get(), &WorkerPool::get());
+}
+
+}  // namespace android::hardware::neuralnetworks::utils
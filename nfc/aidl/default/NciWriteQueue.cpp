@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NciWriteQueue.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include <android-base/logging.h>
+
+#include "Vendor_hal_api.h"
+
+namespace {
+// NCI packet header:
+//   octet 0: message type (bits 7-5), packet boundary flag (bit 4), group or connection id
+//   (bits 3-0)
+//   octet 1: opcode id (bits 5-0) of control packets
+//   octet 2: payload length
+constexpr size_t kNciHeaderSize = 3;
+constexpr uint8_t kMessageTypeShift = 5;
+constexpr uint8_t kMessageTypeData = 0;
+constexpr uint8_t kMessageTypeCommand = 1;
+constexpr uint8_t kMessageTypeResponse = 2;
+constexpr uint8_t kMessageTypeNotification = 3;
+constexpr uint8_t kPacketBoundaryFlag = 0x10;
+constexpr uint8_t kIdMask = 0x0f;
+constexpr uint8_t kOpcodeIdMask = 0x3f;
+constexpr size_t kMaxPayload = 0xff;
+
+constexpr uint8_t kGroupCore = 0x00;
+constexpr uint8_t kGroupRfManagement = 0x01;
+constexpr uint8_t kOpcodeCoreReset = 0x00;
+constexpr uint8_t kOpcodeCoreConnCreate = 0x04;
+constexpr uint8_t kOpcodeCoreConnClose = 0x05;
+constexpr uint8_t kOpcodeCoreConnCredits = 0x06;
+constexpr uint8_t kOpcodeRfIntfActivated = 0x05;
+constexpr uint8_t kOpcodeRfDeactivate = 0x06;
+
+// The connection to the activated remote endpoint.
+constexpr uint8_t kStaticRfConnId = 0x00;
+// Initial number of credits of a connection without data flow control.
+constexpr uint8_t kCreditsFlowControlNotUsed = 0xff;
+
+uint8_t messageType(const std::vector<uint8_t>& packet) {
+    return packet[0] >> kMessageTypeShift;
+}
+
+uint8_t id(const std::vector<uint8_t>& packet) {
+    return packet[0] & kIdMask;
+}
+
+bool isControl(const std::vector<uint8_t>& packet, uint8_t type, uint8_t group, uint8_t opcode) {
+    return messageType(packet) == type && id(packet) == group &&
+           (packet[1] & kOpcodeIdMask) == opcode;
+}
+}  // namespace
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace nfc {
+
+NciWriteQueue::~NciWriteQueue() {
+    stop();
+}
+
+void NciWriteQueue::start(ErrorHandler errorHandler) {
+    stop();
+    std::lock_guard<std::mutex> lock(mLock);
+    mRunning = true;
+    mWriteFailed = false;
+    mErrorHandler = std::move(errorHandler);
+    mConnections.clear();
+    mClosingConnId = -1;
+    mStartTime = Clock::now();
+    mPacketsQueued = 0;
+    mPacketsMerged = 0;
+    mPacketsDropped = 0;
+    mWrites = 0;
+    mWriteFailures = 0;
+    mBytesWritten = 0;
+    mWriteTime = Clock::duration::zero();
+    mMaxQueuedPackets = 0;
+    mWriter = std::thread(&NciWriteQueue::writerLoop, this);
+}
+
+void NciWriteQueue::stop() {
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        if (!mRunning) return;
+        // write() told the stack these packets were written, so they go out before the session
+        // ends, unless they wait for credits for too long.
+        mRoom.wait_for(lock, kDrainTimeout, [this] { return mQueuedPackets == 0 && !mWriting; });
+        mRunning = false;
+        dropQueuedLocked();
+    }
+    mQueued.notify_one();
+    mRoom.notify_all();
+    mWriter.join();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mErrorHandler = nullptr;
+    LOG(INFO) << "NCI session: " << mWrites << " writes of " << mBytesWritten << " bytes, "
+              << mPacketsMerged << " packets merged, " << mPacketsDropped << " dropped, "
+              << mWriteFailures << " failed";
+}
+
+int32_t NciWriteQueue::write(const std::vector<uint8_t>& packet) {
+    if (packet.size() < kNciHeaderSize || packet.size() != kNciHeaderSize + packet[2]) {
+        LOG(ERROR) << "Malformed NCI packet of " << packet.size() << " bytes";
+        return -1;
+    }
+    std::unique_lock<std::mutex> lock(mLock);
+    mRoom.wait(lock, [this] { return mQueuedPackets < kMaxQueuedPackets || !mRunning; });
+    if (!mRunning || mWriteFailed) return -1;
+
+    Packet queued{mNextSequence++, packet, nullptr};
+    if (messageType(packet) == kMessageTypeData) {
+        mConnections[id(packet)].pending.push_back(std::move(queued));
+    } else {
+        mControl.push_back(std::move(queued));
+    }
+    mQueuedPackets++;
+    mPacketsQueued++;
+    mMaxQueuedPackets = std::max(mMaxQueuedPackets, mQueuedPackets);
+    mQueued.notify_one();
+    return packet.size();
+}
+
+int NciWriteQueue::call(const std::function<int()>& function) {
+    std::unique_lock<std::mutex> lock(mLock);
+    if (!mRunning) {
+        lock.unlock();
+        return function();
+    }
+    auto call = std::make_shared<Call>();
+    call->function = function;
+    mControl.push_back({mNextSequence++, {}, call});
+    mQueuedPackets++;
+    mQueued.notify_one();
+    mCallDone.wait(lock, [&call] { return call->done; });
+    return call->result;
+}
+
+bool NciWriteQueue::takeNextLocked(Packet* packet) {
+    // The oldest packet that can be written: the first control packet, or the first data packet
+    // of a connection with credits.
+    std::deque<Packet>* queue = mControl.empty() ? nullptr : &mControl;
+    Connection* connection = nullptr;
+    for (auto& [connId, candidate] : mConnections) {
+        if (candidate.pending.empty() || candidate.credits == 0) continue;
+        if (queue == nullptr || candidate.pending.front().sequence < queue->front().sequence) {
+            queue = &candidate.pending;
+            connection = &candidate;
+        }
+    }
+    if (queue == nullptr) return false;
+
+    *packet = std::move(queue->front());
+    queue->pop_front();
+    mQueuedPackets--;
+    std::vector<uint8_t>& data = packet->data;
+
+    if (packet->call == nullptr && connection == nullptr) {
+        if (isControl(data, kMessageTypeCommand, kGroupCore, kOpcodeCoreConnClose) &&
+            data.size() > kNciHeaderSize) {
+            mClosingConnId = data[kNciHeaderSize];
+        }
+    } else if (connection != nullptr) {
+        // Segments of the same message can be merged, the controller reassembles them anyway.
+        while (data[0] & kPacketBoundaryFlag && !connection->pending.empty() &&
+               data[2] + connection->pending.front().data[2] <=
+                       std::min(connection->maxPayload, kMaxPayload)) {
+            const std::vector<uint8_t>& next = connection->pending.front().data;
+            data[0] = (data[0] & ~kPacketBoundaryFlag) | (next[0] & kPacketBoundaryFlag);
+            data[2] += next[2];
+            data.insert(data.end(), next.begin() + kNciHeaderSize, next.end());
+            connection->pending.pop_front();
+            mQueuedPackets--;
+            mPacketsMerged++;
+            if (connection->credits != kNoFlowControl) {
+                connection->owedCredits++;
+            }
+        }
+        if (connection->credits != kNoFlowControl) {
+            connection->credits--;
+        }
+    }
+    mRoom.notify_all();
+    return true;
+}
+
+void NciWriteQueue::writerLoop() {
+    Packet packet;
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        while (mRunning && !takeNextLocked(&packet)) {
+            mQueued.wait(lock);
+        }
+        if (!mRunning) break;
+        mWriting = true;
+
+        if (packet.call != nullptr) {
+            lock.unlock();
+            const int result = packet.call->function();
+            lock.lock();
+            packet.call->result = result;
+            packet.call->done = true;
+            packet.call = nullptr;
+            mCallDone.notify_all();
+            mWriting = false;
+            mRoom.notify_all();
+            continue;
+        }
+
+        const std::vector<uint8_t>& data = packet.data;
+        lock.unlock();
+        const Clock::time_point start = Clock::now();
+        const int ret = Vendor_hal_write(data.size(), data.data());
+        const Clock::duration writeTime = Clock::now() - start;
+        lock.lock();
+
+        mWrites++;
+        mWriteTime += writeTime;
+        bool failed = false;
+        if (ret == static_cast<int>(data.size())) {
+            mBytesWritten += data.size();
+        } else {
+            mWriteFailures++;
+            LOG(ERROR) << "Cannot write an NCI packet of " << data.size() << " bytes: " << ret;
+            // write() already reported the packets queued as written, so the stack is told
+            // through the error handler, and the next writes fail.
+            failed = !mWriteFailed;
+            mWriteFailed = true;
+        }
+        mWriting = false;
+        mRoom.notify_all();
+        if (failed && mErrorHandler != nullptr) {
+            ErrorHandler errorHandler = mErrorHandler;
+            lock.unlock();
+            errorHandler();
+            lock.lock();
+        }
+    }
+}
+
+void NciWriteQueue::onControllerPacket(std::vector<uint8_t>* packet) {
+    if (packet->size() < kNciHeaderSize || packet->size() < kNciHeaderSize + (*packet)[2]) return;
+    uint8_t* payload = packet->data() + kNciHeaderSize;
+    const size_t length = (*packet)[2];
+
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mRunning) return;
+    if (isControl(*packet, kMessageTypeNotification, kGroupCore, kOpcodeCoreConnCredits)) {
+        // Number of entries, then a connection id and its credits for each.
+        const size_t entries = length > 0 ? payload[0] : 0;
+        for (size_t i = 0; i < entries && 2 + 2 * i < length; i++) {
+            uint8_t* credits = &payload[2 + 2 * i];
+            auto it = mConnections.find(payload[1 + 2 * i] & kIdMask);
+            if (it == mConnections.end() || it->second.credits == kNoFlowControl) continue;
+            Connection& connection = it->second;
+            connection.credits += *credits;
+            const uint32_t handedBack = std::min<uint32_t>(connection.owedCredits, 0xff - *credits);
+            *credits += handedBack;
+            connection.owedCredits -= handedBack;
+        }
+        mQueued.notify_one();
+    } else if (isControl(*packet, kMessageTypeNotification, kGroupRfManagement,
+                         kOpcodeRfIntfActivated) &&
+               length >= 6) {
+        // RF discovery id, RF interface, RF protocol, activation RF technology and mode, then
+        // the largest data payload and initial credits of the static RF connection.
+        resetConnectionLocked(kStaticRfConnId);
+        Connection& connection = mConnections[kStaticRfConnId];
+        connection.maxPayload = payload[4];
+        connection.credits = payload[5] == kCreditsFlowControlNotUsed ? kNoFlowControl : payload[5];
+    } else if (isControl(*packet, kMessageTypeResponse, kGroupCore, kOpcodeCoreConnCreate) &&
+               length >= 4 && payload[0] == 0) {
+        // Status, the largest data payload, initial credits and connection id.
+        const uint8_t connId = payload[3] & kIdMask;
+        resetConnectionLocked(connId);
+        Connection& connection = mConnections[connId];
+        connection.maxPayload = payload[1];
+        connection.credits = payload[2] == kCreditsFlowControlNotUsed ? kNoFlowControl : payload[2];
+    } else if (isControl(*packet, kMessageTypeResponse, kGroupCore, kOpcodeCoreConnClose)) {
+        if (mClosingConnId >= 0) {
+            resetConnectionLocked(mClosingConnId);
+            mClosingConnId = -1;
+        }
+    } else if (messageType(*packet) != kMessageTypeData && id(*packet) == kGroupRfManagement &&
+               ((*packet)[1] & kOpcodeIdMask) == kOpcodeRfDeactivate) {
+        resetConnectionLocked(kStaticRfConnId);
+    } else if (messageType(*packet) != kMessageTypeData && id(*packet) == kGroupCore &&
+               ((*packet)[1] & kOpcodeIdMask) == kOpcodeCoreReset) {
+        resetConnectionsLocked();
+    }
+}
+
+void NciWriteQueue::resetConnectionLocked(uint8_t connId) {
+    auto it = mConnections.find(connId);
+    if (it == mConnections.end()) return;
+    // The controller would not take the data of a closed connection anymore.
+    mPacketsDropped += it->second.pending.size();
+    mQueuedPackets -= it->second.pending.size();
+    mConnections.erase(it);
+    mRoom.notify_all();
+}
+
+void NciWriteQueue::resetConnectionsLocked() {
+    while (!mConnections.empty()) {
+        resetConnectionLocked(mConnections.begin()->first);
+    }
+}
+
+void NciWriteQueue::dropQueuedLocked() {
+    for (Packet& packet : mControl) {
+        if (packet.call != nullptr) {
+            packet.call->done = true;
+        } else {
+            mPacketsDropped++;
+        }
+    }
+    mControl.clear();
+    for (const auto& [connId, connection] : mConnections) {
+        mPacketsDropped += connection.pending.size();
+    }
+    mConnections.clear();
+    mQueuedPackets = 0;
+    mCallDone.notify_all();
+}
+
+void NciWriteQueue::dump(int fd) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mRunning) {
+        dprintf(fd, "No NCI session\n");
+        return;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - mStartTime).count();
+    const double writeMs = std::chrono::duration<double, std::milli>(mWriteTime).count();
+    dprintf(fd, "%llu packets queued, %zu pending, %zu at most\n",
+            static_cast<unsigned long long>(mPacketsQueued), mQueuedPackets, mMaxQueuedPackets);
+    dprintf(fd, "%llu writes of %llu bytes in %.1f ms, %.1f writes/s over %.1f s\n",
+            static_cast<unsigned long long>(mWrites),
+            static_cast<unsigned long long>(mBytesWritten), writeMs,
+            seconds > 0 ? mWrites / seconds : 0.0, seconds);
+    dprintf(fd, "%llu packets merged, %llu dropped, %llu writes failed\n",
+            static_cast<unsigned long long>(mPacketsMerged),
+            static_cast<unsigned long long>(mPacketsDropped),
+            static_cast<unsigned long long>(mWriteFailures));
+    for (const auto& [connId, connection] : mConnections) {
+        if (connection.credits == kNoFlowControl) {
+            dprintf(fd, "connection %u: no flow control, %zu pending\n", connId,
+                    connection.pending.size());
+        } else {
+            dprintf(fd, "connection %u: %d credits, %u owed, %zu pending\n", connId,
+                    connection.credits, connection.owedCredits, connection.pending.size());
+        }
+    }
+}
+
+}  // namespace nfc
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace nfc {
+
+// Queues the NCI packets of a session, and writes them to the vendor HAL from a dedicated
+// writer thread, so that write() returns without waiting for the controller transfer.
+//
+// Data packets are only written while their logical connection has credits. The credits, and the
+// largest data payload of each connection, are learned from the packets of the controller seen by
+// onControllerPacket(). Control packets and the data of other connections are not held behind a
+// connection out of credits; the order is kept otherwise.
+//
+// Queued segments of the same data message are merged into fewer packets, as long as they fit in
+// the largest payload of the connection. The stack spent a credit for each of them, so the credits
+// saved are handed back through the next CORE_CONN_CREDITS_NTF of the connection.
+//
+// The other calls to the vendor HAL of a session go through call(), so that they are made in
+// order with the packets written before them.
+class NciWriteQueue {
+  public:
+    // write() waits for room beyond this many queued packets.
+    static constexpr size_t kMaxQueuedPackets = 256;
+    // stop() waits up to this long for the queued packets to be written, as data packets may
+    // wait for credits that never come.
+    static constexpr std::chrono::milliseconds kDrainTimeout{500};
+
+    // Called on the writer thread when the vendor HAL fails to write a packet.
+    using ErrorHandler = std::function<void()>;
+
+    NciWriteQueue() = default;
+    ~NciWriteQueue();
+
+    NciWriteQueue(const NciWriteQueue&) = delete;
+    NciWriteQueue& operator=(const NciWriteQueue&) = delete;
+
+    // Starts a session. Connections start without flow control until the controller grants
+    // credits.
+    void start(ErrorHandler errorHandler = nullptr);
+    // Writes the packets queued, or drops those not written within kDrainTimeout, and ends the
+    // session.
+    void stop();
+
+    // Returns the size of |packet| once queued, or -1 if it is not an NCI packet, there is no
+    // session, or a previous write of the session failed.
+    int32_t write(const std::vector<uint8_t>& packet);
+
+    // Runs |call| on the writer thread after the packets queued before it, and returns its
+    // result. Runs it right away when there is no session.
+    int call(const std::function<int()>& call);
+
+    // Updates the credits from a packet received from the controller, before the stack gets it.
+    void onControllerPacket(std::vector<uint8_t>* packet);
+
+    void dump(int fd);
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int kNoFlowControl = -1;
+
+    struct Call {
+        std::function<int()> function;
+        bool done = false;
+        int result = -1;
+    };
+
+    // A packet, or a call to make in its place.
+    struct Packet {
+        uint64_t sequence;
+        std::vector<uint8_t> data;
+        std::shared_ptr<Call> call;
+    };
+
+    struct Connection {
+        // kNoFlowControl, or the data packets the controller takes before granting more.
+        int credits = kNoFlowControl;
+        // The largest data payload, or 0 while unknown.
+        size_t maxPayload = 0;
+        // Credits the stack spent on segments merged away, not handed back yet.
+        uint32_t owedCredits = 0;
+        std::deque<Packet> pending;
+    };
+
+    void writerLoop();
+    // Takes the next packet that can be written, merged with the segments following it, or
+    // returns false. Called with mLock held.
+    bool takeNextLocked(Packet* packet);
+    void resetConnectionLocked(uint8_t connId);
+    void resetConnectionsLocked();
+    void dropQueuedLocked();
+
+    std::mutex mLock;
+    std::condition_variable mQueued;
+    // Notified when a packet is taken from the queue or written.
+    std::condition_variable mRoom;
+    std::condition_variable mCallDone;
+    // Guarded by mLock.
+    bool mRunning = false;
+    // A packet or call is in progress on the writer thread.
+    bool mWriting = false;
+    // Set by the first failed write of the session.
+    bool mWriteFailed = false;
+    ErrorHandler mErrorHandler;
+    uint64_t mNextSequence = 0;
+    std::deque<Packet> mControl;
+    std::map<uint8_t, Connection> mConnections;
+    size_t mQueuedPackets = 0;
+    // The connection of the CORE_CONN_CLOSE_CMD last written, closed by its response.
+    int mClosingConnId = -1;
+
+    // Statistics of the session, guarded by mLock.
+    Clock::time_point mStartTime;
+    uint64_t mPacketsQueued = 0;
+    uint64_t mPacketsMerged = 0;
+    uint64_t mPacketsDropped = 0;
+    uint64_t mWrites = 0;
+    uint64_t mWriteFailures = 0;
+    uint64_t mBytesWritten = 0;
+    Clock::duration mWriteTime{0};
+    size_t mMaxQueuedPackets = 0;
+
+    std::thread mWriter;
+};
+
+}  // namespace nfc
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "NciWriteQueue.h"
+
+using aidl::android::hardware::nfc::NciWriteQueue;
+
+namespace {
+
+// Stands for the vendor HAL, which the tests link in place of Vendor_hal_api.cpp.
+struct FakeVendorHal {
+    std::mutex lock;
+    std::condition_variable written;
+    std::vector<std::vector<uint8_t>> packets;
+    // Writes wait while it is set.
+    bool blocked = false;
+    int result = 0;  // 0 writes the whole packet.
+
+    void block() {
+        std::lock_guard<std::mutex> guard(lock);
+        blocked = true;
+    }
+
+    void unblock() {
+        std::lock_guard<std::mutex> guard(lock);
+        blocked = false;
+        written.notify_all();
+    }
+
+    bool waitForPackets(size_t count) {
+        std::unique_lock<std::mutex> guard(lock);
+        return written.wait_for(guard, std::chrono::seconds(1),
+                                [&] { return packets.size() >= count; });
+    }
+
+    std::vector<std::vector<uint8_t>> get() {
+        std::lock_guard<std::mutex> guard(lock);
+        return packets;
+    }
+};
+
+FakeVendorHal gVendorHal;
+
+// A data packet of connection 0.
+std::vector<uint8_t> data(std::vector<uint8_t> payload, bool segment = false) {
+    std::vector<uint8_t> packet = {static_cast<uint8_t>(segment ? 0x10 : 0x00), 0x00,
+                                   static_cast<uint8_t>(payload.size())};
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return packet;
+}
+
+// RF_INTF_ACTIVATED_NTF for the static RF connection, with its largest payload and credits.
+std::vector<uint8_t> activated(uint8_t maxPayload, uint8_t credits) {
+    return {0x61, 0x05, 6, 1, 2, 4, 0, maxPayload, credits};
+}
+
+// CORE_CONN_CREDITS_NTF for the static RF connection.
+std::vector<uint8_t> credits(uint8_t count) {
+    return {0x60, 0x06, 3, 1, 0, count};
+}
+
+const std::vector<uint8_t> kCommand = {0x20, 0x01, 0x00};
+const std::vector<uint8_t> kOtherCommand = {0x21, 0x02, 0x00};
+
+}  // namespace
+
+int Vendor_hal_write(uint16_t data_len, const uint8_t* p_data) {
+    std::unique_lock<std::mutex> guard(gVendorHal.lock);
+    gVendorHal.written.wait(guard, [] { return !gVendorHal.blocked; });
+    gVendorHal.packets.emplace_back(p_data, p_data + data_len);
+    gVendorHal.written.notify_all();
+    return gVendorHal.result == 0 ? data_len : gVendorHal.result;
+}
+
+class NciWriteQueueTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::lock_guard<std::mutex> guard(gVendorHal.lock);
+        gVendorHal.packets.clear();
+        gVendorHal.blocked = false;
+        gVendorHal.result = 0;
+    }
+
+    void TearDown() override {
+        gVendorHal.unblock();
+        mQueue.stop();
+    }
+
+    NciWriteQueue mQueue;
+};
+
+TEST_F(NciWriteQueueTest, WritesInOrder) {
+    mQueue.start();
+    EXPECT_EQ(3, mQueue.write(kCommand));
+    EXPECT_EQ(5, mQueue.write(data({1, 2})));
+    EXPECT_EQ(3, mQueue.write(kOtherCommand));
+
+    ASSERT_TRUE(gVendorHal.waitForPackets(3));
+    EXPECT_EQ(gVendorHal.get(),
+              (std::vector<std::vector<uint8_t>>{kCommand, data({1, 2}), kOtherCommand}));
+}
+
+TEST_F(NciWriteQueueTest, RejectsMalformedPacketsAndWritesWithoutSession) {
+    EXPECT_EQ(-1, mQueue.write(kCommand));
+    mQueue.start();
+    EXPECT_EQ(-1, mQueue.write({0x20, 0x01}));
+    EXPECT_EQ(-1, mQueue.write({0x20, 0x01, 0x02, 0x00}));
+}
+
+TEST_F(NciWriteQueueTest, HoldsDataWithoutCreditsOnly) {
+    mQueue.start();
+    std::vector<uint8_t> ntf = activated(255, 1);
+    mQueue.onControllerPacket(&ntf);
+
+    EXPECT_EQ(5, mQueue.write(data({1, 2})));
+    EXPECT_EQ(5, mQueue.write(data({3, 4})));
+    EXPECT_EQ(3, mQueue.write(kCommand));
+
+    // The second data packet waits for a credit, the command does not.
+    ASSERT_TRUE(gVendorHal.waitForPackets(2));
+    EXPECT_EQ(gVendorHal.get(), (std::vector<std::vector<uint8_t>>{data({1, 2}), kCommand}));
+
+    ntf = credits(1);
+    mQueue.onControllerPacket(&ntf);
+    ASSERT_TRUE(gVendorHal.waitForPackets(3));
+    EXPECT_EQ(gVendorHal.get()[2], data({3, 4}));
+}
+
+TEST_F(NciWriteQueueTest, MergesSegmentsAndHandsCreditsBack) {
+    mQueue.start();
+    std::vector<uint8_t> ntf = activated(6, 1);
+    mQueue.onControllerPacket(&ntf);
+
+    // Queued behind a blocked write, so that they are merged.
+    gVendorHal.block();
+    EXPECT_EQ(3, mQueue.write(kCommand));
+    EXPECT_EQ(5, mQueue.write(data({1, 2}, true)));
+    EXPECT_EQ(5, mQueue.write(data({3, 4}, true)));
+    EXPECT_EQ(5, mQueue.write(data({5, 6})));
+    gVendorHal.unblock();
+
+    ASSERT_TRUE(gVendorHal.waitForPackets(2));
+    EXPECT_EQ(gVendorHal.get()[1], data({1, 2, 3, 4, 5, 6}));
+
+    // The stack spent 3 credits on the segments, the controller got one packet.
+    ntf = credits(1);
+    mQueue.onControllerPacket(&ntf);
+    EXPECT_EQ(3, ntf[5]);
+}
+
+TEST_F(NciWriteQueueTest, StopWritesQueuedPackets) {
+    mQueue.start();
+    gVendorHal.block();
+    EXPECT_EQ(3, mQueue.write(kCommand));
+    EXPECT_EQ(3, mQueue.write(kOtherCommand));
+
+    std::thread unblocker([] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        gVendorHal.unblock();
+    });
+    mQueue.stop();
+    unblocker.join();
+
+    EXPECT_EQ(gVendorHal.get(), (std::vector<std::vector<uint8_t>>{kCommand, kOtherCommand}));
+}
+
+TEST_F(NciWriteQueueTest, StopDropsDataWaitingForCredits) {
+    mQueue.start();
+    std::vector<uint8_t> ntf = activated(255, 0);
+    mQueue.onControllerPacket(&ntf);
+    EXPECT_EQ(5, mQueue.write(data({1, 2})));
+
+    const auto start = std::chrono::steady_clock::now();
+    mQueue.stop();
+    EXPECT_GE(std::chrono::steady_clock::now() - start, NciWriteQueue::kDrainTimeout);
+    EXPECT_TRUE(gVendorHal.get().empty());
+}
+
+TEST_F(NciWriteQueueTest, CallRunsAfterQueuedPackets) {
+    mQueue.start();
+    gVendorHal.block();
+    EXPECT_EQ(3, mQueue.write(kCommand));
+
+    std::thread unblocker([] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        gVendorHal.unblock();
+    });
+    size_t writtenBefore = 0;
+    EXPECT_EQ(42, mQueue.call([&] {
+        writtenBefore = gVendorHal.get().size();
+        return 42;
+    }));
+    unblocker.join();
+    EXPECT_EQ(1u, writtenBefore);
+}
+
+TEST_F(NciWriteQueueTest, CallWithoutSessionRunsRightAway) {
+    EXPECT_EQ(7, mQueue.call([] { return 7; }));
+}
+
+TEST_F(NciWriteQueueTest, ReportsWriteFailures) {
+    std::atomic<int> errors = 0;
+    mQueue.start([&] { errors++; });
+    gVendorHal.result = -1;
+    EXPECT_EQ(3, mQueue.write(kCommand));
+    ASSERT_TRUE(gVendorHal.waitForPackets(1));
+    mQueue.call([] { return 0; });
+
+    EXPECT_EQ(1, errors);
+    EXPECT_EQ(-1, mQueue.write(kOtherCommand));
+
+    // A new session starts over.
+    gVendorHal.result = 0;
+    mQueue.start();
+    EXPECT_EQ(3, mQueue.write(kOtherCommand));
+}
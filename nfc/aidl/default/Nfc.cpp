@@ -26,6 +26,7 @@ namespace hardware {
 namespace nfc {
 
 std::shared_ptr<INfcClientCallback> Nfc::mCallback = nullptr;
+NciWriteQueue Nfc::mWriteQueue;
 AIBinder_DeathRecipient* clientDeathRecipient = nullptr;
 
 void OnDeath(void* cookie) {
@@ -53,7 +54,15 @@ void OnDeath(void* cookie) {
         // Just ignore the error.
     }
 
+    // Before the vendor HAL is opened, so that no packet of the controller is missed.
+    mWriteQueue.start([] {
+        eventCallback(static_cast<uint8_t>(NfcEvent::ERROR),
+                      static_cast<uint8_t>(NfcStatus::FAILED));
+    });
     int ret = Vendor_hal_open(eventCallback, dataCallback);
+    if (ret != 0) {
+        mWriteQueue.stop();
+    }
     return ret == 0 ? ndk::ScopedAStatus::ok()
                     : ndk::ScopedAStatus::fromServiceSpecificError(
                               static_cast<int32_t>(NfcStatus::FAILED));
@@ -66,6 +75,8 @@ void OnDeath(void* cookie) {
         return ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(NfcStatus::FAILED));
     }
+    // Writes the packets of the stack still queued first.
+    mWriteQueue.stop();
     int ret = 0;
     if (type == NfcCloseType::HOST_SWITCHED_OFF) {
         ret = Vendor_hal_close_off();
@@ -87,7 +98,7 @@ void OnDeath(void* cookie) {
         return ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(NfcStatus::FAILED));
     }
-    int ret = Vendor_hal_core_initialized();
+    int ret = mWriteQueue.call(Vendor_hal_core_initialized);
 
     return ret == 0 ? ndk::ScopedAStatus::ok()
                     : ndk::ScopedAStatus::fromServiceSpecificError(
@@ -116,9 +127,11 @@ void OnDeath(void* cookie) {
         return ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(NfcStatus::FAILED));
     }
-    return Vendor_hal_power_cycle() ? ndk::ScopedAStatus::fromServiceSpecificError(
-                                              static_cast<int32_t>(NfcStatus::FAILED))
-                                    : ndk::ScopedAStatus::ok();
+    int ret = mWriteQueue.call(Vendor_hal_power_cycle);
+
+    return ret == 0 ? ndk::ScopedAStatus::ok()
+                    : ndk::ScopedAStatus::fromServiceSpecificError(
+                              static_cast<int32_t>(NfcStatus::FAILED));
 }
 
 ::ndk::ScopedAStatus Nfc::preDiscover() {
@@ -128,9 +141,11 @@ void OnDeath(void* cookie) {
         return ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(NfcStatus::FAILED));
     }
-    return Vendor_hal_pre_discover() ? ndk::ScopedAStatus::fromServiceSpecificError(
-                                               static_cast<int32_t>(NfcStatus::FAILED))
-                                     : ndk::ScopedAStatus::ok();
+    int ret = mWriteQueue.call(Vendor_hal_pre_discover);
+
+    return ret == 0 ? ndk::ScopedAStatus::ok()
+                    : ndk::ScopedAStatus::fromServiceSpecificError(
+                              static_cast<int32_t>(NfcStatus::FAILED));
 }
 
 ::ndk::ScopedAStatus Nfc::write(const std::vector<uint8_t>& data, int32_t* _aidl_return) {
@@ -140,7 +155,7 @@ void OnDeath(void* cookie) {
         return ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(NfcStatus::FAILED));
     }
-    *_aidl_return = Vendor_hal_write(data.size(), &data[0]);
+    *_aidl_return = mWriteQueue.write(data);
     return ndk::ScopedAStatus::ok();
 }
 ::ndk::ScopedAStatus Nfc::setEnableVerboseLogging(bool enable) {
@@ -154,6 +169,11 @@ void OnDeath(void* cookie) {
     return ndk::ScopedAStatus::ok();
 }
 
+binder_status_t Nfc::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    mWriteQueue.dump(fd);
+    return STATUS_OK;
+}
+
 }  // namespace nfc
 }  // namespace hardware
 }  // namespace android
@@ -19,6 +19,9 @@
 #include <aidl/android/hardware/nfc/BnNfc.h>
 #include <aidl/android/hardware/nfc/INfcClientCallback.h>
 #include <android-base/logging.h>
+
+#include "NciWriteQueue.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -44,6 +47,8 @@ struct Nfc : public BnNfc {
     ::ndk::ScopedAStatus setEnableVerboseLogging(bool enable) override;
     ::ndk::ScopedAStatus isVerboseLoggingEnabled(bool* _aidl_return) override;
 
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
     static void eventCallback(uint8_t event, uint8_t status) {
         if (mCallback != nullptr) {
             auto ret = mCallback->sendEvent((NfcEvent)event, (NfcStatus)status);
@@ -55,6 +60,7 @@ struct Nfc : public BnNfc {
 
     static void dataCallback(uint16_t data_len, uint8_t* p_data) {
         std::vector<uint8_t> data(p_data, p_data + data_len);
+        mWriteQueue.onControllerPacket(&data);
         if (mCallback != nullptr) {
             auto ret = mCallback->sendData(data);
             if (!ret.isOk()) {
@@ -64,6 +70,8 @@ struct Nfc : public BnNfc {
     }
 
     static std::shared_ptr<INfcClientCallback> mCallback;
+    // Writes the packets of the stack in the background.
+    static NciWriteQueue mWriteQueue;
 };
 
 }  // namespace nfc
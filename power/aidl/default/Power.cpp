@@ -18,6 +18,10 @@
 
 #include <android-base/logging.h>
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -28,6 +32,8 @@ namespace example {
 const std::vector<Boost> BOOST_RANGE{ndk::enum_range<Boost>().begin(),
                                      ndk::enum_range<Boost>().end()};
 const std::vector<Mode> MODE_RANGE{ndk::enum_range<Mode>().begin(), ndk::enum_range<Mode>().end()};
+// How often clients should report actual work durations: once per frame at 60Hz
+const int64_t HINT_SESSION_PREFERRED_RATE_NS = 16666666;
 
 ndk::ScopedAStatus Power::setMode(Mode type, bool enabled) {
     LOG(VERBOSE) << "Power setMode: " << static_cast<int32_t>(type) << " to: " << enabled;
@@ -52,15 +58,53 @@ ndk::ScopedAStatus Power::isBoostSupported(Boost type, bool* _aidl_return) {
     return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Power::createHintSession(int32_t, int32_t, const std::vector<int32_t>&, int64_t,
+ndk::ScopedAStatus Power::createHintSession(int32_t tgid, int32_t uid,
+                                            const std::vector<int32_t>& threadIds,
+                                            int64_t durationNanos,
                                             std::shared_ptr<IPowerHintSession>* _aidl_return) {
-    *_aidl_return = nullptr;
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    if (threadIds.empty() || durationNanos <= 0) {
+        LOG(ERROR) << "Power createHintSession: " << threadIds.size()
+                   << " threads, duration: " << durationNanos;
+        *_aidl_return = nullptr;
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    auto session =
+            ndk::SharedRefBase::make<PowerHintSession>(tgid, uid, threadIds, durationNanos);
+    {
+        std::lock_guard<std::mutex> lock(mSessionsMutex);
+        mSessions.erase(std::remove_if(mSessions.begin(), mSessions.end(),
+                                       [](const auto& s) { return s.expired(); }),
+                        mSessions.end());
+        mSessions.push_back(session);
+    }
+    *_aidl_return = session;
+    return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Power::getHintSessionPreferredRate(int64_t* outNanoseconds) {
-    *outNanoseconds = -1;
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    *outNanoseconds = HINT_SESSION_PREFERRED_RATE_NS;
+    return ndk::ScopedAStatus::ok();
+}
+
+binder_status_t Power::dump(int fd, const char**, uint32_t) {
+    std::vector<std::shared_ptr<PowerHintSession>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(mSessionsMutex);
+        for (const auto& weak : mSessions) {
+            if (auto session = weak.lock()) {
+                sessions.push_back(std::move(session));
+            }
+        }
+    }
+
+    dprintf(fd, "%zu hint sessions, preferred rate %" PRId64 " ns\n", sessions.size(),
+            HINT_SESSION_PREFERRED_RATE_NS);
+    // The sessions take their own locks
+    for (const auto& session : sessions) {
+        session->dumpInternal(fd);
+    }
+    return STATUS_OK;
 }
 
 }  // namespace example
@@ -17,6 +17,13 @@
 #pragma once
 
 #include <aidl/android/hardware/power/BnPower.h>
+#include <android-base/thread_annotations.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "PowerHintSession.h"
 
 namespace aidl {
 namespace android {
@@ -35,6 +42,11 @@ class Power : public BnPower {
                                          int64_t durationNanos,
                                          std::shared_ptr<IPowerHintSession>* _aidl_return) override;
     ndk::ScopedAStatus getHintSessionPreferredRate(int64_t* outNanoseconds) override;
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+    std::mutex mSessionsMutex;
+    // Kept for dump(); the clients own the sessions
+    std::vector<std::weak_ptr<PowerHintSession>> mSessions GUARDED_BY(mSessionsMutex);
 };
 
 }  // namespace example
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PowerHintSession.h"
+
+#include <android-base/logging.h>
+#include <linux/sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace example {
+
+namespace {
+
+constexpr int32_t kUclampMax = 1024;
+// The controller output has to move this far before it is written to the threads
+constexpr int32_t kUclampStep = 32;
+// Gains applied to the relative error (actual - target) / target, which is clamped to [-1, 1]
+// so that a single stalled frame cannot saturate the controller: a frame taking twice its
+// target adds kIGain to the integral, an idle one takes it away again.
+constexpr float kPGain = 512;
+constexpr float kIGain = 64;
+// Weight of a new sample in Stats::actualAvgNs, as a power of two
+constexpr int kAvgShift = 3;
+
+// The sched_attr layout of the kernels with uclamp; bionic has neither it nor the wrappers
+struct SchedAttr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+    uint32_t sched_util_min;
+    uint32_t sched_util_max;
+};
+
+bool getUclampMin(int32_t tid, int32_t* uclampMin) {
+    SchedAttr attr{};
+    if (syscall(__NR_sched_getattr, tid, &attr, sizeof(attr), 0 /* flags */) != 0) {
+        return false;
+    }
+    *uclampMin = static_cast<int32_t>(attr.sched_util_min);
+    return true;
+}
+
+bool setUclampMin(int32_t tid, int32_t uclampMin) {
+    SchedAttr attr{
+            .size = sizeof(attr),
+            .sched_flags = SCHED_FLAG_KEEP_ALL | SCHED_FLAG_UTIL_CLAMP_MIN,
+            .sched_util_min = static_cast<uint32_t>(uclampMin),
+    };
+    return syscall(__NR_sched_setattr, tid, &attr, 0 /* flags */) == 0;
+}
+
+}  // namespace
+
+PowerHintSession::PowerHintSession(int32_t tgid, int32_t uid,
+                                   const std::vector<int32_t>& threadIds, int64_t durationNanos)
+    : mTgid(tgid),
+      mUid(uid),
+      mThreadIds(threadIds),
+      mTargetNs(durationNanos),
+      mReadUclamp(getUclampMin),
+      mWriteUclamp(setUclampMin) {}
+
+PowerHintSession::~PowerHintSession() {
+    close();
+}
+
+ndk::ScopedAStatus PowerHintSession::updateTargetWorkDuration(int64_t targetDurationNanos) {
+    if (targetDurationNanos <= 0) {
+        LOG(WARNING) << "Ignoring target duration " << targetDurationNanos;
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTargetNs = targetDurationNanos;
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowerHintSession::reportActualWorkDuration(
+        const std::vector<WorkDuration>& durations) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mClosed || mPaused || durations.empty()) {
+        return ndk::ScopedAStatus::ok();
+    }
+
+    ++mStats.reports;
+    const float target = static_cast<float>(mTargetNs);
+    float error = 0;
+    for (const auto& duration : durations) {
+        const int64_t actual = duration.durationNanos;
+        if (actual <= 0) {
+            continue;
+        }
+        ++mStats.samples;
+        mStats.actualAvgNs += (actual - mStats.actualAvgNs) >> kAvgShift;
+        if (actual > mTargetNs) {
+            const int64_t overrun = actual - mTargetNs;
+            ++mStats.overruns;
+            mStats.overrunSumNs += overrun;
+            mStats.overrunMaxNs = std::max(mStats.overrunMaxNs, overrun);
+        }
+
+        error = std::clamp((actual - mTargetNs) / target, -1.0f, 1.0f);
+        mIntegral = std::clamp(mIntegral + kIGain * error, 0.0f, static_cast<float>(kUclampMax));
+    }
+
+    // The proportional term only follows the latest sample of the batch
+    mOutput = std::clamp(static_cast<int32_t>(mIntegral + kPGain * error), 0, kUclampMax);
+    if (std::abs(mOutput - mApplied) >= kUclampStep || (mOutput == 0 && mApplied != 0)) {
+        applyUclampLocked(mOutput);
+    }
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowerHintSession::pause() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mClosed || mPaused) {
+        return ndk::ScopedAStatus::ok();
+    }
+    mPaused = true;
+    applyUclampLocked(0);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowerHintSession::resume() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mClosed || !mPaused) {
+        return ndk::ScopedAStatus::ok();
+    }
+    mPaused = false;
+    // Pick up where the controller left off
+    applyUclampLocked(mOutput);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowerHintSession::close() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mClosed) {
+        return ndk::ScopedAStatus::ok();
+    }
+    mClosed = true;
+    applyUclampLocked(0);
+    return ndk::ScopedAStatus::ok();
+}
+
+void PowerHintSession::applyUclampLocked(int32_t uclampMin) {
+    if (uclampMin == mApplied) {
+        return;
+    }
+    if (uclampMin == 0) {
+        for (const auto& [tid, original] : mOriginalUclamp) {
+            writeUclampLocked(tid, original);
+        }
+        mOriginalUclamp.clear();
+    } else {
+        for (const int32_t tid : mThreadIds) {
+            if (mOriginalUclamp.count(tid) == 0) {
+                int32_t original = 0;
+                // A thread that cannot be read fails the write below as well
+                mReadUclamp(tid, &original);
+                mOriginalUclamp[tid] = original;
+            }
+            writeUclampLocked(tid, uclampMin);
+        }
+    }
+    mApplied = uclampMin;
+}
+
+void PowerHintSession::writeUclampLocked(int32_t tid, int32_t uclampMin) {
+    ++mStats.uclampWrites;
+    if (!mWriteUclamp(tid, uclampMin)) {
+        // Threads exit without telling the session; this is only worth a message once
+        if (mStats.uclampWriteFailures++ == 0) {
+            PLOG(WARNING) << "Cannot set uclamp.min of tid " << tid << " to " << uclampMin;
+        }
+    }
+}
+
+void PowerHintSession::setUclampAccessorsForTesting(UclampReader reader, UclampWriter writer) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mReadUclamp = std::move(reader);
+    mWriteUclamp = std::move(writer);
+}
+
+PowerHintSession::Stats PowerHintSession::getStats() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void PowerHintSession::dumpInternal(int fd) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    dprintf(fd,
+            "Session tgid %d uid %d, %zu threads, %s: target %" PRId64 " ns, actual avg %" PRId64
+            " ns, uclamp.min %d (controller %d, integral %.1f)\n",
+            mTgid, mUid, mThreadIds.size(),
+            mClosed ? "closed" : (mPaused ? "paused" : "active"), mTargetNs, mStats.actualAvgNs,
+            mApplied, mOutput, mIntegral);
+    dprintf(fd,
+            "  %" PRIu64 " reports, %" PRIu64 " samples, %" PRIu64 " overruns (avg %" PRId64
+            " ns, max %" PRId64 " ns), %" PRIu64 " uclamp writes, %" PRIu64 " failed\n",
+            mStats.reports, mStats.samples, mStats.overruns,
+            mStats.overruns ? mStats.overrunSumNs / static_cast<int64_t>(mStats.overruns) : 0,
+            mStats.overrunMaxNs, mStats.uclampWrites, mStats.uclampWriteFailures);
+}
+
+}  // namespace example
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
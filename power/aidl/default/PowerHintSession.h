@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/power/BnPowerHintSession.h>
+#include <aidl/android/hardware/power/WorkDuration.h>
+#include <android-base/thread_annotations.h>
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace example {
+
+// A hint session boosting its thread group through uclamp.min. Every reported work duration
+// feeds a PI controller on the relative error against the target duration; its output, in
+// uclamp units, is written to the session threads only when it moves by a whole step, so
+// steady workloads cost no syscalls. Pausing or closing the session gives each thread back the
+// uclamp.min it had before the session first boosted it.
+class PowerHintSession : public BnPowerHintSession {
+  public:
+    struct Stats {
+        uint64_t reports = 0;
+        uint64_t samples = 0;
+        // Samples whose actual duration exceeded the target
+        uint64_t overruns = 0;
+        int64_t overrunSumNs = 0;
+        int64_t overrunMaxNs = 0;
+        // Exponential moving average of the actual durations
+        int64_t actualAvgNs = 0;
+        uint64_t uclampWrites = 0;
+        uint64_t uclampWriteFailures = 0;
+    };
+
+    PowerHintSession(int32_t tgid, int32_t uid, const std::vector<int32_t>& threadIds,
+                     int64_t durationNanos);
+    ~PowerHintSession() override;
+
+    ndk::ScopedAStatus updateTargetWorkDuration(int64_t targetDurationNanos) override;
+    ndk::ScopedAStatus reportActualWorkDuration(
+            const std::vector<WorkDuration>& durations) override;
+    ndk::ScopedAStatus pause() override;
+    ndk::ScopedAStatus resume() override;
+    ndk::ScopedAStatus close() override;
+
+    void dumpInternal(int fd);
+    Stats getStats();
+
+    using UclampReader = std::function<bool(int32_t tid, int32_t* uclampMin)>;
+    using UclampWriter = std::function<bool(int32_t tid, int32_t uclampMin)>;
+    // Replaces the sched_getattr and sched_setattr calls on the session threads
+    void setUclampAccessorsForTesting(UclampReader reader, UclampWriter writer);
+
+  private:
+    // Writes uclamp.min to every session thread, keeping their other attributes. Zero gives the
+    // threads back their original value.
+    void applyUclampLocked(int32_t uclampMin) REQUIRES(mMutex);
+    void writeUclampLocked(int32_t tid, int32_t uclampMin) REQUIRES(mMutex);
+
+    const int32_t mTgid;
+    const int32_t mUid;
+    const std::vector<int32_t> mThreadIds;
+
+    std::mutex mMutex;
+    int64_t mTargetNs GUARDED_BY(mMutex);
+    bool mPaused GUARDED_BY(mMutex) = false;
+    bool mClosed GUARDED_BY(mMutex) = false;
+    // Controller state, in uclamp units
+    float mIntegral GUARDED_BY(mMutex) = 0;
+    int32_t mOutput GUARDED_BY(mMutex) = 0;
+    // The value last written to the threads
+    int32_t mApplied GUARDED_BY(mMutex) = 0;
+    // The uclamp.min of each thread before its first write, while boosted
+    std::unordered_map<int32_t, int32_t> mOriginalUclamp GUARDED_BY(mMutex);
+    UclampReader mReadUclamp GUARDED_BY(mMutex);
+    UclampWriter mWriteUclamp GUARDED_BY(mMutex);
+    Stats mStats GUARDED_BY(mMutex);
+};
+
+}  // namespace example
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PowerHintSession.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace example {
+namespace {
+
+constexpr int64_t kTargetNs = 16000000;
+
+class PowerHintSessionTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Threads 1 and 2 start with a boost of their own, thread 3 without.
+        mUclamp = {{1, 100}, {2, 300}, {3, 0}};
+        mSession = ndk::SharedRefBase::make<PowerHintSession>(1000, 10000,
+                                                              std::vector<int32_t>{1, 2, 3},
+                                                              kTargetNs);
+        mSession->setUclampAccessorsForTesting(
+                [this](int32_t tid, int32_t* uclampMin) {
+                    ++mReads;
+                    *uclampMin = mUclamp.at(tid);
+                    return true;
+                },
+                [this](int32_t tid, int32_t uclampMin) {
+                    mUclamp.at(tid) = uclampMin;
+                    return true;
+                });
+    }
+
+    void report(int64_t durationNanos) {
+        const std::vector<WorkDuration> durations = {WorkDuration{.durationNanos = durationNanos}};
+        ASSERT_TRUE(mSession->reportActualWorkDuration(durations).isOk());
+    }
+
+    std::map<int32_t, int32_t> mUclamp;
+    int mReads = 0;
+    std::shared_ptr<PowerHintSession> mSession;
+};
+
+TEST_F(PowerHintSessionTest, BoostsOverrunningThreads) {
+    report(2 * kTargetNs);
+
+    EXPECT_GT(mUclamp.at(1), 100);
+    EXPECT_EQ(mUclamp.at(1), mUclamp.at(2));
+    EXPECT_EQ(mUclamp.at(1), mUclamp.at(3));
+}
+
+TEST_F(PowerHintSessionTest, PauseRestoresTheOriginalUclamp) {
+    report(2 * kTargetNs);
+
+    ASSERT_TRUE(mSession->pause().isOk());
+
+    EXPECT_EQ(mUclamp, (std::map<int32_t, int32_t>{{1, 100}, {2, 300}, {3, 0}}));
+}
+
+TEST_F(PowerHintSessionTest, CloseRestoresTheOriginalUclamp) {
+    report(2 * kTargetNs);
+
+    ASSERT_TRUE(mSession->close().isOk());
+
+    EXPECT_EQ(mUclamp, (std::map<int32_t, int32_t>{{1, 100}, {2, 300}, {3, 0}}));
+}
+
+TEST_F(PowerHintSessionTest, RestoresTheUclampReadBeforeTheFirstBoost) {
+    report(2 * kTargetNs);
+    report(2 * kTargetNs);
+    report(2 * kTargetNs);
+
+    ASSERT_TRUE(mSession->close().isOk());
+
+    EXPECT_EQ(3, mReads);
+    EXPECT_EQ(mUclamp, (std::map<int32_t, int32_t>{{1, 100}, {2, 300}, {3, 0}}));
+}
+
+TEST_F(PowerHintSessionTest, ResumeBoostsAgain) {
+    report(2 * kTargetNs);
+    const int32_t boost = mUclamp.at(1);
+    ASSERT_TRUE(mSession->pause().isOk());
+
+    ASSERT_TRUE(mSession->resume().isOk());
+
+    EXPECT_EQ(boost, mUclamp.at(1));
+    ASSERT_TRUE(mSession->pause().isOk());
+    EXPECT_EQ(100, mUclamp.at(1));
+}
+
+TEST_F(PowerHintSessionTest, RestoresTheOriginalUclampOnceTheControllerSettles) {
+    report(2 * kTargetNs);
+
+    // Idle frames wind the controller back down to no boost at all.
+    for (int i = 0; i < 10 && mUclamp.at(1) != 100; ++i) {
+        report(1);
+    }
+
+    EXPECT_EQ(mUclamp, (std::map<int32_t, int32_t>{{1, 100}, {2, 300}, {3, 0}}));
+}
+
+TEST_F(PowerHintSessionTest, DoesNotWriteWhileUnboosted) {
+    ASSERT_TRUE(mSession->pause().isOk());
+    ASSERT_TRUE(mSession->close().isOk());
+
+    EXPECT_EQ(0, mReads);
+    EXPECT_EQ(0u, mSession->getStats().uclampWrites);
+}
+
+}  // namespace
+}  // namespace example
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -24,8 +24,12 @@
 #include <android-base/strings.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <algorithm>
+#include <charconv>
 #include <exception>
+#include <string_view>
 #include <thread>
 
 namespace android {
@@ -44,6 +48,50 @@ constexpr char kDeviceName[] = "pm_device_name";
 constexpr char kDeviceType[] = "iio:device";
 constexpr uint32_t MAX_SAMPLING_RATE = 10;
 constexpr uint64_t WRITE_TIMEOUT_NS = 1000000000;
+constexpr size_t MAX_ENERGY_STREAMS = 8;
+constexpr size_t MIN_ENERGY_BUFFER_SIZE = 4096;
+
+static uint64_t monotonicTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Parses a decimal value like strtoull does, without needing a null terminated string.
+static uint64_t parseUint64(std::string_view s) {
+    size_t start = s.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+        return 0;
+    }
+    uint64_t value = 0;
+    auto [ptr, ec] = std::from_chars(s.data() + start, s.data() + s.size(), value);
+    if (ec == std::errc::result_out_of_range) {
+        return ULLONG_MAX;
+    }
+    return ec == std::errc() ? value : 0;
+}
+
+// Reads the whole file from offset 0 into data, reusing its storage across calls.
+static bool readFromStart(int fd, std::string* data) {
+    size_t size = 0;
+    while (true) {
+        if (data->capacity() - size < MIN_ENERGY_BUFFER_SIZE / 2) {
+            data->reserve(std::max(data->capacity() * 2, MIN_ENERGY_BUFFER_SIZE));
+        }
+        data->resize(data->capacity());
+        ssize_t n = TEMP_FAILURE_RETRY(pread(fd, data->data() + size, data->size() - size, size));
+        if (n < 0) {
+            data->clear();
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        size += n;
+    }
+    data->resize(size);
+    return true;
+}
 
 void PowerStats::findIioPowerMonitorNodes() {
     struct dirent* ent;
@@ -123,42 +171,60 @@ size_t PowerStats::parsePowerRails() {
     return index;
 }
 
-int PowerStats::parseIioEnergyNode(std::string devName) {
+void PowerStats::openIioEnergyNodes() {
+    for (const auto& path : mPm.devicePaths) {
+        std::string fileName = path + "/energy_value";
+        android::base::unique_fd fd(
+                TEMP_FAILURE_RETRY(open(fileName.c_str(), O_RDONLY | O_CLOEXEC)));
+        if (!fd.ok()) {
+            ALOGE("Error opening file: %s", fileName.c_str());
+        }
+        mPm.energyFds.push_back(std::move(fd));
+    }
+}
+
+int PowerStats::parseIioEnergyNode(size_t deviceIndex) {
     int ret = 0;
-    std::string data;
-    std::string fileName = devName + "/energy_value";
-    if (!android::base::ReadFileToString(fileName, &data)) {
-        ALOGE("Error reading file: %s", fileName.c_str());
+    std::string& data = mPm.energyBuffer;
+    const std::string& devName = mPm.devicePaths[deviceIndex];
+    int fd = mPm.energyFds[deviceIndex].get();
+    if (fd < 0 || !readFromStart(fd, &data)) {
+        ALOGE("Error reading file: %s/energy_value", devName.c_str());
         return -1;
     }
 
-    std::istringstream energyData(data);
-    std::string line;
+    // The first line holds the timestamp, each following line is "<rail name>,<energy>".
+    std::string_view energyData(data);
     uint64_t timestamp = 0;
     bool timestampRead = false;
-    while (std::getline(energyData, line)) {
-        std::vector<std::string> words = android::base::Split(line, ",");
+    while (!energyData.empty()) {
+        size_t eol = energyData.find('\n');
+        std::string_view line = energyData.substr(0, eol);
+        energyData.remove_prefix(eol == std::string_view::npos ? energyData.size() : eol + 1);
+
+        size_t comma = line.find(',');
         if (timestampRead == false) {
-            if (words.size() == 1) {
-                timestamp = strtoull(words[0].c_str(), NULL, 10);
+            if (comma == std::string_view::npos) {
+                timestamp = parseUint64(line);
                 if (timestamp == 0 || timestamp == ULLONG_MAX) {
                     ALOGW("Potentially wrong timestamp: %" PRIu64, timestamp);
                 }
                 timestampRead = true;
             }
-        } else if (words.size() == 2) {
-            std::string railName = words[0];
-            if (mPm.railsInfo.count(railName) != 0) {
-                size_t index = mPm.railsInfo[railName].index;
+        } else if (comma != std::string_view::npos &&
+                   line.find(',', comma + 1) == std::string_view::npos) {
+            auto railInfo = mPm.railsInfo.find(line.substr(0, comma));
+            if (railInfo != mPm.railsInfo.end()) {
+                size_t index = railInfo->second.index;
                 mPm.reading[index].index = index;
                 mPm.reading[index].timestamp = timestamp;
-                mPm.reading[index].energy = strtoull(words[1].c_str(), NULL, 10);
+                mPm.reading[index].energy = parseUint64(line.substr(comma + 1));
                 if (mPm.reading[index].energy == ULLONG_MAX) {
                     ALOGW("Potentially wrong energy value: %" PRIu64, mPm.reading[index].energy);
                 }
             }
         } else {
-            ALOGW("Unexpected format in file: %s", fileName.c_str());
+            ALOGW("Unexpected format in file: %s/energy_value", devName.c_str());
             ret = -1;
             break;
         }
@@ -172,8 +238,8 @@ Status PowerStats::parseIioEnergyNodes() {
         return Status::NOT_SUPPORTED;
     }
 
-    for (const auto& devicePath : mPm.devicePaths) {
-        if (parseIioEnergyNode(devicePath) < 0) {
+    for (size_t i = 0; i < mPm.devicePaths.size(); i++) {
+        if (parseIioEnergyNode(i) < 0) {
             ALOGE("Error in parsing power stats");
             ret = Status::FILESYSTEM_ERROR;
             break;
@@ -190,7 +256,22 @@ PowerStats::PowerStats() {
     } else {
         mPm.hwEnabled = true;
         mPm.reading.resize(numRails);
+        openIioEnergyNodes();
+    }
+}
+
+PowerStats::~PowerStats() {
+    {
+        std::lock_guard<std::mutex> _lock(mStreamLock);
+        if (!mSamplerThread.joinable()) {
+            return;
+        }
+        mSamplerExit = true;
+        // Fire the timer right away to wake the sampler up.
+        struct itimerspec spec = {.it_value = {.tv_sec = 0, .tv_nsec = 1}};
+        timerfd_settime(mTimerFd.get(), 0, &spec, nullptr);
     }
+    mSamplerThread.join();
 }
 
 Return<void> PowerStats::getRailInfo(getRailInfo_cb _hidl_cb) {
@@ -248,48 +329,121 @@ Return<void> PowerStats::getEnergyData(const hidl_vec<uint32_t>& railIndices,
 
 Return<void> PowerStats::streamEnergyData(uint32_t timeMs, uint32_t samplingRate,
                                           streamEnergyData_cb _hidl_cb) {
-    std::lock_guard<std::mutex> _lock(mPm.mLock);
-    if (mPm.fmqSynchronized != nullptr) {
-        _hidl_cb(MessageQueueSync::Descriptor(), 0, 0, Status::INSUFFICIENT_RESOURCES);
+    uint32_t sps = std::min(samplingRate, MAX_SAMPLING_RATE);
+    if (sps == 0) {
+        _hidl_cb(MessageQueueSync::Descriptor(), 0, 0, Status::INVALID_INPUT);
         return Void();
     }
-    uint32_t sps = std::min(samplingRate, MAX_SAMPLING_RATE);
     uint32_t numSamples = timeMs * sps / 1000;
-    mPm.fmqSynchronized.reset(new (std::nothrow) MessageQueueSync(MAX_QUEUE_SIZE, true));
-    if (mPm.fmqSynchronized == nullptr || mPm.fmqSynchronized->isValid() == false) {
-        mPm.fmqSynchronized = nullptr;
+    size_t numRails;
+    {
+        std::lock_guard<std::mutex> _lock(mPm.mLock);
+        if (mPm.hwEnabled == false) {
+            _hidl_cb(MessageQueueSync::Descriptor(), 0, 0, Status::NOT_SUPPORTED);
+            return Void();
+        }
+        numRails = mPm.reading.size();
+    }
+
+    std::lock_guard<std::mutex> _lock(mStreamLock);
+    if (mStreams.size() >= MAX_ENERGY_STREAMS) {
         _hidl_cb(MessageQueueSync::Descriptor(), 0, 0, Status::INSUFFICIENT_RESOURCES);
         return Void();
     }
-    std::thread pollThread = std::thread([this, sps, numSamples]() {
-        uint64_t sleepTimeUs = 1000000 / sps;
-        uint32_t currSamples = 0;
-        while (currSamples < numSamples) {
-            mPm.mLock.lock();
-            if (parseIioEnergyNodes() == Status::SUCCESS) {
-                mPm.fmqSynchronized->writeBlocking(&mPm.reading[0], mPm.reading.size(),
-                                                   WRITE_TIMEOUT_NS);
-                mPm.mLock.unlock();
-                currSamples++;
-                if (usleep(sleepTimeUs) < 0) {
-                    ALOGW("Sleep interrupted");
-                    break;
-                }
-            } else {
-                mPm.mLock.unlock();
-                break;
-            }
+    std::unique_ptr<MessageQueueSync> fmq(new (std::nothrow)
+                                                  MessageQueueSync(MAX_QUEUE_SIZE, true));
+    if (fmq == nullptr || fmq->isValid() == false) {
+        _hidl_cb(MessageQueueSync::Descriptor(), 0, 0, Status::INSUFFICIENT_RESOURCES);
+        return Void();
+    }
+
+    // All streams are served by one sampler thread, woken up by a timerfd when the next sample
+    // of any stream is due.
+    if (!mSamplerThread.joinable()) {
+        mTimerFd.reset(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC));
+        if (!mTimerFd.ok()) {
+            ALOGE("Failed to create sampler timer: %s", strerror(errno));
+            _hidl_cb(MessageQueueSync::Descriptor(), 0, 0, Status::INSUFFICIENT_RESOURCES);
+            return Void();
         }
-        mPm.mLock.lock();
-        mPm.fmqSynchronized = nullptr;
-        mPm.mLock.unlock();
-        return;
-    });
-    pollThread.detach();
-    _hidl_cb(*(mPm.fmqSynchronized)->getDesc(), numSamples, mPm.reading.size(), Status::SUCCESS);
+        mSamplerThread = std::thread([this]() { samplerLoop(); });
+    }
+
+    _hidl_cb(*fmq->getDesc(), numSamples, numRails, Status::SUCCESS);
+    if (numSamples > 0) {
+        mStreams.push_back({.fmqSynchronized = std::move(fmq),
+                            .samplesLeft = numSamples,
+                            .periodNs = 1000000000 / sps,
+                            .nextSampleNs = monotonicTimeNs()});
+        armSamplerTimerLocked();
+    }
     return Void();
 }
 
+void PowerStats::armSamplerTimerLocked() {
+    struct itimerspec spec = {};
+    if (!mStreams.empty()) {
+        uint64_t nextSampleNs = mStreams[0].nextSampleNs;
+        for (const auto& stream : mStreams) {
+            nextSampleNs = std::min(nextSampleNs, stream.nextSampleNs);
+        }
+        // A zero it_value disarms the timer, the earliest deadline is at least 1ns.
+        spec.it_value.tv_sec = nextSampleNs / 1000000000;
+        spec.it_value.tv_nsec = std::max<uint64_t>(nextSampleNs % 1000000000, 1);
+    }
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        ALOGE("Failed to arm sampler timer: %s", strerror(errno));
+    }
+}
+
+void PowerStats::samplerLoop() {
+    std::vector<EnergyData> sample;
+    while (true) {
+        uint64_t expirations;
+        if (TEMP_FAILURE_RETRY(read(mTimerFd.get(), &expirations, sizeof(expirations))) < 0) {
+            ALOGE("Failed to read sampler timer: %s", strerror(errno));
+            return;
+        }
+
+        // One read of the energy nodes serves every stream that is due.
+        bool sampled;
+        {
+            std::lock_guard<std::mutex> _lock(mPm.mLock);
+            sampled = parseIioEnergyNodes() == Status::SUCCESS;
+            if (sampled) {
+                sample = mPm.reading;
+            }
+        }
+
+        std::lock_guard<std::mutex> _lock(mStreamLock);
+        if (mSamplerExit) {
+            return;
+        }
+        if (!sampled) {
+            ALOGE("Failed to sample energy data, ending %zu streams", mStreams.size());
+            mStreams.clear();
+            continue;
+        }
+        uint64_t now = monotonicTimeNs();
+        for (auto& stream : mStreams) {
+            if (stream.nextSampleNs > now) {
+                continue;
+            }
+            stream.fmqSynchronized->writeBlocking(sample.data(), sample.size(),
+                                                  std::min(WRITE_TIMEOUT_NS, stream.periodNs));
+            stream.samplesLeft--;
+            // Skip the samples that were missed rather than sending them in a burst.
+            do {
+                stream.nextSampleNs += stream.periodNs;
+            } while (stream.nextSampleNs <= now);
+        }
+        mStreams.erase(std::remove_if(mStreams.begin(), mStreams.end(),
+                                      [](const auto& stream) { return stream.samplesLeft == 0; }),
+                       mStreams.end());
+        armSamplerTimerLocked();
+    }
+}
+
 uint32_t PowerStats::addPowerEntity(const std::string& name, PowerEntityType type) {
     uint32_t id = mPowerEntityInfos.size();
     mPowerEntityInfos.push_back({id, name, type});
@@ -17,11 +17,17 @@
 #ifndef ANDROID_HARDWARE_POWERSTATS_V1_0_POWERSTATS_H
 #define ANDROID_HARDWARE_POWERSTATS_V1_0_POWERSTATS_H
 
+#include <android-base/unique_fd.h>
 #include <android/hardware/power/stats/1.0/IPowerStats.h>
 #include <fmq/MessageQueue.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 namespace hardware {
@@ -56,9 +62,20 @@ struct OnDeviceMmt {
     std::mutex mLock;
     bool hwEnabled;
     std::vector<std::string> devicePaths;
-    std::map<std::string, RailData> railsInfo;
+    // energy_value of each device path, kept open and re-read with pread.
+    std::vector<android::base::unique_fd> energyFds;
+    std::string energyBuffer;
+    // Transparent comparator, so that rails can be looked up by std::string_view.
+    std::map<std::string, RailData, std::less<>> railsInfo;
     std::vector<EnergyData> reading;
+};
+
+// One streamEnergyData client, fed by the shared sampler thread.
+struct EnergyStream {
     std::unique_ptr<MessageQueueSync> fmqSynchronized;
+    uint32_t samplesLeft;
+    uint64_t periodNs;
+    uint64_t nextSampleNs;
 };
 
 class IStateResidencyDataProvider {
@@ -72,6 +89,7 @@ class IStateResidencyDataProvider {
 struct PowerStats : public IPowerStats {
    public:
     PowerStats();
+    ~PowerStats();
     uint32_t addPowerEntity(const std::string& name, PowerEntityType type);
     void addStateResidencyDataProvider(std::shared_ptr<IStateResidencyDataProvider> p);
     // Methods from ::android::hardware::power::stats::V1_0::IPowerStats follow.
@@ -94,8 +112,20 @@ struct PowerStats : public IPowerStats {
     OnDeviceMmt mPm;
     void findIioPowerMonitorNodes();
     size_t parsePowerRails();
-    int parseIioEnergyNode(std::string devName);
+    void openIioEnergyNodes();
+    int parseIioEnergyNode(size_t deviceIndex);
     Status parseIioEnergyNodes();
+    // Arms mTimerFd for the earliest sample due among mStreams, disarms it if there is none.
+    void armSamplerTimerLocked();
+    void samplerLoop();
+
+    // Guards the streams and the sampler thread below.
+    std::mutex mStreamLock;
+    std::vector<EnergyStream> mStreams;
+    android::base::unique_fd mTimerFd;
+    std::thread mSamplerThread;
+    bool mSamplerExit = false;
+
     std::vector<PowerEntityInfo> mPowerEntityInfos;
     std::unordered_map<uint32_t, PowerEntityStateSpace> mPowerEntityStateSpaces;
     std::unordered_map<uint32_t, std::shared_ptr<IStateResidencyDataProvider>>
@@ -16,8 +16,15 @@
 
 #include "PowerStats.h"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
 #include <numeric>
 
 namespace aidl {
@@ -26,6 +33,95 @@ namespace hardware {
 namespace power {
 namespace stats {
 
+PowerStats::~PowerStats() {
+    {
+        std::lock_guard<std::mutex> lock(mRefreshLock);
+        mRefreshExit = true;
+    }
+    mRefreshCondition.notify_all();
+    if (mRefreshThread.joinable()) {
+        mRefreshThread.join();
+    }
+}
+
+void PowerStats::setSnapshotStaleness(std::chrono::milliseconds staleness) {
+    mSnapshotStaleness = std::chrono::duration_cast<Clock::duration>(staleness);
+    if (staleness > std::chrono::milliseconds::zero() && !mRefreshThread.joinable()) {
+        mRefreshThread = std::thread([this] { refreshLoop(); });
+    }
+    // A lower staleness takes effect on the refresher's next wake up.
+    mRefreshCondition.notify_all();
+}
+
+template <typename T, typename ReadFn>
+std::optional<T> PowerStats::getSnapshot(Snapshot<T>* snapshot, ReadFn read) {
+    // Taken before waiting for the lock, so that callers that wait for an ongoing read share its
+    // result even with a zero staleness.
+    const Clock::time_point requestTime = Clock::now();
+    std::lock_guard<std::mutex> lock(snapshot->lock);
+    snapshot->requestTime = std::max(snapshot->requestTime, requestTime);
+    if (snapshot->value.has_value() &&
+        requestTime - snapshot->readTime <= mSnapshotStaleness.load()) {
+        snapshot->hits++;
+        return snapshot->value;
+    }
+    snapshot->misses++;
+    snapshot->value = read();
+    snapshot->readTime = Clock::now();
+    return snapshot->value;
+}
+
+template <typename T, typename ReadFn>
+void PowerStats::refreshSnapshot(Snapshot<T>* snapshot, Clock::time_point since, ReadFn read) {
+    std::lock_guard<std::mutex> lock(snapshot->lock);
+    // Only keep the snapshots that were requested since the last refresh warm.
+    if (snapshot->requestTime < since) {
+        return;
+    }
+    snapshot->refreshes++;
+    snapshot->value = read();
+    snapshot->readTime = Clock::now();
+}
+
+std::optional<PowerStats::StateResidencyMap> PowerStats::readStateResidencies(
+        size_t providerIndex) {
+    StateResidencyMap stateResidencies;
+    if (!mStateResidencyDataProviders[providerIndex]->getStateResidencies(&stateResidencies)) {
+        return std::nullopt;
+    }
+    return stateResidencies;
+}
+
+void PowerStats::refreshLoop() {
+    Clock::time_point lastRefresh = Clock::now();
+    std::unique_lock<std::mutex> lock(mRefreshLock);
+    while (!mRefreshExit) {
+        const Clock::duration staleness = mSnapshotStaleness.load();
+        if (staleness == Clock::duration::zero()) {
+            mRefreshCondition.wait(lock);
+            continue;
+        }
+        // Refresh half way through the window, so that polling callers keep hitting the cache.
+        if (mRefreshCondition.wait_for(lock, staleness / 2) != std::cv_status::timeout) {
+            continue;
+        }
+        lock.unlock();
+
+        const Clock::time_point since = lastRefresh;
+        lastRefresh = Clock::now();
+        for (size_t i = 0; i < mStateResidencySnapshots.size(); i++) {
+            refreshSnapshot(mStateResidencySnapshots[i].get(), since,
+                            [this, i] { return readStateResidencies(i); });
+        }
+        for (size_t i = 0; i < mEnergyConsumedSnapshots.size(); i++) {
+            refreshSnapshot(mEnergyConsumedSnapshots[i].get(), since,
+                            [this, i] { return mEnergyConsumers[i]->getEnergyConsumed(); });
+        }
+
+        lock.lock();
+    }
+}
+
 void PowerStats::addStateResidencyDataProvider(std::unique_ptr<IStateResidencyDataProvider> p) {
     if (!p) {
         return;
@@ -36,6 +132,12 @@ void PowerStats::addStateResidencyDataProvider(std::unique_ptr<IStateResidencyDa
 
     size_t index = mStateResidencyDataProviders.size();
     mStateResidencyDataProviders.emplace_back(std::move(p));
+    std::vector<std::string> entityNames;
+    for (const auto& [entityName, states] : info) {
+        entityNames.emplace_back(entityName);
+    }
+    mStateResidencySnapshots.emplace_back(std::make_unique<Snapshot<StateResidencyMap>>(
+            ::android::base::Join(entityNames, ",")));
 
     for (const auto& [entityName, states] : info) {
         PowerEntity i = {
@@ -61,6 +163,7 @@ void PowerStats::addEnergyConsumer(std::unique_ptr<IEnergyConsumer> p) {
     mEnergyConsumerInfos.emplace_back(
             EnergyConsumer{.id = id, .ordinal = count, .type = type, .name = name});
     mEnergyConsumers.emplace_back(std::move(p));
+    mEnergyConsumedSnapshots.emplace_back(std::make_unique<Snapshot<EnergyConsumerResult>>(name));
 }
 
 void PowerStats::setEnergyMeter(std::unique_ptr<IEnergyMeter> p) {
@@ -96,8 +199,12 @@ ndk::ScopedAStatus PowerStats::getStateResidency(const std::vector<int32_t>& in_
         // Check to see if we already have data for the given id
         std::string powerEntityName = mPowerEntityInfos[id].name;
         if (stateResidencies.find(powerEntityName) == stateResidencies.end()) {
-            mStateResidencyDataProviders.at(mStateResidencyDataProviderIndex.at(id))
-                    ->getStateResidencies(&stateResidencies);
+            size_t providerIndex = mStateResidencyDataProviderIndex.at(id);
+            auto read = [this, providerIndex] { return readStateResidencies(providerIndex); };
+            auto snapshot = getSnapshot(mStateResidencySnapshots.at(providerIndex).get(), read);
+            if (snapshot.has_value()) {
+                stateResidencies.merge(*snapshot);
+            }
         }
 
         // Append results if we have them
@@ -141,7 +248,9 @@ ndk::ScopedAStatus PowerStats::getEnergyConsumed(const std::vector<int32_t>& in_
             return ndk::ScopedAStatus(AStatus_fromExceptionCode(EX_ILLEGAL_ARGUMENT));
         }
 
-        auto optionalResult = mEnergyConsumers[id]->getEnergyConsumed();
+        auto optionalResult = getSnapshot(mEnergyConsumedSnapshots[id].get(), [this, id] {
+            return mEnergyConsumers[id]->getEnergyConsumed();
+        });
         if (optionalResult) {
             EnergyConsumerResult result = optionalResult.value();
             result.id = id;
@@ -172,6 +281,45 @@ ndk::ScopedAStatus PowerStats::readEnergyMeter(const std::vector<int32_t>& in_ch
     return mEnergyMeter->readEnergyMeter(in_channelIds, _aidl_return);
 }
 
+template <typename T>
+void PowerStats::dumpSnapshot(Clock::time_point now, const char* kind, Snapshot<T>* snapshot,
+                              std::string* out) {
+    std::lock_guard<std::mutex> lock(snapshot->lock);
+    std::string age = "none";
+    if (snapshot->value.has_value()) {
+        age = ::android::base::StringPrintf(
+                "%lldms", static_cast<long long>(
+                                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                                          now - snapshot->readTime)
+                                          .count()));
+    }
+    ::android::base::StringAppendF(out,
+                                   "  %s %s: age=%s hits=%" PRIu64 " misses=%" PRIu64
+                                   " refreshes=%" PRIu64 "\n",
+                                   kind, snapshot->name.c_str(), age.c_str(), snapshot->hits,
+                                   snapshot->misses, snapshot->refreshes);
+}
+
+binder_status_t PowerStats::dump(int fd, const char**, uint32_t) {
+    const Clock::time_point now = Clock::now();
+    std::string out = ::android::base::StringPrintf(
+            "Snapshot staleness: %lldms\n",
+            static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           mSnapshotStaleness.load())
+                                           .count()));
+    for (const auto& snapshot : mStateResidencySnapshots) {
+        dumpSnapshot(now, "StateResidency", snapshot.get(), &out);
+    }
+    for (const auto& snapshot : mEnergyConsumedSnapshots) {
+        dumpSnapshot(now, "EnergyConsumer", snapshot.get(), &out);
+    }
+    if (!::android::base::WriteStringToFd(out, fd)) {
+        PLOG(ERROR) << "Failed to dump state to fd";
+    }
+    fsync(fd);
+    return STATUS_OK;
+}
+
 }  // namespace stats
 }  // namespace power
 }  // namespace hardware
@@ -18,6 +18,13 @@
 
 #include <aidl/android/hardware/power/stats/BnPowerStats.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <unordered_map>
 
 namespace aidl {
@@ -54,11 +61,18 @@ class PowerStats : public BnPowerStats {
     };
 
     PowerStats() = default;
+    ~PowerStats();
 
     void addStateResidencyDataProvider(std::unique_ptr<IStateResidencyDataProvider> p);
     void addEnergyConsumer(std::unique_ptr<IEnergyConsumer> p);
     void setEnergyMeter(std::unique_ptr<IEnergyMeter> p);
 
+    // State residencies and consumed energy read from the hardware are shared by all callers for
+    // up to |staleness|, and a background thread refreshes the ones that are being polled. With
+    // the default of zero only callers that overlap with an ongoing read share its result.
+    // Must be called after all providers and consumers have been added.
+    void setSnapshotStaleness(std::chrono::milliseconds staleness);
+
     // Methods from aidl::android::hardware::power::stats::IPowerStats
     ndk::ScopedAStatus getPowerEntityInfo(std::vector<PowerEntity>* _aidl_return) override;
     ndk::ScopedAStatus getStateResidency(const std::vector<int32_t>& in_powerEntityIds,
@@ -70,7 +84,39 @@ class PowerStats : public BnPowerStats {
     ndk::ScopedAStatus readEnergyMeter(const std::vector<int32_t>& in_channelIds,
                                        std::vector<EnergyMeasurement>* _aidl_return) override;
 
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
   private:
+    using Clock = std::chrono::steady_clock;
+
+    // Last successful read of one provider or consumer.
+    template <typename T>
+    struct Snapshot {
+        explicit Snapshot(std::string name) : name(std::move(name)) {}
+
+        const std::string name;
+        std::mutex lock;
+        // Guarded by lock
+        std::optional<T> value;
+        Clock::time_point readTime;
+        Clock::time_point requestTime;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t refreshes = 0;
+    };
+    using StateResidencyMap = std::unordered_map<std::string, std::vector<StateResidency>>;
+
+    // Returns the snapshot value, calling read() if it is older than the staleness.
+    template <typename T, typename ReadFn>
+    std::optional<T> getSnapshot(Snapshot<T>* snapshot, ReadFn read);
+    template <typename T, typename ReadFn>
+    void refreshSnapshot(Snapshot<T>* snapshot, Clock::time_point since, ReadFn read);
+    std::optional<StateResidencyMap> readStateResidencies(size_t providerIndex);
+    void refreshLoop();
+    template <typename T>
+    static void dumpSnapshot(Clock::time_point now, const char* kind, Snapshot<T>* snapshot,
+                             std::string* out);
+
     std::vector<std::unique_ptr<IStateResidencyDataProvider>> mStateResidencyDataProviders;
     std::vector<PowerEntity> mPowerEntityInfos;
     /* Index that maps each power entity id to an entry in mStateResidencyDataProviders */
@@ -80,6 +126,16 @@ class PowerStats : public BnPowerStats {
     std::vector<EnergyConsumer> mEnergyConsumerInfos;
 
     std::unique_ptr<IEnergyMeter> mEnergyMeter;
+
+    std::vector<std::unique_ptr<Snapshot<StateResidencyMap>>> mStateResidencySnapshots;
+    std::vector<std::unique_ptr<Snapshot<EnergyConsumerResult>>> mEnergyConsumedSnapshots;
+
+    std::atomic<Clock::duration> mSnapshotStaleness = Clock::duration::zero();
+    // Guards mRefreshExit, signalled on destruction to stop mRefreshThread.
+    std::mutex mRefreshLock;
+    std::condition_variable mRefreshCondition;
+    bool mRefreshExit = false;
+    std::thread mRefreshThread;
 };
 
 }  // namespace stats
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PowerStats.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using aidl::android::hardware::power::stats::EnergyConsumerResult;
+using aidl::android::hardware::power::stats::EnergyConsumerType;
+using aidl::android::hardware::power::stats::PowerStats;
+using aidl::android::hardware::power::stats::State;
+using aidl::android::hardware::power::stats::StateResidency;
+using aidl::android::hardware::power::stats::StateResidencyResult;
+
+namespace {
+
+// Counts its reads, and reports the count as the residency of its only state.
+class CountingStateResidencyDataProvider : public PowerStats::IStateResidencyDataProvider {
+  public:
+    explicit CountingStateResidencyDataProvider(std::atomic<int>* reads) : mReads(reads) {}
+
+    bool getStateResidencies(
+            std::unordered_map<std::string, std::vector<StateResidency>>* residencies) override {
+        const int reads = ++*mReads;
+        if (fail) {
+            return false;
+        }
+        residencies->emplace("CPU", std::vector<StateResidency>{{.id = 0,
+                                                                 .totalTimeInStateMs = reads}});
+        return true;
+    }
+
+    std::unordered_map<std::string, std::vector<State>> getInfo() override {
+        return {{"CPU", {{0, "Idle"}}}};
+    }
+
+    std::atomic<bool> fail = false;
+
+  private:
+    std::atomic<int>* const mReads;
+};
+
+class CountingEnergyConsumer : public PowerStats::IEnergyConsumer {
+  public:
+    explicit CountingEnergyConsumer(std::atomic<int>* reads) : mReads(reads) {}
+
+    std::string getName() override { return "GPU"; }
+    EnergyConsumerType getType() override { return EnergyConsumerType::OTHER; }
+    std::optional<EnergyConsumerResult> getEnergyConsumed() override {
+        EnergyConsumerResult result;
+        result.energyUWs = ++*mReads;
+        return result;
+    }
+
+  private:
+    std::atomic<int>* const mReads;
+};
+
+class PowerStatsTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        auto provider = std::make_unique<CountingStateResidencyDataProvider>(&mStateReads);
+        mProvider = provider.get();
+        mPowerStats->addStateResidencyDataProvider(std::move(provider));
+        mPowerStats->addEnergyConsumer(std::make_unique<CountingEnergyConsumer>(&mEnergyReads));
+    }
+
+    int64_t getResidency() {
+        std::vector<StateResidencyResult> results;
+        EXPECT_TRUE(mPowerStats->getStateResidency({}, &results).isOk());
+        if (results.size() != 1) {
+            ADD_FAILURE() << "Got " << results.size() << " results";
+            return -1;
+        }
+        return results[0].stateResidencyData[0].totalTimeInStateMs;
+    }
+
+    int64_t getEnergy() {
+        std::vector<EnergyConsumerResult> results;
+        EXPECT_TRUE(mPowerStats->getEnergyConsumed({}, &results).isOk());
+        if (results.size() != 1) {
+            ADD_FAILURE() << "Got " << results.size() << " results";
+            return -1;
+        }
+        return results[0].energyUWs;
+    }
+
+    std::atomic<int> mStateReads = 0;
+    std::atomic<int> mEnergyReads = 0;
+    CountingStateResidencyDataProvider* mProvider;
+    std::shared_ptr<PowerStats> mPowerStats = ndk::SharedRefBase::make<PowerStats>();
+};
+
+TEST_F(PowerStatsTest, ReadsEveryCallWithoutStaleness) {
+    EXPECT_EQ(1, getResidency());
+    EXPECT_EQ(2, getResidency());
+    EXPECT_EQ(1, getEnergy());
+    EXPECT_EQ(2, getEnergy());
+}
+
+TEST_F(PowerStatsTest, SharesReadsWithinStaleness) {
+    mPowerStats->setSnapshotStaleness(std::chrono::hours(1));
+
+    EXPECT_EQ(1, getResidency());
+    EXPECT_EQ(1, getResidency());
+    EXPECT_EQ(1, getEnergy());
+    EXPECT_EQ(1, getEnergy());
+    EXPECT_EQ(1, mStateReads);
+    EXPECT_EQ(1, mEnergyReads);
+}
+
+TEST_F(PowerStatsTest, ReadsAgainOnceStale) {
+    mPowerStats->setSnapshotStaleness(std::chrono::milliseconds(20));
+
+    EXPECT_EQ(1, getEnergy());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_LT(1, getEnergy());
+}
+
+TEST_F(PowerStatsTest, DoesNotKeepFailedReads) {
+    mPowerStats->setSnapshotStaleness(std::chrono::hours(1));
+    mProvider->fail = true;
+
+    std::vector<StateResidencyResult> results;
+    EXPECT_TRUE(mPowerStats->getStateResidency({}, &results).isOk());
+    EXPECT_TRUE(results.empty());
+
+    mProvider->fail = false;
+    EXPECT_EQ(2, getResidency());
+    EXPECT_EQ(2, getResidency());
+}
+
+TEST_F(PowerStatsTest, RefreshesPolledSnapshotsInBackground) {
+    mPowerStats->setSnapshotStaleness(std::chrono::milliseconds(40));
+    EXPECT_EQ(1, getEnergy());
+
+    // The refresher reads it again half way through the window, without a call.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_LT(1, mEnergyReads);
+    // Not the state residencies, which were not requested.
+    EXPECT_EQ(0, mStateReads);
+}
+
+}  // namespace
@@ -24,6 +24,8 @@
 #include <android/binder_manager.h>
 #include <android/binder_process.h>
 
+#include <chrono>
+
 using aidl::android::hardware::power::stats::EnergyConsumerType;
 using aidl::android::hardware::power::stats::FakeEnergyConsumer;
 using aidl::android::hardware::power::stats::FakeEnergyMeter;
@@ -59,6 +61,9 @@ void addFakeEnergyConsumer2(std::shared_ptr<PowerStats> p) {
             std::make_unique<FakeEnergyConsumer>(EnergyConsumerType::MOBILE_RADIO, "MODEM"));
 }
 
+// Batterystats, telemetry and dumpsys poll independently, within this window they share one read.
+constexpr std::chrono::milliseconds kSnapshotStaleness(500);
+
 int main() {
     ABinderProcess_setThreadPoolMaxThreadCount(0);
     std::shared_ptr<PowerStats> p = ndk::SharedRefBase::make<PowerStats>();
@@ -71,6 +76,8 @@ int main() {
     addFakeEnergyConsumer1(p);
     addFakeEnergyConsumer2(p);
 
+    p->setSnapshotStaleness(kSnapshotStaleness);
+
     const std::string instance = std::string() + PowerStats::descriptor + "/default";
     binder_status_t status = AServiceManager_addService(p->asBinder().get(), instance.c_str());
     CHECK_EQ(status, STATUS_OK);
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libradiocompat/IndicationCoalescer.h>
+
+#include <android-base/logging.h>
+
+using namespace std::literals::chrono_literals;
+
+namespace android::hardware::radio::compat {
+
+IndicationCoalescer::IndicationCoalescer(std::string name, std::chrono::milliseconds window)
+    : mName(std::move(name)), mWindow(window) {
+    if (mWindow > 0ms) mFlushThread = std::thread(&IndicationCoalescer::flushThread, this);
+}
+
+IndicationCoalescer::~IndicationCoalescer() {
+    {
+        std::unique_lock<std::mutex> lock(mGuard);
+        mDestroy = true;
+        mCv.notify_all();
+    }
+    if (mFlushThread.joinable()) mFlushThread.join();
+}
+
+void IndicationCoalescer::deliver(std::function<void()> indication) {
+    if (mWindow == 0ms) {
+        indication();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mGuard);
+    const auto now = std::chrono::steady_clock::now();
+    if (!mPending && now >= mLastDelivery + mWindow) {
+        mLastDelivery = now;
+        lock.unlock();
+        indication();
+        return;
+    }
+
+    if (mPending) mSuppressed++;
+    mPending = std::move(indication);
+    mCv.notify_all();
+}
+
+uint64_t IndicationCoalescer::suppressedCount() {
+    std::unique_lock<std::mutex> lock(mGuard);
+    return mSuppressed;
+}
+
+void IndicationCoalescer::flushThread() {
+    std::unique_lock<std::mutex> lock(mGuard);
+    while (!mDestroy) {
+        // nothing held back
+        if (!mPending) {
+            mCv.wait(lock);
+            continue;
+        }
+
+        // holding an indication back, but the window is not over yet
+        const auto deadline = mLastDelivery + mWindow;
+        if (deadline > std::chrono::steady_clock::now()) {
+            mCv.wait_until(lock, deadline);
+            continue;
+        }
+
+        auto indication = std::move(mPending);
+        mPending = nullptr;
+        mLastDelivery = std::chrono::steady_clock::now();
+        LOG(DEBUG) << mName << ": delivering latest indication, " << mSuppressed
+                   << " suppressed so far";
+
+        lock.unlock();
+        indication();
+        lock.lock();
+    }
+}
+
+}  // namespace android::hardware::radio::compat
@@ -16,8 +16,37 @@
 
 #include <libradiocompat/RadioIndication.h>
 
+#include <android-base/properties.h>
+
 namespace android::hardware::radio::compat {
 
-RadioIndication::RadioIndication(std::shared_ptr<DriverContext> context) : mContext(context) {}
+/**
+ * Window in milliseconds within which state indications (cell info, link capacity estimate,
+ * physical channel configs, signal strength) are coalesced, keeping only the latest one. Zero,
+ * the default, delivers every indication as it arrives. Event indications are never coalesced.
+ */
+static constexpr auto kCoalescingWindowProperty = "ro.vendor.radio.compat.coalescing_window_ms";
+
+static std::chrono::milliseconds getCoalescingWindow() {
+    return std::chrono::milliseconds(
+            android::base::GetUintProperty<uint32_t>(kCoalescingWindowProperty, 0));
+}
+
+RadioIndication::RadioIndication(std::shared_ptr<DriverContext> context)
+    : mContext(context),
+      mCellInfoCoalescer("cellInfoList", getCoalescingWindow()),
+      mLinkCapacityEstimateCoalescer("currentLinkCapacityEstimate", getCoalescingWindow()),
+      mPhysicalChannelConfigCoalescer("currentPhysicalChannelConfigs", getCoalescingWindow()),
+      mSignalStrengthCoalescer("currentSignalStrength", getCoalescingWindow()) {}
+
+void RadioIndication::coalesce(IndicationCoalescer& coalescer, V1_0::RadioIndicationType type,
+                               std::function<void()> indication) {
+    // The modem holds a wakelock until the framework acknowledges these, don't hold them back
+    if (type == V1_0::RadioIndicationType::UNSOLICITED_ACK_EXP) {
+        indication();
+        return;
+    }
+    coalescer.deliver(std::move(indication));
+}
 
 }  // namespace android::hardware::radio::compat
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "collections.h"
+#include "network/structs.h"
+
+#include <benchmark/benchmark.h>
+
+namespace android::hardware::radio::compat {
+
+namespace {
+
+// An LTE cell as reported in RadioIndication::cellInfoList_1_6, with the strings and lists that
+// make the conversion expensive.
+V1_6::CellInfo makeLteCellInfo(int32_t ci) {
+    V1_5::CellIdentityLte identity = {};
+    identity.base.base.mcc = "310";
+    identity.base.base.mnc = "260";
+    identity.base.base.ci = ci;
+    identity.base.base.pci = ci % 504;
+    identity.base.base.tac = 1234;
+    identity.base.base.earfcn = 5230;
+    identity.base.operatorNames.alphaLong = "Example Mobile Network Operator";
+    identity.base.operatorNames.alphaShort = "Example";
+    identity.base.bandwidth = 10000;
+    identity.additionalPlmns = {"310410", "311480", "312530"};
+    identity.bands = {V1_5::EutranBands::BAND_2, V1_5::EutranBands::BAND_4,
+                      V1_5::EutranBands::BAND_13};
+
+    V1_6::CellInfoLte lte = {};
+    lte.cellIdentityLte = identity;
+    lte.signalStrengthLte.base.signalStrength = 20;
+    lte.signalStrengthLte.base.rsrp = 90;
+    lte.signalStrengthLte.base.rsrq = 10;
+
+    V1_6::CellInfo info = {};
+    info.registered = ci == 0;
+    info.connectionStatus = V1_2::CellConnectionStatus::NONE;
+    info.ratSpecificInfo.lte(lte);
+    return info;
+}
+
+}  // namespace
+
+static void BM_CellInfoListToAidl(benchmark::State& state) {
+    hidl_vec<V1_6::CellInfo> records(state.range(0));
+    for (size_t i = 0; i < records.size(); i++) {
+        records[i] = makeLteCellInfo(i);
+    }
+
+    for (auto _ : state) {
+        auto aidlRecords = toAidl(records);
+        benchmark::DoNotOptimize(aidlRecords);
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_CellInfoListToAidl)->Arg(1)->Arg(16)->Arg(64);
+
+}  // namespace android::hardware::radio::compat
+
+BENCHMARK_MAIN();
@@ -31,9 +31,12 @@ namespace android::hardware::radio::compat {
  */
 template <typename T>
 auto toAidl(const hidl_vec<T>& inp) {
-    std::vector<decltype(toAidl(T{}))> out(inp.size());
-    for (size_t i = 0; i < inp.size(); i++) {
-        out[i] = toAidl(inp[i]);
+    // Construct the converted elements in place rather than default-constructing and then
+    // assigning them, which matters for lists of large structs such as CellInfo.
+    std::vector<decltype(toAidl(T{}))> out;
+    out.reserve(inp.size());
+    for (const auto& el : inp) {
+        out.push_back(toAidl(el));
     }
     return out;
 }
@@ -63,9 +66,10 @@ auto toHidl(const std::vector<T>& inp) {
  */
 template <typename T, size_t N>
 auto toAidl(const hidl_array<T, N>& inp) {
-    std::vector<decltype(toAidl(T{}))> out(N);
+    std::vector<decltype(toAidl(T{}))> out;
+    out.reserve(N);
     for (size_t i = 0; i < N; i++) {
-        out[i] = toAidl(inp[i]);
+        out.push_back(toAidl(inp[i]));
     }
     return out;
 }
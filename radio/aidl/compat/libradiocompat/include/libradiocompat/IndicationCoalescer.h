@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace android::hardware::radio::compat {
+
+/**
+ * Rate limits one type of state indication, where only the latest value matters.
+ *
+ * The first indication is delivered right away. Indications arriving less than the window after
+ * the last delivery are held back, each replacing the previous one, and the latest of them is
+ * delivered when the window ends. With a zero window every indication is delivered right away.
+ */
+class IndicationCoalescer {
+    const std::string mName;
+    const std::chrono::milliseconds mWindow;
+
+    std::mutex mGuard;
+    std::condition_variable mCv GUARDED_BY(mGuard);
+    std::function<void()> mPending GUARDED_BY(mGuard);
+    std::chrono::time_point<std::chrono::steady_clock> mLastDelivery GUARDED_BY(mGuard);
+    uint64_t mSuppressed GUARDED_BY(mGuard) = 0;
+    bool mDestroy GUARDED_BY(mGuard) = false;
+
+    std::thread mFlushThread;
+
+    void flushThread();
+
+  public:
+    IndicationCoalescer(std::string name, std::chrono::milliseconds window);
+    ~IndicationCoalescer();
+
+    void deliver(std::function<void()> indication);
+
+    /** How many indications were replaced by a newer one before being delivered. */
+    uint64_t suppressedCount();
+};
+
+}  // namespace android::hardware::radio::compat
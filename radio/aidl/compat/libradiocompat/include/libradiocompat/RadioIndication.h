@@ -17,6 +17,7 @@
 
 #include "DriverContext.h"
 #include "GuaranteedCallback.h"
+#include "IndicationCoalescer.h"
 
 #include <aidl/android/hardware/radio/data/IRadioDataIndication.h>
 #include <aidl/android/hardware/radio/messaging/IRadioMessagingIndication.h>
@@ -56,6 +57,15 @@ class RadioIndication : public V1_6::IRadioIndication {
             ::aidl::android::hardware::radio::voice::IRadioVoiceIndicationDefault, true>
             mVoiceCb;
 
+    // State indications where only the latest value matters, see kCoalescingWindowProperty
+    IndicationCoalescer mCellInfoCoalescer;
+    IndicationCoalescer mLinkCapacityEstimateCoalescer;
+    IndicationCoalescer mPhysicalChannelConfigCoalescer;
+    IndicationCoalescer mSignalStrengthCoalescer;
+
+    void coalesce(IndicationCoalescer& coalescer, V1_0::RadioIndicationType type,
+                  std::function<void()> indication);
+
     // IRadioIndication @ 1.0
     Return<void> radioStateChanged(V1_0::RadioIndicationType type,
                                    V1_0::RadioState radioState) override;
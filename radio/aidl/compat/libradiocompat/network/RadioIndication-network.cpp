@@ -75,28 +75,36 @@ Return<void> RadioIndication::cellInfoList_1_4(V1_0::RadioIndicationType type,
 Return<void> RadioIndication::cellInfoList_1_5(V1_0::RadioIndicationType type,
                                                const hidl_vec<V1_5::CellInfo>& records) {
     LOG_CALL << type;
-    networkCb()->cellInfoList(toAidl(type), toAidl(records));
+    coalesce(mCellInfoCoalescer, type, [this, type = toAidl(type), records = toAidl(records)] {
+        networkCb()->cellInfoList(type, records);
+    });
     return {};
 }
 
 Return<void> RadioIndication::cellInfoList_1_6(V1_0::RadioIndicationType type,
                                                const hidl_vec<V1_6::CellInfo>& records) {
     LOG_CALL << type;
-    networkCb()->cellInfoList(toAidl(type), toAidl(records));
+    coalesce(mCellInfoCoalescer, type, [this, type = toAidl(type), records = toAidl(records)] {
+        networkCb()->cellInfoList(type, records);
+    });
     return {};
 }
 
 Return<void> RadioIndication::currentLinkCapacityEstimate(V1_0::RadioIndicationType type,
                                                           const V1_2::LinkCapacityEstimate& lce) {
     LOG_CALL << type;
-    networkCb()->currentLinkCapacityEstimate(toAidl(type), toAidl(lce));
+    coalesce(mLinkCapacityEstimateCoalescer, type, [this, type = toAidl(type), lce = toAidl(lce)] {
+        networkCb()->currentLinkCapacityEstimate(type, lce);
+    });
     return {};
 }
 
 Return<void> RadioIndication::currentLinkCapacityEstimate_1_6(
         V1_0::RadioIndicationType type, const V1_6::LinkCapacityEstimate& lce) {
     LOG_CALL << type;
-    networkCb()->currentLinkCapacityEstimate(toAidl(type), toAidl(lce));
+    coalesce(mLinkCapacityEstimateCoalescer, type, [this, type = toAidl(type), lce = toAidl(lce)] {
+        networkCb()->currentLinkCapacityEstimate(type, lce);
+    });
     return {};
 }
 
@@ -110,14 +118,20 @@ Return<void> RadioIndication::currentPhysicalChannelConfigs(
 Return<void> RadioIndication::currentPhysicalChannelConfigs_1_4(
         V1_0::RadioIndicationType type, const hidl_vec<V1_4::PhysicalChannelConfig>& configs) {
     LOG_CALL << type;
-    networkCb()->currentPhysicalChannelConfigs(toAidl(type), toAidl(configs));
+    coalesce(mPhysicalChannelConfigCoalescer, type,
+             [this, type = toAidl(type), configs = toAidl(configs)] {
+                 networkCb()->currentPhysicalChannelConfigs(type, configs);
+             });
     return {};
 }
 
 Return<void> RadioIndication::currentPhysicalChannelConfigs_1_6(
         V1_0::RadioIndicationType type, const hidl_vec<V1_6::PhysicalChannelConfig>& configs) {
     LOG_CALL << type;
-    networkCb()->currentPhysicalChannelConfigs(toAidl(type), toAidl(configs));
+    coalesce(mPhysicalChannelConfigCoalescer, type,
+             [this, type = toAidl(type), configs = toAidl(configs)] {
+                 networkCb()->currentPhysicalChannelConfigs(type, configs);
+             });
     return {};
 }
 
@@ -138,14 +152,20 @@ Return<void> RadioIndication::currentSignalStrength_1_2(V1_0::RadioIndicationTyp
 Return<void> RadioIndication::currentSignalStrength_1_4(
         V1_0::RadioIndicationType type, const V1_4::SignalStrength& signalStrength) {
     LOG_CALL << type;
-    networkCb()->currentSignalStrength(toAidl(type), toAidl(signalStrength));
+    coalesce(mSignalStrengthCoalescer, type,
+             [this, type = toAidl(type), signalStrength = toAidl(signalStrength)] {
+                 networkCb()->currentSignalStrength(type, signalStrength);
+             });
     return {};
 }
 
 Return<void> RadioIndication::currentSignalStrength_1_6(
         V1_0::RadioIndicationType type, const V1_6::SignalStrength& signalStrength) {
     LOG_CALL << type;
-    networkCb()->currentSignalStrength(toAidl(type), toAidl(signalStrength));
+    coalesce(mSignalStrengthCoalescer, type,
+             [this, type = toAidl(type), signalStrength = toAidl(signalStrength)] {
+                 networkCb()->currentSignalStrength(type, signalStrength);
+             });
     return {};
 }
 
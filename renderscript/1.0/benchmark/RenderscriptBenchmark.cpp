@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/hardware/renderscript/1.0/IContext.h>
+#include <android/hardware/renderscript/1.0/IDevice.h>
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+using ::android::sp;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
+using ::benchmark::Fixture;
+using ::benchmark::State;
+
+using namespace ::android::hardware::renderscript::V1_0;
+
+// Measures the per-call overhead of the context calls an image pipeline makes every frame. The
+// allocations are kept small so that the cost of the call, not of the kernel, dominates.
+class RenderscriptBench : public Fixture {
+  public:
+    void SetUp(State& state) override {
+        sp<IDevice> device = IDevice::getService();
+        if (device == nullptr) {
+            state.SkipWithError("renderscript HAL unavailable");
+            return;
+        }
+        mContext = device->contextCreate(0, ContextType::NORMAL, 0);
+        if (mContext == nullptr) {
+            state.SkipWithError("failed to create context");
+            return;
+        }
+        mElement = mContext->elementCreate(DataType::UNSIGNED_8, DataKind::PIXEL_RGBA, true, 4);
+    }
+
+    void TearDown(State& /*state*/) override {
+        if (mContext == nullptr) {
+            return;
+        }
+        mContext->contextFinish();
+        mContext->contextDestroy();
+        mContext = nullptr;
+    }
+
+  protected:
+    Type createType(uint32_t dim) {
+        return mContext->typeCreate(mElement, dim, dim, 0, false, false, YuvFormat::YUV_NONE);
+    }
+
+    Allocation createAllocation(Type type) {
+        return mContext->allocationCreateTyped(type, AllocationMipmapControl::NONE,
+                                               static_cast<int32_t>(AllocationUsageType::SCRIPT),
+                                               nullptr);
+    }
+
+    sp<IContext> mContext;
+    Element mElement = 0;
+};
+
+// A blend kernel per frame with one input, the way legacy pipelines drive intrinsics.
+BENCHMARK_DEFINE_F(RenderscriptBench, scriptForEach)(State& state) {
+    if (mContext == nullptr) {
+        return;
+    }
+    const Type type = createType(state.range(0));
+    const hidl_vec<Allocation> ins = {createAllocation(type)};
+    const Allocation out = createAllocation(type);
+    const Script blend = mContext->scriptIntrinsicCreate(ScriptIntrinsicID::ID_BLEND, mElement);
+    constexpr uint32_t kSrcOverSlot = 1;
+
+    for (auto _ : state) {
+        mContext->scriptForEach(blend, kSrcOverSlot, ins, out, {}, nullptr);
+    }
+    mContext->contextFinish();
+}
+BENCHMARK_REGISTER_F(RenderscriptBench, scriptForEach)->Arg(4)->Arg(64);
+
+// Uploads of a small staging buffer into an allocation.
+BENCHMARK_DEFINE_F(RenderscriptBench, allocation1DWrite)(State& state) {
+    if (mContext == nullptr) {
+        return;
+    }
+    const Type type = mContext->typeCreate(mElement, state.range(0), 0, 0, false, false,
+                                           YuvFormat::YUV_NONE);
+    const Allocation allocation = createAllocation(type);
+    std::vector<uint8_t> data(state.range(0) * 4, 0x80);
+    hidl_vec<uint8_t> _data;
+    _data.setToExternal(data.data(), data.size());
+
+    for (auto _ : state) {
+        mContext->allocation1DWrite(allocation, 0, 0, state.range(0), _data);
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK_REGISTER_F(RenderscriptBench, allocation1DWrite)->Arg(16)->Arg(4096);
+
+// Creation of an allocation from bitmap data, e.g. when a frame of a new size arrives.
+BENCHMARK_DEFINE_F(RenderscriptBench, allocationCreateFromBitmap)(State& state) {
+    if (mContext == nullptr) {
+        return;
+    }
+    const Type type = createType(state.range(0));
+    std::vector<uint8_t> bitmap(state.range(0) * state.range(0) * 4, 0x80);
+    hidl_vec<uint8_t> _bitmap;
+    _bitmap.setToExternal(bitmap.data(), bitmap.size());
+
+    for (auto _ : state) {
+        const Allocation allocation = mContext->allocationCreateFromBitmap(
+                type, AllocationMipmapControl::NONE, _bitmap,
+                static_cast<int32_t>(AllocationUsageType::SCRIPT));
+        mContext->objDestroy(allocation);
+    }
+    state.SetBytesProcessed(state.iterations() * bitmap.size());
+}
+BENCHMARK_REGISTER_F(RenderscriptBench, allocationCreateFromBitmap)->Arg(16)->Arg(512);
+
+// Creation of a struct element, which converts three argument arrays of the given length.
+BENCHMARK_DEFINE_F(RenderscriptBench, elementComplexCreate)(State& state) {
+    if (mContext == nullptr) {
+        return;
+    }
+    const Element field = mContext->elementCreate(DataType::FLOAT_32, DataKind::USER, false, 1);
+    hidl_vec<Element> elements(state.range(0));
+    hidl_vec<hidl_string> names(state.range(0));
+    hidl_vec<Size> arraySizes(state.range(0));
+    for (size_t i = 0; i < elements.size(); i++) {
+        elements[i] = field;
+        names[i] = "field" + std::to_string(i);
+        arraySizes[i] = 1;
+    }
+
+    for (auto _ : state) {
+        mContext->objDestroy(mContext->elementComplexCreate(elements, names, arraySizes));
+    }
+}
+BENCHMARK_REGISTER_F(RenderscriptBench, elementComplexCreate)->Arg(2)->Arg(8)->Arg(32);
+
+BENCHMARK_MAIN();
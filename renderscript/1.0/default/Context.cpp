@@ -17,6 +17,10 @@
 #include "Context.h"
 #include "Device.h"
 
+#include <algorithm>
+#include <array>
+#include <vector>
+
 namespace android {
 namespace hardware {
 namespace renderscript {
@@ -57,9 +61,34 @@ static ReturnType hidl_to_rs(SourceType* src) {
     return reinterpret_cast<ReturnType>(src);
 }
 
+// Converted argument arrays, e.g. the inputs of scriptForEach, hold a handful of elements and are
+// built on every call, so they only go to the heap when they outgrow the inline storage.
+template<typename T, size_t N = 8>
+class InlineVector {
+  public:
+    explicit InlineVector(size_t size) : mSize(size) {
+        if (mSize > N) {
+            mHeap.resize(mSize);
+        }
+    }
+
+    T* data() { return mSize > N ? mHeap.data() : mInline.data(); }
+    const T* data() const { return mSize > N ? mHeap.data() : mInline.data(); }
+    size_t size() const { return mSize; }
+    T* begin() { return data(); }
+    T* end() { return data() + mSize; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + mSize; }
+
+  private:
+    std::array<T, N> mInline{};
+    std::vector<T> mHeap;
+    size_t mSize;
+};
+
 template<typename RsType, typename HidlType, typename Operation>
-static std::vector<RsType> hidl_to_rs(const hidl_vec<HidlType>& src, Operation operation) {
-    std::vector<RsType> dst(src.size());
+static InlineVector<RsType> hidl_to_rs(const hidl_vec<HidlType>& src, Operation operation) {
+    InlineVector<RsType> dst(src.size());
     std::transform(src.begin(), src.end(), dst.begin(), operation);
     return dst;
 }
@@ -69,9 +98,9 @@ static ReturnType rs_to_hidl(SourceType* src) {
     return static_cast<ReturnType>(reinterpret_cast<uintptr_t>(src));
 }
 
-template<typename HidlType, typename RsType, typename Operation>
-static hidl_vec<HidlType> rs_to_hidl(const std::vector<RsType>& src, Operation operation) {
-    std::vector<HidlType> dst(src.size());
+template<typename HidlType, typename RsContainer, typename Operation>
+static hidl_vec<HidlType> rs_to_hidl(const RsContainer& src, Operation operation) {
+    hidl_vec<HidlType> dst(src.size());
     std::transform(src.begin(), src.end(), dst.begin(), operation);
     return dst;
 }
@@ -362,9 +391,10 @@ Return<void> Context::allocationGetPointer(Allocation allocation, uint32_t lod,
 
 Return<void> Context::elementGetNativeMetadata(Element element, elementGetNativeMetadata_cb _hidl_cb) {
     RsElement _element = hidl_to_rs<RsElement>(element);
-    std::vector<uint32_t> _elemData(5);
-    Device::getHal().ElementGetNativeData(mContext, _element, _elemData.data(), _elemData.size());
-    hidl_vec<uint32_t> elemData = _elemData;
+    // hidl_vec leaves its elements uninitialized, and they are sent whatever the driver writes.
+    hidl_vec<uint32_t> elemData(5);
+    std::fill(elemData.begin(), elemData.end(), 0);
+    Device::getHal().ElementGetNativeData(mContext, _element, elemData.data(), elemData.size());
     _hidl_cb(elemData);
     return Void();
 }
@@ -372,9 +402,9 @@ Return<void> Context::elementGetNativeMetadata(Element element, elementGetNative
 Return<void> Context::elementGetSubElements(Element element, Size numSubElem, elementGetSubElements_cb _hidl_cb) {
     RsElement _element = hidl_to_rs<RsElement>(element);
     uint32_t _numSubElem = static_cast<uint32_t>(numSubElem);
-    std::vector<uintptr_t> _ids(_numSubElem);
-    std::vector<const char*> _names(_numSubElem);
-    std::vector<size_t> _arraySizes(_numSubElem);
+    InlineVector<uintptr_t> _ids(_numSubElem);
+    InlineVector<const char*> _names(_numSubElem);
+    InlineVector<size_t> _arraySizes(_numSubElem);
     Device::getHal().ElementGetSubElements(mContext, _element, _ids.data(), _names.data(), _arraySizes.data(), _numSubElem);
     hidl_vec<Element>     ids        = rs_to_hidl<Element>(_ids,       [](uintptr_t val) { return static_cast<Element>(val); });
     hidl_vec<hidl_string> names      = rs_to_hidl<hidl_string>(_names, [](const char* val) { return val; });
@@ -393,17 +423,17 @@ Return<Element> Context::elementCreate(DataType dt, DataKind dk, bool norm, uint
 }
 
 Return<Element> Context::elementComplexCreate(const hidl_vec<Element>& eins, const hidl_vec<hidl_string>& names, const hidl_vec<Size>& arraySizes) {
-    std::vector<RsElement>   _eins           = hidl_to_rs<RsElement>(eins,      [](Element val) { return hidl_to_rs<RsElement>(val); });
-    std::vector<const char*> _namesPtr       = hidl_to_rs<const char*>(names,   [](const hidl_string& val) { return val.c_str(); });
-    std::vector<size_t>      _nameLengthsPtr = hidl_to_rs<size_t>(names,        [](const hidl_string& val) { return val.size(); });
-    std::vector<uint32_t>    _arraySizes     = hidl_to_rs<uint32_t>(arraySizes, [](Size val) { return static_cast<uint32_t>(val); });
+    InlineVector<RsElement>   _eins           = hidl_to_rs<RsElement>(eins,      [](Element val) { return hidl_to_rs<RsElement>(val); });
+    InlineVector<const char*> _namesPtr       = hidl_to_rs<const char*>(names,   [](const hidl_string& val) { return val.c_str(); });
+    InlineVector<size_t>      _nameLengthsPtr = hidl_to_rs<size_t>(names,        [](const hidl_string& val) { return val.size(); });
+    InlineVector<uint32_t>    _arraySizes     = hidl_to_rs<uint32_t>(arraySizes, [](Size val) { return static_cast<uint32_t>(val); });
     RsElement _element = Device::getHal().ElementCreate2(mContext, _eins.data(), _eins.size(), _namesPtr.data(), _namesPtr.size(), _nameLengthsPtr.data(), _arraySizes.data(), _arraySizes.size());
     return rs_to_hidl<Element>(_element);
 }
 
 Return<void> Context::typeGetNativeMetadata(Type type, typeGetNativeMetadata_cb _hidl_cb) {
     RsType _type = hidl_to_rs<RsType>(type);
-    std::vector<uintptr_t> _metadata(6);
+    std::array<uintptr_t, 6> _metadata{};
     Device::getHal().TypeGetNativeData(mContext, _type, _metadata.data(), _metadata.size());
     hidl_vec<OpaqueHandle> metadata = rs_to_hidl<OpaqueHandle>(_metadata, [](uintptr_t val) { return static_cast<OpaqueHandle>(val); });
     _hidl_cb(metadata);
@@ -510,12 +540,12 @@ Return<void> Context::getName(ObjectBase obj, getName_cb _hidl_cb) {
 Return<Closure> Context::closureCreate(ScriptKernelID kernelID, Allocation returnValue, const hidl_vec<ScriptFieldID>& fieldIDS, const hidl_vec<int64_t>& values, const hidl_vec<int32_t>& sizes, const hidl_vec<Closure>& depClosures, const hidl_vec<ScriptFieldID>& depFieldIDS) {
     RsScriptKernelID _kernelID = hidl_to_rs<RsScriptKernelID>(kernelID);
     RsAllocation _returnValue = hidl_to_rs<RsAllocation>(returnValue);
-    std::vector<RsScriptFieldID> _fieldIDS = hidl_to_rs<RsScriptFieldID>(fieldIDS, [](ScriptFieldID val) { return hidl_to_rs<RsScriptFieldID>(val); });
+    InlineVector<RsScriptFieldID> _fieldIDS = hidl_to_rs<RsScriptFieldID>(fieldIDS, [](ScriptFieldID val) { return hidl_to_rs<RsScriptFieldID>(val); });
     int64_t* _valuesPtr = const_cast<int64_t*>(values.data());
     size_t _valuesLength = values.size();
-    std::vector<int>             _sizes       = hidl_to_rs<int>(sizes,                   [](int32_t val) { return static_cast<int>(val); });
-    std::vector<RsClosure>       _depClosures = hidl_to_rs<RsClosure>(depClosures,       [](Closure val) { return hidl_to_rs<RsClosure>(val); });
-    std::vector<RsScriptFieldID> _depFieldIDS = hidl_to_rs<RsScriptFieldID>(depFieldIDS, [](ScriptFieldID val) { return hidl_to_rs<RsScriptFieldID>(val); });
+    InlineVector<int>             _sizes       = hidl_to_rs<int>(sizes,                   [](int32_t val) { return static_cast<int>(val); });
+    InlineVector<RsClosure>       _depClosures = hidl_to_rs<RsClosure>(depClosures,       [](Closure val) { return hidl_to_rs<RsClosure>(val); });
+    InlineVector<RsScriptFieldID> _depFieldIDS = hidl_to_rs<RsScriptFieldID>(depFieldIDS, [](ScriptFieldID val) { return hidl_to_rs<RsScriptFieldID>(val); });
     RsClosure _closure = Device::getHal().ClosureCreate(mContext, _kernelID, _returnValue, _fieldIDS.data(), _fieldIDS.size(), _valuesPtr, _valuesLength, _sizes.data(), _sizes.size(), _depClosures.data(), _depClosures.size(), _depFieldIDS.data(), _depFieldIDS.size());
     return rs_to_hidl<Closure>(_closure);
 }
@@ -524,10 +554,10 @@ Return<Closure> Context::invokeClosureCreate(ScriptInvokeID invokeID, const hidl
     RsScriptInvokeID _invokeID = hidl_to_rs<RsScriptInvokeID>(invokeID);
     const void* _paramsPtr = params.data();
     size_t _paramsSize = params.size();
-    std::vector<RsScriptFieldID> _fieldIDS = hidl_to_rs<RsScriptFieldID>(fieldIDS, [](ScriptFieldID val) { return hidl_to_rs<RsScriptFieldID>(val); });
+    InlineVector<RsScriptFieldID> _fieldIDS = hidl_to_rs<RsScriptFieldID>(fieldIDS, [](ScriptFieldID val) { return hidl_to_rs<RsScriptFieldID>(val); });
     const int64_t* _valuesPtr = values.data();
     size_t _valuesLength = values.size();
-    std::vector<int> _sizes = hidl_to_rs<int>(sizes, [](int32_t val) { return static_cast<int>(val); });
+    InlineVector<int> _sizes = hidl_to_rs<int>(sizes, [](int32_t val) { return static_cast<int>(val); });
     RsClosure _closure = Device::getHal().InvokeClosureCreate(mContext, _invokeID, _paramsPtr, _paramsSize, _fieldIDS.data(), _fieldIDS.size(), _valuesPtr, _valuesLength, _sizes.data(), _sizes.size());
     return rs_to_hidl<Closure>(_closure);
 }
@@ -573,11 +603,11 @@ Return<ScriptFieldID> Context::scriptFieldIDCreate(Script script, int32_t slot)
 }
 
 Return<ScriptGroup> Context::scriptGroupCreate(const hidl_vec<ScriptKernelID>& kernels, const hidl_vec<ScriptKernelID>& srcK, const hidl_vec<ScriptKernelID>& dstK, const hidl_vec<ScriptFieldID>& dstF, const hidl_vec<Type>& types) {
-    std::vector<RsScriptKernelID> _kernels = hidl_to_rs<RsScriptKernelID>(kernels, [](ScriptFieldID val) { return hidl_to_rs<RsScriptKernelID>(val); });
-    std::vector<RsScriptKernelID> _srcK    = hidl_to_rs<RsScriptKernelID>(srcK,    [](ScriptFieldID val) { return hidl_to_rs<RsScriptKernelID>(val); });
-    std::vector<RsScriptKernelID> _dstK    = hidl_to_rs<RsScriptKernelID>(dstK,    [](ScriptFieldID val) { return hidl_to_rs<RsScriptKernelID>(val); });
-    std::vector<RsScriptFieldID>  _dstF    = hidl_to_rs<RsScriptFieldID>(dstF,     [](ScriptFieldID val) { return hidl_to_rs<RsScriptFieldID>(val); });
-    std::vector<RsType>           _types   = hidl_to_rs<RsType>(types,             [](Type val) { return hidl_to_rs<RsType>(val); });
+    InlineVector<RsScriptKernelID> _kernels = hidl_to_rs<RsScriptKernelID>(kernels, [](ScriptFieldID val) { return hidl_to_rs<RsScriptKernelID>(val); });
+    InlineVector<RsScriptKernelID> _srcK    = hidl_to_rs<RsScriptKernelID>(srcK,    [](ScriptFieldID val) { return hidl_to_rs<RsScriptKernelID>(val); });
+    InlineVector<RsScriptKernelID> _dstK    = hidl_to_rs<RsScriptKernelID>(dstK,    [](ScriptFieldID val) { return hidl_to_rs<RsScriptKernelID>(val); });
+    InlineVector<RsScriptFieldID>  _dstF    = hidl_to_rs<RsScriptFieldID>(dstF,     [](ScriptFieldID val) { return hidl_to_rs<RsScriptFieldID>(val); });
+    InlineVector<RsType>           _types   = hidl_to_rs<RsType>(types,             [](Type val) { return hidl_to_rs<RsType>(val); });
     RsScriptGroup _scriptGroup = Device::getHal().ScriptGroupCreate(mContext, _kernels.data(), _kernels.size() * sizeof(RsScriptKernelID), _srcK.data(), _srcK.size() * sizeof(RsScriptKernelID), _dstK.data(), _dstK.size() * sizeof(RsScriptKernelID), _dstF.data(), _dstF.size() * sizeof(RsScriptFieldID), _types.data(), _types.size() * sizeof(RsType));
     return rs_to_hidl<ScriptGroup>(_scriptGroup);
 }
@@ -585,7 +615,7 @@ Return<ScriptGroup> Context::scriptGroupCreate(const hidl_vec<ScriptKernelID>& k
 Return<ScriptGroup2> Context::scriptGroup2Create(const hidl_string& name, const hidl_string& cacheDir, const hidl_vec<Closure>& closures) {
     const hidl_string& _name = name;
     const hidl_string& _cacheDir = cacheDir;
-    std::vector<RsClosure> _closures = hidl_to_rs<RsClosure>(closures, [](Closure val) { return hidl_to_rs<RsClosure>(val); });
+    InlineVector<RsClosure> _closures = hidl_to_rs<RsClosure>(closures, [](Closure val) { return hidl_to_rs<RsClosure>(val); });
     RsScriptGroup2 _scriptGroup2 = Device::getHal().ScriptGroup2Create(mContext, _name.c_str(), _name.size(), _cacheDir.c_str(), _cacheDir.size(), _closures.data(), _closures.size());
     return rs_to_hidl<ScriptGroup2>(_scriptGroup2);
 }
@@ -663,7 +693,7 @@ Return<void> Context::scriptInvokeV(Script vs, uint32_t slot, const hidl_vec<uin
 Return<void> Context::scriptForEach(Script vs, uint32_t slot, const hidl_vec<Allocation>& vains, Allocation vaout, const hidl_vec<uint8_t>& params, Ptr sc) {
     RsScript _vs = hidl_to_rs<RsScript>(vs);
     uint32_t _slot = slot;
-    std::vector<RsAllocation> _vains = hidl_to_rs<RsAllocation>(vains, [](Allocation val) { return hidl_to_rs<RsAllocation>(val); });
+    InlineVector<RsAllocation> _vains = hidl_to_rs<RsAllocation>(vains, [](Allocation val) { return hidl_to_rs<RsAllocation>(val); });
     RsAllocation _vaout = hidl_to_rs<RsAllocation>(vaout);
     const void* _paramsPtr = hidl_to_rs<const void*>(params.data());
     size_t _paramLen = params.size();
@@ -676,7 +706,7 @@ Return<void> Context::scriptForEach(Script vs, uint32_t slot, const hidl_vec<All
 Return<void> Context::scriptReduce(Script vs, uint32_t slot, const hidl_vec<Allocation>& vains, Allocation vaout, Ptr sc) {
     RsScript _vs = hidl_to_rs<RsScript>(vs);
     uint32_t _slot = slot;
-    std::vector<RsAllocation> _vains = hidl_to_rs<RsAllocation>(vains, [](Allocation val) { return hidl_to_rs<RsAllocation>(val); });
+    InlineVector<RsAllocation> _vains = hidl_to_rs<RsAllocation>(vains, [](Allocation val) { return hidl_to_rs<RsAllocation>(val); });
     RsAllocation _vaout = hidl_to_rs<RsAllocation>(vaout);
     const RsScriptCall* _sc = hidl_to_rs<const RsScriptCall*>(sc);
     size_t _scLen = _sc != nullptr ? sizeof(ScriptCall) : 0;
@@ -737,9 +767,9 @@ Return<void> Context::scriptGetVarV(Script vs, uint32_t slot, Size len, scriptGe
     RsScript _vs = hidl_to_rs<RsScript>(vs);
     uint32_t _slot = slot;
     size_t _len = static_cast<size_t>(len);
-    std::vector<uint8_t> _data(_len);
-    Device::getHal().ScriptGetVarV(mContext, _vs, _slot, _data.data(), _data.size());
-    hidl_vec<uint8_t> data = _data;
+    hidl_vec<uint8_t> data(_len);
+    std::fill(data.begin(), data.end(), 0);
+    Device::getHal().ScriptGetVarV(mContext, _vs, _slot, data.data(), data.size());
     _hidl_cb(data);
     return Void();
 }
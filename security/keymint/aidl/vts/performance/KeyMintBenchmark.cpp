@@ -63,15 +63,14 @@ class KeyMintBenchmarkTest {
 
     int getError() { return static_cast<int>(error_); }
 
-    const string& GenerateMessage(int size) {
+    // Doesn't change the cache, so it may be called from several threads.
+    string GenerateMessage(int size) const {
         for (const string& message : message_cache_) {
             if (message.size() == size) {
                 return message;
             }
         }
-        string message = string(size, 'x');
-        message_cache_.push_back(message);
-        return std::move(message);
+        return string(size, 'x');
     }
 
     optional<BlockMode> getBlockMode(string transform) {
@@ -236,6 +235,27 @@ class KeyMintBenchmarkTest {
         return GetReturnErrorCode(result);
     }
 
+    // Begins an operation with the current key without tracking it, so benchmarks can hold several
+    // operations at once or run them from several threads.
+    ErrorCode BeginOperation(KeyPurpose purpose, const AuthorizationSet& in_params,
+                             std::shared_ptr<IKeyMintOperation>* op) const {
+        BeginResult out;
+        Status result =
+                keymint_->begin(purpose, key_blob_, in_params.vector_data(), std::nullopt, &out);
+        if (result.isOk()) *op = out.operation;
+        return ToErrorCode(result);
+    }
+
+    static ErrorCode FinishOperation(const std::shared_ptr<IKeyMintOperation>& op,
+                                     const string& input, string* output) {
+        vector<uint8_t> oPut;
+        Status result = op->finish(vector<uint8_t>(input.begin(), input.end()), {} /* signature */,
+                                   {} /* authToken */, {} /* timestampToken */,
+                                   {} /* confirmationToken */, &oPut);
+        if (result.isOk()) output->assign(oPut.begin(), oPut.end());
+        return ToErrorCode(result);
+    }
+
     SecurityLevel securityLevel_;
     string name_;
 
@@ -304,6 +324,10 @@ class KeyMintBenchmarkTest {
 
     ErrorCode GetReturnErrorCode(const Status& result) {
         error_ = static_cast<ErrorCode>(result.getServiceSpecificError());
+        return ToErrorCode(result);
+    }
+
+    static ErrorCode ToErrorCode(const Status& result) {
         if (result.isOk()) return ErrorCode::OK;
 
         if (result.getExceptionCode() == EX_SERVICE_SPECIFIC) {
@@ -632,6 +656,125 @@ BENCHMARK_KM_CIPHER_ALL_RSA_KEYS(RSA/ECB/NoPadding, SMALL_MESSAGE_SIZE);
 BENCHMARK_KM_CIPHER_ALL_RSA_KEYS(RSA/ECB/PKCS1Padding, SMALL_MESSAGE_SIZE);
 BENCHMARK_KM_CIPHER_ALL_RSA_KEYS(RSA/ECB/OAEPPadding, SMALL_MESSAGE_SIZE);
 
+// clang-format on
+
+/*
+ * ============= CONCURRENCY TESTS ==================
+ */
+
+// Signs with one key from several threads at once, each thread running its own begin/finish
+// operations. items_per_second is the sign throughput of all threads together, and
+// too_many_operations counts the begins rejected because the implementation ran out of
+// operation slots (they are retried).
+static void sign_concurrent(benchmark::State& state, string transform, int keySize, int msgSize) {
+    // Set up by the first thread before the loop, and only read by the others inside it: the
+    // threads wait for each other when entering the loop.
+    static struct {
+        bool ok;
+        string error;
+        AuthorizationSet in_params;
+        string message;
+    } setup;
+
+    addDefaultLabel(state);
+    if (state.thread_index() == 0) {
+        setup.ok = keymintTest->GenerateKey(transform, keySize, true);
+        setup.error = "Key generation error, " + std::to_string(keymintTest->getError());
+        setup.in_params = keymintTest->getOperationParams(transform, true);
+        setup.message = keymintTest->GenerateMessage(msgSize);
+    }
+
+    int64_t busy = 0;
+    for (auto _ : state) {
+        if (!setup.ok) {
+            state.SkipWithError(setup.error.c_str());
+            break;
+        }
+        std::shared_ptr<IKeyMintOperation> op;
+        ErrorCode error = keymintTest->BeginOperation(KeyPurpose::SIGN, setup.in_params, &op);
+        if (error == ErrorCode::TOO_MANY_OPERATIONS) {
+            busy++;
+            continue;
+        }
+        if (error != ErrorCode::OK) {
+            state.SkipWithError(("Error beginning sign, " + std::to_string(int(error))).c_str());
+            break;
+        }
+        string signature;
+        error = KeyMintBenchmarkTest::FinishOperation(op, setup.message, &signature);
+        if (error != ErrorCode::OK) {
+            state.SkipWithError(("Sign error, " + std::to_string(int(error))).c_str());
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() - busy);
+    state.counters["too_many_operations"] = benchmark::Counter(busy);
+}
+
+// The most operations held open at once by operation_slots.
+static constexpr size_t kMaxOperationSlots = 64;
+
+// Begins operations without finishing them until the implementation runs out of operation slots
+// (or kMaxOperationSlots are open), then measures begin with all slots taken. operation_slots is
+// the number of operations the implementation kept open.
+static void operation_slots(benchmark::State& state, string transform, int keySize) {
+    addDefaultLabel(state);
+    if (!keymintTest->GenerateKey(transform, keySize, true)) {
+        state.SkipWithError(
+                ("Key generation error, " + std::to_string(keymintTest->getError())).c_str());
+        return;
+    }
+    auto in_params = keymintTest->getOperationParams(transform, true);
+
+    vector<std::shared_ptr<IKeyMintOperation>> ops;
+    ErrorCode error = ErrorCode::OK;
+    while (ops.size() < kMaxOperationSlots) {
+        std::shared_ptr<IKeyMintOperation> op;
+        error = keymintTest->BeginOperation(KeyPurpose::SIGN, in_params, &op);
+        if (error != ErrorCode::OK) break;
+        ops.push_back(std::move(op));
+    }
+    state.counters["operation_slots"] = ops.size();
+
+    if (error == ErrorCode::OK || error == ErrorCode::TOO_MANY_OPERATIONS) {
+        for (auto _ : state) {
+            std::shared_ptr<IKeyMintOperation> op;
+            error = keymintTest->BeginOperation(KeyPurpose::SIGN, in_params, &op);
+            state.PauseTiming();
+            if (error == ErrorCode::OK) {
+                op->abort();
+            } else if (error != ErrorCode::TOO_MANY_OPERATIONS) {
+                state.SkipWithError(
+                        ("Error beginning sign, " + std::to_string(int(error))).c_str());
+                state.ResumeTiming();
+                break;
+            }
+            state.ResumeTiming();
+        }
+    } else {
+        state.SkipWithError(("Error beginning sign, " + std::to_string(int(error))).c_str());
+    }
+
+    for (auto& op : ops) {
+        op->abort();
+    }
+}
+
+// clang-format off
+#define BENCHMARK_KM_CONCURRENT(transform, keySize, msgSize)                                      \
+    BENCHMARK_CAPTURE(sign_concurrent, transform/keySize/msgSize,                                 \
+                      #transform "/" #keySize "/" #msgSize, keySize, msgSize)                     \
+            ->Apply(settings)                                                                     \
+            ->ThreadRange(1, 8)                                                                   \
+            ->UseRealTime();
+
+BENCHMARK_KM_CONCURRENT(SHA256withECDSA, 256, SMALL_MESSAGE_SIZE)
+BENCHMARK_KM_CONCURRENT(SHA256withRSA, 2048, SMALL_MESSAGE_SIZE)
+BENCHMARK_KM_CONCURRENT(SHA256withRSA/PSS, 2048, SMALL_MESSAGE_SIZE)
+BENCHMARK_KM_CONCURRENT(HmacSHA256, 256, SMALL_MESSAGE_SIZE)
+
+BENCHMARK_KM(operation_slots, SHA256withECDSA, 256)
+BENCHMARK_KM(operation_slots, HmacSHA256, 256)
 // clang-format on
 }  // namespace aidl::android::hardware::security::keymint::test
 
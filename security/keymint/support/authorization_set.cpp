@@ -16,6 +16,8 @@
 
 #include <keymint_support/authorization_set.h>
 
+#include <algorithm>
+
 #include <aidl/android/hardware/security/keymint/Algorithm.h>
 #include <aidl/android/hardware/security/keymint/BlockMode.h>
 #include <aidl/android/hardware/security/keymint/Digest.h>
@@ -24,28 +26,27 @@
 
 namespace aidl::android::hardware::security::keymint {
 
+namespace {
+
+// Orders KeyParameters by tag alone, for binary searching a sorted set.
+struct TagLess {
+    bool operator()(const KeyParameter& param, Tag tag) const { return param.tag < tag; }
+    bool operator()(Tag tag, const KeyParameter& param) const { return tag < param.tag; }
+};
+
+}  // namespace
+
 void AuthorizationSet::Sort() {
     std::sort(data_.begin(), data_.end());
+    sorted_ = true;
 }
 
 void AuthorizationSet::Deduplicate() {
-    if (data_.empty()) return;
-
     Sort();
-    std::vector<KeyParameter> result;
-
-    auto curr = data_.begin();
-    auto prev = curr++;
-    for (; curr != data_.end(); ++prev, ++curr) {
-        if (prev->tag == Tag::INVALID) continue;
-
-        if (*prev != *curr) {
-            result.push_back(std::move(*prev));
-        }
-    }
-    result.push_back(std::move(*prev));
-
-    std::swap(data_, result);
+    data_.erase(std::remove_if(data_.begin(), data_.end(),
+                               [](const KeyParameter& param) { return param.tag == Tag::INVALID; }),
+                data_.end());
+    data_.erase(std::unique(data_.begin(), data_.end()), data_.end());
 }
 
 void AuthorizationSet::Union(const AuthorizationSet& other) {
@@ -71,6 +72,7 @@ void AuthorizationSet::Subtract(const AuthorizationSet& other) {
 }
 
 KeyParameter& AuthorizationSet::operator[](int at) {
+    sorted_ = false;  // The caller may change the tag through the reference.
     return data_[at];
 }
 
@@ -80,9 +82,14 @@ const KeyParameter& AuthorizationSet::operator[](int at) const {
 
 void AuthorizationSet::Clear() {
     data_.clear();
+    sorted_ = true;
 }
 
 size_t AuthorizationSet::GetTagCount(Tag tag) const {
+    if (sorted_) {
+        auto [first, last] = std::equal_range(data_.begin(), data_.end(), tag, TagLess());
+        return last - first;
+    }
     size_t count = 0;
     for (int pos = -1; (pos = find(tag, pos)) != -1;) ++count;
     return count;
@@ -91,6 +98,13 @@ size_t AuthorizationSet::GetTagCount(Tag tag) const {
 int AuthorizationSet::find(Tag tag, int begin) const {
     auto iter = data_.begin() + (1 + begin);
 
+    if (sorted_) {
+        // All entries for tag are contiguous, start at the first one unless begin is past it.
+        iter = std::max(iter, std::lower_bound(data_.begin(), data_.end(), tag, TagLess()));
+        if (iter != data_.end() && iter->tag == tag) return iter - data_.begin();
+        return -1;
+    }
+
     while (iter != data_.end() && iter->tag != tag) ++iter;
 
     if (iter != data_.end()) return iter - data_.begin();
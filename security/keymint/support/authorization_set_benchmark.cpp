@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <keymint_support/authorization_set.h>
+
+#include <benchmark/benchmark.h>
+
+namespace aidl::android::hardware::security::keymint {
+
+namespace {
+
+// The characteristics a KeyMint implementation typically returns for a hardware-backed RSA
+// signing key, in the order they are usually reported in.
+AuthorizationSet makeKeyCharacteristics() {
+    return AuthorizationSetBuilder()
+            .RsaSigningKey(2048, 65537)
+            .Digest(Digest::NONE, Digest::SHA1, Digest::SHA_2_256, Digest::SHA_2_512)
+            .Padding(PaddingMode::NONE, PaddingMode::RSA_PSS, PaddingMode::RSA_PKCS1_1_5_SIGN)
+            .Authorization(TAG_NO_AUTH_REQUIRED)
+            .Authorization(TAG_ORIGIN, KeyOrigin::GENERATED)
+            .Authorization(TAG_OS_VERSION, 120000)
+            .Authorization(TAG_OS_PATCHLEVEL, 202110)
+            .Authorization(TAG_VENDOR_PATCHLEVEL, 20211005)
+            .Authorization(TAG_BOOT_PATCHLEVEL, 20211005)
+            .Authorization(TAG_CREATION_DATETIME, 1633392000000)
+            .Authorization(TAG_USER_ID, 0)
+            .SetDefaultValidity();
+}
+
+// The lookups done when validating an operation against the key characteristics.
+void lookUpOperationTags(const AuthorizationSet& characteristics) {
+    benchmark::DoNotOptimize(characteristics.GetTagValue(TAG_ALGORITHM));
+    benchmark::DoNotOptimize(characteristics.GetTagValue(TAG_KEY_SIZE));
+    benchmark::DoNotOptimize(characteristics.Contains(TAG_PURPOSE, KeyPurpose::SIGN));
+    benchmark::DoNotOptimize(characteristics.Contains(TAG_DIGEST, Digest::SHA_2_256));
+    benchmark::DoNotOptimize(characteristics.Contains(TAG_PADDING, PaddingMode::RSA_PSS));
+    benchmark::DoNotOptimize(characteristics.Contains(TAG_NO_AUTH_REQUIRED));
+    benchmark::DoNotOptimize(characteristics.Contains(TAG_USER_SECURE_ID));
+    benchmark::DoNotOptimize(characteristics.GetTagCount(TAG_DIGEST));
+    benchmark::DoNotOptimize(characteristics.GetTagValue(TAG_USAGE_EXPIRE_DATETIME));
+    benchmark::DoNotOptimize(characteristics.GetTagValue(TAG_MIN_SECONDS_BETWEEN_OPS));
+}
+
+void BM_LookUpUnsorted(benchmark::State& state) {
+    const AuthorizationSet characteristics = makeKeyCharacteristics();
+    for (auto _ : state) {
+        lookUpOperationTags(characteristics);
+    }
+}
+BENCHMARK(BM_LookUpUnsorted);
+
+void BM_LookUpSorted(benchmark::State& state) {
+    AuthorizationSet characteristics = makeKeyCharacteristics();
+    characteristics.Sort();
+    for (auto _ : state) {
+        lookUpOperationTags(characteristics);
+    }
+}
+BENCHMARK(BM_LookUpSorted);
+
+void BM_Deduplicate(benchmark::State& state) {
+    const AuthorizationSet characteristics = makeKeyCharacteristics();
+    for (auto _ : state) {
+        AuthorizationSet copy = characteristics;
+        copy.push_back(characteristics);
+        copy.Deduplicate();
+        benchmark::DoNotOptimize(copy.size());
+    }
+}
+BENCHMARK(BM_Deduplicate);
+
+}  // namespace
+
+}  // namespace aidl::android::hardware::security::keymint
+
+BENCHMARK_MAIN();
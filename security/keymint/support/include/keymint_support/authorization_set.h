@@ -34,6 +34,10 @@ class AuthorizationSetBuilder;
 /**
  * A collection of KeyParameters. It provides memory ownership and some convenient functionality for
  * sorting, deduplicating, joining, and subtracting sets of KeyParameters.
+ *
+ * Once the set has been sorted (or deduplicated), tag lookups are logarithmic until it is modified
+ * through anything but push_back() of a parameter that keeps the tags in order, or erase().  Do
+ * not change the tag of an entry through a reference obtained before the set was sorted.
  */
 class AuthorizationSet {
   public:
@@ -45,10 +49,11 @@ class AuthorizationSet {
     AuthorizationSet(){};
 
     // Copy constructor.
-    AuthorizationSet(const AuthorizationSet& other) : data_(other.data_) {}
+    AuthorizationSet(const AuthorizationSet& other) : data_(other.data_), sorted_(other.sorted_) {}
 
     // Move constructor.
-    AuthorizationSet(AuthorizationSet&& other) noexcept : data_(std::move(other.data_)) {}
+    AuthorizationSet(AuthorizationSet&& other) noexcept
+        : data_(std::move(other.data_)), sorted_(other.sorted_) {}
 
     // Constructor from vector<KeyParameter>
     AuthorizationSet(const vector<KeyParameter>& other) { *this = other; }
@@ -56,12 +61,14 @@ class AuthorizationSet {
     // Copy assignment.
     AuthorizationSet& operator=(const AuthorizationSet& other) {
         data_ = other.data_;
+        sorted_ = other.sorted_;
         return *this;
     }
 
     // Move assignment.
     AuthorizationSet& operator=(AuthorizationSet&& other) noexcept {
         data_ = std::move(other.data_);
+        sorted_ = other.sorted_;
         return *this;
     }
 
@@ -73,6 +80,7 @@ class AuthorizationSet {
                  * See assignment operator/copy constructor of vector.*/
                 data_[i] = other[i];
             }
+            sorted_ = false;
         }
         return *this;
     }
@@ -136,13 +144,19 @@ class AuthorizationSet {
     /**
      * Returns iterator (pointer) to beginning of elems array, to enable STL-style iteration
      */
-    auto begin() { return data_.begin(); }
+    auto begin() {
+        sorted_ = false;  // The caller may change tags through the iterator.
+        return data_.begin();
+    }
     auto begin() const { return data_.begin(); }
 
     /**
      * Returns iterator (pointer) one past end of elems array, to enable STL-style iteration
      */
-    auto end() { return data_.end(); }
+    auto end() {
+        sorted_ = false;
+        return data_.end();
+    }
     auto end() const { return data_.end(); }
 
     /**
@@ -166,8 +180,8 @@ class AuthorizationSet {
 
     template <TagType tag_type, Tag tag, typename ValueT>
     bool Contains(TypedTag<tag_type, tag> ttag, const ValueT& value) const {
-        for (const auto& param : data_) {
-            auto entry = authorizationValue(ttag, param);
+        for (int pos = -1; (pos = find(tag, pos)) != -1;) {
+            auto entry = authorizationValue(ttag, data_[pos]);
             if (entry && static_cast<ValueT>(*entry) == value) return true;
         }
         return false;
@@ -184,8 +198,14 @@ class AuthorizationSet {
         return {};
     }
 
-    void push_back(const KeyParameter& param) { data_.push_back(param); }
-    void push_back(KeyParameter&& param) { data_.push_back(std::move(param)); }
+    void push_back(const KeyParameter& param) {
+        KeepSorted(param);
+        data_.push_back(param);
+    }
+    void push_back(KeyParameter&& param) {
+        KeepSorted(param);
+        data_.push_back(std::move(param));
+    }
     void push_back(const AuthorizationSet& set) {
         for (auto& entry : set) {
             push_back(entry);
@@ -221,7 +241,15 @@ class AuthorizationSet {
   private:
     std::optional<std::reference_wrapper<const KeyParameter>> GetEntry(Tag tag) const;
 
+    // Appending keeps the set sorted by tag as long as the tags don't go down.
+    void KeepSorted(const KeyParameter& param) {
+        sorted_ = sorted_ && (data_.empty() || !(param.tag < data_.back().tag));
+    }
+
     std::vector<KeyParameter> data_;
+    // True while data_ is ordered by tag, so that the entries for one tag are contiguous and can
+    // be found by binary search.
+    bool sorted_ = true;
 };
 
 class AuthorizationSetBuilder : public AuthorizationSet {
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <map>
+#include <utility>
 #include <vector>
 
 #include <keymaster/cppcose/cppcose.h>
@@ -115,6 +117,22 @@ struct BccEntryData {
  */
 ErrMsgOr<std::vector<BccEntryData>> validateBcc(const cppbor::Array* bcc);
 
+/**
+ * Validates BCCs like validateBcc, remembering the entries whose signatures it has verified. When
+ * checking a batch of CSRs, which mostly come from the same device or at least share a firmware
+ * signing chain, each distinct BCC entry then only has its signature verified once.
+ */
+class BccValidator {
+  public:
+    ErrMsgOr<std::vector<BccEntryData>> validate(const cppbor::Array* bcc);
+
+  private:
+    ErrMsgOr<bytevec> verifyEntry(const cppbor::Array* entry, const bytevec& signingKey);
+
+    // Maps the signing key and the encoded COSE_Sign1 of each verified entry to its subject key.
+    std::map<std::pair<bytevec, bytevec>, bytevec> mVerifiedEntries;
+};
+
 struct JsonOutput {
     static JsonOutput Ok(std::string json) { return {std::move(json), ""}; }
     static JsonOutput Error(std::string error) { return {"", std::move(error)}; }
@@ -15,6 +15,7 @@
  */
 
 #include <iterator>
+#include <string_view>
 #include <tuple>
 
 #include <aidl/android/hardware/security/keymint/RpcHardwareInfo.h>
@@ -294,6 +295,31 @@ ErrMsgOr<bytevec> validatePayloadAndFetchPubKey(const cppbor::Map* payload) {
     return serializedKey->asBstr()->value();
 }
 
+// Encodes the Sig_structure of a COSE_Sign1 (RFC 8152 section 4.4) straight into one buffer, rather
+// than copying the protected params and the payload into a temporary cppbor::Array to encode it.
+bytevec encodeCoseSign1SignatureInput(const bytevec& protectedParams, const bytevec& aad,
+                                      const bytevec& payload) {
+    static constexpr std::string_view kContext = "Signature1";
+
+    bytevec result;
+    result.reserve(cppbor::headerSize(4) + cppbor::headerSize(kContext.size()) + kContext.size() +
+                   cppbor::headerSize(protectedParams.size()) + protectedParams.size() +
+                   cppbor::headerSize(aad.size()) + aad.size() +
+                   cppbor::headerSize(payload.size()) + payload.size());
+    auto appendBstr = [&result](const bytevec& value) {
+        cppbor::encodeHeader(cppbor::BSTR, value.size(), std::back_inserter(result));
+        result.insert(result.end(), value.begin(), value.end());
+    };
+
+    cppbor::encodeHeader(cppbor::ARRAY, 4, std::back_inserter(result));
+    cppbor::encodeHeader(cppbor::TSTR, kContext.size(), std::back_inserter(result));
+    result.insert(result.end(), kContext.begin(), kContext.end());
+    appendBstr(protectedParams);
+    appendBstr(aad);
+    appendBstr(payload);
+    return result;
+}
+
 ErrMsgOr<bytevec> verifyAndParseCoseSign1Cwt(const cppbor::Array* coseSign1,
                                              const bytevec& signingCoseKey, const bytevec& aad) {
     if (!coseSign1 || coseSign1->size() != kCoseSign1EntryCount) {
@@ -333,7 +359,7 @@ ErrMsgOr<bytevec> verifyAndParseCoseSign1Cwt(const cppbor::Array* coseSign1,
 
     bool selfSigned = signingCoseKey.empty();
     bytevec signatureInput =
-        cppbor::Array().add("Signature1").add(*protectedParams).add(aad).add(*payload).encode();
+        encodeCoseSign1SignatureInput(protectedParams->value(), aad, payload->value());
 
     if (algorithm->asInt()->value() == EDDSA) {
         auto key = CoseKey::parseEd25519(selfSigned ? *serializedKey : signingCoseKey);
@@ -368,6 +394,10 @@ ErrMsgOr<bytevec> verifyAndParseCoseSign1Cwt(const cppbor::Array* coseSign1,
 }
 
 ErrMsgOr<std::vector<BccEntryData>> validateBcc(const cppbor::Array* bcc) {
+    return BccValidator().validate(bcc);
+}
+
+ErrMsgOr<std::vector<BccEntryData>> BccValidator::validate(const cppbor::Array* bcc) {
     if (!bcc || bcc->size() == 0) return "Invalid BCC";
 
     std::vector<BccEntryData> result;
@@ -382,7 +412,7 @@ ErrMsgOr<std::vector<BccEntryData>> validateBcc(const cppbor::Array* bcc) {
         if (!entry || entry->size() != kCoseSign1EntryCount) {
             return "Invalid BCC entry " + std::to_string(i) + ": " + prettyPrint(entry);
         }
-        auto payload = verifyAndParseCoseSign1Cwt(entry, std::move(prevKey), bytevec{} /* AAD */);
+        auto payload = verifyEntry(entry, prevKey);
         if (!payload) {
             return "Failed to verify entry " + std::to_string(i) + ": " + payload.moveMessage();
         }
@@ -408,6 +438,17 @@ ErrMsgOr<std::vector<BccEntryData>> validateBcc(const cppbor::Array* bcc) {
     return result;
 }
 
+ErrMsgOr<bytevec> BccValidator::verifyEntry(const cppbor::Array* entry, const bytevec& signingKey) {
+    auto cacheKey = std::make_pair(signingKey, entry->encode());
+    auto it = mVerifiedEntries.find(cacheKey);
+    if (it != mVerifiedEntries.end()) return it->second;
+
+    auto payload = verifyAndParseCoseSign1Cwt(entry, signingKey, bytevec{} /* AAD */);
+    if (!payload) return payload;
+    mVerifiedEntries.emplace(std::move(cacheKey), *payload);
+    return payload;
+}
+
 JsonOutput jsonEncodeCsrWithBuild(const std::string instance_name, const cppbor::Array& csr) {
     const std::string kFingerprintProp = "ro.build.fingerprint";
 
@@ -133,6 +133,37 @@ validateAndExtractEcdsa256EekPubAndId(bool testMode,
                            eek->getBstrValue(CoseKey::KEY_ID).value());
 }
 
+// Builds a self-signed BCC of a device key followed by one Ed25519 entry for a leaf key.
+cppbor::Array generateEd25519Bcc() {
+    bytevec devicePub(ED25519_PUBLIC_KEY_LEN), devicePriv(ED25519_PRIVATE_KEY_LEN);
+    bytevec leafPub(ED25519_PUBLIC_KEY_LEN), leafPriv(ED25519_PRIVATE_KEY_LEN);
+    ED25519_keypair(devicePub.data(), devicePriv.data());
+    ED25519_keypair(leafPub.data(), leafPriv.data());
+
+    auto coseKey = [](const bytevec& pubKey) {
+        return cppbor::Map()
+                .add(CoseKey::KEY_TYPE, OCTET_KEY_PAIR)
+                .add(CoseKey::ALGORITHM, EDDSA)
+                .add(CoseKey::CURVE, ED25519)
+                .add(CoseKey::PUBKEY_X, pubKey);
+    };
+    auto entry = [](const bytevec& signingKey, const cppbor::Map& subjectKey) {
+        bytevec payload = cppbor::Map()
+                                  .add(1 /* issuer */, "issuer")
+                                  .add(2 /* subject */, "subject")
+                                  .add(-4670553 /* key usage */, bytevec{0x20})
+                                  .add(-4670552 /* subject public key */, subjectKey.encode())
+                                  .encode();
+        return cppcose::constructCoseSign1(signingKey, payload, /*aad=*/{}).moveValue();
+    };
+
+    cppbor::Array bcc;
+    bcc.add(coseKey(devicePub));
+    bcc.add(entry(devicePriv, coseKey(devicePub)));
+    bcc.add(entry(devicePriv, coseKey(leafPub)));
+    return bcc;
+}
+
 TEST(RemoteProvUtilsTest, GenerateEekChainInvalidLength) {
     ASSERT_FALSE(generateEekChain(RpcHardwareInfo::CURVE_25519, 1, /*eekId=*/{}));
 }
@@ -248,5 +279,33 @@ TEST(RemoteProvUtilsTest, GetProdEcdsaEekChain) {
     EXPECT_THAT(eekPubY, ElementsAreArray(geek->getBstrValue(CoseKey::PUBKEY_Y).value_or(empty)));
 }
 
+TEST(RemoteProvUtilsTest, ValidateBcc) {
+    cppbor::Array bcc = generateEd25519Bcc();
+    auto result = validateBcc(&bcc);
+    ASSERT_TRUE(result) << result.message();
+    ASSERT_EQ(result->size(), 2);
+    EXPECT_EQ(result->at(0).pubKey, bcc.get(0)->encode());
+}
+
+TEST(RemoteProvUtilsTest, BccValidatorReusesVerifiedEntries) {
+    cppbor::Array bcc = generateEd25519Bcc();
+    BccValidator validator;
+    auto first = validator.validate(&bcc);
+    ASSERT_TRUE(first) << first.message();
+    auto second = validator.validate(&bcc);
+    ASSERT_TRUE(second) << second.message();
+    ASSERT_EQ(first->size(), second->size());
+    for (size_t i = 0; i < first->size(); ++i) {
+        EXPECT_EQ(first->at(i).pubKey, second->at(i).pubKey);
+    }
+
+    // A tampered signature is still rejected, as the entry no longer matches a verified one.
+    auto& signature = bcc.get(2)->asArray()->get(kCoseSign1Signature);
+    bytevec badSignature = signature->asBstr()->value();
+    badSignature[0] ^= 1;
+    signature = std::make_unique<cppbor::Bstr>(badSignature);
+    EXPECT_FALSE(validator.validate(&bcc));
+}
+
 }  // namespace
 }  // namespace aidl::android::hardware::security::keymint::remote_prov
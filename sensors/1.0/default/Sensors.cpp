@@ -162,7 +162,19 @@ Return<void> Sensors::poll(int32_t maxCount, poll_cb _hidl_cb) {
     hidl_vec<Event> out;
     hidl_vec<SensorInfo> dynamicSensorsAdded;
 
-    std::unique_ptr<sensors_event_t[]> data;
+    // The events are delivered from the poll buffers, a poll that finds them still in use by
+    // the previous one gets its own.
+    std::unique_lock<std::mutex> bufferLock(mPollBufferLock, std::try_to_lock);
+    std::unique_ptr<sensors_event_t[]> ownData;
+    std::unique_ptr<Event[]> ownEvents;
+    sensors_event_t *data = mPollBuffer;
+    Event *events = mPollEvents;
+    if (!bufferLock.owns_lock()) {
+        ownData.reset(new sensors_event_t[kPollMaxBufferSize]);
+        ownEvents.reset(new Event[kPollMaxBufferSize]);
+        data = ownData.get();
+        events = ownEvents.get();
+    }
     int err = android::NO_ERROR;
 
     { // scope of reentry lock
@@ -187,10 +199,9 @@ Return<void> Sensors::poll(int32_t maxCount, poll_cb _hidl_cb) {
             err = android::BAD_VALUE;
         } else {
             int bufferSize = maxCount <= kPollMaxBufferSize ? maxCount : kPollMaxBufferSize;
-            data.reset(new sensors_event_t[bufferSize]);
             err = mSensorDevice->poll(
                     reinterpret_cast<sensors_poll_device_t *>(mSensorDevice),
-                    data.get(), bufferSize);
+                    data, bufferSize);
         }
     }
 
@@ -201,6 +212,9 @@ Return<void> Sensors::poll(int32_t maxCount, poll_cb _hidl_cb) {
 
     const size_t count = (size_t)err;
 
+    convertFromSensorEvents(count, data, events);
+    out.setToExternal(events, count);
+
     for (size_t i = 0; i < count; ++i) {
         if (data[i].type != SENSOR_TYPE_DYNAMIC_SENSOR_META) {
             continue;
@@ -223,9 +237,6 @@ Return<void> Sensors::poll(int32_t maxCount, poll_cb _hidl_cb) {
         dynamicSensorsAdded[numDynamicSensors] = info;
     }
 
-    out.resize(count);
-    convertFromSensorEvents(err, data.get(), &out);
-
     _hidl_cb(Result::OK, out, dynamicSensorsAdded);
 
     return Void();
@@ -332,12 +343,9 @@ Return<void> Sensors::configDirectReport(
 void Sensors::convertFromSensorEvents(
         size_t count,
         const sensors_event_t *srcArray,
-        hidl_vec<Event> *dstVec) {
+        Event *dstArray) {
     for (size_t i = 0; i < count; ++i) {
-        const sensors_event_t &src = srcArray[i];
-        Event *dst = &(*dstVec)[i];
-
-        convertFromSensorEvent(src, dst);
+        convertFromSensorEvent(srcArray[i], &dstArray[i]);
     }
 }
 
@@ -69,10 +69,15 @@ private:
     sensors_poll_device_1_t *mSensorDevice;
     std::mutex mPollLock;
 
+    // Reused by every poll, unless the previous one is still delivering its events
+    std::mutex mPollBufferLock;
+    sensors_event_t mPollBuffer[kPollMaxBufferSize];
+    Event mPollEvents[kPollMaxBufferSize];
+
     int getHalDeviceVersion() const;
 
     static void convertFromSensorEvents(
-            size_t count, const sensors_event_t *src, hidl_vec<Event> *dst);
+            size_t count, const sensors_event_t *src, Event *dst);
 
     DISALLOW_COPY_AND_ASSIGN(Sensors);
 };
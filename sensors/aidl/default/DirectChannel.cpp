@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sensors-impl/DirectChannel.h"
+
+#include <log/log.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+namespace {
+
+using EventPayload = ::aidl::android::hardware::sensors::Event::EventPayload;
+
+constexpr size_t kEventSize =
+        static_cast<size_t>(ISensors::DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH);
+constexpr size_t kDataSize =
+        static_cast<size_t>(ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_RESERVED -
+                            ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_DATA);
+
+// Flattens the payload to the float[16] data field of a direct report record.
+void fillEventData(const EventPayload& payload, float* data) {
+    switch (payload.getTag()) {
+        case EventPayload::Tag::vec3: {
+            const auto& vec3 = payload.get<EventPayload::Tag::vec3>();
+            data[0] = vec3.x;
+            data[1] = vec3.y;
+            data[2] = vec3.z;
+            break;
+        }
+        case EventPayload::Tag::vec4: {
+            const auto& vec4 = payload.get<EventPayload::Tag::vec4>();
+            data[0] = vec4.x;
+            data[1] = vec4.y;
+            data[2] = vec4.z;
+            data[3] = vec4.w;
+            break;
+        }
+        case EventPayload::Tag::uncal: {
+            const auto& uncal = payload.get<EventPayload::Tag::uncal>();
+            data[0] = uncal.x;
+            data[1] = uncal.y;
+            data[2] = uncal.z;
+            data[3] = uncal.xBias;
+            data[4] = uncal.yBias;
+            data[5] = uncal.zBias;
+            break;
+        }
+        case EventPayload::Tag::scalar:
+            data[0] = payload.get<EventPayload::Tag::scalar>();
+            break;
+        case EventPayload::Tag::data: {
+            const auto& values = payload.get<EventPayload::Tag::data>().values;
+            memcpy(data, values.data(), sizeof(float) * values.size());
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+}  // namespace
+
+std::unique_ptr<DirectChannel> DirectChannel::create(const SharedMemInfo& mem) {
+    if (mem.format != SharedMemInfo::SharedMemFormat::SENSORS_EVENT ||
+        mem.size < static_cast<int32_t>(kEventSize) || mem.memoryHandle.fds.empty()) {
+        ALOGE("Invalid direct channel memory: format %d, size %d, %zu fds",
+              static_cast<int>(mem.format), mem.size, mem.memoryHandle.fds.size());
+        return nullptr;
+    }
+
+    // The handle is owned by the binder call, keep our own reference to the memory.
+    ::android::base::unique_fd fd(dup(mem.memoryHandle.fds[0].get()));
+    if (!fd.ok()) {
+        ALOGE("Failed to dup direct channel fd: %s", strerror(errno));
+        return nullptr;
+    }
+
+    // Both ashmem regions and gralloc BLOB buffers can be mapped through their first fd.
+    void* addr = mmap(nullptr, mem.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (addr == MAP_FAILED) {
+        ALOGE("Failed to map direct channel memory: %s", strerror(errno));
+        return nullptr;
+    }
+
+    // The hardware is responsible for resetting the memory when the channel is registered.
+    memset(addr, 0, mem.size);
+    return std::unique_ptr<DirectChannel>(
+            new DirectChannel(mem.type, std::move(fd), static_cast<uint8_t*>(addr), mem.size));
+}
+
+DirectChannel::DirectChannel(SharedMemInfo::SharedMemType type, ::android::base::unique_fd fd,
+                             uint8_t* base, size_t size)
+    : mType(type), mFd(std::move(fd)), mBase(base), mSize(size), mWriteOffset(0), mCounter(1) {}
+
+DirectChannel::~DirectChannel() {
+    munmap(mBase, mSize);
+}
+
+void DirectChannel::write(const Event& event, int32_t reportToken) {
+    std::lock_guard<std::mutex> lock(mWriteLock);
+    if (mWriteOffset + kEventSize > mSize) {
+        mWriteOffset = 0;
+    }
+    uint8_t* record = mBase + mWriteOffset;
+
+    int32_t size = kEventSize;
+    int32_t type = static_cast<int32_t>(event.sensorType);
+    float data[kDataSize / sizeof(float)] = {};
+    fillEventData(event.payload, data);
+    memcpy(record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_FIELD, &size, sizeof(size));
+    memcpy(record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_REPORT_TOKEN, &reportToken,
+           sizeof(reportToken));
+    memcpy(record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_SENSOR_TYPE, &type,
+           sizeof(type));
+    memcpy(record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_TIMESTAMP, &event.timestamp,
+           sizeof(event.timestamp));
+    memcpy(record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_DATA, data, sizeof(data));
+    memset(record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_RESERVED, 0,
+           kEventSize - ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_RESERVED);
+
+    // Publish the record. The counter starts at 1 and skips 0 when it wraps around.
+    uint32_t* counter = reinterpret_cast<uint32_t*>(
+            record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_ATOMIC_COUNTER);
+    __atomic_store_n(counter, mCounter, __ATOMIC_RELEASE);
+    if (++mCounter == 0) {
+        mCounter = 1;
+    }
+    mWriteOffset += kEventSize;
+}
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
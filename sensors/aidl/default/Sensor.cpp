@@ -16,9 +16,12 @@
 
 #include "sensors-impl/Sensor.h"
 
+#include "sensors-impl/SensorScheduler.h"
 #include "utils/SystemClock.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using ::ndk::ScopedAStatus;
 
@@ -29,23 +32,27 @@ namespace sensors {
 
 static constexpr int32_t kDefaultMaxDelayUs = 10 * 1000 * 1000;
 
+// Nominal report rates of the direct report rate levels, see ISensors::RateLevel.
+static constexpr int64_t kDirectReportNormalPeriodNs = 1000 * 1000 * 1000 / 50;
+static constexpr int64_t kDirectReportFastPeriodNs = 1000 * 1000 * 1000 / 200;
+static constexpr int64_t kDirectReportVeryFastPeriodNs = 1000 * 1000 * 1000 / 800;
+
+// Continuous sensors that can report at every rate level to ashmem and gralloc direct channels.
+static constexpr uint32_t kDirectChannelFlags =
+        (static_cast<uint32_t>(ISensors::RateLevel::VERY_FAST)
+         << static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_SHIFT_DIRECT_REPORT)) |
+        static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_ASHMEM) |
+        static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_GRALLOC);
+
 Sensor::Sensor(ISensorsEventCallback* callback)
     : mIsEnabled(false),
       mSamplingPeriodNs(0),
-      mLastSampleTimeNs(0),
+      mNextSampleTimeNs(0),
+      mScheduler(nullptr),
       mCallback(callback),
-      mMode(OperationMode::NORMAL) {
-    mRunThread = std::thread(startThread, this);
-}
+      mMode(OperationMode::NORMAL) {}
 
-Sensor::~Sensor() {
-    std::unique_lock<std::mutex> lock(mRunMutex);
-    mStopThread = true;
-    mIsEnabled = false;
-    mWaitCV.notify_all();
-    lock.release();
-    mRunThread.join();
-}
+Sensor::~Sensor() {}
 
 const SensorInfo& Sensor::getSensorInfo() const {
     return mSensorInfo;
@@ -58,18 +65,23 @@ void Sensor::batch(int64_t samplingPeriodNs) {
         samplingPeriodNs = mSensorInfo.maxDelayUs * 1000LL;
     }
 
+    std::unique_lock<std::mutex> lock(mRunMutex);
     if (mSamplingPeriodNs != samplingPeriodNs) {
         mSamplingPeriodNs = samplingPeriodNs;
-        // Wake up the 'run' thread to check if a new event should be generated now
-        mWaitCV.notify_all();
+        // Align to the new period on the next poll
+        mNextSampleTimeNs = 0;
+        lock.unlock();
+        reschedule();
     }
 }
 
 void Sensor::activate(bool enable) {
+    std::unique_lock<std::mutex> lock(mRunMutex);
     if (mIsEnabled != enable) {
-        std::unique_lock<std::mutex> lock(mRunMutex);
         mIsEnabled = enable;
-        mWaitCV.notify_all();
+        mNextSampleTimeNs = 0;
+        lock.unlock();
+        reschedule();
     }
 }
 
@@ -97,34 +109,52 @@ ScopedAStatus Sensor::flush() {
     return ScopedAStatus::ok();
 }
 
-void Sensor::startThread(Sensor* sensor) {
-    sensor->run();
+void Sensor::setScheduler(SensorScheduler* scheduler) {
+    mScheduler = scheduler;
 }
 
-void Sensor::run() {
-    std::unique_lock<std::mutex> runLock(mRunMutex);
-    constexpr int64_t kNanosecondsInSeconds = 1000 * 1000 * 1000;
-
-    while (!mStopThread) {
-        if (!mIsEnabled || mMode == OperationMode::DATA_INJECTION) {
-            mWaitCV.wait(runLock, [&] {
-                return ((mIsEnabled && mMode == OperationMode::NORMAL) || mStopThread);
-            });
-        } else {
-            timespec curTime;
-            clock_gettime(CLOCK_BOOTTIME, &curTime);
-            int64_t now = (curTime.tv_sec * kNanosecondsInSeconds) + curTime.tv_nsec;
-            int64_t nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-
-            if (now >= nextSampleTime) {
-                mLastSampleTimeNs = now;
-                nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-                mCallback->postEvents(readEvents(), isWakeUpSensor());
-            }
+void Sensor::reschedule() {
+    if (mScheduler != nullptr) {
+        mScheduler->reschedule();
+    }
+}
+
+int64_t Sensor::poll(int64_t now, std::vector<Event>* events) {
+    std::lock_guard<std::mutex> lock(mRunMutex);
+    if (mMode == OperationMode::DATA_INJECTION) {
+        return std::numeric_limits<int64_t>::max();
+    }
+
+    int64_t nextSampleTime = std::numeric_limits<int64_t>::max();
+    if (mIsEnabled) {
+        if (mNextSampleTimeNs != 0 && now >= mNextSampleTimeNs) {
+            std::vector<Event> newEvents = readEvents();
+            events->insert(events->end(), newEvents.begin(), newEvents.end());
+        }
+        if (mNextSampleTimeNs == 0 || now >= mNextSampleTimeNs) {
+            // Samples stay on multiples of the period, even if this poll was late.
+            mNextSampleTimeNs = SensorScheduler::alignToPeriod(now, mSamplingPeriodNs);
+        }
+        nextSampleTime = mNextSampleTimeNs;
+    }
+    return std::min(nextSampleTime, writeDirectReports(now));
+}
 
-            mWaitCV.wait_for(runLock, std::chrono::nanoseconds(nextSampleTime - now));
+int64_t Sensor::writeDirectReports(int64_t now) {
+    int64_t nextSampleTime = std::numeric_limits<int64_t>::max();
+    for (auto& [channelHandle, report] : mDirectReports) {
+        if (report.nextSampleTimeNs != 0 && now >= report.nextSampleTimeNs) {
+            // Not readEvents(), direct reports are not filtered like on-change FMQ events.
+            for (const Event& event : Sensor::readEvents()) {
+                report.channel->write(event, report.reportToken);
+            }
+        }
+        if (report.nextSampleTimeNs == 0 || now >= report.nextSampleTimeNs) {
+            report.nextSampleTimeNs = SensorScheduler::alignToPeriod(now, report.samplingPeriodNs);
         }
+        nextSampleTime = std::min(nextSampleTime, report.nextSampleTimeNs);
     }
+    return nextSampleTime;
 }
 
 bool Sensor::isWakeUpSensor() {
@@ -144,10 +174,12 @@ std::vector<Event> Sensor::readEvents() {
 }
 
 void Sensor::setOperationMode(OperationMode mode) {
+    std::unique_lock<std::mutex> lock(mRunMutex);
     if (mMode != mode) {
-        std::unique_lock<std::mutex> lock(mRunMutex);
         mMode = mode;
-        mWaitCV.notify_all();
+        mNextSampleTimeNs = 0;
+        lock.unlock();
+        reschedule();
     }
 }
 
@@ -175,6 +207,48 @@ ScopedAStatus Sensor::injectEvent(const Event& event) {
             static_cast<int32_t>(BnSensors::ERROR_BAD_VALUE));
 }
 
+bool Sensor::supportsDirectChannel(SharedMemType type) const {
+    if (type == SharedMemType::ASHMEM) {
+        return mSensorInfo.flags &
+               static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_ASHMEM);
+    }
+    return mSensorInfo.flags &
+           static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_GRALLOC);
+}
+
+bool Sensor::supportsDirectReportRate(RateLevel rate) const {
+    uint32_t maxRate =
+            (mSensorInfo.flags &
+             static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_MASK_DIRECT_REPORT)) >>
+            static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_SHIFT_DIRECT_REPORT);
+    return static_cast<uint32_t>(rate) <= maxRate;
+}
+
+void Sensor::configDirectReport(int32_t channelHandle,
+                                const std::shared_ptr<DirectChannel>& channel,
+                                int32_t reportToken, RateLevel rate) {
+    std::unique_lock<std::mutex> lock(mRunMutex);
+    if (rate == RateLevel::STOP) {
+        mDirectReports.erase(channelHandle);
+        return;
+    }
+
+    int64_t samplingPeriodNs = kDirectReportNormalPeriodNs;
+    if (rate == RateLevel::FAST) {
+        samplingPeriodNs = kDirectReportFastPeriodNs;
+    } else if (rate == RateLevel::VERY_FAST) {
+        samplingPeriodNs = kDirectReportVeryFastPeriodNs;
+    }
+    mDirectReports[channelHandle] = {
+            .channel = channel,
+            .reportToken = reportToken,
+            .samplingPeriodNs = samplingPeriodNs,
+            .nextSampleTimeNs = 0,
+    };
+    lock.unlock();
+    reschedule();
+}
+
 OnChangeSensor::OnChangeSensor(ISensorsEventCallback* callback)
     : Sensor(callback), mPreviousEventSet(false) {}
 
@@ -216,7 +290,8 @@ AccelSensor::AccelSensor(int32_t sensorHandle, ISensorsEventCallback* callback)
     mSensorInfo.fifoReservedEventCount = 0;
     mSensorInfo.fifoMaxEventCount = 0;
     mSensorInfo.requiredPermission = "";
-    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION);
+    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION) |
+                        kDirectChannelFlags;
 };
 
 void AccelSensor::readEventPayload(EventPayload& payload) {
@@ -343,7 +418,7 @@ GyroSensor::GyroSensor(int32_t sensorHandle, ISensorsEventCallback* callback) :
     mSensorInfo.fifoReservedEventCount = 0;
     mSensorInfo.fifoMaxEventCount = 0;
     mSensorInfo.requiredPermission = "";
-    mSensorInfo.flags = 0;
+    mSensorInfo.flags = kDirectChannelFlags;
 };
 
 void GyroSensor::readEventPayload(EventPayload& payload) {
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sensors-impl/SensorScheduler.h"
+
+#include <log/log.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+namespace {
+
+constexpr int64_t kNanosecondsInSeconds = 1000 * 1000 * 1000;
+
+int64_t getBootTimeNs() {
+    timespec curTime;
+    clock_gettime(CLOCK_BOOTTIME, &curTime);
+    return (curTime.tv_sec * kNanosecondsInSeconds) + curTime.tv_nsec;
+}
+
+void postIfNotEmpty(ISensorsEventCallback* callback, const std::vector<Event>& events,
+                    bool wakeup) {
+    if (!events.empty()) {
+        callback->postEvents(events, wakeup);
+    }
+}
+
+}  // namespace
+
+SensorScheduler::SensorScheduler(ISensorsEventCallback* callback)
+    : mCallback(callback),
+      mTimerFd(timerfd_create(CLOCK_BOOTTIME, TFD_CLOEXEC)),
+      mRescheduleRequested(false),
+      mStopThread(false) {
+    if (!mTimerFd.ok()) {
+        ALOGE("Failed to create the sensor scheduler timer: %s", strerror(errno));
+        return;
+    }
+    mThread = std::thread(&SensorScheduler::run, this);
+}
+
+SensorScheduler::~SensorScheduler() {
+    stop();
+}
+
+void SensorScheduler::addSensor(Sensor* sensor) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mSensors.push_back(sensor);
+    sensor->setScheduler(this);
+}
+
+void SensorScheduler::reschedule() {
+    std::lock_guard<std::mutex> timerLock(mTimerLock);
+    mRescheduleRequested = true;
+    // An absolute time in the past expires immediately.
+    armTimer(1);
+}
+
+void SensorScheduler::stop() {
+    mStopThread = true;
+    if (mThread.joinable()) {
+        armTimer(1);
+        mThread.join();
+    }
+}
+
+int64_t SensorScheduler::alignToPeriod(int64_t now, int64_t periodNs) {
+    if (periodNs <= 0) {
+        return now;
+    }
+    return (now / periodNs + 1) * periodNs;
+}
+
+void SensorScheduler::armTimer(int64_t timeNs) {
+    itimerspec spec = {};
+    spec.it_value.tv_sec = timeNs / kNanosecondsInSeconds;
+    spec.it_value.tv_nsec = timeNs % kNanosecondsInSeconds;
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        ALOGE("Failed to arm the sensor scheduler timer: %s", strerror(errno));
+    }
+}
+
+void SensorScheduler::run() {
+    std::vector<Event> events;
+    std::vector<Event> wakeupEvents;
+
+    while (!mStopThread) {
+        uint64_t expirations;
+        ssize_t ret = TEMP_FAILURE_RETRY(read(mTimerFd.get(), &expirations, sizeof(expirations)));
+        if (ret != sizeof(expirations)) {
+            ALOGE("Failed to read the sensor scheduler timer: %s", strerror(errno));
+            continue;
+        }
+        if (mStopThread) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mLock);
+        {
+            std::lock_guard<std::mutex> timerLock(mTimerLock);
+            mRescheduleRequested = false;
+        }
+        int64_t now = getBootTimeNs();
+        int64_t nextSampleTime = std::numeric_limits<int64_t>::max();
+        for (Sensor* sensor : mSensors) {
+            std::vector<Event>& output = sensor->isWakeUpSensor() ? wakeupEvents : events;
+            nextSampleTime = std::min(nextSampleTime, sensor->poll(now, &output));
+        }
+        postIfNotEmpty(mCallback, events, false /* wakeup */);
+        postIfNotEmpty(mCallback, wakeupEvents, true /* wakeup */);
+        events.clear();
+        wakeupEvents.clear();
+
+        // A sensor that was rescheduled while we polled has armed the timer to expire now, don't
+        // overwrite that with a later time.
+        std::lock_guard<std::mutex> timerLock(mTimerLock);
+        if (!mRescheduleRequested) {
+            armTimer(nextSampleTime == std::numeric_limits<int64_t>::max() ? 0 : nextSampleTime);
+        }
+    }
+}
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -52,13 +52,42 @@ ScopedAStatus Sensors::batch(int32_t in_sensorHandle, int64_t in_samplingPeriodN
     return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
 }
 
-ScopedAStatus Sensors::configDirectReport(int32_t /* in_sensorHandle */,
-                                          int32_t /* in_channelHandle */,
-                                          ISensors::RateLevel /* in_rate */,
-                                          int32_t* _aidl_return) {
-    *_aidl_return = EX_UNSUPPORTED_OPERATION;
+ScopedAStatus Sensors::configDirectReport(int32_t in_sensorHandle, int32_t in_channelHandle,
+                                          ISensors::RateLevel in_rate, int32_t* _aidl_return) {
+    if (!supportsDirectChannels()) {
+        return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+
+    std::lock_guard<std::mutex> lock(mDirectChannelLock);
+    auto channel = mDirectChannels.find(in_channelHandle);
+    if (channel == mDirectChannels.end()) {
+        return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    *_aidl_return = 0;
+    if (in_sensorHandle == -1) {
+        // A sensor handle of -1 stops all the sensors reporting to the channel.
+        if (in_rate != ISensors::RateLevel::STOP) {
+            return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+        }
+        for (const auto& sensor : mSensors) {
+            sensor.second->configDirectReport(in_channelHandle, nullptr, 0, in_rate);
+        }
+        return ScopedAStatus::ok();
+    }
 
-    return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    auto sensor = mSensors.find(in_sensorHandle);
+    if (sensor == mSensors.end() ||
+        !sensor->second->supportsDirectChannel(channel->second->getType()) ||
+        !sensor->second->supportsDirectReportRate(in_rate)) {
+        return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    // There is at most one sensor per handle, so the handle identifies the sensor in the channel.
+    int32_t reportToken = in_rate == ISensors::RateLevel::STOP ? 0 : in_sensorHandle;
+    sensor->second->configDirectReport(in_channelHandle, channel->second, reportToken, in_rate);
+    *_aidl_return = reportToken;
+    return ScopedAStatus::ok();
 }
 
 ScopedAStatus Sensors::flush(int32_t in_sensorHandle) {
@@ -133,11 +162,32 @@ ScopedAStatus Sensors::injectSensorData(const Event& in_event) {
     return ScopedAStatus::fromServiceSpecificError(static_cast<int32_t>(ERROR_BAD_VALUE));
 }
 
-ScopedAStatus Sensors::registerDirectChannel(const ISensors::SharedMemInfo& /* in_mem */,
+ScopedAStatus Sensors::registerDirectChannel(const ISensors::SharedMemInfo& in_mem,
                                              int32_t* _aidl_return) {
-    *_aidl_return = EX_UNSUPPORTED_OPERATION;
+    if (!supportsDirectChannels()) {
+        return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
 
-    return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    bool typeSupported = false;
+    for (const auto& sensor : mSensors) {
+        typeSupported |= sensor.second->supportsDirectChannel(in_mem.type);
+    }
+    if (!typeSupported ||
+        in_mem.format != ISensors::SharedMemInfo::SharedMemFormat::SENSORS_EVENT ||
+        in_mem.size < DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH || in_mem.memoryHandle.fds.empty()) {
+        return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    std::shared_ptr<DirectChannel> channel = DirectChannel::create(in_mem);
+    if (channel == nullptr) {
+        return ScopedAStatus::fromServiceSpecificError(static_cast<int32_t>(ERROR_NO_MEMORY));
+    }
+
+    std::lock_guard<std::mutex> lock(mDirectChannelLock);
+    int32_t channelHandle = mNextDirectChannelHandle++;
+    mDirectChannels[channelHandle] = channel;
+    *_aidl_return = channelHandle;
+    return ScopedAStatus::ok();
 }
 
 ScopedAStatus Sensors::setOperationMode(OperationMode in_mode) {
@@ -147,8 +197,20 @@ ScopedAStatus Sensors::setOperationMode(OperationMode in_mode) {
     return ScopedAStatus::ok();
 }
 
-ScopedAStatus Sensors::unregisterDirectChannel(int32_t /* in_channelHandle */) {
-    return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ScopedAStatus Sensors::unregisterDirectChannel(int32_t in_channelHandle) {
+    if (!supportsDirectChannels()) {
+        return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+
+    std::lock_guard<std::mutex> lock(mDirectChannelLock);
+    if (mDirectChannels.erase(in_channelHandle) > 0) {
+        // The sensors hold a reference to the channel until their reports are stopped.
+        for (const auto& sensor : mSensors) {
+            sensor.second->configDirectReport(in_channelHandle, nullptr, 0,
+                                              ISensors::RateLevel::STOP);
+        }
+    }
+    return ScopedAStatus::ok();
 }
 
 }  // namespace sensors
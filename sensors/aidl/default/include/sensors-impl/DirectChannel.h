@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/sensors/BnSensors.h>
+#include <android-base/unique_fd.h>
+
+#include <memory>
+#include <mutex>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+// Shared memory registered with ISensors::registerDirectChannel. Sensors write events straight
+// into it in the SharedMemFormat::SENSORS_EVENT layout, without going through the Event FMQ.
+class DirectChannel {
+  public:
+    using Event = ::aidl::android::hardware::sensors::Event;
+    using SharedMemInfo = ::aidl::android::hardware::sensors::ISensors::SharedMemInfo;
+
+    // Maps the shared memory and clears it. Returns nullptr if the memory cannot be used.
+    static std::unique_ptr<DirectChannel> create(const SharedMemInfo& mem);
+    ~DirectChannel();
+
+    SharedMemInfo::SharedMemType getType() const { return mType; }
+
+    // Writes one event record at the current position, wrapping around at the end of the memory.
+    // The atomic counter is written last so that a reader never sees a half-written record.
+    void write(const Event& event, int32_t reportToken);
+
+  private:
+    DirectChannel(SharedMemInfo::SharedMemType type, ::android::base::unique_fd fd, uint8_t* base,
+                  size_t size);
+
+    const SharedMemInfo::SharedMemType mType;
+    const ::android::base::unique_fd mFd;
+    uint8_t* const mBase;
+    const size_t mSize;
+
+    // Several sensors may report to the same channel from their own threads.
+    std::mutex mWriteLock;
+    size_t mWriteOffset;
+    uint32_t mCounter;
+};
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
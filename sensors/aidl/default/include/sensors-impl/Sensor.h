@@ -14,15 +14,21 @@
  * limitations under the License.
  */
 
-#include <thread>
+#pragma once
+
+#include <map>
+#include <mutex>
 
 #include <aidl/android/hardware/sensors/BnSensors.h>
+#include "DirectChannel.h"
 
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace sensors {
 
+class SensorScheduler;
+
 class ISensorsEventCallback {
   public:
     using Event = ::aidl::android::hardware::sensors::Event;
@@ -34,6 +40,9 @@ class ISensorsEventCallback {
 class Sensor {
   public:
     using OperationMode = ::aidl::android::hardware::sensors::ISensors::OperationMode;
+    using RateLevel = ::aidl::android::hardware::sensors::ISensors::RateLevel;
+    using SharedMemType =
+            ::aidl::android::hardware::sensors::ISensors::SharedMemInfo::SharedMemType;
     using Event = ::aidl::android::hardware::sensors::Event;
     using EventPayload = ::aidl::android::hardware::sensors::Event::EventPayload;
     using SensorInfo = ::aidl::android::hardware::sensors::SensorInfo;
@@ -53,27 +62,53 @@ class Sensor {
     bool supportsDataInjection() const;
     ndk::ScopedAStatus injectEvent(const Event& event);
 
+    bool supportsDirectChannel(SharedMemType type) const;
+    bool supportsDirectReportRate(RateLevel rate) const;
+    // Starts, updates or, with RateLevel::STOP, stops the direct report to the given channel.
+    void configDirectReport(int32_t channelHandle, const std::shared_ptr<DirectChannel>& channel,
+                            int32_t reportToken, RateLevel rate);
+
+    bool isWakeUpSensor();
+
+    // Called by the scheduler the sensor is added to.
+    void setScheduler(SensorScheduler* scheduler);
+    // Appends the events due at now to events, writes the due direct reports and returns the time
+    // of the next sample. Called from the scheduler thread.
+    int64_t poll(int64_t now, std::vector<Event>* events);
+
   protected:
-    void run();
+    // A direct report configured with configDirectReport.
+    struct DirectReport {
+        std::shared_ptr<DirectChannel> channel;
+        int32_t reportToken;
+        int64_t samplingPeriodNs;
+        // 0 until the report is aligned to its period on the next poll.
+        int64_t nextSampleTimeNs;
+    };
+
+    // Writes the due direct reports and returns the time of the next one.
+    int64_t writeDirectReports(int64_t now);
     virtual std::vector<Event> readEvents();
     virtual void readEventPayload(EventPayload&) = 0;
-    static void startThread(Sensor* sensor);
-
-    bool isWakeUpSensor();
+    // Asks the scheduler to poll this sensor again. Must be called without holding mRunMutex.
+    void reschedule();
 
     bool mIsEnabled;
     int64_t mSamplingPeriodNs;
-    int64_t mLastSampleTimeNs;
+    // 0 until the sensor is aligned to its sampling period on the next poll.
+    int64_t mNextSampleTimeNs;
     SensorInfo mSensorInfo;
 
-    std::atomic_bool mStopThread;
-    std::condition_variable mWaitCV;
+    // Protects the sampling state against the scheduler thread.
     std::mutex mRunMutex;
-    std::thread mRunThread;
+    SensorScheduler* mScheduler;
 
     ISensorsEventCallback* mCallback;
 
     OperationMode mMode;
+
+    // Direct reports by channel handle, protected by mRunMutex.
+    std::map<int32_t, DirectReport> mDirectReports;
 };
 
 class OnChangeSensor : public Sensor {
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Sensor.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+// Generates the samples of all the sensors from a single timerfd thread. Each wakeup polls every
+// sensor and posts all the events that are due in one batch per wake-up class, instead of every
+// sensor waking up and posting on its own. Samples are placed on a grid of multiples of the
+// sampling period, so sensors enabled at the same or harmonic rates become due together.
+class SensorScheduler {
+  public:
+    explicit SensorScheduler(ISensorsEventCallback* callback);
+    ~SensorScheduler();
+
+    // Adds a sensor to poll. The sensor must outlive the scheduler thread, see stop().
+    void addSensor(Sensor* sensor);
+
+    // Polls all the sensors as soon as possible. Sensors call this when what they have to report
+    // changed, e.g. after being enabled or batched at a new rate.
+    void reschedule();
+
+    // Stops the scheduler thread, no event is posted once this returns.
+    void stop();
+
+    // Returns the first multiple of periodNs after now.
+    static int64_t alignToPeriod(int64_t now, int64_t periodNs);
+
+  private:
+    void run();
+    // Arms the timer to expire at the given CLOCK_BOOTTIME time, or disarms it if timeNs is 0.
+    void armTimer(int64_t timeNs);
+
+    ISensorsEventCallback* const mCallback;
+    ::android::base::unique_fd mTimerFd;
+
+    // Protects mSensors and serializes polling with adding sensors. Must not be taken while
+    // holding a sensor's lock.
+    std::mutex mLock;
+    std::vector<Sensor*> mSensors;
+
+    // Protects arming the timer. Never held while polling a sensor, so sensors can call
+    // reschedule() at any time.
+    std::mutex mTimerLock;
+    // Set by reschedule(), tells the thread the timer was armed while it was polling.
+    bool mRescheduleRequested;
+    std::atomic_bool mStopThread;
+    std::thread mThread;
+};
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -22,6 +22,7 @@
 #include <hardware_legacy/power.h>
 #include <map>
 #include "Sensor.h"
+#include "SensorScheduler.h"
 
 namespace aidl {
 namespace android {
@@ -40,9 +41,11 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
   public:
     Sensors()
         : mEventQueueFlag(nullptr),
+          mScheduler(this /* callback */),
           mNextHandle(1),
           mOutstandingWakeUpEvents(0),
           mReadWakeLockQueueRun(false),
+          mNextDirectChannelHandle(1),
           mAutoReleaseWakeLockTime(0),
           mHasWakeLock(false) {
         AddSensor<AccelSensor>();
@@ -57,6 +60,7 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     }
 
     virtual ~Sensors() {
+        mScheduler.stop();
         deleteEventFlag();
         mReadWakeLockQueueRun = false;
         mWakeLockThread.join();
@@ -115,6 +119,19 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
         std::shared_ptr<SensorType> sensor =
                 std::make_shared<SensorType>(mNextHandle++ /* sensorHandle */, this /* callback */);
         mSensors[sensor->getSensorInfo().sensorHandle] = sensor;
+        mScheduler.addSensor(sensor.get());
+    }
+
+    // Whether any sensor can report to a direct channel of any type
+    bool supportsDirectChannels() const {
+        using SharedMemType = ISensors::SharedMemInfo::SharedMemType;
+        for (const auto& sensor : mSensors) {
+            if (sensor.second->supportsDirectChannel(SharedMemType::ASHMEM) ||
+                sensor.second->supportsDirectChannel(SharedMemType::GRALLOC)) {
+                return true;
+            }
+        }
+        return false;
     }
 
     // Utility function to delete the Event Flag
@@ -192,6 +209,8 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     std::shared_ptr<::aidl::android::hardware::sensors::ISensorsCallback> mCallback;
     // A map of the available sensors.
     std::map<int32_t, std::shared_ptr<Sensor>> mSensors;
+    // Generates the samples of all the sensors, batching the events that are due together.
+    SensorScheduler mScheduler;
     // The next available sensor handle.
     int32_t mNextHandle;
     // Lock to protect writes to the FMQs.
@@ -204,6 +223,12 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     std::thread mWakeLockThread;
     // Flag to indicate that the Wake Lock Thread should continue to run
     std::atomic_bool mReadWakeLockQueueRun;
+    // Lock to protect the direct channels.
+    std::mutex mDirectChannelLock;
+    // The registered direct channels, by channel handle.
+    std::map<int32_t, std::shared_ptr<DirectChannel>> mDirectChannels;
+    // The next available direct channel handle.
+    int32_t mNextDirectChannelHandle;
     // Track the time when the wake lock should automatically be released
     int64_t mAutoReleaseWakeLockTime;
     // Flag to indicate if a wake lock has been acquired
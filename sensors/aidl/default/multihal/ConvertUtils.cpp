@@ -356,6 +356,12 @@ void convertToAidlEvent(const V2_1Event& hidlEvent, AidlEvent* aidlEvent) {
     }
 }
 
+void convertToAidlEvents(const V2_1Event* hidlEvents, size_t count, AidlEvent* aidlEvents) {
+    for (size_t i = 0; i < count; ++i) {
+        convertToAidlEvent(hidlEvents[i], &aidlEvents[i]);
+    }
+}
+
 }  // namespace implementation
 }  // namespace sensors
 }  // namespace hardware
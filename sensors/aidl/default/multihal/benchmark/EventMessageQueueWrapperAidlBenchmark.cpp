@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ConvertUtils.h"
+#include "EventMessageQueueWrapperAidl.h"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace implementation {
+
+namespace {
+
+using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
+using AidlEvent = ::aidl::android::hardware::sensors::Event;
+using AidlEventQueue = ::android::AidlMessageQueue<AidlEvent, SynchronizedReadWrite>;
+using HidlEvent = ::android::hardware::sensors::V2_1::Event;
+using ::android::hardware::sensors::V2_1::SensorType;
+using ::android::hardware::sensors::V2_1::implementation::MAX_RECEIVE_BUFFER_EVENT_COUNT;
+
+// Large enough to hold several of the largest batches a sub-HAL can post.
+constexpr size_t kQueueSize = 256 * 32;
+
+std::vector<HidlEvent> makeEvents(size_t count) {
+    std::vector<HidlEvent> events(count);
+    for (size_t i = 0; i < count; i++) {
+        events[i].sensorHandle = 1;
+        events[i].sensorType = SensorType::ACCELEROMETER;
+        events[i].timestamp = i;
+        events[i].u.vec3.x = 1.0f;
+        events[i].u.vec3.y = 2.0f;
+        events[i].u.vec3.z = 9.8f;
+    }
+    return events;
+}
+
+// Writes batches of events the way the proxy does and drains them from a second queue mapped
+// from the same descriptor, the way the framework does. The argument is the batch size.
+class EventQueueBenchmark : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State& state) override {
+        auto queue = std::make_unique<AidlEventQueue>(kQueueSize, false /* configureEventFlag */);
+        mReader = std::make_unique<AidlEventQueue>(queue->dupeDesc());
+        mRawWriter = queue.get();
+        mWrapper = std::make_unique<EventMessageQueueWrapperAidl>(queue);
+        mEvents = makeEvents(state.range(0));
+        mReadBuffer.resize(state.range(0));
+    }
+
+    void TearDown(const benchmark::State& /*state*/) override {
+        mWrapper.reset();
+        mReader.reset();
+    }
+
+  protected:
+    void drain() {
+        benchmark::DoNotOptimize(mReader->read(mReadBuffer.data(), mReadBuffer.size()));
+    }
+
+    std::unique_ptr<AidlEventQueue> mReader;
+    AidlEventQueue* mRawWriter = nullptr;
+    std::unique_ptr<EventMessageQueueWrapperAidl> mWrapper;
+    std::vector<HidlEvent> mEvents;
+    std::vector<AidlEvent> mReadBuffer;
+};
+
+// The previous write path: convert into an intermediate buffer, then copy it into the FMQ.
+BENCHMARK_DEFINE_F(EventQueueBenchmark, BM_WriteThroughIntermediateBuffer)
+(benchmark::State& state) {
+    std::array<AidlEvent, MAX_RECEIVE_BUFFER_EVENT_COUNT> intermediate;
+    for (auto _ : state) {
+        for (size_t i = 0; i < mEvents.size(); ++i) {
+            convertToAidlEvent(mEvents[i], &intermediate[i]);
+        }
+        benchmark::DoNotOptimize(mRawWriter->write(intermediate.data(), mEvents.size()));
+        drain();
+    }
+    state.SetItemsProcessed(state.iterations() * mEvents.size());
+}
+BENCHMARK_REGISTER_F(EventQueueBenchmark, BM_WriteThroughIntermediateBuffer)
+        ->RangeMultiplier(4)
+        ->Range(1, MAX_RECEIVE_BUFFER_EVENT_COUNT);
+
+// The current write path: convert straight into the FMQ's memory.
+BENCHMARK_DEFINE_F(EventQueueBenchmark, BM_WriteInPlace)(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mWrapper->write(mEvents.data(), mEvents.size()));
+        drain();
+    }
+    state.SetItemsProcessed(state.iterations() * mEvents.size());
+}
+BENCHMARK_REGISTER_F(EventQueueBenchmark, BM_WriteInPlace)
+        ->RangeMultiplier(4)
+        ->Range(1, MAX_RECEIVE_BUFFER_EVENT_COUNT);
+
+}  // namespace
+
+}  // namespace implementation
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -43,6 +43,13 @@ void convertToHidlEvent(const ::aidl::android::hardware::sensors::Event& aidlEve
 void convertToAidlEvent(const ::android::hardware::sensors::V2_1::Event& hidlEvent,
                         ::aidl::android::hardware::sensors::Event* aidlEvent);
 
+/**
+ * Populates count AIDL Event instances based on count HIDL V2.1 Event instances. The destination
+ * may be memory owned by an FMQ, each element is overwritten in place.
+ */
+void convertToAidlEvents(const ::android::hardware::sensors::V2_1::Event* hidlEvents, size_t count,
+                         ::aidl::android::hardware::sensors::Event* aidlEvents);
+
 }  // namespace implementation
 }  // namespace sensors
 }  // namespace hardware
@@ -22,6 +22,8 @@
 #include "EventMessageQueueWrapper.h"
 #include "ISensorsWrapper.h"
 
+#include <algorithm>
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -56,23 +58,38 @@ class EventMessageQueueWrapperAidl
 
     bool write(const ::android::hardware::sensors::V2_1::Event* events,
                size_t numToWrite) override {
-        for (int i = 0; i < numToWrite; ++i) {
-            convertToAidlEvent(events[i], &mIntermediateEventBuffer[i]);
+        // Convert straight into the FMQ's memory, this runs for every batch of events posted by
+        // the sub-HALs so avoid the extra copy through an intermediate buffer.
+        AidlEventQueue::MemTransaction tx;
+        if (!mQueue->beginWrite(numToWrite, &tx)) {
+            return false;
         }
-        return mQueue->write(mIntermediateEventBuffer.data(), numToWrite);
+        const auto& firstRegion = tx.getFirstRegion();
+        size_t firstCount = std::min(firstRegion.getLength(), numToWrite);
+        convertToAidlEvents(events, firstCount, firstRegion.getAddress());
+        if (firstCount < numToWrite) {
+            convertToAidlEvents(events + firstCount, numToWrite - firstCount,
+                                tx.getSecondRegion().getAddress());
+        }
+        return mQueue->commitWrite(numToWrite);
     }
 
     virtual bool write(
             const std::vector<::android::hardware::sensors::V2_1::Event>& events) override {
-        for (int i = 0; i < events.size(); ++i) {
-            convertToAidlEvent(events[i], &mIntermediateEventBuffer[i]);
-        }
-        return mQueue->write(mIntermediateEventBuffer.data(), events.size());
+        return write(events.data(), events.size());
     }
 
     bool writeBlocking(const ::android::hardware::sensors::V2_1::Event* events, size_t count,
                        uint32_t readNotification, uint32_t writeNotification, int64_t timeOutNanos,
                        ::android::hardware::EventFlag* evFlag) override {
+        // Usually there is room already, write in place and notify the reader the same way the
+        // FMQ's writeBlocking would.
+        if (evFlag != nullptr && write(events, count)) {
+            if (writeNotification != 0) {
+                evFlag->wake(writeNotification);
+            }
+            return true;
+        }
         for (int i = 0; i < count; ++i) {
             convertToAidlEvent(events[i], &mIntermediateEventBuffer[i]);
         }
@@ -83,10 +100,11 @@ class EventMessageQueueWrapperAidl
     size_t getQuantumCount() override { return mQueue->getQuantumCount(); }
 
   private:
-    std::unique_ptr<::android::AidlMessageQueue<
+    using AidlEventQueue = ::android::AidlMessageQueue<
             ::aidl::android::hardware::sensors::Event,
-            ::aidl::android::hardware::common::fmq::SynchronizedReadWrite>>
-            mQueue;
+            ::aidl::android::hardware::common::fmq::SynchronizedReadWrite>;
+
+    std::unique_ptr<AidlEventQueue> mQueue;
     std::array<::aidl::android::hardware::sensors::Event,
                ::android::hardware::sensors::V2_1::implementation::MAX_RECEIVE_BUFFER_EVENT_COUNT>
             mIntermediateEventBuffer;
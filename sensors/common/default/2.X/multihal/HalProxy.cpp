@@ -19,6 +19,7 @@
 #include <android/hardware/sensors/2.0/types.h>
 
 #include <android-base/file.h>
+#include <android-base/properties.h>
 #include "hardware_legacy/power.h"
 
 #include <dlfcn.h>
@@ -27,6 +28,7 @@
 #include <cmath>
 #include <fstream>
 #include <functional>
+#include <optional>
 #include <thread>
 
 namespace android {
@@ -46,6 +48,10 @@ typedef V2_1::implementation::ISensorsSubHal*(SensorsHalGetSubHalV2_1Func)(uint3
 
 static constexpr int32_t kBitsAfterSubHalIndex = 24;
 
+// Long enough to cover the gap between two batches of a wakeup sensor reporting continuously,
+// short enough not to matter for power once it stops.
+static constexpr int64_t kDefaultWakelockReleaseDelayMs = 10;
+
 /**
  * Set the subhal index as first byte of sensor handle and return this modified version.
  *
@@ -221,8 +227,7 @@ Return<Result> HalProxy::initializeCommon(
     disableAllSensors();
 
     // Clears the queue if any events were pending write before.
-    mPendingWriteEventsQueue = std::queue<std::pair<std::vector<V2_1::Event>, size_t>>();
-    mSizePendingWriteEventsQueue = 0;
+    clearPendingWriteEventsQueue();
 
     // Clears previously connected dynamic sensors
     mDynamicSensors.clear();
@@ -366,15 +371,18 @@ Return<void> HalProxy::debug(const hidl_handle& fd, const hidl_vec<hidl_string>&
     stream << "  Wakelock timeout reset time: " << msFromNs(now - mWakelockTimeoutResetTime)
            << " ms ago" << std::endl;
     // TODO(b/142969448): Add logging for history of wakelock acquisition per subhal.
-    stream << "  Wakelock ref count: " << mWakelockRefCount << std::endl;
-    stream << "  # of events on pending write writes queue: " << mSizePendingWriteEventsQueue
-           << std::endl;
+    stream << "  Wakelock ref count: " << getWakelockRefCount() << std::endl;
+    stream << "  Wakelock held: " << (mWakelockHeld.load() ? "true" : "false")
+           << ", release delay: " << msFromNs(mWakelockReleaseDelayNs) << " ms" << std::endl;
+    stream << "  Wakelock acquisitions: " << mNumWakelockAcquisitions.load()
+           << ", reuses: " << mNumWakelockReuses.load() << std::endl;
+    stream << "  # of events on pending write writes queue: "
+           << mSizePendingWriteEventsQueue.load() << std::endl;
     stream << " Most events seen on pending write events queue: "
-           << mMostEventsObservedPendingWriteEventsQueue << std::endl;
-    if (!mPendingWriteEventsQueue.empty()) {
-        stream << "  Size of events list on front of pending writes queue: "
-               << mPendingWriteEventsQueue.front().first.size() << std::endl;
-    }
+           << mMostEventsObservedPendingWriteEventsQueue.load() << std::endl;
+    stream << "  # of posts that did not fit in the event queue: "
+           << mNumEventQueueFullPosts.load() << std::endl;
+    stream << "  # of events dropped: " << mNumDroppedEvents.load() << std::endl;
     stream << "  # of non-dynamic sensors across all subhals: " << mSensors.size() << std::endl;
     stream << "  # of dynamic sensors across all subhals: " << mDynamicSensors.size() << std::endl;
     stream << "SubHals (" << mSubHalList.size() << "):" << std::endl;
@@ -525,6 +533,11 @@ void* HalProxy::getHandleForSubHalSharedObject(const std::string& filename) {
 
 void HalProxy::init() {
     initializeSensorList();
+    mWakelockReleaseDelayNs =
+            ::android::base::GetIntProperty("vendor.sensors.multihal.wakelock_release_delay_ms",
+                                            kDefaultWakelockReleaseDelayMs, int64_t{0},
+                                            kWakelockTimeoutNs / (1000 * 1000)) *
+            1000 * 1000;
 }
 
 void HalProxy::stopThreads() {
@@ -540,8 +553,16 @@ void HalProxy::stopThreads() {
         mWakeLockQueue->write(&kZero);
         mWakelockQueueFlag->wake(static_cast<uint32_t>(WakeLockQueueFlagBits::DATA_WRITTEN));
     }
-    mWakelockCV.notify_one();
-    mEventQueueWriteCV.notify_one();
+    {
+        std::lock_guard<std::mutex> lock(mWakelockMutex);
+        mWakelockCV.notify_one();
+    }
+    {
+        // Taking the lock makes sure the pending writes thread is either waiting or will see that
+        // the threads are stopped.
+        std::lock_guard<std::mutex> lock(mPendingWritesWaitMutex);
+        mEventQueueWriteCV.notify_one();
+    }
     if (mPendingWritesThread.joinable()) {
         mPendingWritesThread.join();
     }
@@ -567,79 +588,119 @@ void HalProxy::startPendingWritesThread(HalProxy* halProxy) {
 }
 
 void HalProxy::handlePendingWrites() {
-    // TODO(b/143302327): Find a way to optimize locking strategy maybe using two mutexes instead of
-    // one.
-    std::unique_lock<std::mutex> lock(mEventQueueWriteMutex);
+    std::unique_lock<std::mutex> lock(mPendingWritesWaitMutex);
     while (mThreadsRun.load()) {
-        mEventQueueWriteCV.wait(
-                lock, [&] { return !mPendingWriteEventsQueue.empty() || !mThreadsRun.load(); });
-        if (mThreadsRun.load()) {
-            std::vector<Event>& pendingWriteEvents = mPendingWriteEventsQueue.front().first;
-            size_t numWakeupEvents = mPendingWriteEventsQueue.front().second;
-            size_t eventQueueSize = mEventQueue->getQuantumCount();
-            size_t numToWrite = std::min(pendingWriteEvents.size(), eventQueueSize);
+        std::optional<PendingWrite> pendingWrite = mPendingWriteEventsQueue.tryPop();
+        if (pendingWrite.has_value()) {
             lock.unlock();
-            if (!mEventQueue->writeBlocking(
-                        pendingWriteEvents.data(), numToWrite,
-                        static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
-                        static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
-                        kPendingWriteTimeoutNs, mEventQueueFlag)) {
-                ALOGE("Dropping %zu events after blockingWrite failed.", numToWrite);
-                if (numWakeupEvents > 0) {
-                    if (pendingWriteEvents.size() > eventQueueSize) {
-                        decrementRefCountAndMaybeReleaseWakelock(
-                                countNumWakeupEvents(pendingWriteEvents, eventQueueSize));
-                    } else {
-                        decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
-                    }
-                }
-            }
+            writePendingEvents(*pendingWrite);
             lock.lock();
-            mSizePendingWriteEventsQueue -= numToWrite;
-            if (pendingWriteEvents.size() > eventQueueSize) {
-                // TODO(b/143302327): Check if this erase operation is too inefficient. It will copy
-                // all the events ahead of it down to fill gap off array at front after the erase.
-                pendingWriteEvents.erase(pendingWriteEvents.begin(),
-                                         pendingWriteEvents.begin() + eventQueueSize);
-            } else {
-                mPendingWriteEventsQueue.pop();
-            }
+        } else if (mSizePendingWriteEventsQueue.load() > 0) {
+            // Events have been reserved but are still being pushed by a sub-HAL callback.
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        } else {
+            mPendingWritesThreadWaiting = true;
+            // Pairs with the fence in postEventsToMessageQueue, so either the sub-HAL callback sees
+            // that we are waiting or we see the events it reserved.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            mEventQueueWriteCV.wait(lock, [&] {
+                return mSizePendingWriteEventsQueue.load() > 0 || !mThreadsRun.load();
+            });
+            mPendingWritesThreadWaiting = false;
+        }
+    }
+}
+
+void HalProxy::writePendingEvents(const PendingWrite& pendingWrite) {
+    const std::vector<Event>& events = pendingWrite.events;
+    size_t numWritten = 0;
+    while (numWritten < events.size() && mThreadsRun.load()) {
+        // Fill all the space the framework has made, in a single write.
+        size_t numToWrite = std::min(events.size() - numWritten, mEventQueue->availableToWrite());
+        if (numToWrite > 0 && mEventQueue->write(events.data() + numWritten, numToWrite)) {
+            mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
+        } else if (mEventQueue->writeBlocking(
+                           events.data() + numWritten, 1 /* count */,
+                           static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
+                           static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
+                           kPendingWriteTimeoutNs, mEventQueueFlag)) {
+            // Blocked until the framework read events, write as many as fit on the next pass.
+            numToWrite = 1;
+        } else {
+            size_t numDropped = events.size() - numWritten;
+            ALOGE("Dropping %zu events after blockingWrite failed.", numDropped);
+            dropEvents(events, numWritten, pendingWrite.numWakeupEvents > 0);
+            mSizePendingWriteEventsQueue -= numDropped;
+            return;
         }
+        numWritten += numToWrite;
+        mSizePendingWriteEventsQueue -= numToWrite;
     }
 }
 
+void HalProxy::dropEvents(const std::vector<Event>& events, size_t start, bool holdWakelockRefs) {
+    if (holdWakelockRefs) {
+        size_t numWakeupEvents = countNumWakeupEvents(events, start, events.size());
+        if (numWakeupEvents > 0) {
+            decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
+        }
+    }
+    mNumDroppedEvents += events.size() - start;
+}
+
+void HalProxy::clearPendingWriteEventsQueue() {
+    while (mPendingWriteEventsQueue.tryPop().has_value()) {
+    }
+    mSizePendingWriteEventsQueue = 0;
+}
+
 void HalProxy::startWakelockThread(HalProxy* halProxy) {
     halProxy->handleWakelocks();
 }
 
 void HalProxy::handleWakelocks() {
-    std::unique_lock<std::recursive_mutex> lock(mWakelockMutex);
+    std::unique_lock<std::mutex> lock(mWakelockMutex);
+    auto wakeupEventsOrStopped = [&] {
+        return getWakelockRefCount() > 0 || !mThreadsRun.load();
+    };
     while (mThreadsRun.load()) {
-        mWakelockCV.wait(lock, [&] { return mWakelockRefCount > 0 || !mThreadsRun.load(); });
-        if (mThreadsRun.load()) {
-            int64_t timeLeft;
-            if (sharedWakelockDidTimeout(&timeLeft)) {
-                resetSharedWakelock();
-            } else {
-                uint32_t numWakeLocksProcessed;
-                lock.unlock();
-                bool success = mWakeLockQueue->readBlocking(
-                        &numWakeLocksProcessed, 1, 0,
-                        static_cast<uint32_t>(WakeLockQueueFlagBits::DATA_WRITTEN), timeLeft);
-                lock.lock();
-                if (success) {
-                    decrementRefCountAndMaybeReleaseWakelock(
-                            static_cast<size_t>(numWakeLocksProcessed));
-                }
+        if (getWakelockRefCount() == 0) {
+            // All the wakeup events have been acked. Keep the wakelock for a little while in case
+            // the next batch is right behind. Incrementing the ref count while the wakelock is
+            // held does not take the lock, so a missed notification only delays reading the
+            // acks of that batch until the delay is over.
+            if (!mWakelockHeld.load() || mWakelockReleaseDelayNs == 0 ||
+                !mWakelockCV.wait_for(lock, std::chrono::nanoseconds(mWakelockReleaseDelayNs),
+                                      wakeupEventsOrStopped)) {
+                releaseWakelockIfUnusedLocked();
+                mWakelockCV.wait(lock, wakeupEventsOrStopped);
+            }
+            continue;
+        }
+        int64_t timeLeft;
+        if (sharedWakelockDidTimeout(&timeLeft)) {
+            resetSharedWakelockLocked();
+        } else {
+            uint32_t numWakeLocksProcessed;
+            lock.unlock();
+            bool success = mWakeLockQueue->readBlocking(
+                    &numWakeLocksProcessed, 1, 0,
+                    static_cast<uint32_t>(WakeLockQueueFlagBits::DATA_WRITTEN), timeLeft);
+            lock.lock();
+            if (success) {
+                // Released after the delay, at the top of the loop.
+                decrementRefCount(static_cast<size_t>(numWakeLocksProcessed), -1);
             }
         }
     }
-    resetSharedWakelock();
+    resetSharedWakelockLocked();
 }
 
 bool HalProxy::sharedWakelockDidTimeout(int64_t* timeLeft) {
     bool didTimeout;
-    int64_t duration = getTimeNow() - mWakelockTimeoutStartTime;
+    int64_t duration = getTimeNow() - mWakelockTimeoutStartTime.load();
     if (duration > kWakelockTimeoutNs) {
         didTimeout = true;
     } else {
@@ -650,72 +711,152 @@ bool HalProxy::sharedWakelockDidTimeout(int64_t* timeLeft) {
 }
 
 void HalProxy::resetSharedWakelock() {
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
-    decrementRefCountAndMaybeReleaseWakelock(mWakelockRefCount);
-    mWakelockTimeoutResetTime = getTimeNow();
+    std::lock_guard<std::mutex> lockGuard(mWakelockMutex);
+    resetSharedWakelockLocked();
+}
+
+void HalProxy::resetSharedWakelockLocked() {
+    mWakelockTimeoutResetTime.store(getTimeNow());
+    // Starts a new generation without references, the ScopedWakelocks created before the reset
+    // no longer hold one.
+    uint64_t refs = mWakelockRefs.load();
+    while (!mWakelockRefs.compare_exchange_weak(
+            refs, ((refs >> kWakelockRefCountBits) + 1) << kWakelockRefCountBits)) {
+    }
+    releaseWakelockIfUnusedLocked();
 }
 
 void HalProxy::postEventsToMessageQueue(const std::vector<Event>& events, size_t numWakeupEvents,
                                         V2_0::implementation::ScopedWakelock wakelock) {
     size_t numToWrite = 0;
-    std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
-    if (wakelock.isLocked()) {
-        incrementRefCountAndMaybeAcquireWakelock(numWakeupEvents);
-    }
-    if (mPendingWriteEventsQueue.empty()) {
-        numToWrite = std::min(events.size(), mEventQueue->availableToWrite());
-        if (numToWrite > 0) {
-            if (mEventQueue->write(events.data(), numToWrite)) {
-                // TODO(b/143302327): While loop if mEventQueue->avaiableToWrite > 0 to possibly fit
-                // in more writes immediately
-                mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
+    size_t numLeft = 0;
+    size_t numPending = 0;
+    bool holdWakelockRefs = wakelock.isLocked() && numWakeupEvents > 0;
+    bool queued = false;
+    bool tooManyPosts = false;
+    {
+        std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+        if (wakelock.isLocked()) {
+            incrementRefCountAndMaybeAcquireWakelock(numWakeupEvents);
+        }
+        if (mSizePendingWriteEventsQueue.load() == 0) {
+            // Fill all the available space in a single write.
+            numToWrite = std::min(events.size(), mEventQueue->availableToWrite());
+            if (numToWrite > 0) {
+                if (mEventQueue->write(events.data(), numToWrite)) {
+                    mEventQueueFlag->wake(
+                            static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
+                } else {
+                    numToWrite = 0;
+                }
+            }
+        }
+        numLeft = events.size() - numToWrite;
+        if (numLeft == 0) {
+            return;
+        }
+        mNumEventQueueFullPosts++;
+        // Reserve the room and queue the events while holding the lock, from now on only the
+        // pending writes thread writes to the fmq until these events are written, in the order
+        // the posts reserved their room.
+        numPending = mSizePendingWriteEventsQueue.load();
+        if (numPending + numLeft <= kMaxSizePendingWriteEventsQueue) {
+            PendingWrite pendingWrite{
+                    std::vector<Event>(events.begin() + numToWrite, events.end()),
+                    holdWakelockRefs ? numWakeupEvents : 0};
+            numPending = mSizePendingWriteEventsQueue += numLeft;
+            if (mPendingWriteEventsQueue.tryPush(pendingWrite)) {
+                queued = true;
             } else {
-                numToWrite = 0;
+                mSizePendingWriteEventsQueue -= numLeft;
+                tooManyPosts = true;
             }
         }
     }
-    size_t numLeft = events.size() - numToWrite;
-    if (numToWrite < events.size() &&
-        mSizePendingWriteEventsQueue + numLeft <= kMaxSizePendingWriteEventsQueue) {
-        std::vector<Event> eventsLeft(events.begin() + numToWrite, events.end());
-        mPendingWriteEventsQueue.push({eventsLeft, numWakeupEvents});
-        mSizePendingWriteEventsQueue += numLeft;
-        mMostEventsObservedPendingWriteEventsQueue =
-                std::max(mMostEventsObservedPendingWriteEventsQueue, mSizePendingWriteEventsQueue);
+    if (!queued) {
+        if (tooManyPosts) {
+            ALOGE("Dropping %zu events, too many posts pending write.", numLeft);
+        }
+        dropEvents(events, numToWrite, holdWakelockRefs);
+        return;
+    }
+
+    size_t mostEvents = mMostEventsObservedPendingWriteEventsQueue.load();
+    while (numPending > mostEvents &&
+           !mMostEventsObservedPendingWriteEventsQueue.compare_exchange_weak(mostEvents,
+                                                                              numPending)) {
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mPendingWritesThreadWaiting.load()) {
+        std::lock_guard<std::mutex> lock(mPendingWritesWaitMutex);
         mEventQueueWriteCV.notify_one();
     }
 }
 
 bool HalProxy::incrementRefCountAndMaybeAcquireWakelock(size_t delta,
-                                                        int64_t* timeoutStart /* = nullptr */) {
+                                                        int64_t* generation /* = nullptr */) {
     if (!mThreadsRun.load()) return false;
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
-    if (mWakelockRefCount == 0) {
-        acquire_wake_lock(PARTIAL_WAKE_LOCK, kWakelockName);
+    mWakelockTimeoutStartTime.store(getTimeNow());
+    uint64_t refs = mWakelockRefs.fetch_add(delta);
+    bool wasUnused = (refs & kWakelockRefCountMask) == 0;
+    // Pairs with releaseWakelockIfUnusedLocked: either it sees the new reference and keeps the
+    // wakelock, or we see that it is released and acquire it again.
+    if (!mWakelockHeld.load()) {
+        std::lock_guard<std::mutex> lockGuard(mWakelockMutex);
+        if (!mWakelockHeld.load()) {
+            acquire_wake_lock(PARTIAL_WAKE_LOCK, kWakelockName);
+            mWakelockHeld.store(true);
+            mNumWakelockAcquisitions++;
+        }
+        mWakelockCV.notify_one();
+    } else if (wasUnused) {
+        mNumWakelockReuses++;
         mWakelockCV.notify_one();
     }
-    mWakelockTimeoutStartTime = getTimeNow();
-    mWakelockRefCount += delta;
-    if (timeoutStart != nullptr) {
-        *timeoutStart = mWakelockTimeoutStartTime;
+    if (generation != nullptr) {
+        *generation = static_cast<int64_t>(refs >> kWakelockRefCountBits);
     }
     return true;
 }
 
 void HalProxy::decrementRefCountAndMaybeReleaseWakelock(size_t delta,
-                                                        int64_t timeoutStart /* = -1 */) {
-    if (!mThreadsRun.load()) return;
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
-    if (delta > mWakelockRefCount) {
-        ALOGE("Decrementing wakelock ref count by %zu when count is %zu",
-              delta, mWakelockRefCount);
+                                                        int64_t generation /* = -1 */) {
+    if (decrementRefCount(delta, generation)) {
+        std::lock_guard<std::mutex> lockGuard(mWakelockMutex);
+        releaseWakelockIfUnusedLocked();
     }
-    if (timeoutStart == -1) timeoutStart = mWakelockTimeoutResetTime;
-    if (mWakelockRefCount == 0 || timeoutStart < mWakelockTimeoutResetTime) return;
-    mWakelockRefCount -= std::min(mWakelockRefCount, delta);
-    if (mWakelockRefCount == 0) {
-        release_wake_lock(kWakelockName);
+}
+
+bool HalProxy::decrementRefCount(size_t delta, int64_t generation) {
+    if (!mThreadsRun.load()) return false;
+    uint64_t refs = mWakelockRefs.load();
+    size_t count;
+    size_t newCount;
+    do {
+        // The references taken before the last reset were wiped by it.
+        if (generation != -1 &&
+            static_cast<uint64_t>(generation) != refs >> kWakelockRefCountBits) {
+            return false;
+        }
+        count = refs & kWakelockRefCountMask;
+        newCount = count - std::min(count, delta);
+    } while (count > 0 && !mWakelockRefs.compare_exchange_weak(refs, refs - (count - newCount)));
+    if (delta > count) {
+        ALOGE("Decrementing wakelock ref count by %zu when count is %zu", delta, count);
+    }
+    return count > 0 && newCount == 0;
+}
+
+void HalProxy::releaseWakelockIfUnusedLocked() {
+    if (!mWakelockHeld.load()) return;
+    mWakelockHeld.store(false);
+    if (getWakelockRefCount() > 0) {
+        // Incremented in the meantime, that reference keeps the wakelock.
+        mWakelockHeld.store(true);
+        return;
     }
+    release_wake_lock(kWakelockName);
 }
 
 void HalProxy::setDirectChannelFlags(SensorInfo* sensorInfo,
@@ -741,9 +882,10 @@ bool HalProxy::isSubHalIndexValid(int32_t sensorHandle) {
     return extractSubHalIndex(sensorHandle) < mSubHalList.size();
 }
 
-size_t HalProxy::countNumWakeupEvents(const std::vector<Event>& events, size_t n) {
+size_t HalProxy::countNumWakeupEvents(const std::vector<Event>& events, size_t start,
+                                      size_t end) {
     size_t numWakeupEvents = 0;
-    for (size_t i = 0; i < n; i++) {
+    for (size_t i = start; i < end; i++) {
         int32_t sensorHandle = events[i].sensorHandle;
         if (mSensors[sensorHandle].flags & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) {
             numWakeupEvents++;
@@ -34,11 +34,11 @@ ScopedWakelock::ScopedWakelock(ScopedWakelock&& other) {
 
 ScopedWakelock& ScopedWakelock::operator=(ScopedWakelock&& other) {
     mRefCounter = other.mRefCounter;
-    mCreatedAtTimeNs = other.mCreatedAtTimeNs;
+    mGeneration = other.mGeneration;
     mLocked = other.mLocked;
 
     other.mRefCounter = nullptr;
-    other.mCreatedAtTimeNs = 0;
+    other.mGeneration = 0;
     other.mLocked = false;
     return *this;
 }
@@ -46,13 +46,13 @@ ScopedWakelock& ScopedWakelock::operator=(ScopedWakelock&& other) {
 ScopedWakelock::ScopedWakelock(IScopedWakelockRefCounter* refCounter, bool locked)
     : mRefCounter(refCounter), mLocked(locked) {
     if (mLocked) {
-        mLocked = mRefCounter->incrementRefCountAndMaybeAcquireWakelock(1, &mCreatedAtTimeNs);
+        mLocked = mRefCounter->incrementRefCountAndMaybeAcquireWakelock(1, &mGeneration);
     }
 }
 
 ScopedWakelock::~ScopedWakelock() {
     if (mLocked) {
-        mRefCounter->decrementRefCountAndMaybeReleaseWakelock(1, mCreatedAtTimeNs);
+        mRefCounter->decrementRefCountAndMaybeReleaseWakelock(1, mGeneration);
     }
 }
 
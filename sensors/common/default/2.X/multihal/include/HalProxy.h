@@ -19,6 +19,7 @@
 #include "EventMessageQueueWrapper.h"
 #include "HalProxyCallback.h"
 #include "ISensorsCallbackWrapper.h"
+#include "MpscRingQueue.h"
 #include "SubHalWrapper.h"
 #include "V2_0/ScopedWakelock.h"
 #include "V2_0/SubHal.h"
@@ -37,7 +38,6 @@
 #include <condition_variable>
 #include <map>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <utility>
 
@@ -137,13 +137,15 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
 
     // Below methods are from IScopedWakelockRefCounter interface
     bool incrementRefCountAndMaybeAcquireWakelock(size_t delta,
-                                                  int64_t* timeoutStart = nullptr) override;
+                                                  int64_t* generation = nullptr) override;
 
-    void decrementRefCountAndMaybeReleaseWakelock(size_t delta, int64_t timeoutStart = -1) override;
+    void decrementRefCountAndMaybeReleaseWakelock(size_t delta, int64_t generation = -1) override;
 
     const std::map<int32_t, SensorInfo>& getSensors() { return mSensors; }
 
   private:
+    friend class HalProxyWakelockTest;
+
     using EventMessageQueueV2_1 = MessageQueue<V2_1::Event, kSynchronizedReadWrite>;
     using EventMessageQueueV2_0 = MessageQueue<V1_0::Event, kSynchronizedReadWrite>;
     using WakeLockMessageQueue = MessageQueue<uint32_t, kSynchronizedReadWrite>;
@@ -201,24 +203,53 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     //! The bit mask used to get the subhal index from a sensor handle.
     static constexpr int32_t kSensorHandleSubHalIndexMask = 0xFF000000;
 
+    //! Events that did not fit in the event fmq.
+    struct PendingWrite {
+        std::vector<Event> events;
+        //! The number of wakeup events of the post that hold a wakelock reference.
+        size_t numWakeupEvents;
+    };
+
+    //! The max number of posts allowed in the pending write events queue
+    static constexpr size_t kMaxPendingWrites = 4096;
+
     /**
-     * A FIFO queue of pairs of vector of events and the number of wakeup events in that vector
-     * which are waiting to be written to the events fmq in the background thread.
+     * A FIFO queue of the events waiting to be written to the events fmq in the background
+     * thread. Sub-HAL callback threads push to it with mEventQueueWriteMutex held, so the posts
+     * are written in the order they reserved their room, and the background thread pops from it
+     * without taking any lock.
      */
-    std::queue<std::pair<std::vector<Event>, size_t>> mPendingWriteEventsQueue;
+    MpscRingQueue<PendingWrite> mPendingWriteEventsQueue{kMaxPendingWrites};
 
     //! The most events observed on the pending write events queue for debug purposes.
-    size_t mMostEventsObservedPendingWriteEventsQueue = 0;
+    std::atomic<size_t> mMostEventsObservedPendingWriteEventsQueue = 0;
 
     //! The max number of events allowed in the pending write events queue
     static constexpr size_t kMaxSizePendingWriteEventsQueue = 100000;
 
-    //! The number of events in the pending write events queue
-    size_t mSizePendingWriteEventsQueue = 0;
+    /**
+     * The number of events reserved on the pending write events queue and not yet written to
+     * the fmq. It is only increased with mEventQueueWriteMutex held, and the fmq is only written
+     * by sub-HAL callbacks while it is zero, so they never write concurrently with the background
+     * thread.
+     */
+    std::atomic<size_t> mSizePendingWriteEventsQueue = 0;
+
+    //! The number of posts that did not entirely fit in the event fmq, for debug purposes.
+    std::atomic<uint64_t> mNumEventQueueFullPosts = 0;
 
-    //! The mutex protecting writing to the fmq and the pending events queue
+    //! The number of events dropped because the event fmq stayed full, for debug purposes.
+    std::atomic<uint64_t> mNumDroppedEvents = 0;
+
+    //! The mutex protecting direct writes to the fmq from sub-HAL callbacks
     std::mutex mEventQueueWriteMutex;
 
+    //! The mutex the pending writes thread sleeps on when there are no pending write events
+    std::mutex mPendingWritesWaitMutex;
+
+    //! Whether the pending writes thread is sleeping on mEventQueueWriteCV
+    std::atomic_bool mPendingWritesThreadWaiting = false;
+
     //! The condition variable waiting on pending write events to stack up
     std::condition_variable mEventQueueWriteCV;
 
@@ -236,18 +267,35 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
 
     // WakelockRefCount membar vars below
 
-    //! The mutex protecting the wakelock refcount and subsequent wakelock releases and
-    //! acquisitions
-    std::recursive_mutex mWakelockMutex;
+    //! The mutex serializing the acquisitions and releases of the shared wakelock. The refcount
+    //! itself is updated without it.
+    std::mutex mWakelockMutex;
+
+    std::condition_variable mWakelockCV;
+
+    //! The refcount of how many ScopedWakelocks and pending wakeup events are active in the low
+    //! kWakelockRefCountBits bits, and the number of resets in the bits above, which tells the
+    //! references wiped by a reset apart from the ones taken after it. Both are updated together
+    //! so that no reference straddles a reset.
+    std::atomic<uint64_t> mWakelockRefs = 0;
+    static constexpr int kWakelockRefCountBits = 32;
+    static constexpr uint64_t kWakelockRefCountMask = (uint64_t{1} << kWakelockRefCountBits) - 1;
+
+    //! Whether the shared wakelock is held. Only written with mWakelockMutex held, it may stay
+    //! true for a little while after the refcount dropped to 0.
+    std::atomic_bool mWakelockHeld = false;
 
-    std::condition_variable_any mWakelockCV;
+    std::atomic<int64_t> mWakelockTimeoutStartTime = V2_0::implementation::getTimeNow();
 
-    //! The refcount of how many ScopedWakelocks and pending wakeup events are active
-    size_t mWakelockRefCount = 0;
+    std::atomic<int64_t> mWakelockTimeoutResetTime = V2_0::implementation::getTimeNow();
 
-    int64_t mWakelockTimeoutStartTime = V2_0::implementation::getTimeNow();
+    //! How long the shared wakelock is kept once the framework acked all the wakeup events, so
+    //! that back-to-back batches reuse it instead of acquiring it again.
+    int64_t mWakelockReleaseDelayNs = 0;
 
-    int64_t mWakelockTimeoutResetTime = V2_0::implementation::getTimeNow();
+    //! The number of times the shared wakelock was acquired, and reused while it was released.
+    std::atomic<uint64_t> mNumWakelockAcquisitions = 0;
+    std::atomic<uint64_t> mNumWakelockReuses = 0;
 
     const char* kWakelockName = "SensorsHAL_WAKEUP";
 
@@ -303,6 +351,29 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     //! Handles the pending writes on events to eventqueue.
     void handlePendingWrites();
 
+    /**
+     * Writes the events to the event fmq as space becomes available, filling all the available
+     * space at each write. Drops the remaining events if the fmq stays full for
+     * kPendingWriteTimeoutNs.
+     *
+     * @param pendingWrite The events to write.
+     */
+    void writePendingEvents(const PendingWrite& pendingWrite);
+
+    /**
+     * Drops the events from start to the end of the vector, which were not written to the event
+     * fmq. The framework never acks dropped events, so the wakelock references held by their
+     * wakeup events are released here.
+     *
+     * @param events The vector of Event objects.
+     * @param start The index of the first dropped event.
+     * @param holdWakelockRefs Whether the wakeup events of the vector hold wakelock references.
+     */
+    void dropEvents(const std::vector<Event>& events, size_t start, bool holdWakelockRefs);
+
+    //! Drops all the events on the pending write events queue. Threads must be stopped.
+    void clearPendingWriteEventsQueue();
+
     /**
      * Starts the thread that handles decrementing the ref count on wakeup events processed by the
      * framework and timing out wakelocks.
@@ -328,6 +399,22 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
      */
     void resetSharedWakelock();
 
+    //! Same as resetSharedWakelock, mWakelockMutex must be held.
+    void resetSharedWakelockLocked();
+
+    /**
+     * Decrements the ref count without releasing the shared wakelock.
+     *
+     * @return true if the ref count dropped to 0.
+     */
+    bool decrementRefCount(size_t delta, int64_t generation);
+
+    //! The number of active wakelock references.
+    size_t getWakelockRefCount() const { return mWakelockRefs.load() & kWakelockRefCountMask; }
+
+    //! Releases the shared wakelock if it is held and unused. mWakelockMutex must be held.
+    void releaseWakelockIfUnusedLocked();
+
     /**
      * Clear direct channel flags if the HalProxy has already chosen a subhal as its direct channel
      * subhal. Set the directChannelSubHal pointer to the subHal passed in if this is the first
@@ -357,14 +444,15 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     bool isSubHalIndexValid(int32_t sensorHandle);
 
     /**
-     * Count the number of wakeup events in the first n events of the vector.
+     * Count the number of wakeup events in events [start, end) of the vector.
      *
      * @param events The vector of Event objects.
-     * @param n The end index not inclusive of events to consider.
+     * @param start The start index of events to consider.
+     * @param end The end index not inclusive of events to consider.
      *
      * @return The number of wakeup events of the considered events.
      */
-    size_t countNumWakeupEvents(const std::vector<Event>& events, size_t n);
+    size_t countNumWakeupEvents(const std::vector<Event>& events, size_t start, size_t end);
 
     /*
      * Clear out the subhal index bytes from a sensorHandle.
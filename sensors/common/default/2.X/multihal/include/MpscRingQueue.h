@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * A bounded multi-producer, single-consumer queue backed by a ring buffer. Pushing and popping
+ * only use atomic operations, each slot carries a sequence number that tells whether it is ready
+ * to be written or read. Neither call ever blocks, callers decide what to do when the queue is
+ * full or empty.
+ */
+template <typename T>
+class MpscRingQueue {
+  public:
+    //! The capacity is rounded up to the next power of 2.
+    explicit MpscRingQueue(size_t capacity)
+        : mCapacity(roundUpToPowerOfTwo(capacity)),
+          mMask(mCapacity - 1),
+          mSlots(new Slot[mCapacity]) {
+        for (size_t i = 0; i < mCapacity; i++) {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRingQueue(const MpscRingQueue&) = delete;
+    MpscRingQueue& operator=(const MpscRingQueue&) = delete;
+
+    /**
+     * Moves the item into the queue. May be called from any thread.
+     *
+     * @return false if the queue is full, item is untouched in that case.
+     */
+    bool tryPush(T& item) {
+        size_t pos = mTail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = mSlots[pos & mMask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.item.emplace(std::move(item));
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Takes the oldest item out of the queue. Must only be called from one thread at a time.
+     *
+     * @return The item, or std::nullopt if the queue is empty or the oldest item is still being
+     *     pushed.
+     */
+    std::optional<T> tryPop() {
+        size_t pos = mHead.load(std::memory_order_relaxed);
+        Slot& slot = mSlots[pos & mMask];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return std::nullopt;
+        }
+        std::optional<T> item = std::move(slot.item);
+        slot.item.reset();
+        mHead.store(pos + 1, std::memory_order_relaxed);
+        slot.sequence.store(pos + mCapacity, std::memory_order_release);
+        return item;
+    }
+
+    size_t capacity() const { return mCapacity; }
+
+  private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        std::optional<T> item;
+    };
+
+    //! Keep the producer and consumer positions on different cache lines.
+    static constexpr size_t kCacheLineSize = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t mCapacity;
+    const size_t mMask;
+    const std::unique_ptr<Slot[]> mSlots;
+    alignas(kCacheLineSize) std::atomic<size_t> mHead = 0;
+    alignas(kCacheLineSize) std::atomic<size_t> mTail = 0;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
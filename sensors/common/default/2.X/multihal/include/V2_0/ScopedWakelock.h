@@ -35,25 +35,25 @@ class IScopedWakelockRefCounter : public RefBase {
   public:
     /**
      * Increment the wakelock ref count and maybe acquire the shared wakelock if incrementing
-     * from 0 then return the time of incrementing back to caller.
+     * from 0 then return the generation of the references back to caller.
      *
      * @param delta The amount to change ref count by.
-     * @param timeoutStart The ptr to the timestamp in ns that the increment occurred which will be
-     *        set in the function or nullptr if not specified.
+     * @param generation The ptr to the generation of the references, which changes whenever the
+     *        ref count is reset, that will be set in the function or nullptr if not specified.
      *
      * @return true if successfully incremented the wakelock ref count.
      */
     virtual bool incrementRefCountAndMaybeAcquireWakelock(size_t delta,
-                                                          int64_t* timeoutStart = nullptr) = 0;
+                                                          int64_t* generation = nullptr) = 0;
     /**
      * Decrement the wakelock ref count and maybe release wakelock if ref count ends up 0.
      *
      * @param delta The amount to change ref count by.
-     * @param timeoutStart The timestamp in ns that the calling context kept track of when
-     *        incrementing the ref count or -1 by default
+     * @param generation The generation that the calling context kept track of when incrementing
+     *        the ref count, the references are ignored if it was reset since, or -1 by default
      */
     virtual void decrementRefCountAndMaybeReleaseWakelock(size_t delta,
-                                                          int64_t timeoutStart = -1) = 0;
+                                                          int64_t generation = -1) = 0;
     // Virtual dtor needed for compilation success
     virtual ~IScopedWakelockRefCounter(){};
 };
@@ -91,7 +91,7 @@ class ScopedWakelock {
     friend class HalProxyCallbackBase;
     friend class ScopedWakelockTest;
     IScopedWakelockRefCounter* mRefCounter;
-    int64_t mCreatedAtTimeNs;
+    int64_t mGeneration;
     bool mLocked;
     ScopedWakelock(IScopedWakelockRefCounter* refCounter, bool locked);
     ScopedWakelock(const ScopedWakelock&) = delete;
@@ -25,14 +25,36 @@
 #include "V2_0/ScopedWakelock.h"
 #include "convertV2_1.h"
 
+#include <atomic>
 #include <chrono>
+#include <cstdio>
 #include <set>
 #include <thread>
 #include <vector>
 
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+// Reaches the private wakelock reset of the HalProxy.
+class HalProxyWakelockTest : public ::testing::Test {
+  protected:
+    //! Same as the wakelock timing out.
+    static void resetSharedWakelock(HalProxy& proxy) { proxy.resetSharedWakelock(); }
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+
 namespace {
 
 using ::android::hardware::EventFlag;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::MessageQueue;
 using ::android::hardware::Return;
@@ -47,6 +69,7 @@ using ::android::hardware::sensors::V2_0::implementation::ScopedWakelock;
 using ::android::hardware::sensors::V2_1::implementation::convertToNewEvents;
 using ::android::hardware::sensors::V2_1::implementation::convertToNewSensorInfos;
 using ::android::hardware::sensors::V2_1::implementation::HalProxy;
+using ::android::hardware::sensors::V2_1::implementation::HalProxyWakelockTest;
 using ::android::hardware::sensors::V2_1::subhal::implementation::AddAndRemoveDynamicSensorsSubHal;
 using ::android::hardware::sensors::V2_1::subhal::implementation::AllSensorsSubHal;
 using ::android::hardware::sensors::V2_1::subhal::implementation::
@@ -165,6 +188,15 @@ void ackWakeupEventsToHalProxy(size_t numEvents, std::unique_ptr<WakeupMessageQu
 bool readEventsOutOfQueue(size_t numEvents, std::unique_ptr<EventMessageQueueV2_0>& eventQueue,
                           EventFlag* eventQueueFlag);
 
+/**
+ * Reads the wakelock ref count of the proxy from its debug dump.
+ *
+ * @param proxy The HalProxy to dump.
+ *
+ * @return The wakelock ref count, or SIZE_MAX if it could not be read.
+ */
+size_t getWakelockRefCount(HalProxy& proxy);
+
 std::unique_ptr<EventMessageQueueV2_0> makeEventFMQ(size_t size);
 
 std::unique_ptr<WakeupMessageQueue> makeWakelockFMQ(size_t size);
@@ -467,6 +499,38 @@ TEST(HalProxyTest, PostEventsMultipleSubhalsThreaded) {
     EXPECT_EQ(eventQueue->availableToRead(), kNumEvents * 2);
 }
 
+TEST(HalProxyTest, PostEventsMultipleSubhalsThreadedDelayedWrite) {
+    constexpr size_t kQueueSize = 5;
+    constexpr size_t kNumEvents = 6;
+    AllSensorsSubHal<SensorsSubHalV2_0> subHal1, subHal2;
+    std::vector<ISensorsSubHal*> subHals{&subHal1, &subHal2};
+    HalProxy proxy(subHals);
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    EventFlag* eventQueueFlag;
+    EventFlag::createEventFlag(eventQueue->getEventFlagWord(), &eventQueueFlag);
+
+    std::vector<EventV1_0> events = makeMultipleAccelerometerEvents(kNumEvents);
+
+    std::thread t1(&AllSensorsSubHal<SensorsSubHalV2_0>::postEvents, &subHal1,
+                   convertToNewEvents(events), false);
+    std::thread t2(&AllSensorsSubHal<SensorsSubHalV2_0>::postEvents, &subHal2,
+                   convertToNewEvents(events), false);
+
+    t1.join();
+    t2.join();
+
+    // The background thread fills the queue each time there is room, until no events are lost
+    EXPECT_TRUE(readEventsOutOfQueue(kQueueSize, eventQueue, eventQueueFlag));
+    EXPECT_TRUE(readEventsOutOfQueue(kQueueSize, eventQueue, eventQueueFlag));
+    EXPECT_TRUE(readEventsOutOfQueue(kNumEvents * 2 - kQueueSize * 2, eventQueue, eventQueueFlag));
+
+    EXPECT_EQ(eventQueue->availableToRead(), 0);
+}
+
 TEST(HalProxyTest, DestructingWithEventsPendingOnBackgroundThread) {
     constexpr size_t kQueueSize = 5;
     constexpr size_t kNumEvents = 6;
@@ -798,6 +862,178 @@ TEST(HalProxyTest, FillAndDrainPendingQueueTest) {
     EXPECT_TRUE(readEventsOutOfQueue(1, eventQueue, eventQueueFlag));
 }
 
+TEST(HalProxyTest, ConcurrentPostsKeepTheirOrderThroughThePendingQueue) {
+    constexpr size_t kQueueSize = 5;
+    constexpr size_t kNumSubHals = 3;
+    constexpr size_t kNumPosts = 100;
+    constexpr size_t kEventsPerPost = 3;
+    constexpr int64_t kReadBlockingTimeout = INT64_C(500000000);
+    AllSensorsSubHal<SensorsSubHalV2_0> subhals[kNumSubHals];
+    std::vector<ISensorsSubHal*> subHals;
+    for (auto& subhal : subhals) {
+        subHals.push_back(&subhal);
+    }
+
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    EventFlag* eventQueueFlag;
+    EventFlag::createEventFlag(eventQueue->getEventFlagWord(), &eventQueueFlag);
+    HalProxy proxy(subHals);
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    // Each sub-HAL numbers its events, most of the posts go through the pending queue
+    std::vector<std::thread> posters;
+    for (auto& subhal : subhals) {
+        posters.emplace_back([&subhal] {
+            for (size_t post = 0; post < kNumPosts; post++) {
+                std::vector<EventV1_0> events = makeMultipleAccelerometerEvents(kEventsPerPost);
+                for (size_t i = 0; i < kEventsPerPost; i++) {
+                    events[i].timestamp = post * kEventsPerPost + i;
+                }
+                subhal.postEvents(convertToNewEvents(events), false);
+            }
+        });
+    }
+
+    for (auto& poster : posters) {
+        poster.join();
+    }
+
+    // Nothing is dropped, and the events of a post are read in order and in one piece
+    std::vector<int64_t> nextTimestamps(kNumSubHals, 0);
+    EventV1_0 previous;
+    for (size_t i = 0; i < kNumSubHals * kNumPosts * kEventsPerPost; i++) {
+        EventV1_0 event;
+        ASSERT_TRUE(eventQueue->readBlocking(
+                &event, 1, static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
+                static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS), kReadBlockingTimeout,
+                eventQueueFlag));
+        size_t subHalIndex = static_cast<uint32_t>(event.sensorHandle) >> 24;
+        ASSERT_LT(subHalIndex, kNumSubHals);
+        ASSERT_EQ(event.timestamp, nextTimestamps[subHalIndex]++);
+        if (event.timestamp % kEventsPerPost != 0) {
+            ASSERT_EQ(previous.sensorHandle, event.sensorHandle);
+        }
+        previous = event;
+    }
+}
+
+TEST(HalProxyTest, DroppedWakeupEventsReleaseWakelockRefs) {
+    constexpr size_t kQueueSize = 5;
+    constexpr size_t kMaxPendingQueueSize = 100000;
+    constexpr size_t kNumPendingEvents = 2;
+    AllSensorsSubHal<SensorsSubHalV2_0> subhal;
+    std::vector<ISensorsSubHal*> subHals{&subhal};
+
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    EventFlag* eventQueueFlag;
+    EventFlag::createEventFlag(eventQueue->getEventFlagWord(), &eventQueueFlag);
+    HalProxy proxy(subHals);
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    // Fill the fmq, then post more wakeup events than the pending queue can hold
+    std::vector<EventV1_0> events = makeMultipleAccelerometerEvents(kQueueSize);
+    subhal.postEvents(convertToNewEvents(events), false /* wakeup */);
+    events = makeMultipleProximityEvents(kMaxPendingQueueSize + 1);
+    subhal.postEvents(convertToNewEvents(events), true /* wakeup */);
+
+    // The framework never gets the dropped events, so they must not wait for acks
+    EXPECT_EQ(getWakelockRefCount(proxy), 0);
+
+    // Pending wakeup events keep their references until the framework acks them
+    events = makeMultipleProximityEvents(kNumPendingEvents);
+    subhal.postEvents(convertToNewEvents(events), true /* wakeup */);
+    ASSERT_TRUE(readEventsOutOfQueue(kQueueSize, eventQueue, eventQueueFlag));
+    ASSERT_TRUE(readEventsOutOfQueue(kNumPendingEvents, eventQueue, eventQueueFlag));
+    EXPECT_EQ(getWakelockRefCount(proxy), kNumPendingEvents);
+}
+
+TEST_F(HalProxyWakelockTest, ResetIgnoresTheReleasesOfWipedRefs) {
+    constexpr size_t kQueueSize = 5;
+    AllSensorsSubHal<SensorsSubHalV2_0> subhal;
+    std::vector<ISensorsSubHal*> subHals{&subhal};
+
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    HalProxy proxy(subHals);
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    int64_t wipedGeneration;
+    ASSERT_TRUE(proxy.incrementRefCountAndMaybeAcquireWakelock(1, &wipedGeneration));
+    resetSharedWakelock(proxy);
+    EXPECT_EQ(getWakelockRefCount(proxy), 0);
+
+    int64_t generation;
+    ASSERT_TRUE(proxy.incrementRefCountAndMaybeAcquireWakelock(1, &generation));
+    proxy.decrementRefCountAndMaybeReleaseWakelock(1, wipedGeneration);
+    EXPECT_EQ(getWakelockRefCount(proxy), 1);
+    proxy.decrementRefCountAndMaybeReleaseWakelock(1, generation);
+    EXPECT_EQ(getWakelockRefCount(proxy), 0);
+}
+
+TEST_F(HalProxyWakelockTest, RefsTakenRightAfterAResetAreHonored) {
+    constexpr size_t kQueueSize = 5;
+    constexpr size_t kNumResets = 1000;
+    AllSensorsSubHal<SensorsSubHalV2_0> subhal;
+    std::vector<ISensorsSubHal*> subHals{&subhal};
+
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    HalProxy proxy(subHals);
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    // Even when taken within the same clock tick as the reset
+    for (size_t i = 0; i < kNumResets; i++) {
+        resetSharedWakelock(proxy);
+        int64_t generation;
+        ASSERT_TRUE(proxy.incrementRefCountAndMaybeAcquireWakelock(1, &generation));
+        proxy.decrementRefCountAndMaybeReleaseWakelock(1, generation);
+        ASSERT_EQ(getWakelockRefCount(proxy), 0) << "after reset " << i;
+    }
+}
+
+TEST_F(HalProxyWakelockTest, ResetConcurrentlyWithRefs) {
+    constexpr size_t kQueueSize = 5;
+    constexpr size_t kNumThreads = 4;
+    constexpr size_t kNumResets = 50;
+    AllSensorsSubHal<SensorsSubHalV2_0> subhal;
+    std::vector<ISensorsSubHal*> subHals{&subhal};
+
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    HalProxy proxy(subHals);
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    // Each reference is either wiped by the reset or released by its owner, never both or neither
+    for (size_t i = 0; i < kNumResets; i++) {
+        std::atomic_bool done = false;
+        std::vector<std::thread> threads;
+        for (size_t j = 0; j < kNumThreads; j++) {
+            threads.emplace_back([&] {
+                while (!done.load()) {
+                    int64_t generation;
+                    ASSERT_TRUE(proxy.incrementRefCountAndMaybeAcquireWakelock(1, &generation));
+                    proxy.decrementRefCountAndMaybeReleaseWakelock(1, generation);
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        resetSharedWakelock(proxy);
+        done.store(true);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        ASSERT_EQ(getWakelockRefCount(proxy), 0) << "after reset " << i;
+    }
+}
+
 TEST(HalProxyTest, PostEventsMultipleSubhalsThreadedV2_1) {
     constexpr size_t kQueueSize = 5;
     constexpr size_t kNumEvents = 2;
@@ -875,6 +1111,24 @@ bool readEventsOutOfQueue(size_t numEvents, std::unique_ptr<EventMessageQueueV2_
                                     kReadBlockingTimeout, eventQueueFlag);
 }
 
+size_t getWakelockRefCount(HalProxy& proxy) {
+    FILE* dump = tmpfile();
+    if (dump == nullptr) return SIZE_MAX;
+    native_handle_t* handle = native_handle_create(1 /* numFds */, 0 /* numInts */);
+    handle->data[0] = fileno(dump);
+    proxy.debug(hidl_handle(handle), {});
+    native_handle_delete(handle);
+
+    size_t refCount = SIZE_MAX;
+    char line[256];
+    rewind(dump);
+    while (fgets(line, sizeof(line), dump) != nullptr) {
+        if (sscanf(line, "  Wakelock ref count: %zu", &refCount) == 1) break;
+    }
+    fclose(dump);
+    return refCount;
+}
+
 std::unique_ptr<EventMessageQueueV2_0> makeEventFMQ(size_t size) {
     return std::make_unique<EventMessageQueueV2_0>(size, true);
 }
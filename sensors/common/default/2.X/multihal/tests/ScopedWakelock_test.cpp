@@ -29,13 +29,13 @@ class RefCounter : public IScopedWakelockRefCounter {
     size_t decCount = 0;
 
     bool incrementRefCountAndMaybeAcquireWakelock(size_t /* delta */,
-                                                  int64_t* /* timeoutStart */) override {
+                                                  int64_t* /* generation */) override {
         incCount++;
         return true;
     }
 
     void decrementRefCountAndMaybeReleaseWakelock(size_t /* delta */,
-                                                  int64_t /* timeoutStart */) override {
+                                                  int64_t /* generation */) override {
         decCount++;
     }
 };
@@ -77,8 +77,9 @@ class EventMessageQueueWrapperV1_0 : public EventMessageQueueWrapperBase {
     }
 
     virtual bool write(const std::vector<V2_1::Event>& events) override {
-        const std::vector<V1_0::Event>& oldEvents = convertToOldEvents(events);
-        return mQueue->write(oldEvents.data(), oldEvents.size());
+        // Same layout, so the events are written in place rather than through a vector of the
+        // old type.
+        return write(events.data(), events.size());
     }
 
     bool writeBlocking(const V2_1::Event* events, size_t count, uint32_t readNotification,
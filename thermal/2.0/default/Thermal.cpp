@@ -16,10 +16,16 @@
 
 #define LOG_TAG "android.hardware.thermal@2.0-service-mock"
 
+#include <stdio.h>
+
+#include <algorithm>
 #include <cmath>
+#include <optional>
 #include <set>
+#include <string>
 
 #include <android-base/logging.h>
+#include <android-base/parsedouble.h>
 #include <hidl/HidlTransportSupport.h>
 
 #include "Thermal.h"
@@ -81,6 +87,29 @@ static const CpuUsage kCpuUsage = {
         .isOnline = true,
 };
 
+Thermal::Thermal() {
+    temperatures_[kTemp_2_0.type].push_back(kTemp_2_0);
+    thresholds_[kTempThreshold.type].push_back(kTempThreshold);
+}
+
+ThrottlingSeverity Thermal::evaluateSeverity(const TemperatureThreshold& threshold, float value,
+                                             ThrottlingSeverity current) {
+    const auto& hot = threshold.hotThrottlingThresholds;
+    size_t severity = 0;
+    for (size_t i = hot.size(); i-- > 1;) {
+        if (std::isnan(hot[i])) {
+            continue;
+        }
+        // Apply the hysteresis to the thresholds the sensor is already at or above.
+        float limit = i <= static_cast<size_t>(current) ? hot[i] - kHysteresis : hot[i];
+        if (value >= limit) {
+            severity = i;
+            break;
+        }
+    }
+    return static_cast<ThrottlingSeverity>(severity);
+}
+
 // Methods from ::android::hardware::thermal::V1_0::IThermal follow.
 Return<void> Thermal::getTemperatures(getTemperatures_cb _hidl_cb) {
     ThermalStatus status;
@@ -112,11 +141,22 @@ Return<void> Thermal::getCurrentTemperatures(bool filterType, TemperatureType ty
     ThermalStatus status;
     status.code = ThermalStatusCode::SUCCESS;
     std::vector<Temperature_2_0> temperatures;
-    if (filterType && type != kTemp_2_0.type) {
+    {
+        std::lock_guard<std::mutex> _lock(sensor_mutex_);
+        if (filterType) {
+            auto it = temperatures_.find(type);
+            if (it != temperatures_.end()) {
+                temperatures = it->second;
+            }
+        } else {
+            for (const auto& [_, sensors] : temperatures_) {
+                temperatures.insert(temperatures.end(), sensors.begin(), sensors.end());
+            }
+        }
+    }
+    if (filterType && temperatures.empty()) {
         status.code = ThermalStatusCode::FAILURE;
         status.debugMessage = "Failed to read data";
-    } else {
-        temperatures = {kTemp_2_0};
     }
     _hidl_cb(status, temperatures);
     return Void();
@@ -127,11 +167,20 @@ Return<void> Thermal::getTemperatureThresholds(bool filterType, TemperatureType
     ThermalStatus status;
     status.code = ThermalStatusCode::SUCCESS;
     std::vector<TemperatureThreshold> temperature_thresholds;
-    if (filterType && type != kTempThreshold.type) {
+    if (filterType) {
+        auto it = thresholds_.find(type);
+        if (it != thresholds_.end()) {
+            temperature_thresholds = it->second;
+        }
+    } else {
+        for (const auto& [_, thresholds] : thresholds_) {
+            temperature_thresholds.insert(temperature_thresholds.end(), thresholds.begin(),
+                                          thresholds.end());
+        }
+    }
+    if (filterType && temperature_thresholds.empty()) {
         status.code = ThermalStatusCode::FAILURE;
         status.debugMessage = "Failed to read data";
-    } else {
-        temperature_thresholds = {kTempThreshold};
     }
     _hidl_cb(status, temperature_thresholds);
     return Void();
@@ -152,6 +201,19 @@ Return<void> Thermal::getCurrentCoolingDevices(bool filterType, CoolingType type
     return Void();
 }
 
+bool Thermal::isCallbackRegisteredLocked(const sp<IThermalChangedCallback>& callback) {
+    auto equals = [&](const sp<IThermalChangedCallback>& c) {
+        return interfacesEqual(c, callback);
+    };
+    if (std::any_of(callbacks_.begin(), callbacks_.end(), equals)) {
+        return true;
+    }
+    return std::any_of(filtered_callbacks_.begin(), filtered_callbacks_.end(),
+                       [&](const auto& entry) {
+                           return std::any_of(entry.second.begin(), entry.second.end(), equals);
+                       });
+}
+
 Return<void> Thermal::registerThermalChangedCallback(const sp<IThermalChangedCallback>& callback,
                                                      bool filterType, TemperatureType type,
                                                      registerThermalChangedCallback_cb _hidl_cb) {
@@ -166,14 +228,16 @@ Return<void> Thermal::registerThermalChangedCallback(const sp<IThermalChangedCal
         status.code = ThermalStatusCode::SUCCESS;
     }
     std::lock_guard<std::mutex> _lock(thermal_callback_mutex_);
-    if (std::any_of(callbacks_.begin(), callbacks_.end(), [&](const CallbackSetting& c) {
-            return interfacesEqual(c.callback, callback);
-        })) {
+    if (isCallbackRegisteredLocked(callback)) {
         status.code = ThermalStatusCode::FAILURE;
         status.debugMessage = "Same callback interface registered already";
         LOG(ERROR) << status.debugMessage;
     } else {
-        callbacks_.emplace_back(callback, filterType, type);
+        if (filterType) {
+            filtered_callbacks_[type].push_back(callback);
+        } else {
+            callbacks_.push_back(callback);
+        }
         LOG(INFO) << "A callback has been registered to ThermalHAL, isFilter: " << filterType
                   << " Type: " << android::hardware::thermal::V2_0::toString(type);
     }
@@ -195,20 +259,27 @@ Return<void> Thermal::unregisterThermalChangedCallback(
     }
     bool removed = false;
     std::lock_guard<std::mutex> _lock(thermal_callback_mutex_);
-    callbacks_.erase(
-        std::remove_if(callbacks_.begin(), callbacks_.end(),
-                       [&](const CallbackSetting& c) {
-                           if (interfacesEqual(c.callback, callback)) {
-                               LOG(INFO)
-                                   << "A callback has been unregistered from ThermalHAL, isFilter: "
-                                   << c.is_filter_type << " Type: "
-                                   << android::hardware::thermal::V2_0::toString(c.type);
-                               removed = true;
-                               return true;
-                           }
-                           return false;
-                       }),
-        callbacks_.end());
+    auto remove = [&](std::vector<sp<IThermalChangedCallback>>* callbacks, bool isFilter,
+                      TemperatureType type) {
+        callbacks->erase(
+            std::remove_if(callbacks->begin(), callbacks->end(),
+                           [&](const sp<IThermalChangedCallback>& c) {
+                               if (interfacesEqual(c, callback)) {
+                                   LOG(INFO) << "A callback has been unregistered from "
+                                             << "ThermalHAL, isFilter: " << isFilter << " Type: "
+                                             << android::hardware::thermal::V2_0::toString(type);
+                                   removed = true;
+                                   return true;
+                               }
+                               return false;
+                           }),
+            callbacks->end());
+    };
+    remove(&callbacks_, false, TemperatureType::UNKNOWN);
+    for (auto it = filtered_callbacks_.begin(); it != filtered_callbacks_.end();) {
+        remove(&it->second, true, it->first);
+        it = it->second.empty() ? filtered_callbacks_.erase(it) : std::next(it);
+    }
     if (!removed) {
         status.code = ThermalStatusCode::FAILURE;
         status.debugMessage = "The callback was not registered before";
@@ -218,6 +289,90 @@ Return<void> Thermal::unregisterThermalChangedCallback(
     return Void();
 }
 
+void Thermal::notifyThrottling(const Temperature_2_0& temperature) {
+    std::vector<sp<IThermalChangedCallback>> callbacks;
+    {
+        std::lock_guard<std::mutex> _lock(thermal_callback_mutex_);
+        callbacks = callbacks_;
+        auto it = filtered_callbacks_.find(temperature.type);
+        if (it != filtered_callbacks_.end()) {
+            callbacks.insert(callbacks.end(), it->second.begin(), it->second.end());
+        }
+    }
+    // Do not hold the lock during the binder calls, a callback may unregister itself.
+    for (const auto& callback : callbacks) {
+        Return<void> ret = callback->notifyThrottling(temperature);
+        if (!ret.isOk()) {
+            LOG(ERROR) << "Failed to notify throttling: " << ret.description();
+        }
+    }
+}
+
+void Thermal::setTemperature(int fd, const std::string& name, float value) {
+    std::optional<Temperature_2_0> changed;
+    {
+        std::lock_guard<std::mutex> _lock(sensor_mutex_);
+        Temperature_2_0* temperature = nullptr;
+        for (auto& [_, sensors] : temperatures_) {
+            auto it = std::find_if(sensors.begin(), sensors.end(),
+                                   [&](const Temperature_2_0& t) { return t.name == name; });
+            if (it != sensors.end()) {
+                temperature = &*it;
+                break;
+            }
+        }
+        if (temperature == nullptr) {
+            dprintf(fd, "Unknown sensor: %s\n", name.c_str());
+            return;
+        }
+
+        temperature->value = value;
+        ThrottlingSeverity severity = temperature->throttlingStatus;
+        auto thresholds = thresholds_.find(temperature->type);
+        if (thresholds != thresholds_.end()) {
+            for (const auto& threshold : thresholds->second) {
+                if (threshold.name == name) {
+                    severity = evaluateSeverity(threshold, value, severity);
+                }
+            }
+        }
+        dprintf(fd, "%s: %f, severity %s\n", name.c_str(), value,
+                android::hardware::thermal::V2_0::toString(severity).c_str());
+        // Only a threshold crossing is worth a notification.
+        if (severity != temperature->throttlingStatus) {
+            temperature->throttlingStatus = severity;
+            changed = *temperature;
+        }
+    }
+    if (changed.has_value()) {
+        notifyThrottling(*changed);
+    }
+}
+
+Return<void> Thermal::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        return Void();
+    }
+    int out = fd->data[0];
+    float value;
+    if (options.size() == 3 && options[0] == "--set-temperature" &&
+        android::base::ParseFloat(options[2].c_str(), &value)) {
+        setTemperature(out, options[1], value);
+        return Void();
+    }
+    if (options.size() != 0) {
+        dprintf(out, "Usage: --set-temperature <name> <value>\n");
+        return Void();
+    }
+    std::lock_guard<std::mutex> _lock(sensor_mutex_);
+    for (const auto& [_, sensors] : temperatures_) {
+        for (const auto& temperature : sensors) {
+            dprintf(out, "%s\n", toString(temperature).c_str());
+        }
+    }
+    return Void();
+}
+
 }  // namespace implementation
 }  // namespace V2_0
 }  // namespace thermal
@@ -17,6 +17,10 @@
 #ifndef ANDROID_HARDWARE_THERMAL_V2_0_THERMAL_H
 #define ANDROID_HARDWARE_THERMAL_V2_0_THERMAL_H
 
+#include <map>
+#include <mutex>
+#include <vector>
+
 #include <android/hardware/thermal/2.0/IThermal.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
@@ -29,6 +33,7 @@ namespace implementation {
 
 using ::android::sp;
 using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_memory;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
@@ -44,17 +49,20 @@ using Temperature_2_0 = ::android::hardware::thermal::V2_0::Temperature;
 using ::android::hardware::thermal::V2_0::IThermalChangedCallback;
 using ::android::hardware::thermal::V2_0::TemperatureThreshold;
 using ::android::hardware::thermal::V2_0::TemperatureType;
-
-struct CallbackSetting {
-    CallbackSetting(sp<IThermalChangedCallback> callback, bool is_filter_type, TemperatureType type)
-        : callback(callback), is_filter_type(is_filter_type), type(type) {}
-    sp<IThermalChangedCallback> callback;
-    bool is_filter_type;
-    TemperatureType type;
-};
+using ::android::hardware::thermal::V2_0::ThrottlingSeverity;
 
 class Thermal : public IThermal {
    public:
+    // A sensor only goes back to a lower severity once it is this far below the threshold it
+    // crossed, so that a temperature hovering around a threshold does not flood the callbacks.
+    static constexpr float kHysteresis = 1.0;
+
+    Thermal();
+
+    // Returns the severity of a sensor at the given temperature, given its current severity.
+    static ThrottlingSeverity evaluateSeverity(const TemperatureThreshold& threshold, float value,
+                                               ThrottlingSeverity current);
+
     // Methods from ::android::hardware::thermal::V1_0::IThermal follow.
     Return<void> getTemperatures(getTemperatures_cb _hidl_cb) override;
     Return<void> getCpuUsages(getCpuUsages_cb _hidl_cb) override;
@@ -74,9 +82,28 @@ class Thermal : public IThermal {
     Return<void> getCurrentCoolingDevices(bool filterType, CoolingType type,
                                           getCurrentCoolingDevices_cb _hidl_cb) override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    // "--set-temperature <name> <value>" changes the temperature of a sensor, notifying the
+    // callbacks if its severity changes. Without options, the sensors are dumped.
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
+
    private:
+    // Returns whether the callback is registered, for any type.
+    bool isCallbackRegisteredLocked(const sp<IThermalChangedCallback>& callback);
+    void setTemperature(int fd, const std::string& name, float value);
+    void notifyThrottling(const Temperature_2_0& temperature);
+
+    // The sensors grouped by type, so that a filtered query does not scan every sensor.
+    std::mutex sensor_mutex_;
+    std::map<TemperatureType, std::vector<Temperature_2_0>> temperatures_;
+    // Only modified in the constructor.
+    std::map<TemperatureType, std::vector<TemperatureThreshold>> thresholds_;
+
+    // The callbacks grouped by the type they filter on, so that notifying the change of a sensor
+    // only visits the callbacks interested in it.
     std::mutex thermal_callback_mutex_;
-    std::vector<CallbackSetting> callbacks_;
+    std::vector<sp<IThermalChangedCallback>> callbacks_;
+    std::map<TemperatureType, std::vector<sp<IThermalChangedCallback>>> filtered_callbacks_;
 };
 
 }  // namespace implementation
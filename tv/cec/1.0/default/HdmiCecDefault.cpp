@@ -23,7 +23,10 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/ioctl.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <array>
+#include <chrono>
 
 #include "HdmiCecDefault.h"
 
@@ -43,7 +46,46 @@ using android::base::GetUintProperty;
 using std::stoi;
 using std::string;
 
+namespace {
+
+// Transmits are reported by the CEC framework once the retries are done, this only guards
+// against a driver that never reports one
+constexpr std::chrono::seconds kTransmitTimeout(5);
+
+enum OpcodeFlag : uint8_t {
+    WAKEUP = 1 << 0,
+    TRANSFERABLE_IN_SLEEP = 1 << 1,
+    // Transferable in sleep if the UI command is a power one
+    TRANSFERABLE_IF_POWER_UI_COMMAND = 1 << 2,
+};
+
+constexpr std::array<uint8_t, 256> makeOpcodeFlags() {
+    std::array<uint8_t, 256> flags{};
+    for (int opcode : {CEC_MESSAGE_TEXT_VIEW_ON, CEC_MESSAGE_IMAGE_VIEW_ON}) {
+        flags[opcode] |= WAKEUP;
+    }
+    for (int opcode : {CEC_MESSAGE_ABORT, CEC_MESSAGE_DEVICE_VENDOR_ID,
+                       CEC_MESSAGE_GET_CEC_VERSION, CEC_MESSAGE_GET_MENU_LANGUAGE,
+                       CEC_MESSAGE_GIVE_DEVICE_POWER_STATUS, CEC_MESSAGE_GIVE_DEVICE_VENDOR_ID,
+                       CEC_MESSAGE_GIVE_OSD_NAME, CEC_MESSAGE_GIVE_PHYSICAL_ADDRESS,
+                       CEC_MESSAGE_REPORT_PHYSICAL_ADDRESS, CEC_MESSAGE_REPORT_POWER_STATUS,
+                       CEC_MESSAGE_SET_OSD_NAME, CEC_MESSAGE_DECK_CONTROL, CEC_MESSAGE_PLAY,
+                       CEC_MESSAGE_IMAGE_VIEW_ON, CEC_MESSAGE_TEXT_VIEW_ON,
+                       CEC_MESSAGE_SYSTEM_AUDIO_MODE_REQUEST}) {
+        flags[opcode] |= TRANSFERABLE_IN_SLEEP;
+    }
+    flags[CEC_MESSAGE_USER_CONTROL_PRESSED] |= TRANSFERABLE_IF_POWER_UI_COMMAND;
+    return flags;
+}
+
+// Every received message is classified, so this is done once for all opcodes
+constexpr std::array<uint8_t, 256> kOpcodeFlags = makeOpcodeFlags();
+
+}  // namespace
+
 HdmiCecDefault::HdmiCecDefault() {
+    mEpollFd = -1;
+    mExitFd = -1;
     mCecEnabled = false;
     mWakeupEnabled = false;
     mCecControlEnabled = false;
@@ -184,22 +226,45 @@ Return<SendMessageResult> HdmiCecDefault::sendMessage(const CecMessage& message)
     }
     cecMsg.len = message.body.size() + 1;
 
-    // Return failure only if send message fails for all the ports
-    Return<SendMessageResult> result = SendMessageResult::FAIL;
-    for (int i = 0; i < mHdmiCecPorts.size(); i++) {
-        int ret = ioctl(mHdmiCecPorts[i]->mCecFd, CEC_TRANSMIT, &cecMsg);
+    // Queue the message on every port at once and wait for the event thread to receive the
+    // results, so that the ports transmit in parallel
+    auto transmit = std::make_shared<Transmit>();
+    transmit->txStatus.assign(mHdmiCecPorts.size(), -1);
+    std::unique_lock<std::mutex> lock(mTransmitLock);
+    for (size_t i = 0; i < mHdmiCecPorts.size(); i++) {
+        cec_msg portMsg = cecMsg;
+        int ret = ioctl(mHdmiCecPorts[i]->mTxFd, CEC_TRANSMIT, &portMsg);
 
         if (ret) {
             LOG(ERROR) << "Send message failed, Error = " << strerror(errno);
             continue;
         }
+        mPendingTransmits[{i, portMsg.sequence}] = transmit;
+        transmit->pending++;
+    }
+
+    if (!mTransmitDone.wait_for(lock, kTransmitTimeout,
+                                [&transmit] { return transmit->pending == 0; })) {
+        LOG(ERROR) << "Send message timed out";
+        for (auto it = mPendingTransmits.begin(); it != mPendingTransmits.end();) {
+            it = it->second == transmit ? mPendingTransmits.erase(it) : std::next(it);
+        }
+    }
+    lock.unlock();
+
+    // Return failure only if send message fails for all the ports
+    Return<SendMessageResult> result = SendMessageResult::FAIL;
+    for (int txStatus : transmit->txStatus) {
+        if (txStatus == -1) {
+            continue;
+        }
 
-        if (cecMsg.tx_status != CEC_TX_STATUS_OK) {
-            LOG(ERROR) << "Send message tx_status = " << cecMsg.tx_status;
+        if (txStatus != CEC_TX_STATUS_OK) {
+            LOG(ERROR) << "Send message tx_status = " << txStatus;
         }
 
         if (result != SendMessageResult::SUCCESS) {
-            result = getSendMessageResult(cecMsg.tx_status);
+            result = getSendMessageResult(txStatus);
         }
     }
     return result;
@@ -298,8 +363,28 @@ int getPortId(string cecFilename) {
     }
 }
 
+bool HdmiCecDefault::addEpollSource(int fd, uint32_t events, EventSource source,
+                                    size_t portIndex) {
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = (static_cast<uint64_t>(portIndex) << 32) | source;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event)) {
+        LOG(ERROR) << "Failed to add fd to epoll, Error = " << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
 // Initialise the cec file descriptors
 Return<Result> HdmiCecDefault::init() {
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    mExitFd = eventfd(0, EFD_NONBLOCK);
+    if (mEpollFd < 0 || mExitFd < 0 || !addEpollSource(mExitFd, EPOLLIN, EXIT_EVENT, 0)) {
+        LOG(ERROR) << "Failed to set up the event loop, Error = " << strerror(errno);
+        release();
+        return Result::FAILURE_NOT_SUPPORTED;
+    }
+
     const char* parentPath = "/dev/";
     DIR* dir = opendir(parentPath);
     const char* cecFilename = "cec";
@@ -317,16 +402,24 @@ Return<Result> HdmiCecDefault::init() {
             if (result != Result::SUCCESS) {
                 continue;
             }
-            thread eventThread(&HdmiCecDefault::event_thread, this, hdmiCecPort.get());
-            mEventThreads.push_back(std::move(eventThread));
+            size_t portIndex = mHdmiCecPorts.size();
+            if (!addEpollSource(hdmiCecPort->mCecFd, EPOLLIN | EPOLLPRI, CEC_FD_EVENT,
+                                portIndex) ||
+                !addEpollSource(hdmiCecPort->mTxFd, EPOLLIN, TX_FD_EVENT, portIndex)) {
+                // Closing the fds removes them from the epoll set
+                continue;
+            }
             mHdmiCecPorts.push_back(std::move(hdmiCecPort));
         }
     }
+    closedir(dir);
 
     if (mHdmiCecPorts.empty()) {
+        release();
         return Result::FAILURE_NOT_SUPPORTED;
     }
 
+    mEventThread = thread(&HdmiCecDefault::event_thread, this);
     mCecEnabled = true;
     mWakeupEnabled = true;
     mCecControlEnabled = true;
@@ -337,150 +430,188 @@ Return<void> HdmiCecDefault::release() {
     mCecEnabled = false;
     mWakeupEnabled = false;
     mCecControlEnabled = false;
-    for (thread& eventThread : mEventThreads) {
-        if (eventThread.joinable()) {
-            eventThread.join();
-        }
+    if (mEventThread.joinable()) {
+        uint64_t tmp = 1;
+        write(mExitFd, &tmp, sizeof(tmp));
+        mEventThread.join();
     }
     setCallback(nullptr);
+    {
+        // Fail the transmits still waiting for a result
+        std::lock_guard<std::mutex> lock(mTransmitLock);
+        for (auto& pendingTransmit : mPendingTransmits) {
+            pendingTransmit.second->pending--;
+        }
+        mPendingTransmits.clear();
+    }
+    mTransmitDone.notify_all();
     mHdmiCecPorts.clear();
-    mEventThreads.clear();
+    if (mExitFd > 0) {
+        close(mExitFd);
+        mExitFd = -1;
+    }
+    if (mEpollFd > 0) {
+        close(mEpollFd);
+        mEpollFd = -1;
+    }
     return Void();
 }
 
-void HdmiCecDefault::event_thread(HdmiCecPort* hdmiCecPort) {
-    struct pollfd ufds[3] = {
-            {hdmiCecPort->mCecFd, POLLIN, 0},
-            {hdmiCecPort->mCecFd, POLLERR, 0},
-            {hdmiCecPort->mExitFd, POLLIN, 0},
-    };
+void HdmiCecDefault::event_thread() {
+    // Both fds of every port and the exit event
+    epoll_event events[2 * (MAX_PORT_ID - MIN_PORT_ID + 1) + 1];
 
     while (1) {
-        ufds[0].revents = 0;
-        ufds[1].revents = 0;
-        ufds[2].revents = 0;
-
-        int ret = poll(ufds, /* size(ufds) = */ 3, /* timeout = */ -1);
+        int ret = epoll_wait(mEpollFd, events, std::size(events), /* timeout = */ -1);
 
         if (ret <= 0) {
             continue;
         }
 
-        if (ufds[2].revents == POLLIN) { /* Exit */
-            break;
-        }
+        for (int i = 0; i < ret; i++) {
+            EventSource source = static_cast<EventSource>(events[i].data.u64 & 0xffffffff);
+            size_t portIndex = events[i].data.u64 >> 32;
+            uint32_t revents = events[i].events;
 
-        if (ufds[1].revents == POLLERR) { /* CEC Event */
-            cec_event ev;
-            ret = ioctl(hdmiCecPort->mCecFd, CEC_DQEVENT, &ev);
+            if (source == EXIT_EVENT) {
+                return;
+            }
 
-            if (ret) {
-                LOG(ERROR) << "CEC_DQEVENT failed, Error = " << strerror(errno);
+            HdmiCecPort* hdmiCecPort = mHdmiCecPorts[portIndex].get();
+            int fd = source == TX_FD_EVENT ? hdmiCecPort->mTxFd : hdmiCecPort->mCecFd;
+            if (revents & EPOLLHUP) {
+                // The adapter is gone, stop waiting on it
+                LOG(ERROR) << "CEC adapter of port " << hdmiCecPort->mPortId << " hung up";
+                epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
                 continue;
             }
 
-            if (!mCecEnabled) {
+            if (source == TX_FD_EVENT) {
+                if (revents & EPOLLIN) {
+                    handleTransmitDone(portIndex);
+                }
                 continue;
             }
 
-            if (ev.event == CEC_EVENT_STATE_CHANGE) {
-                if (mCallback != nullptr) {
-                    HotplugEvent hotplugEvent{
-                            .connected = (ev.state_change.phys_addr != CEC_PHYS_ADDR_INVALID),
-                            .portId = hdmiCecPort->mPortId};
-                    mCallback->onHotplugEvent(hotplugEvent);
-                } else {
-                    LOG(ERROR) << "No event callback for hotplug";
-                }
+            if (revents & (EPOLLPRI | EPOLLERR)) { /* CEC Event */
+                handleCecEvent(hdmiCecPort);
+            }
+
+            if (revents & EPOLLIN) { /* CEC Driver */
+                handleCecMessage(hdmiCecPort);
             }
         }
+    }
+}
 
-        if (ufds[0].revents == POLLIN) { /* CEC Driver */
-            cec_msg msg = {};
-            ret = ioctl(hdmiCecPort->mCecFd, CEC_RECEIVE, &msg);
+void HdmiCecDefault::handleCecEvent(HdmiCecPort* hdmiCecPort) {
+    cec_event ev;
+    int ret = ioctl(hdmiCecPort->mCecFd, CEC_DQEVENT, &ev);
 
-            if (ret) {
-                LOG(ERROR) << "CEC_RECEIVE failed, Error = " << strerror(errno);
-                continue;
-            }
+    if (ret) {
+        LOG(ERROR) << "CEC_DQEVENT failed, Error = " << strerror(errno);
+        return;
+    }
 
-            if (msg.rx_status != CEC_RX_STATUS_OK) {
-                LOG(ERROR) << "msg rx_status = " << msg.rx_status;
-                continue;
-            }
+    if (!mCecEnabled) {
+        return;
+    }
 
-            if (!mCecEnabled) {
-                continue;
-            }
+    if (ev.event == CEC_EVENT_STATE_CHANGE) {
+        if (mCallback != nullptr) {
+            HotplugEvent hotplugEvent{
+                    .connected = (ev.state_change.phys_addr != CEC_PHYS_ADDR_INVALID),
+                    .portId = hdmiCecPort->mPortId};
+            mCallback->onHotplugEvent(hotplugEvent);
+        } else {
+            LOG(ERROR) << "No event callback for hotplug";
+        }
+    }
+}
 
-            if (!mWakeupEnabled && isWakeupMessage(msg)) {
-                LOG(DEBUG) << "Filter wakeup message";
-                continue;
-            }
+void HdmiCecDefault::handleCecMessage(HdmiCecPort* hdmiCecPort) {
+    cec_msg msg = {};
+    int ret = ioctl(hdmiCecPort->mCecFd, CEC_RECEIVE, &msg);
 
-            if (!mCecControlEnabled && !isTransferableInSleep(msg)) {
-                LOG(DEBUG) << "Filter message in standby mode";
-                continue;
-            }
+    if (ret) {
+        LOG(ERROR) << "CEC_RECEIVE failed, Error = " << strerror(errno);
+        return;
+    }
 
-            if (mCallback != nullptr) {
-                size_t length = std::min(msg.len - 1, (uint32_t)MaxLength::MESSAGE_BODY);
-                CecMessage cecMessage{
-                        .initiator = static_cast<CecLogicalAddress>(msg.msg[0] >> 4),
-                        .destination = static_cast<CecLogicalAddress>(msg.msg[0] & 0xf),
-                };
-                cecMessage.body.resize(length);
-                for (size_t i = 0; i < length; ++i) {
-                    cecMessage.body[i] = static_cast<uint8_t>(msg.msg[i + 1]);
-                }
-                mCallback->onCecMessage(cecMessage);
-            } else {
-                LOG(ERROR) << "no event callback for message";
-            }
+    if (msg.rx_status != CEC_RX_STATUS_OK) {
+        LOG(ERROR) << "msg rx_status = " << msg.rx_status;
+        return;
+    }
+
+    if (!mCecEnabled) {
+        return;
+    }
+
+    if (!mWakeupEnabled && isWakeupMessage(msg)) {
+        LOG(DEBUG) << "Filter wakeup message";
+        return;
+    }
+
+    if (!mCecControlEnabled && !isTransferableInSleep(msg)) {
+        LOG(DEBUG) << "Filter message in standby mode";
+        return;
+    }
+
+    if (mCallback != nullptr) {
+        size_t length = std::min(msg.len - 1, (uint32_t)MaxLength::MESSAGE_BODY);
+        CecMessage cecMessage{
+                .initiator = static_cast<CecLogicalAddress>(msg.msg[0] >> 4),
+                .destination = static_cast<CecLogicalAddress>(msg.msg[0] & 0xf),
+        };
+        cecMessage.body.resize(length);
+        for (size_t i = 0; i < length; ++i) {
+            cecMessage.body[i] = static_cast<uint8_t>(msg.msg[i + 1]);
         }
+        mCallback->onCecMessage(cecMessage);
+    } else {
+        LOG(ERROR) << "no event callback for message";
     }
 }
 
+void HdmiCecDefault::handleTransmitDone(size_t portIndex) {
+    cec_msg msg = {};
+    int ret = ioctl(mHdmiCecPorts[portIndex]->mTxFd, CEC_RECEIVE, &msg);
+
+    if (ret) {
+        if (errno != EAGAIN) {
+            LOG(ERROR) << "CEC_RECEIVE of transmit result failed, Error = " << strerror(errno);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mTransmitLock);
+        auto it = mPendingTransmits.find({portIndex, msg.sequence});
+        if (it == mPendingTransmits.end()) {
+            // The sender stopped waiting for it
+            return;
+        }
+        it->second->txStatus[portIndex] = msg.tx_status;
+        it->second->pending--;
+        mPendingTransmits.erase(it);
+    }
+    mTransmitDone.notify_all();
+}
+
 int HdmiCecDefault::getOpcode(cec_msg message) {
     return static_cast<uint8_t>(message.msg[1]);
 }
 
 bool HdmiCecDefault::isWakeupMessage(cec_msg message) {
-    int opcode = getOpcode(message);
-    switch (opcode) {
-        case CEC_MESSAGE_TEXT_VIEW_ON:
-        case CEC_MESSAGE_IMAGE_VIEW_ON:
-            return true;
-        default:
-            return false;
-    }
+    return kOpcodeFlags[getOpcode(message)] & WAKEUP;
 }
 
 bool HdmiCecDefault::isTransferableInSleep(cec_msg message) {
-    int opcode = getOpcode(message);
-    switch (opcode) {
-        case CEC_MESSAGE_ABORT:
-        case CEC_MESSAGE_DEVICE_VENDOR_ID:
-        case CEC_MESSAGE_GET_CEC_VERSION:
-        case CEC_MESSAGE_GET_MENU_LANGUAGE:
-        case CEC_MESSAGE_GIVE_DEVICE_POWER_STATUS:
-        case CEC_MESSAGE_GIVE_DEVICE_VENDOR_ID:
-        case CEC_MESSAGE_GIVE_OSD_NAME:
-        case CEC_MESSAGE_GIVE_PHYSICAL_ADDRESS:
-        case CEC_MESSAGE_REPORT_PHYSICAL_ADDRESS:
-        case CEC_MESSAGE_REPORT_POWER_STATUS:
-        case CEC_MESSAGE_SET_OSD_NAME:
-        case CEC_MESSAGE_DECK_CONTROL:
-        case CEC_MESSAGE_PLAY:
-        case CEC_MESSAGE_IMAGE_VIEW_ON:
-        case CEC_MESSAGE_TEXT_VIEW_ON:
-        case CEC_MESSAGE_SYSTEM_AUDIO_MODE_REQUEST:
-            return true;
-        case CEC_MESSAGE_USER_CONTROL_PRESSED:
-            return isPowerUICommand(message);
-        default:
-            return false;
+    uint8_t flags = kOpcodeFlags[getOpcode(message)];
+    if (flags & TRANSFERABLE_IF_POWER_UI_COMMAND) {
+        return isPowerUICommand(message);
     }
+    return flags & TRANSFERABLE_IN_SLEEP;
 }
 
 int HdmiCecDefault::getFirstParam(cec_msg message) {
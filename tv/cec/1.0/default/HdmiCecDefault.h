@@ -15,7 +15,11 @@
  */
 #include <hardware/hdmi_cec.h>
 #include <linux/cec.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <thread>
+#include <utility>
 #include <vector>
 #include "HdmiCecPort.h"
 
@@ -56,7 +60,20 @@ class HdmiCecDefault : public IHdmiCec, public hidl_death_recipient {
     Return<void> release();
 
   private:
-    void event_thread(HdmiCecPort* hdmiCecPort);
+    // A message handed to the transmit fd of every port, waiting for their results
+    struct Transmit {
+        size_t pending = 0;
+        // tx_status of each port, or -1 if the message could not be queued on the port
+        vector<int> txStatus;
+    };
+    // What an epoll event is about, stored with the port index in the event data
+    enum EventSource : uint32_t { EXIT_EVENT, CEC_FD_EVENT, TX_FD_EVENT };
+
+    void event_thread();
+    bool addEpollSource(int fd, uint32_t events, EventSource source, size_t portIndex);
+    void handleCecEvent(HdmiCecPort* hdmiCecPort);
+    void handleCecMessage(HdmiCecPort* hdmiCecPort);
+    void handleTransmitDone(size_t portIndex);
     static int getOpcode(cec_msg message);
     static int getFirstParam(cec_msg message);
     static bool isWakeupMessage(cec_msg message);
@@ -64,9 +81,17 @@ class HdmiCecDefault : public IHdmiCec, public hidl_death_recipient {
     static bool isPowerUICommand(cec_msg message);
     static Return<SendMessageResult> getSendMessageResult(int tx_status);
 
-    vector<thread> mEventThreads;
+    // A single thread waits on the fds of every port
+    thread mEventThread;
+    int mEpollFd;
+    int mExitFd;
     vector<shared_ptr<HdmiCecPort>> mHdmiCecPorts;
 
+    std::mutex mTransmitLock;
+    std::condition_variable mTransmitDone;
+    // By port index and sequence number of the queued transmit
+    std::map<std::pair<size_t, uint32_t>, shared_ptr<Transmit>> mPendingTransmits;
+
     // When set to false, all the CEC commands are discarded. True by default after initialization.
     bool mCecEnabled;
     /*
@@ -19,7 +19,6 @@
 #include <errno.h>
 #include <linux/cec.h>
 #include <linux/ioctl.h>
-#include <sys/eventfd.h>
 #include <algorithm>
 
 #include "HdmiCecPort.h"
@@ -34,7 +33,7 @@ namespace implementation {
 HdmiCecPort::HdmiCecPort(unsigned int portId) {
     mPortId = portId;
     mCecFd = -1;
-    mExitFd = -1;
+    mTxFd = -1;
 }
 
 HdmiCecPort::~HdmiCecPort() {
@@ -48,13 +47,6 @@ Return<Result> HdmiCecPort::init(const char* path) {
         LOG(ERROR) << "Failed to open " << path << ", Error = " << strerror(errno);
         return Result::FAILURE_NOT_SUPPORTED;
     }
-    mExitFd = eventfd(0, EFD_NONBLOCK);
-    if (mExitFd < 0) {
-        LOG(ERROR) << "Failed to open eventfd, Error = " << strerror(errno);
-        release();
-        return Result::FAILURE_NOT_SUPPORTED;
-    }
-
     // Ensure the CEC device supports required capabilities
     struct cec_caps caps = {};
     int ret = ioctl(mCecFd, CEC_ADAP_G_CAPS, &caps);
@@ -77,19 +69,32 @@ Return<Result> HdmiCecPort::init(const char* path) {
         release();
         return Result::FAILURE_NOT_SUPPORTED;
     }
+
+    mTxFd = open(path, O_RDWR | O_NONBLOCK);
+    if (mTxFd < 0) {
+        LOG(ERROR) << "Failed to open " << path << " for transmitting, Error = "
+                   << strerror(errno);
+        release();
+        return Result::FAILURE_NOT_SUPPORTED;
+    }
+    mode = CEC_MODE_INITIATOR | CEC_MODE_NO_FOLLOWER;
+    ret = ioctl(mTxFd, CEC_S_MODE, &mode);
+    if (ret) {
+        LOG(ERROR) << "Unable to set transmit mode, Error = " << strerror(errno);
+        release();
+        return Result::FAILURE_NOT_SUPPORTED;
+    }
     return Result::SUCCESS;
 }
 
 Return<void> HdmiCecPort::release() {
-    if (mExitFd > 0) {
-        uint64_t tmp = 1;
-        write(mExitFd, &tmp, sizeof(tmp));
-    }
-    if (mExitFd > 0) {
-        close(mExitFd);
+    if (mTxFd > 0) {
+        close(mTxFd);
+        mTxFd = -1;
     }
     if (mCecFd > 0) {
         close(mCecFd);
+        mCecFd = -1;
     }
     return Void();
 }
@@ -31,7 +31,9 @@ class HdmiCecPort {
 
     unsigned int mPortId;
     int mCecFd;
-    int mExitFd;
+    // Opened non-blocking in initiator mode only, so CEC_TRANSMIT returns at once and the
+    // result of each transmit is received on it
+    int mTxFd;
 };
 
 }  // namespace implementation
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "android.hardware.tv.tuner-service.example-AvBufferSlab"
+
+#include "AvBufferSlab.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <utils/Log.h>
+
+#include <algorithm>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+AvBufferSlab::AvBufferSlab(::android::base::unique_fd fd, size_t size)
+    : mSize(size), mFd(std::move(fd)) {
+    void* base = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd.get(), 0);
+    if (base == MAP_FAILED) {
+        ALOGE("[AvBufferSlab] Failed to map %zu bytes: %s", mSize, strerror(errno));
+        return;
+    }
+    mBase = static_cast<uint8_t*>(base);
+
+    mHandle = native_handle_create(/*numFd*/ 1, 0);
+    if (mHandle == nullptr) {
+        ALOGE("[AvBufferSlab] Failed to create native_handle");
+        return;
+    }
+    mHandle->data[0] = mFd.get();
+}
+
+AvBufferSlab::~AvBufferSlab() {
+    if (mHandle != nullptr) {
+        // The fd is owned by mFd.
+        native_handle_delete(mHandle);
+    }
+    if (mBase != nullptr) {
+        munmap(mBase, mSize);
+    }
+}
+
+bool AvBufferSlab::write(uint64_t dataId, const int8_t* data, size_t size, int64_t* offset) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!isValid() || size == 0 || size > mSize) {
+        return false;
+    }
+
+    size_t start;
+    if (mRanges.empty()) {
+        start = 0;
+    } else {
+        const size_t tail = mRanges.front().offset;
+        if (mHead > tail) {
+            // The free space is after the head, and before the tail once the ring wraps.
+            if (mHead + size <= mSize) {
+                start = mHead;
+            } else if (size <= tail) {
+                start = 0;
+            } else {
+                mFullCount++;
+                return false;
+            }
+        } else if (mHead + size <= tail) {
+            start = mHead;
+        } else {
+            mFullCount++;
+            return false;
+        }
+    }
+
+    memcpy(mBase + start, data, size);
+    mRanges.push_back({dataId, start, size, false});
+    mHead = start + size;
+    mWrites++;
+    *offset = static_cast<int64_t>(start);
+    return true;
+}
+
+bool AvBufferSlab::release(uint64_t dataId) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto range = std::find_if(mRanges.begin(), mRanges.end(),
+                              [dataId](const Range& r) { return r.dataId == dataId; });
+    if (range == mRanges.end()) {
+        return false;
+    }
+    range->released = true;
+    while (!mRanges.empty() && mRanges.front().released) {
+        mRanges.pop_front();
+    }
+    if (mRanges.empty()) {
+        mHead = 0;
+    }
+    return true;
+}
+
+void AvBufferSlab::dump(int fd) {
+    std::lock_guard<std::mutex> lock(mLock);
+    size_t inFlight = 0;
+    for (const auto& range : mRanges) {
+        inFlight += range.released ? 0 : range.size;
+    }
+    dprintf(fd, "      AV slab: %zu bytes, %zu ranges / %zu bytes in flight\n", mSize,
+            mRanges.size(), inFlight);
+    dprintf(fd, "        writes: %" PRIu64 ", full: %" PRIu64 "\n", mWrites, mFullCount);
+}
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
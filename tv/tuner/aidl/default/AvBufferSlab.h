@@ -0,0 +1,80 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <cutils/native_handle.h>
+
+#include <deque>
+#include <mutex>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+// A long-lived DMA-BUF that the A/V data of media events is copied into, instead of a new buffer
+// per event. It is used as a ring: each event gets the next free range of the buffer, and the
+// range is reclaimed once the client releases the data id, so ranges released out of order are
+// only reused after the older ones. The buffer is mapped once for the lifetime of the slab.
+class AvBufferSlab final {
+  public:
+    // Takes ownership of fd, a DMA-BUF of the given size.
+    AvBufferSlab(::android::base::unique_fd fd, size_t size);
+    ~AvBufferSlab();
+
+    bool isValid() const { return mBase != nullptr && mHandle != nullptr; }
+
+    // A handle holding the DMA-BUF fd, to be duplicated into the media events.
+    const native_handle_t* getHandle() const { return mHandle; }
+
+    // Copies size bytes into the next free range and tracks it under dataId. Returns false, with
+    // nothing copied, if the slab does not have a free range that large.
+    bool write(uint64_t dataId, const int8_t* data, size_t size, int64_t* offset);
+
+    // Returns false if dataId is not in the slab.
+    bool release(uint64_t dataId);
+
+    void dump(int fd);
+
+  private:
+    struct Range {
+        uint64_t dataId;
+        size_t offset;
+        size_t size;
+        bool released;
+    };
+
+    const size_t mSize;
+    ::android::base::unique_fd mFd;
+    native_handle_t* mHandle = nullptr;
+    uint8_t* mBase = nullptr;
+
+    std::mutex mLock;
+    // In-flight ranges in the order they were handed out.
+    std::deque<Range> mRanges;
+    size_t mHead = 0;
+    uint64_t mWrites = 0;
+    uint64_t mFullCount = 0;
+};
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -18,10 +18,14 @@
 #define LOG_TAG "android.hardware.tv.tuner-service.example-Demux"
 
 #include <aidl/android/hardware/tv/tuner/DemuxQueueNotifyBits.h>
+#include <aidl/android/hardware/tv/tuner/DemuxTsIndex.h>
 #include <aidl/android/hardware/tv/tuner/Result.h>
 
 #include <utils/Log.h>
+#include <algorithm>
+
 #include "Demux.h"
+#include "Descrambler.h"
 
 namespace aidl {
 namespace android {
@@ -31,6 +35,39 @@ namespace tuner {
 
 #define WAIT_TIMEOUT 3000000000
 
+namespace {
+
+// The DemuxTsIndex flags of a TS packet header and its adaptation field.
+uint32_t getTsIndexFlags(const int8_t* packet) {
+    uint32_t flags = 0;
+    if (packet[1] & 0x40) {
+        flags |= static_cast<uint32_t>(DemuxTsIndex::PAYLOAD_UNIT_START_INDICATOR);
+    }
+    const bool hasAdaptationField = packet[3] & 0x20;
+    if (!hasAdaptationField || static_cast<uint8_t>(packet[4]) == 0) {
+        return flags;
+    }
+    const uint8_t adaptationFlags = static_cast<uint8_t>(packet[5]);
+    static constexpr std::pair<uint8_t, DemuxTsIndex> kAdaptationIndexes[] = {
+            {0x80, DemuxTsIndex::DISCONTINUITY_INDICATOR},
+            {0x40, DemuxTsIndex::RANDOM_ACCESS_INDICATOR},
+            {0x20, DemuxTsIndex::PRIORITY_INDICATOR},
+            {0x10, DemuxTsIndex::PCR_FLAG},
+            {0x08, DemuxTsIndex::OPCR_FLAG},
+            {0x04, DemuxTsIndex::SPLICING_POINT_FLAG},
+            {0x02, DemuxTsIndex::PRIVATE_DATA},
+            {0x01, DemuxTsIndex::ADAPTATION_EXTENSION_FLAG},
+    };
+    for (const auto& [bit, index] : kAdaptationIndexes) {
+        if (adaptationFlags & bit) {
+            flags |= static_cast<uint32_t>(index);
+        }
+    }
+    return flags;
+}
+
+}  // namespace
+
 Demux::Demux(int32_t demuxId, std::shared_ptr<Tuner> tuner) {
     mDemuxId = demuxId;
     mTuner = tuner;
@@ -95,6 +132,7 @@ Demux::~Demux() {
             result = mDvrPlayback->addPlaybackFilter(filterId, filter);
         }
     }
+    updateDispatchFilters();
 
     if (!result) {
         *_aidl_return = nullptr;
@@ -109,9 +147,11 @@ Demux::~Demux() {
 ::ndk::ScopedAStatus Demux::openTimeFilter(std::shared_ptr<ITimeFilter>* _aidl_return) {
     ALOGV("%s", __FUNCTION__);
 
-    mTimeFilter = ndk::SharedRefBase::make<TimeFilter>(this->ref<Demux>());
+    std::shared_ptr<TimeFilter> timeFilter =
+            ndk::SharedRefBase::make<TimeFilter>(this->ref<Demux>());
+    std::atomic_store(&mTimeFilter, timeFilter);
 
-    *_aidl_return = mTimeFilter;
+    *_aidl_return = timeFilter;
     return ::ndk::ScopedAStatus::ok();
 }
 
@@ -179,7 +219,12 @@ Demux::~Demux() {
     mPlaybackFilterIds.clear();
     mRecordFilterIds.clear();
     mFilters.clear();
+    updateDispatchFilters();
     mLastUsedFilterId = -1;
+    {
+        std::lock_guard<std::mutex> lock(mDescramblersLock);
+        mDescramblers.clear();
+    }
     mTuner->removeDemux(mDemuxId);
 
     return ::ndk::ScopedAStatus::ok();
@@ -263,41 +308,128 @@ Demux::~Demux() {
     mPlaybackFilterIds.erase(filterId);
     mRecordFilterIds.erase(filterId);
     mFilters.erase(filterId);
+    updateDispatchFilters();
 
     return ::ndk::ScopedAStatus::ok();
 }
 
-void Demux::startBroadcastTsFilter(vector<int8_t> data) {
-    set<int64_t>::iterator it;
-    uint16_t pid = ((data[1] & 0x1f) << 8) | ((data[2] & 0xff));
+void Demux::updateDispatchFilters() {
+    std::lock_guard<std::mutex> lock(mDispatchLock);
+    for (uint16_t pid : mUsedPids) {
+        mPlaybackFiltersByPid[pid].clear();
+    }
+    mUsedPids.clear();
+    for (int64_t filterId : mPlaybackFilterIds) {
+        auto it = mFilters.find(filterId);
+        if (it == mFilters.end()) {
+            continue;
+        }
+        uint16_t pid = it->second->getTpid();
+        if (pid >= TS_PID_COUNT) {
+            // Not configured as a TS filter yet.
+            continue;
+        }
+        if (mPlaybackFiltersByPid[pid].empty()) {
+            mUsedPids.push_back(pid);
+        }
+        mPlaybackFiltersByPid[pid].push_back(it->second);
+    }
+
+    uint16_t pcrPid = INVALID_TPID;
+    if (!mPcrFilterIds.empty()) {
+        auto it = mFilters.find(*mPcrFilterIds.begin());
+        if (it != mFilters.end()) {
+            pcrPid = it->second->getTpid();
+        }
+    }
+    mPcrPid = pcrPid;
+
+    mRecordSets.clear();
+    for (int64_t filterId : mRecordFilterIds) {
+        auto it = mFilters.find(filterId);
+        if (it == mFilters.end()) {
+            continue;
+        }
+        std::shared_ptr<Dvr> dvr = it->second->getRecordDvr();
+        if (dvr == nullptr) {
+            continue;
+        }
+        auto recordSet = std::find_if(mRecordSets.begin(), mRecordSets.end(),
+                                      [&dvr](const RecordSet& set) { return set.dvr == dvr; });
+        if (recordSet == mRecordSets.end()) {
+            recordSet = mRecordSets.insert(mRecordSets.end(), RecordSet{.dvr = dvr});
+        }
+        recordSet->filters.push_back(it->second);
+        recordSet->tpids.push_back(it->second->getTpid());
+    }
+}
+
+void Demux::startBroadcastTsFilter(uint16_t pid, const vector<const int8_t*>& packets,
+                                   size_t packetSize) {
     if (DEBUG_DEMUX) {
-        ALOGW("[Demux] start ts filter pid: %d", pid);
+        ALOGW("[Demux] start ts filter pid: %d, packets: %zu", pid, packets.size());
     }
-    for (it = mPlaybackFilterIds.begin(); it != mPlaybackFilterIds.end(); it++) {
-        if (pid == mFilters[*it]->getTpid()) {
-            mFilters[*it]->updateFilterOutput(data);
+    if (pid >= TS_PID_COUNT) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mDispatchLock);
+    for (const auto& filter : mPlaybackFiltersByPid[pid]) {
+        filter->updateFilterOutput(packets, packetSize);
+    }
+}
+
+void Demux::sendFrontendInputToRecord(const vector<const int8_t*>& packets, size_t packetSize) {
+    if (DEBUG_DEMUX) {
+        ALOGW("[Demux] update record filter output");
+    }
+    std::lock_guard<std::mutex> lock(mDispatchLock);
+    for (auto& recordSet : mRecordSets) {
+        // Index the packets of each filter's TPID, then write the burst once for all the filters
+        // recording into the DVR.
+        recordSet.tsIndexMasks.assign(recordSet.filters.size(), 0);
+        for (const int8_t* packet : packets) {
+            const uint16_t pid = ((packet[1] & 0x1f) << 8) | (packet[2] & 0xff);
+            for (size_t i = 0; i < recordSet.tpids.size(); i++) {
+                if (recordSet.tpids[i] == pid) {
+                    recordSet.tsIndexMasks[i] |= getTsIndexFlags(packet);
+                }
+            }
+        }
+
+        const bool written = recordSet.dvr->writeRecordFMQ(packets, packetSize);
+        for (size_t i = 0; i < recordSet.filters.size(); i++) {
+            recordSet.filters[i]->onRecordOutputWritten(written, packets.size() * packetSize,
+                                                        recordSet.tsIndexMasks[i]);
         }
     }
 }
 
-void Demux::sendFrontendInputToRecord(vector<int8_t> data) {
-    set<int64_t>::iterator it;
+void Demux::sendFrontendInputToRecord(const int8_t* data, size_t size) {
     if (DEBUG_DEMUX) {
         ALOGW("[Demux] update record filter output");
     }
-    for (it = mRecordFilterIds.begin(); it != mRecordFilterIds.end(); it++) {
-        mFilters[*it]->updateRecordOutput(data);
+    std::lock_guard<std::mutex> lock(mDispatchLock);
+    for (const auto& recordSet : mRecordSets) {
+        const bool written = recordSet.dvr->writeRecordFMQ(data, size);
+        for (const auto& filter : recordSet.filters) {
+            filter->onRecordOutputWritten(written, size, 0);
+        }
     }
 }
 
-void Demux::sendFrontendInputToRecord(vector<int8_t> data, uint16_t pid, uint64_t pts) {
-    sendFrontendInputToRecord(data);
-    set<int64_t>::iterator it;
-    for (it = mRecordFilterIds.begin(); it != mRecordFilterIds.end(); it++) {
-        if (pid == mFilters[*it]->getTpid()) {
-            mFilters[*it]->updatePts(pts);
+void Demux::sendFrontendInputToRecord(const vector<int8_t>& data, uint16_t pid, uint64_t pts) {
+    {
+        // The record events are created as the data is written, so they need the PTS first.
+        std::lock_guard<std::mutex> lock(mDispatchLock);
+        for (const auto& recordSet : mRecordSets) {
+            for (const auto& filter : recordSet.filters) {
+                if (pid == filter->getTpid()) {
+                    filter->updatePts(pts);
+                }
+            }
         }
     }
+    sendFrontendInputToRecord(data.data(), data.size());
 }
 
 bool Demux::startBroadcastFilterDispatcher() {
@@ -329,12 +461,17 @@ bool Demux::startRecordFilterDispatcher() {
     return mFilters[filterId]->startFilterHandler();
 }
 
-void Demux::updateFilterOutput(int64_t filterId, vector<int8_t> data) {
-    mFilters[filterId]->updateFilterOutput(data);
+void Demux::updateFilterOutput(int64_t filterId, const int8_t* data, size_t size) {
+    mFilters[filterId]->updateFilterOutput(data, size);
 }
 
-void Demux::updateMediaFilterOutput(int64_t filterId, vector<int8_t> data, uint64_t pts) {
-    updateFilterOutput(filterId, data);
+void Demux::updateFilterOutput(int64_t filterId, const vector<const int8_t*>& packets,
+                               size_t packetSize) {
+    mFilters[filterId]->updateFilterOutput(packets, packetSize);
+}
+
+void Demux::updateMediaFilterOutput(int64_t filterId, const vector<int8_t>& data, uint64_t pts) {
+    updateFilterOutput(filterId, data.data(), data.size());
     mFilters[filterId]->updatePts(pts);
 }
 
@@ -410,6 +547,63 @@ bool Demux::isRecording() {
     return mIsRecording;
 }
 
+void Demux::attachDescrambler(const std::shared_ptr<Descrambler>& descrambler) {
+    std::lock_guard<std::mutex> lock(mDescramblersLock);
+    mDescramblers.push_back(descrambler);
+}
+
+void Demux::detachDescrambler(const Descrambler* descrambler) {
+    std::lock_guard<std::mutex> lock(mDescramblersLock);
+    // A descrambler detaching as it is destroyed has expired already.
+    mDescramblers.erase(std::remove_if(mDescramblers.begin(), mDescramblers.end(),
+                                       [descrambler](const auto& attached) {
+                                           std::shared_ptr<Descrambler> locked = attached.lock();
+                                           return locked == nullptr || locked.get() == descrambler;
+                                       }),
+                        mDescramblers.end());
+}
+
+vector<std::shared_ptr<Descrambler>> Demux::getDescramblers() {
+    vector<std::shared_ptr<Descrambler>> descramblers;
+    std::lock_guard<std::mutex> lock(mDescramblersLock);
+    for (const auto& attached : mDescramblers) {
+        std::shared_ptr<Descrambler> descrambler = attached.lock();
+        if (descrambler != nullptr) {
+            descramblers.push_back(std::move(descrambler));
+        }
+    }
+    return descramblers;
+}
+
+void Demux::descramblePackets(const vector<pair<uint16_t, int8_t*>>& packets,
+                              size_t packetSize) {
+    // Called without mDescramblersLock, which the last reference to a descrambler takes to
+    // detach it.
+    for (const auto& descrambler : getDescramblers()) {
+        descrambler->descramblePackets(packets, packetSize);
+    }
+}
+
+void Demux::updateTimeFilter(const vector<pair<uint16_t, int8_t*>>& packets) {
+    std::shared_ptr<TimeFilter> timeFilter = std::atomic_load(&mTimeFilter);
+    if (timeFilter == nullptr) {
+        return;
+    }
+    const uint16_t pcrPid = mPcrPid;
+    for (const auto& [pid, packet] : packets) {
+        // The PCR is the first field of an adaptation field with the PCR flag.
+        if ((pcrPid != INVALID_TPID && pid != pcrPid) || !(packet[3] & 0x20) ||
+            static_cast<uint8_t>(packet[4]) < 7 || !(packet[5] & 0x10)) {
+            continue;
+        }
+        const uint8_t* pcr = reinterpret_cast<const uint8_t*>(packet) + 6;
+        const int64_t pcrBase = (static_cast<int64_t>(pcr[0]) << 25) | (pcr[1] << 17) |
+                                (pcr[2] << 9) | (pcr[3] << 1) | (pcr[4] >> 7);
+        // The discontinuity indicator is the first flag of the adaptation field.
+        timeFilter->onPcr(pcrBase, (packet[5] & 0x80) != 0);
+    }
+}
+
 binder_status_t Demux::dump(int fd, const char** args, uint32_t numArgs) {
     dprintf(fd, " Demux %d:\n", mDemuxId);
     dprintf(fd, "  mIsRecording %d\n", mIsRecording);
@@ -438,6 +632,12 @@ binder_status_t Demux::dump(int fd, const char** args, uint32_t numArgs) {
             mDvrRecord->dump(fd, args, numArgs);
         }
     }
+    {
+        dprintf(fd, "  Descramblers:\n");
+        for (const auto& descrambler : getDescramblers()) {
+            descrambler->dump(fd, args, numArgs);
+        }
+    }
     return STATUS_OK;
 }
 
@@ -449,6 +649,7 @@ bool Demux::attachRecordFilter(int64_t filterId) {
 
     mRecordFilterIds.insert(filterId);
     mFilters[filterId]->attachFilterToRecord(mDvrRecord);
+    updateDispatchFilters();
 
     return true;
 }
@@ -460,6 +661,7 @@ bool Demux::detachRecordFilter(int64_t filterId) {
 
     mRecordFilterIds.erase(filterId);
     mFilters[filterId]->detachFilterFromRecord();
+    updateDispatchFilters();
 
     return true;
 }
@@ -20,6 +20,7 @@
 
 #include <fmq/AidlMessageQueue.h>
 #include <math.h>
+#include <array>
 #include <atomic>
 #include <set>
 #include <thread>
@@ -45,6 +46,7 @@ using ::android::hardware::EventFlag;
 
 using FilterMQ = AidlMessageQueue<int8_t, SynchronizedReadWrite>;
 
+class Descrambler;
 class Dvr;
 class Filter;
 class Frontend;
@@ -79,25 +81,54 @@ class Demux : public BnDemux {
     bool attachRecordFilter(int64_t filterId);
     bool detachRecordFilter(int64_t filterId);
     ::ndk::ScopedAStatus startFilterHandler(int64_t filterId);
-    void updateFilterOutput(int64_t filterId, vector<int8_t> data);
-    void updateMediaFilterOutput(int64_t filterId, vector<int8_t> data, uint64_t pts);
+    void updateFilterOutput(int64_t filterId, const int8_t* data, size_t size);
+    void updateFilterOutput(int64_t filterId, const vector<const int8_t*>& packets,
+                            size_t packetSize);
+    void updateMediaFilterOutput(int64_t filterId, const vector<int8_t>& data, uint64_t pts);
     uint16_t getFilterTpid(int64_t filterId);
     void setIsRecording(bool isRecording);
     bool isRecording();
     void startFrontendInputLoop();
 
+    /**
+     * Descramblers with this demux as their source. They descramble each burst of TS packets in
+     * place before it is dispatched to the filters.
+     */
+    void attachDescrambler(const std::shared_ptr<Descrambler>& descrambler);
+    void detachDescrambler(const Descrambler* descrambler);
+    void descramblePackets(const vector<pair<uint16_t, int8_t*>>& packets, size_t packetSize);
+    vector<std::shared_ptr<Descrambler>> getDescramblers();
+    /**
+     * Feeds the PCRs of a burst of TS packets to the time filter. They are taken from the TPID of
+     * the PCR filter used for AV sync, or from any PID without a PCR filter.
+     */
+    void updateTimeFilter(const vector<pair<uint16_t, int8_t*>>& packets);
+
     /**
      * A dispatcher to read and dispatch input data to all the started filters.
      * Each filter handler handles the data filtering/output writing/filterEvent updating.
      * Note that recording filters are not included.
      */
     bool startBroadcastFilterDispatcher();
-    void startBroadcastTsFilter(vector<int8_t> data);
+    /**
+     * Dispatches a group of TS packets sharing the same PID to the playback filters with the
+     * matching TPID. The packets are only read during this call, so they could point into the
+     * DVR playback FMQ.
+     */
+    void startBroadcastTsFilter(uint16_t pid, const vector<const int8_t*>& packets,
+                                size_t packetSize);
 
-    void sendFrontendInputToRecord(vector<int8_t> data);
-    void sendFrontendInputToRecord(vector<int8_t> data, uint16_t pid, uint64_t pts);
+    void sendFrontendInputToRecord(const int8_t* data, size_t size);
+    void sendFrontendInputToRecord(const vector<const int8_t*>& packets, size_t packetSize);
+    void sendFrontendInputToRecord(const vector<int8_t>& data, uint16_t pid, uint64_t pts);
     bool startRecordFilterDispatcher();
 
+    /**
+     * Rebuilds the TPID lookup table for playback filters and the record filter sets. Must be
+     * called whenever a filter is added, removed, attached, detached or its TPID changes.
+     */
+    void updateDispatchFilters();
+
   private:
     // Tuner service
     std::shared_ptr<Tuner> mTuner;
@@ -149,7 +180,35 @@ class Demux : public BnDemux {
     std::map<int64_t, std::shared_ptr<Filter>> mFilters;
 
     /**
-     * Local reference to the opened Timer Filter instance.
+     * Filters used on the packet dispatching path, so that each packet only needs one lookup
+     * instead of going through all the filter ids. Guarded by mDispatchLock.
+     */
+    std::mutex mDispatchLock;
+    std::array<vector<std::shared_ptr<Filter>>, TS_PID_COUNT> mPlaybackFiltersByPid;
+    // The TPIDs which have filters in mPlaybackFiltersByPid.
+    vector<uint16_t> mUsedPids;
+    /**
+     * The attached record filters, grouped by the DVR they record into, with their TPIDs. The
+     * record output is written once per DVR.
+     */
+    struct RecordSet {
+        std::shared_ptr<Dvr> dvr;
+        vector<std::shared_ptr<Filter>> filters;
+        vector<uint16_t> tpids;
+        // The DemuxTsIndex flags of each filter in the current burst.
+        vector<uint32_t> tsIndexMasks;
+    };
+    vector<RecordSet> mRecordSets;
+    // The TPID of the lowest PCR filter, INVALID_TPID without one.
+    std::atomic<uint16_t> mPcrPid{INVALID_TPID};
+
+    // Not owned, so that a descrambler dropped without close() is still destroyed and detached.
+    std::mutex mDescramblersLock;
+    vector<std::weak_ptr<Descrambler>> mDescramblers;
+
+    /**
+     * Local reference to the opened Timer Filter instance. Accessed atomically, as the demux
+     * thread feeds it the PCRs.
      */
     std::shared_ptr<TimeFilter> mTimeFilter;
 
@@ -177,11 +236,6 @@ class Demux : public BnDemux {
      */
     std::mutex mWriteLock;
 
-    // temp handle single PES filter
-    // TODO handle mulptiple Pes filters
-    int mPesSizeLeft = 0;
-    vector<uint8_t> mPesOutput;
-
     const bool DEBUG_DEMUX = false;
 };
 
@@ -21,7 +21,9 @@
 #include <aidl/android/hardware/tv/tuner/Result.h>
 #include <utils/Log.h>
 
+#include "Demux.h"
 #include "Descrambler.h"
+#include "Tuner.h"
 
 namespace aidl {
 namespace android {
@@ -29,9 +31,27 @@ namespace hardware {
 namespace tv {
 namespace tuner {
 
-Descrambler::Descrambler() {}
+// The key size of AES and CSA3.
+static const size_t kKeySize = 16;
+
+class XorDescramblerCipher : public DescramblerCipher {
+  public:
+    void descramble(const vector<uint8_t>& key,
+                    const vector<pair<int8_t*, size_t>>& payloads) override {
+        for (const auto& [payload, size] : payloads) {
+            for (size_t i = 0; i < size; i++) {
+                payload[i] ^= key[i % key.size()];
+            }
+        }
+    }
+};
+
+Descrambler::Descrambler(std::shared_ptr<Tuner> tuner)
+    : mTuner(tuner), mCipher(std::make_shared<XorDescramblerCipher>()) {}
 
-Descrambler::~Descrambler() {}
+Descrambler::~Descrambler() {
+    detachFromDemux();
+}
 
 ::ndk::ScopedAStatus Descrambler::setDemuxSource(int32_t in_demuxId) {
     ALOGV("%s", __FUNCTION__);
@@ -41,41 +61,166 @@ Descrambler::~Descrambler() {}
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::INVALID_STATE));
     }
+    std::shared_ptr<Demux> demux = mTuner->getDemux(in_demuxId);
+    if (demux == nullptr) {
+        ALOGW("[   WARN   ] Demux %" PRIu32 " is not opened", in_demuxId);
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::INVALID_ARGUMENT));
+    }
     mDemuxSet = true;
     mSourceDemuxId = in_demuxId;
+    mDemux = demux;
+    demux->attachDescrambler(this->ref<Descrambler>());
 
     return ::ndk::ScopedAStatus::ok();
 }
 
-::ndk::ScopedAStatus Descrambler::setKeyToken(const std::vector<uint8_t>& /* in_keyToken */) {
+::ndk::ScopedAStatus Descrambler::setKeyToken(const std::vector<uint8_t>& in_keyToken) {
     ALOGV("%s", __FUNCTION__);
 
+    std::lock_guard<std::mutex> lock(mLock);
+    if (in_keyToken.size() == 2 * kKeySize) {
+        mKeys[0].assign(in_keyToken.begin(), in_keyToken.begin() + kKeySize);
+        mKeys[1].assign(in_keyToken.begin() + kKeySize, in_keyToken.end());
+    } else {
+        mKeys[0] = in_keyToken;
+        mKeys[1] = in_keyToken;
+    }
+
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Descrambler::addPid(
-        const DemuxPid& /* in_pid */,
-        const std::shared_ptr<IFilter>& /* in_optionalSourceFilter */) {
+        const DemuxPid& in_pid, const std::shared_ptr<IFilter>& /* in_optionalSourceFilter */) {
     ALOGV("%s", __FUNCTION__);
+    if (in_pid.getTag() != DemuxPid::Tag::tPid ||
+        static_cast<uint32_t>(in_pid.get<DemuxPid::Tag::tPid>()) >= TS_PID_COUNT) {
+        ALOGW("[   WARN   ] Only TS PIDs can be descrambled");
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::INVALID_ARGUMENT));
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mPids.emplace(in_pid.get<DemuxPid::Tag::tPid>(), PidState());
 
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Descrambler::removePid(
-        const DemuxPid& /* in_pid */,
-        const std::shared_ptr<IFilter>& /* in_optionalSourceFilter */) {
+        const DemuxPid& in_pid, const std::shared_ptr<IFilter>& /* in_optionalSourceFilter */) {
     ALOGV("%s", __FUNCTION__);
+    if (in_pid.getTag() != DemuxPid::Tag::tPid) {
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::INVALID_ARGUMENT));
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mPids.erase(in_pid.get<DemuxPid::Tag::tPid>());
 
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Descrambler::close() {
     ALOGV("%s", __FUNCTION__);
+    detachFromDemux();
     mDemuxSet = false;
 
+    std::lock_guard<std::mutex> lock(mLock);
+    mPids.clear();
+    mKeys[0].clear();
+    mKeys[1].clear();
+
     return ::ndk::ScopedAStatus::ok();
 }
 
+binder_status_t Descrambler::dump(int fd, const char** /* args */, uint32_t /* numArgs */) {
+    std::lock_guard<std::mutex> lock(mLock);
+    dprintf(fd, "   Descrambler of demux %d:\n", mDemuxSet ? mSourceDemuxId : -1);
+    for (const auto& [pid, state] : mPids) {
+        const int64_t ns = state.cipherTime.count();
+        dprintf(fd,
+                "    pid %u: packets %" PRIu64 " bytes %" PRIu64 " unkeyed %" PRIu64
+                " cipher %" PRId64 "ns (%" PRIu64 " bytes/ms)\n",
+                pid, state.packets, state.bytes, state.unkeyedPackets, ns,
+                ns > 0 ? state.bytes * 1000000 / static_cast<uint64_t>(ns) : 0);
+    }
+    return STATUS_OK;
+}
+
+void Descrambler::setCipher(std::shared_ptr<DescramblerCipher> cipher) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mCipher = cipher;
+}
+
+void Descrambler::descramblePackets(const vector<pair<uint16_t, int8_t*>>& packets,
+                                    size_t packetSize) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mPids.empty() || mCipher == nullptr || packetSize < TS_PACKET_SIZE) {
+        return;
+    }
+
+    // Collect the payloads of the burst by PID and key, so the cipher takes them in batches.
+    mPendingPids.clear();
+    for (const auto& [pid, packet] : packets) {
+        const uint8_t flags = packet[3];
+        const uint8_t scramblingControl = flags >> 6;
+        // 0b00 is clear, 0b01 reserved, 0b10 and 0b11 scrambled with the even and odd key.
+        if (scramblingControl < 2) {
+            continue;
+        }
+        auto it = mPids.find(pid);
+        if (it == mPids.end()) {
+            continue;
+        }
+        PidState& state = it->second;
+        const vector<uint8_t>& key = mKeys[scramblingControl & 1];
+        if (key.empty()) {
+            state.unkeyedPackets++;
+            continue;
+        }
+
+        // Only the payload is scrambled, not the adaptation field.
+        size_t offset = 4;
+        if (flags & 0x20) {
+            offset += 1 + static_cast<uint8_t>(packet[4]);
+        }
+        if (!(flags & 0x10) || offset >= TS_PACKET_SIZE) {
+            continue;
+        }
+        if (state.payloads[0].empty() && state.payloads[1].empty()) {
+            mPendingPids.push_back(&state);
+        }
+        state.payloads[scramblingControl & 1].push_back({packet + offset, TS_PACKET_SIZE - offset});
+        // The packet is handed on as clear.
+        packet[3] = flags & 0x3f;
+    }
+
+    for (PidState* state : mPendingPids) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t parity = 0; parity < 2; parity++) {
+            if (!state->payloads[parity].empty()) {
+                mCipher->descramble(mKeys[parity], state->payloads[parity]);
+            }
+        }
+        state->cipherTime += std::chrono::steady_clock::now() - start;
+        for (auto& payloads : state->payloads) {
+            state->packets += payloads.size();
+            for (const auto& payload : payloads) {
+                state->bytes += payload.second;
+            }
+            payloads.clear();
+        }
+    }
+}
+
+void Descrambler::detachFromDemux() {
+    std::shared_ptr<Demux> demux = mDemux.lock();
+    if (demux != nullptr) {
+        demux->detachDescrambler(this);
+    }
+    mDemux.reset();
+}
+
 }  // namespace tuner
 }  // namespace tv
 }  // namespace hardware
@@ -19,6 +19,11 @@
 #include <aidl/android/hardware/tv/tuner/BnDescrambler.h>
 #include <aidl/android/hardware/tv/tuner/ITuner.h>
 #include <inttypes.h>
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <vector>
 
 using namespace std;
 
@@ -28,9 +33,27 @@ namespace hardware {
 namespace tv {
 namespace tuner {
 
+class Demux;
+class Tuner;
+
+/**
+ * Cipher of the scrambled TS packet payloads. The default one XORs the payloads with the key, as a
+ * stand-in for the CA cipher of a real implementation.
+ */
+class DescramblerCipher {
+  public:
+    virtual ~DescramblerCipher() = default;
+
+    /**
+     * Descrambles a batch of payloads scrambled with the same key, in place.
+     */
+    virtual void descramble(const vector<uint8_t>& key,
+                            const vector<pair<int8_t*, size_t>>& payloads) = 0;
+};
+
 class Descrambler : public BnDescrambler {
   public:
-    Descrambler();
+    Descrambler(std::shared_ptr<Tuner> tuner);
 
     ::ndk::ScopedAStatus setDemuxSource(int32_t in_demuxId) override;
     ::ndk::ScopedAStatus setKeyToken(const std::vector<uint8_t>& in_keyToken) override;
@@ -41,10 +64,50 @@ class Descrambler : public BnDescrambler {
             const std::shared_ptr<IFilter>& in_optionalSourceFilter) override;
     ::ndk::ScopedAStatus close() override;
 
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+    /**
+     * Replaces the cipher backend, the XOR one by default, e.g. to benchmark a real CA cipher.
+     */
+    void setCipher(std::shared_ptr<DescramblerCipher> cipher);
+
+    /**
+     * Descrambles the scrambled packets of the added PIDs in place and marks them as clear. Called
+     * by the source demux with each burst of TS packets, before they are dispatched.
+     */
+    void descramblePackets(const vector<pair<uint16_t, int8_t*>>& packets, size_t packetSize);
+
   private:
+    // Throughput counters of a PID, and its payloads pending in the current burst.
+    struct PidState {
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        // Scrambled packets left as they are, for the lack of a key.
+        uint64_t unkeyedPackets = 0;
+        std::chrono::nanoseconds cipherTime{0};
+        // Indexed by the odd key bit of the scrambling control, like mKeys.
+        std::array<vector<pair<int8_t*, size_t>>, 2> payloads;
+    };
+
     virtual ~Descrambler();
+    void detachFromDemux();
+
+    std::shared_ptr<Tuner> mTuner;
     int32_t mSourceDemuxId;
     bool mDemuxSet = false;
+    std::weak_ptr<Demux> mDemux;
+
+    // Guards the members below, which the demux uses while descrambling.
+    std::mutex mLock;
+    std::shared_ptr<DescramblerCipher> mCipher;
+    /**
+     * The even and odd keys. A key token of two keys of kKeySize holds the even then the odd key,
+     * any other token is the key of both.
+     */
+    std::array<vector<uint8_t>, 2> mKeys;
+    std::map<uint16_t, PidState> mPids;
+    // The PIDs with payloads in the current burst.
+    vector<PidState*> mPendingPids;
 };
 
 }  // namespace tuner
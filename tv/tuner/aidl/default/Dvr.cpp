@@ -21,6 +21,7 @@
 #include <aidl/android/hardware/tv/tuner/Result.h>
 
 #include <utils/Log.h>
+#include <algorithm>
 #include "Dvr.h"
 
 namespace aidl {
@@ -215,8 +216,18 @@ void Dvr::playbackThreadLoop() {
         // Our current implementation filter the data and write it into the filter FMQ immediately
         // after the DATA_READY from the VTS/framework
         // This is for the non-ES data source, real playback use case handling.
-        if (!readPlaybackFMQ(isVirtualFrontend, isRecording) ||
-            !startFilterDispatcher(isVirtualFrontend, isRecording)) {
+        // The data is handled in bursts of packets, so the filter outputs are flushed regularly
+        // even when the FMQ holds a lot of data.
+        bool filtered = true;
+        int64_t playbackPacketSize = mDvrSettings.get<DvrSettings::Tag::playback>().packetSize;
+        do {
+            if (!readPlaybackFMQ(isVirtualFrontend, isRecording) ||
+                !startFilterDispatcher(isVirtualFrontend, isRecording)) {
+                filtered = false;
+                break;
+            }
+        } while (mDvrThreadRunning && mDvrMQ->availableToRead() >= playbackPacketSize);
+        if (!filtered) {
             ALOGE("[Dvr] playback data failed to be filtered. Ending thread");
             break;
         }
@@ -258,28 +269,82 @@ PlaybackStatus Dvr::checkPlaybackStatusChange(uint32_t availableToWrite, uint32_
 }
 
 bool Dvr::readPlaybackFMQ(bool isVirtualFrontend, bool isRecording) {
-    // Read playback data from the input FMQ
+    // Read a burst of playback data from the input FMQ
     size_t size = mDvrMQ->availableToRead();
     int64_t playbackPacketSize = mDvrSettings.get<DvrSettings::Tag::playback>().packetSize;
-    vector<int8_t> dataOutputBuffer;
-    dataOutputBuffer.resize(playbackPacketSize);
-    // Dispatch the packet to the PID matching filter output buffer
-    for (int i = 0; i < size / playbackPacketSize; i++) {
-        if (!mDvrMQ->read(dataOutputBuffer.data(), playbackPacketSize)) {
-            return false;
+    size_t packetCount = std::min(size / playbackPacketSize, MAX_PLAYBACK_BURST_PACKETS);
+    if (packetCount == 0) {
+        return true;
+    }
+    size_t readSize = packetCount * playbackPacketSize;
+    // The packets are dispatched in place from the FMQ regions. Only a packet wrapping around the
+    // end of the FMQ is copied.
+    DvrMQ::MemTransaction tx;
+    if (!mDvrMQ->beginRead(readSize, &tx)) {
+        return false;
+    }
+    const DvrMQ::MemRegion& first = tx.getFirstRegion();
+    const DvrMQ::MemRegion& second = tx.getSecondRegion();
+    int8_t* firstData = first.getAddress();
+    size_t firstSize = first.getLength();
+    int8_t* secondData = second.getAddress();
+
+    mBurstPackets.clear();
+    size_t offset = 0;
+    for (size_t i = 0; i < packetCount; i++, offset += playbackPacketSize) {
+        int8_t* packet;
+        if (offset + playbackPacketSize <= firstSize) {
+            packet = firstData + offset;
+        } else if (offset >= firstSize) {
+            packet = secondData + (offset - firstSize);
+        } else {
+            size_t head = firstSize - offset;
+            mStraddlePacket.resize(playbackPacketSize);
+            memcpy(mStraddlePacket.data(), firstData + offset, head);
+            memcpy(mStraddlePacket.data() + head, secondData, playbackPacketSize - head);
+            packet = mStraddlePacket.data();
         }
-        if (isVirtualFrontend) {
-            if (isRecording) {
-                mDemux->sendFrontendInputToRecord(dataOutputBuffer);
-            } else {
-                mDemux->startBroadcastTsFilter(dataOutputBuffer);
+        if (packet[0] != TS_SYNC_BYTE) {
+            if (DEBUG_DVR) {
+                ALOGW("[Dvr] drop playback packet without sync byte at %zu", offset);
             }
+            continue;
+        }
+        uint16_t pid = ((packet[1] & 0x1f) << 8) | ((packet[2] & 0xff));
+        mBurstPackets.push_back({pid, packet});
+    }
+    // Scrambled packets are descrambled in place, before any filter sees them.
+    mDemux->descramblePackets(mBurstPackets, playbackPacketSize);
+    mDemux->updateTimeFilter(mBurstPackets);
+
+    if (isVirtualFrontend && isRecording) {
+        // Record filters take the stream as is, so keep the packet order across PIDs.
+        mPidPackets.clear();
+        for (const auto& [pid, packet] : mBurstPackets) {
+            mPidPackets.push_back(packet);
+        }
+        mDemux->sendFrontendInputToRecord(mPidPackets, playbackPacketSize);
+        return mDvrMQ->commitRead(readSize);
+    }
+
+    // Group the packets by PID, so each PID matching filter takes the whole group at once. The
+    // relative order of the packets within a PID is kept.
+    std::stable_sort(mBurstPackets.begin(), mBurstPackets.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 0; i < mBurstPackets.size();) {
+        uint16_t pid = mBurstPackets[i].first;
+        mPidPackets.clear();
+        for (; i < mBurstPackets.size() && mBurstPackets[i].first == pid; i++) {
+            mPidPackets.push_back(mBurstPackets[i].second);
+        }
+        if (isVirtualFrontend) {
+            mDemux->startBroadcastTsFilter(pid, mPidPackets, playbackPacketSize);
         } else {
-            startTpidFilter(dataOutputBuffer);
+            startTpidFilter(pid, mPidPackets, playbackPacketSize);
         }
     }
 
-    return true;
+    return mDvrMQ->commitRead(readSize);
 }
 
 bool Dvr::processEsDataOnPlayback(bool isVirtualFrontend, bool isRecording) {
@@ -402,15 +467,15 @@ void Dvr::getMetaDataValue(int& index, int8_t* dataOutputBuffer, int& value) {
     }
 }
 
-void Dvr::startTpidFilter(vector<int8_t> data) {
+void Dvr::startTpidFilter(uint16_t pid, const vector<const int8_t*>& packets,
+                          size_t packetSize) {
+    if (DEBUG_DVR) {
+        ALOGW("[Dvr] start ts filter pid: %d, packets: %zu", pid, packets.size());
+    }
     map<int64_t, std::shared_ptr<IFilter>>::iterator it;
     for (it = mFilters.begin(); it != mFilters.end(); it++) {
-        uint16_t pid = ((data[1] & 0x1f) << 8) | ((data[2] & 0xff));
-        if (DEBUG_DVR) {
-            ALOGW("[Dvr] start ts filter pid: %d", pid);
-        }
         if (pid == mDemux->getFilterTpid(it->first)) {
-            mDemux->updateFilterOutput(it->first, data);
+            mDemux->updateFilterOutput(it->first, packets, packetSize);
         }
     }
 }
@@ -435,13 +500,13 @@ bool Dvr::startFilterDispatcher(bool isVirtualFrontend, bool isRecording) {
     return true;
 }
 
-bool Dvr::writeRecordFMQ(const vector<int8_t>& data) {
+bool Dvr::writeRecordFMQ(const int8_t* data, size_t size) {
     lock_guard<mutex> lock(mWriteLock);
     if (mRecordStatus == RecordStatus::OVERFLOW) {
         ALOGW("[Dvr] stops writing and wait for the client side flushing.");
         return true;
     }
-    if (mDvrMQ->write(data.data(), data.size())) {
+    if (mDvrMQ->write(data, size)) {
         mDvrEventFlag->wake(static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_READY));
         maySendRecordStatusCallback();
         return true;
@@ -451,6 +516,35 @@ bool Dvr::writeRecordFMQ(const vector<int8_t>& data) {
     return false;
 }
 
+bool Dvr::writeRecordFMQ(const vector<const int8_t*>& packets, size_t packetSize) {
+    lock_guard<mutex> lock(mWriteLock);
+    if (mRecordStatus == RecordStatus::OVERFLOW) {
+        ALOGW("[Dvr] stops writing and wait for the client side flushing.");
+        return true;
+    }
+    const size_t size = packets.size() * packetSize;
+    if (size == 0) {
+        return true;
+    }
+
+    // Gather the packets into the FMQ regions; copyTo splits a packet wrapping around the end.
+    DvrMQ::MemTransaction tx;
+    if (!mDvrMQ->beginWrite(size, &tx)) {
+        maySendRecordStatusCallback();
+        return false;
+    }
+    for (size_t i = 0; i < packets.size(); i++) {
+        tx.copyTo(packets[i], i * packetSize, packetSize);
+    }
+    if (!mDvrMQ->commitWrite(size)) {
+        maySendRecordStatusCallback();
+        return false;
+    }
+    mDvrEventFlag->wake(static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_READY));
+    maySendRecordStatusCallback();
+    return true;
+}
+
 void Dvr::maySendRecordStatusCallback() {
     lock_guard<mutex> lock(mRecordStatusLock);
     int availableToRead = mDvrMQ->availableToRead();
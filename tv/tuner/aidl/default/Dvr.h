@@ -42,6 +42,8 @@ using ::android::AidlMessageQueue;
 using ::android::hardware::EventFlag;
 
 using DvrMQ = AidlMessageQueue<int8_t, SynchronizedReadWrite>;
+// The max number of packets read from the playback FMQ before dispatching the filter outputs.
+const size_t MAX_PLAYBACK_BURST_PACKETS = 512;
 
 struct MediaEsMetaData {
     bool isAudio;
@@ -79,7 +81,12 @@ class Dvr : public BnDvr {
      * Return false is any of the above processes fails.
      */
     bool createDvrMQ();
-    bool writeRecordFMQ(const std::vector<int8_t>& data);
+    /**
+     * Writes to the record FMQ. The packets are copied straight into the FMQ regions, so a burst
+     * takes a single copy no matter how many record filters share the DVR.
+     */
+    bool writeRecordFMQ(const int8_t* data, size_t size);
+    bool writeRecordFMQ(const vector<const int8_t*>& packets, size_t packetSize);
     bool addPlaybackFilter(int64_t filterId, std::shared_ptr<IFilter> filter);
     bool removePlaybackFilter(int64_t filterId);
     bool readPlaybackFMQ(bool isVirtualFrontend, bool isRecording);
@@ -110,11 +117,18 @@ class Dvr : public BnDvr {
      * A dispatcher to read and dispatch input data to all the started filters.
      * Each filter handler handles the data filtering/output writing/filterEvent updating.
      */
-    void startTpidFilter(vector<int8_t> data);
+    void startTpidFilter(uint16_t pid, const vector<const int8_t*>& packets, size_t packetSize);
     void playbackThreadLoop();
 
     unique_ptr<DvrMQ> mDvrMQ;
     EventFlag* mDvrEventFlag;
+    /**
+     * Buffers reused by each playback burst: the valid packets with their PIDs, the packets of
+     * one PID, and a copy of the packet wrapping around the end of the FMQ.
+     */
+    vector<pair<uint16_t, int8_t*>> mBurstPackets;
+    vector<const int8_t*> mPidPackets;
+    vector<int8_t> mStraddlePacket;
     /**
      * Demux callbacks used on filter events or IO buffer status
      */
@@ -20,8 +20,10 @@
 #include <BufferAllocator/BufferAllocator.h>
 #include <aidl/android/hardware/tv/tuner/DemuxFilterMonitorEventType.h>
 #include <aidl/android/hardware/tv/tuner/DemuxQueueNotifyBits.h>
+#include <aidl/android/hardware/tv/tuner/DemuxTsIndex.h>
 #include <aidl/android/hardware/tv/tuner/Result.h>
 #include <aidlcommonsupport/NativeHandle.h>
+#include <android-base/properties.h>
 #include <inttypes.h>
 #include <utils/Log.h>
 
@@ -49,9 +51,11 @@ FilterCallbackScheduler::~FilterCallbackScheduler() {
 }
 
 void FilterCallbackScheduler::onFilterEvent(DemuxFilterEvent&& event) {
+    int64_t nowInNs = getNowInNs();
     std::unique_lock<std::mutex> lock(mLock);
-    mCallbackBuffer.push_back(std::move(event));
     mDataLength += getDemuxFilterEventDataLength(event);
+    mCallbackBuffer.push_back(std::move(event));
+    mEventTimesInNs.push_back(nowInNs);
 
     if (isDataSizeDelayConditionMetLocked()) {
         mIsConditionMet = true;
@@ -70,6 +74,7 @@ void FilterCallbackScheduler::onFilterStatus(const DemuxFilterStatus& status) {
 void FilterCallbackScheduler::flushEvents() {
     std::unique_lock<std::mutex> lock(mLock);
     mCallbackBuffer.clear();
+    mEventTimesInNs.clear();
     mDataLength = 0;
 }
 
@@ -92,10 +97,47 @@ void FilterCallbackScheduler::setDataSizeDelayHint(int dataSizeDelay) {
     }
 }
 
+void FilterCallbackScheduler::setTargetCallbackRate(int targetCallbackRate) {
+    std::unique_lock<std::mutex> lock(mLock);
+    mTargetCallbackRate = max(targetCallbackRate, 0);
+    mDataRate = 0;
+    mLastFlushTimeInNs = getNowInNs();
+    // always notify condition variable to update timeout
+    mIsConditionMet = true;
+    lock.unlock();
+    mCv.notify_all();
+}
+
 bool FilterCallbackScheduler::hasCallbackRegistered() const {
     return mCallback != nullptr;
 }
 
+void FilterCallbackScheduler::dump(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        dprintf(fd, "      Callback scheduler: timeDelay=%dms, dataSizeDelay=%dB, adaptive=%d",
+                getTimeDelayInMsLocked(), getDataSizeDelayInBytesLocked(), isAdaptiveLocked());
+        dprintf(fd, ", dataRate=%.1fB/ms, pending events=%zu\n", mDataRate,
+                mCallbackBuffer.size());
+    }
+    std::lock_guard<std::mutex> lock(mStatsLock);
+    dprintf(fd, "      Callbacks: %" PRIu64 ", events: %" PRIu64 "\n", mCallbackCount,
+            mSentEventCount);
+    dprintf(fd, "      Event to callback latency in ms:");
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        dprintf(fd, " [%d,%s)=%" PRIu64, i == 0 ? 0 : 1 << (i - 1),
+                i == LATENCY_BUCKET_COUNT - 1 ? "inf" : std::to_string(1 << i).c_str(),
+                mLatencyInMsHistogram[i]);
+    }
+    dprintf(fd, "\n      Events per callback:");
+    for (size_t i = 0; i < EVENTS_PER_CALLBACK_BUCKET_COUNT; i++) {
+        dprintf(fd, " [%d,%s)=%" PRIu64, i == 0 ? 0 : 1 << (i - 1),
+                i == EVENTS_PER_CALLBACK_BUCKET_COUNT - 1 ? "inf" : std::to_string(1 << i).c_str(),
+                mEventsPerCallbackHistogram[i]);
+    }
+    dprintf(fd, "\n");
+}
+
 void FilterCallbackScheduler::start() {
     mIsRunning = true;
     mCallbackThread = std::thread(&FilterCallbackScheduler::threadLoop, this);
@@ -121,9 +163,10 @@ void FilterCallbackScheduler::threadLoop() {
 
 void FilterCallbackScheduler::threadLoopOnce() {
     std::unique_lock<std::mutex> lock(mLock);
-    if (mTimeDelayInMs > 0) {
+    int timeDelayInMs = getTimeDelayInMsLocked();
+    if (timeDelayInMs > 0) {
         // Note: predicate protects from lost and spurious wakeups
-        mCv.wait_for(lock, std::chrono::milliseconds(mTimeDelayInMs),
+        mCv.wait_for(lock, std::chrono::milliseconds(timeDelayInMs),
                      [this] { return mIsConditionMet; });
     } else {
         // Note: predicate protects from lost and spurious wakeups
@@ -134,18 +177,95 @@ void FilterCallbackScheduler::threadLoopOnce() {
     // condition_variable wait locks mutex on timeout / notify
     // Note: if stop() has been called in the meantime, do not send more filter
     // events.
-    if (mIsRunning && !mCallbackBuffer.empty()) {
-        if (mCallback) {
-            mCallback->onFilterEvent(mCallbackBuffer);
-        }
-        mCallbackBuffer.clear();
-        mDataLength = 0;
+    if (!mIsRunning || mCallbackBuffer.empty()) {
+        return;
+    }
+    updateDataRateLocked(mDataLength);
+    // Take the pending events out without copying them, so the filter thread is not blocked
+    // while the callback is running.
+    mSendingBuffer.swap(mCallbackBuffer);
+    mSendingEventTimesInNs.swap(mEventTimesInNs);
+    mDataLength = 0;
+    lock.unlock();
+
+    if (mCallback) {
+        mCallback->onFilterEvent(mSendingBuffer);
     }
+    recordCallbackStats(mSendingEventTimesInNs, getNowInNs());
+    mSendingBuffer.clear();
+    mSendingEventTimesInNs.clear();
+}
+
+// mLock needs to be held to call this function
+bool FilterCallbackScheduler::isAdaptiveLocked() {
+    // Delay hints from the client always take precedence.
+    return mTargetCallbackRate > 0 && mTimeDelayInMs == 0 && mDataSizeDelayInBytes == 0;
+}
+
+// mLock needs to be held to call this function
+int FilterCallbackScheduler::getTimeDelayInMsLocked() {
+    if (isAdaptiveLocked()) {
+        // Never wait longer than one callback interval of the target rate.
+        return max(1000 / mTargetCallbackRate, 1);
+    }
+    return mTimeDelayInMs;
+}
+
+// mLock needs to be held to call this function
+int FilterCallbackScheduler::getDataSizeDelayInBytesLocked() {
+    if (isAdaptiveLocked()) {
+        // Flush once about the data of one callback interval is collected.
+        return max(static_cast<int>(mDataRate * getTimeDelayInMsLocked()), 1);
+    }
+    return mDataSizeDelayInBytes;
+}
+
+// mLock needs to be held to call this function
+void FilterCallbackScheduler::updateDataRateLocked(int dataLength) {
+    int64_t nowInNs = getNowInNs();
+    int64_t elapsedInMs = (nowInNs - mLastFlushTimeInNs) / 1000000;
+    mLastFlushTimeInNs = nowInNs;
+    if (elapsedInMs <= 0) {
+        elapsedInMs = 1;
+    }
+    double dataRate = static_cast<double>(dataLength) / elapsedInMs;
+    mDataRate = mDataRate == 0 ? dataRate
+                               : mDataRate * (1 - DATA_RATE_SMOOTHING) +
+                                         dataRate * DATA_RATE_SMOOTHING;
+}
+
+void FilterCallbackScheduler::recordCallbackStats(const std::vector<int64_t>& eventTimesInNs,
+                                                  int64_t callbackTimeInNs) {
+    std::lock_guard<std::mutex> lock(mStatsLock);
+    mCallbackCount++;
+    mSentEventCount += eventTimesInNs.size();
+    mEventsPerCallbackHistogram[getHistogramBucket(eventTimesInNs.size(),
+                                                   EVENTS_PER_CALLBACK_BUCKET_COUNT)]++;
+    for (int64_t eventTimeInNs : eventTimesInNs) {
+        uint64_t latencyInMs = (callbackTimeInNs - eventTimeInNs) / 1000000;
+        mLatencyInMsHistogram[getHistogramBucket(latencyInMs, LATENCY_BUCKET_COUNT)]++;
+    }
+}
+
+int64_t FilterCallbackScheduler::getNowInNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+size_t FilterCallbackScheduler::getHistogramBucket(uint64_t value, size_t bucketCount) {
+    size_t bucket = 0;
+    while (value > 0 && bucket < bucketCount - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
 }
 
 // mLock needs to be held to call this function
 bool FilterCallbackScheduler::isDataSizeDelayConditionMetLocked() {
-    if (mDataSizeDelayInBytes == 0) {
+    int dataSizeDelayInBytes = getDataSizeDelayInBytesLocked();
+    if (dataSizeDelayInBytes == 0) {
         // Data size delay is disabled.
         if (mTimeDelayInMs == 0) {
             // Events should only be sent immediately if time delay is disabled
@@ -156,7 +276,7 @@ bool FilterCallbackScheduler::isDataSizeDelayConditionMetLocked() {
     }
 
     // Data size delay is enabled.
-    return mDataLength >= mDataSizeDelayInBytes;
+    return mDataLength >= dataSizeDelayInBytes;
 }
 
 int FilterCallbackScheduler::getDemuxFilterEventDataLength(const DemuxFilterEvent& event) {
@@ -194,6 +314,8 @@ Filter::Filter(DemuxFilterType type, int64_t filterId, uint32_t bufferSize,
       mFilterId(filterId),
       mBufferSize(bufferSize),
       mType(type) {
+    mCallbackScheduler.setTargetCallbackRate(
+            ::android::base::GetIntProperty(TARGET_CALLBACK_RATE_PROPERTY, 0));
     switch (mType.mainType) {
         case DemuxFilterMainType::TS:
             if (mType.subType.get<DemuxFilterSubType::Tag::tsFilterType>() ==
@@ -305,6 +427,21 @@ Filter::~Filter() {
     switch (mType.mainType) {
         case DemuxFilterMainType::TS:
             mTpid = in_settings.get<DemuxFilterSettings::Tag::ts>().tpid;
+            if (mIsRecordFilter) {
+                const auto& filterSettings =
+                        in_settings.get<DemuxFilterSettings::Tag::ts>().filterSettings;
+                if (filterSettings.getTag() == DemuxTsFilterSettingsFilterSettings::Tag::record) {
+                    mRecordTsIndexMask =
+                            filterSettings
+                                    .get<DemuxTsFilterSettingsFilterSettings::Tag::record>()
+                                    .tsIndexMask;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(mFilterOutputLock);
+                mTsAssemblyStates.clear();
+            }
+            mDemux->updateDispatchFilters();
             break;
         case DemuxFilterMainType::MMTP:
             break;
@@ -324,6 +461,20 @@ Filter::~Filter() {
 
 ::ndk::ScopedAStatus Filter::start() {
     ALOGV("%s", __FUNCTION__);
+    if (mIsMediaFilter && mAvSlab == nullptr) {
+        int av_fd = createAvIonFd(BUFFER_SIZE_16M);
+        if (av_fd >= 0) {
+            mAvSlab = std::make_unique<AvBufferSlab>(::android::base::unique_fd(av_fd),
+                                                     BUFFER_SIZE_16M);
+            if (!mAvSlab->isValid()) {
+                mAvSlab = nullptr;
+            }
+        }
+    }
+    if (mIsRecordFilter) {
+        std::lock_guard<std::mutex> lock(mRecordFilterOutputLock);
+        mRecordedBytes = 0;
+    }
     mFilterThreadRunning = true;
     std::vector<DemuxFilterEvent> events;
     // All the filter event callbacks in start are for testing purpose.
@@ -393,12 +544,18 @@ Filter::~Filter() {
         return ::ndk::ScopedAStatus::ok();
     }
 
-    if (mDataId2Avfd.find(in_avDataId) == mDataId2Avfd.end()) {
+    if (mAvSlab != nullptr && mAvSlab->release(in_avDataId)) {
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+    auto avFd = mDataId2Avfd.find(in_avDataId);
+    if (avFd == mDataId2Avfd.end()) {
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::INVALID_ARGUMENT));
     }
 
-    ::close(mDataId2Avfd[in_avDataId]);
+    ::close(avFd->second);
+    mDataId2Avfd.erase(avFd);
     return ::ndk::ScopedAStatus::ok();
 }
 
@@ -664,6 +821,10 @@ binder_status_t Filter::dump(int fd, const char** /* args */, uint32_t /* numArg
     dprintf(fd, "      mIsRecordFilter: %d\n", mIsRecordFilter);
     dprintf(fd, "      mIsUsingFMQ: %d\n", mIsUsingFMQ);
     dprintf(fd, "      mFilterThreadRunning: %d\n", (bool)mFilterThreadRunning);
+    if (mAvSlab != nullptr) {
+        mAvSlab->dump(fd);
+    }
+    mCallbackScheduler.dump(fd);
     return STATUS_OK;
 }
 
@@ -701,9 +862,21 @@ uint16_t Filter::getTpid() {
     return mTpid;
 }
 
-void Filter::updateFilterOutput(vector<int8_t>& data) {
+void Filter::updateFilterOutput(const int8_t* data, size_t size) {
+    std::lock_guard<std::mutex> lock(mFilterOutputLock);
+    mFilterOutput.insert(mFilterOutput.end(), data, data + size);
+}
+
+void Filter::updateFilterOutput(const vector<int8_t>& data) {
+    updateFilterOutput(data.data(), data.size());
+}
+
+void Filter::updateFilterOutput(const vector<const int8_t*>& packets, size_t packetSize) {
     std::lock_guard<std::mutex> lock(mFilterOutputLock);
-    mFilterOutput.insert(mFilterOutput.end(), data.begin(), data.end());
+    mFilterOutput.reserve(mFilterOutput.size() + packets.size() * packetSize);
+    for (const int8_t* packet : packets) {
+        mFilterOutput.insert(mFilterOutput.end(), packet, packet + packetSize);
+    }
 }
 
 void Filter::updatePts(uint64_t pts) {
@@ -711,9 +884,34 @@ void Filter::updatePts(uint64_t pts) {
     mPts = pts;
 }
 
-void Filter::updateRecordOutput(vector<int8_t>& data) {
+void Filter::onRecordOutputWritten(bool written, size_t size, uint32_t tsIndexMask) {
     std::lock_guard<std::mutex> lock(mRecordFilterOutputLock);
-    mRecordFilterOutput.insert(mRecordFilterOutput.end(), data.begin(), data.end());
+    if (!written) {
+        mRecordWriteFailed = true;
+        return;
+    }
+    if (size == 0) {
+        return;
+    }
+    if (mRecordedBytes == 0) {
+        tsIndexMask |= static_cast<uint32_t>(DemuxTsIndex::FIRST_PACKET);
+    }
+    mRecordedBytes += size;
+
+    DemuxFilterTsRecordEvent recordEvent;
+    recordEvent = {
+            .pid = DemuxPid::make<DemuxPid::Tag::tPid>(mTpid),
+            .tsIndexMask = static_cast<int32_t>(tsIndexMask & mRecordTsIndexMask),
+            .byteNumber = static_cast<int64_t>(size),
+            .pts = (mPts == 0) ? static_cast<int64_t>(time(NULL)) * 900000 : mPts,
+            .firstMbInSlice = 0,  // random address
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mFilterEventsLock);
+        mFilterEvents.push_back(
+                DemuxFilterEvent::make<DemuxFilterEvent::Tag::tsRecord>(recordEvent));
+    }
 }
 
 ::ndk::ScopedAStatus Filter::startFilterHandler() {
@@ -765,86 +963,208 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
 }
 
 ::ndk::ScopedAStatus Filter::startSectionFilterHandler() {
-    if (mFilterOutput.empty()) {
-        return ::ndk::ScopedAStatus::ok();
-    }
-    if (!writeSectionsAndCreateEvent(mFilterOutput)) {
-        ALOGD("[Filter] filter %" PRIu64 " fails to write into FMQ. Ending thread", mFilterId);
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+    size_t offset = 0;
+    for (; offset + TS_PACKET_SIZE <= mFilterOutput.size(); offset += TS_PACKET_SIZE) {
+        TsAssemblyState* state;
+        bool unitStart;
+        size_t payloadSize;
+        const int8_t* payload =
+                getTsPayload(mFilterOutput.data() + offset, &state, &unitStart, &payloadSize);
+        if (payload == nullptr) {
+            continue;
+        }
+        bool written = true;
+        if (unitStart) {
+            // The pointer field tells where the first new section starts, the bytes before it
+            // finish the previous section.
+            size_t pointer = static_cast<uint8_t>(payload[0]);
+            if (1 + pointer > payloadSize) {
+                resetTsAssemblyState(state);
+                continue;
+            }
+            written = assembleSectionData(state, payload + 1, pointer, false);
+            // A section which does not end before the new one is broken.
+            resetTsAssemblyState(state);
+            written = written && assembleSectionData(state, payload + 1 + pointer,
+                                                     payloadSize - 1 - pointer, true);
+        } else {
+            written = assembleSectionData(state, payload, payloadSize, false);
+        }
+        if (!written) {
+            ALOGD("[Filter] filter %" PRIu64 " fails to write into FMQ. Ending thread", mFilterId);
+            mFilterOutput.clear();
+            mTsAssemblyStates.clear();
+            return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                    static_cast<int32_t>(Result::UNKNOWN_ERROR));
+        }
     }
 
-    mFilterOutput.clear();
+    // Keep the trailing partial packet for the next round.
+    mFilterOutput.erase(mFilterOutput.begin(), mFilterOutput.begin() + offset);
 
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Filter::startPesFilterHandler() {
-    if (mFilterOutput.empty()) {
-        return ::ndk::ScopedAStatus::ok();
-    }
-
-    for (int i = 0; i < mFilterOutput.size(); i += 188) {
-        if (mPesSizeLeft == 0) {
-            uint32_t prefix = (mFilterOutput[i + 4] << 16) | (mFilterOutput[i + 5] << 8) |
-                              mFilterOutput[i + 6];
+    size_t offset = 0;
+    for (; offset + TS_PACKET_SIZE <= mFilterOutput.size(); offset += TS_PACKET_SIZE) {
+        TsAssemblyState* state;
+        bool unitStart;
+        size_t payloadSize;
+        const int8_t* payload =
+                getTsPayload(mFilterOutput.data() + offset, &state, &unitStart, &payloadSize);
+        if (payload == nullptr) {
+            continue;
+        }
+        if (unitStart) {
+            // A PES without the length is only finished by the start of the next one.
+            if (state->assembling && state->unbounded &&
+                !writePesAndCreateEvent(state->buffer)) {
+                ALOGD("[Filter] pes data write failed");
+                mFilterOutput.clear();
+                mTsAssemblyStates.clear();
+                return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                        static_cast<int32_t>(Result::INVALID_ARGUMENT));
+            }
+            resetTsAssemblyState(state);
+            uint32_t prefix = payloadSize < 6 ? 0
+                                              : (static_cast<uint8_t>(payload[0]) << 16) |
+                                                        (static_cast<uint8_t>(payload[1]) << 8) |
+                                                        static_cast<uint8_t>(payload[2]);
             if (DEBUG_FILTER) {
                 ALOGD("[Filter] prefix %d", prefix);
             }
-            if (prefix == 0x000001) {
-                // TODO handle mulptiple Pes filters
-                mPesSizeLeft = (mFilterOutput[i + 8] << 8) | mFilterOutput[i + 9];
-                mPesSizeLeft += 6;
-                if (DEBUG_FILTER) {
-                    ALOGD("[Filter] pes data length %d", mPesSizeLeft);
-                }
-            } else {
+            if (prefix != 0x000001) {
                 continue;
             }
+            size_t pesLength = (static_cast<uint8_t>(payload[4]) << 8) |
+                               static_cast<uint8_t>(payload[5]);
+            state->assembling = true;
+            state->unbounded = pesLength == 0;
+            state->sizeLeft = pesLength + 6;
+            if (DEBUG_FILTER) {
+                ALOGD("[Filter] pes data length %zu", pesLength);
+            }
+        }
+        if (!state->assembling) {
+            continue;
         }
 
-        int endPoint = min(184, mPesSizeLeft);
-        // append data and check size
-        vector<int8_t>::const_iterator first = mFilterOutput.begin() + i + 4;
-        vector<int8_t>::const_iterator last = mFilterOutput.begin() + i + 4 + endPoint;
-        mPesOutput.insert(mPesOutput.end(), first, last);
-        // size does not match then continue
-        mPesSizeLeft -= endPoint;
+        size_t size = state->unbounded ? payloadSize : min(payloadSize, state->sizeLeft);
+        state->buffer.insert(state->buffer.end(), payload, payload + size);
+        if (state->unbounded) {
+            continue;
+        }
+        state->sizeLeft -= size;
         if (DEBUG_FILTER) {
-            ALOGD("[Filter] pes data left %d", mPesSizeLeft);
+            ALOGD("[Filter] pes data left %zu", state->sizeLeft);
         }
-        if (mPesSizeLeft > 0) {
+        if (state->sizeLeft > 0) {
             continue;
         }
-        // size match then create event
-        if (!writeDataToFilterMQ(mPesOutput)) {
+        if (!writePesAndCreateEvent(state->buffer)) {
             ALOGD("[Filter] pes data write failed");
             mFilterOutput.clear();
+            mTsAssemblyStates.clear();
             return ::ndk::ScopedAStatus::fromServiceSpecificError(
                     static_cast<int32_t>(Result::INVALID_ARGUMENT));
         }
-        maySendFilterStatusCallback();
-        DemuxFilterPesEvent pesEvent;
-        pesEvent = {
-                // temp dump meta data
-                .streamId = static_cast<int32_t>(mPesOutput[3]),
-                .dataLength = static_cast<int32_t>(mPesOutput.size()),
-        };
-        if (DEBUG_FILTER) {
-            ALOGD("[Filter] assembled pes data length %d", pesEvent.dataLength);
-        }
+        resetTsAssemblyState(state);
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(mFilterEventsLock);
-            mFilterEvents.push_back(DemuxFilterEvent::make<DemuxFilterEvent::Tag::pes>(pesEvent));
+    // Keep the trailing partial packet for the next round.
+    mFilterOutput.erase(mFilterOutput.begin(), mFilterOutput.begin() + offset);
+
+    return ::ndk::ScopedAStatus::ok();
+}
+
+const int8_t* Filter::getTsPayload(const int8_t* packet, TsAssemblyState** state,
+                                   bool* unitStart, size_t* payloadSize) {
+    if (packet[0] != TS_SYNC_BYTE || (packet[1] & 0x80)) {
+        // Out of sync or transport error.
+        return nullptr;
+    }
+    uint16_t pid = ((packet[1] & 0x1f) << 8) | ((packet[2] & 0xff));
+    uint8_t adaptationFieldControl = (packet[3] >> 4) & 0x3;
+    int8_t continuityCounter = packet[3] & 0xf;
+    *state = &mTsAssemblyStates[pid];
+    *unitStart = (packet[1] & 0x40) != 0;
+
+    size_t payloadOffset = 4;
+    if (adaptationFieldControl & 0x2) {
+        size_t adaptationFieldLength = static_cast<uint8_t>(packet[4]);
+        if (adaptationFieldLength > 0 && (packet[5] & 0x80)) {
+            // The discontinuity indicator is set, the counter is expected to jump.
+            (*state)->lastContinuityCounter = -1;
         }
+        payloadOffset += 1 + adaptationFieldLength;
+    }
+    if (!(adaptationFieldControl & 0x1) || payloadOffset >= TS_PACKET_SIZE) {
+        // The continuity counter does not advance without payload.
+        return nullptr;
+    }
 
-        mPesOutput.clear();
+    int8_t lastContinuityCounter = (*state)->lastContinuityCounter;
+    (*state)->lastContinuityCounter = continuityCounter;
+    if (lastContinuityCounter >= 0) {
+        if (continuityCounter == lastContinuityCounter) {
+            // Duplicate packet.
+            return nullptr;
+        }
+        if (continuityCounter != ((lastContinuityCounter + 1) & 0xf)) {
+            if (DEBUG_FILTER) {
+                ALOGD("[Filter] pid %d continuity counter jumps from %d to %d", pid,
+                      lastContinuityCounter, continuityCounter);
+            }
+            // Packets are lost, drop the data unit being assembled.
+            resetTsAssemblyState(*state);
+        }
     }
 
-    mFilterOutput.clear();
+    *payloadSize = TS_PACKET_SIZE - payloadOffset;
+    return packet + payloadOffset;
+}
 
-    return ::ndk::ScopedAStatus::ok();
+void Filter::resetTsAssemblyState(TsAssemblyState* state) {
+    state->assembling = false;
+    state->unbounded = false;
+    state->sizeLeft = 0;
+    state->buffer.clear();
+}
+
+bool Filter::assembleSectionData(TsAssemblyState* state, const int8_t* data, size_t size,
+                                 bool canStartSection) {
+    size_t pos = 0;
+    while (pos < size) {
+        if (!state->assembling) {
+            // 0xff is the stuffing after the last section in the packet.
+            if (!canStartSection || static_cast<uint8_t>(data[pos]) == 0xff) {
+                break;
+            }
+            state->assembling = true;
+            state->sizeLeft = SECTION_HEADER_SIZE;
+        }
+        size_t copySize = min(state->sizeLeft, size - pos);
+        state->buffer.insert(state->buffer.end(), data + pos, data + pos + copySize);
+        pos += copySize;
+        state->sizeLeft -= copySize;
+        if (state->sizeLeft > 0) {
+            break;
+        }
+        if (state->buffer.size() == SECTION_HEADER_SIZE) {
+            // The header is complete, now the section length is known.
+            state->sizeLeft = ((static_cast<uint8_t>(state->buffer[1]) & 0x0f) << 8) |
+                              static_cast<uint8_t>(state->buffer[2]);
+            if (state->sizeLeft > 0) {
+                continue;
+            }
+        }
+        if (!writeSectionAndCreateEvent(state->buffer)) {
+            return false;
+        }
+        resetTsAssemblyState(state);
+    }
+    return true;
 }
 
 ::ndk::ScopedAStatus Filter::startTsFilterHandler() {
@@ -867,39 +1187,38 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
     }
 
     for (int i = 0; i < mFilterOutput.size(); i += 188) {
-        if (mPesSizeLeft == 0) {
+        if (mMediaPesSizeLeft == 0) {
             uint32_t prefix = (mFilterOutput[i + 4] << 16) | (mFilterOutput[i + 5] << 8) |
                               mFilterOutput[i + 6];
             if (DEBUG_FILTER) {
                 ALOGD("[Filter] prefix %d", prefix);
             }
             if (prefix == 0x000001) {
-                // TODO handle mulptiple Pes filters
-                mPesSizeLeft = (mFilterOutput[i + 8] << 8) | mFilterOutput[i + 9];
-                mPesSizeLeft += 6;
+                mMediaPesSizeLeft = (mFilterOutput[i + 8] << 8) | mFilterOutput[i + 9];
+                mMediaPesSizeLeft += 6;
                 if (DEBUG_FILTER) {
-                    ALOGD("[Filter] pes data length %d", mPesSizeLeft);
+                    ALOGD("[Filter] pes data length %d", mMediaPesSizeLeft);
                 }
             } else {
                 continue;
             }
         }
 
-        int endPoint = min(184, mPesSizeLeft);
+        int endPoint = min(184, mMediaPesSizeLeft);
         // append data and check size
         vector<int8_t>::const_iterator first = mFilterOutput.begin() + i + 4;
         vector<int8_t>::const_iterator last = mFilterOutput.begin() + i + 4 + endPoint;
-        mPesOutput.insert(mPesOutput.end(), first, last);
+        mMediaPesOutput.insert(mMediaPesOutput.end(), first, last);
         // size does not match then continue
-        mPesSizeLeft -= endPoint;
+        mMediaPesSizeLeft -= endPoint;
         if (DEBUG_FILTER) {
-            ALOGD("[Filter] pes data left %d", mPesSizeLeft);
+            ALOGD("[Filter] pes data left %d", mMediaPesSizeLeft);
         }
-        if (mPesSizeLeft > 0 || mAvBufferCopyCount++ < 10) {
+        if (mMediaPesSizeLeft > 0 || mAvBufferCopyCount++ < 10) {
             continue;
         }
 
-        result = createMediaFilterEventWithIon(mPesOutput);
+        result = createMediaFilterEventWithIon(mMediaPesOutput);
         if (result.isOk()) {
             return result;
         }
@@ -923,31 +1242,15 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
 }
 
 ::ndk::ScopedAStatus Filter::startRecordFilterHandler() {
+    // The demux writes the record output through to the DVR as it arrives, so only the result of
+    // those writes is left to report.
     std::lock_guard<std::mutex> lock(mRecordFilterOutputLock);
-    if (mRecordFilterOutput.empty()) {
-        return ::ndk::ScopedAStatus::ok();
-    }
-
-    if (mDvr == nullptr || !mDvr->writeRecordFMQ(mRecordFilterOutput)) {
+    if (mRecordWriteFailed) {
+        mRecordWriteFailed = false;
         ALOGD("[Filter] dvr fails to write into record FMQ.");
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::UNKNOWN_ERROR));
     }
-
-    DemuxFilterTsRecordEvent recordEvent;
-    recordEvent = {
-            .byteNumber = static_cast<int64_t>(mRecordFilterOutput.size()),
-            .pts = (mPts == 0) ? static_cast<int64_t>(time(NULL)) * 900000 : mPts,
-            .firstMbInSlice = 0,  // random address
-    };
-
-    {
-        std::lock_guard<std::mutex> lock(mFilterEventsLock);
-        mFilterEvents.push_back(
-                DemuxFilterEvent::make<DemuxFilterEvent::Tag::tsRecord>(recordEvent));
-    }
-
-    mRecordFilterOutput.clear();
     return ::ndk::ScopedAStatus::ok();
 }
 
@@ -961,19 +1264,22 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
     return ::ndk::ScopedAStatus::ok();
 }
 
-bool Filter::writeSectionsAndCreateEvent(vector<int8_t>& data) {
-    // TODO check how many sections has been read
-    ALOGD("[Filter] section handler");
-    if (!writeDataToFilterMQ(data)) {
+bool Filter::writeSectionAndCreateEvent(const vector<int8_t>& section) {
+    if (DEBUG_FILTER) {
+        ALOGD("[Filter] section handler, size %zu", section.size());
+    }
+    if (!writeDataToFilterMQ(section)) {
         return false;
     }
+    maySendFilterStatusCallback();
+    // The version and section number are only in the long form of the section.
+    bool hasSyntax = (section[1] & 0x80) && section.size() >= 8;
     DemuxFilterSectionEvent secEvent;
     secEvent = {
-            // temp dump meta data
-            .tableId = 0,
-            .version = 1,
-            .sectionNum = 1,
-            .dataLength = static_cast<int32_t>(data.size()),
+            .tableId = static_cast<uint8_t>(section[0]),
+            .version = hasSyntax ? (static_cast<uint8_t>(section[5]) >> 1) & 0x1f : 0,
+            .sectionNum = hasSyntax ? static_cast<uint8_t>(section[6]) : 0,
+            .dataLength = static_cast<int32_t>(section.size()),
     };
 
     {
@@ -984,6 +1290,28 @@ bool Filter::writeSectionsAndCreateEvent(vector<int8_t>& data) {
     return true;
 }
 
+bool Filter::writePesAndCreateEvent(const vector<int8_t>& pes) {
+    if (!writeDataToFilterMQ(pes)) {
+        return false;
+    }
+    maySendFilterStatusCallback();
+    DemuxFilterPesEvent pesEvent;
+    pesEvent = {
+            .streamId = static_cast<uint8_t>(pes[3]),
+            .dataLength = static_cast<int32_t>(pes.size()),
+    };
+    if (DEBUG_FILTER) {
+        ALOGD("[Filter] assembled pes data length %d", pesEvent.dataLength);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mFilterEventsLock);
+        mFilterEvents.push_back(DemuxFilterEvent::make<DemuxFilterEvent::Tag::pes>(pesEvent));
+    }
+
+    return true;
+}
+
 bool Filter::writeDataToFilterMQ(const std::vector<int8_t>& data) {
     std::lock_guard<std::mutex> lock(mWriteLock);
     if (mFilterMQ->write(data.data(), data.size())) {
@@ -1045,6 +1373,31 @@ native_handle_t* Filter::createNativeHandle(int fd) {
 }
 
 ::ndk::ScopedAStatus Filter::createIndependentMediaEvents(vector<int8_t>& output) {
+    uint64_t dataId = mLastUsedDataId++ /*createdUID*/;
+    int64_t offset = 0;
+    if (mAvSlab != nullptr && mAvSlab->write(dataId, output.data(), output.size(), &offset)) {
+        auto event = DemuxFilterEvent::make<DemuxFilterEvent::Tag::media>();
+        auto& mediaEvent = event.get<DemuxFilterEvent::Tag::media>();
+        mediaEvent.avMemory = ::android::dupToAidl(mAvSlab->getHandle());
+        mediaEvent.offset = offset;
+        mediaEvent.dataLength = static_cast<int64_t>(output.size());
+        mediaEvent.avDataId = static_cast<int64_t>(dataId);
+        if (mPts) {
+            mediaEvent.pts = mPts;
+            mPts = 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mFilterEventsLock);
+            mFilterEvents.push_back(std::move(event));
+        }
+
+        output.clear();
+        mAvBufferCopyCount = 0;
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+    // The slab is full or the data does not fit, so fall back to a buffer of its own
     int av_fd = createAvIonFd(output.size());
     if (av_fd == -1) {
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
@@ -1053,20 +1406,22 @@ native_handle_t* Filter::createNativeHandle(int fd) {
     // copy the filtered data to the buffer
     uint8_t* avBuffer = getIonBuffer(av_fd, output.size());
     if (avBuffer == NULL) {
+        ::close(av_fd);
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::UNKNOWN_ERROR));
     }
     memcpy(avBuffer, output.data(), output.size() * sizeof(uint8_t));
+    munmap(avBuffer, output.size());
 
     native_handle_t* nativeHandle = createNativeHandle(av_fd);
     if (nativeHandle == NULL) {
+        ::close(av_fd);
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::UNKNOWN_ERROR));
     }
 
-    // Create a dataId and add a <dataId, av_fd> pair into the dataId2Avfd map
-    uint64_t dataId = mLastUsedDataId++ /*createdUID*/;
-    mDataId2Avfd[dataId] = dup(av_fd);
+    // Add a <dataId, av_fd> pair into the dataId2Avfd map
+    mDataId2Avfd[dataId] = av_fd;
 
     // Create mediaEvent and send callback
     auto event = DemuxFilterEvent::make<DemuxFilterEvent::Tag::media>();
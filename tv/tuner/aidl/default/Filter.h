@@ -26,11 +26,13 @@
 #include <ion/ion.h>
 #include <math.h>
 #include <sys/stat.h>
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <set>
 #include <thread>
 
+#include "AvBufferSlab.h"
 #include "Demux.h"
 #include "Dvr.h"
 #include "Frontend.h"
@@ -51,6 +53,13 @@ using ::android::hardware::EventFlag;
 
 using FilterMQ = AidlMessageQueue<int8_t, SynchronizedReadWrite>;
 const uint32_t BUFFER_SIZE_16M = 0x1000000;
+const uint32_t TS_PACKET_SIZE = 188;
+const int8_t TS_SYNC_BYTE = 0x47;
+// TS PIDs are 13 bits.
+const uint32_t TS_PID_COUNT = 0x2000;
+const uint16_t INVALID_TPID = 0xffff;
+// The max callback rate per filter in the adaptive mode, 0 to disable the adaptive mode.
+const char* const TARGET_CALLBACK_RATE_PROPERTY = "vendor.tuner.filter.target_callback_rate";
 
 class Demux;
 class Dvr;
@@ -65,11 +74,19 @@ class FilterCallbackScheduler final {
 
     void setTimeDelayHint(int timeDelay);
     void setDataSizeDelayHint(int dataSizeDelay);
+    /**
+     * Enables the adaptive mode if no delay hint is set by the client. The flush thresholds
+     * then follow the observed data rate to send at most about targetCallbackRate callbacks
+     * per second. 0 disables the adaptive mode.
+     */
+    void setTargetCallbackRate(int targetCallbackRate);
 
     bool hasCallbackRegistered() const;
 
     void flushEvents();
 
+    void dump(int fd);
+
   private:
     void start();
     void stop();
@@ -79,23 +96,56 @@ class FilterCallbackScheduler final {
 
     // function needs to be called while holding mLock
     bool isDataSizeDelayConditionMetLocked();
+    bool isAdaptiveLocked();
+    int getTimeDelayInMsLocked();
+    int getDataSizeDelayInBytesLocked();
+    void updateDataRateLocked(int dataLength);
+
+    void recordCallbackStats(const std::vector<int64_t>& eventTimesInNs, int64_t callbackTimeInNs);
 
     static int getDemuxFilterEventDataLength(const DemuxFilterEvent& event);
+    static int64_t getNowInNs();
+    // Index of the power of 2 bucket holding the value, capped to bucketCount - 1.
+    static size_t getHistogramBucket(uint64_t value, size_t bucketCount);
+
+    // Buckets of [0, 1), [1, 2), [2, 4) ... and [2^(N - 2), inf).
+    static const size_t LATENCY_BUCKET_COUNT = 14;
+    static const size_t EVENTS_PER_CALLBACK_BUCKET_COUNT = 12;
+    // Weight of the latest flush in the data rate estimation.
+    static constexpr double DATA_RATE_SMOOTHING = 0.2;
 
   private:
     std::shared_ptr<IFilterCallback> mCallback;
     std::thread mCallbackThread;
     std::atomic<bool> mIsRunning;
 
-    // mLock protects mCallbackBuffer, mIsConditionMet, mCv, mDataLength,
-    // mTimeDelayInMs, and mDataSizeDelayInBytes
+    // mLock protects mCallbackBuffer, mEventTimesInNs, mIsConditionMet, mCv, mDataLength,
+    // mTimeDelayInMs, mDataSizeDelayInBytes and the adaptive mode states
     std::mutex mLock;
     std::vector<DemuxFilterEvent> mCallbackBuffer;
+    // When each event in mCallbackBuffer was queued
+    std::vector<int64_t> mEventTimesInNs;
     bool mIsConditionMet;
     std::condition_variable mCv;
     int mDataLength;
     int mTimeDelayInMs;
     int mDataSizeDelayInBytes;
+    int mTargetCallbackRate = 0;
+    // Estimated data rate in bytes per ms, and when the last flush happened
+    double mDataRate = 0;
+    int64_t mLastFlushTimeInNs = 0;
+
+    // Only used by the callback thread. The pending events are swapped in, so the vectors keep
+    // their capacity and the events are sent without holding mLock.
+    std::vector<DemuxFilterEvent> mSendingBuffer;
+    std::vector<int64_t> mSendingEventTimesInNs;
+
+    // mStatsLock protects the callback statistics
+    std::mutex mStatsLock;
+    uint64_t mCallbackCount = 0;
+    uint64_t mSentEventCount = 0;
+    std::array<uint64_t, LATENCY_BUCKET_COUNT> mLatencyInMsHistogram = {};
+    std::array<uint64_t, EVENTS_PER_CALLBACK_BUCKET_COUNT> mEventsPerCallbackHistogram = {};
 };
 
 class Filter : public BnFilter {
@@ -135,13 +185,25 @@ class Filter : public BnFilter {
      */
     bool createFilterMQ();
     uint16_t getTpid();
-    void updateFilterOutput(vector<int8_t>& data);
-    void updateRecordOutput(vector<int8_t>& data);
+    /**
+     * Appends the packet to the filter output. The packet is only read during this call, so it
+     * could point into the DVR playback FMQ.
+     */
+    void updateFilterOutput(const int8_t* data, size_t size);
+    void updateFilterOutput(const vector<int8_t>& data);
+    void updateFilterOutput(const vector<const int8_t*>& packets, size_t packetSize);
+    /**
+     * Called after the demux wrote size bytes of the stream to the record FMQ of the filter's
+     * DVR, with the DemuxTsIndex flags found in the packets of the filter's TPID. Creates the
+     * record event, or remembers the failure for startRecordFilterHandler.
+     */
+    void onRecordOutputWritten(bool written, size_t size, uint32_t tsIndexMask);
     void updatePts(uint64_t pts);
     ::ndk::ScopedAStatus startFilterHandler();
     ::ndk::ScopedAStatus startRecordFilterHandler();
     void attachFilterToRecord(const std::shared_ptr<Dvr> dvr);
     void detachFilterFromRecord();
+    std::shared_ptr<Dvr> getRecordDvr() { return mDvr; }
     void freeSharedAvHandle();
     bool isMediaFilter() { return mIsMediaFilter; };
     bool isPcrFilter() { return mIsPcrFilter; };
@@ -164,11 +226,16 @@ class Filter : public BnFilter {
     bool mIsRecordFilter = false;
     DemuxFilterSettings mFilterSettings;
 
-    uint16_t mTpid;
+    uint16_t mTpid = INVALID_TPID;
     std::shared_ptr<IFilter> mDataSource;
     bool mIsDataSourceDemux = true;
     vector<int8_t> mFilterOutput;
-    vector<int8_t> mRecordFilterOutput;
+    // The DemuxTsIndex flags the client asked the record events to report.
+    uint32_t mRecordTsIndexMask = 0;
+    // Bytes recorded since the filter started, and whether a write to the DVR failed since the
+    // last startRecordFilterHandler. Guarded by mRecordFilterOutputLock.
+    uint64_t mRecordedBytes = 0;
+    bool mRecordWriteFailed = false;
     int64_t mPts = 0;
     unique_ptr<FilterMQ> mFilterMQ;
     bool mIsUsingFMQ = false;
@@ -209,7 +276,33 @@ class Filter : public BnFilter {
     void deleteEventFlag();
     bool writeDataToFilterMQ(const std::vector<int8_t>& data);
     bool readDataFromMQ();
-    bool writeSectionsAndCreateEvent(vector<int8_t>& data);
+
+    /**
+     * Streaming reassembly state of the PES packets or sections carried by one PID.
+     */
+    struct TsAssemblyState {
+        // -1 if no packet with payload has been seen yet.
+        int8_t lastContinuityCounter = -1;
+        bool assembling = false;
+        // Only for PES packets without the length, which end at the start of the next one.
+        bool unbounded = false;
+        size_t sizeLeft = 0;
+        vector<int8_t> buffer;
+    };
+    // The table id and the section length.
+    static const size_t SECTION_HEADER_SIZE = 3;
+
+    /**
+     * Returns the payload of the TS packet, or nullptr if there is nothing to assemble from it.
+     * Checks the continuity counter and drops the data unit being assembled on lost packets.
+     */
+    const int8_t* getTsPayload(const int8_t* packet, TsAssemblyState** state, bool* unitStart,
+                               size_t* payloadSize);
+    void resetTsAssemblyState(TsAssemblyState* state);
+    bool assembleSectionData(TsAssemblyState* state, const int8_t* data, size_t size,
+                             bool canStartSection);
+    bool writeSectionAndCreateEvent(const vector<int8_t>& section);
+    bool writePesAndCreateEvent(const vector<int8_t>& pes);
     void maySendFilterStatusCallback();
     DemuxFilterStatus checkFilterStatusChange(uint32_t availableToWrite, uint32_t availableToRead,
                                               uint32_t highThreshold, uint32_t lowThreshold);
@@ -256,16 +349,20 @@ class Filter : public BnFilter {
     std::mutex mFilterOutputLock;
     std::mutex mRecordFilterOutputLock;
 
-    // temp handle single PES filter
-    // TODO handle mulptiple Pes filters
-    int mPesSizeLeft = 0;
-    vector<int8_t> mPesOutput;
+    // PES data of the audio and video filters, handed to createMediaFilterEventWithIon.
+    int mMediaPesSizeLeft = 0;
+    vector<int8_t> mMediaPesOutput;
+    // TS reassembly states for the section and PES filters, keyed by PID.
+    std::map<uint16_t, TsAssemblyState> mTsAssemblyStates;
 
     // A map from data id to ion handle
     std::map<uint64_t, int> mDataId2Avfd;
     uint64_t mLastUsedDataId = 1;
     int mAvBufferCopyCount = 0;
 
+    // Buffer the independent media events are copied into, created when a media filter starts.
+    std::unique_ptr<AvBufferSlab> mAvSlab;
+
     // Shared A/V memory handle
     native_handle_t* mSharedAvMemHandle = nullptr;
     bool mUsingSharedAvMem = false;
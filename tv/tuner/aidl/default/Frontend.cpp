@@ -28,6 +28,14 @@ namespace hardware {
 namespace tv {
 namespace tuner {
 
+namespace {
+
+// Width of the range a blind scan covers from its start frequency.
+constexpr int64_t kBlindScanRangeHz = 8 * 1000 * 1000;
+constexpr int32_t kScanSymbolRate = 30;
+
+}  // namespace
+
 Frontend::Frontend(FrontendType type, int32_t id, std::shared_ptr<Tuner> tuner) {
     mType = type;
     mId = id;
@@ -228,7 +236,11 @@ Frontend::~Frontend() {}
 
     mFrontendSettings = in_settings;
     mFrontendScanType = in_type;
-    mScanThread = std::thread(&Frontend::scanThreadLoop, this);
+    mIsScanning = true;
+    mScanThread = std::thread([this] {
+        scanThreadLoop();
+        mIsScanning = false;
+    });
 
     return ::ndk::ScopedAStatus::ok();
 }
@@ -274,26 +286,57 @@ void Frontend::scanThreadLoop() {
             break;
     }
 
+    // Transponders found on the same LNB before are checked first, and only if none of them
+    // locks any more does the full scan run.
+    const int32_t lnbId = supportsSatellite() ? mLnbId : -1;
+    vector<FrontendScanResult> known;
+    if (mFrontendScanType == FrontendScanType::SCAN_AUTO &&
+        mTuner->getKnownTransponders(mType, lnbId, &known)) {
+        vector<FrontendScanResult> locked = rescanKnownTransponders(known, frequency);
+        if (!locked.empty()) {
+            sendScanMessages(locked, 100);
+            return;
+        }
+    }
+
+    vector<FrontendScanResult> results;
     if (mFrontendScanType == FrontendScanType::SCAN_BLIND) {
-        frequency += 100 * 1000;
+        // The simulated transponder sits 100kHz above where the blind scan starts.
+        results = blindScan(frequency, frequency + 100 * 1000);
+    } else {
+        results = probeRange(frequency, frequency + 1, frequency);
+    }
+    sendScanMessages(results, 20);
+
+    if (!results.empty()) {
+        mTuner->setKnownTransponders(mType, lnbId, std::move(results));
     }
+}
 
+void Frontend::sendScanMessages(const vector<FrontendScanResult>& results,
+                                int32_t progressPercent) {
     {
         FrontendScanMessage msg;
-        vector<int64_t> frequencies = {frequency};
+        vector<int64_t> frequencies;
+        for (const auto& result : results) {
+            frequencies.push_back(result.frequency);
+        }
         msg.set<FrontendScanMessage::Tag::frequencies>(frequencies);
         mCallback->onScanMessage(FrontendScanMessageType::FREQUENCY, msg);
     }
 
     {
         FrontendScanMessage msg;
-        msg.set<FrontendScanMessage::Tag::progressPercent>(20);
+        msg.set<FrontendScanMessage::Tag::progressPercent>(progressPercent);
         mCallback->onScanMessage(FrontendScanMessageType::PROGRESS_PERCENT, msg);
     }
 
     {
         FrontendScanMessage msg;
-        vector<int32_t> symbolRates = {30};
+        vector<int32_t> symbolRates;
+        for (const auto& result : results) {
+            symbolRates.push_back(result.symbolRate);
+        }
         msg.set<FrontendScanMessage::Tag::symbolRates>(symbolRates);
         mCallback->onScanMessage(FrontendScanMessageType::SYMBOL_RATE, msg);
     }
@@ -373,7 +416,11 @@ void Frontend::scanThreadLoop() {
     {
         FrontendScanMessage msg;
         FrontendModulation modulation;
-        modulation.set<FrontendModulation::Tag::dvbc>(FrontendDvbcModulation::MOD_16QAM);
+        if (results.empty()) {
+            modulation.set<FrontendModulation::Tag::dvbc>(FrontendDvbcModulation::MOD_16QAM);
+        } else {
+            modulation = results.front().modulation;
+        }
         msg.set<FrontendScanMessage::Tag::modulation>(modulation);
         mCallback->onScanMessage(FrontendScanMessageType::MODULATION, msg);
     }
@@ -406,6 +453,76 @@ void Frontend::scanThreadLoop() {
     }
 }
 
+vector<FrontendScanResult> Frontend::blindScan(int64_t startFrequency, int64_t signalFrequency) {
+    // Split the range between this frontend and the idle frontends of the same type, which probe
+    // their parts in parallel.
+    const vector<std::shared_ptr<Frontend>> helpers =
+            mTuner->reserveScanFrontends(mType, mId);
+    const int64_t segmentCount = helpers.size() + 1;
+    const int64_t segmentSize = (kBlindScanRangeHz + segmentCount - 1) / segmentCount;
+
+    vector<vector<FrontendScanResult>> segmentResults(segmentCount);
+    vector<std::thread> workers;
+    for (int64_t i = 1; i < segmentCount; i++) {
+        const int64_t begin = startFrequency + i * segmentSize;
+        workers.emplace_back([&, i, begin] {
+            segmentResults[i] =
+                    helpers[i - 1]->probeRange(begin, begin + segmentSize, signalFrequency);
+        });
+    }
+    segmentResults[0] = probeRange(startFrequency, startFrequency + segmentSize, signalFrequency);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& helper : helpers) {
+        helper->releaseScanReservation();
+    }
+
+    // The segments are in frequency order already.
+    vector<FrontendScanResult> results;
+    for (auto& segment : segmentResults) {
+        results.insert(results.end(), segment.begin(), segment.end());
+    }
+    return results;
+}
+
+vector<FrontendScanResult> Frontend::rescanKnownTransponders(
+        const vector<FrontendScanResult>& known, int64_t signalFrequency) {
+    vector<FrontendScanResult> locked;
+    for (const auto& transponder : known) {
+        if (!probeRange(transponder.frequency, transponder.frequency + 1, signalFrequency)
+                     .empty()) {
+            locked.push_back(transponder);
+        }
+    }
+
+    // Transponders that no longer lock are dropped from the known ones.
+    if (!locked.empty() && locked.size() != known.size()) {
+        const int32_t lnbId = supportsSatellite() ? mLnbId : -1;
+        mTuner->setKnownTransponders(mType, lnbId, locked);
+    }
+    return locked;
+}
+
+vector<FrontendScanResult> Frontend::probeRange(int64_t begin, int64_t end,
+                                                int64_t signalFrequency) {
+    vector<FrontendScanResult> results;
+    if (signalFrequency >= begin && signalFrequency < end) {
+        FrontendModulation modulation;
+        modulation.set<FrontendModulation::Tag::dvbc>(FrontendDvbcModulation::MOD_16QAM);
+        results.push_back({signalFrequency, kScanSymbolRate, modulation});
+    }
+    return results;
+}
+
+bool Frontend::tryReserveForScan() {
+    return !mIsLocked && !mIsScanning.exchange(true);
+}
+
+void Frontend::releaseScanReservation() {
+    mIsScanning = false;
+}
+
 ::ndk::ScopedAStatus Frontend::stopScan() {
     ALOGV("%s", __FUNCTION__);
 
@@ -873,12 +990,13 @@ void Frontend::scanThreadLoop() {
     return ::ndk::ScopedAStatus::ok();
 }
 
-::ndk::ScopedAStatus Frontend::setLnb(int32_t /* in_lnbId */) {
+::ndk::ScopedAStatus Frontend::setLnb(int32_t in_lnbId) {
     ALOGV("%s", __FUNCTION__);
     if (!supportsSatellite()) {
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::INVALID_STATE));
     }
+    mLnbId = in_lnbId;
     return ::ndk::ScopedAStatus::ok();
 }
 
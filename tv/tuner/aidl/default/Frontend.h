@@ -17,6 +17,7 @@
 #pragma once
 
 #include <aidl/android/hardware/tv/tuner/BnFrontend.h>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <thread>
@@ -63,10 +64,28 @@ class Frontend : public BnFrontend {
     bool isLocked();
     void getFrontendInfo(FrontendInfo* _aidl_return);
 
+    /**
+     * Reserves an idle frontend to scan part of the frequency range of another frontend's blind
+     * scan. Returns false if the frontend is locked or scanning.
+     */
+    bool tryReserveForScan();
+    void releaseScanReservation();
+    /**
+     * Looks for transponders in [begin, end). The example frontend has no demodulator behind it,
+     * so its input carries a single transponder at signalFrequency.
+     */
+    vector<FrontendScanResult> probeRange(int64_t begin, int64_t end, int64_t signalFrequency);
+
   private:
     virtual ~Frontend();
     bool supportsSatellite();
     void scanThreadLoop();
+    vector<FrontendScanResult> blindScan(int64_t startFrequency, int64_t signalFrequency);
+    /** Returns the known transponders that still lock, they are not reported yet. */
+    vector<FrontendScanResult> rescanKnownTransponders(const vector<FrontendScanResult>& known,
+                                                       int64_t signalFrequency);
+    /** Reports the transponders found by a scan, the same way for each scan type. */
+    void sendScanMessages(const vector<FrontendScanResult>& results, int32_t progressPercent);
 
     std::shared_ptr<IFrontendCallback> mCallback;
     std::shared_ptr<Tuner> mTuner;
@@ -75,6 +94,8 @@ class Frontend : public BnFrontend {
     bool mIsLocked = false;
     int32_t mCiCamId;
     std::thread mScanThread;
+    std::atomic<bool> mIsScanning = false;
+    int32_t mLnbId = -1;
     FrontendSettings mFrontendSettings;
     FrontendScanType mFrontendScanType;
     std::ifstream mFrontendData;
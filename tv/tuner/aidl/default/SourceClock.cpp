@@ -0,0 +1,62 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SourceClock.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+// The PCR base has 33 bits.
+static const int64_t kPcrBaseModulo = int64_t{1} << 33;
+
+int64_t SourceClock::nsToTicks(int64_t ns) {
+    return ns / 1000000000 * kClockRate + ns % 1000000000 * kClockRate / 1000000000;
+}
+
+void SourceClock::onPcr(int64_t pcrBase, bool discontinuity, int64_t nowNs) {
+    const LastPcr last = mLastPcr.load();
+    if (last.base == kInvalidTime) {
+        mLastPcr.store({pcrBase, nowNs, 0});
+        return;
+    }
+
+    // Modulo 2^33, so that a PCR past the wrap follows the one before.
+    const int64_t delta = (pcrBase - last.base + kPcrBaseModulo) % kPcrBaseModulo;
+    int64_t time;
+    if (discontinuity || delta > kMaxPcrInterval) {
+        time = last.time + nsToTicks(nowNs - last.ns);
+    } else {
+        time = last.time + delta;
+    }
+    mLastPcr.store({pcrBase, nowNs, time});
+}
+
+int64_t SourceClock::getTime(int64_t nowNs) const {
+    const LastPcr last = mLastPcr.load();
+    if (last.base == kInvalidTime) {
+        return kInvalidTime;
+    }
+    return last.time + nsToTicks(nowNs - last.ns);
+}
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
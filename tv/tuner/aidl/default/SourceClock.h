@@ -0,0 +1,67 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <commonsupport/SeqLocked.h>
+#include <cstdint>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+/**
+ * The time from the beginning of a transport stream, in 90kHz ticks, driven by its PCRs and
+ * interpolated with the monotonic clock between them.
+ *
+ * The time starts at 0 with the first PCR and does not jump: it follows the 33-bit PCR base across
+ * its wrap, and continues from the interpolated time at a discontinuity, whether the stream
+ * signals it or the PCR just jumps. Between PCRs it runs at the rate of the monotonic clock, so
+ * it can step back slightly at the PCRs of a stream played slower than real time.
+ *
+ * Fed by a single thread, read by any without locking.
+ */
+class SourceClock {
+  public:
+    static constexpr int64_t kClockRate = 90000;
+    static constexpr int64_t kInvalidTime = -1;
+    // PCRs further apart are a discontinuity. The stream must carry one every 100ms.
+    static constexpr int64_t kMaxPcrInterval = kClockRate;
+
+    static int64_t nsToTicks(int64_t ns);
+
+    void onPcr(int64_t pcrBase, bool discontinuity, int64_t nowNs);
+    /** Returns kInvalidTime before the first PCR. */
+    int64_t getTime(int64_t nowNs) const;
+
+  private:
+    struct LastPcr {
+        // kInvalidTime before the first PCR.
+        int64_t base;
+        int64_t ns;
+        int64_t time;
+    };
+
+    ::android::SeqLocked<LastPcr> mLastPcr{{kInvalidTime, 0, 0}};
+};
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "SourceClock.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+namespace {
+
+// 10ms, in nanoseconds and in 90kHz ticks.
+constexpr int64_t k10msNs = 10000000;
+constexpr int64_t k10msTicks = 900;
+
+TEST(SourceClockTest, InvalidBeforeTheFirstPcr) {
+    SourceClock clock;
+    EXPECT_EQ(SourceClock::kInvalidTime, clock.getTime(0));
+}
+
+TEST(SourceClockTest, StartsAtTheFirstPcr) {
+    SourceClock clock;
+    clock.onPcr(123456789, false, 5 * k10msNs);
+    EXPECT_EQ(0, clock.getTime(5 * k10msNs));
+}
+
+TEST(SourceClockTest, FollowsThePcrs) {
+    SourceClock clock;
+    clock.onPcr(1000, false, 0);
+    // A stream played faster than real time.
+    clock.onPcr(1000 + 2 * k10msTicks, false, k10msNs);
+    EXPECT_EQ(2 * k10msTicks, clock.getTime(k10msNs));
+    clock.onPcr(1000 + 3 * k10msTicks, false, 2 * k10msNs);
+    EXPECT_EQ(3 * k10msTicks, clock.getTime(2 * k10msNs));
+}
+
+TEST(SourceClockTest, InterpolatesBetweenPcrs) {
+    SourceClock clock;
+    clock.onPcr(1000, false, 0);
+    clock.onPcr(1000 + k10msTicks, false, k10msNs);
+    EXPECT_EQ(k10msTicks + k10msTicks / 2, clock.getTime(k10msNs + k10msNs / 2));
+    EXPECT_EQ(k10msTicks + 90000, clock.getTime(k10msNs + 1000000000));
+}
+
+TEST(SourceClockTest, FollowsTheWrapOfThePcrBase) {
+    SourceClock clock;
+    clock.onPcr((int64_t{1} << 33) - 1000, false, 0);
+    clock.onPcr(500, false, k10msNs);
+    EXPECT_EQ(1500, clock.getTime(k10msNs));
+}
+
+TEST(SourceClockTest, ContinuesAtSignalledDiscontinuities) {
+    SourceClock clock;
+    clock.onPcr(1000, false, 0);
+    clock.onPcr(1000 + k10msTicks, false, k10msNs);
+    // A new program, whose PCRs restart elsewhere.
+    clock.onPcr(1000 + 2 * k10msTicks, true, 3 * k10msNs);
+    EXPECT_EQ(3 * k10msTicks, clock.getTime(3 * k10msNs));
+    clock.onPcr(1000 + 3 * k10msTicks, false, 4 * k10msNs);
+    EXPECT_EQ(4 * k10msTicks, clock.getTime(4 * k10msNs));
+}
+
+TEST(SourceClockTest, TreatsJumpsAsDiscontinuities) {
+    SourceClock clock;
+    clock.onPcr(500000, false, 0);
+
+    // Backwards.
+    clock.onPcr(1000, false, k10msNs);
+    EXPECT_EQ(k10msTicks, clock.getTime(k10msNs));
+
+    // More than a second forwards.
+    clock.onPcr(1000 + 2 * SourceClock::kClockRate, false, 2 * k10msNs);
+    EXPECT_EQ(2 * k10msTicks, clock.getTime(2 * k10msNs));
+
+    // And the PCRs are followed from there.
+    clock.onPcr(1000 + 2 * SourceClock::kClockRate + k10msTicks, false, 3 * k10msNs);
+    EXPECT_EQ(3 * k10msTicks, clock.getTime(3 * k10msNs));
+}
+
+}  // namespace
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -19,6 +19,7 @@
 
 #include <aidl/android/hardware/tv/tuner/Result.h>
 #include <utils/Log.h>
+#include <chrono>
 
 #include "TimeFilter.h"
 
@@ -28,6 +29,12 @@ namespace hardware {
 namespace tv {
 namespace tuner {
 
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
 TimeFilter::TimeFilter() {}
 
 TimeFilter::TimeFilter(std::shared_ptr<Demux> demux) {
@@ -42,29 +49,34 @@ TimeFilter::~TimeFilter() {}
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::INVALID_ARGUMENT));
     }
-    mTimeStamp = in_timeStamp;
-    mBeginTime = time(NULL);
+    const int64_t now = nowNs();
+    mTimeStamp.store({in_timeStamp, mSourceClock.getTime(now), now});
 
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus TimeFilter::clearTimeStamp() {
     ALOGV("%s", __FUNCTION__);
-    mTimeStamp = INVALID_TIME_STAMP;
+    mTimeStamp.store({INVALID_TIME_STAMP, SourceClock::kInvalidTime, 0});
 
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus TimeFilter::getTimeStamp(int64_t* _aidl_return) {
     ALOGV("%s", __FUNCTION__);
-    if (mTimeStamp == INVALID_TIME_STAMP) {
-        *_aidl_return = mTimeStamp;
+    const TimeStamp timeStamp = mTimeStamp.load();
+    if (timeStamp.value == INVALID_TIME_STAMP) {
+        *_aidl_return = timeStamp.value;
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::INVALID_ARGUMENT));
     }
 
-    uint64_t currentTimeStamp = mTimeStamp + difftime(time(NULL), mBeginTime) * 900000;
-    *_aidl_return = currentTimeStamp;
+    const int64_t now = nowNs();
+    if (timeStamp.sourceTime != SourceClock::kInvalidTime) {
+        *_aidl_return = timeStamp.value + mSourceClock.getTime(now) - timeStamp.sourceTime;
+    } else {
+        *_aidl_return = timeStamp.value + SourceClock::nsToTicks(now - timeStamp.ns);
+    }
 
     return ::ndk::ScopedAStatus::ok();
 }
@@ -72,23 +84,30 @@ TimeFilter::~TimeFilter() {}
 ::ndk::ScopedAStatus TimeFilter::getSourceTime(int64_t* _aidl_return) {
     ALOGV("%s", __FUNCTION__);
 
-    *_aidl_return = 0;
+    const int64_t sourceTime = mSourceClock.getTime(nowNs());
+    *_aidl_return = sourceTime != SourceClock::kInvalidTime ? sourceTime : 0;
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus TimeFilter::close() {
     ALOGV("%s", __FUNCTION__);
-    mTimeStamp = INVALID_TIME_STAMP;
+    mTimeStamp.store({INVALID_TIME_STAMP, SourceClock::kInvalidTime, 0});
 
     return ::ndk::ScopedAStatus::ok();
 }
 
 binder_status_t TimeFilter::dump(int fd, const char** /* args */, uint32_t /* numArgs */) {
+    const int64_t now = nowNs();
     dprintf(fd, "    TimeFilter:\n");
-    dprintf(fd, "      mTimeStamp: %" PRIu64 "\n", mTimeStamp);
+    dprintf(fd, "      mTimeStamp: %" PRId64 "\n", mTimeStamp.load().value);
+    dprintf(fd, "      sourceTime: %" PRId64 "\n", mSourceClock.getTime(now));
     return STATUS_OK;
 }
 
+void TimeFilter::onPcr(int64_t pcrBase, bool discontinuity) {
+    mSourceClock.onPcr(pcrBase, discontinuity, nowNs());
+}
+
 }  // namespace tuner
 }  // namespace tv
 }  // namespace hardware
@@ -17,8 +17,9 @@
 #pragma once
 
 #include <aidl/android/hardware/tv/tuner/BnTimeFilter.h>
+#include <commonsupport/SeqLocked.h>
 #include "Demux.h"
-#include "time.h"
+#include "SourceClock.h"
 
 using namespace std;
 
@@ -46,10 +47,27 @@ class TimeFilter : public BnTimeFilter {
 
     binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
 
+    /**
+     * Takes a PCR the demux saw, with the base in 90kHz ticks and whether its packet has the
+     * discontinuity indicator. Called by the demux thread only.
+     */
+    void onPcr(int64_t pcrBase, bool discontinuity);
+
   private:
+    struct TimeStamp {
+        int64_t value;
+        // The source time and the monotonic time in nanoseconds the value was set at.
+        int64_t sourceTime;
+        int64_t ns;
+    };
+
     ::std::shared_ptr<Demux> mDemux;
-    uint64_t mTimeStamp = INVALID_TIME_STAMP;
-    time_t mBeginTime;
+    SourceClock mSourceClock;
+    /**
+     * The time stamp set advances with the source time, or with the monotonic clock when it was
+     * set before the first PCR.
+     */
+    ::android::SeqLocked<TimeStamp> mTimeStamp{{INVALID_TIME_STAMP, SourceClock::kInvalidTime, 0}};
 };
 
 }  // namespace tuner
@@ -18,6 +18,7 @@
 #define LOG_TAG "android.hardware.tv.tuner-service.example-Tuner"
 
 #include <aidl/android/hardware/tv/tuner/Result.h>
+#include <inttypes.h>
 #include <utils/Log.h>
 
 #include "Demux.h"
@@ -38,6 +39,7 @@ void Tuner::init() {
     // Static Frontends array to maintain local frontends information
     // Array index matches their FrontendId in the default impl
     mFrontendSize = 10;
+    std::lock_guard<std::mutex> lock(mFrontendsLock);
     mFrontends[0] = ndk::SharedRefBase::make<Frontend>(FrontendType::ISDBS, 0, this->ref<Tuner>());
     mFrontends[1] = ndk::SharedRefBase::make<Frontend>(FrontendType::ATSC3, 1, this->ref<Tuner>());
     mFrontends[2] = ndk::SharedRefBase::make<Frontend>(FrontendType::DVBC, 2, this->ref<Tuner>());
@@ -71,6 +73,7 @@ Tuner::~Tuner() {}
     ALOGV("%s", __FUNCTION__);
 
     _aidl_return->resize(mFrontendSize);
+    std::lock_guard<std::mutex> lock(mFrontendsLock);
     for (int i = 0; i < mFrontendSize; i++) {
         (*_aidl_return)[i] = mFrontends[i]->getFrontendId();
     }
@@ -89,7 +92,7 @@ Tuner::~Tuner() {}
                 static_cast<int32_t>(Result::INVALID_ARGUMENT));
     }
 
-    *_aidl_return = mFrontends[in_frontendId];
+    *_aidl_return = getFrontend(in_frontendId);
     return ::ndk::ScopedAStatus::ok();
 }
 
@@ -97,6 +100,7 @@ Tuner::~Tuner() {}
                                       std::shared_ptr<IDemux>* _aidl_return) {
     ALOGV("%s", __FUNCTION__);
 
+    std::lock_guard<std::mutex> lock(mDemuxesLock);
     mLastUsedId += 1;
     mDemuxes[mLastUsedId] = ndk::SharedRefBase::make<Demux>(mLastUsedId, this->ref<Tuner>());
 
@@ -120,7 +124,7 @@ Tuner::~Tuner() {}
 ::ndk::ScopedAStatus Tuner::openDescrambler(std::shared_ptr<IDescrambler>* _aidl_return) {
     ALOGV("%s", __FUNCTION__);
 
-    *_aidl_return = ndk::SharedRefBase::make<Descrambler>();
+    *_aidl_return = ndk::SharedRefBase::make<Descrambler>(this->ref<Tuner>());
 
     return ndk::ScopedAStatus::ok();
 }
@@ -133,7 +137,7 @@ Tuner::~Tuner() {}
                 static_cast<int32_t>(Result::INVALID_ARGUMENT));
     }
 
-    mFrontends[in_frontendId]->getFrontendInfo(_aidl_return);
+    getFrontend(in_frontendId)->getFrontendInfo(_aidl_return);
     return ::ndk::ScopedAStatus::ok();
 }
 
@@ -164,7 +168,13 @@ Tuner::~Tuner() {}
 std::shared_ptr<Frontend> Tuner::getFrontendById(int32_t frontendId) {
     ALOGV("%s", __FUNCTION__);
 
-    return mFrontends[frontendId];
+    return getFrontend(frontendId);
+}
+
+std::shared_ptr<Frontend> Tuner::getFrontend(int32_t frontendId) {
+    std::lock_guard<std::mutex> lock(mFrontendsLock);
+    auto it = mFrontends.find(frontendId);
+    return it != mFrontends.end() ? it->second : nullptr;
 }
 
 ::ndk::ScopedAStatus Tuner::openLnbByName(const std::string& /* in_lnbName */,
@@ -208,14 +218,18 @@ binder_status_t Tuner::dump(int fd, const char** args, uint32_t numArgs) {
     {
         dprintf(fd, "Frontends:\n");
         for (int i = 0; i < mFrontendSize; i++) {
-            mFrontends[i]->dump(fd, args, numArgs);
+            getFrontend(i)->dump(fd, args, numArgs);
         }
     }
     {
         dprintf(fd, "Demuxs:\n");
-        map<int32_t, std::shared_ptr<Demux>>::iterator it;
-        for (it = mDemuxes.begin(); it != mDemuxes.end(); it++) {
-            it->second->dump(fd, args, numArgs);
+        map<int32_t, std::shared_ptr<Demux>> demuxes;
+        {
+            std::lock_guard<std::mutex> lock(mDemuxesLock);
+            demuxes = mDemuxes;
+        }
+        for (const auto& [id, demux] : demuxes) {
+            demux->dump(fd, args, numArgs);
         }
     }
     {
@@ -224,17 +238,83 @@ binder_status_t Tuner::dump(int fd, const char** args, uint32_t numArgs) {
             mLnbs[i]->dump(fd, args, numArgs);
         }
     }
+    {
+        std::lock_guard<std::mutex> lock(mKnownTranspondersLock);
+        dprintf(fd, "Known transponders:\n");
+        for (const auto& [key, results] : mKnownTransponders) {
+            dprintf(fd, "  type %d lnb %d:", static_cast<int32_t>(key.first), key.second);
+            for (const auto& result : results) {
+                dprintf(fd, " %" PRId64 "Hz/%d", result.frequency, result.symbolRate);
+            }
+            dprintf(fd, "\n");
+        }
+    }
     return STATUS_OK;
 }
 
+vector<std::shared_ptr<Frontend>> Tuner::reserveScanFrontends(FrontendType type,
+                                                              int32_t scanningId) {
+    vector<std::shared_ptr<Frontend>> frontends;
+    std::lock_guard<std::mutex> lock(mFrontendsLock);
+    for (const auto& [id, frontend] : mFrontends) {
+        if (id != scanningId && frontend != nullptr && frontend->getFrontendType() == type &&
+            frontend->tryReserveForScan()) {
+            frontends.push_back(frontend);
+        }
+    }
+    return frontends;
+}
+
+bool Tuner::getKnownTransponders(FrontendType type, int32_t lnbId,
+                                 vector<FrontendScanResult>* results) {
+    std::lock_guard<std::mutex> lock(mKnownTranspondersLock);
+    auto it = mKnownTransponders.find({type, lnbId});
+    if (it == mKnownTransponders.end()) {
+        return false;
+    }
+    *results = it->second;
+    return true;
+}
+
+void Tuner::setKnownTransponders(FrontendType type, int32_t lnbId,
+                                 vector<FrontendScanResult> results) {
+    std::lock_guard<std::mutex> lock(mKnownTranspondersLock);
+    mKnownTransponders[{type, lnbId}] = std::move(results);
+}
+
 void Tuner::setFrontendAsDemuxSource(int32_t frontendId, int32_t demuxId) {
-    mFrontendToDemux[frontendId] = demuxId;
-    if (mFrontends[frontendId] != nullptr && mFrontends[frontendId]->isLocked()) {
-        mDemuxes[demuxId]->startFrontendInputLoop();
+    std::shared_ptr<Demux> demux;
+    {
+        std::lock_guard<std::mutex> lock(mDemuxesLock);
+        mFrontendToDemux[frontendId] = demuxId;
+        demux = getDemuxLocked(demuxId);
+    }
+    std::shared_ptr<Frontend> frontend = getFrontend(frontendId);
+    if (demux != nullptr && frontend != nullptr && frontend->isLocked()) {
+        demux->startFrontendInputLoop();
     }
 }
 
+std::shared_ptr<Demux> Tuner::getDemux(int32_t demuxId) {
+    std::lock_guard<std::mutex> lock(mDemuxesLock);
+    return getDemuxLocked(demuxId);
+}
+
+std::shared_ptr<Demux> Tuner::getDemuxLocked(int32_t demuxId) {
+    auto it = mDemuxes.find(demuxId);
+    return it != mDemuxes.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<Demux> Tuner::getFrontendDemux(int32_t frontendId) {
+    std::lock_guard<std::mutex> lock(mDemuxesLock);
+    map<int32_t, int32_t>::iterator it = mFrontendToDemux.find(frontendId);
+    return it != mFrontendToDemux.end() ? getDemuxLocked(it->second) : nullptr;
+}
+
 void Tuner::removeDemux(int32_t demuxId) {
+    // Released without the lock, as the last reference closes the demux, which removes it again.
+    std::shared_ptr<Demux> removed;
+    std::lock_guard<std::mutex> lock(mDemuxesLock);
     map<int32_t, int32_t>::iterator it;
     for (it = mFrontendToDemux.begin(); it != mFrontendToDemux.end(); it++) {
         if (it->second == demuxId) {
@@ -242,32 +322,38 @@ void Tuner::removeDemux(int32_t demuxId) {
             break;
         }
     }
-    mDemuxes.erase(demuxId);
+    auto demuxIt = mDemuxes.find(demuxId);
+    if (demuxIt != mDemuxes.end()) {
+        removed = std::move(demuxIt->second);
+        mDemuxes.erase(demuxIt);
+    }
 }
 
 void Tuner::removeFrontend(int32_t frontendId) {
+    std::shared_ptr<Demux> removed;
+    std::lock_guard<std::mutex> lock(mDemuxesLock);
     map<int32_t, int32_t>::iterator it = mFrontendToDemux.find(frontendId);
     if (it != mFrontendToDemux.end()) {
-        mDemuxes.erase(it->second);
+        auto demuxIt = mDemuxes.find(it->second);
+        if (demuxIt != mDemuxes.end()) {
+            removed = std::move(demuxIt->second);
+            mDemuxes.erase(demuxIt);
+        }
     }
     mFrontendToDemux.erase(frontendId);
 }
 
 void Tuner::frontendStopTune(int32_t frontendId) {
-    map<int32_t, int32_t>::iterator it = mFrontendToDemux.find(frontendId);
-    int32_t demuxId;
-    if (it != mFrontendToDemux.end()) {
-        demuxId = it->second;
-        mDemuxes[demuxId]->stopFrontendInput();
+    std::shared_ptr<Demux> demux = getFrontendDemux(frontendId);
+    if (demux != nullptr) {
+        demux->stopFrontendInput();
     }
 }
 
 void Tuner::frontendStartTune(int32_t frontendId) {
-    map<int32_t, int32_t>::iterator it = mFrontendToDemux.find(frontendId);
-    int32_t demuxId;
-    if (it != mFrontendToDemux.end()) {
-        demuxId = it->second;
-        mDemuxes[demuxId]->startFrontendInputLoop();
+    std::shared_ptr<Demux> demux = getFrontendDemux(frontendId);
+    if (demux != nullptr) {
+        demux->startFrontendInputLoop();
     }
 }
 
@@ -18,8 +18,10 @@
 
 #include <aidl/android/hardware/tv/tuner/BnTuner.h>
 #include <aidl/android/hardware/tv/tuner/FrontendCapabilities.h>
+#include <aidl/android/hardware/tv/tuner/FrontendModulation.h>
 
 #include <map>
+#include <mutex>
 #include "Demux.h"
 #include "Frontend.h"
 #include "Lnb.h"
@@ -36,6 +38,13 @@ class Frontend;
 class Demux;
 class Lnb;
 
+// A transponder a scan locked on, kept to rescan known transponders quickly.
+struct FrontendScanResult {
+    int64_t frequency;
+    int32_t symbolRate;
+    FrontendModulation modulation;
+};
+
 class Tuner : public BnTuner {
   public:
     Tuner();
@@ -68,13 +77,37 @@ class Tuner : public BnTuner {
     void setFrontendAsDemuxSource(int32_t frontendId, int32_t demuxId);
     void frontendStartTune(int32_t frontendId);
     void frontendStopTune(int32_t frontendId);
+    std::shared_ptr<Demux> getDemux(int32_t demuxId);
     void removeDemux(int32_t demuxId);
     void removeFrontend(int32_t frontendId);
     void init();
 
+    /**
+     * Reserves the idle frontends of the given type other than the scanning one, to share the
+     * frequency range of its blind scan. The caller releases each of them after its part.
+     */
+    vector<std::shared_ptr<Frontend>> reserveScanFrontends(FrontendType type,
+                                                           int32_t scanningId);
+    /**
+     * Transponders found by the last scan of a frontend type through an LNB, or with lnbId -1
+     * for terrestrial and cable frontends. They are kept for the lifetime of the service.
+     */
+    bool getKnownTransponders(FrontendType type, int32_t lnbId,
+                              vector<FrontendScanResult>* results);
+    void setKnownTransponders(FrontendType type, int32_t lnbId,
+                              vector<FrontendScanResult> results);
+
   private:
-    // Static mFrontends array to maintain local frontends information
+    std::shared_ptr<Demux> getDemuxLocked(int32_t demuxId);
+    std::shared_ptr<Demux> getFrontendDemux(int32_t frontendId);
+    std::shared_ptr<Frontend> getFrontend(int32_t frontendId);
+
+    // Static mFrontends array to maintain local frontends information. mFrontendsLock guards it,
+    // as the scan threads of the frontends look through it as well.
+    std::mutex mFrontendsLock;
     map<int32_t, std::shared_ptr<Frontend>> mFrontends;
+    // Guards mFrontendToDemux, mDemuxes and mLastUsedId.
+    std::mutex mDemuxesLock;
     map<int32_t, int32_t> mFrontendToDemux;
     map<int32_t, std::shared_ptr<Demux>> mDemuxes;
     // To maintain how many Frontends we have
@@ -84,6 +117,8 @@ class Tuner : public BnTuner {
     int32_t mLastUsedId = -1;
     vector<std::shared_ptr<Lnb>> mLnbs;
     map<FrontendType, int32_t> mMaxUsableFrontends;
+    std::mutex mKnownTranspondersLock;
+    map<pair<FrontendType, int32_t>, vector<FrontendScanResult>> mKnownTransponders;
 };
 
 }  // namespace tuner
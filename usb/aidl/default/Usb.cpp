@@ -22,14 +22,16 @@
 #include <android-base/strings.h>
 #include <assert.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
 #include <chrono>
-#include <regex>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <cutils/uevent.h>
 #include <sys/epoll.h>
@@ -53,6 +55,15 @@ constexpr char kPowerRoleNode[] = "/power_role";
 // Set by the signal handler to destroy the thread
 volatile bool destroyThread;
 
+// A burst of typec uevents, e.g. while docking, is coalesced into one port status update sent
+// this long after the first uevent of the burst.
+constexpr int kUeventDebounceMs = 50;
+
+// The role nodes of a port exist as long as the port does, so they are kept open and re-read with
+// pread instead of being opened for every port status query.
+pthread_mutex_t sSysfsFdsLock = PTHREAD_MUTEX_INITIALIZER;
+std::unordered_map<string, int> sSysfsFds;
+
 void queryVersionHelper(android::hardware::usb::Usb *usb,
                         std::vector<PortStatus> *currentPortStatus);
 
@@ -245,7 +256,9 @@ Usb::Usb()
     : mLock(PTHREAD_MUTEX_INITIALIZER),
       mRoleSwitchLock(PTHREAD_MUTEX_INITIALIZER),
       mPartnerLock(PTHREAD_MUTEX_INITIALIZER),
-      mPartnerUp(false)
+      mPartnerUp(false),
+      mPortStatusResult(Status::SUCCESS),
+      mPortStatusValid(false)
 {
     pthread_condattr_t attr;
     if (pthread_condattr_init(&attr)) {
@@ -339,6 +352,40 @@ ScopedAStatus Usb::limitPowerTransfer(const string& in_portName, bool /*in_limit
     return ScopedAStatus::ok();
 }
 
+bool readCachedSysfsNode(const string &filename, string *contents) {
+    bool ret = false;
+
+    pthread_mutex_lock(&sSysfsFdsLock);
+    for (int attempt = 0; attempt < 2 && !ret; attempt++) {
+        auto it = sSysfsFds.find(filename);
+        if (it == sSysfsFds.end()) {
+            int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                break;
+            it = sSysfsFds.emplace(filename, fd).first;
+        }
+
+        char buf[256];
+        off_t offset = 0;
+        ssize_t n;
+        contents->clear();
+        while ((n = TEMP_FAILURE_RETRY(pread(it->second, buf, sizeof(buf), offset))) > 0) {
+            contents->append(buf, n);
+            offset += n;
+        }
+        if (n == 0) {
+            ret = true;
+        } else {
+            // The port may have gone away and come back, open the node again.
+            close(it->second);
+            sSysfsFds.erase(it);
+        }
+    }
+    pthread_mutex_unlock(&sSysfsFdsLock);
+
+    return ret;
+}
+
 Status getAccessoryConnected(const string &portName, string *accessory) {
     string filename = kTypecPath + portName + "-partner/accessory_mode";
 
@@ -387,7 +434,7 @@ Status getCurrentRoleHelper(const string &portName, bool connected, PortRole *cu
         }
     }
 
-    if (!ReadFileToString(filename, &roleName)) {
+    if (!readCachedSysfsNode(filename, &roleName)) {
         ALOGE("getCurrentRole: Failed to open filesystem node: %s", filename.c_str());
         return Status::ERROR;
     }
@@ -461,6 +508,44 @@ bool canSwitchRoleHelper(const string &portName) {
     return false;
 }
 
+Status getOnePortStatusHelper(const string &portName, bool connected, PortStatus *portStatus) {
+    portStatus->portName = portName;
+
+    PortRole currentRole;
+    currentRole.set<PortRole::powerRole>(PortPowerRole::NONE);
+    if (getCurrentRoleHelper(portName, connected, &currentRole) == Status::SUCCESS){
+        portStatus->currentPowerRole = currentRole.get<PortRole::powerRole>();
+    } else {
+        ALOGE("Error while retrieving portNames");
+        return Status::ERROR;
+    }
+
+    currentRole.set<PortRole::dataRole>(PortDataRole::NONE);
+    if (getCurrentRoleHelper(portName, connected, &currentRole) == Status::SUCCESS) {
+        portStatus->currentDataRole = currentRole.get<PortRole::dataRole>();
+    } else {
+        ALOGE("Error while retrieving current port role");
+        return Status::ERROR;
+    }
+
+    currentRole.set<PortRole::mode>(PortMode::NONE);
+    if (getCurrentRoleHelper(portName, connected, &currentRole) == Status::SUCCESS) {
+        portStatus->currentMode = currentRole.get<PortRole::mode>();
+    } else {
+        ALOGE("Error while retrieving current data role");
+        return Status::ERROR;
+    }
+
+    portStatus->canChangeMode = true;
+    portStatus->canChangeDataRole = connected ? canSwitchRoleHelper(portName) : false;
+    portStatus->canChangePowerRole = connected ? canSwitchRoleHelper(portName) : false;
+
+    portStatus->supportedModes.push_back(PortMode::DRP);
+    portStatus->usbDataStatus.push_back(UsbDataStatus::ENABLED);
+
+    return Status::SUCCESS;
+}
+
 Status getPortStatusHelper(std::vector<PortStatus> *currentPortStatus) {
     std::unordered_map<string, bool> names;
     Status result = getTypeCPortNamesHelper(&names);
@@ -471,42 +556,11 @@ Status getPortStatusHelper(std::vector<PortStatus> *currentPortStatus) {
         for (std::pair<string, bool> port : names) {
             i++;
             ALOGI("%s", port.first.c_str());
-            (*currentPortStatus)[i].portName = port.first;
-
-            PortRole currentRole;
-            currentRole.set<PortRole::powerRole>(PortPowerRole::NONE);
-            if (getCurrentRoleHelper(port.first, port.second, &currentRole) == Status::SUCCESS){
-                (*currentPortStatus)[i].currentPowerRole = currentRole.get<PortRole::powerRole>();
-            } else {
-                ALOGE("Error while retrieving portNames");
-                goto done;
+            if (getOnePortStatusHelper(port.first, port.second, &(*currentPortStatus)[i]) !=
+                Status::SUCCESS) {
+                return Status::ERROR;
             }
 
-            currentRole.set<PortRole::dataRole>(PortDataRole::NONE);
-            if (getCurrentRoleHelper(port.first, port.second, &currentRole) == Status::SUCCESS) {
-                (*currentPortStatus)[i].currentDataRole = currentRole.get<PortRole::dataRole>();
-            } else {
-                ALOGE("Error while retrieving current port role");
-                goto done;
-            }
-
-            currentRole.set<PortRole::mode>(PortMode::NONE);
-            if (getCurrentRoleHelper(port.first, port.second, &currentRole) == Status::SUCCESS) {
-                (*currentPortStatus)[i].currentMode = currentRole.get<PortRole::mode>();
-            } else {
-                ALOGE("Error while retrieving current data role");
-                goto done;
-            }
-
-            (*currentPortStatus)[i].canChangeMode = true;
-            (*currentPortStatus)[i].canChangeDataRole =
-                port.second ? canSwitchRoleHelper(port.first) : false;
-            (*currentPortStatus)[i].canChangePowerRole =
-                port.second ? canSwitchRoleHelper(port.first) : false;
-
-            (*currentPortStatus)[i].supportedModes.push_back(PortMode::DRP);
-            (*currentPortStatus)[i].usbDataStatus.push_back(UsbDataStatus::ENABLED);
-
             ALOGI("%d:%s connected:%d canChangeMode:%d canChagedata:%d canChangePower:%d "
                 "usbDataEnabled:%d",
                 i, port.first.c_str(), port.second,
@@ -517,23 +571,75 @@ Status getPortStatusHelper(std::vector<PortStatus> *currentPortStatus) {
 
         return Status::SUCCESS;
     }
-done:
     return Status::ERROR;
 }
 
+// Sends the port status to the callback and remembers it as the last one sent. Called with
+// usb->mLock held.
+void notifyPortStatusLocked(android::hardware::usb::Usb *usb,
+                            const std::vector<PortStatus> &currentPortStatus, Status status) {
+    usb->mPortStatus = currentPortStatus;
+    usb->mPortStatusResult = status;
+    usb->mPortStatusValid = true;
+    if (usb->mCallback != NULL) {
+        ScopedAStatus ret = usb->mCallback->notifyPortStatusChange(currentPortStatus,
+            status);
+        if (!ret.isOk())
+            ALOGE("queryPortStatus error %s", ret.getDescription().c_str());
+    } else {
+        ALOGI("Notifying userspace skipped. Callback is NULL");
+    }
+}
+
 void queryVersionHelper(android::hardware::usb::Usb *usb,
                         std::vector<PortStatus> *currentPortStatus) {
     Status status;
     pthread_mutex_lock(&usb->mLock);
     status = getPortStatusHelper(currentPortStatus);
     queryMoistureDetectionStatus(currentPortStatus);
-    if (usb->mCallback != NULL) {
-        ScopedAStatus ret = usb->mCallback->notifyPortStatusChange(*currentPortStatus,
-            status);
-        if (!ret.isOk())
-            ALOGE("queryPortStatus error %s", ret.getDescription().c_str());
+    notifyPortStatusLocked(usb, *currentPortStatus, status);
+    pthread_mutex_unlock(&usb->mLock);
+}
+
+// Re-reads the status of the given ports only, or of every port if no port is given or the status
+// of one is not known yet, and notifies the callback only if the status changed since the last
+// notification.
+void updatePortStatusHelper(android::hardware::usb::Usb *usb,
+                            const std::unordered_set<string> &changedPorts,
+                            std::vector<PortStatus> *currentPortStatus) {
+    Status status = Status::SUCCESS;
+    pthread_mutex_lock(&usb->mLock);
+    bool incremental = usb->mPortStatusValid && usb->mPortStatusResult == Status::SUCCESS &&
+                       !changedPorts.empty();
+    if (incremental) {
+        *currentPortStatus = usb->mPortStatus;
+        for (const string &portName : changedPorts) {
+            auto it = std::find_if(currentPortStatus->begin(), currentPortStatus->end(),
+                                   [&portName](const PortStatus &portStatus) {
+                                       return portStatus.portName == portName;
+                                   });
+            std::vector<PortStatus> portStatus(1);
+            bool connected = !access((kTypecPath + portName + "-partner").c_str(), F_OK);
+            if (it == currentPortStatus->end() ||
+                getOnePortStatusHelper(portName, connected, &portStatus[0]) != Status::SUCCESS) {
+                incremental = false;
+                break;
+            }
+            queryMoistureDetectionStatus(&portStatus);
+            *it = portStatus[0];
+        }
+    }
+    if (!incremental) {
+        currentPortStatus->clear();
+        status = getPortStatusHelper(currentPortStatus);
+        queryMoistureDetectionStatus(currentPortStatus);
+    }
+
+    if (usb->mPortStatusValid && status == usb->mPortStatusResult &&
+        *currentPortStatus == usb->mPortStatus) {
+        ALOGI("Port status unchanged, not notifying userspace");
     } else {
-        ALOGI("Notifying userspace skipped. Callback is NULL");
+        notifyPortStatusLocked(usb, *currentPortStatus, status);
     }
     pthread_mutex_unlock(&usb->mLock);
 }
@@ -579,8 +685,63 @@ ScopedAStatus Usb::enableContaminantPresenceDetection(const string& in_portName,
 struct data {
     int uevent_fd;
     ::aidl::android::hardware::usb::Usb *usb;
+    // Set when a typec uevent was received and the port status has not been updated since.
+    bool typec_changed;
+    std::chrono::steady_clock::time_point typec_changed_time;
+    // The ports named by those uevents, or all of them if one could not be attributed to a port.
+    std::unordered_set<string> typec_changed_ports;
+    bool typec_all_ports_changed;
 };
 
+// Returns the port a typec uevent is about from its DEVPATH, e.g. port0 for
+// DEVPATH=/devices/.../typec/port0/port0-partner/port0-partner.0, or an empty string.
+static string typecPortFromDevPath(const char *devPath) {
+    const char *name = strrchr(devPath, '/');
+    string port(name ? name + 1 : devPath);
+
+    port = port.substr(0, port.find_first_of("-."));
+    return port.rfind("port", 0) == 0 ? port : "";
+}
+
+// Matches "add@<path>-partner", the uevent of a partner being attached.
+static bool isPartnerAddEvent(const char *cp) {
+    constexpr char kAdd[] = "add";
+    constexpr char kPartner[] = "-partner";
+    size_t len = strlen(cp);
+
+    return len >= strlen(kAdd) + strlen(kPartner) && !strncmp(cp, kAdd, strlen(kAdd)) &&
+           !strcmp(cp + len - strlen(kPartner), kPartner);
+}
+
+// Sends the port status once for a burst of typec uevents, if it changed.
+static void typec_changed(struct data *payload) {
+    std::vector<PortStatus> currentPortStatus;
+
+    payload->typec_changed = false;
+    if (payload->typec_all_ports_changed) {
+        payload->typec_changed_ports.clear();
+    }
+    payload->typec_all_ports_changed = false;
+    updatePortStatusHelper(payload->usb, payload->typec_changed_ports, &currentPortStatus);
+    payload->typec_changed_ports.clear();
+
+    // Role switch is not in progress and port is in disconnected state
+    if (!pthread_mutex_trylock(&payload->usb->mRoleSwitchLock)) {
+        for (unsigned long i = 0; i < currentPortStatus.size(); i++) {
+            DIR *dp =
+                opendir(string(kTypecPath +
+                               string(currentPortStatus[i].portName.c_str()) +
+                               "-partner").c_str());
+            if (dp == NULL) {
+                switchToDrp(currentPortStatus[i].portName);
+            } else {
+                closedir(dp);
+            }
+        }
+        pthread_mutex_unlock(&payload->usb->mRoleSwitchLock);
+    }
+}
+
 static void uevent_event(uint32_t /*epevents*/, struct data *payload) {
     char msg[UEVENT_MSG_LEN + 2];
     char *cp;
@@ -595,32 +756,27 @@ static void uevent_event(uint32_t /*epevents*/, struct data *payload) {
     msg[n] = '\0';
     msg[n + 1] = '\0';
     cp = msg;
+    string port;
 
     while (*cp) {
-        if (std::regex_match(cp, std::regex("(add)(.*)(-partner)"))) {
+        if (isPartnerAddEvent(cp)) {
             ALOGI("partner added");
             pthread_mutex_lock(&payload->usb->mPartnerLock);
             payload->usb->mPartnerUp = true;
             pthread_cond_signal(&payload->usb->mPartnerCV);
             pthread_mutex_unlock(&payload->usb->mPartnerLock);
+        } else if (!strncmp(cp, "DEVPATH=", strlen("DEVPATH="))) {
+            port = typecPortFromDevPath(cp + strlen("DEVPATH="));
         } else if (!strncmp(cp, "DEVTYPE=typec_", strlen("DEVTYPE=typec_"))) {
-            std::vector<PortStatus> currentPortStatus;
-            queryVersionHelper(payload->usb, &currentPortStatus);
-
-            // Role switch is not in progress and port is in disconnected state
-            if (!pthread_mutex_trylock(&payload->usb->mRoleSwitchLock)) {
-                for (unsigned long i = 0; i < currentPortStatus.size(); i++) {
-                    DIR *dp =
-                        opendir(string(kTypecPath +
-                                       string(currentPortStatus[i].portName.c_str()) +
-                                       "-partner").c_str());
-                    if (dp == NULL) {
-                        switchToDrp(currentPortStatus[i].portName);
-                    } else {
-                        closedir(dp);
-                    }
-                }
-                pthread_mutex_unlock(&payload->usb->mRoleSwitchLock);
+            if (port.empty()) {
+                payload->typec_all_ports_changed = true;
+            } else {
+                payload->typec_changed_ports.insert(port);
+            }
+            // The port status is sent by the worker once the burst is over.
+            if (!payload->typec_changed) {
+                payload->typec_changed = true;
+                payload->typec_changed_time = std::chrono::steady_clock::now();
             }
             break;
         } /* advance to after the next \0 */
@@ -644,6 +800,8 @@ void *work(void *param) {
 
     payload.uevent_fd = uevent_fd;
     payload.usb = (::aidl::android::hardware::usb::Usb *)param;
+    payload.typec_changed = false;
+    payload.typec_all_ports_changed = false;
 
     fcntl(uevent_fd, F_SETFL, O_NONBLOCK);
 
@@ -663,8 +821,19 @@ void *work(void *param) {
 
     while (!destroyThread) {
         struct epoll_event events[UEVENT_MAX_EVENTS];
+        int timeout = -1;
+
+        if (payload.typec_changed) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - payload.typec_changed_time).count();
+            if (elapsed >= kUeventDebounceMs) {
+                typec_changed(&payload);
+                continue;
+            }
+            timeout = kUeventDebounceMs - elapsed;
+        }
 
-        nevents = epoll_wait(epoll_fd, events, UEVENT_MAX_EVENTS, -1);
+        nevents = epoll_wait(epoll_fd, events, UEVENT_MAX_EVENTS, timeout);
         if (nevents == -1) {
             if (errno == EINTR)
                 continue;
@@ -702,6 +871,8 @@ ScopedAStatus Usb::setCallback(
         const shared_ptr<IUsbCallback>& in_callback) {
 
     pthread_mutex_lock(&mLock);
+    // A new callback has not seen any port status yet.
+    mPortStatusValid = false;
     if ((mCallback == NULL && in_callback == NULL) ||
             (mCallback != NULL && in_callback != NULL)) {
         mCallback = in_callback;
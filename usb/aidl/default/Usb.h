@@ -72,6 +72,10 @@ struct Usb : public BnUsb {
     pthread_mutex_t mPartnerLock;
     // Variable to signal partner coming back online after type switch
     bool mPartnerUp;
+    // The last port status sent to mCallback, protected by mLock
+    std::vector<PortStatus> mPortStatus;
+    Status mPortStatusResult;
+    bool mPortStatusValid;
   private:
     pthread_t mPoll;
 };
@@ -17,6 +17,7 @@
 #define LOG_TAG "android.hardware.usb.gadget@1.1-service"
 
 #include "UsbGadget.h"
+#include <algorithm>
 #include <dirent.h>
 #include <fcntl.h>
 #include <stdio.h>
@@ -43,6 +44,50 @@ UsbGadget::UsbGadget() {
 void currentFunctionsAppliedCallback(bool functionsApplied, void* payload) {
     UsbGadget* gadget = (UsbGadget*)payload;
     gadget->mCurrentUsbFunctionsApplied = functionsApplied;
+    if (functionsApplied) gadget->recordSwitchDone();
+}
+
+void UsbGadget::recordSwitchDone() {
+    std::lock_guard<std::mutex> lock(mLockSwitchStats);
+    // Later pull ups come from the ffs daemons restarting, not from a switch.
+    if (!mSwitchPending) return;
+    mSwitchPending = false;
+
+    int64_t latencyUs = duration_cast<microseconds>(steady_clock::now() - mSwitchStart).count();
+    mSwitchStats.switches++;
+    mSwitchStats.lastUs = latencyUs;
+    mSwitchStats.sumUs += latencyUs;
+    mSwitchStats.maxUs = std::max(mSwitchStats.maxUs, latencyUs);
+    ALOGI("Usb functions 0x%llx applied in %lld us",
+          static_cast<unsigned long long>(mCurrentUsbFunctions),
+          static_cast<long long>(latencyUs));
+}
+
+Return<void> UsbGadget::debug(const hidl_handle& handle, const hidl_vec<hidl_string>&) {
+    if (handle == nullptr || handle->numFds < 1) return Void();
+    int fd = handle->data[0];
+
+    SwitchStats stats;
+    {
+        std::lock_guard<std::mutex> lock(mLockSwitchStats);
+        stats = mSwitchStats;
+    }
+    MonitorFfs::PullUpStats pullUpStats = monitorFfs.getPullUpStats();
+
+    dprintf(fd, "Current functions 0x%llx %s\n",
+            static_cast<unsigned long long>(mCurrentUsbFunctions),
+            mCurrentUsbFunctionsApplied ? "applied" : "not applied");
+    dprintf(fd, "%llu switches, latency last %lld us, avg %lld us, max %lld us\n",
+            static_cast<unsigned long long>(stats.switches), static_cast<long long>(stats.lastUs),
+            static_cast<long long>(stats.switches ? stats.sumUs / (int64_t)stats.switches : 0),
+            static_cast<long long>(stats.maxUs));
+    dprintf(fd,
+            "%llu ffs pull ups, %llu delayed by %lld us in total, last ready to pull up %lld us\n",
+            static_cast<unsigned long long>(pullUpStats.pullUps),
+            static_cast<unsigned long long>(pullUpStats.delayedPullUps),
+            static_cast<long long>(pullUpStats.delaySumUs),
+            static_cast<long long>(pullUpStats.lastReadyToPullUpUs));
+    return Void();
 }
 
 Return<void> UsbGadget::getCurrentUsbFunctions(const sp<V1_0::IUsbGadgetCallback>& callback) {
@@ -56,6 +101,7 @@ Return<void> UsbGadget::getCurrentUsbFunctions(const sp<V1_0::IUsbGadgetCallback
 
 V1_0::Status UsbGadget::tearDownGadget() {
     if (resetGadget() != V1_0::Status::SUCCESS) return V1_0::Status::ERROR;
+    monitorFfs.notePullDown();
 
     if (monitorFfs.isMonitorRunning()) {
         monitorFfs.reset();
@@ -146,10 +192,13 @@ V1_0::Status UsbGadget::setupFunctions(uint64_t functions,
         if (addAdb(&monitorFfs, &i) != V1_0::Status::SUCCESS) return V1_0::Status::ERROR;
     }
 
-    // Pull up the gadget right away when there are no ffs functions.
+    // Pull up the gadget as soon as the host has had time to sense the
+    // disconnect when there are no ffs functions.
     if (!ffsEnabled) {
+        monitorFfs.waitSincePullDown(kDisconnectWaitUs);
         if (!WriteStringToFile(kGadgetName, PULLUP_PATH)) return V1_0::Status::ERROR;
         mCurrentUsbFunctionsApplied = true;
+        recordSwitchDone();
         if (callback) callback->setCurrentUsbFunctionsCb(functions, V1_0::Status::SUCCESS);
         return V1_0::Status::SUCCESS;
     }
@@ -179,6 +228,11 @@ Return<void> UsbGadget::setCurrentUsbFunctions(uint64_t functions,
 
     mCurrentUsbFunctions = functions;
     mCurrentUsbFunctionsApplied = false;
+    {
+        std::lock_guard<std::mutex> lock(mLockSwitchStats);
+        mSwitchStart = steady_clock::now();
+        mSwitchPending = true;
+    }
 
     // Unlink the gadget and stop the monitor if running.
     V1_0::Status status = tearDownGadget();
@@ -188,10 +242,12 @@ Return<void> UsbGadget::setCurrentUsbFunctions(uint64_t functions,
 
     ALOGI("Returned from tearDown gadget");
 
-    // Leave the gadget pulled down to give time for the host to sense disconnect.
-    usleep(kDisconnectWaitUs);
+    // The gadget stays pulled down for the host to sense the disconnect
+    // while the new functions are set up; the pull up waits for whatever
+    // is left of that time.
 
     if (functions == static_cast<uint64_t>(V1_0::GadgetFunction::NONE)) {
+        recordSwitchDone();
         if (callback == NULL) return Void();
         Return<void> ret = callback->setCurrentUsbFunctionsCb(functions, V1_0::Status::SUCCESS);
         if (!ret.isOk())
@@ -215,6 +271,10 @@ Return<void> UsbGadget::setCurrentUsbFunctions(uint64_t functions,
 
 error:
     ALOGI("Usb Gadget setcurrent functions failed");
+    {
+        std::lock_guard<std::mutex> lock(mLockSwitchStats);
+        mSwitchPending = false;
+    }
     if (callback == NULL) return Void();
     Return<void> ret = callback->setCurrentUsbFunctionsCb(functions, status);
     if (!ret.isOk())
@@ -46,6 +46,7 @@ using ::android::base::SetProperty;
 using ::android::base::unique_fd;
 using ::android::base::WriteStringToFile;
 using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_memory;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
@@ -74,6 +75,21 @@ struct UsbGadget : public IUsbGadget {
     uint64_t mCurrentUsbFunctions;
     bool mCurrentUsbFunctionsApplied;
 
+    struct SwitchStats {
+        uint64_t switches = 0;
+        // From setCurrentUsbFunctions() to the gadget being pulled up.
+        int64_t lastUs = 0;
+        int64_t sumUs = 0;
+        int64_t maxUs = 0;
+    };
+    // Protects mSwitchStats, mSwitchStart and mSwitchPending.
+    std::mutex mLockSwitchStats;
+    SwitchStats mSwitchStats;
+    steady_clock::time_point mSwitchStart;
+    bool mSwitchPending = false;
+    // Records the latency of the pending function switch, if any.
+    void recordSwitchDone();
+
     Return<void> setCurrentUsbFunctions(uint64_t functions,
                                         const sp<V1_0::IUsbGadgetCallback>& callback,
                                         uint64_t timeout) override;
@@ -82,6 +98,8 @@ struct UsbGadget : public IUsbGadget {
 
     Return<Status> reset() override;
 
+    Return<void> debug(const hidl_handle& handle, const hidl_vec<hidl_string>& options) override;
+
   private:
     V1_0::Status tearDownGadget();
     V1_0::Status setupFunctions(uint64_t functions, const sp<V1_0::IUsbGadgetCallback>& callback,
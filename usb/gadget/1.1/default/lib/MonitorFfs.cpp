@@ -32,6 +32,7 @@ MonitorFfs::MonitorFfs(const char* const gadget)
       mCv(),
       mLockFd(),
       mCurrentUsbFunctionsApplied(false),
+      mPullDownTime(),
       mMonitor(),
       mCallback(NULL),
       mPayload(NULL),
@@ -91,33 +92,72 @@ static void displayInotifyEvent(struct inotify_event* i) {
     if (i->len > 0) ALOGE("        name = %s\n", i->name);
 }
 
+static bool allEndpointsPresent(const vector<string>& endpoints) {
+    for (const string& endpoint : endpoints) {
+        if (access(endpoint.c_str(), R_OK)) {
+            if (kDebug) ALOGI("%s absent", endpoint.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t MonitorFfs::waitSincePullDown(int delayUs) {
+    steady_clock::time_point pullDownTime;
+    {
+        lock_guard<mutex> lock(mLock);
+        pullDownTime = mPullDownTime;
+    }
+
+    int64_t remainingUs =
+            delayUs - duration_cast<microseconds>(steady_clock::now() - pullDownTime).count();
+    if (remainingUs <= 0) return 0;
+    usleep(remainingUs);
+    return remainingUs;
+}
+
+void MonitorFfs::notePullDown() {
+    lock_guard<mutex> lock(mLock);
+    mPullDownTime = steady_clock::now();
+}
+
+MonitorFfs::PullUpStats MonitorFfs::getPullUpStats() {
+    lock_guard<mutex> lock(mLock);
+    return mStats;
+}
+
+int64_t MonitorFfs::pullUp() {
+    steady_clock::time_point ready = steady_clock::now();
+    int64_t delayUs = waitSincePullDown(kPullUpDelay);
+
+    if (!WriteStringToFile(mGadgetName, PULLUP_PATH)) return -1;
+
+    lock_guard<mutex> lock(mLock);
+    mCurrentUsbFunctionsApplied = true;
+    mCallback(mCurrentUsbFunctionsApplied, mPayload);
+    gadgetPullup = true;
+    mStats.pullUps++;
+    if (delayUs > 0) {
+        mStats.delayedPullUps++;
+        mStats.delaySumUs += delayUs;
+    }
+    mStats.lastReadyToPullUpUs =
+            duration_cast<microseconds>(steady_clock::now() - ready).count();
+    ALOGI("GADGET pulled up after %lld us", static_cast<long long>(mStats.lastReadyToPullUpUs));
+    // notify the main thread to signal userspace.
+    mCv.notify_all();
+    return delayUs;
+}
+
 void* MonitorFfs::startMonitorFd(void* param) {
     MonitorFfs* monitorFfs = (MonitorFfs*)param;
     char buf[kBufferSize];
     bool writeUdc = true, stopMonitor = false;
     struct epoll_event events[kEpollEvents];
-    steady_clock::time_point disconnect;
 
-    bool descriptorWritten = true;
-    for (int i = 0; i < static_cast<int>(monitorFfs->mEndpointList.size()); i++) {
-        if (access(monitorFfs->mEndpointList.at(i).c_str(), R_OK)) {
-            descriptorWritten = false;
-            break;
-        }
-    }
-
-    // notify here if the endpoints are already present.
-    if (descriptorWritten) {
-        usleep(kPullUpDelay);
-        if (!!WriteStringToFile(monitorFfs->mGadgetName, PULLUP_PATH)) {
-            lock_guard<mutex> lock(monitorFfs->mLock);
-            monitorFfs->mCurrentUsbFunctionsApplied = true;
-            monitorFfs->mCallback(monitorFfs->mCurrentUsbFunctionsApplied, monitorFfs->mPayload);
-            gadgetPullup = true;
-            writeUdc = false;
-            ALOGI("GADGET pulled up");
-            monitorFfs->mCv.notify_all();
-        }
+    // pull up here if the endpoints are already present.
+    if (allEndpointsPresent(monitorFfs->mEndpointList) && monitorFfs->pullUp() >= 0) {
+        writeUdc = false;
     }
 
     while (!stopMonitor) {
@@ -129,49 +169,29 @@ void* MonitorFfs::startMonitorFd(void* param) {
         }
 
         for (int i = 0; i < nrEvents; i++) {
-            ALOGI("event=%u on fd=%d\n", events[i].events, events[i].data.fd);
+            if (kDebug) ALOGI("event=%u on fd=%d\n", events[i].events, events[i].data.fd);
 
             if (events[i].data.fd == monitorFfs->mInotifyFd) {
-                // Process all of the events in buffer returned by read().
+                // Drain all of the events in the buffer returned by read(),
+                // then check the endpoints once for the whole batch.
                 int numRead = read(monitorFfs->mInotifyFd, buf, kBufferSize);
-                for (char* p = buf; p < buf + numRead;) {
-                    struct inotify_event* event = (struct inotify_event*)p;
-                    if (kDebug) displayInotifyEvent(event);
-
-                    p += sizeof(struct inotify_event) + event->len;
-
-                    bool descriptorPresent = true;
-                    for (int j = 0; j < static_cast<int>(monitorFfs->mEndpointList.size()); j++) {
-                        if (access(monitorFfs->mEndpointList.at(j).c_str(), R_OK)) {
-                            if (kDebug) ALOGI("%s absent", monitorFfs->mEndpointList.at(j).c_str());
-                            descriptorPresent = false;
-                            break;
-                        }
+                if (numRead <= 0) continue;
+                if (kDebug) {
+                    for (char* p = buf; p < buf + numRead;) {
+                        struct inotify_event* event = (struct inotify_event*)p;
+                        displayInotifyEvent(event);
+                        p += sizeof(struct inotify_event) + event->len;
                     }
+                }
 
-                    if (!descriptorPresent && !writeUdc) {
-                        if (kDebug) ALOGI("endpoints not up");
-                        writeUdc = true;
-                        disconnect = std::chrono::steady_clock::now();
-                    } else if (descriptorPresent && writeUdc) {
-                        steady_clock::time_point temp = steady_clock::now();
-
-                        if (std::chrono::duration_cast<microseconds>(temp - disconnect).count() <
-                            kPullUpDelay)
-                            usleep(kPullUpDelay);
-
-                        if (!!WriteStringToFile(monitorFfs->mGadgetName, PULLUP_PATH)) {
-                            lock_guard<mutex> lock(monitorFfs->mLock);
-                            monitorFfs->mCurrentUsbFunctionsApplied = true;
-                            monitorFfs->mCallback(monitorFfs->mCurrentUsbFunctionsApplied,
-                                                  monitorFfs->mPayload);
-                            ALOGI("GADGET pulled up");
-                            writeUdc = false;
-                            gadgetPullup = true;
-                            // notify the main thread to signal userspace.
-                            monitorFfs->mCv.notify_all();
-                        }
-                    }
+                bool descriptorPresent = allEndpointsPresent(monitorFfs->mEndpointList);
+                if (!descriptorPresent && !writeUdc) {
+                    if (kDebug) ALOGI("endpoints not up");
+                    writeUdc = true;
+                    // The gadget goes down with the endpoints.
+                    monitorFfs->notePullDown();
+                } else if (descriptorPresent && writeUdc) {
+                    if (monitorFfs->pullUp() >= 0) writeUdc = false;
                 }
             } else {
                 uint64_t flag;
@@ -50,6 +50,7 @@ using ::android::base::Trim;
 using ::android::base::unique_fd;
 using ::android::base::WriteStringToFile;
 using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_memory;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
@@ -82,6 +83,21 @@ struct UsbGadget : public IUsbGadget {
     bool mCurrentUsbFunctionsApplied;
     UsbSpeed mUsbSpeed;
 
+    struct SwitchStats {
+        uint64_t switches = 0;
+        // From setCurrentUsbFunctions() to the gadget being pulled up.
+        int64_t lastUs = 0;
+        int64_t sumUs = 0;
+        int64_t maxUs = 0;
+    };
+    // Protects mSwitchStats, mSwitchStart and mSwitchPending.
+    std::mutex mLockSwitchStats;
+    SwitchStats mSwitchStats;
+    steady_clock::time_point mSwitchStart;
+    bool mSwitchPending = false;
+    // Records the latency of the pending function switch, if any.
+    void recordSwitchDone();
+
     Return<void> setCurrentUsbFunctions(uint64_t functions,
                                         const sp<V1_0::IUsbGadgetCallback>& callback,
                                         uint64_t timeout) override;
@@ -90,6 +106,8 @@ struct UsbGadget : public IUsbGadget {
 
     Return<Status> reset() override;
 
+    Return<void> debug(const hidl_handle& handle, const hidl_vec<hidl_string>& options) override;
+
     Return<void> getUsbSpeed(const sp<V1_2::IUsbGadgetCallback>& callback) override;
 
   private:
@@ -89,6 +89,7 @@ using ::std::string;
 using ::std::thread;
 using ::std::unique_ptr;
 using ::std::vector;
+using ::std::chrono::duration_cast;
 using ::std::chrono::microseconds;
 using ::std::chrono::steady_clock;
 using ::std::literals::chrono_literals::operator""ms;
@@ -118,6 +119,9 @@ class MonitorFfs {
 
     // Flag to maintain the current status of gadget pullup.
     bool mCurrentUsbFunctionsApplied;
+    // When the gadget was last pulled down, for the host to sense the
+    // disconnect before the next pull up. Protected by mLock.
+    steady_clock::time_point mPullDownTime;
 
     // Thread object that executes the ep monitoring logic.
     unique_ptr<thread> mMonitor;
@@ -129,6 +133,25 @@ class MonitorFfs {
     // Monitor State
     bool mMonitorRunning;
 
+  public:
+    struct PullUpStats {
+        uint64_t pullUps = 0;
+        // Pull ups that had to wait for the host to sense the disconnect.
+        uint64_t delayedPullUps = 0;
+        int64_t delaySumUs = 0;
+        // From the endpoints being ready to the gadget being pulled up.
+        int64_t lastReadyToPullUpUs = 0;
+    };
+
+  private:
+    // Protected by mLock.
+    PullUpStats mStats;
+
+    // Waits for the rest of kPullUpDelay since the last pull down, pulls
+    // up the gadget and notifies the waiters. Returns the delay in us, or
+    // -1 if the gadget could not be pulled up.
+    int64_t pullUp();
+
   public:
     MonitorFfs(const char* const gadget);
     // Inits all the UniqueFds.
@@ -148,6 +171,12 @@ class MonitorFfs {
     void registerFunctionsAppliedCallback(void (*callback)(bool functionsApplied, void*(payload)),
                                           void* payload);
     bool isMonitorRunning();
+    // Records that the gadget has just been pulled down.
+    void notePullDown();
+    // Sleeps until delayUs have passed since the last pull down, if they
+    // have not already. Returns the time slept in us.
+    int64_t waitSincePullDown(int delayUs);
+    PullUpStats getPullUpStats();
     // Ep monitoring and the gadget pull up logic.
     static void* startMonitorFd(void* param);
 };
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2021, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uci_transport.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <android-base/logging.h>
+
+namespace {
+// UCI packet header, from the FiRa UCI Generic Specification:
+//   octet 0: message type (bits 7-5), packet boundary flag (bit 4), group id (bits 3-0)
+//   octet 1: opcode id (bits 5-0)
+//   octet 2-3: payload length, on octet 3 for control packets and 16 bits little endian for
+//   data packets.
+constexpr size_t kUciHeaderSize = 4;
+constexpr uint8_t kMessageTypeShift = 5;
+constexpr uint8_t kMessageTypeData = 0;
+constexpr uint8_t kMessageTypeNotification = 3;
+constexpr uint8_t kPacketBoundaryFlag = 0x10;
+constexpr uint8_t kGroupIdMask = 0x0f;
+constexpr uint8_t kOpcodeIdMask = 0x3f;
+constexpr uint8_t kGroupRangingSessionControl = 0x02;
+constexpr uint8_t kOpcodeRangeDataNotification = 0x00;
+
+constexpr size_t kReadSize = 4096;
+
+bool isDataPacket(const uint8_t* header) {
+    return (header[0] >> kMessageTypeShift) == kMessageTypeData;
+}
+
+size_t payloadLength(const uint8_t* header) {
+    if (isDataPacket(header)) return header[2] | (header[3] << 8);
+    return header[3];
+}
+
+void setPayloadLength(size_t length, uint8_t* header) {
+    if (isDataPacket(header)) {
+        header[2] = length & 0xff;
+        header[3] = (length >> 8) & 0xff;
+    } else {
+        header[3] = length;
+    }
+}
+
+bool isRangeDataNotification(const uint8_t* header) {
+    return (header[0] >> kMessageTypeShift) == kMessageTypeNotification &&
+           (header[0] & kPacketBoundaryFlag) == 0 &&
+           (header[0] & kGroupIdMask) == kGroupRangingSessionControl &&
+           (header[1] & kOpcodeIdMask) == kOpcodeRangeDataNotification;
+}
+}  // namespace
+
+namespace android {
+namespace hardware {
+namespace uwb {
+namespace impl {
+
+UciTransport::UciTransport(const Options& options) : mOptions(options) {}
+
+UciTransport::~UciTransport() {
+    close();
+}
+
+bool UciTransport::open(const std::string& device, Receiver receiver,
+                        ErrorHandler errorHandler) {
+    ::android::base::unique_fd fd(
+            TEMP_FAILURE_RETRY(::open(device.c_str(), O_RDWR | O_CLOEXEC | O_NONBLOCK)));
+    if (fd.get() < 0) {
+        PLOG(ERROR) << "Cannot open " << device;
+        close();
+        return false;
+    }
+    return open(std::move(fd), std::move(receiver), std::move(errorHandler));
+}
+
+bool UciTransport::open(::android::base::unique_fd fd, Receiver receiver,
+                        ErrorHandler errorHandler) {
+    close();
+    if (fcntl(fd.get(), F_SETFL, fcntl(fd.get(), F_GETFL) | O_NONBLOCK) < 0) {
+        PLOG(ERROR) << "Cannot make the UWB device non-blocking";
+        return false;
+    }
+    mStopFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (mStopFd.get() < 0) {
+        PLOG(ERROR) << "Cannot create the eventfd of the reader";
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mWriteLock);
+        mFd = std::move(fd);
+    }
+    mReceiver = std::move(receiver);
+    mErrorHandler = std::move(errorHandler);
+    mReadBuffer.clear();
+    mBatch.clear();
+    mInSegmentedPacket = false;
+    mReader = std::thread(&UciTransport::readerLoop, this);
+    return true;
+}
+
+void UciTransport::close() {
+    if (mReader.joinable()) {
+        uint64_t one = 1;
+        if (TEMP_FAILURE_RETRY(write(mStopFd.get(), &one, sizeof(one))) < 0) {
+            PLOG(ERROR) << "Cannot stop the reader";
+        }
+        mReader.join();
+    }
+    mStopFd.reset();
+    {
+        std::lock_guard<std::mutex> lock(mWriteLock);
+        mFd.reset();
+    }
+    mReceiver = nullptr;
+    mErrorHandler = nullptr;
+}
+
+int32_t UciTransport::send(const std::vector<uint8_t>& packet) {
+    if (packet.size() < kUciHeaderSize ||
+        payloadLength(packet.data()) != packet.size() - kUciHeaderSize) {
+        LOG(ERROR) << "Malformed UCI packet of " << packet.size() << " bytes";
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(mWriteLock);
+    if (mFd.get() < 0) return -1;
+
+    const size_t payloadSize = packet.size() - kUciHeaderSize;
+    if (payloadSize <= mOptions.maxPacketPayload) {
+        if (TEMP_FAILURE_RETRY(write(mFd.get(), packet.data(), packet.size())) !=
+            static_cast<ssize_t>(packet.size())) {
+            PLOG(ERROR) << "Cannot write a UCI packet";
+            return -1;
+        }
+        return packet.size();
+    }
+
+    // Segments with the same header, all but the last one with the packet boundary flag.
+    std::vector<uint8_t> segment;
+    for (size_t offset = 0; offset < payloadSize; offset += mOptions.maxPacketPayload) {
+        const size_t length = std::min(mOptions.maxPacketPayload, payloadSize - offset);
+        const auto payload = packet.begin() + kUciHeaderSize + offset;
+        segment.assign(packet.begin(), packet.begin() + kUciHeaderSize);
+        segment.insert(segment.end(), payload, payload + length);
+        if (offset + length < payloadSize) {
+            segment[0] |= kPacketBoundaryFlag;
+        }
+        setPayloadLength(length, segment.data());
+        if (TEMP_FAILURE_RETRY(write(mFd.get(), segment.data(), segment.size())) !=
+            static_cast<ssize_t>(segment.size())) {
+            PLOG(ERROR) << "Cannot write a UCI segment";
+            return -1;
+        }
+    }
+    return packet.size();
+}
+
+void UciTransport::readerLoop() {
+    uint8_t buffer[kReadSize];
+    while (true) {
+        pollfd fds[] = {{mFd.get(), POLLIN, 0}, {mStopFd.get(), POLLIN, 0}};
+        timespec timeout;
+        int ret = TEMP_FAILURE_RETRY(
+                ppoll(fds, std::size(fds), batchTimeout(&timeout) ? &timeout : nullptr, nullptr));
+        if (ret < 0) {
+            PLOG(ERROR) << "Cannot poll the UWB device";
+            break;
+        }
+        if (fds[1].revents != 0) {
+            flushBatch();
+            return;
+        }
+        if (ret == 0) {
+            // The oldest ranging notification waited for as long as it could.
+            flushBatch();
+            continue;
+        }
+        if (fds[0].revents & (POLLERR | POLLHUP)) {
+            LOG(ERROR) << "The UWB device is gone";
+            break;
+        }
+
+        ssize_t size = TEMP_FAILURE_RETRY(read(mFd.get(), buffer, sizeof(buffer)));
+        if (size < 0 && errno == EAGAIN) continue;
+        if (size <= 0) {
+            PLOG(ERROR) << "Cannot read from the UWB device";
+            break;
+        }
+        mReadBuffer.insert(mReadBuffer.end(), buffer, buffer + size);
+
+        size_t offset = 0;
+        const uint8_t* packet;
+        size_t packetSize;
+        while (nextPacket(&offset, &packet, &packetSize)) {
+            onPacket(packet, packetSize);
+        }
+        // The start of a packet the next read completes.
+        mReadBuffer.erase(mReadBuffer.begin(), mReadBuffer.begin() + offset);
+    }
+    flushBatch();
+    mErrorHandler();
+}
+
+// Returns segments one by one, they are not reassembled.
+bool UciTransport::nextPacket(size_t* offset, const uint8_t** packet, size_t* size) const {
+    const size_t available = mReadBuffer.size() - *offset;
+    if (available < kUciHeaderSize) return false;
+    const uint8_t* header = mReadBuffer.data() + *offset;
+    const size_t packetSize = kUciHeaderSize + payloadLength(header);
+    if (available < packetSize) return false;
+    *packet = header;
+    *size = packetSize;
+    *offset += packetSize;
+    return true;
+}
+
+void UciTransport::onPacket(const uint8_t* packet, size_t size) {
+    // The last segment of a packet has no boundary flag, but is not a whole notification.
+    const bool continuesPacket = mInSegmentedPacket;
+    mInSegmentedPacket = (packet[0] & kPacketBoundaryFlag) != 0;
+    if (mOptions.rangeDataBatchLatency.count() > 0 && !continuesPacket &&
+        isRangeDataNotification(packet)) {
+        if (!mBatch.empty() && mBatch.size() + size > mOptions.maxBatchSize) {
+            flushBatch();
+        }
+        if (mBatch.empty()) {
+            mBatchStart = Clock::now();
+        }
+        mBatch.insert(mBatch.end(), packet, packet + size);
+        return;
+    }
+    flushBatch();
+    mReceiver(std::vector<uint8_t>(packet, packet + size));
+}
+
+void UciTransport::flushBatch() {
+    if (mBatch.empty()) return;
+    mReceiver(mBatch);
+    mBatch.clear();
+}
+
+bool UciTransport::batchTimeout(timespec* timeout) const {
+    if (mBatch.empty()) return false;
+    const auto remaining = std::max(Clock::duration::zero(),
+                                    mBatchStart + mOptions.rangeDataBatchLatency - Clock::now());
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(remaining);
+    timeout->tv_sec = seconds.count();
+    timeout->tv_nsec = std::chrono::nanoseconds(remaining - seconds).count();
+    return true;
+}
+
+}  // namespace impl
+}  // namespace uwb
+}  // namespace hardware
+}  // namespace android
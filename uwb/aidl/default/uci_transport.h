@@ -0,0 +1,118 @@
+/*
+ * Copyright 2021, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_UWB_UCITRANSPORT
+#define ANDROID_HARDWARE_UWB_UCITRANSPORT
+
+#include <time.h>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/unique_fd.h>
+
+namespace android {
+namespace hardware {
+namespace uwb {
+namespace impl {
+
+// Moves UCI packets between the stack and a UWB character device.
+//
+// Packets sent with a payload larger than the chip takes are segmented. A dedicated reader
+// thread splits what the device returns into packets, whether a read returns part of a packet
+// or several of them, and hands them to the receiver in order. Segments the device returns are
+// handed over as they are, for the stack to reassemble: the header of a control packet cannot
+// tell a payload longer than 255 bytes.
+//
+// With a non-zero batch latency, RANGE_DATA_NTF packets are held for up to that long and handed
+// over together, as consecutive packets in one buffer; each packet is delimited by the length
+// of its header. Any other packet, segments included, first hands over the pending batch, so that
+// the order is kept.
+// This saves a callback per notification when ranging with many anchors, but only works with a
+// stack that splits the buffers it receives.
+class UciTransport {
+  public:
+    using Clock = std::chrono::steady_clock;
+    // Called on the reader thread with one packet, or a batch of them.
+    using Receiver = std::function<void(const std::vector<uint8_t>& packets)>;
+    // Called on the reader thread when the device cannot be read anymore.
+    using ErrorHandler = std::function<void()>;
+
+    struct Options {
+        // The largest payload of a packet the chip takes.
+        size_t maxPacketPayload = 255;
+        // Zero hands every RANGE_DATA_NTF over on its own.
+        std::chrono::microseconds rangeDataBatchLatency{0};
+        // Handed over before it grows past this size.
+        size_t maxBatchSize = 4096;
+    };
+
+    explicit UciTransport(const Options& options);
+    ~UciTransport();
+
+    UciTransport(const UciTransport&) = delete;
+    UciTransport& operator=(const UciTransport&) = delete;
+
+    // open and close must not be called concurrently.
+    bool open(const std::string& device, Receiver receiver, ErrorHandler errorHandler);
+    // Takes a connected UCI endpoint, such as one end of a socket pair in tests.
+    bool open(::android::base::unique_fd fd, Receiver receiver, ErrorHandler errorHandler);
+    void close();
+
+    // Writes one UCI packet, segmented as needed. Returns the number of bytes of |packet|
+    // written, or -1 if it is malformed or the write failed.
+    int32_t send(const std::vector<uint8_t>& packet);
+
+  private:
+    void readerLoop();
+    // Returns the next packet of mReadBuffer from |*offset|, or false if it is not complete yet.
+    bool nextPacket(size_t* offset, const uint8_t** packet, size_t* size) const;
+    void onPacket(const uint8_t* packet, size_t size);
+    void flushBatch();
+    // Returns false when no ranging notification is waiting.
+    bool batchTimeout(timespec* timeout) const;
+
+    const Options mOptions;
+
+    ::android::base::unique_fd mFd;
+    // Wakes the reader thread up to stop.
+    ::android::base::unique_fd mStopFd;
+    Receiver mReceiver;
+    ErrorHandler mErrorHandler;
+    std::thread mReader;
+
+    // Writes of a segmented packet must not interleave with another packet. Also guards the
+    // changes of mFd, which the reader thread only reads while it runs.
+    std::mutex mWriteLock;
+
+    // Only used by the reader thread.
+    std::vector<uint8_t> mReadBuffer;
+    std::vector<uint8_t> mBatch;
+    Clock::time_point mBatchStart;
+    // Set when the last packet was a segment with more to come.
+    bool mInSegmentedPacket = false;
+};
+
+}  // namespace impl
+}  // namespace uwb
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_UWB_UCITRANSPORT
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2022, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "uci_transport.h"
+
+using ::android::base::unique_fd;
+using ::android::hardware::uwb::impl::UciTransport;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Packet = std::vector<uint8_t>;
+
+constexpr auto kTimeout = 2s;
+
+// A response of the UWB core group.
+Packet response(std::vector<uint8_t> payload) {
+    Packet packet = {0x40, 0x02, 0x00, static_cast<uint8_t>(payload.size())};
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return packet;
+}
+
+// A RANGE_DATA_NTF, or a segment of one with |moreSegments|.
+Packet rangeDataNotification(std::vector<uint8_t> payload, bool moreSegments = false) {
+    Packet packet = {static_cast<uint8_t>(moreSegments ? 0x72 : 0x62), 0x00, 0x00,
+                     static_cast<uint8_t>(payload.size())};
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return packet;
+}
+
+Packet dataPacket(size_t payloadSize) {
+    Packet packet = {0x00, 0x00, static_cast<uint8_t>(payloadSize & 0xff),
+                     static_cast<uint8_t>(payloadSize >> 8)};
+    for (size_t i = 0; i < payloadSize; i++) packet.push_back(i);
+    return packet;
+}
+
+Packet concat(std::initializer_list<Packet> packets) {
+    Packet buffer;
+    for (const Packet& packet : packets) buffer.insert(buffer.end(), packet.begin(), packet.end());
+    return buffer;
+}
+
+class UciTransportTest : public ::testing::Test {
+  protected:
+    // Connects the transport, created with |options| the first time, to a new peer.
+    void open(const UciTransport::Options& options = {}) {
+        int fds[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds));
+        mPeer.reset(fds[1]);
+        if (!mTransport) mTransport = std::make_unique<UciTransport>(options);
+        ASSERT_TRUE(mTransport->open(
+                unique_fd(fds[0]),
+                [this](const Packet& packets) {
+                    std::lock_guard<std::mutex> lock(mLock);
+                    mReceived.push_back(packets);
+                    mChanged.notify_all();
+                },
+                [this] {
+                    std::lock_guard<std::mutex> lock(mLock);
+                    mFailed = true;
+                    mChanged.notify_all();
+                }));
+    }
+
+    void TearDown() override {
+        if (mTransport) mTransport->close();
+    }
+
+    void writeToTransport(const Packet& bytes) {
+        ASSERT_EQ(static_cast<ssize_t>(bytes.size()),
+                  write(mPeer.get(), bytes.data(), bytes.size()));
+    }
+
+    Packet readFromTransport(size_t size) {
+        Packet bytes(size);
+        size_t offset = 0;
+        while (offset < size) {
+            ssize_t ret = read(mPeer.get(), bytes.data() + offset, size - offset);
+            if (ret <= 0) break;
+            offset += ret;
+        }
+        bytes.resize(offset);
+        return bytes;
+    }
+
+    // Returns the first |count| buffers handed over, or fewer after kTimeout.
+    std::vector<Packet> awaitReceived(size_t count) {
+        std::unique_lock<std::mutex> lock(mLock);
+        mChanged.wait_for(lock, kTimeout, [&] { return mReceived.size() >= count; });
+        return mReceived;
+    }
+
+    std::unique_ptr<UciTransport> mTransport;
+    unique_fd mPeer;
+
+    std::mutex mLock;
+    std::condition_variable mChanged;
+    std::vector<Packet> mReceived;
+    bool mFailed = false;
+};
+
+TEST_F(UciTransportTest, FramesPacketsOfAnyReadBoundaries) {
+    open();
+    const Packet first = response({1, 2, 3});
+    const Packet second = response({});
+    const Packet third = dataPacket(300);
+
+    // The first packet in two writes, the start of the third one with the second one.
+    writeToTransport(Packet(first.begin(), first.begin() + 2));
+    std::this_thread::sleep_for(20ms);
+    EXPECT_TRUE(awaitReceived(0).empty());
+    Packet rest(first.begin() + 2, first.end());
+    rest.insert(rest.end(), second.begin(), second.end());
+    rest.insert(rest.end(), third.begin(), third.begin() + 100);
+    writeToTransport(rest);
+    std::this_thread::sleep_for(20ms);
+    writeToTransport(Packet(third.begin() + 100, third.end()));
+
+    EXPECT_EQ(std::vector<Packet>({first, second, third}), awaitReceived(3));
+}
+
+TEST_F(UciTransportTest, HandsSegmentsOverAsTheyAre) {
+    open();
+    const Packet first = rangeDataNotification({1, 2}, true);
+    const Packet last = rangeDataNotification({3});
+    writeToTransport(concat({first, last}));
+
+    EXPECT_EQ(std::vector<Packet>({first, last}), awaitReceived(2));
+}
+
+TEST_F(UciTransportTest, SegmentsLongPackets) {
+    UciTransport::Options options;
+    options.maxPacketPayload = 4;
+    open(options);
+
+    Packet packet = {0x21, 0x03, 0x00, 10, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    ASSERT_EQ(static_cast<int32_t>(packet.size()), mTransport->send(packet));
+    EXPECT_EQ(Packet({0x31, 0x03, 0x00, 4, 0, 1, 2, 3, 0x31, 0x03, 0x00, 4, 4, 5, 6, 7, 0x21, 0x03,
+                      0x00, 2, 8, 9}),
+              readFromTransport(22));
+
+    // Data packets have a 16 bit length.
+    packet = dataPacket(6);
+    ASSERT_EQ(static_cast<int32_t>(packet.size()), mTransport->send(packet));
+    EXPECT_EQ(Packet({0x10, 0x00, 4, 0, 0, 1, 2, 3, 0x00, 0x00, 2, 0, 4, 5}),
+              readFromTransport(14));
+}
+
+TEST_F(UciTransportTest, RejectsMalformedPackets) {
+    open();
+    EXPECT_EQ(-1, mTransport->send({0x21, 0x03, 0x00}));
+    EXPECT_EQ(-1, mTransport->send({0x21, 0x03, 0x00, 2, 0}));
+
+    const Packet packet = response({7});
+    EXPECT_EQ(static_cast<int32_t>(packet.size()), mTransport->send(packet));
+    EXPECT_EQ(packet, readFromTransport(packet.size()));
+}
+
+TEST_F(UciTransportTest, BatchesRangeDataNotifications) {
+    UciTransport::Options options;
+    options.rangeDataBatchLatency = 10s;
+    open(options);
+    const Packet first = rangeDataNotification({1});
+    const Packet second = rangeDataNotification({2, 2});
+    const Packet other = response({0});
+
+    // The response hands the notifications over before itself.
+    writeToTransport(concat({first, second}));
+    std::this_thread::sleep_for(20ms);
+    writeToTransport(other);
+
+    EXPECT_EQ(std::vector<Packet>({concat({first, second}), other}), awaitReceived(2));
+}
+
+TEST_F(UciTransportTest, HandsBatchesOverAfterTheLatency) {
+    UciTransport::Options options;
+    options.rangeDataBatchLatency = 50ms;
+    open(options);
+    const Packet notification = rangeDataNotification({1, 2, 3});
+
+    const auto start = std::chrono::steady_clock::now();
+    writeToTransport(notification);
+    EXPECT_EQ(std::vector<Packet>({notification}), awaitReceived(1));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, options.rangeDataBatchLatency);
+}
+
+TEST_F(UciTransportTest, HandsBatchesOverBeforeTheyGrowTooLarge) {
+    UciTransport::Options options;
+    options.rangeDataBatchLatency = 10s;
+    const Packet notification = rangeDataNotification({1, 2, 3});
+    options.maxBatchSize = 2 * notification.size();
+    open(options);
+    const Packet other = response({});
+
+    writeToTransport(concat({notification, notification, notification, other}));
+
+    EXPECT_EQ(std::vector<Packet>(
+                      {concat({notification, notification}), notification, other}),
+              awaitReceived(3));
+}
+
+TEST_F(UciTransportTest, DoesNotBatchSegments) {
+    UciTransport::Options options;
+    options.rangeDataBatchLatency = 10s;
+    open(options);
+    const Packet first = rangeDataNotification({1}, true);
+    const Packet last = rangeDataNotification({2});
+    const Packet notification = rangeDataNotification({3});
+    const Packet other = response({});
+
+    writeToTransport(concat({notification, first, last, notification, other}));
+
+    EXPECT_EQ(std::vector<Packet>({notification, first, last, notification, other}),
+              awaitReceived(5));
+}
+
+TEST_F(UciTransportTest, ReportsTheDeviceGoingAway) {
+    UciTransport::Options options;
+    options.rangeDataBatchLatency = 10s;
+    open(options);
+    const Packet notification = rangeDataNotification({1});
+
+    writeToTransport(notification);
+    std::this_thread::sleep_for(20ms);
+    mPeer.reset();
+
+    // The pending batch is handed over first.
+    std::unique_lock<std::mutex> lock(mLock);
+    ASSERT_TRUE(mChanged.wait_for(lock, kTimeout, [&] { return mFailed; }));
+    EXPECT_EQ(std::vector<Packet>({notification}), mReceived);
+}
+
+TEST_F(UciTransportTest, ReopensAfterClose) {
+    open();
+    mTransport->close();
+    EXPECT_EQ(-1, mTransport->send(response({})));
+
+    open();
+    const Packet packet = response({4});
+    writeToTransport(packet);
+    EXPECT_EQ(std::vector<Packet>({packet}), awaitReceived(1));
+}
+
+}  // namespace
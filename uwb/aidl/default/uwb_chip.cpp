@@ -16,9 +16,23 @@
 
 #include "uwb.h"
 
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+
 namespace {
 constexpr static int32_t kAndroidUciVersion = 1;
+constexpr static char kDeviceProperty[] = "ro.vendor.uwb.device";
+constexpr static char kDefaultDevice[] = "/dev/uwb0";
+// In microseconds, 0 to hand every ranging notification over on its own.
+constexpr static char kBatchLatencyProperty[] = "ro.vendor.uwb.range_data_batch_latency_us";
+
+::android::hardware::uwb::impl::UciTransport::Options transportOptions() {
+    ::android::hardware::uwb::impl::UciTransport::Options options;
+    options.rangeDataBatchLatency = std::chrono::microseconds(
+            ::android::base::GetIntProperty<int64_t>(kBatchLatencyProperty, 0, 0));
+    return options;
 }
+}  // namespace
 
 namespace android {
 namespace hardware {
@@ -26,8 +40,14 @@ namespace uwb {
 namespace impl {
 using namespace ::aidl::android::hardware::uwb;
 
-UwbChip::UwbChip(const std::string& name) : name_(name), mClientCallback(nullptr) {}
-UwbChip::~UwbChip() {}
+UwbChip::UwbChip(const std::string& name)
+    : name_(name),
+      mTransport(transportOptions()),
+      mTransportOpen(false),
+      mClientCallback(nullptr) {}
+UwbChip::~UwbChip() {
+    mTransport.close();
+}
 
 ::ndk::ScopedAStatus UwbChip::getName(std::string* name) {
     *name = name_;
@@ -35,18 +55,46 @@ UwbChip::~UwbChip() {}
 }
 
 ::ndk::ScopedAStatus UwbChip::open(const std::shared_ptr<IUwbClientCallback>& clientCallback) {
-    mClientCallback = clientCallback;
-    mClientCallback->onHalEvent(UwbEvent::OPEN_CPLT, UwbStatus::OK);
+    if (clientCallback == nullptr) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
+    }
+    std::lock_guard<std::mutex> openLock(mOpenLock);
+    // The reader thread of a previous open must be gone before the callback changes.
+    mTransport.close();
+    {
+        std::lock_guard<std::mutex> lock(mCallbackLock);
+        mClientCallback = clientCallback;
+    }
+    const std::string device = ::android::base::GetProperty(kDeviceProperty, kDefaultDevice);
+    mTransportOpen = mTransport.open(
+            device, [this](const std::vector<uint8_t>& packets) { onUciPackets(packets); },
+            [this] { onTransportError(); });
+    if (!mTransportOpen) {
+        LOG(INFO) << "No UWB device, UCI messages are not supported";
+    }
+    clientCallback->onHalEvent(UwbEvent::OPEN_CPLT, UwbStatus::OK);
     return ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus UwbChip::close() {
+    std::lock_guard<std::mutex> openLock(mOpenLock);
+    // Nothing is received after this.
+    mTransport.close();
+    mTransportOpen = false;
+    std::lock_guard<std::mutex> lock(mCallbackLock);
+    if (mClientCallback == nullptr) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
+    }
     mClientCallback->onHalEvent(UwbEvent::CLOSE_CPLT, UwbStatus::OK);
     mClientCallback = nullptr;
     return ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus UwbChip::coreInit() {
+    std::lock_guard<std::mutex> lock(mCallbackLock);
+    if (mClientCallback != nullptr) {
+        mClientCallback->onHalEvent(UwbEvent::POST_INIT_CPLT, UwbStatus::OK);
+    }
     return ndk::ScopedAStatus::ok();
 }
 
@@ -59,10 +107,32 @@ UwbChip::~UwbChip() {}
     return ndk::ScopedAStatus::ok();
 }
 
-::ndk::ScopedAStatus UwbChip::sendUciMessage(const std::vector<uint8_t>& /* data */,
-                                             int32_t* /* bytes_written */) {
-    // TODO(b/195992658): Need emulator support for UCI stack.
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+::ndk::ScopedAStatus UwbChip::sendUciMessage(const std::vector<uint8_t>& data,
+                                             int32_t* bytes_written) {
+    if (!mTransportOpen) {
+        // TODO(b/195992658): Need emulator support for UCI stack.
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+    *bytes_written = mTransport.send(data);
+    if (*bytes_written < 0) {
+        return ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(UwbStatus::FAILED));
+    }
+    return ndk::ScopedAStatus::ok();
+}
+
+void UwbChip::onUciPackets(const std::vector<uint8_t>& packets) {
+    std::lock_guard<std::mutex> lock(mCallbackLock);
+    if (mClientCallback != nullptr) {
+        mClientCallback->onUciMessage(packets);
+    }
+}
+
+void UwbChip::onTransportError() {
+    std::lock_guard<std::mutex> lock(mCallbackLock);
+    if (mClientCallback != nullptr) {
+        mClientCallback->onHalEvent(UwbEvent::ERROR, UwbStatus::ERR_TRANSPORT);
+    }
 }
 }  // namespace impl
 }  // namespace uwb
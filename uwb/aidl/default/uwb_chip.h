@@ -17,17 +17,22 @@
 #ifndef ANDROID_HARDWARE_UWB_UWBCHIP
 #define ANDROID_HARDWARE_UWB_UWBCHIP
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 #include <aidl/android/hardware/uwb/BnUwbChip.h>
 #include <aidl/android/hardware/uwb/IUwbClientCallback.h>
 
+#include "uci_transport.h"
+
 namespace android {
 namespace hardware {
 namespace uwb {
 namespace impl {
 using namespace ::aidl::android::hardware::uwb;
-// Default implementation mean't to be used on simulator targets.
+// Default implementation mean't to be used on simulator targets. Talks UCI to the character
+// device of ro.vendor.uwb.device when there is one, see UciTransport.
 class UwbChip : public BnUwbChip {
   public:
     UwbChip(const std::string& name);
@@ -43,7 +48,17 @@ class UwbChip : public BnUwbChip {
                                         int32_t* bytes_written) override;
 
   private:
+    void onUciPackets(const std::vector<uint8_t>& packets);
+    void onTransportError();
+
     std::string name_;
+    // Serializes open and close, which restart the reader thread of mTransport.
+    std::mutex mOpenLock;
+    UciTransport mTransport;
+    // Set while the chip is opened on a UWB device.
+    std::atomic_bool mTransportOpen;
+    std::mutex mCallbackLock;
+    // Guarded by mCallbackLock, as the reader thread of mTransport calls it too.
     std::shared_ptr<IUwbClientCallback> mClientCallback;
 };
 }  // namespace impl
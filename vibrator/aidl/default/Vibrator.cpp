@@ -17,7 +17,6 @@
 #include "vibrator-impl/Vibrator.h"
 
 #include <android-base/logging.h>
-#include <thread>
 
 namespace aidl {
 namespace android {
@@ -39,6 +38,70 @@ static constexpr float PWLE_FREQUENCY_MAX_HZ = 160.0;
 static constexpr float PWLE_BW_MAP_SIZE =
         1 + ((PWLE_FREQUENCY_MAX_HZ - PWLE_FREQUENCY_MIN_HZ) / PWLE_FREQUENCY_RESOLUTION_HZ);
 
+Vibrator::Vibrator() : mSchedulerThread(&Vibrator::schedulerLoop, this) {}
+
+Vibrator::~Vibrator() {
+    cancelAll();
+    {
+        std::lock_guard<std::mutex> lock(mTimersLock);
+        mShuttingDown = true;
+    }
+    mTimersCondition.notify_one();
+    mSchedulerThread.join();
+}
+
+void Vibrator::schedule(std::chrono::steady_clock::time_point when, Timer timer) {
+    {
+        std::lock_guard<std::mutex> lock(mTimersLock);
+        mTimers.emplace(when, std::move(timer));
+    }
+    mTimersCondition.notify_one();
+}
+
+void Vibrator::cancelAll() {
+    std::multimap<std::chrono::steady_clock::time_point, Timer> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mTimersLock);
+        cancelled.swap(mTimers);
+    }
+    // Callbacks are binder calls, so they are made without holding the lock.
+    for (auto& [_, timer] : cancelled) {
+        if (timer.callback != nullptr && !timer.callback->onComplete().isOk()) {
+            LOG(ERROR) << "Failed to call onComplete";
+        }
+    }
+}
+
+void Vibrator::schedulerLoop() {
+    std::unique_lock<std::mutex> lock(mTimersLock);
+    while (!mShuttingDown) {
+        if (mTimers.empty()) {
+            mTimersCondition.wait(lock);
+            continue;
+        }
+        auto next = mTimers.begin();
+        if (next->first > std::chrono::steady_clock::now()) {
+            // Woken up early by a new step that may be due sooner, or by the destructor.
+            mTimersCondition.wait_until(lock, next->first);
+            continue;
+        }
+        Timer timer = std::move(next->second);
+        mTimers.erase(next);
+
+        lock.unlock();
+        if (timer.action) {
+            timer.action();
+        }
+        if (timer.callback != nullptr) {
+            LOG(VERBOSE) << "Notifying on complete";
+            if (!timer.callback->onComplete().isOk()) {
+                LOG(ERROR) << "Failed to call onComplete";
+            }
+        }
+        lock.lock();
+    }
+}
+
 ndk::ScopedAStatus Vibrator::getCapabilities(int32_t* _aidl_return) {
     LOG(VERBOSE) << "Vibrator reporting capabilities";
     *_aidl_return = IVibrator::CAP_ON_CALLBACK | IVibrator::CAP_PERFORM_CALLBACK |
@@ -52,6 +115,7 @@ ndk::ScopedAStatus Vibrator::getCapabilities(int32_t* _aidl_return) {
 
 ndk::ScopedAStatus Vibrator::off() {
     LOG(VERBOSE) << "Vibrator off";
+    cancelAll();
     return ndk::ScopedAStatus::ok();
 }
 
@@ -59,17 +123,8 @@ ndk::ScopedAStatus Vibrator::on(int32_t timeoutMs,
                                 const std::shared_ptr<IVibratorCallback>& callback) {
     LOG(VERBOSE) << "Vibrator on for timeoutMs: " << timeoutMs;
     if (callback != nullptr) {
-        // Note that thread lambdas aren't using implicit capture [=], to avoid capturing "this",
-        // which may be asynchronously destructed.
-        // If "this" is needed, use [sharedThis = this->ref<Vibrator>()].
-        std::thread([timeoutMs, callback] {
-            LOG(VERBOSE) << "Starting on on another thread";
-            usleep(timeoutMs * 1000);
-            LOG(VERBOSE) << "Notifying on complete";
-            if (!callback->onComplete().isOk()) {
-                LOG(ERROR) << "Failed to call onComplete";
-            }
-        }).detach();
+        schedule(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs),
+                 {nullptr, callback});
     }
     return ndk::ScopedAStatus::ok();
 }
@@ -90,12 +145,8 @@ ndk::ScopedAStatus Vibrator::perform(Effect effect, EffectStrength strength,
     constexpr size_t kEffectMillis = 100;
 
     if (callback != nullptr) {
-        std::thread([callback] {
-            LOG(VERBOSE) << "Starting perform on another thread";
-            usleep(kEffectMillis * 1000);
-            LOG(VERBOSE) << "Notifying perform complete";
-            callback->onComplete();
-        }).detach();
+        schedule(std::chrono::steady_clock::now() + std::chrono::milliseconds(kEffectMillis),
+                 {nullptr, callback});
     }
 
     *_aidl_return = kEffectMillis;
@@ -177,27 +228,24 @@ ndk::ScopedAStatus Vibrator::compose(const std::vector<CompositeEffect>& composi
         }
     }
 
-    // The thread may theoretically outlive the vibrator, so take a proper reference to it.
-    std::thread([sharedThis = this->ref<Vibrator>(), composite, callback] {
-        LOG(VERBOSE) << "Starting compose on another thread";
-
-        for (auto& e : composite) {
-            if (e.delayMs) {
-                usleep(e.delayMs * 1000);
-            }
-            LOG(VERBOSE) << "triggering primitive " << static_cast<int>(e.primitive) << " @ scale "
-                         << e.scale;
-
-            int32_t durationMs;
-            sharedThis->getPrimitiveDuration(e.primitive, &durationMs);
-            usleep(durationMs * 1000);
-        }
-
-        if (callback != nullptr) {
-            LOG(VERBOSE) << "Notifying perform complete";
-            callback->onComplete();
-        }
-    }).detach();
+    // Each primitive is triggered by its own step, at the time it is due after the previous ones
+    // and its own delay, and the callback is notified once the last one has played.
+    auto when = std::chrono::steady_clock::now();
+    for (auto& e : composite) {
+        when += std::chrono::milliseconds(e.delayMs);
+        auto trigger = [primitive = e.primitive, scale = e.scale] {
+            LOG(VERBOSE) << "triggering primitive " << static_cast<int>(primitive) << " @ scale "
+                         << scale;
+        };
+        schedule(when, {std::move(trigger), nullptr});
+
+        int32_t durationMs;
+        getPrimitiveDuration(e.primitive, &durationMs);
+        when += std::chrono::milliseconds(durationMs);
+    }
+    if (callback != nullptr) {
+        schedule(when, {nullptr, callback});
+    }
 
     return ndk::ScopedAStatus::ok();
 }
@@ -400,14 +448,10 @@ ndk::ScopedAStatus Vibrator::composePwle(const std::vector<PrimitivePwle> &compo
         }
     }
 
-    std::thread([totalDuration, callback] {
-        LOG(VERBOSE) << "Starting composePwle on another thread";
-        usleep(totalDuration * 1000);
-        if (callback != nullptr) {
-            LOG(VERBOSE) << "Notifying compose PWLE complete";
-            callback->onComplete();
-        }
-    }).detach();
+    if (callback != nullptr) {
+        schedule(std::chrono::steady_clock::now() + std::chrono::milliseconds(totalDuration),
+                 {nullptr, callback});
+    }
 
     return ndk::ScopedAStatus::ok();
 }
@@ -18,12 +18,24 @@
 
 #include <aidl/android/hardware/vibrator/BnVibrator.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace vibrator {
 
 class Vibrator : public BnVibrator {
+  public:
+    Vibrator();
+    ~Vibrator();
+
+  private:
     ndk::ScopedAStatus getCapabilities(int32_t* _aidl_return) override;
     ndk::ScopedAStatus off() override;
     ndk::ScopedAStatus on(int32_t timeoutMs,
@@ -55,6 +67,26 @@ class Vibrator : public BnVibrator {
     ndk::ScopedAStatus composePwle(const std::vector<PrimitivePwle> &composite,
                                    const std::shared_ptr<IVibratorCallback> &callback) override;
 
+    // A step of a vibration that is due at a given time: an optional action, e.g. triggering the
+    // next primitive of a composition, and the callback to notify once the vibration completes.
+    struct Timer {
+        std::function<void()> action;
+        std::shared_ptr<IVibratorCallback> callback;
+    };
+
+    // Queues a step to run on the scheduler thread once when has passed.
+    void schedule(std::chrono::steady_clock::time_point when, Timer timer);
+    // Drops every pending step and notifies their callbacks right away.
+    void cancelAll();
+    void schedulerLoop();
+
+    std::mutex mTimersLock;
+    std::condition_variable mTimersCondition;
+    // Ordered by due time; steps due at the same time keep the order they were scheduled in.
+    std::multimap<std::chrono::steady_clock::time_point, Timer> mTimers;
+    bool mShuttingDown = false;
+    // A single thread runs every step, instead of one sleeping thread per vibration.
+    std::thread mSchedulerThread;
 };
 
 }  // namespace vibrator
@@ -20,6 +20,7 @@
 #include <android/hardware/vibrator/BnVibratorCallback.h>
 #include <android/hardware/vibrator/IVibrator.h>
 #include <binder/IServiceManager.h>
+#include <hal-benchmark/Latency.h>
 
 using ::android::enum_range;
 using ::android::sp;
@@ -292,6 +293,17 @@ class HalCallback : public Aidl::BnVibratorCallback {
     android::binder::Status onComplete() override { return android::binder::Status::ok(); }
 };
 
+// Counts completions, so a benchmark can wait for a vibration to finish instead of cancelling it.
+class CompletionCallback : public Aidl::BnVibratorCallback {
+  public:
+    android::binder::Status onComplete() override {
+        completions.notify();
+        return android::binder::Status::ok();
+    }
+
+    ::android::hardware::hal_benchmark::CompletionCounter completions;
+};
+
 BENCHMARK_WRAPPER(VibratorBench_Aidl, on, {
     int32_t capabilities = 0;
     mVibrator->getCapabilities(&capabilities);
@@ -492,6 +504,38 @@ BENCHMARK_WRAPPER(VibratorEffectsBench_Aidl, perform, {
     }
 });
 
+// Back to back effects that are cancelled right away, the way fast scrolling or typing triggers
+// them, so the cost of starting and cancelling the completion callback is part of each iteration.
+BENCHMARK_WRAPPER(VibratorEffectsBench_Aidl, performRapidFire, {
+    int32_t capabilities = 0;
+    mVibrator->getCapabilities(&capabilities);
+    if ((capabilities & Aidl::IVibrator::CAP_PERFORM_CALLBACK) == 0) {
+        return;
+    }
+
+    auto effect = getEffect(state);
+    auto strength = getStrength(state);
+    sp<CompletionCallback> cb = new CompletionCallback();
+    int32_t lengthMs = 0;
+
+    std::vector<Aidl::Effect> supported;
+    mVibrator->getSupportedEffects(&supported);
+    if (std::find(supported.begin(), supported.end(), effect) == supported.end()) {
+        return;
+    }
+
+    uint32_t count = 0;
+    for (auto _ : state) {
+        mVibrator->perform(effect, strength, cb, &lengthMs);
+        mVibrator->off();
+        count++;
+    }
+
+    // off() must still complete every cancelled effect.
+    cb->completions.waitFor(count, std::chrono::seconds(1));
+    state.counters["completed"] = Counter(cb->completions.get() / static_cast<double>(count));
+});
+
 class VibratorPrimitivesBench_Aidl : public VibratorBench_Aidl {
   public:
     static void DefaultArgs(Benchmark* b) {
@@ -574,4 +618,47 @@ BENCHMARK_WRAPPER(VibratorPrimitivesBench_Aidl, compose, {
     }
 });
 
+// Time from compose until the callback reports the composition has played, compared to the
+// duration of its primitive, so late completions show up as overshoot.
+BENCHMARK_WRAPPER(VibratorPrimitivesBench_Aidl, composeLatency, {
+    int32_t capabilities = 0;
+    mVibrator->getCapabilities(&capabilities);
+    if ((capabilities & Aidl::IVibrator::CAP_COMPOSE_EFFECTS) == 0) {
+        return;
+    }
+
+    Aidl::CompositeEffect effect;
+    effect.primitive = getPrimitive(state);
+    effect.scale = 1.0f;
+    effect.delayMs = 0;
+
+    std::vector<Aidl::CompositePrimitive> supported;
+    mVibrator->getSupportedPrimitives(&supported);
+    if (std::find(supported.begin(), supported.end(), effect.primitive) == supported.end()) {
+        return;
+    }
+
+    int32_t durationMs = 0;
+    mVibrator->getPrimitiveDuration(effect.primitive, &durationMs);
+
+    sp<CompletionCallback> cb = new CompletionCallback();
+    std::vector<Aidl::CompositeEffect> effects;
+    effects.push_back(effect);
+
+    uint32_t count = 0;
+    double overshootUs = 0;
+    for (auto _ : state) {
+        auto start = high_resolution_clock::now();
+        mVibrator->compose(effects, cb);
+        if (!cb->completions.waitFor(++count, std::chrono::milliseconds(durationMs + 1000))) {
+            state.SkipWithError("compose did not complete");
+            break;
+        }
+        duration<double, std::micro> elapsed = high_resolution_clock::now() - start;
+        overshootUs += elapsed.count() - durationMs * 1000.0;
+    }
+
+    state.counters["overshoot_us"] = Counter(overshootUs, Counter::kAvgIterations);
+});
+
 BENCHMARK_MAIN();
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SlotStore.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace weaver {
+
+namespace {
+
+using std::chrono::milliseconds;
+
+// The file holds, in little endian:
+//   "WVR1", the number of slots (32 bits),
+//   for each slot: the key size (8 bits), the key padded to kKeySize, the value size (8 bits),
+//   the value padded to kValueSize, the failures (32 bits),
+//   and the FNV-1a hash of all the above (32 bits).
+constexpr char kMagic[] = {'W', 'V', 'R', '1'};
+constexpr size_t kSlotSize = 1 + SlotStore::kKeySize + 1 + SlotStore::kValueSize + 4;
+constexpr size_t kFileSize = sizeof(kMagic) + 4 + SlotStore::kSlots * kSlotSize + 4;
+
+// The failures a slot is allowed before it is throttled. The throttling then doubles every
+// kFreeFailures failures, up to kMaxThrottle.
+constexpr uint32_t kFreeFailures = 5;
+constexpr milliseconds kFirstThrottle = std::chrono::seconds(30);
+constexpr milliseconds kMaxThrottle = std::chrono::hours(24);
+
+milliseconds throttleTimeout(uint32_t failures) {
+    if (failures < kFreeFailures) return milliseconds(0);
+    const uint32_t doublings = (failures - kFreeFailures) / kFreeFailures;
+    // kFirstThrottle << 12 is past kMaxThrottle already.
+    if (doublings >= 12) return kMaxThrottle;
+    return std::min(kFirstThrottle * (1 << doublings), kMaxThrottle);
+}
+
+// Does not return early, so that the time taken tells nothing about the key.
+bool keysEqual(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    if (a.size() != b.size()) return false;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+uint32_t fnv1a(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void appendU32(uint32_t value, std::vector<uint8_t>* out) {
+    for (int i = 0; i < 4; i++) {
+        out->push_back((value >> (8 * i)) & 0xff);
+    }
+}
+
+uint32_t readU32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+void appendBytes(const std::vector<uint8_t>& bytes, size_t paddedSize, std::vector<uint8_t>* out) {
+    out->push_back(bytes.size());
+    out->insert(out->end(), bytes.begin(), bytes.end());
+    out->insert(out->end(), paddedSize - bytes.size(), 0);
+}
+
+// Returns false if the size is larger than |paddedSize|.
+bool readBytes(const uint8_t** in, size_t paddedSize, std::vector<uint8_t>* bytes) {
+    const size_t size = **in;
+    if (size > paddedSize) return false;
+    bytes->assign(*in + 1, *in + 1 + size);
+    *in += 1 + paddedSize;
+    return true;
+}
+
+}  // namespace
+
+SlotStore::SlotStore(const std::string& path)
+    : mPath(path), mDirectory(path.empty() ? "" : ::android::base::Dirname(path)) {
+    if (!mPath.empty()) {
+        if (access(mDirectory.c_str(), W_OK) == 0) {
+            mPersistent = true;
+            load();
+        } else {
+            PLOG(WARNING) << "Cannot write to " << mDirectory << ", the slots are only kept in "
+                          << "memory";
+        }
+    }
+    mCommitter = std::thread(&SlotStore::commitLoop, this);
+}
+
+SlotStore::~SlotStore() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mRequested.notify_one();
+    mCommitter.join();
+}
+
+void SlotStore::load() {
+    ::android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(mPath.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (fd.get() < 0) {
+        if (errno == ENOENT) {
+            LOG(INFO) << "No slots stored in " << mPath << " yet";
+        } else {
+            PLOG(ERROR) << "Cannot open " << mPath;
+        }
+        return;
+    }
+    std::string contents;
+    if (!::android::base::ReadFdToString(fd.get(), &contents)) {
+        PLOG(ERROR) << "Cannot read " << mPath;
+        return;
+    }
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(contents.data());
+    if (contents.size() != kFileSize || !std::equal(kMagic, kMagic + sizeof(kMagic), in) ||
+        readU32(in + sizeof(kMagic)) != kSlots ||
+        readU32(in + kFileSize - 4) != fnv1a(in, kFileSize - 4)) {
+        LOG(ERROR) << mPath << " is corrupt, starting with empty slots";
+        return;
+    }
+
+    std::array<Slot, kSlots> slots;
+    in += sizeof(kMagic) + 4;
+    const auto now = Clock::now();
+    for (Slot& slot : slots) {
+        if (!readBytes(&in, kKeySize, &slot.key) || !readBytes(&in, kValueSize, &slot.value)) {
+            LOG(ERROR) << mPath << " is corrupt, starting with empty slots";
+            return;
+        }
+        slot.failures = readU32(in);
+        in += 4;
+        // The time left before the restart is not known.
+        const milliseconds timeout = throttleTimeout(slot.failures);
+        if (timeout.count() > 0) {
+            slot.throttledUntil = now + timeout;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    mSlots = std::move(slots);
+}
+
+SlotStore::ReadStatus SlotStore::read(size_t slotId, const std::vector<uint8_t>& key,
+                                      std::vector<uint8_t>* value, milliseconds* timeout) {
+    std::unique_lock<std::mutex> lock(mLock);
+    Slot& slot = mSlots[slotId];
+    if (Clock::now() < slot.throttledUntil) {
+        mThrottledReads++;
+        *timeout = std::chrono::ceil<milliseconds>(slot.throttledUntil - Clock::now());
+        return ReadStatus::THROTTLE;
+    }
+
+    // The read counts as a failure until the key is known to be correct, so that stopping the
+    // service while it compares doesn't make the attempt free. It is throttled right away too:
+    // waiting for the commit drops mLock, and the reads of the slot coming in meanwhile must not
+    // get a comparison of their own.
+    if (slot.failures < std::numeric_limits<uint32_t>::max()) {
+        slot.failures++;
+    }
+    const milliseconds throttle = throttleTimeout(slot.failures);
+    if (throttle.count() > 0) {
+        slot.throttledUntil = Clock::now() + throttle;
+    }
+    if (!waitForCommitLocked(lock, requestCommitLocked())) {
+        *timeout = milliseconds(0);
+        return ReadStatus::FAILED;
+    }
+
+    if (!keysEqual(slot.key, key)) {
+        mFailedReads++;
+        *timeout = throttle;
+        return ReadStatus::INCORRECT_KEY;
+    }
+
+    // Losing the reset only costs a failure, so it doesn't hold the read back.
+    slot.failures = 0;
+    slot.throttledUntil = Clock::time_point();
+    requestCommitLocked();
+    *value = slot.value;
+    *timeout = milliseconds(0);
+    return ReadStatus::OK;
+}
+
+bool SlotStore::write(size_t slotId, const std::vector<uint8_t>& key,
+                      const std::vector<uint8_t>& value) {
+    std::unique_lock<std::mutex> lock(mLock);
+    Slot& slot = mSlots[slotId];
+    slot.key = key;
+    slot.value = value;
+    slot.failures = 0;
+    slot.throttledUntil = Clock::time_point();
+    mWrites++;
+
+    return waitForCommitLocked(lock, requestCommitLocked());
+}
+
+bool SlotStore::waitForCommitLocked(std::unique_lock<std::mutex>& lock, uint64_t generation) {
+    mCommitted.wait(lock, [&] { return mAttemptedGeneration >= generation; });
+    // A later commit that succeeded holds this generation too.
+    return mCommittedGeneration >= generation;
+}
+
+uint64_t SlotStore::requestCommitLocked() {
+    mRequested.notify_one();
+    return ++mGeneration;
+}
+
+std::vector<uint8_t> SlotStore::serializeLocked() const {
+    std::vector<uint8_t> contents(kMagic, kMagic + sizeof(kMagic));
+    contents.reserve(kFileSize);
+    appendU32(kSlots, &contents);
+    for (const Slot& slot : mSlots) {
+        appendBytes(slot.key, kKeySize, &contents);
+        appendBytes(slot.value, kValueSize, &contents);
+        appendU32(slot.failures, &contents);
+    }
+    appendU32(fnv1a(contents.data(), contents.size()), &contents);
+    return contents;
+}
+
+void SlotStore::commitLoop() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mRequested.wait(lock, [this] { return mGeneration != mAttemptedGeneration || mExit; });
+        // Changes left are committed before exiting.
+        if (mGeneration == mAttemptedGeneration) break;
+
+        // Everything changed up to now, including the writes that came in during the last commit.
+        const uint64_t generation = mGeneration;
+        const std::vector<uint8_t> contents = serializeLocked();
+        lock.unlock();
+        const auto start = Clock::now();
+        const bool ok = !mPersistent || commit(contents);
+        const auto time = Clock::now() - start;
+        lock.lock();
+
+        mAttemptedGeneration = generation;
+        if (ok) {
+            mCommittedGeneration = generation;
+        } else {
+            mCommitFailures++;
+        }
+        mCommits++;
+        mCommitTime += time;
+        mMaxCommitTime = std::max(mMaxCommitTime, time);
+        mCommitted.notify_all();
+    }
+}
+
+bool SlotStore::commit(const std::vector<uint8_t>& contents) const {
+    const std::string tmpPath = mPath + ".tmp";
+    ::android::base::unique_fd fd(TEMP_FAILURE_RETRY(
+            open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)));
+    if (fd.get() < 0) {
+        PLOG(ERROR) << "Cannot create " << tmpPath;
+        return false;
+    }
+    if (!::android::base::WriteFully(fd.get(), contents.data(), contents.size())) {
+        PLOG(ERROR) << "Cannot write " << tmpPath;
+        return false;
+    }
+    if (fsync(fd.get()) != 0) {
+        PLOG(ERROR) << "Cannot sync " << tmpPath;
+        return false;
+    }
+    fd.reset();
+    if (rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        PLOG(ERROR) << "Cannot rename " << tmpPath << " to " << mPath;
+        return false;
+    }
+    // The rename only survives a crash once the directory is synced.
+    ::android::base::unique_fd dir(
+            TEMP_FAILURE_RETRY(open(mDirectory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+    if (dir.get() < 0 || fsync(dir.get()) != 0) {
+        PLOG(ERROR) << "Cannot sync " << mDirectory;
+        return false;
+    }
+    return true;
+}
+
+void SlotStore::dump(int fd) {
+    std::lock_guard<std::mutex> lock(mLock);
+    dprintf(fd, "slots: %s\n", mPersistent ? mPath.c_str() : "in memory only");
+    using std::chrono::microseconds;
+    const long long commitUs = std::chrono::duration_cast<microseconds>(mCommitTime).count();
+    const long long maxCommitUs = std::chrono::duration_cast<microseconds>(mMaxCommitTime).count();
+    dprintf(fd, "%llu writes in %llu commits, %llu failed, %lld us on average, %lld us at most\n",
+            static_cast<unsigned long long>(mWrites), static_cast<unsigned long long>(mCommits),
+            static_cast<unsigned long long>(mCommitFailures),
+            mCommits == 0 ? 0 : commitUs / static_cast<long long>(mCommits), maxCommitUs);
+    dprintf(fd, "%llu reads with an incorrect key, %llu throttled\n",
+            static_cast<unsigned long long>(mFailedReads),
+            static_cast<unsigned long long>(mThrottledReads));
+    const auto now = Clock::now();
+    for (size_t i = 0; i < kSlots; i++) {
+        const Slot& slot = mSlots[i];
+        if (slot.failures == 0) continue;
+        const auto left = std::max(Clock::duration::zero(), slot.throttledUntil - now);
+        dprintf(fd, "  slot %zu: %u failures, throttled for %lld ms\n", i, slot.failures,
+                static_cast<long long>(std::chrono::ceil<milliseconds>(left).count()));
+    }
+}
+
+}  // namespace weaver
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace weaver {
+
+// Keeps the slots of Weaver in memory, and persists them to a file.
+//
+// A commit writes every slot to a temporary file next to the file, syncs it, and renames it over
+// the file, so that a crash leaves either the previous slots or the new ones. Commits are made
+// on a dedicated thread: the writes that arrive while a commit is in progress share the next
+// one, and so a single fsync. Reads are served from memory.
+//
+// Failed reads are counted per slot. Past a few failures, the slot is throttled for a time that
+// grows with its failures, as secure elements do. A read first commits the slot with one more
+// failure, and only then compares the key, so that no attempt goes uncounted. The throttling
+// that failure earns starts before the commit, so that concurrent reads of the slot are refused
+// rather than compared. The throttling left is not persisted, and starts over when the file is
+// loaded.
+class SlotStore {
+  public:
+    static constexpr size_t kSlots = 16;
+    static constexpr size_t kKeySize = 16;
+    static constexpr size_t kValueSize = 16;
+
+    // FAILED if the failure could not be committed before comparing the key.
+    enum class ReadStatus { OK, INCORRECT_KEY, THROTTLE, FAILED };
+
+    // An empty |path| keeps the slots in memory only.
+    explicit SlotStore(const std::string& path);
+    ~SlotStore();
+
+    SlotStore(const SlotStore&) = delete;
+    SlotStore& operator=(const SlotStore&) = delete;
+
+    // The slot and the sizes are checked by the caller. |*timeout| is set to the time to wait
+    // before the next read of the slot. Waits for a commit, like write().
+    ReadStatus read(size_t slot, const std::vector<uint8_t>& key, std::vector<uint8_t>* value,
+                    std::chrono::milliseconds* timeout);
+    // Returns once the slot is committed, or false if the commit failed. The slot is updated in
+    // memory either way, and the next commit tries again.
+    bool write(size_t slot, const std::vector<uint8_t>& key, const std::vector<uint8_t>& value);
+
+    void dump(int fd);
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot {
+        std::vector<uint8_t> key;
+        std::vector<uint8_t> value;
+        uint32_t failures = 0;
+        // Reads fail with THROTTLE until then.
+        Clock::time_point throttledUntil;
+    };
+
+    void load();
+    void commitLoop();
+    bool commit(const std::vector<uint8_t>& contents) const;
+    // Returns the generation to be committed, without waiting for it. Called with mLock held.
+    uint64_t requestCommitLocked();
+    // Waits until |generation| is committed, or false if its commit failed.
+    bool waitForCommitLocked(std::unique_lock<std::mutex>& lock, uint64_t generation);
+    std::vector<uint8_t> serializeLocked() const;
+
+    const std::string mPath;
+    const std::string mDirectory;
+    // Set before the commit thread starts.
+    bool mPersistent = false;
+
+    std::mutex mLock;
+    std::condition_variable mRequested;
+    std::condition_variable mCommitted;
+    // Guarded by mLock.
+    std::array<Slot, kSlots> mSlots;
+    bool mExit = false;
+    // Incremented with each change of mSlots to persist.
+    uint64_t mGeneration = 0;
+    // The generation of the last commit made, and of the last one that succeeded.
+    uint64_t mAttemptedGeneration = 0;
+    uint64_t mCommittedGeneration = 0;
+
+    // Statistics, guarded by mLock.
+    uint64_t mWrites = 0;
+    uint64_t mCommits = 0;
+    uint64_t mCommitFailures = 0;
+    Clock::duration mCommitTime{0};
+    Clock::duration mMaxCommitTime{0};
+    uint64_t mFailedReads = 0;
+    uint64_t mThrottledReads = 0;
+
+    std::thread mCommitter;
+};
+
+}  // namespace weaver
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
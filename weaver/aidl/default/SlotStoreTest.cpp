@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "SlotStore.h"
+
+using aidl::android::hardware::weaver::SlotStore;
+using std::chrono::milliseconds;
+
+namespace {
+
+// The failures a slot is allowed before it is throttled.
+constexpr int kFreeFailures = 5;
+
+const std::vector<uint8_t> kKey = {1, 2, 3};
+const std::vector<uint8_t> kOtherKey = {1, 2, 4};
+const std::vector<uint8_t> kValue = {4, 5, 6};
+
+class SlotStoreTest : public ::testing::Test {
+  protected:
+    void SetUp() override { mPath = std::string(mDir.path) + "/slots"; }
+
+    void TearDown() override {
+        unlink(mPath.c_str());
+        unlink((mPath + ".tmp").c_str());
+    }
+
+    SlotStore::ReadStatus read(SlotStore& store, const std::vector<uint8_t>& key,
+                               std::vector<uint8_t>* value = nullptr,
+                               milliseconds* timeout = nullptr) {
+        std::vector<uint8_t> ignoredValue;
+        milliseconds ignoredTimeout;
+        return store.read(0, key, value ? value : &ignoredValue,
+                          timeout ? timeout : &ignoredTimeout);
+    }
+
+    TemporaryDir mDir;
+    std::string mPath;
+};
+
+TEST_F(SlotStoreTest, ReadsWhatWasWritten) {
+    SlotStore store(mPath);
+    ASSERT_TRUE(store.write(0, kKey, kValue));
+
+    std::vector<uint8_t> value;
+    milliseconds timeout;
+    EXPECT_EQ(SlotStore::ReadStatus::OK, read(store, kKey, &value, &timeout));
+    EXPECT_EQ(kValue, value);
+    EXPECT_EQ(0, timeout.count());
+}
+
+TEST_F(SlotStoreTest, ThrottlesAfterFailures) {
+    SlotStore store(mPath);
+    ASSERT_TRUE(store.write(0, kKey, kValue));
+
+    milliseconds timeout;
+    for (int i = 1; i < kFreeFailures; i++) {
+        EXPECT_EQ(SlotStore::ReadStatus::INCORRECT_KEY, read(store, kOtherKey, nullptr, &timeout));
+        EXPECT_EQ(0, timeout.count());
+    }
+    EXPECT_EQ(SlotStore::ReadStatus::INCORRECT_KEY, read(store, kOtherKey, nullptr, &timeout));
+    EXPECT_GT(timeout.count(), 0);
+
+    // Even the correct key is refused until the throttling is over.
+    EXPECT_EQ(SlotStore::ReadStatus::THROTTLE, read(store, kKey, nullptr, &timeout));
+    EXPECT_GT(timeout.count(), 0);
+}
+
+TEST_F(SlotStoreTest, ThrottlesConcurrentReads) {
+    constexpr int kReaders = 16;
+    SlotStore store(mPath);
+    ASSERT_TRUE(store.write(0, kKey, kValue));
+
+    std::atomic<int> incorrect = 0;
+    std::atomic<int> throttled = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; i++) {
+        readers.emplace_back([&] {
+            const SlotStore::ReadStatus status = read(store, kOtherKey);
+            if (status == SlotStore::ReadStatus::INCORRECT_KEY) incorrect++;
+            if (status == SlotStore::ReadStatus::THROTTLE) throttled++;
+        });
+    }
+    for (auto& reader : readers) reader.join();
+
+    // No more keys are compared than if the reads came one after the other.
+    EXPECT_EQ(kFreeFailures, incorrect);
+    EXPECT_EQ(kReaders - kFreeFailures, throttled);
+}
+
+TEST_F(SlotStoreTest, CorrectKeyResetsFailures) {
+    SlotStore store(mPath);
+    ASSERT_TRUE(store.write(0, kKey, kValue));
+
+    for (int i = 1; i < kFreeFailures; i++) {
+        EXPECT_EQ(SlotStore::ReadStatus::INCORRECT_KEY, read(store, kOtherKey));
+    }
+    EXPECT_EQ(SlotStore::ReadStatus::OK, read(store, kKey));
+
+    milliseconds timeout;
+    EXPECT_EQ(SlotStore::ReadStatus::INCORRECT_KEY, read(store, kOtherKey, nullptr, &timeout));
+    EXPECT_EQ(0, timeout.count());
+}
+
+TEST_F(SlotStoreTest, KeepsSlotsAcrossRestarts) {
+    {
+        SlotStore store(mPath);
+        ASSERT_TRUE(store.write(0, kKey, kValue));
+    }
+    SlotStore store(mPath);
+    std::vector<uint8_t> value;
+    EXPECT_EQ(SlotStore::ReadStatus::OK, read(store, kKey, &value));
+    EXPECT_EQ(kValue, value);
+}
+
+TEST_F(SlotStoreTest, KeepsFailuresAcrossRestarts) {
+    {
+        SlotStore store(mPath);
+        ASSERT_TRUE(store.write(0, kKey, kValue));
+        for (int i = 0; i < kFreeFailures; i++) {
+            EXPECT_EQ(SlotStore::ReadStatus::INCORRECT_KEY, read(store, kOtherKey));
+        }
+    }
+    // The throttling starts over.
+    SlotStore store(mPath);
+    EXPECT_EQ(SlotStore::ReadStatus::THROTTLE, read(store, kKey));
+}
+
+TEST_F(SlotStoreTest, FailsReadsThatCannotBeCounted) {
+    SlotStore store(mPath);
+    ASSERT_TRUE(store.write(0, kKey, kValue));
+    for (int i = 2; i < kFreeFailures; i++) {
+        EXPECT_EQ(SlotStore::ReadStatus::INCORRECT_KEY, read(store, kOtherKey));
+    }
+
+    // Commits fail once the directory is gone, and the key is not compared.
+    ASSERT_EQ(0, unlink(mPath.c_str()));
+    ASSERT_EQ(0, rmdir(mDir.path));
+    std::vector<uint8_t> value;
+    EXPECT_EQ(SlotStore::ReadStatus::FAILED, read(store, kKey, &value));
+    EXPECT_TRUE(value.empty());
+    EXPECT_FALSE(store.write(1, kKey, kValue));
+    ASSERT_EQ(0, mkdir(mDir.path, 0700));
+
+    // That read still counted as a failure.
+    milliseconds timeout;
+    EXPECT_EQ(SlotStore::ReadStatus::INCORRECT_KEY, read(store, kOtherKey, nullptr, &timeout));
+    EXPECT_GT(timeout.count(), 0);
+}
+
+TEST_F(SlotStoreTest, StartsEmptyFromCorruptFile) {
+    ASSERT_TRUE(::android::base::WriteStringToFile("WVR1 and garbage", mPath));
+    SlotStore store(mPath);
+    EXPECT_EQ(SlotStore::ReadStatus::INCORRECT_KEY, read(store, kKey));
+    EXPECT_EQ(SlotStore::ReadStatus::OK, read(store, {}));
+}
+
+TEST_F(SlotStoreTest, KeepsSlotsInMemoryWithoutPath) {
+    SlotStore store("");
+    ASSERT_TRUE(store.write(0, kKey, kValue));
+    EXPECT_EQ(SlotStore::ReadStatus::OK, read(store, kKey));
+}
+
+}  // namespace
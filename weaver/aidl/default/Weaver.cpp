@@ -15,55 +15,66 @@
  */
 
 #include "Weaver.h"
-#include <array>
 
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace weaver {
 
-struct Slotinfo {
-    int slot_id;
-    std::vector<uint8_t> key;
-    std::vector<uint8_t> value;
-};
-
-std::array<struct Slotinfo, 16> slot_array;
 // Methods from ::android::hardware::weaver::IWeaver follow.
 
 ::ndk::ScopedAStatus Weaver::getConfig(WeaverConfig* out_config) {
-    *out_config = {16, 16, 16};
+    *out_config = {SlotStore::kSlots, SlotStore::kKeySize, SlotStore::kValueSize};
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Weaver::read(int32_t in_slotId, const std::vector<uint8_t>& in_key, WeaverReadResponse* out_response) {
 
-    if (in_slotId > 15 || in_key.size() > 16) {
+    if (in_slotId < 0 || static_cast<size_t>(in_slotId) >= SlotStore::kSlots ||
+        in_key.size() > SlotStore::kKeySize) {
         *out_response = {0, {}};
         return ndk::ScopedAStatus(AStatus_fromServiceSpecificError(Weaver::STATUS_FAILED));
     }
 
-    if (slot_array[in_slotId].key != in_key) {
-        *out_response = {0, {}};
-        return ndk::ScopedAStatus(AStatus_fromServiceSpecificError(Weaver::STATUS_INCORRECT_KEY));
+    std::vector<uint8_t> value;
+    std::chrono::milliseconds timeout;
+    switch (mStore.read(in_slotId, in_key, &value, &timeout)) {
+        case SlotStore::ReadStatus::INCORRECT_KEY:
+            *out_response = {timeout.count(), {}};
+            return ndk::ScopedAStatus(
+                    AStatus_fromServiceSpecificError(Weaver::STATUS_INCORRECT_KEY));
+        case SlotStore::ReadStatus::THROTTLE:
+            *out_response = {timeout.count(), {}};
+            return ndk::ScopedAStatus(AStatus_fromServiceSpecificError(Weaver::STATUS_THROTTLE));
+        case SlotStore::ReadStatus::FAILED:
+            *out_response = {0, {}};
+            return ndk::ScopedAStatus(AStatus_fromServiceSpecificError(Weaver::STATUS_FAILED));
+        case SlotStore::ReadStatus::OK:
+            break;
     }
 
-    *out_response = {0, slot_array[in_slotId].value};
+    *out_response = {0, std::move(value)};
 
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Weaver::write(int32_t in_slotId, const std::vector<uint8_t>& in_key, const std::vector<uint8_t>& in_value) {
 
-    if (in_slotId > 15 || in_key.size() > 16 || in_value.size() > 16)
+    if (in_slotId < 0 || static_cast<size_t>(in_slotId) >= SlotStore::kSlots ||
+        in_key.size() > SlotStore::kKeySize || in_value.size() > SlotStore::kValueSize)
         return ::ndk::ScopedAStatus::fromStatus(STATUS_FAILED_TRANSACTION);
 
-    slot_array[in_slotId].key = in_key;
-    slot_array[in_slotId].value = in_value;
+    if (!mStore.write(in_slotId, in_key, in_value))
+        return ndk::ScopedAStatus(AStatus_fromServiceSpecificError(Weaver::STATUS_FAILED));
 
     return ::ndk::ScopedAStatus::ok();
 }
 
+binder_status_t Weaver::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    mStore.dump(fd);
+    return STATUS_OK;
+}
+
 } //namespace weaver
 } //namespace hardware
 } //namespace android
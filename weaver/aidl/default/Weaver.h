@@ -18,6 +18,8 @@
 
 #include <aidl/android/hardware/weaver/BnWeaver.h>
 
+#include "SlotStore.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -28,12 +30,18 @@ using ::aidl::android::hardware::weaver::WeaverReadResponse;
 
 struct Weaver : public BnWeaver {
 public:
-    Weaver() = default;
+    // The slots are persisted to |path|, or only kept in memory if it is empty.
+    explicit Weaver(const std::string& path) : mStore(path) {}
 
     // Methods from ::android::hardware::weaver::IWeaver follow.
     ::ndk::ScopedAStatus getConfig(WeaverConfig* _aidl_return) override;
     ::ndk::ScopedAStatus read(int32_t in_slotId, const std::vector<uint8_t>& in_key, WeaverReadResponse* _aidl_return) override;
     ::ndk::ScopedAStatus write(int32_t in_slotId, const std::vector<uint8_t>& in_key, const std::vector<uint8_t>& in_value) override;
+
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+private:
+    SlotStore mStore;
 };
 
 }  // namespace weaver
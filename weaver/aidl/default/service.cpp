@@ -22,9 +22,15 @@
 
 using ::aidl::android::hardware::weaver::Weaver;
 
+// Created by the init script.
+static constexpr char kSlotsPath[] = "/data/vendor/weaver/slots";
+// Writes made from several threads at once share a commit of the slots.
+static constexpr uint32_t kBinderThreads = 4;
+
 int main() {
-    ABinderProcess_setThreadPoolMaxThreadCount(0);
-    std::shared_ptr<Weaver> weaver = ndk::SharedRefBase::make<Weaver>();
+    ABinderProcess_setThreadPoolMaxThreadCount(kBinderThreads);
+    ABinderProcess_startThreadPool();
+    std::shared_ptr<Weaver> weaver = ndk::SharedRefBase::make<Weaver>(kSlotsPath);
 
     const std::string instance = std::string() + Weaver::descriptor + "/default";
     binder_status_t status = AServiceManager_addService(weaver->asBinder().get(), instance.c_str());
@@ -42,12 +42,16 @@ endif
 ifdef WIFI_AVOID_IFACE_RESET_MAC_CHANGE
 LOCAL_CPPFLAGS += -DWIFI_AVOID_IFACE_RESET_MAC_CHANGE
 endif
+ifdef WIFI_HIDL_FEATURE_LOCK_DOMAINS
+LOCAL_CPPFLAGS += -DWIFI_HIDL_FEATURE_LOCK_DOMAINS
+endif
 # Allow implicit fallthroughs in wifi_legacy_hal.cpp until they are fixed.
 LOCAL_CFLAGS += -Wno-error=implicit-fallthrough
 LOCAL_SRC_FILES := \
     hidl_struct_util.cpp \
     hidl_sync_util.cpp \
     ringbuffer.cpp \
+    ringbuffer_file_writer.cpp \
     wifi.cpp \
     wifi_ap_iface.cpp \
     wifi_chip.cpp \
@@ -169,6 +173,7 @@ LOCAL_PROPRIETARY_MODULE := true
 LOCAL_CPPFLAGS := -Wall -Werror -Wextra
 LOCAL_SRC_FILES := \
     tests/hidl_struct_util_unit_tests.cpp \
+    tests/hidl_sync_util_unit_tests.cpp \
     tests/main.cpp \
     tests/mock_interface_tool.cpp \
     tests/mock_wifi_feature_flags.cpp \
@@ -178,7 +183,8 @@ LOCAL_SRC_FILES := \
     tests/ringbuffer_unit_tests.cpp \
     tests/wifi_nan_iface_unit_tests.cpp \
     tests/wifi_chip_unit_tests.cpp \
-    tests/wifi_iface_util_unit_tests.cpp
+    tests/wifi_iface_util_unit_tests.cpp \
+    tests/wifi_legacy_hal_unit_tests.cpp
 LOCAL_STATIC_LIBRARIES := \
     libgmock \
     libgtest \
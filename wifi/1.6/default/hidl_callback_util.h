@@ -17,7 +17,10 @@
 #ifndef HIDL_CALLBACK_UTIL_H_
 #define HIDL_CALLBACK_UTIL_H_
 
-#include <set>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <hidl/HidlSupport.h>
 #include <hidl/HidlTransportSupport.h>
@@ -54,13 +57,37 @@ namespace wifi {
 namespace V1_6 {
 namespace implementation {
 namespace hidl_callback_util {
+// An immutable snapshot of the callbacks registered with a HidlCallbackHandler.
+// It keeps the callbacks alive and can be iterated without any lock, while
+// callbacks are registered or removed concurrently.
+template <typename CallbackType>
+class HidlCallbackList {
+  public:
+    using Callbacks = std::vector<sp<CallbackType>>;
+    using const_iterator = typename Callbacks::const_iterator;
+
+    explicit HidlCallbackList(std::shared_ptr<const Callbacks> callbacks)
+        : callbacks_(std::move(callbacks)) {}
+
+    const_iterator begin() const { return callbacks_->begin(); }
+    const_iterator end() const { return callbacks_->end(); }
+    size_t size() const { return callbacks_->size(); }
+    bool empty() const { return callbacks_->empty(); }
+
+  private:
+    std::shared_ptr<const Callbacks> callbacks_;
+};
+
 template <typename CallbackType>
 // Provides a class to manage callbacks for the various HIDL interfaces and
 // handle the death of the process hosting each callback.
 class HidlCallbackHandler {
   public:
+    using Callbacks = typename HidlCallbackList<CallbackType>::Callbacks;
+
     HidlCallbackHandler()
-        : death_handler_(new HidlDeathHandler<CallbackType>(
+        : callbacks_(std::make_shared<const Callbacks>()),
+          death_handler_(new HidlDeathHandler<CallbackType>(
                   std::bind(&HidlCallbackHandler::onObjectDeath, this, std::placeholders::_1))) {}
     ~HidlCallbackHandler() = default;
 
@@ -69,7 +96,9 @@ class HidlCallbackHandler {
         // (callback proxy's raw pointer) to track the death of individual
         // clients.
         uint64_t cookie = reinterpret_cast<uint64_t>(cb.get());
-        for (const auto& s : cb_set_) {
+        std::lock_guard<std::mutex> lock(lock_);
+        const auto callbacks = std::atomic_load(&callbacks_);
+        for (const auto& s : *callbacks) {
             if (interfacesEqual(cb, s)) {
                 LOG(ERROR) << "Duplicate death notification registration";
                 return true;
@@ -79,35 +108,58 @@ class HidlCallbackHandler {
             LOG(ERROR) << "Failed to register death notification";
             return false;
         }
-        cb_set_.insert(cb);
+        auto new_callbacks = std::make_shared<Callbacks>(*callbacks);
+        new_callbacks->push_back(cb);
+        std::atomic_store(&callbacks_, std::shared_ptr<const Callbacks>(std::move(new_callbacks)));
         return true;
     }
 
-    const std::set<android::sp<CallbackType>>& getCallbacks() { return cb_set_; }
+    // Returns a snapshot of the callbacks, which registrations and deaths
+    // don't change while the caller iterates over it. Events are delivered
+    // far more often than callbacks change, so taking a snapshot doesn't
+    // copy the callbacks nor wait for |lock_|.
+    HidlCallbackList<CallbackType> getCallbacks() {
+        return HidlCallbackList<CallbackType>(std::atomic_load(&callbacks_));
+    }
 
     // Death notification for callbacks.
     void onObjectDeath(uint64_t cookie) {
         CallbackType* cb = reinterpret_cast<CallbackType*>(cookie);
-        const auto& iter = cb_set_.find(cb);
-        if (iter == cb_set_.end()) {
+        std::lock_guard<std::mutex> lock(lock_);
+        const auto callbacks = std::atomic_load(&callbacks_);
+        const auto iter =
+                std::find_if(callbacks->begin(), callbacks->end(),
+                             [cb](const sp<CallbackType>& s) { return s.get() == cb; });
+        if (iter == callbacks->end()) {
             LOG(ERROR) << "Unknown callback death notification received";
             return;
         }
-        cb_set_.erase(iter);
+        auto new_callbacks = std::make_shared<Callbacks>(*callbacks);
+        new_callbacks->erase(new_callbacks->begin() + (iter - callbacks->begin()));
+        std::atomic_store(&callbacks_, std::shared_ptr<const Callbacks>(std::move(new_callbacks)));
         LOG(DEBUG) << "Dead callback removed from list";
     }
 
     void invalidate() {
-        for (const sp<CallbackType>& cb : cb_set_) {
+        std::shared_ptr<const Callbacks> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            callbacks = std::atomic_exchange(&callbacks_, std::make_shared<const Callbacks>());
+        }
+        for (const sp<CallbackType>& cb : *callbacks) {
             if (!cb->unlinkToDeath(death_handler_)) {
                 LOG(ERROR) << "Failed to deregister death notification";
             }
         }
-        cb_set_.clear();
     }
 
   private:
-    std::set<sp<CallbackType>> cb_set_;
+    // Callbacks are registered from the HIDL threads, invoked from the legacy
+    // HAL threads and removed from the binder death notification thread.
+    // |lock_| serializes the changes, each of which publishes a new list in
+    // |callbacks_| instead of modifying the one readers may be iterating.
+    std::mutex lock_;
+    std::shared_ptr<const Callbacks> callbacks_;
     sp<HidlDeathHandler<CallbackType>> death_handler_;
 
     DISALLOW_COPY_AND_ASSIGN(HidlCallbackHandler);
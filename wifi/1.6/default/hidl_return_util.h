@@ -37,13 +37,14 @@ using namespace android::hardware::wifi::V1_0;
  * the status and any returned values.
  * b) if invalid, invokes the HIDL continuation callback with the
  * provided error status and default values.
+ * The call is made with the lock of the object's |kLockDomain| held.
  */
 // Use for HIDL methods which return only an instance of WifiStatus.
 template <typename ObjT, typename WorkFuncT, typename... Args>
 Return<void> validateAndCall(ObjT* obj, WifiStatusCode status_code_if_invalid, WorkFuncT&& work,
                              const std::function<void(const WifiStatus&)>& hidl_cb,
                              Args&&... args) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(ObjT::kLockDomain);
     if (obj->isValid()) {
         hidl_cb((obj->*work)(std::forward<Args>(args)...));
     } else {
@@ -60,6 +61,7 @@ Return<void> validateAndCallWithLock(ObjT* obj, WifiStatusCode status_code_if_in
                                      WorkFuncT&& work,
                                      const std::function<void(const WifiStatus&)>& hidl_cb,
                                      Args&&... args) {
+    static_assert(ObjT::kLockDomain == hidl_sync_util::LockDomain::GLOBAL);
     auto lock = hidl_sync_util::acquireGlobalLock();
     if (obj->isValid()) {
         hidl_cb((obj->*work)(&lock, std::forward<Args>(args)...));
@@ -75,7 +77,7 @@ template <typename ObjT, typename WorkFuncT, typename ReturnT, typename... Args>
 Return<void> validateAndCall(ObjT* obj, WifiStatusCode status_code_if_invalid, WorkFuncT&& work,
                              const std::function<void(const WifiStatus&, ReturnT)>& hidl_cb,
                              Args&&... args) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(ObjT::kLockDomain);
     if (obj->isValid()) {
         const auto& ret_pair = (obj->*work)(std::forward<Args>(args)...);
         const WifiStatus& status = std::get<0>(ret_pair);
@@ -94,7 +96,7 @@ template <typename ObjT, typename WorkFuncT, typename ReturnT1, typename ReturnT
 Return<void> validateAndCall(
         ObjT* obj, WifiStatusCode status_code_if_invalid, WorkFuncT&& work,
         const std::function<void(const WifiStatus&, ReturnT1, ReturnT2)>& hidl_cb, Args&&... args) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(ObjT::kLockDomain);
     if (obj->isValid()) {
         const auto& ret_tuple = (obj->*work)(std::forward<Args>(args)...);
         const WifiStatus& status = std::get<0>(ret_tuple);
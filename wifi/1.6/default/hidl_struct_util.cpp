@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include <android-base/logging.h>
 #include <utils/SystemClock.h>
 
@@ -30,6 +32,15 @@ using V1_6::NanConfigRequestSupplemental;
 
 WifiChannelWidthInMhz convertLegacyWifiChannelWidthToHidl(legacy_hal::wifi_channel_width type);
 
+// hidl_vec::resize() always reallocates, only call it when the size changes so
+// that converting into a previously used struct reuses its storage.
+template <typename T>
+void resizeHidlVec(hidl_vec<T>* vec, size_t size) {
+    if (vec->size() != size) {
+        vec->resize(size);
+    }
+}
+
 hidl_string safeConvertChar(const char* str, size_t max_len) {
     const char* c = str;
     size_t size = 0;
@@ -703,10 +714,9 @@ bool convertLegacyGscanResultToHidl(const legacy_hal::wifi_scan_result& legacy_s
     }
     *hidl_scan_result = {};
     hidl_scan_result->timeStampInUs = legacy_scan_result.ts;
-    hidl_scan_result->ssid = std::vector<uint8_t>(
-            legacy_scan_result.ssid,
-            legacy_scan_result.ssid +
-                    strnlen(legacy_scan_result.ssid, sizeof(legacy_scan_result.ssid) - 1));
+    hidl_scan_result->ssid.resize(
+            strnlen(legacy_scan_result.ssid, sizeof(legacy_scan_result.ssid) - 1));
+    memcpy(hidl_scan_result->ssid.data(), legacy_scan_result.ssid, hidl_scan_result->ssid.size());
     memcpy(hidl_scan_result->bssid.data(), legacy_scan_result.bssid,
            hidl_scan_result->bssid.size());
     hidl_scan_result->frequency = legacy_scan_result.channel;
@@ -742,16 +752,13 @@ bool convertLegacyCachedGscanResultsToHidl(
 
     CHECK(legacy_cached_scan_result.num_results >= 0 &&
           legacy_cached_scan_result.num_results <= MAX_AP_CACHE_PER_SCAN);
-    std::vector<StaScanResult> hidl_scan_results;
+    hidl_scan_data->results.resize(legacy_cached_scan_result.num_results);
     for (int32_t result_idx = 0; result_idx < legacy_cached_scan_result.num_results; result_idx++) {
-        StaScanResult hidl_scan_result;
         if (!convertLegacyGscanResultToHidl(legacy_cached_scan_result.results[result_idx], false,
-                                            &hidl_scan_result)) {
+                                            &hidl_scan_data->results[result_idx])) {
             return false;
         }
-        hidl_scan_results.push_back(hidl_scan_result);
     }
-    hidl_scan_data->results = std::move(hidl_scan_results);
     return true;
 }
 
@@ -762,12 +769,12 @@ bool convertLegacyVectorOfCachedGscanResultsToHidl(
         return false;
     }
     *hidl_scan_datas = {};
-    for (const auto& legacy_cached_scan_result : legacy_cached_scan_results) {
-        StaScanData hidl_scan_data;
-        if (!convertLegacyCachedGscanResultsToHidl(legacy_cached_scan_result, &hidl_scan_data)) {
+    hidl_scan_datas->resize(legacy_cached_scan_results.size());
+    for (size_t i = 0; i < legacy_cached_scan_results.size(); i++) {
+        if (!convertLegacyCachedGscanResultsToHidl(legacy_cached_scan_results[i],
+                                                   &(*hidl_scan_datas)[i])) {
             return false;
         }
-        hidl_scan_datas->push_back(hidl_scan_data);
     }
     return true;
 }
@@ -916,24 +923,27 @@ bool convertLegacyLinkLayerRadioStatsToHidl(
     if (!hidl_radio_stat) {
         return false;
     }
-    *hidl_radio_stat = {};
-
+    // Every field is written below, the vectors are converted in place.
     hidl_radio_stat->radioId = legacy_radio_stat.stats.radio;
     hidl_radio_stat->V1_0.onTimeInMs = legacy_radio_stat.stats.on_time;
     hidl_radio_stat->V1_0.txTimeInMs = legacy_radio_stat.stats.tx_time;
     hidl_radio_stat->V1_0.rxTimeInMs = legacy_radio_stat.stats.rx_time;
     hidl_radio_stat->V1_0.onTimeInMsForScan = legacy_radio_stat.stats.on_time_scan;
-    hidl_radio_stat->V1_0.txTimeInMsPerLevel = legacy_radio_stat.tx_time_per_levels;
+    resizeHidlVec(&hidl_radio_stat->V1_0.txTimeInMsPerLevel,
+                  legacy_radio_stat.tx_time_per_levels.size());
+    std::copy(legacy_radio_stat.tx_time_per_levels.begin(),
+              legacy_radio_stat.tx_time_per_levels.end(),
+              hidl_radio_stat->V1_0.txTimeInMsPerLevel.begin());
     hidl_radio_stat->onTimeInMsForNanScan = legacy_radio_stat.stats.on_time_nbd;
     hidl_radio_stat->onTimeInMsForBgScan = legacy_radio_stat.stats.on_time_gscan;
     hidl_radio_stat->onTimeInMsForRoamScan = legacy_radio_stat.stats.on_time_roam_scan;
     hidl_radio_stat->onTimeInMsForPnoScan = legacy_radio_stat.stats.on_time_pno_scan;
     hidl_radio_stat->onTimeInMsForHs20Scan = legacy_radio_stat.stats.on_time_hs20;
 
-    std::vector<V1_6::WifiChannelStats> hidl_channel_stats;
-
-    for (const auto& channel_stat : legacy_radio_stat.channel_stats) {
-        V1_6::WifiChannelStats hidl_channel_stat;
+    resizeHidlVec(&hidl_radio_stat->channelStats, legacy_radio_stat.channel_stats.size());
+    for (size_t i = 0; i < legacy_radio_stat.channel_stats.size(); i++) {
+        const auto& channel_stat = legacy_radio_stat.channel_stats[i];
+        V1_6::WifiChannelStats& hidl_channel_stat = hidl_radio_stat->channelStats[i];
         hidl_channel_stat.onTimeInMs = channel_stat.on_time;
         hidl_channel_stat.ccaBusyTimeInMs = channel_stat.cca_busy_time;
         /*
@@ -944,11 +954,7 @@ bool convertLegacyLinkLayerRadioStatsToHidl(
         hidl_channel_stat.channel.centerFreq = channel_stat.channel.center_freq;
         hidl_channel_stat.channel.centerFreq0 = channel_stat.channel.center_freq0;
         hidl_channel_stat.channel.centerFreq1 = channel_stat.channel.center_freq1;
-        hidl_channel_stats.push_back(hidl_channel_stat);
     }
-
-    hidl_radio_stat->channelStats = hidl_channel_stats;
-
     return true;
 }
 
@@ -957,7 +963,8 @@ bool convertLegacyLinkLayerStatsToHidl(const legacy_hal::LinkLayerStats& legacy_
     if (!hidl_stats) {
         return false;
     }
-    *hidl_stats = {};
+    // Every field is written below, the peer and radio vectors are converted
+    // in place so that a struct reused across polls keeps its storage.
     // iface legacy_stats conversion.
     hidl_stats->iface.V1_0.beaconRx = legacy_stats.iface.beacon_rx;
     hidl_stats->iface.V1_0.avgRssiMgmt = legacy_stats.iface.rssi_mgmt;
@@ -1028,25 +1035,20 @@ bool convertLegacyLinkLayerStatsToHidl(const legacy_hal::LinkLayerStats& legacy_
     hidl_stats->iface.timeSliceDutyCycleInPercent =
             legacy_stats.iface.info.time_slicing_duty_cycle_percent;
     // peer info legacy_stats conversion.
-    std::vector<V1_6::StaPeerInfo> hidl_peers_info_stats;
-    for (const auto& legacy_peer_info_stats : legacy_stats.peers) {
-        V1_6::StaPeerInfo hidl_peer_info_stats;
-        if (!convertLegacyPeerInfoStatsToHidl(legacy_peer_info_stats, &hidl_peer_info_stats)) {
+    resizeHidlVec(&hidl_stats->iface.peers, legacy_stats.peers.size());
+    for (size_t i = 0; i < legacy_stats.peers.size(); i++) {
+        if (!convertLegacyPeerInfoStatsToHidl(legacy_stats.peers[i], &hidl_stats->iface.peers[i])) {
             return false;
         }
-        hidl_peers_info_stats.push_back(hidl_peer_info_stats);
     }
-    hidl_stats->iface.peers = hidl_peers_info_stats;
     // radio legacy_stats conversion.
-    std::vector<V1_6::StaLinkLayerRadioStats> hidl_radios_stats;
-    for (const auto& legacy_radio_stats : legacy_stats.radios) {
-        V1_6::StaLinkLayerRadioStats hidl_radio_stats;
-        if (!convertLegacyLinkLayerRadioStatsToHidl(legacy_radio_stats, &hidl_radio_stats)) {
+    resizeHidlVec(&hidl_stats->radios, legacy_stats.radios.size());
+    for (size_t i = 0; i < legacy_stats.radios.size(); i++) {
+        if (!convertLegacyLinkLayerRadioStatsToHidl(legacy_stats.radios[i],
+                                                    &hidl_stats->radios[i])) {
             return false;
         }
-        hidl_radios_stats.push_back(hidl_radio_stats);
     }
-    hidl_stats->radios = hidl_radios_stats;
     // Timestamp in the HAL wrapper here since it's not provided in the legacy
     // HAL API.
     hidl_stats->timeStampInMs = uptimeMillis();
@@ -1058,13 +1060,14 @@ bool convertLegacyPeerInfoStatsToHidl(const legacy_hal::WifiPeerInfo& legacy_pee
     if (!hidl_peer_info_stats) {
         return false;
     }
-    *hidl_peer_info_stats = {};
+    // Every field is written below, the rate vector is converted in place.
     hidl_peer_info_stats->staCount = legacy_peer_info_stats.peer_info.bssload.sta_count;
     hidl_peer_info_stats->chanUtil = legacy_peer_info_stats.peer_info.bssload.chan_util;
 
-    std::vector<V1_6::StaRateStat> hidlRateStats;
-    for (const auto& legacy_rate_stats : legacy_peer_info_stats.rate_stats) {
-        V1_6::StaRateStat rateStat;
+    resizeHidlVec(&hidl_peer_info_stats->rateStats, legacy_peer_info_stats.rate_stats.size());
+    for (size_t i = 0; i < legacy_peer_info_stats.rate_stats.size(); i++) {
+        const auto& legacy_rate_stats = legacy_peer_info_stats.rate_stats[i];
+        V1_6::StaRateStat& rateStat = hidl_peer_info_stats->rateStats[i];
         if (!convertLegacyWifiRateInfoToHidl(legacy_rate_stats.rate, &rateStat.rateInfo)) {
             return false;
         }
@@ -1072,9 +1075,7 @@ bool convertLegacyPeerInfoStatsToHidl(const legacy_hal::WifiPeerInfo& legacy_pee
         rateStat.rxMpdu = legacy_rate_stats.rx_mpdu;
         rateStat.mpduLost = legacy_rate_stats.mpdu_lost;
         rateStat.retries = legacy_rate_stats.retries;
-        hidlRateStats.push_back(rateStat);
     }
-    hidl_peer_info_stats->rateStats = hidlRateStats;
     return true;
 }
 
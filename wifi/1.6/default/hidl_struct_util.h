@@ -99,6 +99,8 @@ bool convertLegacyGscanResultToHidl(const legacy_hal::wifi_scan_result& legacy_s
 bool convertLegacyVectorOfCachedGscanResultsToHidl(
         const std::vector<legacy_hal::wifi_cached_scan_results>& legacy_cached_scan_results,
         std::vector<StaScanData>* hidl_scan_datas);
+// |hidl_stats| may hold the result of a previous conversion, its vectors are
+// reused when the number of radios, peers, channels and rates is unchanged.
 bool convertLegacyLinkLayerStatsToHidl(const legacy_hal::LinkLayerStats& legacy_stats,
                                        V1_6::StaLinkLayerStats* hidl_stats);
 bool convertLegacyRoamingCapabilitiesToHidl(
@@ -181,6 +183,8 @@ bool convertLegacyRttResponderToHidl(const legacy_hal::wifi_rtt_responder& legac
 bool convertLegacyRttCapabilitiesToHidl(
         const legacy_hal::wifi_rtt_capabilities& legacy_capabilities,
         V1_6::RttCapabilities* hidl_capabilities);
+bool convertLegacyRttResultToHidl(const legacy_hal::wifi_rtt_result& legacy_result,
+                                  V1_6::RttResult* hidl_result);
 bool convertLegacyVectorOfRttResultToHidl(
         const std::vector<const legacy_hal::wifi_rtt_result*>& legacy_results,
         std::vector<V1_6::RttResult>* hidl_results);
@@ -16,8 +16,58 @@
 
 #include "hidl_sync_util.h"
 
+#include <android-base/logging.h>
+
+#include <iterator>
+
 namespace {
-std::recursive_mutex g_mutex;
+using android::hardware::wifi::V1_6::implementation::hidl_sync_util::DomainMutex;
+using android::hardware::wifi::V1_6::implementation::hidl_sync_util::LockDomain;
+
+// Domains held by GLOBAL, in acquisition order.
+constexpr LockDomain kDomains[] = {LockDomain::STA_IFACE, LockDomain::AP_IFACE,
+                                   LockDomain::P2P_IFACE, LockDomain::RTT_CONTROLLER,
+                                   LockDomain::NAN_IFACE};
+constexpr size_t kNumDomains = sizeof(kDomains) / sizeof(kDomains[0]) + 1;
+
+#ifdef WIFI_HIDL_FEATURE_LOCK_DOMAINS
+bool g_lock_domains_enabled = true;
+#else
+bool g_lock_domains_enabled = false;
+#endif
+
+std::recursive_mutex g_mutexes[kNumDomains];
+// How many times the calling thread holds each domain, to check the lock order.
+thread_local size_t t_hold_counts[kNumDomains];
+
+size_t& getHoldCount(LockDomain domain) {
+    return t_hold_counts[static_cast<size_t>(domain)];
+}
+
+// Acquiring a domain listed before one that is held, or GLOBAL after any
+// other domain, could deadlock with a thread taking them in order.
+void checkLockOrder(LockDomain domain) {
+    if (getHoldCount(LockDomain::GLOBAL) > 0) {
+        return;
+    }
+    for (const auto held : kDomains) {
+        CHECK(getHoldCount(held) == 0 || (domain != LockDomain::GLOBAL && held <= domain))
+                << "Acquiring lock domain " << static_cast<int>(domain)
+                << " while holding lock domain " << static_cast<int>(held);
+    }
+}
+
+std::recursive_mutex& getMutex(LockDomain domain) {
+    return g_mutexes[static_cast<size_t>(domain)];
+}
+
+DomainMutex& getDomainMutex(LockDomain domain) {
+    static DomainMutex mutexes[kNumDomains] = {
+            DomainMutex(LockDomain::GLOBAL),         DomainMutex(LockDomain::STA_IFACE),
+            DomainMutex(LockDomain::AP_IFACE),       DomainMutex(LockDomain::P2P_IFACE),
+            DomainMutex(LockDomain::RTT_CONTROLLER), DomainMutex(LockDomain::NAN_IFACE)};
+    return mutexes[static_cast<size_t>(domain)];
+}
 }  // namespace
 
 namespace android {
@@ -27,8 +77,53 @@ namespace V1_6 {
 namespace implementation {
 namespace hidl_sync_util {
 
-std::unique_lock<std::recursive_mutex> acquireGlobalLock() {
-    return std::unique_lock<std::recursive_mutex>{g_mutex};
+bool lockDomainsEnabled() {
+    return g_lock_domains_enabled;
+}
+
+void setLockDomainsEnabledForTesting(bool enabled) {
+    g_lock_domains_enabled = enabled;
+}
+
+void DomainMutex::lock() {
+    if (!g_lock_domains_enabled) {
+        getMutex(LockDomain::GLOBAL).lock();
+        return;
+    }
+    checkLockOrder(domain_);
+    getHoldCount(domain_)++;
+    if (domain_ != LockDomain::GLOBAL) {
+        getMutex(domain_).lock();
+        return;
+    }
+    getMutex(LockDomain::GLOBAL).lock();
+    for (const auto domain : kDomains) {
+        getMutex(domain).lock();
+    }
+}
+
+void DomainMutex::unlock() {
+    if (!g_lock_domains_enabled) {
+        getMutex(LockDomain::GLOBAL).unlock();
+        return;
+    }
+    getHoldCount(domain_)--;
+    if (domain_ != LockDomain::GLOBAL) {
+        getMutex(domain_).unlock();
+        return;
+    }
+    for (auto it = std::rbegin(kDomains); it != std::rend(kDomains); ++it) {
+        getMutex(*it).unlock();
+    }
+    getMutex(LockDomain::GLOBAL).unlock();
+}
+
+DomainLock acquireLock(LockDomain domain) {
+    return DomainLock{getDomainMutex(domain)};
+}
+
+DomainLock acquireGlobalLock() {
+    return acquireLock(LockDomain::GLOBAL);
 }
 
 }  // namespace hidl_sync_util
@@ -19,15 +19,44 @@
 
 #include <mutex>
 
-// Utility that provides a global lock to synchronize access between
-// the HIDL thread and the legacy HAL's event loop.
+// Utility that provides the locks used to synchronize access between the HIDL
+// thread and the legacy HAL's event loop. See THREADING.README.
 namespace android {
 namespace hardware {
 namespace wifi {
 namespace V1_6 {
 namespace implementation {
 namespace hidl_sync_util {
-std::unique_lock<std::recursive_mutex> acquireGlobalLock();
+// Lock domains. Each interface type has its own domain, so that calls on
+// unrelated interfaces and their legacy HAL callbacks can progress in
+// parallel. GLOBAL holds every other domain.
+// A thread holding a domain lock may only acquire domains listed after it,
+// and must never acquire GLOBAL. This is checked while lock domains are
+// enabled.
+enum class LockDomain { GLOBAL, STA_IFACE, AP_IFACE, P2P_IFACE, RTT_CONTROLLER, NAN_IFACE };
+
+// Whether the domains are locked separately. Unless the service is built with
+// WIFI_HIDL_FEATURE_LOCK_DOMAINS, every domain acquires GLOBAL, since the
+// legacy HAL would call into the vendor library from several threads
+// otherwise. See THREADING.README.
+bool lockDomainsEnabled();
+// Must not be called while any lock is held.
+void setLockDomainsEnabledForTesting(bool enabled);
+
+// Recursive mutex of a lock domain.
+class DomainMutex {
+  public:
+    explicit DomainMutex(LockDomain domain) : domain_(domain) {}
+    void lock();
+    void unlock();
+
+  private:
+    const LockDomain domain_;
+};
+using DomainLock = std::unique_lock<DomainMutex>;
+
+DomainLock acquireLock(LockDomain domain);
+DomainLock acquireGlobalLock();
 }  // namespace hidl_sync_util
 }  // namespace implementation
 }  // namespace V1_6
@@ -16,6 +16,9 @@
 
 #include <android-base/logging.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include "ringbuffer.h"
 
 namespace android {
@@ -24,7 +27,8 @@ namespace wifi {
 namespace V1_6 {
 namespace implementation {
 
-Ringbuffer::Ringbuffer(size_t maxSize) : size_(0), maxSize_(maxSize) {}
+Ringbuffer::Ringbuffer(size_t maxSize)
+    : head_(0), size_(0), maxSize_(maxSize), lengthsHead_(0), numRecords_(0) {}
 
 enum Ringbuffer::AppendStatus Ringbuffer::append(const std::vector<uint8_t>& input) {
     if (input.size() == 0) {
@@ -34,27 +38,74 @@ enum Ringbuffer::AppendStatus Ringbuffer::append(const std::vector<uint8_t>& inp
         LOG(INFO) << "Oversized message of " << input.size() << " bytes is dropped";
         return AppendStatus::FAIL_IP_BUFFER_EXCEEDED_MAXSIZE;
     }
-    data_.push_back(input);
-    size_ += input.size() * sizeof(input[0]);
-    while (size_ > maxSize_) {
-        if (data_.front().size() <= 0 || data_.front().size() > maxSize_) {
-            LOG(ERROR) << "First buffer in the ring buffer is Invalid. Size: "
-                       << data_.front().size();
+    while (size_ + input.size() > maxSize_) {
+        if (!popFront()) {
             return AppendStatus::FAIL_RING_BUFFER_CORRUPTED;
         }
-        size_ -= data_.front().size() * sizeof(data_.front()[0]);
-        data_.pop_front();
     }
+    if (data_.empty()) {
+        data_.resize(maxSize_);
+    }
+    if (numRecords_ == lengths_.size()) {
+        // Unroll the lengths so that the new ones can be added at the end.
+        std::rotate(lengths_.begin(), lengths_.begin() + lengthsHead_, lengths_.end());
+        lengthsHead_ = 0;
+        lengths_.resize(std::max<size_t>(16, lengths_.size() * 2));
+    }
+
+    size_t tail = (head_ + size_) % maxSize_;
+    size_t firstCopy = std::min(input.size(), maxSize_ - tail);
+    memcpy(data_.data() + tail, input.data(), firstCopy);
+    memcpy(data_.data(), input.data() + firstCopy, input.size() - firstCopy);
+    size_ += input.size();
+    lengths_[(lengthsHead_ + numRecords_) % lengths_.size()] = input.size();
+    numRecords_++;
     return AppendStatus::SUCCESS;
 }
 
-const std::list<std::vector<uint8_t>>& Ringbuffer::getData() const {
-    return data_;
+bool Ringbuffer::popFront() {
+    uint32_t length = numRecords_ > 0 ? lengths_[lengthsHead_] : 0;
+    if (length <= 0 || length > size_) {
+        LOG(ERROR) << "First buffer in the ring buffer is Invalid. Size: " << length;
+        return false;
+    }
+    head_ = (head_ + length) % maxSize_;
+    size_ -= length;
+    lengthsHead_ = (lengthsHead_ + 1) % lengths_.size();
+    numRecords_--;
+    return true;
+}
+
+std::array<Ringbuffer::Region, 2> Ringbuffer::getDataRegions() const {
+    size_t firstSize = std::min(size_, maxSize_ - head_);
+    return {Region{data_.data() + head_, firstSize},
+            Region{data_.data(), size_ - firstSize}};
+}
+
+std::vector<std::vector<uint8_t>> Ringbuffer::getRecords() const {
+    std::vector<std::vector<uint8_t>> records;
+    size_t offset = head_;
+    for (size_t i = 0; i < numRecords_; i++) {
+        std::vector<uint8_t> record(lengths_[(lengthsHead_ + i) % lengths_.size()]);
+        for (auto& byte : record) {
+            byte = data_[offset];
+            offset = (offset + 1) % maxSize_;
+        }
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+bool Ringbuffer::empty() const {
+    return size_ == 0;
 }
 
 void Ringbuffer::clear() {
-    data_.clear();
+    // Keep the memory, the ring is going to be filled again.
+    head_ = 0;
     size_ = 0;
+    lengthsHead_ = 0;
+    numRecords_ = 0;
 }
 
 }  // namespace implementation
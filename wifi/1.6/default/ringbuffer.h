@@ -17,7 +17,8 @@
 #ifndef RINGBUFFER_H_
 #define RINGBUFFER_H_
 
-#include <list>
+#include <array>
+#include <cstdint>
 #include <vector>
 
 namespace android {
@@ -28,6 +29,10 @@ namespace implementation {
 
 /**
  * Ringbuffer object used to store debug data.
+ *
+ * The data of all records is stored back to back in a single circular byte buffer of |maxSize|
+ * bytes, allocated on the first append. Record lengths are kept in a separate circular buffer so
+ * that the stored bytes stay exactly what is dumped to the tombstone files.
  */
 class Ringbuffer {
   public:
@@ -39,18 +44,39 @@ class Ringbuffer {
         FAIL_IP_BUFFER_EXCEEDED_MAXSIZE,
         FAIL_RING_BUFFER_CORRUPTED
     };
+    // A contiguous part of the stored data.
+    struct Region {
+        const uint8_t* data;
+        size_t size;
+    };
+
     explicit Ringbuffer(size_t maxSize);
 
-    // Appends the data buffer and deletes from the front until buffer is
+    // Appends the data buffer and deletes records from the front until buffer is
     // within |maxSize_|.
     enum AppendStatus append(const std::vector<uint8_t>& input);
-    const std::list<std::vector<uint8_t>>& getData() const;
+    // Returns the stored data, oldest first, in at most two regions. The
+    // second region is only non-empty when the data wraps around the end of
+    // the buffer.
+    std::array<Region, 2> getDataRegions() const;
+    // Returns a copy of every record, oldest first.
+    std::vector<std::vector<uint8_t>> getRecords() const;
+    bool empty() const;
     void clear();
 
   private:
-    std::list<std::vector<uint8_t>> data_;
+    // Drops the oldest record.
+    bool popFront();
+
+    std::vector<uint8_t> data_;
+    // Offset of the oldest byte in |data_|.
+    size_t head_;
     size_t size_;
     size_t maxSize_;
+    // Circular buffer of record lengths, grown when full.
+    std::vector<uint32_t> lengths_;
+    size_t lengthsHead_;
+    size_t numRecords_;
 };
 
 }  // namespace implementation
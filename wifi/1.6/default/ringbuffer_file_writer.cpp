@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+
+#include <ctime>
+#include <list>
+#include <memory>
+
+#include "ringbuffer_file_writer.h"
+
+namespace android {
+namespace hardware {
+namespace wifi {
+namespace V1_6 {
+namespace implementation {
+
+RingbufferFileWriter::RingbufferFileWriter(const std::string& dir, size_t max_file_size,
+                                           uint32_t max_file_age_sec, uint32_t max_file_num)
+    : dir_(dir),
+      max_file_size_(max_file_size),
+      max_file_age_sec_(max_file_age_sec),
+      max_file_num_(max_file_num) {}
+
+RingbufferFileWriter::~RingbufferFileWriter() {
+    requestFlush(true /* sync_to_disk */);
+    {
+        std::unique_lock<std::mutex> lk(lock_);
+        stop_ = true;
+        cv_.notify_all();
+    }
+    thread_.join();
+}
+
+void RingbufferFileWriter::enqueue(const std::string& name, Ringbuffer& ring) {
+    std::unique_lock<std::mutex> lk(lock_);
+    std::vector<uint8_t>& pending = files_[name].pending;
+    for (const auto& region : ring.getDataRegions()) {
+        pending.insert(pending.end(), region.data, region.data + region.size);
+    }
+    ring.clear();
+}
+
+uint64_t RingbufferFileWriter::requestFlush(bool sync_to_disk) {
+    std::unique_lock<std::mutex> lk(lock_);
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&RingbufferFileWriter::run, this);
+    }
+    sync_requested_ |= sync_to_disk;
+    cv_.notify_all();
+    return ++requested_ticket_;
+}
+
+bool RingbufferFileWriter::waitForFlush(uint64_t ticket) {
+    std::unique_lock<std::mutex> lk(lock_);
+    cv_.wait(lk, [&] { return completed_ticket_ >= ticket; });
+    bool success = !write_failed_;
+    write_failed_ = false;
+    return success;
+}
+
+void RingbufferFileWriter::run() {
+    // Data being written, by ring. The buffers are kept to reuse their memory.
+    struct Work {
+        RingFile* file;
+        std::vector<uint8_t> data;
+    };
+    std::map<std::string, Work> writing;
+    std::unique_lock<std::mutex> lk(lock_);
+    while (true) {
+        cv_.wait(lk, [&] { return stop_ || completed_ticket_ != requested_ticket_; });
+        if (completed_ticket_ == requested_ticket_) {
+            break;
+        }
+        const uint64_t ticket = requested_ticket_;
+        bool sync = sync_requested_;
+        sync_requested_ = false;
+        for (auto& item : files_) {
+            Work& work = writing[item.first];
+            work.file = &item.second;
+            work.data.clear();
+            std::swap(work.data, item.second.pending);
+        }
+        lk.unlock();
+
+        // |files_| nodes are never removed and only this thread uses their
+        // files, so they can be used without the lock.
+        bool success = true;
+        for (auto& item : writing) {
+            if (!item.second.data.empty()) {
+                success &= writeToFile(item.first, item.second.file, item.second.data);
+            }
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (sync || now - last_sync_time_ >= kMinSyncInterval) {
+            for (auto& item : writing) {
+                RingFile& file = *item.second.file;
+                if (file.needs_sync && fsync(file.fd.get()) == -1) {
+                    PLOG(ERROR) << "Error syncing ring buffer file for " << item.first;
+                    success = false;
+                }
+                file.needs_sync = false;
+            }
+            last_sync_time_ = now;
+        }
+
+        lk.lock();
+        write_failed_ |= !success;
+        completed_ticket_ = ticket;
+        cv_.notify_all();
+    }
+}
+
+bool RingbufferFileWriter::writeToFile(const std::string& name, RingFile* file,
+                                       const std::vector<uint8_t>& data) {
+    struct stat file_stat;
+    if (file->fd.ok() && (fstat(file->fd.get(), &file_stat) == -1 || file_stat.st_nlink == 0)) {
+        // The file was removed as an old file, start a new one.
+        file->fd.reset();
+    }
+    if (file->fd.ok() && file->size + data.size() > max_file_size_) {
+        if (file->needs_sync && fsync(file->fd.get()) == -1) {
+            PLOG(ERROR) << "Error syncing ring buffer file for " << name;
+        }
+        file->fd.reset();
+    }
+    if (!file->fd.ok()) {
+        if (!removeOldFiles()) {
+            LOG(ERROR) << "Error occurred while deleting old tombstone files";
+        }
+        std::string file_path = dir_ + name + "XXXXXXXXXX";
+        file->fd.reset(mkstemp(file_path.data()));
+        if (!file->fd.ok()) {
+            PLOG(ERROR) << "create file failed";
+            return false;
+        }
+        file->size = 0;
+        file->needs_sync = false;
+    }
+    if (!android::base::WriteFully(file->fd.get(), data.data(), data.size())) {
+        PLOG(ERROR) << "Error writing to file";
+        return false;
+    }
+    file->size += data.size();
+    file->needs_sync = true;
+    return true;
+}
+
+bool RingbufferFileWriter::removeOldFiles() {
+    time_t now = time(0);
+    const time_t delete_files_before = now - max_file_age_sec_;
+    std::unique_ptr<DIR, decltype(&closedir)> dir_dump(opendir(dir_.c_str()), closedir);
+    if (!dir_dump) {
+        PLOG(ERROR) << "Failed to open directory";
+        return false;
+    }
+    struct dirent* dp;
+    bool success = true;
+    std::list<std::pair<const time_t, std::string>> valid_files;
+    while ((dp = readdir(dir_dump.get()))) {
+        if (dp->d_type != DT_REG) {
+            continue;
+        }
+        std::string cur_file_name(dp->d_name);
+        struct stat cur_file_stat;
+        std::string cur_file_path = dir_ + cur_file_name;
+        if (stat(cur_file_path.c_str(), &cur_file_stat) == -1) {
+            PLOG(ERROR) << "Failed to get file stat for " << cur_file_path;
+            success = false;
+            continue;
+        }
+        const time_t cur_file_time = cur_file_stat.st_mtime;
+        valid_files.push_back(std::pair<const time_t, std::string>(cur_file_time, cur_file_path));
+    }
+    valid_files.sort();  // sort the list of files by last modified time from
+                         // small to big.
+    uint32_t cur_file_count = valid_files.size();
+    for (auto cur_file : valid_files) {
+        if (cur_file_count > max_file_num_ || cur_file.first < delete_files_before) {
+            if (unlink(cur_file.second.c_str()) != 0) {
+                PLOG(ERROR) << "Error deleting file";
+                success = false;
+            }
+            cur_file_count--;
+        } else {
+            break;
+        }
+    }
+    return success;
+}
+
+}  // namespace implementation
+}  // namespace V1_6
+}  // namespace wifi
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RINGBUFFER_FILE_WRITER_H_
+#define RINGBUFFER_FILE_WRITER_H_
+
+#include <android-base/unique_fd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ringbuffer.h"
+
+namespace android {
+namespace hardware {
+namespace wifi {
+namespace V1_6 {
+namespace implementation {
+
+/**
+ * Persists debug ring buffer data to files from a background thread.
+ *
+ * Every ring is appended to its own file in |dir|, only the data queued since
+ * the previous flush is written. A new file is started once the current one
+ * reaches |max_file_size| bytes, old files are removed the same way as
+ * tombstones are. Files are only fsync()ed every |kMinSyncInterval|, unless a
+ * flush explicitly asks for it.
+ */
+class RingbufferFileWriter {
+  public:
+    RingbufferFileWriter(const std::string& dir, size_t max_file_size, uint32_t max_file_age_sec,
+                         uint32_t max_file_num);
+    // Writes the data queued so far before returning.
+    ~RingbufferFileWriter();
+
+    // Copies the data of |ring| to the queue of ring |name| and clears |ring|.
+    // Cheap enough to be called with the ring buffer lock held.
+    void enqueue(const std::string& name, Ringbuffer& ring);
+    // Asks the writer thread to write all the queued data. Returns a ticket
+    // that can be passed to |waitForFlush|.
+    uint64_t requestFlush(bool sync_to_disk);
+    // Blocks until the flush identified by |ticket| and all the previous ones
+    // completed. Returns false if a write failed since the previous wait.
+    bool waitForFlush(uint64_t ticket);
+
+  private:
+    static constexpr std::chrono::seconds kMinSyncInterval{30};
+
+    struct RingFile {
+        android::base::unique_fd fd;
+        size_t size = 0;
+        bool needs_sync = false;
+        // Data queued by |enqueue| and not handed to the writer thread yet.
+        std::vector<uint8_t> pending;
+    };
+
+    void run();
+    // Appends |data| to the file of ring |name|, opening a new file if needed.
+    bool writeToFile(const std::string& name, RingFile* file, const std::vector<uint8_t>& data);
+    // Deletes files that are older than |max_file_age_sec_| and files in
+    // excess of |max_file_num_|, starting from the oldest ones.
+    bool removeOldFiles();
+
+    const std::string dir_;
+    const size_t max_file_size_;
+    const uint32_t max_file_age_sec_;
+    const uint32_t max_file_num_;
+
+    // Protects all the members below.
+    std::mutex lock_;
+    std::condition_variable cv_;
+    std::map<std::string, RingFile> files_;
+    uint64_t requested_ticket_ = 0;
+    uint64_t completed_ticket_ = 0;
+    bool sync_requested_ = false;
+    bool write_failed_ = false;
+    bool stop_ = false;
+    std::chrono::steady_clock::time_point last_sync_time_;
+    // Started on the first flush request.
+    std::thread thread_;
+};
+
+}  // namespace implementation
+}  // namespace V1_6
+}  // namespace wifi
+}  // namespace hardware
+}  // namespace android
+
+#endif  // RINGBUFFER_FILE_WRITER_H_
@@ -360,6 +360,54 @@ TEST_F(HidlStructUtilTest, canConvertLegacyLinkLayerStatsToHidl) {
     }
 }
 
+TEST_F(HidlStructUtilTest, canConvertLegacyLinkLayerStatsIntoReusedHidlStruct) {
+    // A dual radio chip connected to a busy AP.
+    legacy_hal::LinkLayerStats legacy_stats{};
+    legacy_stats.radios.resize(2);
+    legacy_stats.peers.resize(64);
+    for (auto& radio : legacy_stats.radios) {
+        radio.tx_time_per_levels.resize(8);
+        radio.channel_stats.resize(16);
+    }
+    for (auto& peer : legacy_stats.peers) {
+        peer.rate_stats.resize(8);
+    }
+
+    V1_6::StaLinkLayerStats reused{};
+    ASSERT_TRUE(hidl_struct_util::convertLegacyLinkLayerStatsToHidl(legacy_stats, &reused));
+    const auto* radios = reused.radios.data();
+    const auto* peers = reused.iface.peers.data();
+    const auto* channel_stats = reused.radios[1].channelStats.data();
+    const auto* rate_stats = reused.iface.peers[63].rateStats.data();
+
+    // The next poll has the same shape with updated counters.
+    legacy_stats.iface.beacon_rx = rand();
+    legacy_stats.radios[1].stats.on_time = rand();
+    legacy_stats.radios[1].tx_time_per_levels[3] = rand();
+    legacy_stats.radios[1].channel_stats[5].cca_busy_time = rand();
+    legacy_stats.peers[63].peer_info.bssload.sta_count = rand();
+    legacy_stats.peers[63].rate_stats[7].tx_mpdu = rand();
+    ASSERT_TRUE(hidl_struct_util::convertLegacyLinkLayerStatsToHidl(legacy_stats, &reused));
+    EXPECT_EQ(radios, reused.radios.data());
+    EXPECT_EQ(peers, reused.iface.peers.data());
+    EXPECT_EQ(channel_stats, reused.radios[1].channelStats.data());
+    EXPECT_EQ(rate_stats, reused.iface.peers[63].rateStats.data());
+
+    V1_6::StaLinkLayerStats converted{};
+    ASSERT_TRUE(hidl_struct_util::convertLegacyLinkLayerStatsToHidl(legacy_stats, &converted));
+    converted.timeStampInMs = reused.timeStampInMs;
+    EXPECT_EQ(converted, reused);
+
+    // A peer leaving must not leave stale entries behind.
+    legacy_stats.peers.pop_back();
+    ASSERT_TRUE(hidl_struct_util::convertLegacyLinkLayerStatsToHidl(legacy_stats, &reused));
+    converted = {};
+    ASSERT_TRUE(hidl_struct_util::convertLegacyLinkLayerStatsToHidl(legacy_stats, &converted));
+    converted.timeStampInMs = reused.timeStampInMs;
+    EXPECT_EQ(63u, reused.iface.peers.size());
+    EXPECT_EQ(converted, reused);
+}
+
 TEST_F(HidlStructUtilTest, CanConvertLegacyFeaturesToHidl) {
     using HidlChipCaps = V1_3::IWifiChip::ChipCapabilityMask;
 
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <future>
+
+#include "hidl_sync_util.h"
+
+using testing::Test;
+
+namespace {
+constexpr auto kBlockedTimeout = std::chrono::milliseconds(50);
+}  // namespace
+
+namespace android {
+namespace hardware {
+namespace wifi {
+namespace V1_6 {
+namespace implementation {
+namespace hidl_sync_util {
+class HidlSyncUtilTest : public Test {
+  protected:
+    void SetUp() override { setLockDomainsEnabledForTesting(true); }
+    void TearDown() override { setLockDomainsEnabledForTesting(default_enabled_); }
+
+  private:
+    const bool default_enabled_ = lockDomainsEnabled();
+};
+
+TEST_F(HidlSyncUtilTest, DomainsDoNotExcludeEachOther) {
+    std::future<void> acquired;
+    {
+        const auto lock = acquireLock(LockDomain::STA_IFACE);
+        acquired = std::async(std::launch::async, [] { acquireLock(LockDomain::NAN_IFACE); });
+        EXPECT_EQ(std::future_status::ready, acquired.wait_for(kBlockedTimeout));
+    }
+    acquired.wait();
+}
+
+TEST_F(HidlSyncUtilTest, DomainExcludesItself) {
+    std::future<void> acquired;
+    {
+        const auto lock = acquireLock(LockDomain::STA_IFACE);
+        acquired = std::async(std::launch::async, [] { acquireLock(LockDomain::STA_IFACE); });
+        EXPECT_EQ(std::future_status::timeout, acquired.wait_for(kBlockedTimeout));
+    }
+    acquired.wait();
+}
+
+TEST_F(HidlSyncUtilTest, GlobalExcludesEveryDomain) {
+    std::future<void> acquired;
+    {
+        const auto lock = acquireGlobalLock();
+        acquired = std::async(std::launch::async, [] { acquireLock(LockDomain::RTT_CONTROLLER); });
+        EXPECT_EQ(std::future_status::timeout, acquired.wait_for(kBlockedTimeout));
+    }
+    acquired.wait();
+}
+
+TEST_F(HidlSyncUtilTest, DomainsAreGlobalWhenDisabled) {
+    setLockDomainsEnabledForTesting(false);
+    std::future<void> acquired;
+    {
+        const auto lock = acquireLock(LockDomain::STA_IFACE);
+        acquired = std::async(std::launch::async, [] { acquireLock(LockDomain::NAN_IFACE); });
+        EXPECT_EQ(std::future_status::timeout, acquired.wait_for(kBlockedTimeout));
+    }
+    acquired.wait();
+}
+
+TEST_F(HidlSyncUtilTest, AcquireDomainsInOrder) {
+    const auto sta_lock = acquireLock(LockDomain::STA_IFACE);
+    const auto sta_lock_again = acquireLock(LockDomain::STA_IFACE);
+    const auto nan_lock = acquireLock(LockDomain::NAN_IFACE);
+}
+
+TEST_F(HidlSyncUtilTest, AcquireDomainsAfterGlobal) {
+    const auto global_lock = acquireGlobalLock();
+    const auto nan_lock = acquireLock(LockDomain::NAN_IFACE);
+    const auto sta_lock = acquireLock(LockDomain::STA_IFACE);
+    const auto global_lock_again = acquireGlobalLock();
+}
+
+TEST_F(HidlSyncUtilTest, AcquireDomainsInOrderAfterReleasing) {
+    {
+        const auto nan_lock = acquireLock(LockDomain::NAN_IFACE);
+    }
+    const auto sta_lock = acquireLock(LockDomain::STA_IFACE);
+}
+
+TEST_F(HidlSyncUtilTest, AcquireDomainOutOfOrderDies) {
+    EXPECT_DEATH(
+            {
+                const auto nan_lock = acquireLock(LockDomain::NAN_IFACE);
+                const auto sta_lock = acquireLock(LockDomain::STA_IFACE);
+            },
+            "Acquiring lock domain");
+}
+
+TEST_F(HidlSyncUtilTest, AcquireGlobalAfterDomainDies) {
+    EXPECT_DEATH(
+            {
+                const auto sta_lock = acquireLock(LockDomain::STA_IFACE);
+                const auto global_lock = acquireGlobalLock();
+            },
+            "Acquiring lock domain");
+}
+}  // namespace hidl_sync_util
+}  // namespace implementation
+}  // namespace V1_6
+}  // namespace wifi
+}  // namespace hardware
+}  // namespace android
@@ -34,7 +34,7 @@ class RingbufferTest : public Test {
 };
 
 TEST_F(RingbufferTest, CreateEmptyBuffer) {
-    ASSERT_TRUE(buffer_.getData().empty());
+    ASSERT_TRUE(buffer_.empty());
 }
 
 TEST_F(RingbufferTest, CanUseFullBufferCapacity) {
@@ -42,9 +42,9 @@ TEST_F(RingbufferTest, CanUseFullBufferCapacity) {
     const std::vector<uint8_t> input2(maxBufferSize_ / 2, '1');
     buffer_.append(input);
     buffer_.append(input2);
-    ASSERT_EQ(2u, buffer_.getData().size());
-    EXPECT_EQ(input, buffer_.getData().front());
-    EXPECT_EQ(input2, buffer_.getData().back());
+    ASSERT_EQ(2u, buffer_.getRecords().size());
+    EXPECT_EQ(input, buffer_.getRecords().front());
+    EXPECT_EQ(input2, buffer_.getRecords().back());
 }
 
 TEST_F(RingbufferTest, OldDataIsRemovedOnOverflow) {
@@ -54,9 +54,9 @@ TEST_F(RingbufferTest, OldDataIsRemovedOnOverflow) {
     buffer_.append(input);
     buffer_.append(input2);
     buffer_.append(input3);
-    ASSERT_EQ(2u, buffer_.getData().size());
-    EXPECT_EQ(input2, buffer_.getData().front());
-    EXPECT_EQ(input3, buffer_.getData().back());
+    ASSERT_EQ(2u, buffer_.getRecords().size());
+    EXPECT_EQ(input2, buffer_.getRecords().front());
+    EXPECT_EQ(input3, buffer_.getRecords().back());
 }
 
 TEST_F(RingbufferTest, MultipleOldDataIsRemovedOnOverflow) {
@@ -66,20 +66,20 @@ TEST_F(RingbufferTest, MultipleOldDataIsRemovedOnOverflow) {
     buffer_.append(input);
     buffer_.append(input2);
     buffer_.append(input3);
-    ASSERT_EQ(1u, buffer_.getData().size());
-    EXPECT_EQ(input3, buffer_.getData().front());
+    ASSERT_EQ(1u, buffer_.getRecords().size());
+    EXPECT_EQ(input3, buffer_.getRecords().front());
 }
 
 TEST_F(RingbufferTest, AppendingEmptyBufferDoesNotAddGarbage) {
     const std::vector<uint8_t> input = {};
     buffer_.append(input);
-    ASSERT_TRUE(buffer_.getData().empty());
+    ASSERT_TRUE(buffer_.empty());
 }
 
 TEST_F(RingbufferTest, OversizedAppendIsDropped) {
     const std::vector<uint8_t> input(maxBufferSize_ + 1, '0');
     buffer_.append(input);
-    ASSERT_TRUE(buffer_.getData().empty());
+    ASSERT_TRUE(buffer_.empty());
 }
 
 TEST_F(RingbufferTest, OversizedAppendDoesNotDropExistingData) {
@@ -87,8 +87,51 @@ TEST_F(RingbufferTest, OversizedAppendDoesNotDropExistingData) {
     const std::vector<uint8_t> input2(maxBufferSize_ + 1, '1');
     buffer_.append(input);
     buffer_.append(input2);
-    ASSERT_EQ(1u, buffer_.getData().size());
-    EXPECT_EQ(input, buffer_.getData().front());
+    ASSERT_EQ(1u, buffer_.getRecords().size());
+    EXPECT_EQ(input, buffer_.getRecords().front());
+}
+
+TEST_F(RingbufferTest, WrappedDataIsReturnedInTwoRegions) {
+    const std::vector<uint8_t> input(maxBufferSize_ / 2, '0');
+    const std::vector<uint8_t> input2(maxBufferSize_ / 2, '1');
+    const std::vector<uint8_t> input3 = {'2', '3', '4'};
+    buffer_.append(input);
+    buffer_.append(input2);
+    buffer_.append(input3);
+    ASSERT_EQ(2u, buffer_.getRecords().size());
+    EXPECT_EQ(input2, buffer_.getRecords().front());
+    EXPECT_EQ(input3, buffer_.getRecords().back());
+
+    const auto regions = buffer_.getDataRegions();
+    std::vector<uint8_t> data(regions[0].data, regions[0].data + regions[0].size);
+    data.insert(data.end(), regions[1].data, regions[1].data + regions[1].size);
+    std::vector<uint8_t> expected = input2;
+    expected.insert(expected.end(), input3.begin(), input3.end());
+    EXPECT_EQ(expected, data);
+    EXPECT_EQ(maxBufferSize_ / 2, regions[0].size);
+}
+
+TEST_F(RingbufferTest, ClearRemovesAllData) {
+    const std::vector<uint8_t> input(maxBufferSize_ / 2, '0');
+    const std::vector<uint8_t> input2 = {'1'};
+    buffer_.append(input);
+    buffer_.clear();
+    ASSERT_TRUE(buffer_.empty());
+    ASSERT_TRUE(buffer_.getRecords().empty());
+    buffer_.append(input2);
+    ASSERT_EQ(1u, buffer_.getRecords().size());
+    EXPECT_EQ(input2, buffer_.getRecords().front());
+}
+
+TEST_F(RingbufferTest, ManySmallRecordsAreKept) {
+    for (uint8_t i = 0; i < 3 * maxBufferSize_; i++) {
+        buffer_.append(std::vector<uint8_t>{i});
+    }
+    const auto records = buffer_.getRecords();
+    ASSERT_EQ(maxBufferSize_, records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        EXPECT_EQ(std::vector<uint8_t>{static_cast<uint8_t>(2 * maxBufferSize_ + i)}, records[i]);
+    }
 }
 }  // namespace implementation
 }  // namespace V1_6
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2022, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+#include <android-base/macros.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+
+#undef NAN
+#include "wifi_legacy_hal.h"
+
+#include "mock_interface_tool.h"
+
+using testing::NiceMock;
+using testing::Test;
+
+namespace {
+constexpr char kIfaceName[] = "test-wlan0";
+constexpr std::array<uint8_t, 6> kPeerA = {0x02, 0x12, 0x45, 0x56, 0xab, 0xcc};
+constexpr std::array<uint8_t, 6> kPeerB = {0x02, 0x12, 0x45, 0x56, 0xab, 0xdd};
+}  // namespace
+
+namespace android {
+namespace hardware {
+namespace wifi {
+namespace V1_6 {
+namespace implementation {
+namespace legacy_hal {
+namespace {
+// The handler the legacy HAL passed with the last range request.
+wifi_rtt_event_handler captured_rtt_handler;
+
+wifi_error fakeRttRangeRequest(wifi_request_id /* id */, wifi_interface_handle /* iface */,
+                               unsigned /* num_rtt_config */, wifi_rtt_config* /* rtt_config */,
+                               wifi_rtt_event_handler handler) {
+    captured_rtt_handler = handler;
+    return WIFI_SUCCESS;
+}
+
+wifi_error fakeRttRangeCancel(wifi_request_id /* id */, wifi_interface_handle /* iface */,
+                              unsigned /* num_devices */, mac_addr* /* addr */) {
+    return WIFI_SUCCESS;
+}
+
+// Link layer stats calls so far, each reporting its number as iface beacon_rx.
+uint32_t link_stats_calls;
+wifi_error link_stats_status;
+
+wifi_error fakeGetLinkStats(wifi_request_id id, wifi_interface_handle /* iface */,
+                            wifi_stats_result_handler handler) {
+    link_stats_calls++;
+    if (link_stats_status != WIFI_SUCCESS) {
+        return link_stats_status;
+    }
+    wifi_iface_stat iface_stat = {};
+    iface_stat.beacon_rx = link_stats_calls;
+    wifi_radio_stat radio_stat = {};
+    radio_stat.radio = 0;
+    radio_stat.on_time = 10 * link_stats_calls;
+    handler.on_link_stats_results(id, &iface_stat, 1, &radio_stat);
+    return WIFI_SUCCESS;
+}
+
+wifi_rtt_config rttConfig(const std::array<uint8_t, 6>& peer) {
+    wifi_rtt_config config = {};
+    std::memcpy(config.addr, peer.data(), peer.size());
+    return config;
+}
+}  // namespace
+
+// Each test uses request ids of its own, as the outstanding range requests are global.
+class WifiLegacyHalRttTest : public Test {
+  protected:
+    void SetUp() override {
+        fake_func_table_.wifi_rtt_range_request = fakeRttRangeRequest;
+        fake_func_table_.wifi_rtt_range_cancel = fakeRttRangeCancel;
+        legacy_hal_ = std::make_unique<WifiLegacyHal>(iface_tool_, fake_func_table_, true);
+    }
+
+    wifi_error startRequest(wifi_request_id id,
+                            const std::vector<std::array<uint8_t, 6>>& peers) {
+        std::vector<wifi_rtt_config> configs;
+        for (const auto& peer : peers) {
+            configs.push_back(rttConfig(peer));
+        }
+        return legacy_hal_->startRttRangeRequest(
+                kIfaceName, id, configs,
+                [this](wifi_request_id request_id,
+                       const std::vector<const wifi_rtt_result*>& results) {
+                    delivered_.emplace_back(request_id, results.size());
+                });
+    }
+
+    // Reports a batch with one result for each of |peers| from the driver.
+    void reportResults(wifi_request_id id, const std::vector<std::array<uint8_t, 6>>& peers) {
+        std::vector<wifi_rtt_result> results(peers.size());
+        std::vector<wifi_rtt_result*> result_ptrs;
+        for (size_t i = 0; i < peers.size(); i++) {
+            std::memcpy(results[i].addr, peers[i].data(), peers[i].size());
+            result_ptrs.push_back(&results[i]);
+        }
+        captured_rtt_handler.on_rtt_results(id, result_ptrs.size(), result_ptrs.data());
+    }
+
+    std::shared_ptr<NiceMock<wifi_system::MockInterfaceTool>> iface_tool_{
+            new NiceMock<wifi_system::MockInterfaceTool>};
+    wifi_hal_fn fake_func_table_ = {};
+    std::unique_ptr<WifiLegacyHal> legacy_hal_;
+    // The request id and result count of each batch delivered to the user callback.
+    std::vector<std::pair<wifi_request_id, size_t>> delivered_;
+};
+
+TEST_F(WifiLegacyHalRttTest, DeliversEachBatchUntilEveryPeerReported) {
+    ASSERT_EQ(WIFI_SUCCESS, startRequest(1, {kPeerA, kPeerB}));
+
+    reportResults(1, {kPeerA});
+    EXPECT_EQ(WIFI_ERROR_NOT_AVAILABLE, startRequest(1, {kPeerA}));
+    reportResults(1, {kPeerB});
+
+    std::vector<std::pair<wifi_request_id, size_t>> expected = {{1, 1}, {1, 1}};
+    EXPECT_EQ(expected, delivered_);
+    // The request is complete, so its id is free again and its late results are dropped.
+    reportResults(1, {kPeerA});
+    EXPECT_EQ(expected, delivered_);
+    EXPECT_EQ(WIFI_SUCCESS, startRequest(1, {kPeerA}));
+    reportResults(1, {kPeerA});
+}
+
+TEST_F(WifiLegacyHalRttTest, RoutesResultsByRequestId) {
+    ASSERT_EQ(WIFI_SUCCESS, startRequest(2, {kPeerA}));
+    ASSERT_EQ(WIFI_SUCCESS, startRequest(3, {kPeerA, kPeerB}));
+
+    reportResults(3, {kPeerA, kPeerB});
+    reportResults(2, {kPeerA});
+
+    std::vector<std::pair<wifi_request_id, size_t>> expected = {{3, 2}, {2, 1}};
+    EXPECT_EQ(expected, delivered_);
+}
+
+TEST_F(WifiLegacyHalRttTest, CancelsSomePeersOrAll) {
+    ASSERT_EQ(WIFI_SUCCESS, startRequest(4, {kPeerA, kPeerB}));
+    ASSERT_EQ(WIFI_SUCCESS, startRequest(5, {kPeerA, kPeerB}));
+
+    EXPECT_EQ(WIFI_SUCCESS, legacy_hal_->cancelRttRangeRequest(kIfaceName, 4, {kPeerA}));
+    EXPECT_EQ(WIFI_SUCCESS, legacy_hal_->cancelRttRangeRequest(kIfaceName, 5, {}));
+
+    // Request 5 is gone, request 4 completes once its remaining peer reports.
+    EXPECT_EQ(WIFI_ERROR_NOT_AVAILABLE, legacy_hal_->cancelRttRangeRequest(kIfaceName, 5, {}));
+    reportResults(4, {kPeerB});
+    EXPECT_EQ(WIFI_SUCCESS, startRequest(4, {kPeerA}));
+    EXPECT_EQ(WIFI_SUCCESS, legacy_hal_->cancelRttRangeRequest(kIfaceName, 4, {}));
+}
+
+TEST_F(WifiLegacyHalRttTest, ExpiresRequestsWithPeersThatNeverReport) {
+    legacy_hal_->setRttRangeRequestTimeoutForTesting(std::chrono::milliseconds(0));
+    ASSERT_EQ(WIFI_SUCCESS, startRequest(6, {kPeerA, kPeerB}));
+    reportResults(6, {kPeerA});
+
+    // Peer B never reports, starting the next request drops the expired one.
+    EXPECT_EQ(WIFI_SUCCESS, startRequest(7, {kPeerA}));
+    reportResults(6, {kPeerB});
+    EXPECT_EQ(WIFI_SUCCESS, startRequest(6, {kPeerA}));
+
+    std::vector<std::pair<wifi_request_id, size_t>> expected = {{6, 1}};
+    EXPECT_EQ(expected, delivered_);
+    EXPECT_EQ(WIFI_SUCCESS, legacy_hal_->cancelRttRangeRequest(kIfaceName, 6, {}));
+}
+
+TEST_F(WifiLegacyHalRttTest, KeepsRequestsUntilTheyExpire) {
+    ASSERT_EQ(WIFI_SUCCESS, startRequest(8, {kPeerA, kPeerB}));
+
+    EXPECT_EQ(WIFI_SUCCESS, startRequest(9, {kPeerA}));
+    EXPECT_EQ(WIFI_ERROR_NOT_AVAILABLE, startRequest(8, {kPeerA}));
+
+    EXPECT_EQ(WIFI_SUCCESS, legacy_hal_->cancelRttRangeRequest(kIfaceName, 8, {}));
+    EXPECT_EQ(WIFI_SUCCESS, legacy_hal_->cancelRttRangeRequest(kIfaceName, 9, {}));
+}
+
+class WifiLegacyHalLinkLayerStatsTest : public Test {
+  protected:
+    void SetUp() override {
+        link_stats_calls = 0;
+        link_stats_status = WIFI_SUCCESS;
+        fake_func_table_.wifi_get_link_stats = fakeGetLinkStats;
+        legacy_hal_ = std::make_unique<WifiLegacyHal>(iface_tool_, fake_func_table_, true);
+    }
+
+    std::shared_ptr<NiceMock<wifi_system::MockInterfaceTool>> iface_tool_{
+            new NiceMock<wifi_system::MockInterfaceTool>};
+    wifi_hal_fn fake_func_table_ = {};
+    std::unique_ptr<WifiLegacyHal> legacy_hal_;
+};
+
+TEST_F(WifiLegacyHalLinkLayerStatsTest, FetchesOnEveryCallByDefault) {
+    legacy_hal_->setLinkLayerStatsFreshnessForTesting(std::chrono::milliseconds(0));
+
+    auto [first_status, first] = legacy_hal_->sampleLinkLayerStats(kIfaceName);
+    ASSERT_EQ(WIFI_SUCCESS, first_status);
+    EXPECT_EQ(1u, first->stats.iface.beacon_rx);
+    auto [second_status, second] = legacy_hal_->sampleLinkLayerStats(kIfaceName);
+    ASSERT_EQ(WIFI_SUCCESS, second_status);
+    EXPECT_EQ(2u, second->stats.iface.beacon_rx);
+    ASSERT_EQ(1u, second->stats.radios.size());
+    EXPECT_EQ(20u, second->stats.radios[0].stats.on_time);
+
+    EXPECT_EQ(2u, link_stats_calls);
+}
+
+TEST_F(WifiLegacyHalLinkLayerStatsTest, SharesFreshSamples) {
+    legacy_hal_->setLinkLayerStatsFreshnessForTesting(std::chrono::hours(1));
+
+    auto [first_status, first] = legacy_hal_->sampleLinkLayerStats(kIfaceName);
+    ASSERT_EQ(WIFI_SUCCESS, first_status);
+    auto [second_status, second] = legacy_hal_->sampleLinkLayerStats(kIfaceName);
+    ASSERT_EQ(WIFI_SUCCESS, second_status);
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(1u, second->stats.iface.beacon_rx);
+    EXPECT_EQ(1u, link_stats_calls);
+    // The samples of other interfaces are their own.
+    auto [other_status, other] = legacy_hal_->sampleLinkLayerStats("test-wlan1");
+    ASSERT_EQ(WIFI_SUCCESS, other_status);
+    EXPECT_NE(first, other);
+    EXPECT_EQ(2u, link_stats_calls);
+}
+
+TEST_F(WifiLegacyHalLinkLayerStatsTest, FetchesAgainAfterAFailure) {
+    legacy_hal_->setLinkLayerStatsFreshnessForTesting(std::chrono::milliseconds(0));
+    ASSERT_EQ(WIFI_SUCCESS, legacy_hal_->sampleLinkLayerStats(kIfaceName).first);
+
+    link_stats_status = WIFI_ERROR_NOT_AVAILABLE;
+    auto [failed_status, failed] = legacy_hal_->sampleLinkLayerStats(kIfaceName);
+    EXPECT_EQ(WIFI_ERROR_NOT_AVAILABLE, failed_status);
+    EXPECT_EQ(nullptr, failed);
+
+    // A failed fetch is never served as fresh.
+    legacy_hal_->setLinkLayerStatsFreshnessForTesting(std::chrono::hours(1));
+    link_stats_status = WIFI_SUCCESS;
+    auto [status, sample] = legacy_hal_->sampleLinkLayerStats(kIfaceName);
+    ASSERT_EQ(WIFI_SUCCESS, status);
+    EXPECT_EQ(3u, sample->stats.iface.beacon_rx);
+    EXPECT_EQ(3u, link_stats_calls);
+}
+}  // namespace legacy_hal
+}  // namespace implementation
+}  // namespace V1_6
+}  // namespace wifi
+}  // namespace hardware
+}  // namespace android
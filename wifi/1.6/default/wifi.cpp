@@ -166,7 +166,7 @@ WifiStatus Wifi::startInternal() {
 }
 
 WifiStatus Wifi::stopInternal(
-        /* NONNULL */ std::unique_lock<std::recursive_mutex>* lock) {
+        /* NONNULL */ hidl_sync_util::DomainLock* lock) {
     if (run_state_ == RunState::STOPPED) {
         return createWifiStatus(WifiStatusCode::SUCCESS);
     } else if (run_state_ == RunState::STOPPING) {
@@ -248,7 +248,7 @@ WifiStatus Wifi::initializeModeControllerAndLegacyHal() {
 }
 
 WifiStatus Wifi::stopLegacyHalAndDeinitializeModeController(
-        /* NONNULL */ std::unique_lock<std::recursive_mutex>* lock) {
+        /* NONNULL */ hidl_sync_util::DomainLock* lock) {
     legacy_hal::wifi_error legacy_status = legacy_hal::WIFI_SUCCESS;
     int index = 0;
 
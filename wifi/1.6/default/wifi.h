@@ -28,6 +28,7 @@
 #include <functional>
 
 #include "hidl_callback_util.h"
+#include "hidl_sync_util.h"
 #include "wifi_chip.h"
 #include "wifi_feature_flags.h"
 #include "wifi_legacy_hal.h"
@@ -45,6 +46,9 @@ namespace implementation {
  */
 class Wifi : public V1_6::IWifi {
   public:
+    // Domain of the lock held by the HIDL methods, see hidl_sync_util.
+    static constexpr hidl_sync_util::LockDomain kLockDomain =
+            hidl_sync_util::LockDomain::GLOBAL;
     Wifi(const std::shared_ptr<wifi_system::InterfaceTool> iface_tool,
          const std::shared_ptr<legacy_hal::WifiLegacyHalFactory> legacy_hal_factory,
          const std::shared_ptr<mode_controller::WifiModeController> mode_controller,
@@ -73,13 +77,13 @@ class Wifi : public V1_6::IWifi {
     WifiStatus registerEventCallbackInternal_1_5(
             const sp<V1_5::IWifiEventCallback>& event_callback);
     WifiStatus startInternal();
-    WifiStatus stopInternal(std::unique_lock<std::recursive_mutex>* lock);
+    WifiStatus stopInternal(hidl_sync_util::DomainLock* lock);
     std::pair<WifiStatus, std::vector<ChipId>> getChipIdsInternal();
     std::pair<WifiStatus, sp<V1_4::IWifiChip>> getChipInternal(ChipId chip_id);
 
     WifiStatus initializeModeControllerAndLegacyHal();
     WifiStatus stopLegacyHalAndDeinitializeModeController(
-            std::unique_lock<std::recursive_mutex>* lock);
+            hidl_sync_util::DomainLock* lock);
     ChipId getChipIdFromWifiChip(sp<WifiChip>& chip);
 
     // Instance is created in this root level |IWifi| HIDL interface object
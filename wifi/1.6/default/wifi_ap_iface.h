@@ -20,6 +20,7 @@
 #include <android-base/macros.h>
 #include <android/hardware/wifi/1.5/IWifiApIface.h>
 
+#include "hidl_sync_util.h"
 #include "wifi_iface_util.h"
 #include "wifi_legacy_hal.h"
 
@@ -35,6 +36,9 @@ using namespace android::hardware::wifi::V1_0;
  */
 class WifiApIface : public V1_5::IWifiApIface {
   public:
+    // Domain of the lock held by the HIDL methods, see hidl_sync_util.
+    static constexpr hidl_sync_util::LockDomain kLockDomain =
+            hidl_sync_util::LockDomain::AP_IFACE;
     WifiApIface(const std::string& ifname, const std::vector<std::string>& instances,
                 const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal,
                 const std::weak_ptr<iface_util::WifiIfaceUtil> iface_util);
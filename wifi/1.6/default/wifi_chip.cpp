@@ -15,6 +15,7 @@
  */
 
 #include <fcntl.h>
+#include <algorithm>
 
 #include <android-base/logging.h>
 #include <android-base/unique_fd.h>
@@ -169,52 +170,6 @@ void setActiveWlanIfaceNameProperty(const std::string& ifname) {
     }
 }
 
-// delete files that meet either conditions:
-// 1. older than a predefined time in the wifi tombstone dir.
-// 2. Files in excess to a predefined amount, starting from the oldest ones
-bool removeOldFilesInternal() {
-    time_t now = time(0);
-    const time_t delete_files_before = now - kMaxRingBufferFileAgeSeconds;
-    std::unique_ptr<DIR, decltype(&closedir)> dir_dump(opendir(kTombstoneFolderPath), closedir);
-    if (!dir_dump) {
-        PLOG(ERROR) << "Failed to open directory";
-        return false;
-    }
-    struct dirent* dp;
-    bool success = true;
-    std::list<std::pair<const time_t, std::string>> valid_files;
-    while ((dp = readdir(dir_dump.get()))) {
-        if (dp->d_type != DT_REG) {
-            continue;
-        }
-        std::string cur_file_name(dp->d_name);
-        struct stat cur_file_stat;
-        std::string cur_file_path = kTombstoneFolderPath + cur_file_name;
-        if (stat(cur_file_path.c_str(), &cur_file_stat) == -1) {
-            PLOG(ERROR) << "Failed to get file stat for " << cur_file_path;
-            success = false;
-            continue;
-        }
-        const time_t cur_file_time = cur_file_stat.st_mtime;
-        valid_files.push_back(std::pair<const time_t, std::string>(cur_file_time, cur_file_path));
-    }
-    valid_files.sort();  // sort the list of files by last modified time from
-                         // small to big.
-    uint32_t cur_file_count = valid_files.size();
-    for (auto cur_file : valid_files) {
-        if (cur_file_count > kMaxRingBufferFileNum || cur_file.first < delete_files_before) {
-            if (unlink(cur_file.second.c_str()) != 0) {
-                PLOG(ERROR) << "Error deleting file";
-                success = false;
-            }
-            cur_file_count--;
-        } else {
-            break;
-        }
-    }
-    return success;
-}
-
 // Helper function for |cpioArchiveFilesInDir|
 bool cpioWriteHeader(int out_fd, struct stat& st, const char* file_name, size_t file_name_len) {
     const int buf_size = 32 * 1024;
@@ -372,6 +327,8 @@ WifiChip::WifiChip(ChipId chip_id, bool is_primary,
       legacy_hal_(legacy_hal),
       mode_controller_(mode_controller),
       iface_util_(iface_util),
+      ringbuffer_writer_(kTombstoneFolderPath, kMaxBufferSizeBytes, kMaxRingBufferFileAgeSeconds,
+                         kMaxRingBufferFileNum),
       is_valid_(true),
       current_mode_id_(feature_flags::chip_mode_ids::kInvalid),
       modes_(feature_flags.lock()->getChipModes(is_primary)),
@@ -381,7 +338,7 @@ WifiChip::WifiChip(ChipId chip_id, bool is_primary,
 }
 
 void WifiChip::invalidate() {
-    if (!writeRingbufferFilesInternal()) {
+    if (!ringbuffer_writer_.waitForFlush(flushRingbuffersInternal(true /* sync_to_disk */))) {
         LOG(ERROR) << "Error writing files to flash";
     }
     invalidateAndRemoveAllIfaces();
@@ -395,7 +352,7 @@ bool WifiChip::isValid() {
     return is_valid_;
 }
 
-std::set<sp<V1_4::IWifiChipEventCallback>> WifiChip::getEventCallbacks() {
+hidl_callback_util::HidlCallbackList<V1_4::IWifiChipEventCallback> WifiChip::getEventCallbacks() {
     return event_cb_handler_.getCallbacks();
 }
 
@@ -641,7 +598,8 @@ Return<void> WifiChip::debug(const hidl_handle& handle, const hidl_vec<hidl_stri
         usleep(100 * 1000);  // sleep for 100 milliseconds to wait for
                              // ringbuffer updates.
         int fd = handle->data[0];
-        if (!writeRingbufferFilesInternal()) {
+        // The archive reads the files back, so there is no need to wait for them to be synced.
+        if (!ringbuffer_writer_.waitForFlush(flushRingbuffersInternal(false /* sync_to_disk */))) {
             LOG(ERROR) << "Error writing files to flash";
         }
         uint32_t n_error = cpioArchiveFilesInDir(fd, kTombstoneFolderPath);
@@ -847,7 +805,7 @@ WifiChip::getAvailableModesInternal() {
 }
 
 WifiStatus WifiChip::configureChipInternal(
-        /* NONNULL */ std::unique_lock<std::recursive_mutex>* lock, ChipModeId mode_id) {
+        /* NONNULL */ hidl_sync_util::DomainLock* lock, ChipModeId mode_id) {
     if (!isValidModeId(mode_id)) {
         return createWifiStatus(WifiStatusCode::ERROR_INVALID_ARGS);
     }
@@ -870,6 +828,7 @@ WifiStatus WifiChip::configureChipInternal(
         }
     }
     current_mode_id_ = mode_id;
+    updateCurrentModeExpandedConcurrencyCombinations();
     LOG(INFO) << "Configured chip in mode " << mode_id;
     setActiveWlanIfaceNameProperty(getFirstActiveWlanIfaceName());
 
@@ -1286,8 +1245,12 @@ WifiStatus WifiChip::startLoggingToDebugRingBufferInternal(
             getFirstActiveWlanIfaceName(), ring_name,
             static_cast<std::underlying_type<WifiDebugRingBufferVerboseLevel>::type>(verbose_level),
             max_interval_in_sec, min_data_size_in_bytes);
-    ringbuffer_map_.insert(
-            std::pair<std::string, Ringbuffer>(ring_name, Ringbuffer(kMaxBufferSizeBytes)));
+    {
+        std::unique_lock<std::mutex> lk(lock_t);
+        ringbuffer_map_.insert(
+                std::pair<std::string, Ringbuffer>(ring_name, Ringbuffer(kMaxBufferSizeBytes)));
+        // unique_lock unlocked here
+    }
     // if verbose logging enabled, turn up HAL daemon logging as well.
     if (verbose_level < WifiDebugRingBufferVerboseLevel::VERBOSE) {
         android::base::SetMinimumLogSeverity(android::base::DEBUG);
@@ -1309,10 +1272,8 @@ WifiStatus WifiChip::forceDumpToDebugRingBufferInternal(const hidl_string& ring_
 }
 
 WifiStatus WifiChip::flushRingBufferToFileInternal() {
-    if (!writeRingbufferFilesInternal()) {
-        LOG(ERROR) << "Error writing files to flash";
-        return createWifiStatus(WifiStatusCode::ERROR_UNKNOWN);
-    }
+    // The data is captured now, write errors are logged by the writer thread.
+    flushRingbuffersInternal(true /* sync_to_disk */);
     return createWifiStatus(WifiStatusCode::SUCCESS);
 }
 
@@ -1552,7 +1513,7 @@ WifiChip::getAvailableModesInternal_1_6() {
 }
 
 WifiStatus WifiChip::handleChipConfiguration(
-        /* NONNULL */ std::unique_lock<std::recursive_mutex>* lock, ChipModeId mode_id) {
+        /* NONNULL */ hidl_sync_util::DomainLock* lock, ChipModeId mode_id) {
     // If the chip is already configured in a different mode, stop
     // the legacy HAL and then start it after firmware mode change.
     if (isValidModeId(current_mode_id_)) {
@@ -1633,7 +1594,7 @@ WifiStatus WifiChip::registerDebugRingBufferCallback() {
                 }
                 if (appendstatus == Ringbuffer::AppendStatus::FAIL_RING_BUFFER_CORRUPTED) {
                     LOG(ERROR) << "Ringname " << name << " is corrupted. Clear the ring buffer";
-                    shared_ptr_this->writeRingbufferFilesInternal();
+                    shared_ptr_this->flushRingbuffersInternal(false /* sync_to_disk */);
                     return;
                 }
 
@@ -1713,11 +1674,32 @@ std::map<IfaceConcurrencyType, size_t> WifiChip::getCurrentConcurrencyCombinatio
     return iface_counts;
 }
 
+// Packs the iface counts of |combo| into one byte per concurrency type. Each count is capped
+// at 0x7f, which keeps the top bit of every byte free for the comparison below.
+WifiChip::ConcurrencyCounts WifiChip::packConcurrencyCounts(
+        const std::map<IfaceConcurrencyType, size_t>& combo) {
+    ConcurrencyCounts counts = 0;
+    for (const auto& [type, count] : combo) {
+        counts |= static_cast<ConcurrencyCounts>(std::min<size_t>(count, 0x7f))
+                  << (8 * static_cast<uint32_t>(type));
+    }
+    return counts;
+}
+
+// Returns true if every count of |req_counts| fits in the corresponding count of
+// |expanded_combo|. Setting the top bit of each byte of the allowed counts before subtracting
+// the needed ones leaves that bit set exactly in the bytes that did not have to borrow.
+bool WifiChip::canExpandedConcurrencyComboSupportConcurrencyCounts(
+        ConcurrencyCounts expanded_combo, ConcurrencyCounts req_counts) {
+    constexpr ConcurrencyCounts kGuardBits = 0x8080808080;
+    return (((expanded_combo | kGuardBits) - req_counts) & kGuardBits) == kGuardBits;
+}
+
 // This expands the provided concurrency combinations to a more parseable
 // form. Returns a vector of available combinations possible with the number
 // of each concurrency type in the combination.
 // This method is a port of HalDeviceManager.expandConcurrencyCombos() from framework.
-std::vector<std::map<IfaceConcurrencyType, size_t>> WifiChip::expandConcurrencyCombinations(
+std::vector<WifiChip::ConcurrencyCounts> WifiChip::expandConcurrencyCombinations(
         const V1_6::IWifiChip::ChipConcurrencyCombination& combination) {
     uint32_t num_expanded_combos = 1;
     for (const auto& limit : combination.limits) {
@@ -1730,13 +1712,6 @@ std::vector<std::map<IfaceConcurrencyType, size_t>> WifiChip::expandConcurrencyC
     // in each combo.
     std::vector<std::map<IfaceConcurrencyType, size_t>> expanded_combos;
     expanded_combos.resize(num_expanded_combos);
-    for (auto& expanded_combo : expanded_combos) {
-        for (const auto type :
-             {IfaceConcurrencyType::AP, IfaceConcurrencyType::AP_BRIDGED, IfaceConcurrencyType::NAN,
-              IfaceConcurrencyType::P2P, IfaceConcurrencyType::STA}) {
-            expanded_combo[type] = 0;
-        }
-    }
     uint32_t span = num_expanded_combos;
     for (const auto& limit : combination.limits) {
         for (uint32_t i = 0; i < limit.maxIfaces; i++) {
@@ -1747,33 +1722,31 @@ std::vector<std::map<IfaceConcurrencyType, size_t>> WifiChip::expandConcurrencyC
             }
         }
     }
-    return expanded_combos;
+
+    // Many of the expansions only differ in the order of the ifaces, keep one of each.
+    std::vector<ConcurrencyCounts> packed_combos;
+    packed_combos.reserve(expanded_combos.size());
+    for (const auto& expanded_combo : expanded_combos) {
+        packed_combos.push_back(packConcurrencyCounts(expanded_combo));
+    }
+    std::sort(packed_combos.begin(), packed_combos.end());
+    packed_combos.erase(std::unique(packed_combos.begin(), packed_combos.end()),
+                        packed_combos.end());
+    return packed_combos;
 }
 
-bool WifiChip::canExpandedConcurrencyComboSupportConcurrencyTypeWithCurrentTypes(
-        const std::map<IfaceConcurrencyType, size_t>& expanded_combo,
-        IfaceConcurrencyType requested_type) {
-    const auto current_combo = getCurrentConcurrencyCombination();
-
-    // Check if we have space for 1 more iface of |type| in this combo
-    for (const auto type :
-         {IfaceConcurrencyType::AP, IfaceConcurrencyType::AP_BRIDGED, IfaceConcurrencyType::NAN,
-          IfaceConcurrencyType::P2P, IfaceConcurrencyType::STA}) {
-        size_t num_ifaces_needed = current_combo.at(type);
-        if (type == requested_type) {
-            num_ifaces_needed++;
-        }
-        size_t num_ifaces_allowed = expanded_combo.at(type);
-        if (num_ifaces_needed > num_ifaces_allowed) {
-            return false;
-        }
+void WifiChip::updateCurrentModeExpandedConcurrencyCombinations() {
+    current_mode_expanded_combos_.clear();
+    for (const auto& combination : getCurrentModeConcurrencyCombinations()) {
+        const auto expanded_combos = expandConcurrencyCombinations(combination);
+        current_mode_expanded_combos_.insert(current_mode_expanded_combos_.end(),
+                                             expanded_combos.begin(), expanded_combos.end());
     }
-    return true;
 }
 
 // This method does the following:
-// a) Enumerate all possible concurrency combos by expanding the current
-//    ChipConcurrencyCombination.
+// a) Look up the concurrency combos expanded from the current
+//    ChipConcurrencyCombination when the mode was configured.
 // b) Check if the requested concurrency type can be added to the current mode
 //    with the concurrency combination that is already active.
 bool WifiChip::canCurrentModeSupportConcurrencyTypeWithCurrentTypes(
@@ -1782,43 +1755,21 @@ bool WifiChip::canCurrentModeSupportConcurrencyTypeWithCurrentTypes(
         LOG(ERROR) << "Chip not configured in a mode yet";
         return false;
     }
-    const auto combinations = getCurrentModeConcurrencyCombinations();
-    for (const auto& combination : combinations) {
-        const auto expanded_combos = expandConcurrencyCombinations(combination);
-        for (const auto& expanded_combo : expanded_combos) {
-            if (canExpandedConcurrencyComboSupportConcurrencyTypeWithCurrentTypes(expanded_combo,
-                                                                                  requested_type)) {
-                return true;
-            }
+    // Check if we have space for 1 more iface of |type| in a combo
+    auto req_combo = getCurrentConcurrencyCombination();
+    req_combo[requested_type]++;
+    const ConcurrencyCounts req_counts = packConcurrencyCounts(req_combo);
+    for (const auto expanded_combo : current_mode_expanded_combos_) {
+        if (canExpandedConcurrencyComboSupportConcurrencyCounts(expanded_combo, req_counts)) {
+            return true;
         }
     }
     return false;
 }
 
-// Note: This does not consider concurrency types already active. It only checks if the
-// provided expanded concurrency combination can support the requested combo.
-bool WifiChip::canExpandedConcurrencyComboSupportConcurrencyCombo(
-        const std::map<IfaceConcurrencyType, size_t>& expanded_combo,
-        const std::map<IfaceConcurrencyType, size_t>& req_combo) {
-    // Check if we have space for 1 more |type| in this combo
-    for (const auto type :
-         {IfaceConcurrencyType::AP, IfaceConcurrencyType::AP_BRIDGED, IfaceConcurrencyType::NAN,
-          IfaceConcurrencyType::P2P, IfaceConcurrencyType::STA}) {
-        if (req_combo.count(type) == 0) {
-            // Concurrency type not in the req_combo.
-            continue;
-        }
-        size_t num_ifaces_needed = req_combo.at(type);
-        size_t num_ifaces_allowed = expanded_combo.at(type);
-        if (num_ifaces_needed > num_ifaces_allowed) {
-            return false;
-        }
-    }
-    return true;
-}
 // This method does the following:
-// a) Enumerate all possible concurrency combos by expanding the current
-//    ChipConcurrencyCombination.
+// a) Look up the concurrency combos expanded from the current
+//    ChipConcurrencyCombination when the mode was configured.
 // b) Check if the requested concurrency combo can be added to the current mode.
 // Note: This does not consider concurrency types already active. It only checks if the
 // current mode can support the requested combo.
@@ -1828,13 +1779,10 @@ bool WifiChip::canCurrentModeSupportConcurrencyCombo(
         LOG(ERROR) << "Chip not configured in a mode yet";
         return false;
     }
-    const auto combinations = getCurrentModeConcurrencyCombinations();
-    for (const auto& combination : combinations) {
-        const auto expanded_combos = expandConcurrencyCombinations(combination);
-        for (const auto& expanded_combo : expanded_combos) {
-            if (canExpandedConcurrencyComboSupportConcurrencyCombo(expanded_combo, req_combo)) {
-                return true;
-            }
+    const ConcurrencyCounts req_counts = packConcurrencyCounts(req_combo);
+    for (const auto expanded_combo : current_mode_expanded_combos_) {
+        if (canExpandedConcurrencyComboSupportConcurrencyCounts(expanded_combo, req_counts)) {
+            return true;
         }
     }
     return false;
@@ -1957,42 +1905,18 @@ std::string WifiChip::allocateStaIfaceName() {
     return allocateApOrStaIfaceName(IfaceType::STA, 0);
 }
 
-bool WifiChip::writeRingbufferFilesInternal() {
-    if (!removeOldFilesInternal()) {
-        LOG(ERROR) << "Error occurred while deleting old tombstone files";
-        return false;
-    }
-    // write ringbuffers to file
+uint64_t WifiChip::flushRingbuffersInternal(bool sync_to_disk) {
     {
         std::unique_lock<std::mutex> lk(lock_t);
         for (auto& item : ringbuffer_map_) {
             Ringbuffer& cur_buffer = item.second;
-            if (cur_buffer.getData().empty()) {
-                continue;
+            if (!cur_buffer.empty()) {
+                ringbuffer_writer_.enqueue(item.first, cur_buffer);
             }
-            const std::string file_path_raw = kTombstoneFolderPath + item.first + "XXXXXXXXXX";
-            const int dump_fd = mkstemp(makeCharVec(file_path_raw).data());
-            if (dump_fd == -1) {
-                PLOG(ERROR) << "create file failed";
-                return false;
-            }
-            unique_fd file_auto_closer(dump_fd);
-            for (const auto& cur_block : cur_buffer.getData()) {
-                if (cur_block.size() <= 0 || cur_block.size() > kMaxBufferSizeBytes) {
-                    PLOG(ERROR) << "Ring buffer: " << item.first
-                                << " is corrupted. Invalid block size: " << cur_block.size();
-                    break;
-                }
-                if (write(dump_fd, cur_block.data(), sizeof(cur_block[0]) * cur_block.size()) ==
-                    -1) {
-                    PLOG(ERROR) << "Error writing to file";
-                }
-            }
-            cur_buffer.clear();
         }
         // unique_lock unlocked here
     }
-    return true;
+    return ringbuffer_writer_.requestFlush(sync_to_disk);
 }
 
 std::string WifiChip::getWlanIfaceNameWithType(IfaceType type, unsigned idx) {
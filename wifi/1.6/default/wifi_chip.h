@@ -32,7 +32,9 @@
 #include <android/hardware/wifi/1.6/IWifiStaIface.h>
 
 #include "hidl_callback_util.h"
+#include "hidl_sync_util.h"
 #include "ringbuffer.h"
+#include "ringbuffer_file_writer.h"
 #include "wifi_ap_iface.h"
 #include "wifi_feature_flags.h"
 #include "wifi_legacy_hal.h"
@@ -57,6 +59,9 @@ using V1_5::WifiBand;
  */
 class WifiChip : public V1_6::IWifiChip {
   public:
+    // Domain of the lock held by the HIDL methods, see hidl_sync_util.
+    static constexpr hidl_sync_util::LockDomain kLockDomain =
+            hidl_sync_util::LockDomain::GLOBAL;
     WifiChip(ChipId chip_id, bool is_primary,
              const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal,
              const std::weak_ptr<mode_controller::WifiModeController> mode_controller,
@@ -78,7 +83,7 @@ class WifiChip : public V1_6::IWifiChip {
     // marked valid before processing them.
     void invalidate();
     bool isValid();
-    std::set<sp<V1_4::IWifiChipEventCallback>> getEventCallbacks();
+    hidl_callback_util::HidlCallbackList<V1_4::IWifiChipEventCallback> getEventCallbacks();
 
     // HIDL methods exposed.
     Return<void> getId(getId_cb hidl_status_cb) override;
@@ -182,7 +187,7 @@ class WifiChip : public V1_6::IWifiChip {
             const sp<V1_0::IWifiChipEventCallback>& event_callback);
     std::pair<WifiStatus, uint32_t> getCapabilitiesInternal();
     std::pair<WifiStatus, std::vector<V1_0::IWifiChip::ChipMode>> getAvailableModesInternal();
-    WifiStatus configureChipInternal(std::unique_lock<std::recursive_mutex>* lock,
+    WifiStatus configureChipInternal(hidl_sync_util::DomainLock* lock,
                                      ChipModeId mode_id);
     std::pair<WifiStatus, uint32_t> getModeInternal();
     std::pair<WifiStatus, IWifiChip::ChipDebugInfo> requestChipDebugInfoInternal();
@@ -241,22 +246,24 @@ class WifiChip : public V1_6::IWifiChip {
     WifiStatus setCountryCodeInternal(const std::array<int8_t, 2>& code);
     std::pair<WifiStatus, std::vector<V1_5::WifiUsableChannel>> getUsableChannelsInternal(
             WifiBand band, uint32_t ifaceModeMask, uint32_t filterMask);
-    WifiStatus handleChipConfiguration(std::unique_lock<std::recursive_mutex>* lock,
+    WifiStatus handleChipConfiguration(hidl_sync_util::DomainLock* lock,
                                        ChipModeId mode_id);
     WifiStatus registerDebugRingBufferCallback();
     WifiStatus registerRadioModeChangeCallback();
     std::vector<V1_6::IWifiChip::ChipConcurrencyCombination>
     getCurrentModeConcurrencyCombinations();
     std::map<IfaceConcurrencyType, size_t> getCurrentConcurrencyCombination();
-    std::vector<std::map<IfaceConcurrencyType, size_t>> expandConcurrencyCombinations(
+    // The number of ifaces of each concurrency type in a combination, packed in one byte per
+    // type, so that whole combinations can be compared with a few integer operations.
+    using ConcurrencyCounts = uint64_t;
+    static ConcurrencyCounts packConcurrencyCounts(
+            const std::map<IfaceConcurrencyType, size_t>& combo);
+    static bool canExpandedConcurrencyComboSupportConcurrencyCounts(
+            ConcurrencyCounts expanded_combo, ConcurrencyCounts req_counts);
+    std::vector<ConcurrencyCounts> expandConcurrencyCombinations(
             const V1_6::IWifiChip::ChipConcurrencyCombination& combination);
-    bool canExpandedConcurrencyComboSupportConcurrencyTypeWithCurrentTypes(
-            const std::map<IfaceConcurrencyType, size_t>& expanded_combo,
-            IfaceConcurrencyType requested_type);
+    void updateCurrentModeExpandedConcurrencyCombinations();
     bool canCurrentModeSupportConcurrencyTypeWithCurrentTypes(IfaceConcurrencyType requested_type);
-    bool canExpandedConcurrencyComboSupportConcurrencyCombo(
-            const std::map<IfaceConcurrencyType, size_t>& expanded_combo,
-            const std::map<IfaceConcurrencyType, size_t>& req_combo);
     bool canCurrentModeSupportConcurrencyCombo(
             const std::map<IfaceConcurrencyType, size_t>& req_combo);
     bool canCurrentModeSupportConcurrencyType(IfaceConcurrencyType requested_type);
@@ -269,7 +276,9 @@ class WifiChip : public V1_6::IWifiChip {
     std::string allocateApIfaceName();
     std::vector<std::string> allocateBridgedApInstanceNames();
     std::string allocateStaIfaceName();
-    bool writeRingbufferFilesInternal();
+    // Hands the new ring buffer data to |ringbuffer_writer_| and returns the
+    // flush ticket.
+    uint64_t flushRingbuffersInternal(bool sync_to_disk);
     std::string getWlanIfaceNameWithType(IfaceType type, unsigned idx);
     void invalidateAndClearBridgedApAll();
     void deleteApIface(const std::string& if_name);
@@ -292,11 +301,15 @@ class WifiChip : public V1_6::IWifiChip {
     std::vector<sp<WifiStaIface>> sta_ifaces_;
     std::vector<sp<WifiRttController>> rtt_controllers_;
     std::map<std::string, Ringbuffer> ringbuffer_map_;
+    RingbufferFileWriter ringbuffer_writer_;
     bool is_valid_;
     // Members pertaining to chip configuration.
     uint32_t current_mode_id_;
     std::mutex lock_t;
     std::vector<V1_6::IWifiChip::ChipMode> modes_;
+    // Every combination of iface counts the current mode supports, expanded once when the chip
+    // is configured as the checks before each iface creation only need to look them up.
+    std::vector<ConcurrencyCounts> current_mode_expanded_combos_;
     // The legacy ring buffer callback API has only a global callback
     // registration mechanism. Use this to check if we have already
     // registered a callback.
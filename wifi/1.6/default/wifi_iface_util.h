@@ -19,6 +19,8 @@
 
 #include <wifi_system/interface_tool.h>
 
+#include <mutex>
+
 #include <android/hardware/wifi/1.0/IWifi.h>
 
 #include "wifi_legacy_hal.h"
@@ -73,6 +75,9 @@ class WifiIfaceUtil {
   private:
     std::weak_ptr<wifi_system::InterfaceTool> iface_tool_;
     std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal_;
+    // Guards the members below, the interfaces call in here while holding
+    // their own domain lock.
+    std::mutex lock_;
     std::unique_ptr<std::array<uint8_t, 6>> random_mac_address_;
     std::map<std::string, IfaceEventHandlers> event_handlers_map_;
 };
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 
@@ -38,9 +39,13 @@ static constexpr uint32_t kMaxWakeReasonStatsArraySize = 32;
 static constexpr uint32_t kMaxRingBuffers = 10;
 static constexpr uint32_t kMaxWifiUsableChannels = 256;
 static constexpr uint32_t kMaxSupportedRadioCombinationsMatrixLength = 256;
+// Outstanding RTT range requests whose peers have not all reported within this are dropped.
+static constexpr uint32_t kRttRangeRequestTimeoutMs = 30000;
 // need a long timeout (1000ms) for chips that unload their driver.
 static constexpr uint32_t kMaxStopCompleteWaitMs = 1000;
 static constexpr char kDriverPropName[] = "wlan.driver.status";
+static constexpr char kLinkLayerStatsFreshnessPropName[] =
+        "ro.vendor.wifi.link_layer_stats.freshness_ms";
 
 // Helper function to create a non-const char* for legacy Hal API's.
 std::vector<char> makeCharVec(const std::string& str) {
@@ -92,7 +97,7 @@ void onSyncFirmwareMemoryDump(char* buffer, int buffer_size) {
 // Callback to be invoked for Gscan events.
 std::function<void(wifi_request_id, wifi_scan_event)> on_gscan_event_internal_callback;
 void onAsyncGscanEvent(wifi_request_id id, wifi_scan_event event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::STA_IFACE);
     if (on_gscan_event_internal_callback) {
         on_gscan_event_internal_callback(id, event);
     }
@@ -103,7 +108,7 @@ std::function<void(wifi_request_id, wifi_scan_result*, uint32_t)>
         on_gscan_full_result_internal_callback;
 void onAsyncGscanFullResult(wifi_request_id id, wifi_scan_result* result,
                             uint32_t buckets_scanned) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::STA_IFACE);
     if (on_gscan_full_result_internal_callback) {
         on_gscan_full_result_internal_callback(id, result, buckets_scanned);
     }
@@ -123,7 +128,7 @@ void onSyncLinkLayerStatsResult(wifi_request_id id, wifi_iface_stat* iface_stat,
 std::function<void((wifi_request_id, uint8_t*, int8_t))>
         on_rssi_threshold_breached_internal_callback;
 void onAsyncRssiThresholdBreached(wifi_request_id id, uint8_t* bssid, int8_t rssi) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::STA_IFACE);
     if (on_rssi_threshold_breached_internal_callback) {
         on_rssi_threshold_breached_internal_callback(id, bssid, rssi);
     }
@@ -168,15 +173,62 @@ void onAsyncSubsystemRestart(const char* error) {
     }
 }
 
-// Callback to be invoked for rtt results results.
-std::function<void(wifi_request_id, unsigned num_results, wifi_rtt_result* rtt_results[])>
-        on_rtt_results_internal_callback;
+// Outstanding rtt range requests, by request id. A driver may report the results of a request
+// in several batches, so a request is only complete once every peer it ranges has reported.
+// A driver that never reports a peer would keep its request, and its id, forever, so requests
+// expire after a while.
+struct RttRangeRequest {
+    std::vector<std::array<uint8_t, 6>> pending_peers;
+    on_rtt_results_callback on_results_user_callback;
+    std::chrono::steady_clock::time_point expiry;
+};
+std::map<wifi_request_id, RttRangeRequest> rtt_range_requests;
+void dropExpiredRttRangeRequests(std::chrono::steady_clock::time_point now) {
+    for (auto it = rtt_range_requests.begin(); it != rtt_range_requests.end();) {
+        if (now >= it->second.expiry) {
+            LOG(WARNING) << "RTT range request " << it->first << " expired with "
+                         << it->second.pending_peers.size() << " peers pending";
+            it = rtt_range_requests.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
 void onAsyncRttResults(wifi_request_id id, unsigned num_results, wifi_rtt_result* rtt_results[]) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
-    if (on_rtt_results_internal_callback) {
-        on_rtt_results_internal_callback(id, num_results, rtt_results);
-        on_rtt_results_internal_callback = nullptr;
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::RTT_CONTROLLER);
+    const auto it = rtt_range_requests.find(id);
+    if (it == rtt_range_requests.end()) {
+        LOG(ERROR) << "RTT results for unknown request " << id;
+        return;
+    }
+    if (num_results > 0 && !rtt_results) {
+        LOG(ERROR) << "Unexpected nullptr in RTT results";
+        return;
+    }
+    RttRangeRequest& request = it->second;
+    std::vector<const wifi_rtt_result*> rtt_results_vec;
+    rtt_results_vec.reserve(num_results);
+    for (unsigned i = 0; i < num_results; i++) {
+        const wifi_rtt_result* rtt_result = rtt_results[i];
+        if (rtt_result == nullptr) {
+            continue;
+        }
+        rtt_results_vec.push_back(rtt_result);
+        auto& peers = request.pending_peers;
+        peers.erase(std::remove_if(peers.begin(), peers.end(),
+                                   [rtt_result](const std::array<uint8_t, 6>& peer) {
+                                       return std::equal(peer.begin(), peer.end(),
+                                                         rtt_result->addr);
+                                   }),
+                    peers.end());
+    }
+    // Copied, as the user callback may start another request and invalidate |request|.
+    const bool complete = request.pending_peers.empty();
+    const on_rtt_results_callback on_results_user_callback = request.on_results_user_callback;
+    if (complete) {
+        rtt_range_requests.erase(it);
     }
+    on_results_user_callback(id, rtt_results_vec);
 }
 
 // Callbacks for the various NAN operations.
@@ -185,7 +237,7 @@ void onAsyncRttResults(wifi_request_id id, unsigned num_results, wifi_rtt_result
 // So, handle all of them here directly to avoid adding an unnecessary layer.
 std::function<void(transaction_id, const NanResponseMsg&)> on_nan_notify_response_user_callback;
 void onAysncNanNotifyResponse(transaction_id id, NanResponseMsg* msg) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_notify_response_user_callback && msg) {
         on_nan_notify_response_user_callback(id, *msg);
     }
@@ -198,7 +250,7 @@ void onAysncNanEventPublishReplied(NanPublishRepliedInd* /* event */) {
 
 std::function<void(const NanPublishTerminatedInd&)> on_nan_event_publish_terminated_user_callback;
 void onAysncNanEventPublishTerminated(NanPublishTerminatedInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_publish_terminated_user_callback && event) {
         on_nan_event_publish_terminated_user_callback(*event);
     }
@@ -206,7 +258,7 @@ void onAysncNanEventPublishTerminated(NanPublishTerminatedInd* event) {
 
 std::function<void(const NanMatchInd&)> on_nan_event_match_user_callback;
 void onAysncNanEventMatch(NanMatchInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_match_user_callback && event) {
         on_nan_event_match_user_callback(*event);
     }
@@ -214,7 +266,7 @@ void onAysncNanEventMatch(NanMatchInd* event) {
 
 std::function<void(const NanMatchExpiredInd&)> on_nan_event_match_expired_user_callback;
 void onAysncNanEventMatchExpired(NanMatchExpiredInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_match_expired_user_callback && event) {
         on_nan_event_match_expired_user_callback(*event);
     }
@@ -223,7 +275,7 @@ void onAysncNanEventMatchExpired(NanMatchExpiredInd* event) {
 std::function<void(const NanSubscribeTerminatedInd&)>
         on_nan_event_subscribe_terminated_user_callback;
 void onAysncNanEventSubscribeTerminated(NanSubscribeTerminatedInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_subscribe_terminated_user_callback && event) {
         on_nan_event_subscribe_terminated_user_callback(*event);
     }
@@ -231,7 +283,7 @@ void onAysncNanEventSubscribeTerminated(NanSubscribeTerminatedInd* event) {
 
 std::function<void(const NanFollowupInd&)> on_nan_event_followup_user_callback;
 void onAysncNanEventFollowup(NanFollowupInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_followup_user_callback && event) {
         on_nan_event_followup_user_callback(*event);
     }
@@ -239,7 +291,7 @@ void onAysncNanEventFollowup(NanFollowupInd* event) {
 
 std::function<void(const NanDiscEngEventInd&)> on_nan_event_disc_eng_event_user_callback;
 void onAysncNanEventDiscEngEvent(NanDiscEngEventInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_disc_eng_event_user_callback && event) {
         on_nan_event_disc_eng_event_user_callback(*event);
     }
@@ -247,7 +299,7 @@ void onAysncNanEventDiscEngEvent(NanDiscEngEventInd* event) {
 
 std::function<void(const NanDisabledInd&)> on_nan_event_disabled_user_callback;
 void onAysncNanEventDisabled(NanDisabledInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_disabled_user_callback && event) {
         on_nan_event_disabled_user_callback(*event);
     }
@@ -255,7 +307,7 @@ void onAysncNanEventDisabled(NanDisabledInd* event) {
 
 std::function<void(const NanTCAInd&)> on_nan_event_tca_user_callback;
 void onAysncNanEventTca(NanTCAInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_tca_user_callback && event) {
         on_nan_event_tca_user_callback(*event);
     }
@@ -263,7 +315,7 @@ void onAysncNanEventTca(NanTCAInd* event) {
 
 std::function<void(const NanBeaconSdfPayloadInd&)> on_nan_event_beacon_sdf_payload_user_callback;
 void onAysncNanEventBeaconSdfPayload(NanBeaconSdfPayloadInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_beacon_sdf_payload_user_callback && event) {
         on_nan_event_beacon_sdf_payload_user_callback(*event);
     }
@@ -271,14 +323,14 @@ void onAysncNanEventBeaconSdfPayload(NanBeaconSdfPayloadInd* event) {
 
 std::function<void(const NanDataPathRequestInd&)> on_nan_event_data_path_request_user_callback;
 void onAysncNanEventDataPathRequest(NanDataPathRequestInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_data_path_request_user_callback && event) {
         on_nan_event_data_path_request_user_callback(*event);
     }
 }
 std::function<void(const NanDataPathConfirmInd&)> on_nan_event_data_path_confirm_user_callback;
 void onAysncNanEventDataPathConfirm(NanDataPathConfirmInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_data_path_confirm_user_callback && event) {
         on_nan_event_data_path_confirm_user_callback(*event);
     }
@@ -286,7 +338,7 @@ void onAysncNanEventDataPathConfirm(NanDataPathConfirmInd* event) {
 
 std::function<void(const NanDataPathEndInd&)> on_nan_event_data_path_end_user_callback;
 void onAysncNanEventDataPathEnd(NanDataPathEndInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_data_path_end_user_callback && event) {
         on_nan_event_data_path_end_user_callback(*event);
     }
@@ -294,7 +346,7 @@ void onAysncNanEventDataPathEnd(NanDataPathEndInd* event) {
 
 std::function<void(const NanTransmitFollowupInd&)> on_nan_event_transmit_follow_up_user_callback;
 void onAysncNanEventTransmitFollowUp(NanTransmitFollowupInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_transmit_follow_up_user_callback && event) {
         on_nan_event_transmit_follow_up_user_callback(*event);
     }
@@ -302,7 +354,7 @@ void onAysncNanEventTransmitFollowUp(NanTransmitFollowupInd* event) {
 
 std::function<void(const NanRangeRequestInd&)> on_nan_event_range_request_user_callback;
 void onAysncNanEventRangeRequest(NanRangeRequestInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_range_request_user_callback && event) {
         on_nan_event_range_request_user_callback(*event);
     }
@@ -310,7 +362,7 @@ void onAysncNanEventRangeRequest(NanRangeRequestInd* event) {
 
 std::function<void(const NanRangeReportInd&)> on_nan_event_range_report_user_callback;
 void onAysncNanEventRangeReport(NanRangeReportInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_range_report_user_callback && event) {
         on_nan_event_range_report_user_callback(*event);
     }
@@ -318,7 +370,7 @@ void onAysncNanEventRangeReport(NanRangeReportInd* event) {
 
 std::function<void(const NanDataPathScheduleUpdateInd&)> on_nan_event_schedule_update_user_callback;
 void onAsyncNanEventScheduleUpdate(NanDataPathScheduleUpdateInd* event) {
-    const auto lock = hidl_sync_util::acquireGlobalLock();
+    const auto lock = hidl_sync_util::acquireLock(hidl_sync_util::LockDomain::NAN_IFACE);
     if (on_nan_event_schedule_update_user_callback && event) {
         on_nan_event_schedule_update_user_callback(*event);
     }
@@ -375,7 +427,11 @@ WifiLegacyHal::WifiLegacyHal(const std::weak_ptr<wifi_system::InterfaceTool> ifa
       awaiting_event_loop_termination_(false),
       is_started_(false),
       iface_tool_(iface_tool),
-      is_primary_(is_primary) {}
+      is_primary_(is_primary),
+      rtt_range_request_timeout_(kRttRangeRequestTimeoutMs) {
+    link_layer_stats_freshness_ = std::chrono::milliseconds(
+            std::max(property_get_int32(kLinkLayerStatsFreshnessPropName, 0), 0));
+}
 
 wifi_error WifiLegacyHal::initialize() {
     LOG(DEBUG) << "Initialize legacy HAL";
@@ -426,7 +482,7 @@ wifi_error WifiLegacyHal::start() {
 }
 
 wifi_error WifiLegacyHal::stop(
-        /* NONNULL */ std::unique_lock<std::recursive_mutex>* lock,
+        /* NONNULL */ hidl_sync_util::DomainLock* lock,
         const std::function<void()>& on_stop_complete_user_callback) {
     if (!is_started_) {
         LOG(DEBUG) << "Legacy HAL already stopped";
@@ -677,9 +733,37 @@ wifi_error WifiLegacyHal::disableLinkLayerStats(const std::string& iface_name) {
 std::pair<wifi_error, LinkLayerStats> WifiLegacyHal::getLinkLayerStats(
         const std::string& iface_name) {
     LinkLayerStats link_stats{};
-    LinkLayerStats* link_stats_ptr = &link_stats;
+    wifi_error status = fetchLinkLayerStats(iface_name, &link_stats);
+    return {status, std::move(link_stats)};
+}
+
+std::pair<wifi_error, const LinkLayerStatsSample*> WifiLegacyHal::sampleLinkLayerStats(
+        const std::string& iface_name) {
+    LinkLayerStatsSampler& sampler = link_layer_stats_samplers_[iface_name];
+    const auto now = std::chrono::steady_clock::now();
+    if (sampler.valid && now - sampler.sample.time < link_layer_stats_freshness_) {
+        return {WIFI_SUCCESS, &sampler.sample};
+    }
+
+    wifi_error status = fetchLinkLayerStats(iface_name, &sampler.next);
+    if (status != WIFI_SUCCESS) {
+        sampler.valid = false;
+        return {status, nullptr};
+    }
 
-    on_link_layer_stats_result_internal_callback = [&link_stats_ptr](
+    // The previous stats become the buffer of the next fetch.
+    std::swap(sampler.sample.stats, sampler.next);
+    sampler.sample.time = now;
+    sampler.valid = true;
+    return {WIFI_SUCCESS, &sampler.sample};
+}
+
+wifi_error WifiLegacyHal::fetchLinkLayerStats(const std::string& iface_name,
+                                              LinkLayerStats* link_stats) {
+    // The vectors are only resized by the callback so that the elements, and with them the
+    // capacity of their own vectors, left behind by a previous fetch are reused.
+    bool received = false;
+    on_link_layer_stats_result_internal_callback = [link_stats, &received](
                                                            wifi_request_id /* id */,
                                                            wifi_iface_stat* iface_stats_ptr,
                                                            int num_radios,
@@ -687,36 +771,39 @@ std::pair<wifi_error, LinkLayerStats> WifiLegacyHal::getLinkLayerStats(
         wifi_radio_stat* l_radio_stats_ptr;
         wifi_peer_info* l_peer_info_stats_ptr;
 
+        received = true;
         if (iface_stats_ptr != nullptr) {
-            link_stats_ptr->iface = *iface_stats_ptr;
+            link_stats->iface = *iface_stats_ptr;
+            link_stats->peers.resize(iface_stats_ptr->num_peers);
             l_peer_info_stats_ptr = iface_stats_ptr->peer_info;
             for (uint32_t i = 0; i < iface_stats_ptr->num_peers; i++) {
-                WifiPeerInfo peer;
+                WifiPeerInfo& peer = link_stats->peers[i];
                 peer.peer_info = *l_peer_info_stats_ptr;
-                if (l_peer_info_stats_ptr->num_rate > 0) {
-                    /* Copy the rate stats */
-                    peer.rate_stats.assign(
-                            l_peer_info_stats_ptr->rate_stats,
-                            l_peer_info_stats_ptr->rate_stats + l_peer_info_stats_ptr->num_rate);
-                }
+                /* Copy the rate stats */
+                peer.rate_stats.assign(
+                        l_peer_info_stats_ptr->rate_stats,
+                        l_peer_info_stats_ptr->rate_stats + l_peer_info_stats_ptr->num_rate);
                 peer.peer_info.num_rate = 0;
-                link_stats_ptr->peers.push_back(peer);
                 l_peer_info_stats_ptr =
                         (wifi_peer_info*)((u8*)l_peer_info_stats_ptr + sizeof(wifi_peer_info) +
                                           (sizeof(wifi_rate_stat) *
                                            l_peer_info_stats_ptr->num_rate));
             }
-            link_stats_ptr->iface.num_peers = 0;
+            link_stats->iface.num_peers = 0;
         } else {
             LOG(ERROR) << "Invalid iface stats in link layer stats";
+            link_stats->iface = {};
+            link_stats->peers.clear();
         }
         if (num_radios <= 0 || radio_stats_ptr == nullptr) {
             LOG(ERROR) << "Invalid radio stats in link layer stats";
+            link_stats->radios.clear();
             return;
         }
+        link_stats->radios.resize(num_radios);
         l_radio_stats_ptr = radio_stats_ptr;
         for (int i = 0; i < num_radios; i++) {
-            LinkLayerRadioStats radio;
+            LinkLayerRadioStats& radio = link_stats->radios[i];
 
             radio.stats = *l_radio_stats_ptr;
             // Copy over the tx level array to the separate vector.
@@ -725,17 +812,15 @@ std::pair<wifi_error, LinkLayerStats> WifiLegacyHal::getLinkLayerStats(
                 radio.tx_time_per_levels.assign(
                         l_radio_stats_ptr->tx_time_per_levels,
                         l_radio_stats_ptr->tx_time_per_levels + l_radio_stats_ptr->num_tx_levels);
+            } else {
+                radio.tx_time_per_levels.clear();
             }
             radio.stats.num_tx_levels = 0;
             radio.stats.tx_time_per_levels = nullptr;
             /* Copy over the channel stat to separate vector */
-            if (l_radio_stats_ptr->num_channels > 0) {
-                /* Copy the channel stats */
-                radio.channel_stats.assign(
-                        l_radio_stats_ptr->channels,
-                        l_radio_stats_ptr->channels + l_radio_stats_ptr->num_channels);
-            }
-            link_stats_ptr->radios.push_back(radio);
+            radio.channel_stats.assign(
+                    l_radio_stats_ptr->channels,
+                    l_radio_stats_ptr->channels + l_radio_stats_ptr->num_channels);
             l_radio_stats_ptr =
                     (wifi_radio_stat*)((u8*)l_radio_stats_ptr + sizeof(wifi_radio_stat) +
                                        (sizeof(wifi_channel_stat) *
@@ -746,7 +831,10 @@ std::pair<wifi_error, LinkLayerStats> WifiLegacyHal::getLinkLayerStats(
     wifi_error status = global_func_table_.wifi_get_link_stats(0, getIfaceHandle(iface_name),
                                                                {onSyncLinkLayerStatsResult});
     on_link_layer_stats_result_internal_callback = nullptr;
-    return {status, link_stats};
+    if (!received) {
+        *link_stats = {};
+    }
+    return status;
 }
 
 wifi_error WifiLegacyHal::startRssiMonitoring(
@@ -1083,29 +1171,29 @@ wifi_error WifiLegacyHal::startRttRangeRequest(
         const std::string& iface_name, wifi_request_id id,
         const std::vector<wifi_rtt_config>& rtt_configs,
         const on_rtt_results_callback& on_results_user_callback) {
-    if (on_rtt_results_internal_callback) {
+    const auto now = std::chrono::steady_clock::now();
+    dropExpiredRttRangeRequests(now);
+    if (rtt_range_requests.count(id) > 0) {
         return WIFI_ERROR_NOT_AVAILABLE;
     }
 
-    on_rtt_results_internal_callback = [on_results_user_callback](wifi_request_id id,
-                                                                  unsigned num_results,
-                                                                  wifi_rtt_result* rtt_results[]) {
-        if (num_results > 0 && !rtt_results) {
-            LOG(ERROR) << "Unexpected nullptr in RTT results";
-            return;
-        }
-        std::vector<const wifi_rtt_result*> rtt_results_vec;
-        std::copy_if(rtt_results, rtt_results + num_results, back_inserter(rtt_results_vec),
-                     [](wifi_rtt_result* rtt_result) { return rtt_result != nullptr; });
-        on_results_user_callback(id, rtt_results_vec);
-    };
+    RttRangeRequest& request = rtt_range_requests[id];
+    request.on_results_user_callback = on_results_user_callback;
+    request.expiry = now + rtt_range_request_timeout_;
+    request.pending_peers.reserve(rtt_configs.size());
+    for (const auto& rtt_config : rtt_configs) {
+        std::array<uint8_t, 6> peer;
+        static_assert(sizeof(rtt_config.addr) == sizeof(peer), "MAC address size mismatch");
+        std::copy(rtt_config.addr, rtt_config.addr + peer.size(), peer.begin());
+        request.pending_peers.push_back(peer);
+    }
 
     std::vector<wifi_rtt_config> rtt_configs_internal(rtt_configs);
     wifi_error status = global_func_table_.wifi_rtt_range_request(
             id, getIfaceHandle(iface_name), rtt_configs.size(), rtt_configs_internal.data(),
             {onAsyncRttResults});
     if (status != WIFI_SUCCESS) {
-        on_rtt_results_internal_callback = nullptr;
+        rtt_range_requests.erase(id);
     }
     return status;
 }
@@ -1113,20 +1201,30 @@ wifi_error WifiLegacyHal::startRttRangeRequest(
 wifi_error WifiLegacyHal::cancelRttRangeRequest(
         const std::string& iface_name, wifi_request_id id,
         const std::vector<std::array<uint8_t, 6>>& mac_addrs) {
-    if (!on_rtt_results_internal_callback) {
+    const auto it = rtt_range_requests.find(id);
+    if (it == rtt_range_requests.end()) {
         return WIFI_ERROR_NOT_AVAILABLE;
     }
     static_assert(sizeof(mac_addr) == sizeof(std::array<uint8_t, 6>), "MAC address size mismatch");
-    // TODO: How do we handle partial cancels (i.e only a subset of enabled mac
-    // addressed are cancelled).
     std::vector<std::array<uint8_t, 6>> mac_addrs_internal(mac_addrs);
     wifi_error status = global_func_table_.wifi_rtt_range_cancel(
             id, getIfaceHandle(iface_name), mac_addrs.size(),
             reinterpret_cast<mac_addr*>(mac_addrs_internal.data()));
     // If the request Id is wrong, don't stop the ongoing range request. Any
-    // other error should be treated as the end of rtt ranging.
+    // other error should be treated as the end of ranging the cancelled peers,
+    // and an empty list of peers cancels all of them.
     if (status != WIFI_ERROR_INVALID_REQUEST_ID) {
-        on_rtt_results_internal_callback = nullptr;
+        auto& peers = it->second.pending_peers;
+        peers.erase(std::remove_if(peers.begin(), peers.end(),
+                                   [&mac_addrs](const std::array<uint8_t, 6>& peer) {
+                                       return mac_addrs.empty() ||
+                                              std::find(mac_addrs.begin(), mac_addrs.end(),
+                                                        peer) != mac_addrs.end();
+                                   }),
+                    peers.end());
+        if (peers.empty()) {
+            rtt_range_requests.erase(it);
+        }
     }
     return status;
 }
@@ -1347,6 +1445,7 @@ wifi_error WifiLegacyHal::retrieveIfaceHandles() {
         return status;
     }
     iface_name_to_handle_.clear();
+    link_layer_stats_samplers_.clear();
     for (int i = 0; i < num_iface_handles; ++i) {
         std::array<char, IFNAMSIZ> iface_name_arr = {};
         status = global_func_table_.wifi_get_iface_name(iface_handles[i], iface_name_arr.data(),
@@ -1592,6 +1691,7 @@ wifi_error WifiLegacyHal::enableWifiTxPowerLimits(const std::string& iface_name,
 void WifiLegacyHal::invalidate() {
     global_handle_ = nullptr;
     iface_name_to_handle_.clear();
+    link_layer_stats_samplers_.clear();
     on_driver_memory_dump_internal_callback = nullptr;
     on_firmware_memory_dump_internal_callback = nullptr;
     on_gscan_event_internal_callback = nullptr;
@@ -1602,7 +1702,7 @@ void WifiLegacyHal::invalidate() {
     on_error_alert_internal_callback = nullptr;
     on_radio_mode_change_internal_callback = nullptr;
     on_subsystem_restart_internal_callback = nullptr;
-    on_rtt_results_internal_callback = nullptr;
+    rtt_range_requests.clear();
     on_nan_notify_response_user_callback = nullptr;
     on_nan_event_publish_terminated_user_callback = nullptr;
     on_nan_event_match_user_callback = nullptr;
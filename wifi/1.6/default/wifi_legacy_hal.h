@@ -17,6 +17,8 @@
 #ifndef WIFI_LEGACY_HAL_H_
 #define WIFI_LEGACY_HAL_H_
 
+#include <array>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <map>
@@ -26,6 +28,8 @@
 #include <hardware_legacy/wifi_hal.h>
 #include <wifi_system/interface_tool.h>
 
+#include "hidl_sync_util.h"
+
 namespace android {
 namespace hardware {
 namespace wifi {
@@ -364,6 +368,12 @@ struct LinkLayerStats {
 };
 #pragma GCC diagnostic pop
 
+// Link layer stats of an interface, and when they were fetched from the driver.
+struct LinkLayerStatsSample {
+    std::chrono::steady_clock::time_point time;
+    LinkLayerStats stats;
+};
+
 // The |WLAN_DRIVER_WAKE_REASON_CNT.cmd_event_wake_cnt| and
 // |WLAN_DRIVER_WAKE_REASON_CNT.driver_fw_local_wake_cnt| stats is provided
 // as a pointer in |WLAN_DRIVER_WAKE_REASON_CNT| structure in the legacy HAL
@@ -412,7 +422,8 @@ using on_gscan_results_callback =
 using on_rssi_threshold_breached_callback =
         std::function<void(wifi_request_id, std::array<uint8_t, 6>, int8_t)>;
 
-// Callback for RTT range request results.
+// Callback for RTT range request results, invoked for every batch of results
+// the driver reports until each peer of the request has reported.
 // Rtt results contain IE info and are hence passed by reference, to
 // preserve the |LCI| and |LCR| pointers. Callee must not retain
 // the pointer.
@@ -484,7 +495,7 @@ class WifiLegacyHal {
     virtual wifi_error start();
     // Deinitialize the legacy HAL and wait for the event loop thread to exit
     // using a predefined timeout.
-    virtual wifi_error stop(std::unique_lock<std::recursive_mutex>* lock,
+    virtual wifi_error stop(hidl_sync_util::DomainLock* lock,
                             const std::function<void()>& on_complete_callback);
     virtual wifi_error waitForDriverReady();
     // Checks if legacy HAL has successfully started
@@ -530,6 +541,17 @@ class WifiLegacyHal {
     wifi_error enableLinkLayerStats(const std::string& iface_name, bool debug);
     wifi_error disableLinkLayerStats(const std::string& iface_name);
     std::pair<wifi_error, LinkLayerStats> getLinkLayerStats(const std::string& iface_name);
+    // Same as getLinkLayerStats(), but keeps the sample of each interface and returns it
+    // without asking the driver again while it is younger than the freshness window set by
+    // ro.vendor.wifi.link_layer_stats.freshness_ms (0, the default, fetches on every call). The
+    // returned sample is only valid until the next call for the same interface, and like
+    // the other calls must be made with the HAL lock held.
+    std::pair<wifi_error, const LinkLayerStatsSample*> sampleLinkLayerStats(
+            const std::string& iface_name);
+    // Overrides the freshness window read from the property.
+    void setLinkLayerStatsFreshnessForTesting(std::chrono::milliseconds freshness) {
+        link_layer_stats_freshness_ = freshness;
+    }
     // RSSI monitor functions.
     wifi_error startRssiMonitoring(
             const std::string& iface_name, wifi_request_id id, int8_t max_rssi, int8_t min_rssi,
@@ -585,6 +607,10 @@ class WifiLegacyHal {
                                     const on_rtt_results_callback& on_results_callback);
     wifi_error cancelRttRangeRequest(const std::string& iface_name, wifi_request_id id,
                                      const std::vector<std::array<uint8_t, 6>>& mac_addrs);
+    // Range requests started from now on expire after |timeout| instead of the default.
+    void setRttRangeRequestTimeoutForTesting(std::chrono::milliseconds timeout) {
+        rtt_range_request_timeout_ = timeout;
+    }
     std::pair<wifi_error, wifi_rtt_capabilities> getRttCapabilities(const std::string& iface_name);
     std::pair<wifi_error, wifi_rtt_responder> getRttResponderInfo(const std::string& iface_name);
     wifi_error enableRttResponder(const std::string& iface_name, wifi_request_id id,
@@ -696,6 +722,8 @@ class WifiLegacyHal {
     std::pair<wifi_error, std::vector<wifi_cached_scan_results>> getGscanCachedResults(
             const std::string& iface_name);
     void invalidate();
+    // Fills |link_stats| in place, reusing the capacity of its vectors.
+    wifi_error fetchLinkLayerStats(const std::string& iface_name, LinkLayerStats* link_stats);
     // Handles wifi (error) status of Virtual interface create/delete
     wifi_error handleVirtualInterfaceCreateOrDeleteStatus(const std::string& ifname,
                                                           wifi_error status);
@@ -707,6 +735,15 @@ class WifiLegacyHal {
     // Map of interface name to handle that is to be used for all interface
     // specific operations.
     std::map<std::string, wifi_interface_handle> iface_name_to_handle_;
+    // Latest link layer stats sample of each interface, and the buffer the next one is
+    // fetched into before they are swapped.
+    struct LinkLayerStatsSampler {
+        bool valid = false;
+        LinkLayerStatsSample sample;
+        LinkLayerStats next;
+    };
+    std::map<std::string, LinkLayerStatsSampler> link_layer_stats_samplers_;
+    std::chrono::milliseconds link_layer_stats_freshness_;
     // Flag to indicate if we have initiated the cleanup of legacy HAL.
     std::atomic<bool> awaiting_event_loop_termination_;
     std::condition_variable_any stop_wait_cv_;
@@ -718,6 +755,8 @@ class WifiLegacyHal {
     // such as bring wlan0 interface up/down on start/stop HAL.
     // it may be removed once vendor HALs are updated.
     bool is_primary_;
+    // How long an RTT range request waits for all of its peers to report.
+    std::chrono::milliseconds rtt_range_request_timeout_;
 };
 
 }  // namespace legacy_hal
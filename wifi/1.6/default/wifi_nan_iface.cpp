@@ -454,6 +454,9 @@ WifiNanIface::WifiNanIface(const std::string& ifname, bool is_dedicated_iface,
     // Register for iface state toggle events.
     iface_util::IfaceEventHandlers event_handlers = {};
     event_handlers.on_state_toggle_off_on = [weak_ptr_this](const std::string& /* iface_name */) {
+        // Invoked from the thread changing the MAC address, which may hold
+        // another interface's lock.
+        const auto lock = hidl_sync_util::acquireLock(kLockDomain);
         const auto shared_ptr_this = weak_ptr_this.promote();
         if (!shared_ptr_this.get() || !shared_ptr_this->isValid()) {
             LOG(ERROR) << "Callback invoked on an invalid object";
@@ -498,19 +501,23 @@ std::string WifiNanIface::getName() {
     return ifname_;
 }
 
-std::set<sp<V1_0::IWifiNanIfaceEventCallback>> WifiNanIface::getEventCallbacks() {
+hidl_callback_util::HidlCallbackList<V1_0::IWifiNanIfaceEventCallback>
+WifiNanIface::getEventCallbacks() {
     return event_cb_handler_.getCallbacks();
 }
 
-std::set<sp<V1_2::IWifiNanIfaceEventCallback>> WifiNanIface::getEventCallbacks_1_2() {
+hidl_callback_util::HidlCallbackList<V1_2::IWifiNanIfaceEventCallback>
+WifiNanIface::getEventCallbacks_1_2() {
     return event_cb_handler_1_2_.getCallbacks();
 }
 
-std::set<sp<V1_5::IWifiNanIfaceEventCallback>> WifiNanIface::getEventCallbacks_1_5() {
+hidl_callback_util::HidlCallbackList<V1_5::IWifiNanIfaceEventCallback>
+WifiNanIface::getEventCallbacks_1_5() {
     return event_cb_handler_1_5_.getCallbacks();
 }
 
-std::set<sp<V1_6::IWifiNanIfaceEventCallback>> WifiNanIface::getEventCallbacks_1_6() {
+hidl_callback_util::HidlCallbackList<V1_6::IWifiNanIfaceEventCallback>
+WifiNanIface::getEventCallbacks_1_6() {
     return event_cb_handler_1_6_.getCallbacks();
 }
 
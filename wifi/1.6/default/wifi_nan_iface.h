@@ -22,6 +22,7 @@
 #include <android/hardware/wifi/1.6/IWifiNanIfaceEventCallback.h>
 
 #include "hidl_callback_util.h"
+#include "hidl_sync_util.h"
 #include "wifi_iface_util.h"
 #include "wifi_legacy_hal.h"
 
@@ -40,6 +41,9 @@ using namespace android::hardware::wifi::V1_6;
  */
 class WifiNanIface : public V1_6::IWifiNanIface {
   public:
+    // Domain of the lock held by the HIDL methods, see hidl_sync_util.
+    static constexpr hidl_sync_util::LockDomain kLockDomain =
+            hidl_sync_util::LockDomain::NAN_IFACE;
     WifiNanIface(const std::string& ifname, bool is_dedicated_iface,
                  const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal,
                  const std::weak_ptr<iface_util::WifiIfaceUtil> iface_util);
@@ -178,13 +182,13 @@ class WifiNanIface : public V1_6::IWifiNanIface {
             uint16_t cmd_id, const V1_6::NanRespondToDataPathIndicationRequest& msg);
 
     // all 1_0 and descendant callbacks
-    std::set<sp<V1_0::IWifiNanIfaceEventCallback>> getEventCallbacks();
+    hidl_callback_util::HidlCallbackList<V1_0::IWifiNanIfaceEventCallback> getEventCallbacks();
     // all 1_2 and descendant callbacks
-    std::set<sp<V1_2::IWifiNanIfaceEventCallback>> getEventCallbacks_1_2();
+    hidl_callback_util::HidlCallbackList<V1_2::IWifiNanIfaceEventCallback> getEventCallbacks_1_2();
     // all 1_5 and descendant callbacks
-    std::set<sp<V1_5::IWifiNanIfaceEventCallback>> getEventCallbacks_1_5();
+    hidl_callback_util::HidlCallbackList<V1_5::IWifiNanIfaceEventCallback> getEventCallbacks_1_5();
     // all 1_6 and descendant callbacks
-    std::set<sp<V1_6::IWifiNanIfaceEventCallback>> getEventCallbacks_1_6();
+    hidl_callback_util::HidlCallbackList<V1_6::IWifiNanIfaceEventCallback> getEventCallbacks_1_6();
 
     std::string ifname_;
     bool is_dedicated_iface_;
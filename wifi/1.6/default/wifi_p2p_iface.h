@@ -20,6 +20,7 @@
 #include <android-base/macros.h>
 #include <android/hardware/wifi/1.0/IWifiP2pIface.h>
 
+#include "hidl_sync_util.h"
 #include "wifi_legacy_hal.h"
 
 namespace android {
@@ -34,6 +35,9 @@ using namespace android::hardware::wifi::V1_0;
  */
 class WifiP2pIface : public V1_0::IWifiP2pIface {
   public:
+    // Domain of the lock held by the HIDL methods, see hidl_sync_util.
+    static constexpr hidl_sync_util::LockDomain kLockDomain =
+            hidl_sync_util::LockDomain::P2P_IFACE;
     WifiP2pIface(const std::string& ifname,
                  const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal);
     // Refer to |WifiChip::invalidate()|.
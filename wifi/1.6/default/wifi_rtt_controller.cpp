@@ -309,10 +309,20 @@ WifiStatus WifiRttController::rangeRequestInternal_1_6(
                     LOG(ERROR) << "Callback invoked on an invalid object";
                     return;
                 }
+                // The results of a request may come in several batches, each of which is
+                // delivered as soon as it arrives. A result that fails to convert is dropped on
+                // its own rather than holding back the other peers of the batch.
                 std::vector<V1_6::RttResult> hidl_results;
-                if (!hidl_struct_util::convertLegacyVectorOfRttResultToHidl(results,
-                                                                            &hidl_results)) {
-                    LOG(ERROR) << "Failed to convert rtt results to HIDL structs";
+                hidl_results.reserve(results.size());
+                for (const auto result : results) {
+                    V1_6::RttResult hidl_result;
+                    if (!hidl_struct_util::convertLegacyRttResultToHidl(*result, &hidl_result)) {
+                        LOG(ERROR) << "Failed to convert rtt result to HIDL struct";
+                        continue;
+                    }
+                    hidl_results.push_back(std::move(hidl_result));
+                }
+                if (hidl_results.empty() && !results.empty()) {
                     return;
                 }
                 for (const auto& callback : shared_ptr_this->getEventCallbacks()) {
@@ -22,6 +22,7 @@
 #include <android/hardware/wifi/1.6/IWifiRttController.h>
 #include <android/hardware/wifi/1.6/IWifiRttControllerEventCallback.h>
 
+#include "hidl_sync_util.h"
 #include "wifi_legacy_hal.h"
 
 namespace android {
@@ -35,6 +36,9 @@ namespace implementation {
  */
 class WifiRttController : public V1_6::IWifiRttController {
   public:
+    // Domain of the lock held by the HIDL methods, see hidl_sync_util.
+    static constexpr hidl_sync_util::LockDomain kLockDomain =
+            hidl_sync_util::LockDomain::RTT_CONTROLLER;
     WifiRttController(const std::string& iface_name, const sp<IWifiIface>& bound_iface,
                       const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal);
     // Refer to |WifiChip::invalidate()|.
@@ -53,7 +53,7 @@ std::string WifiStaIface::getName() {
     return ifname_;
 }
 
-std::set<sp<IWifiStaIfaceEventCallback>> WifiStaIface::getEventCallbacks() {
+hidl_callback_util::HidlCallbackList<IWifiStaIfaceEventCallback> WifiStaIface::getEventCallbacks() {
     return event_cb_handler_.getCallbacks();
 }
 
@@ -430,18 +430,21 @@ std::pair<WifiStatus, V1_5::StaLinkLayerStats> WifiStaIface::getLinkLayerStatsIn
     return {createWifiStatus(WifiStatusCode::ERROR_NOT_SUPPORTED), {}};
 }
 
-std::pair<WifiStatus, V1_6::StaLinkLayerStats> WifiStaIface::getLinkLayerStatsInternal_1_6() {
+std::pair<WifiStatus, const V1_6::StaLinkLayerStats&>
+WifiStaIface::getLinkLayerStatsInternal_1_6() {
     legacy_hal::wifi_error legacy_status;
-    legacy_hal::LinkLayerStats legacy_stats;
-    std::tie(legacy_status, legacy_stats) = legacy_hal_.lock()->getLinkLayerStats(ifname_);
+    const legacy_hal::LinkLayerStatsSample* legacy_sample;
+    std::tie(legacy_status, legacy_sample) = legacy_hal_.lock()->sampleLinkLayerStats(ifname_);
     if (legacy_status != legacy_hal::WIFI_SUCCESS) {
-        return {createWifiStatusFromLegacyError(legacy_status), {}};
+        link_layer_stats_ = {};
+        return {createWifiStatusFromLegacyError(legacy_status), link_layer_stats_};
     }
-    V1_6::StaLinkLayerStats hidl_stats;
-    if (!hidl_struct_util::convertLegacyLinkLayerStatsToHidl(legacy_stats, &hidl_stats)) {
-        return {createWifiStatus(WifiStatusCode::ERROR_UNKNOWN), {}};
+    if (!hidl_struct_util::convertLegacyLinkLayerStatsToHidl(legacy_sample->stats,
+                                                             &link_layer_stats_)) {
+        link_layer_stats_ = {};
+        return {createWifiStatus(WifiStatusCode::ERROR_UNKNOWN), link_layer_stats_};
     }
-    return {createWifiStatus(WifiStatusCode::SUCCESS), hidl_stats};
+    return {createWifiStatus(WifiStatusCode::SUCCESS), link_layer_stats_};
 }
 
 WifiStatus WifiStaIface::startRssiMonitoringInternal(uint32_t cmd_id, int32_t max_rssi,
@@ -22,6 +22,7 @@
 #include <android/hardware/wifi/1.6/IWifiStaIface.h>
 
 #include "hidl_callback_util.h"
+#include "hidl_sync_util.h"
 #include "wifi_iface_util.h"
 #include "wifi_legacy_hal.h"
 
@@ -37,13 +38,16 @@ using namespace android::hardware::wifi::V1_0;
  */
 class WifiStaIface : public V1_6::IWifiStaIface {
   public:
+    // Domain of the lock held by the HIDL methods, see hidl_sync_util.
+    static constexpr hidl_sync_util::LockDomain kLockDomain =
+            hidl_sync_util::LockDomain::STA_IFACE;
     WifiStaIface(const std::string& ifname,
                  const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal,
                  const std::weak_ptr<iface_util::WifiIfaceUtil> iface_util);
     // Refer to |WifiChip::invalidate()|.
     void invalidate();
     bool isValid();
-    std::set<sp<IWifiStaIfaceEventCallback>> getEventCallbacks();
+    hidl_callback_util::HidlCallbackList<IWifiStaIfaceEventCallback> getEventCallbacks();
     std::string getName();
 
     // HIDL methods exposed.
@@ -117,7 +121,8 @@ class WifiStaIface : public V1_6::IWifiStaIface {
     std::pair<WifiStatus, V1_0::StaLinkLayerStats> getLinkLayerStatsInternal();
     std::pair<WifiStatus, V1_3::StaLinkLayerStats> getLinkLayerStatsInternal_1_3();
     std::pair<WifiStatus, V1_5::StaLinkLayerStats> getLinkLayerStatsInternal_1_5();
-    std::pair<WifiStatus, V1_6::StaLinkLayerStats> getLinkLayerStatsInternal_1_6();
+    // Returns a reference to |link_layer_stats_|, only valid while the lock is held.
+    std::pair<WifiStatus, const V1_6::StaLinkLayerStats&> getLinkLayerStatsInternal_1_6();
     WifiStatus startRssiMonitoringInternal(uint32_t cmd_id, int32_t max_rssi, int32_t min_rssi);
     WifiStatus stopRssiMonitoringInternal(uint32_t cmd_id);
     std::pair<WifiStatus, StaRoamingCapabilities> getRoamingCapabilitiesInternal();
@@ -144,6 +149,9 @@ class WifiStaIface : public V1_6::IWifiStaIface {
     std::weak_ptr<iface_util::WifiIfaceUtil> iface_util_;
     bool is_valid_;
     hidl_callback_util::HidlCallbackHandler<IWifiStaIfaceEventCallback> event_cb_handler_;
+    // Link layer stats are polled periodically, convert them into the same
+    // struct every time so that its vectors are reused.
+    V1_6::StaLinkLayerStats link_layer_stats_;
 
     DISALLOW_COPY_AND_ASSIGN(WifiStaIface);
 };
@@ -18,27 +18,26 @@
 
 #include <android-base/logging.h>
 #include <libnl++/printer.h>
-#include <poll.h>
-
-#include <chrono>
 
 #include "util.h"
 
 namespace android::nlinterceptor {
 using namespace std::chrono_literals;
 
-static constexpr std::chrono::milliseconds kPollTimeout = 300ms;
+static constexpr std::chrono::milliseconds kLogSamplePeriod = 1000ms;
+static constexpr size_t kReceiveBatchSize = 16;
 static constexpr bool kSuperVerbose = true;
 
-InterceptorRelay::InterceptorRelay(uint32_t nlFamily, uint32_t clientNlPid,
+InterceptorRelay::InterceptorRelay(RelayLoop& loop, uint32_t nlFamily,
+                                   uint32_t clientNlPid,
                                    const std::string& clientName)
-    : mClientName(clientName),
+    : mLoop(loop),
+      mClientName(clientName),
       mNlSocket(std::make_optional<nl::Socket>(nlFamily, 0, 0)),
       mClientNlPid(clientNlPid) {}
 
 InterceptorRelay::~InterceptorRelay() {
-    mRunning = false;
-    if (mRelayThread.joinable()) mRelayThread.join();
+    if (mLoopId.has_value()) mLoop.remove(*mLoopId);
 }
 
 uint32_t InterceptorRelay::getPid() {
@@ -47,29 +46,36 @@ uint32_t InterceptorRelay::getPid() {
     return *pidMaybe;
 }
 
-void InterceptorRelay::relayMessages() {
-    pollfd fds[] = {
-        mNlSocket->preparePoll(POLLIN),
-    };
-    while (mRunning) {
-        if (poll(fds, countof(fds), kPollTimeout.count()) < 0) {
-            PLOG(FATAL) << "poll failed";
-            return;
-        }
-        const auto nlsockEvents = fds[0].revents;
+void InterceptorRelay::logMessage(const nl::Buffer<nlmsghdr>& msg) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - mLastLogTime < kLogSamplePeriod) {
+        mUnloggedCount++;
+        return;
+    }
+    LOG(VERBOSE) << "[" << mClientName
+                 << "] nlMsg: " << nl::toString(msg, NETLINK_GENERIC) << " ("
+                 << mUnloggedCount << " more since the last one)";
+    mLastLogTime = now;
+    mUnloggedCount = 0;
+}
 
-        if (isSocketBad(nlsockEvents)) {
-            LOG(ERROR) << "Netlink socket is bad";
-            mRunning = false;
-            return;
-        }
-        if (!isSocketReadable(nlsockEvents)) continue;
+bool InterceptorRelay::relayMessages(uint32_t events) {
+    // EPOLLIN, EPOLLERR and EPOLLHUP equal their poll counterparts.
+    if (isSocketBad(events)) {
+        LOG(ERROR) << "Netlink socket is bad";
+        mRunning = false;
+        return false;
+    }
+    if (!isSocketReadable(events)) return true;
 
+    // The socket is readable, so the first read does not block, and the rest
+    // of the batch it fetched is returned without system calls.
+    do {
         const auto [msgMaybe, sa] = mNlSocket->receiveFrom();
         if (!msgMaybe.has_value()) {
             LOG(ERROR) << "Failed to receive Netlink data!";
             mRunning = false;
-            return;
+            return false;
         }
         const auto msg = *msgMaybe;
         if (!msg.firstOk()) {
@@ -77,23 +83,26 @@ void InterceptorRelay::relayMessages() {
             // Test messages might be empty, this isn't fatal.
             continue;
         }
-        if constexpr (kSuperVerbose) {
-            LOG(VERBOSE) << "[" << mClientName
-                         << "] nlMsg: " << nl::toString(msg, NETLINK_GENERIC);
-        }
+        if constexpr (kSuperVerbose) logMessage(msg);
 
-        uint32_t destinationPid = 0;
+        sockaddr_nl destination = {};
+        destination.nl_family = AF_NETLINK;
         if (sa.nl_pid == 0) {
-            destinationPid = mClientNlPid;
-        }
-
-        if (!mNlSocket->send(msg, destinationPid)) {
-            LOG(ERROR) << "Failed to send Netlink message!";
-            mRunning = false;
-            return;
+            destination.nl_pid = mClientNlPid;
         }
+        mOutgoing.emplace_back(msg, destination);
+    } while (mNlSocket->hasPendingReceive());
+
+    // The messages point into the receive buffer, which the next read reuses.
+    const auto sent = mNlSocket->send(mOutgoing);
+    const bool ok = sent == mOutgoing.size();
+    mOutgoing.clear();
+    if (!ok) {
+        LOG(ERROR) << "Failed to send Netlink message!";
+        mRunning = false;
+        return false;
     }
-    LOG(VERBOSE) << "[" << mClientName << "] Exiting relay thread!";
+    return true;
 }
 
 bool InterceptorRelay::start() {
@@ -102,19 +111,27 @@ bool InterceptorRelay::start() {
             << "Can't relay messages: InterceptorRelay is already running!";
         return false;
     }
-    if (mRelayThread.joinable()) {
-        LOG(ERROR) << "relay thread is already running!";
+    if (mLoopId.has_value()) {
+        LOG(ERROR) << "relay was already started!";
         return false;
     }
     if (!mNlSocket.has_value()) {
         LOG(ERROR) << "Netlink socket not initialized!";
         return false;
     }
+    if (!mNlSocket->setReceiveBatchSize(kReceiveBatchSize)) {
+        LOG(ERROR) << "Failed to set receive batch size!";
+        return false;
+    }
 
     mRunning = true;
-    mRelayThread = std::thread(&InterceptorRelay::relayMessages, this);
+    mLoopId = mLoop.add(this, mNlSocket->preparePoll().fd);
+    if (!mLoopId.has_value()) {
+        mRunning = false;
+        return false;
+    }
 
-    LOG(VERBOSE) << "Relay threads initialized";
+    LOG(VERBOSE) << "Relay initialized";
     return true;
 }
 
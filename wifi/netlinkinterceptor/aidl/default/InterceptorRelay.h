@@ -18,25 +18,30 @@
 
 #include <libnl++/Socket.h>
 
-#include <mutex>
-#include <thread>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include "RelayLoop.h"
 
 namespace android::nlinterceptor {
 
 class InterceptorRelay {
    public:
     /**
-     * Wrapper around the netlink socket and thread which relays messages.
+     * Wrapper around the netlink socket which relays messages on a RelayLoop.
      *
+     * \param loop - relay loop to relay the messages on.
      * \param nlFamily - netlink family to use for the netlink socket.
      * \param clientNlPid - pid of the client netlink socket.
      * \param clientName - name of the client to be used for debugging.
      */
-    InterceptorRelay(uint32_t nlFamily, uint32_t clientNlPid,
+    InterceptorRelay(RelayLoop& loop, uint32_t nlFamily, uint32_t clientNlPid,
                      const std::string& clientName);
 
     /**
-     * Stops the relay thread if running and destroys itself.
+     * Removes itself from the relay loop if running and destroys itself.
      */
     ~InterceptorRelay();
 
@@ -48,7 +53,7 @@ class InterceptorRelay {
     uint32_t getPid();
 
     /**
-     * Spawns relay thread.
+     * Starts relaying messages on the relay loop.
      */
     bool start();
 
@@ -68,26 +73,42 @@ class InterceptorRelay {
      */
     bool unsubscribeGroup(uint32_t nlGroup);
 
+    /**
+     * Called by the relay loop when mNlSocket has events. Reads the batch of
+     * incoming Netlink messages destined for mNlSocket and forwards all of
+     * them with one system call. Messages from the kernel are relayed to the
+     * client specified in the constructor, the others to the kernel.
+     *
+     * \param events - epoll events of mNlSocket.
+     * \return false if the socket failed, and the relay must be removed.
+     */
+    bool relayMessages(uint32_t events);
+
    private:
+    RelayLoop& mLoop;
     std::string mClientName;  ///< Name of client (Wificond, for example).
     std::optional<nl::Socket> mNlSocket;
     const uint32_t mClientNlPid = 0;  ///< pid of client NL socket.
 
     /**
-     * If set to true, the relay thread should be running. Setting this to false
-     * stops the relay thread.
+     * Set to true while the relay loop relays the messages of mNlSocket.
      */
     std::atomic_bool mRunning = false;
+    std::optional<uint64_t> mLoopId;  ///< id of the relay in mLoop.
 
     /**
-     * Reads incoming Netlink messages destined for mNlSocket. If from the
-     * kernel, the message is relayed to the client specified in the
-     * constructor. Otherwise, the message is relayed to the kernel. This will
-     * run as long as mRunning is set to true.
+     * Messages of the current batch with their destinations, kept to reuse
+     * the allocation.
      */
-    void relayMessages();
+    std::vector<std::pair<nl::Buffer<nlmsghdr>, sockaddr_nl>> mOutgoing;
 
-    std::thread mRelayThread;
+    /**
+     * Formatting every message costs more than relaying it, so at most one
+     * message per period is logged, with the count of messages since.
+     */
+    std::chrono::steady_clock::time_point mLastLogTime;
+    uint64_t mUnloggedCount = 0;
+    void logMessage(const nl::Buffer<nlmsghdr>& msg);
 };
 
 }  // namespace android::nlinterceptor
@@ -29,7 +29,8 @@ ndk::ScopedAStatus NetlinkInterceptor::createSocket(
     uint32_t interceptorNlPid = 0;
 
     std::unique_ptr<InterceptorRelay> interceptor =
-        std::make_unique<InterceptorRelay>(nlFamily, clientNlPid, clientName);
+        std::make_unique<InterceptorRelay>(mRelayLoop, nlFamily, clientNlPid,
+                                           clientName);
 
     interceptorNlPid = interceptor->getPid();
 
@@ -46,7 +47,7 @@ ndk::ScopedAStatus NetlinkInterceptor::createSocket(
     }
 
     if (!interceptor->start()) {
-        LOG(ERROR) << "Failed to start interceptor thread!";
+        LOG(ERROR) << "Failed to start interceptor relay!";
         return ndk::ScopedAStatus(AStatus_fromStatus(::android::UNKNOWN_ERROR));
     }
 
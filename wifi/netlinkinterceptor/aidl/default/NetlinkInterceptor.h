@@ -22,6 +22,7 @@
 #include <map>
 
 #include "InterceptorRelay.h"
+#include "RelayLoop.h"
 
 namespace android::nlinterceptor {
 
@@ -51,6 +52,7 @@ class NetlinkInterceptor
         int32_t nlGroup) override;
 
    private:
+    RelayLoop mRelayLoop;  ///< Declared first, as the relays use it.
     ClientMap mClientMap;
 };
 
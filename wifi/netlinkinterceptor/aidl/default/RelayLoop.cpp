@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RelayLoop.h"
+
+#include <android-base/logging.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+
+#include "InterceptorRelay.h"
+
+namespace android::nlinterceptor {
+
+static constexpr uint64_t kExitId = 0;
+static constexpr size_t kMaxEvents = 16;
+
+RelayLoop::RelayLoop()
+    : mEpollFd(epoll_create1(EPOLL_CLOEXEC)),
+      mExitFd(eventfd(0, EFD_CLOEXEC)) {
+    CHECK(mEpollFd.ok()) << "Failed to create epoll instance";
+    CHECK(mExitFd.ok()) << "Failed to create exit eventfd";
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = kExitId;
+    CHECK(epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, mExitFd.get(), &event) == 0)
+        << "Failed to watch exit eventfd";
+
+    mThread = std::thread(&RelayLoop::run, this);
+}
+
+RelayLoop::~RelayLoop() {
+    const uint64_t one = 1;
+    if (write(mExitFd.get(), &one, sizeof(one)) != sizeof(one)) {
+        PLOG(FATAL) << "Failed to stop relay thread";
+    }
+    mThread.join();
+    CHECK(mRelays.empty()) << "Relay loop destroyed with relays left";
+}
+
+std::optional<uint64_t> RelayLoop::add(InterceptorRelay* relay, int fd) {
+    std::lock_guard<std::mutex> lock(mRelaysGuard);
+    const auto id = mNextId++;
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if (epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, fd, &event) < 0) {
+        PLOG(ERROR) << "Failed to watch Netlink socket";
+        return std::nullopt;
+    }
+    mRelays.emplace(id, Entry{relay, fd});
+    return id;
+}
+
+void RelayLoop::remove(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mRelaysGuard);
+    const auto it = mRelays.find(id);
+    if (it != mRelays.end()) removeLocked(it);
+}
+
+void RelayLoop::removeLocked(std::map<uint64_t, Entry>::iterator it) {
+    if (epoll_ctl(mEpollFd.get(), EPOLL_CTL_DEL, it->second.fd, nullptr) < 0) {
+        PLOG(ERROR) << "Failed to stop watching Netlink socket";
+    }
+    mRelays.erase(it);
+}
+
+void RelayLoop::run() {
+    std::array<epoll_event, kMaxEvents> events;
+    while (true) {
+        const int count = TEMP_FAILURE_RETRY(
+            epoll_wait(mEpollFd.get(), events.data(), events.size(), -1));
+        if (count < 0) {
+            PLOG(FATAL) << "epoll_wait failed";
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mRelaysGuard);
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.u64 == kExitId) {
+                LOG(VERBOSE) << "Exiting relay thread!";
+                return;
+            }
+            // The relay may have been removed after epoll_wait returned.
+            const auto it = mRelays.find(events[i].data.u64);
+            if (it == mRelays.end()) continue;
+
+            if (!it->second.relay->relayMessages(events[i].events)) {
+                removeLocked(it);
+            }
+        }
+    }
+}
+
+}  // namespace android::nlinterceptor
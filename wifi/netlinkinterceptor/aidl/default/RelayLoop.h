@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace android::nlinterceptor {
+
+class InterceptorRelay;
+
+class RelayLoop {
+   public:
+    /**
+     * Single thread relaying the messages of every InterceptorRelay, with the
+     * sockets of all relays multiplexed on one epoll instance.
+     */
+    RelayLoop();
+
+    /**
+     * Stops the relay thread. All relays must have been removed.
+     */
+    ~RelayLoop();
+
+    /**
+     * Starts calling relay->relayMessages() whenever fd has events.
+     *
+     * \param relay - relay to call, until it is removed or its call fails.
+     * \param fd - Netlink socket of the relay.
+     * \return id to remove the relay with, std::nullopt on error.
+     */
+    std::optional<uint64_t> add(InterceptorRelay* relay, int fd);
+
+    /**
+     * Stops calling a relay. Once this returns, the relay is not used by the
+     * relay thread anymore.
+     *
+     * \param id - id returned by add().
+     */
+    void remove(uint64_t id);
+
+   private:
+    struct Entry {
+        InterceptorRelay* relay;
+        int fd;
+    };
+
+    base::unique_fd mEpollFd;
+    base::unique_fd mExitFd;  ///< eventfd to stop the relay thread.
+
+    /**
+     * Held by the relay thread while relaying, so removing a relay waits for
+     * the batch it is relaying.
+     */
+    std::mutex mRelaysGuard;
+    std::map<uint64_t, Entry> mRelays;
+    uint64_t mNextId = 1;  ///< 0 is the id of mExitFd.
+
+    void removeLocked(std::map<uint64_t, Entry>::iterator it);
+
+    /**
+     * Waits for events on the relay sockets and relays their messages, until
+     * mExitFd is signalled.
+     */
+    void run();
+
+    std::thread mThread;
+};
+
+}  // namespace android::nlinterceptor